@@ -47,6 +47,7 @@
 #include "pm.h"
 #include "app_channel.h"
 #include "system.h"
+#include "stabilizer.h"
 
 
 #define DEBUG_MODULE "APPAPI"
@@ -138,10 +139,28 @@ void appMain() {
     appchannelReceiveDataPacket(buffer, APPCHANNEL_MTU, APPCHANNEL_WAIT_FOREVER);
     appchannelHasOverflowOccured(); // Deprecated (removed after August 2023)
     appchannelHasOverflowOccurred();
+    appchannelStreamWrite("hello", 5, APPCHANNEL_WAIT_FOREVER);
+    appchannelStreamFree();
   }
 
   // System
   {
     systemRequestShutdown();
   }
+
+  // Stabilizer snapshots
+  {
+    stabilizerSnapshot_t snapshot;
+    state_t state;
+    setpoint_t setpoint;
+    sensorData_t sensorData;
+    uint32_t sequence;
+    stabilizerGetSnapshot(&snapshot);
+    stabilizerGetState(&state);
+    stabilizerGetSetpoint(&setpoint);
+    stabilizerGetSensorData(&sensorData);
+    stabilizerSnapshotReadBegin(&sequence);
+    stabilizerSnapshotReadEnd(sequence);
+    stabilizerSetTickCallback(NULL);
+  }
 }
@@ -1,12 +1,15 @@
 %module cffirmware
 %include <stdint.i>
+%include <pybuffer.i>
 
 // ignore GNU specific compiler attributes
 #define __attribute__(x)
 
 %{
 #define SWIG_FILE_WITH_INIT
+#include <time.h>
 #include "math3d.h"
+#include "math3d_fast.h"
 #include "pptraj.h"
 #include "planner.h"
 #include "stabilizer_types.h"
@@ -20,14 +23,22 @@
 #include "controller_mellinger.h"
 #include "controller_brescianini.h"
 #include "controller_lee.h"
+#include "controller_benchmark.h"
 #include "power_distribution.h"
 #include "axis3fSubSampler.h"
 #include "outlierFilterTdoa.h"
 #include "kalman_core.h"
 #include "mm_tdoa.h"
+#include "kalman_replay.h"
+#include "lighthouse_replay.h"
+#include "clockCorrectionEngine.h"
+#include "clock_correction_replay.h"
+#include "tdoa_replay.h"
+#include "controller_batch.h"
 %}
 
 %include "math3d.h"
+%include "math3d_fast.h"
 %include "pptraj.h"
 %include "planner.h"
 %include "stabilizer_types.h"
@@ -37,14 +48,42 @@
 %include "controller_mellinger.h"
 %include "controller_brescianini.h"
 %include "controller_lee.h"
+%include "controller_benchmark.h"
 %include "power_distribution.h"
 %include "axis3fSubSampler.h"
 %include "outlierFilterTdoa.h"
 %include "kalman_core.h"
 %include "mm_tdoa.h"
+%include "kalman_replay.h"
+%include "lighthouse_replay.h"
+%include "clockCorrectionEngine.h"
+%include "clock_correction_replay.h"
+%include "tdoa_replay.h"
+%include "controller_batch.h"
+
+// Sample and output buffers for the replay, for instance numpy arrays with a dtype matching the C structs
+%pybuffer_binary(const char *sampleBuffer, size_t sampleBufferSize);
+%pybuffer_mutable_binary(char *outputBuffer, size_t outputBufferSize);
+// Second output buffer of the TDoA replay
+%pybuffer_mutable_binary(char *measurementBuffer, size_t measurementBufferSize);
+// Calibration and geometry data for the lighthouse replay, packed as the C structs
+%pybuffer_binary(const char *dataBuffer, size_t dataBufferSize);
+// Second output buffer of the controller batch, for the power distribution
+%pybuffer_mutable_binary(char *motorBuffer, size_t motorBufferSize);
 
 
 %inline %{
+// Host clock for the controller benchmark, in ns. Truncated to 32 bits, controllerBenchmarkRun() handles the wrap.
+static uint32_t controllerBenchmarkHostClock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
+void controllerBenchmarkRunHost(ControllerBenchmark type, uint32_t iterations, controllerBenchmarkResult_t* result)
+{
+    controllerBenchmarkRun(type, iterations, controllerBenchmarkHostClock, result);
+}
 struct poly4d* piecewise_get(struct piecewise_traj *pp, int i)
 {
     return &pp->pieces[i];
@@ -65,6 +104,18 @@ void poly4d_free(struct poly4d *p)
 {
     free(p);
 }
+struct plan_waypoint* plan_waypoint_malloc(int size)
+{
+    return (struct plan_waypoint*)malloc(sizeof(struct plan_waypoint) * size);
+}
+struct plan_waypoint* plan_waypoint_get(struct plan_waypoint *waypoints, int i)
+{
+    return &waypoints[i];
+}
+void plan_waypoint_free(struct plan_waypoint *p)
+{
+    free(p);
+}
 
 struct vec vec2svec(struct vec3_s v)
 {
@@ -95,11 +146,121 @@ void collisionAvoidanceUpdateSetpointWrap(
         collisionState,
         nOthers,
         otherPositions,
+        NULL,
         workspace,
         setpoint, sensorData, state);
     free(workspace);
 }
 
+int kalmanReplayRunBuffer(kalmanReplay_t* replay, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize)
+{
+    return kalmanReplayRun(replay,
+        (const kalmanReplaySample_t*)sampleBuffer, sampleBufferSize / sizeof(kalmanReplaySample_t),
+        (kalmanReplayOutput_t*)outputBuffer, outputBufferSize / sizeof(kalmanReplayOutput_t));
+}
+
+int lighthouseReplayRunBuffer(lighthouseReplay_t* replay, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize)
+{
+    return lighthouseReplayRun(replay,
+        (const lighthouseReplayFrame_t*)sampleBuffer, sampleBufferSize / sizeof(lighthouseReplayFrame_t),
+        (lighthouseReplayOutput_t*)outputBuffer, outputBufferSize / sizeof(lighthouseReplayOutput_t));
+}
+
+int clockCorrectionReplayRunBuffer(clockCorrectionReplay_t* replay, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize)
+{
+    int sampleCount = sampleBufferSize / sizeof(clockCorrectionReplaySample_t);
+    const int maxOutputCount = outputBufferSize / sizeof(clockCorrectionReplayOutput_t);
+    if (sampleCount > maxOutputCount) {
+        sampleCount = maxOutputCount;
+    }
+    return clockCorrectionReplayRun(replay,
+        (const clockCorrectionReplaySample_t*)sampleBuffer, sampleCount,
+        (clockCorrectionReplayOutput_t*)outputBuffer);
+}
+
+int tdoaReplayRunBuffer(tdoaReplay_t* replay, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize, char *measurementBuffer, size_t measurementBufferSize)
+{
+    int packetCount = sampleBufferSize / sizeof(tdoaReplayPacket_t);
+    const int maxResultCount = outputBufferSize / sizeof(tdoaReplayPacketResult_t);
+    if (packetCount > maxResultCount) {
+        packetCount = maxResultCount;
+    }
+    return tdoaReplayRun(replay,
+        (const tdoaReplayPacket_t*)sampleBuffer, packetCount,
+        (tdoaReplayPacketResult_t*)outputBuffer,
+        (tdoaReplayMeasurement_t*)measurementBuffer, measurementBufferSize / sizeof(tdoaReplayMeasurement_t));
+}
+
+int controllerBatchRunBuffer(controllerBatch_t* batch, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize)
+{
+    int count = sampleBufferSize / sizeof(controllerBatchInput_t);
+    const int maxOutputCount = outputBufferSize / sizeof(controllerBatchControl_t);
+    if (count > maxOutputCount) {
+        count = maxOutputCount;
+    }
+
+    return controllerBatchRun(batch, (const controllerBatchInput_t*)sampleBuffer, count, (controllerBatchControl_t*)outputBuffer, NULL);
+}
+
+int controllerBatchRunWithMotorsBuffer(controllerBatch_t* batch, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize, char *motorBuffer, size_t motorBufferSize)
+{
+    int count = sampleBufferSize / sizeof(controllerBatchInput_t);
+    const int maxOutputCount = outputBufferSize / sizeof(controllerBatchControl_t);
+    const int maxMotorCount = motorBufferSize / sizeof(controllerBatchMotors_t);
+    if (count > maxOutputCount) {
+        count = maxOutputCount;
+    }
+    if (count > maxMotorCount) {
+        count = maxMotorCount;
+    }
+
+    return controllerBatchRun(batch, (const controllerBatchInput_t*)sampleBuffer, count, (controllerBatchControl_t*)outputBuffer, (controllerBatchMotors_t*)motorBuffer);
+}
+
+int controllerBatchPowerDistributionBuffer(const char *sampleBuffer, size_t sampleBufferSize, char *motorBuffer, size_t motorBufferSize)
+{
+    int count = sampleBufferSize / sizeof(controllerBatchControl_t);
+    const int maxMotorCount = motorBufferSize / sizeof(controllerBatchMotors_t);
+    if (count > maxMotorCount) {
+        count = maxMotorCount;
+    }
+
+    return controllerBatchPowerDistribution((const controllerBatchControl_t*)sampleBuffer, count, (controllerBatchMotors_t*)motorBuffer);
+}
+
+int controllerBatchPlannerBuffer(struct planner* planner, const char *sampleBuffer, size_t sampleBufferSize, char *outputBuffer, size_t outputBufferSize)
+{
+    int count = sampleBufferSize / sizeof(float);
+    const int maxOutputCount = outputBufferSize / sizeof(controllerBatchGoal_t);
+    if (count > maxOutputCount) {
+        count = maxOutputCount;
+    }
+
+    return controllerBatchPlanner(planner, (const float*)sampleBuffer, count, (controllerBatchGoal_t*)outputBuffer);
+}
+
+bool lighthouseReplaySetCalibrationBuffer(lighthouseReplay_t* replay, uint8_t baseStation, const char *dataBuffer, size_t dataBufferSize)
+{
+    lighthouseCalibration_t calibration;
+    if (dataBufferSize != sizeof(calibration)) {
+        return false;
+    }
+    memcpy(&calibration, dataBuffer, sizeof(calibration));
+    lighthouseReplaySetCalibration(replay, baseStation, &calibration);
+    return true;
+}
+
+bool lighthouseReplaySetGeometryBuffer(lighthouseReplay_t* replay, uint8_t baseStation, const char *dataBuffer, size_t dataBufferSize)
+{
+    baseStationGeometry_t geometry;
+    if (dataBufferSize != sizeof(geometry)) {
+        return false;
+    }
+    memcpy(&geometry, dataBuffer, sizeof(geometry));
+    lighthouseReplaySetGeometry(replay, baseStation, &geometry);
+    return true;
+}
+
 void assertFail(char *exp, char *file, int line) {
     char buf[150];
     sprintf(buf, "%s in File: \"%s\", line %d\n", exp, file, line);
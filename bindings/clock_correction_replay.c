@@ -0,0 +1,87 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * clock_correction_replay.c - Host side benchmark of the clock correction algorithms
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "clock_correction_replay.h"
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void clockCorrectionReplayInit(clockCorrectionReplay_t* this, const clockCorrectionAlgorithm_t algorithm, const uint64_t mask) {
+  memset(this, 0, sizeof(clockCorrectionReplay_t));
+  this->algorithm = algorithm;
+  this->mask = mask;
+  this->stats.firstReliableSample = -1;
+}
+
+static bool update(clockCorrectionReplay_t* this, const clockCorrectionReplaySample_t* sample, const clockCorrectionReplaySample_t* previous) {
+  if (this->algorithm == clockCorrectionAlgorithmLeastSquares) {
+    return clockCorrectionEngineUpdateLeastSquares(&this->storage, sample->rx, previous->rx, sample->tx, previous->tx, this->mask);
+  }
+
+  const double candidate = clockCorrectionEngineCalculate(sample->rx, previous->rx, sample->tx, previous->tx, this->mask);
+  return clockCorrectionEngineUpdate(&this->storage, candidate);
+}
+
+int clockCorrectionReplayRun(clockCorrectionReplay_t* this, const clockCorrectionReplaySample_t* samples, const int sampleCount, clockCorrectionReplayOutput_t* output) {
+  // The loop is timed as a whole, timing each update would mostly measure the clock
+  const double start = now();
+
+  for (int i = 0; i < sampleCount; i++) {
+    bool isReliable = false;
+
+    // As in the TDoA engine, the first packet from an anchor only provides time stamps for the next one
+    if (i > 0) {
+      isReliable = update(this, &samples[i], &samples[i - 1]);
+    }
+
+    output[i].clockCorrection = clockCorrectionEngineGet(&this->storage);
+    output[i].isReliable = isReliable;
+
+    if (isReliable) {
+      this->stats.reliableCount++;
+      if (this->stats.firstReliableSample < 0) {
+        this->stats.firstReliableSample = i;
+      }
+    }
+  }
+
+  const double updateTime = now() - start;
+
+  this->stats.sampleCount += sampleCount;
+  this->stats.updateTime += updateTime;
+  if (this->stats.sampleCount > 1) {
+    this->stats.nsPerUpdate = this->stats.updateTime * 1e9 / (this->stats.sampleCount - 1);
+  }
+
+  return sampleCount;
+}
@@ -0,0 +1,88 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * clock_correction_replay.h - Host side benchmark of the clock correction algorithms
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "clockCorrectionEngine.h"
+
+/**
+ * This module runs a stream of packet time stamps from one anchor through one of the clock correction algorithms in
+ * clockCorrectionEngine.c, in the same way as the TDoA engine does it (see updateClockCorrection() in tdoaEngine.c).
+ * It is intended for benchmarking of the algorithms on the host, it is not part of the firmware.
+ */
+
+// Time stamps of one packet from an anchor
+typedef struct {
+  uint64_t usecTimestamp; // Time of the event in the log [us]
+  uint64_t rx; // Reception time in the tag clock (the reference clock)
+  uint64_t tx; // Transmission time in the anchor clock (clock x)
+} clockCorrectionReplaySample_t;
+
+// Result after each packet
+typedef struct {
+  double clockCorrection;
+  uint8_t isReliable;
+  uint8_t reserved[7];
+} clockCorrectionReplayOutput_t;
+
+typedef struct {
+  uint32_t sampleCount;
+  uint32_t reliableCount;
+  int32_t firstReliableSample; // Index of the first reliable sample, -1 if none
+  uint32_t reserved;
+  double updateTime; // Wall clock time spent in the run, including storing the results [s]
+  double nsPerUpdate;
+} clockCorrectionReplayStats_t;
+
+typedef struct {
+  clockCorrectionAlgorithm_t algorithm;
+  uint64_t mask;
+  clockCorrectionStorage_t storage;
+  clockCorrectionReplayStats_t stats;
+} clockCorrectionReplay_t;
+
+/**
+ * @brief Initialize a replay
+ *
+ * @param this  The replay
+ * @param algorithm  The clock correction algorithm to use
+ * @param mask  Mask with the bits used in the time stamps, for instance TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP
+ */
+void clockCorrectionReplayInit(clockCorrectionReplay_t* this, const clockCorrectionAlgorithm_t algorithm, const uint64_t mask);
+
+/**
+ * @brief Run all samples through the clock correction algorithm. The result after each sample is written to output,
+ * which must have room for sampleCount entries. Timing is available in this->stats when the function returns.
+ *
+ * @param this  The replay
+ * @param samples  The samples, sorted in time
+ * @param sampleCount  Number of samples
+ * @param output  Buffer for the results
+ * @return int  Number of results written to output
+ */
+int clockCorrectionReplayRun(clockCorrectionReplay_t* this, const clockCorrectionReplaySample_t* samples, const int sampleCount, clockCorrectionReplayOutput_t* output);
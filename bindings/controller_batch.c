@@ -0,0 +1,198 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * controller_batch.c - Host side batch evaluation of the controllers, power distribution and planner
+ */
+
+#include <string.h>
+
+#include "controller_batch.h"
+#include "controller_pid.h"
+#include "controller_brescianini.h"
+#include "power_distribution.h"
+
+void controllerBatchInit(controllerBatch_t* this, const controllerBatchType_t type) {
+  memset(this, 0, sizeof(controllerBatch_t));
+  this->type = type;
+
+  switch (type) {
+    case controllerBatchPid:
+      controllerPidInit();
+      break;
+    case controllerBatchMellinger:
+      controllerMellingerInit(&this->mellinger);
+      break;
+    case controllerBatchBrescianini:
+      controllerBrescianiniInit();
+      break;
+    case controllerBatchLee:
+      controllerLeeInit(&this->lee);
+      break;
+  }
+}
+
+static void toSetpointAndState(const controllerBatchInput_t* input, setpoint_t* setpoint, sensorData_t* sensors, state_t* state) {
+  memset(setpoint, 0, sizeof(setpoint_t));
+  setpoint->mode.x = input->mode[0];
+  setpoint->mode.y = input->mode[1];
+  setpoint->mode.z = input->mode[2];
+  setpoint->mode.yaw = input->mode[3];
+  setpoint->position = (point_t){.x = input->position[0], .y = input->position[1], .z = input->position[2]};
+  setpoint->velocity = (velocity_t){.x = input->velocity[0], .y = input->velocity[1], .z = input->velocity[2]};
+  setpoint->acceleration = (acc_t){.x = input->acceleration[0], .y = input->acceleration[1], .z = input->acceleration[2]};
+  setpoint->attitude.yaw = input->yaw;
+  setpoint->attitudeRate.yaw = input->yawRate;
+
+  memset(sensors, 0, sizeof(sensorData_t));
+  sensors->gyro = (Axis3f){.x = input->gyro[0], .y = input->gyro[1], .z = input->gyro[2]};
+
+  state->position = (point_t){.x = input->statePosition[0], .y = input->statePosition[1], .z = input->statePosition[2]};
+  state->velocity = (velocity_t){.x = input->stateVelocity[0], .y = input->stateVelocity[1], .z = input->stateVelocity[2]};
+  state->acc = (acc_t){.x = input->stateAcc[0], .y = input->stateAcc[1], .z = input->stateAcc[2]};
+  state->attitude = (attitude_t){.roll = input->stateAttitude[0], .pitch = input->stateAttitude[1], .yaw = input->stateAttitude[2]};
+  state->attitudeQuaternion = (quaternion_t){.x = input->stateQuaternion[0], .y = input->stateQuaternion[1],
+                                             .z = input->stateQuaternion[2], .w = input->stateQuaternion[3]};
+}
+
+static void fromControl(const control_t* control, controllerBatchControl_t* output) {
+  output->controlMode = control->controlMode;
+
+  switch (control->controlMode) {
+    case controlModeLegacy:
+      output->value[0] = control->thrust;
+      output->value[1] = control->roll;
+      output->value[2] = control->pitch;
+      output->value[3] = control->yaw;
+      break;
+    case controlModeForceTorque:
+      output->value[0] = control->thrustSi;
+      output->value[1] = control->torqueX;
+      output->value[2] = control->torqueY;
+      output->value[3] = control->torqueZ;
+      break;
+    case controlModeForce:
+      memcpy(output->value, control->normalizedForces, sizeof(output->value));
+      break;
+  }
+}
+
+static void toControl(const controllerBatchControl_t* input, control_t* control) {
+  memset(control, 0, sizeof(control_t));
+  control->controlMode = input->controlMode;
+
+  switch (control->controlMode) {
+    case controlModeLegacy:
+      control->thrust = input->value[0];
+      control->roll = (int16_t)input->value[1];
+      control->pitch = (int16_t)input->value[2];
+      control->yaw = (int16_t)input->value[3];
+      break;
+    case controlModeForceTorque:
+      control->thrustSi = input->value[0];
+      control->torqueX = input->value[1];
+      control->torqueY = input->value[2];
+      control->torqueZ = input->value[3];
+      break;
+    case controlModeForce:
+      memcpy(control->normalizedForces, input->value, sizeof(input->value));
+      break;
+  }
+}
+
+static void distributePower(const control_t* control, controllerBatchMotors_t* output) {
+  motors_thrust_uncapped_t motorThrustUncapped;
+  motors_thrust_pwm_t motorPwm;
+
+  powerDistribution(control, &motorThrustUncapped);
+  output->isCapped = powerDistributionCap(&motorThrustUncapped, &motorPwm);
+
+  memcpy(output->motorThrustUncapped, motorThrustUncapped.list, sizeof(output->motorThrustUncapped));
+  memcpy(output->motorPwm, motorPwm.list, sizeof(output->motorPwm));
+  memset(output->reserved, 0, sizeof(output->reserved));
+}
+
+int controllerBatchRun(controllerBatch_t* this, const controllerBatchInput_t* input, const int count,
+                       controllerBatchControl_t* control, controllerBatchMotors_t* motors) {
+  setpoint_t setpoint;
+  sensorData_t sensors;
+  state_t state;
+
+  for (int i = 0; i < count; i++) {
+    toSetpointAndState(&input[i], &setpoint, &sensors, &state);
+
+    switch (this->type) {
+      case controllerBatchPid:
+        controllerPid(&this->control, &setpoint, &sensors, &state, this->tick);
+        break;
+      case controllerBatchMellinger:
+        controllerMellinger(&this->mellinger, &this->control, &setpoint, &sensors, &state, this->tick);
+        break;
+      case controllerBatchBrescianini:
+        controllerBrescianini(&this->control, &setpoint, &sensors, &state, this->tick);
+        break;
+      case controllerBatchLee:
+        controllerLee(&this->lee, &this->control, &setpoint, &sensors, &state, this->tick);
+        break;
+    }
+
+    fromControl(&this->control, &control[i]);
+    if (motors) {
+      distributePower(&this->control, &motors[i]);
+    }
+
+    this->tick++;
+  }
+
+  return count;
+}
+
+int controllerBatchPowerDistribution(const controllerBatchControl_t* control, const int count, controllerBatchMotors_t* motors) {
+  control_t fwControl;
+
+  for (int i = 0; i < count; i++) {
+    toControl(&control[i], &fwControl);
+    distributePower(&fwControl, &motors[i]);
+  }
+
+  return count;
+}
+
+static void toArray(const struct vec v, float* array) {
+  array[0] = v.x;
+  array[1] = v.y;
+  array[2] = v.z;
+}
+
+int controllerBatchPlanner(struct planner* planner, const float* t, const int count, controllerBatchGoal_t* goal) {
+  for (int i = 0; i < count; i++) {
+    const struct traj_eval ev = plan_current_goal(planner, t[i]);
+
+    toArray(ev.pos, goal[i].position);
+    toArray(ev.vel, goal[i].velocity);
+    toArray(ev.acc, goal[i].acceleration);
+    toArray(ev.omega, goal[i].omega);
+    goal[i].yaw = ev.yaw;
+  }
+
+  return count;
+}
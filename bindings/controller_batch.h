@@ -0,0 +1,151 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * controller_batch.h - Host side batch evaluation of the controllers, power distribution and planner
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stabilizer_types.h"
+#include "controller_mellinger.h"
+#include "controller_lee.h"
+#include "planner.h"
+
+/**
+ * This module runs a controller, the power distribution or the planner over a whole buffer of inputs in one call, one
+ * stabilizer tick per input. It is the native version of a python loop that calls for instance controllerMellinger() once
+ * per tick, and is intended for parameter sweeps and regression tests on the host, it is not part of the firmware.
+ *
+ * The inputs and outputs are flat structs with fixed size fields, to make it simple to describe them as numpy dtypes
+ * (see bindings/util/controller_batch.py).
+ */
+
+typedef enum {
+  controllerBatchPid = 0,
+  controllerBatchMellinger = 1,
+  controllerBatchBrescianini = 2,
+  controllerBatchLee = 3,
+} controllerBatchType_t;
+
+// Setpoint and estimated state for one tick
+typedef struct {
+  // Setpoint
+  uint8_t mode[4]; // stab_mode_t for x, y, z and yaw
+  float position[3]; // m, used in modeAbs
+  float velocity[3]; // m/s
+  float acceleration[3]; // m/s^2
+  float yaw; // deg, used in modeAbs
+  float yawRate; // deg/s, used in modeVelocity
+
+  // State
+  float statePosition[3]; // m
+  float stateVelocity[3]; // m/s
+  float stateAcc[3]; // Gs, without gravity
+  float stateAttitude[3]; // roll, pitch, yaw [deg] (legacy CF2 body coordinate system, where pitch is inverted)
+  float stateQuaternion[4]; // x, y, z, w
+  float gyro[3]; // deg/s
+} controllerBatchInput_t;
+
+// Output of the controller, and the input to the power distribution
+typedef struct {
+  uint32_t controlMode; // control_mode_t
+  // controlModeLegacy: thrust, roll, pitch, yaw
+  // controlModeForceTorque: thrustSi, torqueX, torqueY, torqueZ
+  // controlModeForce: normalizedForces
+  float value[4];
+} controllerBatchControl_t;
+
+// Output of the power distribution
+typedef struct {
+  int32_t motorThrustUncapped[STABILIZER_NR_OF_MOTORS];
+  uint16_t motorPwm[STABILIZER_NR_OF_MOTORS];
+  uint8_t isCapped;
+  uint8_t reserved[3];
+} controllerBatchMotors_t;
+
+// Output of the planner
+typedef struct {
+  float position[3];
+  float velocity[3];
+  float acceleration[3];
+  float omega[3];
+  float yaw; // rad
+} controllerBatchGoal_t;
+
+typedef struct {
+  controllerBatchType_t type;
+  controllerMellinger_t mellinger;
+  controllerLee_t lee;
+
+  // The controllers do not update all fields on every tick, the output is kept between ticks as in the stabilizer loop
+  control_t control;
+
+  // The stabilizer tick of the next input, controllers run their loops at fractions of the 1 kHz tick rate
+  stabilizerStep_t tick;
+} controllerBatch_t;
+
+/**
+ * @brief Initialize the selected controller and reset the tick. The PID and Brescianini controllers keep their state
+ * in globals, only one batch using one of them can be used at a time.
+ *
+ * @param this  The batch
+ * @param type  The controller to run
+ */
+void controllerBatchInit(controllerBatch_t* this, const controllerBatchType_t type);
+
+/**
+ * @brief Run the controller once per input, starting at this->tick. The controller state is kept between calls, a long
+ * run can be split in several calls.
+ *
+ * @param this  The batch
+ * @param input  The setpoints and states
+ * @param count  Number of inputs
+ * @param control  Buffer for the controller output, room for count entries
+ * @param motors  Buffer for the output of the power distribution of each control output, room for count entries. May be
+ *                NULL if the power distribution should not run.
+ * @return int  Number of ticks run
+ */
+int controllerBatchRun(controllerBatch_t* this, const controllerBatchInput_t* input, const int count,
+                       controllerBatchControl_t* control, controllerBatchMotors_t* motors);
+
+/**
+ * @brief Run the power distribution, including capping, on each control input
+ *
+ * @param control  The control inputs
+ * @param count  Number of control inputs
+ * @param motors  Buffer for the output, room for count entries
+ * @return int  Number of outputs written
+ */
+int controllerBatchPowerDistribution(const controllerBatchControl_t* control, const int count, controllerBatchMotors_t* motors);
+
+/**
+ * @brief Evaluate the current goal of the planner at each time. The goal is NaN when the planner is not flying.
+ *
+ * @param planner  The planner
+ * @param t  Times [s], must not decrease since the planner may be streaming
+ * @param count  Number of times
+ * @param goal  Buffer for the output, room for count entries
+ * @return int  Number of outputs written
+ */
+int controllerBatchPlanner(struct planner* planner, const float* t, const int count, controllerBatchGoal_t* goal);
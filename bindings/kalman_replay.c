@@ -0,0 +1,170 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * kalman_replay.c - Host side replay of recorded sensor data through the kalman core
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "kalman_replay.h"
+#include "mm_tdoa.h"
+#include "physicalConstants.h"
+#include "cf_math.h"
+
+#define PREDICT_RATE 100
+#define TDOA_ENGINE_MEASUREMENT_NOISE_STD 0.30f
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void kalmanReplayInit(kalmanReplay_t* this) {
+  memset(this, 0, sizeof(kalmanReplay_t));
+  kalmanCoreDefaultParams(&this->coreParams);
+  this->tdoaStdDev = TDOA_ENGINE_MEASUREMENT_NOISE_STD;
+  this->predictStepMs = 1000 / PREDICT_RATE;
+}
+
+void kalmanReplaySetAnchorPosition(kalmanReplay_t* this, const uint8_t id, const float x, const float y, const float z) {
+  if (id < KALMAN_REPLAY_MAX_ANCHORS) {
+    this->anchorPositions[id].x = x;
+    this->anchorPositions[id].y = y;
+    this->anchorPositions[id].z = z;
+  }
+}
+
+static void updateWithSample(kalmanReplay_t* this, const kalmanReplaySample_t* sample, const uint32_t nowMs) {
+  switch (sample->type) {
+    case kalmanReplaySampleAcceleration:
+      {
+        Axis3f acc = {.x = sample->value[0], .y = sample->value[1], .z = sample->value[2]};
+        axis3fSubSamplerAccumulate(&this->accSubSampler, &acc);
+      }
+      break;
+    case kalmanReplaySampleGyroscope:
+      {
+        Axis3f gyro = {.x = sample->value[0], .y = sample->value[1], .z = sample->value[2]};
+        axis3fSubSamplerAccumulate(&this->gyroSubSampler, &gyro);
+      }
+      break;
+    case kalmanReplaySampleTdoa:
+      if (sample->anchorIdA < KALMAN_REPLAY_MAX_ANCHORS && sample->anchorIdB < KALMAN_REPLAY_MAX_ANCHORS) {
+        tdoaMeasurement_t tdoa = {
+          .anchorIdA = sample->anchorIdA,
+          .anchorIdB = sample->anchorIdB,
+          .anchorPositionA = this->anchorPositions[sample->anchorIdA],
+          .anchorPositionB = this->anchorPositions[sample->anchorIdB],
+          .distanceDiff = sample->value[0],
+          .stdDev = this->tdoaStdDev,
+        };
+        kalmanCoreUpdateWithTdoa(&this->coreData, &tdoa, nowMs, &this->outlierFilterState);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+int kalmanReplayRun(kalmanReplay_t* this, const kalmanReplaySample_t* samples, const int sampleCount, kalmanReplayOutput_t* output, const int maxOutputCount) {
+  memset(&this->stats, 0, sizeof(this->stats));
+  if (sampleCount <= 0) {
+    return 0;
+  }
+
+  uint32_t nowMs = samples[0].timestamp;
+  uint32_t nextPredictionMs = nowMs + this->predictStepMs;
+
+  axis3fSubSamplerInit(&this->accSubSampler, GRAVITY_MAGNITUDE);
+  axis3fSubSamplerInit(&this->gyroSubSampler, DEG_TO_RAD);
+  outlierFilterTdoaReset(&this->outlierFilterState);
+  kalmanCoreInit(&this->coreData, &this->coreParams, nowMs);
+
+  // Simplification, assume always flying
+  const bool quadIsFlying = true;
+
+  int sampleIndex = 0;
+  int outputCount = 0;
+  const double startTime = now();
+  while (sampleIndex < sampleCount) {
+    double t0 = now();
+    if (nowMs > nextPredictionMs) {
+      axis3fSubSamplerFinalize(&this->accSubSampler);
+      axis3fSubSamplerFinalize(&this->gyroSubSampler);
+      kalmanCorePredict(&this->coreData, &this->accSubSampler.subSample, &this->gyroSubSampler.subSample, nowMs, quadIsFlying);
+      nextPredictionMs += this->predictStepMs;
+      this->stats.predictionCount++;
+    }
+    double t1 = now();
+    this->stats.predictTime += t1 - t0;
+
+    kalmanCoreAddProcessNoise(&this->coreData, &this->coreParams, nowMs);
+    double t2 = now();
+    this->stats.processNoiseTime += t2 - t1;
+
+    while (sampleIndex < sampleCount && samples[sampleIndex].timestamp <= nowMs) {
+      updateWithSample(this, &samples[sampleIndex], nowMs);
+      sampleIndex++;
+    }
+    double t3 = now();
+    this->stats.updateTime += t3 - t2;
+
+    kalmanCoreFinalize(&this->coreData, &this->coreParams);
+    this->stats.finalizeTime += now() - t3;
+
+    // Main loop called at 1000 Hz in the firmware
+    nowMs++;
+    this->stats.iterationCount++;
+
+    if (outputCount < maxOutputCount) {
+      state_t state;
+      const Axis3f accLatest = {.axis = {0}};
+      kalmanCoreExternalizeState(&this->coreData, &state, &accLatest);
+
+      kalmanReplayOutput_t* out = &output[outputCount];
+      out->timestamp = nowMs;
+      out->position[0] = state.position.x;
+      out->position[1] = state.position.y;
+      out->position[2] = state.position.z;
+      out->velocity[0] = state.velocity.x;
+      out->velocity[1] = state.velocity.y;
+      out->velocity[2] = state.velocity.z;
+      out->quaternion[0] = state.attitudeQuaternion.x;
+      out->quaternion[1] = state.attitudeQuaternion.y;
+      out->quaternion[2] = state.attitudeQuaternion.z;
+      out->quaternion[3] = state.attitudeQuaternion.w;
+      outputCount++;
+    }
+  }
+
+  this->stats.totalTime = now() - startTime;
+  this->stats.sampleCount = sampleCount;
+  if (this->stats.totalTime > 0.0) {
+    this->stats.samplesPerSecond = sampleCount / this->stats.totalTime;
+  }
+
+  return outputCount;
+}
@@ -0,0 +1,123 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * kalman_replay.h - Host side replay of recorded sensor data through the kalman core
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "kalman_core.h"
+#include "outlierFilterTdoa.h"
+#include "axis3fSubSampler.h"
+
+/**
+ * This module runs recorded sensor data through the kalman core in the same way as estimator_kalman.c, but without
+ * FreeRTOS and with all samples available up front in one buffer. It is the native version of
+ * bindings/util/estimator_kalman_emulator.py and is intended for benchmarking of estimator changes on the host, it is
+ * not part of the firmware.
+ */
+
+#define KALMAN_REPLAY_MAX_ANCHORS 16
+
+typedef enum {
+  kalmanReplaySampleAcceleration = 0,
+  kalmanReplaySampleGyroscope = 1,
+  kalmanReplaySampleTdoa = 2,
+} kalmanReplaySampleType_t;
+
+// One recorded sensor sample, samples must be sorted on timestamp
+typedef struct {
+  uint32_t timestamp; // [ms]
+  uint8_t type; // kalmanReplaySampleType_t
+  uint8_t anchorIdA; // TDoA only
+  uint8_t anchorIdB; // TDoA only
+  uint8_t reserved;
+  float value[3]; // Acceleration [G], angular rate [deg/s] or distance difference in value[0] [m]
+} kalmanReplaySample_t;
+
+// The estimated state after one iteration of the 1 kHz loop
+typedef struct {
+  uint32_t timestamp; // [ms]
+  float position[3];
+  float velocity[3];
+  float quaternion[4]; // x, y, z, w
+} kalmanReplayOutput_t;
+
+// Wall clock time spent in each phase of the filter, and the resulting throughput
+typedef struct {
+  uint32_t sampleCount;
+  uint32_t iterationCount;
+  uint32_t predictionCount;
+  double predictTime; // [s]
+  double processNoiseTime; // [s]
+  double updateTime; // [s]
+  double finalizeTime; // [s]
+  double totalTime; // [s]
+  double samplesPerSecond;
+} kalmanReplayStats_t;
+
+typedef struct {
+  kalmanCoreData_t coreData;
+  kalmanCoreParams_t coreParams;
+  Axis3fSubSampler_t accSubSampler;
+  Axis3fSubSampler_t gyroSubSampler;
+  OutlierFilterTdoaState_t outlierFilterState;
+
+  point_t anchorPositions[KALMAN_REPLAY_MAX_ANCHORS];
+  float tdoaStdDev;
+  uint32_t predictStepMs;
+
+  kalmanReplayStats_t stats;
+} kalmanReplay_t;
+
+/**
+ * @brief Initialize a replay with the default kalman core parameters. The parameters in coreParams may be modified
+ * before the replay is run.
+ *
+ * @param this  The replay
+ */
+void kalmanReplayInit(kalmanReplay_t* this);
+
+/**
+ * @brief Set the position of an anchor, used by TDoA samples
+ *
+ * @param this  The replay
+ * @param id  The anchor id, must be less than KALMAN_REPLAY_MAX_ANCHORS
+ */
+void kalmanReplaySetAnchorPosition(kalmanReplay_t* this, const uint8_t id, const float x, const float y, const float z);
+
+/**
+ * @brief Run all samples through the estimator, one iteration of the 1 kHz loop at a time from the time of the first
+ * sample. The estimated state after each iteration is written to output, until maxOutputCount is reached. Timing is
+ * available in this->stats when the function returns.
+ *
+ * @param this  The replay
+ * @param samples  The samples, sorted on timestamp
+ * @param sampleCount  Number of samples
+ * @param output  Buffer for the estimated states, may be NULL if maxOutputCount is 0
+ * @param maxOutputCount  Size of the output buffer
+ * @return int  Number of states written to output
+ */
+int kalmanReplayRun(kalmanReplay_t* this, const kalmanReplaySample_t* samples, const int sampleCount, kalmanReplayOutput_t* output, const int maxOutputCount);
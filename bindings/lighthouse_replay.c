@@ -0,0 +1,272 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * lighthouse_replay.c - Host side replay of recorded lighthouse frames
+ */
+
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "lighthouse_replay.h"
+#include "lighthouse_recorder.h"
+#include "pulse_processor_v2.h"
+#include "lighthouse_calibration.h"
+#include "lighthouse_geometry.h"
+#include "usec_time.h"
+
+// The time of the frame that is currently processed, used by the pulse processor through usecTimestamp()
+static uint64_t replayUsecTime = 0;
+
+uint64_t usecTimestamp(void) {
+  return replayUsecTime;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void modifyBit(uint16_t *bitmap, const int index, const bool value) {
+  const uint16_t mask = (1 << index);
+
+  if (value) {
+    *bitmap |= mask;
+  } else {
+    *bitmap &= ~mask;
+  }
+}
+
+void lighthouseReplayInit(lighthouseReplay_t* this) {
+  memset(this, 0, sizeof(lighthouseReplay_t));
+  this->angles.measurementType = lighthouseBsTypeV2;
+}
+
+void lighthouseReplaySetCalibration(lighthouseReplay_t* this, const uint8_t baseStation, const lighthouseCalibration_t* calibration) {
+  if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
+    this->state.bsCalibration[baseStation] = *calibration;
+    pulseProcessorCalibrationDataUpdated(&this->state, baseStation);
+    modifyBit(&this->state.baseStationCalibValidMap, baseStation, calibration->valid);
+  }
+}
+
+void lighthouseReplaySetGeometry(lighthouseReplay_t* this, const uint8_t baseStation, const baseStationGeometry_t* geometry) {
+  if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
+    this->state.bsGeometry[baseStation] = *geometry;
+    modifyBit(&this->state.baseStationGeoValidMap, baseStation, geometry->valid);
+  }
+}
+
+static void decodeFrame(const lighthouseReplayFrame_t* recorded, pulseProcessorFrame_t* frame) {
+  memset(frame, 0, sizeof(pulseProcessorFrame_t));
+  frame->sensor = recorded->info & LIGHTHOUSE_RECORDER_INFO_SENSOR_MASK;
+  frame->timestamp = recorded->timestamp;
+  frame->width = recorded->width;
+  frame->beamData = recorded->beamData;
+  frame->offset = recorded->offset;
+  frame->channelFound = (recorded->info & LIGHTHOUSE_RECORDER_INFO_CHANNEL_FOUND) != 0;
+  if (frame->channelFound) {
+    frame->channel = recorded->info >> LIGHTHOUSE_RECORDER_INFO_CHANNEL_SHIFT;
+    frame->slowBit = (recorded->info & LIGHTHOUSE_RECORDER_INFO_SLOW_BIT) != 0;
+  }
+}
+
+// Same as useCalibrationData() in lighthouse_core.c, without persisting the data
+static void useDecodedCalibrationData(lighthouseReplay_t* this) {
+  for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
+    pulseProcessorBsSlot_t* slot = pulseProcessorFindBsSlot(&this->state, baseStation);
+    if (slot && slot->ootxDecoder.isFullyDecoded) {
+      lighthouseCalibration_t newData;
+      lighthouseCalibrationInitFromFrame(&newData, &slot->ootxDecoder.frame);
+
+      const lighthouseCalibration_t* current = &this->state.bsCalibration[baseStation];
+      if ((newData.uid != current->uid) || (newData.valid != current->valid)) {
+        lighthouseReplaySetCalibration(this, baseStation, &newData);
+      }
+    }
+  }
+}
+
+static void convertV2AnglesToV1Angles(pulseProcessorResult_t* angles) {
+  for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+      pulseProcessorSensorMeasurement_t* from = &angles->baseStationMeasurementsLh2[bs].sensorMeasurements[sensor];
+      pulseProcessorSensorMeasurement_t* to = &angles->baseStationMeasurementsLh1[bs].sensorMeasurements[sensor];
+
+      if (2 == from->validCount) {
+        pulseProcessorV2ConvertToV1Angles(from->correctedAngles[0], from->correctedAngles[1], to->correctedAngles);
+        to->validCount = from->validCount;
+      } else {
+        to->validCount = 0;
+      }
+    }
+  }
+}
+
+static uint16_t findBaseStationsWithData(const pulseProcessorResult_t* angles) {
+  uint16_t result = 0;
+  for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
+    if (angles->baseStationMeasurementsLh1[baseStation].sensorMeasurements[0].validCount == PULSE_PROCESSOR_N_SWEEPS) {
+      result |= (1 << baseStation);
+    }
+  }
+
+  return result;
+}
+
+static bool estimatePosition(lighthouseReplay_t* this, const uint16_t baseStationMap, lighthouseReplayOutput_t* out) {
+  vec3d origins[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+  vec3d rays[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+  vec3d sum = {0};
+  float residualSqSum = 0;
+
+  for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    int count = 0;
+    for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
+      const pulseProcessorSensorMeasurement_t* measurement = &this->angles.baseStationMeasurementsLh1[baseStation].sensorMeasurements[sensor];
+      if ((baseStationMap & (1 << baseStation)) && measurement->validCount == PULSE_PROCESSOR_N_SWEEPS) {
+        const baseStationGeometry_t* geo = &this->state.bsGeometry[baseStation];
+        lighthouseGeometryGetBaseStationPosition(geo, origins[count]);
+        lighthouseGeometryGetRay(geo, measurement->correctedAngles[0], measurement->correctedAngles[1], rays[count]);
+        count++;
+      }
+    }
+
+    vec3d position;
+    float residual;
+    if (!lighthouseGeometryGetPositionFromRays(origins, rays, count, position, &residual)) {
+      return false;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      sum[i] += position[i];
+    }
+    residualSqSum += residual * residual;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    out->position[i] = sum[i] / PULSE_PROCESSOR_N_SENSORS;
+  }
+  out->residual = sqrtf(residualSqSum / PULSE_PROCESSOR_N_SENSORS);
+  out->baseStationMap = baseStationMap;
+
+  return isfinite(out->position[0]) && isfinite(out->position[1]) && isfinite(out->position[2]);
+}
+
+// Same cycle logic as usePulseResultCrossingBeamsLh2() in lighthouse_core.c
+static bool useSweepPair(lighthouseReplay_t* this, const int baseStation, lighthouseReplayOutput_t* out) {
+  pulseProcessorClearOutdated(&this->state, &this->angles, baseStation);
+
+  const uint16_t baseStationsWithData = findBaseStationsWithData(&this->angles) & this->state.baseStationGeoValidMap;
+  const uint16_t baseStationBitMap = (1 << baseStation);
+
+  if (baseStationsWithData & baseStationBitMap) {
+    if (this->seenMap & baseStationBitMap) {
+      this->expectedMap = this->seenMap;
+      this->seenMap = 0;
+    }
+    this->seenMap |= baseStationBitMap;
+  }
+
+  bool result = false;
+  const bool gotExpected = ((baseStationsWithData & this->expectedMap) == this->expectedMap);
+  if (gotExpected && __builtin_popcount(baseStationsWithData) >= 2) {
+    result = estimatePosition(this, baseStationsWithData, out);
+
+    for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+      if (baseStationsWithData & (1 << bs)) {
+        pulseProcessorProcessed(&this->angles, bs);
+      }
+    }
+  }
+
+  return result;
+}
+
+int lighthouseReplayRun(lighthouseReplay_t* this, const lighthouseReplayFrame_t* frames, const int frameCount, lighthouseReplayOutput_t* output, const int maxOutputCount) {
+  memset(&this->stats, 0, sizeof(this->stats));
+  if (frameCount <= 0) {
+    return 0;
+  }
+
+  int outputCount = 0;
+  const double startTime = now();
+  for (int i = 0; i < frameCount; i++) {
+    replayUsecTime = frames[i].usecTimestamp;
+
+    pulseProcessorFrame_t frame;
+    decodeFrame(&frames[i], &frame);
+
+    int baseStation;
+    int sweepId;
+    bool calibDataIsDecoded = false;
+
+    const double t0 = now();
+    const bool hasSweep = pulseProcessorV2ProcessPulse(&this->state, &frame, &this->angles, &baseStation, &sweepId, &calibDataIsDecoded);
+    const double t1 = now();
+    this->stats.pulseProcessorTime += t1 - t0;
+
+    if (calibDataIsDecoded) {
+      useDecodedCalibrationData(this);
+    }
+
+    if (!hasSweep) {
+      continue;
+    }
+    this->stats.sweepCount++;
+
+    if (sweepId != sweepIdSecond) {
+      continue;
+    }
+
+    const bool hasCalibrationData = pulseProcessorApplyCalibration(&this->state, &this->angles, baseStation);
+    if (hasCalibrationData) {
+      convertV2AnglesToV1Angles(&this->angles);
+      this->stats.calibratedCount++;
+    }
+    const double t2 = now();
+    this->stats.calibrationTime += t2 - t1;
+
+    if (hasCalibrationData && this->state.bsGeometry[baseStation].valid) {
+      lighthouseReplayOutput_t out = {.usecTimestamp = replayUsecTime};
+      if (useSweepPair(this, baseStation, &out)) {
+        this->stats.positionCount++;
+        if (outputCount < maxOutputCount) {
+          output[outputCount] = out;
+          outputCount++;
+        }
+      }
+    }
+    this->stats.positionTime += now() - t2;
+  }
+
+  this->stats.totalTime = now() - startTime;
+  this->stats.frameCount = frameCount;
+  if (this->stats.totalTime > 0.0) {
+    this->stats.framesPerSecond = frameCount / this->stats.totalTime;
+  }
+
+  return outputCount;
+}
@@ -0,0 +1,125 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * lighthouse_replay.h - Host side replay of recorded lighthouse frames
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "pulse_processor.h"
+
+/**
+ * This module runs lighthouse frames recorded by lighthouse_recorder.c through the V2 pulse processor, the calibration
+ * and the crossing beams position solver in the same way as lighthouse_core.c, but without FreeRTOS and as fast as
+ * the host can run it. It is intended for benchmarking and verification of changes to the lighthouse pipeline on the
+ * host, it is not part of the firmware.
+ *
+ * The positions are computed with lighthouseGeometryGetPositionFromRays() per sensor and averaged over the sensors,
+ * as for the multi base station crossing beams method in lighthouse_position_est.c.
+ */
+
+// One recorded frame, frames must be sorted on usecTimestamp
+typedef struct {
+  uint64_t usecTimestamp; // Time of the event in the log [us]
+  uint32_t timestamp; // Deck timestamp, 24 MHz
+  uint32_t beamData;
+  uint32_t offset;
+  uint16_t width;
+  uint8_t info; // Sensor, channel and flags, see LIGHTHOUSE_RECORDER_INFO_* in lighthouse_recorder.h
+  uint8_t reserved;
+} lighthouseReplayFrame_t;
+
+// One crossing beams position solve
+typedef struct {
+  uint64_t usecTimestamp; // [us]
+  float position[3];
+  float residual; // RMS of the residuals of the sensors [m]
+  uint16_t baseStationMap; // The base stations used in the solve
+  uint16_t reserved0;
+  uint32_t reserved1;
+} lighthouseReplayOutput_t;
+
+// Wall clock time spent in each phase, and the resulting throughput
+typedef struct {
+  uint32_t frameCount;
+  uint32_t sweepCount; // Sweeps decoded by the pulse processor
+  uint32_t calibratedCount; // Sweep pairs with calibration data
+  uint32_t positionCount;
+  double pulseProcessorTime; // [s]
+  double calibrationTime; // [s]
+  double positionTime; // [s]
+  double totalTime; // [s]
+  double framesPerSecond;
+} lighthouseReplayStats_t;
+
+typedef struct {
+  pulseProcessor_t state;
+  pulseProcessorResult_t angles;
+
+  // Cycle tracking for the crossing beams solve, as in lighthouse_core.c
+  uint16_t seenMap;
+  uint16_t expectedMap;
+
+  lighthouseReplayStats_t stats;
+} lighthouseReplay_t;
+
+/**
+ * @brief Initialize a replay without calibration and geometry data
+ *
+ * @param this  The replay
+ */
+void lighthouseReplayInit(lighthouseReplay_t* this);
+
+/**
+ * @brief Set the calibration data of a base station. Calibration data decoded from the frames (OOTX) replaces this
+ * data if the uid differs, as in the firmware.
+ *
+ * @param this  The replay
+ * @param baseStation  The base station, must be less than CONFIG_DECK_LIGHTHOUSE_MAX_N_BS
+ * @param calibration  The calibration data
+ */
+void lighthouseReplaySetCalibration(lighthouseReplay_t* this, const uint8_t baseStation, const lighthouseCalibration_t* calibration);
+
+/**
+ * @brief Set the geometry data of a base station
+ *
+ * @param this  The replay
+ * @param baseStation  The base station, must be less than CONFIG_DECK_LIGHTHOUSE_MAX_N_BS
+ * @param geometry  The geometry data
+ */
+void lighthouseReplaySetGeometry(lighthouseReplay_t* this, const uint8_t baseStation, const baseStationGeometry_t* geometry);
+
+/**
+ * @brief Run all frames through the pulse processor and the position solver. Each position is written to output,
+ * until maxOutputCount is reached. Timing is available in this->stats when the function returns.
+ *
+ * @param this  The replay
+ * @param frames  The frames, sorted on usecTimestamp
+ * @param frameCount  Number of frames
+ * @param output  Buffer for the positions, may be NULL if maxOutputCount is 0
+ * @param maxOutputCount  Size of the output buffer
+ * @return int  Number of positions written to output
+ */
+int lighthouseReplayRun(lighthouseReplay_t* this, const lighthouseReplayFrame_t* frames, const int frameCount, lighthouseReplayOutput_t* output, const int maxOutputCount);
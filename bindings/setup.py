@@ -11,13 +11,16 @@ include = [
     "src/modules/interface/outlierfilter",
     "src/hal/interface",
     "src/utils/interface/lighthouse",
+    "src/modules/interface/lighthouse",
     "src/utils/interface",
+    "src/utils/interface/tdoa",
     "build/include/generated",
     "src/config",
     "src/drivers/interface",
     "src/platform/interface",
     "vendor/CMSIS/CMSIS/DSP/Include",
     "vendor/CMSIS/CMSIS/Core/Include",
+    "bindings",
 ]
 
 fw_sources = [
@@ -34,6 +37,7 @@ fw_sources = [
     'vendor/CMSIS/CMSIS/DSP/Source/MatrixFunctions/arm_mat_trans_f32.c',
     "src/modules/src/pptraj.c",
     "src/modules/src/pptraj_compressed.c",
+    "src/modules/src/pptraj_stream.c",
     "src/modules/src/planner.c",
     "src/modules/src/collision_avoidance.c",
     "src/modules/src/controller/controller_pid.c",
@@ -42,6 +46,7 @@ fw_sources = [
     "src/modules/src/controller/controller_mellinger.c",
     "src/modules/src/controller/controller_brescianini.c",
     "src/modules/src/controller/controller_lee.c",
+    "src/modules/src/controller/controller_benchmark.c",
     "src/utils/src/pid.c",
     "src/utils/src/filter.c",
     "src/utils/src/num.c",
@@ -51,6 +56,23 @@ fw_sources = [
     "src/modules/src/kalman_core/kalman_core.c",
     "src/modules/src/kalman_core/mm_tdoa.c",
     "src/modules/src/outlierfilter/outlierFilterTdoa.c",
+    "bindings/kalman_replay.c",
+    "src/utils/src/crc32.c",
+    "src/utils/src/lighthouse/ootx_decoder.c",
+    "src/utils/src/lighthouse/lighthouse_calibration.c",
+    "src/utils/src/lighthouse/lighthouse_geometry.c",
+    "src/utils/src/lighthouse/pulse_processor.c",
+    "src/utils/src/lighthouse/pulse_processor_v1.c",
+    "src/utils/src/lighthouse/pulse_processor_v2.c",
+    "bindings/lighthouse_replay.c",
+    "src/utils/src/clockCorrectionEngine.c",
+    "bindings/clock_correction_replay.c",
+    "src/utils/src/statsCnt.c",
+    "src/utils/src/tdoa/tdoaEngine.c",
+    "src/utils/src/tdoa/tdoaStorage.c",
+    "src/utils/src/tdoa/tdoaStats.c",
+    "bindings/tdoa_replay.c",
+    "bindings/controller_batch.c",
 ]
 
 cffirmware = Extension(
@@ -0,0 +1,212 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * tdoa_replay.c - Host side replay of recorded TDoA3 packets through the TDoA engine
+ */
+
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "tdoa_replay.h"
+
+#define LOCODECK_TS_FREQ (499.2e6 * 128)
+
+// The engine calls back with measurements without a context, point to the replay that is running
+static tdoaReplay_t* activeReplay;
+
+// Measurement handling for the packet that is processed
+static struct {
+  const tdoaReplayPacket_t* packet;
+  tdoaReplayMeasurement_t* measurements;
+  int maxMeasurementCount;
+  int measurementCount;
+  int packetMeasurementCount;
+  int packetAcceptedCount;
+} current;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool hasTruePosition(const tdoaReplayPacket_t* packet) {
+  return !isnan(packet->truePosition[0]) && !isnan(packet->truePosition[1]) && !isnan(packet->truePosition[2]);
+}
+
+// Same model as in mm_tdoa.c
+static float predictDistanceDiff(const tdoaMeasurement_t* tdoa, const float* position) {
+  const float dx1 = position[0] - tdoa->anchorPositions[1].x;
+  const float dy1 = position[1] - tdoa->anchorPositions[1].y;
+  const float dz1 = position[2] - tdoa->anchorPositions[1].z;
+  const float dx0 = position[0] - tdoa->anchorPositions[0].x;
+  const float dy0 = position[1] - tdoa->anchorPositions[0].y;
+  const float dz0 = position[2] - tdoa->anchorPositions[0].z;
+
+  const float d1 = sqrtf(dx1 * dx1 + dy1 * dy1 + dz1 * dz1);
+  const float d0 = sqrtf(dx0 * dx0 + dy0 * dy0 + dz0 * dz0);
+
+  return d1 - d0;
+}
+
+static void handleMeasurement(tdoaMeasurement_t* tdoa) {
+  tdoaReplay_t* this = activeReplay;
+  const tdoaReplayPacket_t* packet = current.packet;
+  const uint32_t nowMs = packet->usecTimestamp / 1000;
+
+  float error = 0.0f;
+  bool isAccepted = true;
+  const bool hasTruth = hasTruePosition(packet);
+  if (hasTruth) {
+    error = tdoa->distanceDiff - predictDistanceDiff(tdoa, packet->truePosition);
+
+    // With the true position as the estimate, the filter sees the error an ideal estimator would see
+    isAccepted = outlierFilterTdoaValidateIntegrator(&this->outlierFilterState, tdoa, error, nowMs);
+  }
+
+  current.packetMeasurementCount++;
+  this->stats.measurementCount++;
+  if (isAccepted) {
+    current.packetAcceptedCount++;
+    this->stats.acceptedCount++;
+    if (hasTruth) {
+      this->stats.errorCount++;
+      this->stats.errorSquareSum += error * error;
+    }
+  }
+
+  if (current.measurementCount < current.maxMeasurementCount) {
+    tdoaReplayMeasurement_t* measurement = &current.measurements[current.measurementCount];
+    measurement->usecTimestamp = packet->usecTimestamp;
+    measurement->anchorIdA = tdoa->anchorIds[0];
+    measurement->anchorIdB = tdoa->anchorIds[1];
+    measurement->isAccepted = isAccepted;
+    measurement->hasTruePosition = hasTruth;
+    measurement->distanceDiff = tdoa->distanceDiff;
+    measurement->error = error;
+    current.measurementCount++;
+  }
+}
+
+void tdoaReplayInit(tdoaReplay_t* this, const uint8_t matchingAlgorithm, const uint8_t clockCorrectionAlgorithm) {
+  memset(this, 0, sizeof(tdoaReplay_t));
+  tdoaEngineInit(&this->engineState, 0, handleMeasurement, LOCODECK_TS_FREQ, matchingAlgorithm);
+  this->engineState.clockCorrectionAlgorithm = clockCorrectionAlgorithm;
+  outlierFilterTdoaReset(&this->outlierFilterState);
+}
+
+void tdoaReplaySetAnchorPosition(tdoaReplay_t* this, const uint8_t id, const float x, const float y, const float z) {
+  this->anchorPositions[id].x = x;
+  this->anchorPositions[id].y = y;
+  this->anchorPositions[id].z = z;
+  this->hasAnchorPosition[id] = true;
+}
+
+// Same as updateRemoteData() in lpsTdoa3Tag.c
+static void updateRemoteData(tdoaAnchorContext_t* anchorCtx, const tdoaReplayPacket_t* packet) {
+  const int remoteCount = packet->remoteCount < TDOA_REPLAY_MAX_REMOTE_ANCHORS ? packet->remoteCount : TDOA_REPLAY_MAX_REMOTE_ANCHORS;
+  for (int i = 0; i < remoteCount; i++) {
+    const tdoaReplayRemoteData_t* remoteData = &packet->remoteData[i];
+
+    if (remoteData->rxTimeStamp != 0) {
+      tdoaStorageSetRemoteRxTime(anchorCtx, remoteData->id, remoteData->rxTimeStamp, remoteData->seq & 0x7f);
+    }
+
+    const bool hasDistance = ((remoteData->seq & 0x80) != 0);
+    if (hasDistance && remoteData->distance != 0) {
+      tdoaStorageSetRemoteTimeOfFlight(anchorCtx, remoteData->id, remoteData->distance);
+    }
+  }
+}
+
+static tdoaReplayResult_t processPacket(tdoaReplay_t* this, const tdoaReplayPacket_t* packet) {
+  const uint32_t nowMs = packet->usecTimestamp / 1000;
+  current.packet = packet;
+  current.packetMeasurementCount = 0;
+  current.packetAcceptedCount = 0;
+
+  tdoaEngineState_t* engineState = &this->engineState;
+  const uint32_t suitableDataFoundBefore = engineState->stats.suitableDataFound.rateCounter.count;
+
+  tdoaAnchorContext_t anchorCtx;
+  tdoaEngineGetAnchorCtxForPacketProcessing(engineState, packet->anchorId, nowMs, &anchorCtx);
+  updateRemoteData(&anchorCtx, packet);
+  const bool timeIsGood = tdoaEngineProcessPacketFiltered(engineState, &anchorCtx, packet->tx, packet->rx, false, 0);
+  tdoaStorageSetRxTxData(&anchorCtx, packet->rx, packet->tx, packet->seq & 0x7f);
+
+  // The position is received in an LPP packet after the range data
+  if (this->hasAnchorPosition[packet->anchorId]) {
+    const point_t* position = &this->anchorPositions[packet->anchorId];
+    tdoaStorageSetAnchorPosition(&anchorCtx, position->x, position->y, position->z);
+  }
+
+  if (!timeIsGood) {
+    return tdoaReplayResultClockCorrection;
+  }
+
+  if (current.packetMeasurementCount == 0) {
+    const bool foundMatch = engineState->stats.suitableDataFound.rateCounter.count != suitableDataFoundBefore;
+    return foundMatch ? tdoaReplayResultNoPosition : tdoaReplayResultNoMatch;
+  }
+
+  if (current.packetAcceptedCount == 0) {
+    return tdoaReplayResultOutlier;
+  }
+
+  return tdoaReplayResultUsed;
+}
+
+int tdoaReplayRun(tdoaReplay_t* this, const tdoaReplayPacket_t* packets, const int packetCount, tdoaReplayPacketResult_t* packetResults, tdoaReplayMeasurement_t* measurements, const int maxMeasurementCount) {
+  activeReplay = this;
+  current.measurements = measurements;
+  current.maxMeasurementCount = maxMeasurementCount;
+  current.measurementCount = 0;
+
+  // The loop is timed as a whole, timing each packet would mostly measure the clock
+  const double start = now();
+
+  for (int i = 0; i < packetCount; i++) {
+    const tdoaReplayResult_t result = processPacket(this, &packets[i]);
+
+    packetResults[i].result = result;
+    packetResults[i].measurementCount = current.packetMeasurementCount;
+    packetResults[i].acceptedCount = current.packetAcceptedCount;
+    this->stats.resultCount[result]++;
+  }
+
+  const double processTime = now() - start;
+  activeReplay = 0;
+
+  this->stats.packetCount += packetCount;
+  this->stats.processTime += processTime;
+  if (this->stats.packetCount > 0) {
+    this->stats.nsPerPacket = this->stats.processTime * 1e9 / this->stats.packetCount;
+  }
+  if (this->stats.errorCount > 0) {
+    this->stats.rmsError = sqrt(this->stats.errorSquareSum / this->stats.errorCount);
+  }
+
+  return current.measurementCount;
+}
@@ -0,0 +1,153 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * tdoa_replay.h - Host side replay of recorded TDoA3 packets through the TDoA engine
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tdoaEngine.h"
+#include "outlierFilterTdoa.h"
+
+/**
+ * This module runs recorded TDoA3 packets through the TDoA engine (tdoaEngine.c, tdoaStorage.c and the clock
+ * correction) in the same way as lpsTdoa3Tag.c, and the resulting measurements through the TDoA measurement model and
+ * outlier filter of the kalman estimator. It is intended for benchmarking of the TDoA pipeline on the host, it is not
+ * part of the firmware.
+ */
+
+#define TDOA_REPLAY_MAX_REMOTE_ANCHORS 8
+#define TDOA_REPLAY_ANCHOR_ID_COUNT 256
+
+// Data about a remote anchor in a packet, as in remoteAnchorDataFull_t in lpsTdoa3Tag.c
+typedef struct {
+  uint8_t id;
+  uint8_t seq; // Bit 7 is set if distance is valid
+  uint16_t distance; // Time of flight between the anchors [anchor ticks]
+  uint32_t rxTimeStamp; // Reception time of the latest packet from the remote anchor, in the anchor clock
+} tdoaReplayRemoteData_t;
+
+// One received TDoA3 packet, packets must be sorted in time
+typedef struct {
+  uint64_t usecTimestamp; // Time of reception [us]
+  uint64_t rx; // Reception time in the tag clock
+  uint32_t tx; // Transmission time in the anchor clock
+  uint8_t anchorId;
+  uint8_t seq;
+  uint8_t remoteCount;
+  uint8_t reserved;
+  float truePosition[3]; // Position of the tag at reception, NaN if unknown
+  uint32_t reserved2;
+  tdoaReplayRemoteData_t remoteData[TDOA_REPLAY_MAX_REMOTE_ANCHORS];
+} tdoaReplayPacket_t;
+
+// What happened to a packet, the first reason that applies
+typedef enum {
+  tdoaReplayResultUsed = 0, // At least one measurement was accepted
+  tdoaReplayResultClockCorrection = 1, // The clock correction of the anchor is not reliable yet
+  tdoaReplayResultNoMatch = 2, // No remote anchor with matching data
+  tdoaReplayResultNoPosition = 3, // A match was found, but the anchor positions are not known
+  tdoaReplayResultOutlier = 4, // All measurements were rejected by the outlier filter
+  tdoaReplayResultCount,
+} tdoaReplayResult_t;
+
+// Result for each packet
+typedef struct {
+  uint8_t result; // tdoaReplayResult_t
+  uint8_t measurementCount; // Measurements produced by the TDoA engine
+  uint8_t acceptedCount; // Measurements accepted by the outlier filter
+  uint8_t reserved;
+} tdoaReplayPacketResult_t;
+
+// One measurement produced by the TDoA engine
+typedef struct {
+  uint64_t usecTimestamp;
+  uint8_t anchorIdA;
+  uint8_t anchorIdB;
+  uint8_t isAccepted;
+  uint8_t hasTruePosition;
+  float distanceDiff; // [m]
+  float error; // Measured minus predicted distance difference at the true position [m], 0 if unknown
+  uint32_t reserved;
+} tdoaReplayMeasurement_t;
+
+typedef struct {
+  uint32_t packetCount;
+  uint32_t measurementCount;
+  uint32_t acceptedCount;
+  uint32_t resultCount[tdoaReplayResultCount]; // Number of packets per tdoaReplayResult_t
+
+  uint32_t errorCount; // Number of measurements with a true position
+  uint32_t reserved;
+  double rmsError; // RMS of the error of accepted measurements [m]
+  double errorSquareSum;
+
+  double processTime; // Wall clock time spent in the run, including the measurement model [s]
+  double nsPerPacket;
+} tdoaReplayStats_t;
+
+typedef struct {
+  tdoaEngineState_t engineState;
+  OutlierFilterTdoaState_t outlierFilterState;
+
+  point_t anchorPositions[TDOA_REPLAY_ANCHOR_ID_COUNT];
+  bool hasAnchorPosition[TDOA_REPLAY_ANCHOR_ID_COUNT];
+
+  tdoaReplayStats_t stats;
+} tdoaReplay_t;
+
+/**
+ * @brief Initialize a replay
+ *
+ * @param this  The replay
+ * @param matchingAlgorithm  A tdoaEngineMatchingAlgorithm_t
+ * @param clockCorrectionAlgorithm  A clockCorrectionAlgorithm_t
+ */
+void tdoaReplayInit(tdoaReplay_t* this, const uint8_t matchingAlgorithm, const uint8_t clockCorrectionAlgorithm);
+
+/**
+ * @brief Set the position of an anchor. The position is handed to the TDoA engine when a packet from the anchor is
+ * processed, as when it is received in an LPP packet.
+ *
+ * @param this  The replay
+ * @param id  The anchor id
+ */
+void tdoaReplaySetAnchorPosition(tdoaReplay_t* this, const uint8_t id, const float x, const float y, const float z);
+
+/**
+ * @brief Run packets through the TDoA engine. The result for each packet is written to packetResults, which must have
+ * room for packetCount entries, and the measurements to measurements until maxMeasurementCount is reached. Timing
+ * and totals are available in this->stats when the function returns.
+ *
+ * @param this  The replay
+ * @param packets  The packets, sorted in time
+ * @param packetCount  Number of packets
+ * @param packetResults  Buffer for the packet results
+ * @param measurements  Buffer for the measurements, may be NULL if maxMeasurementCount is 0
+ * @param maxMeasurementCount  Size of the measurement buffer
+ * @return int  Number of measurements written
+ */
+int tdoaReplayRun(tdoaReplay_t* this, const tdoaReplayPacket_t* packets, const int packetCount, tdoaReplayPacketResult_t* packetResults, tdoaReplayMeasurement_t* measurements, const int maxMeasurementCount);
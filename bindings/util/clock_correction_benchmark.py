@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+"""
+Benchmark of the clock correction algorithms used by the TDoA engine.
+
+Runs streams of packet time stamps through the leaky bucket and the least squares clock correction algorithms, and
+reports the time from when an anchor is first heard until the clock correction is usable (converged), the share of
+reliable samples and the CPU time per update on the host.
+
+The time stamps are read from a file recorded with the uSD-card deck (the tdoa3Pkt event must be enabled in the
+config file of the deck), or generated.
+
+Usage:
+    python3 -m bindings.util.clock_correction_benchmark [log file]
+"""
+
+import argparse
+import numpy as np
+import cffirmware
+import tools.usdlog.cfusdlog as cfusdlog
+
+ALGORITHMS = {
+    'bucket': cffirmware.clockCorrectionAlgorithmBucket,
+    'least squares': cffirmware.clockCorrectionAlgorithmLeastSquares,
+}
+
+# Tick rate of the DW1000 time stamps [Hz]
+TS_FREQ = 499.2e6 * 128
+
+# The TDoA engine uses 32 bits of the time stamps, see TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP
+MASK = 0xFFFFFFFF
+
+
+class ClockCorrectionReplay:
+    """Runs time stamps from one anchor through a clock correction algorithm, natively in clock_correction_replay.c"""
+
+    # Must match clockCorrectionReplaySample_t in clock_correction_replay.h
+    SAMPLE_DTYPE = np.dtype([
+        ('usecTimestamp', '<u8'),
+        ('rx', '<u8'),
+        ('tx', '<u8'),
+    ])
+
+    # Must match clockCorrectionReplayOutput_t in clock_correction_replay.h
+    OUTPUT_DTYPE = np.dtype([
+        ('clockCorrection', '<f8'),
+        ('isReliable', 'u1'),
+        ('reserved', 'u1', (7,)),
+    ])
+
+    def __init__(self, algorithm, mask=MASK) -> None:
+        self.replay = cffirmware.clockCorrectionReplay_t()
+        cffirmware.clockCorrectionReplayInit(self.replay, algorithm, mask)
+
+    def run(self, samples: np.ndarray):
+        """
+        Args:
+            samples (np.ndarray): Samples with the SAMPLE_DTYPE, sorted in time
+
+        Returns:
+            tuple[np.ndarray, cffirmware.clockCorrectionReplayStats_t]: The result after each sample (OUTPUT_DTYPE)
+                                                                         and the statistics
+        """
+        samples = np.ascontiguousarray(samples, dtype=self.SAMPLE_DTYPE)
+        output = np.zeros(len(samples), dtype=self.OUTPUT_DTYPE)
+        if len(samples) > 0:
+            count = cffirmware.clockCorrectionReplayRunBuffer(self.replay, samples, output)
+            output = output[:count]
+
+        return output, self.replay.stats
+
+    @classmethod
+    def from_log_data(cls, log_data: dict):
+        """Extract time stamps per anchor from decoded log data
+
+        Args:
+            log_data: Log data as returned by cfusdlog.decode()
+
+        Returns:
+            dict[int, np.ndarray]: Samples (SAMPLE_DTYPE) per anchor id
+        """
+        result = {}
+        if 'tdoa3Pkt' in log_data:
+            data = log_data['tdoa3Pkt']
+            ids = np.asarray(data['id'])
+            for id in np.unique(ids):
+                selection = ids == id
+                samples = np.zeros(np.count_nonzero(selection), dtype=cls.SAMPLE_DTYPE)
+                # Timestamps in the decoded log are in ms
+                samples['usecTimestamp'] = np.round(np.asarray(data['timestamp'])[selection] * 1000.0)
+                samples['rx'] = np.asarray(data['rx'])[selection]
+                samples['tx'] = np.asarray(data['tx'])[selection]
+                result[int(id)] = samples
+
+        return result
+
+
+def synthetic_stream(clock_correction, duration=2.0, packet_rate=50.0, noise_ticks=10.0, loss=0.0, seed=0):
+    """Generate time stamps for packets from one anchor
+
+    Args:
+        clock_correction: The true clock correction (tag ticks per anchor tick)
+        duration: Length of the stream [s]
+        packet_rate: Mean packet rate [1/s], the packets are sent at random intervals as in TDoA3
+        noise_ticks: Std dev of the noise on the reception time stamps [ticks]
+        loss: Share of lost packets
+        seed: Seed for the random generator
+
+    Returns:
+        np.ndarray: Samples with the ClockCorrectionReplay.SAMPLE_DTYPE
+    """
+    rng = np.random.default_rng(seed)
+    count = int(duration * packet_rate)
+    intervals = rng.uniform(0.5, 1.5, count) / packet_rate
+    tx_time = np.cumsum(intervals)
+    tx_time = tx_time[rng.uniform(size=count) >= loss]
+
+    samples = np.zeros(len(tx_time), dtype=ClockCorrectionReplay.SAMPLE_DTYPE)
+    offset = rng.integers(0, MASK)
+    tx_ticks = np.round(tx_time * TS_FREQ)
+    rx_ticks = np.round(tx_ticks * clock_correction + rng.normal(0.0, noise_ticks, len(tx_time)))
+    samples['usecTimestamp'] = np.round(tx_time * 1e6)
+    samples['tx'] = (tx_ticks.astype(np.uint64) + offset) & MASK
+    samples['rx'] = (rx_ticks.astype(np.uint64) + 2 * offset) & MASK
+    return samples
+
+
+def convergence_time(samples, output, reference, tolerance=0.1e-6):
+    """Time from the first sample until the clock correction is reliable and stays within tolerance of the reference
+
+    Args:
+        samples: The samples (SAMPLE_DTYPE)
+        output: The result of ClockCorrectionReplay.run()
+        reference: The true clock correction
+        tolerance: Max deviation from the reference
+
+    Returns:
+        float: The convergence time [s], or None if the correction never converged
+    """
+    good = (output['isReliable'] != 0) & (np.abs(output['clockCorrection'] - reference) < tolerance)
+    bad = (output['isReliable'] != 0) & ~good
+
+    # The first good sample after the last bad one
+    last_bad = np.nonzero(bad)[0]
+    first_candidate = last_bad[-1] + 1 if len(last_bad) > 0 else 0
+    good_after = np.nonzero(good[first_candidate:])[0]
+    if len(good_after) == 0:
+        return None
+
+    index = first_candidate + good_after[0]
+    return (int(samples['usecTimestamp'][index]) - int(samples['usecTimestamp'][0])) * 1e-6
+
+
+def reference_from_samples(samples):
+    """Estimate the clock correction of a recorded stream, with a least squares fit over the full stream"""
+    tx = np.cumsum(np.concatenate(([0], np.diff(samples['tx'].astype(np.int64)) & MASK)))
+    rx = np.cumsum(np.concatenate(([0], np.diff(samples['rx'].astype(np.int64)) & MASK)))
+    return np.polyfit(tx.astype(np.float64), rx.astype(np.float64), 1)[0]
+
+
+def benchmark(streams, references=None):
+    """Run all streams through all algorithms
+
+    Args:
+        streams (dict[int, np.ndarray]): Samples per anchor id
+        references (dict[int, float]): The true clock correction per anchor, estimated from the samples if missing
+
+    Returns:
+        list[dict]: One row per anchor and algorithm
+    """
+    rows = []
+    for id, samples in streams.items():
+        if len(samples) < 3:
+            continue
+
+        reference = (references or {}).get(id)
+        if reference is None:
+            reference = reference_from_samples(samples)
+
+        for name, algorithm in ALGORITHMS.items():
+            output, stats = ClockCorrectionReplay(algorithm).run(samples)
+            rows.append({
+                'anchor': id,
+                'algorithm': name,
+                'samples': len(samples),
+                'convergence': convergence_time(samples, output, reference),
+                'reliable': stats.reliableCount / len(samples),
+                'nsPerUpdate': stats.nsPerUpdate,
+            })
+
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', nargs='?', help='Log file recorded with the uSD-card deck, synthetic data if missing')
+    parser.add_argument('--noise', type=float, default=10.0, help='Noise on synthetic time stamps [ticks]')
+    args = parser.parse_args()
+
+    if args.file:
+        streams = ClockCorrectionReplay.from_log_data(cfusdlog.decode(args.file))
+        references = None
+    else:
+        clock_corrections = {0: 1.0 + 3e-6, 1: 1.0 - 7e-6, 2: 1.0 + 12e-6, 3: 1.0}
+        streams = {id: synthetic_stream(cc, noise_ticks=args.noise, loss=0.1, seed=id)
+                   for id, cc in clock_corrections.items()}
+        references = clock_corrections
+
+    print(f'{"anchor":>6} {"algorithm":>14} {"samples":>8} {"convergence [ms]":>17} {"reliable [%]":>13} '
+          f'{"ns/update":>10}')
+    for row in benchmark(streams, references):
+        convergence = f'{row["convergence"] * 1000:.0f}' if row['convergence'] is not None else '-'
+        print(f'{row["anchor"]:>6} {row["algorithm"]:>14} {row["samples"]:>8} {convergence:>17} '
+              f'{row["reliable"] * 100:>13.1f} {row["nsPerUpdate"]:>10.1f}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,121 @@
+import numpy as np
+import cffirmware
+
+
+class ControllerBatch:
+    """
+    This class runs a controller over arrays of setpoints and states with the loop running natively in
+    controller_batch.c, one stabilizer tick per input. It replaces python loops that call for instance
+    controllerMellinger() once per tick, which makes parameter sweeps and regression tests over long runs fast.
+    """
+
+    # Must match controllerBatchInput_t in controller_batch.h
+    INPUT_DTYPE = np.dtype([
+        ('mode', 'u1', (4,)),
+        ('position', '<f4', (3,)),
+        ('velocity', '<f4', (3,)),
+        ('acceleration', '<f4', (3,)),
+        ('yaw', '<f4'),
+        ('yawRate', '<f4'),
+        ('statePosition', '<f4', (3,)),
+        ('stateVelocity', '<f4', (3,)),
+        ('stateAcc', '<f4', (3,)),
+        ('stateAttitude', '<f4', (3,)),
+        ('stateQuaternion', '<f4', (4,)),
+        ('gyro', '<f4', (3,)),
+    ])
+
+    # Must match controllerBatchControl_t in controller_batch.h
+    CONTROL_DTYPE = np.dtype([
+        ('controlMode', '<u4'),
+        ('value', '<f4', (4,)),
+    ])
+
+    # Must match controllerBatchMotors_t in controller_batch.h
+    MOTORS_DTYPE = np.dtype([
+        ('motorThrustUncapped', '<i4', (4,)),
+        ('motorPwm', '<u2', (4,)),
+        ('isCapped', 'u1'),
+        ('reserved', 'u1', (3,)),
+    ])
+
+    # Must match controllerBatchGoal_t in controller_batch.h
+    GOAL_DTYPE = np.dtype([
+        ('position', '<f4', (3,)),
+        ('velocity', '<f4', (3,)),
+        ('acceleration', '<f4', (3,)),
+        ('omega', '<f4', (3,)),
+        ('yaw', '<f4'),
+    ])
+
+    def __init__(self, controller_type) -> None:
+        """
+        Args:
+            controller_type: One of cffirmware.controllerBatchPid, controllerBatchMellinger,
+                             controllerBatchBrescianini or controllerBatchLee
+        """
+        self.batch = cffirmware.controllerBatch_t()
+        cffirmware.controllerBatchInit(self.batch, controller_type)
+
+    @classmethod
+    def make_inputs(cls, count: int) -> np.ndarray:
+        """Returns count inputs with all setpoint modes disabled, zero states and the identity attitude"""
+        inputs = np.zeros(count, dtype=cls.INPUT_DTYPE)
+        inputs['stateQuaternion'][:, 3] = 1.0
+        return inputs
+
+    def run(self, inputs: np.ndarray, power_distribution=False):
+        """
+        Run the controller once per input. The controller state is kept between calls.
+
+        Args:
+            inputs (np.ndarray): Setpoints and states with the INPUT_DTYPE, one per tick
+            power_distribution (bool): Also run the power distribution on the output of each tick
+
+        Returns:
+            np.ndarray: The controller output (CONTROL_DTYPE) if power_distribution is False, otherwise a tuple with the
+                        controller output and the motor output (MOTORS_DTYPE)
+        """
+        inputs = np.ascontiguousarray(inputs, dtype=self.INPUT_DTYPE)
+        control = np.zeros(len(inputs), dtype=self.CONTROL_DTYPE)
+
+        if not power_distribution:
+            cffirmware.controllerBatchRunBuffer(self.batch, inputs, control)
+            return control
+
+        motors = np.zeros(len(inputs), dtype=self.MOTORS_DTYPE)
+        cffirmware.controllerBatchRunWithMotorsBuffer(self.batch, inputs, control, motors)
+        return control, motors
+
+    @classmethod
+    def power_distribution(cls, control: np.ndarray) -> np.ndarray:
+        """
+        Run the power distribution, including capping, on each control input
+
+        Args:
+            control (np.ndarray): Control inputs with the CONTROL_DTYPE
+
+        Returns:
+            np.ndarray: The motor output (MOTORS_DTYPE)
+        """
+        control = np.ascontiguousarray(control, dtype=cls.CONTROL_DTYPE)
+        motors = np.zeros(len(control), dtype=cls.MOTORS_DTYPE)
+        cffirmware.controllerBatchPowerDistributionBuffer(control, motors)
+        return motors
+
+    @classmethod
+    def planner_goals(cls, planner, t: np.ndarray) -> np.ndarray:
+        """
+        Evaluate the current goal of a planner at each time
+
+        Args:
+            planner (cffirmware.planner): The planner
+            t (np.ndarray): Times [s], must not decrease
+
+        Returns:
+            np.ndarray: The goals (GOAL_DTYPE), NaN when the planner is not flying
+        """
+        t = np.ascontiguousarray(t, dtype='<f4')
+        goals = np.zeros(len(t), dtype=cls.GOAL_DTYPE)
+        cffirmware.controllerBatchPlannerBuffer(planner, t, goals)
+        return goals
@@ -64,7 +64,7 @@ class EstimatorKalmanEmulator:
 
         self._update_queued_measurements(self.now_ms, sensor_samples)
 
-        cffirmware.kalmanCoreFinalize(self.coreData)
+        cffirmware.kalmanCoreFinalize(self.coreData, self.coreParams)
 
         # Main loop called at 1000 Hz in the firmware
         self.now_ms += 1
@@ -0,0 +1,101 @@
+import numpy as np
+import cffirmware
+import tools.usdlog.cfusdlog as cfusdlog
+
+
+class KalmanReplay:
+    """
+    This class replays sensor data recorded with the uSD-card deck through the kalman core, in the same way as
+    EstimatorKalmanEmulator, but with the full estimator loop running natively in kalman_replay.c. The samples are
+    passed to the C code as one contiguous buffer, which makes it possible to run long logs in a short time, for
+    instance to benchmark changes to the estimator.
+    """
+
+    # Must match kalmanReplaySample_t in kalman_replay.h
+    SAMPLE_DTYPE = np.dtype([
+        ('timestamp', '<u4'),
+        ('type', 'u1'),
+        ('anchorIdA', 'u1'),
+        ('anchorIdB', 'u1'),
+        ('reserved', 'u1'),
+        ('value', '<f4', (3,)),
+    ])
+
+    # Must match kalmanReplayOutput_t in kalman_replay.h
+    OUTPUT_DTYPE = np.dtype([
+        ('timestamp', '<u4'),
+        ('position', '<f4', (3,)),
+        ('velocity', '<f4', (3,)),
+        ('quaternion', '<f4', (4,)),
+    ])
+
+    def __init__(self, anchor_positions) -> None:
+        self.replay = cffirmware.kalmanReplay_t()
+        cffirmware.kalmanReplayInit(self.replay)
+        for id, point in anchor_positions.items():
+            cffirmware.kalmanReplaySetAnchorPosition(self.replay, id, point.x, point.y, point.z)
+
+    def run(self, samples: np.ndarray):
+        """
+        Run samples through the estimator
+
+        Args:
+            samples (np.ndarray): Samples with the SAMPLE_DTYPE, sorted on timestamp
+
+        Returns:
+            tuple[np.ndarray, cffirmware.kalmanReplayStats_t]: The estimated state after each iteration of the
+                                                              1 kHz loop (OUTPUT_DTYPE) and the timing statistics
+        """
+        samples = np.ascontiguousarray(samples, dtype=self.SAMPLE_DTYPE)
+        if len(samples) == 0:
+            return np.zeros(0, dtype=self.OUTPUT_DTYPE), self.replay.stats
+
+        max_output_count = int(samples['timestamp'][-1]) - int(samples['timestamp'][0]) + 2
+        output = np.zeros(max_output_count, dtype=self.OUTPUT_DTYPE)
+        count = cffirmware.kalmanReplayRunBuffer(self.replay, samples, output)
+
+        return output[:count], self.replay.stats
+
+    @classmethod
+    def read_samples(cls, file_name: str) -> np.ndarray:
+        """Read sensor data from a file recorded using the uSD-card on a Crazyflie
+
+        Args:
+            file_name: The name of the file with recorded data
+
+        Returns:
+            np.ndarray: Samples with the SAMPLE_DTYPE, sorted on timestamp. Samples with the same time stamp are
+                        kept in the order of the log types in the file, as in SdCardFileRunner
+        """
+        log_data = cfusdlog.decode(file_name)
+
+        parts = []
+        for log_type, data in log_data.items():
+            part = None
+            if log_type == 'estAcceleration':
+                part = cls._make_samples(data, cffirmware.kalmanReplaySampleAcceleration)
+                part['value'] = np.column_stack((data['acc.x'], data['acc.y'], data['acc.z']))
+            elif log_type == 'estGyroscope':
+                part = cls._make_samples(data, cffirmware.kalmanReplaySampleGyroscope)
+                part['value'] = np.column_stack((data['gyro.x'], data['gyro.y'], data['gyro.z']))
+            elif log_type == 'estTDOA':
+                part = cls._make_samples(data, cffirmware.kalmanReplaySampleTdoa)
+                part['anchorIdA'] = data['idA']
+                part['anchorIdB'] = data['idB']
+                part['value'][:, 0] = data['distanceDiff']
+
+            if part is not None:
+                parts.append(part)
+
+        if len(parts) == 0:
+            return np.zeros(0, dtype=cls.SAMPLE_DTYPE)
+
+        samples = np.concatenate(parts)
+        return samples[np.argsort(samples['timestamp'], kind='stable')]
+
+    @classmethod
+    def _make_samples(cls, data, sample_type) -> np.ndarray:
+        samples = np.zeros(len(data['timestamp']), dtype=cls.SAMPLE_DTYPE)
+        samples['timestamp'] = data['timestamp']
+        samples['type'] = sample_type
+        return samples
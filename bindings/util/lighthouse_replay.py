@@ -0,0 +1,171 @@
+import numpy as np
+import cffirmware
+import tools.usdlog.cfusdlog as cfusdlog
+
+
+class LighthouseReplay:
+    """
+    This class replays raw lighthouse frames recorded with the uSD-card deck (see lighthouse_recorder.h) through the
+    V2 pulse processor, the calibration and the crossing beams position solver, running natively in
+    lighthouse_replay.c. The frames are passed to the C code as one contiguous buffer, which makes it possible to run
+    long logs much faster than real time, for instance to benchmark changes to the lighthouse pipeline.
+    """
+
+    # Must match lighthouseReplayFrame_t in lighthouse_replay.h
+    FRAME_DTYPE = np.dtype([
+        ('usecTimestamp', '<u8'),
+        ('timestamp', '<u4'),
+        ('beamData', '<u4'),
+        ('offset', '<u4'),
+        ('width', '<u2'),
+        ('info', 'u1'),
+        ('reserved', 'u1'),
+    ])
+
+    # Must match lighthouseReplayOutput_t in lighthouse_replay.h
+    OUTPUT_DTYPE = np.dtype([
+        ('usecTimestamp', '<u8'),
+        ('position', '<f4', (3,)),
+        ('residual', '<f4'),
+        ('baseStationMap', '<u2'),
+        ('reserved0', '<u2'),
+        ('reserved1', '<u4'),
+    ])
+
+    # Must match lighthouseCalibration_t in lighthouse_types.h (packed)
+    CALIBRATION_DTYPE = np.dtype([
+        ('sweep', '<f4', (2, 7)),
+        ('uid', '<u4'),
+        ('valid', 'u1'),
+    ])
+
+    # Must match baseStationGeometry_t in lighthouse_geometry.h (packed, but with 4 byte aligned members)
+    GEOMETRY_DTYPE = np.dtype({
+        'names': ['origin', 'mat', 'valid'],
+        'formats': [('<f4', (3,)), ('<f4', (3, 3)), 'u1'],
+        'offsets': [0, 12, 48],
+        'itemsize': 52,
+    })
+
+    def __init__(self, calibrations=None, geometries=None) -> None:
+        """
+        Args:
+            calibrations (dict[int, np.ndarray]): Calibration data (CALIBRATION_DTYPE) per base station
+            geometries (dict[int, np.ndarray]): Geometry data (GEOMETRY_DTYPE) per base station
+        """
+        self.replay = cffirmware.lighthouseReplay_t()
+        cffirmware.lighthouseReplayInit(self.replay)
+
+        for bs, calibration in (calibrations or {}).items():
+            data = np.asarray(calibration, dtype=self.CALIBRATION_DTYPE).tobytes()
+            cffirmware.lighthouseReplaySetCalibrationBuffer(self.replay, bs, data)
+
+        for bs, geometry in (geometries or {}).items():
+            data = np.asarray(geometry, dtype=self.GEOMETRY_DTYPE).tobytes()
+            cffirmware.lighthouseReplaySetGeometryBuffer(self.replay, bs, data)
+
+    def run(self, frames: np.ndarray):
+        """
+        Run frames through the lighthouse pipeline
+
+        Args:
+            frames (np.ndarray): Frames with the FRAME_DTYPE, sorted on usecTimestamp
+
+        Returns:
+            tuple[np.ndarray, cffirmware.lighthouseReplayStats_t]: The crossing beams positions (OUTPUT_DTYPE) and
+                                                                   the timing statistics
+        """
+        frames = np.ascontiguousarray(frames, dtype=self.FRAME_DTYPE)
+        if len(frames) == 0:
+            return np.zeros(0, dtype=self.OUTPUT_DTYPE), self.replay.stats
+
+        # A position needs at least one frame per sensor
+        max_output_count = len(frames) // 4 + 1
+        output = np.zeros(max_output_count, dtype=self.OUTPUT_DTYPE)
+        count = cffirmware.lighthouseReplayRunBuffer(self.replay, frames, output)
+
+        return output[:count], self.replay.stats
+
+    @classmethod
+    def read_log(cls, file_name: str):
+        """Read lighthouse frames, calibration and geometry data from a file recorded using the uSD-card on a Crazyflie
+
+        Args:
+            file_name: The name of the file with recorded data
+
+        Returns:
+            tuple[np.ndarray, dict, dict]: The frames (FRAME_DTYPE), calibration data and geometry data per base
+                                           station, see from_log_data()
+        """
+        return cls.from_log_data(cfusdlog.decode(file_name))
+
+    @classmethod
+    def from_log_data(cls, log_data: dict):
+        """Extract lighthouse frames, calibration and geometry data from decoded log data. The first complete snapshot
+        of calibration and geometry data is used for each base station.
+
+        Args:
+            log_data: Log data as returned by cfusdlog.decode()
+
+        Returns:
+            tuple[np.ndarray, dict, dict]: The frames (FRAME_DTYPE), calibration data (CALIBRATION_DTYPE) and geometry
+                                           data (GEOMETRY_DTYPE) per base station
+        """
+        frames = np.zeros(0, dtype=cls.FRAME_DTYPE)
+        if 'lhFrame' in log_data:
+            data = log_data['lhFrame']
+            frames = np.zeros(len(data['timestamp']), dtype=cls.FRAME_DTYPE)
+            # Timestamps in the decoded log are in ms
+            frames['usecTimestamp'] = np.round(np.asarray(data['timestamp']) * 1000.0)
+            frames['timestamp'] = data['deckTs']
+            for field in ('beamData', 'offset', 'width', 'info'):
+                frames[field] = data[field]
+            frames = frames[np.argsort(frames['usecTimestamp'], kind='stable')]
+
+        return frames, cls._read_calibrations(log_data), cls._read_geometries(log_data)
+
+    @classmethod
+    def _first_per_id(cls, log_data, event_name, fields):
+        result = {}
+        if event_name in log_data:
+            data = log_data[event_name]
+            for i, id in enumerate(data['id']):
+                if int(id) not in result:
+                    result[int(id)] = [data[field][i] for field in fields]
+        return result
+
+    @classmethod
+    def _read_calibrations(cls, log_data):
+        part_a = cls._first_per_id(log_data, 'lhCalibA', ('phase', 'tilt', 'curve', 'gibmag'))
+        part_b = cls._first_per_id(log_data, 'lhCalibB', ('gibphase', 'ogeemag', 'ogeephase', 'uid'))
+
+        # id is (base station << 1) | sweep
+        result = {}
+        for bs in {id >> 1 for id in part_a.keys()}:
+            ids = ((bs << 1), (bs << 1) | 1)
+            if all(id in part_a and id in part_b for id in ids):
+                calibration = np.zeros((), dtype=cls.CALIBRATION_DTYPE)
+                for sweep, id in enumerate(ids):
+                    calibration['sweep'][sweep] = part_a[id] + part_b[id][0:3]
+                calibration['uid'] = part_b[ids[0]][3]
+                calibration['valid'] = 1
+                result[bs] = calibration
+
+        return result
+
+    @classmethod
+    def _read_geometries(cls, log_data):
+        rows = cls._first_per_id(log_data, 'lhGeo', ('x', 'y', 'z'))
+
+        # id is (base station << 2) | row, row 0 is the origin and rows 1 - 3 the rotation matrix
+        result = {}
+        for bs in {id >> 2 for id in rows.keys()}:
+            ids = [(bs << 2) | row for row in range(4)]
+            if all(id in rows for id in ids):
+                geometry = np.zeros((), dtype=cls.GEOMETRY_DTYPE)
+                geometry['origin'] = rows[ids[0]]
+                geometry['mat'] = [rows[id] for id in ids[1:]]
+                geometry['valid'] = 1
+                result[bs] = geometry
+
+        return result
@@ -0,0 +1,338 @@
+#!/usr/bin/env python
+"""
+Replay of TDoA3 packets through the TDoA engine.
+
+Runs packets recorded with the uSD-card deck (the tdoa3Pkt and tdoa3Remote events must be enabled in the config file
+of the deck), or generated packets, through the TDoA engine natively in tdoa_replay.c. Reports the measurement yield,
+why packets did not produce measurements, the CPU time per packet on the host and the error of the measurements and
+of the estimated position, when the true position is known.
+
+Usage:
+    python3 -m bindings.util.tdoa_replay [log file] --anchors anchor_positions.yaml
+"""
+
+import argparse
+import numpy as np
+import cffirmware
+import tools.usdlog.cfusdlog as cfusdlog
+from bindings.util.kalman_replay import KalmanReplay
+from bindings.util.loco_utils import read_loco_anchor_positions
+
+# Must match tdoaEngineMatchingAlgorithm_t in tdoaEngine.h
+MATCHING_ALGORITHMS = {
+    'random': 1,
+    'youngest': 2,
+    'all': 3,
+}
+
+# Must match clockCorrectionAlgorithm_t in clockCorrectionEngine.h
+CLOCK_CORRECTION_ALGORITHMS = {
+    'bucket': cffirmware.clockCorrectionAlgorithmBucket,
+    'least squares': cffirmware.clockCorrectionAlgorithmLeastSquares,
+}
+
+RESULT_NAMES = {
+    cffirmware.tdoaReplayResultUsed: 'used',
+    cffirmware.tdoaReplayResultClockCorrection: 'clock correction',
+    cffirmware.tdoaReplayResultNoMatch: 'no match',
+    cffirmware.tdoaReplayResultNoPosition: 'no position',
+    cffirmware.tdoaReplayResultOutlier: 'outlier',
+}
+
+# Tick rate of the DW1000 time stamps [Hz]
+TS_FREQ = 499.2e6 * 128
+SPEED_OF_LIGHT = 299792458.0
+
+
+class TdoaReplay:
+    """Runs TDoA3 packets through the TDoA engine, natively in tdoa_replay.c"""
+
+    # Must match tdoaReplayRemoteData_t in tdoa_replay.h
+    REMOTE_DTYPE = np.dtype([
+        ('id', 'u1'),
+        ('seq', 'u1'),
+        ('distance', '<u2'),
+        ('rxTimeStamp', '<u4'),
+    ])
+
+    # Must match tdoaReplayPacket_t in tdoa_replay.h
+    PACKET_DTYPE = np.dtype([
+        ('usecTimestamp', '<u8'),
+        ('rx', '<u8'),
+        ('tx', '<u4'),
+        ('anchorId', 'u1'),
+        ('seq', 'u1'),
+        ('remoteCount', 'u1'),
+        ('reserved', 'u1'),
+        ('truePosition', '<f4', (3,)),
+        ('reserved2', '<u4'),
+        ('remoteData', REMOTE_DTYPE, (8,)),
+    ])
+
+    # Must match tdoaReplayPacketResult_t in tdoa_replay.h
+    RESULT_DTYPE = np.dtype([
+        ('result', 'u1'),
+        ('measurementCount', 'u1'),
+        ('acceptedCount', 'u1'),
+        ('reserved', 'u1'),
+    ])
+
+    # Must match tdoaReplayMeasurement_t in tdoa_replay.h
+    MEASUREMENT_DTYPE = np.dtype([
+        ('usecTimestamp', '<u8'),
+        ('anchorIdA', 'u1'),
+        ('anchorIdB', 'u1'),
+        ('isAccepted', 'u1'),
+        ('hasTruePosition', 'u1'),
+        ('distanceDiff', '<f4'),
+        ('error', '<f4'),
+        ('reserved', '<u4'),
+    ])
+
+    def __init__(self, anchor_positions, matching='random', clock_correction='bucket') -> None:
+        """
+        Args:
+            anchor_positions (dict[int, cffirmware.vec3_s]): The anchor positions, see read_loco_anchor_positions()
+            matching: One of MATCHING_ALGORITHMS
+            clock_correction: One of CLOCK_CORRECTION_ALGORITHMS
+        """
+        self.replay = cffirmware.tdoaReplay_t()
+        cffirmware.tdoaReplayInit(self.replay, MATCHING_ALGORITHMS[matching],
+                                  CLOCK_CORRECTION_ALGORITHMS[clock_correction])
+        for id, point in anchor_positions.items():
+            cffirmware.tdoaReplaySetAnchorPosition(self.replay, id, point.x, point.y, point.z)
+
+    def run(self, packets: np.ndarray):
+        """
+        Args:
+            packets (np.ndarray): Packets with the PACKET_DTYPE, sorted in time
+
+        Returns:
+            tuple[np.ndarray, np.ndarray, cffirmware.tdoaReplayStats_t]: The result of each packet (RESULT_DTYPE),
+                the measurements (MEASUREMENT_DTYPE) and the statistics
+        """
+        packets = np.ascontiguousarray(packets, dtype=self.PACKET_DTYPE)
+        results = np.zeros(len(packets), dtype=self.RESULT_DTYPE)
+        measurements = np.zeros(len(packets) * 8, dtype=self.MEASUREMENT_DTYPE)
+        count = 0
+        if len(packets) > 0:
+            count = cffirmware.tdoaReplayRunBuffer(self.replay, packets, results, measurements)
+
+        return results, measurements[:count], self.replay.stats
+
+    @classmethod
+    def from_log_data(cls, log_data: dict, true_position=None) -> np.ndarray:
+        """Build packets from decoded log data
+
+        Args:
+            log_data: Log data as returned by cfusdlog.decode()
+            true_position: Optional function of time [s] that returns the true tag position (x, y, z)
+
+        Returns:
+            np.ndarray: Packets with the PACKET_DTYPE, sorted in time
+        """
+        if 'tdoa3Pkt' not in log_data:
+            return np.zeros(0, dtype=cls.PACKET_DTYPE)
+
+        data = log_data['tdoa3Pkt']
+        packets = np.zeros(len(data['timestamp']), dtype=cls.PACKET_DTYPE)
+        # Timestamps in the decoded log are in ms
+        packets['usecTimestamp'] = np.round(np.asarray(data['timestamp']) * 1000.0)
+        packets['rx'] = data['rx']
+        packets['tx'] = data['tx']
+        packets['anchorId'] = data['id']
+        packets['seq'] = data['seq']
+        packets['truePosition'] = np.nan
+
+        if true_position is not None:
+            for packet in packets:
+                packet['truePosition'] = true_position(packet['usecTimestamp'] * 1e-6)
+
+        # The remote data events are triggered right after the packet event, match on anchor, sequence number and time
+        index = {}
+        for i, packet in enumerate(packets):
+            index[(int(packet['anchorId']), int(packet['seq']), int(packet['usecTimestamp']) // 1000)] = i
+
+        if 'tdoa3Remote' in log_data:
+            remote = log_data['tdoa3Remote']
+            for i in range(len(remote['timestamp'])):
+                key = (int(remote['id'][i]), int(remote['pktSeq'][i]))
+                timestamp = int(round(remote['timestamp'][i]))
+                packet_index = index.get(key + (timestamp,), index.get(key + (timestamp - 1,)))
+                if packet_index is None:
+                    continue
+
+                packet = packets[packet_index]
+                count = packet['remoteCount']
+                if count < 8:
+                    packet['remoteData'][count] = (remote['remoteId'][i], remote['seq'][i], remote['tof'][i],
+                                                   remote['rx'][i])
+                    packet['remoteCount'] = count + 1
+
+        return packets[np.argsort(packets['usecTimestamp'], kind='stable')]
+
+
+def make_anchor_positions(positions):
+    """Convert (x, y, z) tuples per anchor id to the format of read_loco_anchor_positions()"""
+    result = {}
+    for id, (x, y, z) in positions.items():
+        point = cffirmware.vec3_s()
+        point.x, point.y, point.z = x, y, z
+        result[id] = point
+    return result
+
+
+def synthetic_packets(anchor_positions, true_position, duration=5.0, packet_interval=0.002, drift_ppm=10.0, seed=0):
+    """Generate TDoA3 packets for a tag at a fixed position. The anchors transmit in turn at random intervals and
+    report the latest packet they received from every other anchor, as TDoA3 anchors do.
+
+    Args:
+        anchor_positions (dict[int, cffirmware.vec3_s]): The anchor positions
+        true_position (tuple): Position of the tag
+        duration: Length of the stream [s]
+        packet_interval: Mean time between packets from the system [s]
+        drift_ppm: Max clock drift of the anchors and the tag [ppm]
+        seed: Seed for the random generator
+
+    Returns:
+        np.ndarray: Packets with the TdoaReplay.PACKET_DTYPE
+    """
+    rng = np.random.default_rng(seed)
+    ids = sorted(anchor_positions.keys())
+    positions = {id: np.array((point.x, point.y, point.z), dtype=np.float64) for id, point in anchor_positions.items()}
+    tag = np.array(true_position, dtype=np.float64)
+
+    drift = {id: rng.uniform(-drift_ppm, drift_ppm) * 1e-6 for id in ids}
+    offset = {id: float(rng.integers(0, 2**32)) for id in ids}
+    tag_drift = rng.uniform(-drift_ppm, drift_ppm) * 1e-6
+    tag_offset = float(rng.integers(0, 2**32))
+
+    def anchor_ticks(id, t):
+        return int(t * (1.0 + drift[id]) * TS_FREQ + offset[id]) & 0xFFFFFFFF
+
+    seq = {id: 0 for id in ids}
+    # Latest (seq, rx time) received by anchor [receiver][sender]
+    latest = {id: {} for id in ids}
+
+    count = int(duration / packet_interval)
+    packets = np.zeros(count, dtype=TdoaReplay.PACKET_DTYPE)
+    t = 0.01
+    for k in range(count):
+        id = ids[k % len(ids)]
+        t += packet_interval * rng.uniform(0.5, 1.5)
+        seq[id] = (seq[id] + 1) & 0x7f
+
+        arrival = t + np.linalg.norm(tag - positions[id]) / SPEED_OF_LIGHT
+        packet = packets[k]
+        packet['usecTimestamp'] = int(arrival * 1e6)
+        packet['rx'] = int(arrival * (1.0 + tag_drift) * TS_FREQ + tag_offset) & 0xFFFFFFFFFF
+        packet['tx'] = anchor_ticks(id, t)
+        packet['anchorId'] = id
+        packet['seq'] = seq[id]
+        packet['truePosition'] = tag
+
+        remote_count = 0
+        for other, (other_seq, rx) in latest[id].items():
+            if remote_count >= 8:
+                break
+            tof = np.linalg.norm(positions[other] - positions[id]) / SPEED_OF_LIGHT * TS_FREQ
+            packet['remoteData'][remote_count] = (other, other_seq | 0x80, int(round(tof)), rx)
+            remote_count += 1
+        packet['remoteCount'] = remote_count
+
+        for other in ids:
+            if other != id:
+                rx_time = t + np.linalg.norm(positions[other] - positions[id]) / SPEED_OF_LIGHT
+                latest[other][id] = (seq[id], anchor_ticks(other, rx_time))
+
+    return packets
+
+
+def estimated_position_error(measurements, anchor_positions, true_position):
+    """Run the accepted measurements through the kalman estimator, for a tag that is standing still, and return the
+    RMS error of the estimated position over the second half of the stream [m]"""
+    accepted = measurements[measurements['isAccepted'] != 0]
+    if len(accepted) == 0:
+        return None
+
+    start_ms = int(accepted['usecTimestamp'][0] // 1000)
+    end_ms = int(accepted['usecTimestamp'][-1] // 1000)
+
+    imu_count = end_ms - start_ms + 1
+    imu = np.zeros(2 * imu_count, dtype=KalmanReplay.SAMPLE_DTYPE)
+    imu['timestamp'] = np.repeat(np.arange(start_ms, end_ms + 1), 2)
+    imu['type'][0::2] = cffirmware.kalmanReplaySampleAcceleration
+    imu['type'][1::2] = cffirmware.kalmanReplaySampleGyroscope
+    imu['value'][0::2, 2] = 1.0
+
+    tdoa = np.zeros(len(accepted), dtype=KalmanReplay.SAMPLE_DTYPE)
+    tdoa['timestamp'] = accepted['usecTimestamp'] // 1000
+    tdoa['type'] = cffirmware.kalmanReplaySampleTdoa
+    tdoa['anchorIdA'] = accepted['anchorIdA']
+    tdoa['anchorIdB'] = accepted['anchorIdB']
+    tdoa['value'][:, 0] = accepted['distanceDiff']
+
+    samples = np.concatenate((imu, tdoa))
+    samples = samples[np.argsort(samples['timestamp'], kind='stable')]
+
+    output, _ = KalmanReplay(anchor_positions).run(samples)
+    second_half = output[len(output) // 2:]
+    error = second_half['position'] - np.array(true_position, dtype=np.float32)
+    return float(np.sqrt(np.mean(np.sum(error ** 2, axis=1))))
+
+
+def summary(results, measurements, stats):
+    """Key figures of a run as a dict"""
+    packet_count = len(results)
+    row = {
+        'packets': packet_count,
+        'measurements': len(measurements),
+        'yield': float(np.mean(results['acceptedCount'] > 0)) if packet_count > 0 else 0.0,
+        'nsPerPacket': stats.nsPerPacket,
+        'rmsError': stats.rmsError if stats.errorCount > 0 else None,
+    }
+    for result, name in RESULT_NAMES.items():
+        row[name] = int(np.count_nonzero(results['result'] == result))
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', nargs='?', help='Log file recorded with the uSD-card deck, synthetic data if missing')
+    parser.add_argument('--anchors', help='Anchor positions, a yaml file exported from the client')
+    args = parser.parse_args()
+
+    if args.file:
+        if not args.anchors:
+            parser.error('Anchor positions are needed for recorded data')
+        anchor_positions = read_loco_anchor_positions(args.anchors)
+        packets = TdoaReplay.from_log_data(cfusdlog.decode(args.file))
+        true_position = None
+    else:
+        anchor_positions = make_anchor_positions({
+            0: (0.0, 0.0, 0.0), 1: (4.0, 0.0, 0.0), 2: (0.0, 4.0, 0.0), 3: (4.0, 4.0, 0.0),
+            4: (0.0, 0.0, 2.5), 5: (4.0, 0.0, 2.5), 6: (0.0, 4.0, 2.5), 7: (4.0, 4.0, 2.5)})
+        true_position = (1.5, 2.5, 1.0)
+        packets = synthetic_packets(anchor_positions, true_position)
+
+    names = list(RESULT_NAMES.values())
+    print(f'{"matching":>9} {"clock corr":>14} {"yield [%]":>10} {"ns/packet":>10} {"rms [m]":>8} {"est [m]":>8} ' +
+          ' '.join(f'{name:>16}' for name in names))
+    for matching in MATCHING_ALGORITHMS:
+        for clock_correction in CLOCK_CORRECTION_ALGORITHMS:
+            replay = TdoaReplay(anchor_positions, matching, clock_correction)
+            results, measurements, stats = replay.run(packets)
+            row = summary(results, measurements, stats)
+
+            estimated = None
+            if true_position is not None:
+                estimated = estimated_position_error(measurements, anchor_positions, true_position)
+
+            rms = f'{row["rmsError"]:.3f}' if row['rmsError'] is not None else '-'
+            est = f'{estimated:.3f}' if estimated is not None else '-'
+            print(f'{matching:>9} {clock_correction:>14} {row["yield"] * 100:>10.1f} {row["nsPerPacket"]:>10.0f} '
+                  f'{rms:>8} {est:>8} ' + ' '.join(f'{row[name]:>16}' for name in names))
+
+
+if __name__ == '__main__':
+    main()
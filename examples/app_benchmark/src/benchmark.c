@@ -0,0 +1,560 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * benchmark.c - App layer application with a fixed suite of micro-benchmarks of
+ *   the core kernels, timed with the DWT cycle counter.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "app.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "crtp.h"
+#include "cycle_counter.h"
+#include "supervisor.h"
+#include "version.h"
+#include "mem.h"
+#include "log.h"
+#include "param.h"
+
+#include "kalman_core.h"
+#include "mm_tdoa.h"
+#include "outlierFilterTdoa.h"
+#include "controller_pid.h"
+#include "controller_mellinger.h"
+#include "controller_indi.h"
+#include "controller_brescianini.h"
+#include "controller_lee.h"
+#include "pptraj.h"
+#include "lighthouse_calibration.h"
+#include "filter.h"
+#include "math3d.h"
+
+#define DEBUG_MODULE "BENCH"
+#include "debug.h"
+
+// Increase when the workload of a benchmark changes, results are only comparable within one suite version
+#define BENCHMARK_SUITE_VERSION 1
+#define BENCHMARK_ITERATIONS 500
+#define BENCHMARK_NAME_LEN 12
+
+typedef enum {
+  benchKalmanPredict,
+  benchKalmanScalarUpdate,
+  benchKalmanTdoa,
+  benchControllerPid,
+  benchControllerMellinger,
+  benchControllerIndi,
+  benchControllerBrescianini,
+  benchControllerLee,
+  benchPptrajEval,
+  benchLighthouseCalibration,
+  benchLpf2p,
+  benchLogBlockSample,
+  benchmark_COUNT,
+} benchmarkId_t;
+
+typedef struct {
+  const char* name;
+  // Sets up the input for the iteration, not timed
+  void (*prepare)(const uint32_t iteration);
+  // The timed call
+  void (*run)(void);
+} benchmark_t;
+
+// The result table, as read through the memory subsystem (MEM_TYPE_APP). All values are little endian.
+typedef struct {
+  char name[BENCHMARK_NAME_LEN];
+  uint32_t minCycles;
+  uint32_t avgCycles;
+  uint32_t maxCycles;
+} __attribute__((packed)) benchmarkResult_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t count;
+  uint16_t iterations;
+  uint32_t runCount;
+  uint32_t cpuFrequencyHz;
+  benchmarkResult_t results[benchmark_COUNT];
+} __attribute__((packed)) benchmarkTable_t;
+
+static benchmarkTable_t table;
+
+static uint8_t run;
+static uint32_t avgCycles[benchmark_COUNT];
+
+// Results are written here so that the compiler can not remove the calls
+static volatile float sink;
+
+
+// Shared scenario ////////////////////////////////////////////////
+
+static setpoint_t setpoint;
+static sensorData_t sensors;
+static state_t state;
+static control_t control;
+
+// A slow circle with a tilted, yawing vehicle lagging a bit behind the setpoint. The scenario changes every iteration
+// to avoid data dependent shortcuts in the measurements.
+static void prepareScenario(const uint32_t iteration) {
+  const float t = iteration * 0.01f;
+  const float s = sinf(t);
+  const float c = cosf(t);
+
+  memset(&setpoint, 0, sizeof(setpoint));
+  setpoint.mode.x = modeAbs;
+  setpoint.mode.y = modeAbs;
+  setpoint.mode.z = modeAbs;
+  setpoint.mode.yaw = modeAbs;
+  setpoint.position.x = c;
+  setpoint.position.y = s;
+  setpoint.position.z = 1.0f;
+  setpoint.velocity.x = -s;
+  setpoint.velocity.y = c;
+  setpoint.acceleration.x = -c;
+  setpoint.acceleration.y = -s;
+  setpoint.attitude.yaw = 10.0f * s;
+
+  const float roll = radians(5.0f * s);
+  const float pitch = radians(5.0f * c);
+  const float yaw = radians(10.0f * s + 2.0f);
+  struct quat q = rpy2quat(mkvec(roll, pitch, yaw));
+
+  memset(&state, 0, sizeof(state));
+  state.position.x = 0.95f * c;
+  state.position.y = 0.95f * s;
+  state.position.z = 0.98f;
+  state.velocity.x = -0.9f * s;
+  state.velocity.y = 0.9f * c;
+  state.attitude.roll = degrees(roll);
+  state.attitude.pitch = -degrees(pitch);
+  state.attitude.yaw = degrees(yaw);
+  state.attitudeQuaternion.x = q.x;
+  state.attitudeQuaternion.y = q.y;
+  state.attitudeQuaternion.z = q.z;
+  state.attitudeQuaternion.w = q.w;
+
+  memset(&sensors, 0, sizeof(sensors));
+  sensors.acc.x = 0.05f * s;
+  sensors.acc.y = -0.05f * c;
+  sensors.acc.z = 1.0f + 0.01f * s;
+  sensors.gyro.x = 20.0f * c;
+  sensors.gyro.y = -20.0f * s;
+  sensors.gyro.z = 5.0f * c;
+}
+
+
+// Kalman filter ////////////////////////////////////////////////
+
+#define KALMAN_START_MS 1000
+// The filter runs the prediction at 100 Hz
+#define KALMAN_PREDICTION_MS 10
+
+static kalmanCoreParams_t kalmanParams;
+static kalmanCoreData_t kalmanInitial;
+static kalmanCoreData_t kalman;
+static OutlierFilterTdoaState_t tdoaOutlierFilter;
+static tdoaMeasurement_t tdoa;
+static float scalarH[KC_STATE_DIM];
+static float scalarError;
+
+static void setupKalman(void) {
+  kalmanCoreDefaultParams(&kalmanParams);
+  kalmanCoreInit(&kalmanInitial, &kalmanParams, KALMAN_START_MS);
+  kalmanInitial.S[KC_STATE_Z] = 1.0f;
+}
+
+// Every iteration starts from the same filter state, the filter would otherwise converge during the run
+static void prepareKalman(const uint32_t iteration) {
+  prepareScenario(iteration);
+  memcpy(&kalman, &kalmanInitial, sizeof(kalman));
+}
+
+static void runKalmanPredict(void) {
+  kalmanCorePredict(&kalman, &sensors.acc, &sensors.gyro, KALMAN_START_MS + KALMAN_PREDICTION_MS, true);
+}
+
+static void prepareKalmanScalarUpdate(const uint32_t iteration) {
+  prepareKalman(iteration);
+  memset(scalarH, 0, sizeof(scalarH));
+  scalarH[KC_STATE_X + iteration % 3] = 1.0f;
+  scalarError = state.position.x - kalman.S[KC_STATE_X];
+}
+
+static void runKalmanScalarUpdate(void) {
+  arm_matrix_instance_f32 H = {1, KC_STATE_DIM, scalarH};
+  kalmanCoreScalarUpdate(&kalman, &H, scalarError, 0.01f);
+}
+
+static void prepareKalmanTdoa(const uint32_t iteration) {
+  prepareKalman(iteration);
+  outlierFilterTdoaReset(&tdoaOutlierFilter);
+
+  // Anchors in the corners of a 4 x 4 x 3 m space, the measurement is consistent with the scenario
+  const int a = iteration % 8;
+  const int b = (iteration + 3) % 8;
+  tdoa.anchorIdA = a;
+  tdoa.anchorIdB = b;
+  tdoa.anchorPositionA = (point_t){.x = (a & 1) ? 2.0f : -2.0f, .y = (a & 2) ? 2.0f : -2.0f, .z = (a & 4) ? 3.0f : 0.0f};
+  tdoa.anchorPositionB = (point_t){.x = (b & 1) ? 2.0f : -2.0f, .y = (b & 2) ? 2.0f : -2.0f, .z = (b & 4) ? 3.0f : 0.0f};
+
+  const struct vec p = mkvec(state.position.x, state.position.y, state.position.z);
+  const float dA = vmag(vsub(p, mkvec(tdoa.anchorPositionA.x, tdoa.anchorPositionA.y, tdoa.anchorPositionA.z)));
+  const float dB = vmag(vsub(p, mkvec(tdoa.anchorPositionB.x, tdoa.anchorPositionB.y, tdoa.anchorPositionB.z)));
+  tdoa.distanceDiff = dB - dA;
+  tdoa.stdDev = 0.15f;
+  tdoa.eventTimeUs = 0;
+}
+
+static void runKalmanTdoa(void) {
+  kalmanCoreUpdateWithTdoa(&kalman, &tdoa, KALMAN_START_MS, &tdoaOutlierFilter);
+}
+
+
+// Controllers ////////////////////////////////////////////////
+
+static controllerMellinger_t mellinger;
+static controllerLee_t lee;
+
+// Step 0 executes all the rate limited parts of the controllers
+static const stabilizerStep_t controllerStep = 0;
+
+static void runControllerPid(void) {
+  controllerPid(&control, &setpoint, &sensors, &state, controllerStep);
+}
+
+static void runControllerMellinger(void) {
+  controllerMellinger(&mellinger, &control, &setpoint, &sensors, &state, controllerStep);
+}
+
+static void runControllerIndi(void) {
+  controllerINDI(&control, &setpoint, &sensors, &state, controllerStep);
+}
+
+static void runControllerBrescianini(void) {
+  controllerBrescianini(&control, &setpoint, &sensors, &state, controllerStep);
+}
+
+static void runControllerLee(void) {
+  controllerLee(&lee, &control, &setpoint, &sensors, &state, controllerStep);
+}
+
+// The PID, INDI and Brescianini controllers keep their state in globals, they are re-initialized before and after
+// the run
+static void initControllers(void) {
+  controllerPidInit();
+  controllerINDIInit();
+  controllerBrescianiniInit();
+  controllerMellingerInit(&mellinger);
+  controllerLeeInit(&lee);
+}
+
+
+// Trajectory ////////////////////////////////////////////////
+
+// Two 7th order pieces of a figure 8 trajectory, with some height and yaw motion added
+static struct poly4d trajectoryPieces[] = {
+  {
+    .p = {
+      { 0.396058f, 0.918033f, 0.128965f, -0.773546f, 0.339704f, 0.034310f, -0.026417f, -0.030049f },
+      { -0.445604f, -0.684403f, 0.888433f, 1.493630f, -1.361618f, -0.139316f, 0.158875f, 0.095799f },
+      { 1.0f, 0.1f, -0.05f, 0.02f, 0.01f, -0.005f, 0.002f, -0.001f },
+      { 0.1f, 0.3f, -0.2f, 0.05f, 0.0f, 0.0f, 0.0f, 0.0f },
+    },
+    .duration = 0.71f,
+  },
+  {
+    .p = {
+      { 0.922409f, 0.405715f, -0.582968f, -0.092188f, -0.114670f, 0.101046f, 0.075834f, -0.037926f },
+      { -0.291165f, 0.967514f, 0.421451f, -1.086348f, 0.545211f, 0.030109f, -0.050046f, -0.068177f },
+      { 1.05f, -0.1f, 0.05f, -0.02f, -0.01f, 0.005f, -0.002f, 0.001f },
+      { 0.35f, -0.3f, 0.2f, -0.05f, 0.0f, 0.0f, 0.0f, 0.0f },
+    },
+    .duration = 0.62f,
+  },
+};
+
+static struct piecewise_traj trajectory = {
+  .t_begin = 0.0f,
+  .timescale = 1.0f,
+  .scale = {1.0f, 1.0f, 1.0f},
+  .shift = {0.0f, 0.0f, 0.0f},
+  .n_pieces = 2,
+  .pieces = trajectoryPieces,
+};
+static float trajectoryTime;
+
+static void preparePptrajEval(const uint32_t iteration) {
+  // Moves forward through both pieces, and starts over
+  trajectoryTime = (iteration % 100) * 0.0133f;
+  if (trajectoryTime == 0.0f) {
+    piecewise_reset_cache(&trajectory);
+  }
+}
+
+static void runPptrajEval(void) {
+  struct traj_eval ev = piecewise_eval(&trajectory, trajectoryTime);
+  sink = ev.pos.x + ev.vel.y + ev.acc.z + ev.omega.x;
+}
+
+
+// Lighthouse ////////////////////////////////////////////////
+
+static const lighthouseCalibration_t lighthouseCalibration = {
+  .sweep = {
+    {.phase = 0.0012f, .tilt = -0.0471f, .curve = 0.0083f, .gibmag = 0.0026f, .gibphase = 1.21f, .ogeemag = -0.0046f, .ogeephase = 0.57f},
+    {.phase = -0.0009f, .tilt = 0.0512f, .curve = -0.0061f, .gibmag = -0.0031f, .gibphase = 2.02f, .ogeemag = 0.0052f, .ogeephase = 1.13f},
+  },
+  .uid = 0x12345678,
+  .valid = true,
+};
+static float rawAngles[2];
+
+static void prepareLighthouseCalibration(const uint32_t iteration) {
+  const float t = iteration * 0.01f;
+  rawAngles[0] = 0.5f * sinf(t);
+  rawAngles[1] = 0.4f * cosf(t);
+}
+
+static void runLighthouseCalibration(void) {
+  float correctedAngles[2];
+  lighthouseCalibrationApplyV2(&lighthouseCalibration, rawAngles, correctedAngles);
+  sink = correctedAngles[0] + correctedAngles[1];
+}
+
+
+// Filter ////////////////////////////////////////////////
+
+static lpf2pData lpf;
+static float lpfSample;
+
+static void prepareLpf2p(const uint32_t iteration) {
+  if (iteration == 0) {
+    lpf2pInit(&lpf, 1000.0f, 80.0f);
+  }
+  prepareScenario(iteration);
+  lpfSample = sensors.gyro.x;
+}
+
+static void runLpf2p(void) {
+  sink = lpf2pApply(&lpf, lpfSample);
+}
+
+
+// Log ////////////////////////////////////////////////
+
+// A typical block of state estimate and attitude variables
+static const char* logBlockVariables[][2] = {
+  {"stateEstimate", "x"},
+  {"stateEstimate", "y"},
+  {"stateEstimate", "z"},
+  {"stateEstimate", "vx"},
+  {"stateEstimate", "vy"},
+  {"stateEstimate", "vz"},
+  {"stabilizer", "roll"},
+  {"stabilizer", "pitch"},
+  {"stabilizer", "yaw"},
+};
+#define LOG_BLOCK_VARIABLE_COUNT ((int)(sizeof(logBlockVariables) / sizeof(logBlockVariables[0])))
+static logVarId_t logBlockIds[LOG_BLOCK_VARIABLE_COUNT];
+static uint8_t logBlockPacket[CRTP_MAX_DATA_SIZE];
+
+static void setupLogBlock(void) {
+  for (int i = 0; i < LOG_BLOCK_VARIABLE_COUNT; i++) {
+    logBlockIds[i] = logGetVarId(logBlockVariables[i][0], logBlockVariables[i][1]);
+  }
+}
+
+// The log blocks are sampled inside the log module, the app can not reach that code. This samples the same
+// variables through the public log API, resolving the address and the size of each variable and copying the
+// value into a packet, which is the work logRunBlock() does per variable.
+static void runLogBlockSample(void) {
+  int offset = 0;
+  for (int i = 0; i < LOG_BLOCK_VARIABLE_COUNT; i++) {
+    if (!logVarIdIsValid(logBlockIds[i])) {
+      continue;
+    }
+
+    const uint8_t size = logVarSize(logGetType(logBlockIds[i]));
+    if (offset + size > (int)sizeof(logBlockPacket)) {
+      break;
+    }
+    memcpy(&logBlockPacket[offset], logGetAddress(logBlockIds[i]), size);
+    offset += size;
+  }
+  sink = offset;
+}
+
+
+// Suite ////////////////////////////////////////////////
+
+static const benchmark_t benchmarks[benchmark_COUNT] = {
+  [benchKalmanPredict] = {"kfPredict", prepareKalman, runKalmanPredict},
+  [benchKalmanScalarUpdate] = {"kfScalar", prepareKalmanScalarUpdate, runKalmanScalarUpdate},
+  [benchKalmanTdoa] = {"kfTdoa", prepareKalmanTdoa, runKalmanTdoa},
+  [benchControllerPid] = {"ctrlPid", prepareScenario, runControllerPid},
+  [benchControllerMellinger] = {"ctrlMell", prepareScenario, runControllerMellinger},
+  [benchControllerIndi] = {"ctrlIndi", prepareScenario, runControllerIndi},
+  [benchControllerBrescianini] = {"ctrlBresc", prepareScenario, runControllerBrescianini},
+  [benchControllerLee] = {"ctrlLee", prepareScenario, runControllerLee},
+  [benchPptrajEval] = {"pptrajEval", preparePptrajEval, runPptrajEval},
+  [benchLighthouseCalibration] = {"lhCalib", prepareLighthouseCalibration, runLighthouseCalibration},
+  [benchLpf2p] = {"lpf2p", prepareLpf2p, runLpf2p},
+  [benchLogBlockSample] = {"logBlock", prepareScenario, runLogBlockSample},
+};
+
+static void runBenchmark(const benchmark_t* benchmark, benchmarkResult_t* result) {
+  // Warm up the caches and the states, no timing
+  benchmark->prepare(0);
+  benchmark->run();
+
+  uint64_t total = 0;
+  uint32_t min = UINT32_MAX;
+  uint32_t max = 0;
+  for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    benchmark->prepare(i);
+
+    // Keep other tasks from running in the middle of a call, they would show up in the timing
+    vTaskSuspendAll();
+    const uint32_t start = cycleCounterGet();
+    benchmark->run();
+    const uint32_t elapsed = cycleCounterElapsed(start);
+    xTaskResumeAll();
+
+    total += elapsed;
+    if (elapsed < min) {
+      min = elapsed;
+    }
+    if (elapsed > max) {
+      max = elapsed;
+    }
+  }
+
+  strncpy(result->name, benchmark->name, BENCHMARK_NAME_LEN);
+  result->minCycles = min;
+  result->avgCycles = (total + BENCHMARK_ITERATIONS / 2) / BENCHMARK_ITERATIONS;
+  result->maxCycles = max;
+}
+
+static void runSuite(void) {
+  if (supervisorIsArmed()) {
+    DEBUG_PRINT("Refusing to run while armed\n");
+    return;
+  }
+
+  cycleCounterInit();
+  setupKalman();
+  setupLogBlock();
+  initControllers();
+
+  // One line per benchmark, comma separated, starting with BENCH to be easy to pick out of the console
+  DEBUG_PRINT("BENCH,suite,%d,%s,%d\n", BENCHMARK_SUITE_VERSION, V_SLOCAL_REVISION, BENCHMARK_ITERATIONS);
+  for (int i = 0; i < benchmark_COUNT; i++) {
+    benchmarkResult_t result;
+    runBenchmark(&benchmarks[i], &result);
+
+    table.results[i] = result;
+    avgCycles[i] = result.avgCycles;
+    DEBUG_PRINT("BENCH,%s,%lu,%lu,%lu\n", benchmarks[i].name,
+      (unsigned long)result.minCycles, (unsigned long)result.avgCycles, (unsigned long)result.maxCycles);
+  }
+
+  table.runCount++;
+  DEBUG_PRINT("BENCH,end,%lu\n", (unsigned long)table.runCount);
+
+  initControllers();
+}
+
+static uint32_t tableGetSize(void) {
+  return sizeof(table);
+}
+
+static bool tableRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > sizeof(table)) {
+    return false;
+  }
+
+  memcpy(buffer, ((const uint8_t*)&table) + memAddr, readLen);
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_APP,
+  .getSize = tableGetSize,
+  .read = tableRead,
+  .write = 0, // Write not supported
+};
+
+void appMain() {
+  table.version = BENCHMARK_SUITE_VERSION;
+  table.count = benchmark_COUNT;
+  table.iterations = BENCHMARK_ITERATIONS;
+  table.cpuFrequencyHz = configCPU_CLOCK_HZ;
+  memoryRegisterHandler(&memDef);
+
+  DEBUG_PRINT("Set appBench.run to run the benchmarks\n");
+
+  while(1) {
+    vTaskDelay(M2T(100));
+    if (run) {
+      runSuite();
+      run = 0;
+    }
+  }
+}
+
+/**
+ * Micro-benchmarks of the core kernels, timed with the cycle counter. Results are printed to the console, logged and
+ * available in the MEM_TYPE_APP memory.
+ */
+PARAM_GROUP_START(appBench)
+/**
+ * @brief Set to nonzero to run the benchmark suite. Refused while armed.
+ */
+PARAM_ADD(PARAM_UINT8, run, &run)
+PARAM_GROUP_STOP(appBench)
+
+/**
+ * Results of the last benchmark run, average CPU cycles per call
+ */
+LOG_GROUP_START(appBench)
+LOG_ADD(LOG_UINT32, kfPredict, &avgCycles[benchKalmanPredict])
+LOG_ADD(LOG_UINT32, kfScalar, &avgCycles[benchKalmanScalarUpdate])
+LOG_ADD(LOG_UINT32, kfTdoa, &avgCycles[benchKalmanTdoa])
+LOG_ADD(LOG_UINT32, ctrlPid, &avgCycles[benchControllerPid])
+LOG_ADD(LOG_UINT32, ctrlMell, &avgCycles[benchControllerMellinger])
+LOG_ADD(LOG_UINT32, ctrlIndi, &avgCycles[benchControllerIndi])
+LOG_ADD(LOG_UINT32, ctrlBresc, &avgCycles[benchControllerBrescianini])
+LOG_ADD(LOG_UINT32, ctrlLee, &avgCycles[benchControllerLee])
+LOG_ADD(LOG_UINT32, pptrajEval, &avgCycles[benchPptrajEval])
+LOG_ADD(LOG_UINT32, lhCalib, &avgCycles[benchLighthouseCalibration])
+LOG_ADD(LOG_UINT32, lpf2p, &avgCycles[benchLpf2p])
+LOG_ADD(LOG_UINT32, logBlock, &avgCycles[benchLogBlockSample])
+LOG_GROUP_STOP(appBench)
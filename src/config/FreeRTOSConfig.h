@@ -162,9 +162,9 @@ to exclude the API function. */
 #ifdef CONFIG_DEBUG_QUEUE_MONITOR
     #undef traceQUEUE_SEND
     #undef traceQUEUE_SEND_FAILED
-    #define traceQUEUE_SEND(xQueue) qm_traceQUEUE_SEND(xQueue)
+    #define traceQUEUE_SEND(xQueue) do { qm_traceQUEUE_SEND(xQueue); TRACE_QUEUE_STATS_SEND(xQueue); } while (0)
     void qm_traceQUEUE_SEND(void* xQueue);
-    #define traceQUEUE_SEND_FAILED(xQueue) qm_traceQUEUE_SEND_FAILED(xQueue)
+    #define traceQUEUE_SEND_FAILED(xQueue) do { qm_traceQUEUE_SEND_FAILED(xQueue); TRACE_QUEUE_STATS_SEND_FAILED(xQueue); } while (0)
     void qm_traceQUEUE_SEND_FAILED(void* xQueue);
 #endif // CONFIG_DEBUG_QUEUE_MONITOR
 
@@ -74,6 +74,7 @@
 #define ZRANGER_TASK_PRI        2
 #define ZRANGER2_TASK_PRI       2
 #define LOG_TASK_PRI            1
+#define LOG_SCHED_TASK_PRI      2
 #define MEM_TASK_PRI            1
 #define PARAM_TASK_PRI          1
 #define PROXIMITY_TASK_PRI      0
@@ -90,6 +91,7 @@
 #define UART1_TEST_TASK_PRI     1
 #define UART2_TEST_TASK_PRI     1
 #define KALMAN_TASK_PRI         2
+#define KALMAN_UPDATE_TASK_PRI  1
 #define ERROR_UKF_TASK_PRI      2
 #define LEDSEQCMD_TASK_PRI      1
 #define FLAPPERDECK_TASK_PRI    2
@@ -100,6 +102,8 @@
 #define UART2_TASK_PRI          3
 #define CRTP_SRV_TASK_PRI       0
 #define PLATFORM_SRV_TASK_PRI   0
+#define P2P_TDMA_TASK_PRI       3
+#define EVENTTRIGGER_TASK_PRI   1
 
 // Not compiled
 #if 0
@@ -117,6 +121,7 @@
 #define CRTP_RX_TASK_NAME       "CRTP-RX"
 #define CRTP_RXTX_TASK_NAME     "CRTP-RXTX"
 #define LOG_TASK_NAME           "LOG"
+#define LOG_SCHED_TASK_NAME     "LOG-SCHED"
 #define MEM_TASK_NAME           "MEM"
 #define PARAM_TASK_NAME         "PARAM"
 #define SENSORS_TASK_NAME       "SENSORS"
@@ -144,6 +149,7 @@
 #define UART1_TEST_TASK_NAME    "UART1TEST"
 #define UART2_TEST_TASK_NAME    "UART2TEST"
 #define KALMAN_TASK_NAME        "KALMAN"
+#define KALMAN_UPDATE_TASK_NAME "KALMAN-UPD"
 #define ERROR_UKF_TASK_NAME     "ERROR_UKF"
 #define ACTIVE_MARKER_TASK_NAME "ACTIVEMARKER-DECK"
 #define AI_DECK_GAP_TASK_NAME   "AI-DECK-GAP"
@@ -158,6 +164,8 @@
 #define CPX_TASK_NAME           "CPX"
 #define APP_TASK_NAME           "APP"
 #define FLAPPERDECK_TASK_NAME   "FLAPPERDECK"
+#define P2P_TDMA_TASK_NAME      "P2P-TDMA"
+#define EVENTTRIGGER_TASK_NAME  "EVENTTRIG"
 
 
 //Task stack sizes
@@ -169,6 +177,7 @@
 #define CRTP_RX_TASK_STACKSIZE        (2* configMINIMAL_STACK_SIZE)
 #define CRTP_RXTX_TASK_STACKSIZE      configMINIMAL_STACK_SIZE
 #define LOG_TASK_STACKSIZE            (2 * configMINIMAL_STACK_SIZE)
+#define LOG_SCHED_TASK_STACKSIZE      (3 * configMINIMAL_STACK_SIZE)
 #define MEM_TASK_STACKSIZE            (2 * configMINIMAL_STACK_SIZE)
 #define PARAM_TASK_STACKSIZE          (2 * configMINIMAL_STACK_SIZE)
 #define SENSORS_TASK_STACKSIZE        (2 * configMINIMAL_STACK_SIZE)
@@ -202,8 +211,11 @@
 #define LPS_DECK_STACKSIZE            (3 * configMINIMAL_STACK_SIZE)
 #define OA_DECK_TASK_STACKSIZE        (2 * configMINIMAL_STACK_SIZE)
 #define KALMAN_TASK_STACKSIZE         (3 * configMINIMAL_STACK_SIZE)
+#define KALMAN_UPDATE_TASK_STACKSIZE  (3 * configMINIMAL_STACK_SIZE)
 #define FLAPPERDECK_TASK_STACKSIZE    (2 * configMINIMAL_STACK_SIZE)
 #define ERROR_UKF_TASK_STACKSIZE      (4 * configMINIMAL_STACK_SIZE)
+#define P2P_TDMA_TASK_STACKSIZE       configMINIMAL_STACK_SIZE
+#define EVENTTRIGGER_TASK_STACKSIZE   (2 * configMINIMAL_STACK_SIZE)
 
 //The radio channel. From 0 to 125
 #define RADIO_CHANNEL 80
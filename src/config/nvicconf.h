@@ -78,6 +78,7 @@
 
 
 #define NVIC_TRACE_TIM_PRI    4
+#define NVIC_SLEEP_TIM_PRI    NVIC_HIGH_PRI
 #define NVIC_RADIO_PRI        11
 #define NVIC_ADC_PRI          12
 #define NVIC_CPPM_PRI         14
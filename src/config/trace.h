@@ -27,6 +27,8 @@
 #ifndef __TRACE_H__
 #define __TRACE_H__
 
+#include "autoconf.h"
+
 #define configUSE_TRACE_FACILITY	1
 
 // ITM useful macros
@@ -37,9 +39,53 @@
                            ((uint32_t*)0xE0000000)[CH] = DATA
 #endif
 
+#if defined(CONFIG_DEBUG_CPU_ACCOUNTING) || defined(CONFIG_DEBUG_EVENT_TRACE)
+#include "cpu_accounting.h"
+#include "event_trace.h"
+
+#ifdef CONFIG_DEBUG_CPU_ACCOUNTING
+#define TRACE_CPU_ACCOUNTING_SWITCHED_IN() cpuAccountingTaskSwitchedIn(pxCurrentTCB)
+#else
+#define TRACE_CPU_ACCOUNTING_SWITCHED_IN()
+#endif
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE
+#define TRACE_EVENT_SWITCHED_IN() eventTraceRecord(EVENT_TRACE_TASK_SWITCH, pxCurrentTCB->uxTCBNumber, 0)
+#else
+#define TRACE_EVENT_SWITCHED_IN()
+#endif
+
+#define traceTASK_SWITCHED_IN() do { TRACE_CPU_ACCOUNTING_SWITCHED_IN(); TRACE_EVENT_SWITCHED_IN(); } while (0)
+#else
 // Send 4 first characters of task name to ITM port 1
 #define traceTASK_SWITCHED_IN() ITM_SEND(1, *((uint32_t*)pxCurrentTCB->pcTaskName))
+#endif
+
+#ifdef CONFIG_QUEUE_STATS
+// Statistics for the registered queues, see queuestats.h
+#include "queuestats.h"
+#define TRACE_QUEUE_STATS_SEND(xQueue) QUEUE_STATS_TRACE_SEND(((xQUEUE *) xQueue)->uxQueueNumber, ((xQUEUE *) xQueue)->uxMessagesWaiting)
+#define TRACE_QUEUE_STATS_RECEIVE(xQueue) QUEUE_STATS_TRACE_RECEIVE(((xQUEUE *) xQueue)->uxQueueNumber, ((xQUEUE *) xQueue)->uxMessagesWaiting)
+#define TRACE_QUEUE_STATS_SEND_FAILED(xQueue) QUEUE_STATS_TRACE_SEND_FAILED(((xQUEUE *) xQueue)->uxQueueNumber)
+
+#define traceQUEUE_SEND_FROM_ISR(xQueue) TRACE_QUEUE_STATS_SEND(xQueue)
+#define traceQUEUE_SEND_FROM_ISR_FAILED(xQueue) TRACE_QUEUE_STATS_SEND_FAILED(xQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(xQueue) TRACE_QUEUE_STATS_RECEIVE(xQueue)
+#else
+#define TRACE_QUEUE_STATS_SEND(xQueue)
+#define TRACE_QUEUE_STATS_RECEIVE(xQueue)
+#define TRACE_QUEUE_STATS_SEND_FAILED(xQueue)
+#endif
 
+#ifdef CONFIG_DEBUG_EVENT_TRACE
+// Binary event trace, see event_trace.h
+#define traceTASK_CREATE(pxNewTCB) eventTraceTaskCreated((pxNewTCB)->uxTCBNumber, (pxNewTCB)->pcTaskName)
+#define traceQUEUE_SEND(xQueue) do { EVENT_TRACE_QUEUE(EVENT_TRACE_QUEUE_SEND, xQueue); TRACE_QUEUE_STATS_SEND(xQueue); } while (0)
+#define traceQUEUE_SEND_FAILED(xQueue) TRACE_QUEUE_STATS_SEND_FAILED(xQueue)
+#define traceQUEUE_RECEIVE(xQueue) do { EVENT_TRACE_QUEUE(EVENT_TRACE_QUEUE_RECEIVE, xQueue); TRACE_QUEUE_STATS_RECEIVE(xQueue); } while (0)
+#define traceBLOCKING_ON_QUEUE_SEND(xQueue) EVENT_TRACE_QUEUE(EVENT_TRACE_QUEUE_BLOCK_SEND, xQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(xQueue) EVENT_TRACE_QUEUE(EVENT_TRACE_QUEUE_BLOCK_RECEIVE, xQueue)
+#else
 // Systick value on port 2
 #define traceTASK_INCREMENT_TICK(xTickCount) ITM_SEND(2, xTickCount)
 
@@ -49,9 +95,14 @@
 #define ITM_BLOCKING_ON_QUEUE_RECEIVE 0x0300
 #define ITM_BLOCKING_ON_QUEUE_SEND 0x0400
 
-#define traceQUEUE_SEND(xQueue) ITM_SEND(3, ITM_QUEUE_SEND | ((xQUEUE *) xQueue)->uxQueueNumber)
-#define traceQUEUE_SEND_FAILED(xQueue) ITM_SEND(3, ITM_QUEUE_FAILED | ((xQUEUE *) xQueue)->uxQueueNumber)
-#define traceBLOCKING_ON_QUEUE_RECEIVE(xQueue) ITM_SEND(3, ITM_BLOCKING_ON_QUEUE_RECEIVE | ((xQUEUE *) xQueue)->uxQueueNumber)
-#define traceBLOCKING_ON_QUEUE_SEND(xQueue) ITM_SEND(3, ITM_BLOCKING_ON_QUEUE_SEND | ((xQUEUE *) xQueue)->uxQueueNumber)
+// The lower byte of the queue number is the queue monitor id, the upper bits are used by the queue statistics
+#define ITM_QUEUE_NUMBER(xQueue) (((xQUEUE *) xQueue)->uxQueueNumber & 0xff)
+
+#define traceQUEUE_SEND(xQueue) do { ITM_SEND(3, ITM_QUEUE_SEND | ITM_QUEUE_NUMBER(xQueue)); TRACE_QUEUE_STATS_SEND(xQueue); } while (0)
+#define traceQUEUE_SEND_FAILED(xQueue) do { ITM_SEND(3, ITM_QUEUE_FAILED | ITM_QUEUE_NUMBER(xQueue)); TRACE_QUEUE_STATS_SEND_FAILED(xQueue); } while (0)
+#define traceQUEUE_RECEIVE(xQueue) TRACE_QUEUE_STATS_RECEIVE(xQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(xQueue) ITM_SEND(3, ITM_BLOCKING_ON_QUEUE_RECEIVE | ITM_QUEUE_NUMBER(xQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(xQueue) ITM_SEND(3, ITM_BLOCKING_ON_QUEUE_SEND | ITM_QUEUE_NUMBER(xQueue))
+#endif
 
 #endif
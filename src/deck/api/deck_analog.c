@@ -24,13 +24,37 @@
  * deck_analog.c - Arduino-compatible analog input implementation
  */
 
+#include <stdbool.h>
+
 #include "deck.h"
 
 #include "stm32fxxx.h"
+#include "nvicconf.h"
 
 static  uint32_t  stregResolution;
 static  uint32_t  adcRange;
 
+/*
+ * Background scan: ADC1 converts the scanned pins continuously and DMA2 stream 4 writes the results to a circular
+ * buffer. At each half of the buffer the conversions of each pin are averaged and low pass filtered in the DMA
+ * interrupt. ADC2 is left for the single conversions of analogRead().
+ */
+#define ANALOG_SCAN_MAX_PINS      4
+/* Conversions of each pin averaged per update. A conversion takes (480 + 12) / 42 MHz = 11.7 us. */
+#define ANALOG_SCAN_OVERSAMPLING  64
+/* Low pass filter of the averaged values, time constant of about 1 / ANALOG_SCAN_FILTER_ALPHA updates */
+#define ANALOG_SCAN_FILTER_ALPHA  0.1f
+#define ANALOG_SCAN_RANGE         4096.0f
+
+#define ANALOG_SCAN_DMA_STREAM    DMA2_Stream4
+#define ANALOG_SCAN_DMA_CHANNEL   DMA_Channel_0
+
+static uint8_t scanPinIds[ANALOG_SCAN_MAX_PINS];
+static uint8_t scanCount;
+static uint16_t scanBuffer[2 * ANALOG_SCAN_OVERSAMPLING * ANALOG_SCAN_MAX_PINS];
+/* Latest filtered value of each scanned pin, in ADC codes. Written by the DMA interrupt only, 32-bit reads are atomic. */
+static volatile float scanFiltered[ANALOG_SCAN_MAX_PINS];
+
 void adcInit(void)
 {
   /*
@@ -80,11 +104,8 @@ static uint16_t analogReadChannel(uint8_t channel)
   return ADC_GetConversionValue(ADC2);
 }
 
-uint16_t analogRead(const deckPin_t pin)
+static void analogPinInit(const deckPin_t pin)
 {
-  assert_param(deckGPIOMapping[pin.id].adcCh > -1);
-
-  /* Now set the GPIO pin to analog mode. */
 
   /* Enable clock for the peripheral of the pin.*/
   RCC_AHB1PeriphClockCmd(deckGPIOMapping[pin.id].periph, ENABLE);
@@ -101,6 +122,14 @@ uint16_t analogRead(const deckPin_t pin)
 
   /* TODO: Any settling time before we can do ADC after init on the GPIO pin? */
   GPIO_Init(deckGPIOMapping[pin.id].port, &GPIO_InitStructure);
+}
+
+uint16_t analogRead(const deckPin_t pin)
+{
+  assert_param(deckGPIOMapping[pin.id].adcCh > -1);
+
+  /* Now set the GPIO pin to analog mode. */
+  analogPinInit(pin);
 
   /* Read the appropriate ADC channel. */
   return analogReadChannel((uint8_t)deckGPIOMapping[pin.id].adcCh);
@@ -150,3 +179,141 @@ float analogReadVoltage(const deckPin_t pin)
 
   return voltage;
 }
+
+static void analogScanStop(void)
+{
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+
+  ADC_Cmd(ADC1, DISABLE);
+  ADC_DMACmd(ADC1, DISABLE);
+  DMA_ITConfig(ANALOG_SCAN_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, DISABLE);
+  DMA_Cmd(ANALOG_SCAN_DMA_STREAM, DISABLE);
+  while (DMA_GetCmdStatus(ANALOG_SCAN_DMA_STREAM) != DISABLE);
+}
+
+static void analogScanStart(void)
+{
+  ADC_InitTypeDef ADC_InitStructure;
+  DMA_InitTypeDef DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  ADC_StructInit(&ADC_InitStructure);
+  ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
+  ADC_InitStructure.ADC_ScanConvMode = ENABLE;
+  ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
+  ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
+  ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
+  ADC_InitStructure.ADC_NbrOfConversion = scanCount;
+  ADC_Init(ADC1, &ADC_InitStructure);
+
+  for (int i = 0; i < scanCount; i++)
+  {
+    /* The longest sampling time, for high impedance sources such as voltage dividers */
+    ADC_RegularChannelConfig(ADC1, (uint8_t)deckGPIOMapping[scanPinIds[i]].adcCh, i + 1, ADC_SampleTime_480Cycles);
+  }
+
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel = ANALOG_SCAN_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC1->DR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)scanBuffer;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize = 2 * ANALOG_SCAN_OVERSAMPLING * scanCount;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+  DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+  DMA_Init(ANALOG_SCAN_DMA_STREAM, &DMA_InitStructure);
+  DMA_ClearITPendingBit(ANALOG_SCAN_DMA_STREAM, DMA_IT_HTIF4 | DMA_IT_TCIF4);
+  DMA_ITConfig(ANALOG_SCAN_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream4_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_ADC_PRI;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  DMA_Cmd(ANALOG_SCAN_DMA_STREAM, ENABLE);
+
+  ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
+  ADC_DMACmd(ADC1, ENABLE);
+  ADC_Cmd(ADC1, ENABLE);
+  ADC_SoftwareStartConv(ADC1);
+}
+
+bool analogScanEnable(const deckPin_t pin)
+{
+  assert_param(deckGPIOMapping[pin.id].adcCh > -1);
+
+  for (int i = 0; i < scanCount; i++)
+  {
+    if (scanPinIds[i] == pin.id)
+    {
+      return true;
+    }
+  }
+
+  if (scanCount >= ANALOG_SCAN_MAX_PINS)
+  {
+    return false;
+  }
+
+  analogPinInit(pin);
+
+  /* Stop a running scan before changing the sequence */
+  analogScanStop();
+  scanPinIds[scanCount] = pin.id;
+  /* Start from a single conversion until the first update from the scan */
+  scanFiltered[scanCount] = analogReadVoltage(pin) * ANALOG_SCAN_RANGE / VREF;
+  scanCount++;
+
+  analogScanStart();
+
+  return true;
+}
+
+float analogScanReadVoltage(const deckPin_t pin)
+{
+  for (int i = 0; i < scanCount; i++)
+  {
+    if (scanPinIds[i] == pin.id)
+    {
+      return scanFiltered[i] * VREF / ANALOG_SCAN_RANGE;
+    }
+  }
+
+  return analogReadVoltage(pin);
+}
+
+static void analogScanUpdate(const uint16_t* samples)
+{
+  for (int i = 0; i < scanCount; i++)
+  {
+    uint32_t sum = 0;
+    for (int n = 0; n < ANALOG_SCAN_OVERSAMPLING; n++)
+    {
+      sum += samples[n * scanCount + i];
+    }
+
+    const float average = (float)sum / ANALOG_SCAN_OVERSAMPLING;
+    scanFiltered[i] += ANALOG_SCAN_FILTER_ALPHA * (average - scanFiltered[i]);
+  }
+}
+
+void __attribute__((used)) DMA2_Stream4_IRQHandler(void)
+{
+  if (DMA_GetITStatus(ANALOG_SCAN_DMA_STREAM, DMA_IT_HTIF4))
+  {
+    DMA_ClearITPendingBit(ANALOG_SCAN_DMA_STREAM, DMA_IT_HTIF4);
+    analogScanUpdate(&scanBuffer[0]);
+  }
+
+  if (DMA_GetITStatus(ANALOG_SCAN_DMA_STREAM, DMA_IT_TCIF4))
+  {
+    DMA_ClearITPendingBit(ANALOG_SCAN_DMA_STREAM, DMA_IT_TCIF4);
+    analogScanUpdate(&scanBuffer[ANALOG_SCAN_OVERSAMPLING * scanCount]);
+  }
+}
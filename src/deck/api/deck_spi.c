@@ -32,10 +32,14 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 
 #include "cfassert.h"
 #include "config.h"
 #include "nvicconf.h"
+#include "usec_time.h"
+#include "statsCnt.h"
+#include "log.h"
 
 #define SPI                     SPI1
 #define SPI_CLK                 RCC_APB2Periph_SPI1
@@ -87,6 +91,17 @@ static SemaphoreHandle_t txComplete;
 static SemaphoreHandle_t rxComplete;
 static SemaphoreHandle_t spiMutex;
 
+// Number of tasks waiting for the bus, per priority
+static volatile uint8_t waitingCount[spiPriorityCount];
+
+static spiUser_t transactionUser;
+static uint32_t transactionStart;
+
+// Time the bus is held per user [us/s]
+static statsCntRateLogger_t busTime[spiUserCount];
+// Time high priority transactions wait for the bus [us]
+static statsCntMinMaxAvg_t highPriorityWait;
+
 static void spiDMAInit();
 static void spiConfigureWithSpeed(uint16_t baudRatePrescaler);
 
@@ -95,12 +110,22 @@ void spiBegin(void)
 {
   GPIO_InitTypeDef GPIO_InitStructure;
 
+  // Called by each deck driver that uses the bus
+  if (isInit) {
+    return;
+  }
+
   // binary semaphores created using xSemaphoreCreateBinary() are created in a state
   // such that the semaphore must first be 'given' before it can be 'taken'
   txComplete = xSemaphoreCreateBinary();
   rxComplete = xSemaphoreCreateBinary();
   spiMutex = xSemaphoreCreateMutex();
 
+  for (int i = 0; i < spiUserCount; i++) {
+    STATS_CNT_RATE_INIT(&busTime[i], 1000);
+  }
+  statsCntMinMaxAvgInit(&highPriorityWait, 1000);
+
   /*!< Enable the SPI clock */
   SPI_CLK_INIT(SPI_CLK, ENABLE);
 
@@ -261,14 +286,61 @@ bool spiExchange(size_t length, const uint8_t * data_tx, uint8_t * data_rx)
   return result;
 }
 
+static bool isHigherPriorityWaiting(const spiPriority_t priority)
+{
+  for (int p = priority + 1; p < spiPriorityCount; p++) {
+    if (waitingCount[p] > 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void spiBeginTransaction(uint16_t baudRatePrescaler)
 {
+  spiBeginTransactionWithPriority(baudRatePrescaler, spiPriorityNormal, spiUserOther);
+}
+
+void spiBeginTransactionWithPriority(uint16_t baudRatePrescaler, spiPriority_t priority, spiUser_t user)
+{
+  ASSERT(priority < spiPriorityCount);
+  ASSERT(user < spiUserCount);
+
+  const uint32_t waitStart = usecTimestamp();
+
+  taskENTER_CRITICAL();
+  waitingCount[priority]++;
+  taskEXIT_CRITICAL();
+
   xSemaphoreTake(spiMutex, portMAX_DELAY);
+  while (isHigherPriorityWaiting(priority)) {
+    // The mutex is not handed over to a waiting task with a lower task
+    // priority if we take it again right away, block for a while instead
+    xSemaphoreGive(spiMutex);
+    vTaskDelay(1);
+    xSemaphoreTake(spiMutex, portMAX_DELAY);
+  }
+
+  taskENTER_CRITICAL();
+  waitingCount[priority]--;
+  taskEXIT_CRITICAL();
+
+  transactionStart = usecTimestamp();
+  transactionUser = user;
+  if (priority == spiPriorityHigh) {
+    statsCntMinMaxAvgAdd(&highPriorityWait, transactionStart - waitStart);
+  }
+
   spiConfigureWithSpeed(baudRatePrescaler);
 }
 
 void spiEndTransaction()
 {
+  const uint32_t now = usecTimestamp();
+  STATS_CNT_RATE_MULTI_EVENT(&busTime[transactionUser], now - transactionStart);
+  statsCntMinMaxAvgUpdate(&highPriorityWait, now / 1000);
+
   xSemaphoreGive(spiMutex);
 }
 
@@ -323,3 +395,29 @@ void __attribute__((used)) SPI_RX_DMA_IRQHandler(void)
     portYIELD();
   }
 }
+
+/**
+ * Usage of the deck SPI bus
+ */
+LOG_GROUP_START(spiBus)
+/**
+ * @brief Time the bus is held by the loco deck [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(locoUs, &busTime[spiUserLoco])
+/**
+ * @brief Time the bus is held by the flow deck [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(flowUs, &busTime[spiUserFlow])
+/**
+ * @brief Time the bus is held by the uSD card deck [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(usdUs, &busTime[spiUserUsd])
+/**
+ * @brief Time the bus is held by other users [us/s]
+ */
+STATS_CNT_RATE_LOG_ADD(otherUs, &busTime[spiUserOther])
+/**
+ * @brief Time high priority transactions wait for the bus [us]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(hiWait, &highPriorityWait)
+LOG_GROUP_STOP(spiBus)
@@ -31,6 +31,7 @@
 #include "deck.h"
 #include "deck_memory.h"
 #include "debug.h"
+#include "boot_timeline.h"
 
 #ifdef CONFIG_DEBUG
   #define DECK_CORE_DBG_PRINT(fmt, ...)  DEBUG_PRINT(fmt, ## __VA_ARGS__)
@@ -64,6 +65,7 @@ void deckInit()
       }
 
       deck->driver->init(deck);
+      bootTimelineMark(deck->driver->name ? deck->driver->name : "deck");
     }
   }
 }
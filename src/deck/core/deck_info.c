@@ -36,9 +36,17 @@
 #include "crc32.h"
 #include "debug.h"
 #include "static_mem.h"
+#include "boot_timeline.h"
 
 #include "autoconf.h"
 
+#ifdef CONFIG_DECK_INFO_CACHE
+#include "mem.h"
+#include "storage.h"
+#include "usec_time.h"
+#include "worker.h"
+#endif
+
 #ifdef CONFIG_DEBUG
   #define DECK_INFO_DBG_PRINT(fmt, ...)  DEBUG_PRINT(fmt, ## __VA_ARGS__)
 #else
@@ -58,6 +66,24 @@ static bool requiredLowInterferenceRadioMode = false;
 
 static char* deck_force = CONFIG_DECK_FORCE;
 
+#if defined(CONFIG_DECK_INFO_CACHE) && !defined(CONFIG_DEBUG_DECK_IGNORE_OWS)
+#define DECK_INFO_CACHE_KEY "sys/deckInfo"
+// The deck memories of the previous boot, used as long as the same decks are
+// mounted. Only the serial numbers are read from the decks in that case.
+typedef struct {
+  uint8_t nDecks;
+  // Time it took to read the deck memories [us]
+  uint32_t readTime;
+  OwSerialNum serialNr[DECK_MAX_COUNT];
+  uint8_t raw[DECK_MAX_COUNT][sizeof(deckInfos[0].raw)];
+} __attribute__((packed)) deckInfoCache_t;
+NO_DMA_CCM_SAFE_ZERO_INIT static deckInfoCache_t deckInfoCache;
+
+static bool deckInfoCacheLoad(const uint8_t nDecks);
+static void deckInfoCacheSave(const uint8_t nDecks, const uint32_t readTime);
+static void deckInfoCacheVerifyWorker(void *arg);
+#endif
+
 void deckInfoInit()
 {
   static bool isInit = false;
@@ -186,10 +212,17 @@ static void enumerateDecks(void)
   }
 
 #ifndef CONFIG_DEBUG_DECK_IGNORE_OWS
+#ifdef CONFIG_DECK_INFO_CACHE
+  const bool isFromCache = deckInfoCacheLoad(nDecks);
+  const uint32_t readStart = usecTimestamp();
+#else
+  const bool isFromCache = false;
+#endif
+
   for (int i = 0; i < nDecks; i++)
   {
     DECK_INFO_DBG_PRINT("Enumerating deck %i\n", i);
-    if (owRead(i, 0, sizeof(deckInfos[0].raw), (uint8_t *)&deckInfos[i]))
+    if (isFromCache || owRead(i, 0, sizeof(deckInfos[0].raw), (uint8_t *)&deckInfos[i]))
     {
       if (infoDecode(&deckInfos[i]))
       {
@@ -214,6 +247,22 @@ static void enumerateDecks(void)
       noError = false;
     }
   }
+
+#ifdef CONFIG_DECK_INFO_CACHE
+  if (isFromCache) {
+    bootTimelineMark("deckInfoFromCache");
+    DEBUG_PRINT("Deck memories from cache, saved %lu ms\n", (unsigned long)(deckInfoCache.readTime / 1000));
+
+    // The decks could have been re-programmed with the same serial numbers
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .coalesce = true};
+    workerScheduleWithOptions(deckInfoCacheVerifyWorker, NULL, &options);
+  } else if (nDecks > 0) {
+    bootTimelineMark("deckInfoRead");
+    if (noError) {
+      deckInfoCacheSave(nDecks, usecTimestamp() - readStart);
+    }
+  }
+#endif
 #else
   DEBUG_PRINT("Ignoring all OW decks because of compile flag.\n");
   nDecks = 0;
@@ -256,6 +305,95 @@ static void enumerateDecks(void)
   return;
 }
 
+#if defined(CONFIG_DECK_INFO_CACHE) && !defined(CONFIG_DEBUG_DECK_IGNORE_OWS)
+/**
+ * Use the deck memories of the previous boot if the serial numbers of the
+ * mounted decks are the same.
+ */
+static bool deckInfoCacheLoad(const uint8_t nDecks)
+{
+  OwSerialNum serialNr[DECK_MAX_COUNT];
+
+  if (nDecks == 0 || nDecks > DECK_MAX_COUNT) {
+    return false;
+  }
+
+  memset(serialNr, 0, sizeof(serialNr));
+  for (int i = 0; i < nDecks; i++) {
+    if (!memGetOwSerialNr(i, serialNr[i].data)) {
+      return false;
+    }
+  }
+  bootTimelineMark("deckSerialNrScan");
+
+  const bool isCached = storageFetch(DECK_INFO_CACHE_KEY, &deckInfoCache, sizeof(deckInfoCache)) == sizeof(deckInfoCache) &&
+    deckInfoCache.nDecks == nDecks &&
+    memcmp(deckInfoCache.serialNr, serialNr, sizeof(serialNr)) == 0;
+
+  if (!isCached) {
+    // Kept for deckInfoCacheSave()
+    memcpy(deckInfoCache.serialNr, serialNr, sizeof(serialNr));
+    DECK_INFO_DBG_PRINT("Mounted decks have changed, reading deck memories\n");
+    return false;
+  }
+
+  for (int i = 0; i < nDecks; i++) {
+    memcpy(deckInfos[i].raw, deckInfoCache.raw[i], sizeof(deckInfos[i].raw));
+  }
+
+  return true;
+}
+
+static void deckInfoCacheStoreWorker(void *arg)
+{
+  storageStore(DECK_INFO_CACHE_KEY, &deckInfoCache, sizeof(deckInfoCache));
+}
+
+static void deckInfoCacheSave(const uint8_t nDecks, const uint32_t readTime)
+{
+  if (nDecks > DECK_MAX_COUNT) {
+    return;
+  }
+
+  deckInfoCache.nDecks = nDecks;
+  deckInfoCache.readTime = readTime;
+  memset(deckInfoCache.raw, 0, sizeof(deckInfoCache.raw));
+  for (int i = 0; i < nDecks; i++) {
+    memcpy(deckInfoCache.raw[i], deckInfos[i].raw, sizeof(deckInfos[i].raw));
+  }
+
+  // Writing to the EEPROM is done after the boot, not to delay it
+  const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .coalesce = true};
+  workerScheduleWithOptions(deckInfoCacheStoreWorker, NULL, &options);
+}
+
+/**
+ * Read the deck memories in the background after a boot from the cache. A
+ * change is stored and used at the next boot.
+ */
+static void deckInfoCacheVerifyWorker(void *arg)
+{
+  static uint8_t raw[sizeof(deckInfos[0].raw)];
+  bool isChanged = false;
+
+  for (int i = 0; i < deckInfoCache.nDecks; i++) {
+    if (!owRead(i, 0, sizeof(raw), raw)) {
+      return;
+    }
+
+    if (memcmp(raw, deckInfoCache.raw[i], sizeof(raw)) != 0) {
+      memcpy(deckInfoCache.raw[i], raw, sizeof(raw));
+      isChanged = true;
+    }
+  }
+
+  if (isChanged) {
+    DEBUG_PRINT("Deck memory has changed, used at next boot\n");
+    deckInfoCacheStoreWorker(NULL);
+  }
+}
+#endif
+
 static void checkPeriphAndGpioConflicts(void)
 {
   bool noError = true;
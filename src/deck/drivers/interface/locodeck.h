@@ -95,6 +95,11 @@ typedef struct uwbAlgorithm_s {
   bool (*getAnchorPosition)(const uint8_t anchorId, point_t* position);
   uint8_t (*getAnchorIdList)(uint8_t unorderedAnchorList[], const int maxListSize);
   uint8_t (*getActiveAnchorIdList)(uint8_t unorderedAnchorList[], const int maxListSize);
+  // Set the position of an anchor from the anchor table, the position is only used if the algorithm does not have
+  // a valid position from the anchor itself
+  void (*setDefaultAnchorPosition)(const uint8_t anchorId, const point_t* position);
+  // Optional, write a table with link statistics for all anchors to the buffer and return the length
+  size_t (*getLinkStatsTable)(uint8_t* buffer, const size_t bufferSize);
 } uwbAlgorithm_t;
 
 #include <FreeRTOS.h>
@@ -118,6 +123,9 @@ typedef struct {
 bool lpsGetLppShort(lpsLppShortPacket_t* shortPacket);
 
 uint16_t locoDeckGetRangingState();
+// Time (in micro seconds) of the latest interrupt from the DW1000, captured in the ISR.
+// Use as the event time of a received packet instead of the time it is processed.
+uint64_t locoDeckGetIrqTimestampUs();
 void locoDeckSetRangingState(const uint16_t newState);
 
 // LPP Packet types and format
@@ -0,0 +1,140 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsAnchorTable.h: Compact table of anchor positions, for bulk upload and persistent storage
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stabilizer_types.h"
+#include "autoconf.h"
+
+#ifdef CONFIG_DECK_LOCO_ANCHOR_TABLE_SIZE
+#define LPS_ANCHOR_TABLE_MAX_ANCHORS CONFIG_DECK_LOCO_ANCHOR_TABLE_SIZE
+#else
+#define LPS_ANCHOR_TABLE_MAX_ANCHORS 32
+#endif
+
+#if LPS_ANCHOR_TABLE_MAX_ANCHORS > 255
+  #error "Too large anchor table"
+#endif
+
+#define LPS_ANCHOR_TABLE_FORMAT_VERSION 1
+
+/**
+ * The serialized format of the table, used in the memory map and in the persistent storage:
+ * a header followed by anchorCount entries, sorted by anchor id. The CRC is the zlib compatible CRC32 of the entries,
+ * since the entries are sorted it only depends on the content of the table and clients can compare it to the CRC of
+ * their own table to find out if an upload is needed.
+ */
+typedef struct {
+  uint8_t formatVersion;
+  uint8_t anchorCount;
+  uint16_t reserved;
+  uint32_t crc;
+} __attribute__((packed)) lpsAnchorTableHeader_t;
+
+typedef struct {
+  uint8_t id;
+  float x;
+  float y;
+  float z;
+} __attribute__((packed)) lpsAnchorTableEntry_t;
+
+#define LPS_ANCHOR_TABLE_SERIALIZED_SIZE(count) (sizeof(lpsAnchorTableHeader_t) + (count) * sizeof(lpsAnchorTableEntry_t))
+#define LPS_ANCHOR_TABLE_MAX_SERIALIZED_SIZE LPS_ANCHOR_TABLE_SERIALIZED_SIZE(LPS_ANCHOR_TABLE_MAX_ANCHORS)
+
+typedef struct {
+  // Sorted by id
+  lpsAnchorTableEntry_t entries[LPS_ANCHOR_TABLE_MAX_ANCHORS];
+  uint8_t count;
+} lpsAnchorTable_t;
+
+/**
+ * @brief Initialize an empty table
+ *
+ * @param this The table
+ */
+void lpsAnchorTableInit(lpsAnchorTable_t* this);
+
+/**
+ * @brief Set the position of an anchor, the anchor is added if it is not in the table
+ *
+ * @param this The table
+ * @param id The anchor id
+ * @param position The position of the anchor, the timestamp is not used
+ * @return true if the position was set, false if the anchor is new and the table is full
+ */
+bool lpsAnchorTableSet(lpsAnchorTable_t* this, const uint8_t id, const point_t* position);
+
+/**
+ * @brief Get the position of an anchor
+ *
+ * @param this The table
+ * @param id The anchor id
+ * @param position Set to the position of the anchor, if found. The timestamp is not touched.
+ * @return true if the anchor is in the table
+ */
+bool lpsAnchorTableGet(const lpsAnchorTable_t* this, const uint8_t id, point_t* position);
+
+/**
+ * @brief The CRC of the table, the same as in the header of the serialized table
+ *
+ * @param this The table
+ * @return uint32_t The CRC
+ */
+uint32_t lpsAnchorTableCrc(const lpsAnchorTable_t* this);
+
+/**
+ * @brief Serialize the table
+ *
+ * @param this The table
+ * @param buffer The destination
+ * @param bufferSize The size of the destination
+ * @return size_t The number of bytes written, 0 if the buffer is too small
+ */
+size_t lpsAnchorTableSerialize(const lpsAnchorTable_t* this, uint8_t* buffer, const size_t bufferSize);
+
+/**
+ * @brief Get the total size of a serialized table from its header
+ *
+ * @param buffer The start of the serialized table
+ * @param length The number of bytes available in the buffer
+ * @return size_t The size of the serialized table, 0 if the buffer does not contain a full header
+ */
+size_t lpsAnchorTableSerializedSize(const uint8_t* buffer, const size_t length);
+
+/**
+ * @brief Deserialize a table. The data is validated (format version, size, CRC and order of the ids) and the
+ * table is only modified if it is valid.
+ *
+ * @param this The table
+ * @param buffer The serialized table
+ * @param length The length of the serialized table
+ * @return true if the data was valid and the table was updated
+ */
+bool lpsAnchorTableDeserialize(lpsAnchorTable_t* this, const uint8_t* buffer, const size_t length);
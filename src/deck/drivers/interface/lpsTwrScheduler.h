@@ -0,0 +1,125 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsTwrScheduler.h: Selects which anchor to range next in TWR
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stabilizer_types.h"
+
+#define LPS_TWR_SCHEDULER_MAX_ANCHORS 8
+
+// An anchor that has not been ranged for this long is ranged next, regardless of its expected information gain.
+// This makes sure anchor positions (sent in LPP packets) are picked up and that TDMA stays synchronized.
+#define LPS_TWR_SCHEDULER_MAX_AGE_MS 500
+
+// Time an anchor is left out after repeated failures, doubled for each failed probe
+#define LPS_TWR_SCHEDULER_SUSPEND_MIN_MS 1000
+#define LPS_TWR_SCHEDULER_SUSPEND_MAX_MS 8000
+
+// Std dev of a TWR distance measurement [m]
+#define LPS_TWR_SCHEDULER_MEASUREMENT_STD_DEV 0.25f
+
+typedef enum {
+  lpsTwrSchedulerModeRoundRobin = 0,
+  lpsTwrSchedulerModeAdaptive = 1,
+} lpsTwrSchedulerMode_t;
+
+typedef struct {
+  uint32_t lastAttemptMs;
+  uint32_t suspendedUntilMs;
+  uint16_t suspendTimeMs;
+  uint8_t consecutiveFailures;
+  bool isSuspended;
+} lpsTwrSchedulerAnchor_t;
+
+typedef struct {
+  lpsTwrSchedulerAnchor_t anchors[LPS_TWR_SCHEDULER_MAX_ANCHORS];
+  uint8_t anchorCount;
+  uint8_t failureThreshold;
+
+  uint8_t current;
+  uint8_t burstSize;
+  uint8_t burstRemaining;
+} lpsTwrScheduler_t;
+
+/**
+ * @brief Initialize the scheduler
+ *
+ * @param this The scheduler
+ * @param anchorCount The number of anchors, max LPS_TWR_SCHEDULER_MAX_ANCHORS
+ * @param failureThreshold Number of consecutive failed rangings before an anchor is suspended
+ */
+void lpsTwrSchedulerInit(lpsTwrScheduler_t* this, const uint8_t anchorCount, const uint8_t failureThreshold);
+
+/**
+ * @brief Set the number of consecutive rangings done with an anchor every time it is selected
+ *
+ * @param this The scheduler
+ * @param burstSize The burst size, values lower than 1 are treated as 1
+ */
+void lpsTwrSchedulerSetBurstSize(lpsTwrScheduler_t* this, const uint8_t burstSize);
+
+/**
+ * @brief Report the result of a ranging attempt
+ *
+ * @param this The scheduler
+ * @param anchor The anchor that was ranged
+ * @param success True if a distance was measured
+ * @param nowMs The current time
+ */
+void lpsTwrSchedulerReportResult(lpsTwrScheduler_t* this, const uint8_t anchor, const bool success, const uint32_t nowMs);
+
+/**
+ * @brief Select the anchor to range next
+ *
+ * In round robin mode the anchors are ranged one by one, skipping suspended anchors.
+ *
+ * In adaptive mode anchors that have not been ranged for LPS_TWR_SCHEDULER_MAX_AGE_MS are selected first (oldest
+ * first). Otherwise the anchor with the largest expected information gain is selected, that is the anchor for which the
+ * position uncertainty along the line of sight is the largest. If the tag position, the covariance or all anchor
+ * positions are unknown, round robin is used.
+ *
+ * @param this The scheduler
+ * @param mode The scheduling mode
+ * @param tagPos The estimated position of the tag, may be 0
+ * @param posCov The covariance of the estimated position, may be 0
+ * @param anchorPositions Positions of the anchors
+ * @param positionValidMask Bit field where a set bit indicates that the position of the anchor is valid
+ * @param nowMs The current time
+ * @return uint8_t The anchor to range
+ */
+uint8_t lpsTwrSchedulerNext(lpsTwrScheduler_t* this, const lpsTwrSchedulerMode_t mode, const point_t* tagPos, const float posCov[3][3], const point_t anchorPositions[], const uint32_t positionValidMask, const uint32_t nowMs);
+
+/**
+ * @brief Check if an anchor is suspended due to repeated failures
+ *
+ * @param this The scheduler
+ * @param anchor The anchor
+ * @return true if suspended
+ */
+bool lpsTwrSchedulerIsSuspended(const lpsTwrScheduler_t* this, const uint8_t anchor);
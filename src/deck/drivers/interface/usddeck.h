@@ -23,10 +23,11 @@ int usddeckFrequency(void);
 // For synchronous logging: add a new log entry
 void usddeckTriggerLogging(void);
 
-// returns size of current file if logging is stopped (0 otherwise)
+// returns size of the file to download if logging is stopped (0 otherwise)
+// This is the latest log file unless another file is selected through MEM_TYPE_USD_DIR
 uint32_t usddeckFileSize(void);
 
-// Read "length" number of bytes at "offset" into "buffer" of current file
+// Read "length" number of bytes at "offset" into "buffer" of the file to download
 // Only works if logging is stopped
 bool usddeckRead(uint32_t offset, uint8_t* buffer, uint16_t length);
 
@@ -25,6 +25,8 @@
  * activeMarkerDeck.c - Deck driver for the Active marker deck
  */
 
+#include <string.h>
+
 #include "stm32fxxx.h"
 #include "FreeRTOS.h"
 #include "task.h"
@@ -35,6 +37,8 @@
 #include "param.h"
 #include "eventtrigger.h"
 #include "i2cdev.h"
+#include "mem.h"
+#include "radiolink.h"
 
 #define DEBUG_MODULE "ACTIVE_MARKER"
 #include "debug.h"
@@ -56,6 +60,21 @@ static bool isVerified = false;
 static uint8_t currentId[LED_COUNT] = {0xff, 0xff, 0xff, 0xff};
 static uint8_t requestedId[LED_COUNT] = {1, 3, 4, 2}; // 1 to 4, clockwise
 
+// ID pattern, the IDs of all LEDs step through the pattern in sync with the swarm time base. The pattern is written
+// through MEM_TYPE_ACTIVE_MARKER, see docs/functional-areas/memory-subsystem/MEM_TYPE_ACTIVE_MARKER.md
+#define PATTERN_MAX_STEPS 16
+#define PATTERN_MIN_STEP_MS 10
+
+typedef struct {
+  uint8_t length;
+  uint8_t ids[PATTERN_MAX_STEPS][LED_COUNT];
+} __attribute__((packed)) idPattern_t;
+
+static idPattern_t pattern;
+static uint16_t patternStepMs = 0;
+static uint8_t patternStep;
+static uint32_t idWriteCount;
+
 #define MODE_OFF 0
 #define MODE_PWM 1
 #define MODE_MODULATED 2
@@ -95,6 +114,41 @@ static char versionString[VERSION_STRING_LEN + 1];
 
 static void task(void* param);
 
+static uint32_t handleMemGetSize(void) {
+  return sizeof(pattern);
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > sizeof(pattern)) {
+    return false;
+  }
+
+  memcpy(buffer, ((const uint8_t*)&pattern) + memAddr, readLen);
+  return true;
+}
+
+// The task reads the pattern while it is written, a client stops the pattern by writing 0 to the length before
+// writing the IDs and writes the length last
+static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer) {
+  if (memAddr + writeLen > sizeof(pattern)) {
+    return false;
+  }
+
+  if (memAddr == 0 && writeLen > 0 && buffer[0] > PATTERN_MAX_STEPS) {
+    return false;
+  }
+
+  memcpy(((uint8_t*)&pattern) + memAddr, buffer, writeLen);
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_ACTIVE_MARKER,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = handleMemWrite,
+};
+
 static void activeMarkerDeckInit(DeckInfo *info) {
   if (isInit) {
     return;
@@ -103,6 +157,8 @@ static void activeMarkerDeckInit(DeckInfo *info) {
   xTaskCreate(task, ACTIVE_MARKER_TASK_NAME,
               ACTIVEMARKER_TASK_STACKSIZE, NULL, ACTIVE_MARKER_TASK_PRI, NULL);
 
+  memoryRegisterHandler(&memDef);
+
 #ifndef ACTIVE_MARKER_DECK_TEST
   memset(versionString, 0, VERSION_STRING_LEN + 1);
   i2cOk = i2cdevReadReg8(I2C1_DEV, DECK_I2C_ADDRESS, MEM_ADR_VER, VERSION_STRING_LEN, (uint8_t*)versionString);
@@ -136,17 +192,35 @@ static bool activeMarkerDeckTest() {
   return isVerified;
 }
 
-static void handleIdUpdate() {
+static bool isPatternActive() {
+  return patternStepMs > 0 && pattern.length > 0 && currentDeckMode == MODE_QUALISYS;
+}
+
+// Selects the IDs of the current step of the pattern and returns the time to the next step [ms]. All drones with the
+// same time base and step length change IDs at the same time.
+static uint32_t handlePatternStep(const uint8_t** ids) {
+  const uint32_t stepMs = patternStepMs > PATTERN_MIN_STEP_MS ? patternStepMs : PATTERN_MIN_STEP_MS;
+  const uint64_t nowMs = radiolinkP2PSharedTimeUs() / 1000;
+
+  patternStep = (nowMs / stepMs) % pattern.length;
+  *ids = pattern.ids[patternStep];
+
+  return stepMs - (nowMs % stepMs);
+}
+
+// One I2C write for all LEDs, only when an ID has changed
+static void handleIdUpdate(const uint8_t* ids) {
   bool isDifferent = false;
   for (int led = 0; led < LED_COUNT; led++) {
-    if (currentId[led] != requestedId[led]) {
+    if (currentId[led] != ids[led]) {
       isDifferent = true;
-      currentId[led] = requestedId[led];
+      currentId[led] = ids[led];
     }
   }
 
   if (isDifferent) {
       i2cdevWriteReg8(I2C1_DEV, DECK_I2C_ADDRESS, MEM_ADR_LED, LED_COUNT, currentId);
+      idWriteCount++;
   }
 }
 
@@ -181,8 +255,20 @@ static void task(void *param) {
 #endif
 
   while (1) {
+    uint32_t delay = DEFAULT_UPDATE_PERIOD_MS;
+    if (doPollDeckButtonSensor) {
+      delay = POLL_UPDATE_PERIOD_MS;
+    }
+
     if (isVerified) {
-      handleIdUpdate();
+      const uint8_t* ids = requestedId;
+      if (isPatternActive()) {
+        const uint32_t timeToStepMs = handlePatternStep(&ids);
+        if (timeToStepMs < delay) {
+          delay = timeToStepMs;
+        }
+      }
+      handleIdUpdate(ids);
 
       if (deckFwVersion >= version_1_0) {
         handleModeUpdate();
@@ -190,11 +276,6 @@ static void task(void *param) {
       }
     }
 
-    int delay = DEFAULT_UPDATE_PERIOD_MS;
-    if (doPollDeckButtonSensor) {
-      delay = POLL_UPDATE_PERIOD_MS;
-    }
-
     vTaskDelay(M2T(delay));
   }
 
@@ -290,6 +371,18 @@ PARAM_ADD_CORE(PARAM_UINT8 | PARAM_PERSISTENT, right, &requestedId[3])
  */
 PARAM_ADD_CORE(PARAM_UINT8 | PARAM_PERSISTENT, mode, &requestedDeckMode)
 
+/**
+ * @brief Length of each step of the ID pattern [ms], 0 to use the fixed IDs (default: 0)
+ *
+ * In Qualisys mode the IDs of the LEDs can step through a pattern written
+ * to the MEM_TYPE_ACTIVE_MARKER memory. The steps follow the swarm time
+ * broadcasted by the client in the localization service SWARM_TIME
+ * packets, drones with the same step length change IDs at the same time
+ * and can share IDs in different steps. Until the swarm time is
+ * synchronized the local clock is used. The shortest step is 10 ms.
+ */
+PARAM_ADD(PARAM_UINT16, stepMs, &patternStepMs)
+
 PARAM_ADD(PARAM_UINT8, poll, &doPollDeckButtonSensor)
 
 #ifdef ACTIVE_MARKER_DECK_TEST
@@ -315,4 +408,12 @@ PARAM_GROUP_STOP(deck)
 LOG_GROUP_START(activeMarker)
 LOG_ADD(LOG_UINT8, btSns, &deckButtonSensorValue)
 LOG_ADD(LOG_UINT8, i2cOk, &i2cOk)
+/**
+ * @brief Current step of the ID pattern
+ */
+LOG_ADD(LOG_UINT8, patStep, &patternStep)
+/**
+ * @brief Number of I2C writes of the LED IDs
+ */
+LOG_ADD(LOG_UINT32, idWrites, &idWriteCount)
 LOG_GROUP_STOP(activeMarker)
@@ -347,9 +347,19 @@ static bool aideckTest()
   return true;
 }
 
+static bool espDeckFlasherReadIfInBootloader(const uint32_t memAddr, const uint8_t readLen, uint8_t *buffer)
+{
+  // The UART is used by CPX when the ESP is not in bootloader mode
+  if (ESP_MODE_BOOTLOADER != espMode) {
+    return false;
+  }
+
+  return espDeckFlasherRead(memAddr, readLen, buffer);
+}
+
 static const DeckMemDef_t espMemoryDef = {
     .write = espDeckFlasherWrite,
-    .read = 0,
+    .read = espDeckFlasherReadIfInBootloader,
     .properties = espDeckFlasherPropertiesQuery,
     .supportsUpgrade = true,
     .id = "esp",
@@ -23,6 +23,9 @@
 /* flowdeck_v1v2.c: Flow deck driver */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
+
+#include "stm32fxxx.h"
 
 #include "deck.h"
 #include "debug.h"
@@ -30,6 +33,7 @@
 #include "log.h"
 #include "param.h"
 #include "pmw3901.h"
+#include "range.h"
 #include "sleepus.h"
 
 #include "stabilizer_types.h"
@@ -39,6 +43,9 @@
 #include "cf_math.h"
 
 #include "usec_time.h"
+#include "statsCnt.h"
+#include "rateSupervisor.h"
+#include "autoconf.h"
 #include <stdlib.h>
 
 #define AVERAGE_HISTORY_LENGTH 4
@@ -59,6 +66,7 @@ float dpixelx_previous = 0;
 float dpixely_previous = 0;
 
 static uint8_t outlierCount = 0;
+static uint8_t lowQualityCount = 0;
 static float stdFlow = 2.0f;
 
 static bool isInit1 = false;
@@ -76,26 +84,146 @@ static bool useAdaptiveStd = false;
 // (will not work if useAdaptiveStd is on)
 static float flowStdFixed = 2.0f;
 
+// Samples with fewer features or a longer shutter time than this are not used, the defaults let all samples through
+static uint8_t flowMinSqual = 0;
+static uint16_t flowMaxShutter = UINT16_MAX;
+
+// Enqueue the down range measurements together with the flow, the Kalman estimator fuses the two in one update
+static uint8_t pairTof = 1;
+static bool isFlowTaskRunning = false;
+
 #define NCS_PIN DECK_GPIO_IO3
 
+// Read period when the motion pin is not used, the PMW3901 frame rate is around 100 Hz
+#define FLOW_READ_PERIOD_MS 10
+// Max time between reads when the motion pin is used. The sensor does not assert the pin
+// when it does not move, but dt is kept short anyway.
+#define FLOW_MOTION_TIMEOUT_MS 20
+
+#if defined(CONFIG_DECK_FLOW_MOTION_PIN_IO1)
+  #define MOTION_PIN DECK_GPIO_IO1
+  #define MOTION_PIN_USED DECK_USING_IO_1
+  #define MOTION_EXTI_PORT_SOURCE EXTI_PortSourceGPIOB
+  #define MOTION_EXTI_PIN_SOURCE EXTI_PinSource8
+  #define MOTION_EXTI_LINE EXTI_Line8
+  #define MOTION_EXTI_CALLBACK EXTI8_Callback
+#elif defined(CONFIG_DECK_FLOW_MOTION_PIN_IO4)
+  #define MOTION_PIN DECK_GPIO_IO4
+  #define MOTION_PIN_USED DECK_USING_IO_4
+  #define MOTION_EXTI_PORT_SOURCE EXTI_PortSourceGPIOC
+  #define MOTION_EXTI_PIN_SOURCE EXTI_PinSource12
+  #define MOTION_EXTI_LINE EXTI_Line12
+  #define MOTION_EXTI_CALLBACK EXTI12_Callback
+#else
+  #define MOTION_PIN_USED 0
+#endif
+
+static STATS_CNT_RATE_DEFINE(flowReadRate, 1000);
+static rateSupervisorTask_t rateSupervisorTask;
+
+#ifdef MOTION_PIN
+static SemaphoreHandle_t motionSemaphore;
+static StaticSemaphore_t motionSemaphoreBuffer;
+static volatile uint32_t motionTimestamp;
+
+static void flowdeckMotionInterruptInit()
+{
+  pinMode(MOTION_PIN, INPUT);
+
+  motionSemaphore = xSemaphoreCreateBinaryStatic(&motionSemaphoreBuffer);
+
+  SYSCFG_EXTILineConfig(MOTION_EXTI_PORT_SOURCE, MOTION_EXTI_PIN_SOURCE);
+
+  // The motion pin is active low
+  EXTI_InitTypeDef EXTI_InitStructure;
+  EXTI_InitStructure.EXTI_Line = MOTION_EXTI_LINE;
+  EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+  EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
+  EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+  EXTI_Init(&EXTI_InitStructure);
+}
+
+void __attribute__((used)) MOTION_EXTI_CALLBACK(void)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+  motionTimestamp = xTaskGetTickCountFromISR();
+  xSemaphoreGiveFromISR(motionSemaphore, &xHigherPriorityTaskWoken);
+  if (xHigherPriorityTaskWoken) {
+    portYIELD();
+  }
+}
+#endif
+
+/**
+ * Wait until it is time to read the sensor, on the motion interrupt if the pin is
+ * connected, otherwise at the sensor frame rate.
+ *
+ * @return The time of the sample [ms]
+ */
+static uint32_t flowdeckWaitForSample(TickType_t* lastWakeTime)
+{
+#ifdef MOTION_PIN
+  if (xSemaphoreTake(motionSemaphore, M2T(FLOW_MOTION_TIMEOUT_MS)) == pdTRUE) {
+    return motionTimestamp;
+  }
+#else
+  vTaskDelayUntil(lastWakeTime, M2T(FLOW_READ_PERIOD_MS));
+#endif
+
+  return xTaskGetTickCount();
+}
 
 static void flowdeckTask(void *param)
 {
   systemWaitStart();
 
   uint64_t lastTime  = usecTimestamp();
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  // The motion interrupt follows the sensor frame rate, which is less exact than the timed reads
+  rateSupervisorRegisterTask(&rateSupervisorTask, "flowdeck", T2M(lastWakeTime), 1000 / FLOW_READ_PERIOD_MS, MOTION_PIN_USED ? 50 : 2, 1);
   while(1) {
-    vTaskDelay(10);
+    const uint32_t sampleTimestamp = flowdeckWaitForSample(&lastWakeTime);
+    rateSupervisorTaskValidate(&rateSupervisorTask, T2M(xTaskGetTickCount()));
 
+    // Motion, delta x/y, squal and shutter in one burst
     pmw3901ReadMotion(NCS_PIN, &currentMotion);
+    STATS_CNT_RATE_EVENT(&flowReadRate);
 
     // Flip motion information to comply with sensor mounting
     // (might need to be changed if mounted differently)
     int16_t accpx = -currentMotion.deltaY;
     int16_t accpy = -currentMotion.deltaX;
 
-    // Outlier removal
-    if (abs(accpx) < OULIER_LIMIT && abs(accpy) < OULIER_LIMIT) {
+    // The held down range measurement goes right before the flow, see rangeHoldDownRange()
+    tofMeasurement_t tofData;
+    if (rangeTakeDownRange(&tofData)) {
+      estimatorEnqueueTOF(&tofData);
+    }
+
+    // Outlier removal, on the raw sensor values before any floating point work
+    if (abs(accpx) >= OULIER_LIMIT || abs(accpy) >= OULIER_LIMIT) {
+      outlierCount++;
+      continue;
+    }
+
+    // we do want to update dt every measurement and not only in the ones with detected motion,
+    // as we work with instantaneous gyro and velocity values in the update function
+    // (meaning assuming the current measurements over all of dt)
+    const uint64_t now = usecTimestamp();
+    const float dt = (float)(now - lastTime) / 1000000.0f;
+    lastTime = now;
+
+    // Push measurements into the estimator if flow is not disabled
+    //    and the PMW flow sensor indicates motion detection
+    if (useFlowDisabled || currentMotion.motion != 0xB0) {
+      continue;
+    }
+
+    // Too few surface features or a too long shutter time (too dark), the sample is not reliable
+    if (currentMotion.squal < flowMinSqual || currentMotion.shutter > flowMaxShutter) {
+      lowQualityCount++;
+      continue;
+    }
 
     if (useAdaptiveStd)
     {
@@ -113,56 +241,60 @@ static void flowdeckTask(void *param)
       stdFlow = flowStdFixed;
     }
 
-
     // Form flow measurement struct and push into the EKF
     flowMeasurement_t flowData;
+    flowData.timestamp = sampleTimestamp;
     flowData.stdDevX = stdFlow;
     flowData.stdDevY = stdFlow;
-    flowData.dt = (float)(usecTimestamp()-lastTime)/1000000.0f;
-    // we do want to update dt every measurement and not only in the ones with detected motion,
-    // as we work with instantaneous gyro and velocity values in the update function
-    // (meaning assuming the current measurements over all of dt)
-    lastTime = usecTimestamp();
-
-
+    flowData.dt = dt;
 
 #if defined(USE_MA_SMOOTHING)
-      // Use MA Smoothing
-      pixelAverages.averageX[pixelAverages.ptr] = (float32_t)accpx;
-      pixelAverages.averageY[pixelAverages.ptr] = (float32_t)accpy;
+    // Use MA Smoothing
+    pixelAverages.averageX[pixelAverages.ptr] = (float32_t)accpx;
+    pixelAverages.averageY[pixelAverages.ptr] = (float32_t)accpy;
 
-      float32_t meanX;
-      float32_t meanY;
+    float32_t meanX;
+    float32_t meanY;
 
-      arm_mean_f32(pixelAverages.averageX, AVERAGE_HISTORY_LENGTH, &meanX);
-      arm_mean_f32(pixelAverages.averageY, AVERAGE_HISTORY_LENGTH, &meanY);
+    arm_mean_f32(pixelAverages.averageX, AVERAGE_HISTORY_LENGTH, &meanX);
+    arm_mean_f32(pixelAverages.averageY, AVERAGE_HISTORY_LENGTH, &meanY);
 
-      pixelAverages.ptr = (pixelAverages.ptr + 1) % AVERAGE_HISTORY_LENGTH;
+    pixelAverages.ptr = (pixelAverages.ptr + 1) % AVERAGE_HISTORY_LENGTH;
 
-      flowData.dpixelx = (float)meanX;   // [pixels]
-      flowData.dpixely = (float)meanY;   // [pixels]
+    flowData.dpixelx = (float)meanX;   // [pixels]
+    flowData.dpixely = (float)meanY;   // [pixels]
 #elif defined(USE_LP_FILTER)
-      // Use LP filter measurements
-      flowData.dpixelx = LP_CONSTANT * dpixelx_previous + (1.0f - LP_CONSTANT) * (float)accpx;
-      flowData.dpixely = LP_CONSTANT * dpixely_previous + (1.0f - LP_CONSTANT) * (float)accpy;
-      dpixelx_previous = flowData.dpixelx;
-      dpixely_previous = flowData.dpixely;
+    // Use LP filter measurements
+    flowData.dpixelx = LP_CONSTANT * dpixelx_previous + (1.0f - LP_CONSTANT) * (float)accpx;
+    flowData.dpixely = LP_CONSTANT * dpixely_previous + (1.0f - LP_CONSTANT) * (float)accpy;
+    dpixelx_previous = flowData.dpixelx;
+    dpixely_previous = flowData.dpixely;
 #else
-      // Use raw measurements
-      flowData.dpixelx = (float)accpx;
-      flowData.dpixely = (float)accpy;
+    // Use raw measurements
+    flowData.dpixelx = (float)accpx;
+    flowData.dpixely = (float)accpy;
 #endif
-      // Push measurements into the estimator if flow is not disabled
-      //    and the PMW flow sensor indicates motion detection
-      if (!useFlowDisabled && currentMotion.motion == 0xB0) {
-        estimatorEnqueueFlow(&flowData);
-      }
-    } else {
-      outlierCount++;
-    }
+    estimatorEnqueueFlow(&flowData);
   }
 }
 
+static void pairTofChanged(void)
+{
+  rangeHoldDownRange(pairTof && isFlowTaskRunning);
+}
+
+static void flowdeckStartTask(void)
+{
+#ifdef MOTION_PIN
+  flowdeckMotionInterruptInit();
+#endif
+  xTaskCreate(flowdeckTask, FLOW_TASK_NAME, FLOW_TASK_STACKSIZE, NULL,
+              FLOW_TASK_PRI, NULL);
+
+  isFlowTaskRunning = true;
+  pairTofChanged();
+}
+
 static void flowdeck1Init()
 {
   if (isInit1 || isInit2) {
@@ -175,9 +307,7 @@ static void flowdeck1Init()
 
   if (pmw3901Init(NCS_PIN))
   {
-    xTaskCreate(flowdeckTask, FLOW_TASK_NAME, FLOW_TASK_STACKSIZE, NULL,
-                FLOW_TASK_PRI, NULL);
-
+    flowdeckStartTask();
     isInit1 = true;
   }
 }
@@ -199,7 +329,7 @@ static const DeckDriver flowdeck1_deck = {
   .vid = 0xBC,
   .pid = 0x0A,
   .name = "bcFlow",
-  .usedGpio = DECK_USING_IO_3,
+  .usedGpio = DECK_USING_IO_3 | MOTION_PIN_USED,
   .usedPeriph = DECK_USING_I2C | DECK_USING_SPI,
   .requiredEstimator = StateEstimatorTypeKalman,
 
@@ -221,9 +351,7 @@ static void flowdeck2Init()
 
   if (pmw3901Init(NCS_PIN))
   {
-    xTaskCreate(flowdeckTask, FLOW_TASK_NAME, FLOW_TASK_STACKSIZE, NULL,
-                FLOW_TASK_PRI, NULL);
-
+    flowdeckStartTask();
     isInit2 = true;
   }
 }
@@ -246,7 +374,7 @@ static const DeckDriver flowdeck2_deck = {
   .pid = 0x0F,
   .name = "bcFlow2",
 
-  .usedGpio = DECK_USING_IO_3,
+  .usedGpio = DECK_USING_IO_3 | MOTION_PIN_USED,
   .usedPeriph = DECK_USING_I2C | DECK_USING_SPI,
   .requiredEstimator = StateEstimatorTypeKalman,
 
@@ -292,6 +420,10 @@ LOG_ADD(LOG_UINT8, Rawsum, &currentMotion.rawDataSum)
  * @brief Counted flow outliers excluded from the estimator
  */
 LOG_ADD(LOG_UINT8, outlierCount, &outlierCount)
+/**
+ * @brief Counted low quality samples (see motion.minSqual and motion.maxShutter) excluded from the estimator
+ */
+LOG_ADD(LOG_UINT8, lowQualCount, &lowQualityCount)
 /**
  * @brief Count of surface feature
  */
@@ -300,6 +432,10 @@ LOG_ADD(LOG_UINT8, squal, &currentMotion.squal)
  * @brief Standard deviation of flow measurement
  */
 LOG_ADD(LOG_FLOAT, std, &stdFlow)
+/**
+ * @brief Rate of reads of the motion sensor [Hz]
+ */
+STATS_CNT_RATE_LOG_ADD(readRt, &flowReadRate)
 LOG_GROUP_STOP(motion)
 
 /**
@@ -319,6 +455,18 @@ PARAM_ADD(PARAM_UINT8, adaptive, &useAdaptiveStd)
  * @brief Set standard deviation flow measurement (default: 2.0f)
  */
 PARAM_ADD_CORE(PARAM_FLOAT, flowStdFixed, &flowStdFixed)
+/**
+ * @brief Minimum number of surface features for a sample to be used (default: 0)
+ */
+PARAM_ADD(PARAM_UINT8, minSqual, &flowMinSqual)
+/**
+ * @brief Maximum shutter time for a sample to be used [clock cycles] (default: 65535)
+ */
+PARAM_ADD(PARAM_UINT16, maxShutter, &flowMaxShutter)
+/**
+ * @brief Nonzero to enqueue the down range together with the flow, fused as one update by the Kalman estimator (default: 1)
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, pairTof, &pairTof, pairTofChanged)
 PARAM_GROUP_STOP(motion)
 
 PARAM_GROUP_START(deck)
@@ -677,6 +677,10 @@ static float fadeTime = 0.5;
 
 static float currentFadeTime = 0.5;
 
+// Frames sent to the LEDs, and frames not sent since the LEDs already show them
+static uint32_t framesSent;
+static uint32_t framesSkipped;
+
 #include "log.h"
 
 /**
@@ -692,6 +696,14 @@ LOG_GROUP_START(ring)
  * @brief Current fade time of fade color effect
  */
 LOG_ADD(LOG_FLOAT, fadeTime, &currentFadeTime)
+/**
+ * @brief Number of frames sent to the LEDs
+ */
+LOG_ADD(LOG_UINT32, sent, &framesSent)
+/**
+ * @brief Number of frames not sent since they were equal to the previous one
+ */
+LOG_ADD(LOG_UINT32, skipped, &framesSkipped)
 LOG_GROUP_STOP(ring)
 
 static void fadeColorEffect(uint8_t buffer[][3], bool reset)
@@ -858,11 +870,15 @@ static int timeEffectI = 0;
 static uint64_t timeEffectTime = 0;
 static uint8_t timeEffectPrevBuffer[CONFIG_DECK_LEDRING_NBR_LEDS][3];
 static float timeEffectRotation = 0;
+// Timing rendered in the output buffer, -1 if none. A timing without fade or
+// rotation gives the same output during its whole duration.
+static int timeEffectRenderedI = -1;
 
 static void timeMemEffect(uint8_t outputBuffer[][3], bool reset)
 {
   // Start timer when going to this
   if (reset) {
+    timeEffectRenderedI = -1;
     for (int i = 0; i < CONFIG_DECK_LEDRING_NBR_LEDS; i++) {
       COPY_COLOR(timeEffectPrevBuffer[i], part_black);
       COPY_COLOR(outputBuffer[i], part_black);
@@ -905,6 +921,11 @@ static void timeMemEffect(uint8_t outputBuffer[][3], bool reset)
       return;
   }
 
+  if (timeEffectRenderedI == timeEffectI && !current.fade && !current.rotate) {
+    return;
+  }
+  timeEffectRenderedI = timeEffectI;
+
   // Apply the current effect
   uint8_t color[3];
   RGB565_TO_RGB888(color, current.color)
@@ -1020,14 +1041,43 @@ static xTimerHandle timer;
 
 
 
+// The LEDs keep their color, a frame equal to the previous one is only sent
+// this often, in case the LEDs missed it
+#define LEDRING_REFRESH_PERIOD M2T(1000)
+
+static void sendFrame(uint8_t frame[][3])
+{
+  // Read by the ws2812 driver until the next frame is sent
+  static uint8_t sentFrame[CONFIG_DECK_LEDRING_NBR_LEDS][3];
+  static bool isSent = false;
+  static TickType_t sentAt;
+
+  const TickType_t now = xTaskGetTickCount();
+  if (isSent && (now - sentAt) < LEDRING_REFRESH_PERIOD &&
+      memcmp(frame, sentFrame, sizeof(sentFrame)) == 0) {
+    framesSkipped++;
+    return;
+  }
+
+  // Waits for the previous frame to be sent before changing it
+  ws2812WaitDone();
+  memcpy(sentFrame, frame, sizeof(sentFrame));
+  ws2812Send(sentFrame, CONFIG_DECK_LEDRING_NBR_LEDS);
+  isSent = true;
+  sentAt = now;
+  framesSent++;
+}
+
 void ledring12Worker(void * data)
 {
   static int current_effect = 0;
+  // Kept between the calls, some effects update the previous frame
   static uint8_t buffer[CONFIG_DECK_LEDRING_NBR_LEDS][3];
+  uint8_t frame[CONFIG_DECK_LEDRING_NBR_LEDS][3];
   bool reset = true;
 
   if (/*!pmIsDischarging() ||*/ (effect > neffect)) {
-    ws2812Send(black, CONFIG_DECK_LEDRING_NBR_LEDS);
+    sendFrame(black);
     return;
   }
 
@@ -1044,22 +1094,27 @@ void ledring12Worker(void * data)
   }
 
   effectsFct[current_effect](buffer, reset);
-  overrideWithLightSignal(buffer);
+
+  // The light signal and the dimmer only change what is shown, not the
+  // buffer of the effect
+  memcpy(frame, buffer, sizeof(frame));
+  overrideWithLightSignal(frame);
 
   if (CONFIG_DECK_LEDRING_DIMMER) {
     for (uint8_t i = 0; i < CONFIG_DECK_LEDRING_NBR_LEDS; i++) {
       for (uint8_t j = 0; j < 3; j++) {
-        buffer[i][j] = buffer[i][j] >> CONFIG_DECK_LEDRING_DIMMER;
+        frame[i][j] = frame[i][j] >> CONFIG_DECK_LEDRING_DIMMER;
       }
     }
   }
 
-  ws2812Send(buffer, CONFIG_DECK_LEDRING_NBR_LEDS);
+  sendFrame(frame);
 }
 
 static void ledring12Timer(xTimerHandle timer)
 {
-  workerSchedule(ledring12Worker, NULL);
+  const workerOptions_t options = {.priority = WORKER_PRIORITY_NORMAL, .coalesce = true};
+  workerScheduleWithOptions(ledring12Worker, NULL, &options);
 
   setHeadlightsOn(headlightEnable);
   checkLightSignalTrigger();
@@ -1134,6 +1189,7 @@ static bool handleTimingmemWrite(const uint32_t memAddr, const uint8_t writeLen,
   if ((memAddr + writeLen) <= sizeof(ledringtimingsmem.timings)) {
     uint8_t* mem = (uint8_t*) &ledringtimingsmem.timings;
     memcpy(mem+memAddr, buffer, writeLen);
+    timeEffectRenderedI = -1;
     result = true;
   }
 
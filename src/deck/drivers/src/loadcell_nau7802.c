@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "nvicconf.h"
 #include "stm32fxxx.h"
 
@@ -43,6 +44,13 @@
 #include "sleepus.h"
 #include "debug.h"
 #include "statsCnt.h"
+#include "autoconf.h"
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+#include "usec_time.h"
+#include "motors.h"
+#include "mem.h"
+#include "static_mem.h"
+#endif
 
 // Hardware defines (also update deck driver below!)
 #define DECK_I2C_ADDRESS 0x2A
@@ -66,6 +74,108 @@ static STATS_CNT_RATE_DEFINE(rate, 1000);
 static xSemaphoreHandle dataReady;
 static StaticSemaphore_t dataReadyBuffer;
 
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+static volatile uint32_t dataReadyTimestamp;
+
+// Every sample is captured with the motor commands, for thrust stand runs. The
+// ring is read through MEM_TYPE_LOADCELL, see
+// docs/functional-areas/memory-subsystem/MEM_TYPE_LOADCELL.md
+#define CAPTURE_CAPACITY CONFIG_DECK_LOADCELL_CAPTURE_SIZE
+#define CAPTURE_VERSION 1
+
+typedef struct {
+  uint32_t timestamp;   // data ready interrupt [us]
+  int32_t rawWeight;
+  uint16_t motorRatio[4];
+} __attribute__((packed)) loadcellSample_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t sampleSize;
+  uint8_t isCapturing;
+  uint8_t channel;
+  uint32_t capacity;
+  uint32_t head;
+} __attribute__((packed)) loadcellCaptureMemHeader_t;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static loadcellSample_t captureRing[CAPTURE_CAPACITY];
+// Total number of captured samples, the next sample is written at captureHead % CAPTURE_CAPACITY
+static uint32_t captureHead;
+static uint8_t capture;
+static uint8_t isCapturing;
+
+static loadcellCaptureMemHeader_t captureReadHeader;
+
+#define CAPTURE_RING_OFFSET sizeof(loadcellCaptureMemHeader_t)
+#define CAPTURE_TOTAL_SIZE (CAPTURE_RING_OFFSET + sizeof(captureRing))
+
+static void captureSample(const uint32_t timestamp, const int32_t measurement)
+{
+  if (capture != isCapturing) {
+    // A new capture starts from an empty ring
+    if (capture) {
+      __atomic_store_n(&captureHead, 0, __ATOMIC_RELEASE);
+    }
+    isCapturing = capture;
+  }
+
+  if (!isCapturing) {
+    return;
+  }
+
+  const uint32_t head = captureHead;
+  loadcellSample_t* sample = &captureRing[head % CAPTURE_CAPACITY];
+  sample->timestamp = timestamp;
+  sample->rawWeight = measurement;
+  for (int i = 0; i < 4; i++) {
+    sample->motorRatio[i] = motorsGetRatio(MOTOR_M1 + i);
+  }
+  // The sample is complete before the head includes it
+  __atomic_store_n(&captureHead, head + 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t handleMemGetSize(void) {
+  return CAPTURE_TOTAL_SIZE;
+}
+
+// The ring is read while samples are captured, a client reads the header again after the samples to know if any of
+// them were overwritten during the read
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > CAPTURE_TOTAL_SIZE) {
+    return false;
+  }
+
+  if (memAddr == 0) {
+    captureReadHeader.version = CAPTURE_VERSION;
+    captureReadHeader.sampleSize = sizeof(loadcellSample_t);
+    captureReadHeader.isCapturing = isCapturing;
+    captureReadHeader.channel = channel;
+    captureReadHeader.capacity = CAPTURE_CAPACITY;
+    captureReadHeader.head = __atomic_load_n(&captureHead, __ATOMIC_ACQUIRE);
+  }
+
+  uint32_t addr = memAddr;
+  uint32_t left = readLen;
+  if (addr < CAPTURE_RING_OFFSET) {
+    const uint32_t length = (left < CAPTURE_RING_OFFSET - addr) ? left : CAPTURE_RING_OFFSET - addr;
+    memcpy(buffer, ((const uint8_t*)&captureReadHeader) + addr, length);
+    buffer += length;
+    addr += length;
+    left -= length;
+  }
+  memcpy(buffer, ((const uint8_t*)captureRing) + addr - CAPTURE_RING_OFFSET, left);
+
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_LOADCELL,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+#endif
+
 static void loadcellTask(void* prm);
 
 ////////////////////////////
@@ -403,6 +513,9 @@ static void setupDataReadyInterrupt(void)
 void __attribute__((used)) EXTI8_Callback(void)
 {
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+  dataReadyTimestamp = (uint32_t)usecTimestamp();
+#endif
   xSemaphoreGiveFromISR(dataReady, &xHigherPriorityTaskWoken);
   if (xHigherPriorityTaskWoken) {
     portYIELD();
@@ -461,6 +574,10 @@ static void loadcellInit(DeckInfo *info)
   // Set up Interrupt
   setupDataReadyInterrupt();
 
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+  memoryRegisterHandler(&memDef);
+#endif
+
   if (1) {
     // Create a task
     xTaskCreate(loadcellTask, "LOADCELL",
@@ -475,11 +592,18 @@ static void loadcellTask(void* prm)
     BaseType_t semResult = xSemaphoreTake(dataReady, M2T(500));
     if (semResult == pdTRUE || digitalRead(DATA_READY_PIN))
     {
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+      // A missed interrupt is timestamped when the pin is polled
+      const uint32_t timestamp = (semResult == pdTRUE) ? dataReadyTimestamp : (uint32_t)usecTimestamp();
+#endif
       int32_t measurement;
       bool result = nau7802_getMeasurement(&nau7802, &measurement);
       if (result) {
         rawWeight = measurement;
         weight = a[channel] * rawWeight + b[channel];
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+        captureSample(timestamp, measurement);
+#endif
         // currentChannel = (currentChannel + 1) % 2;
         // nau7802_setChannel(&nau7802, currentChannel);
 
@@ -557,6 +681,12 @@ PARAM_ADD(PARAM_FLOAT, a, &a[0])
 PARAM_ADD(PARAM_FLOAT, b, &b[0])
 PARAM_ADD(PARAM_UINT8, sampleRate, &sampleRateDesired)
 PARAM_ADD(PARAM_UINT8, channel, &channelDesired)
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+/**
+ * @brief Nonzero to capture every sample to the MEM_TYPE_LOADCELL ring, a new capture starts from an empty ring
+ */
+PARAM_ADD(PARAM_UINT8, capture, &capture)
+#endif
 PARAM_GROUP_STOP(loadcell)
 
 LOG_GROUP_START(loadcell)
@@ -564,4 +694,7 @@ LOG_ADD(LOG_INT32, rawWeight, &rawWeight)
 LOG_ADD(LOG_FLOAT, weight, &weight)
 
 STATS_CNT_RATE_LOG_ADD(rate, &rate)
+#ifdef CONFIG_DECK_LOADCELL_CAPTURE
+LOG_ADD(LOG_UINT32, captured, &captureHead)
+#endif
 LOG_GROUP_STOP(loadcell)
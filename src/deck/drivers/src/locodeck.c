@@ -32,6 +32,7 @@
 
 #define DEBUG_MODULE "DWM"
 
+#include <assert.h>
 #include <stdint.h>
 #include <string.h>
 #include "stm32fxxx.h"
@@ -51,8 +52,13 @@
 #include "estimator.h"
 #include "statsCnt.h"
 #include "mem.h"
+#include "usec_time.h"
+#include "storage.h"
+#include "worker.h"
 
 #include "locodeck.h"
+#include "lpsAnchorTable.h"
+#include "tdoaStats.h"
 
 #include "lpsTdoa2Tag.h"
 #include "lpsTdoa3Tag.h"
@@ -137,6 +143,16 @@ static uint32_t timeout;
 
 static STATS_CNT_RATE_DEFINE(spiWriteCount, 1000);
 static STATS_CNT_RATE_DEFINE(spiReadCount, 1000);
+static STATS_CNT_RATE_DEFINE(spiBusCount, 1000);
+
+// Time of the latest rising edge on the DW1000 IRQ line, set in the ISR
+static volatile uint64_t irqTimestampUs;
+
+// True while the uwb task holds the SPI bus for a full interrupt handling pass
+static bool isSpiBusHeld = false;
+
+static void spiBusAcquire();
+static void spiBusRelease();
 
 // Memory read/write handling
 #define MEM_LOCO_INFO             0x0000
@@ -151,17 +167,45 @@ static STATS_CNT_RATE_DEFINE(spiReadCount, 1000);
 #define MEM_LOCO2_ANCHOR_BASE      0x2000
 #define MEM_LOCO2_ANCHOR_PAGE_SIZE 0x0100
 #define MEM_LOCO2_PAGE_LEN         (3 * sizeof(float) + 1)
+#define MEM_LOCO2_ANCHOR_TABLE      0x12000
+#define MEM_LOCO2_ANCHOR_TABLE_SIZE 0x1000
+#define MEM_LOCO2_LINK_STATS       0x13000
+#define MEM_LOCO2_LINK_STATS_SIZE  0x4000
 
-static uint32_t handleMemGetSize(void) { return MEM_LOCO_ANCHOR_BASE + MEM_LOCO_ANCHOR_PAGE_SIZE * 256; }
+static uint32_t handleMemGetSize(void) { return MEM_LOCO2_LINK_STATS + MEM_LOCO2_LINK_STATS_SIZE; }
 static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* dest);
+static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* src);
 static const MemoryHandlerDef_t memDef = {
   .type = MEM_TYPE_LOCO2,
   .getSize = handleMemGetSize,
   .read = handleMemRead,
-  .write = 0, // Write is not supported
+  .write = handleMemWrite, // Only the anchor table can be written
 };
 static void buildAnchorMemList(const uint32_t memAddr, const uint8_t readLen, uint8_t* dest, const uint32_t pageBase_address, const uint8_t anchorCount, const uint8_t unsortedAnchorList[]);
 
+// Anchor position table, uploaded in bulk, loaded from storage at start up and extended with positions received from
+// the anchors. The positions are handed to the algorithm to use until the anchors have sent their own positions.
+// Protected by algoSemaphore.
+#define ANCHOR_TABLE_STORAGE_KEY "lps/anchors"
+#define ANCHOR_TABLE_UPDATE_INTERVAL M2T(250)
+#define ANCHOR_TABLE_PERSIST_INTERVAL M2T(10000)
+
+static lpsAnchorTable_t anchorTable;
+static uint32_t anchorTableCrc;
+static uint32_t anchorTablePersistedCrc;
+static uint32_t anchorTableNextUpdate;
+static uint32_t anchorTableNextPersist;
+static bool isAnchorTablePersisting = false;
+
+// Serialized table for reads and uploads through the memory sub system, one transfer at a time
+static uint8_t memTableBuffer[LPS_ANCHOR_TABLE_MAX_SERIALIZED_SIZE];
+static uint32_t memTableUploadedLength;
+// Serialized table for the persistent storage, used in the worker task
+static uint8_t storageTableBuffer[LPS_ANCHOR_TABLE_MAX_SERIALIZED_SIZE];
+// Snapshot of the link statistics for reads through the memory sub system
+static uint8_t memLinkStatsBuffer[TDOA_STATS_LINK_TABLE_MAX_SIZE];
+static_assert(sizeof(memLinkStatsBuffer) <= MEM_LOCO2_LINK_STATS_SIZE);
+
 static void txCallback(dwDevice_t *dev)
 {
   timeout = algorithm->onEvent(dev, eventPacketSent);
@@ -193,6 +237,48 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
     uint8_t anchorCount = locoDeckGetActiveAnchorIdList(unsortedAnchorList, MEM_ANCHOR_ID_LIST_LENGTH);
     buildAnchorMemList(memAddr, readLen, dest, MEM_LOCO2_ACTIVE_LIST, anchorCount, unsortedAnchorList);
     result = true;
+  } else if (memAddr >= MEM_LOCO2_LINK_STATS) {
+    const uint32_t offset = memAddr - MEM_LOCO2_LINK_STATS;
+    if (offset + readLen <= MEM_LOCO2_LINK_STATS_SIZE) {
+      static uint32_t memLinkStatsLength;
+      if (offset == 0) {
+        // A new read of the table, take a snapshot to get a consistent table over multiple reads
+        memLinkStatsLength = 0;
+        if (isInit && algorithm->getLinkStatsTable) {
+          xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+          memLinkStatsLength = algorithm->getLinkStatsTable(memLinkStatsBuffer, sizeof(memLinkStatsBuffer));
+          xSemaphoreGive(algoSemaphore);
+        }
+      }
+
+      for (int i = 0; i < readLen; i++) {
+        const uint32_t index = offset + i;
+        dest[i] = (index < memLinkStatsLength) ? memLinkStatsBuffer[index] : 0;
+      }
+
+      result = true;
+    }
+  } else if (memAddr >= MEM_LOCO2_ANCHOR_TABLE) {
+    const uint32_t offset = memAddr - MEM_LOCO2_ANCHOR_TABLE;
+    if (offset + readLen <= MEM_LOCO2_ANCHOR_TABLE_SIZE) {
+      static uint32_t memTableLength;
+      if (offset == 0) {
+        // A new read of the table, take a snapshot to get a consistent table over multiple reads
+        memTableLength = 0;
+        if (isInit) {
+          xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+          memTableLength = lpsAnchorTableSerialize(&anchorTable, memTableBuffer, sizeof(memTableBuffer));
+          xSemaphoreGive(algoSemaphore);
+        }
+      }
+
+      for (int i = 0; i < readLen; i++) {
+        const uint32_t index = offset + i;
+        dest[i] = (index < memTableLength) ? memTableBuffer[index] : 0;
+      }
+
+      result = true;
+    }
   } else {
     if (memAddr >= MEM_LOCO2_ANCHOR_BASE) {
       uint32_t pageAddress = memAddr - MEM_LOCO2_ANCHOR_BASE;
@@ -219,6 +305,43 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
   return result;
 }
 
+// The table must be written in order, starting with the header. It is validated and replaces the current anchor table
+// when the last byte has been written.
+static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* src) {
+  if (!isInit || memAddr < MEM_LOCO2_ANCHOR_TABLE) {
+    return false;
+  }
+
+  const uint32_t offset = memAddr - MEM_LOCO2_ANCHOR_TABLE;
+  if (offset == 0) {
+    memTableUploadedLength = 0;
+  }
+
+  if (offset != memTableUploadedLength || offset + writeLen > sizeof(memTableBuffer)) {
+    return false;
+  }
+
+  memcpy(&memTableBuffer[offset], src, writeLen);
+  memTableUploadedLength += writeLen;
+
+  bool result = true;
+  const size_t tableSize = lpsAnchorTableSerializedSize(memTableBuffer, memTableUploadedLength);
+  if (tableSize > 0 && memTableUploadedLength >= tableSize) {
+    xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+    result = lpsAnchorTableDeserialize(&anchorTable, memTableBuffer, tableSize);
+    if (result) {
+      // Hand the positions to the algorithm and persist the table as soon as possible
+      anchorTableNextUpdate = 0;
+      anchorTableNextPersist = 0;
+    }
+    xSemaphoreGive(algoSemaphore);
+
+    memTableUploadedLength = 0;
+  }
+
+  return result;
+}
+
 static void buildAnchorMemList(const uint32_t memAddr, const uint8_t readLen, uint8_t* dest, const uint32_t pageBase_address, const uint8_t anchorCount, const uint8_t unsortedAnchorList[]) {
   for (int i = 0; i < readLen; i++) {
     int address = memAddr + i;
@@ -278,6 +401,82 @@ uint8_t locoDeckGetActiveAnchorIdList(uint8_t unorderedAnchorList[], const int m
   return result;
 }
 
+static void loadAnchorTable() {
+  lpsAnchorTableInit(&anchorTable);
+
+  const size_t length = storageFetch(ANCHOR_TABLE_STORAGE_KEY, storageTableBuffer, sizeof(storageTableBuffer));
+  if (length > 0) {
+    if (lpsAnchorTableDeserialize(&anchorTable, storageTableBuffer, length)) {
+      DEBUG_PRINT("Loaded %d anchor positions from storage\n", anchorTable.count);
+    } else {
+      DEBUG_PRINT("WARNING: Invalid anchor table in storage\n");
+    }
+  }
+
+  anchorTableCrc = lpsAnchorTableCrc(&anchorTable);
+  anchorTablePersistedCrc = anchorTableCrc;
+}
+
+static void persistAnchorTableWorker(void* arg) {
+  xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+  const size_t length = lpsAnchorTableSerialize(&anchorTable, storageTableBuffer, sizeof(storageTableBuffer));
+  const uint32_t crc = anchorTableCrc;
+  xSemaphoreGive(algoSemaphore);
+
+  const bool isStored = storageStore(ANCHOR_TABLE_STORAGE_KEY, storageTableBuffer, length);
+  if (!isStored) {
+    DEBUG_PRINT("WARNING: Failed to persist anchor table\n");
+  }
+
+  xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+  if (isStored) {
+    anchorTablePersistedCrc = crc;
+  }
+  isAnchorTablePersisting = false;
+  xSemaphoreGive(algoSemaphore);
+}
+
+// Add positions the algorithm has received from the anchors to the table
+static void learnAnchorPositions() {
+  uint8_t anchorIds[LPS_ANCHOR_TABLE_MAX_ANCHORS];
+  const uint8_t anchorCount = algorithm->getAnchorIdList(anchorIds, LPS_ANCHOR_TABLE_MAX_ANCHORS);
+
+  for (int i = 0; i < anchorCount; i++) {
+    point_t position;
+    memset(&position, 0, sizeof(position));
+    if (algorithm->getAnchorPosition(anchorIds[i], &position) && position.timestamp != 0) {
+      lpsAnchorTableSet(&anchorTable, anchorIds[i], &position);
+    }
+  }
+}
+
+// Called with algoSemaphore taken
+static void updateAnchorTable() {
+  const uint32_t now = xTaskGetTickCount();
+  if (now < anchorTableNextUpdate) {
+    return;
+  }
+  anchorTableNextUpdate = now + ANCHOR_TABLE_UPDATE_INTERVAL;
+
+  for (int i = 0; i < anchorTable.count; i++) {
+    const lpsAnchorTableEntry_t* entry = &anchorTable.entries[i];
+    const point_t position = {.x = entry->x, .y = entry->y, .z = entry->z};
+    algorithm->setDefaultAnchorPosition(entry->id, &position);
+  }
+
+  learnAnchorPositions();
+  anchorTableCrc = lpsAnchorTableCrc(&anchorTable);
+
+  // Anchors send the same positions over and over, only write to the storage when something has changed
+  if (anchorTableCrc != anchorTablePersistedCrc && !isAnchorTablePersisting && now >= anchorTableNextPersist) {
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW};
+    if (workerScheduleWithOptions(persistAnchorTableWorker, 0, &options) == 0) {
+      isAnchorTablePersisting = true;
+      anchorTableNextPersist = now + ANCHOR_TABLE_PERSIST_INTERVAL;
+    }
+  }
+}
+
 static bool switchToMode(const lpsMode_t newMode) {
   bool result = false;
 
@@ -287,6 +486,7 @@ static bool switchToMode(const lpsMode_t newMode) {
 
     algorithm->init(dwm);
     timeout = algorithm->onEvent(dwm, eventTimeout);
+    anchorTableNextUpdate = 0;
 
     result = true;
   }
@@ -356,15 +556,24 @@ static void uwbTask(void* parameters) {
 
   systemWaitStart();
 
+  xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+  loadAnchorTable();
+  xSemaphoreGive(algoSemaphore);
+
   while(1) {
     xSemaphoreTake(algoSemaphore, portMAX_DELAY);
     handleModeSwitch();
+    updateAnchorTable();
     xSemaphoreGive(algoSemaphore);
 
     if (ulTaskNotifyTake(pdTRUE, timeout / portTICK_PERIOD_MS) > 0) {
       do{
         xSemaphoreTake(algoSemaphore, portMAX_DELAY);
+        // All register accesses of one pass (status, rx info, payload, rx timestamp and
+        // the status clear/receiver restart) are done in one bus transaction
+        spiBusAcquire();
         dwHandleInterrupt(dwm);
+        spiBusRelease();
         xSemaphoreGive(algoSemaphore);
       } while(digitalRead(GPIO_PIN_IRQ) != 0);
     } else {
@@ -397,35 +606,66 @@ bool lpsGetLppShort(lpsLppShortPacket_t* shortPacket)
   return xQueueReceive(lppShortQueue, shortPacket, 0) == pdPASS;
 }
 
+uint64_t locoDeckGetIrqTimestampUs()
+{
+  return irqTimestampUs;
+}
+
 static uint8_t spiTxBuffer[196];
 static uint8_t spiRxBuffer[196];
 static uint16_t spiSpeed = SPI_BAUDRATE_2MHZ;
 
 /************ Low level ops for libdw **********/
+
+// Taking the bus re-initializes the SPI peripheral, holding it while handling an
+// interrupt saves that work for every register access
+static void spiBusAcquire()
+{
+  spiBeginTransactionWithPriority(spiSpeed, spiPriorityHigh, spiUserLoco);
+  isSpiBusHeld = true;
+  STATS_CNT_RATE_EVENT(&spiBusCount);
+}
+
+static void spiBusRelease()
+{
+  isSpiBusHeld = false;
+  spiEndTransaction();
+}
+
 static void spiWrite(dwDevice_t* dev, const void *header, size_t headerLength,
                                       const void* data, size_t dataLength)
 {
-  spiBeginTransaction(spiSpeed);
+  if (!isSpiBusHeld) {
+    spiBeginTransactionWithPriority(spiSpeed, spiPriorityHigh, spiUserLoco);
+    STATS_CNT_RATE_EVENT(&spiBusCount);
+  }
   digitalWrite(CS_PIN, LOW);
   memcpy(spiTxBuffer, header, headerLength);
   memcpy(spiTxBuffer+headerLength, data, dataLength);
   spiExchange(headerLength+dataLength, spiTxBuffer, spiRxBuffer);
   digitalWrite(CS_PIN, HIGH);
-  spiEndTransaction();
+  if (!isSpiBusHeld) {
+    spiEndTransaction();
+  }
   STATS_CNT_RATE_EVENT(&spiWriteCount);
 }
 
 static void spiRead(dwDevice_t* dev, const void *header, size_t headerLength,
                                      void* data, size_t dataLength)
 {
-  spiBeginTransaction(spiSpeed);
+  if (!isSpiBusHeld) {
+    spiBeginTransactionWithPriority(spiSpeed, spiPriorityHigh, spiUserLoco);
+    STATS_CNT_RATE_EVENT(&spiBusCount);
+  }
   digitalWrite(CS_PIN, LOW);
   memcpy(spiTxBuffer, header, headerLength);
   memset(spiTxBuffer+headerLength, 0, dataLength);
   spiExchange(headerLength+dataLength, spiTxBuffer, spiRxBuffer);
   memcpy(data, spiRxBuffer+headerLength, dataLength);
   digitalWrite(CS_PIN, HIGH);
-  spiEndTransaction();
+  if (!isSpiBusHeld) {
+    spiEndTransaction();
+  }
   STATS_CNT_RATE_EVENT(&spiReadCount);
 }
 
@@ -437,6 +677,8 @@ static void spiRead(dwDevice_t* dev, const void *header, size_t headerLength,
   {
     portBASE_TYPE  xHigherPriorityTaskWoken = pdFALSE;
 
+    irqTimestampUs = usecTimestamp();
+
     // Unlock interrupt handling task
     vTaskNotifyGiveFromISR(uwbTaskHandle, &xHigherPriorityTaskWoken);
 
@@ -636,6 +878,20 @@ LOG_ADD_CORE(LOG_UINT8, mode, &algoOptions.currentRangingMode)
 
 STATS_CNT_RATE_LOG_ADD(spiWr, &spiWriteCount)
 STATS_CNT_RATE_LOG_ADD(spiRe, &spiReadCount)
+/**
+ * @brief Number of SPI bus transactions per second, one transaction covers all register accesses of an interrupt
+ */
+STATS_CNT_RATE_LOG_ADD(spiBus, &spiBusCount)
+
+/**
+ * @brief CRC of the anchor position table, compare with the CRC of a table to upload
+ */
+LOG_ADD(LOG_UINT32, tableCrc, &anchorTableCrc)
+
+/**
+ * @brief Number of anchors in the anchor position table
+ */
+LOG_ADD(LOG_UINT8, tableCount, &anchorTable.count)
 LOG_GROUP_STOP(loco)
 
 /**
@@ -0,0 +1,157 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsAnchorTable.c: Compact table of anchor positions, for bulk upload and persistent storage
+ */
+
+#include <string.h>
+
+#include "lpsAnchorTable.h"
+#include "crc32.h"
+
+static int findIndex(const lpsAnchorTable_t* this, const uint8_t id, bool* found);
+
+void lpsAnchorTableInit(lpsAnchorTable_t* this) {
+  memset(this, 0, sizeof(lpsAnchorTable_t));
+}
+
+bool lpsAnchorTableSet(lpsAnchorTable_t* this, const uint8_t id, const point_t* position) {
+  bool found = false;
+  const int index = findIndex(this, id, &found);
+
+  if (!found) {
+    if (this->count >= LPS_ANCHOR_TABLE_MAX_ANCHORS) {
+      return false;
+    }
+
+    memmove(&this->entries[index + 1], &this->entries[index], (this->count - index) * sizeof(lpsAnchorTableEntry_t));
+    this->count++;
+    this->entries[index].id = id;
+  }
+
+  this->entries[index].x = position->x;
+  this->entries[index].y = position->y;
+  this->entries[index].z = position->z;
+
+  return true;
+}
+
+bool lpsAnchorTableGet(const lpsAnchorTable_t* this, const uint8_t id, point_t* position) {
+  bool found = false;
+  const int index = findIndex(this, id, &found);
+
+  if (found) {
+    position->x = this->entries[index].x;
+    position->y = this->entries[index].y;
+    position->z = this->entries[index].z;
+  }
+
+  return found;
+}
+
+uint32_t lpsAnchorTableCrc(const lpsAnchorTable_t* this) {
+  return crc32CalculateBuffer(this->entries, this->count * sizeof(lpsAnchorTableEntry_t));
+}
+
+size_t lpsAnchorTableSerialize(const lpsAnchorTable_t* this, uint8_t* buffer, const size_t bufferSize) {
+  const size_t size = LPS_ANCHOR_TABLE_SERIALIZED_SIZE(this->count);
+  if (size > bufferSize) {
+    return 0;
+  }
+
+  const lpsAnchorTableHeader_t header = {
+    .formatVersion = LPS_ANCHOR_TABLE_FORMAT_VERSION,
+    .anchorCount = this->count,
+    .reserved = 0,
+    .crc = lpsAnchorTableCrc(this),
+  };
+
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(buffer + sizeof(header), this->entries, this->count * sizeof(lpsAnchorTableEntry_t));
+
+  return size;
+}
+
+size_t lpsAnchorTableSerializedSize(const uint8_t* buffer, const size_t length) {
+  if (length < sizeof(lpsAnchorTableHeader_t)) {
+    return 0;
+  }
+
+  const lpsAnchorTableHeader_t* header = (const lpsAnchorTableHeader_t*)buffer;
+  return LPS_ANCHOR_TABLE_SERIALIZED_SIZE(header->anchorCount);
+}
+
+bool lpsAnchorTableDeserialize(lpsAnchorTable_t* this, const uint8_t* buffer, const size_t length) {
+  const size_t size = lpsAnchorTableSerializedSize(buffer, length);
+  if (size == 0 || size > length) {
+    return false;
+  }
+
+  lpsAnchorTableHeader_t header;
+  memcpy(&header, buffer, sizeof(header));
+  if (header.formatVersion != LPS_ANCHOR_TABLE_FORMAT_VERSION || header.anchorCount > LPS_ANCHOR_TABLE_MAX_ANCHORS) {
+    return false;
+  }
+
+  const lpsAnchorTableEntry_t* entries = (const lpsAnchorTableEntry_t*)(buffer + sizeof(header));
+  const size_t entriesSize = header.anchorCount * sizeof(lpsAnchorTableEntry_t);
+  if (crc32CalculateBuffer(entries, entriesSize) != header.crc) {
+    return false;
+  }
+
+  // The ids must be unique and sorted, otherwise the CRC is not unique for a set of anchors
+  for (int i = 1; i < header.anchorCount; i++) {
+    if (entries[i].id <= entries[i - 1].id) {
+      return false;
+    }
+  }
+
+  memcpy(this->entries, entries, entriesSize);
+  this->count = header.anchorCount;
+
+  return true;
+}
+
+// Binary search for an id. Returns the index of the anchor, or the index where it should be inserted if not found.
+static int findIndex(const lpsAnchorTable_t* this, const uint8_t id, bool* found) {
+  int low = 0;
+  int high = this->count;
+
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    const uint8_t midId = this->entries[mid].id;
+    if (midId == id) {
+      *found = true;
+      return mid;
+    }
+
+    if (midId < id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  *found = false;
+  return low;
+}
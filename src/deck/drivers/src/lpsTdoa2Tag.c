@@ -37,6 +37,7 @@
 #include "cfassert.h"
 
 #include "estimator.h"
+#include "usec_time.h"
 
 #include "physicalConstants.h"
 #include "tdoaEngineInstance.h"
@@ -89,6 +90,9 @@ static uint16_t logAnchorDistance[LOCODECK_NR_OF_TDOA2_ANCHORS];
 static bool rangingOk;
 static float stdDev = TDOA_ENGINE_MEASUREMENT_NOISE_STD;
 
+// Time of the packet being processed, shared by all TDoA measurements extracted from it
+static uint32_t packetEventTimeUs;
+
 // The default receive time in the anchors for messages from other anchors is 0
 // and is overwritten with the actual receive time when a packet arrives.
 // That is, if no message was received the rx time will be 0.
@@ -231,6 +235,7 @@ static bool rxcallback(dwDevice_t *dev) {
 
     if (anchor < LOCODECK_NR_OF_TDOA2_ANCHORS) {  // Если айди меньше, чем количество анкеров
       uint32_t now_ms = T2M(xTaskGetTickCount());  // Текущее время в мс
+      packetEventTimeUs = (uint32_t)locoDeckGetIrqTimestampUs();
 
       const int64_t rxAn_by_T_in_cl_T = arrival.full;  // Получаем время приема пакета нами
       const int64_t txAn_in_cl_An = packet->timestamps[anchor];  // Получаем время отправки пакета 
@@ -323,6 +328,9 @@ static void sendTdoaToEstimatorCallback(tdoaMeasurement_t* tdoaMeasurement) {
   // Override the default standard deviation set by the TDoA engine.
   tdoaMeasurement->stdDev = stdDev;  // Устанавливается стандартное отклонение 0.15f
 
+  // The packet is processed when it is received, the time when processing started is a good approximation of the
+  // time of the measurement. All measurements from one packet get the same time.
+  tdoaMeasurement->eventTimeUs = packetEventTimeUs;
   estimatorEnqueueTDOA(tdoaMeasurement);  // Добавление в очередь эстиматора (локализатор)
 
   #ifdef CONFIG_DECK_LOCO_2D_POSITION  // Если включена локализация только 2D
@@ -373,7 +381,7 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
   uint32_t now_ms = T2M(xTaskGetTickCount());  // Получаем время сейчас
 
 // Ищем контекст в массиве по айдишнику анкера. Если найден, сохраняется в anchorCtx
-  bool contextFound = tdoaStorageGetAnchorCtx(tdoaEngineState.anchorInfoArray, anchorId, now_ms, &anchorCtx);
+  bool contextFound = tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, anchorId, now_ms, &anchorCtx);
   if (contextFound) {  // Если найден контекст
     tdoaStorageGetAnchorPosition(&anchorCtx, position);  // Извлекает позиция анкера
     return true;  // Возврат тру
@@ -384,13 +392,32 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
 
 // Получает список айди анкеров
 static uint8_t getAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
-  return tdoaStorageGetListOfAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize);
+  return tdoaStorageGetListOfAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize);
 }
 
 // Получает список активных анкеров
 static uint8_t getActiveAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
   uint32_t now_ms = T2M(xTaskGetTickCount());  // Время сейчас
-  return tdoaStorageGetListOfActiveAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize, now_ms);
+  return tdoaStorageGetListOfActiveAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize, now_ms);
+}
+
+static size_t getLinkStatsTable(uint8_t* buffer, const size_t bufferSize) {
+  uint32_t now_ms = T2M(xTaskGetTickCount());
+  return tdoaStatsSerializeLinkTable(&tdoaEngineState.anchorStorage, now_ms, buffer, bufferSize);
+}
+
+static void setDefaultAnchorPosition(const uint8_t anchorId, const point_t* position) {
+  tdoaAnchorContext_t anchorCtx;
+  uint32_t now_ms = T2M(xTaskGetTickCount());
+
+  // Only anchors that have been heard, anchors that are not in range should not take up space in the storage.
+  // The table is applied periodically, which keeps the position valid while the anchor is heard.
+  if (tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, anchorId, now_ms, &anchorCtx)) {
+    point_t current;
+    if (!tdoaStorageGetAnchorPosition(&anchorCtx, &current)) {
+      tdoaStorageSetAnchorPosition(&anchorCtx, position->x, position->y, position->z);
+    }
+  }
 }
 
 // Loco Posisioning Protocol (LPP) handling
@@ -421,6 +448,8 @@ uwbAlgorithm_t uwbTdoa2TagAlgorithm = {
   .getAnchorPosition = getAnchorPosition,
   .getAnchorIdList = getAnchorIdList,
   .getActiveAnchorIdList = getActiveAnchorIdList,
+  .setDefaultAnchorPosition = setDefaultAnchorPosition,
+  .getLinkStatsTable = getLinkStatsTable,
 };
 
 // Применить новые опции
@@ -60,6 +60,7 @@ for improved position estimation.
 #include "tdoaEngineInstance.h"
 #include "tdoaStats.h"
 #include "estimator.h"
+#include "usec_time.h"
 
 #include "libdw1000.h"
 #include "mac.h"
@@ -75,6 +76,13 @@ for improved position estimation.
 #define DEBUG_MODULE "TDOA3"
 #include "debug.h"
 #include "cfassert.h"
+#include "eventtrigger.h"
+
+// Received TDoA3 packets, for instance to replay them through the TDoA engine on the host, see
+// bindings/util/tdoa_replay.py and bindings/util/clock_correction_benchmark.py. The time stamps are truncated to the
+// 32 bits used by the TDoA engine. tdoa3Pkt is followed by one tdoa3Remote for each remote anchor in the packet.
+EVENTTRIGGER(tdoa3Pkt, uint8, id, uint32, rx, uint32, tx, uint8, seq)
+EVENTTRIGGER(tdoa3Remote, uint8, id, uint8, pktSeq, uint8, remoteId, uint8, seq, uint32, rx, uint16, tof)
 
 // Positions for sent LPP packets
 #define LPS_TDOA3_TYPE 0
@@ -159,6 +167,9 @@ static struct {
 
   bool isTdoaActive;
 
+  // Time of the packet being processed, shared by all TDoA measurements extracted from it
+  uint32_t packetEventTimeUs;
+
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
 
   // Hybrid mode transmission information
@@ -212,6 +223,14 @@ static int updateRemoteData(tdoaAnchorContext_t* anchorCtx, const void* payload)
   for (uint8_t i = 0; i < packet->header.remoteCount; i++) {
     remoteAnchorDataFull_t* anchorData = (remoteAnchorDataFull_t*)anchorDataPtr;
 
+    eventTrigger_tdoa3Remote_payload.id = tdoaStorageGetId(anchorCtx);
+    eventTrigger_tdoa3Remote_payload.pktSeq = packet->header.seq & 0x7f;
+    eventTrigger_tdoa3Remote_payload.remoteId = anchorData->id;
+    eventTrigger_tdoa3Remote_payload.seq = anchorData->seq;
+    eventTrigger_tdoa3Remote_payload.rx = anchorData->rxTimeStamp;
+    eventTrigger_tdoa3Remote_payload.tof = ((anchorData->seq & 0x80) != 0) ? anchorData->distance : 0;
+    eventTrigger(&eventTrigger_tdoa3Remote);
+
     uint8_t remoteId = anchorData->id;
     int64_t remoteRxTime = anchorData->rxTimeStamp;
     uint8_t remoteSeqNr = anchorData->seq & 0x7f;
@@ -289,7 +308,14 @@ static void rxcallback(dwDevice_t *dev) {
     const int64_t txAn_in_cl_An = packet->header.txTimeStamp;
     const uint8_t seqNr = packet->header.seq & 0x7f;
 
+    eventTrigger_tdoa3Pkt_payload.id = anchorId;
+    eventTrigger_tdoa3Pkt_payload.rx = (uint32_t)rxAn_by_T_in_cl_T;
+    eventTrigger_tdoa3Pkt_payload.tx = (uint32_t)txAn_in_cl_An;
+    eventTrigger_tdoa3Pkt_payload.seq = seqNr;
+    eventTrigger(&eventTrigger_tdoa3Pkt);
+
     uint32_t now_ms = T2M(xTaskGetTickCount());
+    ctx.packetEventTimeUs = (uint32_t)locoDeckGetIrqTimestampUs();
     tdoaAnchorContext_t anchorCtx;
     tdoaEngineGetAnchorCtxForPacketProcessing(&tdoaEngineState, anchorId, now_ms, &anchorCtx);
     int rangeDataLength = updateRemoteData(&anchorCtx, packet);
@@ -439,7 +465,7 @@ static int populateTxData(rangePacket3_t *rangePacket, const uint32_t now_ms) {
   // Consider a more clever selection of which anchors to include as remote data.
   // This implementation will give a somewhat randomized set but can probably be improved
   uint8_t ids[MAX_NR_OF_ANCHORS_IN_TX];
-  uint8_t anchorCount = tdoaStorageGetListOfActiveAnchorIds(tdoaEngineState.anchorInfoArray, ids, MAX_NR_OF_ANCHORS_IN_TX, now_ms);
+  uint8_t anchorCount = tdoaStorageGetListOfActiveAnchorIds(&tdoaEngineState.anchorStorage, ids, MAX_NR_OF_ANCHORS_IN_TX, now_ms);
 
   for (uint8_t i = 0; i < anchorCount; i++) {
     remoteAnchorDataFull_t* anchorData = (remoteAnchorDataFull_t*) anchorDataPtr;
@@ -448,7 +474,7 @@ static int populateTxData(rangePacket3_t *rangePacket, const uint32_t now_ms) {
 
     uint8_t id = ids[i];
     tdoaAnchorContext_t anchorCtx;
-    tdoaStorageGetAnchorCtx(tdoaEngineState.anchorInfoArray, id, now_ms, &anchorCtx);
+    tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, id, now_ms, &anchorCtx);
 
     anchorData->id = id;
     anchorData->seq = tdoaStorageGetSeqNr(&anchorCtx);
@@ -620,6 +646,10 @@ static void sendTdoaToEstimatorCallback(tdoaMeasurement_t* tdoaMeasurement) {
     // Override the default standard deviation set by the TDoA engine.
     tdoaMeasurement->stdDev = ctx.tdoaStdDev;
 
+    // The packet is processed when it is received, the time when processing started is a good approximation of the
+    // time of the measurement. All measurements from one packet get the same time which makes it possible for the
+    // estimator to process them as a batch.
+    tdoaMeasurement->eventTimeUs = ctx.packetEventTimeUs;
     estimatorEnqueueTDOA(tdoaMeasurement);
 
     #ifdef CONFIG_DECK_LOCO_2D_POSITION
@@ -636,7 +666,7 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
   tdoaAnchorContext_t anchorCtx;
   uint32_t now_ms = T2M(xTaskGetTickCount());
 
-  bool contextFound = tdoaStorageGetAnchorCtx(tdoaEngineState.anchorInfoArray, anchorId, now_ms, &anchorCtx);
+  bool contextFound = tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, anchorId, now_ms, &anchorCtx);
   if (contextFound) {
     tdoaStorageGetAnchorPosition(&anchorCtx, position);
     return true;
@@ -646,12 +676,31 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
 }
 
 static uint8_t getAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
-  return tdoaStorageGetListOfAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize);
+  return tdoaStorageGetListOfAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize);
 }
 
 static uint8_t getActiveAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
   uint32_t now_ms = T2M(xTaskGetTickCount());
-  return tdoaStorageGetListOfActiveAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize, now_ms);
+  return tdoaStorageGetListOfActiveAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize, now_ms);
+}
+
+static size_t getLinkStatsTable(uint8_t* buffer, const size_t bufferSize) {
+  uint32_t now_ms = T2M(xTaskGetTickCount());
+  return tdoaStatsSerializeLinkTable(&tdoaEngineState.anchorStorage, now_ms, buffer, bufferSize);
+}
+
+static void setDefaultAnchorPosition(const uint8_t anchorId, const point_t* position) {
+  tdoaAnchorContext_t anchorCtx;
+  uint32_t now_ms = T2M(xTaskGetTickCount());
+
+  // Only anchors that have been heard, anchors that are not in range should not take up space in the storage.
+  // The table is applied periodically, which keeps the position valid while the anchor is heard.
+  if (tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, anchorId, now_ms, &anchorCtx)) {
+    point_t current;
+    if (!tdoaStorageGetAnchorPosition(&anchorCtx, &current)) {
+      tdoaStorageSetAnchorPosition(&anchorCtx, position->x, position->y, position->z);
+    }
+  }
 }
 
 static void Initialize(dwDevice_t *dev) {
@@ -706,6 +755,8 @@ uwbAlgorithm_t uwbTdoa3TagAlgorithm = {
   .getAnchorPosition = getAnchorPosition,
   .getAnchorIdList = getAnchorIdList,
   .getActiveAnchorIdList = getActiveAnchorIdList,
+  .setDefaultAnchorPosition = setDefaultAnchorPosition,
+  .getLinkStatsTable = getLinkStatsTable,
 };
 
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
@@ -0,0 +1,209 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsTwrScheduler.c: Selects which anchor to range next in TWR
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "lpsTwrScheduler.h"
+
+static bool isAvailable(const lpsTwrSchedulerAnchor_t* anchor, const uint32_t nowMs);
+static uint8_t selectRoundRobin(const lpsTwrScheduler_t* this, const uint32_t nowMs);
+static uint8_t selectFirstToResume(const lpsTwrScheduler_t* this);
+static float varianceAlongLineOfSight(const point_t* tagPos, const float posCov[3][3], const point_t* anchorPos);
+
+void lpsTwrSchedulerInit(lpsTwrScheduler_t* this, const uint8_t anchorCount, const uint8_t failureThreshold) {
+  memset(this, 0, sizeof(lpsTwrScheduler_t));
+
+  this->anchorCount = anchorCount;
+  if (this->anchorCount > LPS_TWR_SCHEDULER_MAX_ANCHORS) {
+    this->anchorCount = LPS_TWR_SCHEDULER_MAX_ANCHORS;
+  }
+
+  this->failureThreshold = failureThreshold;
+  this->burstSize = 1;
+
+  for (int i = 0; i < this->anchorCount; i++) {
+    this->anchors[i].suspendTimeMs = LPS_TWR_SCHEDULER_SUSPEND_MIN_MS;
+  }
+}
+
+void lpsTwrSchedulerSetBurstSize(lpsTwrScheduler_t* this, const uint8_t burstSize) {
+  this->burstSize = burstSize > 0 ? burstSize : 1;
+  if (this->burstRemaining >= this->burstSize) {
+    this->burstRemaining = this->burstSize - 1;
+  }
+}
+
+void lpsTwrSchedulerReportResult(lpsTwrScheduler_t* this, const uint8_t anchor, const bool success, const uint32_t nowMs) {
+  if (anchor >= this->anchorCount) {
+    return;
+  }
+
+  lpsTwrSchedulerAnchor_t* state = &this->anchors[anchor];
+  state->lastAttemptMs = nowMs;
+
+  if (success) {
+    state->consecutiveFailures = 0;
+    state->isSuspended = false;
+    state->suspendTimeMs = LPS_TWR_SCHEDULER_SUSPEND_MIN_MS;
+    return;
+  }
+
+  if (state->consecutiveFailures < UINT8_MAX) {
+    state->consecutiveFailures++;
+  }
+
+  if (state->consecutiveFailures >= this->failureThreshold) {
+    // A failed probe of an already suspended anchor doubles the suspension time
+    if (state->isSuspended && state->suspendTimeMs < LPS_TWR_SCHEDULER_SUSPEND_MAX_MS) {
+      state->suspendTimeMs *= 2;
+    }
+
+    state->isSuspended = true;
+    state->suspendedUntilMs = nowMs + state->suspendTimeMs;
+
+    // No point in continuing a burst with a failing anchor
+    if (anchor == this->current) {
+      this->burstRemaining = 0;
+    }
+  }
+}
+
+uint8_t lpsTwrSchedulerNext(lpsTwrScheduler_t* this, const lpsTwrSchedulerMode_t mode, const point_t* tagPos, const float posCov[3][3], const point_t anchorPositions[], const uint32_t positionValidMask, const uint32_t nowMs) {
+  if (this->anchorCount == 0) {
+    return 0;
+  }
+
+  if (this->burstRemaining > 0 && isAvailable(&this->anchors[this->current], nowMs)) {
+    this->burstRemaining--;
+    return this->current;
+  }
+
+  int selected = -1;
+
+  const bool canUseGeometry = (mode == lpsTwrSchedulerModeAdaptive) && tagPos && posCov && (positionValidMask != 0);
+  if (canUseGeometry) {
+    // Anchors that have not been ranged for a long time come first, oldest first
+    uint32_t oldestAge = 0;
+    for (int i = 0; i < this->anchorCount; i++) {
+      const lpsTwrSchedulerAnchor_t* anchor = &this->anchors[i];
+      const uint32_t age = nowMs - anchor->lastAttemptMs;
+      if (isAvailable(anchor, nowMs) && age >= LPS_TWR_SCHEDULER_MAX_AGE_MS && age > oldestAge) {
+        oldestAge = age;
+        selected = i;
+      }
+    }
+
+    if (selected < 0) {
+      // Pick the anchor with the largest expected information gain. Search from the anchor after the current one to
+      // break ties in round robin order.
+      float bestGain = -1.0f;
+      for (int n = 1; n <= this->anchorCount; n++) {
+        const int i = (this->current + n) % this->anchorCount;
+        if (!isAvailable(&this->anchors[i], nowMs) || !(positionValidMask & (1 << i))) {
+          continue;
+        }
+
+        const float variance = varianceAlongLineOfSight(tagPos, posCov, &anchorPositions[i]);
+        const float measurementVariance = LPS_TWR_SCHEDULER_MEASUREMENT_STD_DEV * LPS_TWR_SCHEDULER_MEASUREMENT_STD_DEV;
+        const float gain = variance / (variance + measurementVariance);
+        if (gain > bestGain) {
+          bestGain = gain;
+          selected = i;
+        }
+      }
+    }
+  }
+
+  if (selected < 0) {
+    selected = selectRoundRobin(this, nowMs);
+  }
+
+  this->current = selected;
+  this->burstRemaining = this->burstSize - 1;
+
+  return this->current;
+}
+
+bool lpsTwrSchedulerIsSuspended(const lpsTwrScheduler_t* this, const uint8_t anchor) {
+  if (anchor >= this->anchorCount) {
+    return false;
+  }
+
+  return this->anchors[anchor].isSuspended;
+}
+
+static bool isAvailable(const lpsTwrSchedulerAnchor_t* anchor, const uint32_t nowMs) {
+  if (!anchor->isSuspended) {
+    return true;
+  }
+
+  // When the suspension time has passed the anchor is probed again
+  return (int32_t)(nowMs - anchor->suspendedUntilMs) >= 0;
+}
+
+static uint8_t selectRoundRobin(const lpsTwrScheduler_t* this, const uint32_t nowMs) {
+  for (int n = 1; n <= this->anchorCount; n++) {
+    const int i = (this->current + n) % this->anchorCount;
+    if (isAvailable(&this->anchors[i], nowMs)) {
+      return i;
+    }
+  }
+
+  return selectFirstToResume(this);
+}
+
+static uint8_t selectFirstToResume(const lpsTwrScheduler_t* this) {
+  uint8_t result = 0;
+  for (int i = 1; i < this->anchorCount; i++) {
+    if ((int32_t)(this->anchors[i].suspendedUntilMs - this->anchors[result].suspendedUntilMs) < 0) {
+      result = i;
+    }
+  }
+
+  return result;
+}
+
+static float varianceAlongLineOfSight(const point_t* tagPos, const float posCov[3][3], const point_t* anchorPos) {
+  const float dx = tagPos->x - anchorPos->x;
+  const float dy = tagPos->y - anchorPos->y;
+  const float dz = tagPos->z - anchorPos->z;
+  const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+  if (distance < 0.0001f) {
+    return 0.0f;
+  }
+
+  const float u[3] = {dx / distance, dy / distance, dz / distance};
+
+  float result = 0.0f;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      result += u[i] * posCov[i][j] * u[j];
+    }
+  }
+
+  return result;
+}
@@ -28,15 +28,18 @@
 
 #include "lpsTwrTag.h"
 #include "lpsTdma.h"
+#include "lpsTwrScheduler.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 
 #include "log.h"
+#include "param.h"
 #include "crtp_localization_service.h"
 
 #include "stabilizer_types.h"
 #include "estimator.h"
+#include "estimator_kalman.h"
 #include "cf_math.h"
 
 #include "physicalConstants.h"
@@ -132,6 +135,12 @@ static dwTime_t frameStart;
 
 static bool rangingOk;
 
+// Anchor scheduling
+static lpsTwrScheduler_t scheduler;
+static uint8_t schedulerMode = lpsTwrSchedulerModeAdaptive;
+static uint8_t burstSize = 1;
+static uint8_t suspendedAnchors;
+
 static void lpsHandleLppShortPacket(const uint8_t srcId, const uint8_t *data);
 
 static void txcallback(dwDevice_t *dev)
@@ -296,6 +305,29 @@ static dwTime_t transmitTimeForSlot(int slot)
   return transmitTime;
 }
 
+static uint8_t selectNextAnchor()
+{
+  const uint32_t now_ms = T2M(xTaskGetTickCount());
+  lpsTwrSchedulerSetBurstSize(&scheduler, burstSize);
+
+  uint32_t positionValidMask = 0;
+  for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (options->combinedAnchorPositionOk || options->anchorPosition[i].timestamp) {
+      positionValidMask |= (1 << i);
+    }
+  }
+
+  if (schedulerMode == lpsTwrSchedulerModeAdaptive && positionValidMask != 0) {
+    point_t tagPos;
+    float posCov[3][3];
+    estimatorKalmanGetEstimatedPos(&tagPos);
+    estimatorKalmanGetEstimatedPosCovariance(posCov);
+    return lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, options->anchorPosition, positionValidMask, now_ms);
+  }
+
+  return lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, options->anchorPosition, positionValidMask, now_ms);
+}
+
 static void initiateRanging(dwDevice_t *dev)
 {
   if (!options->useTdma || tdmaSynchronized) {
@@ -304,10 +336,7 @@ static void initiateRanging(dwDevice_t *dev)
       frameStart.full += TDMA_FRAME_LEN;
     }
 
-    current_anchor ++;
-    if (current_anchor >= LOCODECK_NR_OF_TWR_ANCHORS) {
-      current_anchor = 0;
-    }
+    current_anchor = selectNextAnchor();
   } else {
     current_anchor = 0;
   }
@@ -383,12 +412,16 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
 
           locSrvSendRangeFloat(current_anchor, NAN);
           failedRanging[current_anchor]++;
+          lpsTwrSchedulerReportResult(&scheduler, current_anchor, false, T2M(xTaskGetTickCount()));
         } else {
           rangingState |= (1<<current_anchor);
           state.failedRanging[current_anchor] = 0;
 
           locSrvSendRangeFloat(current_anchor, state.distance[current_anchor]);
           succededRanging[current_anchor]++;
+          if (ranging_complete && !lpp_transaction) {
+            lpsTwrSchedulerReportResult(&scheduler, current_anchor, true, T2M(xTaskGetTickCount()));
+          }
         }
         locoDeckSetRangingState(rangingState);
       }
@@ -408,6 +441,13 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
           failedRanging[i] = 0;
           succededRanging[i] = 0;
         }
+
+        suspendedAnchors = 0;
+        for (int i=0; i<LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+          if (lpsTwrSchedulerIsSuspended(&scheduler, i)) {
+            suspendedAnchors |= (1 << i);
+          }
+        }
       }
 
 
@@ -480,6 +520,7 @@ static void twrTagInit(dwDevice_t *dev)
 
   curr_seq = 0;
   current_anchor = 0;
+  lpsTwrSchedulerInit(&scheduler, LOCODECK_NR_OF_TWR_ANCHORS, options->rangingFailedThreshold);
 
   locoDeckSetRangingState(0);
   ranging_complete = false;
@@ -531,7 +572,7 @@ static uint8_t getActiveAnchorIdList(uint8_t unorderedAnchorList[], const int ma
   uint8_t count = 0;
 
   for (int i = 0; i < LOCODECK_NR_OF_TWR_ANCHORS; i++) {
-    if (state.failedRanging[i] < options->rangingFailedThreshold) {
+    if (state.failedRanging[i] < options->rangingFailedThreshold && !lpsTwrSchedulerIsSuspended(&scheduler, i)) {
       unorderedAnchorList[count] = i;
       count++;
     }
@@ -540,6 +581,15 @@ static uint8_t getActiveAnchorIdList(uint8_t unorderedAnchorList[], const int ma
   return count;
 }
 
+static void setDefaultAnchorPosition(const uint8_t anchorId, const point_t* position) {
+  if (anchorId < LOCODECK_NR_OF_TWR_ANCHORS && options->anchorPosition[anchorId].timestamp == 0) {
+    options->anchorPosition[anchorId].timestamp = xTaskGetTickCount();
+    options->anchorPosition[anchorId].x = position->x;
+    options->anchorPosition[anchorId].y = position->y;
+    options->anchorPosition[anchorId].z = position->z;
+  }
+}
+
 uwbAlgorithm_t uwbTwrTagAlgorithm = {
   .init = twrTagInit,
   .onEvent = twrTagOnEvent,
@@ -547,6 +597,7 @@ uwbAlgorithm_t uwbTwrTagAlgorithm = {
   .getAnchorPosition = getAnchorPosition,
   .getAnchorIdList = getAnchorIdList,
   .getActiveAnchorIdList = getActiveAnchorIdList,
+  .setDefaultAnchorPosition = setDefaultAnchorPosition,
 };
 
 /**
@@ -613,8 +664,54 @@ LOG_ADD(LOG_UINT8, rangingSuccessRate5, &rangingSuccessRate[5])
  * @brief Ranging attempt rate with anchor 5 [1/s]
  */
 LOG_ADD(LOG_UINT8, rangingPerSec5, &rangingPerSec[5])
+
+/**
+ * @brief Successful ranging ratio with anchor 6 [%]
+ */
+LOG_ADD(LOG_UINT8, rangingSuccessRate6, &rangingSuccessRate[6])
+
+/**
+ * @brief Ranging attempt rate with anchor 6 [1/s]
+ */
+LOG_ADD(LOG_UINT8, rangingPerSec6, &rangingPerSec[6])
+
+/**
+ * @brief Successful ranging ratio with anchor 7 [%]
+ */
+LOG_ADD(LOG_UINT8, rangingSuccessRate7, &rangingSuccessRate[7])
+
+/**
+ * @brief Ranging attempt rate with anchor 7 [1/s]
+ */
+LOG_ADD(LOG_UINT8, rangingPerSec7, &rangingPerSec[7])
+
+/**
+ * @brief Bit field of anchors that are suspended by the scheduler due to repeated failures
+ */
+LOG_ADD(LOG_UINT8, suspended, &suspendedAnchors)
 LOG_GROUP_STOP(twr)
 
+/**
+ * Two Way Ranging anchor scheduling
+ */
+PARAM_GROUP_START(twr)
+
+/**
+ * @brief Anchor scheduling (0 = round robin, 1 = adaptive, default 1)
+ *
+ * In adaptive mode the anchor that is expected to reduce the position uncertainty the most is ranged next, based on the
+ * geometry and the position covariance of the kalman estimator. Anchors that have not been ranged for 500 ms are ranged
+ * first. Anchors without a known position are ranged in this way too, to pick up positions sent by the anchors.
+ */
+PARAM_ADD(PARAM_UINT8, sched, &schedulerMode)
+
+/**
+ * @brief Number of consecutive rangings with an anchor every time it is selected (default 1)
+ */
+PARAM_ADD(PARAM_UINT8, burst, &burstSize)
+
+PARAM_GROUP_STOP(twr)
+
 /**
  * Log group for distances (ranges) to anchors aquired by Two Way Ranging (TWR)
  */
@@ -40,6 +40,9 @@
 #include "task.h"
 
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "autoconf.h"
 
 static bool isInit = false;
 static bool isTested = false;
@@ -58,6 +61,37 @@ NO_DMA_CCM_SAFE_ZERO_INIT static VL53L1_Dev_t devUp;
 NO_DMA_CCM_SAFE_ZERO_INIT static VL53L1_Dev_t devLeft;
 NO_DMA_CCM_SAFE_ZERO_INIT static VL53L1_Dev_t devRight;
 
+#ifdef CONFIG_DECK_MULTIRANGER_RATE_HZ
+#define MR_RATE_HZ CONFIG_DECK_MULTIRANGER_RATE_HZ
+#else
+#define MR_RATE_HZ 10
+#endif
+#define MR_PERIOD_MS (1000 / MR_RATE_HZ)
+// Time reserved in each period for reading out and restarting a sensor
+#define MR_BUDGET_MARGIN_MS 5
+// The long distance mode needs a timing budget of at least 33 ms
+#define MR_LONG_MODE_MIN_TIMING_BUDGET_US 33000
+// Poll interval when a range is not ready at the expected time
+#define MR_POLL_RETRY_MS 1
+// A sensor that has not produced a range for this long is restarted
+#define MR_STALL_TIMEOUT_MS (4 * MR_PERIOD_MS)
+
+typedef struct {
+    VL53L1_Dev_t* dev;
+    rangeDirection_t direction;
+    TickType_t startTime;
+    TickType_t nextPollTime;
+} mrSensor_t;
+
+static mrSensor_t sensors[] = {
+    {.dev = &devFront, .direction = rangeFront},
+    {.dev = &devBack, .direction = rangeBack},
+    {.dev = &devUp, .direction = rangeUp},
+    {.dev = &devLeft, .direction = rangeLeft},
+    {.dev = &devRight, .direction = rangeRight},
+};
+#define MR_SENSOR_COUNT ((int)(sizeof(sensors) / sizeof(sensors[0])))
+
 static bool mrInitSensor(VL53L1_Dev_t *pdev, uint32_t pca95pin, char *name)
 {
     bool status;
@@ -81,66 +115,105 @@ static bool mrInitSensor(VL53L1_Dev_t *pdev, uint32_t pca95pin, char *name)
     return status;
 }
 
-static uint16_t mrGetMeasurementAndRestart(VL53L1_Dev_t *dev)
+static uint16_t mrGetRange(const VL53L1_RangingMeasurementData_t* rangingData)
 {
-    VL53L1_Error status = VL53L1_ERROR_NONE;
-    VL53L1_RangingMeasurementData_t rangingData;
-    uint8_t dataReady = 0;
-    uint16_t range;
+    if (filterMask & (1 << rangingData->RangeStatus))
+    {
+        return rangingData->RangeMilliMeter;
+    }
+    else
+    {
+        return 32767;
+    }
+}
 
-    while (dataReady == 0)
+static void mrStartSensor(mrSensor_t* sensor, const TickType_t now)
+{
+    VL53L1_StopMeasurement(sensor->dev);
+    VL53L1_StartMeasurement(sensor->dev);
+    sensor->startTime = now;
+    sensor->nextPollTime = now + M2T(MR_PERIOD_MS);
+}
+
+static void mrConfigureSensor(mrSensor_t* sensor)
+{
+    const uint32_t timingBudgetUs = (MR_PERIOD_MS - MR_BUDGET_MARGIN_MS) * 1000;
+
+    VL53L1_StopMeasurement(sensor->dev);
+    if (timingBudgetUs < MR_LONG_MODE_MIN_TIMING_BUDGET_US)
     {
-        status = VL53L1_GetMeasurementDataReady(dev, &dataReady);
-        vTaskDelay(M2T(1));
+        VL53L1_SetDistanceMode(sensor->dev, VL53L1_DISTANCEMODE_MEDIUM);
     }
+    VL53L1_SetMeasurementTimingBudgetMicroSeconds(sensor->dev, timingBudgetUs);
+}
 
-    status = VL53L1_GetRangingMeasurementData(dev, &rangingData);
+/**
+ * Check a sensor without blocking. If the range is ready, it is read and reported and the next
+ * measurement is started, otherwise the sensor is polled again shortly.
+ */
+static void mrPollSensor(mrSensor_t* sensor, const TickType_t now)
+{
+    uint8_t dataReady = 0;
+    VL53L1_GetMeasurementDataReady(sensor->dev, &dataReady);
 
-    if (filterMask & (1 << rangingData.RangeStatus))
+    if (dataReady)
     {
-        range = rangingData.RangeMilliMeter;
+        VL53L1_RangingMeasurementData_t rangingData;
+        if (VL53L1_GetRangingMeasurementData(sensor->dev, &rangingData) == VL53L1_ERROR_NONE)
+        {
+            rangeSetWithTimestamp(sensor->direction, mrGetRange(&rangingData) / 1000.0f, now);
+        }
+        mrStartSensor(sensor, now);
+    }
+    else if ((int32_t)(now - sensor->startTime) > (int32_t)M2T(MR_STALL_TIMEOUT_MS))
+    {
+        // No data for a long time, restart the measurement
+        mrStartSensor(sensor, now);
     }
     else
     {
-        range = 32767;
+        sensor->nextPollTime = now + M2T(MR_POLL_RETRY_MS);
     }
-
-    VL53L1_StopMeasurement(dev);
-    status = VL53L1_StartMeasurement(dev);
-    status = status;
-
-    return range;
 }
 
 static void mrTask(void *param)
 {
-    VL53L1_Error status = VL53L1_ERROR_NONE;
-
     systemWaitStart();
 
-    // Restart all sensors
-    status = VL53L1_StopMeasurement(&devFront);
-    status = VL53L1_StartMeasurement(&devFront);
-    status = VL53L1_StopMeasurement(&devBack);
-    status = VL53L1_StartMeasurement(&devBack);
-    status = VL53L1_StopMeasurement(&devUp);
-    status = VL53L1_StartMeasurement(&devUp);
-    status = VL53L1_StopMeasurement(&devLeft);
-    status = VL53L1_StartMeasurement(&devLeft);
-    status = VL53L1_StopMeasurement(&devRight);
-    status = VL53L1_StartMeasurement(&devRight);
-    status = status;
-
-    TickType_t lastWakeTime = xTaskGetTickCount();
+    // Start the sensors staggered over the period to spread the bus load
+    for (int i = 0; i < MR_SENSOR_COUNT; i++)
+    {
+        mrConfigureSensor(&sensors[i]);
+        mrStartSensor(&sensors[i], xTaskGetTickCount());
+        vTaskDelay(M2T(MR_PERIOD_MS / MR_SENSOR_COUNT));
+    }
 
     while (1)
     {
-        vTaskDelayUntil(&lastWakeTime, M2T(100));
-        rangeSet(rangeFront, mrGetMeasurementAndRestart(&devFront) / 1000.0f);
-        rangeSet(rangeBack, mrGetMeasurementAndRestart(&devBack) / 1000.0f);
-        rangeSet(rangeUp, mrGetMeasurementAndRestart(&devUp) / 1000.0f);
-        rangeSet(rangeLeft, mrGetMeasurementAndRestart(&devLeft) / 1000.0f);
-        rangeSet(rangeRight, mrGetMeasurementAndRestart(&devRight) / 1000.0f);
+        // Sleep until the next sensor is expected to be ready
+        TickType_t now = xTaskGetTickCount();
+        int32_t timeToNextPoll = INT32_MAX;
+        for (int i = 0; i < MR_SENSOR_COUNT; i++)
+        {
+            const int32_t timeToPoll = (int32_t)(sensors[i].nextPollTime - now);
+            if (timeToPoll < timeToNextPoll)
+            {
+                timeToNextPoll = timeToPoll;
+            }
+        }
+        if (timeToNextPoll > 0)
+        {
+            vTaskDelay(timeToNextPoll);
+        }
+
+        now = xTaskGetTickCount();
+        for (int i = 0; i < MR_SENSOR_COUNT; i++)
+        {
+            if ((int32_t)(sensors[i].nextPollTime - now) <= 0)
+            {
+                mrPollSensor(&sensors[i], now);
+            }
+        }
     }
 }
 
@@ -33,6 +33,7 @@
 #include "deck.h"
 #include "debug.h"
 #include "log.h"
+#include "rpm.h"
 
 //Hardware configuration
 #define ET_GPIO_PERIF   (RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB | RCC_AHB1Periph_GPIOC)
@@ -306,6 +307,14 @@ void __attribute__((used)) TIM3_IRQHandler(void)
   }
 }
 
+void rpmDeckGetRpm(float* rpm)
+{
+  rpm[0] = m1rpm;
+  rpm[1] = m2rpm;
+  rpm[2] = m3rpm;
+  rpm[3] = m4rpm;
+}
+
 static const DeckDriver rpm_deck = {
   .vid = 0x00,
   .pid = 0x00,
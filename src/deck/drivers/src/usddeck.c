@@ -86,7 +86,8 @@
 #define USD_SPI_BAUDRATE_2MHZ   SPI_BAUDRATE_2MHZ
 #define USD_SPI_BAUDRATE_21MHZ  SPI_BAUDRATE_21MHZ
 #define SPI_EXCHANGE            spiExchange
-#define SPI_BEGIN_TRANSACTION   spiBeginTransaction
+// The uSD card must not delay the other decks on the bus, see SD_disk_write()
+#define SPI_BEGIN_TRANSACTION(speed) spiBeginTransactionWithPriority(speed, spiPriorityBulk, spiUserUsd)
 #define SPI_END_TRANSACTION     spiEndTransaction
 #endif
 
@@ -95,15 +96,52 @@
 #define FIXED_FREQUENCY_EVENT_ID          (0xFFFF)
 #define FIXED_FREQUENCY_EVENT_NAME        "fixedFrequency"
 
+// Log data is written to the card in whole chunks of sectors, so that FatFS
+// can stream them straight from the chunk with a single multi-block write.
+#define USD_SECTOR_SIZE                   (512)
+#define USD_WRITE_CHUNK_SECTORS           (4)
+#define USD_WRITE_CHUNK_SIZE              (USD_SECTOR_SIZE * USD_WRITE_CHUNK_SECTORS)
+
+// Files are downloaded through the memory subsystem while logging is stopped.
+// The write chunk is then unused and holds the read-ahead cache.
+#define USD_READ_CACHE_SIZE               USD_WRITE_CHUNK_SIZE
+#define USD_DIR_VERSION                   (1)
+#define USD_DIR_HEADER_SIZE               (3)
+#define USD_DIR_NAME_SIZE                 (13)
+#define USD_DIR_ENTRY_SIZE                (USD_DIR_NAME_SIZE + 4)
+
+#define USD_CONFIG_FILE                   "config.txt"
+#ifdef CONFIG_DECK_USD_COMPILED_CONFIG
+// The resolved configuration, loaded instead of parsing the config file. Valid
+// for the config file with the same CRC and the firmware with the same log TOC.
+#define USD_COMPILED_CONFIG_FILE          "config.bin"
+#define USD_COMPILED_CONFIG_VERSION       (1)
+#define USD_COMPILED_EVENT_NAME_SIZE      (32)
+#endif
+
+#ifdef CONFIG_DECK_USD_COMPRESSED
+#define USD_LOG_FORMAT_VERSION            (3)
+// Event trigger payloads have at most 5 variables of up to 4 bytes
+#define MAX_USD_EVENT_DATA_SIZE           (5 * 4 + MAX_USD_LOG_VARIABLES_PER_EVENT * 4)
+// Tag and timestamp varints plus one varint of up to 5 bytes per variable
+#define MAX_USD_COMPRESSED_EVENT_SIZE     (3 + 10 + (5 + MAX_USD_LOG_VARIABLES_PER_EVENT) * 5)
+#else
+#define USD_LOG_FORMAT_VERSION            (2)
+#endif
+
 
 /* set to true when graceful shutdown is triggered */
 static volatile bool in_shutdown = false;
 
 typedef struct usdLogEventConfig_s {
   uint16_t eventId;
+  // Event trigger providing the payload, NULL for fixed frequency logging
+  const eventtrigger *trigger;
   uint8_t numVars;
   uint16_t numBytes;
   logVarId_t varIds[MAX_USD_LOG_VARIABLES_PER_EVENT];
+  // Lazy log groups used by the event, see logLazyGroupMask()
+  uint32_t lazyGroups;
 } usdLogEventConfig_t;
 
 typedef struct usdLogConfig_s {
@@ -118,6 +156,37 @@ typedef struct usdLogConfig_s {
   uint8_t fixedFrequencyEventIdx;
 } usdLogConfig_t;
 
+#ifdef CONFIG_DECK_USD_COMPRESSED
+// Per event state of the compressed encoding
+typedef struct usdCompressState_s {
+  uint64_t lastTicks;
+  uint16_t sinceKeyframe;
+  uint8_t lastData[MAX_USD_EVENT_DATA_SIZE];
+} usdCompressState_t;
+#endif
+
+#ifdef CONFIG_DECK_USD_COMPILED_CONFIG
+typedef struct {
+  uint8_t version;
+  uint32_t configCrc;
+  uint32_t logTocCrc;
+  uint16_t bufferSize;
+  char filename[13];
+  uint16_t frequency;
+  uint8_t enableOnStartup;
+  uint8_t mode;
+  uint8_t numEventConfigs;
+  uint8_t fixedFrequencyEventIdx;
+} __attribute__((packed)) usdCompiledConfigHeader_t;
+
+// Event triggers are stored by name, their ids are not covered by the log TOC CRC
+typedef struct {
+  char eventName[USD_COMPILED_EVENT_NAME_SIZE];
+  uint8_t numVars;
+  logVarId_t varIds[MAX_USD_LOG_VARIABLES_PER_EVENT];
+} __attribute__((packed)) usdCompiledEventConfig_t;
+#endif
+
 typedef struct usdLogStats_s {
   uint32_t eventsRequested;
   uint32_t eventsWritten;
@@ -130,7 +199,6 @@ typedef struct ringBuffer_s {
   uint16_t size;          // used size of buffer
   uint8_t* readPtr;       // pointer for read/pop
   uint8_t* writePtr;      // pointer for write/push
-  uint16_t popSize;       // size for ongoing pop operation
 } ringBuffer_t;
 
 void ringBuffer_init(ringBuffer_t* b, uint8_t *buffer, uint16_t capacity)
@@ -140,7 +208,6 @@ void ringBuffer_init(ringBuffer_t* b, uint8_t *buffer, uint16_t capacity)
   b->size = 0;
   b->readPtr = buffer;
   b->writePtr = buffer;
-  b->popSize = 0;
 }
 
 void ringBuffer_reset(ringBuffer_t *b)
@@ -148,7 +215,6 @@ void ringBuffer_reset(ringBuffer_t *b)
   b->size = 0;
   b->readPtr = b->buffer;
   b->writePtr = b->buffer;
-  b->popSize = 0;
 }
 
 uint16_t ringBuffer_availableSpace(const ringBuffer_t* b)
@@ -173,30 +239,19 @@ bool ringBuffer_push(ringBuffer_t* b, const void* data, uint16_t size)
   return true;
 }
 
-bool ringBuffer_pop_start(ringBuffer_t* b, const uint8_t** buf, uint16_t* size)
+// Copy up to maxSize bytes out of the buffer and release the space right away
+uint16_t ringBuffer_pop(ringBuffer_t* b, uint8_t* data, uint16_t maxSize)
 {
-  if (b->size == 0) {
-    return false;
-  }
-
-  *buf = b->readPtr;
-  if (b->writePtr > b->readPtr) {
-    // writer did not wrap around yet
-    *size = b->writePtr - b->readPtr;
-    b->readPtr = b->writePtr;
-  } else {
-    // wrap around -> read until end of buffer, only
-    *size = b->buffer + b->capacity - b->readPtr;
-    b->readPtr = b->buffer;
+  uint16_t size = b->size < maxSize ? b->size : maxSize;
+  for (uint16_t i = 0; i < size; ++i) {
+    data[i] = *(b->readPtr);
+    ++b->readPtr;
+    if (b->readPtr == b->buffer + b->capacity) {
+      b->readPtr = b->buffer;
+    }
   }
-  b->popSize = *size;
-  return true;
-}
-
-void ringBuffer_pop_done(ringBuffer_t *b)
-{
-  b->size -= b->popSize;
-  b->popSize = 0;
+  b->size -= size;
+  return size;
 }
 
 // FATFS low lever driver functions.
@@ -220,6 +275,13 @@ static STATS_CNT_RATE_DEFINE(fatWriteRate, 1000);
 static usdLogConfig_t usdLogConfig;
 static usdLogStats_t usdLogStats;
 
+#ifdef CONFIG_DECK_USD_COMPRESSED
+// Protected by logBufferMutex
+static usdCompressState_t usdCompressState[MAX_USD_LOG_EVENTS];
+static uint8_t compressData[MAX_USD_EVENT_DATA_SIZE];
+static uint8_t compressOut[MAX_USD_COMPRESSED_EVENT_SIZE];
+#endif
+
 static BYTE exchangeBuff[512];
 static uint16_t spiSpeed;
 
@@ -237,8 +299,38 @@ static SemaphoreHandle_t logBufferMutex;
 static ringBuffer_t logBuffer;
 static TaskHandle_t xHandleWriteTask;
 
+// Staging chunk for the writer task, must be in DMA capable memory
+static uint8_t writeChunk[USD_WRITE_CHUNK_SIZE];
+static uint16_t writeChunkFill;
+static uint32_t writeLatencyMax;
+
+#ifdef CONFIG_DECK_USD_STREAMING
+// Streaming to a preallocated file, see usdStreamStart()
+static bool streamMode;
+static LBA_t streamSector;      // next sector to write
+static LBA_t streamSectorEnd;   // first sector after the preallocated area
+static FSIZE_t streamLength;    // bytes of log data in the file
+#endif
+
 static bool enableLogging;
 static uint32_t lastFileSize = 0;
+
+// Download state, protected by logFileMutex. The latest log file is
+// downloaded when no file is selected.
+static char downloadFilename[USD_DIR_NAME_SIZE];
+static uint32_t downloadFileSize;
+static uint32_t readCacheOffset;
+static uint16_t readCacheLength;
+static uint32_t readCacheHits;
+static uint32_t readCacheMisses;
+static STATS_CNT_RATE_DEFINE(downloadRate, 1000);
+
+// Directory listing, see handleMemDirRead()
+static uint16_t dirCount;
+static DIR dirObj;
+static FILINFO dirInfo;
+static int dirCursor = -1;    // number of listed files read from dirObj, -1 when not open
+static uint8_t dirEntry[USD_DIR_ENTRY_SIZE];  // the file at dirCursor - 1
 static crc32Context_t crcContext;
 
 static xTimerHandle timer;
@@ -256,6 +348,16 @@ static const MemoryHandlerDef_t memDef = {
   .write = 0, // Write not supported
 };
 
+static uint32_t handleMemDirGetSize(void);
+static bool handleMemDirRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
+static bool handleMemDirWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer);
+static const MemoryHandlerDef_t memDirDef = {
+  .type = MEM_TYPE_USD_DIR,
+  .getSize = handleMemDirGetSize,
+  .read = handleMemDirRead,
+  .write = handleMemDirWrite,
+};
+
 
 // Low lever driver functions
 static sdSpiContext_t sdSpiContext =
@@ -455,6 +557,7 @@ static void usdInit(DeckInfo *info)
 {
   if (!isInit) {
     memoryRegisterHandler(&memDef);
+    memoryRegisterHandler(&memDirDef);
 
     logFileMutex = xSemaphoreCreateMutex();
     logBufferMutex = xSemaphoreCreateMutex();
@@ -475,10 +578,104 @@ static void usdInit(DeckInfo *info)
   isInit = true;
 }
 
-static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t* payload, uint8_t payloadSize)
+#ifdef CONFIG_DECK_USD_COMPRESSED
+static uint8_t payloadTypeSize(enum eventtriggerType_e type)
 {
-  uint64_t ticks = usecTimestamp();
+  switch (type) {
+  case eventtriggerType_uint8:
+  case eventtriggerType_int8:
+    return 1;
+  case eventtriggerType_uint16:
+  case eventtriggerType_int16:
+  case eventtrigerType_fp16:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+static uint8_t varintEncode(uint8_t* out, uint64_t value)
+{
+  uint8_t len = 0;
+  while (value >= 0x80) {
+    out[len++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[len++] = value;
+  return len;
+}
+
+// Zig-zag encoded difference of two values of the given size, wrapping in that size
+static uint32_t zigzagDelta(const uint8_t* current, const uint8_t* last, uint8_t size)
+{
+  uint32_t a = 0;
+  uint32_t b = 0;
+  memcpy(&a, current, size);
+  memcpy(&b, last, size);
+
+  const uint8_t shift = 32 - 8 * size;
+  int32_t delta = (int32_t)((a - b) << shift) >> shift;
+  return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
 
+/* Compressed event record (file format version 3):
+ *   varint tag: (event index << 1) | keyframe
+ *   keyframe:   uint64 timestamp, raw data as in version 2
+ *   otherwise:  varint timestamp delta, zig-zag varint delta per variable
+ * Variables are treated as integers of their size, floats by their bit pattern. */
+static void usddeckWriteCompressedEvent(const usdLogEventConfig_t* cfg, uint64_t ticks, const uint8_t* payload, uint8_t payloadSize)
+{
+  const uint8_t index = cfg - usdLogConfig.eventConfigs;
+  usdCompressState_t* state = &usdCompressState[index];
+
+  uint16_t dataSize = payloadSize;
+  if (payloadSize) {
+    memcpy(compressData, payload, payloadSize);
+  }
+  logLazyGroupsPrepare(cfg->lazyGroups);
+  for (int i = 0; i < cfg->numVars; ++i) {
+    logVarId_t varid = cfg->varIds[i];
+    uint8_t size = logVarSize(logGetType(varid));
+    memcpy(&compressData[dataSize], logGetAddress(varid), size);
+    dataSize += size;
+  }
+
+  const bool keyframe = (state->sinceKeyframe == 0);
+  uint16_t len = varintEncode(compressOut, (index << 1) | keyframe);
+  if (keyframe) {
+    memcpy(&compressOut[len], &ticks, sizeof(ticks));
+    len += sizeof(ticks);
+    memcpy(&compressOut[len], compressData, dataSize);
+    len += dataSize;
+  } else {
+    len += varintEncode(&compressOut[len], ticks - state->lastTicks);
+
+    uint16_t offset = 0;
+    const uint8_t numPayloadVariables = cfg->trigger ? cfg->trigger->numPayloadVariables : 0;
+    for (int i = 0; i < numPayloadVariables + cfg->numVars; ++i) {
+      uint8_t size;
+      if (i < numPayloadVariables) {
+        size = payloadTypeSize(cfg->trigger->payloadDesc[i].type);
+      } else {
+        size = logVarSize(logGetType(cfg->varIds[i - numPayloadVariables]));
+      }
+      len += varintEncode(&compressOut[len], zigzagDelta(&compressData[offset], &state->lastData[offset], size));
+      offset += size;
+    }
+  }
+
+  // only write if we have enough space, the state is kept for the next event otherwise
+  if (ringBuffer_push(&logBuffer, compressOut, len)) {
+    memcpy(state->lastData, compressData, dataSize);
+    state->lastTicks = ticks;
+    state->sinceKeyframe = (state->sinceKeyframe + 1) % CONFIG_DECK_USD_KEYFRAME_INTERVAL;
+    ++usdLogStats.eventsWritten;
+  }
+}
+#endif
+
+static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, uint64_t ticks, const uint8_t* payload, uint8_t payloadSize)
+{
   if (!enableLogging) {
     return;
   }
@@ -492,6 +689,9 @@ static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t*
     vTaskResume(xHandleWriteTask);
   }
 
+#ifdef CONFIG_DECK_USD_COMPRESSED
+  usddeckWriteCompressedEvent(cfg, ticks, payload, payloadSize);
+#else
   int dataSize = sizeof(cfg->eventId) + sizeof(ticks) + payloadSize + cfg->numBytes;
 
   // only write if we have enough space
@@ -504,6 +704,8 @@ static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t*
       ringBuffer_push(&logBuffer, payload, payloadSize);
     }
 
+    logLazyGroupsPrepare(cfg->lazyGroups);
+
     for (int i = 0; i < cfg->numVars; ++i) {
       logVarId_t varid = cfg->varIds[i];
       switch (logGetType(varid)) {
@@ -527,24 +729,169 @@ static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t*
     }
     ++usdLogStats.eventsWritten;
   }
+#endif
   xSemaphoreGive(logBufferMutex);
 }
 
-static void usddeckEventtriggerCallback(const eventtrigger *event)
+static void usddeckEventtriggerCallback(const eventtriggerRecord *record)
 {
-  uint16_t eventId = eventtriggerGetId(event);
+  uint16_t eventId = eventtriggerGetId(record->event);
   for (uint8_t i = 0; i < usdLogConfig.numEventConfigs; ++i) {
     if (usdLogConfig.eventConfigs[i].eventId == eventId) {
-      usddeckWriteEventData(&usdLogConfig.eventConfigs[i], event->payload, event->payloadSize);
+      usddeckWriteEventData(&usdLogConfig.eventConfigs[i], record->timestamp, record->payload, record->payloadSize);
       break;
     }
   }
 }
 
+#ifdef CONFIG_DECK_USD_COMPILED_CONFIG
+/* CRC of the config file, the key of the compiled config. Called before the
+ * write task is created, the write chunk is used as read buffer. */
+static bool usdConfigHash(uint32_t* crc)
+{
+  if (f_open(&logFile, USD_CONFIG_FILE, FA_READ) != FR_OK) {
+    return false;
+  }
+
+  crc32Context_t context;
+  crc32ContextInit(&context);
+  FRESULT r;
+  UINT bytesRead;
+  do {
+    r = f_read(&logFile, writeChunk, sizeof(writeChunk), &bytesRead);
+    if (r == FR_OK) {
+      crc32Update(&context, writeChunk, bytesRead);
+    }
+  } while (r == FR_OK && bytesRead == sizeof(writeChunk));
+  f_close(&logFile);
+
+  *crc = crc32Out(&context);
+  return r == FR_OK;
+}
+
+static bool usdConfigLoadEvent(usdLogEventConfig_t* cfg, const usdCompiledEventConfig_t* event)
+{
+  if (event->numVars > MAX_USD_LOG_VARIABLES_PER_EVENT ||
+      strnlen(event->eventName, USD_COMPILED_EVENT_NAME_SIZE) == USD_COMPILED_EVENT_NAME_SIZE) {
+    return false;
+  }
+
+  if (strcmp(event->eventName, FIXED_FREQUENCY_EVENT_NAME) == 0) {
+    cfg->eventId = FIXED_FREQUENCY_EVENT_ID;
+    cfg->trigger = 0;
+  } else {
+    const eventtrigger *et = eventtriggerGetByName(event->eventName);
+    if (!et) {
+      return false;
+    }
+    cfg->eventId = eventtriggerGetId(et);
+    cfg->trigger = et;
+  }
+
+  cfg->numVars = event->numVars;
+  cfg->numBytes = 0;
+  cfg->lazyGroups = 0;
+  for (int i = 0; i < cfg->numVars; ++i) {
+    const logVarId_t varid = event->varIds[i];
+    cfg->varIds[i] = varid;
+    cfg->numBytes += logVarSize(logGetType(varid));
+    cfg->lazyGroups |= logLazyGroupMask(varid);
+  }
+  return true;
+}
+
+/* Loads the compiled config if it was compiled from this config file and for
+ * this firmware. No names are looked up in the log TOC. */
+static bool usdConfigLoadCompiled(const uint32_t configCrc)
+{
+  if (f_open(&logFile, USD_COMPILED_CONFIG_FILE, FA_READ) != FR_OK) {
+    return false;
+  }
+
+  usdCompiledConfigHeader_t header;
+  UINT bytesRead;
+  bool result = f_read(&logFile, &header, sizeof(header), &bytesRead) == FR_OK &&
+    bytesRead == sizeof(header) &&
+    header.version == USD_COMPILED_CONFIG_VERSION &&
+    header.configCrc == configCrc &&
+    header.logTocCrc == logGetTocCrc() &&
+    header.numEventConfigs <= MAX_USD_LOG_EVENTS &&
+    header.filename[sizeof(header.filename) - 1] == '\0';
+
+  for (int i = 0; result && i < header.numEventConfigs; ++i) {
+    usdCompiledEventConfig_t event;
+    result = f_read(&logFile, &event, sizeof(event), &bytesRead) == FR_OK &&
+      bytesRead == sizeof(event) &&
+      usdConfigLoadEvent(&usdLogConfig.eventConfigs[i], &event);
+  }
+  f_close(&logFile);
+
+  if (result) {
+    usdLogConfig.bufferSize = header.bufferSize;
+    memcpy(usdLogConfig.filename, header.filename, sizeof(usdLogConfig.filename));
+    usdLogConfig.frequency = header.frequency;
+    usdLogConfig.enableOnStartup = header.enableOnStartup;
+    usdLogConfig.mode = header.mode;
+    usdLogConfig.numEventConfigs = header.numEventConfigs;
+    usdLogConfig.fixedFrequencyEventIdx = header.fixedFrequencyEventIdx;
+    for (int i = 0; i < usdLogConfig.numEventConfigs; ++i) {
+      logLazyGroupsAddConsumer(usdLogConfig.eventConfigs[i].lazyGroups);
+    }
+  }
+
+  return result;
+}
+
+// Writes the parsed config, it is loaded at the next startup unless the config file or the firmware changes
+static void usdConfigSaveCompiled(const uint32_t configCrc)
+{
+  if (f_open(&logFile, USD_COMPILED_CONFIG_FILE, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+    return;
+  }
+
+  usdCompiledConfigHeader_t header = {
+    .version = USD_COMPILED_CONFIG_VERSION,
+    .configCrc = configCrc,
+    .logTocCrc = logGetTocCrc(),
+    .bufferSize = usdLogConfig.bufferSize,
+    .frequency = usdLogConfig.frequency,
+    .enableOnStartup = usdLogConfig.enableOnStartup,
+    .mode = usdLogConfig.mode,
+    .numEventConfigs = usdLogConfig.numEventConfigs,
+    .fixedFrequencyEventIdx = usdLogConfig.fixedFrequencyEventIdx,
+  };
+  memcpy(header.filename, usdLogConfig.filename, sizeof(header.filename));
+
+  UINT bytesWritten;
+  bool result = f_write(&logFile, &header, sizeof(header), &bytesWritten) == FR_OK && bytesWritten == sizeof(header);
+
+  for (int i = 0; result && i < usdLogConfig.numEventConfigs; ++i) {
+    const usdLogEventConfig_t* cfg = &usdLogConfig.eventConfigs[i];
+    const char* eventName = cfg->trigger ? cfg->trigger->name : FIXED_FREQUENCY_EVENT_NAME;
+
+    usdCompiledEventConfig_t event = {.numVars = cfg->numVars};
+    result = strlen(eventName) < USD_COMPILED_EVENT_NAME_SIZE;
+    if (result) {
+      strcpy(event.eventName, eventName);
+      memcpy(event.varIds, cfg->varIds, sizeof(event.varIds));
+      result = f_write(&logFile, &event, sizeof(event), &bytesWritten) == FR_OK && bytesWritten == sizeof(event);
+    }
+  }
+  f_close(&logFile);
+
+  if (!result) {
+    f_unlink(USD_COMPILED_CONFIG_FILE);
+    DEBUG_PRINT("Failed to write compiled config\n");
+  }
+}
+#endif
+
 static void usdGracefulShutdownCallback()
 {
   uint32_t timeout = 15; /* ms */
   in_shutdown = true;
+  // stop logging so that the writer task flushes and closes the file
+  enableLogging = false;
   vTaskResume(xHandleWriteTask);
   xSemaphoreTake(shutdownMutex, M2T(timeout));
 }
@@ -564,9 +911,19 @@ static void usdLogTask(void* prm)
 
   // loop to break out in case of errors
   while (true) {
+#ifdef CONFIG_DECK_USD_COMPILED_CONFIG
+    uint32_t configCrc = 0;
+    const bool isConfigHashed = usdConfigHash(&configCrc);
+    if (isConfigHashed && usdConfigLoadCompiled(configCrc)) {
+      eventtriggerRegisterCallback(eventtriggerHandler_USD, &usddeckEventtriggerCallback);
+      DEBUG_PRINT("Compiled config read [OK].\n");
+      initSuccess = true;
+    }
+#endif
+
     /* open config file */
     // loop to break out in case of errors
-    while (f_open(&logFile, "config.txt", FA_READ) == FR_OK) {
+    while (!initSuccess && f_open(&logFile, USD_CONFIG_FILE, FA_READ) == FR_OK) {
       /* try to read configuration */
       char readBuffer[32];
       char* endptr;
@@ -617,6 +974,7 @@ static void usdLogTask(void* prm)
             if (!line) break;
             usdLogConfig.mode = strtol(line, &endptr, 10);
             cfg->eventId = FIXED_FREQUENCY_EVENT_ID;
+            cfg->trigger = 0;
             eventName = FIXED_FREQUENCY_EVENT_NAME;
             usdLogConfig.fixedFrequencyEventIdx = usdLogConfig.numEventConfigs;
           } else {
@@ -624,6 +982,7 @@ static void usdLogTask(void* prm)
             const eventtrigger *et = eventtriggerGetByName(&line[3]);
             if (et) {
               cfg->eventId = eventtriggerGetId(et);
+              cfg->trigger = et;
               eventName = et->name;
             } else {
               DEBUG_PRINT("Unknown event %s\n", &line[3]);
@@ -635,6 +994,7 @@ static void usdLogTask(void* prm)
           // Add log variables
           cfg->numVars = 0;
           cfg->numBytes = 0;
+          cfg->lazyGroups = 0;
           while (true) {
             line = f_gets_without_comments(readBuffer, sizeof(readBuffer), &logFile);
             if (!line || strncmp(line, "on:", 3) == 0) {
@@ -663,6 +1023,8 @@ static void usdLogTask(void* prm)
               cfg->varIds[cfg->numVars] = varid;
               ++cfg->numVars;
               cfg->numBytes += logVarSize(logGetType(varid));
+              cfg->lazyGroups |= logLazyGroupMask(varid);
+              logLazyGroupsAddConsumer(logLazyGroupMask(varid));
             } else {
               DEBUG_PRINT("Skip log variable %s: %s.%s (out of storage)\n", eventName, group, name);
               continue;
@@ -688,6 +1050,11 @@ static void usdLogTask(void* prm)
       //             usdLogConfig.frequency, usdLogConfig.bufferSize);
       // DEBUG_PRINT("enOnStartup: %d. mode: %d\n", usdLogConfig.enableOnStartup, usdLogConfig.mode);
       // DEBUG_PRINT("slots: %d, %d\n", usdLogConfig.numSlots, usdLogConfig.numBytes);
+#ifdef CONFIG_DECK_USD_COMPILED_CONFIG
+      if (isConfigHashed) {
+        usdConfigSaveCompiled(configCrc);
+      }
+#endif
       initSuccess = true;
       break;
     }
@@ -760,34 +1127,78 @@ int usddeckFrequency(void)
 void usddeckTriggerLogging(void)
 {
   if (usdLogConfig.fixedFrequencyEventIdx < MAX_USD_LOG_EVENTS) {
-    usddeckWriteEventData(&usdLogConfig.eventConfigs[usdLogConfig.fixedFrequencyEventIdx], 0, 0);
+    usddeckWriteEventData(&usdLogConfig.eventConfigs[usdLogConfig.fixedFrequencyEventIdx], usecTimestamp(), 0, 0);
   }
 }
 
-// returns size of current file if logging is stopped (0 otherwise)
+// returns size of the file to download if logging is stopped (0 otherwise)
 uint32_t usddeckFileSize(void)
 {
-  return lastFileSize;
+  return downloadFilename[0] != '\0' ? downloadFileSize : lastFileSize;
 }
 
-// Read "length" number of bytes at "offset" into "buffer" of current file
+static const char* usdDownloadFilename(void)
+{
+  return downloadFilename[0] != '\0' ? downloadFilename : usdLogConfig.filename;
+}
+
+/* Fills the read cache with whole sectors, starting with the sector holding
+ * offset. A read that continues where the cache ends, or starts the file, is
+ * a download and prefetches the whole cache in one multi-sector read. Must be
+ * called with logFileMutex taken. */
+static bool usdReadCacheFill(const uint32_t offset)
+{
+  const uint32_t start = offset & ~(uint32_t)(USD_SECTOR_SIZE - 1);
+  const bool isSequential = start == 0 || (readCacheLength > 0 && start == readCacheOffset + readCacheLength);
+  const UINT length = isSequential ? USD_READ_CACHE_SIZE : USD_SECTOR_SIZE;
+
+  bool result = false;
+  readCacheLength = 0;
+  if (f_open(&logFile, usdDownloadFilename(), FA_READ) == FR_OK) {
+    UINT bytesRead;
+    if (f_lseek(&logFile, start) == FR_OK &&
+        f_read(&logFile, writeChunk, length, &bytesRead) == FR_OK &&
+        bytesRead > offset - start) {
+      readCacheOffset = start;
+      readCacheLength = bytesRead;
+      result = true;
+    }
+    f_close(&logFile);
+  }
+  return result;
+}
+
+// Read "length" number of bytes at "offset" into "buffer" of the file to download
 // Only works if logging is stopped
 bool usddeckRead(uint32_t offset, uint8_t* buffer, uint16_t length)
 {
   bool result = false;
   if (initSuccess && xSemaphoreTake(logFileMutex, 0) == pdTRUE) {
-    if (f_open(&logFile, usdLogConfig.filename, FA_READ) == FR_OK) {
-      if (f_lseek(&logFile, offset) == FR_OK) {
-        UINT bytesRead;
-        FRESULT r = f_read(&logFile, buffer, length, &bytesRead);
-        f_close(&logFile);
-        if (r == FR_OK && bytesRead == length) {
-          result = true;
+    bool isHit = true;
+    result = true;
+    while (result && length > 0) {
+      if (offset < readCacheOffset || offset >= readCacheOffset + readCacheLength) {
+        isHit = false;
+        result = usdReadCacheFill(offset);
+      }
+
+      if (result) {
+        uint16_t count = readCacheOffset + readCacheLength - offset;
+        if (count > length) {
+          count = length;
         }
-      } else {
-        f_close(&logFile);
+        memcpy(buffer, &writeChunk[offset - readCacheOffset], count);
+        buffer += count;
+        offset += count;
+        length -= count;
       }
     }
+
+    if (isHit) {
+      readCacheHits++;
+    } else {
+      readCacheMisses++;
+    }
     xSemaphoreGive(logFileMutex);
   }
   return result;
@@ -798,6 +1209,7 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
 
   if (memAddr + readLen <= usddeckFileSize()) {
     if (usddeckRead(memAddr, buffer, readLen)) {
+      STATS_CNT_RATE_MULTI_EVENT(&downloadRate, readLen);
       result = true;
     }
   }
@@ -805,16 +1217,266 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
   return result;
 }
 
-static void usdWriteData(const void *data, size_t size)
+static void usdDirClose(void)
 {
-  UINT bytesWritten;
-  FRESULT status = f_write(&logFile, data, size, &bytesWritten);
-  if (status != FR_OK) {
-    DEBUG_PRINT("usd deck write failure %d\n", status);
-    enableLogging = false;
+  if (dirCursor >= 0) {
+    f_closedir(&dirObj);
+    dirCursor = -1;
+  }
+}
+
+// Files that are listed and can be downloaded
+static bool usdDirIsListed(const FILINFO* info)
+{
+  return (info->fattrib & (AM_DIR | AM_HID | AM_SYS)) == 0;
+}
+
+// Counts the listed files in the current directory. Must be called with logFileMutex taken.
+static void usdDirScan(void)
+{
+  dirCount = 0;
+  usdDirClose();
+  if (f_opendir(&dirObj, "") == FR_OK) {
+    while (f_readdir(&dirObj, &dirInfo) == FR_OK && dirInfo.fname[0] != '\0') {
+      if (usdDirIsListed(&dirInfo) && dirCount < UINT16_MAX) {
+        dirCount++;
+      }
+    }
+    f_closedir(&dirObj);
+  }
+}
+
+/* Reads the directory up to the listed file with the given index and encodes
+ * it in dirEntry. Reads are mostly sequential, the directory is only read from
+ * the start again when going backwards. Must be called with logFileMutex taken. */
+static bool usdDirSeek(const int index)
+{
+  if (dirCursor > 0 && index == dirCursor - 1) {
+    return true;
+  }
+
+  if (dirCursor < 0 || index < dirCursor) {
+    usdDirClose();
+    if (f_opendir(&dirObj, "") != FR_OK) {
+      return false;
+    }
+    dirCursor = 0;
+  }
+
+  while (dirCursor <= index) {
+    if (f_readdir(&dirObj, &dirInfo) != FR_OK || dirInfo.fname[0] == '\0') {
+      usdDirClose();
+      return false;
+    }
+    if (usdDirIsListed(&dirInfo)) {
+      dirCursor++;
+    }
+  }
+
+  // The short name is used if the long one does not fit, both can be opened
+  const char* name = strlen(dirInfo.fname) < USD_DIR_NAME_SIZE ? dirInfo.fname : dirInfo.altname;
+  memset(dirEntry, 0, USD_DIR_NAME_SIZE);
+  strncpy((char*)dirEntry, name, USD_DIR_NAME_SIZE - 1);
+  const uint32_t size = dirInfo.fsize;
+  memcpy(&dirEntry[USD_DIR_NAME_SIZE], &size, sizeof(size));
+  return true;
+}
+
+static uint32_t handleMemDirGetSize(void)
+{
+  uint32_t size = 0;
+  if (initSuccess && xSemaphoreTake(logFileMutex, 0) == pdTRUE) {
+    usdDirScan();
+    size = USD_DIR_HEADER_SIZE + dirCount * USD_DIR_ENTRY_SIZE;
+    xSemaphoreGive(logFileMutex);
+  }
+  return size;
+}
+
+/* The listing of the files on the card, a header with the version and the
+ * number of files followed by one fixed size entry per file. The files are
+ * counted again when the header is read. */
+static bool handleMemDirRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer)
+{
+  bool result = false;
+  if (initSuccess && xSemaphoreTake(logFileMutex, 0) == pdTRUE) {
+    if (memAddr < USD_DIR_HEADER_SIZE) {
+      usdDirScan();
+    }
+
+    const uint8_t header[USD_DIR_HEADER_SIZE] = {USD_DIR_VERSION, dirCount & 0xff, dirCount >> 8};
+    result = true;
+    for (int i = 0; result && i < readLen; i++) {
+      const uint32_t address = memAddr + i;
+      if (address < USD_DIR_HEADER_SIZE) {
+        buffer[i] = header[address];
+      } else {
+        const uint32_t index = (address - USD_DIR_HEADER_SIZE) / USD_DIR_ENTRY_SIZE;
+        result = index < dirCount && usdDirSeek(index);
+        if (result) {
+          buffer[i] = dirEntry[(address - USD_DIR_HEADER_SIZE) % USD_DIR_ENTRY_SIZE];
+        }
+      }
+    }
+    xSemaphoreGive(logFileMutex);
+  }
+  return result;
+}
+
+/* Selects the file to download, the null terminated name is written at
+ * address 0. An empty name selects the latest log file. */
+static bool handleMemDirWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer)
+{
+  if (memAddr != 0 || writeLen > USD_DIR_NAME_SIZE || memchr(buffer, '\0', writeLen) == NULL) {
+    return false;
+  }
+
+  bool result = false;
+  if (initSuccess && xSemaphoreTake(logFileMutex, 0) == pdTRUE) {
+    const char* name = (const char*)buffer;
+    if (name[0] == '\0') {
+      downloadFilename[0] = '\0';
+      result = true;
+    } else if (f_stat(name, &dirInfo) == FR_OK && !(dirInfo.fattrib & AM_DIR)) {
+      strcpy(downloadFilename, name);
+      downloadFileSize = dirInfo.fsize;
+      result = true;
+    }
+
+    if (result) {
+      readCacheLength = 0;
+    }
+    // dirInfo no longer holds the entry of the cursor
+    usdDirClose();
+    xSemaphoreGive(logFileMutex);
+  }
+  return result;
+}
+
+#ifdef CONFIG_DECK_USD_STREAMING
+/* Preallocate a contiguous area for the log file. If it succeeds, sectors are
+ * streamed straight to the card and FatFS is not involved until the file is
+ * truncated and closed. */
+static void usdStreamStart(void)
+{
+  streamMode = false;
+
+  const FSIZE_t size = (FSIZE_t)CONFIG_DECK_USD_STREAMING_SIZE_MB * 1024 * 1024;
+  if (f_expand(&logFile, size, 1) != FR_OK || f_sync(&logFile) != FR_OK) {
+    DEBUG_PRINT("Failed to preallocate %d MB, using FatFS writes\n", CONFIG_DECK_USD_STREAMING_SIZE_MB);
+    return;
+  }
+
+  const FATFS* fs = logFile.obj.fs;
+  streamSector = fs->database + (LBA_t)fs->csize * (logFile.obj.sclust - 2);
+  streamSectorEnd = streamSector + f_size(&logFile) / USD_SECTOR_SIZE;
+  streamLength = 0;
+  streamMode = true;
+}
+
+static bool usdStreamChunk(void)
+{
+  // Only the last chunk of a file can be partial, pad it to a whole sector.
+  // The padding is cut off when the file is truncated.
+  const UINT count = (writeChunkFill + USD_SECTOR_SIZE - 1) / USD_SECTOR_SIZE;
+  if (streamSector + count > streamSectorEnd) {
+    DEBUG_PRINT("usd deck preallocated file full\n");
+    return false;
+  }
+  memset(&writeChunk[writeChunkFill], 0, count * USD_SECTOR_SIZE - writeChunkFill);
+
+  if (disk_write(logFile.obj.fs->pdrv, writeChunk, streamSector, count) != RES_OK) {
+    DEBUG_PRINT("usd deck stream write failure\n");
+    return false;
+  }
+  streamSector += count;
+  streamLength += writeChunkFill;
+  return true;
+}
+
+static void usdStreamStop(void)
+{
+  if (streamMode) {
+    streamMode = false;
+    // cut the file at the real length of the data
+    if (f_lseek(&logFile, streamLength) != FR_OK || f_truncate(&logFile) != FR_OK) {
+      DEBUG_PRINT("usd deck failed to truncate log file\n");
+    }
+  }
+}
+#endif
+
+static void usdWriteChunk(void)
+{
+  uint32_t start = T2M(xTaskGetTickCount());
+
+  bool success;
+#ifdef CONFIG_DECK_USD_STREAMING
+  if (streamMode) {
+    success = usdStreamChunk();
+  } else
+#endif
+  {
+    UINT bytesWritten;
+    FRESULT status = f_write(&logFile, writeChunk, writeChunkFill, &bytesWritten);
+    success = (status == FR_OK);
+    if (!success) {
+      DEBUG_PRINT("usd deck write failure %d\n", status);
+    }
+  }
+
+  if (success) {
+    STATS_CNT_RATE_MULTI_EVENT(&fatWriteRate, writeChunkFill);
   } else {
-    crc32Update(&crcContext, data, size);
-    STATS_CNT_RATE_MULTI_EVENT(&fatWriteRate, bytesWritten);
+    enableLogging = false;
+  }
+
+  uint32_t latency = T2M(xTaskGetTickCount()) - start;
+  if (latency > writeLatencyMax) {
+    writeLatencyMax = latency;
+  }
+
+  writeChunkFill = 0;
+}
+
+/* Append data to the log file. All data goes through the staging chunk, which
+ * starts at the beginning of the file and is therefore always sector aligned. */
+static void usdWriteData(const void *data, size_t size)
+{
+  crc32Update(&crcContext, data, size);
+
+  const uint8_t* bytes = data;
+  while (size > 0) {
+    size_t space = USD_WRITE_CHUNK_SIZE - writeChunkFill;
+    size_t n = size < space ? size : space;
+    memcpy(&writeChunk[writeChunkFill], bytes, n);
+    writeChunkFill += n;
+    bytes += n;
+    size -= n;
+
+    if (writeChunkFill == USD_WRITE_CHUNK_SIZE) {
+      usdWriteChunk();
+    }
+  }
+}
+
+/* Move data from the ring buffer to the card. The ring buffer mutex is only
+ * held while copying to the staging chunk, the slow card write runs with the
+ * ring buffer space already released to the producers. */
+static void usdWriteBuffered(void)
+{
+  while (true) {
+    uint8_t* dest = &writeChunk[writeChunkFill];
+    xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+    uint16_t size = ringBuffer_pop(&logBuffer, dest, USD_WRITE_CHUNK_SIZE - writeChunkFill);
+    xSemaphoreGive(logBufferMutex);
+
+    crc32Update(&crcContext, dest, size);
+    writeChunkFill += size;
+    if (writeChunkFill < USD_WRITE_CHUNK_SIZE) {
+      break;
+    }
+    usdWriteChunk();
   }
 }
 
@@ -833,14 +1495,24 @@ static void usdWriteTask(void* prm)
       // reset stats
       usdLogStats.eventsRequested = 0;
       usdLogStats.eventsWritten = 0;
+      writeLatencyMax = 0;
 
       // reset the buffer
       xSemaphoreTake(logBufferMutex, portMAX_DELAY);
       ringBuffer_reset(&logBuffer);
+#ifdef CONFIG_DECK_USD_COMPRESSED
+      for (int i = 0; i < MAX_USD_LOG_EVENTS; ++i) {
+        usdCompressState[i].sinceKeyframe = 0;
+      }
+#endif
       xSemaphoreGive(logBufferMutex);
 
       xSemaphoreTake(logFileMutex, portMAX_DELAY);
       lastFileSize = 0;
+      // the write chunk is no longer a read cache and a new file is created
+      downloadFilename[0] = '\0';
+      readCacheLength = 0;
+      usdDirClose();
 
       /* look for existing files and use first not existent combination
        * of two chars */
@@ -871,12 +1543,16 @@ static void usdWriteTask(void* prm)
 
         // iniatialize crc
         crc32ContextInit(&crcContext);
+        writeChunkFill = 0;
+#ifdef CONFIG_DECK_USD_STREAMING
+        usdStreamStart();
+#endif
 
         // write header
         uint8_t magic = 0xBC;
         usdWriteData(&magic, sizeof(magic));
 
-        uint16_t version = 2;
+        uint16_t version = USD_LOG_FORMAT_VERSION;
         usdWriteData(&version, sizeof(version));
 
         uint16_t numEventTypes = usdLogConfig.numEventConfigs;
@@ -978,40 +1654,21 @@ static void usdWriteTask(void* prm)
           /* sleep */
           vTaskSuspend(NULL);
 
-          // check if we have anything to write
-          xSemaphoreTake(logBufferMutex, portMAX_DELAY);
-          const uint8_t* buf;
-          uint16_t size;
-          bool hasData = ringBuffer_pop_start(&logBuffer, &buf, &size);
-          xSemaphoreGive(logBufferMutex);
-
-          // execute the actual write operation
-          if (hasData) {
-            usdWriteData(buf, size);
-
-            xSemaphoreTake(logBufferMutex, portMAX_DELAY);
-            ringBuffer_pop_done(&logBuffer);
-            xSemaphoreGive(logBufferMutex);
-          }
+          // write all complete chunks
+          usdWriteBuffered();
         }
         // write everything that's still in the buffer
-        xSemaphoreTake(logBufferMutex, portMAX_DELAY);
-        while (true) {
-          const uint8_t *buf;
-          uint16_t size;
-          bool hasData = ringBuffer_pop_start(&logBuffer, &buf, &size);
-          if (hasData) {
-            usdWriteData(buf, size);
-            ringBuffer_pop_done(&logBuffer);
-          } else {
-            break;
-          }
-        }
-        xSemaphoreGive(logBufferMutex);
+        usdWriteBuffered();
 
         // write CRC
         uint32_t crcValue = crc32Out(&crcContext);
         usdWriteData(&crcValue, sizeof(crcValue));
+        if (writeChunkFill > 0) {
+          usdWriteChunk();
+        }
+#ifdef CONFIG_DECK_USD_STREAMING
+        usdStreamStop();
+#endif
 
         // close file
         f_close(&logFile);
@@ -1125,4 +1782,20 @@ STATS_CNT_RATE_LOG_ADD(spiReBps, &spiReadRate)
  * @brief Data write rate to the SD card [bytes/s]
  */
 STATS_CNT_RATE_LOG_ADD(fatWrBps, &fatWriteRate)
+/**
+ * @brief Longest time spent writing one chunk to the SD card [ms]
+ */
+LOG_ADD(LOG_UINT32, wrLatMax, &writeLatencyMax)
+/**
+ * @brief File download rate through the memory subsystem [bytes/s]
+ */
+STATS_CNT_RATE_LOG_ADD(dlBps, &downloadRate)
+/**
+ * @brief Number of download reads served from the read-ahead cache
+ */
+LOG_ADD(LOG_UINT32, dlHits, &readCacheHits)
+/**
+ * @brief Number of download reads that had to read from the SD card
+ */
+LOG_ADD(LOG_UINT32, dlMisses, &readCacheMisses)
 LOG_GROUP_STOP(usd)
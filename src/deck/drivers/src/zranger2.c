@@ -53,33 +53,72 @@ static float expCoeff;
 
 #define RANGE_OUTLIER_LIMIT 5000 // the measured range is in [mm]
 
+#define ZRANGER2_TIMING_BUDGET_US 25000
+#define ZRANGER2_TIMING_BUDGET_MS (ZRANGER2_TIMING_BUDGET_US / 1000)
+#define ZRANGER2_MIN_READY_DELAY_MS (ZRANGER2_TIMING_BUDGET_MS / 2)
+#define ZRANGER2_POLL_RETRY_MS 1
+#define ZRANGER2_STALL_TIMEOUT_MS (4 * ZRANGER2_TIMING_BUDGET_MS)
+
 static uint16_t range_last = 0;
+// Expected time from the start of a measurement until the data is ready
+static uint32_t readyDelayMs = ZRANGER2_TIMING_BUDGET_MS;
 
 static bool isInit;
 
 NO_DMA_CCM_SAFE_ZERO_INIT static VL53L1_Dev_t dev;
 
-static uint16_t zRanger2GetMeasurementAndRestart(VL53L1_Dev_t *dev)
+/**
+ * Wait for the measurement in progress without polling the sensor more than needed. The first poll is
+ * done when the data is expected to be ready, the expected delay from the start of the measurement is
+ * adapted so that the sensor is polled close to when the data becomes ready.
+ *
+ * @return The time the data was found to be ready [ticks]
+ */
+static TickType_t zRanger2WaitForData(VL53L1_Dev_t *dev, const TickType_t startTime)
 {
-    VL53L1_Error status = VL53L1_ERROR_NONE;
-    VL53L1_RangingMeasurementData_t rangingData;
     uint8_t dataReady = 0;
-    uint16_t range;
+    bool isFirstPoll = true;
 
-    while (dataReady == 0)
+    TickType_t wakeTime = startTime;
+    vTaskDelayUntil(&wakeTime, M2T(readyDelayMs));
+
+    while (1)
     {
-        status = VL53L1_GetMeasurementDataReady(dev, &dataReady);
-        vTaskDelay(M2T(1));
+        VL53L1_GetMeasurementDataReady(dev, &dataReady);
+        const TickType_t now = xTaskGetTickCount();
+        if (dataReady)
+        {
+            if (isFirstPoll)
+            {
+                // The data may have been ready for a while, try earlier next time
+                if (readyDelayMs > ZRANGER2_MIN_READY_DELAY_MS)
+                {
+                    readyDelayMs--;
+                }
+            }
+            else
+            {
+                readyDelayMs = T2M(now - startTime);
+            }
+            return now;
+        }
+
+        if (T2M(now - startTime) > ZRANGER2_STALL_TIMEOUT_MS)
+        {
+            // No data, let the caller restart the measurement
+            return 0;
+        }
+
+        isFirstPoll = false;
+        vTaskDelay(M2T(ZRANGER2_POLL_RETRY_MS));
     }
+}
 
-    status = VL53L1_GetRangingMeasurementData(dev, &rangingData);
-    range = rangingData.RangeMilliMeter;
-
+static TickType_t zRanger2StartMeasurement(VL53L1_Dev_t *dev)
+{
     VL53L1_StopMeasurement(dev);
-    status = VL53L1_StartMeasurement(dev);
-    status = status;
-
-    return range;
+    VL53L1_StartMeasurement(dev);
+    return xTaskGetTickCount();
 }
 
 void zRanger2Init(DeckInfo* info)
@@ -115,24 +154,37 @@ bool zRanger2Test(void)
 
 void zRanger2Task(void* arg)
 {
-  TickType_t lastWakeTime;
-
   systemWaitStart();
 
   // Restart sensor
   VL53L1_StopMeasurement(&dev);
   VL53L1_SetDistanceMode(&dev, VL53L1_DISTANCEMODE_MEDIUM);
-  VL53L1_SetMeasurementTimingBudgetMicroSeconds(&dev, 25000);
+  VL53L1_SetMeasurementTimingBudgetMicroSeconds(&dev, ZRANGER2_TIMING_BUDGET_US);
 
-  VL53L1_StartMeasurement(&dev);
-
-  lastWakeTime = xTaskGetTickCount();
+  TickType_t startTime = zRanger2StartMeasurement(&dev);
 
+  // A new measurement is started as soon as the previous one is read, the ranging period is set by the
+  // timing budget of the sensor
   while (1) {
-    vTaskDelayUntil(&lastWakeTime, M2T(25));
+    const TickType_t readyTime = zRanger2WaitForData(&dev, startTime);
+    if (readyTime == 0) {
+      startTime = zRanger2StartMeasurement(&dev);
+      continue;
+    }
+
+    VL53L1_RangingMeasurementData_t rangingData;
+    const VL53L1_Error status = VL53L1_GetRangingMeasurementData(&dev, &rangingData);
+    startTime = zRanger2StartMeasurement(&dev);
+    if (status != VL53L1_ERROR_NONE) {
+      continue;
+    }
+
+    // The range is captured during the timing budget, use the middle of the interval as the
+    // time of the measurement
+    const uint32_t captureTime = readyTime - M2T(ZRANGER2_TIMING_BUDGET_MS / 2);
 
-    range_last = zRanger2GetMeasurementAndRestart(&dev);
-    rangeSet(rangeDown, range_last / 1000.0f);
+    range_last = rangingData.RangeMilliMeter;
+    rangeSetWithTimestamp(rangeDown, range_last / 1000.0f, captureTime);
 
     // check if range is feasible and push into the estimator
     // the sensor should not be able to measure >5 [m], and outliers typically
@@ -140,7 +192,7 @@ void zRanger2Task(void* arg)
     if (range_last < RANGE_OUTLIER_LIMIT) {
       float distance = (float)range_last * 0.001f; // Scale from [mm] to [m]
       float stdDev = expStdA * (1.0f  + expf( expCoeff * (distance - expPointA)));
-      rangeEnqueueDownRangeInEstimator(distance, stdDev, xTaskGetTickCount());
+      rangeEnqueueDownRangeInEstimator(distance, stdDev, captureTime);
     }
   }
 }
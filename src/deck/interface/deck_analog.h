@@ -28,6 +28,7 @@
 #define __DECK_ANALOG_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "deck_constants.h"
 
 /* Voltage reference types for the analogReference() function. */
@@ -49,4 +50,20 @@ void analogReadResolution(uint8_t bits);
  */
 float analogReadVoltage(const deckPin_t pin);
 
+/*
+ * Add a deck pin to the background scan. The pin is converted continuously by ADC1 with DMA, and the
+ * values are oversampled and low pass filtered without any CPU time from the caller.
+ * @param[in] pin   deck pin to scan.
+ * @return          false if the max number of scanned pins is reached
+ */
+bool analogScanEnable(const deckPin_t pin);
+
+/*
+ * Get the latest filtered voltage of a scanned deck pin, see analogScanEnable(). Does not block and can be called
+ * from any task. Falls back to a single conversion with analogReadVoltage() if the pin is not scanned.
+ * @param[in] pin   deck pin to read.
+ * @return          voltage in volts
+ */
+float analogScanReadVoltage(const deckPin_t pin);
+
 #endif
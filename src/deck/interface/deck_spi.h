@@ -37,11 +37,47 @@
 #define SPI_BAUDRATE_3MHZ   SPI_BaudRatePrescaler_32    // 2.625MHz
 #define SPI_BAUDRATE_2MHZ   SPI_BaudRatePrescaler_64    // 1.3125MHz
 
+/**
+ * Priority of a transaction on the deck SPI bus. A transaction is not started
+ * while transactions of a higher priority are waiting for the bus, whatever
+ * the priorities of the tasks.
+ */
+typedef enum {
+  // Long transfers that can be delayed, like the uSD card. Should be split in
+  // short transactions to not block the bus.
+  spiPriorityBulk = 0,
+  spiPriorityNormal,
+  // Time critical transfers, like the UWB radio
+  spiPriorityHigh,
+  spiPriorityCount,
+} spiPriority_t;
+
+/**
+ * Users of the deck SPI bus, the time each of them holds the bus is logged in
+ * the spiBus log group.
+ */
+typedef enum {
+  spiUserOther = 0,
+  spiUserLoco,
+  spiUserFlow,
+  spiUserUsd,
+  spiUserCount,
+} spiUser_t;
+
 /**
  * Initialize the SPI.
  */
 void spiBegin(void);
+
+/**
+ * Take the bus with normal priority
+ */
 void spiBeginTransaction(uint16_t baudRatePrescaler);
+
+/**
+ * Take the bus, waits until no transactions of higher priority are waiting.
+ */
+void spiBeginTransactionWithPriority(uint16_t baudRatePrescaler, spiPriority_t priority, spiUser_t user);
 void spiEndTransaction();
 
 /* Send the data_tx buffer and receive into the data_rx buffer */
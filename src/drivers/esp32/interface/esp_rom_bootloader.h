@@ -69,6 +69,50 @@ bool espRomBootloaderFlashBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffe
 **/
 bool espRomBootloaderFlashData(uint8_t *sendBuffer, uint32_t flashDataSize, uint32_t sequenceNumber);
 
+/**
+* @brief Called to initialize compressed flashing with the ESP. The data is then sent as blocks of a zlib stream with
+* espRomBootloaderFlashDataSend().
+*
+* @param *sendBuffer Pointer to a buffer used to construct the flash begin packet. Can be left empty.
+* @param numberOfFlashBuffers The number of compressed data packets that will be sent
+* @param uncompressedSize The size of the image after decompression, this is the size that is erased
+* @param flashOffset The offset in flash where flashing will start
+*
+* @return true if flash begin command was accepted by ESP, false otherwise.
+**/
+bool espRomBootloaderFlashDeflBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffers, uint32_t uncompressedSize, uint32_t flashOffset);
+
+/**
+* @brief Called to send a packet to be flashed onto the ESP, without waiting for the response. The ESP writes the
+* packet while the next one is filled, the response is received with espRomBootloaderFlashDataWaitForResponse() before
+* the next packet is sent. The send buffer may be reused as soon as the function returns.
+*
+* @param *sendBuffer Pointer to a buffer used to construct the slip packet. Must contain actual to be flashed data.
+* @param flashDataSize Size of the current data packet
+* @param sequenceNumber The sequence number of the current data packet, indicates this is the nth packet
+* @param isCompressed true if the packet is a block of a zlib stream, started with espRomBootloaderFlashDeflBegin()
+**/
+void espRomBootloaderFlashDataSend(uint8_t *sendBuffer, uint32_t flashDataSize, uint32_t sequenceNumber, bool isCompressed);
+
+/**
+* @brief Called to wait for the response to the last packet sent with espRomBootloaderFlashDataSend().
+*
+* @return true if data was succesfully flashed to ESP, false otherwise.
+**/
+bool espRomBootloaderFlashDataWaitForResponse();
+
+/**
+* @brief Called to read the MD5 digest of a region of the ESP flash.
+*
+* @param *sendBuffer Pointer to a buffer used to construct the slip packet. Can be left empty.
+* @param address The start address of the region in flash
+* @param size The size of the region
+* @param *md5 Pointer to a buffer of 16 bytes where the digest is written
+*
+* @return true if the digest was read, false otherwise.
+**/
+bool espRomBootloaderFlashMd5(uint8_t *sendBuffer, uint32_t address, uint32_t size, uint8_t *md5);
+
 /**
 * @brief Called to attach the SPI memory to the ESP. Must be called before issuing any flash command.
 *
@@ -47,6 +47,9 @@
 #define FLASH_DATA 0x03
 #define FLASH_END 0x04
 #define SYNC 0x08
+#define FLASH_DEFL_BEGIN 0x10
+#define FLASH_DEFL_DATA 0x11
+#define FLASH_DEFL_END 0x12
 #define SPI_FLASH_MD5 0x13
 #define ERASE_FLASH 0xd0
 #define READ_FLASH 0xd2
@@ -98,3 +101,28 @@ typedef struct
 **/
 bool espSlipExchange(uint8_t *sendBuffer, espSlipReceivePacket_t *receiverPacket, espSlipSendPacket_t *senderPacket, espSlipSendBuffer_t sendBufferFunction,
                      espSlipGetDataWithTimeout_t getDataWithTimeout, uint32_t timeoutTicks);
+
+/**
+* @brief Called to send a SLIP packet to the ESP without waiting for the response. The response must be received with
+* espSlipReceive() before the next packet is sent.
+*
+* @param *sendBuffer Pointer to the to be sent buffer
+* @param *senderPacket Pointer to sender packet struct, which will be used to fill the send buffer header
+* @param sendBufferFunction Function pointer to the function that sends the buffer (split into pages) to the ESP
+* @param getDataWithTimeoutFunction Function pointer to the function used to flush old received data
+**/
+void espSlipSend(uint8_t *sendBuffer, espSlipSendPacket_t *senderPacket, espSlipSendBuffer_t sendBufferFunction,
+                 espSlipGetDataWithTimeout_t getDataWithTimeout);
+
+/**
+* @brief Called to receive the response to a SLIP packet sent with espSlipSend().
+*
+* @param *receiverPacket Pointer to receiver packet struct, which will be filled with the response
+* @param *senderPacket Pointer to the sender packet struct of the sent packet
+* @param getDataWithTimeoutFunction Function pointer to the function that receives data (byte by byte) from the ESP
+* @param timeoutTicks Number of ticks to wait for a response from the ESP
+*
+* @return true if ESP responds with a status byte indicating success.
+**/
+bool espSlipReceive(espSlipReceivePacket_t *receiverPacket, espSlipSendPacket_t *senderPacket,
+                    espSlipGetDataWithTimeout_t getDataWithTimeout, uint32_t timeoutTicks);
@@ -43,6 +43,9 @@
 
 #define SYNC_ATTEMPTS 10
 
+// 32 hex characters and 4 status bytes
+#define ESP_ROM_MD5_RESPONSE_SIZE (32 + 4)
+
 static espSlipSendPacket_t senderPacket;
 static espSlipReceivePacket_t receiverPacket;
 
@@ -89,9 +92,23 @@ bool espRomBootloaderSpiAttach(uint8_t *sendBuffer)
   return espSlipExchange(sendBuffer, &receiverPacket, &senderPacket, uart2SendDataDmaBlocking, uart2GetCharWithTimeout, 100);
 }
 
-bool espRomBootloaderFlashBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffers, uint32_t firmwareSize, uint32_t flashOffset)
+// The flash data is sent with double buffered DMA, the next flash buffer can be filled while it is being sent
+static void sendDataDma(uint32_t size, uint8_t *data)
+{
+  uart2SendDataDma(size, data);
+}
+
+static void setWord(uint8_t *sendBuffer, const int index, const uint32_t value)
+{
+  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + index + 0] = (uint8_t)((value >> 0) & 0x000000FF);
+  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + index + 1] = (uint8_t)((value >> 8) & 0x000000FF);
+  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + index + 2] = (uint8_t)((value >> 16) & 0x000000FF);
+  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + index + 3] = (uint8_t)((value >> 24) & 0x000000FF);
+}
+
+static bool flashBegin(uint8_t *sendBuffer, uint8_t command, uint32_t numberOfFlashBuffers, uint32_t firmwareSize, uint32_t flashOffset)
 {
-  senderPacket.command = FLASH_BEGIN;
+  senderPacket.command = command;
   senderPacket.dataSize = 0x10;
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 0] = (uint8_t)((firmwareSize >> 0) & 0x000000FF);
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 1] = (uint8_t)((firmwareSize >> 8) & 0x000000FF);
@@ -116,15 +133,26 @@ bool espRomBootloaderFlashBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffe
   return espSlipExchange(sendBuffer, &receiverPacket, &senderPacket, uart2SendDataDmaBlocking, uart2GetCharWithTimeout, 10000);
 }
 
-bool espRomBootloaderFlashData(uint8_t *sendBuffer, uint32_t flashDataSize, uint32_t sequenceNumber)
+bool espRomBootloaderFlashBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffers, uint32_t firmwareSize, uint32_t flashOffset)
+{
+  return flashBegin(sendBuffer, FLASH_BEGIN, numberOfFlashBuffers, firmwareSize, flashOffset);
+}
+
+bool espRomBootloaderFlashDeflBegin(uint8_t *sendBuffer, uint32_t numberOfFlashBuffers, uint32_t uncompressedSize, uint32_t flashOffset)
+{
+  // The ROM erases the uncompressed size
+  return flashBegin(sendBuffer, FLASH_DEFL_BEGIN, numberOfFlashBuffers, uncompressedSize, flashOffset);
+}
+
+void espRomBootloaderFlashDataSend(uint8_t *sendBuffer, uint32_t flashDataSize, uint32_t sequenceNumber, bool isCompressed)
 {
-  senderPacket.command = FLASH_DATA;
-  senderPacket.dataSize = ESP_SLIP_MTU + ESP_SLIP_ADDITIONAL_DATA_OVERHEAD_LEN;
+  // Compressed blocks are sent with their actual size, padding would be part of the deflate stream
+  const uint32_t dataSize = isCompressed ? flashDataSize : ESP_SLIP_MTU;
+
+  senderPacket.command = isCompressed ? FLASH_DEFL_DATA : FLASH_DATA;
+  senderPacket.dataSize = dataSize + ESP_SLIP_ADDITIONAL_DATA_OVERHEAD_LEN;
 
-  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 0] = (uint8_t)((ESP_SLIP_MTU >> 0) & 0x000000FF);
-  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 1] = (uint8_t)((ESP_SLIP_MTU >> 8) & 0x000000FF);
-  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 2] = (uint8_t)((ESP_SLIP_MTU >> 16) & 0x000000FF);
-  sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 3] = (uint8_t)((ESP_SLIP_MTU >> 24) & 0x000000FF);
+  setWord(sendBuffer, 0, dataSize);
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 4] = (uint8_t)((sequenceNumber >> 0) & 0x000000FF);
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 5] = (uint8_t)((sequenceNumber >> 8) & 0x000000FF);
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 6] = (uint8_t)((sequenceNumber >> 16) & 0x000000FF);
@@ -138,11 +166,80 @@ bool espRomBootloaderFlashData(uint8_t *sendBuffer, uint32_t flashDataSize, uint
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 14] = 0x00;
   sendBuffer[1 + ESP_SLIP_OVERHEAD_LEN + 15] = 0x00;
 
-  if (flashDataSize < ESP_SLIP_MTU)
+  if (flashDataSize < dataSize)
   {
     // pad the data with 0xFF
-    memset(&sendBuffer[ESP_SLIP_DATA_START + flashDataSize], 0xFF, ESP_SLIP_MTU - flashDataSize);
+    memset(&sendBuffer[ESP_SLIP_DATA_START + flashDataSize], 0xFF, dataSize - flashDataSize);
   }
 
-  return espSlipExchange(sendBuffer, &receiverPacket, &senderPacket, uart2SendDataDmaBlocking, uart2GetCharWithTimeout, 100);
+  espSlipSend(sendBuffer, &senderPacket, sendDataDma, uart2GetCharWithTimeout);
+}
+
+bool espRomBootloaderFlashDataWaitForResponse()
+{
+  // Decompressing may write several flash sectors for one block
+  const uint32_t timeoutTicks = (senderPacket.command == FLASH_DEFL_DATA) ? 500 : 100;
+  return espSlipReceive(&receiverPacket, &senderPacket, uart2GetCharWithTimeout, timeoutTicks);
+}
+
+bool espRomBootloaderFlashData(uint8_t *sendBuffer, uint32_t flashDataSize, uint32_t sequenceNumber)
+{
+  espRomBootloaderFlashDataSend(sendBuffer, flashDataSize, sequenceNumber, false);
+  return espRomBootloaderFlashDataWaitForResponse();
+}
+
+static bool hexToNibble(const uint8_t c, uint8_t *nibble)
+{
+  if (c >= '0' && c <= '9')
+  {
+    *nibble = c - '0';
+  }
+  else if (c >= 'a' && c <= 'f')
+  {
+    *nibble = c - 'a' + 10;
+  }
+  else if (c >= 'A' && c <= 'F')
+  {
+    *nibble = c - 'A' + 10;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+bool espRomBootloaderFlashMd5(uint8_t *sendBuffer, uint32_t address, uint32_t size, uint8_t *md5)
+{
+  senderPacket.command = SPI_FLASH_MD5;
+  senderPacket.dataSize = 0x10;
+  setWord(sendBuffer, 0, address);
+  setWord(sendBuffer, 4, size);
+  setWord(sendBuffer, 8, 0);
+  setWord(sendBuffer, 12, 0);
+
+  // The ROM hashes at roughly 8 s per MB, the timeout is for the first byte of the response
+  const uint32_t timeoutTicks = M2T(1000 + (size / 1024) * 8);
+  if (!espSlipExchange(sendBuffer, &receiverPacket, &senderPacket, uart2SendDataDmaBlocking, uart2GetCharWithTimeout, timeoutTicks))
+  {
+    return false;
+  }
+
+  // The ROM responds with the digest as 32 hex characters
+  if (receiverPacket.dataSize != ESP_ROM_MD5_RESPONSE_SIZE)
+  {
+    return false;
+  }
+  for (int i = 0; i < 16; i++)
+  {
+    uint8_t high;
+    uint8_t low;
+    if (!hexToNibble(receiverPacket.data[2 * i], &high) || !hexToNibble(receiverPacket.data[2 * i + 1], &low))
+    {
+      return false;
+    }
+    md5[i] = (high << 4) | low;
+  }
+
+  return true;
 }
@@ -294,7 +294,7 @@ static void assembleBuffer(uint8_t *sendBuffer, espSlipSendPacket_t *senderPacke
   sendBuffer[3] = (uint8_t)((senderPacket->dataSize >> 0) & 0x000000FF);
   sendBuffer[4] = (uint8_t)((senderPacket->dataSize >> 8) & 0x000000FF);
 
-  if (senderPacket->command == FLASH_DATA)
+  if (senderPacket->command == FLASH_DATA || senderPacket->command == FLASH_DEFL_DATA)
   {
     uint32_t checksum = (uint32_t)generateChecksum(sendBuffer, senderPacket);
     sendBuffer[5] = (uint8_t)((checksum >> 0) & 0x000000FF);
@@ -324,12 +324,21 @@ static void flushTxBuffer(espSlipGetDataWithTimeout_t getDataWithTimeout)
   return;
 }
 
-bool espSlipExchange(uint8_t *sendBuffer, espSlipReceivePacket_t *receiverPacket, espSlipSendPacket_t *senderPacket, espSlipSendBuffer_t sendBufferFunction, espSlipGetDataWithTimeout_t getDataWithTimeout, uint32_t timeoutTicks)
+void espSlipSend(uint8_t *sendBuffer, espSlipSendPacket_t *senderPacket, espSlipSendBuffer_t sendBufferFunction, espSlipGetDataWithTimeout_t getDataWithTimeout)
 {
   flushTxBuffer(getDataWithTimeout);
   assembleBuffer(sendBuffer, senderPacket);
 
   sendSlipPacket(sendSize, sendBuffer, sendBufferFunction);
+}
 
+bool espSlipReceive(espSlipReceivePacket_t *receiverPacket, espSlipSendPacket_t *senderPacket, espSlipGetDataWithTimeout_t getDataWithTimeout, uint32_t timeoutTicks)
+{
   return receivePacket(receiverPacket, senderPacket, getDataWithTimeout, timeoutTicks);
 }
+
+bool espSlipExchange(uint8_t *sendBuffer, espSlipReceivePacket_t *receiverPacket, espSlipSendPacket_t *senderPacket, espSlipSendBuffer_t sendBufferFunction, espSlipGetDataWithTimeout_t getDataWithTimeout, uint32_t timeoutTicks)
+{
+  espSlipSend(sendBuffer, senderPacket, sendBufferFunction, getDataWithTimeout);
+  return espSlipReceive(receiverPacket, senderPacket, getDataWithTimeout, timeoutTicks);
+}
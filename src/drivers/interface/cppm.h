@@ -26,6 +26,18 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#define CPPM_MAX_CHANNELS 12
+
+/**
+ * One decoded CPPM frame, assembled in the capture interrupt
+ */
+typedef struct {
+  uint16_t ch[CPPM_MAX_CHANNELS]; // Channel pulse lengths [us]
+  uint8_t count;                  // Number of channels in the frame
+  uint64_t timestamp;             // Time the frame was completed [us]
+} cppmFrame_t;
 
 void cppmInit(void);
 
@@ -33,7 +45,11 @@ bool cppmIsAvailible(void);
 
 void cppmClearQueue(void);
 
-int cppmGetTimestamp(uint16_t *timestamp);
+/**
+ * Wait for the next complete frame. Only the latest frame is kept, a frame
+ * that is not fetched before the next one completes is dropped.
+ */
+int cppmGetFrame(cppmFrame_t *frame);
 
 float cppmConvert2Float(uint16_t timestamp, float min, float max, float deadband);
 
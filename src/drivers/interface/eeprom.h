@@ -33,6 +33,15 @@
 
 #define EEPROM_I2C_ADDR     0x50
 #define EEPROM_SIZE         0x1FFF
+#define EEPROM_PAGE_SIZE    32
+
+/**
+ * Called when an asynchronous write is on the eeprom, from the timer task. Must
+ * not block or call the eeprom functions.
+ * @param success  False if a page write failed since the write was queued.
+ * @param arg  The argument given with the write.
+ */
+typedef void (*eepromWriteCallback_t)(bool success, void* arg);
 
 /**
  * Initialize the i2c eeprom module
@@ -68,6 +77,7 @@ bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len);
 
 /**
  * Write data to the eeprom from a supplied buffer.
+ * Waits for all queued writes, including this one, to be on the eeprom.
  * 
  * @param buffer  The buffer to read the data from
  * @param writeAddr  The start address to write to
@@ -77,6 +87,32 @@ bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len);
  */
 bool eepromWriteBuffer(const uint8_t* buffer, uint16_t writeAddr, uint16_t len);
 
+/**
+ * Queue data to be written to the eeprom and return without waiting for the
+ * eeprom. The data is copied, split in pages and written in the background in
+ * the order it was queued. Consecutive writes to the same page are merged into
+ * one page write. Blocks only if the write queue is full. Reads return the
+ * queued data before it is written.
+ *
+ * @param buffer  The buffer to read the data from
+ * @param writeAddr  The start address to write to
+ * @param len  Number of bytes to write
+ * @param callback  Called when the data is written, may be NULL
+ * @param callbackArg  Argument to the callback
+ *
+ * @return True if queued, false if the data is outside of the eeprom.
+ */
+bool eepromWriteBufferAsync(const uint8_t* buffer, uint16_t writeAddr, uint16_t len,
+                            eepromWriteCallback_t callback, void* callbackArg);
+
+/**
+ * Wait for all the queued writes to be on the eeprom.
+ * @param timeout  Max time to wait [ticks]
+ *
+ * @return True if all writes are done, false on timeout.
+ */
+bool eepromWaitIdle(uint32_t timeout);
+
 // TODO
 bool eepromWritePage(uint8_t* buffer, uint16_t writeAddr);
 
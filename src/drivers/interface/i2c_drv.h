@@ -38,6 +38,56 @@ typedef struct _I2cMessage
   uint8_t          *buffer;           //< Pointer to the buffer from where data will be read for transmission, or into which received data will be placed.
 } I2cMessage;
 
+typedef enum
+{
+  i2cPriorityNormal,
+  i2cPriorityHigh,
+  i2cPriorityCount,
+} I2cPriority;
+
+struct _I2cTransaction;
+typedef void (*I2cTransactionCallback)(struct _I2cTransaction* transaction);
+
+/**
+ * A sequence of messages that is transferred as one unit, for instance a
+ * register write followed by a read. No other transaction is started on the bus
+ * between the messages of a transaction. The transaction, and the messages and
+ * buffers it points to, must stay valid until it is done.
+ */
+typedef struct _I2cTransaction
+{
+  I2cMessage*      messages;          //< The messages, transferred in order
+  uint8_t          messageCount;      //< Number of messages
+  I2cPriority      priority;          //< Pending high priority transactions are started before normal ones
+  I2cTransactionCallback callback;    //< Called from the i2c interrupt when done, may be NULL
+  SemaphoreHandle_t doneSemaphore;    //< Given from the i2c interrupt when done, may be NULL
+  void*            arg;               //< Client data, not used by the driver
+  volatile bool    isDone;            //< Set when all messages are transferred or one failed
+  I2cStatus        status;            //< i2cAck if all messages were acked
+  // Internal
+  uint8_t          messageNr;         //< Index of the message in progress
+  struct _I2cTransaction* next;       //< Next transaction in the pending queue
+} I2cTransaction;
+
+/**
+ * Bus statistics, exposed in the "i2c" log group.
+ */
+typedef struct
+{
+  uint32_t transactionCount;          //< Finished transactions
+  uint32_t nackCount;                 //< Transactions that failed
+  uint32_t timeoutCount;              //< Blocking transfers that timed out
+  uint8_t pendingCount;               //< Transactions in the pending queue
+  uint8_t pendingMax;                 //< Max number of pending transactions
+  uint32_t shadowHitCount;            //< Register reads saved by the i2cdev shadow registers
+  uint64_t busyStartUs;               //< Start of the transaction in progress
+  uint32_t busyUs;                    //< Accumulated time with a transaction in progress
+  // Used to calculate the utilization
+  uint32_t latestBusyUs;
+  uint32_t latestTimestamp;
+  float latestUtilization;
+} I2cBusStats;
+
 typedef struct
 {
   I2C_TypeDef*        i2cPort;
@@ -74,6 +124,11 @@ typedef struct
   SemaphoreHandle_t isBusFreeMutex;     //< Mutex to protect bus
   StaticSemaphore_t isBusFreeMutexBuffer;
   DMA_InitTypeDef DMAStruct;            //< DMA configuration structure used during transfer setup.
+  I2cTransaction* currentTransaction;   //< Transaction in progress, NULL if the bus is idle
+  bool isRestarting;                    //< No transaction is started while the bus is restarted
+  I2cTransaction* pendingHead[i2cPriorityCount]; //< Pending transactions per priority
+  I2cTransaction* pendingTail[i2cPriorityCount];
+  I2cBusStats stats;
 } I2cDrv;
 
 // Definitions of i2c busses found in c file.
@@ -89,6 +144,7 @@ void i2cdrvInit(I2cDrv* i2c);
  * Send or receive a message over the I2C bus.
  *
  * The message is synchrony by semapthore and uses interrupts to transfer the message.
+ * It is queued with normal priority together with asynchronous transactions.
  *
  * @param i2c      i2c bus to use.
  * @param message	 An I2cMessage struct containing all the i2c message
@@ -97,6 +153,30 @@ void i2cdrvInit(I2cDrv* i2c);
  */
 bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message);
 
+/**
+ * Transfer a transaction and wait for it to be done.
+ *
+ * @param i2c          i2c bus to use.
+ * @param transaction  The transaction, callback and doneSemaphore are set by the driver.
+ * @return             true if all messages were acked, false otherwise.
+ */
+bool i2cdrvTransactionTransfer(I2cDrv* i2c, I2cTransaction* transaction);
+
+/**
+ * Queue a transaction on the bus without blocking. It is started directly if the
+ * bus is idle, otherwise when the transactions in front of it are done. When done,
+ * isDone and status are set, the callback is called and the doneSemaphore is given,
+ * all from the i2c interrupt.
+ *
+ * Asynchronous transactions are not supervised by a timeout, a bus that hangs is
+ * restarted by the next blocking transfer that times out.
+ *
+ * @param i2c          i2c bus to use.
+ * @param transaction  The transaction to queue, must not already be queued.
+ * @return             true if queued, false if the transaction has no messages.
+ */
+bool i2cdrvTransactionQueue(I2cDrv* i2c, I2cTransaction* transaction);
+
 
 /**
  * Create a message to transfer
@@ -205,4 +205,40 @@ bool i2cdevWriteBit(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
 bool i2cdevWriteBits(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
                      uint8_t bitStart, uint8_t length, uint8_t data);
 
+/**
+ * Write the masked bits of a byte to an I2C peripheral register, the other bits
+ * are kept.
+ * @param dev  Pointer to I2C peripheral to write to
+ * @param devAddress  The device address to write to
+ * @param memAddress  The internal address to write to.
+ * @param mask  The bits to write.
+ * @param data  The byte containing the bits to write.
+ *
+ * @return TRUE if write was successful, otherwise FALSE.
+ */
+bool i2cdevWriteMasked(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
+                       uint8_t mask, uint8_t data);
+
+/**
+ * Keep a shadow copy of a register, the read-modify-write functions
+ * (i2cdevWriteBit, i2cdevWriteBits and i2cdevWriteMasked) then use the copy
+ * instead of reading the register. Only for registers that the device never
+ * changes by itself and that are only written through i2cdevWriteReg8() and the
+ * functions based on it. Usually called when the device is initialized.
+ * @param dev  Pointer to the I2C peripheral of the device
+ * @param devAddress  The device address
+ * @param memAddress  The internal address of the register
+ *
+ * @return TRUE if the register is shadowed, FALSE if there is no room left.
+ */
+bool i2cdevShadowEnable(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress);
+
+/**
+ * Forget the shadow copies of the registers of a device, for instance after a
+ * reset of the device. The copies are refreshed on the next read-modify-write.
+ * @param dev  Pointer to the I2C peripheral of the device
+ * @param devAddress  The device address
+ */
+void i2cdevShadowInvalidate(I2C_Dev *dev, uint8_t devAddress);
+
 #endif //__I2CDEV_H__
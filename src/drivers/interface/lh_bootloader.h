@@ -36,6 +36,12 @@
  */
 #define LH_FW_ADDR          0x020000
 
+/**
+ * @brief Size of a page in the flash, a page write can not cross a page boundary
+ *
+ */
+#define LH_FLASH_PAGE_SIZE  256
+
 /**
  * Initialize the i2c lighthouse module
  *
@@ -91,6 +97,15 @@ bool lhblFlashWritePage(uint32_t address, uint16_t length, const uint8_t *data);
  */
 bool lhblFlashWriteFW(uint8_t *data, uint32_t length);
 
+/**
+ * Wait for an ongoing write or erase operation in the lighthouse spi flash
+ * to complete. A page write returns before the flash is done and the next
+ * operation must wait.
+ *
+ * @return True on success, else false.
+ */
+bool lhblFlashWaitComplete(void);
+
 /**
  * Erase firwmare section in lighthouse spi flash
  *
@@ -317,11 +317,26 @@ int motorsESCIsLo(uint32_t id);
  */
 void motorsBurstDshot();
 
+/**
+ * Get the motor speeds from the bidirectional DSHOT telemetry
+ *
+ * @param rpm Set to the speed of each motor [RPM], NBR_OF_MOTORS entries. 0 if there is no recent valid telemetry or
+ * if bidirectional DSHOT is not enabled.
+ */
+void motorsGetRpm(float* rpm);
+
 /**
  * Set the PWM ratio of the motor 'id'
  */
 void motorsSetRatio(uint32_t id, uint16_t ratio);
 
+/**
+ * Set the PWM ratios of all motors, NBR_OF_MOTORS entries. With PWM the new
+ * ratios are applied together at the same timer update event. With DSHOT the
+ * frames are prepared, to be sent with motorsBurstDshot().
+ */
+void motorsSetRatios(const uint16_t* ratios);
+
 /**
  * Get the PWM ratio of the motor 'id'. Return -1 if wrong ID.
  */
@@ -360,4 +375,13 @@ const MotorHealthTestDef* motorsGetHealthTestSettings(uint32_t id);
  */
 float motorsCompensateBatteryVoltage(uint32_t id, float iThrust, float supplyVoltage);
 
+/**
+ * @brief Battery compensation of all motors in one go, see motorsCompensateBatteryVoltage()
+ *
+ * @param thrust The desired thrust of each motor, NBR_OF_MOTORS entries
+ * @param compensated The PWM ratios required to get the desired thrust given the battery state, NBR_OF_MOTORS entries
+ * @param supplyVoltage The battery voltage
+ */
+void motorsCompensateBatteryVoltageAll(const int32_t* thrust, int32_t* compensated, float supplyVoltage);
+
 #endif /* __MOTORS_H__ */
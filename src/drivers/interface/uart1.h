@@ -44,6 +44,16 @@
 #define UART1_DMA_CH           DMA_Channel_4
 #define UART1_DMA_FLAG_TCIF    DMA_FLAG_TCIF3
 
+#define UART1_RX_DMA_IRQ       DMA1_Stream1_IRQn
+#define UART1_RX_DMA_STREAM    DMA1_Stream1
+#define UART1_RX_DMA_CH        DMA_Channel_4
+#define UART1_RX_DMA_IT_TCIF   DMA_IT_TCIF1
+
+// Size of the circular RX DMA buffer, must be a power of 2
+#define UART1_RX_DMA_BUFFER_SIZE 512
+// Max number of bytes in one call to uart1RxDmaPeek()
+#define UART1_RX_DMA_MAX_PEEK    32
+
 #define UART1_GPIO_PERIF       RCC_AHB1Periph_GPIOC
 #define UART1_GPIO_PORT        GPIOC
 #define UART1_GPIO_TX_PIN      GPIO_Pin_10
@@ -114,6 +124,42 @@ uint32_t uart1bytesAvailable();
  */
 uint32_t uart1QueueMaxLength();
 
+/**
+ * @brief Switch RX from the per byte interrupt and queue to circular DMA. After this call, received
+ * data is read with uart1RxDmaBytesAvailable(), uart1RxDmaPeek() and uart1RxDmaConsume() instead of
+ * the queue based functions. Call after uart1Init().
+ *
+ * @return true if RX DMA is used, false if it is not available in this configuration (the DMA
+ * stream is used by the DShot motor driver) and the queue based RX is still active.
+ */
+bool uart1EnableRxDma(void);
+
+/**
+ * @brief Get the number of received bytes in the RX DMA buffer that have not been consumed yet.
+ * If the DMA has overwritten unread data, the buffer is emptied and uart1DidOverrun() will
+ * return true.
+ *
+ * @return uint32_t  Number of bytes available
+ */
+uint32_t uart1RxDmaBytesAvailable(void);
+
+/**
+ * @brief Get a pointer to the next bytes in the RX DMA buffer, without consuming them. The data
+ * is normally read in place in the DMA buffer, if it wraps around the end of the buffer it is
+ * copied to a small internal buffer. The data is valid until the next call to uart1RxDmaPeek().
+ *
+ * @param size  Number of bytes, at most UART1_RX_DMA_MAX_PEEK and at most the number of available bytes
+ * @return const uint8_t*  Pointer to the data
+ */
+const uint8_t* uart1RxDmaPeek(const uint32_t size);
+
+/**
+ * @brief Mark bytes in the RX DMA buffer as read
+ *
+ * @param size  Number of bytes
+ */
+void uart1RxDmaConsume(const uint32_t size);
+
 /**
  * Sends raw data using a lock. Should be used from
  * exception functions and for debugging when a lot of data
@@ -83,6 +83,15 @@ void uart2SendData(uint32_t size, uint8_t* data);
  */
 void uart2SendDataDmaBlocking(uint32_t size, uint8_t* data);
 
+/**
+ * Sends raw data using double buffered DMA transfers. The data is copied
+ * and the function returns as soon as a DMA buffer is available for the
+ * last part of it, while the transfer is still in progress.
+ * @param[in] size  Number of bytes to send
+ * @param[in] data  Pointer to data
+ */
+void uart2SendDataDma(uint32_t size, const uint8_t* data);
+
 /**
  * Send a single character to the serial port using the uartSendData function.
  * @param[in] ch Character to print. Only the 8 LSB are used.
@@ -48,6 +48,7 @@
 #define UARTSLK_DMA_RX_STREAM    DMA2_Stream1
 #define UARTSLK_DMA_RX_CH        DMA_Channel_5
 #define UARTSLK_DMA_RX_FLAG_TCIF DMA_FLAG_TCIF1
+#define UARTSLK_DMA_RX_FLAG_HTIF DMA_FLAG_HTIF1
 
 #define UARTSLK_GPIO_PERIF       RCC_AHB1Periph_GPIOC
 #define UARTSLK_GPIO_PORT        GPIOC
@@ -132,8 +133,16 @@ void uartslkSendDataIsrBlocking(uint32_t size, uint8_t* data);
 int uartslkPutchar(int ch);
 
 /**
- * Sends raw data using DMA transfer.
- * @param[in] size  Number of bytes to send
+ * Queues raw data for DMA transfer. The data is copied, the function only
+ * blocks if the TX queue is full.
+ * @param[in] size  Number of bytes to send, at most SYSLINK_MTU + 6
+ * @param[in] data  Pointer to data
+ */
+void uartslkSendDataDma(uint32_t size, uint8_t* data);
+
+/**
+ * Sends raw data using DMA transfer, blocks until all the queued data is sent.
+ * @param[in] size  Number of bytes to send, at most SYSLINK_MTU + 6
  * @param[in] data  Pointer to data
  */
 void uartslkSendDataDmaBlocking(uint32_t size, uint8_t* data);
@@ -3,6 +3,8 @@
 
 void ws2812Init(void);
 void ws2812Send(uint8_t (*color)[3], uint16_t len);
+// Wait until the colors given to the previous ws2812Send() are no longer used
+void ws2812WaitDone(void);
 void ws2812DmaIsr(void);
 
 #endif
@@ -35,6 +35,7 @@
 #include "nvicconf.h"
 #include "commander.h"
 #include "static_mem.h"
+#include "usec_time.h"
 
 #define DEBUG_MODULE  "CPPM"
 #include "debug.h"
@@ -86,6 +87,7 @@
 
 #define CPPM_MIN_PPM_USEC            1100
 #define CPPM_MAX_PPM_USEC            1900
+#define CPPM_SYNC_MIN_USEC           2100
 
 #if (CPPM_TIMER_NUMBER == 3)
   #define CPPM_TIMER                   TIM3
@@ -144,12 +146,23 @@
 #endif
 
 
-static xQueueHandle captureQueue;
-STATIC_MEM_QUEUE_ALLOC(captureQueue, 64, sizeof(uint16_t));
+// The frame is decoded in the capture interrupt and handed over complete, the
+// queue only holds the latest frame.
+static xQueueHandle frameQueue;
+STATIC_MEM_QUEUE_ALLOC(frameQueue, 1, sizeof(cppmFrame_t));
+static cppmFrame_t frameInProgress;
+// Number of channels in the previous frame, the frame is published as soon as
+// this many channels are received instead of waiting for the sync gap.
+static uint8_t expectedChannels;
+static bool isFramePublished;
+static bool isFrameValid;
 static uint16_t prevCaptureVal;
 static bool captureFlag;
 static bool isAvailible;
 
+static uint32_t frameCount;
+static uint32_t frameDropCount;
+
 void cppmInit(void)
 {
   TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
@@ -189,7 +202,7 @@ void cppmInit(void)
   NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
   NVIC_Init(&NVIC_InitStructure);
 
-  captureQueue = STATIC_MEM_QUEUE_CREATE(captureQueue);
+  frameQueue = STATIC_MEM_QUEUE_CREATE(frameQueue);
 
   TIM_ITConfig(CPPM_TIMER, TIM_IT_Update | CPPM_TIMER_IT_CC, ENABLE);
   TIM_Cmd(CPPM_TIMER, ENABLE);
@@ -200,16 +213,16 @@ bool cppmIsAvailible(void)
   return isAvailible;
 }
 
-int cppmGetTimestamp(uint16_t *timestamp)
+int cppmGetFrame(cppmFrame_t *frame)
 {
-  ASSERT(timestamp);
+  ASSERT(frame);
 
-  return xQueueReceive(captureQueue, timestamp, portMAX_DELAY);
+  return xQueueReceive(frameQueue, frame, portMAX_DELAY);
 }
 
 void cppmClearQueue(void)
 {
-  xQueueReset(captureQueue);
+  xQueueReset(frameQueue);
 }
 
 float cppmConvert2Float(uint16_t timestamp, float min, float max, float deadband)
@@ -272,6 +285,50 @@ uint16_t cppmConvert2uint16(uint16_t timestamp)
   return base * (65535 / (CPPM_MAX_PPM_USEC - CPPM_MIN_PPM_USEC));
 }
 
+static void cppmPublishFrameFromISR(portBASE_TYPE *xHigherPriorityTaskWoken)
+{
+  frameInProgress.timestamp = usecTimestamp();
+
+  if (uxQueueMessagesWaitingFromISR(frameQueue) > 0)
+  {
+    frameDropCount++;
+  }
+  xQueueOverwriteFromISR(frameQueue, &frameInProgress, xHigherPriorityTaskWoken);
+
+  frameCount++;
+  isFramePublished = true;
+}
+
+// Called for every captured edge with the time since the previous edge
+static void cppmDecodeEdgeFromISR(uint16_t captureValDiff, portBASE_TYPE *xHigherPriorityTaskWoken)
+{
+  if (captureValDiff >= CPPM_SYNC_MIN_USEC)
+  {
+    // Sync gap, the frame is complete if it was not already published
+    if (isFrameValid && !isFramePublished && frameInProgress.count > 0 && isAvailible)
+    {
+      cppmPublishFrameFromISR(xHigherPriorityTaskWoken);
+    }
+
+    expectedChannels = isFrameValid ? frameInProgress.count : 0;
+    frameInProgress.count = 0;
+    isFramePublished = false;
+    isFrameValid = true;
+    return;
+  }
+
+  if (frameInProgress.count < CPPM_MAX_CHANNELS)
+  {
+    frameInProgress.ch[frameInProgress.count] = captureValDiff;
+    frameInProgress.count++;
+  }
+
+  if (isFrameValid && !isFramePublished && frameInProgress.count == expectedChannels && isAvailible)
+  {
+    cppmPublishFrameFromISR(xHigherPriorityTaskWoken);
+  }
+}
+
 #if (CPPM_TIMER_NUMBER == 3)
 void __attribute__((used)) TIM3_IRQHandler()
 #elif (CPPM_TIMER_NUMBER == 9)
@@ -290,7 +347,9 @@ void __attribute__((used)) TIM8_TRG_COM_TIM14_IRQHandler()
   {
     if (TIM_GetFlagStatus(CPPM_TIMER, CPPM_TIMER_FLAG_CC) != RESET)
     {
-      //TODO: Handle overflow error
+      // An edge was missed, drop the frame until the next sync gap
+      isFrameValid = false;
+      TIM_ClearFlag(CPPM_TIMER, CPPM_TIMER_FLAG_CC);
     }
 
     #if (CPPM_TIMER_CHANNEL == 2)
@@ -305,7 +364,7 @@ void __attribute__((used)) TIM8_TRG_COM_TIM14_IRQHandler()
     captureValDiff = captureVal - prevCaptureVal;
     prevCaptureVal = captureVal;
 
-    xQueueSendFromISR(captureQueue, &captureValDiff, &xHigherPriorityTaskWoken);
+    cppmDecodeEdgeFromISR(captureValDiff, &xHigherPriorityTaskWoken);
 
     captureFlag = true;
     TIM_ClearITPendingBit(CPPM_TIMER, CPPM_TIMER_IT_CC);
@@ -318,5 +377,25 @@ void __attribute__((used)) TIM8_TRG_COM_TIM14_IRQHandler()
     captureFlag = false;
     TIM_ClearITPendingBit(CPPM_TIMER, TIM_IT_Update);
   }
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
+/**
+ * CPPM decoder statistics
+ */
+LOG_GROUP_START(cppm)
+/**
+ * @brief Number of complete frames decoded
+ */
+LOG_ADD(LOG_UINT32, frames, &frameCount)
+/**
+ * @brief Number of frames overwritten before they were used
+ */
+LOG_ADD(LOG_UINT32, dropped, &frameDropCount)
+/**
+ * @brief Number of channels in the latest frame
+ */
+LOG_ADD(LOG_UINT8, channels, &expectedChannels)
+LOG_GROUP_STOP(cppm)
+
@@ -32,11 +32,15 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
+#include "timers.h"
 
 #include "eeprom.h"
+#include "i2c_drv.h"
 #include "debug.h"
 #include "eprintf.h"
 #include "mem.h"
+#include "log.h"
 
 #ifdef EEPROM_RUN_WRITE_READ_TEST
 static bool eepromTestWriteRead(void);
@@ -56,6 +60,58 @@ static uint8_t devAddr;
 static I2C_Dev *I2Cx;
 static bool isInit;
 
+// Number of pages that can wait to be written
+#define WRITE_QUEUE_PAGES 8
+
+// The write engine runs every tick while there are pages to write. A page
+// write is retried while the eeprom is busy, after it the eeprom is polled
+// until the write cycle is done.
+#define WRITE_ENGINE_PERIOD M2T(1)
+#define WRITE_ATTEMPTS 60
+#define POLL_ATTEMPTS 30
+
+/* Data waiting to be written to one page of the eeprom. Consecutive writes to
+ * the same page are merged while waiting. */
+typedef struct
+{
+  uint16_t address;
+  uint8_t length;
+  uint8_t data[EEPROM_PAGE_SIZE];
+  eepromWriteCallback_t callback;
+  void* callbackArg;
+  uint32_t errorsAtQueue;
+} eepromPage_t;
+
+typedef enum
+{
+  writeIdle,
+  writeData,
+  writePoll,
+} eepromWriteState_t;
+
+// Queue of pages to write, in order, the first one is the one being written.
+// Protected by the pages mutex.
+static eepromPage_t pages[WRITE_QUEUE_PAGES];
+static int pageFirst;
+static int pageCount;
+static SemaphoreHandle_t pagesMutex;
+static StaticSemaphore_t pagesMutexBuffer;
+
+static xTimerHandle writeTimer;
+static StaticTimer_t writeTimerBuffer;
+static eepromWriteState_t writeState;
+static int writeAttempts;
+static I2cMessage writeMessage;
+static I2cTransaction writeTransaction;
+static bool isTransactionQueued;
+static uint8_t pollDummy;
+
+static uint32_t pagesWritten;
+static uint32_t writesMerged;
+static uint32_t writeErrors;
+
+static void eepromWriteTimer(xTimerHandle timer);
+
 bool eepromInit(I2C_Dev *i2cPort)
 {
   if (isInit) {
@@ -67,6 +123,12 @@ bool eepromInit(I2C_Dev *i2cPort)
   I2Cx = i2cPort;
   devAddr = EEPROM_I2C_ADDR;
 
+  pagesMutex = xSemaphoreCreateMutexStatic(&pagesMutexBuffer);
+  writeTimer = xTimerCreateStatic("eepromTimer", WRITE_ENGINE_PERIOD, pdTRUE, NULL, eepromWriteTimer, &writeTimerBuffer);
+  writeTransaction.messages = &writeMessage;
+  writeTransaction.messageCount = 1;
+  writeTransaction.priority = i2cPriorityNormal;
+
   isInit = true;
 
   return true;
@@ -138,71 +200,225 @@ bool eepromTestConnection(void)
 
 bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len)
 {
-  bool status;
+  bool status = false;
 
   if ((uint32_t)readAddr + len > EEPROM_SIZE)
   {
      return false;
   }
 
-  status = i2cdevRead16(I2Cx, devAddr, readAddr, len, buffer);
+  xSemaphoreTake(pagesMutex, portMAX_DELAY);
+
+  // The eeprom does not answer during a write cycle
+  for (int retry = 0; retry < POLL_ATTEMPTS && !status; retry++) {
+    status = i2cdevRead16(I2Cx, devAddr, readAddr, len, buffer);
+    if (!status) {
+      vTaskDelay(M2T(1));
+    }
+  }
+
+  // Data not written yet is newer than the content of the eeprom
+  for (int i = 0; i < pageCount && status; i++) {
+    const eepromPage_t *page = &pages[(pageFirst + i) % WRITE_QUEUE_PAGES];
+    const uint16_t start = (page->address > readAddr) ? page->address : readAddr;
+    const uint16_t end = ((page->address + page->length) < (readAddr + len)) ? (page->address + page->length) : (readAddr + len);
+    if (start < end) {
+      memcpy(&buffer[start - readAddr], &page->data[start - page->address], end - start);
+    }
+  }
+
+  xSemaphoreGive(pagesMutex);
 
   return status;
 }
 
 bool eepromWriteBuffer(const uint8_t* buffer, uint16_t writeAddr, uint16_t len)
 {
-  bool status;
+  const uint32_t errors = writeErrors;
 
-  unsigned char pageBuffer[32];
-  int bufferIndex = 0;
-  int leftToWrite = len;
-  uint16_t currentAddress = writeAddr;
-  uint16_t pageAddress = writeAddr;
+  if (!eepromWriteBufferAsync(buffer, writeAddr, len, 0, 0)) {
+    return false;
+  }
 
-  if ((uint32_t)writeAddr + len > EEPROM_SIZE)
+  return eepromWaitIdle(portMAX_DELAY) && (writeErrors == errors);
+}
+
+// Adds data within one page to the write queue, called with the pages mutex taken
+static void queuePageData(const uint8_t* data, uint16_t address, uint8_t length,
+                          eepromWriteCallback_t callback, void* callbackArg)
+{
+  // Merge with the last page in the queue, if it is for the same page, not
+  // being written and the data is contiguous. The write order is kept.
+  if (pageCount > 0) {
+    eepromPage_t *last = &pages[(pageFirst + pageCount - 1) % WRITE_QUEUE_PAGES];
+    const bool isWritten = (pageCount == 1) && (writeState != writeIdle);
+    if (!isWritten &&
+        (last->address / EEPROM_PAGE_SIZE) == (address / EEPROM_PAGE_SIZE) &&
+        address <= last->address + last->length &&
+        address + length >= last->address &&
+        !(last->callback && callback)) {
+      const uint16_t start = (last->address < address) ? last->address : address;
+      const uint16_t end = ((last->address + last->length) > (address + length)) ? (last->address + last->length) : (address + length);
+      memmove(&last->data[last->address - start], last->data, last->length);
+      memcpy(&last->data[address - start], data, length);
+      last->address = start;
+      last->length = end - start;
+      if (callback) {
+        last->callback = callback;
+        last->callbackArg = callbackArg;
+        last->errorsAtQueue = writeErrors;
+      }
+      writesMerged++;
+      return;
+    }
+  }
+
+  eepromPage_t *page = &pages[(pageFirst + pageCount) % WRITE_QUEUE_PAGES];
+  page->address = address;
+  page->length = length;
+  memcpy(page->data, data, length);
+  page->callback = callback;
+  page->callbackArg = callbackArg;
+  page->errorsAtQueue = writeErrors;
+  pageCount++;
+}
+
+bool eepromWriteBufferAsync(const uint8_t* buffer, uint16_t writeAddr, uint16_t len,
+                            eepromWriteCallback_t callback, void* callbackArg)
+{
+  if ((uint32_t)writeAddr + len > EEPROM_SIZE || len == 0)
   {
      return false;
   }
 
-  while (leftToWrite > 0) {
-    int pageIndex = 0;
-    pageAddress = currentAddress;
-    do {
-      pageBuffer[pageIndex++] = buffer[bufferIndex++];
-      leftToWrite -= 1;
-      currentAddress += 1;
-    } while ((leftToWrite > 0) && (currentAddress % 32 != 0));
-
-    // Writing page
-    for (int retry = 0; retry < 10; retry++) {
-      status = i2cdevWrite16(I2Cx, devAddr, pageAddress, pageIndex, pageBuffer);
-      if (status) {
-        break;
-      }
-      vTaskDelay(M2T(6));
+  uint16_t bufferIndex = 0;
+  while (bufferIndex < len) {
+    const uint16_t address = writeAddr + bufferIndex;
+    uint16_t length = EEPROM_PAGE_SIZE - (address % EEPROM_PAGE_SIZE);
+    if (length > len - bufferIndex) {
+      length = len - bufferIndex;
     }
-    if (!status) {
-      return false;
+    const bool isLast = (bufferIndex + length == len);
+
+    xSemaphoreTake(pagesMutex, portMAX_DELAY);
+    // Wait for room in the queue
+    while (pageCount == WRITE_QUEUE_PAGES) {
+      xSemaphoreGive(pagesMutex);
+      vTaskDelay(WRITE_ENGINE_PERIOD);
+      xSemaphoreTake(pagesMutex, portMAX_DELAY);
     }
+    queuePageData(&buffer[bufferIndex], address, length, isLast ? callback : 0, callbackArg);
+    xSemaphoreGive(pagesMutex);
 
-    // Waiting for page to be written
-    for (int retry = 0; retry < 30; retry++) {
-      uint8_t dummy;
-      status = i2cdevWrite(I2Cx, devAddr, 1, &dummy);
+    xTimerStart(writeTimer, M2T(10));
+    bufferIndex += length;
+  }
 
-      if (status) {
-        break;
-      }
+  return true;
+}
 
-      vTaskDelay(M2T(1));
+bool eepromWaitIdle(uint32_t timeout)
+{
+  const TickType_t start = xTaskGetTickCount();
+
+  while (true) {
+    xSemaphoreTake(pagesMutex, portMAX_DELAY);
+    const bool isIdle = (pageCount == 0);
+    xSemaphoreGive(pagesMutex);
+
+    if (isIdle) {
+      return true;
     }
-    if (!status) {
+    if ((xTaskGetTickCount() - start) >= timeout) {
       return false;
     }
+
+    // The engine may not have been started if the timer queue was full
+    if (!xTimerIsTimerActive(writeTimer)) {
+      xTimerStart(writeTimer, 0);
+    }
+    vTaskDelay(WRITE_ENGINE_PERIOD);
   }
+}
 
-  return status;
+/* Runs the writes of the queued pages, in the timer task. Each step queues one
+ * i2c transaction, the outcome is checked in the next step. */
+static void eepromWriteTimer(xTimerHandle timer)
+{
+  if (isTransactionQueued && !writeTransaction.isDone) {
+    return;
+  }
+  if (xSemaphoreTake(pagesMutex, 0) == pdFALSE) {
+    return;
+  }
+
+  const bool isAck = isTransactionQueued && (writeTransaction.status == i2cAck);
+  isTransactionQueued = false;
+
+  bool isPageDone = false;
+  bool isSuccess = false;
+  switch (writeState) {
+    case writeIdle:
+      break;
+    case writeData:
+      if (isAck) {
+        writeState = writePoll;
+        writeAttempts = 0;
+      } else if (++writeAttempts >= WRITE_ATTEMPTS) {
+        isPageDone = true;
+      }
+      break;
+    case writePoll:
+      if (isAck) {
+        isPageDone = true;
+        isSuccess = true;
+      } else if (++writeAttempts >= POLL_ATTEMPTS) {
+        isPageDone = true;
+      }
+      break;
+  }
+
+  eepromWriteCallback_t callback = 0;
+  void* callbackArg = 0;
+  bool callbackSuccess = false;
+  if (isPageDone) {
+    eepromPage_t *page = &pages[pageFirst];
+    if (isSuccess) {
+      pagesWritten++;
+    } else {
+      writeErrors++;
+    }
+    callback = page->callback;
+    callbackArg = page->callbackArg;
+    callbackSuccess = (writeErrors == page->errorsAtQueue);
+
+    pageFirst = (pageFirst + 1) % WRITE_QUEUE_PAGES;
+    pageCount--;
+    writeState = writeIdle;
+  }
+
+  if (writeState == writeIdle && pageCount > 0) {
+    writeState = writeData;
+    writeAttempts = 0;
+  }
+
+  if (writeState == writeData) {
+    const eepromPage_t *page = &pages[pageFirst];
+    i2cdrvCreateMessageIntAddr(&writeMessage, devAddr, true, page->address, i2cWrite, page->length, page->data);
+    isTransactionQueued = i2cdrvTransactionQueue(I2Cx, &writeTransaction);
+  } else if (writeState == writePoll) {
+    // The eeprom acks its address again when the write cycle is done
+    i2cdrvCreateMessage(&writeMessage, devAddr, i2cWrite, 1, &pollDummy);
+    isTransactionQueued = i2cdrvTransactionQueue(I2Cx, &writeTransaction);
+  } else {
+    xTimerStop(timer, 0);
+  }
+
+  xSemaphoreGive(pagesMutex);
+
+  if (callback) {
+    callback(callbackSuccess, callbackArg);
+  }
 }
 
 bool eepromWritePage(uint8_t* buffer, uint16_t writeAddr)
@@ -234,3 +450,25 @@ static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const
 
   return result;
 }
+
+/**
+ * Asynchronous writes to the eeprom
+ */
+LOG_GROUP_START(eeprom)
+/**
+ * @brief Number of pages written
+ */
+LOG_ADD(LOG_UINT32, pages, &pagesWritten)
+/**
+ * @brief Number of writes merged with a page waiting to be written
+ */
+LOG_ADD(LOG_UINT32, merged, &writesMerged)
+/**
+ * @brief Number of page writes that failed
+ */
+LOG_ADD(LOG_UINT32, errors, &writeErrors)
+/**
+ * @brief Number of pages waiting to be written
+ */
+LOG_ADD(LOG_INT32, queued, &pageCount)
+LOG_GROUP_STOP(eeprom)
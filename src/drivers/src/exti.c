@@ -30,6 +30,7 @@
 #include "exti.h"
 #include "nvicconf.h"
 #include "nrf24l01.h"
+#include "isr_trace.h"
 
 static bool isInit;
 
@@ -91,41 +92,52 @@ bool extiTest(void)
 
 void __attribute__((used)) EXTI0_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI0_IRQn);
   EXTI_ClearITPendingBit(EXTI_Line0);
   EXTI0_Callback();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI1_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI1_IRQn);
   EXTI_ClearITPendingBit(EXTI_Line1);
   EXTI1_Callback();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI2_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI2_IRQn);
   EXTI_ClearITPendingBit(EXTI_Line2);
   EXTI2_Callback();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI3_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI3_IRQn);
   EXTI_ClearITPendingBit(EXTI_Line3);
   EXTI3_Callback();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI4_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI4_IRQn);
   EXTI_ClearITPendingBit(EXTI_Line4);
   EXTI4_Callback();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI9_5_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI9_5_IRQn);
   if (EXTI_GetITStatus(EXTI_Line5) == SET) {
     EXTI_ClearITPendingBit(EXTI_Line5);
@@ -151,10 +163,12 @@ void __attribute__((used)) EXTI9_5_IRQHandler(void)
     EXTI_ClearITPendingBit(EXTI_Line9);
     EXTI9_Callback();
   }
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) EXTI15_10_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
   if (EXTI_GetITStatus(EXTI_Line10) == SET) {
     EXTI_ClearITPendingBit(EXTI_Line10);
@@ -185,6 +199,7 @@ void __attribute__((used)) EXTI15_10_IRQHandler(void)
     EXTI_ClearITPendingBit(EXTI_Line15);
     EXTI15_Callback();
   }
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((weak)) EXTI0_Callback(void) { }
@@ -446,6 +446,13 @@ DRESULT SD_disk_write(const BYTE *buff, DWORD sector, UINT count, void * usrOps)
           }
 
           buff += 512;
+
+          // Release the SPI bus between blocks, as in waitForCardReady(), to
+          // bound the time other devices on the bus have to wait
+          if (count > 1) {
+            context->csHigh(0);
+            context->csLow();
+          }
         } while (--count);
 
         // STOP_TRAN
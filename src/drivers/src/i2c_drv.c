@@ -48,14 +48,12 @@
 #include "config.h"
 #include "nvicconf.h"
 #include "sleepus.h"
+#include "usec_time.h"
+#include "log.h"
+#include "isr_trace.h"
 
 #include "autoconf.h"
 
-//DEBUG
-#ifdef I2CDRV_DEBUG_LOG_EVENTS
-#include "usec_time.h"
-#endif
-
 // Definitions of sensors I2C bus
 #define I2C_DEFAULT_SENSORS_CLOCK_SPEED             400000
 
@@ -67,6 +65,10 @@
 #define I2C_SLAVE_ADDRESS7      0x30
 #define I2C_MAX_RETRIES         2
 #define I2C_MESSAGE_TIMEOUT     M2T(1000)
+// Max number of polls of the STOP bit before a new start is generated, a
+// stop takes a few us at 400 kHz.
+#define I2C_STOP_WAIT_MAX       1000
+#define I2C_UTILIZATION_INTERVAL_MS 1000
 
 // Helpers to unlock bus
 #define I2CDEV_CLK_TS (10)
@@ -98,6 +100,10 @@ static void i2cdrvDmaSetupBus(I2cDrv* i2c);
  * Start the i2c transfer
  */
 static void i2cdrvStartTransfer(I2cDrv *i2c);
+/**
+ * Start the next pending transaction, if the bus is idle
+ */
+static void i2cdrvStartNextTransaction(I2cDrv* i2c);
 /**
  * Try to restart a hanged buss
  */
@@ -195,6 +201,9 @@ static void i2cdrvStartTransfer(I2cDrv *i2c)
 {
   ASSERT_DMA_SAFE(i2c->txMessage.buffer);
 
+  // A start must not be generated while the stop of the previous message is in progress
+  for (int i = 0; (i2c->def->i2cPort->CR1 & I2C_CR1_STOP) && i < I2C_STOP_WAIT_MAX; i++) { ; }
+
   if (i2c->txMessage.direction == i2cRead)
   {
     i2c->DMAStruct.DMA_BufferSize = i2c->txMessage.messageLength;
@@ -214,11 +223,95 @@ static void i2cTryNextMessage(I2cDrv* i2c)
   I2C_ITConfig(i2c->def->i2cPort, I2C_IT_EVT | I2C_IT_BUF, DISABLE);
 }
 
+static void i2cdrvStartMessage(I2cDrv* i2c)
+{
+  I2cTransaction* transaction = i2c->currentTransaction;
+  memcpy((char*)&i2c->txMessage, (char*)&transaction->messages[transaction->messageNr], sizeof(I2cMessage));
+  i2cdrvStartTransfer(i2c);
+}
+
+static void i2cdrvStartNextTransaction(I2cDrv* i2c)
+{
+  if (i2c->currentTransaction || i2c->isRestarting)
+  {
+    return;
+  }
+
+  for (int priority = i2cPriorityCount - 1; priority >= 0; priority--)
+  {
+    I2cTransaction* transaction = i2c->pendingHead[priority];
+    if (transaction)
+    {
+      i2c->pendingHead[priority] = transaction->next;
+      if (!transaction->next)
+      {
+        i2c->pendingTail[priority] = 0;
+      }
+      transaction->next = 0;
+      i2c->stats.pendingCount--;
+
+      i2c->currentTransaction = transaction;
+      i2c->stats.busyStartUs = usecTimestamp();
+      i2cdrvStartMessage(i2c);
+      return;
+    }
+  }
+}
+
+static void i2cdrvFinishTransaction(I2cDrv* i2c, I2cStatus status)
+{
+  I2cTransaction* transaction = i2c->currentTransaction;
+
+  i2c->stats.busyUs += (uint32_t)(usecTimestamp() - i2c->stats.busyStartUs);
+  i2c->stats.transactionCount++;
+  if (status != i2cAck)
+  {
+    i2c->stats.nackCount++;
+  }
+
+  i2c->currentTransaction = 0;
+  transaction->status = status;
+  transaction->isDone = true;
+
+  if (transaction->callback)
+  {
+    transaction->callback(transaction);
+  }
+
+  if (transaction->doneSemaphore)
+  {
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+    xSemaphoreGiveFromISR(transaction->doneSemaphore, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  }
+}
+
+/**
+ * Called from the interrupts when the current message is done. Continues with the next
+ * message of the transaction, or the next pending transaction.
+ */
 static void i2cNotifyClient(I2cDrv* i2c)
 {
-  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-  xSemaphoreGiveFromISR(i2c->isBusFreeSemaphore, &xHigherPriorityTaskWoken);
-  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  // Stop, a new start is generated for the next message if any.
+  i2cTryNextMessage(i2c);
+
+  I2cTransaction* transaction = i2c->currentTransaction;
+  if (!transaction)
+  {
+    return;
+  }
+
+  const I2cStatus status = i2c->txMessage.status;
+  transaction->messages[transaction->messageNr].status = status;
+  if (status == i2cAck && ++transaction->messageNr < transaction->messageCount)
+  {
+    i2cdrvStartMessage(i2c);
+  }
+  else
+  {
+    i2cdrvFinishTransaction(i2c, status);
+    i2cdrvStartNextTransaction(i2c);
+  }
 }
 
 static void i2cdrvTryToRestartBus(I2cDrv* i2c)
@@ -399,34 +492,136 @@ void i2cdrvCreateMessageIntAddr(I2cMessage *message,
   message->nbrOfRetries = I2C_MAX_RETRIES;
 }
 
-bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message)
+static void i2cdrvAbortTransaction(I2cDrv* i2c, I2cTransaction* transaction)
 {
-  bool status = false;
+  bool isCurrent = false;
 
-  xSemaphoreTake(i2c->isBusFreeMutex, portMAX_DELAY); // Protect message data
-  // Copy message
-  memcpy((char*)&i2c->txMessage, (char*)message, sizeof(I2cMessage));
-  // We can now start the ISR sending this message.
-  i2cdrvStartTransfer(i2c);
-  // Wait for transaction to be done
-  if (xSemaphoreTake(i2c->isBusFreeSemaphore, I2C_MESSAGE_TIMEOUT) == pdTRUE)
+  taskENTER_CRITICAL();
+  if (i2c->currentTransaction == transaction)
   {
-    if (i2c->txMessage.status == i2cAck)
+    // Keep other transactions off the bus until it is restarted
+    isCurrent = true;
+    i2c->currentTransaction = 0;
+    i2c->isRestarting = true;
+    I2C_ITConfig(i2c->def->i2cPort, I2C_IT_EVT | I2C_IT_BUF, DISABLE);
+    i2cdrvClearDMA(i2c);
+  }
+  else if (!transaction->isDone)
+  {
+    // Still pending, remove it from the queue
+    I2cTransaction** link = &i2c->pendingHead[transaction->priority];
+    I2cTransaction* previous = 0;
+    while (*link && *link != transaction)
     {
-      status = true;
+      previous = *link;
+      link = &(*link)->next;
+    }
+    if (*link)
+    {
+      *link = transaction->next;
+      if (i2c->pendingTail[transaction->priority] == transaction)
+      {
+        i2c->pendingTail[transaction->priority] = previous;
+      }
+      i2c->stats.pendingCount--;
     }
   }
-  else
+  transaction->status = i2cNack;
+  transaction->isDone = true;
+  taskEXIT_CRITICAL();
+
+  if (isCurrent)
   {
-    i2cdrvClearDMA(i2c);
     i2cdrvTryToRestartBus(i2c);
     //TODO: If bus is really hanged... fail safe
+
+    taskENTER_CRITICAL();
+    i2c->isRestarting = false;
+    i2cdrvStartNextTransaction(i2c);
+    taskEXIT_CRITICAL();
+  }
+}
+
+static void i2cdrvEnqueueTransaction(I2cDrv* i2c, I2cTransaction* transaction)
+{
+  if (i2c->pendingTail[transaction->priority])
+  {
+    i2c->pendingTail[transaction->priority]->next = transaction;
+  }
+  else
+  {
+    i2c->pendingHead[transaction->priority] = transaction;
+  }
+  i2c->pendingTail[transaction->priority] = transaction;
+
+  i2c->stats.pendingCount++;
+  if (i2c->stats.pendingCount > i2c->stats.pendingMax)
+  {
+    i2c->stats.pendingMax = i2c->stats.pendingCount;
+  }
+
+  i2cdrvStartNextTransaction(i2c);
+}
+
+bool i2cdrvTransactionQueue(I2cDrv* i2c, I2cTransaction* transaction)
+{
+  if (transaction->messageCount == 0 || transaction->priority >= i2cPriorityCount)
+  {
+    return false;
+  }
+
+  transaction->isDone = false;
+  transaction->status = i2cAck;
+  transaction->messageNr = 0;
+  transaction->next = 0;
+
+  taskENTER_CRITICAL();
+  i2cdrvEnqueueTransaction(i2c, transaction);
+  taskEXIT_CRITICAL();
+
+  return true;
+}
+
+bool i2cdrvTransactionTransfer(I2cDrv* i2c, I2cTransaction* transaction)
+{
+  bool status = false;
+
+  // Only one blocking transfer per bus at the time, they share the semaphore
+  xSemaphoreTake(i2c->isBusFreeMutex, portMAX_DELAY);
+  transaction->callback = 0;
+  transaction->doneSemaphore = i2c->isBusFreeSemaphore;
+  if (i2cdrvTransactionQueue(i2c, transaction))
+  {
+    // Wait for transaction to be done
+    if (xSemaphoreTake(i2c->isBusFreeSemaphore, I2C_MESSAGE_TIMEOUT) == pdTRUE)
+    {
+      status = (transaction->status == i2cAck);
+    }
+    else
+    {
+      i2c->stats.timeoutCount++;
+      i2cdrvAbortTransaction(i2c, transaction);
+      // The transaction may have finished just after the timeout
+      xSemaphoreTake(i2c->isBusFreeSemaphore, 0);
+    }
   }
   xSemaphoreGive(i2c->isBusFreeMutex);
 
   return status;
 }
 
+bool i2cdrvMessageTransfer(I2cDrv* i2c, I2cMessage* message)
+{
+  I2cTransaction transaction =
+  {
+    .messages = message,
+    .messageCount = 1,
+    .priority = i2cPriorityNormal,
+  };
+
+  return i2cdrvTransactionTransfer(i2c, &transaction);
+}
+
 
 static void i2cdrvEventIsrHandler(I2cDrv* i2c)
 {
@@ -525,9 +720,8 @@ static void i2cdrvEventIsrHandler(I2cDrv* i2c)
       }
       else
       {
+        // Stop and continue with the next message, if any.
         i2cNotifyClient(i2c);
-        // Are there any other messages to transact? If so stop else repeated start.
-        i2cTryNextMessage(i2c);
       }
     }
     else // Reading. Shouldn't happen since we use DMA for reading.
@@ -536,9 +730,8 @@ static void i2cdrvEventIsrHandler(I2cDrv* i2c)
       i2c->txMessage.buffer[i2c->messageIndex++] = I2C_ReceiveData(i2c->def->i2cPort);
       if(i2c->messageIndex == i2c->txMessage.messageLength)
       {
-        i2cNotifyClient(i2c);
         // Are there any other messages to transact?
-        i2cTryNextMessage(i2c);
+        i2cNotifyClient(i2c);
       }
     }
     // A second BTF interrupt might occur if we don't wait for it to clear.
@@ -594,7 +787,6 @@ static void i2cdrvErrorIsrHandler(I2cDrv* i2c)
       // Failed so notify client and try next message if any.
       i2c->txMessage.status = i2cNack;
       i2cNotifyClient(i2c);
-      i2cTryNextMessage(i2c);
     }
     I2C_ClearFlag(i2c->def->i2cPort, I2C_FLAG_AF);
   }
@@ -634,20 +826,23 @@ static void i2cdrvDmaIsrHandler(I2cDrv* i2c)
     i2c->txMessage.status = i2cAck;
   }
   i2cdrvClearDMA(i2c);
-  i2cNotifyClient(i2c);
   // Are there any other messages to transact?
-  i2cTryNextMessage(i2c);
+  i2cNotifyClient(i2c);
 }
 
 
 void __attribute__((used)) I2C1_ER_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   i2cdrvErrorIsrHandler(&deckBus);
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) I2C1_EV_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   i2cdrvEventIsrHandler(&deckBus);
+  ISR_TRACE_EXIT();
 }
 
 #ifdef CONFIG_DECK_USD_USE_ALT_PINS_AND_SPI
@@ -656,20 +851,103 @@ void __attribute__((used)) DMA1_Stream5_IRQHandler(void)
 void __attribute__((used)) DMA1_Stream0_IRQHandler(void)
 #endif
 {
+  ISR_TRACE_ENTER();
   i2cdrvDmaIsrHandler(&deckBus);
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) I2C3_ER_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   i2cdrvErrorIsrHandler(&sensorsBus);
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) I2C3_EV_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   i2cdrvEventIsrHandler(&sensorsBus);
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) DMA1_Stream2_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   i2cdrvDmaIsrHandler(&sensorsBus);
+  ISR_TRACE_EXIT();
 }
+
+static float i2cdrvUtilizationLog(uint32_t timestamp, void* data)
+{
+  I2cBusStats* stats = (I2cBusStats*)data;
+
+  const uint32_t intervalMs = timestamp - stats->latestTimestamp;
+  if (intervalMs >= I2C_UTILIZATION_INTERVAL_MS)
+  {
+    const uint32_t busyUs = stats->busyUs;
+    // us per ms to percent
+    stats->latestUtilization = (busyUs - stats->latestBusyUs) / (intervalMs * 10.0f);
+    stats->latestBusyUs = busyUs;
+    stats->latestTimestamp = timestamp;
+  }
+
+  return stats->latestUtilization;
+}
+
+static logByFunction_t deckBusUtilization = {.aquireFloat = i2cdrvUtilizationLog, .data = &deckBus.stats};
+static logByFunction_t sensorsBusUtilization = {.aquireFloat = i2cdrvUtilizationLog, .data = &sensorsBus.stats};
+
+/**
+ * Statistics of the i2c busses, deck is the expansion port bus (I2C1) and sens the
+ * on board sensors bus (I2C3).
+ */
+LOG_GROUP_START(i2c)
+/**
+ * @brief Share of the time the deck bus has a transaction in progress [%]
+ */
+LOG_ADD_BY_FUNCTION(LOG_FLOAT, deckUtil, &deckBusUtilization)
+/**
+ * @brief Number of finished transactions on the deck bus
+ */
+LOG_ADD(LOG_UINT32, deckTrans, &deckBus.stats.transactionCount)
+/**
+ * @brief Number of failed transactions on the deck bus
+ */
+LOG_ADD(LOG_UINT32, deckNack, &deckBus.stats.nackCount)
+/**
+ * @brief Number of blocking transfers that timed out on the deck bus
+ */
+LOG_ADD(LOG_UINT32, deckTo, &deckBus.stats.timeoutCount)
+/**
+ * @brief Max number of pending transactions on the deck bus
+ */
+LOG_ADD(LOG_UINT8, deckQMax, &deckBus.stats.pendingMax)
+/**
+ * @brief Number of register reads saved by shadow registers on the deck bus
+ */
+LOG_ADD(LOG_UINT32, deckShadow, &deckBus.stats.shadowHitCount)
+/**
+ * @brief Share of the time the sensors bus has a transaction in progress [%]
+ */
+LOG_ADD_BY_FUNCTION(LOG_FLOAT, sensUtil, &sensorsBusUtilization)
+/**
+ * @brief Number of finished transactions on the sensors bus
+ */
+LOG_ADD(LOG_UINT32, sensTrans, &sensorsBus.stats.transactionCount)
+/**
+ * @brief Number of failed transactions on the sensors bus
+ */
+LOG_ADD(LOG_UINT32, sensNack, &sensorsBus.stats.nackCount)
+/**
+ * @brief Number of blocking transfers that timed out on the sensors bus
+ */
+LOG_ADD(LOG_UINT32, sensTo, &sensorsBus.stats.timeoutCount)
+/**
+ * @brief Max number of pending transactions on the sensors bus
+ */
+LOG_ADD(LOG_UINT8, sensQMax, &sensorsBus.stats.pendingMax)
+/**
+ * @brief Number of register reads saved by shadow registers on the sensors bus
+ */
+LOG_ADD(LOG_UINT32, sensShadow, &sensorsBus.stats.shadowHitCount)
+LOG_GROUP_STOP(i2c)
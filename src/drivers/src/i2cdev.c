@@ -39,6 +39,52 @@
 #include "nvicconf.h"
 #include "debug.h"
 
+#define I2CDEV_SHADOW_MAX_REGS 24
+
+/* Shadow copy of a register whose value only changes when written by us. Used
+ * by the read-modify-write helpers to skip the read transaction. */
+struct shadowReg
+{
+  I2C_Dev *dev;
+  uint8_t devAddress;
+  uint8_t memAddress;
+  uint8_t value;
+  bool isValid;
+};
+
+static struct shadowReg shadowRegs[I2CDEV_SHADOW_MAX_REGS];
+static int shadowRegCount;
+
+static struct shadowReg* shadowFind(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress)
+{
+  for (int i = 0; i < shadowRegCount; i++)
+  {
+    struct shadowReg *reg = &shadowRegs[i];
+    if (reg->memAddress == memAddress && reg->devAddress == devAddress && reg->dev == dev)
+    {
+      return reg;
+    }
+  }
+
+  return 0;
+}
+
+static void shadowUpdate(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
+                         uint16_t len, const uint8_t *data, bool isWritten)
+{
+  for (int i = 0; i < shadowRegCount; i++)
+  {
+    struct shadowReg *reg = &shadowRegs[i];
+    if (reg->dev == dev && reg->devAddress == devAddress &&
+        reg->memAddress >= memAddress && reg->memAddress - memAddress < len)
+    {
+      // A failed write leaves the register in an unknown state
+      reg->value = data[reg->memAddress - memAddress];
+      reg->isValid = isWritten;
+    }
+  }
+}
+
 int i2cdevInit(I2C_Dev *dev)
 {
   i2cdrvInit(dev);
@@ -120,29 +166,73 @@ bool i2cdevWriteByte(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
 bool i2cdevWriteBit(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
                     uint8_t bitNum, uint8_t data)
 {
-    uint8_t byte;
-    i2cdevReadByte(dev, devAddress, memAddress, &byte);
-    byte = (data != 0) ? (byte | (1 << bitNum)) : (byte & ~(1 << bitNum));
-    return i2cdevWriteByte(dev, devAddress, memAddress, byte);
+  return i2cdevWriteMasked(dev, devAddress, memAddress, 1 << bitNum, (data != 0) ? 0xFF : 0x00);
 }
 
 bool i2cdevWriteBits(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
                      uint8_t bitStart, uint8_t length, uint8_t data)
 {
-  bool status;
+  uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
+  data <<= (bitStart - length + 1); // shift data into correct position
+
+  return i2cdevWriteMasked(dev, devAddress, memAddress, mask, data);
+}
+
+bool i2cdevWriteMasked(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
+                       uint8_t mask, uint8_t data)
+{
   uint8_t byte;
 
-  if ((status = i2cdevReadByte(dev, devAddress, memAddress, &byte)) == true)
+  struct shadowReg *reg = shadowFind(dev, devAddress, memAddress);
+  if (reg && reg->isValid)
   {
-      uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
-      data <<= (bitStart - length + 1); // shift data into correct position
-      data &= mask; // zero all non-important bits in data
-      byte &= ~(mask); // zero all important bits in existing byte
-      byte |= data; // combine data with existing byte
-      status = i2cdevWriteByte(dev, devAddress, memAddress, byte);
+    byte = reg->value;
+    dev->stats.shadowHitCount++;
+  }
+  else if (i2cdevReadByte(dev, devAddress, memAddress, &byte) == false)
+  {
+    return false;
   }
 
-  return status;
+  byte &= ~mask; // zero all important bits in existing byte
+  byte |= data & mask; // combine data with existing byte
+
+  return i2cdevWriteByte(dev, devAddress, memAddress, byte);
+}
+
+bool i2cdevShadowEnable(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress)
+{
+  if (shadowFind(dev, devAddress, memAddress))
+  {
+    return true;
+  }
+
+  if (shadowRegCount >= I2CDEV_SHADOW_MAX_REGS)
+  {
+    DEBUG_PRINT("No room for shadow register 0x%02X:0x%02X\n", devAddress, memAddress);
+    return false;
+  }
+
+  // The value is unknown until the register is read or written
+  struct shadowReg *reg = &shadowRegs[shadowRegCount];
+  reg->dev = dev;
+  reg->devAddress = devAddress;
+  reg->memAddress = memAddress;
+  reg->isValid = false;
+  shadowRegCount++;
+
+  return true;
+}
+
+void i2cdevShadowInvalidate(I2C_Dev *dev, uint8_t devAddress)
+{
+  for (int i = 0; i < shadowRegCount; i++)
+  {
+    if (shadowRegs[i].dev == dev && shadowRegs[i].devAddress == devAddress)
+    {
+      shadowRegs[i].isValid = false;
+    }
+  }
 }
 
 bool i2cdevWrite(I2C_Dev *dev, uint8_t devAddress, uint16_t len, const uint8_t *data)
@@ -162,7 +252,13 @@ bool i2cdevWriteReg8(I2C_Dev *dev, uint8_t devAddress, uint8_t memAddress,
   i2cdrvCreateMessageIntAddr(&message, devAddress, false, memAddress,
                              i2cWrite, len, data);
 
-  return i2cdrvMessageTransfer(dev, &message);
+  bool status = i2cdrvMessageTransfer(dev, &message);
+  if (memAddress != I2CDEV_NO_MEM_ADDR)
+  {
+    shadowUpdate(dev, devAddress, memAddress, len, data, status);
+  }
+
+  return status;
 }
 
 bool i2cdevWriteReg16(I2C_Dev *dev, uint8_t devAddress, uint16_t memAddress,
@@ -36,7 +36,6 @@
 
 #define LH_I2C_ADDR         0x2F
 #define LH_FW_SIZE          0x020000
-#define LH_FLASH_PAGE_SIZE  256
 #define LH_WRITE_BUF_SIZE   (5 + 4 + LH_FLASH_PAGE_SIZE)
 
 /* Commands */
@@ -135,7 +134,7 @@ static bool lhblFlashEraseBlock64k(uint32_t address)
   return lhExchange(5 + 4, flashWriteBuf, 0, 0);
 }
 
-static bool lhblFlashWaitComplete(void)
+bool lhblFlashWaitComplete(void)
 {
   bool status;
   uint8_t flashStatus;
@@ -59,6 +59,48 @@ static void motorsDshotDMASetup();
 static volatile uint32_t dmaWait;
 #endif
 
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+#include "dshotTelemetry.h"
+
+// The reply from the ESCs is captured by sampling the GPIO input data registers with DMA, triggered by TIM8 at three
+// times the telemetry bit rate. TIM8 is clocked from APB2.
+#define DSHOT_SAMPLE_TIM_CLOCK_HZ       168000000
+#define DSHOT_SAMPLE_RATE_HZ            (3 * DSHOT_TELEMETRY_BIT_RATE(TIM_CLOCK_HZ / MOTORS_BL_PWM_PERIOD))
+#define DSHOT_SAMPLE_PERIOD             (DSHOT_SAMPLE_TIM_CLOCK_HZ / DSHOT_SAMPLE_RATE_HZ)
+#define DSHOT_SAMPLES_PER_BIT           ((float)DSHOT_SAMPLE_TIM_CLOCK_HZ * MOTORS_BL_PWM_PERIOD / \
+                                        ((float)DSHOT_SAMPLE_PERIOD * DSHOT_TELEMETRY_BIT_RATE(TIM_CLOCK_HZ)))
+// Samples in the time of n DSHOT bits
+#define DSHOT_SAMPLES_FOR_BITS(n)       ((n) * 15 / 4)
+// The ESC replies 30 us after the end of the frame
+#define DSHOT_TELEMETRY_MAX_DELAY_US    50
+// M2 is sent after M1, the sampling window covers both frames, the reply delay and the reply
+#define DSHOT_SAMPLE_COUNT              (DSHOT_SAMPLES_FOR_BITS(2 * DSHOT_DMA_BUFFER_SIZE + 4) + \
+                                        DSHOT_TELEMETRY_MAX_DELAY_US * (DSHOT_SAMPLE_RATE_HZ / 1000) / 1000 + \
+                                        3 * (DSHOT_TELEMETRY_FRAME_BITS + 2))
+// Where to start to search for the reply. The output of M2 is started from the DMA interrupt of M1.
+#define DSHOT_SEARCH_START              DSHOT_SAMPLES_FOR_BITS(DSHOT_FRAME_SIZE + 1)
+#define DSHOT_SEARCH_START_M2           DSHOT_SAMPLES_FOR_BITS(DSHOT_DMA_BUFFER_SIZE + DSHOT_FRAME_SIZE + 3)
+// The speed is set to 0 if there is no valid telemetry for this many frames
+#define DSHOT_TELEMETRY_TIMEOUT_FRAMES  50
+// Number of frames the error rate is calculated over
+#define DSHOT_TELEMETRY_STATS_FRAMES    500
+
+static uint16_t dshotSamplesGpioA[DSHOT_SAMPLE_COUNT];
+static uint16_t dshotSamplesGpioB[DSHOT_SAMPLE_COUNT];
+static bool isDshotSampling = false;
+
+static float motorRpm[NBR_OF_MOTORS];
+static uint16_t telemetryMissed[NBR_OF_MOTORS];
+static uint16_t telemetryFrames[NBR_OF_MOTORS];
+static uint16_t telemetryErrors[NBR_OF_MOTORS];
+static float telemetryErrorRate[NBR_OF_MOTORS];
+
+static void motorsDshotTelemetrySetup();
+static void motorsDshotTelemetryCollect();
+static void motorsDshotTelemetryStart();
+static void motorsDshotSetPinMode(const MotorPerifDef* motor, const GPIOMode_TypeDef mode);
+#endif
+
 void motorsPlayTone(uint16_t frequency, uint16_t duration_msec);
 void motorsPlayMelody(uint16_t *notes);
 void motorsBeep(int id, bool enable, uint16_t frequency, uint16_t ratio);
@@ -173,6 +215,57 @@ GPIO_InitTypeDef GPIO_PassthroughOutput =
 //
 // And to get the PWM as a percentage we would need to divide the
 // Voltage needed with the Supply voltage.
+//
+// The polynomial is evaluated into a lookup table over the thrust range for
+// the current supply voltage, in steps of MOTORS_BAT_COMP_VOLTAGE_BUCKET. The
+// table is regenerated when the voltage moves to another step, which happens
+// rarely, and the compensation itself is an interpolated lookup.
+#define MOTORS_BAT_COMP_LUT_BITS 6
+#define MOTORS_BAT_COMP_LUT_SIZE (1 << MOTORS_BAT_COMP_LUT_BITS)
+#define MOTORS_BAT_COMP_LUT_SHIFT (16 - MOTORS_BAT_COMP_LUT_BITS)
+#define MOTORS_BAT_COMP_VOLTAGE_BUCKET 0.01f
+
+#ifdef CONFIG_ENABLE_THRUST_BAT_COMPENSATED
+static float batCompLut[MOTORS_BAT_COMP_LUT_SIZE + 1];
+static int32_t batCompLutBucket = -1;
+
+static float batCompVoltsNeeded(float iThrust)
+{
+  float thrust = (iThrust / 65536.0f) * 60;
+  return -0.0006239f * thrust * thrust + 0.088f * thrust;
+}
+
+static void batCompLutUpdate(float supplyVoltage)
+{
+  const int32_t bucket = (int32_t)(supplyVoltage / MOTORS_BAT_COMP_VOLTAGE_BUCKET + 0.5f);
+  if (bucket == batCompLutBucket)
+  {
+    return;
+  }
+
+  const float scale = UINT16_MAX / (bucket * MOTORS_BAT_COMP_VOLTAGE_BUCKET);
+  for (int i = 0; i <= MOTORS_BAT_COMP_LUT_SIZE; i++)
+  {
+    batCompLut[i] = batCompVoltsNeeded(i << MOTORS_BAT_COMP_LUT_SHIFT) * scale;
+  }
+  batCompLutBucket = bucket;
+}
+
+static float batCompLookup(float iThrust, float supplyVoltage)
+{
+  if (iThrust < 0.0f || iThrust >= 65536.0f)
+  {
+    // Outside of the table, use the polynomial
+    return UINT16_MAX * batCompVoltsNeeded(iThrust) / supplyVoltage;
+  }
+
+  const uint32_t thrust = (uint32_t)iThrust;
+  const uint32_t index = thrust >> MOTORS_BAT_COMP_LUT_SHIFT;
+  const float fraction = (iThrust - (float)(index << MOTORS_BAT_COMP_LUT_SHIFT)) * (1.0f / (1 << MOTORS_BAT_COMP_LUT_SHIFT));
+  return batCompLut[index] + fraction * (batCompLut[index + 1] - batCompLut[index]);
+}
+#endif
+
 float motorsCompensateBatteryVoltage(uint32_t id, float iThrust, float supplyVoltage)
 {
   #ifdef CONFIG_ENABLE_THRUST_BAT_COMPENSATED
@@ -193,16 +286,42 @@ float motorsCompensateBatteryVoltage(uint32_t id, float iThrust, float supplyVol
       return iThrust;
     }
 
-    float thrust = (iThrust / 65536.0f) * 60;
-    float volts = -0.0006239f * thrust * thrust + 0.088f * thrust;
-    float ratio = volts / supplyVoltage;
-    return UINT16_MAX * ratio;
+    batCompLutUpdate(supplyVoltage);
+    return batCompLookup(iThrust, supplyVoltage);
   }
   #endif
 
   return iThrust;
 }
 
+void motorsCompensateBatteryVoltageAll(const int32_t* thrust, int32_t* compensated, float supplyVoltage)
+{
+  #ifdef CONFIG_ENABLE_THRUST_BAT_COMPENSATED
+  // Same sanity check as in motorsCompensateBatteryVoltage()
+  if (supplyVoltage >= 2.0f)
+  {
+    batCompLutUpdate(supplyVoltage);
+    for (int id = 0; id < NBR_OF_MOTORS; id++)
+    {
+      if (motorMap[id]->drvType == BRUSHED)
+      {
+        compensated[id] = batCompLookup(thrust[id], supplyVoltage);
+      }
+      else
+      {
+        compensated[id] = thrust[id];
+      }
+    }
+    return;
+  }
+  #endif
+
+  for (int id = 0; id < NBR_OF_MOTORS; id++)
+  {
+    compensated[id] = thrust[id];
+  }
+}
+
 /* Public functions */
 
 //Initialization. Will set all motors ratio to 0%
@@ -263,6 +382,10 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_100MHz;
     GPIO_InitStructure.GPIO_OType = motorMap[i]->gpioOType;
     GPIO_InitStructure.GPIO_Pin = motorMap[i]->gpioPin;
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+    // Keeps the line idle high while the pin is an input, waiting for the reply from the ESC
+    GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+#endif
     GPIO_Init(motorMap[i]->gpioPort, &GPIO_InitStructure);
 
     //Map timers to alternate functions
@@ -281,6 +404,13 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
     TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
     TIM_OCInitStructure.TIM_Pulse = 0;
     TIM_OCInitStructure.TIM_OCPolarity = motorMap[i]->timPolarity;
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+    // The signal is inverted (idle high) for bidirectional DSHOT
+    if (motorMap[i]->drvType == BRUSHLESS)
+    {
+      TIM_OCInitStructure.TIM_OCPolarity = (motorMap[i]->timPolarity == TIM_OCPolarity_High) ? TIM_OCPolarity_Low : TIM_OCPolarity_High;
+    }
+#endif
     TIM_OCInitStructure.TIM_OCIdleState = TIM_OCIdleState_Set;
 
     // Configure Output Compare for PWM
@@ -291,6 +421,9 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
 #ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
   motorsDshotDMASetup();
 #endif
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  motorsDshotTelemetrySetup();
+#endif
 
   // Start the timers
   for (i = 0; i < NBR_OF_MOTORS; i++)
@@ -357,10 +490,12 @@ bool motorsTest(void)
 
 void motorsStop()
 {
+  uint16_t ratios[NBR_OF_MOTORS];
   for (int i = 0; i < NBR_OF_MOTORS; i++)
   {
-    motorsSetRatio(MOTORS[i], powerDistributionStopRatio(i));
+    ratios[i] = powerDistributionStopRatio(i);
   }
+  motorsSetRatios(ratios);
 
 #ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
   if (motorMap[0]->drvType == BRUSHLESS)
@@ -434,6 +569,10 @@ static void motorsPrepareDshot(uint32_t id, uint16_t ratio)
         csData >>= 4;
   }
 
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  // An inverted checksum tells the ESC to reply with telemetry
+  cs = ~cs;
+#endif
   cs &= 0xf;
   dshotBits = (dshotBits << 4) | cs;
 
@@ -455,9 +594,20 @@ static void motorsPrepareDshot(uint32_t id, uint16_t ratio)
  * Unfortunately the TIM2_CH2 (M1) and TIM2_CH4 (M2) share DMA channel 3 request and can't
  * be used at the same time. Solved by running after each other and TIM2_CH2
  * will be started in DMA1_Stream6_IRQHandler. Thus M2 will have a bit of latency.
+ *
+ * With bidirectional DSHOT the replies to the previous burst are decoded first, the pins are switched back to
+ * the timer and the sampling of the replies to this burst is started.
  */
 void motorsBurstDshot()
 {
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+    motorsDshotTelemetryCollect();
+    for (int i = 0; i < NBR_OF_MOTORS; i++)
+    {
+      motorsDshotSetPinMode(motorMap[i], GPIO_Mode_AF);
+    }
+    motorsDshotTelemetryStart();
+#endif
 
     motorMap[0]->DMA_stream->NDTR = DSHOT_DMA_BUFFER_SIZE;
     motorMap[1]->DMA_stream->NDTR = DSHOT_DMA_BUFFER_SIZE;
@@ -484,50 +634,248 @@ void motorsBurstDshot()
 }
 #endif
 
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+static void motorsDshotTelemetrySetup()
+{
+  TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+  TIM_OCInitTypeDef TIM_OCInitStructure;
+  DMA_InitTypeDef DMA_InitStructure;
+
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM8, ENABLE);
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+
+  TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+  TIM_TimeBaseStructure.TIM_Period = DSHOT_SAMPLE_PERIOD - 1;
+  TIM_TimeBaseStructure.TIM_Prescaler = 0;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseInit(TIM8, &TIM_TimeBaseStructure);
+
+  // CC1 triggers the sampling of GPIOA (DMA2 stream 2) and CC2 of GPIOB (DMA2 stream 3)
+  TIM_OCStructInit(&TIM_OCInitStructure);
+  TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_Timing;
+  TIM_OCInitStructure.TIM_Pulse = 0;
+  TIM_OC1Init(TIM8, &TIM_OCInitStructure);
+  TIM_OCInitStructure.TIM_Pulse = DSHOT_SAMPLE_PERIOD / 2;
+  TIM_OC2Init(TIM8, &TIM_OCInitStructure);
+  TIM_DMACmd(TIM8, TIM_DMA_CC1 | TIM_DMA_CC2, ENABLE);
+
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel = DMA_Channel_7;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize = DSHOT_SAMPLE_COUNT;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&GPIOA->IDR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)dshotSamplesGpioA;
+  DMA_Init(DMA2_Stream2, &DMA_InitStructure);
+
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&GPIOB->IDR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)dshotSamplesGpioB;
+  DMA_Init(DMA2_Stream3, &DMA_InitStructure);
+}
 
-// Ithrust is thrust mapped for 65536 <==> 60 grams
-void motorsSetRatio(uint32_t id, uint16_t ithrust)
+static void motorsDshotTelemetryStart()
 {
-  if (isInit) {
-    ASSERT(id < NBR_OF_MOTORS);
+  DMA_ClearFlag(DMA2_Stream2, DMA_FLAG_TCIF2 | DMA_FLAG_HTIF2 | DMA_FLAG_TEIF2 | DMA_FLAG_DMEIF2 | DMA_FLAG_FEIF2);
+  DMA_ClearFlag(DMA2_Stream3, DMA_FLAG_TCIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3);
+  DMA_SetCurrDataCounter(DMA2_Stream2, DSHOT_SAMPLE_COUNT);
+  DMA_SetCurrDataCounter(DMA2_Stream3, DSHOT_SAMPLE_COUNT);
+  DMA_Cmd(DMA2_Stream2, ENABLE);
+  DMA_Cmd(DMA2_Stream3, ENABLE);
+
+  TIM_SetCounter(TIM8, 0);
+  TIM_Cmd(TIM8, ENABLE);
+  isDshotSampling = true;
+}
 
-    uint16_t ratio = ithrust;
+static void motorsDshotTelemetryCollect()
+{
+  if (!isDshotSampling)
+  {
+    return;
+  }
+  isDshotSampling = false;
 
-    // Override ratio in case of motorSetEnable
-    if (motorSetEnable == 2)
+  TIM_Cmd(TIM8, DISABLE);
+  DMA_Cmd(DMA2_Stream2, DISABLE);
+  DMA_Cmd(DMA2_Stream3, DISABLE);
+  const int countGpioA = DSHOT_SAMPLE_COUNT - DMA_GetCurrDataCounter(DMA2_Stream2);
+  const int countGpioB = DSHOT_SAMPLE_COUNT - DMA_GetCurrDataCounter(DMA2_Stream3);
+
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    const uint16_t* samples;
+    int count;
+    if (motorMap[i]->gpioPort == GPIOA)
     {
-      ratio = motorPowerSet[MOTOR_M1];
+      samples = dshotSamplesGpioA;
+      count = countGpioA;
     }
-    else if (motorSetEnable == 1)
+    else if (motorMap[i]->gpioPort == GPIOB)
     {
-      ratio = motorPowerSet[id];
+      samples = dshotSamplesGpioB;
+      count = countGpioB;
+    }
+    else
+    {
+      continue;
     }
 
-    motor_ratios[id] = ratio;
+    const int start = (i == MOTOR_M2) ? DSHOT_SEARCH_START_M2 : DSHOT_SEARCH_START;
+    uint16_t value;
+    if (dshotTelemetryDecodeSamples(samples, count, start, motorMap[i]->gpioPin, DSHOT_SAMPLES_PER_BIT, &value))
+    {
+      motorRpm[i] = dshotTelemetryToErpm(value) * 2.0f / CONFIG_MOTORS_DSHOT_MOTOR_POLES;
+      telemetryMissed[i] = 0;
+    }
+    else
+    {
+      telemetryErrors[i]++;
+      if (telemetryMissed[i] < DSHOT_TELEMETRY_TIMEOUT_FRAMES)
+      {
+        telemetryMissed[i]++;
+      }
+      else
+      {
+        motorRpm[i] = 0.0f;
+      }
+    }
 
-    if (motorMap[id]->drvType == BRUSHLESS)
+    telemetryFrames[i]++;
+    if (telemetryFrames[i] >= DSHOT_TELEMETRY_STATS_FRAMES)
     {
+      telemetryErrorRate[i] = 100.0f * telemetryErrors[i] / telemetryFrames[i];
+      telemetryFrames[i] = 0;
+      telemetryErrors[i] = 0;
+    }
+  }
+}
+
+static void motorsDshotSetPinMode(const MotorPerifDef* motor, const GPIOMode_TypeDef mode)
+{
+  const uint32_t shift = motor->gpioPinSource * 2;
+  motor->gpioPort->MODER = (motor->gpioPort->MODER & ~(GPIO_MODER_MODER0 << shift)) | ((uint32_t)mode << shift);
+}
+#endif
+
+void motorsGetRpm(float* rpm)
+{
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+    rpm[i] = motorRpm[i];
+#else
+    rpm[i] = 0.0f;
+#endif
+  }
+}
+
+
+// True if the motor output is driven by the compare register of its timer,
+// false for DSHOT where the compare values are fed by DMA at the burst
+static bool motorsUsesCompare(uint32_t id)
+{
 #ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
-      // Prepare DSHOT, firing it will be done synchronously with motorsBurstDshot.
-      motorsPrepareDshot(id, ratio);
+  return motorMap[id]->drvType != BRUSHLESS;
 #else
-      motorMap[id]->setCompare(motorMap[id]->tim, motorsBLConv16ToBits(ratio));
+  return true;
 #endif
+}
+
+/* Holds back, or releases, the update events of the timers of the PWM motors.
+ * The compare registers are preloaded, values written while the update events
+ * are held back are all applied at the same update event. */
+static void motorsHoldUpdates(bool hold)
+{
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    if (!motorsUsesCompare(i))
+    {
+      continue;
     }
-    else
+
+    bool isFirstOfTimer = true;
+    for (int j = 0; j < i; j++)
     {
-      motorMap[id]->setCompare(motorMap[id]->tim, motorsConv16ToBits(ratio));
+      if (motorMap[j]->tim == motorMap[i]->tim && motorsUsesCompare(j))
+      {
+        isFirstOfTimer = false;
+      }
     }
 
-    if (id == MOTOR_M1)
+    if (isFirstOfTimer)
     {
-      uint64_t currTime = usecTimestamp();
-      cycleTime = currTime - lastCycleTime;
-      lastCycleTime = currTime;
+      TIM_UpdateDisableConfig(motorMap[i]->tim, hold ? ENABLE : DISABLE);
     }
   }
 }
 
+// Ithrust is thrust mapped for 65536 <==> 60 grams
+static void motorsWriteRatio(uint32_t id, uint16_t ithrust)
+{
+  uint16_t ratio = ithrust;
+
+  // Override ratio in case of motorSetEnable
+  if (motorSetEnable == 2)
+  {
+    ratio = motorPowerSet[MOTOR_M1];
+  }
+  else if (motorSetEnable == 1)
+  {
+    ratio = motorPowerSet[id];
+  }
+
+  motor_ratios[id] = ratio;
+
+  if (motorMap[id]->drvType == BRUSHLESS)
+  {
+#ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+    // Prepare DSHOT, firing it will be done synchronously with motorsBurstDshot.
+    motorsPrepareDshot(id, ratio);
+#else
+    motorMap[id]->setCompare(motorMap[id]->tim, motorsBLConv16ToBits(ratio));
+#endif
+  }
+  else
+  {
+    motorMap[id]->setCompare(motorMap[id]->tim, motorsConv16ToBits(ratio));
+  }
+
+  if (id == MOTOR_M1)
+  {
+    uint64_t currTime = usecTimestamp();
+    cycleTime = currTime - lastCycleTime;
+    lastCycleTime = currTime;
+  }
+}
+
+void motorsSetRatio(uint32_t id, uint16_t ithrust)
+{
+  if (isInit) {
+    ASSERT(id < NBR_OF_MOTORS);
+
+    motorsWriteRatio(id, ithrust);
+  }
+}
+
+void motorsSetRatios(const uint16_t* ithrust)
+{
+  if (isInit) {
+    motorsHoldUpdates(true);
+    for (int i = 0; i < NBR_OF_MOTORS; i++)
+    {
+      motorsWriteRatio(i, ithrust[i]);
+    }
+    motorsHoldUpdates(false);
+  }
+}
+
 void motorsEnablePWM(void)
 {
   for (int i = 0; i < NBR_OF_MOTORS; i++)
@@ -683,18 +1031,27 @@ void __attribute__((used)) DMA1_Stream1_IRQHandler(void)  // M4
   TIM_DMACmd(TIM2, TIM_DMA_CC3, DISABLE);
   DMA_ClearITPendingBit(DMA1_Stream1, DMA_IT_TCIF1);
   DMA_ITConfig(DMA1_Stream1, DMA_IT_TC, DISABLE);
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  motorsDshotSetPinMode(motorMap[3], GPIO_Mode_IN);
+#endif
 }
 void __attribute__((used)) DMA1_Stream5_IRQHandler(void)  // M3
 {
   TIM_DMACmd(TIM2, TIM_DMA_CC1, DISABLE);
   DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TCIF5);
   DMA_ITConfig(DMA1_Stream5, DMA_IT_TC, DISABLE);
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  motorsDshotSetPinMode(motorMap[2], GPIO_Mode_IN);
+#endif
 }
 void __attribute__((used)) DMA1_Stream6_IRQHandler(void) // M1
 {
   TIM_DMACmd(TIM2, TIM_DMA_CC2, DISABLE);
   DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TCIF6);
   DMA_ITConfig(DMA1_Stream6, DMA_IT_TC, DISABLE);
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  motorsDshotSetPinMode(motorMap[0], GPIO_Mode_IN);
+#endif
   /* Enable TIM DMA Requests M2*/
   TIM_DMACmd(motorMap[1]->tim, motorMap[1]->TIM_DMASource, ENABLE);
   /* Enable DMA TIM Stream */
@@ -705,6 +1062,9 @@ void __attribute__((used)) DMA1_Stream7_IRQHandler(void)  // M2
   TIM_DMACmd(TIM2, TIM_DMA_CC4, DISABLE);
   DMA_ClearITPendingBit(DMA1_Stream7, DMA_IT_TCIF7);
   DMA_ITConfig(DMA1_Stream7, DMA_IT_TC, DISABLE);
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+  motorsDshotSetPinMode(motorMap[1], GPIO_Mode_IN);
+#endif
 }
 #endif
 
@@ -763,3 +1123,43 @@ LOG_ADD_CORE(LOG_UINT32, m3, &motor_ratios[MOTOR_M3])
  */
 LOG_ADD_CORE(LOG_UINT32, m4, &motor_ratios[MOTOR_M4])
 LOG_GROUP_STOP(motor)
+
+#ifdef CONFIG_MOTORS_DSHOT_BIDIRECTIONAL
+/**
+ * Motor speeds from bidirectional DSHOT telemetry
+ */
+LOG_GROUP_START(dshot)
+/**
+ * @brief Speed of M1 [RPM]
+ */
+LOG_ADD(LOG_FLOAT, m1Rpm, &motorRpm[MOTOR_M1])
+/**
+ * @brief Speed of M2 [RPM]
+ */
+LOG_ADD(LOG_FLOAT, m2Rpm, &motorRpm[MOTOR_M2])
+/**
+ * @brief Speed of M3 [RPM]
+ */
+LOG_ADD(LOG_FLOAT, m3Rpm, &motorRpm[MOTOR_M3])
+/**
+ * @brief Speed of M4 [RPM]
+ */
+LOG_ADD(LOG_FLOAT, m4Rpm, &motorRpm[MOTOR_M4])
+/**
+ * @brief Share of missing or invalid telemetry frames from M1 [%]
+ */
+LOG_ADD(LOG_FLOAT, m1Err, &telemetryErrorRate[MOTOR_M1])
+/**
+ * @brief Share of missing or invalid telemetry frames from M2 [%]
+ */
+LOG_ADD(LOG_FLOAT, m2Err, &telemetryErrorRate[MOTOR_M2])
+/**
+ * @brief Share of missing or invalid telemetry frames from M3 [%]
+ */
+LOG_ADD(LOG_FLOAT, m3Err, &telemetryErrorRate[MOTOR_M3])
+/**
+ * @brief Share of missing or invalid telemetry frames from M4 [%]
+ */
+LOG_ADD(LOG_FLOAT, m4Err, &telemetryErrorRate[MOTOR_M4])
+LOG_GROUP_STOP(dshot)
+#endif
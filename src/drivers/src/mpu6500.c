@@ -92,6 +92,20 @@ void mpu6500Init(I2C_Dev *i2cPort)
   I2Cx = i2cPort;
   devAddr = MPU6500_ADDRESS_AD0_HIGH;
 
+  // Configuration registers that are only changed by us. USER_CTRL, PWR_MGMT_1
+  // and SIGNAL_PATH_RESET have self clearing reset bits and are left out.
+  static const uint8_t shadowRegs[] = {
+    MPU6500_RA_CONFIG, MPU6500_RA_GYRO_CONFIG, MPU6500_RA_ACCEL_CONFIG,
+    MPU6500_RA_ACCEL_CONFIG_2, MPU6500_RA_FIFO_EN, MPU6500_RA_I2C_MST_CTRL,
+    MPU6500_RA_I2C_SLV0_CTRL, MPU6500_RA_I2C_SLV1_CTRL, MPU6500_RA_I2C_SLV2_CTRL,
+    MPU6500_RA_I2C_SLV3_CTRL, MPU6500_RA_I2C_SLV4_CTRL, MPU6500_RA_INT_PIN_CFG,
+    MPU6500_RA_INT_ENABLE, MPU6500_RA_I2C_MST_DELAY_CTRL, MPU6500_RA_PWR_MGMT_2,
+  };
+  for (int i = 0; i < sizeof(shadowRegs); i++)
+  {
+    i2cdevShadowEnable(I2Cx, devAddr, shadowRegs[i]);
+  }
+
   isInit = true;
 }
 
@@ -2643,6 +2657,8 @@ void mpu6500ResetSensors()
 void mpu6500Reset()
 {
   i2cdevWriteBit(I2Cx, devAddr, MPU6500_RA_PWR_MGMT_1, MPU6500_PWR1_DEVICE_RESET_BIT, 1);
+  // All registers are back to their default values
+  i2cdevShadowInvalidate(I2Cx, devAddr);
 }
 /** Get sleep mode status.
  * Setting the SLEEP bit in the register puts the device into very low power
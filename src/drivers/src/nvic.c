@@ -31,6 +31,7 @@
 #include "usb_core.h"
 
 #include "uart1.h"
+#include "isr_trace.h"
 #define UART_PRINT    uart1Printf
 
 #define DONT_DISCARD __attribute__((used))
@@ -47,7 +48,9 @@ extern void tickFreeRTOS(void);
 
 void DONT_DISCARD SysTick_Handler(void)
 {
+  ISR_TRACE_ENTER();
     tickFreeRTOS();
+  ISR_TRACE_EXIT();
 }
 
 #ifdef NVIC_NOT_USED_BY_FREERTOS
@@ -76,9 +79,11 @@ void DONT_DISCARD PendSV_Handler(void)
 
 void  __attribute__((used)) OTG_FS_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   extern USB_OTG_CORE_HANDLE USB_OTG_dev;
 
   USBD_OTG_ISR_Handler(&USB_OTG_dev);
+  ISR_TRACE_EXIT();
 }
 
 /**
@@ -42,12 +42,19 @@
 #include "config.h"
 #include "nvicconf.h"
 #include "static_mem.h"
+#include "autoconf.h"
 
 /** This uart is conflicting with SPI2 DMA used in sensors_bmi088_spi_bmp3xx.c
  *  which is used in CF-Bolt. So for other products this can be enabled.
  */
 //#define ENABLE_UART1_DMA
 
+/** RX DMA uses DMA1 stream 1, which is also used by the DShot motor driver
+ */
+#ifndef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+#define ENABLE_UART1_RX_DMA
+#endif
+
 #define QUEUE_LENGTH 64
 static xQueueHandle uart1queue;
 STATIC_MEM_QUEUE_ALLOC(uart1queue, QUEUE_LENGTH, sizeof(uint8_t));
@@ -55,6 +62,15 @@ STATIC_MEM_QUEUE_ALLOC(uart1queue, QUEUE_LENGTH, sizeof(uint8_t));
 static bool isInit = false;
 static bool hasOverrun = false;
 
+#ifdef ENABLE_UART1_RX_DMA
+static uint8_t rxDmaBuffer[UART1_RX_DMA_BUFFER_SIZE];
+static uint8_t rxDmaPeekBuffer[UART1_RX_DMA_MAX_PEEK];
+static volatile uint32_t rxDmaLaps;
+static uint32_t rxDmaWriteCount;
+static uint32_t rxDmaReadCount;
+static bool isRxDmaEnabled = false;
+#endif
+
 #ifdef ENABLE_UART1_DMA
 static xSemaphoreHandle uartBusy;
 static StaticSemaphore_t uartBusyBuffer;
@@ -252,6 +268,139 @@ void uart1SendDataDmaBlocking(uint32_t size, uint8_t* data)
 }
 #endif
 
+bool uart1EnableRxDma(void)
+{
+#ifdef ENABLE_UART1_RX_DMA
+  if (!isInit) {
+    return false;
+  }
+
+  if (isRxDmaEnabled) {
+    return true;
+  }
+
+  DMA_InitTypeDef DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  USART_ITConfig(UART1_TYPE, USART_IT_RXNE, DISABLE);
+
+  DMA_DeInit(UART1_RX_DMA_STREAM);
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel = UART1_RX_DMA_CH;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&UART1_TYPE->DR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)rxDmaBuffer;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize = UART1_RX_DMA_BUFFER_SIZE;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+  DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+  DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+  DMA_Init(UART1_RX_DMA_STREAM, &DMA_InitStructure);
+
+  rxDmaLaps = 0;
+  rxDmaWriteCount = 0;
+  rxDmaReadCount = 0;
+
+  // The transfer complete interrupt is only used to count laps around the buffer
+  NVIC_InitStructure.NVIC_IRQChannel = UART1_RX_DMA_IRQ;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_UART1_DMA_PRI;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+  DMA_ITConfig(UART1_RX_DMA_STREAM, DMA_IT_TC, ENABLE);
+
+  // Data received before the switch is dropped
+  xQueueReset(uart1queue);
+
+  DMA_Cmd(UART1_RX_DMA_STREAM, ENABLE);
+  USART_DMACmd(UART1_TYPE, USART_DMAReq_Rx, ENABLE);
+
+  isRxDmaEnabled = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef ENABLE_UART1_RX_DMA
+static uint32_t updateRxDmaWriteCount()
+{
+  uint32_t laps;
+  uint32_t remaining;
+  do {
+    laps = rxDmaLaps;
+    remaining = DMA_GetCurrDataCounter(UART1_RX_DMA_STREAM);
+  } while (laps != rxDmaLaps);
+
+  // Wraps consistently since the buffer size is a power of 2
+  uint32_t count = laps * UART1_RX_DMA_BUFFER_SIZE + (UART1_RX_DMA_BUFFER_SIZE - remaining);
+
+  // The DMA may have wrapped while the transfer complete interrupt is pending
+  if ((int32_t)(count - rxDmaWriteCount) < 0) {
+    count += UART1_RX_DMA_BUFFER_SIZE;
+  }
+
+  rxDmaWriteCount = count;
+  return count;
+}
+#endif
+
+uint32_t uart1RxDmaBytesAvailable(void)
+{
+#ifdef ENABLE_UART1_RX_DMA
+  if (!isRxDmaEnabled) {
+    return 0;
+  }
+
+  const uint32_t writeCount = updateRxDmaWriteCount();
+  uint32_t available = writeCount - rxDmaReadCount;
+
+  // Keep a margin to the write position, the DMA must not write into data that is being peeked at
+  if (available > UART1_RX_DMA_BUFFER_SIZE - UART1_RX_DMA_MAX_PEEK) {
+    rxDmaReadCount = writeCount;
+    available = 0;
+    hasOverrun = true;
+  }
+
+  return available;
+#else
+  return 0;
+#endif
+}
+
+const uint8_t* uart1RxDmaPeek(const uint32_t size)
+{
+#ifdef ENABLE_UART1_RX_DMA
+  ASSERT(size <= UART1_RX_DMA_MAX_PEEK);
+
+  const uint32_t start = rxDmaReadCount & (UART1_RX_DMA_BUFFER_SIZE - 1);
+  if (start + size <= UART1_RX_DMA_BUFFER_SIZE) {
+    return &rxDmaBuffer[start];
+  }
+
+  const uint32_t firstPart = UART1_RX_DMA_BUFFER_SIZE - start;
+  memcpy(rxDmaPeekBuffer, &rxDmaBuffer[start], firstPart);
+  memcpy(&rxDmaPeekBuffer[firstPart], rxDmaBuffer, size - firstPart);
+  return rxDmaPeekBuffer;
+#else
+  return 0;
+#endif
+}
+
+void uart1RxDmaConsume(const uint32_t size)
+{
+#ifdef ENABLE_UART1_RX_DMA
+  rxDmaReadCount += size;
+#endif
+}
+
 int uart1Putchar(int ch)
 {
     uart1SendData(1, (uint8_t *)&ch);
@@ -298,6 +447,16 @@ void __attribute__((used)) DMA1_Stream3_IRQHandler(void)
 }
 #endif
 
+#ifdef ENABLE_UART1_RX_DMA
+void __attribute__((used)) DMA1_Stream1_IRQHandler(void)
+{
+  if (DMA_GetITStatus(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_TCIF)) {
+    DMA_ClearITPendingBit(UART1_RX_DMA_STREAM, UART1_RX_DMA_IT_TCIF);
+    rxDmaLaps++;
+  }
+}
+#endif
+
 void __attribute__((used)) USART3_IRQHandler(void)
 {
   if (USART_GetITStatus(UART1_TYPE, USART_IT_RXNE))
@@ -44,24 +44,53 @@
 #include "config.h"
 #include "nvicconf.h"
 #include "static_mem.h"
+#include "log.h"
 
 static xSemaphoreHandle uartBusy;
 static StaticSemaphore_t uartBusyBuffer;
-static xSemaphoreHandle waitUntilSendDone;
-static StaticSemaphore_t waitUntilSendDoneBuffer;
 
 static bool isInit = false;
 
+/*
+ * DMA TX is double buffered: data is copied into a free buffer and the
+ * caller can continue while the other buffer is being transmitted. The
+ * buffer that is not in flight is kept pending and is started from the
+ * transfer complete interrupt.
+ */
+#define UART2_DMA_NBR_OF_BUFFERS 2
+#define UART2_DMA_NO_BUFFER (-1)
+
 static DMA_InitTypeDef DMA_InitStructureShare;
-static uint8_t dmaBuffer[UART2_DMA_BUFFER_SIZE];
+static uint8_t dmaBuffer[UART2_DMA_NBR_OF_BUFFERS][UART2_DMA_BUFFER_SIZE];
+static uint16_t dmaBufferSize[UART2_DMA_NBR_OF_BUFFERS];
+static volatile int8_t dmaActiveBuffer = UART2_DMA_NO_BUFFER;
+static volatile int8_t dmaPendingBuffer = UART2_DMA_NO_BUFFER;
+STATIC_MEM_QUEUE_ALLOC(dmaFreeBuffers, UART2_DMA_NBR_OF_BUFFERS, sizeof(int8_t));
+static xQueueHandle dmaFreeBuffers;
 static bool    isUartDmaInitialized;
-static uint32_t initialDMACount;
+
+/*
+ * Received bytes are collected in the interrupt and handed over to the
+ * stream buffer in batches, when the line goes idle (end of a frame) or when
+ * the batch is full. This avoids one stream buffer call and possibly one
+ * task wake up for each received byte.
+ */
+#define UART2_RX_BATCH_SIZE 32
+#define UART2_RX_STREAM_SIZE 512
+
+static uint8_t rxBatch[UART2_RX_BATCH_SIZE];
+static uint8_t rxBatchCount;
 
 static StreamBufferHandle_t rxStream;
 static EventGroupHandle_t isrEvents;
 
 static bool hasOverrun = false;
 
+static uint32_t rxBytes;
+static uint32_t txBytes;
+static uint32_t rxDropped;
+static uint32_t rxOverruns;
+
 /**
   * Configures the UART DMA. Mainly used for FreeRTOS trace
   * data transfer.
@@ -74,7 +103,7 @@ static void uart2DmaInit(void)
 
   // USART TX DMA Channel Config
   DMA_InitStructureShare.DMA_PeripheralBaseAddr = (uint32_t)&UART2_TYPE->DR;
-  DMA_InitStructureShare.DMA_Memory0BaseAddr = (uint32_t)dmaBuffer;
+  DMA_InitStructureShare.DMA_Memory0BaseAddr = (uint32_t)dmaBuffer[0];
   DMA_InitStructureShare.DMA_MemoryInc = DMA_MemoryInc_Enable;
   DMA_InitStructureShare.DMA_MemoryBurst = DMA_MemoryBurst_Single;
   DMA_InitStructureShare.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
@@ -95,9 +124,71 @@ static void uart2DmaInit(void)
   NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_UART2_DMA_PRI;
   NVIC_Init(&NVIC_InitStructure);
 
+  dmaFreeBuffers = STATIC_MEM_QUEUE_CREATE(dmaFreeBuffers);
+  for (int8_t i = 0; i < UART2_DMA_NBR_OF_BUFFERS; i++) {
+    xQueueSend(dmaFreeBuffers, &i, 0);
+  }
+
   isUartDmaInitialized = true;
 }
 
+// Called with the DMA stream disabled, from a critical section or the DMA interrupt
+static void uart2DmaStart(int8_t buffer)
+{
+  DMA_InitStructureShare.DMA_Memory0BaseAddr = (uint32_t)dmaBuffer[buffer];
+  DMA_InitStructureShare.DMA_BufferSize = dmaBufferSize[buffer];
+  dmaActiveBuffer = buffer;
+  // Init new DMA stream
+  DMA_Init(UART2_DMA_STREAM, &DMA_InitStructureShare);
+  // Enable the Transfer Complete interrupt
+  DMA_ITConfig(UART2_DMA_STREAM, DMA_IT_TC, ENABLE);
+  /* Enable USART DMA TX Requests */
+  USART_DMACmd(UART2_TYPE, USART_DMAReq_Tx, ENABLE);
+  /* Clear transfer complete */
+  USART_ClearFlag(UART2_TYPE, USART_FLAG_TC);
+  /* Enable DMA USART TX Stream */
+  DMA_Cmd(UART2_DMA_STREAM, ENABLE);
+}
+
+static void uart2DmaQueue(uint32_t size, const uint8_t* data)
+{
+  while (size > 0)
+  {
+    const uint32_t chunk = size < UART2_DMA_BUFFER_SIZE ? size : UART2_DMA_BUFFER_SIZE;
+    int8_t buffer;
+
+    // Wait for a buffer that is not in flight
+    xQueueReceive(dmaFreeBuffers, &buffer, portMAX_DELAY);
+    memcpy(dmaBuffer[buffer], data, chunk);
+    dmaBufferSize[buffer] = chunk;
+
+    taskENTER_CRITICAL();
+    if (dmaActiveBuffer == UART2_DMA_NO_BUFFER) {
+      uart2DmaStart(buffer);
+    } else {
+      dmaPendingBuffer = buffer;
+    }
+    taskEXIT_CRITICAL();
+
+    txBytes += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+static void uart2DmaWaitUntilDone(void)
+{
+  int8_t buffers[UART2_DMA_NBR_OF_BUFFERS];
+
+  // All buffers are back in the free queue when nothing is in flight
+  for (int i = 0; i < UART2_DMA_NBR_OF_BUFFERS; i++) {
+    xQueueReceive(dmaFreeBuffers, &buffers[i], portMAX_DELAY);
+  }
+  for (int i = 0; i < UART2_DMA_NBR_OF_BUFFERS; i++) {
+    xQueueSend(dmaFreeBuffers, &buffers[i], 0);
+  }
+}
+
 void uart2Init(const uint32_t baudrate)
 {
 
@@ -106,7 +197,6 @@ void uart2Init(const uint32_t baudrate)
   NVIC_InitTypeDef NVIC_InitStructure;
 
   // initialize the FreeRTOS structures first, to prevent null pointers in interrupts
-  waitUntilSendDone = xSemaphoreCreateBinaryStatic(&waitUntilSendDoneBuffer); // initialized as blocking
   uartBusy = xSemaphoreCreateBinaryStatic(&uartBusyBuffer); // initialized as blocking
   xSemaphoreGive(uartBusy); // but we give it because the uart isn't busy at initialization
 
@@ -154,10 +244,11 @@ void uart2Init(const uint32_t baudrate)
   USART_Cmd(UART2_TYPE, ENABLE);
 
   USART_ITConfig(UART2_TYPE, USART_IT_RXNE, ENABLE);
+  USART_ITConfig(UART2_TYPE, USART_IT_IDLE, ENABLE);
 
   isrEvents = xEventGroupCreate();
 
-  rxStream = xStreamBufferCreate( 200, 1);
+  rxStream = xStreamBufferCreate(UART2_RX_STREAM_SIZE, 1);
   ASSERT(rxStream);
 
   isInit = true;
@@ -183,6 +274,7 @@ void uart2SendData(uint32_t size, uint8_t* data)
   txSize = size;
   txBuffer = data;
 
+  txBytes += size;
   USART_ITConfig(UART2_TYPE, USART_IT_TXE, ENABLE);
 
   xEventGroupWaitBits(isrEvents,
@@ -198,25 +290,25 @@ void uart2SendDataDmaBlocking(uint32_t size, uint8_t* data)
   if (isUartDmaInitialized)
   {
     xSemaphoreTake(uartBusy, portMAX_DELAY);
-    // Wait for DMA to be free
-    while(DMA_GetCmdStatus(UART2_DMA_STREAM) != DISABLE);
-    //Copy data in DMA buffer
-    memcpy(dmaBuffer, data, size);
-    DMA_InitStructureShare.DMA_BufferSize = size;
-    initialDMACount = size;
-    // Init new DMA stream
-    DMA_Init(UART2_DMA_STREAM, &DMA_InitStructureShare);
-    // Enable the Transfer Complete interrupt
-    DMA_ITConfig(UART2_DMA_STREAM, DMA_IT_TC, ENABLE);
-    /* Enable USART DMA TX Requests */
-    USART_DMACmd(UART2_TYPE, USART_DMAReq_Tx, ENABLE);
-    /* Clear transfer complete */
-    USART_ClearFlag(UART2_TYPE, USART_FLAG_TC);
-    /* Enable DMA USART TX Stream */
-    DMA_Cmd(UART2_DMA_STREAM, ENABLE);
-    xSemaphoreTake(waitUntilSendDone, portMAX_DELAY);
+    uart2DmaQueue(size, data);
+    uart2DmaWaitUntilDone();
+    xSemaphoreGive(uartBusy);
+  }
+}
+
+void uart2SendDataDma(uint32_t size, const uint8_t* data)
+{
+#ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+  // The DMA stream is used by the motors
+  uart2SendData(size, (uint8_t*)data);
+#else
+  if (isUartDmaInitialized)
+  {
+    xSemaphoreTake(uartBusy, portMAX_DELAY);
+    uart2DmaQueue(size, data);
     xSemaphoreGive(uartBusy);
   }
+#endif
 }
 
 int uart2Putchar(int ch)
@@ -288,20 +380,54 @@ void __attribute__((used)) DMA1_Stream6_IRQHandler(void)
   USART_DMACmd(UART2_TYPE, USART_DMAReq_Tx, DISABLE);
   DMA_Cmd(UART2_DMA_STREAM, DISABLE);
 
-  xSemaphoreGiveFromISR(waitUntilSendDone, &xHigherPriorityTaskWoken);
+  const int8_t doneBuffer = dmaActiveBuffer;
+  if (dmaPendingBuffer != UART2_DMA_NO_BUFFER) {
+    const int8_t nextBuffer = dmaPendingBuffer;
+    dmaPendingBuffer = UART2_DMA_NO_BUFFER;
+    // The stream must be disabled before it can be re-initialized
+    while (DMA_GetCmdStatus(UART2_DMA_STREAM) != DISABLE);
+    uart2DmaStart(nextBuffer);
+  } else {
+    dmaActiveBuffer = UART2_DMA_NO_BUFFER;
+  }
+
+  xQueueSendFromISR(dmaFreeBuffers, &doneBuffer, &xHigherPriorityTaskWoken);
   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 #endif
 
+static void uart2RxBatchFlush(BaseType_t* xHigherPriorityTaskWoken)
+{
+  if (rxBatchCount > 0)
+  {
+    const size_t sent = xStreamBufferSendFromISR(rxStream, rxBatch, rxBatchCount, xHigherPriorityTaskWoken);
+    rxDropped += rxBatchCount - sent;
+    rxBatchCount = 0;
+  }
+}
+
 void __attribute__((used)) USART2_IRQHandler(void)
 {
 
   uint32_t status = UART2_TYPE->SR;
   if ((UART2_TYPE->SR & USART_FLAG_RXNE) != 0)
+  {
+    // Reading DR after SR also clears a pending idle flag
+    rxBatch[rxBatchCount++] = USART_ReceiveData(UART2_TYPE) & 0x00FF;
+    rxBytes++;
+    if (rxBatchCount == UART2_RX_BATCH_SIZE)
+    {
+      BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+      uart2RxBatchFlush(&xHigherPriorityTaskWoken);
+      portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+    }
+  }
+  else if ((status & USART_FLAG_IDLE) != 0)
   {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    uint8_t rxData = USART_ReceiveData(UART2_TYPE) & 0x00FF;
-    xStreamBufferSendFromISR(rxStream, &rxData, 1, &xHigherPriorityTaskWoken );
+    // The idle flag is cleared by reading SR followed by DR
+    asm volatile ("" : "=m" (UART2_TYPE->DR) : "r" (UART2_TYPE->DR));
+    uart2RxBatchFlush(&xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
   }
 
@@ -336,5 +462,28 @@ void __attribute__((used)) USART2_IRQHandler(void)
     asm volatile ("" : "=m" (UART2_TYPE->DR) : "r" (UART2_TYPE->DR)); // of these two registers
 
     hasOverrun = true;
+    rxOverruns++;
   }
 }
+
+/**
+ * UART2 driver statistics, wrap around counters
+ */
+LOG_GROUP_START(uart2)
+/**
+ * @brief Number of bytes received
+ */
+LOG_ADD(LOG_UINT32, rxBytes, &rxBytes)
+/**
+ * @brief Number of bytes sent
+ */
+LOG_ADD(LOG_UINT32, txBytes, &txBytes)
+/**
+ * @brief Number of received bytes dropped because the RX stream buffer was full
+ */
+LOG_ADD(LOG_UINT32, rxDropped, &rxDropped)
+/**
+ * @brief Number of overrun, noise, framing or parity errors
+ */
+LOG_ADD(LOG_UINT32, rxOverruns, &rxOverruns)
+LOG_GROUP_STOP(uart2)
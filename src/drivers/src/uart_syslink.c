@@ -43,7 +43,12 @@
 #include "nvicconf.h"
 #include "config.h"
 #include "queuemonitor.h"
+#include "queuestats.h"
+#include "isr_trace.h"
 #include "static_mem.h"
+#include "cycle_counter.h"
+#include "log.h"
+#include "statsCnt.h"
 
 #define DEBUG_MODULE "U-SLK"
 #include "debug.h"
@@ -53,6 +58,17 @@
 #define CCR_ENABLE_SET  ((uint32_t)0x00000001)
 
 #define UARTSLK_CLKSUM_SIZE   2
+#define UARTSLK_FRAME_MAX_SIZE (SYSLINK_MTU + 6)
+
+// With CONFIG_SYSLINK_RX_DMA the received bytes are written by a circular DMA
+// to a ring. The ring is parsed when the line goes idle and when the DMA has
+// written half of it, one interrupt handles a burst of bytes, often several
+// syslink packets.
+#define UARTSLK_RX_RING_SIZE 256
+
+// Frames waiting for the TX DMA, sent one after the other from the transfer
+// complete interrupt
+#define UARTSLK_TX_QUEUE_SIZE 4
 
 static bool isInit = false;
 
@@ -65,10 +81,25 @@ STATIC_MEM_QUEUE_ALLOC(syslinkPacketDelivery, 8, sizeof(SyslinkPacket));
 static bool syslinkPacketDeliveryReadyToReceive = false;
 
 #ifdef CONFIG_SYSLINK_RX_DMA
-static uint8_t dmaRXBuffer[64];
+static uint8_t dmaRXBuffer[UARTSLK_RX_RING_SIZE];
+static uint16_t rxRingReadPos;
 static DMA_InitTypeDef DMA_InitStructureShareRX;
 #endif
-static uint8_t dmaTXBuffer[64];
+
+typedef struct {
+  uint8_t data[UARTSLK_FRAME_MAX_SIZE];
+  uint8_t size;
+} txFrame_t;
+
+static txFrame_t txFrames[UARTSLK_TX_QUEUE_SIZE];
+static uint8_t txHead;
+static uint8_t txTail;
+static volatile uint8_t txQueued;
+static volatile bool txIsSending;
+static xSemaphoreHandle txFrameFreed;
+static StaticSemaphore_t txFrameFreedBuffer;
+static xSemaphoreHandle txDrained;
+static StaticSemaphore_t txDrainedBuffer;
 static uint8_t *outDataIsr;
 static uint8_t dataIndexIsr;
 static uint8_t dataSizeIsr;
@@ -95,6 +126,15 @@ static uint32_t dmaTxStreamResumedCounter;
 static bool dmaNrfFlowControlBufferFull;
 static uint32_t dmaSendWhileNrfBufferFull;
 
+// Link throughput and the cost of the RX interrupts
+static STATS_CNT_RATE_DEFINE(rxByteRate, 1000);
+static STATS_CNT_RATE_DEFINE(rxPacketRate, 1000);
+static STATS_CNT_RATE_DEFINE(rxIsrRate, 1000);
+static STATS_CNT_RATE_DEFINE(rxIsrCycleRate, 1000);
+static STATS_CNT_RATE_DEFINE(txByteRate, 1000);
+static uint32_t rxErrors;
+static uint32_t txQueueFull;
+
 /**
   * Configures the UART DMA. Mainly used for FreeRTOS trace
   * data transfer.
@@ -107,7 +147,7 @@ void uartslkDmaInit(void)
 
   // USART TX DMA Channel Config
   DMA_InitStructureShareTX.DMA_PeripheralBaseAddr = (uint32_t)&UARTSLK_TYPE->DR;
-  DMA_InitStructureShareTX.DMA_Memory0BaseAddr = (uint32_t)dmaTXBuffer;
+  DMA_InitStructureShareTX.DMA_Memory0BaseAddr = (uint32_t)txFrames[0].data;
   DMA_InitStructureShareTX.DMA_MemoryInc = DMA_MemoryInc_Enable;
   DMA_InitStructureShareTX.DMA_MemoryBurst = DMA_MemoryBurst_Single;
   DMA_InitStructureShareTX.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
@@ -129,18 +169,18 @@ void uartslkDmaInit(void)
   NVIC_Init(&NVIC_InitStructure);
 
 #ifdef CONFIG_SYSLINK_RX_DMA
-  // USART TX DMA Channel Config
+  // USART RX DMA Channel Config, circular over the ring
   DMA_InitStructureShareRX.DMA_PeripheralBaseAddr = (uint32_t)&UARTSLK_TYPE->DR;
   DMA_InitStructureShareRX.DMA_Memory0BaseAddr = (uint32_t)dmaRXBuffer;
   DMA_InitStructureShareRX.DMA_MemoryInc = DMA_MemoryInc_Enable;
   DMA_InitStructureShareRX.DMA_MemoryBurst = DMA_MemoryBurst_Single;
   DMA_InitStructureShareRX.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
-  DMA_InitStructureShareRX.DMA_BufferSize = 0;
+  DMA_InitStructureShareRX.DMA_BufferSize = UARTSLK_RX_RING_SIZE;
   DMA_InitStructureShareRX.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
   DMA_InitStructureShareRX.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
   DMA_InitStructureShareRX.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
   DMA_InitStructureShareRX.DMA_DIR = DMA_DIR_PeripheralToMemory;
-  DMA_InitStructureShareRX.DMA_Mode = DMA_Mode_Normal;
+  DMA_InitStructureShareRX.DMA_Mode = DMA_Mode_Circular;
   DMA_InitStructureShareRX.DMA_Priority = DMA_Priority_High;
   DMA_InitStructureShareRX.DMA_FIFOMode = DMA_FIFOMode_Disable;
   DMA_InitStructureShareRX.DMA_FIFOThreshold = DMA_FIFOThreshold_1QuarterFull ;
@@ -163,9 +203,13 @@ void uartslkInit(void)
   waitUntilSendDone = xSemaphoreCreateBinaryStatic(&waitUntilSendDoneBuffer); // initialized as blocking
   uartBusy = xSemaphoreCreateBinaryStatic(&uartBusyBuffer); // initialized as blocking
   xSemaphoreGive(uartBusy); // but we give it because the uart isn't busy at initialization
+  txFrameFreed = xSemaphoreCreateBinaryStatic(&txFrameFreedBuffer);
+  txDrained = xSemaphoreCreateBinaryStatic(&txDrainedBuffer);
+  cycleCounterInit();
 
   syslinkPacketDelivery = STATIC_MEM_QUEUE_CREATE(syslinkPacketDelivery);
   DEBUG_QUEUE_MONITOR_REGISTER(syslinkPacketDelivery);
+  queueStatsRegister(syslinkPacketDelivery, queueStatsSyslinkRx);
 
   USART_InitTypeDef USART_InitStructure;
   GPIO_InitTypeDef GPIO_InitStructure;
@@ -215,7 +259,16 @@ void uartslkInit(void)
   NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
   NVIC_Init(&NVIC_InitStructure);
 
+#ifdef CONFIG_SYSLINK_RX_DMA
+  // The DMA receives all the bytes, the interrupts tell when to parse them
+  rxRingReadPos = 0;
+  DMA_ITConfig(UARTSLK_DMA_RX_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+  USART_DMACmd(UARTSLK_TYPE, USART_DMAReq_Rx, ENABLE);
+  DMA_Cmd(UARTSLK_DMA_RX_STREAM, ENABLE);
+  USART_ITConfig(UARTSLK_TYPE, USART_IT_IDLE, ENABLE);
+#else
   USART_ITConfig(UARTSLK_TYPE, USART_IT_RXNE, ENABLE);
+#endif
 
   // Setting up TXEN pin (NRF flow control)
   RCC_AHB1PeriphClockCmd(UARTSLK_TXEN_PERIF, ENABLE);
@@ -248,11 +301,19 @@ bool uartslkTest(void)
 void uartslkPauseRx(void)
 {
   NVIC_DisableIRQ(UARTSLK_IRQ);
+#ifdef CONFIG_SYSLINK_RX_DMA
+  NVIC_DisableIRQ(UARTSLK_DMA_RX_IRQ);
+#endif
 }
 
 void uartslkResumeRx(void)
 {
   rxState = waitForFirstStart;
+#ifdef CONFIG_SYSLINK_RX_DMA
+  // Drop what was received while paused
+  rxRingReadPos = (UARTSLK_RX_RING_SIZE - DMA_GetCurrDataCounter(UARTSLK_DMA_RX_STREAM)) % UARTSLK_RX_RING_SIZE;
+  NVIC_EnableIRQ(UARTSLK_DMA_RX_IRQ);
+#endif
   NVIC_EnableIRQ(UARTSLK_IRQ);
 }
 
@@ -303,38 +364,76 @@ int uartslkPutchar(int ch)
     return (unsigned char)ch;
 }
 
-void uartslkSendDataDmaBlocking(uint32_t size, uint8_t* data)
+/* Starts the DMA transfer of the frame at the tail of the queue. Called with
+ * the syslink interrupts masked or from the TX DMA interrupt. */
+static void uartslkStartTxFrame(void)
 {
+  txFrame_t *frame = &txFrames[txTail];
+
   if (dmaNrfFlowControlBufferFull) {
     dmaSendWhileNrfBufferFull++;
   }
 
-  if (isUartDmaInitialized)
+  // Wait for DMA to be free
+  while(DMA_GetCmdStatus(UARTSLK_DMA_TX_STREAM) != DISABLE);
+  DMA_InitStructureShareTX.DMA_Memory0BaseAddr = (uint32_t)frame->data;
+  DMA_InitStructureShareTX.DMA_BufferSize = frame->size;
+  initialDMACount = frame->size;
+  // Init new DMA stream
+  DMA_Init(UARTSLK_DMA_TX_STREAM, &DMA_InitStructureShareTX);
+  // Enable the Transfer Complete interrupt
+  DMA_ITConfig(UARTSLK_DMA_TX_STREAM, DMA_IT_TC, ENABLE);
+  // Enable USART DMA TX Requests
+  USART_DMACmd(UARTSLK_TYPE, USART_DMAReq_Tx, ENABLE);
+  // Clear transfer complete
+  USART_ClearFlag(UARTSLK_TYPE, USART_FLAG_TC);
+  txIsSending = true;
+  // Enable DMA USART TX Stream
+  DMA_Cmd(UARTSLK_DMA_TX_STREAM, ENABLE);
+}
+
+void uartslkSendDataDma(uint32_t size, uint8_t* data)
+{
+  ASSERT(size <= UARTSLK_FRAME_MAX_SIZE);
+
+  if (!isUartDmaInitialized)
+  {
+    return;
+  }
+
+  xSemaphoreTake(uartBusy, portMAX_DELAY);
+  if (txQueued == UARTSLK_TX_QUEUE_SIZE)
   {
-    xSemaphoreTake(uartBusy, portMAX_DELAY);
-    // Wait for DMA to be free
-    while(DMA_GetCmdStatus(UARTSLK_DMA_TX_STREAM) != DISABLE);
-    //Copy data in DMA buffer
-    memcpy(dmaTXBuffer, data, size);
-    DMA_InitStructureShareTX.DMA_BufferSize = size;
-    initialDMACount = (uint16_t)size;
-    // Init new DMA stream
-    DMA_Init(UARTSLK_DMA_TX_STREAM, &DMA_InitStructureShareTX);
-    // Enable the Transfer Complete interrupt
-    DMA_ITConfig(UARTSLK_DMA_TX_STREAM, DMA_IT_TC, ENABLE);
-    // Enable USART DMA TX Requests
-    // Critical section is needed as the RX DMA that runs form interrupt can
-    // change the same USARTx->CR3 register at the wrong point (not atomic).
-    taskENTER_CRITICAL();
-    USART_DMACmd(UARTSLK_TYPE, USART_DMAReq_Tx, ENABLE);
-    taskEXIT_CRITICAL();
-    // Clear transfer complete
-    USART_ClearFlag(UARTSLK_TYPE, USART_FLAG_TC);
-    // Enable DMA USART TX Stream
-    DMA_Cmd(UARTSLK_DMA_TX_STREAM, ENABLE);
-    xSemaphoreTake(waitUntilSendDone, portMAX_DELAY);
-    xSemaphoreGive(uartBusy);
+    txQueueFull++;
+    xSemaphoreTake(txFrameFreed, 0);
+    while (txQueued == UARTSLK_TX_QUEUE_SIZE)
+    {
+      xSemaphoreTake(txFrameFreed, portMAX_DELAY);
+    }
+  }
+
+  memcpy(txFrames[txHead].data, data, size);
+  txFrames[txHead].size = (uint8_t)size;
+  txHead = (txHead + 1) % UARTSLK_TX_QUEUE_SIZE;
+  STATS_CNT_RATE_MULTI_EVENT(&txByteRate, size);
+
+  // Critical section is needed as the transfer complete interrupt also starts
+  // frames, and the RX interrupts change the same USARTx->CR3 register.
+  taskENTER_CRITICAL();
+  txQueued++;
+  if (!txIsSending)
+  {
+    uartslkStartTxFrame();
   }
+  taskEXIT_CRITICAL();
+  xSemaphoreGive(uartBusy);
+}
+
+void uartslkSendDataDmaBlocking(uint32_t size, uint8_t* data)
+{
+  xSemaphoreTake(txDrained, 0);
+  uartslkSendDataDma(size, data);
+  xSemaphoreTake(txDrained, portMAX_DELAY);
 }
 
 static void uartslkPauseDma()
@@ -367,7 +466,7 @@ static void uartslkResumeDma()
     // Update DMA counter
     DMA_SetCurrDataCounter(UARTSLK_DMA_TX_STREAM, remainingDMACount);
     // Update memory read address
-    UARTSLK_DMA_TX_STREAM->M0AR = (uint32_t)&dmaTXBuffer[initialDMACount - remainingDMACount];
+    UARTSLK_DMA_TX_STREAM->M0AR = (uint32_t)&txFrames[txTail].data[initialDMACount - remainingDMACount];
     // Enable the Transfer Complete interrupt
     DMA_ITConfig(UARTSLK_DMA_TX_STREAM, DMA_IT_TC, ENABLE);
     // Clear transfer complete
@@ -390,75 +489,97 @@ static void uartslkDmaTXIsr(void)
   DMA_Cmd(UARTSLK_DMA_TX_STREAM, DISABLE);
 
   remainingDMACount = 0;
-  xSemaphoreGiveFromISR(waitUntilSendDone, &xHigherPriorityTaskWoken);
-}
 
-#ifdef CONFIG_SYSLINK_RX_DMA
-static void uartslkReceiveDMA(uint32_t size)
-{
-  if (isUartDmaInitialized)
+  // Send the next frame, if any
+  txTail = (txTail + 1) % UARTSLK_TX_QUEUE_SIZE;
+  txQueued--;
+  xSemaphoreGiveFromISR(txFrameFreed, &xHigherPriorityTaskWoken);
+  if (txQueued > 0)
   {
-    // Wait for DMA to be free
-    while(DMA_GetCmdStatus(UARTSLK_DMA_RX_STREAM) != DISABLE);
-    // Reload new DMA stream by loading number of bytes to be transferred
-    UARTSLK_DMA_RX_STREAM->NDTR = size;
-    // Enable the Transfer Complete interrupt
-    DMA_ITConfig(UARTSLK_DMA_RX_STREAM, DMA_IT_TC, ENABLE);
-    // Enable USART DMA RX Requests
-    USART_DMACmd(UARTSLK_TYPE, USART_DMAReq_Rx, ENABLE);
-    // Clear transfer complete
-    USART_ClearFlag(UARTSLK_TYPE, USART_FLAG_TC);
-    // Disable USART RX interrupt
-    USART_ITConfig(UARTSLK_TYPE, USART_IT_RXNE, DISABLE);
-    // Enable DMA USART RX Stream
-    DMA_Cmd(UARTSLK_DMA_RX_STREAM, ENABLE);
+    uartslkStartTxFrame();
+  }
+  else
+  {
+    txIsSending = false;
+    xSemaphoreGiveFromISR(txDrained, &xHigherPriorityTaskWoken);
   }
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-static void uartslkDmaRXIsr(void)
+/* Parses received bytes. The payload of a packet is copied in one go, the
+ * rest goes through the state machine. Called from the UART and RX DMA
+ * interrupts, that have the same priority. */
+static void uartslkParseFromISR(const uint8_t* data, const uint32_t length, BaseType_t * const pxHigherPriorityTaskWoken)
 {
-  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-
-  // Stop and cleanup DMA stream
-  DMA_ITConfig(UARTSLK_DMA_RX_STREAM, DMA_IT_TC, DISABLE);
-  DMA_ClearITPendingBit(UARTSLK_DMA_RX_STREAM, UARTSLK_DMA_RX_FLAG_TCIF);
-  USART_DMACmd(UARTSLK_TYPE, USART_DMAReq_Rx, DISABLE);
-  DMA_Cmd(UARTSLK_DMA_RX_STREAM, DISABLE);
-  // Enable USART RX interrupt
-  USART_ITConfig(UARTSLK_TYPE, USART_IT_RXNE, ENABLE);
-
-  for (int i = 0; i < slp.length; i++)
+  uint32_t i = 0;
+  while (i < length)
   {
-    slp.data[i] = dmaRXBuffer[i];
-    cksum[0] += dmaRXBuffer[i];
-    cksum[1] += cksum[0];
-  }
-  // Check checksum and send to queue
-  if ((cksum[0] == dmaRXBuffer[slp.length]) &&
-      (cksum[1] == dmaRXBuffer[slp.length + 1]))
-  {
-    // Post the packet to the queue if there's room
-    if (!xQueueIsQueueFullFromISR(syslinkPacketDelivery))
+    if (rxState == waitForData)
     {
-      if (syslinkPacketDeliveryReadyToReceive)
+      uint32_t count = slp.length - dataIndex;
+      if (count > length - i)
+      {
+        count = length - i;
+      }
+
+      uint8_t sum0 = cksum[0];
+      uint8_t sum1 = cksum[1];
+      for (uint32_t j = 0; j < count; j++)
       {
-        xQueueSendFromISR(syslinkPacketDelivery, (void *)&slp, &xHigherPriorityTaskWoken);
+        const uint8_t c = data[i + j];
+        slp.data[dataIndex + j] = c;
+        sum0 += c;
+        sum1 += sum0;
+      }
+      cksum[0] = sum0;
+      cksum[1] = sum1;
+
+      dataIndex += count;
+      i += count;
+      if (dataIndex == slp.length)
+      {
+        rxState = waitForChksum1;
       }
     }
-    else if(!(CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
+    else
     {
-      // Only assert if debugger is not connected
-      ASSERT(0); // Queue overflow
+      uartslkHandleDataFromISR(data[i], pxHigherPriorityTaskWoken);
+      i++;
     }
   }
-  else
-  { // Checksum error
-    if(!(CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
-    {
-      // Only assert if debugger is not connected
-      ASSERT(0);
-    }
+}
+
+#ifdef CONFIG_SYSLINK_RX_DMA
+/* Parses the bytes written to the ring since the last call */
+static void uartslkRxRingProcessFromISR(BaseType_t * const pxHigherPriorityTaskWoken)
+{
+  const uint32_t start = cycleCounterGet();
+
+  const uint16_t writePos = (UARTSLK_RX_RING_SIZE - DMA_GetCurrDataCounter(UARTSLK_DMA_RX_STREAM)) % UARTSLK_RX_RING_SIZE;
+  const uint16_t readPos = rxRingReadPos;
+  if (writePos > readPos)
+  {
+    uartslkParseFromISR(&dmaRXBuffer[readPos], writePos - readPos, pxHigherPriorityTaskWoken);
   }
+  else if (writePos < readPos)
+  {
+    uartslkParseFromISR(&dmaRXBuffer[readPos], UARTSLK_RX_RING_SIZE - readPos, pxHigherPriorityTaskWoken);
+    uartslkParseFromISR(&dmaRXBuffer[0], writePos, pxHigherPriorityTaskWoken);
+  }
+  rxRingReadPos = writePos;
+
+  STATS_CNT_RATE_MULTI_EVENT(&rxByteRate, (writePos - readPos + UARTSLK_RX_RING_SIZE) % UARTSLK_RX_RING_SIZE);
+  STATS_CNT_RATE_EVENT(&rxIsrRate);
+  STATS_CNT_RATE_MULTI_EVENT(&rxIsrCycleRate, cycleCounterElapsed(start));
+}
+
+static void uartslkDmaRXIsr(void)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+  DMA_ClearFlag(UARTSLK_DMA_RX_STREAM, UARTSLK_DMA_RX_FLAG_HTIF | UARTSLK_DMA_RX_FLAG_TCIF);
+  uartslkRxRingProcessFromISR(&xHigherPriorityTaskWoken);
 
   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
@@ -487,24 +608,12 @@ void uartslkHandleDataFromISR(uint8_t c, BaseType_t * const pxHigherPriorityTask
       cksum[0] += c;
       cksum[1] += cksum[0];
       dataIndex = 0;
-#ifdef CONFIG_SYSLINK_RX_DMA
-      if (c >= 1)
-      {
-        rxState = waitForFirstStart;
-        // For efficiency receive using DMA
-        uartslkReceiveDMA(slp.length + UARTSLK_CLKSUM_SIZE);
-      }
-      else // zero length
-      {
-        rxState = waitForChksum1;
-      }
-#else
       rxState = (c > 0) ? waitForData : waitForChksum1;
-#endif
     }
     else
     {
       rxState = waitForFirstStart;
+      rxErrors++;
     }
     break;
   case waitForData:
@@ -525,6 +634,7 @@ void uartslkHandleDataFromISR(uint8_t c, BaseType_t * const pxHigherPriorityTask
     else
     {
       rxState = waitForFirstStart; //Checksum error
+      rxErrors++;
       if(!(CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
       {
         // Only assert if debugger is not connected
@@ -541,6 +651,7 @@ void uartslkHandleDataFromISR(uint8_t c, BaseType_t * const pxHigherPriorityTask
         if (syslinkPacketDeliveryReadyToReceive)
         {
           xQueueSendFromISR(syslinkPacketDelivery, (void *)&slp, pxHigherPriorityTaskWoken);
+          STATS_CNT_RATE_EVENT(&rxPacketRate);
         }
       }
       else if(!(CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
@@ -552,6 +663,7 @@ void uartslkHandleDataFromISR(uint8_t c, BaseType_t * const pxHigherPriorityTask
     else
     {
       rxState = waitForFirstStart; //Checksum error
+      rxErrors++;
       ASSERT(0);
     }
     rxState = waitForFirstStart;
@@ -570,11 +682,26 @@ void uartslkIsr(void)
   // if (USART_GetITStatus(UARTSLK_TYPE, USART_IT_RXNE) == SET)
   // we do this check as fast as possible to minimize the chance of an overrun,
   // which occasionally cause problems and cause packet loss at high CPU usage
+#ifdef CONFIG_SYSLINK_RX_DMA
+  if ((UARTSLK_TYPE->SR & USART_FLAG_IDLE) != 0)
+  {
+    // The idle flag is cleared by reading SR followed by DR, the data is
+    // received by the DMA
+    asm volatile ("" : "=m" (UARTSLK_TYPE->DR) : "r" (UARTSLK_TYPE->DR));
+    uartslkRxRingProcessFromISR(&xHigherPriorityTaskWoken);
+  }
+#else
   if ((UARTSLK_TYPE->SR & (1<<5)) != 0) // if the RXNE interrupt has occurred
   {
+    const uint32_t start = cycleCounterGet();
     uint8_t rxDataInterrupt = (uint8_t)(UARTSLK_TYPE->DR & 0xFF);
-    uartslkHandleDataFromISR(rxDataInterrupt, &xHigherPriorityTaskWoken);
+    uartslkParseFromISR(&rxDataInterrupt, 1, &xHigherPriorityTaskWoken);
+
+    STATS_CNT_RATE_EVENT(&rxByteRate);
+    STATS_CNT_RATE_EVENT(&rxIsrRate);
+    STATS_CNT_RATE_MULTI_EVENT(&rxIsrCycleRate, cycleCounterElapsed(start));
   }
+#endif
   else if (USART_GetITStatus(UARTSLK_TYPE, USART_IT_TXE) == SET)
   {
     if (outDataIsr && (dataIndexIsr < dataSizeIsr))
@@ -624,18 +751,24 @@ void __attribute__((used)) EXTI4_Callback(void)
 
 void __attribute__((used)) USART6_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   uartslkIsr();
+  ISR_TRACE_EXIT();
 }
 
 void __attribute__((used)) DMA2_Stream7_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   uartslkDmaTXIsr();
+  ISR_TRACE_EXIT();
 }
 
 #ifdef CONFIG_SYSLINK_RX_DMA
 void __attribute__((used)) DMA2_Stream1_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   uartslkDmaRXIsr();
+  ISR_TRACE_EXIT();
 }
 #endif
 
@@ -646,3 +779,39 @@ void uartSyslinkDumpDebugProbe() {
   DEBUG_PRINT("STM dmaTxStreamResumedCounter: %ld\n", dmaTxStreamResumedCounter);
   DEBUG_PRINT("STM dmaSendWhileNrfBufferFull: %ld\n", dmaSendWhileNrfBufferFull);
 }
+
+/**
+ * Throughput of the syslink UART to the nRF51, and CPU cost of the RX
+ * interrupts. With CONFIG_SYSLINK_RX_DMA an interrupt handles a burst of
+ * bytes, otherwise there is one interrupt per byte.
+ */
+LOG_GROUP_START(uartSlk)
+/**
+ * @brief Received bytes [1/s]
+ */
+STATS_CNT_RATE_LOG_ADD(rxBytes, &rxByteRate)
+/**
+ * @brief Received syslink packets [1/s]
+ */
+STATS_CNT_RATE_LOG_ADD(rxPkts, &rxPacketRate)
+/**
+ * @brief RX interrupts [1/s]
+ */
+STATS_CNT_RATE_LOG_ADD(rxIsrs, &rxIsrRate)
+/**
+ * @brief CPU cycles spent in the RX interrupts [1/s], divide by the core clock for the load
+ */
+STATS_CNT_RATE_LOG_ADD(rxCycles, &rxIsrCycleRate)
+/**
+ * @brief Sent bytes [1/s]
+ */
+STATS_CNT_RATE_LOG_ADD(txBytes, &txByteRate)
+/**
+ * @brief Number of packets dropped because of a bad length or checksum
+ */
+LOG_ADD(LOG_UINT32, rxErr, &rxErrors)
+/**
+ * @brief Number of times a frame had to wait for room in the TX queue
+ */
+LOG_ADD(LOG_UINT32, txQFull, &txQueueFull)
+LOG_GROUP_STOP(uartSlk)
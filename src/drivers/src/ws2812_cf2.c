@@ -205,6 +205,12 @@ void ws2812Send(uint8_t (*color)[3], uint16_t len)
 	TIM_Cmd(TIM3, ENABLE);                      // Go!!!
 }
 
+void ws2812WaitDone(void)
+{
+	xSemaphoreTake(allLedDone, portMAX_DELAY);
+	xSemaphoreGive(allLedDone);
+}
+
 void ws2812DmaIsr(void)
 {
     portBASE_TYPE xHigherPriorityTaskWoken;
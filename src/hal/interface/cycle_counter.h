@@ -0,0 +1,49 @@
+/**
+ *    ||          ____  _ __                           
+ * +------+      / __ )(_) /_______________ _____  ___ 
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cycle_counter.h - CPU cycle counter based on the DWT unit, for profiling.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "stm32fxxx.h"
+
+/**
+ * Enable the DWT cycle counter. Safe to call multiple times.
+ */
+void cycleCounterInit(void);
+
+/**
+ * Get the current value of the cycle counter. It runs at the core clock and wraps after 2^32 cycles (about 25 s at
+ * 168 MHz), use cycleCounterElapsed() to compute differences.
+ */
+static inline uint32_t cycleCounterGet(void) {
+  return DWT->CYCCNT;
+}
+
+/**
+ * Get the number of cycles since a previous value from cycleCounterGet(). Handles wrap around.
+ */
+static inline uint32_t cycleCounterElapsed(const uint32_t start) {
+  return cycleCounterGet() - start;
+}
@@ -0,0 +1,79 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * p2p_relay.h - Multi-hop relay of P2P broadcasts
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radiolink.h"
+
+/*
+ * Relayed P2P packets are sent on their own P2P port with a small header: the
+ * id of the origin, a sequence number, the remaining number of hops (TTL), the
+ * number of hops so far, the P2P port of the payload and the time the origin
+ * sent it, in swarm time (see radiolinkP2PSharedTimeUs()). Every drone that receives a relayed packet for the first time
+ * delivers it to the P2P callback as a regular P2P packet on the payload port,
+ * and rebroadcasts it in its own TDMA slot if the TTL allows. Duplicates are
+ * recognized by the origin and sequence number.
+ */
+
+#define P2P_RELAY_PORT 13
+
+typedef struct {
+  uint8_t origin;   // P2P id of the sender
+  uint8_t seq;      // Sequence number, per origin
+  uint8_t ttl;      // Number of hops left, the packet is not rebroadcast when it reaches 1
+  uint8_t hops;     // Number of rebroadcasts so far
+  uint8_t port;     // P2P port of the payload
+  uint8_t flags;    // P2P_RELAY_FLAG_*
+  uint16_t sentMs;  // Lower 16 bits of the shared time when the origin sent the packet [ms]
+} __attribute__((packed)) p2pRelayHeader_t;
+
+// sentMs is in swarm time, the origin had a time base. Otherwise it is the local time of the origin.
+#define P2P_RELAY_FLAG_SHARED_TIME 0x01
+
+#define P2P_RELAY_MAX_DATA_SIZE (P2P_MAX_DATA_SIZE - sizeof(p2pRelayHeader_t))
+
+void p2pRelayInit(void);
+
+/**
+ * Broadcast a P2P packet that is relayed by the other drones.
+ *
+ * @param p2pp The packet, port, size and data are used. The size must be at most P2P_RELAY_MAX_DATA_SIZE.
+ * @param ttl The maximum number of times the packet is sent, 1 is a regular single hop broadcast
+ * @return false if the packet could not be queued
+ */
+bool p2pRelaySendBroadcast(const P2PPacket *p2pp, uint8_t ttl);
+
+/**
+ * Handle a received P2P packet, called by the radio link before the packet is
+ * delivered. A relayed packet is replaced in place by the payload and its port.
+ *
+ * @param p2pp The received packet
+ * @return false if the packet is a duplicate or our own and must not be delivered
+ */
+bool p2pRelayHandleReceived(P2PPacket *p2pp);
@@ -59,5 +59,54 @@ struct crtpLinkOperations * radiolinkGetLink();
 bool radiolinkSendP2PPacketBroadcast(P2PPacket *p2pp);
 void p2pRegisterCB(P2PCallback cb);
 
+/**
+ * Align the time base of the P2P broadcast slots (CONFIG_RADIO_P2P_TDMA) to
+ * a time shared by the swarm. The localization service sets it to the swarm
+ * time broadcasted by the client (see swarmTime.h) at every received time
+ * stamp, once the swarm time is synchronized. Without it the local clock is
+ * used, the broadcast rate is still paced but slots of different drones may
+ * overlap.
+ *
+ * @param sharedTimeUs The shared time, in us, at the time of the call
+ */
+void radiolinkP2PSetTimeBase(uint64_t sharedTimeUs);
+
+/**
+ * The time shared by the swarm, see radiolinkP2PSetTimeBase(). The local
+ * clock until a time base is set.
+ *
+ * @return The shared time, in us
+ */
+uint64_t radiolinkP2PSharedTimeUs(void);
+
+/**
+ * Check if the shared time is a time base common to the swarm, that is if
+ * radiolinkP2PSetTimeBase() has been called within the last 30 s.
+ */
+bool radiolinkP2PHasTimeBase(void);
+
+/**
+ * Time until the start of the next own P2P slot (CONFIG_RADIO_P2P_TDMA), 0
+ * without TDMA.
+ *
+ * @return The time, in us
+ */
+uint32_t radiolinkP2PTimeToSlotUs(void);
+
+/**
+ * The P2P id of this drone, selecting the TDMA slot. Defaults to the last
+ * byte of the radio address.
+ */
+uint8_t radiolinkP2PGetId(void);
+
+/**
+ * Enable or disable aggregation of small CRTP packets into one radio frame.
+ * Aggregation is negotiated by the client and is disabled again when the
+ * radio connection is lost.
+ *
+ * @return true if aggregation is enabled
+ */
+bool radiolinkSetAggregation(bool enable);
+
 
 #endif //__RADIO_H__
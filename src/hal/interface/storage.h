@@ -50,8 +50,14 @@ bool storageTest();
  * Store a buffer in a key. If the key already exist in the table,
  * it will be replaced.
  *
- * This function can take a lot of time to complete: if there is no space for the new buffer,
- * the memory is going to be defragmented before the new buffer is written.
+ * Small buffers are written to a RAM cache and written to the memory later from a
+ * background task, repeated stores to the same key are only written once. Use
+ * storageFlush() to make sure they are in memory. Write errors of cached buffers are
+ * reported by storageFlush().
+ *
+ * Other buffers are written directly. This can take a lot of time to complete: if there
+ * is no space for the new buffer, the memory is going to be defragmented before the new
+ * buffer is written.
  *
  * This function can fail either if there is no place left in memory or if the memory
  * is corrupted.
@@ -64,6 +70,15 @@ bool storageTest();
  */
 bool storageStore(const char* key, const void* buffer, size_t length);
 
+/**
+ * Write all cached buffers to the memory.
+ *
+ * Also done on graceful shutdown.
+ *
+ * @return true if all buffers were written, false otherwise.
+ */
+bool storageFlush();
+
 /**
  * Fetch a buffer from the memory at some key.
  *
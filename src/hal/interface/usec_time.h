@@ -26,6 +26,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Initialize microsecond-resolution timer (TIM1).
@@ -41,3 +42,12 @@ void usecTimerReset(void);
  * Get microsecond-resolution timestamp.
  */
 uint64_t usecTimestamp(void);
+
+/**
+ * Block the calling task for at least us microseconds, it is woken up by a
+ * hardware timer interrupt. The timer serves one task at the time.
+ *
+ * @return false if nothing was waited, when called from an interrupt, before the
+ *         scheduler runs or while another task sleeps.
+ */
+bool usecTimerSleep(uint32_t us);
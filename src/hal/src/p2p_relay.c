@@ -0,0 +1,339 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * p2p_relay.c - Multi-hop relay of P2P broadcasts
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "p2p_relay.h"
+#include "autoconf.h"
+#include "log.h"
+#include "param.h"
+
+// Max number of rebroadcasts per second, and the burst that is allowed
+#ifdef CONFIG_RADIO_P2P_RELAY_RATE
+#define RELAY_RATE CONFIG_RADIO_P2P_RELAY_RATE
+#else
+#define RELAY_RATE 20
+#endif
+
+#ifdef CONFIG_RADIO_P2P_TDMA_PACKETS_PER_SLOT
+#define RELAY_BURST CONFIG_RADIO_P2P_TDMA_PACKETS_PER_SLOT
+#else
+#define RELAY_BURST 2
+#endif
+
+// Number of recently seen packets that are remembered for duplicate suppression
+#ifdef CONFIG_RADIO_P2P_RELAY_CACHE_SIZE
+#define RELAY_CACHE_SIZE CONFIG_RADIO_P2P_RELAY_CACHE_SIZE
+#else
+#define RELAY_CACHE_SIZE 16
+#endif
+
+// Number of origins that the delivery ratio is tracked for
+#define RELAY_MAX_ORIGINS 8
+
+#define RELAY_FILTER_ALPHA 0.1f
+
+typedef struct {
+  uint8_t origin;
+  uint8_t seq;
+} relayKey_t;
+
+typedef struct {
+  uint8_t origin;
+  uint8_t lastSeq;
+  bool isUsed;
+} relayOrigin_t;
+
+static relayKey_t seenCache[RELAY_CACHE_SIZE];
+static uint8_t seenCount;
+static uint8_t seenNext;
+
+static relayOrigin_t origins[RELAY_MAX_ORIGINS];
+static uint8_t originNext;
+
+static uint8_t txSeq;
+static uint8_t relayEnable = 1;
+
+static float tokens;
+static uint32_t tokensUpdatedMs;
+
+static uint32_t rxCount;
+static uint32_t expectedCount;
+static uint32_t duplicateCount;
+static uint32_t forwardCount;
+static uint32_t forwardDropCount;
+// Low pass filtered over the received packets
+static float deliveryRatio;
+static float hopsAverage;
+static float latencyAverage;
+static uint32_t latencyUnknownCount;
+
+void p2pRelayInit(void)
+{
+  memset(seenCache, 0, sizeof(seenCache));
+  seenCount = 0;
+  seenNext = 0;
+  memset(origins, 0, sizeof(origins));
+  originNext = 0;
+
+  tokens = RELAY_BURST;
+  tokensUpdatedMs = T2M(xTaskGetTickCount());
+
+  rxCount = 0;
+  expectedCount = 0;
+  duplicateCount = 0;
+  forwardCount = 0;
+  forwardDropCount = 0;
+  latencyUnknownCount = 0;
+  deliveryRatio = 100.0f;
+  hopsAverage = 0.0f;
+  latencyAverage = 0.0f;
+}
+
+static void wrap(P2PPacket *dest, const p2pRelayHeader_t *header, const uint8_t *data, const uint8_t size)
+{
+  dest->port = P2P_RELAY_PORT;
+  dest->size = sizeof(p2pRelayHeader_t) + size;
+  memcpy(dest->data, header, sizeof(p2pRelayHeader_t));
+  memcpy(dest->data + sizeof(p2pRelayHeader_t), data, size);
+}
+
+bool p2pRelaySendBroadcast(const P2PPacket *p2pp, uint8_t ttl)
+{
+  if (p2pp->size > P2P_RELAY_MAX_DATA_SIZE) {
+    return false;
+  }
+
+  const p2pRelayHeader_t header = {
+    .origin = radiolinkP2PGetId(),
+    .seq = __atomic_fetch_add(&txSeq, 1, __ATOMIC_RELAXED),
+    .ttl = ttl > 0 ? ttl : 1,
+    .hops = 0,
+    .port = p2pp->port,
+    .flags = radiolinkP2PHasTimeBase() ? P2P_RELAY_FLAG_SHARED_TIME : 0,
+    .sentMs = (uint16_t)(radiolinkP2PSharedTimeUs() / 1000),
+  };
+
+  P2PPacket relayed;
+  wrap(&relayed, &header, p2pp->data, p2pp->size);
+  return radiolinkSendP2PPacketBroadcast(&relayed);
+}
+
+static bool isSeen(const uint8_t origin, const uint8_t seq)
+{
+  for (int i = 0; i < seenCount; i++) {
+    if (seenCache[i].origin == origin && seenCache[i].seq == seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void markSeen(const uint8_t origin, const uint8_t seq)
+{
+  seenCache[seenNext].origin = origin;
+  seenCache[seenNext].seq = seq;
+  seenNext = (seenNext + 1) % RELAY_CACHE_SIZE;
+  if (seenCount < RELAY_CACHE_SIZE) {
+    seenCount++;
+  }
+}
+
+// The delivery ratio is the share of the sequence numbers of an origin that is received
+static void updateDelivery(const uint8_t origin, const uint8_t seq)
+{
+  relayOrigin_t *entry = 0;
+  for (int i = 0; i < RELAY_MAX_ORIGINS; i++) {
+    if (origins[i].isUsed && origins[i].origin == origin) {
+      entry = &origins[i];
+    }
+  }
+
+  rxCount++;
+  if (!entry) {
+    entry = &origins[originNext];
+    originNext = (originNext + 1) % RELAY_MAX_ORIGINS;
+    entry->origin = origin;
+    entry->lastSeq = seq;
+    entry->isUsed = true;
+    expectedCount++;
+  } else {
+    // Packets that arrive out of order are received but not expected again
+    const uint8_t advance = seq - entry->lastSeq;
+    if (advance > 0 && advance < 128) {
+      expectedCount += advance;
+      entry->lastSeq = seq;
+      deliveryRatio += RELAY_FILTER_ALPHA * (100.0f / advance - deliveryRatio);
+    }
+  }
+}
+
+// The latency is only known when both the origin and this drone follow the swarm time
+static void updateLatency(const p2pRelayHeader_t *header)
+{
+  if (!(header->flags & P2P_RELAY_FLAG_SHARED_TIME) || !radiolinkP2PHasTimeBase()) {
+    latencyUnknownCount++;
+    return;
+  }
+
+  const uint16_t nowMs = (uint16_t)(radiolinkP2PSharedTimeUs() / 1000);
+  const int16_t latencyMs = (int16_t)(nowMs - header->sentMs);
+  if (latencyMs < 0) {
+    // Clocks that are not synchronized yet
+    latencyUnknownCount++;
+    return;
+  }
+  latencyAverage += RELAY_FILTER_ALPHA * (latencyMs - latencyAverage);
+}
+
+static bool takeToken(void)
+{
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+  tokens += (nowMs - tokensUpdatedMs) * RELAY_RATE / 1000.0f;
+  tokensUpdatedMs = nowMs;
+  if (tokens > RELAY_BURST) {
+    tokens = RELAY_BURST;
+  }
+
+  if (tokens < 1.0f) {
+    return false;
+  }
+  tokens -= 1.0f;
+  return true;
+}
+
+static void forward(const p2pRelayHeader_t *received, const uint8_t *data, const uint8_t size)
+{
+  if (!takeToken()) {
+    forwardDropCount++;
+    return;
+  }
+
+  // The send time of the origin is kept, the latency is measured end to end by the receivers
+  p2pRelayHeader_t header = *received;
+  header.ttl--;
+  header.hops++;
+
+  P2PPacket relayed;
+  wrap(&relayed, &header, data, size);
+  if (radiolinkSendP2PPacketBroadcast(&relayed)) {
+    forwardCount++;
+  } else {
+    forwardDropCount++;
+  }
+}
+
+bool p2pRelayHandleReceived(P2PPacket *p2pp)
+{
+  if (p2pp->port != P2P_RELAY_PORT) {
+    return true;
+  }
+
+  if (p2pp->size < sizeof(p2pRelayHeader_t)) {
+    return false;
+  }
+
+  p2pRelayHeader_t header;
+  memcpy(&header, p2pp->data, sizeof(header));
+  const uint8_t size = p2pp->size - sizeof(header);
+
+  // Our own packets come back from the relays
+  if (header.origin == radiolinkP2PGetId() || isSeen(header.origin, header.seq)) {
+    duplicateCount++;
+    return false;
+  }
+  markSeen(header.origin, header.seq);
+
+  updateDelivery(header.origin, header.seq);
+  hopsAverage += RELAY_FILTER_ALPHA * (header.hops - hopsAverage);
+  updateLatency(&header);
+
+  if (relayEnable && header.ttl > 1) {
+    forward(&header, p2pp->data + sizeof(header), size);
+  }
+
+  // Delivered as a regular P2P packet on the port of the payload
+  memmove(p2pp->data, p2pp->data + sizeof(header), size);
+  p2pp->size = size;
+  p2pp->port = header.port;
+  return true;
+}
+
+/**
+ * Multi-hop relay of P2P broadcasts
+ */
+LOG_GROUP_START(p2pRelay)
+/**
+ * @brief Number of relayed packets received, duplicates excluded
+ */
+LOG_ADD(LOG_UINT32, rx, &rxCount)
+/**
+ * @brief Number of relayed packets expected from the sequence numbers of the origins
+ */
+LOG_ADD(LOG_UINT32, expected, &expectedCount)
+/**
+ * @brief Number of duplicates and own packets that were dropped
+ */
+LOG_ADD(LOG_UINT32, dup, &duplicateCount)
+/**
+ * @brief Number of packets rebroadcast
+ */
+LOG_ADD(LOG_UINT32, fwd, &forwardCount)
+/**
+ * @brief Number of packets not rebroadcast due to the rate limit or a full queue
+ */
+LOG_ADD(LOG_UINT32, fwdDrop, &forwardDropCount)
+/**
+ * @brief Share of the packets of the origins that is received, low pass filtered [%]
+ */
+LOG_ADD(LOG_FLOAT, delivery, &deliveryRatio)
+/**
+ * @brief Number of rebroadcasts of the received packets, low pass filtered
+ */
+LOG_ADD(LOG_FLOAT, hops, &hopsAverage)
+/**
+ * @brief Time from the origin to this drone for the received packets, in swarm time, low pass filtered [ms]
+ */
+LOG_ADD(LOG_FLOAT, latency, &latencyAverage)
+/**
+ * @brief Number of received packets without a known latency, the origin or this drone has no swarm time
+ */
+LOG_ADD(LOG_UINT32, latUnknown, &latencyUnknownCount)
+LOG_GROUP_STOP(p2pRelay)
+
+/**
+ * Multi-hop relay of P2P broadcasts
+ */
+PARAM_GROUP_START(p2pRelay)
+/**
+ * @brief Nonzero to rebroadcast the relayed packets of other drones (default: 1)
+ */
+PARAM_ADD(PARAM_UINT8, enable, &relayEnable)
+PARAM_GROUP_STOP(p2pRelay)
@@ -55,27 +55,15 @@ bool pca95x4ConfigOutput(uint8_t devAddr, uint32_t val) {
   bool pass;
 
   pass = i2cdevWriteByte(I2Cx, devAddr, PCA95X4_CONFIG_REG, val);
+  // The outputs are only changed by us
+  i2cdevShadowEnable(I2Cx, devAddr, PCA95X4_OUTPUT_REG);
   return pass;
 }
 
 bool pca95x4SetOutput(uint8_t devAddr, uint32_t mask) {
-  uint8_t val;
-  bool pass;
-
-  pass = i2cdevReadByte(I2Cx, devAddr, PCA95X4_OUTPUT_REG, &val);
-  val |= mask;
-  pass = i2cdevWriteByte(I2Cx, devAddr, PCA95X4_OUTPUT_REG, val);
-
-  return pass;
+  return i2cdevWriteMasked(I2Cx, devAddr, PCA95X4_OUTPUT_REG, mask, 0xFF);
 }
 
 bool pca95x4ClearOutput(uint8_t devAddr, uint32_t mask) {
-  uint8_t val;
-  bool pass;
-
-  pass = i2cdevReadByte(I2Cx, devAddr, PCA95X4_OUTPUT_REG, &val);
-  val &= ~mask;
-  pass = i2cdevWriteByte(I2Cx, devAddr, PCA95X4_OUTPUT_REG, val);
-
-  return pass;
+  return i2cdevWriteMasked(I2Cx, devAddr, PCA95X4_OUTPUT_REG, mask, 0x00);
 }
@@ -196,6 +196,12 @@ static int32_t pmBatteryChargeFromVoltage(float voltage)
 
 float pmGetBatteryVoltage(void)
 {
+  // The external battery voltage is scanned in the background, reading it is cheap and gives the latest value
+  if (isExtBatVoltDeckPinSet)
+  {
+    return pmMeasureExtBatteryVoltage();
+  }
+
   return batteryVoltage;
 }
 
@@ -274,7 +280,7 @@ void pmSyslinkUpdate(SyslinkPacket *slp)
     // If using voltage measurements from external battery, we'll set the
     // voltage to this instead of the one sent from syslink.
     if (isExtBatVoltDeckPinSet) {
-      pmSetBatteryVoltage(extBatteryVoltage);
+      pmSetBatteryVoltage(pmMeasureExtBatteryVoltage());
     } else {
       pmSetBatteryVoltage(pmSyslinkInfo.vBat);
     }
@@ -283,7 +289,8 @@ void pmSyslinkUpdate(SyslinkPacket *slp)
     temp = pmSyslinkInfo.temp;
 #endif
   } else if (slp->type == SYSLINK_PM_SHUTDOWN_REQUEST) {
-    workerSchedule(pmGracefulShutdown, NULL);
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_HIGH, .coalesce = true};
+    workerScheduleWithOptions(pmGracefulShutdown, NULL, &options);
   }
 }
 
@@ -330,6 +337,7 @@ PMStates pmUpdateState()
 void pmEnableExtBatteryCurrMeasuring(const deckPin_t pin, float ampPerVolt)
 {
   extBatCurrDeckPin = pin;
+  analogScanEnable(pin);
   isExtBatCurrDeckPinSet = true;
   extBatCurrAmpPerVolt = ampPerVolt;
 }
@@ -340,7 +348,7 @@ float pmMeasureExtBatteryCurrent(void)
 
   if (isExtBatCurrDeckPinSet)
   {
-    current = analogReadVoltage(extBatCurrDeckPin) * extBatCurrAmpPerVolt;
+    current = analogScanReadVoltage(extBatCurrDeckPin) * extBatCurrAmpPerVolt;
   }
   else
   {
@@ -353,6 +361,7 @@ float pmMeasureExtBatteryCurrent(void)
 void pmEnableExtBatteryVoltMeasuring(const deckPin_t pin, float multiplier)
 {
   extBatVoltDeckPin = pin;
+  analogScanEnable(pin);
   isExtBatVoltDeckPinSet = true;
   extBatVoltMultiplier = multiplier;
 }
@@ -363,7 +372,7 @@ float pmMeasureExtBatteryVoltage(void)
 
   if (isExtBatVoltDeckPinSet)
   {
-    voltage = analogReadVoltage(extBatVoltDeckPin) * extBatVoltMultiplier;
+    voltage = analogScanReadVoltage(extBatVoltDeckPin) * extBatVoltMultiplier;
   }
   else
   {
@@ -42,15 +42,37 @@
 #include "led.h"
 #include "ledseq.h"
 #include "queuemonitor.h"
+#include "queuestats.h"
 #include "static_mem.h"
 #include "cfassert.h"
-
-#define RADIOLINK_TX_QUEUE_SIZE (1)
+#include "param.h"
+#include "usec_time.h"
+#include "system.h"
+#include "worker.h"
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+#include "peer_localization.h"
+#endif
+#ifdef CONFIG_RADIO_P2P_RELAY
+#include "p2p_relay.h"
+#endif
+
+// A few packets are buffered so that they can be aggregated into one radio frame
+#define RADIOLINK_TX_QUEUE_SIZE (3)
 #define RADIOLINK_CRTP_QUEUE_SIZE (5)
 #define RADIO_ACTIVITY_TIMEOUT_MS (1000)
 
 #define RADIOLINK_P2P_QUEUE_SIZE (5)
 
+/*
+ * Aggregated frames use the null packet header (port 15, channel 3), that
+ * clients without aggregation support drop, followed by a marker byte.
+ * The rest of the frame is a sequence of sub-packets: [size][header][data...]
+ * where size is the CRTP data size of the sub-packet.
+ */
+#define RADIOLINK_AGGREGATION_HEADER CRTP_HEADER(CRTP_PORT_LINK, 3)
+#define RADIOLINK_AGGREGATION_MARKER 0x41
+#define RADIOLINK_AGGREGATION_SUB_HEADER_SIZE 1
+
 static xQueueHandle  txQueue;
 STATIC_MEM_QUEUE_ALLOC(txQueue, RADIOLINK_TX_QUEUE_SIZE, sizeof(SyslinkPacket));
 
@@ -69,9 +91,273 @@ static bool isConnected;
 static uint32_t lastPacketTick;
 static uint16_t count_rx_broadcast;
 static uint16_t count_rx_unicast;
+static bool aggregationEnabled;
+static uint16_t count_tx_aggregated;
 
 static volatile P2PCallback p2p_callback;
 
+static bool radiolinkSendP2PPacketNow(P2PPacket *p);
+
+// Offset from the local clock to the time shared by the swarm. 64 bit accesses are not atomic, the offset is only
+// accessed in critical sections.
+static int64_t p2pTimeOffset;
+static uint64_t p2pTimeBaseSetUs;
+static bool p2pIsTimeBaseSet;
+
+// Same as the max age of the swarm time, see swarmTime.h
+#define P2P_TIME_BASE_MAX_AGE_US (30 * 1000 * 1000)
+
+void radiolinkP2PSetTimeBase(uint64_t sharedTimeUs)
+{
+  const uint64_t nowUs = usecTimestamp();
+  const int64_t offset = (int64_t)sharedTimeUs - (int64_t)nowUs;
+
+  taskENTER_CRITICAL();
+  p2pTimeOffset = offset;
+  p2pTimeBaseSetUs = nowUs;
+  p2pIsTimeBaseSet = true;
+  taskEXIT_CRITICAL();
+}
+
+bool radiolinkP2PHasTimeBase(void)
+{
+  taskENTER_CRITICAL();
+  const bool isSet = p2pIsTimeBaseSet;
+  const uint64_t setUs = p2pTimeBaseSetUs;
+  taskEXIT_CRITICAL();
+
+  return isSet && (usecTimestamp() - setUs) < P2P_TIME_BASE_MAX_AGE_US;
+}
+
+uint64_t radiolinkP2PSharedTimeUs(void)
+{
+  taskENTER_CRITICAL();
+  const int64_t offset = p2pTimeOffset;
+  taskEXIT_CRITICAL();
+
+  return usecTimestamp() + offset;
+}
+
+#ifdef CONFIG_RADIO_P2P_TDMA
+/*
+ * P2P broadcasts are queued and sent in the slot of this drone. A frame is
+ * tdmaSlots slots of tdmaSlotMs each and the slot is selected by tdmaId.
+ */
+static xQueueHandle p2pTxQueue;
+STATIC_MEM_QUEUE_ALLOC(p2pTxQueue, RADIOLINK_P2P_QUEUE_SIZE, sizeof(P2PPacket));
+STATIC_MEM_TASK_ALLOC(p2pTdmaTask, P2P_TDMA_TASK_STACKSIZE);
+
+static uint8_t tdmaId;
+static uint8_t tdmaSlots = CONFIG_RADIO_P2P_TDMA_SLOTS;
+static uint8_t tdmaSlotMs = CONFIG_RADIO_P2P_TDMA_SLOT_MS;
+static volatile bool tdmaInOwnSlot;
+
+static uint32_t tdmaQueueDrops;
+static uint32_t tdmaRxInOwnSlot;
+// Low pass filtered over slots, in percent
+static float tdmaUtilization;
+static float tdmaCollisionEstimate;
+
+#define TDMA_FILTER_ALPHA 0.1f
+
+// Parameters may change at any time
+static uint8_t tdmaSlotLengthMs(void)
+{
+  return tdmaSlotMs > 1 ? tdmaSlotMs : 2;
+}
+
+uint32_t radiolinkP2PTimeToSlotUs(void)
+{
+  const uint8_t slots = tdmaSlots > 1 ? tdmaSlots : 2;
+  const uint64_t slotUs = tdmaSlotLengthMs() * 1000;
+  const uint64_t frameUs = slots * slotUs;
+  const uint64_t slotStart = (tdmaId % slots) * slotUs;
+
+  const uint64_t framePos = radiolinkP2PSharedTimeUs() % frameUs;
+  return (slotStart + frameUs - framePos) % frameUs;
+}
+
+uint8_t radiolinkP2PGetId(void)
+{
+  return tdmaId;
+}
+
+static void p2pTdmaTask(void *param)
+{
+  P2PPacket p2pp;
+
+  systemWaitStart();
+
+  while (1)
+  {
+    const uint8_t slotMs = tdmaSlotLengthMs();
+
+    // Wait for the start of the slot, rounded up to the next tick
+    const uint32_t waitUs = radiolinkP2PTimeToSlotUs();
+    vTaskDelay(M2T((waitUs + 999) / 1000));
+
+    tdmaInOwnSlot = true;
+    const uint32_t rxInSlotBefore = tdmaRxInOwnSlot;
+
+    int sent = 0;
+    while (sent < CONFIG_RADIO_P2P_TDMA_PACKETS_PER_SLOT && xQueueReceive(p2pTxQueue, &p2pp, 0) == pdTRUE)
+    {
+      radiolinkSendP2PPacketNow(&p2pp);
+      sent++;
+    }
+
+    // Stay in the slot until it ends, the first ms is already used by the rounding above
+    vTaskDelay(M2T(slotMs - 1));
+    tdmaInOwnSlot = false;
+
+    const float utilization = 100.0f * sent / CONFIG_RADIO_P2P_TDMA_PACKETS_PER_SLOT;
+    const float collision = tdmaRxInOwnSlot != rxInSlotBefore ? 100.0f : 0.0f;
+    tdmaUtilization += TDMA_FILTER_ALPHA * (utilization - tdmaUtilization);
+    tdmaCollisionEstimate += TDMA_FILTER_ALPHA * (collision - tdmaCollisionEstimate);
+  }
+}
+#else
+uint32_t radiolinkP2PTimeToSlotUs(void)
+{
+  return 0;
+}
+
+uint8_t radiolinkP2PGetId(void)
+{
+  return configblockGetRadioAddress() & 0xFF;
+}
+#endif
+
+#ifdef CONFIG_RADIO_CHANNEL_HOP
+/*
+ * Channel hopping over a hop sequence agreed with the ground, set with the
+ * hop.chN/hop.drN params. The ground requests a hop by writing the entry to
+ * hop.next, the hop is done hop.delayMs later so that the answer is still
+ * sent on the old channel. If no packet is received for hop.scanMs the
+ * sequence is scanned, hop.scanMs on each entry, until the ground is found.
+ *
+ * The quality of each entry is monitored while it is used. The Crazyflie is
+ * the receiving side of the link and does not see the lost acks, the ground
+ * keeps polling so a lower rate of received packets shows the losses.
+ */
+#define HOP_MAX_ENTRIES 4
+#define HOP_MONITOR_PERIOD_MS 100
+#define HOP_FILTER_ALPHA 0.2f
+#define HOP_NONE 0xFF
+
+typedef struct {
+  float rssi;
+  float rxRate;
+  float throughput;
+} hopQuality_t;
+
+static uint8_t hopLength;
+static uint8_t hopChannels[HOP_MAX_ENTRIES];
+static uint8_t hopDatarates[HOP_MAX_ENTRIES];
+static uint8_t hopNext = HOP_NONE;
+static uint16_t hopDelayMs = 20;
+static uint16_t hopScanMs = 500;
+
+static uint8_t hopIndex = HOP_NONE;
+static uint8_t hopHomeChannel;
+static uint8_t hopHomeDatarate;
+static uint32_t hopAt;
+static uint8_t hopPendingIndex;
+static bool hopIsPending;
+static uint32_t hopLastMoveTick;
+static uint32_t hopCount;
+static uint32_t hopScanCount;
+static hopQuality_t hopQuality[HOP_MAX_ENTRIES];
+
+static uint32_t count_rx_bytes;
+static uint32_t count_tx_bytes;
+
+static void hopTo(const uint8_t index)
+{
+  radiolinkSetChannel(hopChannels[index]);
+  radiolinkSetDatarate(hopDatarates[index]);
+
+  hopIndex = index;
+  hopLastMoveTick = xTaskGetTickCount();
+  hopCount++;
+}
+
+static void hopRequest(void)
+{
+  if (hopNext < hopLength && hopNext < HOP_MAX_ENTRIES) {
+    hopPendingIndex = hopNext;
+    hopAt = xTaskGetTickCount() + M2T(hopDelayMs);
+    hopIsPending = true;
+  }
+  hopNext = HOP_NONE;
+}
+
+// The entry in use, the radio starts on the channel of the config block
+static uint8_t hopFindIndex(void)
+{
+  for (int i = 0; i < hopLength && i < HOP_MAX_ENTRIES; i++) {
+    if (hopChannels[i] == hopHomeChannel && hopDatarates[i] == hopHomeDatarate) {
+      return i;
+    }
+  }
+
+  return HOP_NONE;
+}
+
+static void hopMonitor(void *arg)
+{
+  static uint16_t lastRxCount;
+  static uint32_t lastBytes;
+
+  const uint32_t now = xTaskGetTickCount();
+  const uint16_t rxCount = count_rx_unicast;
+  const uint32_t bytes = count_rx_bytes + count_tx_bytes;
+  const float dt = HOP_MONITOR_PERIOD_MS / 1000.0f;
+
+  if (hopIndex == HOP_NONE) {
+    hopIndex = hopFindIndex();
+  }
+
+  if (hopIndex < HOP_MAX_ENTRIES) {
+    hopQuality_t* quality = &hopQuality[hopIndex];
+    const uint16_t received = rxCount - lastRxCount;
+    quality->rxRate += HOP_FILTER_ALPHA * (received / dt - quality->rxRate);
+    quality->throughput += HOP_FILTER_ALPHA * ((bytes - lastBytes) / dt - quality->throughput);
+    // The RSSI is only fresh when packets are received
+    if (received > 0) {
+      quality->rssi += HOP_FILTER_ALPHA * (rssi - quality->rssi);
+    }
+  }
+  lastRxCount = rxCount;
+  lastBytes = bytes;
+
+  if (hopIsPending && (int32_t)(now - hopAt) >= 0) {
+    hopIsPending = false;
+    hopTo(hopPendingIndex);
+    return;
+  }
+
+  // Lost link, look for the ground on the other entries
+  const bool isScanEnabled = hopScanMs > 0 && hopLength >= 2;
+  if (isScanEnabled && lastPacketTick != 0 &&
+      (now - lastPacketTick) >= M2T(hopScanMs) && (now - hopLastMoveTick) >= M2T(hopScanMs)) {
+    const uint8_t length = hopLength < HOP_MAX_ENTRIES ? hopLength : HOP_MAX_ENTRIES;
+    const uint8_t next = hopIndex < length ? (hopIndex + 1) % length : 0;
+    hopTo(next);
+    hopScanCount++;
+  }
+}
+
+static void hopInit(void)
+{
+  hopHomeChannel = configblockGetRadioChannel();
+  hopHomeDatarate = configblockGetRadioSpeed();
+
+  const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .periodMs = HOP_MONITOR_PERIOD_MS};
+  workerScheduleWithOptions(hopMonitor, NULL, &options);
+}
+#endif
+
 static bool radiolinkIsConnected(void) {
   return (xTaskGetTickCount() - lastPacketTick) < M2T(RADIO_ACTIVITY_TIMEOUT_MS);
 }
@@ -91,6 +377,7 @@ void radiolinkInit(void)
 
   txQueue = STATIC_MEM_QUEUE_CREATE(txQueue);
   DEBUG_QUEUE_MONITOR_REGISTER(txQueue);
+  queueStatsRegister(txQueue, queueStatsRadioTx);
   crtpPacketDelivery = STATIC_MEM_QUEUE_CREATE(crtpPacketDelivery);
   DEBUG_QUEUE_MONITOR_REGISTER(crtpPacketDelivery);
 
@@ -102,6 +389,20 @@ void radiolinkInit(void)
   radiolinkSetDatarate(configblockGetRadioSpeed());
   radiolinkSetAddress(configblockGetRadioAddress());
 
+#ifdef CONFIG_RADIO_P2P_TDMA
+  tdmaId = configblockGetRadioAddress() & 0xFF;
+  p2pTxQueue = STATIC_MEM_QUEUE_CREATE(p2pTxQueue);
+  DEBUG_QUEUE_MONITOR_REGISTER(p2pTxQueue);
+  STATIC_MEM_TASK_CREATE(p2pTdmaTask, p2pTdmaTask, P2P_TDMA_TASK_NAME, NULL, P2P_TDMA_TASK_PRI);
+#endif
+#ifdef CONFIG_RADIO_P2P_RELAY
+  p2pRelayInit();
+#endif
+
+#ifdef CONFIG_RADIO_CHANNEL_HOP
+  hopInit();
+#endif
+
   isInit = true;
 }
 
@@ -151,11 +452,70 @@ void radiolinkSetPowerDbm(int8_t powerDbm)
 }
 
 
+bool radiolinkSetAggregation(bool enable)
+{
+  aggregationEnabled = enable;
+  return aggregationEnabled;
+}
+
+static void appendSubPacket(SyslinkPacket *frame, const SyslinkPacket *slp)
+{
+  // slp->data holds the CRTP header followed by the CRTP data
+  frame->data[frame->length] = slp->length - 1;
+  memcpy(&frame->data[frame->length + RADIOLINK_AGGREGATION_SUB_HEADER_SIZE], slp->data, slp->length);
+  frame->length += RADIOLINK_AGGREGATION_SUB_HEADER_SIZE + slp->length;
+}
+
+static bool fitsInFrame(uint8_t frameLength, const SyslinkPacket *slp)
+{
+  return frameLength + RADIOLINK_AGGREGATION_SUB_HEADER_SIZE + slp->length <= CRTP_MAX_DATA_SIZE + 1;
+}
+
+/**
+ * Packs the packets waiting in the TX queue into txPacket, as long as they fit
+ * in one radio frame. txPacket is left untouched if the next packet does not fit.
+ */
+static void aggregateTxPackets(SyslinkPacket *txPacket)
+{
+  static SyslinkPacket frame;
+  static SyslinkPacket next;
+
+  if (xQueuePeek(txQueue, &next, 0) != pdTRUE)
+  {
+    return;
+  }
+
+  frame.type = SYSLINK_RADIO_RAW;
+  frame.data[0] = RADIOLINK_AGGREGATION_HEADER;
+  frame.data[1] = RADIOLINK_AGGREGATION_MARKER;
+  frame.length = 2;
+
+  if (!fitsInFrame(frame.length, txPacket) ||
+      !fitsInFrame(frame.length + RADIOLINK_AGGREGATION_SUB_HEADER_SIZE + txPacket->length, &next))
+  {
+    return;
+  }
+
+  appendSubPacket(&frame, txPacket);
+  while (xQueuePeek(txQueue, &next, 0) == pdTRUE && fitsInFrame(frame.length, &next))
+  {
+    xQueueReceive(txQueue, &next, 0);
+    appendSubPacket(&frame, &next);
+    count_tx_aggregated++;
+  }
+
+  memcpy(txPacket, &frame, sizeof(SyslinkPacket));
+}
+
 void radiolinkSyslinkDispatch(SyslinkPacket *slp)
 {
   static SyslinkPacket txPacket;
 
   if (slp->type == SYSLINK_RADIO_RAW || slp->type == SYSLINK_RADIO_RAW_BROADCAST) {
+    if (!radiolinkIsConnected()) {
+      // A new connection must negotiate aggregation again
+      aggregationEnabled = false;
+    }
     lastPacketTick = xTaskGetTickCount();
   }
 
@@ -165,11 +525,21 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
     // Assert that we are not dropping any packets
     ASSERT(xQueueSend(crtpPacketDelivery, &slp->length, 0) == pdPASS);
     ++count_rx_unicast;
+#ifdef CONFIG_RADIO_CHANNEL_HOP
+    count_rx_bytes += slp->length;
+#endif
     ledseqRun(&seq_linkUp);
     // If a radio packet is received, one can be sent
     if (xQueueReceive(txQueue, &txPacket, 0) == pdTRUE)
     {
+      if (aggregationEnabled)
+      {
+        aggregateTxPackets(&txPacket);
+      }
       ledseqRun(&seq_linkDown);
+#ifdef CONFIG_RADIO_CHANNEL_HOP
+      count_tx_bytes += txPacket.length - 1;
+#endif
       syslinkSendPacket(&txPacket);
     }
   } else if (slp->type == SYSLINK_RADIO_RAW_BROADCAST)
@@ -190,6 +560,12 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
   } else if (slp->type == SYSLINK_RADIO_P2P_BROADCAST)
   {
     ledseqRun(&seq_linkUp);
+#ifdef CONFIG_RADIO_P2P_TDMA
+    if (tdmaInOwnSlot) {
+      // Someone else is transmitting in our slot
+      tdmaRxInOwnSlot++;
+    }
+#endif
     P2PPacket p2pp;
     p2pp.port=slp->data[0];
     p2pp.rssi = slp->data[1];
@@ -198,6 +574,16 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
     memcpy(&p2pp.data[0], &slp->data[2], p2pDataLength);
     p2pp.size = p2pDataLength;
 
+#ifdef CONFIG_RADIO_P2P_RELAY
+    if (!p2pRelayHandleReceived(&p2pp)) {
+      // Duplicate of a relayed packet
+    } else
+#endif
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+    if (peerLocalizationHandleP2P(&p2pp)) {
+      // Peer state, handled by the peer localization
+    } else
+#endif
     if (p2p_callback) {
         p2p_callback(&p2pp);
     }
@@ -240,6 +626,23 @@ static int radiolinkSendCRTPPacket(CRTPPacket *p)
 }
 
 bool radiolinkSendP2PPacketBroadcast(P2PPacket *p)
+{
+#ifdef CONFIG_RADIO_P2P_TDMA
+  ASSERT(p->size <= P2P_MAX_DATA_SIZE);
+
+  if (xQueueSend(p2pTxQueue, p, 0) != pdTRUE)
+  {
+    tdmaQueueDrops++;
+    return false;
+  }
+
+  return true;
+#else
+  return radiolinkSendP2PPacketNow(p);
+#endif
+}
+
+static bool radiolinkSendP2PPacketNow(P2PPacket *p)
 {
   static SyslinkPacket slp;
 
@@ -290,4 +693,178 @@ LOG_ADD_CORE(LOG_UINT16, numRxBc, &count_rx_broadcast)
  * Note that this is only 16 bits and overflows. Use overflow correction on the client side.
  */
 LOG_ADD_CORE(LOG_UINT16, numRxUc, &count_rx_unicast)
+/**
+ * @brief Number of packets sent in an aggregated radio frame, in addition to the first one.
+ *
+ * Note that this is only 16 bits and overflows. Use overflow correction on the client side.
+ */
+LOG_ADD(LOG_UINT16, numTxAgg, &count_tx_aggregated)
 LOG_GROUP_STOP(radio)
+
+#ifdef CONFIG_RADIO_P2P_TDMA
+/**
+ * Time slotted P2P broadcasts
+ */
+LOG_GROUP_START(p2pTdma)
+/**
+ * @brief Share of the packets per slot that were used, low pass filtered over slots [%]
+ */
+LOG_ADD(LOG_FLOAT, util, &tdmaUtilization)
+/**
+ * @brief Share of the own slots in which a P2P packet from another drone was received,
+ * an estimate of the collisions in the slot, low pass filtered over slots [%]
+ */
+LOG_ADD(LOG_FLOAT, collEst, &tdmaCollisionEstimate)
+/**
+ * @brief Number of P2P packets received in the own slot
+ */
+LOG_ADD(LOG_UINT32, rxInSlot, &tdmaRxInOwnSlot)
+/**
+ * @brief Number of P2P packets dropped because the queue was full
+ */
+LOG_ADD(LOG_UINT32, qDrop, &tdmaQueueDrops)
+LOG_GROUP_STOP(p2pTdma)
+
+/**
+ * Time slotted P2P broadcasts
+ */
+PARAM_GROUP_START(p2pTdma)
+/**
+ * @brief Id selecting the slot of this drone, defaults to the last byte of the radio address
+ */
+PARAM_ADD(PARAM_UINT8, id, &tdmaId)
+/**
+ * @brief Number of slots per frame, should be the same for all drones
+ */
+PARAM_ADD(PARAM_UINT8, slots, &tdmaSlots)
+/**
+ * @brief Length of a slot [ms], should be the same for all drones
+ */
+PARAM_ADD(PARAM_UINT8, slotMs, &tdmaSlotMs)
+PARAM_GROUP_STOP(p2pTdma)
+#endif
+
+#ifdef CONFIG_RADIO_CHANNEL_HOP
+/**
+ * Radio channel hopping. The hop sequence is agreed with the ground, entry N
+ * is channel chN at datarate drN (0: 250K, 1: 1M, 2: 2M).
+ */
+PARAM_GROUP_START(hop)
+/**
+ * @brief Number of entries used in the hop sequence, 0 disables hopping (default: 0)
+ */
+PARAM_ADD(PARAM_UINT8, len, &hopLength)
+/**
+ * @brief Channel of entry 0, should be the channel of the config block
+ */
+PARAM_ADD(PARAM_UINT8, ch0, &hopChannels[0])
+/**
+ * @brief Datarate of entry 0, should be the datarate of the config block
+ */
+PARAM_ADD(PARAM_UINT8, dr0, &hopDatarates[0])
+/**
+ * @brief Channel of entry 1
+ */
+PARAM_ADD(PARAM_UINT8, ch1, &hopChannels[1])
+/**
+ * @brief Datarate of entry 1
+ */
+PARAM_ADD(PARAM_UINT8, dr1, &hopDatarates[1])
+/**
+ * @brief Channel of entry 2
+ */
+PARAM_ADD(PARAM_UINT8, ch2, &hopChannels[2])
+/**
+ * @brief Datarate of entry 2
+ */
+PARAM_ADD(PARAM_UINT8, dr2, &hopDatarates[2])
+/**
+ * @brief Channel of entry 3
+ */
+PARAM_ADD(PARAM_UINT8, ch3, &hopChannels[3])
+/**
+ * @brief Datarate of entry 3
+ */
+PARAM_ADD(PARAM_UINT8, dr3, &hopDatarates[3])
+/**
+ * @brief Write an entry to hop to it after delayMs, reads back as 255
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, next, &hopNext, hopRequest)
+/**
+ * @brief Time between the hop request and the hop [ms] (default: 20)
+ */
+PARAM_ADD(PARAM_UINT16, delayMs, &hopDelayMs)
+/**
+ * @brief Time without packets before scanning the sequence, and time spent on each entry
+ * while scanning [ms], 0 disables the scan (default: 500)
+ */
+PARAM_ADD(PARAM_UINT16, scanMs, &hopScanMs)
+PARAM_GROUP_STOP(hop)
+
+/**
+ * Radio channel hopping. The quality of an entry of the hop sequence is
+ * updated while it is used, low pass filtered.
+ */
+LOG_GROUP_START(hop)
+/**
+ * @brief Entry in use, 255 if the channel is not in the sequence
+ */
+LOG_ADD(LOG_UINT8, idx, &hopIndex)
+/**
+ * @brief Number of hops, requested or scanning
+ */
+LOG_ADD(LOG_UINT32, hops, &hopCount)
+/**
+ * @brief Number of hops done while scanning for a lost link
+ */
+LOG_ADD(LOG_UINT32, scans, &hopScanCount)
+/**
+ * @brief RSSI on entry 0 [-dBm]
+ */
+LOG_ADD(LOG_FLOAT, rssi0, &hopQuality[0].rssi)
+/**
+ * @brief Received packets on entry 0 [1/s]
+ */
+LOG_ADD(LOG_FLOAT, rxRate0, &hopQuality[0].rxRate)
+/**
+ * @brief CRTP bytes received and sent on entry 0 [bytes/s]
+ */
+LOG_ADD(LOG_FLOAT, tput0, &hopQuality[0].throughput)
+/**
+ * @brief RSSI on entry 1 [-dBm]
+ */
+LOG_ADD(LOG_FLOAT, rssi1, &hopQuality[1].rssi)
+/**
+ * @brief Received packets on entry 1 [1/s]
+ */
+LOG_ADD(LOG_FLOAT, rxRate1, &hopQuality[1].rxRate)
+/**
+ * @brief CRTP bytes received and sent on entry 1 [bytes/s]
+ */
+LOG_ADD(LOG_FLOAT, tput1, &hopQuality[1].throughput)
+/**
+ * @brief RSSI on entry 2 [-dBm]
+ */
+LOG_ADD(LOG_FLOAT, rssi2, &hopQuality[2].rssi)
+/**
+ * @brief Received packets on entry 2 [1/s]
+ */
+LOG_ADD(LOG_FLOAT, rxRate2, &hopQuality[2].rxRate)
+/**
+ * @brief CRTP bytes received and sent on entry 2 [bytes/s]
+ */
+LOG_ADD(LOG_FLOAT, tput2, &hopQuality[2].throughput)
+/**
+ * @brief RSSI on entry 3 [-dBm]
+ */
+LOG_ADD(LOG_FLOAT, rssi3, &hopQuality[3].rssi)
+/**
+ * @brief Received packets on entry 3 [1/s]
+ */
+LOG_ADD(LOG_FLOAT, rxRate3, &hopQuality[3].rxRate)
+/**
+ * @brief CRTP bytes received and sent on entry 3 [bytes/s]
+ */
+LOG_ADD(LOG_FLOAT, tput3, &hopQuality[3].throughput)
+LOG_GROUP_STOP(hop)
+#endif
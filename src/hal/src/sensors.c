@@ -49,6 +49,12 @@
   #include "sensors_bosch.h"
 #endif
 
+#ifdef CONFIG_SENSORS_SIM
+  #include "sensors_sim.h"
+  // The simulated sensors replace the sensors of the platform
+  #define SENSORS_FORCE SensorImplementation_sim
+#endif
+
 
 typedef struct {
   SensorImplementation_t implements;
@@ -140,6 +146,23 @@ static const sensorsImplementation_t sensorImplementations[SensorImplementation_
     .dataAvailableCallback = nullFunction,
   },
 #endif
+#ifdef CONFIG_SENSORS_SIM
+  {
+    .implements = SensorImplementation_sim,
+    .init = sensorsSimInit,
+    .test = sensorsSimTest,
+    .areCalibrated = sensorsSimAreCalibrated,
+    .manufacturingTest = sensorsSimManufacturingTest,
+    .acquire = sensorsSimAcquire,
+    .waitDataReady = sensorsSimWaitDataReady,
+    .readGyro = sensorsSimReadGyro,
+    .readAcc = sensorsSimReadAcc,
+    .readMag = sensorsSimReadMag,
+    .readBaro = sensorsSimReadBaro,
+    .setAccMode = sensorsSimSetAccMode,
+    .dataAvailableCallback = nullFunction,
+  },
+#endif
 };
 
 static const sensorsImplementation_t* activeImplementation;
@@ -46,6 +46,7 @@
 #include "ledseq.h"
 #include "sound.h"
 #include "filter.h"
+#include "welford.h"
 #include "i2cdev.h"
 #include "bmi088.h"
 #include "bmp3.h"
@@ -55,6 +56,26 @@
 
 #include "sensors_bmi088_common.h"
 #include "platform_defaults.h"
+#include "boot_timeline.h"
+#include "storage.h"
+#include "worker.h"
+#include "statsCnt.h"
+#include "rateSupervisor.h"
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+#include "rate_loop.h"
+#endif
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+#include "axis3fSubSampler.h"
+#endif
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+#include "rpmFilter.h"
+#include "cycle_counter.h"
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER_SOURCE_DSHOT
+#include "motors.h"
+#else
+#include "rpm.h"
+#endif
+#endif
 
 #define GYRO_ADD_RAW_AND_VARIANCE_LOG_VALUES
 
@@ -65,6 +86,17 @@
 #define SENSORS_DELAY_BARO              (SENSORS_READ_RATE_HZ/SENSORS_READ_BARO_HZ)
 #define SENSORS_DELAY_MAG               (SENSORS_READ_RATE_HZ/SENSORS_READ_MAG_HZ)
 
+// With the inner rate loop the gyro runs faster than the rest of the sensors, and
+// every gyro sample is fed to the rate loop
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+#define SENSORS_GYRO_RATE_HZ            RATE_LOOP_RATE_HZ
+#define SENSORS_BMI088_GYRO_ODR_CFG     BMI088_GYRO_BW_230_ODR_2000_HZ
+#else
+#define SENSORS_GYRO_RATE_HZ            SENSORS_READ_RATE_HZ
+#define SENSORS_BMI088_GYRO_ODR_CFG     BMI088_GYRO_BW_116_ODR_1000_HZ
+#endif
+#define SENSORS_GYRO_DECIMATION         (SENSORS_GYRO_RATE_HZ/SENSORS_READ_RATE_HZ)
+
 #define SENSORS_BMI088_GYRO_FS_CFG      BMI088_GYRO_RANGE_2000_DPS
 #define SENSORS_BMI088_DEG_PER_LSB_CFG  (2.0f *2000.0f) / 65536.0f
 
@@ -90,6 +122,20 @@
 
 #define SENSORS_ACC_SCALE_SAMPLES  200
 
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+// In FIFO mode every accelerometer sample is used, at the output data rate
+#define SENSORS_ACCEL_RATE_HZ           1600
+// Max time span of samples drained per wake, frames beyond that are left in the FIFOs for the next wake
+#define SENSORS_FIFO_MAX_SPAN_MS        4
+#define SENSORS_FIFO_GYRO_FRAME_SIZE    6
+#define SENSORS_FIFO_GYRO_MAX_FRAMES    (SENSORS_FIFO_MAX_SPAN_MS * SENSORS_GYRO_RATE_HZ / 1000)
+// An accelerometer frame is a header followed by x, y and z. Room for one extra frame and a skip frame.
+#define SENSORS_FIFO_ACCEL_FRAME_SIZE   7
+#define SENSORS_FIFO_ACCEL_MAX_BYTES    ((SENSORS_FIFO_MAX_SPAN_MS * SENSORS_ACCEL_RATE_HZ / 1000 + 1) * SENSORS_FIFO_ACCEL_FRAME_SIZE + 2)
+#else
+#define SENSORS_ACCEL_RATE_HZ           SENSORS_READ_RATE_HZ
+#endif
+
 
 typedef struct
 {
@@ -97,9 +143,8 @@ typedef struct
   Axis3f     variance;
   Axis3f     mean;
   bool       isBiasValueFound;
-  bool       isBufferFilled;
-  Axis3i16*  bufHead;
-  Axis3i16   buffer[SENSORS_NBR_OF_BIAS_SAMPLES];
+  // Statistics of the current window of SENSORS_NBR_OF_BIAS_SAMPLES samples, per axis
+  welford_t  stats[GYRO_NBR_OF_AXES];
 } BiasObj;
 
 /* initialize necessary variables */
@@ -115,6 +160,24 @@ STATIC_MEM_QUEUE_ALLOC(magnetometerDataQueue, 1, sizeof(Axis3f));
 static xQueueHandle barometerDataQueue;
 STATIC_MEM_QUEUE_ALLOC(barometerDataQueue, 1, sizeof(baro_t));
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+// Raw IMU data read by DMA from the data ready interrupt
+typedef struct
+{
+  Axis3i16 gyro;
+  Axis3i16 accel;
+  uint64_t timestamp;
+} imuRawFrame_t;
+
+static xQueueHandle imuRawFrameQueue;
+STATIC_MEM_QUEUE_ALLOC(imuRawFrameQueue, 1, sizeof(imuRawFrame_t));
+static imuRawFrame_t imuRawFrameInProgress;
+static volatile bool isImuReadAsync = false;
+// Frames not read since the bus was busy, or not processed before the next frame
+static uint32_t imuAsyncBusyCount;
+static uint32_t imuAsyncOverwrittenCount;
+#endif
+
 static xSemaphoreHandle sensorsDataReady;
 static StaticSemaphore_t sensorsDataReadyBuffer;
 static xSemaphoreHandle dataReady;
@@ -123,6 +186,8 @@ static StaticSemaphore_t dataReadyBuffer;
 static bool isInit = false;
 static sensorData_t sensorData;
 static volatile uint64_t imuIntTimestamp;
+// Time from the data ready interrupt to the release of sensorsWaitDataReady()
+static statsCntMinMaxAvg_t dataReadyLatency;
 
 static Axis3i16 gyroRaw;
 static Axis3i16 accelRaw;
@@ -132,21 +197,55 @@ static Axis3f gyroBias;
 static Axis3f gyroBiasStdDev;
 #endif
 static bool gyroBiasFound = false;
+#ifdef CONFIG_SENSORS_GYRO_BIAS_CACHE
+#define GYRO_BIAS_CACHE_KEY "sys/gyroBias"
+typedef struct
+{
+  Axis3f bias;
+  // IMU temperature when the bias was measured [C]
+  float temperature;
+} gyroBiasCache_t;
+static gyroBiasCache_t gyroBiasCache;
+static bool isGyroBiasFromCache = false;
+static bool isGyroBiasCacheUpdated = false;
+#endif
 static float accScaleSum = 0;
 static float accScale = 1;
 static bool accScaleFound = false;
 static uint32_t accScaleSumCount = 0;
 
 // Low Pass filtering
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+// The motor vibrations are removed by the RPM filter, a higher cutoff gives less phase delay
+#define GYRO_LPF_CUTOFF_FREQ  CONFIG_SENSORS_GYRO_RPM_FILTER_LPF_HZ
+#else
 #define GYRO_LPF_CUTOFF_FREQ  80
+#endif
 #define ACCEL_LPF_CUTOFF_FREQ 30
-static lpf2pData accLpf[3];
-static lpf2pData gyroLpf[3];
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in);
+static biquadBank_t accLpf;
+static biquadBank_t gyroLpf;
+
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+NO_DMA_CCM_SAFE_ZERO_INIT static rpmFilter_t gyroRpmFilter;
+// Cost of the RPM filter per gyro sample [cycles]
+static statsCntMinMaxAvg_t rpmFilterCycles;
+#endif
 
 static bool isBarometerPresent = false;
+static rateSupervisorTask_t rateSupervisorTask;
 static uint8_t baroMeasDelayMin = SENSORS_DELAY_BARO;
 
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+static uint8_t gyroFifoBuffer[SENSORS_FIFO_GYRO_MAX_FRAMES * SENSORS_FIFO_GYRO_FRAME_SIZE];
+static uint8_t accelFifoBuffer[SENSORS_FIFO_ACCEL_MAX_BYTES];
+// Samples since the last time the measurements were enqueued to the estimator
+static Axis3fSubSampler_t gyroFifoSubSampler;
+static Axis3fSubSampler_t accelFifoSubSampler;
+static uint32_t gyroFifoOverruns;
+static uint32_t accelFifoSkippedFrames;
+static uint8_t gyroFifoMaxFrames;
+#endif
+
 // IMU alignment Euler angles
 static float imuPhi = IMU_PHI;
 static float imuTheta = IMU_THETA;
@@ -166,9 +265,12 @@ static bool processGyroBiasNoBuffer(int16_t gx, int16_t gy, int16_t gz, Axis3f *
 static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz,  Axis3f *gyroBiasOut);
 #endif
 static bool processAccScale(int16_t ax, int16_t ay, int16_t az);
+#ifdef CONFIG_SENSORS_GYRO_BIAS_CACHE
+static bool gyroBiasCacheLoad(Axis3f *gyroBiasOut);
+static void gyroBiasCacheSave(const Axis3f *gyroBiasIn);
+#endif
 static void sensorsBiasObjInit(BiasObj* bias);
 static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut);
-static void sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut);
 static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z);
 static bool sensorsFindBiasValue(BiasObj* bias);
 static void sensorsAlignToAirframe(Axis3f* in, Axis3f* out);
@@ -241,6 +343,131 @@ static void sensorsAccelGet(Axis3i16* dataOut)
   bmi088_get_accel_data((struct bmi088_sensor_data*)dataOut, &bmi088Dev);
 }
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+static void sensorsRawDataToAxis3i16(const uint8_t* data, Axis3i16* out)
+{
+  out->x = (int16_t)((data[1] << 8) | data[0]);
+  out->y = (int16_t)((data[3] << 8) | data[2]);
+  out->z = (int16_t)((data[5] << 8) | data[4]);
+}
+
+// Called from the SPI DMA interrupt, the frame is complete
+static void sensorsAccelReadAsyncDone(const uint8_t* data)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+  // The first byte of an accelerometer read over SPI is a dummy byte
+  sensorsRawDataToAxis3i16(&data[1], &imuRawFrameInProgress.accel);
+
+  if (uxQueueMessagesWaitingFromISR(imuRawFrameQueue) > 0)
+  {
+    imuAsyncOverwrittenCount++;
+  }
+  xQueueOverwriteFromISR(imuRawFrameQueue, &imuRawFrameInProgress, &xHigherPriorityTaskWoken);
+  xSemaphoreGiveFromISR(sensorsDataReady, &xHigherPriorityTaskWoken);
+
+  if (xHigherPriorityTaskWoken)
+  {
+    portYIELD();
+  }
+}
+
+// Called from the SPI DMA interrupt, continue with the accelerometer
+static void sensorsGyroReadAsyncDone(const uint8_t* data)
+{
+  sensorsRawDataToAxis3i16(data, &imuRawFrameInProgress.gyro);
+
+  if (!sensorsBmi088SpiReadAsync(bmi088Dev.accel_id, BMI088_ACCEL_X_LSB_REG, 1 + 6, sensorsAccelReadAsyncDone))
+  {
+    imuAsyncBusyCount++;
+  }
+}
+#endif
+
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+static void sensorsFifoInit(void)
+{
+  uint8_t data;
+
+  data = BMI088_GYRO_STREAM_OP_MODE << BMI088_GYRO_FIFO_MODE_POS;
+  bmi088_set_gyro_regs(BMI088_GYRO_FIFO_CONFIG_1_REG, &data, 1, &bmi088Dev);
+
+  // Stream mode, bit 1 must always be set
+  data = 0x02;
+  bmi088_set_accel_regs(BMI088_ACCEL_FIFO_CONFIG_0_REG, &data, 1, &bmi088Dev);
+  // Store accelerometer data, bit 4 must always be set
+  data = BMI088_FIFO_ACCEL | BMI088_FIFO_HEADER;
+  bmi088_set_accel_regs(BMI088_ACCEL_FIFO_CONFIG_1_REG, &data, 1, &bmi088Dev);
+
+  axis3fSubSamplerInit(&gyroFifoSubSampler, 1.0f);
+  axis3fSubSamplerInit(&accelFifoSubSampler, 1.0f);
+}
+
+/**
+ * Drain the gyro FIFO in one burst. Returns the number of frames read into gyroFifoBuffer, at most
+ * SENSORS_FIFO_GYRO_MAX_FRAMES, and the number of frames that were in the FIFO in availableOut.
+ */
+static uint8_t sensorsGyroFifoGet(uint8_t* availableOut)
+{
+  uint8_t status = 0;
+  bmi088_get_gyro_regs(BMI088_GYRO_FIFO_STAT_REG, &status, 1, &bmi088Dev);
+  if (status & BMI088_GYRO_FIFO_OVERRUN_MASK)
+  {
+    gyroFifoOverruns++;
+  }
+
+  const uint8_t available = status & BMI088_GYRO_FIFO_COUNTER_MASK;
+  uint8_t count = available;
+  if (count > SENSORS_FIFO_GYRO_MAX_FRAMES)
+  {
+    count = SENSORS_FIFO_GYRO_MAX_FRAMES;
+  }
+
+  if (count > 0)
+  {
+    bmi088_get_gyro_regs(BMI088_GYRO_FIFO_DATA_REG, gyroFifoBuffer, count * SENSORS_FIFO_GYRO_FRAME_SIZE, &bmi088Dev);
+  }
+
+  if (available > gyroFifoMaxFrames)
+  {
+    gyroFifoMaxFrames = available;
+  }
+
+  *availableOut = available;
+  return count;
+}
+
+/**
+ * Drain the accelerometer FIFO in one burst. Returns the number of bytes read into accelFifoBuffer.
+ */
+static uint16_t sensorsAccelFifoGet(void)
+{
+  uint8_t lengthData[2] = {0};
+  bmi088_get_accel_regs(BMI088_ACCEL_FIFO_LENGTH_0_REG, lengthData, 2, &bmi088Dev);
+
+  uint16_t length = lengthData[0] | ((lengthData[1] & BMI088_FIFO_BYTE_COUNTER_MSB_MASK) << 8);
+  if (length > SENSORS_FIFO_ACCEL_MAX_BYTES)
+  {
+    // A partially read frame is repeated in the next read
+    length = SENSORS_FIFO_ACCEL_MAX_BYTES;
+  }
+
+  if (length > 0)
+  {
+    bmi088_get_accel_regs(BMI088_ACCEL_FIFO_DATA_REG, accelFifoBuffer, length, &bmi088Dev);
+  }
+
+  return length;
+}
+
+static void sensorsFifoFrameToAxis3i16(const uint8_t* frame, Axis3i16* out)
+{
+  out->x = (int16_t)((frame[1] << 8) | frame[0]);
+  out->y = (int16_t)((frame[3] << 8) | frame[2]);
+  out->z = (int16_t)((frame[5] << 8) | frame[4]);
+}
+#endif
+
 static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
                              float temperature)
 {
@@ -284,61 +511,287 @@ bool sensorsBmi088Bmp3xxAreCalibrated()
   return gyroBiasFound;
 }
 
-static void sensorsTask(void *param)
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+/**
+ * Remove the motor vibrations from a gyro sample, with notches at the latest motor speeds
+ */
+static void sensorsRpmFilterApply(float* gyro)
 {
-  systemWaitStart();
+  const uint32_t start = cycleCounterGet();
+
+  float rpm[RPM_FILTER_MOTORS];
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER_SOURCE_DSHOT
+  motorsGetRpm(rpm);
+#else
+  rpmDeckGetRpm(rpm);
+#endif
+  rpmFilterSetRpm(&gyroRpmFilter, rpm);
+  rpmFilterApply(&gyroRpmFilter, gyro);
 
+  statsCntMinMaxAvgAdd(&rpmFilterCycles, cycleCounterElapsed(start));
+  statsCntMinMaxAvgUpdate(&rpmFilterCycles, T2M(xTaskGetTickCount()));
+}
+#endif
+
+/**
+ * Calibrate, scale, align and filter a gyro sample into sensorData.gyro, and feed it to the rate loop.
+ * Returns true if the gyro bias has been measured.
+ */
+static bool sensorsProcessGyro(const Axis3i16* raw)
+{
   Axis3f gyroScaledIMU;
+
+  /* calibrate if necessary */
+#ifdef GYRO_BIAS_LIGHT_WEIGHT
+  const bool isGyroBiasMeasured = processGyroBiasNoBuffer(raw->x, raw->y, raw->z, &gyroBias);
+#else
+  const bool isGyroBiasMeasured = processGyroBias(raw->x, raw->y, raw->z, &gyroBias);
+#endif
+
+#ifdef CONFIG_SENSORS_GYRO_BIAS_CACHE
+  gyroBiasFound = isGyroBiasMeasured || isGyroBiasFromCache;
+  if (isGyroBiasMeasured && !isGyroBiasCacheUpdated)
+  {
+    gyroBiasCacheSave(&gyroBias);
+    isGyroBiasCacheUpdated = true;
+  }
+#else
+  gyroBiasFound = isGyroBiasMeasured;
+#endif
+
+  /* Gyro */
+  gyroScaledIMU.x =  (raw->x - gyroBias.x) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+  gyroScaledIMU.y =  (raw->y - gyroBias.y) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+  gyroScaledIMU.z =  (raw->z - gyroBias.z) * SENSORS_BMI088_DEG_PER_LSB_CFG;
+  sensorsAlignToAirframe(&gyroScaledIMU, &sensorData.gyro);
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+  sensorsRpmFilterApply(sensorData.gyro.axis);
+#endif
+  biquadBankApply(&gyroLpf, sensorData.gyro.axis);
+
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+  if (gyroBiasFound)
+  {
+    rateLoopGyroSample(&sensorData.gyro);
+  }
+#endif
+
+  return isGyroBiasMeasured;
+}
+
+/**
+ * Scale, align and filter an accelerometer sample into sensorData.acc
+ */
+static void sensorsProcessAccel(const Axis3i16* raw, const bool isGyroBiasMeasured)
+{
   Axis3f accScaledIMU;
   Axis3f accScaled;
+
+  // The accelerometer scale is measured while still, not when started from the stored gyro bias
+  if (isGyroBiasMeasured)
+  {
+     processAccScale(raw->x, raw->y, raw->z);
+  }
+
+  /* Acelerometer */
+  accScaledIMU.x = raw->x * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
+  accScaledIMU.y = raw->y * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
+  accScaledIMU.z = raw->z * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
+  sensorsAlignToAirframe(&accScaledIMU, &accScaled);
+  sensorsAccAlignToGravity(&accScaled, &sensorData.acc);
+  biquadBankApply(&accLpf, sensorData.acc.axis);
+}
+
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+/**
+ * Drain and process the gyro FIFO. The time stamp of each sample is reconstructed from the number of frames
+ * in the FIFO, the newest frame is the one that triggered the latest data ready interrupt.
+ * Returns the number of processed samples.
+ */
+static uint8_t sensorsGyroFifoProcess(bool* isGyroBiasMeasured)
+{
+  const uint64_t samplePeriodUs = 1000000 / SENSORS_GYRO_RATE_HZ;
+
+  uint8_t available = 0;
+  const uint8_t count = sensorsGyroFifoGet(&available);
+  const uint64_t newestTimestamp = imuIntTimestamp;
+
+  for (int i = 0; i < count; i++)
+  {
+    sensorsFifoFrameToAxis3i16(&gyroFifoBuffer[i * SENSORS_FIFO_GYRO_FRAME_SIZE], &gyroRaw);
+    *isGyroBiasMeasured = sensorsProcessGyro(&gyroRaw);
+    axis3fSubSamplerAccumulate(&gyroFifoSubSampler, &sensorData.gyro);
+    sensorData.interruptTimestamp = newestTimestamp - (available - 1 - i) * samplePeriodUs;
+  }
+
+  return count;
+}
+
+/**
+ * Drain and process the accelerometer FIFO. The FIFO is in header mode, frames that do not contain
+ * accelerometer data are skipped.
+ */
+static void sensorsAccelFifoProcess(const bool isGyroBiasMeasured)
+{
+  const uint16_t length = sensorsAccelFifoGet();
+
+  uint16_t index = 0;
+  while (index < length)
+  {
+    const uint8_t header = accelFifoBuffer[index] & BMI088_FIFO_TAG_INTR_MASK;
+    uint16_t frameLength;
+    switch (header)
+    {
+      case FIFO_HEAD_A:
+        frameLength = SENSORS_FIFO_ACCEL_FRAME_SIZE;
+        break;
+      case FIFO_HEAD_SENSOR_TIME:
+        frameLength = 1 + BMI088_SENSOR_TIME_LENGTH;
+        break;
+      case FIFO_HEAD_SKIP_FRAME:
+      case FIFO_HEAD_INPUT_CONFIG:
+      case FIFO_HEAD_SAMPLE_DROP:
+        frameLength = 2;
+        break;
+      default:
+        // Over read, there is no more data
+        frameLength = 0;
+        break;
+    }
+
+    if (frameLength == 0 || index + frameLength > length)
+    {
+      break;
+    }
+
+    if (header == FIFO_HEAD_A)
+    {
+      sensorsFifoFrameToAxis3i16(&accelFifoBuffer[index + 1], &accelRaw);
+      sensorsProcessAccel(&accelRaw, isGyroBiasMeasured);
+      axis3fSubSamplerAccumulate(&accelFifoSubSampler, &sensorData.acc);
+    }
+    else if (header == FIFO_HEAD_SKIP_FRAME)
+    {
+      accelFifoSkippedFrames += accelFifoBuffer[index + 1];
+    }
+
+    index += frameLength;
+  }
+}
+#endif
+
+static void sensorsTask(void *param)
+{
+  systemWaitStart();
+
   measurement_t measurement;
   /* wait an additional second the keep bus free
    * this is only required by the z-ranger, since the
    * configuration will be done after system start-up */
   //vTaskDelayUntil(&lastWakeTime, M2T(1500));
+
+#ifdef CONFIG_SENSORS_GYRO_BIAS_CACHE
+  isGyroBiasFromCache = gyroBiasCacheLoad(&gyroBias);
+  if (isGyroBiasFromCache)
+  {
+    soundSetEffect(SND_CALIB);
+    ledseqRun(&seq_calibrated);
+    bootTimelineMark("gyroBiasFromCache");
+  }
+#endif
+
+  rateSupervisorRegisterTask(&rateSupervisorTask, "sensors", T2M(xTaskGetTickCount()), SENSORS_READ_RATE_HZ, SENSORS_READ_RATE_HZ / 100, 1);
+
   while (1)
   {
     if (pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY))
     {
-      sensorData.interruptTimestamp = imuIntTimestamp;
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+      // All samples in the FIFOs are processed, while the measurements are averaged and enqueued to the
+      // estimator at SENSORS_READ_RATE_HZ
+      static bool isGyroBiasMeasured = false;
+      static uint8_t gyroSamplesSinceEnqueue = 0;
+      gyroSamplesSinceEnqueue += sensorsGyroFifoProcess(&isGyroBiasMeasured);
+      if (gyroSamplesSinceEnqueue < SENSORS_GYRO_DECIMATION)
+      {
+        continue;
+      }
+      gyroSamplesSinceEnqueue = 0;
 
-      /* get data from chosen sensors */
-      sensorsGyroGet(&gyroRaw);
-      sensorsAccelGet(&accelRaw);
+      sensorsAccelFifoProcess(isGyroBiasMeasured);
 
-      /* calibrate if necessary */
-#ifdef GYRO_BIAS_LIGHT_WEIGHT
-      gyroBiasFound = processGyroBiasNoBuffer(gyroRaw.x, gyroRaw.y, gyroRaw.z, &gyroBias);
+      sensorData.gyro = *axis3fSubSamplerFinalize(&gyroFifoSubSampler);
+      measurement.type = MeasurementTypeGyroscope;
+      measurement.data.gyroscope.gyro = sensorData.gyro;
+      measurement.data.gyroscope.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
+      estimatorEnqueue(&measurement);
+
+      if (accelFifoSubSampler.count > 0)
+      {
+        sensorData.acc = *axis3fSubSamplerFinalize(&accelFifoSubSampler);
+        measurement.type = MeasurementTypeAcceleration;
+        measurement.data.acceleration.acc = sensorData.acc;
+      measurement.data.acceleration.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
+        measurement.data.acceleration.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
+        estimatorEnqueue(&measurement);
+      }
 #else
-      gyroBiasFound = processGyroBias(gyroRaw.x, gyroRaw.y, gyroRaw.z, &gyroBias);
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+      imuRawFrame_t frame = {0};
+      if (isImuReadAsync)
+      {
+        // The frame has already been read by DMA, the next one is read while this one is processed
+        if (pdTRUE != xQueueReceive(imuRawFrameQueue, &frame, 0))
+        {
+          continue;
+        }
+        sensorData.interruptTimestamp = frame.timestamp;
+        gyroRaw = frame.gyro;
+      }
+      else
 #endif
-      if (gyroBiasFound)
       {
-         processAccScale(accelRaw.x, accelRaw.y, accelRaw.z);
+        sensorData.interruptTimestamp = imuIntTimestamp;
+
+        /* get data from chosen sensors */
+        sensorsGyroGet(&gyroRaw);
+      }
+      const bool isGyroBiasMeasured = sensorsProcessGyro(&gyroRaw);
+
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+      // Everything below runs at SENSORS_READ_RATE_HZ
+      static uint8_t gyroDecimation = 0;
+      if (++gyroDecimation < SENSORS_GYRO_DECIMATION)
+      {
+        continue;
       }
+      gyroDecimation = 0;
+#endif
 
-      /* Gyro */
-      gyroScaledIMU.x =  (gyroRaw.x - gyroBias.x) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      gyroScaledIMU.y =  (gyroRaw.y - gyroBias.y) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      gyroScaledIMU.z =  (gyroRaw.z - gyroBias.z) * SENSORS_BMI088_DEG_PER_LSB_CFG;
-      sensorsAlignToAirframe(&gyroScaledIMU, &sensorData.gyro);
-      applyAxis3fLpf((lpf2pData*)(&gyroLpf), &sensorData.gyro);
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+      if (isImuReadAsync)
+      {
+        accelRaw = frame.accel;
+      }
+      else
+#endif
+      {
+        sensorsAccelGet(&accelRaw);
+      }
+      sensorsProcessAccel(&accelRaw, isGyroBiasMeasured);
 
       measurement.type = MeasurementTypeGyroscope;
       measurement.data.gyroscope.gyro = sensorData.gyro;
+      measurement.data.gyroscope.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
       estimatorEnqueue(&measurement);
 
-      /* Acelerometer */
-      accScaledIMU.x = accelRaw.x * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
-      accScaledIMU.y = accelRaw.y * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
-      accScaledIMU.z = accelRaw.z * SENSORS_BMI088_G_PER_LSB_CFG / accScale;
-      sensorsAlignToAirframe(&accScaledIMU, &accScaled);
-      sensorsAccAlignToGravity(&accScaled, &sensorData.acc);
-      applyAxis3fLpf((lpf2pData*)(&accLpf), &sensorData.acc);
-
       measurement.type = MeasurementTypeAcceleration;
       measurement.data.acceleration.acc = sensorData.acc;
+      measurement.data.acceleration.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
       estimatorEnqueue(&measurement);
+#endif
+
+      rateSupervisorTaskValidate(&rateSupervisorTask, T2M(xTaskGetTickCount()));
     }
 
     if (isBarometerPresent)
@@ -374,6 +827,9 @@ static void sensorsTask(void *param)
 void sensorsBmi088Bmp3xxWaitDataReady(void)
 {
   xSemaphoreTake(dataReady, portMAX_DELAY);
+
+  statsCntMinMaxAvgAdd(&dataReadyLatency, (uint32_t)(usecTimestamp() - sensorData.interruptTimestamp));
+  statsCntMinMaxAvgUpdate(&dataReadyLatency, T2M(xTaskGetTickCount()));
 }
 
 static void sensorsDeviceInit(void)
@@ -403,9 +859,9 @@ static void sensorsDeviceInit(void)
     bmi088Dev.gyro_cfg.power = BMI088_GYRO_PM_NORMAL;
     rslt |= bmi088_set_gyro_power_mode(&bmi088Dev);
     /* set bandwidth and range of gyro */
-    bmi088Dev.gyro_cfg.bw = BMI088_GYRO_BW_116_ODR_1000_HZ;
+    bmi088Dev.gyro_cfg.bw = SENSORS_BMI088_GYRO_ODR_CFG;
     bmi088Dev.gyro_cfg.range = SENSORS_BMI088_GYRO_FS_CFG;
-    bmi088Dev.gyro_cfg.odr = BMI088_GYRO_BW_116_ODR_1000_HZ;
+    bmi088Dev.gyro_cfg.odr = SENSORS_BMI088_GYRO_ODR_CFG;
     rslt |= bmi088_set_gyro_meas_conf(&bmi088Dev);
 
     intConfig.gyro_int_channel = BMI088_INT_CHANNEL_3;
@@ -449,6 +905,10 @@ static void sensorsDeviceInit(void)
 
     struct bmi088_sensor_data acc;
     rslt |= bmi088_get_accel_data(&acc, &bmi088Dev);
+
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+    sensorsFifoInit();
+#endif
   }
   else
   {
@@ -536,11 +996,12 @@ static void sensorsDeviceInit(void)
   }
 
   // Init second order filer for accelerometer and gyro
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    lpf2pInit(&gyroLpf[i], 1000, GYRO_LPF_CUTOFF_FREQ);
-    lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-  }
+  biquadBankInitLowPass(&gyroLpf, 3, SENSORS_GYRO_RATE_HZ, GYRO_LPF_CUTOFF_FREQ);
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+  rpmFilterInit(&gyroRpmFilter, SENSORS_GYRO_RATE_HZ, CONFIG_SENSORS_GYRO_RPM_FILTER_HARMONICS,
+    CONFIG_SENSORS_GYRO_RPM_FILTER_Q / 100.0f, CONFIG_SENSORS_GYRO_RPM_FILTER_MIN_HZ);
+#endif
+  biquadBankInitLowPass(&accLpf, 3, SENSORS_ACCEL_RATE_HZ, ACCEL_LPF_CUTOFF_FREQ);
 
   cosPitch = cosf(configblockGetCalibPitch() * (float) M_PI / 180);
   sinPitch = sinf(configblockGetCalibPitch() * (float) M_PI / 180);
@@ -556,6 +1017,13 @@ static void sensorsTaskInit(void)
   gyroDataQueue = STATIC_MEM_QUEUE_CREATE(gyroDataQueue);
   magnetometerDataQueue = STATIC_MEM_QUEUE_CREATE(magnetometerDataQueue);
   barometerDataQueue = STATIC_MEM_QUEUE_CREATE(barometerDataQueue);
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  imuRawFrameQueue = STATIC_MEM_QUEUE_CREATE(imuRawFrameQueue);
+#endif
+  statsCntMinMaxAvgInit(&dataReadyLatency, 1000);
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+  statsCntMinMaxAvgInit(&rpmFilterCycles, 1000);
+#endif
 
   STATIC_MEM_TASK_CREATE(sensorsTask, sensorsTask, SENSORS_TASK_NAME, NULL, SENSORS_TASK_PRI);
 }
@@ -604,6 +1072,10 @@ void sensorsBmi088Bmp3xxInit_SPI(void)
     DEBUG_PRINT("BMI088: Using SPI interface.\n");
     sensorsBmi088_SPI_deviceInit(&bmi088Dev);
     sensorsBmi088Bmp3xxInit();
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+    // From now on the IMU is read from the data ready interrupt
+    isImuReadAsync = isInit;
+#endif
 }
 
 void sensorsBmi088Bmp3xxInit_I2C(void)
@@ -751,89 +1223,106 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBias
     {
       soundSetEffect(SND_CALIB);
       ledseqRun(&seq_calibrated);
+      bootTimelineMark("gyroBiasFound");
     }
   }
 
-  gyroBiasOut->x = gyroBiasRunning.bias.x;
-  gyroBiasOut->y = gyroBiasRunning.bias.y;
-  gyroBiasOut->z = gyroBiasRunning.bias.z;
+  // Keep the current bias, possibly from the cache, until a new one is found
+  if (gyroBiasRunning.isBiasValueFound)
+  {
+    gyroBiasOut->x = gyroBiasRunning.bias.x;
+    gyroBiasOut->y = gyroBiasRunning.bias.y;
+    gyroBiasOut->z = gyroBiasRunning.bias.z;
+  }
 
   return gyroBiasRunning.isBiasValueFound;
 }
 #endif
 
-static void sensorsBiasObjInit(BiasObj* bias)
-{
-  bias->isBufferFilled = false;
-  bias->bufHead = bias->buffer;
-}
-
+#ifdef CONFIG_SENSORS_GYRO_BIAS_CACHE
 /**
- * Calculates the variance and mean for the bias buffer.
+ * Use the gyro bias stored at the previous boot if the IMU temperature is
+ * close to the temperature it was measured at.
  */
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
+static bool gyroBiasCacheLoad(Axis3f *gyroBiasOut)
 {
-  uint32_t i;
-  int64_t sum[GYRO_NBR_OF_AXES] = {0};
-  int64_t sumSq[GYRO_NBR_OF_AXES] = {0};
+  float temperature;
 
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
+  if (storageFetch(GYRO_BIAS_CACHE_KEY, &gyroBiasCache, sizeof(gyroBiasCache)) != sizeof(gyroBiasCache))
   {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-    sumSq[0] += bias->buffer[i].x * bias->buffer[i].x;
-    sumSq[1] += bias->buffer[i].y * bias->buffer[i].y;
-    sumSq[2] += bias->buffer[i].z * bias->buffer[i].z;
+    return false;
   }
 
-  meanOut->x = (float) sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = (float) sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = (float) sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
+  if (bmi088_get_sensor_temperature(&bmi088Dev, &temperature) != BMI088_OK)
+  {
+    return false;
+  }
 
-  varOut->x = sumSq[0] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->x * meanOut->x;
-  varOut->y = sumSq[1] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->y * meanOut->y;
-  varOut->z = sumSq[2] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->z * meanOut->z;
+  if (fabsf(temperature - gyroBiasCache.temperature) > CONFIG_SENSORS_GYRO_BIAS_CACHE_MAX_TEMP_DIFF)
+  {
+    DEBUG_PRINT("Stored gyro bias not used, measured at %.1f C, now %.1f C\n", (double)gyroBiasCache.temperature, (double)temperature);
+    return false;
+  }
+
+  *gyroBiasOut = gyroBiasCache.bias;
+  DEBUG_PRINT("Using stored gyro bias, measured at %.1f C\n", (double)gyroBiasCache.temperature);
+  return true;
 }
 
-/**
- * Calculates the mean for the bias buffer.
- */
-static void __attribute__((used)) sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut)
+static void gyroBiasCacheStoreWorker(void *arg)
+{
+  storageStore(GYRO_BIAS_CACHE_KEY, &gyroBiasCache, sizeof(gyroBiasCache));
+}
+
+static void gyroBiasCacheSave(const Axis3f *gyroBiasIn)
 {
-  uint32_t i;
-  int32_t sum[GYRO_NBR_OF_AXES] = {0};
+  float temperature;
 
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
+  if (bmi088_get_sensor_temperature(&bmi088Dev, &temperature) != BMI088_OK)
   {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
+    return;
   }
 
-  meanOut->x = sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
+  gyroBiasCache.bias = *gyroBiasIn;
+  gyroBiasCache.temperature = temperature;
+
+  // Writing to the EEPROM takes too long for the sensors task
+  const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .coalesce = true};
+  workerScheduleWithOptions(gyroBiasCacheStoreWorker, NULL, &options);
+}
+#endif
+
+static void sensorsBiasObjInit(BiasObj* bias)
+{
+  for (int i = 0; i < GYRO_NBR_OF_AXES; i++)
+  {
+    welfordInit(&bias->stats[i]);
+  }
 }
 
 /**
- * Adds a new value to the variance buffer and if it is full
- * replaces the oldest one. Thus a circular buffer.
+ * Calculates the variance and mean for the current window of samples.
  */
-static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z)
+static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
 {
-  bias->bufHead->x = x;
-  bias->bufHead->y = y;
-  bias->bufHead->z = z;
-  bias->bufHead++;
-
-  if (bias->bufHead >= &bias->buffer[SENSORS_NBR_OF_BIAS_SAMPLES])
+  for (int i = 0; i < GYRO_NBR_OF_AXES; i++)
   {
-    bias->bufHead = bias->buffer;
-    bias->isBufferFilled = true;
+    meanOut->axis[i] = welfordMean(&bias->stats[i]);
+    varOut->axis[i] = welfordVariance(&bias->stats[i]);
   }
 }
 
+/**
+ * Adds a new value to the statistics of the current window, in constant time
+ * and without keeping the samples.
+ */
+static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z)
+{
+  welfordAdd(&bias->stats[0], x);
+  welfordAdd(&bias->stats[1], y);
+  welfordAdd(&bias->stats[2], z);
+}
+
 /**
  * Checks if the variances is below the predefined thresholds.
  * The bias value should have been added before calling this.
@@ -844,9 +1333,11 @@ static bool sensorsFindBiasValue(BiasObj* bias)
   static int32_t varianceSampleTime;
   bool foundBias = false;
 
-  if (bias->isBufferFilled)
+  if (bias->stats[0].count >= SENSORS_NBR_OF_BIAS_SAMPLES)
   {
     sensorsCalculateVarianceAndMean(bias, &bias->variance, &bias->mean);
+    // Start the next window
+    sensorsBiasObjInit(bias);
 
     if (bias->variance.x < GYRO_VARIANCE_THRESHOLD_X &&
         bias->variance.y < GYRO_VARIANCE_THRESHOLD_Y &&
@@ -957,10 +1448,7 @@ void sensorsBmi088Bmp3xxSetAccMode(accModes accMode)
       {
         DEBUG_PRINT("ACC config [FAIL]\n");
       }
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, 500);
-      }
+      biquadBankInitLowPass(&accLpf, 3, SENSORS_ACCEL_RATE_HZ, 500);
       break;
     case ACC_MODE_FLIGHT:
     default:
@@ -972,25 +1460,29 @@ void sensorsBmi088Bmp3xxSetAccMode(accModes accMode)
       {
         DEBUG_PRINT("ACC config [FAIL]\n");
       }
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-      }
+      biquadBankInitLowPass(&accLpf, 3, SENSORS_ACCEL_RATE_HZ, ACCEL_LPF_CUTOFF_FREQ);
       break;
   }
 }
 
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in)
-{
-  for (uint8_t i = 0; i < 3; i++) {
-    in->axis[i] = lpf2pApply(&data[i], in->axis[i]);
-  }
-}
-
 void sensorsBmi088Bmp3xxDataAvailableCallback(void)
 {
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
   imuIntTimestamp = usecTimestamp();
+
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  if (isImuReadAsync)
+  {
+    // The sensors task is woken when the DMA read is done
+    imuRawFrameInProgress.timestamp = imuIntTimestamp;
+    if (!sensorsBmi088SpiReadAsync(bmi088Dev.gyro_id, BMI088_GYRO_X_LSB_REG, 6, sensorsGyroReadAsyncDone))
+    {
+      imuAsyncBusyCount++;
+    }
+    return;
+  }
+#endif
+
   xSemaphoreGiveFromISR(sensorsDataReady, &xHigherPriorityTaskWoken);
 
   if (xHigherPriorityTaskWoken)
@@ -1010,6 +1502,46 @@ LOG_ADD(LOG_FLOAT, zVariance, &gyroBiasRunning.variance.z)
 LOG_GROUP_STOP(gyro)
 #endif
 
+LOG_GROUP_START(imu_sensors)
+/**
+ * @brief Time from the IMU data ready interrupt until the sensor data is available to the stabilizer [us]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(readyLat, &dataReadyLatency)
+#ifdef CONFIG_SENSORS_GYRO_RPM_FILTER
+/**
+ * @brief Cost of the gyro RPM filter per sample, including the coefficient update of one motor [cycles]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(rpmFilt, &rpmFilterCycles)
+#endif
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+/**
+ * @brief Number of IMU reads that could not be started as the SPI bus was busy
+ */
+LOG_ADD(LOG_UINT32, asyncBusy, &imuAsyncBusyCount)
+/**
+ * @brief Number of IMU frames replaced by a newer frame before they were processed
+ */
+LOG_ADD(LOG_UINT32, asyncOvr, &imuAsyncOverwrittenCount)
+#endif
+LOG_GROUP_STOP(imu_sensors)
+
+#ifdef CONFIG_SENSORS_BMI088_FIFO
+LOG_GROUP_START(imuFifo)
+/**
+ * @brief Number of times the gyro FIFO has been found full, samples were lost
+ */
+LOG_ADD(LOG_UINT32, gyroOvr, &gyroFifoOverruns)
+/**
+ * @brief Number of accelerometer frames lost since the FIFO was full
+ */
+LOG_ADD(LOG_UINT32, accSkip, &accelFifoSkippedFrames)
+/**
+ * @brief Max number of frames found in the gyro FIFO at a wake
+ */
+LOG_ADD(LOG_UINT8, gyroMaxFrm, &gyroFifoMaxFrames)
+LOG_GROUP_STOP(imuFifo)
+#endif
+
 PARAM_GROUP_START(imu_sensors)
 
 /**
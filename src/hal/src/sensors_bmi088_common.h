@@ -26,11 +26,28 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "bstdr_types.h"
 
 void sensorsBmi088_I2C_deviceInit(struct bmi088_dev *device);
 void sensorsBmi088_SPI_deviceInit(struct bmi088_dev *device);
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+/**
+ * Called from the SPI DMA interrupt when an asynchronous read is done, data is valid during the call only
+ */
+typedef void (*sensorsBmi088SpiReadCallback_t)(const uint8_t *data);
+
+/**
+ * Start a read over SPI without waiting for it to complete, can be called from interrupts. Reads are
+ * not started when the bus is busy, or if len does not fit in one DMA transaction.
+ *
+ * @return true if the read was started
+ */
+bool sensorsBmi088SpiReadAsync(uint8_t dev_id, uint8_t reg_addr, uint16_t len,
+                               sensorsBmi088SpiReadCallback_t callback);
+#endif
+
 void        bmi088_ms_delay(uint32_t period);
 
 bstdr_ret_t bmi088_burst_read(uint8_t dev_id, uint8_t reg_addr,
@@ -29,6 +29,9 @@
 
 #include "stm32fxxx.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "bmi088.h"
 #include "i2cdev.h"
 #include "bstdr_types.h"
@@ -91,6 +94,14 @@ static StaticSemaphore_t spiRxDMACompleteBuffer;
 
 static bool isInit;
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+// Asynchronous read in progress, the callback is called from the RX DMA interrupt
+static volatile sensorsBmi088SpiReadCallback_t asyncReadCallback;
+static volatile uint8_t asyncReadDevId;
+// A blocking transaction is using, or waiting for, the bus. No asynchronous reads are started.
+static volatile bool isSyncTransactionActive;
+#endif
+
 static char spiSendByte(char byte)
 {
   /* Loop while DR register in not emplty */
@@ -111,9 +122,23 @@ static char spiReceiveByte()
   return spiSendByte(DUMMY_BYTE);
 }
 
-static void spiDMATransaction(uint8_t reg_addr,
-                              uint8_t *reg_data,
-                              uint16_t len)
+static void spiTxDMAStop(void)
+{
+  // Stop and cleanup DMA stream
+  DMA_ITConfig(BMI088_SPI_TX_DMA_STREAM, DMA_IT_TC, DISABLE);
+  DMA_ClearITPendingBit(BMI088_SPI_TX_DMA_STREAM, BMI088_SPI_TX_DMA_FLAG_TCIF);
+
+  // Clear stream flags
+  DMA_ClearFlag(BMI088_SPI_TX_DMA_STREAM,BMI088_SPI_TX_DMA_FLAG_TCIF);
+
+  // Disable SPI DMA requests
+  SPI_I2S_DMACmd(BMI088_SPI, SPI_I2S_DMAReq_Tx, DISABLE);
+
+  // Disable streams
+  DMA_Cmd(BMI088_SPI_TX_DMA_STREAM, DISABLE);
+}
+
+static void spiDMAStart(uint8_t reg_addr, uint16_t len)
 {
   ASSERT(len < SPI_MAX_DMA_TRANSACTION_SIZE);
 
@@ -148,6 +173,13 @@ static void spiDMATransaction(uint8_t reg_addr,
 
   // Enable peripheral to begin the transaction
   SPI_Cmd(BMI088_SPI, ENABLE);
+}
+
+static void spiDMATransaction(uint8_t reg_addr,
+                              uint8_t *reg_data,
+                              uint16_t len)
+{
+  spiDMAStart(reg_addr, len);
 
   // Wait for completion
   // TODO: Better error handling rather than passing up invalid data
@@ -159,9 +191,54 @@ static void spiDMATransaction(uint8_t reg_addr,
   memcpy(reg_data, &spiRxBuffer[1], len);
 }
 
+static void spiChipSelect(uint8_t dev_id)
+{
+  if (dev_id == BMI088_ACCEL_I2C_ADDR_PRIMARY)
+  {
+    ACC_EN_CS();
+  }
+  else
+  {
+    GYR_EN_CS();
+  }
+}
+
+static void spiChipDeselect(uint8_t dev_id)
+{
+  if (dev_id == BMI088_ACCEL_I2C_ADDR_PRIMARY)
+  {
+    ACC_DIS_CS();
+  }
+  else
+  {
+    GYR_DIS_CS();
+  }
+}
+
+static void spiSyncTransactionBegin(void)
+{
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  isSyncTransactionActive = true;
+  // An asynchronous read takes a few micro seconds
+  while (asyncReadCallback)
+  {
+    taskYIELD();
+  }
+#endif
+}
+
+static void spiSyncTransactionEnd(void)
+{
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  isSyncTransactionActive = false;
+#endif
+}
+
 static bstdr_ret_t spi_burst_read(uint8_t dev_id, uint8_t reg_addr,
                                   uint8_t *reg_data, uint16_t len)
 {
+  spiSyncTransactionBegin();
+
   /**< Burst read code comes here */
   if (dev_id == BMI088_ACCEL_I2C_ADDR_PRIMARY)
   {
@@ -194,12 +271,16 @@ static bstdr_ret_t spi_burst_read(uint8_t dev_id, uint8_t reg_addr,
     GYR_DIS_CS();
   }
 
+  spiSyncTransactionEnd();
+
   return BSTDR_OK;
 }
 
 static bstdr_ret_t spi_burst_write(uint8_t dev_id, uint8_t reg_addr,
                                    uint8_t *reg_data, uint16_t len)
 {
+  spiSyncTransactionBegin();
+
   if (dev_id == BMI088_ACCEL_I2C_ADDR_PRIMARY)
   {
     ACC_EN_CS();
@@ -223,6 +304,8 @@ static bstdr_ret_t spi_burst_write(uint8_t dev_id, uint8_t reg_addr,
     GYR_DIS_CS();
   }
 
+  spiSyncTransactionEnd();
+
   return BSTDR_OK;
 }
 
@@ -359,22 +442,59 @@ void sensorsBmi088_SPI_deviceInit(struct bmi088_dev *device)
   device->delay_ms = bmi088_ms_delay;
 }
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+bool sensorsBmi088SpiReadAsync(uint8_t dev_id, uint8_t reg_addr, uint16_t len,
+                               sensorsBmi088SpiReadCallback_t callback)
+{
+  if (isSyncTransactionActive || asyncReadCallback || len <= 1 || len >= SPI_MAX_DMA_TRANSACTION_SIZE)
+  {
+    return false;
+  }
+
+  asyncReadCallback = callback;
+  asyncReadDevId = dev_id;
+
+  spiChipSelect(dev_id);
+  spiDMAStart(reg_addr | BMI088_SPI_RD_MASK, len);
+
+  return true;
+}
+
+static void spiAsyncReadComplete(void)
+{
+  // The RX stream completes after the TX stream, but the TX interrupt may not have been served yet
+  spiTxDMAStop();
+  spiChipDeselect(asyncReadDevId);
+
+  // Release the bus before the callback, it may start the next read
+  const sensorsBmi088SpiReadCallback_t callback = asyncReadCallback;
+  asyncReadCallback = 0;
+  callback(&spiRxBuffer[1]);
+}
+#endif
+
 void __attribute__((used)) BMI088_SPI_TX_DMA_IRQHandler(void)
 {
   portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
-  // Stop and cleanup DMA stream
-  DMA_ITConfig(BMI088_SPI_TX_DMA_STREAM, DMA_IT_TC, DISABLE);
-  DMA_ClearITPendingBit(BMI088_SPI_TX_DMA_STREAM, BMI088_SPI_TX_DMA_FLAG_TCIF);
-
-  // Clear stream flags
-  DMA_ClearFlag(BMI088_SPI_TX_DMA_STREAM,BMI088_SPI_TX_DMA_FLAG_TCIF);
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  // The stream may already have been stopped by the completion of an asynchronous read, and a new read
+  // been started
+  if (DMA_GetFlagStatus(BMI088_SPI_TX_DMA_STREAM, BMI088_SPI_TX_DMA_FLAG_TCIF) == RESET)
+  {
+    return;
+  }
+#endif
 
-  // Disable SPI DMA requests
-  SPI_I2S_DMACmd(BMI088_SPI, SPI_I2S_DMAReq_Tx, DISABLE);
+  spiTxDMAStop();
 
-  // Disable streams
-  DMA_Cmd(BMI088_SPI_TX_DMA_STREAM, DISABLE);
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  // Asynchronous reads are completed by the RX stream only
+  if (asyncReadCallback)
+  {
+    return;
+  }
+#endif
 
   // Give the semaphore, allowing the SPI transaction to complete
   xSemaphoreGiveFromISR(spiTxDMAComplete, &xHigherPriorityTaskWoken);
@@ -402,6 +522,14 @@ void __attribute__((used)) BMI088_SPI_RX_DMA_IRQHandler(void)
   // Disable streams
   DMA_Cmd(BMI088_SPI_RX_DMA_STREAM, DISABLE);
 
+#ifdef CONFIG_SENSORS_BMI088_SPI_ASYNC
+  if (asyncReadCallback)
+  {
+    spiAsyncReadComplete();
+    return;
+  }
+#endif
+
   // Give the semaphore, allowing the SPI transaction to complete
   xSemaphoreGiveFromISR(spiRxDMAComplete, &xHigherPriorityTaskWoken);
 
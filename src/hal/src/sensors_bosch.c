@@ -51,6 +51,7 @@
 #include "ledseq.h"
 #include "sound.h"
 #include "filter.h"
+#include "welford.h"
 
 /* Bosch Sensortec Drivers */
 #include "bmi055.h"
@@ -137,11 +138,9 @@ static uint8_t accelSecInUse =          SENSORS_BMI160;
 
 typedef struct {
   Axis3i16      value;
-  Axis3i16*     bufStart;
-  Axis3i16*     bufPtr;
+  // Statistics of the current window of SENSORS_NBR_OF_BIAS_SAMPLES samples, per axis
+  welford_t     stats[GYRO_NBR_OF_AXES];
   uint8_t       found : 1;
-  uint8_t       ongoing : 1;
-  uint8_t       bufIsFull : 1;
 } BiasObj;
 
 /* initialize necessary variables */
@@ -199,9 +198,8 @@ static void sensorsAccIIRLPFilter(Axis3i16* in, Axis3i16* out,
                                   Axis3i32* storedValues, int32_t attenuation);
 static void sensorsAccAlignToGravity(Axis3f* in, Axis3f* out);
 static void sensorsBiasReset(BiasObj* bias);
-static void sensorsBiasMalloc(BiasObj* bias);
-static void sensorsBiasFree(BiasObj* bias);
-static void sensorsBiasBufPtrIncrement(BiasObj* bias);
+static void sensorsBiasWindowReset(BiasObj* bias);
+static void sensorsBiasAddValue(BiasObj* bias, const Axis3i16* value);
 
 STATIC_MEM_TASK_ALLOC(sensorsTask, SENSORS_TASK_STACKSIZE);
 
@@ -438,19 +436,15 @@ static void sensorsAccelGet(Axis3i16* dataOut, uint8_t device) {
 static void sensorsGyroCalibrate(BiasObj* gyro, uint8_t type) {
   if (gyro->found == 0)
     {
-      if (gyro->ongoing == 0)
-        {
-          sensorsBiasMalloc(gyro);
-        }
-      /* write directly into buffer */
-      sensorsGyroGet(gyro->bufPtr, type);
+      Axis3i16 sample;
+      sensorsGyroGet(&sample, type);
       /* FIXME: for sensor deck v1 realignment has to be added her */
-      sensorsBiasBufPtrIncrement(gyro);
+      sensorsBiasAddValue(gyro, &sample);
 
-      if (gyro->bufIsFull == 1)
+      if (gyro->stats[0].count >= SENSORS_NBR_OF_BIAS_SAMPLES)
         {
-          if (processGyroBias(gyro))
-            sensorsBiasFree(gyro);
+          processGyroBias(gyro);
+          sensorsBiasWindowReset(gyro);
         }
     }
 }
@@ -459,26 +453,25 @@ static void __attribute__((used))
 sensorsAccelCalibrate(BiasObj* accel, BiasObj* gyro, uint8_t type) {
   if (accel->found == 0)
     {
-      if (accel->ongoing == 0)
-        {
-          sensorsBiasMalloc(accel);
-        }
-      /* write directly into buffer */
-      sensorsAccelGet(accel->bufPtr, type);
+      Axis3i16 sample;
+      sensorsAccelGet(&sample, type);
       /* FIXME: for sensor deck v1 realignment has to be added her */
-      sensorsBiasBufPtrIncrement(accel);
-      if ( (accel->bufIsFull == 1) && (gyro->found == 1) )
+      sensorsBiasAddValue(accel, &sample);
+      if (accel->stats[0].count >= SENSORS_NBR_OF_BIAS_SAMPLES)
         {
-          processAccelBias(accel);
-          switch(type) {
-            case SENSORS_BMI160:
-              accel->value.z -= SENSORS_BMI160_1G_IN_LSB;
-              break;
-            case SENSORS_BMI055:
-              accel->value.z -= SENSORS_BMI055_1G_IN_LSB;
-              break;
-          }
-          sensorsBiasFree(accel);
+          if (gyro->found == 1)
+            {
+              processAccelBias(accel);
+              switch(type) {
+                case SENSORS_BMI160:
+                  accel->value.z -= SENSORS_BMI160_1G_IN_LSB;
+                  break;
+                case SENSORS_BMI055:
+                  accel->value.z -= SENSORS_BMI055_1G_IN_LSB;
+                  break;
+              }
+            }
+          sensorsBiasWindowReset(accel);
         }
     }
 }
@@ -658,11 +651,13 @@ static void sensorsTask(void *param)
 
       measurement.type = MeasurementTypeAcceleration;
       measurement.data.acceleration.acc = sensors.acc;
+      measurement.data.acceleration.sampleTimeUs = 0;
       estimatorEnqueue(&measurement);
       xQueueOverwrite(accelPrimDataQueue, &sensors.acc);
 
       measurement.type = MeasurementTypeGyroscope;
       measurement.data.gyroscope.gyro = sensors.gyro;
+      measurement.data.gyroscope.sampleTimeUs = 0;
       estimatorEnqueue(&measurement);
       xQueueOverwrite(gyroPrimDataQueue, &sensors.gyro);
 
@@ -690,24 +685,11 @@ void sensorsBoschWaitDataReady(void)
   xSemaphoreTake(dataReady, portMAX_DELAY);
 }
 
-static void sensorsBiasMalloc(BiasObj* bias)
-{
-  /* allocate memory for buffer */
-  bias->bufStart =
-      pvPortMalloc(SENSORS_NBR_OF_BIAS_SAMPLES * sizeof(Axis3i16));
-  bias->bufPtr = bias->bufStart;
-  /* set ongoing bit */
-  bias->ongoing = 1;
-}
-
 static void __attribute__((used)) sensorsBiasReset(BiasObj* bias)
 {
-  /* unset bias found and buffer full status bits */
+  /* unset bias found status bit and restart the statistics */
   bias->found = 0;
-  bias->bufIsFull = 0;
-  /* set bufPtr to start to ensure the buffer has to be refilled
-   * completly before bufferIsFull Status bit will be set */
-  bias->bufPtr = bias->bufStart;
+  sensorsBiasWindowReset(bias);
   /* clear any exisiting bias value */
   bias->value.x = 0;
   bias->value.y = 0;
@@ -715,73 +697,44 @@ static void __attribute__((used)) sensorsBiasReset(BiasObj* bias)
   allSensorsAreCalibrated = false;
 }
 
-static void sensorsBiasFree(BiasObj* bias)
+static void sensorsBiasWindowReset(BiasObj* bias)
 {
-  /* unset buffer is full */
-  bias->bufIsFull = 0;
-  /* free buffer memory */
-  vPortFree(bias->bufStart);
-  bias->bufStart = NULL;
-  bias->bufPtr = NULL;
+  for (int i = 0; i < GYRO_NBR_OF_AXES; i++)
+    {
+      welfordInit(&bias->stats[i]);
+    }
 }
 
 /**
- * Adds a new value to the variance buffer and if it is full
- * replaces the oldest one. Thus a circular buffer.
+ * Adds a new value to the statistics of the current window, in constant time
+ * and without keeping the samples.
  */
-static void sensorsBiasBufPtrIncrement(BiasObj* bias)
+static void sensorsBiasAddValue(BiasObj* bias, const Axis3i16* value)
 {
-  bias->bufPtr++;
-  if (bias->bufPtr >= bias->bufStart+SENSORS_NBR_OF_BIAS_SAMPLES)
-    {
-      bias->bufPtr = bias->bufStart;
-      bias->bufIsFull = 1;
-    }
+  welfordAdd(&bias->stats[0], value->x);
+  welfordAdd(&bias->stats[1], value->y);
+  welfordAdd(&bias->stats[2], value->z);
 }
 
 /**
- * Calculates the mean for the bias buffer.
+ * Calculates the mean for the current window of samples.
  */
 static void calcMean(BiasObj* bias, Axis3f* mean) {
-  Axis3i16* elem;
-  int64_t sum[GYRO_NBR_OF_AXES] = {0};
-
-  for (elem = bias->bufStart;
-       elem != (bias->bufStart+SENSORS_NBR_OF_BIAS_SAMPLES); elem++)
-    {
-      sum[0] += elem->x;
-      sum[1] += elem->y;
-      sum[2] += elem->z;
-    }
-
-  mean->x = (float)sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  mean->y = (float)sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  mean->z = (float)sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
+  mean->x = welfordMean(&bias->stats[0]);
+  mean->y = welfordMean(&bias->stats[1]);
+  mean->z = welfordMean(&bias->stats[2]);
 }
 
 /**
- * Calculates the variance and mean for the bias buffer.
+ * Calculates the variance and mean for the current window of samples.
  */
 static void calcVarianceAndMean(BiasObj* bias, Axis3f* variance, Axis3f* mean)
 {
-  Axis3i16* elem;
-  int64_t sumSquared[GYRO_NBR_OF_AXES] = {0};
-
-  for (elem = bias->bufStart;
-      elem != (bias->bufStart+SENSORS_NBR_OF_BIAS_SAMPLES); elem++)
-    {
-      sumSquared[0] += elem->x * elem->x;
-      sumSquared[1] += elem->y * elem->y;
-      sumSquared[2] += elem->z * elem->z;
-    }
   calcMean(bias, mean);
 
-  variance->x = fabs(sumSquared[0] / SENSORS_NBR_OF_BIAS_SAMPLES
-                     - mean->x * mean->x);
-  variance->y = fabs(sumSquared[1] / SENSORS_NBR_OF_BIAS_SAMPLES
-                     - mean->y * mean->y);
-  variance->z = fabs(sumSquared[2] / SENSORS_NBR_OF_BIAS_SAMPLES
-                     - mean->z * mean->z);
+  variance->x = welfordVariance(&bias->stats[0]);
+  variance->y = welfordVariance(&bias->stats[1]);
+  variance->z = welfordVariance(&bias->stats[2]);
 }
 
 /**
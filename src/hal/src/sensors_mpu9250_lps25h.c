@@ -49,9 +49,11 @@
 #include "ledseq.h"
 #include "sound.h"
 #include "filter.h"
+#include "welford.h"
 #include "static_mem.h"
 #include "estimator.h"
 #include "platform_defaults.h"
+#include "boot_timeline.h"
 
 #define SENSORS_ENABLE_PRESSURE_LPS25H
 //#define GYRO_ADD_RAW_AND_VARIANCE_LOG_VALUES
@@ -95,9 +97,8 @@ typedef struct
   Axis3f     variance;
   Axis3f     mean;
   bool       isBiasValueFound;
-  bool       isBufferFilled;
-  Axis3i16*  bufHead;
-  Axis3i16   buffer[SENSORS_NBR_OF_BIAS_SAMPLES];
+  // Statistics of the current window of SENSORS_NBR_OF_BIAS_SAMPLES samples, per axis
+  welford_t  stats[GYRO_NBR_OF_AXES];
 } BiasObj;
 
 static xQueueHandle accelerometerDataQueue;
@@ -132,9 +133,8 @@ static float accScale = 1;
 // Low Pass filtering
 #define GYRO_LPF_CUTOFF_FREQ  80
 #define ACCEL_LPF_CUTOFF_FREQ 30
-static lpf2pData accLpf[3];
-static lpf2pData gyroLpf[3];
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in);
+static biquadBank_t accLpf;
+static biquadBank_t gyroLpf;
 
 static bool isBarometerPresent = false;
 static bool isMagnetometerPresent = false;
@@ -172,7 +172,6 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz,  Axis3f *gyroBia
 static bool processAccScale(int16_t ax, int16_t ay, int16_t az);
 static void sensorsBiasObjInit(BiasObj* bias);
 static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut);
-static void sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut);
 static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z);
 static bool sensorsFindBiasValue(BiasObj* bias);
 static void sensorsAlignToAirframe(Axis3f* in, Axis3f* out);
@@ -246,11 +245,13 @@ static void sensorsTask(void *param)
 
       measurement.type = MeasurementTypeAcceleration;
       measurement.data.acceleration.acc = sensorData.acc;
+      measurement.data.acceleration.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
       estimatorEnqueue(&measurement);
       xQueueOverwrite(accelerometerDataQueue, &sensorData.acc);
 
       measurement.type = MeasurementTypeGyroscope;
       measurement.data.gyroscope.gyro = sensorData.gyro;
+      measurement.data.gyroscope.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
       estimatorEnqueue(&measurement);
       xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
       if (isMagnetometerPresent)
@@ -336,14 +337,14 @@ void processAccGyroMeasurements(const uint8_t *buffer)
   gyroScaledIMU.y =  (gyroRaw.y - gyroBias.y) * SENSORS_DEG_PER_LSB_CFG;
   gyroScaledIMU.z =  (gyroRaw.z - gyroBias.z) * SENSORS_DEG_PER_LSB_CFG;
   sensorsAlignToAirframe(&gyroScaledIMU, &sensorData.gyro);
-  applyAxis3fLpf((lpf2pData*)(&gyroLpf), &sensorData.gyro);
+  biquadBankApply(&gyroLpf, sensorData.gyro.axis);
 
   accScaledIMU.x = -(accelRaw.x) * SENSORS_G_PER_LSB_CFG / accScale;
   accScaledIMU.y =  (accelRaw.y) * SENSORS_G_PER_LSB_CFG / accScale;
   accScaledIMU.z =  (accelRaw.z) * SENSORS_G_PER_LSB_CFG / accScale;
   sensorsAlignToAirframe(&accScaledIMU, &accScaled);
   sensorsAccAlignToGravity(&accScaled, &sensorData.acc);
-  applyAxis3fLpf((lpf2pData*)(&accLpf), &sensorData.acc);
+  biquadBankApply(&accLpf, sensorData.acc.axis);
 }
 
 static void sensorsDeviceInit(void)
@@ -395,11 +396,8 @@ static void sensorsDeviceInit(void)
   // Set digital low-pass bandwidth for gyro
   mpu6500SetDLPFMode(MPU6500_DLPF_BW_98);
   // Init second order filer for accelerometer
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    lpf2pInit(&gyroLpf[i], 1000, GYRO_LPF_CUTOFF_FREQ);
-    lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-  }
+  biquadBankInitLowPass(&gyroLpf, 3, 1000, GYRO_LPF_CUTOFF_FREQ);
+  biquadBankInitLowPass(&accLpf, 3, 1000, ACCEL_LPF_CUTOFF_FREQ);
 
 
 #ifdef SENSORS_ENABLE_MAG_AK8963
@@ -679,6 +677,7 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBias
     {
       soundSetEffect(SND_CALIB);
       ledseqRun(&seq_calibrated);
+      bootTimelineMark("gyroBiasFound");
     }
   }
 
@@ -692,75 +691,33 @@ static bool processGyroBias(int16_t gx, int16_t gy, int16_t gz, Axis3f *gyroBias
 
 static void sensorsBiasObjInit(BiasObj* bias)
 {
-  bias->isBufferFilled = false;
-  bias->bufHead = bias->buffer;
-}
-
-/**
- * Calculates the variance and mean for the bias buffer.
- */
-static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
-{
-  uint32_t i;
-  int64_t sum[GYRO_NBR_OF_AXES] = {0};
-  int64_t sumSq[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
+  for (int i = 0; i < GYRO_NBR_OF_AXES; i++)
   {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
-    sumSq[0] += bias->buffer[i].x * bias->buffer[i].x;
-    sumSq[1] += bias->buffer[i].y * bias->buffer[i].y;
-    sumSq[2] += bias->buffer[i].z * bias->buffer[i].z;
+    welfordInit(&bias->stats[i]);
   }
-
-
-  meanOut->x = (float) sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = (float) sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = (float) sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
-
-  varOut->x = sumSq[0] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->x * meanOut->x;
-  varOut->y = sumSq[1] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->y * meanOut->y;
-  varOut->z = sumSq[2] / SENSORS_NBR_OF_BIAS_SAMPLES - meanOut->z * meanOut->z;
 }
 
 /**
- * Calculates the mean for the bias buffer.
+ * Calculates the variance and mean for the current window of samples.
  */
-static void __attribute__((used)) sensorsCalculateBiasMean(BiasObj* bias, Axis3i32* meanOut)
+static void sensorsCalculateVarianceAndMean(BiasObj* bias, Axis3f* varOut, Axis3f* meanOut)
 {
-  uint32_t i;
-  int32_t sum[GYRO_NBR_OF_AXES] = {0};
-
-  for (i = 0; i < SENSORS_NBR_OF_BIAS_SAMPLES; i++)
+  for (int i = 0; i < GYRO_NBR_OF_AXES; i++)
   {
-    sum[0] += bias->buffer[i].x;
-    sum[1] += bias->buffer[i].y;
-    sum[2] += bias->buffer[i].z;
+    meanOut->axis[i] = welfordMean(&bias->stats[i]);
+    varOut->axis[i] = welfordVariance(&bias->stats[i]);
   }
-
-  meanOut->x = sum[0] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->y = sum[1] / SENSORS_NBR_OF_BIAS_SAMPLES;
-  meanOut->z = sum[2] / SENSORS_NBR_OF_BIAS_SAMPLES;
 }
 
 /**
- * Adds a new value to the variance buffer and if it is full
- * replaces the oldest one. Thus a circular buffer.
+ * Adds a new value to the statistics of the current window, in constant time
+ * and without keeping the samples.
  */
 static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z)
 {
-  bias->bufHead->x = x;
-  bias->bufHead->y = y;
-  bias->bufHead->z = z;
-  bias->bufHead++;
-
-  if (bias->bufHead >= &bias->buffer[SENSORS_NBR_OF_BIAS_SAMPLES])
-  {
-    bias->bufHead = bias->buffer;
-    bias->isBufferFilled = true;
-  }
+  welfordAdd(&bias->stats[0], x);
+  welfordAdd(&bias->stats[1], y);
+  welfordAdd(&bias->stats[2], z);
 }
 
 /**
@@ -773,9 +730,11 @@ static bool sensorsFindBiasValue(BiasObj* bias)
   static int32_t varianceSampleTime;
   bool foundBias = false;
 
-  if (bias->isBufferFilled)
+  if (bias->stats[0].count >= SENSORS_NBR_OF_BIAS_SAMPLES)
   {
     sensorsCalculateVarianceAndMean(bias, &bias->variance, &bias->mean);
+    // Start the next window
+    sensorsBiasObjInit(bias);
 
     if (bias->variance.x < GYRO_VARIANCE_THRESHOLD_X &&
         bias->variance.y < GYRO_VARIANCE_THRESHOLD_Y &&
@@ -927,29 +886,16 @@ void sensorsMpu9250Lps25hSetAccMode(accModes accMode)
   {
     case ACC_MODE_PROPTEST:
       mpu6500SetAccelDLPF(MPU6500_ACCEL_DLPF_BW_460);
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, 500);
-      }
+      biquadBankInitLowPass(&accLpf, 3, 1000, 500);
       break;
     case ACC_MODE_FLIGHT:
     default:
       mpu6500SetAccelDLPF(MPU6500_ACCEL_DLPF_BW_41);
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
-      }
+      biquadBankInitLowPass(&accLpf, 3, 1000, ACCEL_LPF_CUTOFF_FREQ);
       break;
   }
 }
 
-static void applyAxis3fLpf(lpf2pData *data, Axis3f* in)
-{
-  for (uint8_t i = 0; i < 3; i++) {
-    in->axis[i] = lpf2pApply(&data[i], in->axis[i]);
-  }
-}
-
 #ifdef GYRO_ADD_RAW_AND_VARIANCE_LOG_VALUES
 LOG_GROUP_START(gyro)
 LOG_ADD(LOG_INT16, xRaw, &gyroRaw.x)
@@ -0,0 +1,258 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sensors_sim.c - Simulated sensors, driven by a quadrotor model and the motor commands
+ */
+
+/**
+ * The sensor data is generated by a rigid body model of the Crazyflie (sim_quadrotor.c) that is advanced one step per
+ * tick with the current motor commands. The model runs in a task of its own with the same timing and queues as the
+ * real sensor drivers, so the stabilizer, the estimators and the commander run unmodified on top of it.
+ *
+ * The simulation time follows the FreeRTOS tick, one model step of 1 ms per tick. On a port where the tick is not
+ * tied to the wall clock, the whole firmware runs faster (or slower) than real time.
+ */
+
+#define DEBUG_MODULE "SIMSENS"
+
+#include "sensors_sim.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "system.h"
+#include "log.h"
+#include "param.h"
+#include "debug.h"
+#include "static_mem.h"
+#include "estimator.h"
+#include "motors.h"
+#include "usec_time.h"
+#include "sim_quadrotor.h"
+
+#define SENSORS_SIM_READ_RATE_HZ 1000
+#define SENSORS_SIM_READ_BARO_HZ 50
+#define SENSORS_SIM_DELAY_BARO (SENSORS_SIM_READ_RATE_HZ / SENSORS_SIM_READ_BARO_HZ)
+
+static xQueueHandle accelerometerDataQueue;
+STATIC_MEM_QUEUE_ALLOC(accelerometerDataQueue, 1, sizeof(Axis3f));
+static xQueueHandle gyroDataQueue;
+STATIC_MEM_QUEUE_ALLOC(gyroDataQueue, 1, sizeof(Axis3f));
+static xQueueHandle barometerDataQueue;
+STATIC_MEM_QUEUE_ALLOC(barometerDataQueue, 1, sizeof(baro_t));
+
+static xSemaphoreHandle dataReady;
+static StaticSemaphore_t dataReadyBuffer;
+
+static bool isInit = false;
+static sensorData_t sensorData;
+static simQuadrotor_t model;
+
+// Start position of the model, applied when reset is set
+static float startX;
+static float startY;
+static float startYaw;
+static uint8_t reset;
+
+STATIC_MEM_TASK_ALLOC(sensorsSimTask, SENSORS_TASK_STACKSIZE);
+
+static void resetModel(void) {
+  simQuadrotorParams_t params;
+  simQuadrotorDefaultParams(&params);
+  simQuadrotorInit(&model, &params, mkvec(startX, startY, 0.0f), radians(startYaw));
+}
+
+static void sensorsSimTask(void *param) {
+  systemWaitStart();
+
+  measurement_t measurement;
+  uint16_t motorRatio[STABILIZER_NR_OF_MOTORS];
+  uint8_t baroDelay = SENSORS_SIM_DELAY_BARO;
+  const float dt = 1.0f / SENSORS_SIM_READ_RATE_HZ;
+
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  while (1) {
+    vTaskDelayUntil(&lastWakeTime, F2T(SENSORS_SIM_READ_RATE_HZ));
+
+    if (reset) {
+      resetModel();
+      reset = 0;
+    }
+
+    for (int i = 0; i < STABILIZER_NR_OF_MOTORS; i++) {
+      motorRatio[i] = motorsGetRatio(i);
+    }
+    simQuadrotorStep(&model, motorRatio, dt);
+
+    sensorData.interruptTimestamp = usecTimestamp();
+    simQuadrotorGetGyro(&model, &sensorData.gyro);
+    simQuadrotorGetAcc(&model, &sensorData.acc);
+
+    measurement.type = MeasurementTypeGyroscope;
+    measurement.data.gyroscope.gyro = sensorData.gyro;
+    measurement.data.gyroscope.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
+    estimatorEnqueue(&measurement);
+
+    measurement.type = MeasurementTypeAcceleration;
+    measurement.data.acceleration.acc = sensorData.acc;
+    measurement.data.acceleration.sampleTimeUs = (uint32_t)sensorData.interruptTimestamp;
+    estimatorEnqueue(&measurement);
+
+    if (--baroDelay == 0) {
+      simQuadrotorGetBaro(&model, &sensorData.baro);
+
+      measurement.type = MeasurementTypeBarometer;
+      measurement.data.barometer.baro = sensorData.baro;
+      estimatorEnqueue(&measurement);
+
+      xQueueOverwrite(barometerDataQueue, &sensorData.baro);
+      baroDelay = SENSORS_SIM_DELAY_BARO;
+    }
+
+    xQueueOverwrite(accelerometerDataQueue, &sensorData.acc);
+    xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
+
+    xSemaphoreGive(dataReady);
+  }
+}
+
+void sensorsSimInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  resetModel();
+
+  accelerometerDataQueue = STATIC_MEM_QUEUE_CREATE(accelerometerDataQueue);
+  gyroDataQueue = STATIC_MEM_QUEUE_CREATE(gyroDataQueue);
+  barometerDataQueue = STATIC_MEM_QUEUE_CREATE(barometerDataQueue);
+  dataReady = xSemaphoreCreateBinaryStatic(&dataReadyBuffer);
+
+  STATIC_MEM_TASK_CREATE(sensorsSimTask, sensorsSimTask, SENSORS_TASK_NAME, NULL, SENSORS_TASK_PRI);
+
+  DEBUG_PRINT("Using simulated sensors\n");
+  isInit = true;
+}
+
+bool sensorsSimTest(void) {
+  return isInit;
+}
+
+bool sensorsSimAreCalibrated(void) {
+  // The simulated gyro has no bias
+  return true;
+}
+
+bool sensorsSimManufacturingTest(void) {
+  return true;
+}
+
+void sensorsSimAcquire(sensorData_t *sensors) {
+  sensorsReadGyro(&sensors->gyro);
+  sensorsReadAcc(&sensors->acc);
+  sensorsReadMag(&sensors->mag);
+  sensorsReadBaro(&sensors->baro);
+  sensors->interruptTimestamp = sensorData.interruptTimestamp;
+}
+
+void sensorsSimWaitDataReady(void) {
+  xSemaphoreTake(dataReady, portMAX_DELAY);
+}
+
+bool sensorsSimReadGyro(Axis3f *gyro) {
+  return (pdTRUE == xQueueReceive(gyroDataQueue, gyro, 0));
+}
+
+bool sensorsSimReadAcc(Axis3f *acc) {
+  return (pdTRUE == xQueueReceive(accelerometerDataQueue, acc, 0));
+}
+
+bool sensorsSimReadMag(Axis3f *mag) {
+  // No magnetometer
+  return false;
+}
+
+bool sensorsSimReadBaro(baro_t *baro) {
+  return (pdTRUE == xQueueReceive(barometerDataQueue, baro, 0));
+}
+
+void sensorsSimSetAccMode(accModes accMode) {
+  // Nothing to configure
+}
+
+/**
+ * Ground truth of the simulated sensors
+ */
+LOG_GROUP_START(simSens)
+/**
+ * @brief True position X [m]
+ */
+LOG_ADD(LOG_FLOAT, x, &model.position.x)
+/**
+ * @brief True position Y [m]
+ */
+LOG_ADD(LOG_FLOAT, y, &model.position.y)
+/**
+ * @brief True position Z [m]
+ */
+LOG_ADD(LOG_FLOAT, z, &model.position.z)
+/**
+ * @brief True velocity X [m/s]
+ */
+LOG_ADD(LOG_FLOAT, vx, &model.velocity.x)
+/**
+ * @brief True velocity Y [m/s]
+ */
+LOG_ADD(LOG_FLOAT, vy, &model.velocity.y)
+/**
+ * @brief True velocity Z [m/s]
+ */
+LOG_ADD(LOG_FLOAT, vz, &model.velocity.z)
+/**
+ * @brief Nonzero when the model rests on the ground
+ */
+LOG_ADD(LOG_UINT8, onGround, &model.isOnGround)
+LOG_GROUP_STOP(simSens)
+
+/**
+ * Simulated sensors
+ */
+PARAM_GROUP_START(simSens)
+/**
+ * @brief Start position X, used at the next reset [m]
+ */
+PARAM_ADD(PARAM_FLOAT, startX, &startX)
+/**
+ * @brief Start position Y, used at the next reset [m]
+ */
+PARAM_ADD(PARAM_FLOAT, startY, &startY)
+/**
+ * @brief Start yaw, used at the next reset [deg]
+ */
+PARAM_ADD(PARAM_FLOAT, startYaw, &startYaw)
+/**
+ * @brief Set to nonzero to put the model back at rest at the start position
+ */
+PARAM_ADD(PARAM_UINT8, reset, &reset)
+PARAM_GROUP_STOP(simSens)
@@ -28,11 +28,17 @@
 
 #include "storage.h"
 #include "param.h"
+#include "log.h"
+#include "worker.h"
+#include "pm.h"
 
 #include "kve/kve.h"
+#include "kve/kve_index.h"
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "timers.h"
+#include "task.h"
 
 #include "i2cdev.h"
 #include "eeprom.h"
@@ -62,7 +68,53 @@
 #define DEFRAG_ON_STARTUP DEFAULT_DEFRAG_ON_STARTUP
 #endif
 
+#ifdef CONFIG_STORAGE_CACHE_ENTRIES
+#define CACHE_ENTRIES CONFIG_STORAGE_CACHE_ENTRIES
+#else
+#define CACHE_ENTRIES 16
+#endif
+
+#ifdef CONFIG_STORAGE_CACHE_DATA_SIZE
+#define CACHE_DATA_SIZE CONFIG_STORAGE_CACHE_DATA_SIZE
+#else
+#define CACHE_DATA_SIZE 8
+#endif
+
+// Including the terminating null, longer keys are not cached
+#define CACHE_KEY_SIZE 40
+
+// Cached writes are flushed to the EEPROM when they have not been replaced for this long
+#define CACHE_FLUSH_DELAY M2T(500)
+
+// Background work, flushing the cache and compacting the holes left by
+// deletes, is done one EEPROM write at a time every period
+#define WORK_PERIOD M2T(100)
+
+// Max time for storageFlush() to wait for the EEPROM writes
+#define STORAGE_FLUSH_TIMEOUT M2T(2000)
+
+// Write-back cache of the small items, like parameter values. An entry is
+// free if the key is empty and waits to be written to the EEPROM if dirty.
+typedef struct {
+  char key[CACHE_KEY_SIZE];
+  uint8_t data[CACHE_DATA_SIZE];
+  uint8_t length;
+  bool dirty;
+  TickType_t dirtySince;
+} cacheEntry_t;
+
+static cacheEntry_t cache[CACHE_ENTRIES];
+
 static SemaphoreHandle_t storageMutex;
+static StaticTimer_t workTimerBuffer;
+static bool defragPending;
+static bool workScheduled;
+static uint32_t cacheHits;
+static uint32_t cacheFlushes;
+
+// Fragmentation in %, as in storagePrintStats, and number of background steps done
+static uint8_t fragmentation;
+static uint32_t defragSteps;
 
 static size_t readEeprom(size_t address, void* data, size_t length)
 {
@@ -95,7 +147,8 @@ static size_t writeEeprom(size_t address, const void* data, size_t length)
     return 0;
   }
 
-  bool success = eepromWriteBuffer(data, KVE_PARTITION_START + address, length);
+  // Written in the background, in order. Reads see the data directly.
+  bool success = eepromWriteBufferAsync(data, KVE_PARTITION_START + address, length, 0, 0);
 
 #if TRACE_MEMORY_ACCESS
   DEBUG_PRINT("W %s @%04x: ", success?" OK ":"FAIL", address);
@@ -116,20 +169,185 @@ static size_t writeEeprom(size_t address, const void* data, size_t length)
 
 static void flushEeprom(void)
 {
-  // NOP for now, lets fix the EEPROM write first!
+  // NOP, the EEPROM driver keeps the write order. storageFlush() waits for
+  // the writes to be done.
 }
 
+// Index of the stored keys, 4 bytes per slot. Holds up to 3/4 of the slots
+// in items, lookups fall back to walking the table with more items stored.
+#define KVE_INDEX_SIZE 128
+static kveIndexSlot_t kveIndexSlots[KVE_INDEX_SIZE];
+static kveIndex_t kveIndex = {
+  .slots = kveIndexSlots,
+  .size = KVE_INDEX_SIZE,
+};
+
 static kveMemory_t kve = {
   .memorySize = KVE_PARTITION_LENGTH,
   .read = readEeprom,
   .write = writeEeprom,
   .flush = flushEeprom,
+  .index = &kveIndex,
 };
 
 // Public API
 
 static bool isInit = false;
 
+static void updateFragmentation(void)
+{
+  kveStats_t stats;
+
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+  kveGetStats(&kve, &stats);
+  xSemaphoreGive(storageMutex);
+
+  fragmentation = stats.fragmentation;
+}
+
+// Cache functions, to be called with the storage mutex taken
+
+static cacheEntry_t* cacheFind(const char *key)
+{
+  for (int i = 0; i < CACHE_ENTRIES; i++) {
+    if (cache[i].key[0] && strcmp(cache[i].key, key) == 0) {
+      return &cache[i];
+    }
+  }
+
+  return NULL;
+}
+
+static bool cacheFlushEntry(cacheEntry_t *entry)
+{
+  if (!entry->dirty) {
+    return true;
+  }
+
+  bool result = kveStore(&kve, entry->key, entry->data, entry->length);
+  if (!result) {
+    // Do not retry forever, the write is lost as it would have been without cache
+    DEBUG_PRINT("Error: cannot write %s\n", entry->key);
+    entry->key[0] = 0;
+  }
+
+  entry->dirty = false;
+  cacheFlushes++;
+  defragPending = true;
+
+  return result;
+}
+
+static bool cacheFlushAll(void)
+{
+  bool result = true;
+
+  for (int i = 0; i < CACHE_ENTRIES; i++) {
+    result = cacheFlushEntry(&cache[i]) && result;
+  }
+
+  return result;
+}
+
+static cacheEntry_t* cacheAllocate(void)
+{
+  cacheEntry_t *oldest = NULL;
+
+  for (int i = 0; i < CACHE_ENTRIES; i++) {
+    if (!cache[i].dirty) {
+      return &cache[i];
+    }
+
+    if (!oldest || (int32_t)(cache[i].dirtySince - oldest->dirtySince) < 0) {
+      oldest = &cache[i];
+    }
+  }
+
+  // All entries are waiting to be written, make room
+  cacheFlushEntry(oldest);
+  return oldest;
+}
+
+static void cacheDrop(const char *key)
+{
+  cacheEntry_t *entry = cacheFind(key);
+  if (entry) {
+    entry->key[0] = 0;
+    entry->dirty = false;
+  }
+}
+
+static cacheEntry_t* cacheFindExpired(void)
+{
+  const TickType_t now = xTaskGetTickCount();
+
+  for (int i = 0; i < CACHE_ENTRIES; i++) {
+    if (cache[i].dirty && (now - cache[i].dirtySince) >= CACHE_FLUSH_DELAY) {
+      return &cache[i];
+    }
+  }
+
+  return NULL;
+}
+
+static bool cacheIsDirty(void)
+{
+  for (int i = 0; i < CACHE_ENTRIES; i++) {
+    if (cache[i].dirty) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void storageWorker(void *arg)
+{
+  // Each EEPROM write is done with the mutex taken separately, storage users
+  // wait for at most one item write or move
+  bool flushed = true;
+  while (flushed) {
+    xSemaphoreTake(storageMutex, portMAX_DELAY);
+    cacheEntry_t *entry = cacheFindExpired();
+    flushed = entry != NULL;
+    if (flushed) {
+      cacheFlushEntry(entry);
+    }
+    xSemaphoreGive(storageMutex);
+  }
+
+  if (defragPending) {
+    xSemaphoreTake(storageMutex, portMAX_DELAY);
+    bool moreToDo = kveDefragStep(&kve);
+    xSemaphoreGive(storageMutex);
+
+    if (moreToDo) {
+      defragSteps++;
+    } else {
+      defragPending = false;
+    }
+
+    updateFragmentation();
+  }
+
+  workScheduled = false;
+}
+
+static void workTimer(xTimerHandle timer)
+{
+  if ((defragPending || cacheIsDirty()) && !workScheduled) {
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW};
+    if (workerScheduleWithOptions(storageWorker, NULL, &options) == 0) {
+      workScheduled = true;
+    }
+  }
+}
+
+static void storageGracefulShutdown()
+{
+  storageFlush();
+}
+
 void storageInit()
 {
   storageMutex = xSemaphoreCreateMutex();
@@ -138,6 +356,12 @@ void storageInit()
   if (DEFRAG_ON_STARTUP) {
     kveDefrag(&kve);
   }
+
+  defragPending = true;
+  xTimerHandle timer = xTimerCreateStatic("storageTimer", WORK_PERIOD, pdTRUE, NULL, workTimer, &workTimerBuffer);
+  xTimerStart(timer, 100);
+
+  pmRegisterGracefulShutdownCallback(storageGracefulShutdown);
 }
 
 bool storageTest()
@@ -163,9 +387,47 @@ bool storageStore(const char* key, const void* buffer, size_t length)
     return false;
   }
 
+  bool result = true;
+
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+
+  if (length <= CACHE_DATA_SIZE && strlen(key) < CACHE_KEY_SIZE) {
+    cacheEntry_t *entry = cacheFind(key);
+    if (!entry) {
+      entry = cacheAllocate();
+      strcpy(entry->key, key);
+    }
+
+    // Repeated writes of the same key only update the cache
+    if (!entry->dirty) {
+      entry->dirty = true;
+      entry->dirtySince = xTaskGetTickCount();
+    }
+    memcpy(entry->data, buffer, length);
+    entry->length = length;
+  } else {
+    cacheDrop(key);
+    result = kveStore(&kve, key, buffer, length);
+
+    // Replacing an item with one of another size leaves a hole
+    defragPending = true;
+  }
+
+  xSemaphoreGive(storageMutex);
+
+  return result;
+}
+
+bool storageFlush()
+{
+  if (!isInit) {
+    return false;
+  }
+
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
-  bool result = kveStore(&kve, key, buffer, length);
+  bool result = cacheFlushAll();
+  result = eepromWaitIdle(STORAGE_FLUSH_TIMEOUT) && result;
 
   xSemaphoreGive(storageMutex);
 
@@ -181,6 +443,8 @@ bool storageForeach(const char *prefix, storageFunc_t func)
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
+  // The items are iterated from the EEPROM
+  cacheFlushAll();
   bool success = kveForeach(&kve, prefix, func);
 
   xSemaphoreGive(storageMutex);
@@ -194,9 +458,18 @@ size_t storageFetch(const char *key, void* buffer, size_t length)
     return 0;
   }
 
+  size_t result;
+
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
-  size_t result = kveFetch(&kve, key, buffer, length);
+  cacheEntry_t *entry = cacheFind(key);
+  if (entry) {
+    result = (length < entry->length) ? length : entry->length;
+    memcpy(buffer, entry->data, result);
+    cacheHits++;
+  } else {
+    result = kveFetch(&kve, key, buffer, length);
+  }
 
   xSemaphoreGive(storageMutex);
 
@@ -211,10 +484,17 @@ bool storageDelete(const char* key)
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
-  bool result = kveDelete(&kve, key);
+  // The item may not have been written to the EEPROM yet
+  cacheEntry_t *entry = cacheFind(key);
+  bool wasCached = entry && entry->dirty;
+  cacheDrop(key);
+
+  bool result = kveDelete(&kve, key) || wasCached;
 
   xSemaphoreGive(storageMutex);
 
+  defragPending = result || defragPending;
+
   return result;
 }
 
@@ -223,6 +503,7 @@ bool storageReformat() {
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
+  memset(cache, 0, sizeof(cache));
   kveFormat(&kve);
   bool pass = kveCheck(&kve);
 
@@ -243,17 +524,20 @@ void storagePrintStats()
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
+  cacheFlushAll();
   kveGetStats(&kve, &stats);
 
   xSemaphoreGive(storageMutex);
 
 
   DEBUG_PRINT("Used storage: %d item stored, %d Bytes/%d Bytes (%d%%)\n", stats.totalItems, stats.itemSize, stats.totalSize, (stats.itemSize*100)/stats.totalSize);
-  DEBUG_PRINT("Fragmentation: %d%%\n", stats.fragmentation);
+  DEBUG_PRINT("Fragmentation: %d%%, %d background defrag steps\n", stats.fragmentation, defragSteps);
   DEBUG_PRINT("Efficiency: Data: %d Bytes (%d%%), Keys: %d Bytes (%d%%), Metadata: %d Bytes (%d%%)\n",
     stats.dataSize, (stats.dataSize*100)/stats.totalSize,
     stats.keySize, (stats.keySize*100)/stats.totalSize,
     stats.metadataSize, (stats.metadataSize*100)/stats.totalSize);
+  DEBUG_PRINT("Index: %d items, %d Bytes RAM\n", stats.indexItems, stats.indexSize);
+  DEBUG_PRINT("Cache: %d entries, %d hits, %d writes to EEPROM\n", CACHE_ENTRIES, cacheHits, cacheFlushes);
 }
 
 static bool storageStats;
@@ -289,3 +573,30 @@ PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, storageStats, &storageStats, printStats)
 PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, storageReformat, &reformatValue, doReformat)
 
 PARAM_GROUP_STOP(system)
+
+/**
+ * Persistent storage
+ */
+LOG_GROUP_START(storage)
+
+/**
+ * @brief Part of the free space taken by holes left by deleted items [%]
+ */
+LOG_ADD(LOG_UINT8, frag, &fragmentation)
+
+/**
+ * @brief Number of background defragmentation steps done
+ */
+LOG_ADD(LOG_UINT32, defragSteps, &defragSteps)
+
+/**
+ * @brief Number of fetches served by the write-back cache
+ */
+LOG_ADD(LOG_UINT32, cacheHits, &cacheHits)
+
+/**
+ * @brief Number of cached items written to the EEPROM
+ */
+LOG_ADD(LOG_UINT32, cacheFlushes, &cacheFlushes)
+
+LOG_GROUP_STOP(storage)
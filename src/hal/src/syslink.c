@@ -160,7 +160,7 @@ int syslinkSendPacket(SyslinkPacket *slp)
   sendBuffer[dataSize-2] = cksum[0];
   sendBuffer[dataSize-1] = cksum[1];
 
-  uartslkSendDataDmaBlocking(dataSize, sendBuffer);
+  uartslkSendDataDma(dataSize, sendBuffer);
 
   xSemaphoreGive(syslinkAccess);
 
@@ -48,6 +48,7 @@
 #include "usbd_req.h"
 
 #include "crtp.h"
+#include "log.h"
 #include "static_mem.h"
 #include "vcp_esc_passthrough.h"
 #include "bootloader.h"
@@ -67,6 +68,29 @@ STATIC_MEM_QUEUE_ALLOC(usbDataRx, 5, sizeof(USBPacket)); /* Buffer USB packets (
 static xQueueHandle usbDataTx;
 STATIC_MEM_QUEUE_ALLOC(usbDataTx, 1, sizeof(USBPacket)); /* Buffer USB packets (max 64 bytes) */
 
+/*
+ * Streaming mode, enabled by the host with the vendor request USB_CMD_ENABLE_CRTP_STREAM.
+ * Instead of one USB transfer per CRTP packet, outgoing packets are framed as
+ * [length][header][data...] in a byte stream that is sent in large bulk
+ * transfers, which lets the host read at full USB FS bandwidth.
+ */
+#define USB_CMD_ENABLE_CRTP         0x01
+#define USB_CMD_ENTER_BOOTLOADER    0x02
+#define USB_CMD_ENABLE_CRTP_STREAM  0x03
+
+#define USB_STREAM_BUFFER_SIZE      2048
+#define USB_STREAM_MAX_TRANSFER     (8 * USB_RX_TX_PACKET_SIZE)
+#define USB_STREAM_SEND_TIMEOUT_MS  100
+
+static bool streamMode = false;
+static uint8_t streamBuffer[USB_STREAM_BUFFER_SIZE];
+// Written by the sending task
+static volatile uint16_t streamHead;
+// Start of the data not yet acknowledged by the host, updated in the USB interrupt
+static volatile uint16_t streamTail;
+static uint16_t streamInFlight;
+static uint32_t streamOverflows;
+
 #define USB_CDC_CONFIG_DESC_SIZ     98
 
 #define CF_INTERFACE                0x0
@@ -326,6 +350,66 @@ static void resetUSB(void) {
 
   rxStopped = true;
   doingTransfer = false;
+
+  streamMode = false;
+  streamHead = 0;
+  streamTail = 0;
+  streamInFlight = 0;
+}
+
+/**
+ * Starts a transfer of the pending stream data, called from the USB interrupt.
+ * Only the contiguous part up to the end of the buffer is sent, the rest
+ * goes in the next transfer.
+ *
+ * @return true if a transfer was started
+ */
+static bool streamStartTransfer(void *pdev)
+{
+  const uint16_t head = streamHead;
+  if (head == streamTail)
+  {
+    return false;
+  }
+
+  uint16_t length = (head > streamTail) ? (head - streamTail) : (USB_STREAM_BUFFER_SIZE - streamTail);
+  if (length > USB_STREAM_MAX_TRANSFER)
+  {
+    length = USB_STREAM_MAX_TRANSFER;
+  }
+
+  streamInFlight = length;
+  DCD_EP_Tx(pdev, CF_IN_EP, &streamBuffer[streamTail], length);
+
+  return true;
+}
+
+static bool streamWrite(uint32_t size, const uint8_t* data)
+{
+  const uint16_t head = streamHead;
+  const uint16_t used = (head + USB_STREAM_BUFFER_SIZE - streamTail) % USB_STREAM_BUFFER_SIZE;
+  // One byte is kept free to tell a full buffer from an empty one
+  const uint16_t free = USB_STREAM_BUFFER_SIZE - 1 - used;
+
+  if (size + 1 > free)
+  {
+    return false;
+  }
+
+  // Only the space after head is written, it is not touched by the interrupt
+  uint16_t index = head;
+  streamBuffer[index] = size;
+  for (uint32_t i = 0; i < size; i++)
+  {
+    index = (index + 1) % USB_STREAM_BUFFER_SIZE;
+    streamBuffer[index] = data[i];
+  }
+
+  // Make sure the data is in place before the interrupt can see it
+  __DMB();
+  streamHead = (index + 1) % USB_STREAM_BUFFER_SIZE;
+
+  return true;
 }
 
 static uint8_t usbd_cf_Setup(void *pdev , USB_SETUP_REQ  *req)
@@ -333,8 +417,9 @@ static uint8_t usbd_cf_Setup(void *pdev , USB_SETUP_REQ  *req)
   if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR) // Crazyflie interface
   {
     command = req->wIndex;
-    if (command == 0x01)
+    if (command == USB_CMD_ENABLE_CRTP || command == USB_CMD_ENABLE_CRTP_STREAM)
     {
+      streamMode = (command == USB_CMD_ENABLE_CRTP_STREAM);
       crtpSetLink(usblinkGetLink());
 
       if (rxStopped && !xQueueIsQueueFullFromISR(usbDataRx))
@@ -346,7 +431,7 @@ static uint8_t usbd_cf_Setup(void *pdev , USB_SETUP_REQ  *req)
         rxStopped = false;
       }
     }
-    else if(command == 0x02)
+    else if(command == USB_CMD_ENTER_BOOTLOADER)
     {
       //restart system and transition to DFU bootloader mode
       //enter bootloader specific to STM32f4xx
@@ -554,7 +639,13 @@ static uint8_t  usbd_cf_DataIn (void *pdev, uint8_t epnum)
 
     doingTransfer = false;
 
-    if (xQueueReceiveFromISR(usbDataTx, &outPacket, &xTaskWokenByReceive) == pdTRUE)
+    if (streamMode)
+    {
+      streamTail = (streamTail + streamInFlight) % USB_STREAM_BUFFER_SIZE;
+      streamInFlight = 0;
+      doingTransfer = streamStartTransfer(pdev);
+    }
+    else if (xQueueReceiveFromISR(usbDataTx, &outPacket, &xTaskWokenByReceive) == pdTRUE)
     {
       doingTransfer = true;
       DCD_EP_Tx (pdev,
@@ -567,11 +658,9 @@ static uint8_t  usbd_cf_DataIn (void *pdev, uint8_t epnum)
   }
   else // VCP In endpoint
   {
-    int i;
     doingVcpTransfer = false;
 
-    for (i = 0; i < USB_RX_TX_PACKET_SIZE &&
-         (passthroughVcpTxReceiveFromISR(&outVcpPacket.data[i]) == pdTRUE); i++);
+    const uint32_t i = passthroughVcpTxReceiveBufferFromISR(outVcpPacket.data, USB_RX_TX_PACKET_SIZE);
 
     if (i != 0)
     {
@@ -590,7 +679,11 @@ static uint8_t  usbd_cf_SOF (void *pdev)
 {
   portBASE_TYPE xTaskWokenByReceive = pdFALSE;
   if (!doingTransfer) {
-    if (xQueueReceiveFromISR(usbDataTx, &outPacket, &xTaskWokenByReceive) == pdTRUE)
+    if (streamMode)
+    {
+      doingTransfer = streamStartTransfer(pdev);
+    }
+    else if (xQueueReceiveFromISR(usbDataTx, &outPacket, &xTaskWokenByReceive) == pdTRUE)
     {
       doingTransfer = true;
       DCD_EP_Tx (pdev,
@@ -603,10 +696,7 @@ static uint8_t  usbd_cf_SOF (void *pdev)
 
   /* VCP */
   if (!doingVcpTransfer) {
-   int i;
-   for (i = 0; (i < USB_RX_TX_PACKET_SIZE) &&
-         (passthroughVcpTxReceiveFromISR(&outVcpPacket.data[i]) == pdTRUE); i++)
-   { };
+    const uint32_t i = passthroughVcpTxReceiveBufferFromISR(outVcpPacket.data, USB_RX_TX_PACKET_SIZE);
 
     if (i != 0)
     {
@@ -664,10 +754,7 @@ static uint8_t  usbd_cf_DataOut (void *pdev, uint8_t epnum)
 
     /* USB data will be immediately processed, this allow next USB traffic being
     NAKed till the end of the application Xfer */
-    for (int i = 0; i < USB_Rx_Cnt; i++)
-    {
-      passthroughVcpRxSendFromISR(USB_Rx_Buffer[i]);
-    }
+    passthroughVcpRxSendBufferFromISR(USB_Rx_Buffer, USB_Rx_Cnt);
 
     /* Prepare Out endpoint to receive next packet */
     DCD_EP_PrepareRx(pdev,
@@ -811,8 +898,33 @@ static USBPacket outStage;
 
 bool usbSendData(uint32_t size, uint8_t* data)
 {
+  if (streamMode)
+  {
+    for (int i = 0; i < USB_STREAM_SEND_TIMEOUT_MS; i++)
+    {
+      if (streamWrite(size, data))
+      {
+        return true;
+      }
+      vTaskDelay(M2T(1));
+    }
+
+    streamOverflows++;
+    return false;
+  }
+
   outStage.size = size;
   memcpy(outStage.data, data, size);
   // Dont' block when sending
   return (xQueueSend(usbDataTx, &outStage, M2T(100)) == pdTRUE);
 }
+
+/**
+ * USB streaming mode
+ */
+LOG_GROUP_START(usb)
+/**
+ * @brief Number of packets dropped in streaming mode because the stream buffer stayed full
+ */
+LOG_ADD(LOG_UINT32, streamOvf, &streamOverflows)
+LOG_GROUP_STOP(usb)
@@ -28,14 +28,30 @@
 #include "usec_time.h"
 #include "cfassert.h"
 #include "param.h"
+#include "log.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
 
 #include "nvicconf.h"
 #include "stm32fxxx.h"
+#include "isr_trace.h"
 
 static bool isInit = false;
 static uint8_t reset = 0;
 static uint32_t usecTimerHighCount;
 
+// Sleep timer (TIM6), one pulse mode, wakes up one sleeping task at the time
+static SemaphoreHandle_t sleepWakeup;
+static StaticSemaphore_t sleepWakeupBuffer;
+static bool isSleepTimerBusy;
+static uint32_t sleepCount;
+static uint32_t sleepBusyCount;
+static uint32_t sleepTotalUs;
+
+static void sleepTimerInit(void);
+
 void usecTimerInit(void)
 {
   if (isInit) {
@@ -70,9 +86,86 @@ void usecTimerInit(void)
   TIM_ITConfig(TIM7, TIM_IT_Update, ENABLE);
   TIM_Cmd(TIM7, ENABLE);
 
+  sleepTimerInit();
+
   isInit = true;
 }
 
+static void sleepTimerInit(void)
+{
+  TIM_TimeBaseInitTypeDef  TIM_TimeBaseStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  sleepWakeup = xSemaphoreCreateBinaryStatic(&sleepWakeupBuffer);
+
+  RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM6, ENABLE);
+
+  // Same tick as TIM7, the period is set for each sleep
+  TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+  TIM_TimeBaseStructure.TIM_Prescaler = SystemCoreClock / (1000 * 1000) / 2;
+  TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+  TIM_TimeBaseInit(TIM6, &TIM_TimeBaseStructure);
+  // The counter stops at the update event
+  TIM_SelectOnePulseMode(TIM6, TIM_OPMode_Single);
+  // TIM_TimeBaseInit() generated an update event
+  TIM_ClearITPendingBit(TIM6, TIM_IT_Update);
+
+  NVIC_InitStructure.NVIC_IRQChannel = TIM6_DAC_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_SLEEP_TIM_PRI;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  DBGMCU_APB1PeriphConfig(DBGMCU_TIM6_STOP, ENABLE);
+  TIM_ITConfig(TIM6, TIM_IT_Update, ENABLE);
+}
+
+bool usecTimerSleep(uint32_t us)
+{
+  if (!isInit || us == 0 || __get_IPSR() != 0 || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+    return false;
+  }
+
+  bool isFree;
+  taskENTER_CRITICAL();
+  isFree = !isSleepTimerBusy;
+  isSleepTimerBusy = true;
+  taskEXIT_CRITICAL();
+
+  if (!isFree) {
+    sleepBusyCount++;
+    return false;
+  }
+
+  // A wakeup from a sleep that timed out
+  xSemaphoreTake(sleepWakeup, 0);
+
+  uint32_t left = us;
+  while (left > 0) {
+    const uint32_t period = (left > 0x10000) ? 0x10000 : left;
+    TIM6->ARR = period - 1;
+    TIM6->CNT = 0;
+    TIM_Cmd(TIM6, ENABLE);
+
+    if (xSemaphoreTake(sleepWakeup, M2T(period / 1000 + 2)) == pdFALSE) {
+      // Should not happen, the caller busy-waits what is left
+      TIM_Cmd(TIM6, DISABLE);
+      break;
+    }
+    left -= period;
+  }
+
+  sleepCount++;
+  sleepTotalUs += us - left;
+
+  isSleepTimerBusy = false;
+
+  return true;
+}
+
+
 void usecTimerReset(void)
 {
   IF_DEBUG_ASSERT(isInit);
@@ -104,9 +197,23 @@ uint64_t usecTimestamp(void)
 
 void __attribute__((used)) TIM7_IRQHandler(void)
 {
+  ISR_TRACE_ENTER();
   TIM_ClearITPendingBit(TIM7, TIM_IT_Update);
 
   __sync_fetch_and_add(&usecTimerHighCount, 1);
+  ISR_TRACE_EXIT();
+}
+
+void __attribute__((used)) TIM6_DAC_IRQHandler(void)
+{
+  ISR_TRACE_ENTER();
+  TIM_ClearITPendingBit(TIM6, TIM_IT_Update);
+
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  xSemaphoreGiveFromISR(sleepWakeup, &xHigherPriorityTaskWoken);
+  ISR_TRACE_EXIT();
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 /**
@@ -129,4 +236,22 @@ PARAM_GROUP_START(usec)
  */
 PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, reset, &reset, &resetParamCallback)
 
-PARAM_GROUP_STOP(usec)
\ No newline at end of file
+PARAM_GROUP_STOP(usec)
+/**
+ * Microsecond sleeps done by blocking the task on the sleep timer, the CPU
+ * time is used by other tasks meanwhile.
+ */
+LOG_GROUP_START(sleepus)
+/**
+ * @brief Number of sleeps that blocked the task
+ */
+LOG_ADD(LOG_UINT32, blocked, &sleepCount)
+/**
+ * @brief Number of sleeps busy-waited since the sleep timer was used by another task
+ */
+LOG_ADD(LOG_UINT32, timerBusy, &sleepBusyCount)
+/**
+ * @brief Total time tasks have been blocked in sleeps [us]
+ */
+LOG_ADD(LOG_UINT32, blockedUs, &sleepTotalUs)
+LOG_GROUP_STOP(sleepus)
@@ -27,6 +27,7 @@
 #include <stdbool.h>
 
 #include "crtp.h"
+#include "autoconf.h"
 
 #define APPCHANNEL_WAIT_FOREVER (-1)
 #define APPCHANNEL_MTU (31)
@@ -147,6 +148,38 @@ bool appchannelHasOverflowOccurred();
  */
 bool appchannelHasOverflowOccured();
 
+// Streaming -------------------------------------------------------------------
+//
+// Messages written to the stream are buffered in a ring buffer and sent to the client in as many packets as needed,
+// with a sequence number per packet so that the client can reassemble the messages and detect lost packets. Packets
+// are only sent when the client has granted credits, so the client controls the data rate. The protocol is described
+// in docs/functional-areas/crtp/crtp_platform.md.
+
+// The largest message that can be written to the stream
+#define APPCHANNEL_STREAM_MAX_MESSAGE_SIZE (CONFIG_APP_CHANNEL_STREAM_BUFFER_SIZE - 2)
+
+/**
+ * Write a message to the app channel stream
+ *
+ * The message is copied to the stream buffer and sent in the background when the client grants credits.
+ *
+ * @param data Pointer to the message
+ * @param length Length of the message, at most APPCHANNEL_STREAM_MAX_MESSAGE_SIZE bytes
+ * @param timeout_ms Time to wait for room in the buffer in millisecond. A value of 0 will make the function non
+ *                   blocking, APPCHANNEL_WAIT_FOREVER makes the function block until there is room.
+ * @return true if the message was added to the stream, false if it was dropped
+ *
+ * \app_api
+ */
+bool appchannelStreamWrite(const void* data, size_t length, int timeout_ms);
+
+/**
+ * Get the number of bytes that can be written to the stream without blocking, including the message overhead
+ *
+ * \app_api
+ */
+size_t appchannelStreamFree();
+
 // Function declared bellow are private to the Crazyflie firmware and
 // should not be called from an app
 
@@ -159,3 +192,8 @@ void appchannelInit();
  *
  */
 void appchannelIncomingPacket(CRTPPacket *p);
+
+/**
+ *
+ */
+void appchannelStreamIncomingPacket(CRTPPacket *p);
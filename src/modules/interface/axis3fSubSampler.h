@@ -33,6 +33,10 @@ typedef struct {
   uint32_t count;
   float conversionFactor;
 
+  // Coning correction, only used by axis3fSubSamplerAccumulateConing()
+  float coningFactor;
+  Axis3f coningSum;
+
   Axis3f subSample;
 } Axis3fSubSampler_t;
 
@@ -45,16 +49,44 @@ typedef struct {
 void axis3fSubSamplerInit(Axis3fSubSampler_t* this, const float conversionFactor);
 
 /**
- * @brief Accumulate a sample
+ * @brief Initialize a sub sampler for angular rates that are accumulated with axis3fSubSamplerAccumulateConing().
+ *
+ * @param this  Pointer to sub sampler
+ * @param conversionFactor  Conversion factor used for unit conversion, to rad/s.
+ * @param samplePeriod  Time between two samples [s]
+ */
+void axis3fSubSamplerInitConing(Axis3fSubSampler_t* this, const float conversionFactor, const float samplePeriod);
+
+/**
+ * @brief Accumulate a sample. Runs for every IMU sample, the conversion factor is applied once in
+ * axis3fSubSamplerFinalize().
+ *
+ * @param this  Pointer to sub sampler
+ * @param sample  The sample to accumulate
+ */
+static inline void axis3fSubSamplerAccumulate(Axis3fSubSampler_t* this, const Axis3f* sample) {
+  this->sum.x += sample->x;
+  this->sum.y += sample->y;
+  this->sum.z += sample->z;
+
+  this->count++;
+}
+
+/**
+ * @brief Accumulate an angular rate sample with coning correction. When the rotation axis moves during the sub sample
+ * interval, the average rate is not the rate that gives the same attitude change. The second order term of the rotation
+ * vector (1/2 * phi x omega) is accumulated as well and added to the average in axis3fSubSamplerFinalize(), the result
+ * is the constant rate that gives the same rotation as the samples. Requires axis3fSubSamplerInitConing().
  *
  * @param this  Pointer to sub sampler
  * @param sample  The sample to accumulate
  */
-void axis3fSubSamplerAccumulate(Axis3fSubSampler_t* this, const Axis3f* sample);
+void axis3fSubSamplerAccumulateConing(Axis3fSubSampler_t* this, const Axis3f* sample);
 
 /**
  * @brief Compute the sub sample, uses simple averaging of samples. The sub sample is multiplied with the conversion
- * factor and the result is stored in the subSample member of the Axis3fSubSampler_t.
+ * factor and the result is stored in the subSample member of the Axis3fSubSampler_t. The coning correction is added
+ * when the samples were accumulated with axis3fSubSamplerAccumulateConing().
  *
  * @param this  Pointer to sub sampler
  * @return Axis3f*  Pointer to the resulting sub sample
@@ -0,0 +1,79 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * boot_timeline.h - Timestamps of the init and test functions run at boot
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOOT_TIMELINE_MAX_ENTRIES 64
+
+typedef struct {
+  // Name of the boot phase that ended, must be a string constant
+  const char* name;
+  // Time since the microsecond timer was started [us]
+  uint32_t timestamp;
+} bootTimelineEntry_t;
+
+/**
+ * Register the memory handler of the time line. Phases can be recorded
+ * before this.
+ */
+void bootTimelineInit(void);
+
+/**
+ * Record the end of a boot phase, for instance an init or a test function.
+ *
+ * The time spent in a phase is the time since the previous entry. Can be
+ * called from any task, but only after usecTimerInit(). Entries after the
+ * first BOOT_TIMELINE_MAX_ENTRIES are dropped.
+ *
+ * @param name Name of the phase, the pointer is kept
+ */
+void bootTimelineMark(const char* name);
+
+uint8_t bootTimelineCount(void);
+
+/**
+ * @return The entry at index, or 0 if index is out of range
+ */
+const bootTimelineEntry_t* bootTimelineGet(const uint8_t index);
+
+/**
+ * Print the time line on the console
+ */
+void bootTimelinePrint(void);
+
+/**
+ * Size in bytes of the time line serialized for the memory subsystem, see
+ * MEM_TYPE_BOOT_TIMELINE.
+ */
+uint32_t bootTimelineGetSize(void);
+
+/**
+ * Read part of the serialized time line. Each entry is a uint32 timestamp
+ * followed by the zero terminated name.
+ */
+bool bootTimelineRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
@@ -118,23 +118,36 @@ typedef struct collision_avoidance_state_s
 // otherPositions == workspace, this function will still work correctly, but it
 // will overwrite the contents of otherPositions.
 //
+// Neighbors that are too far away to affect our motion within the horizon
+// (given by horizonSecs and maxSpeed) are culled before the cell is built, so
+// the cost mostly depends on the number of close neighbors.
+//
+// If the velocities of the neighbors are given, approaching neighbors are
+// extrapolated to the closest approach within horizonSecs, assuming that both
+// we and they keep the current velocity. This requires that the neighbors
+// know our velocity as well, otherwise our cells may overlap. Diverging
+// neighbors are handled as without velocities.
+//
 // Args:
 //   params: Algorithm parameters.
 //   collisionState: Algorithm mutable state.
 //   nOthers: Number of other Crazyflies in array arguments.
 //   otherPositions: [nOthers * 3] array of positions (meters).
+//   otherVelocities: [nOthers * 3] array of velocities (meters/second), or
+//     NULL if the velocities of the neighbors are unknown.
 //   workspace: Space of no less than 7 * (nOthers + 6) floats. Used for
 //     temporary storage during computation. This can be the same address as
 //     otherPositions - otherPositions is copied into workspace immediately.
 //   setpoint: Setpoint from commander that will be mutated.
 //   sensorData: Not currently used, but kept for API similarity with sitAw.
-//   state: Current state estimate.
+//   state: Current state estimate, the velocity is used with otherVelocities.
 //
 void collisionAvoidanceUpdateSetpointCore(
   collision_avoidance_params_t const *params,
   collision_avoidance_state_t *collisionState,
   int nOthers,
   float const *otherPositions,
+  float const *otherVelocities,
   float *workspace,
   setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state);
 
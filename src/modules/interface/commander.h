@@ -46,6 +46,11 @@ uint32_t commanderGetInactivityTime(void);
 
 // Arg `setpoint` cannot be const; the commander will mutate its timestamp.
 void commanderSetSetpoint(setpoint_t *setpoint, int priority);
+
+// Like commanderSetSetpoint(), for a setpoint with the time it was generated
+// by the sender, in ms. These setpoints are played back through a jitter
+// buffer that interpolates between them at the stabilizer rate.
+void commanderSetTimedSetpoint(setpoint_t *setpoint, uint16_t senderTimeMs, int priority);
 int commanderGetActivePriority(void);
 
 // Sets the priority of the current setpoint to the lowest non-disabled value,
@@ -66,16 +66,33 @@ int consolePutcharFromISR(int ch);
 int consolePuts(const char *str);
 
 /**
- * Flush the console buffer
+ * Put data on the console buffer. The console lock is taken once for the whole write.
+ *
+ * @param data The data to print
+ * @param len Number of bytes
+ * @return The number of bytes written, bytes that do not fit in the buffer are dropped
+ */
+int consoleWrite(const char* data, int len);
+
+/**
+ * Flush the console buffer, that is send the buffered text to the client. Text is otherwise sent from the worker
+ * shortly after it is written.
  */
 void consoleFlush(void);
 
 /**
- * Macro implementing consolePrintf with eprintf
+ * Print formatted text to the console buffer, the text is formatted straight into the buffer with eprintf and the
+ * console lock is only taken once.
  *
- * @param FMT String format
- * @patam ... Parameters to print
+ * @param fmt String format
+ * @param ... Parameters to print
+ * @return the number of character printed
+ */
+int consolePrintf(const char* fmt, ...) __attribute__ (( format(printf, 1, 2) ));
+
+/**
+ * Same as consolePrintf with a va_list
  */
-#define consolePrintf(FMT, ...) eprintf(consolePutchar, FMT, ## __VA_ARGS__)
+int consoleVprintf(const char* fmt, va_list ap);
 
 #endif /*CONSOLE_H_*/
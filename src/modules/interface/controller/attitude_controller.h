@@ -34,6 +34,13 @@
 void attitudeControllerInit(const float updateDt);
 bool attitudeControllerTest(void);
 
+/**
+ * Set the rate the attitude PID (and the rate PID, unless run by the inner
+ * rate loop) is updated at. Calling attitudeControllerInit() again restores
+ * the rate of its update time.
+ */
+void attitudeControllerSetRate(const float rateHz);
+
 /**
  * Make the controller run an update of the attitude PID. The output is
  * the desired rate which should be fed into a rate controller. The
@@ -63,6 +70,16 @@ void attitudeControllerResetRollAttitudePID(void);
  */
 void attitudeControllerResetPitchAttitudePID(void);
 
+/**
+ * Reset controller roll, pitch and yaw attitude PID's.
+ */
+void attitudeControllerResetAttitudePID(void);
+
+/**
+ * Reset controller roll, pitch and yaw rate PID's.
+ */
+void attitudeControllerResetRatePID(void);
+
 /**
  * Reset controller roll, pitch and yaw PID's.
  */
@@ -50,6 +50,13 @@ void controller(control_t *control, const setpoint_t *setpoint,
 ControllerType controllerGetType(void);
 const char* controllerGetName();
 
+/**
+ * Check if the budget guard has switched to the fallback controller, because the
+ * current controller repeatedly exceeded its cycle budget. The flag is cleared by the call.
+ * @return true if the controller was switched since the previous call
+ */
+bool controllerFallbackTriggered(void);
+
 
 #ifdef CONFIG_CONTROLLER_OOT
 void controllerOutOfTreeInit(void);
@@ -0,0 +1,73 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * controller_benchmark.h - Micro-benchmark of the controllers and the math3d kernels
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+  ControllerBenchmarkMellinger = 0,
+  ControllerBenchmarkLee,
+  ControllerBenchmarkBrescianini,
+  ControllerBenchmarkMath3d,
+  ControllerBenchmarkMath3dFast,
+  ControllerBenchmarkPoly4dEval,
+  ControllerBenchmarkSubSampler,
+  ControllerBenchmarkSubSamplerConing,
+  ControllerBenchmark_COUNT,
+} ControllerBenchmark;
+
+/**
+ * Clock used to time the benchmark. Any monotonic counter works (cycles on target, nanoseconds on host), the
+ * result is reported in the same unit. Wrap around is handled as long as a single call is shorter than 2^32 ticks.
+ */
+typedef uint32_t (*controllerBenchmarkClock_t)(void);
+
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+  float avg;
+  uint32_t count;
+} controllerBenchmarkResult_t;
+
+/**
+ * Run one benchmark for a number of iterations and time each call with the given clock.
+ *
+ * The controllers are fed a deterministic scenario that changes every iteration so that the full control path,
+ * including the attitude update, is executed on each call. The Brescianini controller keeps its state in globals and
+ * is re-initialized by the benchmark, do not run it while flying with that controller.
+ *
+ * @param type The benchmark to run
+ * @param iterations Number of timed calls
+ * @param clock The clock to time the calls with
+ * @param result Timing statistics, in clock ticks per call
+ */
+void controllerBenchmarkRun(const ControllerBenchmark type, const uint32_t iterations,
+                            const controllerBenchmarkClock_t clock, controllerBenchmarkResult_t* result);
+
+/**
+ * Get a human readable name of a benchmark
+ */
+const char* controllerBenchmarkName(const ControllerBenchmark type);
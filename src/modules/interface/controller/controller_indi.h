@@ -96,8 +96,9 @@ struct IndiVariables {
   struct FloatRates u_act_dyn;
   float rate_d[3];
 
-  Butterworth2LowPass u[3];
-  Butterworth2LowPass rate[3];
+  // Gyro rates in channels 0-2 and actuator commands in channels 3-5, same
+  // coefficients for both
+  biquadBank_t filt;
   struct FloatRates g1;
   float g2;
 
@@ -105,6 +106,9 @@ struct IndiVariables {
   struct FloatRates act_dyn;
   float filt_cutoff;
   float filt_cutoff_r;
+  // The cutoffs the filter coefficients were calculated for
+  float filt_cutoff_applied;
+  float filt_cutoff_r_applied;
 };
 
 void controllerINDIInit(void);
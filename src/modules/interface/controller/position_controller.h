@@ -33,6 +33,8 @@
 void positionControllerInit();
 void positionControllerResetAllPID();
 void positionControllerResetAllfilters();
+// Set the rate [Hz] positionController() is called at, positionControllerInit() restores POSITION_RATE
+void positionControllerSetRate(const float rateHz);
 void positionController(float* thrust, attitude_t *attitude, const setpoint_t *setpoint,
                                                              const state_t *state);
 void velocityController(float* thrust, attitude_t *attitude, const Axis3f *setpoint_velocity,
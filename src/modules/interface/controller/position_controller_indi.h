@@ -55,9 +55,9 @@ struct Angles {
 
 struct IndiOuterVariables {
 
-  Butterworth2LowPass ddxi[3];
-  Butterworth2LowPass ang[3];
-  Butterworth2LowPass thr[3];
+  // Linear acceleration in channels 0-2 and attitude in channels 3-5
+  biquadBank_t accAtt;
+  biquadBank_t thr;
 
   float filt_cutoff;
   float act_dyn_posINDI;
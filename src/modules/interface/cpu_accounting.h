@@ -0,0 +1,51 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cpu_accounting.h - Per task and interrupt CPU time, measured with the cycle counter
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "autoconf.h"
+
+#ifdef CONFIG_DEBUG_CPU_ACCOUNTING
+
+void cpuAccountingInit(void);
+
+/**
+ * Called by the kernel (traceTASK_SWITCHED_IN) when a task is switched in, charges the time since the previous
+ * switch to the previous task.
+ */
+void cpuAccountingTaskSwitchedIn(const void* task);
+
+/**
+ * Mark the start and end of an interrupt handler, called through ISR_TRACE_ENTER() and ISR_TRACE_EXIT() in
+ * isr_trace.h. The time spent in handlers is counted as interrupt time instead of as time of the interrupted task.
+ * Handlers that are not marked are counted as time of the interrupted task. May be nested.
+ */
+void cpuAccountingIsrEnter(void);
+void cpuAccountingIsrExit(void);
+
+#endif // CONFIG_DEBUG_CPU_ACCOUNTING
@@ -0,0 +1,131 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cpx_inference.h - Typed CPX function for inference results from the AI-deck
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cpx.h"
+#include "stabilizer_types.h"
+
+/*
+ * Inference results are sent to the STM32 with the CPX_F_INFERENCE function, one result per packet. All packets start
+ * with a cpxInferenceHeader_t, followed by the payload of the type. All values are little endian.
+ *
+ * The sender reports the time from the image capture to the sending of the result, the observation is timestamped
+ * on the STM32 time base from it. The UART transport adds around a ms that is not accounted for.
+ */
+
+typedef enum {
+  CPX_INFERENCE_DETECTION = 0,
+  CPX_INFERENCE_RELATIVE_POSE = 1,
+  CPX_INFERENCE_TYPE_COUNT,
+} cpxInferenceType_t;
+
+typedef struct {
+  uint8_t type;       // cpxInferenceType_t
+  uint8_t id;         // Class of a detection, or id of the target of a relative pose
+  uint16_t latencyMs; // From the image capture to the sending of the result
+} __attribute__((packed)) cpxInferenceHeader_t;
+
+// A detection in the image, coordinates are normalized to [-1, 1] and scaled to the int16 range
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t width;
+  int16_t height;
+  uint8_t confidence; // 0 - 255
+} __attribute__((packed)) cpxInferenceDetectionPayload_t;
+
+// The pose of a target relative to the Crazyflie, in the body frame. The camera mounting is compensated by the sender.
+typedef struct {
+  float x;
+  float y;
+  float z;
+  float qx;
+  float qy;
+  float qz;
+  float qw;
+  float stdDevPos;
+  float stdDevQuat;
+} __attribute__((packed)) cpxInferenceRelativePosePayload_t;
+
+typedef struct {
+  uint8_t type; // cpxInferenceType_t
+  uint8_t id;
+  uint32_t eventTimeUs; // Lower 32 bits of usecTimestamp() at the image capture
+  uint16_t latencyMs;
+  union {
+    struct {
+      float x; // [-1, 1]
+      float y;
+      float width;
+      float height;
+      float confidence; // [0, 1]
+    } detection;
+    struct {
+      point_t position;
+      quaternion_t quat;
+      float stdDevPos;
+      float stdDevQuat;
+    } relativePose;
+  };
+} cpxInferenceObservation_t;
+
+/**
+ * Decode a CPX_F_INFERENCE packet.
+ *
+ * @param packet The received packet
+ * @param nowUs Lower 32 bits of usecTimestamp() when the packet was received
+ * @param observation The decoded observation
+ * @return true if the packet holds a valid result
+ */
+bool cpxInferenceDecode(const CPXPacket_t* packet, const uint32_t nowUs, cpxInferenceObservation_t* observation);
+
+/**
+ * Compute the pose of the Crazyflie from the relative pose of a marker with a known pose.
+ *
+ * @param observation A relative pose observation of the marker
+ * @param markerPosition The position of the marker in the world frame
+ * @param markerYaw The yaw of the marker in the world frame [rad], the marker is assumed to be level
+ * @param pose The pose of the Crazyflie, timestamped at the image capture
+ */
+void cpxInferenceMarkerToPose(const cpxInferenceObservation_t* observation, const point_t* markerPosition, const float markerYaw, poseMeasurement_t* pose);
+
+/**
+ * Handle a CPX_F_INFERENCE packet, called from the CPX task. The observation is stored as the latest of its type and,
+ * depending on the cpxInf.mode parameter, fed to the estimator or used to follow the target.
+ */
+void cpxInferenceHandlePacket(const CPXPacket_t* packet);
+
+/**
+ * Get the latest observation of a type.
+ *
+ * @param type The type of observation
+ * @param observation The latest observation
+ * @return true if there is an observation of the type
+ */
+bool cpxInferenceGetLatest(const cpxInferenceType_t type, cpxInferenceObservation_t* observation);
@@ -71,6 +71,26 @@ int cpxInternalRouterReceiveCRTP(CPXPacket_t * packet);
  */
 void cpxInternalRouterReceiveOthers(CPXPacket_t * packet);
 
+/**
+ * @brief Receive a CPX packet sent with another function than CRTP, without
+ * copying it
+ *
+ * The packet is owned by the caller until it is returned with
+ * cpxInternalRouterRelease(). The route has a limited number of packets in
+ * flight, so the packet should be released as soon as possible.
+ *
+ * @return The received packet
+ */
+CPXPacket_t* cpxInternalRouterReceiveOthersNoCopy(void);
+
+/**
+ * @brief Return a packet received with cpxInternalRouterReceiveOthersNoCopy()
+ * to the router
+ *
+ * @param packet The packet to release
+ */
+void cpxInternalRouterRelease(CPXPacket_t* packet);
+
 /**
  * @brief Send a CPX packet from the external router into the internal
  * router
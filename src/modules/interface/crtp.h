@@ -30,7 +30,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define CRTP_PROTOCOL_VERSION 7
+#define CRTP_PROTOCOL_VERSION 9
 
 #define CRTP_MAX_DATA_SIZE 30
 
@@ -78,6 +78,36 @@ typedef struct _CRTPPacket
 
 typedef void (*CrtpCallback)(CRTPPacket *);
 
+#define CRTP_NBR_OF_CHANNELS 4
+// Latency histogram bins: below 1 ms, then one bin per power of two ms, the last bin is 64 ms and above
+#define CRTP_STATS_LATENCY_BINS 8
+
+/**
+ * Traffic statistics of one CRTP port, counted since boot
+ */
+typedef struct {
+  uint32_t txPackets;
+  uint32_t txBytes;
+  uint32_t rxPackets;
+  uint32_t rxBytes;
+  // Packets dropped because the TX queue or packet pool was full
+  uint32_t txDrops;
+  uint32_t txChannelPackets[CRTP_NBR_OF_CHANNELS];
+  uint32_t rxChannelPackets[CRTP_NBR_OF_CHANNELS];
+  // Time from queuing a packet until the link accepted it, saturates at UINT16_MAX per bin
+  uint16_t txLatency[CRTP_STATS_LATENCY_BINS];
+} crtpPortStats_t;
+
+/**
+ * Statistics of the link layer (radio, USB, CPX...) as seen from the TX task
+ */
+typedef struct {
+  // Number of times the link refused a packet
+  uint32_t retries;
+  // Time spent handing a packet to the link, including retries
+  uint16_t sendLatency[CRTP_STATS_LATENCY_BINS];
+} crtpLinkStats_t;
+
 /**
  * Initialize the CRTP stack
  */
@@ -107,7 +137,8 @@ void crtpRegisterPortCB(int port, CrtpCallback cb);
 /**
  * Put a packet in the TX task
  *
- * If the TX stack is full, the oldest lowest priority packet is dropped
+ * The packet is queued in the TX priority class of its port. If the queue of
+ * the class is full the packet is dropped.
  *
  * @param[in] p CRTPPacket to send
  */
@@ -120,6 +151,44 @@ int crtpSendPacket(CRTPPacket *p);
  */
 int crtpSendPacketBlock(CRTPPacket *p);
 
+/**
+ * Allocate a TX packet from the CRTP packet pool. The packet can be filled in
+ * place and handed to crtpSendPacketNoCopy(), which avoids copying it on the
+ * way to the link.
+ *
+ * The packet has a reference count of one when allocated.
+ *
+ * @return A packet or NULL if the pool is empty
+ */
+CRTPPacket* crtpPacketAlloc(void);
+
+/**
+ * Add a reference to a pool packet, for instance to queue the same packet
+ * more than once. Each reference must be released with crtpPacketRelease().
+ */
+void crtpPacketRetain(CRTPPacket* p);
+
+/**
+ * Release a reference to a pool packet, the packet is returned to the pool
+ * when the last reference is released.
+ */
+void crtpPacketRelease(CRTPPacket* p);
+
+/**
+ * Put a packet allocated with crtpPacketAlloc() in the TX task without copying it
+ *
+ * One reference to the packet is handed over to the TX path, also if the packet
+ * is dropped because the queue of its TX priority class is full.
+ *
+ * @param[in] p CRTPPacket to send, from crtpPacketAlloc()
+ */
+int crtpSendPacketNoCopy(CRTPPacket *p);
+
+/**
+ * Same as crtpSendPacketNoCopy() but blocks until there is place in the queue
+ */
+int crtpSendPacketNoCopyBlock(CRTPPacket *p);
+
 /**
  * Fetch a packet with a specidied task ID.
  *
@@ -142,12 +211,29 @@ int crtpReceivePacket(CRTPPort taskId, CRTPPacket *p);
 int crtpReceivePacketWait(CRTPPort taskId, CRTPPacket *p, int wait);
 
 /**
- * Get the number of free tx packets in the queue
+ * Get the number of free tx packets in the queues of all TX priority classes
  *
  * @return Number of free packets
  */
 int crtpGetFreeTxQueuePackets(void);
 
+/**
+ * Get the number of free tx packets in the queue used by a port. Ports are
+ * grouped in TX priority classes that each have a queue of their own.
+ *
+ * @param[in] portId The CRTP port
+ * @return Number of free packets
+ */
+int crtpGetFreeTxQueuePacketsForPort(CRTPPort portId);
+
+/**
+ * Get the size of the tx queue used by a port
+ *
+ * @param[in] portId The CRTP port
+ * @return Size of the queue in packets
+ */
+int crtpGetTxQueueSizeForPort(CRTPPort portId);
+
 /**
  * Wait for a packet to arrive for the specified taskID
  *
@@ -158,6 +244,19 @@ int crtpGetFreeTxQueuePackets(void);
  */
 int crtpReceivePacketBlock(CRTPPort taskId, CRTPPacket *p);
 
+/**
+ * Get the traffic statistics of a port
+ *
+ * @param[in] portId The CRTP port
+ * @return The statistics or NULL if the port is invalid
+ */
+const crtpPortStats_t* crtpGetPortStats(CRTPPort portId);
+
+/**
+ * Get the statistics of the active link layer
+ */
+const crtpLinkStats_t* crtpGetLinkStats(void);
+
 /**
  * Function pointer structure to be filled by the CRTP link to permits CRTP to
  * use manu link
@@ -26,6 +26,7 @@
 #ifndef CRTP_COMMANDER_H_
 #define CRTP_COMMANDER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "stabilizer_types.h"
 #include "crtp.h"
@@ -33,6 +34,17 @@
 void crtpCommanderInit(void);
 void crtpCommanderRpytDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk);
 void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk);
+void crtpCommanderGenericDecodeTimedSetpoint(setpoint_t *setpoint, uint16_t *senderTimeMs, CRTPPacket *pk);
+
+/**
+ * Decode the entry of a drone in a broadcast setpoint packet
+ *
+ * @param setpoint The setpoint, only written if the packet has an entry for the drone
+ * @param id The id of the drone
+ * @param pk The broadcast setpoint packet
+ * @return true if the packet has an entry for the drone
+ */
+bool crtpCommanderGenericDecodeBroadcastSetpoint(setpoint_t *setpoint, uint8_t id, CRTPPacket *pk);
 
 float getCPPMRollScale();
 float getCPPMRollRateScale();
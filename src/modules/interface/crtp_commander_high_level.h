@@ -43,6 +43,7 @@ Header file for high-level commander that computes smooth setpoints based on hig
 #include <stdint.h>
 
 #include "math3d.h"
+#include "planner.h"
 
 #include "stabilizer_types.h"
 
@@ -51,6 +52,7 @@ Header file for high-level commander that computes smooth setpoints based on hig
 typedef enum {
   CRTP_CHL_TRAJECTORY_TYPE_POLY4D = 0, // struct poly4d, see pptraj.h
   CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED = 1, // see pptraj_compressed.h
+  CRTP_CHL_TRAJECTORY_TYPE_POLY4D_STREAM = 2, // ring buffer of struct poly4d, see pptraj_stream.h
   // Future types might include versions without yaw
 } crtpCommanderTrajectoryType_t;
 
@@ -197,6 +199,20 @@ bool crtpCommanderHighLevelIsBlocked();
  */
 int crtpCommanderHighLevelGoTo(const float x, const float y, const float z, const float yaw, const float duration_s, const bool relative);
 
+/**
+ * @brief Fly through a route of waypoints, then hover at the last one.
+ *
+ * The route is planned on-board as a chained trajectory, one 7th order segment per waypoint, passing the
+ * intermediate waypoints without stopping.
+ *
+ * @param waypoints    The waypoints, a duration of zero means that the duration is set from maxVelocity
+ * @param nWaypoints   Number of waypoints, at most PLAN_MAX_WAYPOINTS
+ * @param maxVelocity  Velocity limit (m/s) used for waypoints with zero duration
+ * @param relative     Set to true if the waypoints are relative to the current setpoint
+ * @return zero if the command succeeded, an error code otherwise
+ */
+int crtpCommanderHighLevelGoToWaypoints(const struct plan_waypoint* waypoints, const uint8_t nWaypoints, const float maxVelocity, const bool relative);
+
 /**
  * @brief Returns whether the trajectory with the given ID is defined
  *
@@ -217,6 +233,23 @@ bool crtpCommanderHighLevelIsTrajectoryDefined(uint8_t trajectoryId);
  */
 int crtpCommanderHighLevelStartTrajectory(const uint8_t trajectoryId, const float timeScale, const bool relative, const bool reversed);
 
+/**
+ * @brief Set the view of the trajectory memory, applied to trajectories that are started after this call.
+ *
+ * The positions of the trajectory are scaled (around the origin) and shifted, the shift is only used when the
+ * trajectory is not started relative to the current position. The time is stretched with the timescale of the view
+ * multiplied with the timescale of the start command. Compressed and streamed trajectories can not be started
+ * with a scaled view.
+ *
+ * @param shift        shift of the positions (m)
+ * @param scale        scale of the positions, (1, 1, 1) = original size
+ * @param timeScale    time factor; 1.0 = original speed;
+ *                                  >1.0: slower;
+ *                                  <1.0: faster
+ * @return zero if the command succeeded, an error code otherwise
+ */
+int crtpCommanderHighLevelSetTrajectoryView(const struct vec shift, const struct vec scale, const float timeScale);
+
 /**
  * @brief Define a trajectory that has previously been uploaded to memory.
  *
@@ -228,6 +261,37 @@ int crtpCommanderHighLevelStartTrajectory(const uint8_t trajectoryId, const floa
  */
 int crtpCommanderHighLevelDefineTrajectory(const uint8_t trajectoryId, const crtpCommanderTrajectoryType_t type, const uint32_t offset, const uint8_t nPieces);
 
+/**
+ * @brief Append pieces that have previously been uploaded to memory to a streamed trajectory.
+ *
+ * The streamed trajectory is defined with crtpCommanderHighLevelDefineTrajectory() using the type
+ * CRTP_CHL_TRAJECTORY_TYPE_POLY4D_STREAM, where offset and nPieces give the location and the capacity (in pieces)
+ * of the ring buffer in the trajectory memory. The pieces to append are first uploaded to another part of the
+ * trajectory memory and then copied (or decoded) into the ring buffer by this function, also while the trajectory is
+ * being flown.
+ *
+ * @param trajectoryId The id of the streamed trajectory
+ * @param type         The format of the pieces to append, CRTP_CHL_TRAJECTORY_TYPE_POLY4D or
+ *                     CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED
+ * @param offset       offset of the pieces in uploaded memory (bytes)
+ * @param nPieces      Nr of pieces to append
+ * @param last         set to true if these are the last pieces of the trajectory
+ * @return zero if the command succeeded, an error code otherwise
+ */
+int crtpCommanderHighLevelAppendTrajectory(const uint8_t trajectoryId, const crtpCommanderTrajectoryType_t type, const uint32_t offset, const uint8_t nPieces, const bool last);
+
+/**
+ * @brief Get the bounds of a trajectory (duration, max velocity, acceleration, jerk and tilt).
+ *
+ * The bounds are computed when the trajectory is defined. Writing to the trajectory memory used by the trajectory
+ * invalidates them until the trajectory is defined again. Streamed trajectories do not have bounds.
+ *
+ * @param trajectoryId   The id of the trajectory
+ * @param bounds [out]   The bounds
+ * @return true if the bounds are valid
+ */
+bool crtpCommanderHighLevelGetTrajectoryBounds(const uint8_t trajectoryId, struct traj_bounds* bounds);
+
 /**
  * @brief Get the size of the allocated trajectory memory
  *
@@ -67,6 +67,7 @@ typedef enum
   EXT_POSE_PACKED          = 9,
   LH_ANGLE_STREAM          = 10,
   LH_PERSIST_DATA          = 11,
+  SWARM_TIME               = 12,
 } locsrv_t;
 
 // Set up the callback for the CRTP_PORT_LOCALIZATION
@@ -98,4 +99,14 @@ void locSrvResetEmergencyStopRequest();
  */
 uint32_t locSrvGetEmergencyStopWatchdogNotificationTick();
 
+/**
+ * @brief Convert a swarm time, broadcasted by the client in SWARM_TIME packets, to local time.
+ *
+ * @param swarmTimeMs   The lower 32 bits of the swarm time in ms
+ * @param localTimeUs   The corresponding local time, see usecTimestamp()
+ * @return true   The swarm time is synchronized and the conversion is valid
+ * @return false  No recent swarm time available
+ */
+bool locSrvGetLocalTimeForSwarmTime(const uint32_t swarmTimeMs, uint64_t* localTimeUs);
+
 #endif /* _CRTP_LOCALIZATION_SERVICE_H_ */
@@ -34,6 +34,15 @@
 // Written by deck memory sub system before flashing
 extern uint32_t espDeckFlasherNewBinarySize;
 
+// A compressed image is written as this header followed by the image as a zlib stream, the same stream that esptool
+// sends for compressed flashing. An uncompressed ESP32 image starts with 0xE9, it can not be mistaken for the header.
+#define ESP_DECK_FLASHER_DEFLATE_MAGIC 0x4c464544 // "DEFL"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t uncompressedSize;
+} __attribute__((packed)) espDeckFlasherDeflateHeader_t;
+
 /**
 * @brief Repeatedly called upon arrival of a data packet from the radio when flashing the ESP from the cfclient with zip.
 *
@@ -45,4 +54,17 @@ extern uint32_t espDeckFlasherNewBinarySize;
 **/
 bool espDeckFlasherWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t *buffer, const DeckMemDef_t* memDef);
 
+/**
+* @brief Read the MD5 digest of the firmware on the ESP, the first espDeckFlasherNewBinarySize bytes of the firmware
+* partition. Used to skip flashing an image that is already on the ESP: the size of the (uncompressed) image is written,
+* the 16 bytes of the digest are read and compared with the digest of the new image. The ESP must be in bootloader mode.
+*
+* @param memAddr The offset in the digest to read from.
+* @param readLen The number of bytes to read.
+* @param *buffer Pointer to the buffer where the data is written.
+*
+* @return true if the digest was read, false otherwise.
+**/
+bool espDeckFlasherRead(const uint32_t memAddr, const uint8_t readLen, uint8_t *buffer);
+
 uint8_t espDeckFlasherPropertiesQuery();
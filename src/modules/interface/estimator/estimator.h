@@ -56,6 +56,7 @@ typedef enum {
   MeasurementTypeGyroscope,
   MeasurementTypeAcceleration,
   MeasurementTypeBarometer,
+  MeasurementType_COUNT,
 } MeasurementType;
 
 typedef struct
@@ -81,6 +82,14 @@ typedef struct
 void stateEstimatorInit(StateEstimatorType estimator);
 bool stateEstimatorTest(void);
 void stateEstimatorSwitchTo(StateEstimatorType estimator);
+
+/**
+ * Switch estimator from the stabilizer loop. An estimator that supports it is warm started from the current
+ * estimate in the worker task while the current estimator keeps running, and is swapped in at the first tick
+ * after that. Other estimators are switched to directly, as by stateEstimatorSwitchTo().
+ */
+void stateEstimatorRequestSwitch(StateEstimatorType estimator, const state_t *state);
+bool stateEstimatorIsSwitching(void);
 void stateEstimator(state_t *state, const stabilizerStep_t stabilizerStep);
 StateEstimatorType stateEstimatorGetType(void);
 const char* stateEstimatorGetName();
@@ -55,8 +55,15 @@
 
 #include <stdint.h>
 #include "stabilizer_types.h"
+#include "estimator.h"
 
 void estimatorKalmanInit(void);
+
+/**
+ * Initialize the filter from another estimate, instead of from the initial position parameters. Takes the lock of
+ * the filter and may be called from any task while the Kalman task is running, but not from the stabilizer loop.
+ */
+void estimatorKalmanWarmStart(const state_t* initialState);
 bool estimatorKalmanTest(void);
 void estimatorKalman(state_t *state, const stabilizerStep_t stabilizerStep);
 
@@ -65,7 +72,20 @@ bool estimatorKalmanTaskTest();
 
 void estimatorKalmanGetEstimatedPos(point_t* pos);
 
+/**
+ * Copies the 3x3 covariance matrix of the estimated position (x, y, z)
+ */
+void estimatorKalmanGetEstimatedPosCovariance(float cov[3][3]);
+
 /**
  * Copies 9 floats representing the current state rotation matrix
  */
 void estimatorKalmanGetEstimatedRot(float * rotationMatrix);
+
+/**
+ * Get the average number of CPU cycles spent on one measurement of a type, calculated over the last second.
+ *
+ * @param type The measurement type
+ * @return The average number of cycles, 0 if no measurement of this type has been processed
+ */
+float estimatorKalmanGetMeasurementCycles(const MeasurementType type);
@@ -0,0 +1,100 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * measurement_queue.h - Queue for measurements to the state estimators, with
+ * priorities, coalescing of superseded measurements and age based discard.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "estimator.h"
+
+#define MEASUREMENT_QUEUE_SIZE (20)
+#define MEASUREMENT_QUEUE_NONE (0xff)
+
+// Per type statistics, all counters are totals since init
+typedef struct {
+  uint32_t appended;  // Added to the queue
+  uint32_t coalesced; // Replaced an older measurement of the same type in the queue
+  uint32_t evicted;   // Removed from the queue to make room for a measurement with higher priority
+  uint32_t rejected;  // Not added since the queue was full of measurements with the same or higher priority
+  uint32_t stale;     // Discarded at dequeue since it was too old
+  uint32_t dropped;   // Sum of evicted, rejected and stale
+  uint8_t depth;      // Current number of measurements of this type in the queue
+  uint8_t maxDepth;   // Max number of measurements of this type in the queue
+} measurementQueueTypeStats_t;
+
+typedef struct {
+  measurement_t measurement;
+  uint32_t enqueuedMs;
+  uint8_t next;
+  uint8_t prev;
+} measurementQueueSlot_t;
+
+typedef struct {
+  measurementQueueSlot_t slots[MEASUREMENT_QUEUE_SIZE];
+
+  // Doubly linked list of queued measurements, in the order they were enqueued
+  uint8_t head;
+  uint8_t tail;
+  // Singly linked list of free slots
+  uint8_t free;
+
+  uint8_t depth;
+  measurementQueueTypeStats_t stats[MeasurementType_COUNT];
+} measurementQueue_t;
+
+/**
+ * @brief Initialize an empty queue and clear the statistics
+ *
+ * @param queue The queue
+ */
+void measurementQueueInit(measurementQueue_t* queue);
+
+/**
+ * @brief Add a measurement to the queue.
+ *
+ * Some types, for instance flow and ToF, are only of interest in their latest version. A new measurement of such a type
+ * replaces a queued one of the same type, in its position in the queue.
+ *
+ * If the queue is full, the oldest measurement with the lowest priority is evicted to make room, provided that it has
+ * lower priority than the new measurement. Otherwise the new measurement is rejected.
+ *
+ * @param queue The queue
+ * @param measurement The measurement to add
+ * @param nowMs The current time, used for age based discard
+ * @return true if the measurement was added or coalesced
+ */
+bool measurementQueuePush(measurementQueue_t* queue, const measurement_t* measurement, const uint32_t nowMs);
+
+/**
+ * @brief Get the oldest measurement from the queue. Measurements that are older than the max age for their types are
+ * discarded.
+ *
+ * @param queue The queue
+ * @param measurement Destination for the measurement
+ * @param nowMs The current time
+ * @return true if a measurement was returned
+ */
+bool measurementQueuePop(measurementQueue_t* queue, measurement_t* measurement, const uint32_t nowMs);
@@ -29,3 +29,13 @@
 
 void positionEstimate(state_t* estimate, const baro_t* baro, const tofMeasurement_t* tofMeasurement, float dt, stabilizerStep_t stabilizerStep);
 void positionUpdateVelocity(float accWZ, float dt);
+
+// Incremental altitude estimator, an alternative to positionEstimate() and positionUpdateVelocity()
+// that uses the timestamps [ticks] of the samples instead of a fixed dt. Every sample is processed
+// in constant time, samples can arrive at irregular rates.
+void positionAltitudeReset(void);
+// Vertical acceleration without gravity [g], as from sensfusion6GetAccZWithoutGravity()
+void positionAltitudeAddAcc(float accWZ, uint32_t timestamp);
+void positionAltitudeAddBaro(const baro_t* baro, uint32_t timestamp);
+void positionAltitudeAddTof(const tofMeasurement_t* tofMeasurement);
+void positionAltitudeGetEstimate(state_t* estimate);
@@ -0,0 +1,79 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * event_trace.h - Binary trace of context switches, interrupts, queue operations and markers
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "autoconf.h"
+
+// Event types, the layout of an event is described in docs/development/event_trace.md
+typedef enum {
+  EVENT_TRACE_NONE = 0,
+  EVENT_TRACE_TASK_SWITCH,          // id: task number
+  EVENT_TRACE_ISR_ENTER,            // id: exception number
+  EVENT_TRACE_ISR_EXIT,             // id: exception number
+  EVENT_TRACE_QUEUE_SEND,           // arg: queue
+  EVENT_TRACE_QUEUE_RECEIVE,        // arg: queue
+  EVENT_TRACE_QUEUE_BLOCK_SEND,     // arg: queue
+  EVENT_TRACE_QUEUE_BLOCK_RECEIVE,  // arg: queue
+  EVENT_TRACE_MARKER,               // id: marker id, arg: value
+  EVENT_TRACE_TASK_NAME,            // id: task number, arg: two characters of the name
+} eventTraceType_t;
+
+// Marker ids
+typedef enum {
+  EVENT_TRACE_MARKER_STABILIZER_LOOP = 1,  // arg: the lower 16 bits of the stabilizer step
+  EVENT_TRACE_MARKER_STABILIZER_STAGE,     // arg: the stage that ended, see stabilizerProfilerStage_t
+  EVENT_TRACE_MARKER_USER = 128,           // the first marker id for apps and other user code
+} eventTraceMarker_t;
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE
+
+void eventTraceInit(void);
+
+/**
+ * Record an event, may be called from tasks and interrupt handlers.
+ */
+void eventTraceRecord(const eventTraceType_t type, const uint8_t id, const uint16_t arg);
+
+/**
+ * Called by the kernel (traceTASK_CREATE) when a task is created, records the name of the task.
+ */
+void eventTraceTaskCreated(const uint8_t taskNumber, const char* name);
+
+void eventTraceIsrEnter(void);
+void eventTraceIsrExit(void);
+
+// Queues are identified by their (word) address
+#define EVENT_TRACE_QUEUE(type, queue) eventTraceRecord((type), 0, (uint16_t)((uintptr_t)(queue) >> 2))
+
+#define EVENT_TRACE_MARK(id, value) eventTraceRecord(EVENT_TRACE_MARKER, (id), (value))
+
+#else
+
+#define EVENT_TRACE_MARK(id, value)
+
+#endif // CONFIG_DEBUG_EVENT_TRACE
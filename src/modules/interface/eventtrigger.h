@@ -136,6 +136,8 @@ EVENTTRIGGER(myEvent, uint8, var1, uint32, var2)
     {                                                                                                           \
         CALL_MACRO_FOR_EACH_PAIR(_EVENTTRIGGER_ENTRY_PACKED, ##__VA_ARGS__)                                     \
     } __attribute__((packed)) eventTrigger_##NAME##_payload;                                                    \
+    _Static_assert(sizeof(eventTrigger_##NAME##_payload) <= EVENTTRIGGER_MAX_PAYLOAD_SIZE,                      \
+                   "eventtrigger payload too large");                                                           \
     static const eventtriggerPayloadDesc __eventTriggerPayloadDesc__##NAME##__[] =                              \
         {                                                                                                       \
             CALL_MACRO_FOR_EACH_PAIR(_EVENTTRIGGER_ENTRY_DESCRIPTION, ##__VA_ARGS__)};                          \
@@ -169,11 +171,30 @@ EVENTTRIGGER(myEvent, uint8, var1, uint32, var2)
 
 /* Functions and associated data structures */
 
-typedef void (*eventtriggerCallback)(const eventtrigger *);
+// Largest payload an event can carry, 5 variables of 4 bytes
+#define EVENTTRIGGER_MAX_PAYLOAD_SIZE 20
+
+/** An event as seen by the handlers
+ *
+ * The payload is copied when the event is triggered, the handlers are called
+ * later from the eventtrigger task and must use the copy and the timestamp in
+ * the record, not the payload of the event.
+ */
+typedef struct eventtriggerRecord_s
+{
+    const eventtrigger *event;
+    // Time when eventTrigger() was called, in us (usecTimestamp())
+    uint64_t timestamp;
+    uint8_t payloadSize;
+    uint8_t payload[EVENTTRIGGER_MAX_PAYLOAD_SIZE];
+} eventtriggerRecord;
+
+typedef void (*eventtriggerCallback)(const eventtriggerRecord *);
 
 enum eventtriggerHandler_e
 {
     eventtriggerHandler_USD = 0,
+    eventtriggerHandler_Log,
     eventtriggerHandler_Count
 };
 
@@ -198,11 +219,20 @@ const eventtrigger* eventtriggerGetById(uint16_t id);
  */
 const eventtrigger* eventtriggerGetByName(const char *name);
 
+/** Start the task that passes triggered events to the handlers
+ */
+void eventtriggerInit(void);
+
 /** Trigger the specified event
  * 
  * @param event Pointer to the event with updated payload
  * 
- * event->payload should be filled beforehand with metadata about the event
+ * event->payload should be filled beforehand with metadata about the event.
+ * The payload is copied to a lock free ring together with a timestamp and the
+ * call returns without waiting for the handlers, that are called from the
+ * eventtrigger task. If the ring is full the event is dropped and counted in
+ * the log variable eventtrig.overflow. May be called from tasks and interrupt
+ * handlers.
  */
 void eventTrigger(const eventtrigger *event);
 
@@ -212,6 +242,6 @@ void eventTrigger(const eventtrigger *event);
  * @param cb function pointer to the callback
  * 
  * The handler allows multiple event handlers to be triggered by the same event.
- * The callback is only called for enabled events.
+ * The callback is only called for enabled events, from the eventtrigger task.
  */
 void eventtriggerRegisterCallback(enum eventtriggerHandler_e handler, eventtriggerCallback cb);
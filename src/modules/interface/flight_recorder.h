@@ -0,0 +1,58 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * flight_recorder.h - RAM black box of the last seconds of the stabilizer loop
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "stabilizer.h"
+
+// The reason the recording was frozen, the layout of the recording is described in
+// docs/functional-areas/memory-subsystem/MEM_TYPE_FLIGHT_RECORDER.md
+typedef enum {
+  FLIGHT_RECORDER_REASON_NONE = 0,
+  FLIGHT_RECORDER_REASON_TUMBLED,
+  FLIGHT_RECORDER_REASON_CRASHED,
+  FLIGHT_RECORDER_REASON_LOCKED,  // emergency stop or watchdog timeout
+  FLIGHT_RECORDER_REASON_RESET,   // the system was reset while flying
+} flightRecorderReason_t;
+
+// One sample, 64 bytes
+typedef struct {
+  stabilizerStep_t step;
+  stateCompressed_t state;
+  setpointCompressed_t setpoint;
+  uint16_t motorRatios[STABILIZER_NR_OF_MOTORS];
+  uint16_t supervisorInfo;  // see SUPERVISOR_INFO_xxx in supervisor.h
+} flightRecorderSample_t;
+
+void flightRecorderInit(void);
+
+/**
+ * Record a sample, called by the stabilizer loop every iteration after the motors have been set. Samples are
+ * recorded at CONFIG_FLIGHT_RECORDER_RATE.
+ */
+void flightRecorderSample(const stabilizerStep_t stabilizerStep, const state_t* state, const setpoint_t* setpoint, const sensorData_t* sensorData);
@@ -0,0 +1,51 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * isr_trace.h - Marks the start and end of interrupt handlers for the CPU accounting and the event trace
+ */
+
+#pragma once
+
+#include "autoconf.h"
+#include "cpu_accounting.h"
+#include "event_trace.h"
+
+#ifdef CONFIG_DEBUG_CPU_ACCOUNTING
+  #define ISR_TRACE_CPU_ACCOUNTING_ENTER() cpuAccountingIsrEnter()
+  #define ISR_TRACE_CPU_ACCOUNTING_EXIT() cpuAccountingIsrExit()
+#else
+  #define ISR_TRACE_CPU_ACCOUNTING_ENTER()
+  #define ISR_TRACE_CPU_ACCOUNTING_EXIT()
+#endif
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE
+  #define ISR_TRACE_EVENT_ENTER() eventTraceIsrEnter()
+  #define ISR_TRACE_EVENT_EXIT() eventTraceIsrExit()
+#else
+  #define ISR_TRACE_EVENT_ENTER()
+  #define ISR_TRACE_EVENT_EXIT()
+#endif
+
+// Call first and last in an interrupt handler
+#define ISR_TRACE_ENTER() do { ISR_TRACE_CPU_ACCOUNTING_ENTER(); ISR_TRACE_EVENT_ENTER(); } while (0)
+#define ISR_TRACE_EXIT() do { ISR_TRACE_EVENT_EXIT(); ISR_TRACE_CPU_ACCOUNTING_EXIT(); } while (0)
@@ -62,6 +62,19 @@ typedef enum
   KC_STATE_X, KC_STATE_Y, KC_STATE_Z, KC_STATE_PX, KC_STATE_PY, KC_STATE_PZ, KC_STATE_D0, KC_STATE_D1, KC_STATE_D2, KC_STATE_DIM
 } kalmanCoreStateIdx_t;
 
+// The covariance matrix is symmetric and only the upper triangle is stored, packed row by row.
+// Use KC_PACKED_INDEX(i, j) to access element (i, j), it is valid for any i and j.
+#define KC_STATE_PACKED_DIM (KC_STATE_DIM * (KC_STATE_DIM + 1) / 2)
+#define KC_PACKED_INDEX_UPPER(i, j) ((i) * KC_STATE_DIM - ((i) * ((i) - 1)) / 2 + (j) - (i))
+#define KC_PACKED_INDEX(i, j) ((i) <= (j) ? KC_PACKED_INDEX_UPPER(i, j) : KC_PACKED_INDEX_UPPER(j, i))
+
+
+// One scalar measurement, used to pass several measurements from the same epoch to kalmanCoreBatchUpdate()
+typedef struct {
+  const float* h;     // The measurement jacobian (a row vector with KC_STATE_DIM elements)
+  float error;        // The innovation, measured - predicted
+  float stdMeasNoise; // Standard deviation of the measurement noise
+} kalmanCoreScalarMeasurement_t;
 
 // The data used by the kalman core implementation.
 typedef struct {
@@ -85,9 +98,8 @@ typedef struct {
   // The quad's attitude as a rotation matrix (used by the prediction, updated by the finalization)
   float R[3][3];
 
-  // The covariance matrix
-  __attribute__((aligned(4))) float P[KC_STATE_DIM][KC_STATE_DIM];
-  arm_matrix_instance_f32 Pm;
+  // The covariance matrix, symmetric and packed (upper triangle), see KC_PACKED_INDEX()
+  __attribute__((aligned(4))) float P[KC_STATE_PACKED_DIM];
 
   float baroReferenceHeight;
 
@@ -98,7 +110,16 @@ typedef struct {
   bool isUpdated;
 
   uint32_t lastPredictionMs;
+  // Sample time of the newest IMU sample used in the latest prediction, 0 if unknown
+  uint32_t lastPredictionSampleTimeUs;
   uint32_t lastProcessNoiseUpdateMs;
+
+  // Number of finalizations per covariance rotation method, see kalmanCoreFinalize()
+  uint32_t finalizeExactCount;
+  uint32_t finalizeFirstOrderCount;
+
+  // Number of scalar updates dropped because the innovation or its covariance was not finite
+  uint32_t nonFiniteUpdateCount;
 } kalmanCoreData_t;
 
 // The parameters used by the filter
@@ -129,6 +150,11 @@ typedef struct {
   // PI --- facing negative X
   // 3 * PI / 2 --- facing negative Y
   float initialYaw;
+
+  // When all attitude errors are below this limit [rad], the covariance is rotated using a first order approximation
+  // in the finalization, instead of the second order rotation of the full matrix. The error of the approximation grows
+  // with the square of the limit, about 1e-6 relative to the covariance at 1e-3 rad
+  float attitudeErrorSmallAngle;
 } kalmanCoreParams_t;
 
 /*  - Load default parameters */
@@ -137,6 +163,10 @@ void kalmanCoreDefaultParams(kalmanCoreParams_t *params);
 /*  - Initialize Kalman State */
 void kalmanCoreInit(kalmanCoreData_t *this, const kalmanCoreParams_t *params, const uint32_t nowMs);
 
+/*  - Initialize Kalman State with the position, velocity and attitude of another estimate, with the initial
+ *    covariance of kalmanCoreInit(). The attitude is only used if the quaternion of the estimate is valid. */
+void kalmanCoreInitFromState(kalmanCoreData_t *this, const kalmanCoreParams_t *params, const uint32_t nowMs, const state_t *state);
+
 /*  - Measurement updates based on sensors */
 
 // Barometer
@@ -149,22 +179,52 @@ void kalmanCoreUpdateWithBaro(kalmanCoreData_t *this, const kalmanCoreParams_t *
  *  - Predicting the current state forward */
 void kalmanCorePredict(kalmanCoreData_t *this, Axis3f *acc, Axis3f *gyro, const uint32_t nowMs, bool quadIsFlying);
 
+/**
+ * @brief Predict with a time step from the time stamps of the IMU samples, the time between the newest sample of
+ * this prediction and of the previous one. Scheduling jitter of the caller does then not affect the prediction.
+ * Uses the time step from nowMs, as kalmanCorePredict(), if the samples are not time stamped or the sample time
+ * step is unreasonable.
+ *
+ * @param sampleTimeUs Lower 32 bits of usecTimestamp() of the newest IMU sample, 0 if unknown
+ */
+void kalmanCorePredictAtSampleTime(kalmanCoreData_t *this, Axis3f *acc, Axis3f *gyro, const uint32_t nowMs, const uint32_t sampleTimeUs, bool quadIsFlying);
+
 void kalmanCoreAddProcessNoise(kalmanCoreData_t *this, const kalmanCoreParams_t *params, const uint32_t nowMs);
 
 /**
  * @brief Finalization to incorporate attitude error into body attitude
  *
  * @param this Core data
+ * @param params Parameters, attitudeErrorSmallAngle selects the method used to rotate the covariance
  * @return true The state was finalized
  * @return false The state was not changed and did not require finalization
  */
-bool kalmanCoreFinalize(kalmanCoreData_t* this);
+bool kalmanCoreFinalize(kalmanCoreData_t* this, const kalmanCoreParams_t *params);
 
 /*  - Externalization to move the filter's internal state into the external state expected by other modules */
 void kalmanCoreExternalizeState(const kalmanCoreData_t* this, state_t *state, const Axis3f *acc);
 
 void kalmanCoreDecoupleXY(kalmanCoreData_t* this);
 
+/**
+ * @brief Unpack the covariance matrix into a full (dense) matrix
+ *
+ * @param this Core data
+ * @param P Destination for the full covariance matrix
+ */
+void kalmanCoreGetCovariance(const kalmanCoreData_t* this, float P[KC_STATE_DIM][KC_STATE_DIM]);
+
 void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise);
 
+/**
+ * @brief Sequentially apply a number of scalar measurements from the same epoch. The result is the same as calling
+ * kalmanCoreScalarUpdate() for each measurement, but temporaries are shared and the sanity checks of the state are only
+ * done once, after the last measurement.
+ *
+ * @param this Core data
+ * @param measurements The measurements to apply, in order
+ * @param count The number of measurements
+ */
+void kalmanCoreBatchUpdate(kalmanCoreData_t* this, const kalmanCoreScalarMeasurement_t* measurements, const int count);
+
 void kalmanCoreUpdateWithPKE(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error);
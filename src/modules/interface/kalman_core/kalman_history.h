@@ -0,0 +1,77 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--'  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * kalman_history.h - History of the predicted motion, used to fuse delayed measurements
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KALMAN_HISTORY_LENGTH (16)
+
+// Don't extrapolate the motion further than this past the latest prediction
+#define KALMAN_HISTORY_MAX_EXTRAPOLATION_US (20000)
+
+typedef struct {
+  uint32_t timeUs;
+  // The accumulated position change from the predictions (global frame), up to this time
+  float displacement[3];
+} kalmanHistoryEntry_t;
+
+/**
+ * A ring buffer with the accumulated predicted displacement at the time of each prediction.
+ *
+ * Given the time of a measurement, the displacement between the latest prediction and the measurement can be
+ * calculated. Shifting the position state by this displacement while applying the measurement gives the position at
+ * the time of the measurement, while the corrections from measurements since then are kept. The covariance of the
+ * current state is used.
+ */
+typedef struct {
+  kalmanHistoryEntry_t entries[KALMAN_HISTORY_LENGTH];
+  uint8_t newest;
+  uint8_t count;
+  float accumulated[3];
+} kalmanHistory_t;
+
+void kalmanHistoryInit(kalmanHistory_t* history);
+
+/**
+ * @brief Add the change in position from one prediction
+ *
+ * @param history The history
+ * @param timeUs The time of the prediction, lower 32 bits of usecTimestamp()
+ * @param positionChange The change of the position states in the prediction
+ */
+void kalmanHistoryAddPrediction(kalmanHistory_t* history, const uint32_t timeUs, const float positionChange[3]);
+
+/**
+ * @brief Get the predicted displacement from the time of the latest prediction to the time of an event.
+ * The displacement is interpolated between predictions, or extrapolated if the event is after the latest prediction.
+ *
+ * @param history The history
+ * @param eventTimeUs The time of the event, lower 32 bits of usecTimestamp()
+ * @param offset Destination for the displacement
+ * @return true if the event is covered by the history
+ */
+bool kalmanHistoryGetOffset(const kalmanHistory_t* history, const uint32_t eventTimeUs, float offset[3]);
@@ -19,5 +19,6 @@
 
 #include "kalman_core.h"
 
-// M-estimation based robust Kalman filter update for UWB TWR measurements
-void kalmanCoreRobustUpdateWithDistance(kalmanCoreData_t* this, distanceMeasurement_t *d); 
\ No newline at end of file
+// M-estimation based robust Kalman filter update for UWB TWR measurements.
+// Returns the number of reweighting iterations that were run.
+int kalmanCoreRobustUpdateWithDistance(kalmanCoreData_t* this, distanceMeasurement_t *d);
\ No newline at end of file
@@ -29,3 +29,6 @@
 
 // Measurements of flow (dnx, dny)
 void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *flow, const Axis3f *gyro);
+
+// Measurements of flow (dnx, dny) and TOF from the same deck, applied as one batch linearized around the same state
+void kalmanCoreUpdateWithFlowAndTof(kalmanCoreData_t* this, const flowMeasurement_t *flow, const tofMeasurement_t *tof, const Axis3f *gyro);
@@ -28,5 +28,20 @@
 #include "kalman_core.h"
 #include "outlierFilterLighthouse.h"
 
+// Max number of sweep angles in one batch, all sweeps of all sensors from one base station in one frame
+#define KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH 8
+
 // Measurement of sweep angles from a Lighthouse base station
 void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *angles, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
+
+/**
+ * Measurement of a batch of sweep angles from the same base station and frame. The sensor positions in the global
+ * reference frame and in the rotor reference frames are computed once per batch and shared by the sweeps, and all
+ * accepted sweeps are fed to the kalman core in one batch update. The sweeps are linearized around the state at the
+ * start of the batch.
+ *
+ * @param sweeps The sweep angle measurements
+ * @param count The number of measurements, at most KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH
+ * @return The number of sweeps that were used in the update
+ */
+int kalmanCoreUpdateWithSweepAnglesBatch(kalmanCoreData_t *this, const sweepAngleMeasurement_t sweeps[], const int count, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
@@ -28,5 +28,48 @@
 #include "kalman_core.h"
 #include "outlierFilterTdoa.h"
 
+// Max number of TDoA measurements in one batch, all measurements extracted from one received UWB packet
+#define KALMAN_CORE_TDOA_MAX_BATCH 8
+
+// The result of the outlier gating of a batch of TDoA measurements
+typedef struct {
+  // The accepted measurements, ready for kalmanCoreBatchUpdate()
+  kalmanCoreScalarMeasurement_t measurements[KALMAN_CORE_TDOA_MAX_BATCH];
+  float h[KALMAN_CORE_TDOA_MAX_BATCH][KC_STATE_DIM];
+  int acceptedCount;
+
+  // Indexed as the input measurements
+  bool isAccepted[KALMAN_CORE_TDOA_MAX_BATCH];
+} kalmanCoreTdoaGatedBatch_t;
+
+/**
+ * The gating stage of the TDoA update, shared by the standard and the robust update. Calculates the jacobian and the
+ * error of a measurement at the current state and validates it with the outlier filter.
+ *
+ * @param h Output, the jacobian
+ * @param errorOut Output, measured - predicted distance difference
+ * @return true if the measurement should be used
+ */
+bool kalmanCoreGateTdoa(const kalmanCoreData_t* this, const tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState, float h[KC_STATE_DIM], float* errorOut);
+
+/**
+ * Run the gating stage for a batch of measurements, linearized around the current state.
+ *
+ * @param gated Output, the accepted measurements
+ * @return The number of accepted measurements
+ */
+int kalmanCoreGateTdoaBatch(const kalmanCoreData_t* this, const tdoaMeasurement_t tdoas[], const int count, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState, kalmanCoreTdoaGatedBatch_t* gated);
+
 // Measurements of a UWB Tx/Rx
 void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState);
+
+/**
+ * Measurement of a batch of TDoA values from the same point in time, typically all measurements extracted from one
+ * UWB packet. The measurements are validated by the outlier filter one by one and the accepted measurements are fed
+ * to the kalman core in one batch update, linearized around the state at the start of the batch.
+ *
+ * @param tdoas The TDoA measurements
+ * @param count The number of measurements, at most KALMAN_CORE_TDOA_MAX_BATCH
+ * @return The number of measurements that were used in the update
+ */
+int kalmanCoreUpdateWithTdoaBatch(kalmanCoreData_t* this, const tdoaMeasurement_t tdoas[], const int count, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState);
@@ -20,5 +20,7 @@
 #include "kalman_core.h"
 #include "outlierFilterTdoa.h"
 
-// M-estimation based robust Kalman filter update for UWB TDOA measurements
-void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, OutlierFilterTdoaState_t* outlierFilterState);
+// M-estimation based robust Kalman filter update for UWB TDOA measurements. Outliers are not handled, the measurement
+// should be validated with kalmanCoreGateTdoa() before the update. Returns the number of reweighting iterations that
+// were run.
+int kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, OutlierFilterTdoaState_t* outlierFilterState);
@@ -29,3 +29,8 @@
 
 // Measurements of TOF from laser sensor
 void kalmanCoreUpdateWithTof(kalmanCoreData_t* this, tofMeasurement_t *tof);
+
+// Fill in the scalar measurement for a TOF measurement, to be applied with kalmanCoreBatchUpdate(). h must hold
+// KC_STATE_DIM zeros and is referenced by the measurement. Returns false if the measurement is not reliable at the
+// current attitude and should not be used.
+bool kalmanCoreTofMeasurement(const kalmanCoreData_t* this, const tofMeasurement_t *tof, float h[KC_STATE_DIM], kalmanCoreScalarMeasurement_t* measurement);
@@ -29,4 +29,20 @@
 #include <stdbool.h>
 #include "kalman_core.h"
 
+/**
+ * Check that the position and velocity are within the kalman.maxPos and kalman.maxVel bounds. NaN is out of bounds.
+ */
 bool kalmanSupervisorIsStateWithinBounds(const kalmanCoreData_t* this);
+
+/**
+ * Check the state after the finalization, to be called once per estimator loop.
+ *
+ * The kalman core drops measurements with a non finite innovation, so a NaN can only enter the state through the
+ * prediction or a numerical problem in the covariance. Every call checks the bounds, the quaternion and the covariance
+ * diagonal, the off diagonal covariance elements are swept at a low rate.
+ *
+ * @param this The kalman core data
+ * @param nowMs The current time, used to schedule the full covariance sweep
+ * @return false if the filter should be reset
+ */
+bool kalmanSupervisorIsStateValid(const kalmanCoreData_t* this, const uint32_t nowMs);
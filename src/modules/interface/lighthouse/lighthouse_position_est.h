@@ -49,4 +49,15 @@ void lighthousePositionSetGeometryData(const uint8_t baseStation, const baseStat
 void lighthousePositionCalibrationDataWritten(const uint8_t baseStation);
 
 void lighthousePositionEstimatePoseCrossingBeams(const pulseProcessor_t *state, pulseProcessorResult_t* angles, int baseStation1, int baseStation2);
+
+/**
+ * @brief Estimate the position using crossing beams from all base stations in baseStationMap, in one
+ * least squares solve. The yaw is estimated from yawBaseStation.
+ *
+ * @param state           The pulse processor state with geometry data
+ * @param angles          The calibrated angles
+ * @param baseStationMap  Bit map of base stations to use, base stations without geometry data are ignored
+ * @param yawBaseStation  The base station to use for the yaw estimate
+ */
+void lighthousePositionEstimatePoseCrossingBeamsMulti(const pulseProcessor_t *state, pulseProcessorResult_t* angles, const uint16_t baseStationMap, int yawBaseStation);
 void lighthousePositionEstimatePoseSweeps(const pulseProcessor_t *state, pulseProcessorResult_t* angles, int baseStation);
@@ -0,0 +1,62 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lighthouse_recorder.h - Record raw lighthouse data to the uSD event log
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "lighthouse_core.h"
+
+/**
+ * @brief Record the raw frames from the lighthouse deck, and snapshots of the calibration and geometry data, as
+ * event triggers. Events are only written to the uSD card if they are listed in the config file of the card:
+ *
+ * lhFrame               One event per frame from the deck
+ * lhCalibA, lhCalibB    Calibration data for one sweep of a base station, split over two events
+ * lhGeo                 One row of the geometry data of a base station
+ *
+ * The recorded data can be replayed on the host with bindings/util/lighthouse_replay.py
+ */
+
+// Bit fields of the info byte of lhFrame
+#define LIGHTHOUSE_RECORDER_INFO_SENSOR_MASK 0x03
+#define LIGHTHOUSE_RECORDER_INFO_CHANNEL_FOUND 0x04
+#define LIGHTHOUSE_RECORDER_INFO_SLOW_BIT 0x08
+#define LIGHTHOUSE_RECORDER_INFO_CHANNEL_SHIFT 4
+
+/**
+ * @brief Record a frame from the deck. Sync frames are not recorded.
+ *
+ * @param frame The frame
+ */
+void lighthouseRecorderProcessFrame(const lighthouseUartFrame_t* frame);
+
+/**
+ * @brief Record the calibration and geometry data of one base station at a time. Base stations are cycled through
+ * at a low rate to make sure each part of the log contains the data needed to replay it.
+ *
+ * @param now_ms The current time in ms
+ */
+void lighthouseRecorderProcessSnapshot(const uint32_t now_ms);
@@ -27,16 +27,26 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include "pulse_processor.h"
 
 /**
  * @brief Throttles how much of the data from lighthouse base stations that is used. When multiple base stations
  * are received, pushing all the data to the estimator is nor necessary and it increases the risk of overloading
  * the system.
  *
- * This function tries to limit the rate of the samples used by randomly discarding samples when needed.
+ * The rate of samples is limited by lh2maxRate and by a CPU budget for the measured cost of the updates in the Kalman
+ * filter. Within this rate the samples carrying the most information are used, based on the time since the base
+ * station was last used, the number of sensors that have seen the sweeps and the angles to the base station.
  *
  * @param now_ms The current time in ms
+ * @param angles The angles of the sample, LH2 angles converted to LH1 angles
+ * @param baseStation The base station of the sample
  * @return true   If the sample is to be used
  * @return false  If the sample should be discarded
  */
-bool throttleLh2Samples(const uint32_t now_ms);
+bool throttleLh2Samples(const uint32_t now_ms, const pulseProcessorResult_t* angles, const int baseStation);
+
+/**
+ * @brief Reset the state of the throttling
+ */
+void throttleLh2Reset();
@@ -53,6 +53,14 @@ typedef uint16_t logVarId_t;
  */
 logVarId_t logGetVarId(const char* group, const char* name);
 
+/** Get the CRC of the log TOC
+ *
+ * Variable IDs are the same in all firmware builds with the same TOC CRC.
+ *
+ * @return The CRC, same as in the CMD_GET_INFO_V2 answer
+ */
+uint32_t logGetTocCrc(void);
+
 /** Check variable ID validity
  *
  * @param varId variable ID, returned by logGetLogId()
@@ -80,6 +88,17 @@ int logGetType(logVarId_t varid);
  */
 void logGetGroupAndName(logVarId_t varid, char** group, char** name);
 
+/** Time looking up every log variable by group and name
+ *
+ * Compares logGetVarId() using the name index with a linear search of the
+ * TOC. Only available with CONFIG_TOC_INDEX_BENCHMARK.
+ *
+ * @param clock Function returning a free running cycle counter
+ * @param indexCycles Filled with the average cycles per lookup using the index
+ * @param scanCycles Filled with the average cycles per lookup using a linear search
+ */
+void logNameIndexBenchmark(uint32_t (*clock)(void), float* indexCycles, float* scanCycles);
+
 /** Get address of the logging variable
  *
  * @param varId variable ID, returned by logGetVarId()
@@ -115,6 +134,80 @@ int logGetInt(logVarId_t varid);
  */
 unsigned int logGetUint(logVarId_t varid);
 
+/* Lazily evaluated log groups
+ *
+ * Some log groups only contain variables derived from other data, for instance
+ * compressed versions of the state. A producer can register such a group with a
+ * prepare callback, the log subsystem then calls the callback right before a
+ * log block containing variables of the group is sampled, instead of the
+ * producer computing the variables all the time.
+ *
+ * Consumers reading log variables directly through logGetAddress(), and not
+ * through log blocks, should use logLazyGroupMask(), logLazyGroupsAddConsumer()
+ * and logLazyGroupsPrepare(). logGetInt(), logGetFloat() and logGetUint() prepare
+ * the variable they read.
+ */
+
+#define LOG_LAZY_GROUPS_MAX 8
+
+/** Callback computing the variables of a lazy log group */
+typedef void (*logLazyPrepare_t)(void);
+
+typedef struct logLazyGroup_s {
+  // Set by the producer
+  const char* group;
+  logLazyPrepare_t prepare;
+
+  // Private, set by logLazyGroupRegister()
+  uint16_t start;
+  uint16_t stop;
+  uint8_t index;
+} logLazyGroup_t;
+
+/** Register a lazy log group
+ *
+ * @param lazyGroup The group, with group name and prepare callback set. Must be
+ *                  statically allocated.
+ * @return true if registered, false if the group does not exist or there is no
+ *         more room for lazy groups.
+ */
+bool logLazyGroupRegister(logLazyGroup_t* lazyGroup);
+
+/** Check if any variable of a lazy group is consumed
+ *
+ * @param lazyGroup A registered lazy group
+ * @return true if a running log block or a direct consumer uses a variable of the group
+ */
+bool logIsGroupConsumed(const logLazyGroup_t* lazyGroup);
+
+/** Get the mask of the lazy groups a variable belongs to
+ *
+ * @param varId variable ID, returned by logGetVarId()
+ * @return Mask with one bit per lazy group, 0 if the variable is not part of a lazy group
+ */
+uint32_t logLazyGroupMask(logVarId_t varid);
+
+/** Mark lazy groups as consumed by a direct consumer, for logIsGroupConsumed()
+ *
+ * @param mask Mask from logLazyGroupMask()
+ */
+void logLazyGroupsAddConsumer(uint32_t mask);
+
+/** Call the prepare callbacks of lazy groups, before reading their variables directly
+ *
+ * @param mask Mask from logLazyGroupMask()
+ */
+void logLazyGroupsPrepare(uint32_t mask);
+
+/** Sample the log blocks that are synchronous with the stabilizer
+ *
+ * Called by the stabilizer once per step, after the state has been published.
+ * The packets are sent later by the log scheduler task.
+ *
+ * @param stabilizerStep The current stabilizer step
+ */
+void logStabilizerStep(const uint32_t stabilizerStep);
+
 /* Basic log structure */
 struct log_s {
   uint8_t type;
@@ -152,6 +245,16 @@ typedef struct {
   };
 
   void* data;
+
+  // Minimum time between two calls of the getter [ms], the last value is used
+  // in between. With 0 the getter is still only called once per log scheduler
+  // pass, however many log blocks use the variable.
+  uint16_t minIntervalMs;
+
+  // Evaluation cache, managed by the log module
+  uint32_t cachePass;
+  uint32_t cacheTimestamp;
+  uint32_t cacheValue;
 } logByFunction_t;
 
 /* Internal defines */
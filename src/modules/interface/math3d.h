@@ -279,6 +279,10 @@ static inline bool vgeq(struct vec a, struct vec b) {
 static inline bool visnan(struct vec v) {
 	return isnan(v.x) || isnan(v.y) || isnan(v.z);
 }
+// test if all elements of a vector are finite.
+static inline bool visfinite(struct vec v) {
+	return isfinite(v.x) && isfinite(v.y) && isfinite(v.z);
+}
 
 //
 // special functions to ease the pain of writing vector math in C.
@@ -42,6 +42,17 @@ typedef enum {
   MEM_TYPE_LEDMEM   = 0x17,
   MEM_TYPE_APP      = 0x18,
   MEM_TYPE_DECK_MEM = 0x19,
+  MEM_TYPE_LOG_TOC  = 0x1A,
+  MEM_TYPE_PARAM_TOC = 0x1B,
+  MEM_TYPE_BOOT_TIMELINE = 0x1C,
+  MEM_TYPE_TASK_LOAD = 0x1D,
+  MEM_TYPE_EVENT_TRACE = 0x1E,
+  MEM_TYPE_FLIGHT_RECORDER = 0x1F,
+  MEM_TYPE_SYSID = 0x20,
+  MEM_TYPE_PARAM_STATE = 0x21,
+  MEM_TYPE_USD_DIR = 0x22,
+  MEM_TYPE_LOADCELL = 0x23,
+  MEM_TYPE_ACTIVE_MARKER = 0x24,
 } MemoryType_t;
 
 #define MEMORY_SERIAL_LENGTH 8
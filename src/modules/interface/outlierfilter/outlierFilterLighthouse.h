@@ -29,7 +29,25 @@
 typedef struct {
     uint32_t openingTimeMs;
     int32_t openingWindowMs;
+
+    // Sweeps rejected since the error was too large while the filter was closed
+    uint32_t rejectedErrorCount;
+    // Frames rejected as a whole since most of the sweeps in the frame had too large errors, for instance reflections
+    uint32_t rejectedFrameCount;
 } OutlierFilterLhState_t;
 
 bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const float distanceToBs, const float angleError, const uint32_t nowMs);
+
+/**
+ * Validate all sweeps of a frame, from one base station, in one call. The result for each sweep is the same as for
+ * outlierFilterLighthouseValidateSweep(), except that all sweeps are rejected if the filter is closed and more than
+ * half of the sweeps have too large errors.
+ *
+ * @param distanceToBs Distance from the sensor to the base station, one per sweep
+ * @param angleError Error of the sweep angle, one per sweep
+ * @param count Number of sweeps
+ * @param accepted Set to true for the sweeps that should be used, one per sweep
+ * @return The number of accepted sweeps
+ */
+int outlierFilterLighthouseValidateSweeps(OutlierFilterLhState_t* this, const float distanceToBs[], const float angleError[], const int count, const uint32_t nowMs, bool accepted[]);
 void outlierFilterLighthouseReset(OutlierFilterLhState_t* this, const uint32_t nowMs);
@@ -30,7 +30,20 @@ typedef struct {
     float integrator;
     uint32_t latestUpdateMs;
     bool isFilterOpen;
+    // Running mean of the squared error, in standard deviations, of samples in a closed filter
+    float errorVariance;
+    // The factor applied to the standard deviation of the samples, derived from errorVariance
+    float errorScale;
+    uint32_t rejectedCount;
 } OutlierFilterTdoaState_t;
 
 void outlierFilterTdoaReset(OutlierFilterTdoaState_t* this);
+
+/**
+ * Validate a TDoA sample. Single pass, all state is updated once per sample.
+ *
+ * @param error The error of the sample, measured - predicted distance difference
+ * @param nowMs The time of the sample
+ * @return true if the sample should be used
+ */
 bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs);
@@ -47,6 +47,16 @@
 
 #define MAXIMUM_DTR_PACKET_DATA_SIZE P2P_MAX_USABLE_DATA_SIZE - DTR_PACKET_HEADER_SIZE
 
+// Maximum number of DATA packets sent per token pass in sliding window mode
+#define DTR_MAX_WINDOW_SIZE 7
+
+// messageType layout: | seq (4 bits) | ack request (1 bit) | type (3 bits) |
+// seq and ack request are only used in sliding window mode and are 0 otherwise
+#define DTR_MESSAGE_TYPE_MASK 0x07
+#define DTR_ACK_REQUEST 0x08
+#define DTR_SEQ_SHIFT 4
+#define DTR_SEQ_MASK 0x0F
+
 typedef enum tx_states_e {
 	TX_TOKEN,
 	TX_CTS,
@@ -106,6 +116,11 @@ typedef struct {
 	uint32_t sendPackets;
 	uint32_t receivedPackets;
 
+	// DATA packets acknowledged by a receiver, counted once per receiver
+	uint32_t ackedPackets;
+	// DATA packets sent again because no ack was received in time
+	uint32_t retransmittedPackets;
+
 } dtrRadioInfo;
 
 typedef struct {
@@ -63,6 +63,9 @@ uint8_t dtrGetNumberOfPacketsInQueue(DTRQueue_Names qName);
 
 bool dtrGetPacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout);
 
+// Removes the first packet from the queue and returns it, also for the TX_DATA_Q
+bool dtrTakePacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout);
+
 // Blocks to wait for a packet to be received for a given time
 // new_packet_received --> True if a new packet has been received and False if the timeout has been reached
 bool dtrReceivePacketWaitUntil(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received);
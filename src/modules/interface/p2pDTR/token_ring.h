@@ -95,6 +95,14 @@ void DisableDTRProtocol(void);
 // @return true if the packet was sent successfully to the DTR (not the final receiver), false otherwise 
 bool dtrSendPacket(dtrPacket* packet);
 
+// Sets the number of DATA packets that may be sent per token pass.
+// 1 (default) is stop-and-wait, one packet per token pass and one ack per packet.
+// Larger values enable the sliding window mode, up to DTR_MAX_WINDOW_SIZE packets
+// are sent back to back to each receiver which acknowledges them with one cumulative ack.
+// All nodes of the ring must use the same mode.
+// @param size The window size
+void dtrSetWindowSize(uint8_t size);
+
 // Receives a packet from the DTR Protocol
 // Blocks for the specified timeout if no packet is received
 // @param packet: the packet to be received
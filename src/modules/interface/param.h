@@ -103,6 +103,13 @@ typedef float * (*paramGetterFloat)(void);
 #define MISC_PERSISTENT_GET_STATE 4
 #define MISC_PERSISTENT_CLEAR     5
 #define MISC_GET_DEFAULT_VALUE    6
+#define MISC_BULK_WRITE           7
+#define MISC_BULK_READ            8
+#define MISC_TXN_STAGE            9
+#define MISC_TXN_COMMIT           10
+#define MISC_TXN_ABORT            11
+#define MISC_PERSISTENT_STORE_BULK      12
+#define MISC_PERSISTENT_STORE_BULK_DONE 13
 
 /* Macros */
 
@@ -114,6 +114,48 @@ int paramGetInt(paramVarId_t varid);
  */
 unsigned int paramGetUint(paramVarId_t varid);
 
+/** Time looking up every parameter by group and name
+ *
+ * Compares paramGetVarId() using the name index with a linear search of the
+ * TOC. Only available with CONFIG_TOC_INDEX_BENCHMARK.
+ *
+ * @param clock Function returning a free running cycle counter
+ * @param indexCycles Filled with the average cycles per lookup using the index
+ * @param scanCycles Filled with the average cycles per lookup using a linear search
+ */
+void paramNameIndexBenchmark(uint32_t (*clock)(void), float* indexCycles, float* scanCycles);
+
+/** Size of the serialized param TOC
+ *
+ * The TOC is exposed as MEM_TYPE_PARAM_TOC, see toc_blob.h for the format.
+ */
+uint32_t paramTocBlobGetSize(void);
+
+/** Read a part of the serialized param TOC
+ *
+ * @param memAddr Start address in the serialized TOC
+ * @param readLen Number of bytes to read
+ * @param buffer Filled with the data
+ * @return false if the read is outside of the serialized TOC
+ */
+bool paramTocBlobRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
+
+/** Size of the serialized param state
+ *
+ * The current value of all parameters, which differ from their default and
+ * which are stored, exposed as MEM_TYPE_PARAM_STATE.
+ */
+uint32_t paramStateBlobGetSize(void);
+
+/** Read a part of the serialized param state
+ *
+ * @param memAddr Start address in the serialized state
+ * @param readLen Number of bytes to read
+ * @param buffer Filled with the data
+ * @return false if the read is outside of the serialized state
+ */
+bool paramStateBlobRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
+
 /** Set int value of an int parameter (1-4 bytes)
  *
  *  An update is also send to the client
@@ -132,6 +174,14 @@ void paramSetInt(paramVarId_t varid, int valuei);
  */
 void paramSetFloat(paramVarId_t varid, float valuef);
 
+/** Swap in a committed param transaction
+ *
+ * Writes all the values of a committed transaction and calls the change
+ * callbacks, once per callback. Called by the stabilizer between two ticks, the
+ * callbacks run in the stabilizer task.
+ */
+void paramTransactionApply(void);
+
 /**
  * @brief Initialize the parameter subsystem
  */
@@ -153,3 +203,9 @@ void paramGetExtendedType(CRTPPacket *p);
 void paramPersistentStore(CRTPPacket *p);
 void paramPersistentGetState(CRTPPacket *p);
 void paramPersistentClear(CRTPPacket *p);
+void paramPersistentStoreBulk(CRTPPacket *p);
+void paramBulkWrite(CRTPPacket *p);
+void paramBulkRead(CRTPPacket *p);
+void paramTransactionStage(CRTPPacket *p);
+void paramTransactionCommit(CRTPPacket *p);
+void paramTransactionAbort(CRTPPacket *p);
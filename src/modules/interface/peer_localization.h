@@ -4,16 +4,21 @@
 #include <stdbool.h>
 #include "math3d.h"
 #include "stabilizer_types.h"
+#include "autoconf.h"
 
-// This module tracks the positions of other Crazyflies. Currently, only motion
-// capture localization is supported. Mocap setups transmit position
-// measurements on the radio in broadcast mode, so we can obtain the positions
-// of other Crazyflies on the same radio "for free". In the future, other
-// methods of peer localization such as peer-to-peer sharing could be added.
+// This module tracks the positions of other Crazyflies. Mocap setups transmit
+// position measurements on the radio in broadcast mode, so we can obtain the
+// positions of other Crazyflies on the same radio "for free". With
+// CONFIG_PEER_LOCALIZATION_BROADCAST the Crazyflies also share their own
+// position and velocity estimates peer-to-peer.
 
 // The maximum number of other Crazyflie ID's to track. This constant may be
 // needed for static allocations in other modules, e.g. collision avoidance.
+#ifdef CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#define PEER_LOCALIZATION_MAX_NEIGHBORS CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#else
 #define PEER_LOCALIZATION_MAX_NEIGHBORS 10
+#endif
 
 // Initialize and test the module.
 void peerLocalizationInit();
@@ -24,20 +29,60 @@ typedef struct peerLocalizationOtherPosition_s {
   point_t pos; // position and timestamp (millisecs)
 } peerLocalizationOtherPosition_t;
 
+// The tracked peers, stored as a structure of arrays for fast iteration by
+// consumers that process all peers, e.g. collision avoidance. The peers are
+// packed in the index range [0, count). When the table is full and a new peer
+// is heard, the peer with the oldest position is evicted and its index is
+// reused, so the index of a peer is uncorrelated with its radio ID and may be
+// taken over by another peer.
+typedef struct peerLocalizationTable_s {
+  uint8_t count;
+  uint8_t id[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  uint32_t timestamp[PEER_LOCALIZATION_MAX_NEIGHBORS];  // millisecs
+  float x[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  float y[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  float z[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  // Velocity at the time of the position, only valid if hasVelocity is set.
+  // Peers that are only known from mocap positions have no velocity.
+  float vx[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  float vy[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  float vz[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  bool hasVelocity[PEER_LOCALIZATION_MAX_NEIGHBORS];
+} peerLocalizationTable_t;
+
 // Tell the peer localization system the position of another Crazyflie.
 // Should be called when the position is already known with high accuracy,
-// e.g. when a motion capture measurement packet is received.
+// e.g. when a motion capture measurement packet is received. If the table is
+// full, the peer with the oldest position is replaced. Returns false if the ID
+// is not valid (1 - 255).
 bool peerLocalizationTellPosition(int id, positionMeasurement_t const *pos);
 
+// Tell the peer localization system the position and velocity of another
+// Crazyflie, e.g. from the state it broadcasts itself. Same as
+// peerLocalizationTellPosition() otherwise.
+bool peerLocalizationTellPositionVelocity(int id, positionMeasurement_t const *pos, velocity_t const *vel);
+
 // Returns true if we have a position value for the given radio ID.
 bool peerLocalizationIsIDActive(uint8_t id);
 
-// Returns the position value for the given radio ID, or NULL if none exists.
-// Performs a linear search.
-peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t id);
+// Copies the position value for the given radio ID to *position. Returns false
+// if none exists. Constant time lookup.
+bool peerLocalizationGetPositionByID(uint8_t id, peerLocalizationOtherPosition_t *position);
+
+// Copies the position value based on index, uncorrelated with radio ID, to
+// *position. Returns false if there is no peer at the index.
+bool peerLocalizationGetPositionByIdx(uint8_t idx, peerLocalizationOtherPosition_t *position);
+
+// Returns the table of all tracked peers. More efficient if iterating over all
+// peers is needed.
+const peerLocalizationTable_t *peerLocalizationGetTable();
+
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+struct _P2PPacket;
 
-// Returns the position value based on index, uncorrelated with radio ID. More
-// efficient if iterating over all peers is needed.
-peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx);
+// Handles a received P2P packet. Returns true if it carried the state of
+// another Crazyflie, false if it belongs to another P2P port.
+bool peerLocalizationHandleP2P(struct _P2PPacket *p2pp);
+#endif
 
 #endif // __PEER_LOCALIZATION_H__
@@ -43,6 +43,7 @@ Header file for planning state machine
 #include "math3d.h"
 #include "pptraj.h"
 #include "pptraj_compressed.h"
+#include "pptraj_stream.h"
 
 enum trajectory_state
 {
@@ -56,10 +57,22 @@ enum trajectory_state
 	TRAJECTORY_STATE_DISABLED        = 4,
 };
 
+// maximum number of waypoints in a route planned on-board
+#define PLAN_MAX_WAYPOINTS 8
+
+// a waypoint of a route planned on-board
+struct plan_waypoint
+{
+	struct vec pos;  // m
+	float yaw;       // rad
+	float duration;  // s, time to get here from the previous waypoint. Zero to use the velocity limit
+};
+
 enum trajectory_type
 {
 	TRAJECTORY_TYPE_PIECEWISE            = 0,
-	TRAJECTORY_TYPE_PIECEWISE_COMPRESSED = 1
+	TRAJECTORY_TYPE_PIECEWISE_COMPRESSED = 1,
+	TRAJECTORY_TYPE_PIECEWISE_STREAM     = 2
 };
 
 struct planner
@@ -69,12 +82,13 @@ struct planner
 	bool reversed;					// true, if trajectory should be evaluated in reverse
 
 	union {
-		const struct piecewise_traj* trajectory; // pointer to trajectory
+		struct piecewise_traj* trajectory; // pointer to trajectory
 		struct piecewise_traj_compressed* compressed_trajectory; // pointer to compressed trajectory
+		struct piecewise_traj_stream* stream_trajectory; // pointer to streamed trajectory
 	};
 
 	struct piecewise_traj planned_trajectory; // trajectory for on-board planning
-	struct poly4d pieces[1]; // the on-board planner requires a single piece, only
+	struct poly4d pieces[PLAN_MAX_WAYPOINTS]; // one piece per segment, a single piece except for waypoint routes
 };
 
 // initialize the planner
@@ -114,11 +128,21 @@ int plan_go_to(struct planner *p, bool relative, struct vec hover_pos, float hov
 // same as above, but with current state provided from outside.
 int plan_go_to_from(struct planner *p, const struct traj_eval *curr_eval, bool relative, struct vec hover_pos, float hover_yaw, float duration, float t);
 
+// fly through a route of waypoints, then hover at the last one. The route is
+// planned as one 7th order piece per segment, passing the intermediate
+// waypoints without stopping. Segments with zero duration get a duration from
+// max_velocity. If relative, the waypoints are relative to the current setpoint.
+int plan_go_to_waypoints_from(struct planner *p, const struct traj_eval *curr_eval, bool relative,
+	const struct plan_waypoint *waypoints, int n_waypoints, float max_velocity, float t);
+
 // start trajectory. start_from param is ignored if relative == false.
 int plan_start_trajectory(struct planner *p, struct piecewise_traj* trajectory, bool reversed, bool relative, struct vec start_from);
 
 // start compressed trajectory. start_from param is ignored if relative == false.
 int plan_start_compressed_trajectory(struct planner *p, struct piecewise_traj_compressed* trajectory, bool relative, struct vec start_from);
 
+// start streamed trajectory. start_from param is ignored if relative == false.
+int plan_start_stream_trajectory(struct planner *p, struct piecewise_traj_stream* trajectory, bool relative, struct vec start_from);
+
 // Query if the trjectory is finished
 bool plan_is_finished(struct planner *p, float t);
@@ -40,5 +40,6 @@ bool platformserviceTest(void);
 
 int platformserviceSendAppchannelPacket(CRTPPacket *p);
 int platformserviceSendAppchannelPacketBlock(CRTPPacket *p);
+int platformserviceSendAppStreamPacket(CRTPPacket *p);
 
 #endif /* __PLATFORMSERVICE_H__ */
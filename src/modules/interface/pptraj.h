@@ -137,6 +137,25 @@ bool is_traj_eval_valid(struct traj_eval const *ev);
 // evaluate a single polynomial piece
 struct traj_eval poly4d_eval(struct poly4d const *p, float t);
 
+// bounds of a trajectory, found by sampling
+struct traj_bounds
+{
+	float duration; // s
+	float max_vel;  // m/s
+	float max_acc;  // m/s^2
+	float max_jerk; // m/s^3
+	float max_tilt; // rad, angle of the thrust vector from vertical
+};
+
+// a traj_bounds with all zero members.
+struct traj_bounds traj_bounds_zero(void);
+
+// extend the bounds with the bounds of a single piece. the piece is sampled
+// every POLY4D_BOUNDS_SAMPLE_TIME seconds (and at both ends) and the Euclidean
+// norms are used. the duration of the piece is added to the total.
+#define POLY4D_BOUNDS_SAMPLE_TIME 0.02f
+void poly4d_bounds_approx(struct poly4d const *p, struct traj_bounds *bounds);
+
 
 
 // ----------------------------------//
@@ -147,11 +166,47 @@ struct piecewise_traj
 {
 	float t_begin;
 	float timescale;
+	// per-axis scale of the position, applied around the origin before the
+	// shift. Must be (1, 1, 1) for the trajectory as defined
+	struct vec scale;
 	struct vec shift;
 	unsigned char n_pieces;
 	struct poly4d* pieces;
+
+	// mutable part of the data structure, a playhead and a cache of the
+	// current piece. Maintained by piecewise_eval() and
+	// piecewise_eval_reversed(), the rest is supplied by the user.
+	struct {
+		// the trajectory the cache was built for, the cache is rebuilt if
+		// any of these change
+		struct poly4d const* pieces;
+		unsigned char n_pieces;
+		float t_begin;
+		float timescale;
+		struct vec scale;
+		struct vec shift;
+		bool reversed;
+
+		// position of the current piece in the order of evaluation, -1 if
+		// there is no current piece
+		int position;
+
+		// start time of the current piece, relative to t_begin
+		float t_begin_relative;
+
+		// the current piece scaled, shifted, time-stretched and (if reversed) reflected
+		struct poly4d poly4d;
+	} current_piece;
 };
 
+// Invalidate the playhead and the cached piece. Must be called when the
+// pieces are modified in place.
+static inline void piecewise_reset_cache(struct piecewise_traj *pp)
+{
+	pp->current_piece.pieces = 0;
+	pp->current_piece.position = -1;
+}
+
 static inline float piecewise_duration(struct piecewise_traj const *pp)
 {
 	float total_dur = 0;
@@ -169,11 +224,19 @@ void piecewise_plan_7th_order_no_jerk(struct piecewise_traj *p, float duration,
 	struct vec p0, float y0, struct vec v0, float dy0, struct vec a0,
 	struct vec p1, float y1, struct vec v1, float dy1, struct vec a1);
 
+// plan a single piece with the same boundary conditions as above, to be used
+// when chaining several pieces into one trajectory.
+void poly4d_plan_7th_order_no_jerk(struct poly4d *p, float duration,
+	struct vec p0, float y0, struct vec v0, float dy0, struct vec a0,
+	struct vec p1, float y1, struct vec v1, float dy1, struct vec a1);
+
+// Evaluate the trajectory at time t. The current piece is tracked, evaluating
+// at increasing (or slowly decreasing) times is O(1) per call.
 struct traj_eval piecewise_eval(
-	struct piecewise_traj const *traj, float t);
+	struct piecewise_traj *traj, float t);
 
 struct traj_eval piecewise_eval_reversed(
-	struct piecewise_traj const *traj, float t);
+	struct piecewise_traj *traj, float t);
 
 
 static inline bool piecewise_is_finished(struct piecewise_traj const *traj, float t)
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "pptraj.h"
+#include <stdint.h>
 #include <stdio.h>
 
 enum piecewise_traj_storage_type {
@@ -40,6 +41,23 @@ enum piecewise_traj_storage_type {
 // compressed piecewise polynomial trajectories //
 // ---------------------------------------------//
 
+// Maximum number of entries in the seek index of a compressed trajectory. The
+// index covers every n:th piece, where n is the smallest power of two that
+// makes the whole trajectory fit.
+#define PPTRAJ_COMPRESSED_INDEX_SIZE 16
+
+// An entry in the seek index, the state needed to start decoding at a piece
+struct piecewise_traj_compressed_index_entry
+{
+	// raw representation of the piece
+	const void* data;
+	// start time of the piece, relative to the start of the trajectory
+	float t_begin_relative;
+	// start point of the piece, i.e. the end point of the previous piece
+	struct vec pos;
+	float yaw;
+};
+
 struct piecewise_traj_compressed
 {
 	float t_begin;
@@ -48,6 +66,10 @@ struct piecewise_traj_compressed
 	struct vec shift;
 	const void* data;
 
+	// sparse seek index, built when the trajectory is loaded
+	struct piecewise_traj_compressed_index_entry index[PPTRAJ_COMPRESSED_INDEX_SIZE];
+	uint8_t n_index;
+
 	// mutable part of the data structure. We plan to mess around with this part
 	// but keep the rest untouched (i.e. supplied by the user)
 	struct {
@@ -80,6 +102,31 @@ static inline bool piecewise_compressed_is_finished(
 struct traj_eval piecewise_compressed_eval(
 	struct piecewise_traj_compressed *traj, float t);
 
-// Loads the compressed trajectory at the given pointer
+// Loads the compressed trajectory at the given pointer. The data is walked
+// once to calculate the total duration and to build the seek index.
 void piecewise_compressed_load(
 	struct piecewise_traj_compressed *traj, const void* data);
+
+// Size of the starting point at the beginning of a compressed trajectory, in
+// bytes
+#define PPTRAJ_COMPRESSED_START_SIZE 8
+
+// Size of the header of a single piece of a compressed trajectory, in bytes
+#define PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE 3
+
+// Decodes the starting point of a compressed trajectory at the given pointer
+// into the position and yaw of the given evaluation, all derivatives are set
+// to zero. Returns a pointer to the first piece of the trajectory.
+const void* piecewise_compressed_decode_start(
+	const void* data, struct traj_eval *start);
+
+// Returns the size in bytes (header and body) of the compressed piece at the
+// given pointer, or zero if the piece marks the end of the trajectory. Only
+// the header of the piece is read.
+int piecewise_compressed_piece_size(const void* data);
+
+// Decodes the compressed piece at the given pointer into a poly4d. Compressed
+// pieces start where the previous piece ended, prev_end is the evaluation at
+// the end of the previous piece (or the starting point for the first piece).
+void piecewise_compressed_decode_piece(
+	const void* data, const struct traj_eval *prev_end, struct poly4d *poly4d);
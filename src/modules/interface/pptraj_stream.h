@@ -0,0 +1,123 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * pptraj_stream.h - Streamed piecewise polynomial trajectories
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pptraj.h"
+
+// ---------------------------------------------//
+// streamed piecewise polynomial trajectories   //
+// ---------------------------------------------//
+
+// A trajectory of unbounded length where the pieces are kept in a ring buffer.
+// The client appends pieces while the trajectory is flown, the pieces are
+// released when the playhead has passed them. If the playhead reaches the end
+// of the buffered pieces before the client has marked the stream as complete,
+// the trajectory holds the end point of the last piece and the time base is
+// moved forward, the trajectory continues from the hold point when more pieces
+// are appended.
+struct piecewise_traj_stream
+{
+	// start time of the piece at the head of the ring buffer
+	float t_begin;
+	float timescale;
+	struct vec shift;
+
+	// ring buffer storage, supplied by the user
+	struct poly4d* pieces;
+	uint16_t capacity;
+
+	// the ring buffer holds the pieces [head, head + count) (modulo capacity)
+	uint16_t head;
+	uint16_t count;
+
+	// true when the client has appended the last piece
+	bool complete;
+	// true while holding position, waiting for more pieces
+	bool underrun;
+	uint32_t underrun_count;
+
+	// evaluation at the end of the last appended piece, this is where a
+	// compressed piece that is appended continues from
+	struct traj_eval tail_end;
+	bool has_tail;
+
+	// mutable part of the data structure, the piece at the head stretched with
+	// the timescale
+	struct {
+		int16_t position;
+		float timescale;
+		struct poly4d poly4d;
+	} current_piece;
+};
+
+// Initializes an empty stream that stores its pieces in the given buffer.
+void piecewise_stream_init(struct piecewise_traj_stream *stream,
+	struct poly4d* buffer, int capacity);
+
+// Appends a piece to the end of the stream. Returns false if the stream is
+// full or already complete.
+bool piecewise_stream_append(struct piecewise_traj_stream *stream,
+	struct poly4d const *piece);
+
+// Decodes and appends pieces in the compressed format (see pptraj_compressed.h)
+// to the stream. The first data appended to an empty stream must start with
+// the starting point of the compressed trajectory, later data only holds
+// pieces. A piece with zero duration marks the end of the trajectory and
+// completes the stream. At most size bytes are read from data. Returns the
+// number of pieces appended, or -1 if the data is truncated or the stream would
+// overflow, in which case nothing is appended.
+int piecewise_stream_append_compressed(struct piecewise_traj_stream *stream,
+	const void* data, int size, int n_pieces);
+
+// Marks the stream as complete, no more pieces will be appended. The
+// trajectory finishes at the end of the last piece.
+static inline void piecewise_stream_set_complete(struct piecewise_traj_stream *stream)
+{
+	stream->complete = true;
+}
+
+// Returns the number of pieces that can be appended to the stream.
+static inline int piecewise_stream_free(struct piecewise_traj_stream const *stream)
+{
+	return stream->capacity - stream->count;
+}
+
+// Returns the duration of the pieces in the stream that have not been
+// consumed yet, starting at t_begin.
+float piecewise_stream_buffered_duration(struct piecewise_traj_stream const *stream);
+
+// Returns whether we have finished flying the trajectory. A stream that is not
+// complete is never finished.
+bool piecewise_stream_is_finished(struct piecewise_traj_stream const *stream, float t);
+
+// Evaluates the trajectory at the given time instant. Pieces that the
+// playhead has passed are released. The time must not decrease between calls.
+struct traj_eval piecewise_stream_eval(struct piecewise_traj_stream *stream, float t);
@@ -0,0 +1,93 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * queuestats.h - Always on statistics for the most important queues
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "autoconf.h"
+
+// The monitored queues, each has a fixed set of log variables in the queueStat group
+typedef enum {
+  queueStatsCrtpTxControl = 0,
+  queueStatsCrtpTxConfig,
+  queueStatsCrtpTxBulk,
+  queueStatsRadioTx,
+  queueStatsSyslinkRx,
+  queueStatsEstimator,
+  queueStatsWorker,
+  queueStats_COUNT,
+} queueStatsId_t;
+
+#ifdef CONFIG_QUEUE_STATS
+
+/**
+ * Initialize the statistics and start the periodic update of the wait times.
+ * Must be called after workerInit().
+ */
+void queueStatsInit(void);
+
+/**
+ * Monitor a FreeRTOS queue. Sends and receives are recorded by the kernel
+ * trace hooks, the queue is identified by bits 16-23 of its queue number.
+ *
+ * @param queue The queue handle
+ * @param id The statistics to update
+ */
+void queueStatsRegister(void* queue, const queueStatsId_t id);
+
+/**
+ * Record a change of a queue that is not a FreeRTOS queue. The depth goes
+ * from depthBefore to depthBefore + added - removed. Must be called while
+ * the queue is protected from concurrent updates.
+ */
+void queueStatsUpdate(const queueStatsId_t id, const uint32_t depthBefore, const uint32_t added, const uint32_t removed);
+
+/**
+ * Record an item that was not added since the queue was full.
+ */
+void queueStatsFull(const queueStatsId_t id);
+
+// Kernel trace hooks, see trace.h. The item is not yet added or removed when
+// the hooks are called.
+#define QUEUE_STATS_NUMBER_SHIFT 16
+#define QUEUE_STATS_ID(queueNumber) ((((queueNumber) >> QUEUE_STATS_NUMBER_SHIFT) & 0xff) - 1)
+#define QUEUE_STATS_IS_MONITORED(queueNumber) (((queueNumber) >> QUEUE_STATS_NUMBER_SHIFT) & 0xff)
+
+#define QUEUE_STATS_TRACE_SEND(queueNumber, waiting) \
+  do { if (QUEUE_STATS_IS_MONITORED(queueNumber)) queueStatsUpdate(QUEUE_STATS_ID(queueNumber), (waiting), 1, 0); } while (0)
+#define QUEUE_STATS_TRACE_RECEIVE(queueNumber, waiting) \
+  do { if (QUEUE_STATS_IS_MONITORED(queueNumber)) queueStatsUpdate(QUEUE_STATS_ID(queueNumber), (waiting), 0, 1); } while (0)
+#define QUEUE_STATS_TRACE_SEND_FAILED(queueNumber) \
+  do { if (QUEUE_STATS_IS_MONITORED(queueNumber)) queueStatsFull(QUEUE_STATS_ID(queueNumber)); } while (0)
+
+#else
+
+#define queueStatsInit()
+#define queueStatsRegister(queue, id)
+#define queueStatsUpdate(id, depthBefore, added, removed)
+#define queueStatsFull(id)
+
+#endif // CONFIG_QUEUE_STATS
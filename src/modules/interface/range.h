@@ -27,6 +27,10 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "stabilizer_types.h"
+
 typedef enum {
     rangeFront=0,
     rangeBack,
@@ -38,13 +42,22 @@ typedef enum {
 } rangeDirection_t;
 
 /**
- * Set the range for a certain direction
+ * Set the range for a certain direction, time stamped with the current time
  *
  * @param direction Direction of the range
  * @param range_m Distance to an object in meter
  */
 void rangeSet(rangeDirection_t direction, float range_m);
 
+/**
+ * Set the range for a certain direction
+ *
+ * @param direction Direction of the range
+ * @param range_m Distance to an object in meter
+ * @param timestamp The time when the range was sampled (in sys ticks)
+ */
+void rangeSetWithTimestamp(rangeDirection_t direction, float range_m, uint32_t timestamp);
+
 /**
  * Get the range for a certain direction
  *
@@ -53,6 +66,14 @@ void rangeSet(rangeDirection_t direction, float range_m);
  */
 float rangeGet(rangeDirection_t direction);
 
+/**
+ * Get the time of the latest range for a certain direction
+ *
+ * @param direction Direction of the range
+ * @return The time when the range was sampled (in sys ticks), 0 if no range has been set
+ */
+uint32_t rangeGetTimestamp(rangeDirection_t direction);
+
 /**
  * Enqueue a range measurement for distance to the ground in the current estimator.
  *
@@ -61,3 +82,19 @@ float rangeGet(rangeDirection_t direction);
  * @param timeStamp The time when the range was sampled (in sys ticks)
  */
 void rangeEnqueueDownRangeInEstimator(float distance, float stdDev, uint32_t timeStamp);
+
+/**
+ * Hold the down range measurements instead of enqueuing them in the estimator. Used by a driver that enqueues them
+ * together with its own measurements, the latest held measurement is fetched with rangeTakeDownRange().
+ *
+ * @param hold True to hold the measurements, false to enqueue them directly again
+ */
+void rangeHoldDownRange(const bool hold);
+
+/**
+ * Take the latest held down range measurement, see rangeHoldDownRange()
+ *
+ * @param tof Set to the measurement
+ * @return true if there was a new measurement since the previous call
+ */
+bool rangeTakeDownRange(tofMeasurement_t* tof);
@@ -0,0 +1,79 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * rate_loop.h - Attitude rate loop running on every gyro sample, decoupled
+ * from the 1 kHz stabilizer loop.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "stabilizer_types.h"
+
+/**
+ * Rate of the inner rate loop, equal to the gyro output data rate. 2 kHz is the
+ * highest output data rate the bmi088 gyro supports.
+ */
+#define RATE_LOOP_RATE_HZ  2000
+
+// Setpoints and controls older than this are stale and not used to drive the motors
+#define RATE_LOOP_TIMEOUT_MS  10
+
+void rateLoopInit(void);
+
+/**
+ * @brief Set the desired rates and thrust for the rate loop. Called by the controller, in the
+ * stabilizer task, every time the attitude controller has been updated.
+ *
+ * @param rateDesired The desired roll, pitch and yaw rates (deg/s)
+ * @param thrust The thrust, 0 resets the rate PIDs and outputs zero control
+ */
+void rateLoopSetSetpoint(const attitude_t* rateDesired, const float thrust);
+
+/**
+ * @brief Let the stabilizer tell the rate loop if the supervisor allows the motors to run.
+ * The rate loop never drives the motors when not allowed to.
+ */
+void rateLoopSetMotorsAllowed(const bool areMotorsAllowedToRun);
+
+/**
+ * @brief Hand over the control of the stabilizer loop, called by the stabilizer task
+ * every tick the motors are allowed to run. The rate loop drives the motors with it
+ * when the controller does not provide a fresh setpoint.
+ *
+ * The rate loop is the only one calling stabilizerControlMotors() when enabled, the
+ * stabilizer must not set the motors itself.
+ */
+void rateLoopSetStabilizerControl(const control_t* control);
+
+/**
+ * @brief Run one iteration of the rate loop, called by the sensor task for every gyro sample.
+ *
+ * @param gyro The filtered gyro sample aligned to the airframe (deg/s)
+ */
+void rateLoopGyroSample(const Axis3f* gyro);
+
+/**
+ * @brief Get the latest control output of the rate loop, for logging in the stabilizer task
+ */
+void rateLoopGetControl(control_t* control);
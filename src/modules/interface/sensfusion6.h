@@ -31,6 +31,13 @@ void sensfusion6Init(void);
 bool sensfusion6Test(void);
 
 void sensfusion6UpdateQ(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+/**
+ * Cheaper variant of sensfusion6UpdateQ() for high update rates, without branches in the
+ * fusion. The gravity direction used by sensfusion6GetEulerRPY() and
+ * sensfusion6GetAccZWithoutGravity() is only computed when one of them is called.
+ */
+void sensfusion6UpdateQFast(float gx, float gy, float gz, float ax, float ay, float az, float dt);
 void sensfusion6GetQuaternion(float* qx, float* qy, float* qz, float* qw);
 void sensfusion6GetEulerRPY(float* roll, float* pitch, float* yaw);
 float sensfusion6GetAccZWithoutGravity(const float ax, const float ay, const float az);
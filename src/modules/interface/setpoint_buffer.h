@@ -0,0 +1,111 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * setpoint_buffer.h - Jitter buffer for timestamped streamed setpoints
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stabilizer_types.h"
+
+// Number of setpoints the buffer holds. Together with the setpoint rate this
+// limits the useful latency, 8 setpoints at 100 Hz cover 70 ms.
+#define SETPOINT_BUFFER_SIZE 8
+
+// The buffer is restarted when no setpoint has arrived for this long
+#define SETPOINT_BUFFER_RESYNC_MS 500
+
+// The offset between the sender clock and the local clock is increased by 1 ms
+// this often, to follow a sender clock that runs slower than ours.
+#define SETPOINT_BUFFER_OFFSET_CREEP_MS 1000
+
+typedef struct {
+  // Time the setpoints are delayed with, counted from the earliest arrival of
+  // a setpoint seen so far
+  uint16_t latencyMs;
+  // How long the last two setpoints are extrapolated when the buffer runs dry,
+  // after that the setpoint is held
+  uint16_t maxExtrapolationMs;
+} setpointBufferConfig_t;
+
+typedef struct {
+  setpoint_t setpoint;
+  uint32_t senderTime;  // ms, unwrapped sender time
+  uint32_t arrivalTime; // ms, local time
+} setpointBufferEntry_t;
+
+// A jitter buffer for setpoints streamed with a sender timestamp. The setpoints
+// are played back with a fixed delay relative to the sender clock and
+// interpolated at the rate of the caller, which hides the jitter of the radio
+// link. The offset between the sender clock and the local clock is estimated
+// from the fastest arrival, so the clocks do not have to be synchronized.
+typedef struct {
+  // The ring holds the setpoints [head, head + count), sorted on sender time
+  setpointBufferEntry_t entries[SETPOINT_BUFFER_SIZE];
+  uint8_t head;
+  uint8_t count;
+
+  // The setpoint that was released last, used to extrapolate from when only
+  // one setpoint is left
+  setpointBufferEntry_t previous;
+  bool hasPrevious;
+
+  bool isSynced;
+  uint32_t lastSenderTime;
+  int32_t offset;  // local time - sender time, ms
+  uint32_t lastCreepTime;
+
+  // Sender time of the last evaluation, setpoints older than this are late
+  uint32_t lastPlayTime;
+  bool hasPlayTime;
+
+  // Statistics
+  int32_t jitterMs;  // how late the last setpoint arrived, relative to the fastest one
+  int32_t delayMs;   // time the setpoint that is played back has spent in the buffer
+  uint32_t lateCount;
+  uint32_t overflowCount;
+  uint32_t extrapolationCount;
+  uint32_t holdCount;
+} setpointBuffer_t;
+
+// Empties the buffer, the clock offset is estimated from scratch when the next
+// setpoint is pushed. The statistic counters are kept.
+void setpointBufferReset(setpointBuffer_t* buffer);
+
+// Adds a setpoint to the buffer. The sender time is a free running 16 bit
+// millisecond counter of the sender, it is unwrapped by the buffer. Returns
+// false if the setpoint is not newer than the last setpoint that was pushed,
+// in which case it is dropped.
+bool setpointBufferPush(setpointBuffer_t* buffer, const setpoint_t* setpoint, uint16_t senderTimeMs, uint32_t nowMs);
+
+// Evaluates the buffer at the given local time. The setpoints that have been
+// passed are released. The timestamp of the result is the arrival time of the
+// newest setpoint in the buffer. Returns false if the buffer is empty.
+bool setpointBufferGet(setpointBuffer_t* buffer, const setpointBufferConfig_t* config, uint32_t nowMs, setpoint_t* result);
+
+static inline int setpointBufferGetDepth(const setpointBuffer_t* buffer) {
+  return buffer->count;
+}
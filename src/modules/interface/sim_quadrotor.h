@@ -0,0 +1,107 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sim_quadrotor.h - Rigid body model of a quadrotor, used for simulated sensors
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "math3d.h"
+#include "stabilizer_types.h"
+
+/**
+ * A rigid body model of a quadrotor in the X configuration, driven by the motor commands. The motor order, the arm
+ * length and the PWM to thrust mapping are the same as in power_distribution_quadrotor.c. The body stops on the ground
+ * plane (z = 0) and can not fall through it, which is enough to take off and land.
+ *
+ * The model has no dependencies on FreeRTOS or the hardware and is stepped with a fixed time step. It is used by the
+ * simulated sensors (sensors_sim.c), but can also be used on its own.
+ */
+
+typedef struct {
+  float mass; // kg
+  float armLength; // m
+  float inertia[3]; // Diagonal of the inertia matrix [kg m^2]
+  float thrustToTorque; // Yaw torque per Newton thrust [m]
+  // thrust = a * pwm^2 + b * pwm, where pwm is normalized (0...1) and the thrust is in Newtons (per rotor)
+  float pwmToThrustA;
+  float pwmToThrustB;
+  float drag; // Linear drag [N / (m/s)]
+  float motorTimeConstant; // s
+} simQuadrotorParams_t;
+
+typedef struct {
+  simQuadrotorParams_t params;
+
+  struct vec position; // m, world frame
+  struct vec velocity; // m/s, world frame
+  struct quat attitude; // body to world
+  struct vec angularVelocity; // rad/s, body frame
+  float motorThrust[STABILIZER_NR_OF_MOTORS]; // N, after the motor time constant
+  struct vec acceleration; // m/s^2, world frame, including gravity
+  bool isOnGround;
+} simQuadrotor_t;
+
+/**
+ * @brief Get the parameters of a Crazyflie 2.x
+ */
+void simQuadrotorDefaultParams(simQuadrotorParams_t* params);
+
+/**
+ * @brief Initialize the model at rest on the ground
+ *
+ * @param this  The model
+ * @param params  Parameters, copied to the model
+ * @param position  Initial position, z should be 0
+ * @param yaw  Initial yaw [rad]
+ */
+void simQuadrotorInit(simQuadrotor_t* this, const simQuadrotorParams_t* params, const struct vec position, const float yaw);
+
+/**
+ * @brief Advance the model one time step
+ *
+ * @param this  The model
+ * @param motorRatio  The motor commands, 0 - UINT16_MAX as from motorsGetRatio()
+ * @param dt  Time step [s]
+ */
+void simQuadrotorStep(simQuadrotor_t* this, const uint16_t motorRatio[STABILIZER_NR_OF_MOTORS], const float dt);
+
+/**
+ * @brief What a gyro would read
+ *
+ * @param gyro  The angular velocity in the body frame [deg/s]
+ */
+void simQuadrotorGetGyro(const simQuadrotor_t* this, Axis3f* gyro);
+
+/**
+ * @brief What an accelerometer would read, 1 G up at rest
+ *
+ * @param acc  The specific force in the body frame [G]
+ */
+void simQuadrotorGetAcc(const simQuadrotor_t* this, Axis3f* acc);
+
+/**
+ * @brief What a barometer would read, with the ground plane at sea level
+ */
+void simQuadrotorGetBaro(const simQuadrotor_t* this, baro_t* baro);
@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #include "estimator.h"
+#include "stabilizer_types.h"
 
 /**
  * Initialize the stabilizer subsystem and launch the stabilizer loop task.
@@ -44,4 +45,112 @@ void stabilizerInit(StateEstimatorType estimator);
  */
 bool stabilizerTest(void);
 
+/**
+ * Run power distribution and battery compensation for a control output and set
+ * the motors. Used by the stabilizer loop, and by the inner rate loop when enabled.
+ */
+void stabilizerControlMotors(const control_t* control);
+
+/**
+ * Get a consistent copy of the latest state estimate, setpoint or sensor data. They are published by the stabilizer
+ * loop once per iteration, after the motors have been set. The copy is protected by a sequence lock, it never blocks the
+ * stabilizer loop and is safe to use from any task with a lower priority than the stabilizer loop, for instance apps.
+ * Do not call from an ISR.
+ * @return True if a consistent copy was made.
+ */
+bool stabilizerGetState(state_t* state);
+bool stabilizerGetSetpoint(setpoint_t* setpoint);
+bool stabilizerGetSensorData(sensorData_t* sensorData);
+
+/**
+ * Compact fixed point versions of the state estimate and the setpoint, as logged in the stateEstimateZ and ctrltargetZ
+ * log groups.
+ */
+typedef struct {
+  // position - mm
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  // velocity - mm / sec
+  int16_t vx;
+  int16_t vy;
+  int16_t vz;
+  // acceleration - mm / sec^2
+  int16_t ax;
+  int16_t ay;
+  int16_t az;
+  // compressed quaternion, see quatcompress.h
+  int32_t quat;
+  // angular velocity - milliradians / sec
+  int16_t rateRoll;
+  int16_t ratePitch;
+  int16_t rateYaw;
+} stateCompressed_t;
+
+typedef struct {
+  // position - mm
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  // velocity - mm / sec
+  int16_t vx;
+  int16_t vy;
+  int16_t vz;
+  // acceleration - mm / sec^2
+  int16_t ax;
+  int16_t ay;
+  int16_t az;
+} setpointCompressed_t;
+
+/**
+ * Convert a state estimate, with the angular velocity from the gyro, or a setpoint to the compact format.
+ */
+void stabilizerCompressState(const state_t* state, const sensorData_t* sensorData, stateCompressed_t* dest);
+void stabilizerCompressSetpoint(const setpoint_t* setpoint, setpointCompressed_t* dest);
+
+/**
+ * The variables of one stabilizer iteration, published together after the motors have been set.
+ */
+typedef struct {
+  stabilizerStep_t step;
+  state_t state;
+  setpoint_t setpoint;
+  sensorData_t sensorData;
+  control_t control;
+} stabilizerSnapshot_t;
+
+/**
+ * Get a consistent copy of all variables of the latest stabilizer iteration. Same rules as stabilizerGetState().
+ * @return True if a consistent copy was made.
+ */
+bool stabilizerGetSnapshot(stabilizerSnapshot_t* snapshot);
+
+/**
+ * Read the latest snapshot in place, without copying it. Read the fields that are needed from the returned pointer
+ * and call stabilizerSnapshotReadEnd() with the sequence number. If it returns false the snapshot was updated during
+ * the read, the values must be discarded and the read retried. Same rules as stabilizerGetState().
+ *
+ * Example:
+ *   uint32_t sequence;
+ *   float z;
+ *   do {
+ *     const stabilizerSnapshot_t* snapshot = stabilizerSnapshotReadBegin(&sequence);
+ *     z = snapshot->state.position.z;
+ *   } while (!stabilizerSnapshotReadEnd(sequence));
+ *
+ * @param sequence Set to the sequence number to pass to stabilizerSnapshotReadEnd()
+ * @return The published snapshot
+ */
+const stabilizerSnapshot_t* stabilizerSnapshotReadBegin(uint32_t* sequence);
+bool stabilizerSnapshotReadEnd(const uint32_t sequence);
+
+typedef void (*stabilizerTickCallback_t)(const stabilizerSnapshot_t* snapshot);
+
+/**
+ * Register a function that is called by the stabilizer loop every iteration, right after the snapshot has been
+ * published. The function runs in the stabilizer task at 1 kHz and must return quickly, for instance by notifying a
+ * task or copying a few values. Only one function can be registered, pass NULL to unregister.
+ */
+void stabilizerSetTickCallback(stabilizerTickCallback_t callback);
+
 #endif /* STABILIZER_H_ */
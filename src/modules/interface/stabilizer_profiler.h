@@ -0,0 +1,108 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * stabilizer_profiler.h - CPU cycles spent per stage of the stabilizer loop,
+ * as min/average/max and as log2 histograms, over the latest second.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "statsCnt.h"
+
+typedef enum {
+  StabilizerStageSensors = 0,         // sensorsAcquire()
+  StabilizerStageEstimator,           // stateEstimator()
+  StabilizerStageSetpoint,            // crtpCommanderHighLevelGetSetpoint() and commanderGetSetpoint()
+  StabilizerStageSupervisor,          // supervisorUpdate()
+  StabilizerStageCollisionAvoidance,  // collisionAvoidanceUpdateSetpoint()
+  StabilizerStageController,          // controller()
+  StabilizerStageMotors,              // controlMotors()
+  StabilizerStagePublish,             // Publication of state, setpoint and sensor data, see stabilizerGetState()
+  StabilizerStageLoop,                // The full loop, from sensor data being ready until the end of the iteration
+  StabilizerStage_COUNT,
+} stabilizerProfilerStage_t;
+
+// Bin 0 holds values below 2^STABILIZER_PROFILER_FIRST_BIT cycles, bin n values in
+// [2^(STABILIZER_PROFILER_FIRST_BIT + n - 1), 2^(STABILIZER_PROFILER_FIRST_BIT + n)) and the last bin everything above.
+#define STABILIZER_PROFILER_HISTOGRAM_BINS (12)
+#define STABILIZER_PROFILER_FIRST_BIT (8)
+
+#define STABILIZER_PROFILER_INTERVAL_MS (1000)
+
+typedef struct {
+  statsCntMinMaxAvg_t cycles;
+
+  uint16_t bins[STABILIZER_PROFILER_HISTOGRAM_BINS];
+  // Histogram of the latest completed interval
+  uint16_t latestBins[STABILIZER_PROFILER_HISTOGRAM_BINS];
+} stabilizerProfilerStageStats_t;
+
+/**
+ * @brief Clear all statistics
+ */
+void stabilizerProfilerInit(void);
+
+/**
+ * @brief Add the number of cycles spent in a stage for one iteration of the loop
+ *
+ * @param stage The stage
+ * @param cycles Number of cycles
+ */
+void stabilizerProfilerAdd(const stabilizerProfilerStage_t stage, const uint32_t cycles);
+
+/**
+ * @brief Move the collected statistics to the latest values when the interval has passed. Call once per iteration of
+ * the loop.
+ *
+ * @param nowMs The current time [ms]
+ * @return true if the latest values were updated
+ */
+bool stabilizerProfilerUpdate(const uint32_t nowMs);
+
+/**
+ * @brief Get the statistics for a stage
+ *
+ * @param stage The stage
+ * @return const stabilizerProfilerStageStats_t* The statistics, or 0 if stage is out of range
+ */
+const stabilizerProfilerStageStats_t* stabilizerProfilerGetStage(const uint8_t stage);
+
+/**
+ * @brief Get the histogram bin for a number of cycles
+ *
+ * @param cycles Number of cycles
+ * @return int The index of the bin
+ */
+static inline int stabilizerProfilerBin(const uint32_t cycles) {
+  if (cycles < (1u << STABILIZER_PROFILER_FIRST_BIT)) {
+    return 0;
+  }
+
+  const int bitLength = 32 - __builtin_clz(cycles);
+  const int bin = bitLength - STABILIZER_PROFILER_FIRST_BIT;
+  if (bin >= STABILIZER_PROFILER_HISTOGRAM_BINS) {
+    return STABILIZER_PROFILER_HISTOGRAM_BINS - 1;
+  }
+  return bin;
+}
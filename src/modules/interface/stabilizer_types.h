@@ -108,6 +108,7 @@ typedef struct tdoaMeasurement_s {
 
   float distanceDiff;
   float stdDev;
+  uint32_t eventTimeUs; // Lower 32 bits of usecTimestamp() at the time of the measurement, 0 if unknown
 } tdoaMeasurement_t;
 
 typedef struct baro_s {
@@ -127,6 +128,7 @@ typedef struct positionMeasurement_s {
   };
   float stdDev;
   measurementSource_t source;
+  uint32_t eventTimeUs; // Lower 32 bits of usecTimestamp() at the time of the measurement, 0 if unknown
 } positionMeasurement_t;
 
 typedef struct poseMeasurement_s {
@@ -141,6 +143,7 @@ typedef struct poseMeasurement_s {
   quaternion_t quat;
   float stdDevPos;
   float stdDevQuat;
+  uint32_t eventTimeUs; // Lower 32 bits of usecTimestamp() at the time of the measurement, 0 if unknown
 } poseMeasurement_t;
 
 typedef struct distanceMeasurement_s {
@@ -162,6 +165,8 @@ typedef struct zDistance_s {
   float distance;           // m
 } zDistance_t;
 
+#define STABILIZER_NR_OF_MOTORS 4
+
 typedef struct sensorData_s {
   Axis3f acc;               // Gs
   Axis3f gyro;              // deg/s
@@ -171,6 +176,7 @@ typedef struct sensorData_s {
   Axis3f accSec;            // Gs
   Axis3f gyroSec;           // deg/s
 #endif
+  float motorRpm[STABILIZER_NR_OF_MOTORS]; // RPM, from bidirectional DSHOT telemetry
   uint64_t interruptTimestamp;
 } sensorData_t;
 
@@ -182,8 +188,6 @@ typedef struct state_s {
   acc_t acc;                // Gs (but acc.z without considering gravity)
 } state_t;
 
-#define STABILIZER_NR_OF_MOTORS 4
-
 typedef enum control_mode_e {
   controlModeLegacy      = 0, // legacy mode with int16_t roll, pitch, yaw and float thrust
   controlModeForceTorque = 1,
@@ -337,18 +341,21 @@ typedef struct {
   float stdDev;
   const lighthouseCalibrationSweep_t* calib;
   lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
+  uint32_t eventTimeUs;      // Lower 32 bits of usecTimestamp() at the time of the measurement, 0 if unknown
 } sweepAngleMeasurement_t;
 
 /** gyroscope measurement */
 typedef struct
 {
   Axis3f gyro; // deg/s, for legacy reasons
+  uint32_t sampleTimeUs; // Lower 32 bits of usecTimestamp() at the data ready interrupt of the sample, 0 if unknown
 } gyroscopeMeasurement_t;
 
 /** accelerometer measurement */
 typedef struct
 {
   Axis3f acc; // Gs, for legacy reasons
+  uint32_t sampleTimeUs; // Lower 32 bits of usecTimestamp() at the data ready interrupt of the sample, 0 if unknown
 } accelerationMeasurement_t;
 
 /** barometer measurement */
@@ -31,6 +31,8 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include "cfassert.h"
 
 /**
@@ -73,6 +75,60 @@
   #define FORCE_CCM_ZERO_INIT __attribute__((section(".ccmbss")))
 #endif
 
+/**
+ * @brief Macro to place a variable in the CCM (Core Coupled Memroy) in a
+ * section that is not initialized at start up. The content survives a warm
+ * reset (watchdog, assert or software reset) but is random after a power on,
+ * the user must validate it, for instance with a magic number. The same DMA
+ * restrictions as for NO_DMA_CCM_SAFE_ZERO_INIT apply.
+ */
+#if defined(UNIT_TEST_MODE)
+  #define NO_DMA_CCM_SAFE_NO_INIT
+#else
+  #define NO_DMA_CCM_SAFE_NO_INIT __attribute__((section(".ccmnzds")))
+#endif
+
+
+/**
+ * @brief Allocate memory in CCM at runtime, for pools whose size is not known
+ * at compile time.
+ *
+ * The blocks are taken from the part of the CCM that is not used by static
+ * variables (the CCM arena), they are 8 byte aligned, zero initialized and can
+ * not be freed. As with NO_DMA_CCM_SAFE_ZERO_INIT, the memory can not be
+ * used for DMA transfers. Intended to be called during init.
+ *
+ * @param size The size of the block in bytes
+ * @return A pointer to the block, or NULL if the CCM arena is exhausted
+ */
+void* ccmArenaAlloc(const size_t size);
+
+/**
+ * @brief The number of bytes left in the CCM arena
+ */
+size_t ccmArenaGetFree(void);
+
+/**
+ * @brief Record describing one static allocation made by the macros in this file.
+ *
+ * Every STATIC_MEM_xxx_ALLOC() adds a record to the .staticMem linker section,
+ * the records can be iterated at runtime to attribute the RAM and CCM usage to
+ * the modules (source files) that made the allocations.
+ */
+typedef struct {
+  const char* name;
+  const char* file;
+  uint32_t ramSize;
+  uint32_t ccmSize;
+} staticMemRecord_t;
+
+#if defined(UNIT_TEST_MODE)
+  #define STATIC_MEM_REGISTER(NAME, RAM_SIZE, CCM_SIZE)
+#else
+  #define STATIC_MEM_REGISTER(NAME, RAM_SIZE, CCM_SIZE) \
+    static const staticMemRecord_t osSys_ ## NAME ## MemRecord __attribute__((section(".staticMem." #NAME), used)) = \
+      {.name = #NAME, .file = __FILE__, .ramSize = (RAM_SIZE), .ccmSize = (CCM_SIZE)};
+#endif
 
 /**
  * @brief Creation of queues using static memory.
@@ -121,7 +177,8 @@
   static const int osSys_ ## NAME ## Length = (LENGTH); \
   static const int osSys_ ## NAME ## ItemSize = (ITEM_SIZE); \
   NO_DMA_CCM_SAFE_ZERO_INIT static uint8_t osSys_ ## NAME ## Storage[(LENGTH) * (ITEM_SIZE)]; \
-  NO_DMA_CCM_SAFE_ZERO_INIT static StaticQueue_t osSys_ ## NAME ## Mgm;
+  NO_DMA_CCM_SAFE_ZERO_INIT static StaticQueue_t osSys_ ## NAME ## Mgm; \
+  STATIC_MEM_REGISTER(NAME, 0, (LENGTH) * (ITEM_SIZE) + sizeof(StaticQueue_t))
 
 /**
  * @brief Creates a queue using static memory
@@ -175,7 +232,8 @@
 #define STATIC_MEM_TASK_ALLOC(NAME, STACK_DEPTH) \
   static const int osSys_ ## NAME ## StackDepth = (STACK_DEPTH); \
   static StackType_t osSys_ ## NAME ## StackBuffer[(STACK_DEPTH)]; \
-  NO_DMA_CCM_SAFE_ZERO_INIT static StaticTask_t osSys_ ## NAME ## TaskBuffer;
+  NO_DMA_CCM_SAFE_ZERO_INIT static StaticTask_t osSys_ ## NAME ## TaskBuffer; \
+  STATIC_MEM_REGISTER(NAME, (STACK_DEPTH) * sizeof(StackType_t), sizeof(StaticTask_t))
 
 /**
  * @brief Allocate variables and stack for a task using static memory.
@@ -191,7 +249,8 @@
 #define STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(NAME, STACK_DEPTH) \
   static const int osSys_ ## NAME ## StackDepth = (STACK_DEPTH); \
   NO_DMA_CCM_SAFE_ZERO_INIT static StackType_t osSys_ ## NAME ## StackBuffer[(STACK_DEPTH)]; \
-  NO_DMA_CCM_SAFE_ZERO_INIT static StaticTask_t osSys_ ## NAME ## TaskBuffer;
+  NO_DMA_CCM_SAFE_ZERO_INIT static StaticTask_t osSys_ ## NAME ## TaskBuffer; \
+  STATIC_MEM_REGISTER(NAME, 0, (STACK_DEPTH) * sizeof(StackType_t) + sizeof(StaticTask_t))
 
 /**
  * @brief Create a task using static memory
@@ -28,6 +28,16 @@
 
 #include "stabilizer_types.h"
 
+// Bits of the supervisor.info log variable, see supervisorGetInfoField()
+#define SUPERVISOR_INFO_CAN_ARM    0x0001
+#define SUPERVISOR_INFO_IS_ARMED   0x0002
+#define SUPERVISOR_INFO_AUTO_ARM   0x0004
+#define SUPERVISOR_INFO_CAN_FLY    0x0008
+#define SUPERVISOR_INFO_IS_FLYING  0x0010
+#define SUPERVISOR_INFO_IS_TUMBLED 0x0020
+#define SUPERVISOR_INFO_IS_LOCKED  0x0040
+#define SUPERVISOR_INFO_IS_CRASHED 0x0080
+
 /**
  * @brief Update the supervisor state.
  *
@@ -35,6 +45,9 @@
  *   - collecting data from the system (conditions)
  *   - possibly change state, based on the conditions
  *
+ * Call on every tick of the stabilizer loop. The checks that can stop the motors run on every call, the other checks
+ * are decimated to the rates they need.
+ *
  * @param sensors        Latest sensor data
  * @param setpoint       Current setpoint
  * @param stabilizerStep Stabilizer step for rate control
@@ -125,6 +138,14 @@ bool supervisorIsLocked();
  */
 bool supervisorIsCrashed();
 
+/**
+ * @brief Get the supervisor status as a bitfield of SUPERVISOR_INFO_xxx, the same value as the supervisor.info log
+ * variable. Updated by supervisorUpdate().
+ *
+ * @return uint16_t The bitfield
+ */
+uint16_t supervisorGetInfoField();
+
 /**
  * @brief Request the system to be recover if crashed.
  *
@@ -0,0 +1,64 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sysid.h - Onboard excitation and capture for system identification
+ */
+
+#pragma once
+
+#include "stabilizer_types.h"
+
+typedef enum {
+  sysidTargetMotors = 0,  // open loop, the selected motors are set to the base ratio plus the signal
+  sysidTargetRoll,        // added to the roll attitude or rate setpoint [deg or deg/s]
+  sysidTargetPitch,       // added to the pitch attitude or rate setpoint [deg or deg/s]
+  sysidTargetYaw,         // added to the yaw attitude or rate setpoint [deg or deg/s]
+  sysidTargetThrust,      // added to the thrust setpoint
+} sysidTarget_t;
+
+typedef enum {
+  sysidStateIdle = 0,
+  sysidStateRunning,
+  sysidStateDone,
+  sysidStateAborted,  // the supervisor stopped the motors during the maneuver
+} sysidState_t;
+
+void sysidInit(void);
+
+/**
+ * Advance the maneuver and add the excitation to the setpoint, for the setpoint targets. Called by the stabilizer loop
+ * every iteration, before the supervisor overrides the setpoint.
+ */
+void sysidUpdateSetpoint(setpoint_t* setpoint, const stabilizerStep_t stabilizerStep);
+
+/**
+ * Replace the output of the power distribution with the excitation, for the motor target. Called every time the
+ * motors are set.
+ */
+void sysidUpdateMotors(motors_thrust_pwm_t* motorPwm);
+
+/**
+ * Capture a sample of the motor commands, gyro, accelerometer and motor RPM, called by the stabilizer loop every
+ * iteration after the motors have been set.
+ */
+void sysidCapture(const stabilizerStep_t stabilizerStep, const sensorData_t* sensorData);
@@ -0,0 +1,62 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sysid_signal.h - Excitation signals for system identification
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+  sysidSignalStep = 0,  // 0 during the first quarter of the duration, then the amplitude
+  sysidSignalChirp,     // sine with a frequency sweeping linearly from f0 to f1 over the duration
+  sysidSignalPrbs,      // pseudo random binary sequence of +/- the amplitude
+} sysidSignal_t;
+
+typedef struct {
+  sysidSignal_t signal;
+  float amplitude;
+  uint32_t durationMs;
+  float f0;           // chirp start frequency [Hz]
+  float f1;           // chirp end frequency [Hz]
+  uint16_t prbsBitMs; // time one bit of the pseudo random sequence is held [ms]
+} sysidSignalConfig_t;
+
+typedef struct {
+  uint16_t lfsr;
+  uint32_t prbsBit;
+} sysidSignalState_t;
+
+void sysidSignalInit(sysidSignalState_t* this);
+
+/**
+ * Get the value of the signal at a time since the start of the maneuver. The time must not decrease between two calls
+ * after sysidSignalInit().
+ *
+ * @param this The signal state
+ * @param config The signal configuration
+ * @param timeMs Time since the start [ms]
+ * @return The signal value, in the unit of the amplitude
+ */
+float sysidSignalValue(sysidSignalState_t* this, const sysidSignalConfig_t* config, const uint32_t timeMs);
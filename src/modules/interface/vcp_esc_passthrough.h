@@ -42,6 +42,11 @@ void passthroughEnableFromISR();
  */
 void passthroughVcpRxSendFromISR(uint8_t Ch);
 
+/**
+ * Queue a buffer of serial data incoming from VCP interrupt routine, typically a whole USB packet
+ */
+void passthroughVcpRxSendBufferFromISR(const uint8_t* data, uint32_t length);
+
 /**
  * Queue serial data incoming from VCP, blocking.
  */
@@ -57,12 +62,33 @@ int passthroughVcpRxReceive(uint8_t* receiveChPtr);
  */
 int passthroughVcpRxReceiveBlock(uint8_t* receiveChPtr);
 
+/**
+ * Read length bytes of serial data that has been queued from VCP, blocks until all bytes are received
+ */
+void passthroughVcpRxReceiveBufferBlock(uint8_t* data, uint32_t length);
+
 /**
  * Queue outgoing data that should be sent, none-blocking
  */
 void passthroughVcpTxSend(uint8_t Ch);
 
+/**
+ * Queue outgoing data that should be sent, blocking.
+ */
+void passthroughVcpTxSendBlock(uint8_t Ch);
+
+/**
+ * Queue a buffer of outgoing data that should be sent, blocking. The data is sent in as few USB packets as possible.
+ */
+void passthroughVcpTxSendBufferBlock(const uint8_t* data, uint32_t length);
+
 /**
  * Consume outgoing serial VCP data from the send queue.
  */
 int  passthroughVcpTxReceiveFromISR(uint8_t* receiveChPtr);
+
+/**
+ * Consume up to maxLength bytes of outgoing serial VCP data from the send queue.
+ * @return The number of bytes copied to data
+ */
+uint32_t passthroughVcpTxReceiveBufferFromISR(uint8_t* data, uint32_t maxLength);
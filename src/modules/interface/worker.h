@@ -27,6 +27,25 @@
 #define __WORKER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+// Priority of a job, a pending job of higher priority is always executed before a job of lower priority. Jobs of the
+// same priority are executed in the order they were scheduled.
+typedef enum {
+  WORKER_PRIORITY_LOW = 0,
+  WORKER_PRIORITY_NORMAL,
+  WORKER_PRIORITY_HIGH,
+} workerPriority_t;
+
+typedef struct {
+  workerPriority_t priority;
+  // If true, the job is not scheduled again if a job with the same function and argument is already pending
+  bool coalesce;
+  // The job is executed at the earliest after this delay
+  uint32_t delayMs;
+  // If not 0, the job is executed again with this period until it is cancelled with workerCancel()
+  uint32_t periodMs;
+} workerOptions_t;
 
 void workerInit();
 
@@ -42,8 +61,8 @@ void workerLoop();
 
 /**
  * Schedule a function for execution by the worker loop
- * The function will be executed as soon as possible by the worker loop.
- * Scheduled functions are stacked in a FIFO queue.
+ * The function will be executed as soon as possible by the worker loop, with normal priority.
+ * Scheduled functions of the same priority are executed in FIFO order.
  *
  * @param function Function to be executed
  * @param arg      Argument that will be passed to the function when executed
@@ -51,4 +70,25 @@ void workerLoop();
  */
 int workerSchedule(void (*function)(void*), void *arg);
 
+/**
+ * Schedule a function for execution by the worker loop, with a priority, coalescing, a delay and a period.
+ *
+ * @param function Function to be executed
+ * @param arg      Argument that will be passed to the function when executed
+ * @param options  How to schedule the function
+ * @return         0 in case of success (also if the job was coalesced with a pending job), ENOMEM if there is no
+ *                 room for the job.
+ */
+int workerScheduleWithOptions(void (*function)(void*), void *arg, const workerOptions_t* options);
+
+/**
+ * Cancel pending jobs with the given function and argument, and stop periodic jobs. A job that is being executed
+ * runs to completion.
+ *
+ * @param function Function of the jobs to cancel
+ * @param arg      Argument of the jobs to cancel
+ * @return         0 if a job was cancelled, ENOENT otherwise
+ */
+int workerCancel(void (*function)(void*), void *arg);
+
 #endif //__WORKER_H
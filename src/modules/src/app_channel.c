@@ -28,10 +28,14 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 #include "queue.h"
 
 #include "crtp.h"
 #include "platformservice.h"
+#include "worker.h"
+#include "log.h"
+#include "statsCnt.h"
 
 static SemaphoreHandle_t sendMutex;
 
@@ -41,6 +45,44 @@ static bool overflow;
 
 static int sendDataPacket(void* data, size_t length, const bool doBlock);
 
+// Stream
+#define STREAM_BUFFER_SIZE CONFIG_APP_CHANNEL_STREAM_BUFFER_SIZE
+#define STREAM_MESSAGE_HEADER_SIZE 2
+#define STREAM_PACKET_HEADER_SIZE 2
+#define STREAM_RETRY_MS 10
+#define STREAM_MAX_CREDITS 255
+
+#define STREAM_FLAG_FIRST 0x01
+#define STREAM_FLAG_LAST 0x02
+
+typedef enum {
+  streamCommandCredit = 0x00,
+  streamCommandReset = 0x01,
+} StreamCommand;
+
+// Written messages are stored as a 16 bit length followed by the data, in [tail, head) of the ring buffer. All stream
+// state is protected by streamMutex.
+static SemaphoreHandle_t streamMutex;
+static SemaphoreHandle_t streamSpace;
+static uint8_t streamBuffer[STREAM_BUFFER_SIZE];
+static uint32_t streamHead;
+static uint32_t streamTail;
+
+// The message that is being sent, the length has been removed from the buffer
+static uint16_t messageLength;
+static uint16_t messageRemaining;
+
+static uint8_t sequence;
+static uint8_t credits;
+
+// Stats
+static STATS_CNT_RATE_DEFINE(streamPacketRate, 1000);
+static STATS_CNT_RATE_DEFINE(streamByteRate, 1000);
+static uint32_t streamDroppedMessages;
+static uint32_t streamCreditStalls;
+
+static void streamPump();
+
 // Deprecated (removed after August 2023)
 void appchannelSendPacket(void* data, size_t length)
 {
@@ -102,6 +144,9 @@ void appchannelInit()
   rxQueue = xQueueCreate(10, sizeof(CRTPPacket));
 
   overflow = false;
+
+  streamMutex = xSemaphoreCreateMutex();
+  streamSpace = xSemaphoreCreateBinary();
 }
 
 void appchannelIncomingPacket(CRTPPacket *p)
@@ -135,3 +180,214 @@ static int sendDataPacket(void* data, size_t length, const bool doBlock)
 
   return result;
 }
+
+static uint32_t streamUsed()
+{
+  return streamHead - streamTail;
+}
+
+static void streamCopyIn(const void* data, const uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++) {
+    streamBuffer[(streamHead + i) % STREAM_BUFFER_SIZE] = ((const uint8_t*)data)[i];
+  }
+  streamHead += length;
+}
+
+static void streamCopyOut(void* data, const uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++) {
+    ((uint8_t*)data)[i] = streamBuffer[(streamTail + i) % STREAM_BUFFER_SIZE];
+  }
+}
+
+static void streamRetryWork(void* arg)
+{
+  streamPump();
+}
+
+/**
+ * Send as many packets as the credits allow, must be called with streamMutex taken.
+ * Returns true if the CRTP TX queue was full and sending must be retried.
+ */
+static bool streamPumpLocked()
+{
+  static CRTPPacket packet;
+  bool isSpaceFreed = false;
+  bool isRetryNeeded = false;
+
+  while (true) {
+    if (messageRemaining == 0) {
+      if (streamUsed() < STREAM_MESSAGE_HEADER_SIZE) {
+        break;
+      }
+
+      streamCopyOut(&messageLength, STREAM_MESSAGE_HEADER_SIZE);
+      streamTail += STREAM_MESSAGE_HEADER_SIZE;
+      messageRemaining = messageLength;
+    }
+
+    if (credits == 0) {
+      streamCreditStalls++;
+      break;
+    }
+
+    const bool isFirst = (messageRemaining == messageLength);
+    uint8_t headerSize = STREAM_PACKET_HEADER_SIZE;
+    packet.data[0] = sequence;
+    packet.data[1] = isFirst ? STREAM_FLAG_FIRST : 0;
+    if (isFirst) {
+      memcpy(&packet.data[headerSize], &messageLength, sizeof(messageLength));
+      headerSize += sizeof(messageLength);
+    }
+
+    uint16_t payload = CRTP_MAX_DATA_SIZE - headerSize;
+    if (payload >= messageRemaining) {
+      payload = messageRemaining;
+      packet.data[1] |= STREAM_FLAG_LAST;
+    }
+
+    streamCopyOut(&packet.data[headerSize], payload);
+    packet.size = headerSize + payload;
+    if (platformserviceSendAppStreamPacket(&packet) != pdTRUE) {
+      isRetryNeeded = true;
+      break;
+    }
+
+    streamTail += payload;
+    messageRemaining -= payload;
+    sequence++;
+    credits--;
+    isSpaceFreed = true;
+
+    STATS_CNT_RATE_EVENT(&streamPacketRate);
+    STATS_CNT_RATE_MULTI_EVENT(&streamByteRate, payload);
+  }
+
+  if (isSpaceFreed) {
+    xSemaphoreGive(streamSpace);
+  }
+
+  return isRetryNeeded;
+}
+
+static void streamPump()
+{
+  xSemaphoreTake(streamMutex, portMAX_DELAY);
+  const bool isRetryNeeded = streamPumpLocked();
+  xSemaphoreGive(streamMutex);
+
+  if (isRetryNeeded) {
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_NORMAL, .coalesce = true, .delayMs = STREAM_RETRY_MS};
+    workerScheduleWithOptions(streamRetryWork, NULL, &options);
+  }
+}
+
+bool appchannelStreamWrite(const void* data, size_t length, int timeout_ms)
+{
+  if (length == 0 || length > APPCHANNEL_STREAM_MAX_MESSAGE_SIZE) {
+    return false;
+  }
+
+  const TickType_t ticksToWait = (timeout_ms < 0) ? portMAX_DELAY : M2T(timeout_ms);
+  const TickType_t start = xTaskGetTickCount();
+  const uint32_t needed = length + STREAM_MESSAGE_HEADER_SIZE;
+
+  xSemaphoreTake(streamMutex, portMAX_DELAY);
+  while (STREAM_BUFFER_SIZE - streamUsed() < needed) {
+    xSemaphoreGive(streamMutex);
+
+    const TickType_t elapsed = xTaskGetTickCount() - start;
+    const bool isTimedOut = (ticksToWait != portMAX_DELAY) && (elapsed >= ticksToWait);
+    if (isTimedOut || xSemaphoreTake(streamSpace, (ticksToWait == portMAX_DELAY) ? portMAX_DELAY : ticksToWait - elapsed) != pdTRUE) {
+      xSemaphoreTake(streamMutex, portMAX_DELAY);
+      streamDroppedMessages++;
+      xSemaphoreGive(streamMutex);
+      return false;
+    }
+
+    xSemaphoreTake(streamMutex, portMAX_DELAY);
+  }
+
+  const uint16_t messageHeader = length;
+  streamCopyIn(&messageHeader, STREAM_MESSAGE_HEADER_SIZE);
+  streamCopyIn(data, length);
+  const bool isRetryNeeded = streamPumpLocked();
+  xSemaphoreGive(streamMutex);
+
+  if (isRetryNeeded) {
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_NORMAL, .coalesce = true, .delayMs = STREAM_RETRY_MS};
+    workerScheduleWithOptions(streamRetryWork, NULL, &options);
+  }
+
+  return true;
+}
+
+size_t appchannelStreamFree()
+{
+  xSemaphoreTake(streamMutex, portMAX_DELAY);
+  const size_t free = STREAM_BUFFER_SIZE - streamUsed();
+  xSemaphoreGive(streamMutex);
+
+  return free;
+}
+
+static void addCredits(const uint8_t count)
+{
+  const uint16_t total = credits + count;
+  credits = (total > STREAM_MAX_CREDITS) ? STREAM_MAX_CREDITS : total;
+}
+
+void appchannelStreamIncomingPacket(CRTPPacket *p)
+{
+  if (p->size < 2) {
+    return;
+  }
+
+  xSemaphoreTake(streamMutex, portMAX_DELAY);
+  switch (p->data[0]) {
+    case streamCommandCredit:
+      addCredits(p->data[1]);
+      break;
+    case streamCommandReset:
+      // Start a new session, the messages that were buffered for the previous client are discarded
+      streamTail = streamHead;
+      messageRemaining = 0;
+      sequence = 0;
+      credits = 0;
+      addCredits(p->data[1]);
+      xSemaphoreGive(streamSpace);
+      break;
+    default:
+      break;
+  }
+  xSemaphoreGive(streamMutex);
+
+  streamPump();
+}
+
+/**
+ * Statistics of the app channel stream, see app_channel.h
+ */
+LOG_GROUP_START(appStream)
+/**
+ * @brief Stream packets sent per second
+ */
+STATS_CNT_RATE_LOG_ADD(txPkt, &streamPacketRate)
+/**
+ * @brief Stream payload bytes sent per second
+ */
+STATS_CNT_RATE_LOG_ADD(txBytes, &streamByteRate)
+/**
+ * @brief Number of messages that were dropped since the buffer was full
+ */
+LOG_ADD(LOG_UINT32, msgDrop, &streamDroppedMessages)
+/**
+ * @brief Number of times sending stopped since the client had not granted enough credits
+ */
+LOG_ADD(LOG_UINT32, stall, &streamCreditStalls)
+/**
+ * @brief Credits left, the number of packets that can be sent before the client grants more credits
+ */
+LOG_ADD(LOG_UINT8, credits, &credits)
+LOG_GROUP_STOP(appStream)
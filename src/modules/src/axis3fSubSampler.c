@@ -31,19 +31,39 @@ void axis3fSubSamplerInit(Axis3fSubSampler_t* this, const float conversionFactor
   this->conversionFactor = conversionFactor;
 }
 
-void axis3fSubSamplerAccumulate(Axis3fSubSampler_t* this, const Axis3f* sample) {
-  this->sum.x += sample->x;
-  this->sum.y += sample->y;
-  this->sum.z += sample->z;
+void axis3fSubSamplerInitConing(Axis3fSubSampler_t* this, const float conversionFactor, const float samplePeriod) {
+  axis3fSubSamplerInit(this, conversionFactor);
 
-  this->count++;
+  // The rotation vector is phi = sum(w * dt) + 1/2 * sum(phi_prev x w * dt). With the samples in sensor units the second
+  // term is 1/2 * dt^2 * c^2 * sum(S_prev x s), divided by the interval (count * dt) in axis3fSubSamplerFinalize()
+  this->coningFactor = 0.5f * samplePeriod * conversionFactor * conversionFactor;
+}
+
+void axis3fSubSamplerAccumulateConing(Axis3fSubSampler_t* this, const Axis3f* sample) {
+  // The sum is the rotation so far, in sensor units
+  this->coningSum.x += this->sum.y * sample->z - this->sum.z * sample->y;
+  this->coningSum.y += this->sum.z * sample->x - this->sum.x * sample->z;
+  this->coningSum.z += this->sum.x * sample->y - this->sum.y * sample->x;
+
+  axis3fSubSamplerAccumulate(this, sample);
 }
 
 Axis3f* axis3fSubSamplerFinalize(Axis3fSubSampler_t* this) {
   if (this->count > 0) {
-    this->subSample.x = this->sum.x * this->conversionFactor / this->count;
-    this->subSample.y = this->sum.y * this->conversionFactor / this->count;
-    this->subSample.z = this->sum.z * this->conversionFactor / this->count;
+    // One division per sub sample
+    const float invCount = 1.0f / this->count;
+    const float scale = this->conversionFactor * invCount;
+    this->subSample.x = this->sum.x * scale;
+    this->subSample.y = this->sum.y * scale;
+    this->subSample.z = this->sum.z * scale;
+
+    if (this->coningFactor != 0.0f) {
+      const float coningScale = this->coningFactor * invCount;
+      this->subSample.x += this->coningSum.x * coningScale;
+      this->subSample.y += this->coningSum.y * coningScale;
+      this->subSample.z += this->coningSum.z * coningScale;
+      this->coningSum = (Axis3f){.axis={0}};
+    }
 
     // Reset
     this->count = 0;
@@ -0,0 +1,180 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * boot_timeline.c - Timestamps of the init and test functions run at boot
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "boot_timeline.h"
+#include "usec_time.h"
+#include "mem.h"
+#include "log.h"
+#include "param.h"
+
+#define DEBUG_MODULE "BOOT"
+#include "debug.h"
+
+static bootTimelineEntry_t entries[BOOT_TIMELINE_MAX_ENTRIES];
+static uint8_t count;
+static uint8_t dropped;
+
+// Time of the latest entry [ms], for the log
+static uint32_t latestMs;
+
+static bool isInit = false;
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_BOOT_TIMELINE,
+  .getSize = bootTimelineGetSize,
+  .read = bootTimelineRead,
+  .write = 0, // Write not supported
+};
+
+void bootTimelineInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  memoryRegisterHandler(&memDef);
+  isInit = true;
+}
+
+void bootTimelineMark(const char* name) {
+  const uint32_t timestamp = usecTimestamp();
+
+  taskENTER_CRITICAL();
+  if (count < BOOT_TIMELINE_MAX_ENTRIES) {
+    entries[count].name = name;
+    entries[count].timestamp = timestamp;
+    count++;
+  } else if (dropped < UINT8_MAX) {
+    dropped++;
+  }
+  taskEXIT_CRITICAL();
+
+  latestMs = timestamp / 1000;
+}
+
+uint8_t bootTimelineCount(void) {
+  return count;
+}
+
+const bootTimelineEntry_t* bootTimelineGet(const uint8_t index) {
+  if (index >= count) {
+    return 0;
+  }
+  return &entries[index];
+}
+
+void bootTimelinePrint(void) {
+  uint32_t previous = 0;
+
+  DEBUG_PRINT("Boot time line [ms], time at end of phase (time in phase):\n");
+  for (int i = 0; i < count; i++) {
+    const bootTimelineEntry_t* entry = &entries[i];
+    DEBUG_PRINT("%5lu.%03lu (%4lu.%03lu) %s\n",
+      entry->timestamp / 1000, entry->timestamp % 1000,
+      (entry->timestamp - previous) / 1000, (entry->timestamp - previous) % 1000,
+      entry->name);
+    previous = entry->timestamp;
+  }
+
+  if (dropped) {
+    DEBUG_PRINT("%d entries dropped\n", dropped);
+  }
+}
+
+static uint32_t entrySize(const bootTimelineEntry_t* entry) {
+  return sizeof(entry->timestamp) + strlen(entry->name) + 1;
+}
+
+uint32_t bootTimelineGetSize(void) {
+  uint32_t size = 0;
+  for (int i = 0; i < count; i++) {
+    size += entrySize(&entries[i]);
+  }
+  return size;
+}
+
+bool bootTimelineRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > bootTimelineGetSize()) {
+    return false;
+  }
+
+  // Copy the part of each serialized entry that overlaps the requested range
+  uint32_t entryAddr = 0;
+  for (int i = 0; i < count && entryAddr < memAddr + readLen; i++) {
+    const bootTimelineEntry_t* entry = &entries[i];
+    const uint32_t size = entrySize(entry);
+
+    for (uint32_t j = 0; j < size; j++) {
+      const uint32_t addr = entryAddr + j;
+      if (addr >= memAddr && addr < memAddr + readLen) {
+        if (j < sizeof(entry->timestamp)) {
+          buffer[addr - memAddr] = ((const uint8_t*)&entry->timestamp)[j];
+        } else {
+          buffer[addr - memAddr] = entry->name[j - sizeof(entry->timestamp)];
+        }
+      }
+    }
+
+    entryAddr += size;
+  }
+
+  return true;
+}
+
+static uint8_t printTimeline;
+
+static void doPrintTimeline(void) {
+  if (printTimeline) {
+    bootTimelinePrint();
+    printTimeline = 0;
+  }
+}
+
+/**
+ * Time line of the boot, the full time line is available through the
+ * MEM_TYPE_BOOT_TIMELINE memory and the system.bootTimeline parameter.
+ */
+LOG_GROUP_START(boot)
+/**
+ * @brief Number of phases recorded
+ */
+LOG_ADD(LOG_UINT8, count, &count)
+/**
+ * @brief Time at the end of the latest phase recorded [ms]
+ */
+LOG_ADD(LOG_UINT32, latestMs, &latestMs)
+LOG_GROUP_STOP(boot)
+
+PARAM_GROUP_START(system)
+/**
+ * @brief Set to nonzero to print the boot time line to the console
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, bootTimeline, &printTimeline, doPrintTimeline)
+PARAM_GROUP_STOP(system)
@@ -94,58 +94,129 @@ static struct vec sidestepGoal(
   );
 }
 
-void collisionAvoidanceUpdateSetpointCore(
+// Constructs the polytope inequalities Ax <= B of our buffered Voronoi cell,
+// in coordinates relative to our position.
+//
+// Neighbors that are so far away that their cell wall lies entirely outside
+// the box we can reach within the horizon are left out. Their rows would be
+// redundant, but each row adds to the cost of every projection iteration.
+//
+// If the neighbor velocities are known, the wall towards an approaching
+// neighbor is placed between the positions of the closest approach within the
+// horizon, assuming both keep their velocities. The neighbor does the same
+// computation with the same positions and velocities, so the walls still
+// agree. Diverging neighbors never get closer than they are now and their
+// wall is computed from the current positions.
+//
+// The rows of A are written in place, so otherPositions may be the same
+// address as A.
+//
+// Args:
+//   params: Algorithm parameters.
+//   ourPos: Our current position.
+//   ourVel: Our current velocity, only used with otherVelocities.
+//   nOthers: Number of other Crazyflies in otherPositions.
+//   otherPositions: [nOthers * 3] array of positions (meters).
+//   otherVelocities: [nOthers * 3] array of velocities (meters/second), or
+//     NULL to treat the neighbors as static.
+//   A: LHS matrix, space for [(nOthers + 6) * 3] floats.
+//   B: RHS vector, space for [nOthers + 6] floats.
+//
+// Returns the number of rows in the inequality, at most nOthers + 6.
+//
+static int buildCell(
   collision_avoidance_params_t const *params,
-  collision_avoidance_state_t *collisionState,
+  struct vec ourPos,
+  struct vec ourVel,
   int nOthers,
   float const *otherPositions,
-  float *workspace,
-  setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state)
+  float const *otherVelocities,
+  float A[], float B[])
 {
-  //
-  // Part 1: Construct the polytope inequalities in A, b.
-  //
-
-  int const nRows = nOthers + 6;
-  float *A = workspace;
-  float *B = workspace + 3 * nRows;
-  float *projectionWorkspace = workspace + 4 * nRows;
-
   // Compute the cell in a stretched coordinate system for downwash awareness.
   // See header for details.
   struct vec const radiiInv = veltrecip(params->ellipsoidRadii);
-  struct vec const ourPos = vec2svec(state->position);
 
-  // We could do some optimizations here to reduce the number of rows, like
-  // leave out very far away neighbors. It would help the average case
-  // complexity, but not the worst case - so we skip it for now.
+  // The bounding box faces enforce max speed in the infinity-norm, so all
+  // points we may move to are inside a box with this half-width. In the
+  // stretched coordinate system the box fits in a sphere with radius
+  // horizonStretched, and the wall towards a neighbor at stretched distance
+  // dist is at dist / 2 - 1. The wall can not affect us if it is outside the
+  // sphere, compare squared distances to avoid the square root.
+  float const maxDist = params->horizonSecs * params->maxSpeed;
+  float const horizonStretched = maxDist * vmag(radiiInv);
+  float const cullDist = 2.0f * (horizonStretched + 1.0f);
+  float const cullDistSqr = cullDist * cullDist;
+
+  struct vec const ourVelStretched = veltmul(ourVel, radiiInv);
+
+  int nRows = 0;
   for (int i = 0; i < nOthers; ++i) {
     struct vec peerPos = vloadf(otherPositions + 3 * i);
     struct vec const toPeerStretched = veltmul(vsub(peerPos, ourPos), radiiInv);
-    float const dist = vmag(toPeerStretched);
-    struct vec const a = vdiv(veltmul(toPeerStretched, radiiInv), dist);
-    float const b = dist / 2.0f - 1.0f;
+
+    // Closest approach within the horizon. A positive dot product of the
+    // relative position and velocity means that we are diverging.
+    float tClosest = 0.0f;
+    struct vec relVelStretched = vzero();
+    if (otherVelocities) {
+      relVelStretched = vsub(veltmul(vloadf(otherVelocities + 3 * i), radiiInv), ourVelStretched);
+      float const closing = -vdot(toPeerStretched, relVelStretched);
+      if (closing > 0.0f) {
+        tClosest = fminf(closing / vmag2(relVelStretched), params->horizonSecs);
+      }
+    }
+
+    float const distSqr = vmag2(toPeerStretched);
+    if (tClosest == 0.0f && distSqr > cullDistSqr) {
+      continue;
+    }
+
+    // The wall is the bisector of the positions at the closest approach,
+    // shifted by our own motion until then. Without prediction this is the
+    // usual b = dist / 2 - 1.
+    struct vec const ourShift = vscl(tClosest, ourVelStretched);
+    struct vec const toPeerClosest = vadd(toPeerStretched, vscl(tClosest, relVelStretched));
+    float const distClosest = vmag(toPeerClosest);
+    // On a collision course the direction at the closest approach is
+    // undefined, use the current direction instead.
+    struct vec const normal = distClosest > 1e-3f ? vdiv(toPeerClosest, distClosest) : vnormalize(toPeerStretched);
+    float const b = vdot(normal, ourShift) + distClosest / 2.0f - 1.0f;
+    if (b > horizonStretched) {
+      continue;
+    }
+    struct vec const a = veltmul(normal, radiiInv);
     float scale = 1.0f / vmag(a);
-    vstoref(vscl(scale, a), A + 3 * i);
-    B[i] = scale * b;
+    vstoref(vscl(scale, a), A + 3 * nRows);
+    B[nRows] = scale * b;
+    ++nRows;
   }
 
   // Add the bounding box polytope faces. We also use the box faces to enforce
   // max speed in the infinity-norm.
-  float const maxDist = params->horizonSecs * params->maxSpeed;
-
-  memset(A + 3 * nOthers, 0, 18 * sizeof(float));
+  memset(A + 3 * nRows, 0, 18 * sizeof(float));
 
   for (int dim = 0; dim < 3; ++dim) {
     float boxMax = vindex(params->bboxMax, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim) + dim] = 1.0f;
-    B[nOthers + dim] = fminf(maxDist, boxMax);
+    A[3 * (nRows + dim) + dim] = 1.0f;
+    B[nRows + dim] = fminf(maxDist, boxMax);
 
     float boxMin = vindex(params->bboxMin, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim + 3) + dim] = -1.0f;
-    B[nOthers + dim + 3] = -fmaxf(-maxDist, boxMin);
+    A[3 * (nRows + dim + 3) + dim] = -1.0f;
+    B[nRows + dim + 3] = -fmaxf(-maxDist, boxMin);
   }
 
+  return nRows + 6;
+}
+
+// Modifies the setpoint such that it respects the cell inequalities from
+// buildCell(). A and B are not modified.
+static void updateSetpointInCell(
+  collision_avoidance_params_t const *params,
+  collision_avoidance_state_t *collisionState,
+  float const A[], float const B[], float projectionWorkspace[], int nRows,
+  setpoint_t *setpoint, struct vec ourPos)
+{
   //
   // Part 2: Use the constructed polytope to modify the setpoint.
   //
@@ -252,6 +323,28 @@ void collisionAvoidanceUpdateSetpointCore(
   setpoint->velocity = svec2vec(setVel);
 }
 
+void collisionAvoidanceUpdateSetpointCore(
+  collision_avoidance_params_t const *params,
+  collision_avoidance_state_t *collisionState,
+  int nOthers,
+  float const *otherPositions,
+  float const *otherVelocities,
+  float *workspace,
+  setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state)
+{
+  // The workspace layout is sized for all neighbors, even if some of them are
+  // culled when the cell is built.
+  int const maxRows = nOthers + 6;
+  float *A = workspace;
+  float *B = workspace + 3 * maxRows;
+  float *projectionWorkspace = workspace + 4 * maxRows;
+
+  struct vec const ourPos = vec2svec(state->position);
+  struct vec const ourVel = vec2svec(state->velocity);
+  int const nRows = buildCell(params, ourPos, ourVel, nOthers, otherPositions, otherVelocities, A, B);
+  updateSetpointInCell(params, collisionState, A, B, projectionWorkspace, nRows, setpoint, ourPos);
+}
+
 
 //
 // Everything below this comment will only be compiled in a firware build made
@@ -266,9 +359,13 @@ void collisionAvoidanceUpdateSetpointCore(
 
 #include "param.h"
 #include "log.h"
+#include "statsCnt.h"
+#include "cycle_counter.h"
 
 
 static uint8_t collisionAvoidanceEnable = 0;
+// Nonzero to extrapolate the neighbors that share their velocity
+static uint8_t predictEnable = 1;
 
 static collision_avoidance_params_t params = {
   .ellipsoidRadii = { .x = 0.3, .y = 0.3, .z = 0.9 },
@@ -286,8 +383,18 @@ static collision_avoidance_state_t collisionState = {
   .lastFeasibleSetPosition = { .x = NAN, .y = NAN, .z = NAN },
 };
 
+// Statistics for logging
+static statsCntMinMaxAvg_t updateCycles;
+static uint16_t nPeers = 0;
+static uint16_t nWalls = 0;
+static uint32_t cellReuseCount = 0;
+static uint16_t nPredicted = 0;
+static STATS_CNT_RATE_DEFINE(interventionRate, 1000);
+
 void collisionAvoidanceInit()
 {
+  cycleCounterInit();
+  statsCntMinMaxAvgInit(&updateCycles, 1000);
 }
 
 bool collisionAvoidanceTest()
@@ -302,47 +409,178 @@ bool collisionAvoidanceTest()
 #define MAX_CELL_ROWS (PEER_LOCALIZATION_MAX_NEIGHBORS + 6)
 static float workspace[7 * MAX_CELL_ROWS];
 
+// The cell is kept in the workspace between updates and is only rebuilt when
+// our state, the neighbors or the params have changed. The state estimate and
+// the peer positions are typically updated at a lower rate than the
+// stabilizer loop. Neighbors with a velocity are extrapolated to the current
+// time, the cell is then rebuilt every tick.
+static peerLocalizationOtherPosition_t cellPeers[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static struct vec cellPeerVelocities[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static bool cellPeerHasVelocity[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static int cellPeerCount = 0;
+static int cellRows = 0;
+static struct vec cellPosition;
+static struct vec cellVelocity;
+static TickType_t cellTime;
+static uint8_t cellPredict;
+static collision_avoidance_params_t cellParams;
+
+// Peer positions are not extrapolated further than this
+#define MAX_EXTRAPOLATION_MS 1000
+
 // Latency counter for logging.
 static uint32_t latency = 0;
 
+static bool isSamePeer(peerLocalizationOtherPosition_t const *cached, peerLocalizationTable_t const *peers, int i)
+{
+  return cached->id == peers->id[i] && cached->pos.timestamp == peers->timestamp[i] &&
+    cached->pos.x == peers->x[i] && cached->pos.y == peers->y[i] && cached->pos.z == peers->z[i];
+}
+
+static bool isSameSetpoint(setpoint_t const *a, setpoint_t const *b)
+{
+  return veq(vec2svec(a->position), vec2svec(b->position)) && veq(vec2svec(a->velocity), vec2svec(b->velocity));
+}
+
 void collisionAvoidanceUpdateSetpoint(
   setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state, stabilizerStep_t stabilizerStep)
 {
   if (!collisionAvoidanceEnable) {
+    cellRows = 0;
     return;
   }
 
+  uint32_t const startCycles = cycleCounterGet();
   TickType_t const time = xTaskGetTickCount();
   bool doAgeFilter = params.maxPeerLocAgeMillis >= 0;
 
   // Counts the actual number of neighbors after we filter stale measurements.
   int nOthers = 0;
+  bool isCellChanged = (cellRows == 0);
 
-  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
+  peerLocalizationTable_t const *peers = peerLocalizationGetTable();
 
-    peerLocalizationOtherPosition_t const *otherPos = peerLocalizationGetPositionByIdx(i);
+  for (int i = 0; i < peers->count; ++i) {
 
-    if (otherPos == NULL || otherPos->id == 0) {
+    if (doAgeFilter && (time - peers->timestamp[i] > params.maxPeerLocAgeMillis)) {
       continue;
     }
 
-    if (doAgeFilter && (time - otherPos->pos.timestamp > params.maxPeerLocAgeMillis)) {
-      continue;
+    if (nOthers >= cellPeerCount || !isSamePeer(&cellPeers[nOthers], peers, i)) {
+      peerLocalizationOtherPosition_t *cached = &cellPeers[nOthers];
+      cached->id = peers->id[i];
+      cached->pos.x = peers->x[i];
+      cached->pos.y = peers->y[i];
+      cached->pos.z = peers->z[i];
+      cached->pos.timestamp = peers->timestamp[i];
+      cellPeerVelocities[nOthers] = mkvec(peers->vx[i], peers->vy[i], peers->vz[i]);
+      cellPeerHasVelocity[nOthers] = peers->hasVelocity[i];
+      isCellChanged = true;
     }
-
-    workspace[3 * nOthers + 0] = otherPos->pos.x;
-    workspace[3 * nOthers + 1] = otherPos->pos.y;
-    workspace[3 * nOthers + 2] = otherPos->pos.z;
     ++nOthers;
   }
 
-  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, workspace, workspace, setpoint, sensorData, state);
+  int predicted = 0;
+  if (predictEnable) {
+    for (int i = 0; i < nOthers; ++i) {
+      if (cellPeerHasVelocity[i]) {
+        predicted++;
+      }
+    }
+  }
+
+  struct vec const ourPos = vec2svec(state->position);
+  struct vec const ourVel = vec2svec(state->velocity);
+  isCellChanged = isCellChanged || nOthers != cellPeerCount || vneq(ourPos, cellPosition) ||
+    predictEnable != cellPredict || memcmp(&params, &cellParams, sizeof(params)) != 0;
+  if (predicted > 0) {
+    isCellChanged = isCellChanged || vneq(ourVel, cellVelocity) || time != cellTime;
+  }
+
+  // Same layout as in collisionAvoidanceUpdateSetpointCore()
+  int const maxRows = nOthers + 6;
+  float *A = workspace;
+  float *B = workspace + 3 * maxRows;
+  float *projectionWorkspace = workspace + 4 * maxRows;
+
+  if (isCellChanged) {
+    // The velocities are only needed while the cell is built, they are kept in
+    // the projection workspace which buildCell() does not touch.
+    float *velocities = predicted > 0 ? projectionWorkspace : NULL;
+    for (int i = 0; i < nOthers; ++i) {
+      struct vec peerPos = mkvec(cellPeers[i].pos.x, cellPeers[i].pos.y, cellPeers[i].pos.z);
+      struct vec peerVel = vzero();
+      if (predictEnable && cellPeerHasVelocity[i]) {
+        // Neighbors without a velocity are static, they do not know ours either
+        // and the wall must be computed the same way on both sides.
+        uint32_t ageMs = T2M(time - cellPeers[i].pos.timestamp);
+        if (ageMs > MAX_EXTRAPOLATION_MS) {
+          ageMs = MAX_EXTRAPOLATION_MS;
+        }
+        peerVel = cellPeerVelocities[i];
+        peerPos = vadd(peerPos, vscl(ageMs / 1000.0f, peerVel));
+      }
+      vstoref(peerPos, workspace + 3 * i);
+      if (velocities) {
+        vstoref(peerVel, velocities + 3 * i);
+      }
+    }
+    cellRows = buildCell(&params, ourPos, ourVel, nOthers, workspace, velocities, A, B);
+    cellPeerCount = nOthers;
+    cellPosition = ourPos;
+    cellVelocity = ourVel;
+    cellTime = time;
+    cellPredict = predictEnable;
+    cellParams = params;
+  } else {
+    cellReuseCount++;
+  }
+
+  setpoint_t const original = *setpoint;
+  updateSetpointInCell(&params, &collisionState, A, B, projectionWorkspace, cellRows, setpoint, ourPos);
+  if (!isSameSetpoint(&original, setpoint)) {
+    STATS_CNT_RATE_EVENT(&interventionRate);
+  }
 
   latency = xTaskGetTickCount() - time;
+
+  nPeers = nOthers;
+  nPredicted = predicted;
+  nWalls = cellRows - 6;
+  statsCntMinMaxAvgAdd(&updateCycles, cycleCounterElapsed(startCycles));
+  statsCntMinMaxAvgUpdate(&updateCycles, T2M(time));
 }
 
+/**
+ * Collision avoidance performance. Only updated when collision avoidance is
+ * enabled.
+ */
 LOG_GROUP_START(colAv)
   LOG_ADD(LOG_UINT32, latency, &latency)
+  /**
+   * @brief CPU cycles per setpoint update, min, average and max over one second
+   */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(cycles, &updateCycles)
+  /**
+   * @brief Number of neighbors with a recent enough position
+   */
+  LOG_ADD(LOG_UINT16, nPeers, &nPeers)
+  /**
+   * @brief Number of neighbors that are close enough to limit our cell, the others are culled
+   */
+  LOG_ADD(LOG_UINT16, nWalls, &nWalls)
+  /**
+   * @brief Number of updates where the cell from the previous update was reused
+   */
+  LOG_ADD(LOG_UINT32, cellReuse, &cellReuseCount)
+  /**
+   * @brief Number of neighbors that share their velocity and are extrapolated
+   */
+  LOG_ADD(LOG_UINT16, nPredicted, &nPredicted)
+  /**
+   * @brief Rate of updates where the setpoint was modified [1/s]
+   */
+  STATS_CNT_RATE_LOG_ADD(interventions, &interventionRate)
 LOG_GROUP_STOP(colAv)
 
 
@@ -424,6 +662,14 @@ PARAM_GROUP_START(colAv)
   PARAM_ADD(PARAM_FLOAT, maxSpeed, &params.maxSpeed)
   PARAM_ADD(PARAM_FLOAT, sidestepThrsh, &params.sidestepThreshold)
   PARAM_ADD(PARAM_INT32, maxPeerLocAge, &params.maxPeerLocAgeMillis)
+
+  /**
+   * @brief Nonzero to extrapolate the neighbors that share their velocity (default: 1)
+   *
+   * Requires CONFIG_PEER_LOCALIZATION_BROADCAST on all Crazyflies, neighbors
+   * that only have mocap positions are always treated as static.
+   */
+  PARAM_ADD(PARAM_UINT8, predict, &predictEnable)
   PARAM_ADD(PARAM_FLOAT, vorTol, &params.voronoiProjectionTolerance)
   PARAM_ADD(PARAM_INT32, vorIters, &params.voronoiProjectionMaxIters)
 PARAM_GROUP_STOP(colAv)
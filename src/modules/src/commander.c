@@ -34,7 +34,9 @@
 #include "crtp_commander_high_level.h"
 
 #include "cf_math.h"
+#include "log.h"
 #include "param.h"
+#include "setpoint_buffer.h"
 #include "static_mem.h"
 
 static bool isInit;
@@ -53,6 +55,16 @@ STATIC_MEM_QUEUE_ALLOC(setpointQueue, 1, sizeof(setpoint_t));
 static QueueHandle_t priorityQueue;
 STATIC_MEM_QUEUE_ALLOC(priorityQueue, 1, sizeof(int));
 
+// Timestamped setpoints are played back through the jitter buffer, as long as
+// the timed setpoints are the active ones
+static setpointBuffer_t setpointBuffer;
+static bool setpointBufferActive = false;
+static bool enableSetpointBuffer = true;
+static setpointBufferConfig_t setpointBufferConfig = {
+  .latencyMs = 30,
+  .maxExtrapolationMs = 50,
+};
+
 /* Public functions */
 void commanderInit(void)
 {
@@ -79,6 +91,7 @@ void commanderSetSetpoint(setpoint_t *setpoint, int priority)
   ASSERT(peekResult == pdTRUE);
 
   if (priority >= currentPriority) {
+    setpointBufferActive = false;
     setpoint->timestamp = xTaskGetTickCount();
     // This is a potential race but without effect on functionality
     xQueueOverwrite(setpointQueue, setpoint);
@@ -90,6 +103,35 @@ void commanderSetSetpoint(setpoint_t *setpoint, int priority)
   }
 }
 
+void commanderSetTimedSetpoint(setpoint_t *setpoint, uint16_t senderTimeMs, int priority)
+{
+  int currentPriority;
+
+  const BaseType_t peekResult = xQueuePeek(priorityQueue, &currentPriority, 0);
+  ASSERT(peekResult == pdTRUE);
+
+  if (priority >= currentPriority) {
+    const uint32_t now = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+    if (!setpointBufferActive) {
+      setpointBufferReset(&setpointBuffer);
+    }
+    setpointBufferPush(&setpointBuffer, setpoint, senderTimeMs, now);
+    taskEXIT_CRITICAL();
+
+    // The queue gets the raw setpoint, it is used when the buffer is disabled
+    setpoint->timestamp = now;
+    xQueueOverwrite(setpointQueue, setpoint);
+    xQueueOverwrite(priorityQueue, &priority);
+    setpointBufferActive = true;
+    if (priority > COMMANDER_PRIORITY_HIGHLEVEL) {
+      // Stop the high-level planner so it will forget its current state
+      crtpCommanderHighLevelStop();
+    }
+  }
+}
+
 void commanderRelaxPriority()
 {
   crtpCommanderHighLevelTellState(&lastState);
@@ -100,6 +142,15 @@ void commanderRelaxPriority()
 void commanderGetSetpoint(setpoint_t *setpoint, const state_t *state)
 {
   xQueuePeek(setpointQueue, setpoint, 0);
+
+  // This is a potential race with a new setpoint from another source, the
+  // buffer is used for at most one more stabilizer tick
+  if (setpointBufferActive && enableSetpointBuffer) {
+    const uint32_t now = xTaskGetTickCount();
+    taskENTER_CRITICAL();
+    setpointBufferGet(&setpointBuffer, &setpointBufferConfig, now, setpoint);
+    taskEXIT_CRITICAL();
+  }
   lastUpdate = setpoint->timestamp;
 
   // This copying is not strictly necessary because stabilizer.c already keeps
@@ -157,3 +208,74 @@ PARAM_GROUP_START(commander)
 PARAM_ADD_CORE(PARAM_UINT8, enHighLevel, &enableHighLevel)
 
 PARAM_GROUP_STOP(commander)
+
+/**
+ * Timestamped setpoints, sent on channel 2 of the generic setpoint port, are
+ * buffered and played back with a fixed delay relative to the clock of the
+ * sender. The setpoints are interpolated at the stabilizer rate, which gives
+ * smooth tracking even if the setpoints arrive with jitter over the radio.
+ */
+PARAM_GROUP_START(cmdBuf)
+
+/**
+ * @brief Nonzero to play timestamped setpoints back through the jitter buffer (default: 1)
+ *
+ * When disabled, timestamped setpoints are used as they arrive.
+ */
+PARAM_ADD(PARAM_UINT8, enable, &enableSetpointBuffer)
+
+/**
+ * @brief Playback delay [ms] relative to the fastest arrival (default: 30)
+ *
+ * Setpoints that arrive later than this are late and are not interpolated
+ * towards. The buffer holds 8 setpoints, which limits the useful delay to
+ * about 7 setpoint periods.
+ */
+PARAM_ADD(PARAM_UINT16, latency, &setpointBufferConfig.latencyMs)
+
+/**
+ * @brief Max time [ms] to extrapolate when the buffer runs dry, before the setpoint is held (default: 50)
+ */
+PARAM_ADD(PARAM_UINT16, maxExtrap, &setpointBufferConfig.maxExtrapolationMs)
+
+PARAM_GROUP_STOP(cmdBuf)
+
+/**
+ * Jitter buffer statistics for timestamped setpoints
+ */
+LOG_GROUP_START(cmdBuf)
+/**
+ * @brief Number of setpoints in the buffer
+ */
+LOG_ADD(LOG_UINT8, depth, &setpointBuffer.count)
+
+/**
+ * @brief Time [ms] the setpoint that is played back has spent in the buffer
+ */
+LOG_ADD(LOG_INT32, delay, &setpointBuffer.delayMs)
+
+/**
+ * @brief How much later [ms] the last setpoint arrived than the fastest one
+ */
+LOG_ADD(LOG_INT32, jitter, &setpointBuffer.jitterMs)
+
+/**
+ * @brief Number of setpoints that arrived after their playback time
+ */
+LOG_ADD(LOG_UINT32, late, &setpointBuffer.lateCount)
+
+/**
+ * @brief Number of setpoints dropped since the buffer was full
+ */
+LOG_ADD(LOG_UINT32, overflow, &setpointBuffer.overflowCount)
+
+/**
+ * @brief Number of stabilizer ticks the setpoint was extrapolated
+ */
+LOG_ADD(LOG_UINT32, extrap, &setpointBuffer.extrapolationCount)
+
+/**
+ * @brief Number of stabilizer ticks the setpoint was held, the extrapolation limit was reached
+ */
+LOG_ADD(LOG_UINT32, hold, &setpointBuffer.holdCount)
+LOG_GROUP_STOP(cmdBuf)
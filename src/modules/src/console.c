@@ -25,6 +25,7 @@
  */
 
 #include <string.h>
+#include <stdarg.h>
 
 /*FreeRtos includes*/
 #include "FreeRTOS.h"
@@ -32,6 +33,8 @@
 #include "console.h"
 
 #include "crtp.h"
+#include "worker.h"
+#include "log.h"
 
 #ifdef STM32F40_41xxx
 #include "stm32f4xx.h"
@@ -42,35 +45,166 @@
 #endif
 #endif
 
+// Must be a power of two
+#define CONSOLE_BUFFER_SIZE 512
+// Written text is sent from the worker, a writer only sends when the buffer is filled above this level
+#define INLINE_FLUSH_LEVEL (CONSOLE_BUFFER_SIZE * 3 / 4)
+#define FLUSH_RETRY_MS 10
+
+// Text is written to the buffer in [tail, head) and sent to the client from tail, protected by synch
+static char buffer[CONSOLE_BUFFER_SIZE];
+static uint32_t head;
+static uint32_t tail;
+static bool isFullMarkerPending = false;
+static bool isFlushScheduled = false;
 static CRTPPacket messageToPrint;
-static bool messageSendingIsPending = false;
 static xSemaphoreHandle synch = NULL;
 
 static const char bufferFullMsg[] = "<F>\n";
 static bool isInit;
 
-static void addBufferFullMarker();
+// Log variables
+static uint32_t droppedBytes;
 
+static void consoleFlushWork(void* arg);
+
+static bool isInInterrupt(void)
+{
+  return (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+}
+
+static uint32_t bufferFree(void)
+{
+  return CONSOLE_BUFFER_SIZE - (head - tail);
+}
+
+static void copyToBuffer(const char* data, const uint32_t len)
+{
+  const uint32_t start = head & (CONSOLE_BUFFER_SIZE - 1);
+  const uint32_t firstPart = (len < CONSOLE_BUFFER_SIZE - start) ? len : CONSOLE_BUFFER_SIZE - start;
+  memcpy(&buffer[start], data, firstPart);
+  memcpy(buffer, &data[firstPart], len - firstPart);
+  head += len;
+}
 
 /**
- * Send the data to the client
- * returns TRUE if successful otherwise FALSE
+ * Add data to the buffer, must be called with synch taken. Data that does not fit is dropped and a marker is added
+ * when there is room again.
  */
-static bool consoleSendMessage(void)
+static void writeLocked(const char* data, const uint32_t len)
 {
-  if (crtpSendPacket(&messageToPrint) == pdTRUE)
+  if (isFullMarkerPending)
+  {
+    if (bufferFree() < sizeof(bufferFullMsg) - 1 + len)
+    {
+      droppedBytes += len;
+      return;
+    }
+
+    copyToBuffer(bufferFullMsg, sizeof(bufferFullMsg) - 1);
+    isFullMarkerPending = false;
+  }
+
+  uint32_t count = len;
+  if (count > bufferFree())
   {
-    messageToPrint.size = 0;
-    messageSendingIsPending = false;
+    count = bufferFree();
+    droppedBytes += len - count;
+    isFullMarkerPending = true;
   }
-  else
+
+  copyToBuffer(data, count);
+}
+
+static int putcharLocked(int ch)
+{
+  const char c = (char)ch;
+  writeLocked(&c, 1);
+  return (unsigned char)ch;
+}
+
+/**
+ * Send the buffered data to the client, must be called with synch taken.
+ * returns TRUE if all data was sent otherwise FALSE
+ */
+static bool sendLocked(void)
+{
+  while (head != tail)
   {
-    return false;
+    const uint32_t start = tail & (CONSOLE_BUFFER_SIZE - 1);
+    uint32_t size = head - tail;
+    if (size > CRTP_MAX_DATA_SIZE)
+    {
+      size = CRTP_MAX_DATA_SIZE;
+    }
+    if (size > CONSOLE_BUFFER_SIZE - start)
+    {
+      size = CONSOLE_BUFFER_SIZE - start;
+    }
+
+    memcpy(messageToPrint.data, &buffer[start], size);
+    messageToPrint.size = size;
+    if (crtpSendPacket(&messageToPrint) != pdTRUE)
+    {
+      return false;
+    }
+
+    tail += size;
   }
 
   return true;
 }
 
+static void scheduleFlush(uint32_t delayMs)
+{
+  const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .coalesce = true, .delayMs = delayMs};
+  if (workerScheduleWithOptions(consoleFlushWork, NULL, &options) != 0)
+  {
+    isFlushScheduled = false;
+  }
+}
+
+/**
+ * Called with synch taken after data has been written from a task. Returns true if a flush must be scheduled, which
+ * is done after synch is released since the worker may print.
+ */
+static bool afterWriteLocked(void)
+{
+  if ((head - tail) >= INLINE_FLUSH_LEVEL)
+  {
+    sendLocked();
+  }
+
+  if (head != tail && !isFlushScheduled && workerTest())
+  {
+    isFlushScheduled = true;
+    return true;
+  }
+
+  return false;
+}
+
+static void consoleFlushWork(void* arg)
+{
+  bool isAllSent = true;
+
+  if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
+  {
+    isAllSent = sendLocked();
+    if (isAllSent)
+    {
+      isFlushScheduled = false;
+    }
+    xSemaphoreGive(synch);
+  }
+
+  if (!isAllSent)
+  {
+    // The CRTP TX queue is full, try again later
+    scheduleFlush(FLUSH_RETRY_MS);
+  }
+}
+
 void consoleInit()
 {
   if (isInit)
@@ -79,7 +213,8 @@ void consoleInit()
   messageToPrint.size = 0;
   messageToPrint.header = CRTP_HEADER(CRTP_PORT_CONSOLE, 0);
   vSemaphoreCreateBinary(synch);
-  messageSendingIsPending = false;
+  head = 0;
+  tail = 0;
 
   isInit = true;
 }
@@ -91,43 +226,24 @@ bool consoleTest(void)
 
 int consolePutchar(int ch)
 {
-  bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
-
   if (!isInit) {
     return 0;
   }
 
-  if (isInInterrupt) {
+  if (isInInterrupt()) {
     return consolePutcharFromISR(ch);
   }
 
   if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
   {
-    // Try to send if we already have a pending message
-    if (messageSendingIsPending)
-    {
-      consoleSendMessage();
-    }
+    putcharLocked(ch);
+    const bool isFlushNeeded = afterWriteLocked();
+    xSemaphoreGive(synch);
 
-    if (! messageSendingIsPending)
+    if (isFlushNeeded)
     {
-      if (messageToPrint.size < CRTP_MAX_DATA_SIZE)
-      {
-        messageToPrint.data[messageToPrint.size] = (unsigned char)ch;
-        messageToPrint.size++;
-      }
-
-      if (ch == '\n' || messageToPrint.size >= CRTP_MAX_DATA_SIZE)
-      {
-        if (crtpGetFreeTxQueuePackets() == 1)
-        {
-          addBufferFullMarker();
-        }
-        messageSendingIsPending = true;
-        consoleSendMessage();
-      }
+      scheduleFlush(0);
     }
-    xSemaphoreGive(synch);
   }
 
   return (unsigned char)ch;
@@ -137,60 +253,101 @@ int consolePutcharFromISR(int ch) {
   BaseType_t higherPriorityTaskWoken;
 
   if (xSemaphoreTakeFromISR(synch, &higherPriorityTaskWoken) == pdTRUE) {
-    if (messageToPrint.size < CRTP_MAX_DATA_SIZE)
-    {
-      messageToPrint.data[messageToPrint.size] = (unsigned char)ch;
-      messageToPrint.size++;
-    }
+    putcharLocked(ch);
     xSemaphoreGiveFromISR(synch, &higherPriorityTaskWoken);
   }
 
   return ch;
 }
 
-int consolePuts(const char *str)
+int consoleWrite(const char* data, int len)
 {
-  int ret = 0;
-
-  while(*str)
-    ret |= consolePutchar(*str++);
+  if (!isInit) {
+    return 0;
+  }
 
-  return ret;
-}
+  if (isInInterrupt()) {
+    for (int i = 0; i < len; i++) {
+      consolePutcharFromISR(data[i]);
+    }
+    return len;
+  }
 
-void consoleFlush(void)
-{
   if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
   {
-    consoleSendMessage();
+    writeLocked(data, len);
+    const bool isFlushNeeded = afterWriteLocked();
     xSemaphoreGive(synch);
+
+    if (isFlushNeeded)
+    {
+      scheduleFlush(0);
+    }
   }
+
+  return len;
 }
 
+int consolePuts(const char *str)
+{
+  consoleWrite(str, strlen(str));
+  return 0;
+}
 
-static int findMarkerStart()
+int consoleVprintf(const char* fmt, va_list ap)
 {
-  int start = messageToPrint.size;
+  int len = 0;
+
+  if (!isInit) {
+    return 0;
+  }
+
+  if (isInInterrupt()) {
+    return evprintf(consolePutcharFromISR, fmt, ap);
+  }
 
-  // If last char is new line, rewind one char since the marker contains a new line.
-  if (start > 0 && messageToPrint.data[start - 1] == '\n')
+  if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
   {
-    start -= 1;
+    // The formatted text is written straight to the buffer, the lock is only taken once
+    len = evprintf(putcharLocked, fmt, ap);
+    const bool isFlushNeeded = afterWriteLocked();
+    xSemaphoreGive(synch);
+
+    if (isFlushNeeded)
+    {
+      scheduleFlush(0);
+    }
   }
 
-  return start;
+  return len;
 }
 
-static void addBufferFullMarker()
+int consolePrintf(const char* fmt, ...)
 {
-  // Try to add the marker after the message if it fits in the buffer, otherwise overwrite the end of the message
-  int endMarker = findMarkerStart() + sizeof(bufferFullMsg);
-  if (endMarker >= (CRTP_MAX_DATA_SIZE))
+  va_list ap;
+
+  va_start(ap, fmt);
+  const int len = consoleVprintf(fmt, ap);
+  va_end(ap);
+
+  return len;
+}
+
+void consoleFlush(void)
+{
+  if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
   {
-    endMarker = CRTP_MAX_DATA_SIZE;
+    sendLocked();
+    xSemaphoreGive(synch);
   }
-
-  int startMarker = endMarker - sizeof(bufferFullMsg);
-  memcpy(&messageToPrint.data[startMarker], bufferFullMsg, sizeof(bufferFullMsg));
-  messageToPrint.size = startMarker + sizeof(bufferFullMsg);
 }
+
+/**
+ * Console output to the client
+ */
+LOG_GROUP_START(console)
+/**
+ * @brief Number of bytes that were dropped since the buffer was full
+ */
+LOG_ADD(LOG_UINT32, drop, &droppedBytes)
+LOG_GROUP_STOP(console)
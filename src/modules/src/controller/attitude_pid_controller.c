@@ -33,6 +33,9 @@
 #include "log.h"
 #include "commander.h"
 #include "platform_defaults.h"
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+#include "rate_loop.h"
+#endif
 
 
 static bool attFiltEnable = ATTITUDE_LPF_ENABLE;
@@ -104,16 +107,28 @@ static bool isInit;
 
 void attitudeControllerInit(const float updateDt)
 {
-  if(isInit)
+  if(isInit) {
+    // Another controller may have changed the rate
+    attitudeControllerSetRate(1.0f / updateDt);
     return;
+  }
+
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+  // The rate PIDs are run by the inner rate loop, on every gyro sample
+  const float rateUpdateDt = 1.0f / RATE_LOOP_RATE_HZ;
+  const float rateSamplingRate = RATE_LOOP_RATE_HZ;
+#else
+  const float rateUpdateDt = updateDt;
+  const float rateSamplingRate = ATTITUDE_RATE;
+#endif
 
   //TODO: get parameters from configuration manager instead - now (partly) implemented
   pidInit(&pidRollRate,  0, pidRollRate.kp,  pidRollRate.ki,  pidRollRate.kd,
-       pidRollRate.kff,  updateDt, ATTITUDE_RATE, omxFiltCutoff, rateFiltEnable);
+       pidRollRate.kff,  rateUpdateDt, rateSamplingRate, omxFiltCutoff, rateFiltEnable);
   pidInit(&pidPitchRate, 0, pidPitchRate.kp, pidPitchRate.ki, pidPitchRate.kd,
-       pidPitchRate.kff, updateDt, ATTITUDE_RATE, omyFiltCutoff, rateFiltEnable);
+       pidPitchRate.kff, rateUpdateDt, rateSamplingRate, omyFiltCutoff, rateFiltEnable);
   pidInit(&pidYawRate,   0, pidYawRate.kp,   pidYawRate.ki,   pidYawRate.kd,
-       pidYawRate.kff,   updateDt, ATTITUDE_RATE, omzFiltCutoff, rateFiltEnable);
+       pidYawRate.kff,   rateUpdateDt, rateSamplingRate, omzFiltCutoff, rateFiltEnable);
 
   pidSetIntegralLimit(&pidRollRate,  PID_ROLL_RATE_INTEGRATION_LIMIT);
   pidSetIntegralLimit(&pidPitchRate, PID_PITCH_RATE_INTEGRATION_LIMIT);
@@ -133,6 +148,27 @@ void attitudeControllerInit(const float updateDt)
   isInit = true;
 }
 
+void attitudeControllerSetRate(const float rateHz)
+{
+  const float updateDt = 1.0f / rateHz;
+
+#ifndef CONFIG_STABILIZER_INNER_RATE_LOOP
+  pidSetDt(&pidRollRate, updateDt);
+  pidSetDt(&pidPitchRate, updateDt);
+  pidSetDt(&pidYawRate, updateDt);
+  filterReset(&pidRollRate, rateHz, omxFiltCutoff, rateFiltEnable);
+  filterReset(&pidPitchRate, rateHz, omyFiltCutoff, rateFiltEnable);
+  filterReset(&pidYawRate, rateHz, omzFiltCutoff, rateFiltEnable);
+#endif
+
+  pidSetDt(&pidRoll, updateDt);
+  pidSetDt(&pidPitch, updateDt);
+  pidSetDt(&pidYaw, updateDt);
+  filterReset(&pidRoll, rateHz, attFiltCutoff, attFiltEnable);
+  filterReset(&pidPitch, rateHz, attFiltCutoff, attFiltEnable);
+  filterReset(&pidYaw, rateHz, attFiltCutoff, attFiltEnable);
+}
+
 bool attitudeControllerTest()
 {
   return isInit;
@@ -186,16 +222,26 @@ void attitudeControllerResetPitchAttitudePID(void)
     pidReset(&pidPitch);
 }
 
-void attitudeControllerResetAllPID(void)
+void attitudeControllerResetAttitudePID(void)
 {
   pidReset(&pidRoll);
   pidReset(&pidPitch);
   pidReset(&pidYaw);
+}
+
+void attitudeControllerResetRatePID(void)
+{
   pidReset(&pidRollRate);
   pidReset(&pidPitchRate);
   pidReset(&pidYawRate);
 }
 
+void attitudeControllerResetAllPID(void)
+{
+  attitudeControllerResetAttitudePID();
+  attitudeControllerResetRatePID();
+}
+
 void attitudeControllerGetActuatorOutput(int16_t* roll, int16_t* pitch, int16_t* yaw)
 {
   *roll = rollOutput;
@@ -10,10 +10,136 @@
 #include "controller_lee.h"
 
 #include "autoconf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cycle_counter.h"
+#include "eventtrigger.h"
+#include "log.h"
+#include "param.h"
 
 #define DEFAULT_CONTROLLER ControllerTypePID
 static ControllerType currentController = ControllerTypeAutoSelect;
 
+// Budget guard. Each controller call is timed, if the budget is exceeded more than maxOverruns times within
+// one window the fallback controller is used instead.
+#define FALLBACK_CONTROLLER ControllerTypePID
+#define BUDGET_GUARD_WINDOW_MS 1000
+#define CYCLES_PER_US (configCPU_CLOCK_HZ / 1000000)
+
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
+static uint8_t budgetGuardEnable = 1;
+#endif
+static uint16_t budgetUs = 500;
+static uint16_t maxOverruns = 10;
+
+static uint32_t latestCycles;
+static uint32_t overrunCount;
+static uint32_t fallbackCount;
+static uint16_t windowOverruns;
+static uint32_t windowStartMs;
+
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
+static void switchToFallback(const uint32_t cycles);
+#endif
+
+static void guardBudget(const uint32_t cycles) {
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+  if (nowMs - windowStartMs > BUDGET_GUARD_WINDOW_MS) {
+    windowStartMs = nowMs;
+    windowOverruns = 0;
+  }
+
+  if (cycles <= budgetUs * CYCLES_PER_US) {
+    return;
+  }
+
+  overrunCount++;
+  windowOverruns++;
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
+  if (budgetGuardEnable && windowOverruns > maxOverruns && currentController != FALLBACK_CONTROLLER) {
+    windowOverruns = 0;
+    switchToFallback(cycles);
+  }
+#endif
+}
+
+#ifdef CONFIG_STABILIZER_FIXED_DISPATCH
+
+// The controller is fixed at compile time. The calls are direct, the other controllers are not built and there is no
+// fallback controller to switch to.
+#if defined(CONFIG_CONTROLLER_PID)
+  #define FIXED_CONTROLLER ControllerTypePID
+  #define FIXED_CONTROLLER_NAME "PID"
+  #define fixedControllerInit controllerPidInit
+  #define fixedControllerTest controllerPidTest
+  #define fixedControllerUpdate controllerPid
+#elif defined(CONFIG_CONTROLLER_MELLINGER)
+  #define FIXED_CONTROLLER ControllerTypeMellinger
+  #define FIXED_CONTROLLER_NAME "Mellinger"
+  #define fixedControllerInit controllerMellingerFirmwareInit
+  #define fixedControllerTest controllerMellingerFirmwareTest
+  #define fixedControllerUpdate controllerMellingerFirmware
+#elif defined(CONFIG_CONTROLLER_INDI)
+  #define FIXED_CONTROLLER ControllerTypeINDI
+  #define FIXED_CONTROLLER_NAME "INDI"
+  #define fixedControllerInit controllerINDIInit
+  #define fixedControllerTest controllerINDITest
+  #define fixedControllerUpdate controllerINDI
+#elif defined(CONFIG_CONTROLLER_BRESCIANINI)
+  #define FIXED_CONTROLLER ControllerTypeBrescianini
+  #define FIXED_CONTROLLER_NAME "Brescianini"
+  #define fixedControllerInit controllerBrescianiniInit
+  #define fixedControllerTest controllerBrescianiniTest
+  #define fixedControllerUpdate controllerBrescianini
+#elif defined(CONFIG_CONTROLLER_LEE)
+  #define FIXED_CONTROLLER ControllerTypeLee
+  #define FIXED_CONTROLLER_NAME "Lee"
+  #define fixedControllerInit controllerLeeFirmwareInit
+  #define fixedControllerTest controllerLeeFirmwareTest
+  #define fixedControllerUpdate controllerLeeFirmware
+#else
+  #error "CONFIG_STABILIZER_FIXED_DISPATCH requires one controller to be selected"
+#endif
+
+void controllerInit(ControllerType controller) {
+  if (currentController != FIXED_CONTROLLER) {
+    currentController = FIXED_CONTROLLER;
+    fixedControllerInit();
+  }
+
+  DEBUG_PRINT("Using %s (%d) controller, fixed at compile time\n", controllerGetName(), currentController);
+}
+
+ControllerType controllerGetType(void) {
+  return FIXED_CONTROLLER;
+}
+
+bool controllerTest(void) {
+  return fixedControllerTest();
+}
+
+void controller(control_t *control, const setpoint_t *setpoint, const sensorData_t *sensors, const state_t *state, const stabilizerStep_t stabilizerStep) {
+  const uint32_t start = cycleCounterGet();
+  fixedControllerUpdate(control, setpoint, sensors, state, stabilizerStep);
+  latestCycles = cycleCounterElapsed(start);
+
+  guardBudget(latestCycles);
+}
+
+bool controllerFallbackTriggered(void) {
+  return false;
+}
+
+const char* controllerGetName() {
+  return FIXED_CONTROLLER_NAME;
+}
+
+#else
+
+static bool isFallbackTriggered;
+
+EVENTTRIGGER(ctrlFallback, uint8, from, uint32, cycles)
+
 static void initController();
 
 typedef struct {
@@ -86,10 +212,77 @@ bool controllerTest(void) {
   return controllerFunctions[currentController].test();
 }
 
+static void switchToFallback(const uint32_t cycles) {
+  DEBUG_PRINT("%s controller exceeded its budget (%lu cycles), switching to %s\n", controllerGetName(),
+    (unsigned long)cycles, controllerFunctions[FALLBACK_CONTROLLER].name);
+
+  eventTrigger_ctrlFallback_payload.from = currentController;
+  eventTrigger_ctrlFallback_payload.cycles = cycles;
+  eventTrigger(&eventTrigger_ctrlFallback);
+
+  currentController = FALLBACK_CONTROLLER;
+  initController();
+
+  fallbackCount++;
+  isFallbackTriggered = true;
+}
+
 void controller(control_t *control, const setpoint_t *setpoint, const sensorData_t *sensors, const state_t *state, const stabilizerStep_t stabilizerStep) {
+  const uint32_t start = cycleCounterGet();
   controllerFunctions[currentController].update(control, setpoint, sensors, state, stabilizerStep);
+  latestCycles = cycleCounterElapsed(start);
+
+  guardBudget(latestCycles);
+}
+
+bool controllerFallbackTriggered(void) {
+  const bool result = isFallbackTriggered;
+  isFallbackTriggered = false;
+  return result;
 }
 
 const char* controllerGetName() {
   return controllerFunctions[currentController].name;
 }
+
+#endif // CONFIG_STABILIZER_FIXED_DISPATCH
+
+/**
+ * Budget guard for the controllers. Every controller call is timed, if a controller
+ * exceeds the budget more than maxOverruns times within a second the system switches
+ * to the PID controller and the ctrlFallback event is triggered.
+ */
+PARAM_GROUP_START(ctrlGuard)
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
+/**
+ * @brief Nonzero to switch to the PID controller on repeated overruns (default: 1)
+ */
+PARAM_ADD(PARAM_UINT8, enable, &budgetGuardEnable)
+#endif
+/**
+ * @brief Max time for one controller call [us] (default: 500)
+ */
+PARAM_ADD(PARAM_UINT16, budget, &budgetUs)
+/**
+ * @brief Number of overruns within one second that is tolerated before switching (default: 10)
+ */
+PARAM_ADD(PARAM_UINT16, maxOverruns, &maxOverruns)
+PARAM_GROUP_STOP(ctrlGuard)
+
+/**
+ * Budget guard for the controllers
+ */
+LOG_GROUP_START(ctrlGuard)
+/**
+ * @brief CPU cycles spent in the latest controller call
+ */
+LOG_ADD(LOG_UINT32, cycles, &latestCycles)
+/**
+ * @brief Total number of controller calls that exceeded the budget
+ */
+LOG_ADD(LOG_UINT32, overruns, &overrunCount)
+/**
+ * @brief Number of switches to the fallback controller
+ */
+LOG_ADD(LOG_UINT32, fallbacks, &fallbackCount)
+LOG_GROUP_STOP(ctrlGuard)
@@ -0,0 +1,369 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * controller_benchmark.c - Micro-benchmark of the controllers and the math3d kernels
+ *
+ * Times single calls to the full state controllers, to a representative mix of math3d primitives, both in the
+ * reference (math3d.h) and in the optimized (math3d_fast.h) variant, to the trajectory polynomial evaluation and to the IMU sub sampling of
+ * one Kalman prediction interval. On target the calls are timed with the DWT cycle
+ * counter and the benchmark is started through the ctrlBench.run parameter, on host it is run from the python bindings.
+ */
+#define DEBUG_MODULE "CTRLBENCH"
+
+#include <math.h>
+#include <string.h>
+
+#include "controller_benchmark.h"
+#include "controller_mellinger.h"
+#include "controller_lee.h"
+#include "controller_brescianini.h"
+#include "math3d.h"
+#include "math3d_fast.h"
+#include "pptraj.h"
+#include "axis3fSubSampler.h"
+
+#ifndef UNIT_TEST_MODE
+#include "cycle_counter.h"
+#include "supervisor.h"
+#include "param.h"
+#include "log.h"
+#include "debug.h"
+#endif
+
+static controllerMellinger_t mellinger;
+static controllerLee_t lee;
+
+static setpoint_t setpoint;
+static sensorData_t sensors;
+static state_t state;
+static control_t control;
+
+// Results of the math3d workloads are written here so that the compiler can not remove them
+static volatile float sink;
+
+static const char* names[ControllerBenchmark_COUNT] = {
+  [ControllerBenchmarkMellinger] = "Mellinger",
+  [ControllerBenchmarkLee] = "Lee",
+  [ControllerBenchmarkBrescianini] = "Brescianini",
+  [ControllerBenchmarkMath3d] = "math3d",
+  [ControllerBenchmarkMath3dFast] = "math3d fast",
+  [ControllerBenchmarkPoly4dEval] = "poly4d eval",
+  [ControllerBenchmarkSubSampler] = "subsampler",
+  [ControllerBenchmarkSubSamplerConing] = "subsampler coning",
+};
+
+// Gyro samples per Kalman prediction, 1 kHz IMU and 100 Hz prediction
+#define SUB_SAMPLER_SAMPLES 10
+static Axis3fSubSampler_t subSampler;
+
+// A 7th order piece of a figure 8 trajectory, with some height and yaw motion added
+static const struct poly4d benchmarkPiece = {
+  .p = {
+    { 0.396058f, 0.918033f, 0.128965f, -0.773546f, 0.339704f, 0.034310f, -0.026417f, -0.030049f },
+    { -0.445604f, -0.684403f, 0.888433f, 1.493630f, -1.361618f, -0.139316f, 0.158875f, 0.095799f },
+    { 1.0f, 0.1f, -0.05f, 0.02f, 0.01f, -0.005f, 0.002f, -0.001f },
+    { 0.1f, 0.3f, -0.2f, 0.05f, 0.0f, 0.0f, 0.0f, 0.0f },
+  },
+  .duration = 0.71f,
+};
+static float pieceTime;
+
+// A slow circle with a tilted, yawing vehicle lagging a bit behind the setpoint. The scenario changes every iteration
+// to avoid data dependent shortcuts in the measurements.
+static void updateScenario(const uint32_t iteration) {
+  const float t = iteration * 0.01f;
+  const float s = sinf(t);
+  const float c = cosf(t);
+
+  memset(&setpoint, 0, sizeof(setpoint));
+  setpoint.mode.x = modeAbs;
+  setpoint.mode.y = modeAbs;
+  setpoint.mode.z = modeAbs;
+  setpoint.mode.yaw = modeAbs;
+  setpoint.position.x = c;
+  setpoint.position.y = s;
+  setpoint.position.z = 1.0f;
+  setpoint.velocity.x = -s;
+  setpoint.velocity.y = c;
+  setpoint.acceleration.x = -c;
+  setpoint.acceleration.y = -s;
+  setpoint.attitude.yaw = 10.0f * s;
+
+  const float roll = radians(5.0f * s);
+  const float pitch = radians(5.0f * c);
+  const float yaw = radians(10.0f * s + 2.0f);
+  struct quat q = rpy2quat(mkvec(roll, pitch, yaw));
+
+  memset(&state, 0, sizeof(state));
+  state.position.x = 0.95f * c;
+  state.position.y = 0.95f * s;
+  state.position.z = 0.98f;
+  state.velocity.x = -0.9f * s;
+  state.velocity.y = 0.9f * c;
+  state.attitude.roll = degrees(roll);
+  state.attitude.pitch = -degrees(pitch);
+  state.attitude.yaw = degrees(yaw);
+  state.attitudeQuaternion.x = q.x;
+  state.attitudeQuaternion.y = q.y;
+  state.attitudeQuaternion.z = q.z;
+  state.attitudeQuaternion.w = q.w;
+
+  memset(&sensors, 0, sizeof(sensors));
+  sensors.gyro.x = 20.0f * c;
+  sensors.gyro.y = -20.0f * s;
+  sensors.gyro.z = 5.0f * c;
+
+  pieceTime = (0.5f + 0.5f * s) * benchmarkPiece.duration;
+}
+
+static void runMath3d(void) {
+  struct quat q = mkquat(state.attitudeQuaternion.x, state.attitudeQuaternion.y, state.attitudeQuaternion.z, state.attitudeQuaternion.w);
+  struct vec v = mkvec(setpoint.position.x, setpoint.position.y, setpoint.position.z);
+
+  struct quat qn = qnormalize(q);
+  struct vec vr = qvrot(qn, v);
+  struct vec vn = vnormalize(v);
+  struct mat33 R = quat2rotmat(qn);
+  struct mat33 RtR = mmul(mtranspose(R), R);
+  struct vec w = mvmul(mtranspose(R), vn);
+
+  sink = vr.x + vn.y + w.z + RtR.m[0][1];
+}
+
+static void runMath3dFast(void) {
+  struct quat q = mkquat(state.attitudeQuaternion.x, state.attitudeQuaternion.y, state.attitudeQuaternion.z, state.attitudeQuaternion.w);
+  struct vec v = mkvec(setpoint.position.x, setpoint.position.y, setpoint.position.z);
+
+  struct quat qn = qnormalize_fast(q);
+  struct vec vr = qvrot_fast(qn, v);
+  struct vec vn = vnormalize_fast(v);
+  struct mat33 R = quat2rotmat_fast(qn);
+  struct mat33 RtR = mtmul(R, R);
+  struct vec w = mtvmul(R, vn);
+
+  sink = vr.x + vn.y + w.z + RtR.m[0][1];
+}
+
+static void runPoly4dEval(void) {
+  struct traj_eval ev = poly4d_eval(&benchmarkPiece, pieceTime);
+
+  sink = ev.pos.x + ev.vel.y + ev.acc.z + ev.omega.x;
+}
+
+static void runSubSampler(const bool isConing) {
+  Axis3f sample = {.x = sensors.gyro.x, .y = sensors.gyro.y, .z = sensors.gyro.z};
+
+  for (int i = 0; i < SUB_SAMPLER_SAMPLES; i++) {
+    if (isConing) {
+      axis3fSubSamplerAccumulateConing(&subSampler, &sample);
+    } else {
+      axis3fSubSamplerAccumulate(&subSampler, &sample);
+    }
+    sample.x += 0.1f;
+    sample.z -= 0.1f;
+  }
+
+  sink = axis3fSubSamplerFinalize(&subSampler)->y;
+}
+
+static void runOnce(const ControllerBenchmark type) {
+  // Step 0 executes all the rate limited parts of the controllers
+  const stabilizerStep_t step = 0;
+
+  switch (type) {
+    case ControllerBenchmarkMellinger:
+      controllerMellinger(&mellinger, &control, &setpoint, &sensors, &state, step);
+      break;
+    case ControllerBenchmarkLee:
+      controllerLee(&lee, &control, &setpoint, &sensors, &state, step);
+      break;
+    case ControllerBenchmarkBrescianini:
+      controllerBrescianini(&control, &setpoint, &sensors, &state, step);
+      break;
+    case ControllerBenchmarkMath3d:
+      runMath3d();
+      break;
+    case ControllerBenchmarkMath3dFast:
+      runMath3dFast();
+      break;
+    case ControllerBenchmarkPoly4dEval:
+      runPoly4dEval();
+      break;
+    case ControllerBenchmarkSubSampler:
+      runSubSampler(false);
+      break;
+    case ControllerBenchmarkSubSamplerConing:
+      runSubSampler(true);
+      break;
+    default:
+      break;
+  }
+}
+
+void controllerBenchmarkRun(const ControllerBenchmark type, const uint32_t iterations,
+                            const controllerBenchmarkClock_t clock, controllerBenchmarkResult_t* result) {
+  memset(result, 0, sizeof(*result));
+  if (type >= ControllerBenchmark_COUNT || iterations == 0) {
+    return;
+  }
+
+  controllerMellingerInit(&mellinger);
+  controllerLeeInit(&lee);
+  if (type == ControllerBenchmarkSubSamplerConing) {
+    axis3fSubSamplerInitConing(&subSampler, radians(1.0f), 0.001f);
+  } else {
+    axis3fSubSamplerInit(&subSampler, radians(1.0f));
+  }
+  if (type == ControllerBenchmarkBrescianini) {
+    controllerBrescianiniInit();
+  }
+
+  // Warm up caches and the controller states, no timing
+  updateScenario(0);
+  runOnce(type);
+
+  uint64_t total = 0;
+  result->min = UINT32_MAX;
+  for (uint32_t i = 0; i < iterations; i++) {
+    updateScenario(i + 1);
+
+    const uint32_t start = clock();
+    runOnce(type);
+    const uint32_t elapsed = clock() - start;
+
+    total += elapsed;
+    if (elapsed < result->min) {
+      result->min = elapsed;
+    }
+    if (elapsed > result->max) {
+      result->max = elapsed;
+    }
+  }
+
+  result->count = iterations;
+  result->avg = (float)total / iterations;
+
+  if (type == ControllerBenchmarkBrescianini) {
+    controllerBrescianiniInit();
+  }
+}
+
+const char* controllerBenchmarkName(const ControllerBenchmark type) {
+  if (type >= ControllerBenchmark_COUNT) {
+    return "Unknown";
+  }
+  return names[type];
+}
+
+#ifndef UNIT_TEST_MODE
+
+#define CONTROLLER_BENCHMARK_ITERATIONS 200
+
+static uint8_t run;
+static float avgCycles[ControllerBenchmark_COUNT];
+static uint32_t maxCycles[ControllerBenchmark_COUNT];
+
+static void runBenchmarks(void) {
+  if (!run) {
+    return;
+  }
+  run = 0;
+
+  if (supervisorIsArmed()) {
+    DEBUG_PRINT("Refusing to run while armed\n");
+    return;
+  }
+
+  cycleCounterInit();
+  for (int type = 0; type < ControllerBenchmark_COUNT; type++) {
+    controllerBenchmarkResult_t result;
+    controllerBenchmarkRun(type, CONTROLLER_BENCHMARK_ITERATIONS, cycleCounterGet, &result);
+    avgCycles[type] = result.avg;
+    maxCycles[type] = result.max;
+    DEBUG_PRINT("%s: min %lu avg %.0f max %lu cycles\n", controllerBenchmarkName(type),
+      (unsigned long)result.min, (double)result.avg, (unsigned long)result.max);
+  }
+}
+
+/**
+ * Micro-benchmark of the controllers, the math3d kernels, the trajectory evaluation and the IMU sub sampling, timed with the cycle counter. Intended to be run on
+ * ground to compare the cost of the controllers.
+ */
+PARAM_GROUP_START(ctrlBench)
+/**
+ * @brief Set to nonzero to run the benchmarks, results are printed to the console and logged. Refused while armed.
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, run, &run, runBenchmarks)
+PARAM_GROUP_STOP(ctrlBench)
+
+/**
+ * Results of the last benchmark run, in CPU cycles per call
+ */
+LOG_GROUP_START(ctrlBench)
+/**
+ * @brief Mellinger controller, average cycles
+ */
+LOG_ADD(LOG_FLOAT, mellAvg, &avgCycles[ControllerBenchmarkMellinger])
+/**
+ * @brief Mellinger controller, max cycles
+ */
+LOG_ADD(LOG_UINT32, mellMax, &maxCycles[ControllerBenchmarkMellinger])
+/**
+ * @brief Lee controller, average cycles
+ */
+LOG_ADD(LOG_FLOAT, leeAvg, &avgCycles[ControllerBenchmarkLee])
+/**
+ * @brief Lee controller, max cycles
+ */
+LOG_ADD(LOG_UINT32, leeMax, &maxCycles[ControllerBenchmarkLee])
+/**
+ * @brief Brescianini controller, average cycles
+ */
+LOG_ADD(LOG_FLOAT, brescAvg, &avgCycles[ControllerBenchmarkBrescianini])
+/**
+ * @brief Brescianini controller, max cycles
+ */
+LOG_ADD(LOG_UINT32, brescMax, &maxCycles[ControllerBenchmarkBrescianini])
+/**
+ * @brief math3d reference workload, average cycles
+ */
+LOG_ADD(LOG_FLOAT, m3dAvg, &avgCycles[ControllerBenchmarkMath3d])
+/**
+ * @brief math3d fast workload, average cycles
+ */
+LOG_ADD(LOG_FLOAT, m3dFastAvg, &avgCycles[ControllerBenchmarkMath3dFast])
+/**
+ * @brief Trajectory polynomial evaluation (poly4d_eval), average cycles
+ */
+LOG_ADD(LOG_FLOAT, polyAvg, &avgCycles[ControllerBenchmarkPoly4dEval])
+/**
+ * @brief IMU sub sampling of one Kalman prediction (10 gyro samples and the finalize), average cycles
+ */
+LOG_ADD(LOG_FLOAT, subSmpAvg, &avgCycles[ControllerBenchmarkSubSampler])
+/**
+ * @brief As subSmpAvg, with coning correction, average cycles
+ */
+LOG_ADD(LOG_FLOAT, coningAvg, &avgCycles[ControllerBenchmarkSubSamplerConing])
+LOG_GROUP_STOP(ctrlBench)
+
+#endif // UNIT_TEST_MODE
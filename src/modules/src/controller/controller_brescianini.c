@@ -261,16 +261,18 @@ void controllerBrescianini(control_t *control,
     }
 
     // the attitude error quaternion
-    attErrorReduced.w = cosf(alpha / 2.0f);
-    attErrorReduced.x = sinf(alpha / 2.0f) * rotAxisI.x;
-    attErrorReduced.y = sinf(alpha / 2.0f) * rotAxisI.y;
-    attErrorReduced.z = sinf(alpha / 2.0f) * rotAxisI.z;
+    float sinHalfAlpha = sinf(alpha / 2.0f);
+    float cosHalfAlpha = cosf(alpha / 2.0f);
+    attErrorReduced.w = cosHalfAlpha;
+    attErrorReduced.x = sinHalfAlpha * rotAxisI.x;
+    attErrorReduced.y = sinHalfAlpha * rotAxisI.y;
+    attErrorReduced.z = sinHalfAlpha * rotAxisI.z;
 
     // choose the shorter rotation
-    if (sinf(alpha / 2.0f) < 0) {
+    if (sinHalfAlpha < 0) {
       rotAxisI = vneg(rotAxisI);
     }
-    if (cosf(alpha / 2.0f) < 0) {
+    if (cosHalfAlpha < 0) {
       rotAxisI = vneg(rotAxisI);
       attErrorReduced = qneg(attErrorReduced);
     }
@@ -293,10 +295,12 @@ void controllerBrescianini(control_t *control,
     }
 
     // the quaternion corresponding to a roll and pitch around this axis
-    struct quat attFullReqPitchRoll = mkquat(sinf(alpha / 2.0f) * rotAxisI.x,
-                                             sinf(alpha / 2.0f) * rotAxisI.y,
-                                             sinf(alpha / 2.0f) * rotAxisI.z,
-                                             cosf(alpha / 2.0f));
+    sinHalfAlpha = sinf(alpha / 2.0f);
+    cosHalfAlpha = cosf(alpha / 2.0f);
+    struct quat attFullReqPitchRoll = mkquat(sinHalfAlpha * rotAxisI.x,
+                                             sinHalfAlpha * rotAxisI.y,
+                                             sinHalfAlpha * rotAxisI.z,
+                                             cosHalfAlpha);
 
     // the quaternion corresponding to a rotation to the desired yaw
     struct quat attFullReqYaw = mkquat(0, 0, sinf(radians(setpoint->attitude.yaw) / 2.0f), cosf(radians(setpoint->attitude.yaw) / 2.0f));
@@ -23,8 +23,17 @@
  * http://arc.aiaa.org/doi/pdf/10.2514/1.G001490
  */
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "controller_indi.h"
 #include "math3d.h"
+#include "cycle_counter.h"
+#include "statsCnt.h"
+
+// Channels of the gyro rates and actuator commands in the filter bank
+#define INDI_FILT_RATE 0
+#define INDI_FILT_U 3
 
 static float thrust_threshold = 300.0f;
 static float bound_control_input = 32000.0f;
@@ -36,6 +45,9 @@ struct FloatRates body_rates;
 static vector_t refOuterINDI;				// Reference values from outer loop INDI
 static bool outerLoopActive = true ; 		// if 1, outer loop INDI is activated
 
+// Cost of a controller call [cycles]
+static statsCntMinMaxAvg_t indiCycles;
+
 static struct IndiVariables indi = {
 		.g1 = {STABILIZATION_INDI_G1_P, STABILIZATION_INDI_G1_Q, STABILIZATION_INDI_G1_R},
 		.g2 = STABILIZATION_INDI_G2_R,
@@ -60,43 +72,46 @@ static inline void float_rates_zero(struct FloatRates *fr) {
 
 void indi_init_filters(void)
 {
-	// tau = 1/(2*pi*Fc)
-	float tau = 1.0f / (2.0f * M_PI_F * indi.filt_cutoff);
-	float tau_r = 1.0f / (2.0f * M_PI_F * indi.filt_cutoff_r);
-	float tau_axis[3] = {tau, tau, tau_r};
-	float sample_time = 1.0f / ATTITUDE_RATE;
-	// Filtering of gyroscope and actuators
-	for (int8_t i = 0; i < 3; i++) {
-		init_butterworth_2_low_pass(&indi.u[i], tau_axis[i], sample_time, 0.0f);
-		init_butterworth_2_low_pass(&indi.rate[i], tau_axis[i], sample_time, 0.0f);
-	}
+	// Filtering of gyroscope and actuators, second order Butterworth
+	biquadBankInitLowPass(&indi.filt, 6, ATTITUDE_RATE, indi.filt_cutoff);
+	biquadBankSetLowPass(&indi.filt, INDI_FILT_RATE + 2, ATTITUDE_RATE, indi.filt_cutoff_r);
+	biquadBankSetLowPass(&indi.filt, INDI_FILT_U + 2, ATTITUDE_RATE, indi.filt_cutoff_r);
+	indi.filt_cutoff_applied = indi.filt_cutoff;
+	indi.filt_cutoff_r_applied = indi.filt_cutoff_r;
 }
 
 /**
- * @brief Update butterworth filter for p, q and r of a FloatRates struct
- *
- * @param filter The filter array to use
- * @param new_values The new values
+ * @brief Recalculate the filter coefficients when a cutoff parameter has changed, the state is kept
  */
-static inline void filter_pqr(Butterworth2LowPass *filter, struct FloatRates *new_values)
+static void indi_update_filter_cutoffs(void)
 {
-	update_butterworth_2_low_pass(&filter[0], new_values->p);
-	update_butterworth_2_low_pass(&filter[1], new_values->q);
-	update_butterworth_2_low_pass(&filter[2], new_values->r);
+	if (indi.filt_cutoff != indi.filt_cutoff_applied) {
+		for (int8_t i = 0; i < 2; i++) {
+			biquadBankSetLowPass(&indi.filt, INDI_FILT_RATE + i, ATTITUDE_RATE, indi.filt_cutoff);
+			biquadBankSetLowPass(&indi.filt, INDI_FILT_U + i, ATTITUDE_RATE, indi.filt_cutoff);
+		}
+		indi.filt_cutoff_applied = indi.filt_cutoff;
+	}
+
+	if (indi.filt_cutoff_r != indi.filt_cutoff_r_applied) {
+		biquadBankSetLowPass(&indi.filt, INDI_FILT_RATE + 2, ATTITUDE_RATE, indi.filt_cutoff_r);
+		biquadBankSetLowPass(&indi.filt, INDI_FILT_U + 2, ATTITUDE_RATE, indi.filt_cutoff_r);
+		indi.filt_cutoff_r_applied = indi.filt_cutoff_r;
+	}
 }
 
 /**
- * @brief Caclulate finite difference form a filter array
- * The filter already contains the previous values
+ * @brief Filter the gyro rates and the actuator commands of the previous time step, and calculate the finite
+ * difference of the filtered rates, in one pass
  *
- * @param output The output array
- * @param filter The filter array input
+ * @param rates The gyro rates
+ * @param u The actuator commands
+ * @param rate_d The output angular accelerations
  */
-static inline void finite_difference_from_filter(float *output, Butterworth2LowPass *filter)
+static inline void filter_pqr_and_differentiate(const struct FloatRates *rates, const struct FloatRates *u, float *rate_d)
 {
-	for (int8_t i = 0; i < 3; i++) {
-		output[i] = (filter[i].o[0] - filter[i].o[1]) * ATTITUDE_RATE;
-	}
+	float values[6] = {rates->p, rates->q, rates->r, u->p, u->q, u->r};
+	biquadBankApplyDifferentiate(&indi.filt, values, 3, ATTITUDE_RATE, rate_d);
 }
 
 static float capAngle(float angle) {
@@ -128,6 +143,9 @@ void controllerINDIInit(void)
 	// Re-initialize filters
 	indi_init_filters();
 
+	cycleCounterInit();
+	statsCntMinMaxAvgInit(&indiCycles, 1000);
+
 	attitudeControllerInit(ATTITUDE_UPDATE_DT);
 	positionControllerInit();
 	positionControllerINDIInit();
@@ -147,6 +165,8 @@ void controllerINDI(control_t *control, const setpoint_t *setpoint,
 	const state_t *state,
 	const stabilizerStep_t stabilizerStep)
 {
+	const uint32_t start = cycleCounterGet();
+
 	control->controlMode = controlModeLegacy;
 
 	//The z_distance decoder adds a negative sign to the yaw command, the position decoder doesn't
@@ -240,18 +260,14 @@ void controllerINDI(control_t *control, const setpoint_t *setpoint,
 		body_rates.q = -radians(sensors->gyro.y); //Account for gyro measuring pitch rate in opposite direction relative to both the CF coords and INDI coords
 		body_rates.r = -radians(sensors->gyro.z); //Account for conversion of ENU -> NED
 
-		filter_pqr(indi.rate, &body_rates);
-
 		/*
 		 * 2 - Calculate the derivative with finite difference.
-		 */
-
-		finite_difference_from_filter(indi.rate_d, indi.rate);
-
-		/*
 		 * 3 - same filter on the actuators (or control_t values), using the commands from the previous timestep.
+		 * Done in the same pass as the gyro filter.
 		 */
-		filter_pqr(indi.u, &indi.u_act_dyn);
+
+		indi_update_filter_cutoffs();
+		filter_pqr_and_differentiate(&body_rates, &indi.u_act_dyn, indi.rate_d);
 
 
 		/*
@@ -289,9 +305,9 @@ void controllerINDI(control_t *control, const setpoint_t *setpoint,
 		 * 6. Add delta_commands to commands and bound to allowable values
 		 */
 
-		indi.u_in.p = indi.u[0].o[0] + indi.du.p;
-		indi.u_in.q = indi.u[1].o[0] + indi.du.q;
-		indi.u_in.r = indi.u[2].o[0] + indi.du.r;
+		indi.u_in.p = indi.filt.y1[INDI_FILT_U + 0] + indi.du.p;
+		indi.u_in.q = indi.filt.y1[INDI_FILT_U + 1] + indi.du.q;
+		indi.u_in.r = indi.filt.y1[INDI_FILT_U + 2] + indi.du.r;
 
 		//bound the total control input
 		indi.u_in.p = clamp(indi.u_in.p, -1.0f*bound_control_input, bound_control_input);
@@ -331,6 +347,8 @@ void controllerINDI(control_t *control, const setpoint_t *setpoint,
 	control->pitch = indi.u_in.q;
 	control->yaw  = indi.u_in.r;
 
+	statsCntMinMaxAvgAdd(&indiCycles, cycleCounterElapsed(start));
+	statsCntMinMaxAvgUpdate(&indiCycles, T2M(xTaskGetTickCount()));
 }
 
 /**
@@ -506,28 +524,28 @@ LOG_ADD(LOG_FLOAT, rate_d[2], &indi.rate_d[2])
 /**
  * @brief INDI filtered (8Hz low-pass) roll motor input from previous time step [motor units]
  */
-LOG_ADD(LOG_FLOAT, uf_p, &indi.u[0].o[0])
+LOG_ADD(LOG_FLOAT, uf_p, &indi.filt.y1[INDI_FILT_U + 0])
 /**
  * @brief INDI filtered (8Hz low-pass) pitch motor input from previous time step [motor units]
  */
-LOG_ADD(LOG_FLOAT, uf_q, &indi.u[1].o[0])
+LOG_ADD(LOG_FLOAT, uf_q, &indi.filt.y1[INDI_FILT_U + 1])
 /**
  * @brief INDI filtered (8Hz low-pass) yaw motor input from previous time step [motor units]
  */
-LOG_ADD(LOG_FLOAT, uf_r, &indi.u[2].o[0])
+LOG_ADD(LOG_FLOAT, uf_r, &indi.filt.y1[INDI_FILT_U + 2])
 
 /**
  * @brief INDI filtered gyroscope measurement (8Hz low-pass), roll [rad/s]
  */
-LOG_ADD(LOG_FLOAT, Omega_f_p, &indi.rate[0].o[0])
+LOG_ADD(LOG_FLOAT, Omega_f_p, &indi.filt.y1[INDI_FILT_RATE + 0])
 /**
  * @brief INDI filtered gyroscope measurement (8Hz low-pass), pitch [rad/s]
  */
-LOG_ADD(LOG_FLOAT, Omega_f_q, &indi.rate[1].o[0])
+LOG_ADD(LOG_FLOAT, Omega_f_q, &indi.filt.y1[INDI_FILT_RATE + 1])
 /**
  * @brief INDI filtered gyroscope measurement (8Hz low-pass), yaw [rad/s]
  */
-LOG_ADD(LOG_FLOAT, Omega_f_r, &indi.rate[2].o[0])
+LOG_ADD(LOG_FLOAT, Omega_f_r, &indi.filt.y1[INDI_FILT_RATE + 2])
 
 /**
  * @brief INDI desired attitude angle from outer loop, roll [rad]
@@ -542,4 +560,9 @@ LOG_ADD(LOG_FLOAT, n_q, &attitudeDesired.pitch)
  */
 LOG_ADD(LOG_FLOAT, n_r, &attitudeDesired.yaw)
 
+/**
+ * @brief Cost of a controller call, including the outer loop [cycles]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(cycles, &indiCycles)
+
 LOG_GROUP_STOP(ctrlINDI)
@@ -38,6 +38,7 @@ CDC 2010
 #include <string.h>
 
 #include "math3d.h"
+#include "math3d_fast.h"
 #include "controller_lee.h"
 #include "physicalConstants.h"
 #include "power_distribution.h"
@@ -143,9 +144,8 @@ void controllerLee(controllerLee_t* self, control_t *control, const setpoint_t *
       veltmul(self->Kpos_I, self->i_error_pos));
 
     struct quat q = mkquat(state->attitudeQuaternion.x, state->attitudeQuaternion.y, state->attitudeQuaternion.z, state->attitudeQuaternion.w);
-    struct mat33 R = quat2rotmat(q);
-    struct vec z  = vbasis(2);
-    control->thrustSi = self->mass*vdot(F_d , mvmul(R, z));
+    struct mat33 R = quat2rotmat_fast(q);
+    control->thrustSi = self->mass*vdot(F_d , mcolumn(R, 2));
     self->thrustSi = control->thrustSi;
     // Reset the accumulated error while on the ground
     if (control->thrustSi < 0.01f) {
@@ -200,16 +200,17 @@ void controllerLee(controllerLee_t* self, control_t *control, const setpoint_t *
   // current rotation [R]
   struct quat q = mkquat(state->attitudeQuaternion.x, state->attitudeQuaternion.y, state->attitudeQuaternion.z, state->attitudeQuaternion.w);
   self->rpy = quat2rpy(q);
-  struct mat33 R = quat2rotmat(q);
+  struct mat33 R = quat2rotmat_fast(q);
 
   // desired rotation [Rdes]
   struct quat q_des = mat2quat(self->R_des);
   self->rpy_des = quat2rpy(q_des);
 
-  // rotation error
-  struct mat33 eRM = msub(mmul(mtranspose(self->R_des), R), mmul(mtranspose(R), self->R_des));
+  // rotation error, eR = 0.5 * vee(Rdes^T R - R^T Rdes). With X = R^T Rdes the first term is X^T,
+  // so only one matrix product is needed.
+  struct mat33 X = mtmul(R, self->R_des);
 
-  struct vec eR = vscl(0.5f, mkvec(eRM.m[2][1], eRM.m[0][2], eRM.m[1][0]));
+  struct vec eR = vscl(0.5f, mkvec(X.m[1][2] - X.m[2][1], X.m[2][0] - X.m[0][2], X.m[0][1] - X.m[1][0]));
 
   // angular velocity
   self->omega = mkvec(
@@ -233,7 +234,7 @@ void controllerLee(controllerLee_t* self, control_t *control, const setpoint_t *
   float desiredYawRate = radians(setpoint->attitudeRate.yaw) * vdot(zdes,z_w);
   struct vec omega_des = mkvec(-vdot(hw,ydes), vdot(hw,xdes), desiredYawRate);
   
-  self->omega_r = mvmul(mmul(mtranspose(R), self->R_des), omega_des);
+  self->omega_r = mvmul(X, omega_des);
 
   struct vec omega_error = vsub(self->omega, self->omega_r);
   
@@ -8,8 +8,36 @@
 #include "log.h"
 #include "param.h"
 #include "math3d.h"
-
-#define ATTITUDE_UPDATE_DT    (float)(1.0f/ATTITUDE_RATE)
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+#include "rate_loop.h"
+#endif
+#ifndef UNIT_TEST_MODE
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cycle_counter.h"
+#include "statsCnt.h"
+#endif
+
+// The loops run on the ticks where (tick % divider) == (phase % divider), the divider is RATE_MAIN_LOOP / rate.
+// The position loop is by default run on the odd ticks, the attitude loop on the even ticks, to spread the work of a
+// position update over ticks where the attitude loop is idle.
+typedef struct {
+  uint16_t rate;
+  uint16_t divider;
+  float dt;
+} loopRate_t;
+
+static uint16_t attitudeRate = ATTITUDE_RATE;
+static uint16_t positionRate = POSITION_RATE;
+static uint8_t attitudePhase = 0;
+static uint8_t positionPhase = 1;
+
+static loopRate_t attitudeLoop;
+static loopRate_t positionLoop;
+
+#ifndef UNIT_TEST_MODE
+static statsCntMinMaxAvg_t pidCycles;
+#endif
 
 static attitude_t attitudeDesired;
 static attitude_t rateDesired;
@@ -24,10 +52,48 @@ static float r_pitch;
 static float r_yaw;
 static float accelz;
 
+// Only rates that divide the main loop rate can be run, other rates are rounded up to the next one that does
+static void loopRateSet(loopRate_t* loop, const uint16_t rate) {
+  uint16_t divider = 1;
+  if (rate == 0) {
+    divider = RATE_MAIN_LOOP;
+  } else if (rate < RATE_MAIN_LOOP) {
+    divider = RATE_MAIN_LOOP / rate;
+  }
+
+  loop->rate = rate;
+  loop->divider = divider;
+  loop->dt = (float)divider / RATE_MAIN_LOOP;
+}
+
+static bool loopDoExecute(const loopRate_t* loop, const uint8_t phase, const stabilizerStep_t stabilizerStep) {
+  return (stabilizerStep % loop->divider) == (phase % loop->divider);
+}
+
+// Applies changes of the rate parameters, the PIDs are updated with the new sample time
+static void updateLoopRates(const bool force) {
+  if (force || attitudeRate != attitudeLoop.rate) {
+    loopRateSet(&attitudeLoop, attitudeRate);
+    attitudeControllerSetRate(1.0f / attitudeLoop.dt);
+  }
+
+  if (force || positionRate != positionLoop.rate) {
+    loopRateSet(&positionLoop, positionRate);
+    positionControllerSetRate(1.0f / positionLoop.dt);
+  }
+}
+
 void controllerPidInit(void)
 {
-  attitudeControllerInit(ATTITUDE_UPDATE_DT);
+  attitudeControllerInit((float)(1.0f/ATTITUDE_RATE));
   positionControllerInit();
+
+  updateLoopRates(true);
+
+#ifndef UNIT_TEST_MODE
+  cycleCounterInit();
+  statsCntMinMaxAvgInit(&pidCycles, 1000);
+#endif
 }
 
 bool controllerPidTest(void)
@@ -58,12 +124,20 @@ void controllerPid(control_t *control, const setpoint_t *setpoint,
                                          const state_t *state,
                                          const stabilizerStep_t stabilizerStep)
 {
+#ifndef UNIT_TEST_MODE
+  const uint32_t start = cycleCounterGet();
+#endif
+
   control->controlMode = controlModeLegacy;
 
-  if (RATE_DO_EXECUTE(ATTITUDE_RATE, stabilizerStep)) {
+  updateLoopRates(false);
+  const bool runAttitude = loopDoExecute(&attitudeLoop, attitudePhase, stabilizerStep);
+  const bool runPosition = loopDoExecute(&positionLoop, positionPhase, stabilizerStep);
+
+  if (runAttitude) {
     // Rate-controled YAW is moving YAW angle setpoint
     if (setpoint->mode.yaw == modeVelocity) {
-      attitudeDesired.yaw = capAngle(attitudeDesired.yaw + setpoint->attitudeRate.yaw * ATTITUDE_UPDATE_DT);
+      attitudeDesired.yaw = capAngle(attitudeDesired.yaw + setpoint->attitudeRate.yaw * attitudeLoop.dt);
 
       float yawMaxDelta = attitudeControllerGetYawMaxDelta();
       if (yawMaxDelta != 0.0f)
@@ -90,11 +164,11 @@ void controllerPid(control_t *control, const setpoint_t *setpoint,
     attitudeDesired.yaw = capAngle(attitudeDesired.yaw);
   }
 
-  if (RATE_DO_EXECUTE(POSITION_RATE, stabilizerStep)) {
+  if (runPosition) {
     positionController(&actuatorThrust, &attitudeDesired, setpoint, state);
   }
 
-  if (RATE_DO_EXECUTE(ATTITUDE_RATE, stabilizerStep)) {
+  if (runAttitude) {
     // Switch between manual and automatic position control
     if (setpoint->mode.z == modeDisable) {
       actuatorThrust = setpoint->thrust;
@@ -120,6 +194,11 @@ void controllerPid(control_t *control, const setpoint_t *setpoint,
       attitudeControllerResetPitchAttitudePID();
     }
 
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+    // The rate PID is run by the inner rate loop on every gyro sample, the output
+    // here is the latest one from the rate loop and only used for logging
+    rateLoopGetControl(control);
+#else
     // TODO: Investigate possibility to subtract gyro drift.
     attitudeControllerCorrectRatePID(sensors->gyro.x, -sensors->gyro.y, sensors->gyro.z,
                              rateDesired.roll, rateDesired.pitch, rateDesired.yaw);
@@ -129,6 +208,7 @@ void controllerPid(control_t *control, const setpoint_t *setpoint,
                                         &control->yaw);
 
     control->yaw = -control->yaw;
+#endif
 
     cmd_thrust = control->thrust;
     cmd_roll = control->roll;
@@ -154,12 +234,26 @@ void controllerPid(control_t *control, const setpoint_t *setpoint,
     cmd_pitch = control->pitch;
     cmd_yaw = control->yaw;
 
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+    // The rate PIDs belong to the rate loop, it resets them itself on zero thrust
+    attitudeControllerResetAttitudePID();
+#else
     attitudeControllerResetAllPID();
+#endif
     positionControllerResetAllPID();
 
     // Reset the calculated YAW angle for rate control
     attitudeDesired.yaw = state->attitude.yaw;
   }
+
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+  rateLoopSetSetpoint(&rateDesired, control->thrust);
+#endif
+
+#ifndef UNIT_TEST_MODE
+  statsCntMinMaxAvgAdd(&pidCycles, cycleCounterElapsed(start));
+  statsCntMinMaxAvgUpdate(&pidCycles, T2M(xTaskGetTickCount()));
+#endif
 }
 
 /**
@@ -227,4 +321,33 @@ LOG_ADD(LOG_FLOAT, pitchRate, &rateDesired.pitch)
  * @brief Desired yaw rate setpoint
  */
 LOG_ADD(LOG_FLOAT, yawRate,   &rateDesired.yaw)
+#ifndef UNIT_TEST_MODE
+/**
+ * @brief Min, average and max CPU cycles of a controller tick, the max is the worst case tick with both loops
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(cycles, &pidCycles)
+#endif
 LOG_GROUP_STOP(controller)
+
+/**
+ * Loop rates of the PID controller. The rates are rounded up to rates that divide the main loop rate
+ * (1000 Hz), for instance 300 Hz runs at 333 Hz.
+ */
+PARAM_GROUP_START(ctrlPid)
+/**
+ * @brief Rate of the attitude loop [Hz] (default: 500)
+ */
+PARAM_ADD(PARAM_UINT16 | PARAM_PERSISTENT, attRate, &attitudeRate)
+/**
+ * @brief Rate of the position loop [Hz] (default: 100)
+ */
+PARAM_ADD(PARAM_UINT16 | PARAM_PERSISTENT, posRate, &positionRate)
+/**
+ * @brief Tick, modulo the loop period, the attitude loop runs on (default: 0)
+ */
+PARAM_ADD(PARAM_UINT8 | PARAM_PERSISTENT, attPhase, &attitudePhase)
+/**
+ * @brief Tick, modulo the loop period, the position loop runs on. The default (1) keeps it off the attitude ticks
+ */
+PARAM_ADD(PARAM_UINT8 | PARAM_PERSISTENT, posPhase, &positionPhase)
+PARAM_GROUP_STOP(ctrlPid)
@@ -58,38 +58,32 @@ static struct IndiOuterVariables indiOuter = {
 
 void position_indi_init_filters(void)
 {
-	// tau = 1/(2*pi*Fc)
-	float tau = 1.0f / (2.0f * M_PI_F * indiOuter.filt_cutoff);
-	float tau_axis[3] = {tau, tau, tau};
-	float sample_time = 1.0f / ATTITUDE_RATE;
-	// Filtering of linear acceleration, attitude and thrust 
-	for (int8_t i = 0; i < 3; i++) {
-		init_butterworth_2_low_pass(&indiOuter.ddxi[i], tau_axis[i], sample_time, 0.0f);
-		init_butterworth_2_low_pass(&indiOuter.ang[i], tau_axis[i], sample_time, 0.0f);
-		init_butterworth_2_low_pass(&indiOuter.thr[i], tau_axis[i], sample_time, 0.0f);
-	}
-}
-
-// Linear acceleration filter
-static inline void filter_ddxi(Butterworth2LowPass *filter, struct Vectr *old_values, struct Vectr *new_values)
-{
-	new_values->x = update_butterworth_2_low_pass(&filter[0], old_values->x);
-	new_values->y = update_butterworth_2_low_pass(&filter[1], old_values->y);
-	new_values->z = update_butterworth_2_low_pass(&filter[2], old_values->z);
+	// Filtering of linear acceleration, attitude and thrust, second order Butterworth
+	biquadBankInitLowPass(&indiOuter.accAtt, 6, ATTITUDE_RATE, indiOuter.filt_cutoff);
+	biquadBankInitLowPass(&indiOuter.thr, 1, ATTITUDE_RATE, indiOuter.filt_cutoff);
 }
 
-// Attitude filter
-static inline void filter_ang(Butterworth2LowPass *filter, struct Angles *old_values, struct Angles *new_values)
+// Linear acceleration and attitude filter, in one pass
+static inline void filter_ddxi_ang(biquadBank_t *filter, const struct Vectr *accel, const struct Angles *att,
+                                   struct Vectr *accel_f, struct Angles *att_f)
 {
-	new_values->phi = update_butterworth_2_low_pass(&filter[0], old_values->phi);
-	new_values->theta = update_butterworth_2_low_pass(&filter[1], old_values->theta);
-	new_values->psi = update_butterworth_2_low_pass(&filter[2], old_values->psi);
+	float values[6] = {accel->x, accel->y, accel->z, att->phi, att->theta, att->psi};
+	biquadBankApply(filter, values);
+
+	accel_f->x = values[0];
+	accel_f->y = values[1];
+	accel_f->z = values[2];
+	att_f->phi = values[3];
+	att_f->theta = values[4];
+	att_f->psi = values[5];
 }
 
 // Thrust filter
-static inline void filter_thrust(Butterworth2LowPass *filter, float *old_thrust, float *new_thrust) 
+static inline void filter_thrust(biquadBank_t *filter, float *old_thrust, float *new_thrust)
 {
-	*new_thrust = update_butterworth_2_low_pass(&filter[0], *old_thrust);
+	float value = *old_thrust;
+	biquadBankApply(filter, &value);
+	*new_thrust = value;
 }
 
 
@@ -158,14 +152,14 @@ void positionControllerINDI(const sensorData_t *sensors,
 	indiOuter.linear_accel_s.y = (-sensors->acc.y)*9.81f;
 	indiOuter.linear_accel_s.z = (-sensors->acc.z)*9.81f;
 
-	// Filter lin. acceleration 
-	filter_ddxi(indiOuter.ddxi, &indiOuter.linear_accel_s, &indiOuter.linear_accel_f);
-
 	// Obtain actual attitude values (in rad)
 	indiOuter.attitude_s.phi = radians(state->attitude.roll); 
 	indiOuter.attitude_s.theta = radians(state->attitude.pitch);
 	indiOuter.attitude_s.psi = -radians(state->attitude.yaw);
-	filter_ang(indiOuter.ang, &indiOuter.attitude_s, &indiOuter.attitude_f);
+
+	// Filter lin. acceleration and attitude
+	filter_ddxi_ang(&indiOuter.accAtt, &indiOuter.linear_accel_s, &indiOuter.attitude_s,
+	                &indiOuter.linear_accel_f, &indiOuter.attitude_f);
 
 
 	// Actual attitude (in rad)
@@ -245,7 +239,7 @@ void positionControllerINDI(const sensorData_t *sensors,
 	indiOuter.T_tilde     = -(g31_inv*indiOuter.linear_accel_err.x + g32_inv*indiOuter.linear_accel_err.y + g33_inv*indiOuter.linear_accel_err.z)/K_thr; 	
 
 	// Filter thrust
-	filter_thrust(indiOuter.thr, &indiOuter.T_incremented, &indiOuter.T_inner_f);
+	filter_thrust(&indiOuter.thr, &indiOuter.T_incremented, &indiOuter.T_inner_f);
 
 	// Pass thrust through the model of the actuator dynamics
 	indiOuter.T_inner = indiOuter.T_inner + indiOuter.act_dyn_posINDI*(indiOuter.T_inner_f - indiOuter.T_inner); 
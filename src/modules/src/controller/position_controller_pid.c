@@ -163,21 +163,26 @@ static struct this_s this = {
 };
 #endif
 
+// The rate positionController() is called at
+static float updateRate = POSITION_RATE;
+
 void positionControllerInit()
 {
+  updateRate = POSITION_RATE;
+
   pidInit(&this.pidX.pid, this.pidX.setpoint, this.pidX.pid.kp, this.pidX.pid.ki, this.pidX.pid.kd,
-      this.pidX.pid.kff, this.pidX.pid.dt, POSITION_RATE, posFiltCutoff, posFiltEnable);
+      this.pidX.pid.kff, DT, POSITION_RATE, posFiltCutoff, posFiltEnable);
   pidInit(&this.pidY.pid, this.pidY.setpoint, this.pidY.pid.kp, this.pidY.pid.ki, this.pidY.pid.kd,
-      this.pidY.pid.kff, this.pidY.pid.dt, POSITION_RATE, posFiltCutoff, posFiltEnable);
+      this.pidY.pid.kff, DT, POSITION_RATE, posFiltCutoff, posFiltEnable);
   pidInit(&this.pidZ.pid, this.pidZ.setpoint, this.pidZ.pid.kp, this.pidZ.pid.ki, this.pidZ.pid.kd,
-      this.pidZ.pid.kff, this.pidZ.pid.dt, POSITION_RATE, posZFiltCutoff, posZFiltEnable);
+      this.pidZ.pid.kff, DT, POSITION_RATE, posZFiltCutoff, posZFiltEnable);
 
   pidInit(&this.pidVX.pid, this.pidVX.setpoint, this.pidVX.pid.kp, this.pidVX.pid.ki, this.pidVX.pid.kd,
-      this.pidVX.pid.kff, this.pidVX.pid.dt, POSITION_RATE, velFiltCutoff, velFiltEnable);
+      this.pidVX.pid.kff, DT, POSITION_RATE, velFiltCutoff, velFiltEnable);
   pidInit(&this.pidVY.pid, this.pidVY.setpoint, this.pidVY.pid.kp, this.pidVY.pid.ki, this.pidVY.pid.kd,
-      this.pidVY.pid.kff, this.pidVY.pid.dt, POSITION_RATE, velFiltCutoff, velFiltEnable);
+      this.pidVY.pid.kff, DT, POSITION_RATE, velFiltCutoff, velFiltEnable);
   pidInit(&this.pidVZ.pid, this.pidVZ.setpoint, this.pidVZ.pid.kp, this.pidVZ.pid.ki, this.pidVZ.pid.kd,
-      this.pidVZ.pid.kff, this.pidVZ.pid.dt, POSITION_RATE, velZFiltCutoff, velZFiltEnable);
+      this.pidVZ.pid.kff, DT, POSITION_RATE, velZFiltCutoff, velZFiltEnable);
 }
 
 static float runPid(float input, struct pidAxis_s *axis, float setpoint, float dt) {
@@ -277,12 +282,26 @@ void positionControllerResetAllPID()
 }
 
 void positionControllerResetAllfilters() {
-  filterReset(&this.pidX.pid, POSITION_RATE, posFiltCutoff, posFiltEnable);
-  filterReset(&this.pidY.pid, POSITION_RATE, posFiltCutoff, posFiltEnable);
-  filterReset(&this.pidZ.pid, POSITION_RATE, posZFiltCutoff, posZFiltEnable);
-  filterReset(&this.pidVX.pid, POSITION_RATE, velFiltCutoff, velFiltEnable);
-  filterReset(&this.pidVY.pid, POSITION_RATE, velFiltCutoff, velFiltEnable);
-  filterReset(&this.pidVZ.pid, POSITION_RATE, velZFiltCutoff, velZFiltEnable);
+  filterReset(&this.pidX.pid, updateRate, posFiltCutoff, posFiltEnable);
+  filterReset(&this.pidY.pid, updateRate, posFiltCutoff, posFiltEnable);
+  filterReset(&this.pidZ.pid, updateRate, posZFiltCutoff, posZFiltEnable);
+  filterReset(&this.pidVX.pid, updateRate, velFiltCutoff, velFiltEnable);
+  filterReset(&this.pidVY.pid, updateRate, velFiltCutoff, velFiltEnable);
+  filterReset(&this.pidVZ.pid, updateRate, velZFiltCutoff, velZFiltEnable);
+}
+
+void positionControllerSetRate(const float rateHz) {
+  updateRate = rateHz;
+
+  const float dt = 1.0f / rateHz;
+  pidSetDt(&this.pidX.pid, dt);
+  pidSetDt(&this.pidY.pid, dt);
+  pidSetDt(&this.pidZ.pid, dt);
+  pidSetDt(&this.pidVX.pid, dt);
+  pidSetDt(&this.pidVY.pid, dt);
+  pidSetDt(&this.pidVZ.pid, dt);
+
+  positionControllerResetAllfilters();
 }
 
 /**
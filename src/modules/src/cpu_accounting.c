@@ -0,0 +1,311 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cpu_accounting.c - Per task and interrupt CPU time, measured with the cycle counter
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#include "cpu_accounting.h"
+#include "cycle_counter.h"
+#include "mem.h"
+#include "log.h"
+
+#define TIMER_PERIOD M2T(1000)
+
+// Must be a power of two, the tasks are stored in a hash table on the task handle
+#define MAX_TASKS 32
+#define TOP_COUNT 4
+
+// Load is reported in 0.1 %
+#define LOAD_SCALE 1000
+
+typedef struct {
+  const void* task;  // handle of the task, NULL for a free slot
+  uint32_t cycles;   // cycles in the task since the last update, not including marked interrupt handlers
+} taskCycles_t;
+
+// Updated by the kernel at context switches and read by the timer in a critical section
+static taskCycles_t tasks[MAX_TASKS];
+static taskCycles_t* currentSlot;
+static uint32_t switchedInAt;
+static uint32_t isrCyclesAtSwitchIn;
+static uint32_t isrCycles;
+static uint32_t isrStart;
+static uint8_t isrNesting;
+static uint32_t contextSwitches;
+
+static uint32_t lastUpdateAt;
+
+// The result of the latest period, laid out as in the memory
+typedef struct {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t cycles;
+  uint16_t load;
+} __attribute__((packed)) taskLoadEntry_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t count;
+  uint16_t isrLoad;
+  uint32_t totalCycles;
+  uint32_t isrCycles;
+  uint32_t contextSwitches;
+  taskLoadEntry_t entries[MAX_TASKS];
+} __attribute__((packed)) taskLoadTable_t;
+
+#define TABLE_VERSION 1
+#define TABLE_HEADER_SIZE (sizeof(taskLoadTable_t) - sizeof(((taskLoadTable_t*)0)->entries))
+
+static taskLoadTable_t table;
+// The copy of the table that is read through the memory, latched when a read starts at address 0 so that a read
+// that spans several packets is consistent
+static taskLoadTable_t readTable;
+
+// Log variables
+static uint16_t isrLoad;
+static uint16_t contextSwitchRate;
+static uint32_t topName[TOP_COUNT];
+static uint16_t topLoad[TOP_COUNT];
+
+static bool isInit = false;
+static StaticTimer_t timerBuffer;
+
+static uint32_t handleMemGetSize(void) {
+  return TABLE_HEADER_SIZE + table.count * sizeof(taskLoadEntry_t);
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr == 0) {
+    readTable = table;
+  }
+
+  const uint32_t size = TABLE_HEADER_SIZE + readTable.count * sizeof(taskLoadEntry_t);
+  if (memAddr + readLen > size) {
+    return false;
+  }
+
+  memcpy(buffer, ((const uint8_t*)&readTable) + memAddr, readLen);
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_TASK_LOAD,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+
+static taskCycles_t* findSlot(const void* task) {
+  uint32_t index = ((uint32_t)task >> 3) & (MAX_TASKS - 1);
+  for (int i = 0; i < MAX_TASKS; i++) {
+    taskCycles_t* slot = &tasks[index];
+    if (slot->task == task) {
+      return slot;
+    }
+    if (slot->task == 0) {
+      slot->task = task;
+      return slot;
+    }
+    index = (index + 1) & (MAX_TASKS - 1);
+  }
+
+  return 0;
+}
+
+// Charges the time since the latest switch to the current task. Must be called with interrupts masked.
+static void chargeCurrentTask(const uint32_t now) {
+  const uint32_t cycles = (now - switchedInAt) - (isrCycles - isrCyclesAtSwitchIn);
+  // Time in tasks that do not fit in the table is not counted
+  if (currentSlot) {
+    currentSlot->cycles += cycles;
+  }
+  switchedInAt = now;
+  isrCyclesAtSwitchIn = isrCycles;
+}
+
+void cpuAccountingTaskSwitchedIn(const void* task) {
+  if (!isInit) {
+    return;
+  }
+
+  chargeCurrentTask(cycleCounterGet());
+  currentSlot = findSlot(task);
+  contextSwitches++;
+}
+
+void cpuAccountingIsrEnter(void) {
+  const UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+  if (isrNesting == 0) {
+    isrStart = cycleCounterGet();
+  }
+  isrNesting++;
+  taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+}
+
+void cpuAccountingIsrExit(void) {
+  const UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+  isrNesting--;
+  if (isrNesting == 0) {
+    isrCycles += cycleCounterElapsed(isrStart);
+  }
+  taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+}
+
+static uint16_t toLoad(const uint32_t cycles, const uint32_t total) {
+  return total ? ((uint64_t)cycles * LOAD_SCALE) / total : 0;
+}
+
+static void insertInTop(const char* name, const uint16_t load) {
+  for (int i = 0; i < TOP_COUNT; i++) {
+    if (load > topLoad[i]) {
+      for (int j = TOP_COUNT - 1; j > i; j--) {
+        topLoad[j] = topLoad[j - 1];
+        topName[j] = topName[j - 1];
+      }
+      topLoad[i] = load;
+      // The first four characters of the name, as in the ITM trace
+      topName[i] = 0;
+      memcpy(&topName[i], name, strnlen(name, sizeof(topName[i])));
+      return;
+    }
+  }
+}
+
+static void timerHandler(xTimerHandle timer) {
+  static taskCycles_t snapshot[MAX_TASKS];
+  uint32_t periodIsrCycles;
+  uint32_t periodContextSwitches;
+
+  taskENTER_CRITICAL();
+  const uint32_t now = cycleCounterGet();
+  chargeCurrentTask(now);
+  memcpy(snapshot, tasks, sizeof(snapshot));
+  for (int i = 0; i < MAX_TASKS; i++) {
+    tasks[i].cycles = 0;
+  }
+  periodIsrCycles = isrCycles;
+  isrCycles = 0;
+  isrCyclesAtSwitchIn = 0;
+  periodContextSwitches = contextSwitches;
+  contextSwitches = 0;
+  taskEXIT_CRITICAL();
+
+  const uint32_t total = now - lastUpdateAt;
+  lastUpdateAt = now;
+
+  table.version = TABLE_VERSION;
+  table.count = 0;
+  table.totalCycles = total;
+  table.isrCycles = periodIsrCycles;
+  table.isrLoad = toLoad(periodIsrCycles, total);
+  table.contextSwitches = periodContextSwitches;
+
+  memset(topName, 0, sizeof(topName));
+  memset(topLoad, 0, sizeof(topLoad));
+
+  for (int i = 0; i < MAX_TASKS; i++) {
+    if (snapshot[i].task == 0) {
+      continue;
+    }
+
+    taskLoadEntry_t* entry = &table.entries[table.count];
+    memset(entry->name, 0, sizeof(entry->name));
+    strncpy(entry->name, pcTaskGetName((TaskHandle_t)snapshot[i].task), sizeof(entry->name) - 1);
+    entry->cycles = snapshot[i].cycles;
+    entry->load = toLoad(snapshot[i].cycles, total);
+    table.count++;
+
+    insertInTop(entry->name, entry->load);
+  }
+
+  isrLoad = table.isrLoad;
+  contextSwitchRate = periodContextSwitches * configTICK_RATE_HZ / TIMER_PERIOD;
+}
+
+void cpuAccountingInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  cycleCounterInit();
+  memoryRegisterHandler(&memDef);
+
+  lastUpdateAt = cycleCounterGet();
+  switchedInAt = lastUpdateAt;
+  isInit = true;
+
+  xTimerHandle timer = xTimerCreateStatic("cpuAccountingTimer", TIMER_PERIOD, pdTRUE, NULL, timerHandler, &timerBuffer);
+  xTimerStart(timer, 100);
+}
+
+/**
+ * CPU time per task and in interrupt handlers, measured with the cycle counter at every context switch. Updated once
+ * per second. The full table of tasks is available through the MEM_TYPE_TASK_LOAD memory.
+ */
+LOG_GROUP_START(cpuLoad)
+/**
+ * @brief Time spent in marked interrupt handlers [0.1 %]
+ */
+LOG_ADD(LOG_UINT16, isr, &isrLoad)
+/**
+ * @brief Context switches per second
+ */
+LOG_ADD(LOG_UINT16, ctxSwitch, &contextSwitchRate)
+/**
+ * @brief The first four characters of the name of the task with the highest load
+ */
+LOG_ADD(LOG_UINT32, top1Name, &topName[0])
+/**
+ * @brief Load of the task with the highest load [0.1 %]
+ */
+LOG_ADD(LOG_UINT16, top1, &topLoad[0])
+/**
+ * @brief The first four characters of the name of the task with the second highest load
+ */
+LOG_ADD(LOG_UINT32, top2Name, &topName[1])
+/**
+ * @brief Load of the task with the second highest load [0.1 %]
+ */
+LOG_ADD(LOG_UINT16, top2, &topLoad[1])
+/**
+ * @brief The first four characters of the name of the task with the third highest load
+ */
+LOG_ADD(LOG_UINT32, top3Name, &topName[2])
+/**
+ * @brief Load of the task with the third highest load [0.1 %]
+ */
+LOG_ADD(LOG_UINT16, top3, &topLoad[2])
+/**
+ * @brief The first four characters of the name of the task with the fourth highest load
+ */
+LOG_ADD(LOG_UINT32, top4Name, &topName[3])
+/**
+ * @brief Load of the task with the fourth highest load [0.1 %]
+ */
+LOG_ADD(LOG_UINT16, top4, &topLoad[3])
+LOG_GROUP_STOP(cpuLoad)
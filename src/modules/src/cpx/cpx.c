@@ -44,8 +44,7 @@
 #include "aideck.h"
 #endif
 #include "cpx.h"
-
-static CPXPacket_t cpxRx;
+#include "cpx_inference.h"
 
 static volatile cpxAppMessageHandlerCallback_t appMessageHandlerCallback;
 
@@ -95,21 +94,21 @@ void cpxRegisterAppMessageHandler(cpxAppMessageHandlerCallback_t callback) {
 static void cpx(void* _param) {
   systemWaitStart();
   while (1) {
-    cpxInternalRouterReceiveOthers(&cpxRx);
+    CPXPacket_t* cpxRx = cpxInternalRouterReceiveOthersNoCopy();
 
-    //DEBUG_PRINT("CPX RX: Message from [0x%02X] to function [0x%02X] (size=%u)\n", cpxRx.route.source, cpxRx.route.function, cpxRx.dataLength);
+    //DEBUG_PRINT("CPX RX: Message from [0x%02X] to function [0x%02X] (size=%u)\n", cpxRx->route.source, cpxRx->route.function, cpxRx->dataLength);
 
-    switch (cpxRx.route.function) {
+    switch (cpxRx->route.function) {
       case CPX_F_WIFI_CTRL:
-        if (cpxRx.data[0] == WIFI_AP_CONNECTED_CMD) {
+        if (cpxRx->data[0] == WIFI_AP_CONNECTED_CMD) {
             DEBUG_PRINT("WiFi connected to ip: %u.%u.%u.%u\n",
-                        cpxRx.data[1],
-                        cpxRx.data[2],
-                        cpxRx.data[3],
-                        cpxRx.data[4]);
+                        cpxRx->data[1],
+                        cpxRx->data[2],
+                        cpxRx->data[3],
+                        cpxRx->data[4]);
         }
-        if (cpxRx.data[0] == WIFI_CLIENT_CONNECTED_CMD) {
-          if (cpxRx.data[1] == 0x00) {
+        if (cpxRx->data[0] == WIFI_CLIENT_CONNECTED_CMD) {
+          if (cpxRx->data[1] == 0x00) {
             cpxLinkSetConnected(false);
             DEBUG_PRINT("CPX disconnected\n");
           } else {
@@ -119,22 +118,22 @@ static void cpx(void* _param) {
         }
         break;
       case CPX_F_CONSOLE:
-        if (cpxRx.route.source == CPX_T_ESP32) {
-          DEBUG_PRINT("ESP32: %s", cpxRx.data);
-        } else if (cpxRx.route.source == CPX_T_GAP8) {
-          DEBUG_PRINT("GAP8: %s", cpxRx.data);
+        if (cpxRx->route.source == CPX_T_ESP32) {
+          DEBUG_PRINT("ESP32: %s", cpxRx->data);
+        } else if (cpxRx->route.source == CPX_T_GAP8) {
+          DEBUG_PRINT("GAP8: %s", cpxRx->data);
         } else {
-          DEBUG_PRINT("UNKNOWN: %s", cpxRx.data);
+          DEBUG_PRINT("UNKNOWN: %s", cpxRx->data);
         }
         break;
       case CPX_F_BOOTLOADER:
 #ifdef CONFIG_DECK_AI
-        cpxBootloaderMessage(&cpxRx);
+        cpxBootloaderMessage(cpxRx);
 #endif
         break;
       case CPX_F_SYSTEM:
-        if (cpxRx.data[0] == CPX_ENABLE_CRTP_BRIDGE) {
-          if (cpxRx.data[1] == 0x00) {
+        if (cpxRx->data[0] == CPX_ENABLE_CRTP_BRIDGE) {
+          if (cpxRx->data[1] == 0x00) {
             crtpSetLink(radiolinkGetLink());
             DEBUG_PRINT("Disable CPX <> CRTP bridge\n");
           } else {
@@ -143,8 +142,8 @@ static void cpx(void* _param) {
           }
         }
 
-        if (cpxRx.data[0] == CPX_SET_CLIENT_CONNECTED) {
-          if (cpxRx.data[1] == 0x00) {
+        if (cpxRx->data[0] == CPX_SET_CLIENT_CONNECTED) {
+          if (cpxRx->data[1] == 0x00) {
             cpxLinkSetConnected(false);
           } else {
             cpxLinkSetConnected(true);
@@ -153,12 +152,17 @@ static void cpx(void* _param) {
         break;
       case CPX_F_APP:
         if (appMessageHandlerCallback) {
-          appMessageHandlerCallback(&cpxRx);
+          appMessageHandlerCallback(cpxRx);
         }
         break;
+      case CPX_F_INFERENCE:
+        cpxInferenceHandlePacket(cpxRx);
+        break;
       default:
-        DEBUG_PRINT("Not handling function [0x%02X] from [0x%02X]\n", cpxRx.route.function, cpxRx.route.source);
+        DEBUG_PRINT("Not handling function [0x%02X] from [0x%02X]\n", cpxRx->route.function, cpxRx->route.source);
     }
+
+    cpxInternalRouterRelease(cpxRx);
   }
 }
 
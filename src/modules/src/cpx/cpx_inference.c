@@ -0,0 +1,337 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cpx_inference.c - Typed CPX function for inference results from the AI-deck
+ *
+ * The results are decoded and timestamped in the CPX task, and are then
+ * available without any parsing in the apps. A relative pose of a marker
+ * with a known pose can be fed to the estimator as a pose measurement, and
+ * a relative pose of a target can be followed with body frame velocity
+ * setpoints. Only the latest observation of each type is kept, so old
+ * results are never queued up behind new ones.
+ */
+
+#define DEBUG_MODULE "CPXINF"
+
+#include <string.h>
+#include <math.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "static_mem.h"
+
+#include "debug.h"
+#include "param.h"
+#include "log.h"
+#include "statsCnt.h"
+#include "usec_time.h"
+#include "math3d.h"
+#include "estimator.h"
+#include "commander.h"
+
+#include "cpx_inference.h"
+
+#define CPX_INFERENCE_MODE_ESTIMATOR (1 << 0)
+#define CPX_INFERENCE_MODE_FOLLOW    (1 << 1)
+
+#define INT16_SCALE (1.0f / 32767.0f)
+
+static xQueueHandle latestQueue[CPX_INFERENCE_TYPE_COUNT];
+STATIC_MEM_QUEUE_ALLOC(latestDetection, 1, sizeof(cpxInferenceObservation_t));
+STATIC_MEM_QUEUE_ALLOC(latestRelativePose, 1, sizeof(cpxInferenceObservation_t));
+
+// Parameters
+static uint8_t mode = 0;
+static uint16_t maxAgeMs = 200;
+
+static uint8_t markerId = 0;
+static point_t markerPosition;
+static float markerYawDeg = 0.0f;
+
+static uint8_t followId = 0;
+static float followDistance = 1.0f;
+static float followGain = 1.0f;
+static float followMaxVelocity = 0.5f;
+static float followYawGain = 60.0f;
+
+// Logging
+static statsCntMinMaxAvg_t latencyStats;
+static STATS_CNT_RATE_DEFINE(resultRate, 1000);
+static uint32_t droppedCount;
+static uint8_t logType;
+static uint8_t logId;
+static float logX;
+static float logY;
+
+static setpoint_t followSetpoint;
+
+static bool isInit = false;
+
+static void init() {
+  latestQueue[CPX_INFERENCE_DETECTION] = STATIC_MEM_QUEUE_CREATE(latestDetection);
+  latestQueue[CPX_INFERENCE_RELATIVE_POSE] = STATIC_MEM_QUEUE_CREATE(latestRelativePose);
+  statsCntMinMaxAvgInit(&latencyStats, 1000);
+  isInit = true;
+}
+
+bool cpxInferenceDecode(const CPXPacket_t* packet, const uint32_t nowUs, cpxInferenceObservation_t* observation) {
+  cpxInferenceHeader_t header;
+  if (packet->dataLength < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, packet->data, sizeof(header));
+  const uint8_t* payload = &packet->data[sizeof(header)];
+  const uint32_t payloadLength = packet->dataLength - sizeof(header);
+
+  observation->type = header.type;
+  observation->id = header.id;
+  observation->latencyMs = header.latencyMs;
+  observation->eventTimeUs = nowUs - (uint32_t)header.latencyMs * 1000;
+
+  switch (header.type) {
+    case CPX_INFERENCE_DETECTION:
+    {
+      cpxInferenceDetectionPayload_t detection;
+      if (payloadLength != sizeof(detection)) {
+        return false;
+      }
+      memcpy(&detection, payload, sizeof(detection));
+      observation->detection.x = detection.x * INT16_SCALE;
+      observation->detection.y = detection.y * INT16_SCALE;
+      observation->detection.width = detection.width * INT16_SCALE;
+      observation->detection.height = detection.height * INT16_SCALE;
+      observation->detection.confidence = detection.confidence / 255.0f;
+      return true;
+    }
+    case CPX_INFERENCE_RELATIVE_POSE:
+    {
+      cpxInferenceRelativePosePayload_t relativePose;
+      if (payloadLength != sizeof(relativePose)) {
+        return false;
+      }
+      memcpy(&relativePose, payload, sizeof(relativePose));
+      observation->relativePose.position.x = relativePose.x;
+      observation->relativePose.position.y = relativePose.y;
+      observation->relativePose.position.z = relativePose.z;
+      observation->relativePose.quat.x = relativePose.qx;
+      observation->relativePose.quat.y = relativePose.qy;
+      observation->relativePose.quat.z = relativePose.qz;
+      observation->relativePose.quat.w = relativePose.qw;
+      observation->relativePose.stdDevPos = relativePose.stdDevPos;
+      observation->relativePose.stdDevQuat = relativePose.stdDevQuat;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void cpxInferenceMarkerToPose(const cpxInferenceObservation_t* observation, const point_t* markerPosition, const float markerYaw, poseMeasurement_t* pose) {
+  const point_t* relativePosition = &observation->relativePose.position;
+  const quaternion_t* relativeQuat = &observation->relativePose.quat;
+
+  // world <- marker, and body <- marker from the observation, gives world <- body = (world <- marker) * (marker <- body)
+  const struct quat qWorldMarker = rpy2quat(mkvec(0.0f, 0.0f, markerYaw));
+  const struct quat qBodyMarker = qnormalize(mkquat(relativeQuat->x, relativeQuat->y, relativeQuat->z, relativeQuat->w));
+  const struct quat qWorldBody = qnormalize(qqmul(qWorldMarker, qinv(qBodyMarker)));
+
+  const struct vec markerInWorld = mkvec(markerPosition->x, markerPosition->y, markerPosition->z);
+  const struct vec markerInBody = mkvec(relativePosition->x, relativePosition->y, relativePosition->z);
+  const struct vec bodyInWorld = vsub(markerInWorld, qvrot(qWorldBody, markerInBody));
+
+  pose->x = bodyInWorld.x;
+  pose->y = bodyInWorld.y;
+  pose->z = bodyInWorld.z;
+  pose->quat.x = qWorldBody.x;
+  pose->quat.y = qWorldBody.y;
+  pose->quat.z = qWorldBody.z;
+  pose->quat.w = qWorldBody.w;
+  pose->stdDevPos = observation->relativePose.stdDevPos;
+  pose->stdDevQuat = observation->relativePose.stdDevQuat;
+  pose->eventTimeUs = observation->eventTimeUs;
+}
+
+// Body frame velocity setpoint that keeps the target at the follow distance in front of the Crazyflie
+static void follow(const cpxInferenceObservation_t* observation) {
+  const point_t* target = &observation->relativePose.position;
+  const float bearing = atan2f(target->y, target->x);
+
+  memset(&followSetpoint, 0, sizeof(followSetpoint));
+  followSetpoint.mode.x = modeVelocity;
+  followSetpoint.mode.y = modeVelocity;
+  followSetpoint.mode.z = modeVelocity;
+  followSetpoint.mode.yaw = modeVelocity;
+  followSetpoint.velocity_body = true;
+
+  const float distanceError = sqrtf(target->x * target->x + target->y * target->y) - followDistance;
+  followSetpoint.velocity.x = clamp(followGain * distanceError * cosf(bearing), -followMaxVelocity, followMaxVelocity);
+  followSetpoint.velocity.y = clamp(followGain * distanceError * sinf(bearing), -followMaxVelocity, followMaxVelocity);
+  followSetpoint.velocity.z = clamp(followGain * target->z, -followMaxVelocity, followMaxVelocity);
+  followSetpoint.attitudeRate.yaw = followYawGain * degrees(bearing);
+
+  // A low priority, any other setpoint source takes over
+  commanderSetSetpoint(&followSetpoint, COMMANDER_PRIORITY_HIGHLEVEL);
+}
+
+void cpxInferenceHandlePacket(const CPXPacket_t* packet) {
+  if (!isInit) {
+    init();
+  }
+
+  const uint32_t nowUs = (uint32_t)usecTimestamp();
+  cpxInferenceObservation_t observation;
+  if (!cpxInferenceDecode(packet, nowUs, &observation)) {
+    droppedCount++;
+    return;
+  }
+
+  STATS_CNT_RATE_EVENT(&resultRate);
+  statsCntMinMaxAvgAdd(&latencyStats, observation.latencyMs);
+  statsCntMinMaxAvgUpdate(&latencyStats, nowUs / 1000);
+
+  // Too old results are worse than none for control
+  if (observation.latencyMs > maxAgeMs) {
+    droppedCount++;
+    return;
+  }
+
+  xQueueOverwrite(latestQueue[observation.type], &observation);
+
+  logType = observation.type;
+  logId = observation.id;
+  if (observation.type == CPX_INFERENCE_DETECTION) {
+    logX = observation.detection.x;
+    logY = observation.detection.y;
+  } else {
+    logX = observation.relativePose.position.x;
+    logY = observation.relativePose.position.y;
+  }
+
+  if (observation.type == CPX_INFERENCE_RELATIVE_POSE) {
+    if ((mode & CPX_INFERENCE_MODE_ESTIMATOR) && observation.id == markerId) {
+      poseMeasurement_t pose;
+      cpxInferenceMarkerToPose(&observation, &markerPosition, radians(markerYawDeg), &pose);
+      estimatorEnqueuePose(&pose);
+    }
+
+    if ((mode & CPX_INFERENCE_MODE_FOLLOW) && observation.id == followId) {
+      follow(&observation);
+    }
+  }
+}
+
+bool cpxInferenceGetLatest(const cpxInferenceType_t type, cpxInferenceObservation_t* observation) {
+  if (!isInit || type >= CPX_INFERENCE_TYPE_COUNT) {
+    return false;
+  }
+
+  return xQueuePeek(latestQueue[type], observation, 0) == pdTRUE;
+}
+
+/**
+ * Inference results from the AI-deck
+ */
+PARAM_GROUP_START(cpxInf)
+/**
+ * @brief Use of the results, bit 0: marker pose to the estimator, bit 1: follow the target (default 0)
+ */
+PARAM_ADD(PARAM_UINT8, mode, &mode)
+/**
+ * @brief Results with a larger latency are dropped [ms] (default 200)
+ */
+PARAM_ADD(PARAM_UINT16, maxAge, &maxAgeMs)
+/**
+ * @brief Id of the marker with a known pose, that is used by the estimator
+ */
+PARAM_ADD(PARAM_UINT8, mkId, &markerId)
+/**
+ * @brief X position of the marker [m]
+ */
+PARAM_ADD(PARAM_FLOAT, mkX, &markerPosition.x)
+/**
+ * @brief Y position of the marker [m]
+ */
+PARAM_ADD(PARAM_FLOAT, mkY, &markerPosition.y)
+/**
+ * @brief Z position of the marker [m]
+ */
+PARAM_ADD(PARAM_FLOAT, mkZ, &markerPosition.z)
+/**
+ * @brief Yaw of the marker [deg], the marker is level
+ */
+PARAM_ADD(PARAM_FLOAT, mkYaw, &markerYawDeg)
+/**
+ * @brief Id of the target to follow
+ */
+PARAM_ADD(PARAM_UINT8, flwId, &followId)
+/**
+ * @brief Distance to keep to the followed target [m] (default 1.0)
+ */
+PARAM_ADD(PARAM_FLOAT, flwDist, &followDistance)
+/**
+ * @brief Velocity per m of distance error [1/s] (default 1.0)
+ */
+PARAM_ADD(PARAM_FLOAT, flwGain, &followGain)
+/**
+ * @brief Max velocity when following [m/s] (default 0.5)
+ */
+PARAM_ADD(PARAM_FLOAT, flwMaxVel, &followMaxVelocity)
+/**
+ * @brief Yaw rate per bearing to the target [1/s] (default 60 deg/s per rad, as deg/s per deg)
+ */
+PARAM_ADD(PARAM_FLOAT, flwYawGain, &followYawGain)
+PARAM_GROUP_STOP(cpxInf)
+
+/**
+ * Inference results from the AI-deck
+ */
+LOG_GROUP_START(cpxInf)
+/**
+ * @brief Latency from image capture to result, as reported by the sender [ms]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(latency, &latencyStats)
+/**
+ * @brief Received results per second
+ */
+STATS_CNT_RATE_LOG_ADD(rate, &resultRate)
+/**
+ * @brief Number of results dropped because they could not be decoded or were too old
+ */
+LOG_ADD(LOG_UINT32, dropped, &droppedCount)
+/**
+ * @brief Type of the latest result
+ */
+LOG_ADD(LOG_UINT8, type, &logType)
+/**
+ * @brief Id of the latest result
+ */
+LOG_ADD(LOG_UINT8, id, &logId)
+/**
+ * @brief X of the latest result, image x of a detection or body x of a relative pose [m]
+ */
+LOG_ADD(LOG_FLOAT, x, &logX)
+/**
+ * @brief Y of the latest result, image y of a detection or body y of a relative pose [m]
+ */
+LOG_ADD(LOG_FLOAT, y, &logY)
+LOG_GROUP_STOP(cpxInf)
@@ -26,39 +26,153 @@
 
 #define DEBUG_MODULE "CPX-INT-ROUTER"
 
+#include <string.h>
+
 #include "FreeRTOS.h"
 #include "config.h"
 #include "debug.h"
 #include "queue.h"
+#include "log.h"
 
 #include "crtp.h"
 #include "cpx_internal_router.h"
 #include "cpx.h"
 
-#define QUEUE_LENGTH (2)
+/*
+ * Packets are stored in a shared pool and only pool indexes are passed
+ * through the route queues. The length of a route queue is the credit of the
+ * destination: the number of packets it may have waiting. A producer that
+ * finds no credit left waits for the destination to consume a packet,
+ * packets routed in from the UART are dropped after ROUTE_IN_TIMEOUT though,
+ * so that one lagging consumer does not stall the routes to the others.
+ *
+ * The pool holds enough packets for all credits, one packet being processed
+ * per consumer and a few producers filling in packets.
+ */
+#define ROUTE_CREDITS (2)
+#define POOL_PRODUCERS (2)
+#define POOL_SIZE (ROUTE_COUNT * (ROUTE_CREDITS + 1) + POOL_PRODUCERS)
+#define ROUTE_IN_TIMEOUT M2T(10)
+
+typedef enum {
+  ROUTE_CRTP = 0,
+  ROUTE_OTHERS,
+  ROUTE_TX,
+  ROUTE_COUNT,
+} route_t;
+
+typedef struct {
+  xQueueHandle queue;
+  // Wait for credit when routing in from the UART
+  TickType_t routeInTimeout;
+  uint32_t drops;
+  uint8_t depth;
+  uint8_t peakDepth;
+} routeState_t;
+
+static CPXPacket_t pool[POOL_SIZE];
+static xQueueHandle poolFree;
+static uint8_t poolMinFree;
+
+static routeState_t routes[ROUTE_COUNT];
+
+static CPXPacket_t* poolAlloc(TickType_t wait) {
+  uint8_t index;
+  if (xQueueReceive(poolFree, &index, wait) != pdTRUE) {
+    return NULL;
+  }
+
+  const uint8_t free = uxQueueMessagesWaiting(poolFree);
+  if (free < poolMinFree) {
+    poolMinFree = free;
+  }
+
+  return &pool[index];
+}
+
+void cpxInternalRouterRelease(CPXPacket_t* packet) {
+  const uint8_t index = packet - pool;
+  xQueueSend(poolFree, &index, 0);
+}
 
-static xQueueHandle crtpQueue;
-static xQueueHandle mixedQueue;
+static bool routeSend(route_t route, CPXPacket_t* packet, TickType_t wait) {
+  routeState_t* state = &routes[route];
+  const uint8_t index = packet - pool;
 
-static xQueueHandle txq;
+  if (xQueueSend(state->queue, &index, wait) != pdTRUE) {
+    state->drops++;
+    cpxInternalRouterRelease(packet);
+    return false;
+  }
+
+  const uint8_t depth = uxQueueMessagesWaiting(state->queue);
+  state->depth = depth;
+  if (depth > state->peakDepth) {
+    state->peakDepth = depth;
+  }
+
+  return true;
+}
+
+static CPXPacket_t* routeReceive(route_t route, TickType_t wait) {
+  routeState_t* state = &routes[route];
+  uint8_t index;
+
+  if (xQueueReceive(state->queue, &index, wait) != pdTRUE) {
+    return NULL;
+  }
+
+  state->depth = uxQueueMessagesWaiting(state->queue);
+  return &pool[index];
+}
+
+static void copyPacket(CPXPacket_t* dst, const CPXPacket_t* src) {
+  dst->route = src->route;
+  dst->dataLength = src->dataLength;
+  memcpy(dst->data, src->data, src->dataLength);
+}
+
+static bool sendToEsp(const CPXPacket_t * packet, TickType_t wait) {
+  CPXPacket_t* poolPacket = poolAlloc(wait);
+  if (!poolPacket) {
+    routes[ROUTE_TX].drops++;
+    return false;
+  }
+
+  copyPacket(poolPacket, packet);
+  return routeSend(ROUTE_TX, poolPacket, wait);
+}
 
 int cpxInternalRouterReceiveCRTP(CPXPacket_t * packet) {
-  return xQueueReceive(crtpQueue, packet, M2T(100));
+  CPXPacket_t* poolPacket = routeReceive(ROUTE_CRTP, M2T(100));
+  if (!poolPacket) {
+    return pdFALSE;
+  }
+
+  copyPacket(packet, poolPacket);
+  cpxInternalRouterRelease(poolPacket);
+  return pdTRUE;
 }
 
 void cpxInternalRouterReceiveOthers(CPXPacket_t * packet) {
-  xQueueReceive(mixedQueue, packet, (TickType_t)portMAX_DELAY);
+  CPXPacket_t* poolPacket = cpxInternalRouterReceiveOthersNoCopy();
+  copyPacket(packet, poolPacket);
+  cpxInternalRouterRelease(poolPacket);
+}
+
+CPXPacket_t* cpxInternalRouterReceiveOthersNoCopy(void) {
+  return routeReceive(ROUTE_OTHERS, (TickType_t)portMAX_DELAY);
 }
 
 void cpxSendPacketBlocking(const CPXPacket_t * packet) {
   if (cpxCheckVersion(packet->route.version)) {
-    xQueueSend(txq, packet, portMAX_DELAY);
+    sendToEsp(packet, portMAX_DELAY);
   }
 }
 
 bool cpxSendPacketBlockingTimeout(const CPXPacket_t * packet, const uint32_t timeout) {
   if (cpxCheckVersion(packet->route.version)) {
-    return xQueueSend(txq, packet, timeout) == pdTRUE;
+    return sendToEsp(packet, timeout);
   } else {
     return pdTRUE;
   }
@@ -72,31 +186,96 @@ void cpxInternalRouterRouteIn(const CPXRoutablePacket_t* packet) {
   // this should never fail, as it should be checked when the packet is received
   // however, double checking doesn't harm
   if (cpxCheckVersion(packet->route.version)) {
+    route_t route;
     switch (packet->route.function) {
       case CPX_F_SYSTEM:
       case CPX_F_CONSOLE:
       case CPX_F_WIFI_CTRL:
       case CPX_F_BOOTLOADER:
       case CPX_F_APP:
+      case CPX_F_INFERENCE:
       case CPX_F_TEST:
-        xQueueSend(mixedQueue, packet, portMAX_DELAY);
+        route = ROUTE_OTHERS;
         break;
       case CPX_F_CRTP:
-        xQueueSend(crtpQueue, packet, portMAX_DELAY);
+        route = ROUTE_CRTP;
         break;
       default:
         DEBUG_PRINT("Message on function which is not handled (0x%X)\n", packet->route.function);
+        return;
+    }
+
+    CPXPacket_t* poolPacket = poolAlloc(routes[route].routeInTimeout);
+    if (!poolPacket) {
+      routes[route].drops++;
+      return;
     }
+
+    poolPacket->route = packet->route;
+    poolPacket->dataLength = packet->dataLength;
+    memcpy(poolPacket->data, packet->data, packet->dataLength);
+    routeSend(route, poolPacket, routes[route].routeInTimeout);
   }
 }
 
 // Route from STM to external targets
 void cpxInternalRouterRouteOut(CPXRoutablePacket_t* packet) {
-  xQueueReceive(txq, packet, (TickType_t)portMAX_DELAY);
+  CPXPacket_t* poolPacket = routeReceive(ROUTE_TX, (TickType_t)portMAX_DELAY);
+
+  packet->route = poolPacket->route;
+  packet->dataLength = poolPacket->dataLength;
+  memcpy(packet->data, poolPacket->data, poolPacket->dataLength);
+  cpxInternalRouterRelease(poolPacket);
 }
 
 void cpxInternalRouterInit(void) {
-  txq = xQueueCreate(QUEUE_LENGTH, sizeof(CPXPacket_t));
-  crtpQueue = xQueueCreate(QUEUE_LENGTH, sizeof(CPXPacket_t));;
-  mixedQueue = xQueueCreate(QUEUE_LENGTH, sizeof(CPXPacket_t));;
+  poolFree = xQueueCreate(POOL_SIZE, sizeof(uint8_t));
+  for (uint8_t i = 0; i < POOL_SIZE; i++) {
+    xQueueSend(poolFree, &i, 0);
+  }
+  poolMinFree = POOL_SIZE;
+
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    routes[i].queue = xQueueCreate(ROUTE_CREDITS, sizeof(uint8_t));
+  }
+
+  // CRTP packets are not dropped, the CRTP RX task is never blocked for long
+  routes[ROUTE_CRTP].routeInTimeout = portMAX_DELAY;
+  routes[ROUTE_OTHERS].routeInTimeout = ROUTE_IN_TIMEOUT;
+  routes[ROUTE_TX].routeInTimeout = portMAX_DELAY;
 }
+
+/**
+ * CPX internal routing, packets to the CRTP bridge (crtp), to the other
+ * STM32 functions (others) and to the ESP32 (tx)
+ */
+LOG_GROUP_START(cpxRoute)
+/**
+ * @brief Packets dropped on the route to the CRTP bridge
+ */
+LOG_ADD(LOG_UINT32, crtpDrop, &routes[ROUTE_CRTP].drops)
+/**
+ * @brief Packets waiting on the route to the CRTP bridge
+ */
+LOG_ADD(LOG_UINT8, crtpDepth, &routes[ROUTE_CRTP].depth)
+/**
+ * @brief Packets dropped on the route to the other STM32 functions, because the consumer lagged
+ */
+LOG_ADD(LOG_UINT32, othersDrop, &routes[ROUTE_OTHERS].drops)
+/**
+ * @brief Packets waiting on the route to the other STM32 functions
+ */
+LOG_ADD(LOG_UINT8, othersDepth, &routes[ROUTE_OTHERS].depth)
+/**
+ * @brief Packets dropped on the route to the ESP32, when sent with a timeout
+ */
+LOG_ADD(LOG_UINT32, txDrop, &routes[ROUTE_TX].drops)
+/**
+ * @brief Packets waiting on the route to the ESP32
+ */
+LOG_ADD(LOG_UINT8, txDepth, &routes[ROUTE_TX].depth)
+/**
+ * @brief Lowest number of free packets in the CPX packet pool since boot
+ */
+LOG_ADD(LOG_UINT8, poolMinFree, &poolMinFree)
+LOG_GROUP_STOP(cpxRoute)
@@ -108,6 +108,9 @@ static bool shutdownTransport = false;
 
 static bool isInit = false;
 
+static uint32_t rxFrames;
+static uint32_t txFrames;
+
 static uint8_t calcCrc(const uart_transport_packet_t* packet) {
   const uint8_t* start = (const uint8_t*) packet;
   const uint8_t* end = &packet->payload[packet->payloadLength];
@@ -157,11 +160,12 @@ static void CPX_UART_RX(void *param)
       }
       else
       {
-        uart2GetData(uartRxp.payloadLength, (uint8_t*) &uartRxp.payload);
+        // Payload and CRC in one go, the CRC follows directly after the payload
+        uart2GetData((size_t) uartRxp.payloadLength + UART_CRC_LENGTH, (uint8_t*) &uartRxp.payload);
 
-        uint8_t crc;
-        uart2GetData(1, &crc);
+        const uint8_t crc = uartRxp.payload[uartRxp.payloadLength];
         ASSERT(crc == calcCrc(&uartRxp));
+        rxFrames++;
         if (cpxCheckVersion(uartRxp.routablePayload.route.version)) {
           xQueueSend(uartRxQueue, &uartRxp, portMAX_DELAY);
         }
@@ -190,7 +194,7 @@ static void CPX_UART_TX(void *param)
   // Sync with ESP32 so both are in CTS
   do
   {
-    uart2SendData(sizeof(ctr), (uint8_t *)&ctr);
+    uart2SendDataDma(sizeof(ctr), ctr);
     vTaskDelay(100);
     evBits = xEventGroupGetBits(evGroup);
   } while ((evBits & ESP_CTS_EVENT) != ESP_CTS_EVENT && shutdownTransport == false);
@@ -208,7 +212,7 @@ static void CPX_UART_TX(void *param)
                                    portMAX_DELAY);
       if ((evBits & ESP_CTR_EVENT) == ESP_CTR_EVENT)
       {
-        uart2SendData(sizeof(ctr), (uint8_t *)&ctr);
+        uart2SendDataDma(sizeof(ctr), ctr);
       }
     }
 
@@ -227,10 +231,13 @@ static void CPX_UART_TX(void *param)
                                      portMAX_DELAY);
         if ((evBits & ESP_CTR_EVENT) == ESP_CTR_EVENT)
         {
-          uart2SendData(sizeof(ctr), (uint8_t *)&ctr);
+          uart2SendDataDma(sizeof(ctr), ctr);
         }
       } while ((evBits & ESP_CTS_EVENT) != ESP_CTS_EVENT);
-      uart2SendData((uint32_t) uartTxp.payloadLength + UART_META_LENGTH, (uint8_t *)&uartTxp);
+      // Returns as soon as the frame is copied to a DMA buffer, the next
+      // frame is assembled while this one is on the wire
+      uart2SendDataDma((uint32_t) uartTxp.payloadLength + UART_META_LENGTH, (uint8_t *)&uartTxp);
+      txFrames++;
     }
   }
 
@@ -296,3 +303,18 @@ void cpxUARTTransportDeinit() {
                       pdTRUE, // Wait for all bits
                       portMAX_DELAY);
 }
+
+/**
+ * CPX UART transport statistics, wrap around counters. Use together with
+ * the uart2 log group for byte counts.
+ */
+LOG_GROUP_START(cpxUart)
+/**
+ * @brief Number of CPX frames received from the ESP32
+ */
+LOG_ADD(LOG_UINT32, rxFrames, &rxFrames)
+/**
+ * @brief Number of CPX frames sent to the ESP32
+ */
+LOG_ADD(LOG_UINT32, txFrames, &txFrames)
+LOG_GROUP_STOP(cpxUart)
@@ -25,6 +25,7 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 #include <errno.h>
 
 /*FreeRtos includes*/
@@ -39,7 +40,9 @@
 #include "info.h"
 #include "cfassert.h"
 #include "queuemonitor.h"
+#include "queuestats.h"
 #include "static_mem.h"
+#include "usec_time.h"
 
 #include "log.h"
 
@@ -67,12 +70,88 @@ static struct {
   uint32_t previousStatisticsTime;
 } stats;
 
-static xQueueHandle  txQueue;
-
 #define CRTP_NBR_OF_PORTS 16
-#define CRTP_TX_QUEUE_SIZE 200
 #define CRTP_RX_QUEUE_SIZE 16
 
+/*
+ * The TX path is split in priority classes, each with its own bounded queue,
+ * so that bulk traffic (log data, console) can not delay the control plane.
+ * The TX task serves the classes in weighted round robin order: in every round
+ * a class may send up to its weight in packets, a new round is started as soon
+ * as no class with weight left has anything to send. An idle class does not
+ * use any bandwidth.
+ */
+typedef enum {
+  CRTP_TX_CLASS_CONTROL = 0,  // Setpoints, localization, platform and link services
+  CRTP_TX_CLASS_CONFIG,       // Param and mem
+  CRTP_TX_CLASS_BULK,         // Log, console and everything else
+  CRTP_TX_CLASS_COUNT,
+} crtpTxClass_t;
+
+#define CRTP_TX_QUEUE_SIZE_CONTROL 16
+#define CRTP_TX_QUEUE_SIZE_CONFIG 32
+#define CRTP_TX_QUEUE_SIZE_BULK 152
+
+static const uint8_t txQueueSize[CRTP_TX_CLASS_COUNT] = {
+  [CRTP_TX_CLASS_CONTROL] = CRTP_TX_QUEUE_SIZE_CONTROL,
+  [CRTP_TX_CLASS_CONFIG] = CRTP_TX_QUEUE_SIZE_CONFIG,
+  [CRTP_TX_CLASS_BULK] = CRTP_TX_QUEUE_SIZE_BULK,
+};
+
+static const uint8_t txClassWeight[CRTP_TX_CLASS_COUNT] = {
+  [CRTP_TX_CLASS_CONTROL] = 8,
+  [CRTP_TX_CLASS_CONFIG] = 4,
+  [CRTP_TX_CLASS_BULK] = 1,
+};
+
+static const uint8_t portTxClass[CRTP_NBR_OF_PORTS] = {
+  [CRTP_PORT_CONSOLE] = CRTP_TX_CLASS_BULK,
+  [0x01] = CRTP_TX_CLASS_BULK,
+  [CRTP_PORT_PARAM] = CRTP_TX_CLASS_CONFIG,
+  [CRTP_PORT_SETPOINT] = CRTP_TX_CLASS_CONTROL,
+  [CRTP_PORT_MEM] = CRTP_TX_CLASS_CONFIG,
+  [CRTP_PORT_LOG] = CRTP_TX_CLASS_BULK,
+  [CRTP_PORT_LOCALIZATION] = CRTP_TX_CLASS_CONTROL,
+  [CRTP_PORT_SETPOINT_GENERIC] = CRTP_TX_CLASS_CONTROL,
+  [CRTP_PORT_SETPOINT_HL] = CRTP_TX_CLASS_CONTROL,
+  [0x09] = CRTP_TX_CLASS_BULK,
+  [0x0A] = CRTP_TX_CLASS_BULK,
+  [0x0B] = CRTP_TX_CLASS_BULK,
+  [0x0C] = CRTP_TX_CLASS_BULK,
+  [CRTP_PORT_PLATFORM] = CRTP_TX_CLASS_CONTROL,
+  [0x0E] = CRTP_TX_CLASS_BULK,
+  [CRTP_PORT_LINK] = CRTP_TX_CLASS_CONTROL,
+};
+
+/*
+ * TX packets live in a fixed pool and only pointers to them are passed through
+ * the TX queues, the link layer reads the packet in place. Each packet has a
+ * reference count so that it can be queued more than once. The pool is a bit
+ * larger than the queues together to leave room for the packet being sent and
+ * packets that producers are filling in.
+ */
+#define CRTP_TX_POOL_SIZE (CRTP_TX_QUEUE_SIZE_CONTROL + CRTP_TX_QUEUE_SIZE_CONFIG + CRTP_TX_QUEUE_SIZE_BULK + 8)
+
+static CRTPPacket txPool[CRTP_TX_POOL_SIZE];
+static uint8_t txPoolRefCount[CRTP_TX_POOL_SIZE];
+static uint8_t txPoolFreeList[CRTP_TX_POOL_SIZE];
+static uint8_t txPoolFreeCount;
+static uint8_t txPoolMinFree;
+// Time a packet was queued [us], for the enqueue to transmit latency
+static uint32_t txPoolEnqueueTime[CRTP_TX_POOL_SIZE];
+
+static xQueueHandle txQueues[CRTP_TX_CLASS_COUNT];
+static uint8_t txClassCredit[CRTP_TX_CLASS_COUNT];
+static TaskHandle_t txTaskHandle;
+
+static struct {
+  uint8_t depth[CRTP_TX_CLASS_COUNT];
+  uint32_t dropped[CRTP_TX_CLASS_COUNT];
+} txClassStats;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static crtpPortStats_t portStats[CRTP_NBR_OF_PORTS];
+static crtpLinkStats_t linkStats;
+
 static void crtpTxTask(void *param);
 static void crtpRxTask(void *param);
 
@@ -88,10 +167,20 @@ void crtpInit(void)
   if(isInit)
     return;
 
-  txQueue = xQueueCreate(CRTP_TX_QUEUE_SIZE, sizeof(CRTPPacket));
-  DEBUG_QUEUE_MONITOR_REGISTER(txQueue);
+  for (int i = 0; i < CRTP_TX_POOL_SIZE; i++) {
+    txPoolFreeList[i] = i;
+  }
+  txPoolFreeCount = CRTP_TX_POOL_SIZE;
+  txPoolMinFree = CRTP_TX_POOL_SIZE;
+
+  for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++) {
+    txQueues[i] = xQueueCreate(txQueueSize[i], sizeof(CRTPPacket*));
+    DEBUG_QUEUE_MONITOR_REGISTER(txQueues[i]);
+    queueStatsRegister(txQueues[i], queueStatsCrtpTxControl + i);
+    txClassCredit[i] = txClassWeight[i];
+  }
 
-  STATIC_MEM_TASK_CREATE(crtpTxTask, crtpTxTask, CRTP_TX_TASK_NAME, NULL, CRTP_TX_TASK_PRI);
+  txTaskHandle = STATIC_MEM_TASK_CREATE(crtpTxTask, crtpTxTask, CRTP_TX_TASK_NAME, NULL, CRTP_TX_TASK_PRI);
   STATIC_MEM_TASK_CREATE(crtpRxTask, crtpRxTask, CRTP_RX_TASK_NAME, NULL, CRTP_RX_TASK_PRI);
 
   isInit = true;
@@ -135,27 +224,174 @@ int crtpReceivePacketWait(CRTPPort portId, CRTPPacket *p, int wait)
   return xQueueReceive(queues[portId], p, M2T(wait));
 }
 
+static crtpTxClass_t getTxClass(const uint8_t port)
+{
+  return portTxClass[port & (CRTP_NBR_OF_PORTS - 1)];
+}
+
 int crtpGetFreeTxQueuePackets(void)
 {
-  return (CRTP_TX_QUEUE_SIZE - uxQueueMessagesWaiting(txQueue));
+  int free = 0;
+  for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++) {
+    free += uxQueueSpacesAvailable(txQueues[i]);
+  }
+
+  return free;
+}
+
+int crtpGetFreeTxQueuePacketsForPort(CRTPPort portId)
+{
+  return uxQueueSpacesAvailable(txQueues[getTxClass(portId)]);
+}
+
+CRTPPacket* crtpPacketAlloc(void)
+{
+  CRTPPacket* p = NULL;
+
+  taskENTER_CRITICAL();
+  if (txPoolFreeCount > 0)
+  {
+    txPoolFreeCount--;
+    const uint8_t index = txPoolFreeList[txPoolFreeCount];
+    txPoolRefCount[index] = 1;
+    p = &txPool[index];
+
+    if (txPoolFreeCount < txPoolMinFree)
+    {
+      txPoolMinFree = txPoolFreeCount;
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  return p;
+}
+
+void crtpPacketRetain(CRTPPacket* p)
+{
+  const int index = p - txPool;
+  ASSERT(index >= 0 && index < CRTP_TX_POOL_SIZE);
+
+  taskENTER_CRITICAL();
+  ASSERT(txPoolRefCount[index] > 0);
+  txPoolRefCount[index]++;
+  taskEXIT_CRITICAL();
+}
+
+void crtpPacketRelease(CRTPPacket* p)
+{
+  const int index = p - txPool;
+  ASSERT(index >= 0 && index < CRTP_TX_POOL_SIZE);
+
+  taskENTER_CRITICAL();
+  ASSERT(txPoolRefCount[index] > 0);
+  txPoolRefCount[index]--;
+  if (txPoolRefCount[index] == 0)
+  {
+    txPoolFreeList[txPoolFreeCount] = index;
+    txPoolFreeCount++;
+  }
+  taskEXIT_CRITICAL();
+}
+
+static uint8_t latencyBin(const uint32_t latencyUs)
+{
+  // Bin 0 is below 1 ms, then one bin per power of two ms
+  const uint32_t latencyMs = latencyUs / 1000;
+  if (latencyMs == 0)
+  {
+    return 0;
+  }
+
+  const uint8_t bin = 32 - __builtin_clz(latencyMs);
+  return (bin < CRTP_STATS_LATENCY_BINS) ? bin : CRTP_STATS_LATENCY_BINS - 1;
+}
+
+static void addToHistogram(uint16_t* histogram, const uint32_t latencyUs)
+{
+  uint16_t* bin = &histogram[latencyBin(latencyUs)];
+  if (*bin < UINT16_MAX)
+  {
+    (*bin)++;
+  }
+}
+
+const crtpPortStats_t* crtpGetPortStats(CRTPPort portId)
+{
+  if (portId >= CRTP_NBR_OF_PORTS)
+  {
+    return NULL;
+  }
+
+  return &portStats[portId];
+}
+
+const crtpLinkStats_t* crtpGetLinkStats(void)
+{
+  return &linkStats;
+}
+
+int crtpGetTxQueueSizeForPort(CRTPPort portId)
+{
+  return txQueueSize[getTxClass(portId)];
+}
+
+static bool receiveNextTxPacket(CRTPPacket **p)
+{
+  for (int round = 0; round < 2; round++)
+  {
+    for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++)
+    {
+      if (txClassCredit[i] > 0 && xQueueReceive(txQueues[i], p, 0) == pdTRUE)
+      {
+        txClassCredit[i]--;
+        return true;
+      }
+    }
+
+    // Nothing to send from the classes with credit left, start a new round
+    for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++)
+    {
+      txClassCredit[i] = txClassWeight[i];
+    }
+  }
+
+  return false;
 }
 
 void crtpTxTask(void *param)
 {
-  CRTPPacket p;
+  CRTPPacket* p;
 
   while (true)
   {
     if (link != &nopLink)
     {
-      if (xQueueReceive(txQueue, &p, portMAX_DELAY) == pdTRUE)
+      if (!receiveNextTxPacket(&p))
+      {
+        // All queues are empty, wait for crtpSendPacket() to notify us
+        ulTaskNotifyTake(pdTRUE, M2T(10));
+      }
+      else
       {
+        const uint32_t sendStart = usecTimestamp();
+
         // Keep testing, if the link changes to USB it will go though
-        while (link->sendPacket(&p) == false)
+        while (link->sendPacket(p) == false)
         {
+          linkStats.retries++;
           // Relaxation time
           vTaskDelay(M2T(10));
         }
+
+        const uint32_t sent = usecTimestamp();
+        crtpPortStats_t* port = &portStats[p->port];
+        port->txPackets++;
+        port->txBytes += p->size;
+        port->txChannelPackets[p->channel]++;
+        addToHistogram(port->txLatency, sent - txPoolEnqueueTime[p - txPool]);
+        addToHistogram(linkStats.sendLatency, sent - sendStart);
+
+        crtpPacketRelease(p);
         stats.txCount++;
         updateStats();
       }
@@ -177,6 +413,11 @@ void crtpRxTask(void *param)
     {
       if (!link->receivePacket(&p))
       {
+        crtpPortStats_t* port = &portStats[p.port];
+        port->rxPackets++;
+        port->rxBytes += p.size;
+        port->rxChannelPackets[p.channel]++;
+
         if (queues[p.port])
         {
           // Block, since we should never drop a packet
@@ -207,25 +448,77 @@ void crtpRegisterPortCB(int port, CrtpCallback cb)
   callbacks[port] = cb;
 }
 
-int crtpSendPacket(CRTPPacket *p)
+static int sendToTxQueue(CRTPPacket *p, TickType_t wait)
 {
   ASSERT(p);
   ASSERT(p->size <= CRTP_MAX_DATA_SIZE);
 
-  return xQueueSend(txQueue, p, 0);
+  const crtpTxClass_t txClass = getTxClass(p->port);
+  txPoolEnqueueTime[p - txPool] = usecTimestamp();
+  int result = xQueueSend(txQueues[txClass], &p, wait);
+  if (result == pdTRUE)
+  {
+    xTaskNotifyGive(txTaskHandle);
+  }
+  else
+  {
+    txClassStats.dropped[txClass]++;
+    portStats[p->port].txDrops++;
+    crtpPacketRelease(p);
+  }
+
+  return result;
+}
+
+int crtpSendPacketNoCopy(CRTPPacket *p)
+{
+  return sendToTxQueue(p, 0);
+}
+
+int crtpSendPacketNoCopyBlock(CRTPPacket *p)
+{
+  return sendToTxQueue(p, portMAX_DELAY);
+}
+
+int crtpSendPacket(CRTPPacket *p)
+{
+  ASSERT(p);
+
+  CRTPPacket* poolPacket = crtpPacketAlloc();
+  if (poolPacket == NULL)
+  {
+    txClassStats.dropped[getTxClass(p->port)]++;
+    portStats[p->port].txDrops++;
+    return pdFALSE;
+  }
+
+  memcpy(poolPacket, p, sizeof(CRTPPacket));
+  return sendToTxQueue(poolPacket, 0);
 }
 
 int crtpSendPacketBlock(CRTPPacket *p)
 {
   ASSERT(p);
-  ASSERT(p->size <= CRTP_MAX_DATA_SIZE);
 
-  return xQueueSend(txQueue, p, portMAX_DELAY);
+  CRTPPacket* poolPacket;
+  while ((poolPacket = crtpPacketAlloc()) == NULL)
+  {
+    vTaskDelay(M2T(1));
+  }
+
+  memcpy(poolPacket, p, sizeof(CRTPPacket));
+  return sendToTxQueue(poolPacket, portMAX_DELAY);
 }
 
 int crtpReset(void)
 {
-  xQueueReset(txQueue);
+  CRTPPacket* p;
+  for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++) {
+    // Return the queued packets to the pool
+    while (xQueueReceive(txQueues[i], &p, 0) == pdTRUE) {
+      crtpPacketRelease(p);
+    }
+  }
   if (link->reset) {
     link->reset();
   }
@@ -272,6 +565,10 @@ static void updateStats()
     stats.rxRate = (uint16_t)(1000.0f * stats.rxCount / interval);
     stats.txRate = (uint16_t)(1000.0f * stats.txCount / interval);
 
+    for (int i = 0; i < CRTP_TX_CLASS_COUNT; i++) {
+      txClassStats.depth[i] = uxQueueMessagesWaiting(txQueues[i]);
+    }
+
     clearStats();
     stats.previousStatisticsTime = now;
     stats.nextStatisticsTime = now + STATS_INTERVAL;
@@ -281,4 +578,97 @@ static void updateStats()
 LOG_GROUP_START(crtp)
 LOG_ADD(LOG_UINT16, rxRate, &stats.rxRate)
 LOG_ADD(LOG_UINT16, txRate, &stats.txRate)
+
+/**
+ * @brief Packets waiting in the control class TX queue (setpoints, localization, platform, link)
+ */
+LOG_ADD(LOG_UINT8, txDepthCtrl, &txClassStats.depth[CRTP_TX_CLASS_CONTROL])
+
+/**
+ * @brief Packets waiting in the config class TX queue (param, mem)
+ */
+LOG_ADD(LOG_UINT8, txDepthCfg, &txClassStats.depth[CRTP_TX_CLASS_CONFIG])
+
+/**
+ * @brief Packets waiting in the bulk class TX queue (log, console and other ports)
+ */
+LOG_ADD(LOG_UINT8, txDepthBulk, &txClassStats.depth[CRTP_TX_CLASS_BULK])
+
+/**
+ * @brief Packets dropped since boot because the control class TX queue was full
+ */
+LOG_ADD(LOG_UINT32, txDropCtrl, &txClassStats.dropped[CRTP_TX_CLASS_CONTROL])
+
+/**
+ * @brief Packets dropped since boot because the config class TX queue was full
+ */
+LOG_ADD(LOG_UINT32, txDropCfg, &txClassStats.dropped[CRTP_TX_CLASS_CONFIG])
+
+/**
+ * @brief Packets dropped since boot because the bulk class TX queue was full
+ */
+LOG_ADD(LOG_UINT32, txDropBulk, &txClassStats.dropped[CRTP_TX_CLASS_BULK])
+
+/**
+ * @brief Free packets in the TX packet pool
+ */
+LOG_ADD(LOG_UINT8, txPoolFree, &txPoolFreeCount)
+
+/**
+ * @brief Lowest number of free packets in the TX packet pool since boot
+ */
+LOG_ADD(LOG_UINT8, txPoolMinFree, &txPoolMinFree)
+
+/**
+ * @brief Number of times the link refused a packet and the send was retried
+ */
+LOG_ADD(LOG_UINT32, linkRetries, &linkStats.retries)
 LOG_GROUP_STOP(crtp)
+
+/**
+ * Bytes sent per CRTP port since boot. Packet counts, drops, per channel
+ * counters and latency histograms are available through the getCrtpStats
+ * platform command.
+ */
+LOG_GROUP_START(crtpTxB)
+/**
+ * @brief Bytes sent on the console port
+ */
+LOG_ADD(LOG_UINT32, console, &portStats[CRTP_PORT_CONSOLE].txBytes)
+/**
+ * @brief Bytes sent on the param port
+ */
+LOG_ADD(LOG_UINT32, param, &portStats[CRTP_PORT_PARAM].txBytes)
+/**
+ * @brief Bytes sent on the setpoint port
+ */
+LOG_ADD(LOG_UINT32, setpoint, &portStats[CRTP_PORT_SETPOINT].txBytes)
+/**
+ * @brief Bytes sent on the mem port
+ */
+LOG_ADD(LOG_UINT32, mem, &portStats[CRTP_PORT_MEM].txBytes)
+/**
+ * @brief Bytes sent on the log port
+ */
+LOG_ADD(LOG_UINT32, log, &portStats[CRTP_PORT_LOG].txBytes)
+/**
+ * @brief Bytes sent on the localization port
+ */
+LOG_ADD(LOG_UINT32, loc, &portStats[CRTP_PORT_LOCALIZATION].txBytes)
+/**
+ * @brief Bytes sent on the generic setpoint port
+ */
+LOG_ADD(LOG_UINT32, setpointG, &portStats[CRTP_PORT_SETPOINT_GENERIC].txBytes)
+/**
+ * @brief Bytes sent on the high level setpoint port
+ */
+LOG_ADD(LOG_UINT32, setpointHL, &portStats[CRTP_PORT_SETPOINT_HL].txBytes)
+/**
+ * @brief Bytes sent on the platform port
+ */
+LOG_ADD(LOG_UINT32, platform, &portStats[CRTP_PORT_PLATFORM].txBytes)
+/**
+ * @brief Bytes sent on the link port
+ */
+LOG_ADD(LOG_UINT32, link, &portStats[CRTP_PORT_LINK].txBytes)
+LOG_GROUP_STOP(crtpTxB)
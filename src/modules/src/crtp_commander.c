@@ -31,6 +31,7 @@
 #include "cfassert.h"
 #include "commander.h"
 #include "crtp.h"
+#include "configblock.h"
 
 
 static bool isInit;
@@ -52,6 +53,8 @@ void crtpCommanderInit(void)
 enum crtpSetpointGenericChannel {
   SET_SETPOINT_CHANNEL = 0,
   META_COMMAND_CHANNEL = 1,
+  SET_TIMED_SETPOINT_CHANNEL = 2,
+  BROADCAST_SETPOINT_CHANNEL = 3,
 };
 
 /* Channel 1 of the generic commander port is used for "meta-commands"
@@ -121,6 +124,18 @@ static void commanderCrtpCB(CRTPPacket* pk)
       crtpCommanderGenericDecodeSetpoint(&setpoint, pk);
       commanderSetSetpoint(&setpoint, COMMANDER_PRIORITY_CRTP);
       break;
+    case SET_TIMED_SETPOINT_CHANNEL: {
+        uint16_t senderTimeMs;
+        crtpCommanderGenericDecodeTimedSetpoint(&setpoint, &senderTimeMs, pk);
+        commanderSetTimedSetpoint(&setpoint, senderTimeMs, COMMANDER_PRIORITY_CRTP);
+      }
+      break;
+    case BROADCAST_SETPOINT_CHANNEL:
+      // The drone id is the last byte of the radio address, as for the P2P TDMA slots
+      if (crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, configblockGetRadioAddress() & 0xFF, pk)) {
+        commanderSetSetpoint(&setpoint, COMMANDER_PRIORITY_CRTP);
+      }
+      break;
     case META_COMMAND_CHANNEL: {
         uint8_t metaCmd = pk->data[0];
         if (metaCmd < nMetaCommands && (metaCommandDecoders[metaCmd] != NULL)) {
@@ -412,23 +412,138 @@ const static packetDecoder_t packetDecoders[] = {
 };
 
 /* Decoder switch */
-void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk)
+static void decodeSetpoint(setpoint_t *setpoint, const uint8_t *data, size_t datalen)
 {
   static int nTypes = -1;
 
-  ASSERT(pk->size > 0);
+  ASSERT(datalen > 0);
 
   if (nTypes<0) {
     nTypes = sizeof(packetDecoders)/sizeof(packetDecoders[0]);
   }
 
-  uint8_t type = pk->data[0];
+  uint8_t type = data[0];
 
   memset(setpoint, 0, sizeof(setpoint_t));
 
   if (type<nTypes && (packetDecoders[type] != NULL)) {
-    packetDecoders[type](setpoint, type, ((char*)pk->data)+1, pk->size-1);
+    packetDecoders[type](setpoint, type, ((char*)data)+1, datalen-1);
+  }
+}
+
+void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk)
+{
+  decodeSetpoint(setpoint, pk->data, pk->size);
+}
+
+/* Timed setpoints carry the time the setpoint was generated by the sender,
+ * followed by a generic setpoint:
+ * +-------------+------+==========================+
+ * | TIME        | TYPE |     DATA                 |
+ * +-------------+------+==========================+
+ *
+ * TIME is a free running 16-bit millisecond counter in the clock of the
+ * sender. The fullState setpoint does not fit in a timed packet.
+ */
+struct timedSetpointHeader_s {
+  uint16_t senderTimeMs;
+} __attribute__((packed));
+void crtpCommanderGenericDecodeTimedSetpoint(setpoint_t *setpoint, uint16_t *senderTimeMs, CRTPPacket *pk)
+{
+  const struct timedSetpointHeader_s *header = (const struct timedSetpointHeader_s *)pk->data;
+
+  ASSERT(pk->size > sizeof(struct timedSetpointHeader_s));
+
+  *senderTimeMs = header->senderTimeMs;
+  decodeSetpoint(setpoint, pk->data + sizeof(struct timedSetpointHeader_s), pk->size - sizeof(struct timedSetpointHeader_s));
+}
+
+/* Broadcast setpoints carry compact setpoints for a range of consecutive drone
+ * ids, to control a swarm with one radio broadcast packet:
+ * +--------+----------+=========+=========+====
+ * | FORMAT | FIRST_ID | ENTRY 0 | ENTRY 1 | ...
+ * +--------+----------+=========+=========+====
+ *
+ * Entry i is the setpoint of drone FIRST_ID + i, the number of entries is
+ * given by the packet length. Positions are in mm and velocities in mm/s in
+ * the world frame, the yaw is held.
+ */
+enum broadcastFormat_e {
+  broadcastPosition         = 0, // x, y, z: up to 4 drones per packet
+  broadcastPositionVelocity = 1, // x, y, z, vx, vy, vz: up to 2 drones per packet
+  broadcastVelocity         = 2, // vx, vy, vz: up to 4 drones per packet
+};
+
+struct broadcastSetpointHeader_s {
+  uint8_t format;
+  uint8_t firstId;
+} __attribute__((packed));
+
+struct broadcastVector_s {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+} __attribute__((packed));
+
+bool crtpCommanderGenericDecodeBroadcastSetpoint(setpoint_t *setpoint, uint8_t id, CRTPPacket *pk)
+{
+  struct broadcastSetpointHeader_s header;
+  struct broadcastVector_s position = {0};
+  struct broadcastVector_s velocity = {0};
+
+  if (pk->size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, pk->data, sizeof(header));
+
+  size_t entryLen;
+  switch (header.format) {
+    case broadcastPosition:
+    case broadcastVelocity:
+      entryLen = sizeof(struct broadcastVector_s);
+      break;
+    case broadcastPositionVelocity:
+      entryLen = 2 * sizeof(struct broadcastVector_s);
+      break;
+    default:
+      return false;
+  }
+
+  // The entry of this drone, if any, is found from the id offset
+  const uint8_t index = id - header.firstId;
+  const size_t offset = sizeof(header) + index * entryLen;
+  if (offset + entryLen > pk->size) {
+    return false;
+  }
+
+  if (header.format == broadcastVelocity) {
+    memcpy(&velocity, &pk->data[offset], sizeof(velocity));
+  } else {
+    memcpy(&position, &pk->data[offset], sizeof(position));
+    if (header.format == broadcastPositionVelocity) {
+      memcpy(&velocity, &pk->data[offset + sizeof(position)], sizeof(velocity));
+    }
   }
+
+  memset(setpoint, 0, sizeof(setpoint_t));
+
+  const stab_mode_t mode = (header.format == broadcastVelocity) ? modeVelocity : modeAbs;
+  setpoint->mode.x = mode;
+  setpoint->mode.y = mode;
+  setpoint->mode.z = mode;
+
+  setpoint->position.x = position.x / 1000.0f;
+  setpoint->position.y = position.y / 1000.0f;
+  setpoint->position.z = position.z / 1000.0f;
+  setpoint->velocity.x = velocity.x / 1000.0f;
+  setpoint->velocity.y = velocity.y / 1000.0f;
+  setpoint->velocity.z = velocity.z / 1000.0f;
+  setpoint->velocity_body = false;
+
+  setpoint->mode.yaw = modeVelocity;
+  setpoint->attitudeRate.yaw = 0.0f;
+
+  return true;
 }
 
 /**
@@ -57,6 +57,8 @@ such as: take-off, landing, polynomial trajectories.
 #include "commander.h"
 #include "stabilizer_types.h"
 #include "stabilizer.h"
+#include "crtp_localization_service.h"
+#include "crc32.h"
 
 // Local types
 enum TrajectoryLocation_e {
@@ -85,10 +87,33 @@ struct trajectoryDescription
 
 #define ALL_GROUPS 0
 
+// Streamed trajectories. The client is notified when the number of buffered pieces drops to the low watermark, the
+// status is checked with this interval.
+#define STREAM_STATUS_INTERVAL_MS 100
+#define STREAM_DEFAULT_LOW_WATERMARK 4
+#define STREAM_TRAJECTORY_ID_NONE 0xff
+
+// Commands scheduled at a swarm time must not start further into the future than this
+#define SCHEDULE_MAX_AHEAD_US (60 * 1000 * 1000)
+
 // Global variables
 uint8_t trajectories_memory[TRAJECTORY_MEMORY_SIZE] __attribute__((aligned(4)));
 static struct trajectoryDescription trajectory_descriptions[NUM_TRAJECTORY_DEFINITIONS];
 
+// Bounds of the defined trajectories, computed when a trajectory is defined and invalidated when the memory it uses
+// is written to
+struct trajectoryBounds
+{
+  struct traj_bounds bounds;
+  uint32_t size;  // bytes of trajectory memory used by the trajectory
+  bool valid;
+};
+static struct trajectoryBounds trajectory_bounds[NUM_TRAJECTORY_DEFINITIONS];
+static uint8_t selected_bounds_id;
+static struct traj_bounds selected_bounds;
+static bool selected_bounds_valid;
+static float selected_bounds_tilt_deg;
+
 // Static structs are zero-initialized, so nullSetpoint corresponds to
 // modeDisable for all stab_mode_t members and zero for all physical values.
 // In other words, the controller should cut power upon recieving it.
@@ -103,6 +128,26 @@ static struct vec vel; // last known setpoint (velocity [m/s])
 static float yaw; // last known setpoint yaw (yaw [rad])
 static struct piecewise_traj trajectory;
 static struct piecewise_traj_compressed  compressed_trajectory;
+static struct piecewise_traj_stream stream_trajectory;
+static uint8_t stream_trajectory_id = STREAM_TRAJECTORY_ID_NONE;
+static uint8_t stream_low_watermark = STREAM_DEFAULT_LOW_WATERMARK;
+static bool stream_notified;
+
+// A command that is scheduled to be executed at a swarm time, see COMMAND_AT_SWARM_TIME
+static struct {
+  bool is_pending;
+  uint64_t local_time_us;
+  uint8_t command;
+  uint8_t data[CRTP_MAX_DATA_SIZE];
+} scheduled_command;
+
+// The view of the trajectory memory for this Crazyflie, applied when a trajectory is started, see
+// COMMAND_SET_TRAJECTORY_VIEW
+static struct {
+  struct vec shift;
+  struct vec scale;
+  float timescale;
+} trajectory_view;
 
 // makes sure that we don't evaluate the trajectory while it is being changed
 static xSemaphoreHandle lockTraj;
@@ -140,6 +185,13 @@ enum TrajectoryCommand_e {
   COMMAND_LAND_2                  = 8,
   COMMAND_TAKEOFF_WITH_VELOCITY   = 9,
   COMMAND_LAND_WITH_VELOCITY      = 10,
+  COMMAND_APPEND_TRAJECTORY       = 11,
+  COMMAND_STREAM_STATUS           = 12, // Sent by the Crazyflie, not a command
+  COMMAND_GO_TO_WAYPOINTS         = 13,
+  COMMAND_AT_SWARM_TIME           = 14,
+  COMMAND_WRITE_TRAJECTORY_MEMORY = 15,
+  COMMAND_SET_TRAJECTORY_VIEW     = 16,
+  COMMAND_CHECK_TRAJECTORY_MEMORY = 17,
 };
 
 struct data_set_group_mask {
@@ -218,6 +270,24 @@ struct data_go_to {
   float duration; // sec
 } __attribute__((packed));
 
+// "fly through these waypoints, then hover at the last one". The waypoints are read from the trajectory memory, as
+// an array of struct compact_waypoint
+struct data_go_to_waypoints {
+  uint8_t groupMask;    // mask for which CFs this should apply to
+  uint8_t relative;     // set to true, if the waypoints are relative to current setpoint
+  uint8_t n_waypoints;  // number of waypoints, at most PLAN_MAX_WAYPOINTS
+  float max_velocity;   // m/s, sets the duration of waypoints with zero duration
+  uint32_t offset;      // offset of the waypoints in uploaded memory
+} __attribute__((packed));
+
+struct compact_waypoint {
+  int16_t x;            // mm
+  int16_t y;            // mm
+  int16_t z;            // mm
+  int16_t yaw;          // 1/10 degrees
+  uint16_t duration;    // ms from the previous waypoint, 0 to use max_velocity
+} __attribute__((packed));
+
 // starts executing a specified trajectory
 struct data_start_trajectory {
   uint8_t groupMask; // mask for which CFs this should apply to
@@ -233,20 +303,100 @@ struct data_define_trajectory {
   struct trajectoryDescription description;
 } __attribute__((packed));
 
+// appends pieces to a streamed trajectory (previously defined by COMMAND_DEFINE_TRAJECTORY)
+struct data_append_trajectory {
+  uint8_t trajectoryId;   // id of the streamed trajectory
+  uint8_t trajectoryType; // format of the pieces to append, TRAJECTORY_TYPE_POLY4D or TRAJECTORY_TYPE_POLY4D_COMPRESSED
+  uint32_t offset;        // offset of the pieces in uploaded memory
+  uint8_t n_pieces;       // number of pieces to append
+  uint8_t last;           // set to true, if these are the last pieces of the trajectory
+} __attribute__((packed));
+
+// executes a command at a swarm time, that is at the same time in all Crazyflies that receive it, see
+// locSrvGetLocalTimeForSwarmTime(). The data of the command follows this struct. Supported commands are
+// COMMAND_TAKEOFF_2, COMMAND_TAKEOFF_WITH_VELOCITY, COMMAND_GO_TO and COMMAND_START_TRAJECTORY, the command is
+// planned from the swarm time. One command can be scheduled, a new command replaces a pending one and
+// COMMAND_STOP cancels it.
+struct data_at_swarm_time {
+  uint32_t swarmTime;   // ms, the lower 32 bits of the swarm time
+  uint8_t command;      // the command to execute
+} __attribute__((packed));
+
+// writes data to the trajectory memory, like the memory subsystem does. Used to upload the same trajectories to all
+// Crazyflies with one broadcast, there is no acknowledge for broadcasts and the client should verify the upload with
+// COMMAND_CHECK_TRAJECTORY_MEMORY to each Crazyflie. The data follows this struct.
+struct data_write_trajectory_memory {
+  uint8_t groupMask;      // mask for which CFs this should apply to
+  uint32_t offset;        // offset in the trajectory memory (bytes)
+  uint8_t size;           // number of bytes of data
+  uint8_t data[];
+} __attribute__((packed));
+
+#define WRITE_TRAJECTORY_MEMORY_MAX_SIZE (CRTP_MAX_DATA_SIZE - 1 - sizeof(struct data_write_trajectory_memory))
+
+// sets the view of the trajectory memory for this Crazyflie. When trajectories are started, the positions are scaled
+// (around the origin), shifted (only if the trajectory is not started relative to the current position) and the time
+// is stretched by the timescale of the view multiplied with the timescale of the start command. The Crazyflies of a
+// group can fly their own copy of trajectories that are shared by all Crazyflies. The view is used for trajectories
+// that are started after it is set. Compressed and streamed trajectories do not support scaling, and compressed
+// trajectories do not support a timescale, but the shift is applied.
+struct data_set_trajectory_view {
+  uint8_t groupMask;      // mask for which CFs this should apply to
+  float x;                // shift (m)
+  float y;
+  float z;
+  float scaleX;           // scale of the position, 1 = original size, negative values mirror the axis
+  float scaleY;
+  float scaleZ;
+  float timescale;        // time factor; 1 = original speed; >1: slower; <1: faster
+} __attribute__((packed));
+
+// checks the contents of the trajectory memory, answers 0 if the CRC32 of the memory range matches and EIO if not
+struct data_check_trajectory_memory {
+  uint32_t offset;        // offset in the trajectory memory (bytes)
+  uint32_t length;        // number of bytes to check
+  uint32_t crc32;         // expected CRC32 of the memory range
+} __attribute__((packed));
+
+#define STREAM_STATUS_FLAG_UNDERRUN 0x01
+#define STREAM_STATUS_FLAG_COMPLETE 0x02
+
+// status of a streamed trajectory that is being flown, sent when the buffered pieces reach the low watermark or the
+// trajectory holds position waiting for more pieces
+struct data_stream_status {
+  uint8_t trajectoryId;   // id of the streamed trajectory
+  uint8_t n_pieces;       // number of buffered pieces
+  uint8_t n_free;         // number of pieces that can be appended
+  uint8_t flags;          // STREAM_STATUS_FLAG_*
+} __attribute__((packed));
+
 // Private functions
 static void crtpCommanderHighLevelTask(void * prm);
 
 static int set_group_mask(const struct data_set_group_mask* data);
 static int takeoff(const struct data_takeoff* data);
 static int land(const struct data_land* data);
-static int takeoff2(const struct data_takeoff_2* data);
+static int takeoff2(const struct data_takeoff_2* data, const float t);
 static int land2(const struct data_land_2* data);
-static int takeoff_with_velocity(const struct data_takeoff_with_velocity* data);
+static int takeoff_with_velocity(const struct data_takeoff_with_velocity* data, const float t);
 static int land_with_velocity(const struct data_land_with_velocity* data);
 static int stop(const struct data_stop* data);
-static int go_to(const struct data_go_to* data);
-static int start_trajectory(const struct data_start_trajectory* data);
+static int go_to(const struct data_go_to* data, const float t);
+static int go_to_waypoints(const struct data_go_to_waypoints* data);
+static int go_to_waypoints_from(const uint8_t groupMask, const bool relative, const struct plan_waypoint* waypoints, const int nWaypoints, const float maxVelocity);
+static int start_trajectory(const struct data_start_trajectory* data, const float t);
+static int at_swarm_time(const struct data_at_swarm_time* data);
+static void run_scheduled_command(void);
 static int define_trajectory(const struct data_define_trajectory* data);
+static int append_trajectory(const struct data_append_trajectory* data);
+static int write_trajectory_memory(const struct data_write_trajectory_memory* data);
+static int set_trajectory_view(const struct data_set_trajectory_view* data);
+static int check_trajectory_memory(const struct data_check_trajectory_memory* data);
+static bool is_view_scaled(void);
+static void compute_trajectory_bounds(const uint8_t trajectoryId);
+static void update_selected_bounds(void);
+static void send_stream_status(void);
+uint8_t* initCrtpPacket(CRTPPacket* packet, const enum TrajectoryCommand_e command);
 
 // Helper functions
 static struct vec state2vec(struct vec3_s v)
@@ -276,6 +426,10 @@ void crtpCommanderHighLevelInit(void)
   vel = vzero();
   yaw = 0;
 
+  trajectory_view.shift = vzero();
+  trajectory_view.scale = vrepeat(1.0f);
+  trajectory_view.timescale = 1.0f;
+
   isBlocked = false;
 
   isInit = true;
@@ -370,6 +524,33 @@ bool crtpCommanderHighLevelGetSetpoint(setpoint_t* setpoint, const state_t *stat
   }
 }
 
+// Handles the commands that can be scheduled with COMMAND_AT_SWARM_TIME, t is the time to plan from.
+static int handleTimedCommand(const enum TrajectoryCommand_e command, const uint8_t* data, const float t)
+{
+  int ret = 0;
+
+  switch(command)
+  {
+    case COMMAND_TAKEOFF_2:
+      ret = takeoff2((const struct data_takeoff_2*)data, t);
+      break;
+    case COMMAND_TAKEOFF_WITH_VELOCITY:
+      ret = takeoff_with_velocity((const struct data_takeoff_with_velocity*)data, t);
+      break;
+    case COMMAND_GO_TO:
+      ret = go_to((const struct data_go_to*)data, t);
+      break;
+    case COMMAND_START_TRAJECTORY:
+      ret = start_trajectory((const struct data_start_trajectory*)data, t);
+      break;
+    default:
+      ret = ENOEXEC;
+      break;
+  }
+
+  return ret;
+}
+
 static int handleCommand(const enum TrajectoryCommand_e command, const uint8_t* data)
 {
   int ret = 0;
@@ -386,29 +567,41 @@ static int handleCommand(const enum TrajectoryCommand_e command, const uint8_t*
       ret = land((const struct data_land*)data);
       break;
     case COMMAND_TAKEOFF_2:
-      ret = takeoff2((const struct data_takeoff_2*)data);
+    case COMMAND_TAKEOFF_WITH_VELOCITY:
+    case COMMAND_GO_TO:
+    case COMMAND_START_TRAJECTORY:
+      ret = handleTimedCommand(command, data, usecTimestamp() / 1e6);
       break;
     case COMMAND_LAND_2:
       ret = land2((const struct data_land_2*)data);
       break;
-    case COMMAND_TAKEOFF_WITH_VELOCITY:
-      ret = takeoff_with_velocity((const struct data_takeoff_with_velocity*)data);
-      break;
     case COMMAND_LAND_WITH_VELOCITY:
       ret = land_with_velocity((const struct data_land_with_velocity*)data);
       break;
     case COMMAND_STOP:
       ret = stop((const struct data_stop*)data);
       break;
-    case COMMAND_GO_TO:
-      ret = go_to((const struct data_go_to*)data);
-      break;
-    case COMMAND_START_TRAJECTORY:
-      ret = start_trajectory((const struct data_start_trajectory*)data);
+    case COMMAND_GO_TO_WAYPOINTS:
+      ret = go_to_waypoints((const struct data_go_to_waypoints*)data);
       break;
     case COMMAND_DEFINE_TRAJECTORY:
       ret = define_trajectory((const struct data_define_trajectory*)data);
       break;
+    case COMMAND_APPEND_TRAJECTORY:
+      ret = append_trajectory((const struct data_append_trajectory*)data);
+      break;
+    case COMMAND_AT_SWARM_TIME:
+      ret = at_swarm_time((const struct data_at_swarm_time*)data);
+      break;
+    case COMMAND_WRITE_TRAJECTORY_MEMORY:
+      ret = write_trajectory_memory((const struct data_write_trajectory_memory*)data);
+      break;
+    case COMMAND_SET_TRAJECTORY_VIEW:
+      ret = set_trajectory_view((const struct data_set_trajectory_view*)data);
+      break;
+    case COMMAND_CHECK_TRAJECTORY_MEMORY:
+      ret = check_trajectory_memory((const struct data_check_trajectory_memory*)data);
+      break;
     default:
       ret = ENOEXEC;
       break;
@@ -423,14 +616,27 @@ void crtpCommanderHighLevelTask(void * prm)
   crtpInitTaskQueue(CRTP_PORT_SETPOINT_HL);
 
   while(1) {
-    crtpReceivePacketBlock(CRTP_PORT_SETPOINT_HL, &p);
+    uint32_t timeout_ms = STREAM_STATUS_INTERVAL_MS;
+    if (scheduled_command.is_pending) {
+      const uint64_t now_us = usecTimestamp();
+      if (scheduled_command.local_time_us <= now_us) {
+        timeout_ms = 0;
+      } else if (scheduled_command.local_time_us - now_us < timeout_ms * 1000) {
+        timeout_ms = (scheduled_command.local_time_us - now_us) / 1000;
+      }
+    }
 
-    int ret = handleCommand(p.data[0], &p.data[1]);
+    if (crtpReceivePacketWait(CRTP_PORT_SETPOINT_HL, &p, M2T(timeout_ms)) == pdTRUE) {
+      int ret = handleCommand(p.data[0], &p.data[1]);
 
-    //answer
-    p.data[3] = ret;
-    p.size = 4;
-    crtpSendPacketBlock(&p);
+      //answer
+      p.data[3] = ret;
+      p.size = 4;
+      crtpSendPacketBlock(&p);
+    }
+
+    run_scheduled_command();
+    send_stream_status();
   }
 }
 
@@ -458,7 +664,7 @@ int takeoff(const struct data_takeoff* data)
   return result;
 }
 
-int takeoff2(const struct data_takeoff_2* data)
+int takeoff2(const struct data_takeoff_2* data, const float t)
 {
   if (isBlocked) {
     return EBUSY;
@@ -467,7 +673,6 @@ int takeoff2(const struct data_takeoff_2* data)
   int result = 0;
   if (isInGroup(data->groupMask)) {
     xSemaphoreTake(lockTraj, portMAX_DELAY);
-    float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
     if (data->useCurrentYaw) {
@@ -480,7 +685,7 @@ int takeoff2(const struct data_takeoff_2* data)
   return result;
 }
 
-int takeoff_with_velocity(const struct data_takeoff_with_velocity* data)
+int takeoff_with_velocity(const struct data_takeoff_with_velocity* data, const float t)
 {
   if (isBlocked) {
     return EBUSY;
@@ -489,7 +694,6 @@ int takeoff_with_velocity(const struct data_takeoff_with_velocity* data)
   int result = 0;
   if (isInGroup(data->groupMask)) {
     xSemaphoreTake(lockTraj, portMAX_DELAY);
-    float t = usecTimestamp() / 1e6;
 
     float hover_yaw = data->yaw;
     if (data->useCurrentYaw) {
@@ -582,13 +786,70 @@ int stop(const struct data_stop* data)
   int result = 0;
   if (isInGroup(data->groupMask)) {
     xSemaphoreTake(lockTraj, portMAX_DELAY);
+    scheduled_command.is_pending = false;
     plan_stop(&planner);
     xSemaphoreGive(lockTraj);
   }
   return result;
 }
 
-int go_to(const struct data_go_to* data)
+int at_swarm_time(const struct data_at_swarm_time* data)
+{
+  // The command data follows the header, the group mask is the first member of all supported commands
+  const uint8_t* command_data = (const uint8_t*)data + sizeof(struct data_at_swarm_time);
+  const int max_command_size = CRTP_MAX_DATA_SIZE - 1 - sizeof(struct data_at_swarm_time);
+
+  switch (data->command) {
+    case COMMAND_TAKEOFF_2:
+    case COMMAND_TAKEOFF_WITH_VELOCITY:
+    case COMMAND_GO_TO:
+    case COMMAND_START_TRAJECTORY:
+      break;
+    default:
+      return ENOEXEC;
+  }
+
+  if (!isInGroup(command_data[0])) {
+    // Do not replace a command scheduled for our group
+    return 0;
+  }
+
+  uint64_t local_time_us;
+  if (!locSrvGetLocalTimeForSwarmTime(data->swarmTime, &local_time_us)) {
+    return ENODATA;
+  }
+
+  const uint64_t now_us = usecTimestamp();
+  if (local_time_us < now_us) {
+    return ETIME;
+  }
+  if (local_time_us - now_us > SCHEDULE_MAX_AHEAD_US) {
+    return ERANGE;
+  }
+
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  scheduled_command.command = data->command;
+  memcpy(scheduled_command.data, command_data, max_command_size);
+  scheduled_command.local_time_us = local_time_us;
+  scheduled_command.is_pending = true;
+  xSemaphoreGive(lockTraj);
+
+  return 0;
+}
+
+static void run_scheduled_command(void)
+{
+  if (!scheduled_command.is_pending || usecTimestamp() < scheduled_command.local_time_us) {
+    return;
+  }
+
+  scheduled_command.is_pending = false;
+
+  // Plan from the scheduled time rather than the current time, to start at the same time in all Crazyflies
+  handleTimedCommand(scheduled_command.command, scheduled_command.data, scheduled_command.local_time_us / 1e6);
+}
+
+int go_to(const struct data_go_to* data, const float t)
 {
   static struct traj_eval ev = {
     // pos, vel, yaw will be filled before using
@@ -604,7 +865,6 @@ int go_to(const struct data_go_to* data)
   if (isInGroup(data->groupMask)) {
     struct vec hover_pos = mkvec(data->x, data->y, data->z);
     xSemaphoreTake(lockTraj, portMAX_DELAY);
-    float t = usecTimestamp() / 1e6;
     if (plan_is_disabled(&planner) || plan_is_stopped(&planner)) {
       ev.pos = pos;
       ev.vel = vel;
@@ -619,7 +879,55 @@ int go_to(const struct data_go_to* data)
   return result;
 }
 
-int start_trajectory(const struct data_start_trajectory* data)
+int go_to_waypoints(const struct data_go_to_waypoints* data)
+{
+  struct plan_waypoint waypoints[PLAN_MAX_WAYPOINTS];
+
+  if (data->n_waypoints == 0 || data->n_waypoints > PLAN_MAX_WAYPOINTS ||
+      data->offset + data->n_waypoints * sizeof(struct compact_waypoint) > sizeof(trajectories_memory)) {
+    return ENOEXEC;
+  }
+
+  for (int i = 0; i < data->n_waypoints; i++) {
+    struct compact_waypoint wp;
+    memcpy(&wp, &trajectories_memory[data->offset + i * sizeof(wp)], sizeof(wp));
+    waypoints[i].pos = mkvec(wp.x / 1000.0f, wp.y / 1000.0f, wp.z / 1000.0f);
+    waypoints[i].yaw = radians(wp.yaw / 10.0f);
+    waypoints[i].duration = wp.duration / 1000.0f;
+  }
+
+  return go_to_waypoints_from(data->groupMask, data->relative, waypoints, data->n_waypoints, data->max_velocity);
+}
+
+static int go_to_waypoints_from(const uint8_t groupMask, const bool relative, const struct plan_waypoint* waypoints, const int nWaypoints, const float maxVelocity)
+{
+  if (isBlocked) {
+    return EBUSY;
+  }
+
+  int result = 0;
+  if (isInGroup(groupMask)) {
+    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    float t = usecTimestamp() / 1e6;
+    struct traj_eval ev;
+    if (plan_is_disabled(&planner) || plan_is_stopped(&planner)) {
+      ev = traj_eval_zero();
+      ev.pos = pos;
+      ev.vel = vel;
+      ev.yaw = yaw;
+    }
+    else {
+      ev = plan_current_goal(&planner, t);
+    }
+    if (plan_go_to_waypoints_from(&planner, &ev, relative, waypoints, nWaypoints, maxVelocity, t) != 0) {
+      result = ENOEXEC;
+    }
+    xSemaphoreGive(lockTraj);
+  }
+  return result;
+}
+
+int start_trajectory(const struct data_start_trajectory* data, const float t)
 {
   if (isBlocked) {
     return EBUSY;
@@ -632,27 +940,48 @@ int start_trajectory(const struct data_start_trajectory* data)
       if (   trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
           && trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D) {
         xSemaphoreTake(lockTraj, portMAX_DELAY);
-        float t = usecTimestamp() / 1e6;
         trajectory.t_begin = t;
-        trajectory.timescale = data->timescale;
+        trajectory.timescale = data->timescale * trajectory_view.timescale;
+        trajectory.scale = trajectory_view.scale;
         trajectory.n_pieces = trajDesc->trajectoryIdentifier.mem.n_pieces;
         trajectory.pieces = (struct poly4d*)&trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset];
         result = plan_start_trajectory(&planner, &trajectory, data->reversed, data->relative, pos);
+        if (!data->relative) {
+          trajectory.shift = trajectory_view.shift;
+        }
         xSemaphoreGive(lockTraj);
       } else if (trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
           && trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED) {
 
-        if (data->timescale != 1 || data->reversed) {
+        if (data->timescale * trajectory_view.timescale != 1 || data->reversed || is_view_scaled()) {
           result = ENOEXEC;
         } else {
           xSemaphoreTake(lockTraj, portMAX_DELAY);
-          float t = usecTimestamp() / 1e6;
           piecewise_compressed_load(
             &compressed_trajectory,
             &trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset]
           );
           compressed_trajectory.t_begin = t;
           result = plan_start_compressed_trajectory(&planner, &compressed_trajectory, data->relative, pos);
+          if (!data->relative) {
+            compressed_trajectory.shift = trajectory_view.shift;
+          }
+          xSemaphoreGive(lockTraj);
+        }
+      } else if (trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
+          && trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_STREAM
+          && data->trajectoryId == stream_trajectory_id) {
+
+        if (data->reversed || stream_trajectory.count == 0 || is_view_scaled()) {
+          result = ENOEXEC;
+        } else {
+          xSemaphoreTake(lockTraj, portMAX_DELAY);
+          stream_trajectory.t_begin = t;
+          stream_trajectory.timescale = data->timescale * trajectory_view.timescale;
+          result = plan_start_stream_trajectory(&planner, &stream_trajectory, data->relative, pos);
+          if (!data->relative) {
+            stream_trajectory.shift = trajectory_view.shift;
+          }
           xSemaphoreGive(lockTraj);
         }
       }
@@ -661,15 +990,235 @@ int start_trajectory(const struct data_start_trajectory* data)
   return result;
 }
 
+static bool is_view_scaled(void)
+{
+  return !veq(trajectory_view.scale, vrepeat(1.0f));
+}
+
+int write_trajectory_memory(const struct data_write_trajectory_memory* data)
+{
+  if (data->size > WRITE_TRAJECTORY_MEMORY_MAX_SIZE) {
+    return ENOEXEC;
+  }
+
+  int result = 0;
+  if (isInGroup(data->groupMask)) {
+    if (!crtpCommanderHighLevelWriteTrajectory(data->offset, data->size, data->data)) {
+      result = ENOMEM;
+    }
+  }
+  return result;
+}
+
+int set_trajectory_view(const struct data_set_trajectory_view* data)
+{
+  const struct vec shift = mkvec(data->x, data->y, data->z);
+  const struct vec scale = mkvec(data->scaleX, data->scaleY, data->scaleZ);
+  if (!visfinite(shift) || !visfinite(scale) || !isfinite(data->timescale) || data->timescale <= 0) {
+    return ENOEXEC;
+  }
+
+  if (isInGroup(data->groupMask)) {
+    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    trajectory_view.shift = shift;
+    trajectory_view.scale = scale;
+    trajectory_view.timescale = data->timescale;
+    xSemaphoreGive(lockTraj);
+  }
+  return 0;
+}
+
+int check_trajectory_memory(const struct data_check_trajectory_memory* data)
+{
+  if (data->offset > sizeof(trajectories_memory) || data->length > sizeof(trajectories_memory) - data->offset) {
+    return ENOMEM;
+  }
+
+  if (crc32CalculateBuffer(&trajectories_memory[data->offset], data->length) != data->crc32) {
+    return EIO;
+  }
+  return 0;
+}
+
+static bool is_flying_stream(void)
+{
+  return planner.type == TRAJECTORY_TYPE_PIECEWISE_STREAM && !plan_is_stopped(&planner) && !plan_is_disabled(&planner);
+}
+
 int define_trajectory(const struct data_define_trajectory* data)
 {
   if (data->trajectoryId >= NUM_TRAJECTORY_DEFINITIONS) {
     return ENOEXEC;
   }
+
+  if (data->trajectoryId == stream_trajectory_id && is_flying_stream()) {
+    return EBUSY;
+  }
+
+  if (data->description.trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_STREAM) {
+    const uint32_t offset = data->description.trajectoryIdentifier.mem.offset;
+    const uint8_t capacity = data->description.trajectoryIdentifier.mem.n_pieces;
+    if (capacity == 0 || (offset % 4) != 0 || offset + capacity * sizeof(struct poly4d) > sizeof(trajectories_memory)) {
+      return ENOEXEC;
+    }
+    if (stream_trajectory_id != STREAM_TRAJECTORY_ID_NONE && is_flying_stream()) {
+      return EBUSY;
+    }
+
+    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    piecewise_stream_init(&stream_trajectory, (struct poly4d*)&trajectories_memory[offset], capacity);
+    stream_trajectory_id = data->trajectoryId;
+    stream_notified = false;
+    xSemaphoreGive(lockTraj);
+  } else if (data->trajectoryId == stream_trajectory_id) {
+    stream_trajectory_id = STREAM_TRAJECTORY_ID_NONE;
+  }
+
   trajectory_descriptions[data->trajectoryId] = data->description;
+  compute_trajectory_bounds(data->trajectoryId);
   return 0;
 }
 
+// Walks the pieces of a trajectory once to find its bounds. Streamed trajectories do not have bounds.
+static void compute_trajectory_bounds(const uint8_t trajectoryId)
+{
+  const struct trajectoryDescription* trajDesc = &trajectory_descriptions[trajectoryId];
+  struct trajectoryBounds* result = &trajectory_bounds[trajectoryId];
+  const uint32_t offset = trajDesc->trajectoryIdentifier.mem.offset;
+  const uint8_t nPieces = trajDesc->trajectoryIdentifier.mem.n_pieces;
+  struct poly4d piece;
+
+  result->bounds = traj_bounds_zero();
+  result->size = 0;
+  result->valid = false;
+
+  if (trajDesc->trajectoryLocation != TRAJECTORY_LOCATION_MEM || offset >= sizeof(trajectories_memory)) {
+    update_selected_bounds();
+    return;
+  }
+
+  if (trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D) {
+    if (offset + nPieces * sizeof(struct poly4d) <= sizeof(trajectories_memory)) {
+      for (int i = 0; i < nPieces; i++) {
+        memcpy(&piece, &trajectories_memory[offset + i * sizeof(piece)], sizeof(piece));
+        poly4d_bounds_approx(&piece, &result->bounds);
+      }
+      result->size = nPieces * sizeof(struct poly4d);
+      result->valid = true;
+    }
+  } else if (trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED) {
+    const uint8_t* start = &trajectories_memory[offset];
+    const uint8_t* end = &trajectories_memory[sizeof(trajectories_memory)];
+    if (end - start >= PPTRAJ_COMPRESSED_START_SIZE) {
+      struct traj_eval prevEnd;
+      const uint8_t* ptr = piecewise_compressed_decode_start(start, &prevEnd);
+      while (end - ptr >= PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE) {
+        const int pieceSize = piecewise_compressed_piece_size(ptr);
+        if (pieceSize == 0) {
+          result->size = ptr + PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE - start;
+          result->valid = true;
+          break;
+        }
+        if (end - ptr < pieceSize) {
+          break;
+        }
+        piecewise_compressed_decode_piece(ptr, &prevEnd, &piece);
+        poly4d_bounds_approx(&piece, &result->bounds);
+        prevEnd = poly4d_eval(&piece, piece.duration);
+        ptr += pieceSize;
+      }
+    }
+  }
+
+  update_selected_bounds();
+}
+
+static void update_selected_bounds(void)
+{
+  if (selected_bounds_id < NUM_TRAJECTORY_DEFINITIONS && trajectory_bounds[selected_bounds_id].valid) {
+    selected_bounds = trajectory_bounds[selected_bounds_id].bounds;
+    selected_bounds_valid = true;
+  } else {
+    selected_bounds = traj_bounds_zero();
+    selected_bounds_valid = false;
+  }
+  selected_bounds_tilt_deg = degrees(selected_bounds.max_tilt);
+}
+
+int append_trajectory(const struct data_append_trajectory* data)
+{
+  if (data->trajectoryId != stream_trajectory_id || data->offset >= sizeof(trajectories_memory)) {
+    return ENOEXEC;
+  }
+
+  int result = 0;
+  const uint8_t* src = &trajectories_memory[data->offset];
+  const uint32_t size = sizeof(trajectories_memory) - data->offset;
+
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  if (data->n_pieces > piecewise_stream_free(&stream_trajectory)) {
+    result = ENOMEM;
+  } else if (data->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D) {
+    if (data->n_pieces * sizeof(struct poly4d) > size) {
+      result = ENOEXEC;
+    } else {
+      for (int i = 0; i < data->n_pieces; i++) {
+        struct poly4d piece;
+        memcpy(&piece, &src[i * sizeof(struct poly4d)], sizeof(piece));
+        piecewise_stream_append(&stream_trajectory, &piece);
+      }
+    }
+  } else if (data->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED) {
+    if (piecewise_stream_append_compressed(&stream_trajectory, src, size, data->n_pieces) < 0) {
+      result = ENOEXEC;
+    }
+  } else {
+    result = ENOEXEC;
+  }
+
+  if (result == 0) {
+    if (data->last) {
+      piecewise_stream_set_complete(&stream_trajectory);
+    }
+    stream_notified = false;
+  }
+  xSemaphoreGive(lockTraj);
+
+  return result;
+}
+
+// Tells the client that a streamed trajectory is running low on pieces, at most once per append
+static void send_stream_status(void)
+{
+  if (stream_trajectory_id == STREAM_TRAJECTORY_ID_NONE || stream_notified) {
+    return;
+  }
+
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  const bool isFlying = is_flying_stream();
+  const bool isComplete = stream_trajectory.complete;
+  const bool isUnderrun = stream_trajectory.underrun;
+  const uint8_t nPieces = stream_trajectory.count;
+  const uint8_t nFree = piecewise_stream_free(&stream_trajectory);
+  xSemaphoreGive(lockTraj);
+
+  if (!isFlying || isComplete || (nPieces > stream_low_watermark && !isUnderrun)) {
+    return;
+  }
+
+  CRTPPacket p;
+  struct data_stream_status* status = (struct data_stream_status*)initCrtpPacket(&p, COMMAND_STREAM_STATUS);
+  status->trajectoryId = stream_trajectory_id;
+  status->n_pieces = nPieces;
+  status->n_free = nFree;
+  status->flags = (isUnderrun ? STREAM_STATUS_FLAG_UNDERRUN : 0) | (isComplete ? STREAM_STATUS_FLAG_COMPLETE : 0);
+  p.size = 1 + sizeof(*status);
+
+  if (crtpSendPacket(&p) == pdTRUE) {
+    stream_notified = true;
+  }
+}
+
 static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
   return crtpCommanderHighLevelReadTrajectory(memAddr, readLen, buffer);
 }
@@ -820,6 +1369,11 @@ int crtpCommanderHighLevelGoTo(const float x, const float y, const float z, cons
   return handleCommand(COMMAND_GO_TO, (const uint8_t*)&data);
 }
 
+int crtpCommanderHighLevelGoToWaypoints(const struct plan_waypoint* waypoints, const uint8_t nWaypoints, const float maxVelocity, const bool relative)
+{
+  return go_to_waypoints_from(ALL_GROUPS, relative, waypoints, nWaypoints, maxVelocity);
+}
+
 bool crtpCommanderHighLevelIsTrajectoryDefined(uint8_t trajectoryId)
 {
   return (
@@ -842,6 +1396,23 @@ int crtpCommanderHighLevelStartTrajectory(const uint8_t trajectoryId, const floa
   return handleCommand(COMMAND_START_TRAJECTORY, (const uint8_t*)&data);
 }
 
+int crtpCommanderHighLevelSetTrajectoryView(const struct vec shift, const struct vec scale, const float timeScale)
+{
+  struct data_set_trajectory_view data =
+  {
+    .groupMask = ALL_GROUPS,
+    .x = shift.x,
+    .y = shift.y,
+    .z = shift.z,
+    .scaleX = scale.x,
+    .scaleY = scale.y,
+    .scaleZ = scale.z,
+    .timescale = timeScale,
+  };
+
+  return handleCommand(COMMAND_SET_TRAJECTORY_VIEW, (const uint8_t*)&data);
+}
+
 int crtpCommanderHighLevelDefineTrajectory(const uint8_t trajectoryId, const crtpCommanderTrajectoryType_t type, const uint32_t offset, const uint8_t nPieces)
 {
   struct data_define_trajectory data =
@@ -856,6 +1427,30 @@ int crtpCommanderHighLevelDefineTrajectory(const uint8_t trajectoryId, const crt
   return handleCommand(COMMAND_DEFINE_TRAJECTORY, (const uint8_t*)&data);
 }
 
+int crtpCommanderHighLevelAppendTrajectory(const uint8_t trajectoryId, const crtpCommanderTrajectoryType_t type, const uint32_t offset, const uint8_t nPieces, const bool last)
+{
+  struct data_append_trajectory data =
+  {
+    .trajectoryId = trajectoryId,
+    .trajectoryType = type,
+    .offset = offset,
+    .n_pieces = nPieces,
+    .last = last,
+  };
+
+  return handleCommand(COMMAND_APPEND_TRAJECTORY, (const uint8_t*)&data);
+}
+
+bool crtpCommanderHighLevelGetTrajectoryBounds(const uint8_t trajectoryId, struct traj_bounds* bounds)
+{
+  if (trajectoryId >= NUM_TRAJECTORY_DEFINITIONS || !trajectory_bounds[trajectoryId].valid) {
+    return false;
+  }
+
+  *bounds = trajectory_bounds[trajectoryId].bounds;
+  return true;
+}
+
 uint32_t crtpCommanderHighLevelTrajectoryMemSize()
 {
   return sizeof(trajectories_memory);
@@ -868,6 +1463,20 @@ bool crtpCommanderHighLevelWriteTrajectory(const uint32_t offset, const uint32_t
   if ((offset + length) <= sizeof(trajectories_memory)) {
     memcpy(&(trajectories_memory[offset]), data, length);
     result = true;
+
+    // the bounds of trajectories in the written memory must be computed again, by defining them again
+    bool invalidated = false;
+    for (int i = 0; i < NUM_TRAJECTORY_DEFINITIONS; i++) {
+      struct trajectoryBounds* bounds = &trajectory_bounds[i];
+      const uint32_t start = trajectory_descriptions[i].trajectoryIdentifier.mem.offset;
+      if (bounds->valid && offset < start + bounds->size && offset + length > start) {
+        bounds->valid = false;
+        invalidated = true;
+      }
+    }
+    if (invalidated) {
+      update_selected_bounds();
+    }
   }
 
   return result;
@@ -914,4 +1523,78 @@ PARAM_ADD_CORE(PARAM_FLOAT, vland, &defaultLandingVelocity)
  */
 PARAM_ADD_CORE(PARAM_UINT8, groupmask, &group_mask)
 
+/**
+ * @brief Number of buffered pieces of a streamed trajectory at which the client is notified to append more pieces
+ */
+PARAM_ADD(PARAM_UINT8, streamLow, &stream_low_watermark)
+
+/**
+ * @brief Id of the trajectory to show in the hlBounds log group
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, boundsId, &selected_bounds_id, update_selected_bounds)
+
 PARAM_GROUP_STOP(hlCommander)
+
+/**
+ * State of the streamed trajectory
+ */
+LOG_GROUP_START(hlStream)
+
+/**
+ * @brief Number of buffered pieces
+ */
+LOG_ADD(LOG_UINT16, pieces, &stream_trajectory.count)
+
+/**
+ * @brief Capacity of the ring buffer in pieces
+ */
+LOG_ADD(LOG_UINT16, capacity, &stream_trajectory.capacity)
+
+/**
+ * @brief Nonzero while holding position, waiting for more pieces
+ */
+LOG_ADD(LOG_UINT8, underrun, &stream_trajectory.underrun)
+
+/**
+ * @brief Number of times the stream has run out of pieces
+ */
+LOG_ADD(LOG_UINT32, underruns, &stream_trajectory.underrun_count)
+
+LOG_GROUP_STOP(hlStream)
+
+/**
+ * Bounds of the trajectory selected by hlCommander.boundsId, computed when the trajectory was defined
+ */
+LOG_GROUP_START(hlBounds)
+
+/**
+ * @brief Nonzero if the bounds are valid, i.e. the trajectory is defined and the memory has not been written to since
+ */
+LOG_ADD(LOG_UINT8, valid, &selected_bounds_valid)
+
+/**
+ * @brief Total duration (s)
+ */
+LOG_ADD(LOG_FLOAT, duration, &selected_bounds.duration)
+
+/**
+ * @brief Maximum velocity (m/s)
+ */
+LOG_ADD(LOG_FLOAT, vel, &selected_bounds.max_vel)
+
+/**
+ * @brief Maximum acceleration (m/s^2)
+ */
+LOG_ADD(LOG_FLOAT, acc, &selected_bounds.max_acc)
+
+/**
+ * @brief Maximum jerk (m/s^3)
+ */
+LOG_ADD(LOG_FLOAT, jerk, &selected_bounds.max_jerk)
+
+/**
+ * @brief Maximum tilt of the thrust vector from vertical (deg)
+ */
+LOG_ADD(LOG_FLOAT, tilt, &selected_bounds_tilt_deg)
+
+LOG_GROUP_STOP(hlBounds)
@@ -52,6 +52,9 @@
 #include "peer_localization.h"
 
 #include "num.h"
+#include "swarmTime.h"
+#include "usec_time.h"
+#include "radiolink.h"
 
 
 #define NBR_OF_RANGES_IN_PACKET   5
@@ -65,8 +68,13 @@ typedef enum
   EXT_POSITION        = 0,
   GENERIC_TYPE        = 1,
   EXT_POSITION_PACKED = 2,
+  EXT_POSE_PACKED_TIMED = 3,
 } locsrvChannels_t;
 
+// Accept any time stamp in a timed packet if no packet has been accepted for
+// this long, the sender may have restarted.
+#define POSE_TIMESTAMP_RESYNC_MS 1000
+
 typedef struct
 {
   uint8_t type;
@@ -105,6 +113,17 @@ typedef struct {
   uint32_t quat; // compressed quaternion, see quatcompress.h
 } __attribute__((packed)) extPosePackedItem;
 
+// Up to 2 items per CRTP packet, sharing one time stamp
+typedef struct {
+  uint16_t timestampMs; // lower 16 bits of the swarm time in ms, or of the clock of the sender
+  extPosePackedItem items[];
+} __attribute__((packed)) extPosePackedTimedPacket;
+
+typedef struct {
+  uint8_t type;
+  uint64_t swarmTimeUs; // swarm time when the packet was sent
+} __attribute__((packed)) swarmTimePacket;
+
 // Struct for logging position information
 static positionMeasurement_t ext_pos;
 // Struct for logging pose information
@@ -124,14 +143,25 @@ static bool isInit = false;
 static uint8_t my_id;
 static uint16_t tickOfLastPacket; // tick when last packet was received
 
+static uint16_t maxPoseAgeMs = 50;
+static uint16_t lastPoseTimestampMs;
+static uint32_t tickOfLastPoseTimestamp;
+static bool hasPoseTimestamp = false;
+static uint32_t latePosePacketCount;
+
 static void locSrvCrtpCB(CRTPPacket* pk);
 static void extPositionHandler(CRTPPacket* pk);
 static void genericLocHandle(CRTPPacket* pk);
 static void extPositionPackedHandler(CRTPPacket* pk);
+static void extPosePackedTimedHandler(const CRTPPacket* pk);
 
 static bool isEmergencyStopRequested = false;
 static uint32_t emergencyStopWatchdogNotificationTick = 0;
 
+// Updated in the CRTP rx task, read by for instance the high level commander
+static swarmTime_t swarmTime;
+static uint8_t swarmTimeIsSynced = 0;
+
 void locSrvInit()
 {
   if (isInit) {
@@ -141,6 +171,8 @@ void locSrvInit()
   uint64_t address = configblockGetRadioAddress();
   my_id = address & 0xFF;
 
+  swarmTimeInit(&swarmTime);
+
   crtpRegisterPortCB(CRTP_PORT_LOCALIZATION, locSrvCrtpCB);
   isInit = true;
 }
@@ -158,11 +190,48 @@ static void locSrvCrtpCB(CRTPPacket* pk)
     case EXT_POSITION_PACKED:
       extPositionPackedHandler(pk);
       break;
+    case EXT_POSE_PACKED_TIMED:
+      extPosePackedTimedHandler(pk);
+      break;
     default:
       break;
   }
 }
 
+// Age of a time stamp in the recent past, that holds the lower 16 bits of the
+// swarm time in ms. The swarm time must be synchronized.
+static int16_t swarmTimeAgeMs(const uint16_t timestampMs, const uint64_t nowUs) {
+  const uint16_t nowSwarmMs = swarmTimeFromLocal(&swarmTime, nowUs) / 1000;
+  return nowSwarmMs - timestampMs;
+}
+
+// Converts a time stamp in swarm time (see swarmTimeAgeMs()) to the time of
+// the measurement in local time, as used by the estimator. Returns 0 (unknown)
+// if the swarm time is not synchronized.
+static uint32_t eventTimeFromSwarmTime(const uint16_t timestampMs) {
+  const uint64_t nowUs = usecTimestamp();
+  if (!swarmTimeIsSynchronized(&swarmTime, nowUs)) {
+    return 0;
+  }
+
+  int16_t ageMs = swarmTimeAgeMs(timestampMs, nowUs);
+  if (ageMs < 0) {
+    ageMs = 0;
+  }
+  return (uint32_t)(nowUs - ageMs * 1000);
+}
+
+// Reads the optional time stamp after the payload of a packet with a known size
+static uint32_t eventTimeFromTrailingTimestamp(const uint8_t* data, const int payloadSize, const int itemSize) {
+  if (payloadSize % itemSize != sizeof(uint16_t)) {
+    return 0;
+  }
+
+  uint16_t timestampMs;
+  memcpy(&timestampMs, &data[payloadSize - sizeof(uint16_t)], sizeof(timestampMs));
+  return eventTimeFromSwarmTime(timestampMs);
+}
+
 static void updateLogFromExtPos()
 {
   ext_pose.x = ext_pos.x;
@@ -178,6 +247,7 @@ static void extPositionHandler(CRTPPacket* pk) {
   ext_pos.z = data->z;
   ext_pos.stdDev = extPosStdDev;
   ext_pos.source = MeasurementSourceLocationService;
+  ext_pos.eventTimeUs = eventTimeFromTrailingTimestamp(pk->data, pk->size, sizeof(struct CrtpExtPosition));
   updateLogFromExtPos();
 
   estimatorEnqueuePosition(&ext_pos);
@@ -196,32 +266,84 @@ static void extPoseHandler(const CRTPPacket* pk) {
   ext_pose.quat.w = data->qw;
   ext_pose.stdDevPos = extPosStdDev;
   ext_pose.stdDevQuat = extQuatStdDev;
+  // There is no room for a time stamp in this packet
+  ext_pose.eventTimeUs = 0;
 
   estimatorEnqueuePose(&ext_pose);
   tickOfLastPacket = xTaskGetTickCount();
 }
 
+static void extPosePackedItemHandler(const extPosePackedItem* item, const uint32_t eventTimeUs) {
+  if (item->id == my_id) {
+    ext_pose.x = item->x / 1000.0f;
+    ext_pose.y = item->y / 1000.0f;
+    ext_pose.z = item->z / 1000.0f;
+    quatdecompress(item->quat, (float *)&ext_pose.quat.q0);
+    ext_pose.stdDevPos = extPosStdDev;
+    ext_pose.stdDevQuat = extQuatStdDev;
+    ext_pose.eventTimeUs = eventTimeUs;
+    estimatorEnqueuePose(&ext_pose);
+    tickOfLastPacket = xTaskGetTickCount();
+  } else {
+    ext_pos.x = item->x / 1000.0f;
+    ext_pos.y = item->y / 1000.0f;
+    ext_pos.z = item->z / 1000.0f;
+    ext_pos.stdDev = extPosStdDev;
+    peerLocalizationTellPosition(item->id, &ext_pos);
+  }
+}
+
 static void extPosePackedHandler(const CRTPPacket* pk) {
   uint8_t numItems = (pk->size - 1) / sizeof(extPosePackedItem);
+  const uint32_t eventTimeUs = eventTimeFromTrailingTimestamp(&pk->data[1], pk->size - 1, sizeof(extPosePackedItem));
   for (uint8_t i = 0; i < numItems; ++i) {
     const extPosePackedItem* item = (const extPosePackedItem*)&pk->data[1 + i * sizeof(extPosePackedItem)];
-    if (item->id == my_id) {
-      ext_pose.x = item->x / 1000.0f;
-      ext_pose.y = item->y / 1000.0f;
-      ext_pose.z = item->z / 1000.0f;
-      quatdecompress(item->quat, (float *)&ext_pose.quat.q0);
-      ext_pose.stdDevPos = extPosStdDev;
-      ext_pose.stdDevQuat = extQuatStdDev;
-      estimatorEnqueuePose(&ext_pose);
-      tickOfLastPacket = xTaskGetTickCount();
-    } else {
-      ext_pos.x = item->x / 1000.0f;
-      ext_pos.y = item->y / 1000.0f;
-      ext_pos.z = item->z / 1000.0f;
-      ext_pos.stdDev = extPosStdDev;
-      peerLocalizationTellPosition(item->id, &ext_pos);
+    extPosePackedItemHandler(item, eventTimeUs);
+  }
+}
+
+// A timed packet is late if it is not newer than the last accepted one, that
+// is if it was reordered or duplicated on the way. When the swarm time is
+// synchronized the time stamp is in swarm time, and packets older than
+// maxPoseAgeMs are late as well.
+static bool isPosePacketLate(const uint16_t timestampMs) {
+  const uint32_t nowTick = xTaskGetTickCount();
+
+  if (hasPoseTimestamp && (nowTick - tickOfLastPoseTimestamp) < M2T(POSE_TIMESTAMP_RESYNC_MS)) {
+    if ((int16_t)(timestampMs - lastPoseTimestampMs) <= 0) {
+      return true;
     }
   }
+
+  const uint64_t nowUs = usecTimestamp();
+  if (maxPoseAgeMs > 0 && swarmTimeIsSynchronized(&swarmTime, nowUs)) {
+    if (swarmTimeAgeMs(timestampMs, nowUs) > maxPoseAgeMs) {
+      return true;
+    }
+  }
+
+  lastPoseTimestampMs = timestampMs;
+  tickOfLastPoseTimestamp = nowTick;
+  hasPoseTimestamp = true;
+  return false;
+}
+
+static void extPosePackedTimedHandler(const CRTPPacket* pk) {
+  if (pk->size < sizeof(extPosePackedTimedPacket)) {
+    return;
+  }
+
+  const extPosePackedTimedPacket* packet = (const extPosePackedTimedPacket*)pk->data;
+  if (isPosePacketLate(packet->timestampMs)) {
+    latePosePacketCount++;
+    return;
+  }
+
+  const uint32_t eventTimeUs = eventTimeFromSwarmTime(packet->timestampMs);
+  uint8_t numItems = (pk->size - sizeof(extPosePackedTimedPacket)) / sizeof(extPosePackedItem);
+  for (uint8_t i = 0; i < numItems; ++i) {
+    extPosePackedItemHandler(&packet->items[i], eventTimeUs);
+  }
 }
 
 static void lpsShortLppPacketHandler(CRTPPacket* pk) {
@@ -282,7 +404,29 @@ static void lhPersistDataWorker(void* arg) {
 static void lhPersistDataHandler(CRTPPacket* pk) {
   if (pk->size >= (1 + sizeof(LhPersistArgs_t))) {
     LhPersistArgs_t* args = (LhPersistArgs_t*) &pk->data[1];
-    workerSchedule(lhPersistDataWorker, (void*)args->combinedField);
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW};
+    workerScheduleWithOptions(lhPersistDataWorker, (void*)args->combinedField, &options);
+  }
+}
+
+static void swarmTimeHandler(const CRTPPacket* pk)
+{
+  if (pk->size < sizeof(swarmTimePacket)) {
+    return;
+  }
+
+  const uint64_t localTimeUs = usecTimestamp();
+  const swarmTimePacket* packet = (const swarmTimePacket*)pk->data;
+
+  taskENTER_CRITICAL();
+  swarmTimeUpdate(&swarmTime, packet->swarmTimeUs, localTimeUs);
+  swarmTimeIsSynced = swarmTimeIsSynchronized(&swarmTime, localTimeUs);
+  taskEXIT_CRITICAL();
+
+  // The P2P slots and the other users of the shared time follow the swarm time. This task is the only writer of
+  // swarmTime, it can be read without the critical section here.
+  if (swarmTimeIsSynced) {
+    radiolinkP2PSetTimeBase(swarmTimeFromLocal(&swarmTime, usecTimestamp()));
   }
 }
 
@@ -310,6 +454,9 @@ static void genericLocHandle(CRTPPacket* pk)
     case LH_PERSIST_DATA:
       lhPersistDataHandler(pk);
       break;
+    case SWARM_TIME:
+      swarmTimeHandler(pk);
+      break;
     default:
       // Nothing here
       break;
@@ -319,6 +466,7 @@ static void genericLocHandle(CRTPPacket* pk)
 static void extPositionPackedHandler(CRTPPacket* pk)
 {
   uint8_t numItems = pk->size / sizeof(extPositionPackedItem);
+  const uint32_t eventTimeUs = eventTimeFromTrailingTimestamp(pk->data, pk->size, sizeof(extPositionPackedItem));
   for (uint8_t i = 0; i < numItems; ++i) {
     const extPositionPackedItem* item = (const extPositionPackedItem*)&pk->data[i * sizeof(extPositionPackedItem)];
     ext_pos.x = item->x / 1000.0f;
@@ -326,6 +474,7 @@ static void extPositionPackedHandler(CRTPPacket* pk)
     ext_pos.z = item->z / 1000.0f;
     ext_pos.stdDev = extPosStdDev;
     ext_pos.source = MeasurementSourceLocationService;
+    ext_pos.eventTimeUs = eventTimeUs;
     if (item->id == my_id) {
       updateLogFromExtPos();
       estimatorEnqueuePosition(&ext_pos);
@@ -404,6 +553,21 @@ uint32_t locSrvGetEmergencyStopWatchdogNotificationTick() {
   return emergencyStopWatchdogNotificationTick;
 }
 
+bool locSrvGetLocalTimeForSwarmTime(const uint32_t swarmTimeMs, uint64_t* localTimeUs) {
+  const uint64_t nowUs = usecTimestamp();
+
+  taskENTER_CRITICAL();
+  const swarmTime_t snapshot = swarmTime;
+  taskEXIT_CRITICAL();
+
+  if (!swarmTimeIsSynchronized(&snapshot, nowUs)) {
+    return false;
+  }
+
+  *localTimeUs = swarmTimeToLocalFromMs(&snapshot, swarmTimeMs, nowUs);
+  return true;
+}
+
 // This logging group is deprecated (removed after August 2023)
 LOG_GROUP_START(ext_pos)
   LOG_ADD(LOG_FLOAT, X, &ext_pos.x)
@@ -453,8 +617,30 @@ LOG_GROUP_START(locSrvZ)
  * @brief time when data was received last (ms/ticks)
  */
   LOG_ADD_CORE(LOG_UINT16, tick, &tickOfLastPacket)  // time when data was received last (ms/ticks)
+/**
+ * @brief Number of timed packed pose packets that were rejected since they arrived late
+ */
+  LOG_ADD(LOG_UINT32, poseLate, &latePosePacketCount)
 LOG_GROUP_STOP(locSrvZ)
 
+/**
+ * The swarm time base, broadcasted by the client and used to start commands at the same time in all Crazyflies
+ */
+LOG_GROUP_START(swarmTime)
+/**
+ * @brief Nonzero when the swarm time is synchronized, updated when a time stamp is received
+ */
+  LOG_ADD(LOG_UINT8, synced, &swarmTimeIsSynced)
+/**
+ * @brief Deviation between the latest received time stamp and the estimate (us)
+ */
+  LOG_ADD(LOG_FLOAT, error, &swarmTime.latestErrorUs)
+/**
+ * @brief Number of times the estimate has been restarted due to a jump in the swarm clock
+ */
+  LOG_ADD(LOG_UINT32, resync, &swarmTime.resyncCount)
+LOG_GROUP_STOP(swarmTime)
+
 /**
  * Service parameters for (external) positioning data stream through ctrp
  */
@@ -475,4 +661,8 @@ PARAM_GROUP_START(locSrv)
  * @brief Standard deviation of the quarternion data to kalman filter
  */
   PARAM_ADD_CORE(PARAM_FLOAT, extQuatStdDev, &extQuatStdDev)
+/**
+ * @brief Max age [ms] of a timed packed pose packet, measured in swarm time. 0 to only reject reordered packets (default: 50)
+ */
+  PARAM_ADD(PARAM_UINT16, maxPoseAge, &maxPoseAgeMs)
 PARAM_GROUP_STOP(locSrv)
@@ -45,6 +45,8 @@
 #include "log.h"
 #include "param.h"
 #include "static_mem.h"
+#include "crc32.h"
+#include "statsCnt.h"
 
 #if 0
 #define MEM_DEBUG(fmt, ...) DEBUG_PRINT("D/log " fmt, ## __VA_ARGS__)
@@ -64,6 +66,24 @@
 
 #define MEM_CMD_GET_NBR     1
 #define MEM_CMD_GET_INFO    2
+#define MEM_CMD_READ_STREAM  4
+#define MEM_CMD_WRITE_STREAM 5
+#define MEM_CMD_CRC          6
+#define MEM_CMD_STREAM_STATUS 7
+#define MEM_CMD_STREAM_GAPS  8
+
+// Flags of a write window
+#define MEM_STREAM_FLAG_LOSSY 0x01
+
+// Missing ranges recorded in a lossy write window
+#define MEM_STREAM_MAX_GAPS 16
+// Gaps per STREAM_GAPS reply
+#define MEM_STREAM_GAPS_PER_PACKET 3
+// Block CRCs per CRC reply
+#define MEM_CRC_PER_PACKET 6
+
+// Data bytes in a read response packet
+#define MEM_READ_DATA_LEN (MEM_MAX_LEN - 6)
 
 #define STATUS_OK 0
 
@@ -76,12 +96,43 @@ static void memReadProcess(CRTPPacket* p);
 static void createNbrResponse(CRTPPacket* p);
 static void createInfoResponse(CRTPPacket* p, uint8_t memId);
 static void createInfoResponseBody(CRTPPacket* p, uint8_t type, uint32_t memSize, const uint8_t data[8]);
+static void memReadStream(CRTPPacket* p);
+static void memWriteStreamOpen(CRTPPacket* p);
+static void memCrc(CRTPPacket* p);
+static void memStreamStatus(CRTPPacket* p);
+static void memStreamGaps(CRTPPacket* p);
 
 static bool isInit = false;
 
 static const uint8_t NoSerialNr[MEMORY_SERIAL_LENGTH] = {0, 0, 0, 0, 0, 0, 0, 0};
 static CRTPPacket packet;
 
+// Open write window, the packets written in it are acknowledged all at once
+// when it is complete. A lossy window, for instance written with broadcasts
+// to many Crazyflies, accepts gaps and is not acknowledged. The missing ranges
+// are fetched with STREAM_GAPS and written again one Crazyflie at a time.
+static struct {
+  bool active;
+  bool isLossy;
+  uint8_t memId;
+  uint8_t status;
+  uint32_t startAddr;
+  uint32_t nextAddr;
+  uint32_t endAddr;
+  crc32Context_t crc;
+
+  uint8_t gapCount;
+  bool isGapOverflow;
+  struct {
+    uint32_t addr;
+    uint32_t length;
+  } gaps[MEM_STREAM_MAX_GAPS];
+} writeStream;
+
+// Throughput of the memory port [bytes/s]
+static STATS_CNT_RATE_DEFINE(writeRate, 1000);
+static STATS_CNT_RATE_DEFINE(readRate, 1000);
+
 STATIC_MEM_TASK_ALLOC(memTask, MEM_TASK_STACKSIZE);
 
 void crtpMemInit(void)
@@ -152,6 +203,26 @@ static void memSettingsProcess(CRTPPacket* p) {
       }
       break;
 
+    case MEM_CMD_READ_STREAM:
+      memReadStream(p);
+      break;
+
+    case MEM_CMD_WRITE_STREAM:
+      memWriteStreamOpen(p);
+      break;
+
+    case MEM_CMD_CRC:
+      memCrc(p);
+      break;
+
+    case MEM_CMD_STREAM_STATUS:
+      memStreamStatus(p);
+      break;
+
+    case MEM_CMD_STREAM_GAPS:
+      memStreamGaps(p);
+      break;
+
     default:
       // Do nothing
       break;
@@ -201,9 +272,291 @@ static void createInfoResponseBody(CRTPPacket* p, uint8_t type, uint32_t memSize
 }
 
 
+static bool readMemory(uint8_t memId, uint32_t memAddr, uint8_t readLen, uint8_t* buffer) {
+  const uint8_t nrOfMems = memGetNrOfMems();
+
+  STATS_CNT_RATE_MULTI_EVENT(&readRate, readLen);
+
+  if (memId < nrOfMems) {
+    return memRead(memId, memAddr, readLen, buffer);
+  } else {
+    uint8_t owMemId = memId - nrOfMems;
+    return memReadOw(owMemId, memAddr, readLen, buffer);
+  }
+}
+
+static bool writeMemory(uint8_t memId, uint32_t memAddr, uint8_t writeLen, const uint8_t* buffer) {
+  const uint8_t nrOfMems = memGetNrOfMems();
+
+  STATS_CNT_RATE_MULTI_EVENT(&writeRate, writeLen);
+
+  if (memId < nrOfMems) {
+    return memWrite(memId, memAddr, writeLen, buffer);
+  } else {
+    uint8_t owMemId = memId - nrOfMems;
+    return memWriteOw(owMemId, memAddr, writeLen, buffer);
+  }
+}
+
+// Trailer of a stream: [cmd][memId][addr][length][status][crc32]
+static void sendStreamTrailer(CRTPPacket* p, uint8_t cmd, uint8_t memId, uint32_t memAddr, uint32_t length, uint8_t status, uint32_t crc) {
+  p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_SETTINGS_CH);
+  p->data[0] = cmd;
+  p->data[1] = memId;
+  memcpy(&p->data[2], &memAddr, 4);
+  memcpy(&p->data[6], &length, 4);
+  p->data[10] = status;
+  memcpy(&p->data[11], &crc, 4);
+  p->size = 15;
+
+  crtpSendPacketBlock(p);
+}
+
+// Read a range and send it back-to-back as read responses, without waiting
+// for a request per packet
+static void memReadStream(CRTPPacket* p) {
+  uint32_t memAddr;
+  uint32_t length;
+
+  const uint8_t memId = p->data[1];
+  memcpy(&memAddr, &p->data[2], 4);
+  memcpy(&length, &p->data[6], 4);
+
+  MEM_DEBUG("Stream read of %lu bytes\n", length);
+
+  crc32Context_t crc;
+  crc32ContextInit(&crc);
+
+  uint8_t status = STATUS_OK;
+  uint32_t address = memAddr;
+  uint32_t endAddr = memAddr + length;
+  if (endAddr < memAddr) {
+    status = EINVAL;
+    endAddr = memAddr;
+  }
+
+  while (address < endAddr) {
+    uint8_t readLen = MEM_READ_DATA_LEN;
+    if (endAddr - address < readLen) {
+      readLen = endAddr - address;
+    }
+
+    p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_READ_CH);
+    p->data[0] = memId;
+    memcpy(&p->data[1], &address, 4);
+    if (!readMemory(memId, address, readLen, &p->data[6])) {
+      status = EIO;
+      break;
+    }
+
+    p->data[5] = STATUS_OK;
+    p->size = 6 + readLen;
+    crc32Update(&crc, &p->data[6], readLen);
+    crtpSendPacketBlock(p);
+
+    address += readLen;
+  }
+
+  sendStreamTrailer(p, MEM_CMD_READ_STREAM, memId, memAddr, length, status, crc32Out(&crc));
+}
+
+static void memWriteStreamOpen(CRTPPacket* p) {
+  uint32_t memAddr;
+  uint32_t length;
+
+  const uint8_t memId = p->data[1];
+  memcpy(&memAddr, &p->data[2], 4);
+  memcpy(&length, &p->data[6], 4);
+
+  if (memAddr + length < memAddr) {
+    writeStream.active = false;
+    sendStreamTrailer(p, MEM_CMD_WRITE_STREAM, memId, memAddr, 0, EINVAL, 0);
+    return;
+  }
+
+  // The flags are optional
+  const uint8_t flags = p->size > 10 ? p->data[10] : 0;
+
+  // Opening a new window drops the current one
+  writeStream.active = length > 0;
+  writeStream.isLossy = (flags & MEM_STREAM_FLAG_LOSSY) != 0;
+  writeStream.memId = memId;
+  writeStream.status = STATUS_OK;
+  writeStream.startAddr = memAddr;
+  writeStream.nextAddr = memAddr;
+  writeStream.endAddr = memAddr + length;
+  writeStream.gapCount = 0;
+  writeStream.isGapOverflow = false;
+  crc32ContextInit(&writeStream.crc);
+
+  if (!writeStream.active && !writeStream.isLossy) {
+    sendStreamTrailer(p, MEM_CMD_WRITE_STREAM, memId, memAddr, length, STATUS_OK, crc32Out(&writeStream.crc));
+  }
+}
+
+static bool isInWriteStream(uint8_t memId, uint32_t memAddr) {
+  return writeStream.active && memId == writeStream.memId &&
+         memAddr >= writeStream.startAddr && memAddr < writeStream.endAddr;
+}
+
+static void addWriteStreamGap(uint32_t addr, uint32_t length) {
+  if (writeStream.gapCount < MEM_STREAM_MAX_GAPS) {
+    writeStream.gaps[writeStream.gapCount].addr = addr;
+    writeStream.gaps[writeStream.gapCount].length = length;
+    writeStream.gapCount++;
+  } else {
+    writeStream.isGapOverflow = true;
+  }
+}
+
+static void memWriteStreamProcess(CRTPPacket* p, uint32_t memAddr, uint8_t writeLen) {
+  uint8_t status = STATUS_OK;
+  const bool isInOrder = (memAddr == writeStream.nextAddr);
+
+  // The packets must come in order, or with gaps in a lossy window, and stay
+  // in the window
+  if ((!isInOrder && !writeStream.isLossy) || writeLen > writeStream.endAddr - memAddr) {
+    status = EINVAL;
+  } else if (!writeMemory(writeStream.memId, memAddr, writeLen, &p->data[5])) {
+    status = EIO;
+  } else if (memAddr >= writeStream.nextAddr) {
+    if (isInOrder) {
+      crc32Update(&writeStream.crc, &p->data[5], writeLen);
+    } else {
+      addWriteStreamGap(writeStream.nextAddr, memAddr - writeStream.nextAddr);
+    }
+    writeStream.nextAddr = memAddr + writeLen;
+  }
+
+  if (status != STATUS_OK || writeStream.nextAddr == writeStream.endAddr) {
+    writeStream.active = false;
+    writeStream.status = status;
+    if (!writeStream.isLossy) {
+      sendStreamTrailer(p, MEM_CMD_WRITE_STREAM, writeStream.memId, writeStream.startAddr,
+                        writeStream.nextAddr - writeStream.startAddr, status, crc32Out(&writeStream.crc));
+    }
+  }
+}
+
+// State of the latest write window, ends a lossy window so that the missing
+// ranges can be written:
+// [cmd][memId][startAddr][nextAddr][endAddr][status][gapCount][gapOverflow]
+static void memStreamStatus(CRTPPacket* p) {
+  if (writeStream.isLossy) {
+    writeStream.active = false;
+  }
+
+  p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_SETTINGS_CH);
+  p->data[0] = MEM_CMD_STREAM_STATUS;
+  p->data[1] = writeStream.memId;
+  memcpy(&p->data[2], &writeStream.startAddr, 4);
+  memcpy(&p->data[6], &writeStream.nextAddr, 4);
+  memcpy(&p->data[10], &writeStream.endAddr, 4);
+  p->data[14] = writeStream.status;
+  p->data[15] = writeStream.gapCount;
+  p->data[16] = writeStream.isGapOverflow;
+  p->size = 17;
+
+  crtpSendPacketBlock(p);
+}
+
+// Missing ranges of the latest write window, from a gap index:
+// [cmd][first][count]([addr][length])*count
+static void memStreamGaps(CRTPPacket* p) {
+  const uint8_t first = p->data[1];
+  uint8_t count = 0;
+
+  while (count < MEM_STREAM_GAPS_PER_PACKET && first + count < writeStream.gapCount) {
+    memcpy(&p->data[3 + count * 8], &writeStream.gaps[first + count].addr, 4);
+    memcpy(&p->data[3 + count * 8 + 4], &writeStream.gaps[first + count].length, 4);
+    count++;
+  }
+
+  p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_SETTINGS_CH);
+  p->data[0] = MEM_CMD_STREAM_GAPS;
+  p->data[1] = first;
+  p->data[2] = count;
+  p->size = 3 + count * 8;
+
+  crtpSendPacketBlock(p);
+}
+
+// CRC32 of a range computed on the Crazyflie, to check an image without
+// reading it back. With a block size, the CRC of each block is sent first, as
+// [cmd][memId][first block]([crc32])*n, so only the blocks that differ have to
+// be written.
+static void memCrc(CRTPPacket* p) {
+  uint32_t memAddr;
+  uint32_t length;
+  uint32_t blockSize = 0;
+  uint8_t buffer[MEM_READ_DATA_LEN];
+
+  const uint8_t memId = p->data[1];
+  memcpy(&memAddr, &p->data[2], 4);
+  memcpy(&length, &p->data[6], 4);
+  if (p->size >= 14) {
+    memcpy(&blockSize, &p->data[10], 4);
+  }
+
+  crc32Context_t crc;
+  crc32Context_t blockCrc;
+  crc32ContextInit(&crc);
+  crc32ContextInit(&blockCrc);
+
+  uint8_t status = STATUS_OK;
+  uint32_t address = memAddr;
+  uint32_t endAddr = memAddr + length;
+  if (endAddr < memAddr) {
+    status = EINVAL;
+    endAddr = memAddr;
+  }
+
+  uint16_t block = 0;
+  uint8_t blocksInPacket = 0;
+  uint32_t blockEnd = (blockSize > 0 && blockSize < endAddr - memAddr) ? memAddr + blockSize : endAddr;
+
+  while (address < endAddr) {
+    uint8_t readLen = MEM_READ_DATA_LEN;
+    if (blockEnd - address < readLen) {
+      readLen = blockEnd - address;
+    }
+
+    if (!readMemory(memId, address, readLen, buffer)) {
+      status = EIO;
+      break;
+    }
+
+    crc32Update(&crc, buffer, readLen);
+    crc32Update(&blockCrc, buffer, readLen);
+    address += readLen;
+
+    if (blockSize > 0 && address == blockEnd) {
+      const uint32_t blockCrcValue = crc32Out(&blockCrc);
+      memcpy(&p->data[4 + blocksInPacket * 4], &blockCrcValue, 4);
+      blocksInPacket++;
+      block++;
+
+      if (blocksInPacket == MEM_CRC_PER_PACKET || address == endAddr) {
+        const uint16_t firstBlock = block - blocksInPacket;
+        p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_SETTINGS_CH);
+        p->data[0] = MEM_CMD_CRC;
+        p->data[1] = memId;
+        memcpy(&p->data[2], &firstBlock, 2);
+        p->size = 4 + blocksInPacket * 4;
+        crtpSendPacketBlock(p);
+        blocksInPacket = 0;
+      }
+
+      crc32ContextInit(&blockCrc);
+      blockEnd = (endAddr - address > blockSize) ? address + blockSize : endAddr;
+    }
+  }
+
+  sendStreamTrailer(p, MEM_CMD_CRC, memId, memAddr, length, status, crc32Out(&crc));
+}
+
 static void memReadProcess(CRTPPacket* p) {
   uint32_t memAddr;
-  const uint8_t nrOfMems = memGetNrOfMems();
 
   MEM_DEBUG("Packet is MEM READ\n");
   p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_READ_CH);
@@ -213,13 +566,7 @@ static void memReadProcess(CRTPPacket* p) {
   uint8_t readLen = p->data[5];
   uint8_t* startOfData = &p->data[6];
 
-  bool result = false;
-  if (memId < nrOfMems) {
-    result = memRead(memId, memAddr, readLen, startOfData);
-  } else {
-    uint8_t owMemId = memId - nrOfMems;
-    result = memReadOw(owMemId, memAddr, readLen, startOfData);
-  }
+  bool result = readMemory(memId, memAddr, readLen, startOfData);
 
   p->data[5] = result ? STATUS_OK : EIO;
   if (result) {
@@ -233,7 +580,6 @@ static void memReadProcess(CRTPPacket* p) {
 
 static void memWriteProcess(CRTPPacket* p) {
   uint32_t memAddr;
-  const uint8_t nrOfMems = memGetNrOfMems();
 
   uint8_t memId = p->data[0];
   memcpy(&memAddr, &p->data[1], 4);
@@ -242,19 +588,33 @@ static void memWriteProcess(CRTPPacket* p) {
   uint8_t writeLen = p->size - 5;
 
   MEM_DEBUG("Packet is MEM WRITE\n");
+
+  if (isInWriteStream(memId, memAddr)) {
+    memWriteStreamProcess(p, memAddr, writeLen);
+    return;
+  }
+
   p->header = CRTP_HEADER(CRTP_PORT_MEM, MEM_WRITE_CH);
   // Dont' touch the first 5 bytes, they will be the same.
 
-  bool result = false;
-  if (memId < nrOfMems) {
-    result = memWrite(memId, memAddr, writeLen, startOfData);
-  } else {
-    uint8_t owMemId = memId - nrOfMems;
-    result = memWriteOw(owMemId, memAddr, writeLen, startOfData);
-  }
+  bool result = writeMemory(memId, memAddr, writeLen, startOfData);
 
   p->data[5] = result ? STATUS_OK : EIO;
   p->size = 6;
 
   crtpSendPacketBlock(p);
 }
+
+/**
+ * Throughput of the memory port, for instance when updating a deck firmware
+ */
+LOG_GROUP_START(memPort)
+/**
+ * @brief Bytes written to memories [bytes/s]
+ */
+STATS_CNT_RATE_LOG_ADD(wrBps, &writeRate)
+/**
+ * @brief Bytes read from memories [bytes/s]
+ */
+STATS_CNT_RATE_LOG_ADD(rdBps, &readRate)
+LOG_GROUP_STOP(memPort)
@@ -35,6 +35,7 @@
 #include "crtpservice.h"
 #include "static_mem.h"
 #include "param.h"
+#include "usec_time.h"
 
 
 typedef enum {
@@ -43,6 +44,74 @@ typedef enum {
   linkSink   = 0x02,
 } LinkNbr;
 
+// Link benchmark, controlled with commands on the source channel. Benchmark
+// packets to the Crazyflie are sent on the sink channel.
+typedef enum {
+  benchStart  = 0x01,
+  benchStop   = 0x02,
+  benchResult = 0x03,
+  benchData   = 0x10,
+} BenchCommand;
+
+typedef enum {
+  benchModeDownlink  = 0, // The Crazyflie sends data packets
+  benchModeUplink    = 1, // The host sends data packets to the sink channel
+  benchModeRoundTrip = 2, // The Crazyflie sends data packets, the host returns them to the sink channel
+} BenchMode;
+
+#define BENCH_HIST_BINS 8
+#define BENCH_MAX_RATE 2000
+#define BENCH_MAX_BURST 8
+// Time to wait for the last packets to come back in the round trip mode
+#define BENCH_ROUND_TRIP_GRACE_MS 200
+
+struct benchStart_s {
+  uint8_t cmd;
+  uint8_t mode;
+  uint8_t size;
+  uint16_t rateHz;
+  uint16_t durationMs;
+} __attribute__((packed));
+
+struct benchData_s {
+  uint8_t cmd;
+  uint16_t seq;
+  uint32_t timestampUs;
+} __attribute__((packed));
+
+struct benchResult_s {
+  uint8_t cmd;
+  uint8_t mode;
+  uint16_t txCount;
+  uint16_t rxCount;
+  uint16_t lostCount;
+  uint16_t durationMs;
+  // Round trip time in round trip mode, otherwise the time between packets.
+  // Average and max are in 10 us, the bins are [0, 1) ms, [1, 2) ms,
+  // [2, 4) ms ... [64, inf) ms
+  uint16_t avg10Us;
+  uint16_t max10Us;
+  uint16_t hist[BENCH_HIST_BINS];
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct benchResult_s) <= CRTP_MAX_DATA_SIZE, "Benchmark result does not fit a packet");
+
+static struct {
+  bool isRunning;
+  uint8_t mode;
+  uint8_t size;
+  uint16_t rateHz;
+  uint32_t startTick;
+  uint32_t durationMs;
+  uint32_t sent;
+  uint16_t seq;
+  uint16_t nextRxSeq;
+  uint32_t lastEventUs;
+  uint64_t sumUs;
+  uint32_t maxUs;
+  uint32_t samples;
+  struct benchResult_s result;
+} bench;
 
 static bool isInit=false;
 static uint16_t echoDelay=0;
@@ -66,6 +135,184 @@ bool crtpserviceTest(void)
   return isInit;
 }
 
+static uint16_t saturate16(uint32_t value)
+{
+  return value > UINT16_MAX ? UINT16_MAX : value;
+}
+
+static void benchAddSample(uint32_t us)
+{
+  uint32_t ms = us / 1000;
+  int bin = 0;
+  while (ms > 0 && bin < BENCH_HIST_BINS - 1) {
+    ms >>= 1;
+    bin++;
+  }
+
+  if (bench.result.hist[bin] < UINT16_MAX) {
+    bench.result.hist[bin]++;
+  }
+  bench.sumUs += us;
+  if (us > bench.maxUs) {
+    bench.maxUs = us;
+  }
+  bench.samples++;
+}
+
+static void benchSendResult(CRTPPacket* p)
+{
+  p->header = CRTP_HEADER(CRTP_PORT_LINK, linkSource);
+  p->size = sizeof(bench.result);
+  memcpy(p->data, &bench.result, sizeof(bench.result));
+  crtpSendPacketBlock(p);
+}
+
+static uint32_t benchElapsedMs()
+{
+  return T2M(xTaskGetTickCount() - bench.startTick);
+}
+
+static void benchFinish(CRTPPacket* p)
+{
+  const uint32_t elapsedMs = benchElapsedMs();
+  struct benchResult_s* result = &bench.result;
+  result->cmd = benchResult;
+  result->mode = bench.mode;
+  result->txCount = saturate16(bench.sent);
+  result->durationMs = saturate16(elapsedMs < bench.durationMs ? elapsedMs : bench.durationMs);
+  result->avg10Us = bench.samples ? saturate16(bench.sumUs / bench.samples / 10) : 0;
+  result->max10Us = saturate16(bench.maxUs / 10);
+  if (bench.mode == benchModeRoundTrip) {
+    result->lostCount = saturate16(bench.sent - result->rxCount);
+  }
+
+  bench.isRunning = false;
+  benchSendResult(p);
+}
+
+static void benchHandleStart(CRTPPacket* p)
+{
+  struct benchStart_s start;
+  memcpy(&start, p->data, sizeof(start));
+
+  const uint8_t size = start.size < sizeof(struct benchData_s) ? sizeof(struct benchData_s) : start.size;
+  if (start.mode > benchModeRoundTrip || size > CRTP_MAX_DATA_SIZE || start.rateHz > BENCH_MAX_RATE) {
+    return;
+  }
+
+  memset(&bench, 0, sizeof(bench));
+  bench.mode = start.mode;
+  bench.size = size;
+  bench.rateHz = start.rateHz;
+  bench.durationMs = start.durationMs;
+  bench.lastEventUs = usecTimestamp();
+  bench.startTick = xTaskGetTickCount();
+  bench.isRunning = true;
+}
+
+// Returns false if the packet is not a benchmark command
+static bool benchHandleSource(CRTPPacket* p)
+{
+  switch (p->data[0]) {
+    case benchStart:
+      if (p->size < sizeof(struct benchStart_s)) {
+        return false;
+      }
+      benchHandleStart(p);
+      return true;
+    case benchStop:
+      if (bench.isRunning) {
+        benchFinish(p);
+      }
+      return true;
+    case benchResult:
+      benchSendResult(p);
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void benchHandleSink(const CRTPPacket* p)
+{
+  if (!bench.isRunning || bench.mode == benchModeDownlink || p->size < sizeof(struct benchData_s) || p->data[0] != benchData) {
+    return;
+  }
+
+  struct benchData_s data;
+  memcpy(&data, p->data, sizeof(data));
+  const uint32_t nowUs = usecTimestamp();
+  struct benchResult_s* result = &bench.result;
+
+  if (bench.mode == benchModeRoundTrip) {
+    benchAddSample(nowUs - data.timestampUs);
+  } else {
+    // Count the gaps in the sequence numbers as lost packets
+    const uint16_t gap = data.seq - bench.nextRxSeq;
+    if (gap < UINT16_MAX / 2) {
+      result->lostCount = saturate16(result->lostCount + gap);
+      bench.nextRxSeq = data.seq + 1;
+    }
+    if (result->rxCount > 0) {
+      benchAddSample(nowUs - bench.lastEventUs);
+    }
+    bench.lastEventUs = nowUs;
+  }
+
+  if (result->rxCount < UINT16_MAX) {
+    result->rxCount++;
+  }
+}
+
+// Sends the data packets that are due. Packets are sent without blocking,
+// a full TX queue is counted as lost packets in the downlink mode.
+static void benchSendData(CRTPPacket* p)
+{
+  const uint32_t elapsedMs = benchElapsedMs();
+  if (elapsedMs >= bench.durationMs) {
+    return;
+  }
+  const uint32_t due = (uint64_t)elapsedMs * bench.rateHz / 1000 + 1;
+
+  for (int i = 0; i < BENCH_MAX_BURST && bench.sent < due; i++) {
+    const uint32_t nowUs = usecTimestamp();
+    struct benchData_s data = {
+      .cmd = benchData,
+      .seq = bench.seq++,
+      .timestampUs = nowUs,
+    };
+
+    p->header = CRTP_HEADER(CRTP_PORT_LINK, linkSource);
+    p->size = bench.size;
+    memset(p->data, 0, bench.size);
+    memcpy(p->data, &data, sizeof(data));
+    bench.sent++;
+
+    if (crtpSendPacket(p) != pdTRUE) {
+      if (bench.mode == benchModeDownlink) {
+        bench.result.lostCount = saturate16(bench.result.lostCount + 1);
+      }
+      continue;
+    }
+
+    if (bench.mode == benchModeDownlink) {
+      benchAddSample(nowUs - bench.lastEventUs);
+      bench.lastEventUs = nowUs;
+    }
+  }
+}
+
+static int benchWaitMs()
+{
+  const uint32_t elapsedMs = benchElapsedMs();
+  if (bench.mode == benchModeUplink || bench.rateHz == 0 || elapsedMs >= bench.durationMs) {
+    return 1;
+  }
+
+  const uint32_t nextMs = (uint64_t)bench.sent * 1000 / bench.rateHz;
+  return nextMs > elapsedMs ? nextMs - elapsedMs : 0;
+}
+
 static void crtpSrvTask(void* prm)
 {
   static CRTPPacket p;
@@ -73,27 +320,47 @@ static void crtpSrvTask(void* prm)
   crtpInitTaskQueue(CRTP_PORT_LINK);
 
   while(1) {
-    crtpReceivePacketBlock(CRTP_PORT_LINK, &p);
-
-    switch (p.channel)
-    {
-      case linkEcho:
-        if (echoDelay > 0) {
-          vTaskDelay(M2T(echoDelay));
-        }
-        crtpSendPacketBlock(&p);
-        break;
-      case linkSource:
-        p.size = CRTP_MAX_DATA_SIZE;
-        bzero(p.data, CRTP_MAX_DATA_SIZE);
-        strcpy((char*)p.data, "Bitcraze Crazyflie");
-        crtpSendPacketBlock(&p);
-        break;
-      case linkSink:
-        /* Ignore packet */
-        break;
-      default:
-        break;
+    bool isReceived;
+    if (bench.isRunning) {
+      isReceived = crtpReceivePacketWait(CRTP_PORT_LINK, &p, benchWaitMs()) == pdTRUE;
+    } else {
+      isReceived = crtpReceivePacketBlock(CRTP_PORT_LINK, &p) == pdTRUE;
+    }
+
+    if (isReceived) {
+      switch (p.channel)
+      {
+        case linkEcho:
+          if (echoDelay > 0) {
+            vTaskDelay(M2T(echoDelay));
+          }
+          crtpSendPacketBlock(&p);
+          break;
+        case linkSource:
+          if (p.size > 0 && benchHandleSource(&p)) {
+            break;
+          }
+          p.size = CRTP_MAX_DATA_SIZE;
+          bzero(p.data, CRTP_MAX_DATA_SIZE);
+          strcpy((char*)p.data, "Bitcraze Crazyflie");
+          crtpSendPacketBlock(&p);
+          break;
+        case linkSink:
+          benchHandleSink(&p);
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (bench.isRunning) {
+      if (bench.mode != benchModeUplink && bench.rateHz > 0) {
+        benchSendData(&p);
+      }
+      const uint32_t graceMs = bench.mode == benchModeRoundTrip ? BENCH_ROUND_TRIP_GRACE_MS : 0;
+      if (benchElapsedMs() >= bench.durationMs + graceMs) {
+        benchFinish(&p);
+      }
     }
   }
 }
@@ -34,6 +34,7 @@
 #include "debug.h"
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "aideck.h"
 #include "deck.h"
 #include "esp_deck_flasher.h"
@@ -49,29 +50,69 @@ static uint8_t sendBuffer[ESP_SLIP_DATA_START + ESP_SLIP_MTU + ESP_SLIP_STOP_COD
 static uint8_t overshoot;
 static uint32_t sendBufferIndex;
 
+static bool isCompressed;
+// Offset of the image data in the written binary, after the header of a compressed image
+static uint32_t dataStart;
+// The last flash buffer has been sent and its response has not been received yet
+static bool isResponsePending;
+static uint32_t startTimeMs;
 
-static bool initialize() {
+static uint8_t flashMd5[16];
+
+
+static bool connect() {
   if (!espRomBootloaderSync(&sendBuffer[0])){
-    DEBUG_PRINT("Write failed - cannot sync with bootloader\n");
+    DEBUG_PRINT("Cannot sync with bootloader\n");
     return false;
   }
 
   if (!espRomBootloaderSpiAttach(&sendBuffer[0])){
-    DEBUG_PRINT("Write failed - cannot attach SPI flash\n");
+    DEBUG_PRINT("Cannot attach SPI flash\n");
     return false;
   }
 
-  numberOfFlashBuffers = 1 + (espDeckFlasherNewBinarySize - 1) / ESP_SLIP_MTU;
-  // It should be possible to send the actual binary size to the ESP but we get flashing errors sometimes for
-  // the last (smaller) buffer. Solve it by sending full buffers.
-  const uint32_t quantizedSize = numberOfFlashBuffers * ESP_SLIP_MTU;
-  if (!espRomBootloaderFlashBegin(&sendBuffer[0], numberOfFlashBuffers, quantizedSize, ESP_FW_ADDRESS)) {
+  return true;
+}
+
+static bool initialize(const uint8_t writeLen, const uint8_t *buffer) {
+  if (!connect()) {
+    DEBUG_PRINT("Write failed\n");
+    return false;
+  }
+
+  espDeckFlasherDeflateHeader_t header;
+  isCompressed = false;
+  dataStart = 0;
+  if (writeLen >= sizeof(header)) {
+    memcpy(&header, buffer, sizeof(header));
+    if (header.magic == ESP_DECK_FLASHER_DEFLATE_MAGIC) {
+      isCompressed = true;
+      dataStart = sizeof(header);
+    }
+  }
+
+  const uint32_t dataSize = espDeckFlasherNewBinarySize - dataStart;
+  numberOfFlashBuffers = 1 + (dataSize - 1) / ESP_SLIP_MTU;
+
+  bool isStarted;
+  if (isCompressed) {
+    isStarted = espRomBootloaderFlashDeflBegin(&sendBuffer[0], numberOfFlashBuffers, header.uncompressedSize, ESP_FW_ADDRESS);
+  } else {
+    // It should be possible to send the actual binary size to the ESP but we get flashing errors sometimes for
+    // the last (smaller) buffer. Solve it by sending full buffers.
+    const uint32_t quantizedSize = numberOfFlashBuffers * ESP_SLIP_MTU;
+    isStarted = espRomBootloaderFlashBegin(&sendBuffer[0], numberOfFlashBuffers, quantizedSize, ESP_FW_ADDRESS);
+  }
+
+  if (!isStarted) {
     DEBUG_PRINT("Failed to start flashing\n");
     return false;
   }
 
   sequenceNumber = 0;
   sendBufferIndex = 0;
+  isResponsePending = false;
+  startTimeMs = T2M(xTaskGetTickCount());
 
   return true;
 }
@@ -99,36 +140,94 @@ static void appendOvershootToSendBuffer(const uint8_t writeLen, const uint8_t *b
   }
 }
 
+// The ESP writes a flash buffer while the next one is received from the radio, only its response is waited for
+// before the next buffer is sent
+static bool waitForPendingResponse() {
+  if (isResponsePending) {
+    isResponsePending = false;
+    if (!espRomBootloaderFlashDataWaitForResponse()) {
+      DEBUG_PRINT("Flash write failed\n");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool sendFlashBuffer() {
+  if (!waitForPendingResponse()) {
+    return false;
+  }
+
+  espRomBootloaderFlashDataSend(sendBuffer, sendBufferIndex, sequenceNumber, isCompressed);
+  isResponsePending = true;
+  sequenceNumber++;
+
+  return true;
+}
+
 
 bool espDeckFlasherWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t *buffer, const DeckMemDef_t* memDef) {
+  uint8_t dataLen = writeLen;
+  const uint8_t *data = buffer;
+
   if (memAddr == 0) {
-    if (!initialize()) {
+    if (!initialize(writeLen, buffer)) {
       return false;
     }
+
+    // Skip the header of a compressed image
+    dataLen -= dataStart;
+    data += dataStart;
   }
 
-  appendToSendBuffer(writeLen, buffer);
+  appendToSendBuffer(dataLen, data);
 
   const bool isSendBufferFull = (sendBufferIndex == ESP_SLIP_MTU);
   if (isSendBufferFull) {
-    if (!espRomBootloaderFlashData(sendBuffer, sendBufferIndex, sequenceNumber)) {
-      DEBUG_PRINT("Flash write failed\n");
+    if (!sendFlashBuffer()) {
       return false;
     }
     sendBufferIndex = 0;
-    sequenceNumber++;
 
-    appendOvershootToSendBuffer(writeLen, buffer);
+    appendOvershootToSendBuffer(dataLen, data);
   }
 
   // If this is the last radio packet and we have a half full flash buffer, send it (with padding) to the ESP
   const bool isLastPacket = ((memAddr + writeLen) == espDeckFlasherNewBinarySize);
-  if (isLastPacket && sendBufferIndex) {
-    if (!espRomBootloaderFlashData(sendBuffer, sendBufferIndex, sequenceNumber)) {
-      DEBUG_PRINT("Flash write failed\n");
+  if (isLastPacket) {
+    if (sendBufferIndex && !sendFlashBuffer()) {
+      return false;
+    }
+
+    if (!waitForPendingResponse()) {
+      return false;
+    }
+
+    DEBUG_PRINT("Flashed %lu bytes%s in %lu ms\n", (unsigned long)espDeckFlasherNewBinarySize,
+                isCompressed ? " (compressed)" : "", (unsigned long)(T2M(xTaskGetTickCount()) - startTimeMs));
+  }
+
+  return true;
+}
+
+bool espDeckFlasherRead(const uint32_t memAddr, const uint8_t readLen, uint8_t *buffer) {
+  if (memAddr + readLen > sizeof(flashMd5)) {
+    return false;
+  }
+
+  // The digest is read from the ESP when the first byte is read, and kept for the rest of it
+  if (memAddr == 0) {
+    if (!connect()) {
+      return false;
+    }
+
+    if (!espRomBootloaderFlashMd5(&sendBuffer[0], ESP_FW_ADDRESS, espDeckFlasherNewBinarySize, flashMd5)) {
+      DEBUG_PRINT("Failed to read flash MD5\n");
       return false;
     }
   }
 
+  memcpy(buffer, &flashMd5[memAddr], readLen);
   return true;
 }
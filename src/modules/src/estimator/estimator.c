@@ -1,28 +1,31 @@
 #include "stm32fxxx.h"
 #include "FreeRTOS.h"
-#include "queue.h"
-#include "static_mem.h"
+#include "task.h"
 
 #define DEBUG_MODULE "ESTIMATOR"
 #include "debug.h"
 
 #include "cfassert.h"
 #include "estimator.h"
+#include "measurement_queue.h"
 #include "estimator_complementary.h"
 #include "estimator_kalman.h"
 #include "estimator_ukf.h"
 #include "log.h"
 #include "statsCnt.h"
+#include "queuestats.h"
 #include "eventtrigger.h"
 #include "quatcompress.h"
+#include "worker.h"
+#include "cycle_counter.h"
 
 #define DEFAULT_ESTIMATOR StateEstimatorTypeComplementary
 static StateEstimatorType currentEstimator = StateEstimatorTypeAutoSelect;
 
 
-#define MEASUREMENTS_QUEUE_SIZE (20)
-static xQueueHandle measurementsQueue;
-STATIC_MEM_QUEUE_ALLOC(measurementsQueue, MEASUREMENTS_QUEUE_SIZE, sizeof(measurement_t));
+// Accessed from tasks as well as interrupts, protected by critical sections
+static measurementQueue_t measurementsQueue;
+static bool isMeasurementsQueueInit = false;
 
 // Statistics
 #define ONE_SECOND 1000
@@ -43,11 +46,92 @@ EVENTTRIGGER(estGyroscope)
 EVENTTRIGGER(estAcceleration)
 EVENTTRIGGER(estBarometer)
 
+#ifdef CONFIG_STABILIZER_FIXED_DISPATCH
+
+// The estimator is fixed at compile time. The calls are direct and switch requests, for instance from decks that
+// require another estimator, are ignored.
+#if defined(CONFIG_ESTIMATOR_KALMAN)
+  #define FIXED_ESTIMATOR StateEstimatorTypeKalman
+  #define FIXED_ESTIMATOR_NAME "Kalman"
+  #define fixedEstimatorInit estimatorKalmanInit
+  #define fixedEstimatorTest estimatorKalmanTest
+  #define fixedEstimatorUpdate estimatorKalman
+#elif defined(CONFIG_ESTIMATOR_UKF)
+  #define FIXED_ESTIMATOR StateEstimatorTypeUkf
+  #define FIXED_ESTIMATOR_NAME "Error State UKF"
+  #define fixedEstimatorInit errorEstimatorUkfInit
+  #define fixedEstimatorTest errorEstimatorUkfTest
+  #define fixedEstimatorUpdate errorEstimatorUkf
+#elif defined(CONFIG_ESTIMATOR_COMPLEMENTARY)
+  #define FIXED_ESTIMATOR StateEstimatorTypeComplementary
+  #define FIXED_ESTIMATOR_NAME "Complementary"
+  #define fixedEstimatorInit estimatorComplementaryInit
+  #define fixedEstimatorTest estimatorComplementaryTest
+  #define fixedEstimatorUpdate estimatorComplementary
+#else
+  #error "CONFIG_STABILIZER_FIXED_DISPATCH requires one estimator to be selected"
+#endif
+
+void stateEstimatorInit(StateEstimatorType estimator) {
+  measurementQueueInit(&measurementsQueue);
+  isMeasurementsQueueInit = true;
+
+  currentEstimator = FIXED_ESTIMATOR;
+  fixedEstimatorInit();
+  DEBUG_PRINT("Using %s (%d) estimator, fixed at compile time\n", stateEstimatorGetName(), currentEstimator);
+}
+
+void stateEstimatorSwitchTo(StateEstimatorType estimator) {
+  if (estimator != FIXED_ESTIMATOR && estimator != StateEstimatorTypeAutoSelect) {
+    DEBUG_PRINT("Estimator %d requested, ignored\n", estimator);
+  }
+}
+
+void stateEstimatorRequestSwitch(StateEstimatorType estimator, const state_t *state) {
+  stateEstimatorSwitchTo(estimator);
+}
+
+bool stateEstimatorIsSwitching(void) {
+  return false;
+}
+
+StateEstimatorType stateEstimatorGetType(void) {
+  return FIXED_ESTIMATOR;
+}
+
+bool stateEstimatorTest(void) {
+  return fixedEstimatorTest();
+}
+
+void stateEstimator(state_t *state, const stabilizerStep_t tick) {
+  fixedEstimatorUpdate(state, tick);
+}
+
+const char* stateEstimatorGetName() {
+  return FIXED_ESTIMATOR_NAME;
+}
+
+#else
+
 static void initEstimator(const StateEstimatorType estimator);
 static void deinitEstimator(const StateEstimatorType estimator);
 
+// Switch in progress, the pending estimator is warm started by the worker while the current one keeps running
+static volatile bool isSwitching;
+static volatile bool isPendingReady;
+static StateEstimatorType pendingEstimator;
+static state_t pendingState;
+static uint32_t switchRequestMs;
+// Time from the switch request to the first tick with the new estimator [ms], and its cost in the stabilizer loop
+static uint32_t switchLatencyMs;
+static uint32_t switchCycles;
+
 typedef struct {
   void (*init)(void);
+  // Optional, initializes the estimator from the estimate of the running estimator. Called from the worker task,
+  // the estimator must protect its state from its own tasks. Estimators that implement it are switched to without
+  // blocking the stabilizer loop, see stateEstimatorRequestSwitch().
+  void (*warmStart)(const state_t *state);
   void (*deinit)(void);
   bool (*test)(void);
   void (*update)(state_t *state, const stabilizerStep_t stabilizerStep);
@@ -59,6 +143,7 @@ typedef struct {
 static EstimatorFcns estimatorFunctions[] = {
     {
         .init = NOT_IMPLEMENTED,
+        .warmStart = NOT_IMPLEMENTED,
         .deinit = NOT_IMPLEMENTED,
         .test = NOT_IMPLEMENTED,
         .update = NOT_IMPLEMENTED,
@@ -66,6 +151,7 @@ static EstimatorFcns estimatorFunctions[] = {
     }, // Any estimator
     {
         .init = estimatorComplementaryInit,
+        .warmStart = NOT_IMPLEMENTED,
         .deinit = NOT_IMPLEMENTED,
         .test = estimatorComplementaryTest,
         .update = estimatorComplementary,
@@ -74,6 +160,7 @@ static EstimatorFcns estimatorFunctions[] = {
 #ifdef CONFIG_ESTIMATOR_KALMAN_ENABLE
     {
         .init = estimatorKalmanInit,
+        .warmStart = estimatorKalmanWarmStart,
         .deinit = NOT_IMPLEMENTED,
         .test = estimatorKalmanTest,
         .update = estimatorKalman,
@@ -83,6 +170,7 @@ static EstimatorFcns estimatorFunctions[] = {
 #ifdef CONFIG_ESTIMATOR_UKF_ENABLE
     {
 	    .init = errorEstimatorUkfInit,
+	    .warmStart = NOT_IMPLEMENTED,
 	    .deinit = NOT_IMPLEMENTED,
 	    .test = errorEstimatorUkfTest,
 	    .update = errorEstimatorUkf,
@@ -92,6 +180,7 @@ static EstimatorFcns estimatorFunctions[] = {
 #ifdef CONFIG_ESTIMATOR_OOT
     {
         .init = estimatorOutOfTreeInit,
+        .warmStart = NOT_IMPLEMENTED,
         .deinit = NOT_IMPLEMENTED,
         .test = estimatorOutOfTreeTest,
         .update = estimatorOutOfTree,
@@ -101,15 +190,12 @@ static EstimatorFcns estimatorFunctions[] = {
 };
 
 void stateEstimatorInit(StateEstimatorType estimator) {
-  measurementsQueue = STATIC_MEM_QUEUE_CREATE(measurementsQueue);
+  measurementQueueInit(&measurementsQueue);
+  isMeasurementsQueueInit = true;
   stateEstimatorSwitchTo(estimator);
 }
 
-void stateEstimatorSwitchTo(StateEstimatorType estimator) {
-  if (estimator < 0 || estimator >= StateEstimatorType_COUNT) {
-    return;
-  }
-
+static StateEstimatorType resolveEstimatorType(const StateEstimatorType estimator) {
   StateEstimatorType newEstimator = estimator;
 
   if (StateEstimatorTypeAutoSelect == newEstimator) {
@@ -118,7 +204,7 @@ void stateEstimatorSwitchTo(StateEstimatorType estimator) {
 
   #if defined(CONFIG_ESTIMATOR_KALMAN)
     #define ESTIMATOR StateEstimatorTypeKalman
-  #elif defined(CONFIG_UKF_KALMAN)
+  #elif defined(CONFIG_ESTIMATOR_UKF)
     #define ESTIMATOR StateEstimatorTypeUkf
   #elif defined(CONFIG_ESTIMATOR_COMPLEMENTARY)
     #define ESTIMATOR StateEstimatorTypeComplementary
@@ -132,6 +218,16 @@ void stateEstimatorSwitchTo(StateEstimatorType estimator) {
     newEstimator = forcedEstimator;
   }
 
+  return newEstimator;
+}
+
+void stateEstimatorSwitchTo(StateEstimatorType estimator) {
+  if (estimator < 0 || estimator >= StateEstimatorType_COUNT) {
+    return;
+  }
+
+  StateEstimatorType newEstimator = resolveEstimatorType(estimator);
+
   initEstimator(newEstimator);
   StateEstimatorType previousEstimator = currentEstimator;
   currentEstimator = newEstimator;
@@ -140,6 +236,60 @@ void stateEstimatorSwitchTo(StateEstimatorType estimator) {
   DEBUG_PRINT("Using %s (%d) estimator\n", stateEstimatorGetName(), currentEstimator);
 }
 
+static void warmStartWorker(void* arg) {
+  estimatorFunctions[pendingEstimator].warmStart(&pendingState);
+  isPendingReady = true;
+}
+
+void stateEstimatorRequestSwitch(StateEstimatorType estimator, const state_t *state) {
+  if (estimator < 0 || estimator >= StateEstimatorType_COUNT || isSwitching) {
+    return;
+  }
+
+  StateEstimatorType newEstimator = resolveEstimatorType(estimator);
+  if (newEstimator == currentEstimator) {
+    return;
+  }
+
+  switchRequestMs = T2M(xTaskGetTickCount());
+
+  if (estimatorFunctions[newEstimator].warmStart) {
+    pendingEstimator = newEstimator;
+    pendingState = *state;
+    isPendingReady = false;
+    isSwitching = true;
+    if (workerScheduleWithOptions(warmStartWorker, NULL, &(workerOptions_t){.priority = WORKER_PRIORITY_NORMAL}) == 0) {
+      return;
+    }
+    isSwitching = false;
+  }
+
+  // No warm start, or the worker queue is full: switch synchronously, as stateEstimatorSwitchTo()
+  const uint32_t start = cycleCounterGet();
+  stateEstimatorSwitchTo(newEstimator);
+  switchCycles = cycleCounterElapsed(start);
+  switchLatencyMs = T2M(xTaskGetTickCount()) - switchRequestMs;
+}
+
+bool stateEstimatorIsSwitching(void) {
+  return isSwitching;
+}
+
+// Called from the stabilizer loop when the warm started estimator is ready, the swap is a change of the current type
+static void completeSwitch() {
+  const uint32_t start = cycleCounterGet();
+
+  StateEstimatorType previousEstimator = currentEstimator;
+  currentEstimator = pendingEstimator;
+  isPendingReady = false;
+  isSwitching = false;
+  deinitEstimator(previousEstimator);
+
+  switchCycles = cycleCounterElapsed(start);
+  switchLatencyMs = T2M(xTaskGetTickCount()) - switchRequestMs;
+  DEBUG_PRINT("Using %s (%d) estimator, warm started in %lu ms\n", stateEstimatorGetName(), currentEstimator, switchLatencyMs);
+}
+
 StateEstimatorType stateEstimatorGetType(void) {
   return currentEstimator;
 }
@@ -161,6 +311,10 @@ bool stateEstimatorTest(void) {
 }
 
 void stateEstimator(state_t *state, const stabilizerStep_t tick) {
+  if (isPendingReady) {
+    completeSwitch();
+  }
+
   estimatorFunctions[currentEstimator].update(state, tick);
 }
 
@@ -168,25 +322,42 @@ const char* stateEstimatorGetName() {
   return estimatorFunctions[currentEstimator].name;
 }
 
+#endif // CONFIG_STABILIZER_FIXED_DISPATCH
+
+
+// Must be called in a critical section
+static bool pushMeasurement(const measurement_t *measurement, const uint32_t nowMs) {
+  const uint8_t depthBefore = measurementsQueue.depth;
+  const bool result = measurementQueuePush(&measurementsQueue, measurement, nowMs);
+  if (measurementsQueue.depth > depthBefore) {
+    queueStatsUpdate(queueStatsEstimator, depthBefore, measurementsQueue.depth - depthBefore, 0);
+  } else if (!result) {
+    queueStatsFull(queueStatsEstimator);
+  }
+
+  return result;
+}
 
 void estimatorEnqueue(const measurement_t *measurement) {
-  if (!measurementsQueue) {
+  if (!isMeasurementsQueueInit) {
     return;
   }
 
-  portBASE_TYPE result;
+  bool result;
   bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
   if (isInInterrupt) {
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-    result = xQueueSendFromISR(measurementsQueue, measurement, &xHigherPriorityTaskWoken);
-    if (xHigherPriorityTaskWoken == pdTRUE) {
-      portYIELD();
-    }
+    const uint32_t nowMs = T2M(xTaskGetTickCountFromISR());
+    UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    result = pushMeasurement(measurement, nowMs);
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
   } else {
-    result = xQueueSend(measurementsQueue, measurement, 0);
+    const uint32_t nowMs = T2M(xTaskGetTickCount());
+    taskENTER_CRITICAL();
+    result = pushMeasurement(measurement, nowMs);
+    taskEXIT_CRITICAL();
   }
 
-  if (result == pdTRUE) {
+  if (result) {
     STATS_CNT_RATE_EVENT(&measurementAppendedCounter);
   } else {
     STATS_CNT_RATE_EVENT(&measurementNotAppendedCounter);
@@ -256,10 +427,61 @@ void estimatorEnqueue(const measurement_t *measurement) {
 }
 
 bool estimatorDequeue(measurement_t *measurement) {
-  return pdTRUE == xQueueReceive(measurementsQueue, measurement, 0);
+  const uint32_t nowMs = T2M(xTaskGetTickCount());
+
+  taskENTER_CRITICAL();
+  const uint8_t depthBefore = measurementsQueue.depth;
+  bool result = measurementQueuePop(&measurementsQueue, measurement, nowMs);
+  // Stale measurements that are discarded also leave the queue
+  if (measurementsQueue.depth != depthBefore) {
+    queueStatsUpdate(queueStatsEstimator, depthBefore, 0, depthBefore - measurementsQueue.depth);
+  }
+  taskEXIT_CRITICAL();
+
+  return result;
 }
 
 LOG_GROUP_START(estimator)
   STATS_CNT_RATE_LOG_ADD(rtApnd, &measurementAppendedCounter)
   STATS_CNT_RATE_LOG_ADD(rtRej, &measurementNotAppendedCounter)
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
+  /**
+  * @brief Time from the latest estimator switch request to the first tick with the new estimator [ms]
+  */
+  LOG_ADD(LOG_UINT32, swLatency, &switchLatencyMs)
+  /**
+  * @brief CPU cycles the latest estimator switch took in the stabilizer loop
+  */
+  LOG_ADD(LOG_UINT32, swCycles, &switchCycles)
+#endif
 LOG_GROUP_STOP(estimator)
+
+// Adds the number of dropped measurements and the max queue depth for one measurement type
+#define QUEUE_STATS_LOG_ADD(NAME, TYPE) \
+  LOG_ADD(LOG_UINT32, NAME##Drop, &measurementsQueue.stats[TYPE].dropped) \
+  LOG_ADD(LOG_UINT8, NAME##Dpth, &measurementsQueue.stats[TYPE].maxDepth)
+
+/**
+ * Statistics of the measurement queue, per measurement type. Drop is the
+ * total number of measurements that were rejected, evicted by measurements
+ * with higher priority or discarded since they were too old when dequeued.
+ * Dpth is the max number of measurements of the type in the queue.
+ */
+LOG_GROUP_START(estQueue)
+  /**
+  * @brief Current number of measurements in the queue
+  */
+  LOG_ADD(LOG_UINT8, depth, &measurementsQueue.depth)
+  QUEUE_STATS_LOG_ADD(tdoa, MeasurementTypeTDOA)
+  QUEUE_STATS_LOG_ADD(pos, MeasurementTypePosition)
+  QUEUE_STATS_LOG_ADD(pose, MeasurementTypePose)
+  QUEUE_STATS_LOG_ADD(dist, MeasurementTypeDistance)
+  QUEUE_STATS_LOG_ADD(tof, MeasurementTypeTOF)
+  QUEUE_STATS_LOG_ADD(height, MeasurementTypeAbsoluteHeight)
+  QUEUE_STATS_LOG_ADD(flow, MeasurementTypeFlow)
+  QUEUE_STATS_LOG_ADD(yawErr, MeasurementTypeYawError)
+  QUEUE_STATS_LOG_ADD(sweep, MeasurementTypeSweepAngle)
+  QUEUE_STATS_LOG_ADD(gyro, MeasurementTypeGyroscope)
+  QUEUE_STATS_LOG_ADD(acc, MeasurementTypeAcceleration)
+  QUEUE_STATS_LOG_ADD(baro, MeasurementTypeBarometer)
+LOG_GROUP_STOP(estQueue)
@@ -29,6 +29,7 @@
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "task.h"
 
 #include "stabilizer.h"
 #include "estimator_complementary.h"
@@ -37,21 +38,44 @@
 #include "sensors.h"
 #include "stabilizer_types.h"
 #include "static_mem.h"
+#include "cycle_counter.h"
+#include "statsCnt.h"
+#include "log.h"
 
 static Axis3f gyro;
 static Axis3f acc;
 static baro_t baro;
 static tofMeasurement_t tof;
 
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_FAST_ATTITUDE
+// The attitude is fused on every tick, the Euler angles and the vertical acceleration are only
+// computed at the rate the attitude controllers use them
+#define FUSION_UPDATE_RATE RATE_MAIN_LOOP
+#define ATTITUDE_UPDATE_RATE ATTITUDE_RATE
+#define sensfusion6Update sensfusion6UpdateQFast
+#else
+#define FUSION_UPDATE_RATE RATE_250_HZ
 #define ATTITUDE_UPDATE_RATE RATE_250_HZ
-#define ATTITUDE_UPDATE_DT 1.0/ATTITUDE_UPDATE_RATE
+#define sensfusion6Update sensfusion6UpdateQ
+#endif
+#define FUSION_UPDATE_DT (1.0f/FUSION_UPDATE_RATE)
+#define ATTITUDE_UPDATE_DT (1.0f/ATTITUDE_UPDATE_RATE)
 
 #define POS_UPDATE_RATE RATE_100_HZ
 #define POS_UPDATE_DT 1.0/POS_UPDATE_RATE
 
+// CPU cycles of the attitude fusion and attitude output
+static statsCntMinMaxAvg_t attitudeCycles;
+
 void estimatorComplementaryInit(void)
 {
   sensfusion6Init();
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_INCREMENTAL_ALTITUDE
+  positionAltitudeReset();
+#endif
+
+  cycleCounterInit();
+  statsCntMinMaxAvgInit(&attitudeCycles, 1000);
 }
 
 bool estimatorComplementaryTest(void)
@@ -78,21 +102,32 @@ void estimatorComplementary(state_t *state, const stabilizerStep_t stabilizerSte
       break;
     case MeasurementTypeBarometer:
       baro = m.data.barometer.baro;
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_INCREMENTAL_ALTITUDE
+      // The baro samples have no time stamp, they are used as soon as they arrive
+      positionAltitudeAddBaro(&baro, xTaskGetTickCount());
+#endif
       break;
     case MeasurementTypeTOF:
       tof = m.data.tof;
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_INCREMENTAL_ALTITUDE
+      positionAltitudeAddTof(&tof);
+#endif
       break;
     default:
       break;
     }
   }
 
+  const uint32_t start = cycleCounterGet();
+
   // Update filter
-  if (RATE_DO_EXECUTE(ATTITUDE_UPDATE_RATE, stabilizerStep)) {
-    sensfusion6UpdateQ(gyro.x, gyro.y, gyro.z,
-                        acc.x, acc.y, acc.z,
-                        ATTITUDE_UPDATE_DT);
+  if (RATE_DO_EXECUTE(FUSION_UPDATE_RATE, stabilizerStep)) {
+    sensfusion6Update(gyro.x, gyro.y, gyro.z,
+                      acc.x, acc.y, acc.z,
+                      FUSION_UPDATE_DT);
+  }
 
+  if (RATE_DO_EXECUTE(ATTITUDE_UPDATE_RATE, stabilizerStep)) {
     // Save attitude, adjusted for the legacy CF2 body coordinate system
     sensfusion6GetEulerRPY(&state->attitude.roll, &state->attitude.pitch, &state->attitude.yaw);
 
@@ -108,10 +143,33 @@ void estimatorComplementary(state_t *state, const stabilizerStep_t stabilizerSte
                                                     acc.y,
                                                     acc.z);
 
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_INCREMENTAL_ALTITUDE
+    positionAltitudeAddAcc(state->acc.z, xTaskGetTickCount());
+#else
     positionUpdateVelocity(state->acc.z, ATTITUDE_UPDATE_DT);
+#endif
+  }
+
+  if (RATE_DO_EXECUTE(FUSION_UPDATE_RATE, stabilizerStep)) {
+    statsCntMinMaxAvgAdd(&attitudeCycles, cycleCounterElapsed(start));
+    statsCntMinMaxAvgUpdate(&attitudeCycles, T2M(xTaskGetTickCount()));
   }
 
   if (RATE_DO_EXECUTE(POS_UPDATE_RATE, stabilizerStep)) {
+#ifdef CONFIG_ESTIMATOR_COMPLEMENTARY_INCREMENTAL_ALTITUDE
+    positionAltitudeGetEstimate(state);
+#else
     positionEstimate(state, &baro, &tof, POS_UPDATE_DT, stabilizerStep);
+#endif
   }
 }
+
+/**
+ * Log variables of the complementary estimator
+ */
+LOG_GROUP_START(estComp)
+/**
+ * @brief Min, average and max CPU cycles of an attitude update, including the Euler angles on the ticks they are computed
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(attCycles, &attitudeCycles)
+LOG_GROUP_STOP(estComp)
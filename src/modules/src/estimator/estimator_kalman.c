@@ -56,6 +56,8 @@
  * 2021.03.15, Wolfgang Hoenig: Refactored queue handling
  */
 
+#include <assert.h>
+
 #include "kalman_core.h"
 #include "kalman_supervisor.h"
 
@@ -77,6 +79,7 @@
 
 #include "statsCnt.h"
 #include "rateSupervisor.h"
+#include "cycle_counter.h"
 
 // Measurement models
 #include "mm_distance.h"
@@ -92,6 +95,9 @@
 #include "mm_tdoa_robust.h"
 #include "mm_distance_robust.h"
 
+#include "kalman_history.h"
+#include "usec_time.h"
+
 #define DEBUG_MODULE "ESTKALMAN"
 #include "debug.h"
 #include "cfassert.h"
@@ -100,19 +106,48 @@
 // #define KALMAN_USE_BARO_UPDATE
 
 
+/**
+ * The estimator runs in two stages:
+ * - The predict stage (kalmanTask) is triggered by the stabilizer loop. It runs the prediction, adds process noise,
+ *   finalizes and publishes the state. It only does a bounded amount of work per round.
+ * - The update stage (kalmanUpdateTask) runs at a lower priority and applies the measurement updates, one at a time.
+ *
+ * The filter data is protected by coreMutex, which the update stage only holds for one measurement. The worst case
+ * delay of the predict stage is thus one measurement update, regardless of how many measurements that arrive.
+ *
+ * The published state is double buffered, the stabilizer loop reads it without locking, see estimatorKalman().
+ */
+
 // Semaphore to signal that we got data from the stabilizer loop to process
 static SemaphoreHandle_t runTaskSemaphore;
 
-// Mutex to protect data that is shared between the task and
-// functions called by the stabilizer loop
-static SemaphoreHandle_t dataMutex;
-static StaticSemaphore_t dataMutexBuffer;
+// Mutex to protect the filter data that is shared between the predict and the update stages
+static SemaphoreHandle_t coreMutex;
+static StaticSemaphore_t coreMutexBuffer;
+
+// Measurements handed over from the predict stage to the update stage
+#define UPDATE_QUEUE_LENGTH 16
+typedef struct {
+  measurement_t measurement;
+  uint32_t arrivalUs;
+} updateQueueItem_t;
+static xQueueHandle updateQueue;
+STATIC_MEM_QUEUE_ALLOC(updateQueue, UPDATE_QUEUE_LENGTH, sizeof(updateQueueItem_t));
+
+// Max number of measurements the update stage processes in one batch
+#define UPDATE_MAX_BATCH (KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH > KALMAN_CORE_TDOA_MAX_BATCH ? KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH : KALMAN_CORE_TDOA_MAX_BATCH)
+
+// The stabilizer loop must be able to read the published state while the predict stage is preempted, and the update
+// stage must not delay the predict stage more than necessary.
+static_assert(STABILIZER_TASK_PRI > KALMAN_TASK_PRI);
+static_assert(KALMAN_TASK_PRI > KALMAN_UPDATE_TASK_PRI);
 
 
 /**
  * Tuning parameters
  */
 #define PREDICT_RATE RATE_100_HZ // this is slower than the IMU update rate of 1000Hz
+#define IMU_RATE RATE_1000_HZ
 const uint32_t PREDICTION_UPDATE_INTERVAL_MS = 1000 / PREDICT_RATE;
 
 // The bounds on the covariance, these shouldn't be hit, but sometimes are... why?
@@ -124,6 +159,9 @@ const uint32_t PREDICTION_UPDATE_INTERVAL_MS = 1000 / PREDICT_RATE;
 static bool robustTwr = false;
 static bool robustTdoa = false;
 
+// Apply time stamped measurements at the time they were taken, using the predicted motion since then
+static bool delayCompensation = true;
+
 /**
  * Quadrocopter State
  *
@@ -147,28 +185,58 @@ static Axis3fSubSampler_t accSubSampler;
 static Axis3fSubSampler_t gyroSubSampler;
 static Axis3f accLatest;
 static Axis3f gyroLatest;
+// Time stamp of the newest gyro sample, 0 if the samples are not time stamped
+static uint32_t gyroLatestSampleTimeUs;
 
 static OutlierFilterTdoaState_t outlierFilterTdoaState;
 static OutlierFilterLhState_t sweepOutlierFilterState;
 
+static kalmanHistory_t history;
+static int32_t latestMeasurementDelayUs;
+
 
 // Indicates that the internal state is corrupt and should be reset
 bool resetEstimation = false;
 
 static kalmanCoreParams_t coreParams;
 
-// Data used to enable the task and stabilizer loop to run with minimal locking
-static state_t taskEstimatorState; // The estimator state produced by the task, copied to the stabilizer when needed.
+// Double buffered state snapshot, produced by the predict stage and copied to the stabilizer when needed. The predict
+// stage writes the buffer that is not published and then publishes it. The stabilizer task has a higher priority and
+// is never preempted by the predict stage while copying the published buffer, no lock is needed.
+static state_t stateSnapshots[2];
+static volatile uint8_t publishedSnapshot;
+
+// Arrival times of the measurements that have been applied by the update stage but not yet published
+static uint32_t unpublishedArrivalUs[UPDATE_QUEUE_LENGTH];
+static uint8_t unpublishedCount;
+static uint32_t updateQueueDropped;
 
 // Statistics
 #define ONE_SECOND 1000
 static STATS_CNT_RATE_DEFINE(updateCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(predictionCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(finalizeCounter, ONE_SECOND);
+static STATS_CNT_RATE_DEFINE(delayCompensatedCounter, ONE_SECOND);
 // static STATS_CNT_RATE_DEFINE(measurementAppendedCounter, ONE_SECOND);
 // static STATS_CNT_RATE_DEFINE(measurementNotAppendedCounter, ONE_SECOND);
 
-static rateSupervisor_t rateSupervisorContext;
+// Cycles spent per measurement type and per phase of the filter, see the kalmanCyc log group
+static statsCntMinMaxAvg_t measurementCycles[MeasurementType_COUNT];
+static statsCntMinMaxAvg_t sweepBatchCycles;
+static statsCntMinMaxAvg_t tdoaBatchCycles;
+static statsCntMinMaxAvg_t tdoaGateCycles;
+static statsCntMinMaxAvg_t tdoaUpdateCycles;
+static statsCntMinMaxAvg_t flowTofCycles;
+static statsCntMinMaxAvg_t robustTwrIterations;
+static statsCntMinMaxAvg_t robustTdoaIterations;
+static statsCntMinMaxAvg_t predictCycles;
+static statsCntMinMaxAvg_t processNoiseCycles;
+static statsCntMinMaxAvg_t finalizeCycles;
+
+// Time from the arrival of a measurement to the publication of the state corrected by it [us]
+static statsCntMinMaxAvg_t correctionLatency;
+
+static rateSupervisorTask_t rateSupervisorTask;
 
 #define WARNING_HOLD_BACK_TIME_MS 2000
 static uint32_t warningBlockTimeMs = 0;
@@ -180,9 +248,20 @@ static const bool useBaroUpdate = false;
 #endif
 
 static void kalmanTask(void* parameters);
-static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlying);
+static void kalmanUpdateTask(void* parameters);
+static void dequeueMeasurements(void);
+static void updateWithMeasurement(measurement_t* m, const uint32_t nowMs, const bool quadIsFlying);
+static int receiveSweepAngleBatch(updateQueueItem_t items[]);
+static void updateWithSweepAngleBatch(const updateQueueItem_t items[], const int count, const uint32_t nowMs);
+static int receiveTdoaBatch(updateQueueItem_t items[]);
+static void updateWithTdoaBatch(const updateQueueItem_t items[], const int count, const uint32_t nowMs);
+static int receiveFlowTofPair(updateQueueItem_t items[]);
+static void updateWithFlowTofPair(const updateQueueItem_t items[]);
+static void initCycleStats();
+static void updateCycleStats(const uint32_t nowMs);
 
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(kalmanTask, KALMAN_TASK_STACKSIZE);
+STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(kalmanUpdateTask, KALMAN_UPDATE_TASK_STACKSIZE);
 
 // --------------------------------------------------
 
@@ -195,9 +274,11 @@ void estimatorKalmanTaskInit() {
   runTaskSemaphore = xSemaphoreCreateBinary();
   ASSERT(runTaskSemaphore);
 
-  dataMutex = xSemaphoreCreateMutexStatic(&dataMutexBuffer);
+  coreMutex = xSemaphoreCreateMutexStatic(&coreMutexBuffer);
+  updateQueue = STATIC_MEM_QUEUE_CREATE(updateQueue);
 
   STATIC_MEM_TASK_CREATE(kalmanTask, kalmanTask, KALMAN_TASK_NAME, NULL, KALMAN_TASK_PRI);
+  STATIC_MEM_TASK_CREATE(kalmanUpdateTask, kalmanUpdateTask, KALMAN_UPDATE_TASK_NAME, NULL, KALMAN_UPDATE_TASK_PRI);
 
   isInit = true;
 }
@@ -212,14 +293,19 @@ static void kalmanTask(void* parameters) {
   uint32_t nowMs = T2M(xTaskGetTickCount());
   uint32_t nextPredictionMs = nowMs;
 
-  rateSupervisorInit(&rateSupervisorContext, nowMs, ONE_SECOND, PREDICT_RATE - 1, PREDICT_RATE + 1, 1);
+  rateSupervisorRegisterTask(&rateSupervisorTask, "kalman", nowMs, PREDICT_RATE, 1, 1);
+  initCycleStats();
 
   while (true) {
     xSemaphoreTake(runTaskSemaphore, portMAX_DELAY);
     nowMs = T2M(xTaskGetTickCount()); // would be nice if this had a precision higher than 1ms...
 
+    xSemaphoreTake(coreMutex, portMAX_DELAY);
+
     if (resetEstimation) {
       estimatorKalmanInit();
+      xQueueReset(updateQueue);
+      unpublishedCount = 0;
       resetEstimation = false;
     }
 
@@ -229,37 +315,56 @@ static void kalmanTask(void* parameters) {
     kalmanCoreDecoupleXY(&coreData);
   #endif
 
+    dequeueMeasurements();
+
     // Run the system dynamics to predict the state forward.
     if (nowMs >= nextPredictionMs) {
       axis3fSubSamplerFinalize(&accSubSampler);
       axis3fSubSamplerFinalize(&gyroSubSampler);
 
-      kalmanCorePredict(&coreData, &accSubSampler.subSample, &gyroSubSampler.subSample, nowMs, quadIsFlying);
+      const float positionBefore[3] = {coreData.S[KC_STATE_X], coreData.S[KC_STATE_Y], coreData.S[KC_STATE_Z]};
+
+      const uint32_t predictStart = cycleCounterGet();
+      kalmanCorePredictAtSampleTime(&coreData, &accSubSampler.subSample, &gyroSubSampler.subSample, nowMs, gyroLatestSampleTimeUs, quadIsFlying);
+      statsCntMinMaxAvgAdd(&predictCycles, cycleCounterElapsed(predictStart));
+
+      const float positionChange[3] = {
+        coreData.S[KC_STATE_X] - positionBefore[0],
+        coreData.S[KC_STATE_Y] - positionBefore[1],
+        coreData.S[KC_STATE_Z] - positionBefore[2],
+      };
+      // The prediction is valid at the time of the newest IMU sample, when known
+      const uint32_t predictionTimeUs = gyroLatestSampleTimeUs != 0 ? gyroLatestSampleTimeUs : (uint32_t)usecTimestamp();
+      kalmanHistoryAddPrediction(&history, predictionTimeUs, positionChange);
       nextPredictionMs = nowMs + PREDICTION_UPDATE_INTERVAL_MS;
 
       STATS_CNT_RATE_EVENT(&predictionCounter);
 
-      if (!rateSupervisorValidate(&rateSupervisorContext, nowMs)) {
-        DEBUG_PRINT("WARNING: Kalman prediction rate off (%lu)\n", rateSupervisorLatestCount(&rateSupervisorContext));
+      if (!rateSupervisorTaskValidate(&rateSupervisorTask, nowMs)) {
+        DEBUG_PRINT("WARNING: Kalman prediction rate off (%lu)\n", rateSupervisorLatestCount(&rateSupervisorTask.supervisor));
       }
     }
 
     // Add process noise every loop, rather than every prediction
+    const uint32_t processNoiseStart = cycleCounterGet();
     kalmanCoreAddProcessNoise(&coreData, &coreParams, nowMs);
+    statsCntMinMaxAvgAdd(&processNoiseCycles, cycleCounterElapsed(processNoiseStart));
 
-    updateQueuedMeasurements(nowMs, quadIsFlying);
-
-    if (kalmanCoreFinalize(&coreData))
+    const uint32_t finalizeStart = cycleCounterGet();
+    if (kalmanCoreFinalize(&coreData, &coreParams))
     {
+      statsCntMinMaxAvgAdd(&finalizeCycles, cycleCounterElapsed(finalizeStart));
       STATS_CNT_RATE_EVENT(&finalizeCounter);
     }
 
-    if (! kalmanSupervisorIsStateWithinBounds(&coreData)) {
+    updateCycleStats(nowMs);
+
+    if (! kalmanSupervisorIsStateValid(&coreData, nowMs)) {
       resetEstimation = true;
 
       if (nowMs > warningBlockTimeMs) {
         warningBlockTimeMs = nowMs + WARNING_HOLD_BACK_TIME_MS;
-        DEBUG_PRINT("State out of bounds, resetting\n");
+        DEBUG_PRINT("State out of bounds or not finite, resetting\n");
       }
     }
 
@@ -267,105 +372,417 @@ static void kalmanTask(void* parameters) {
      * Finally, the internal state is externalized.
      * This is done every round, since the external state includes some sensor data
      */
-    xSemaphoreTake(dataMutex, portMAX_DELAY);
-    kalmanCoreExternalizeState(&coreData, &taskEstimatorState, &accLatest);
-    xSemaphoreGive(dataMutex);
+    const uint8_t snapshot = 1 - publishedSnapshot;
+    kalmanCoreExternalizeState(&coreData, &stateSnapshots[snapshot], &accLatest);
+
+    const uint32_t nowUs = (uint32_t)usecTimestamp();
+    for (int i = 0; i < unpublishedCount; i++) {
+      statsCntMinMaxAvgAdd(&correctionLatency, nowUs - unpublishedArrivalUs[i]);
+    }
+    unpublishedCount = 0;
+
+    xSemaphoreGive(coreMutex);
+
+    publishedSnapshot = snapshot;
 
     STATS_CNT_RATE_EVENT(&updateCounter);
   }
 }
 
+static void kalmanUpdateTask(void* parameters) {
+  systemWaitStart();
+
+  static updateQueueItem_t items[UPDATE_MAX_BATCH];
+  while (true) {
+    xQueueReceive(updateQueue, &items[0], portMAX_DELAY);
+    int count = 1;
+    if (items[0].measurement.type == MeasurementTypeSweepAngle) {
+      count = receiveSweepAngleBatch(items);
+    } else if (items[0].measurement.type == MeasurementTypeTDOA) {
+      count = receiveTdoaBatch(items);
+    } else if (items[0].measurement.type == MeasurementTypeFlow || items[0].measurement.type == MeasurementTypeTOF) {
+      count = receiveFlowTofPair(items);
+    }
+    const uint32_t nowMs = T2M(xTaskGetTickCount());
+    const bool quadIsFlying = supervisorIsFlying();
+
+    xSemaphoreTake(coreMutex, portMAX_DELAY);
+    if (items[0].measurement.type == MeasurementTypeSweepAngle) {
+      updateWithSweepAngleBatch(items, count, nowMs);
+    } else if (items[0].measurement.type == MeasurementTypeTDOA) {
+      updateWithTdoaBatch(items, count, nowMs);
+    } else if (count == 2) {
+      updateWithFlowTofPair(items);
+    } else {
+      updateWithMeasurement(&items[0].measurement, nowMs, quadIsFlying);
+    }
+    for (int i = 0; i < count && unpublishedCount < UPDATE_QUEUE_LENGTH; i++) {
+      unpublishedArrivalUs[unpublishedCount++] = items[i].arrivalUs;
+    }
+    xSemaphoreGive(coreMutex);
+  }
+}
+
+/**
+ * Receive the sweep angles that belong to the same frame as the one in items[0], that is the following sweeps from the
+ * same base station with the same event time. The predict stage has a higher priority and hands over all measurements
+ * of a frame before the update stage gets to run, the sweeps of a frame are consecutive in the queue.
+ */
+static int receiveSweepAngleBatch(updateQueueItem_t items[]) {
+  const sweepAngleMeasurement_t* first = &items[0].measurement.data.sweepAngle;
+
+  int count = 1;
+  while (count < KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH && xQueuePeek(updateQueue, &items[count], 0) == pdTRUE) {
+    const measurement_t* next = &items[count].measurement;
+    if (next->type != MeasurementTypeSweepAngle ||
+        next->data.sweepAngle.baseStationId != first->baseStationId ||
+        next->data.sweepAngle.eventTimeUs != first->eventTimeUs) {
+      break;
+    }
+
+    xQueueReceive(updateQueue, &items[count], 0);
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ * Receive the TDoA measurements that were extracted from the same UWB packet as the one in items[0], that is the
+ * following measurements with the same event time and the same anchor B (the anchor that sent the packet).
+ */
+static int receiveTdoaBatch(updateQueueItem_t items[]) {
+  const tdoaMeasurement_t* first = &items[0].measurement.data.tdoa;
+
+  int count = 1;
+  while (count < KALMAN_CORE_TDOA_MAX_BATCH && xQueuePeek(updateQueue, &items[count], 0) == pdTRUE) {
+    const measurement_t* next = &items[count].measurement;
+    if (next->type != MeasurementTypeTDOA ||
+        next->data.tdoa.anchorIdB != first->anchorIdB ||
+        next->data.tdoa.eventTimeUs != first->eventTimeUs) {
+      break;
+    }
+
+    xQueueReceive(updateQueue, &items[count], 0);
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ * Receive the measurement that pairs with the flow or TOF measurement in items[0], if it is next in the queue. The
+ * flow deck holds the down range measurements and enqueues them right before its flow measurements (see
+ * rangeHoldDownRange()), the pair is fused as one update.
+ */
+static int receiveFlowTofPair(updateQueueItem_t items[]) {
+  const MeasurementType pairType = (items[0].measurement.type == MeasurementTypeFlow) ? MeasurementTypeTOF : MeasurementTypeFlow;
+
+  if (xQueuePeek(updateQueue, &items[1], 0) != pdTRUE || items[1].measurement.type != pairType) {
+    return 1;
+  }
+
+  xQueueReceive(updateQueue, &items[1], 0);
+  return 2;
+}
+
 void estimatorKalman(state_t *state, const stabilizerStep_t stabilizerStep) {
   // This function is called from the stabilizer loop. It is important that this call returns
-  // as quickly as possible. The dataMutex must only be locked short periods by the task.
-  xSemaphoreTake(dataMutex, portMAX_DELAY);
-
-  // Copy the latest state, calculated by the task
-  memcpy(state, &taskEstimatorState, sizeof(state_t));
-  xSemaphoreGive(dataMutex);
+  // as quickly as possible, it copies the latest published state without locking.
+  memcpy(state, &stateSnapshots[publishedSnapshot], sizeof(state_t));
 
   xSemaphoreGive(runTaskSemaphore);
 }
 
-static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlying) {
+/**
+ * Move the position state to where the Crazyflie was (or will be) at the time of a measurement, according to the
+ * predictions. Corrections to the state are additive, restorePosition() moves the corrected state back to the time of
+ * the latest prediction.
+ */
+static bool shiftPositionToEventTime(const uint32_t eventTimeUs, float offset[3]) {
+  if (!delayCompensation || eventTimeUs == 0) {
+    return false;
+  }
+
+  if (!kalmanHistoryGetOffset(&history, eventTimeUs, offset)) {
+    return false;
+  }
+
+  latestMeasurementDelayUs = (int32_t)((uint32_t)usecTimestamp() - eventTimeUs);
+  coreData.S[KC_STATE_X] += offset[0];
+  coreData.S[KC_STATE_Y] += offset[1];
+  coreData.S[KC_STATE_Z] += offset[2];
+  STATS_CNT_RATE_EVENT(&delayCompensatedCounter);
+
+  return true;
+}
+
+static void restorePosition(const float offset[3]) {
+  coreData.S[KC_STATE_X] -= offset[0];
+  coreData.S[KC_STATE_Y] -= offset[1];
+  coreData.S[KC_STATE_Z] -= offset[2];
+}
+
+// Called by the predict stage. The IMU samples are used by the prediction and are accumulated directly, the other
+// measurements are handed over to the update stage.
+static void dequeueMeasurements(void) {
   /**
    * Sensor measurements can come in sporadically and faster than the stabilizer loop frequency,
    * we therefore consume all measurements since the last loop, rather than accumulating
    */
 
   // Pull the latest sensors values of interest; discard the rest
-  measurement_t m;
-  while (estimatorDequeue(&m)) {
-    switch (m.type) {
-      case MeasurementTypeTDOA:
-        if(robustTdoa){
-          // robust KF update with TDOA measurements
-          kalmanCoreRobustUpdateWithTdoa(&coreData, &m.data.tdoa, &outlierFilterTdoaState);
-        }else{
-          // standard KF update
-          kalmanCoreUpdateWithTdoa(&coreData, &m.data.tdoa, nowMs, &outlierFilterTdoaState);
-        }
-        break;
-      case MeasurementTypePosition:
-        kalmanCoreUpdateWithPosition(&coreData, &m.data.position);
-        break;
-      case MeasurementTypePose:
-        kalmanCoreUpdateWithPose(&coreData, &m.data.pose);
-        break;
-      case MeasurementTypeDistance:
-        if(robustTwr){
-            // robust KF update with UWB TWR measurements
-            kalmanCoreRobustUpdateWithDistance(&coreData, &m.data.distance);
-        }else{
-            // standard KF update
-            kalmanCoreUpdateWithDistance(&coreData, &m.data.distance);
-        }
-        break;
-      case MeasurementTypeTOF:
-        kalmanCoreUpdateWithTof(&coreData, &m.data.tof);
-        break;
-      case MeasurementTypeAbsoluteHeight:
-        kalmanCoreUpdateWithAbsoluteHeight(&coreData, &m.data.height);
-        break;
-      case MeasurementTypeFlow:
-        kalmanCoreUpdateWithFlow(&coreData, &m.data.flow, &gyroLatest);
-        break;
-      case MeasurementTypeYawError:
-        kalmanCoreUpdateWithYawError(&coreData, &m.data.yawError);
-        break;
-      case MeasurementTypeSweepAngle:
-        kalmanCoreUpdateWithSweepAngles(&coreData, &m.data.sweepAngle, nowMs, &sweepOutlierFilterState);
-        break;
+  updateQueueItem_t item;
+  while (estimatorDequeue(&item.measurement)) {
+    const measurement_t* m = &item.measurement;
+    const uint32_t start = cycleCounterGet();
+
+    switch (m->type) {
       case MeasurementTypeGyroscope:
-        axis3fSubSamplerAccumulate(&gyroSubSampler, &m.data.gyroscope.gyro);
-        gyroLatest = m.data.gyroscope.gyro;
+#ifdef CONFIG_ESTIMATOR_KALMAN_GYRO_CONING
+        axis3fSubSamplerAccumulateConing(&gyroSubSampler, &m->data.gyroscope.gyro);
+#else
+        axis3fSubSamplerAccumulate(&gyroSubSampler, &m->data.gyroscope.gyro);
+#endif
+        gyroLatest = m->data.gyroscope.gyro;
+        gyroLatestSampleTimeUs = m->data.gyroscope.sampleTimeUs;
         break;
       case MeasurementTypeAcceleration:
-        axis3fSubSamplerAccumulate(&accSubSampler, &m.data.acceleration.acc);
-        accLatest = m.data.acceleration.acc;
-        break;
-      case MeasurementTypeBarometer:
-        if (useBaroUpdate) {
-          kalmanCoreUpdateWithBaro(&coreData, &coreParams, m.data.barometer.baro.asl, quadIsFlying);
-        }
+        axis3fSubSamplerAccumulate(&accSubSampler, &m->data.acceleration.acc);
+        accLatest = m->data.acceleration.acc;
         break;
       default:
-        break;
+        item.arrivalUs = (uint32_t)usecTimestamp();
+        if (xQueueSend(updateQueue, &item, 0) != pdTRUE) {
+          updateQueueDropped++;
+        }
+        continue;
+    }
+
+    statsCntMinMaxAvgAdd(&measurementCycles[m->type], cycleCounterElapsed(start));
+  }
+}
+
+// Called by the update stage, with the coreMutex taken
+static void updateWithMeasurement(measurement_t* m, const uint32_t nowMs, const bool quadIsFlying) {
+  const uint32_t start = cycleCounterGet();
+
+  switch (m->type) {
+    case MeasurementTypePosition: {
+        float offset[3];
+        const bool isShifted = shiftPositionToEventTime(m->data.position.eventTimeUs, offset);
+        kalmanCoreUpdateWithPosition(&coreData, &m->data.position);
+        if (isShifted) {
+          restorePosition(offset);
+        }
+      }
+      break;
+    case MeasurementTypePose: {
+        // Only the position is moved to the time of the measurement, the attitude part is fused as is
+        float offset[3];
+        const bool isShifted = shiftPositionToEventTime(m->data.pose.eventTimeUs, offset);
+        kalmanCoreUpdateWithPose(&coreData, &m->data.pose);
+        if (isShifted) {
+          restorePosition(offset);
+        }
+      }
+      break;
+    case MeasurementTypeDistance:
+      if(robustTwr){
+          // robust KF update with UWB TWR measurements
+          statsCntMinMaxAvgAdd(&robustTwrIterations, kalmanCoreRobustUpdateWithDistance(&coreData, &m->data.distance));
+      }else{
+          // standard KF update
+          kalmanCoreUpdateWithDistance(&coreData, &m->data.distance);
+      }
+      break;
+    case MeasurementTypeTOF:
+      kalmanCoreUpdateWithTof(&coreData, &m->data.tof);
+      break;
+    case MeasurementTypeAbsoluteHeight:
+      kalmanCoreUpdateWithAbsoluteHeight(&coreData, &m->data.height);
+      break;
+    case MeasurementTypeFlow:
+      kalmanCoreUpdateWithFlow(&coreData, &m->data.flow, &gyroLatest);
+      break;
+    case MeasurementTypeYawError:
+      kalmanCoreUpdateWithYawError(&coreData, &m->data.yawError);
+      break;
+    case MeasurementTypeBarometer:
+      if (useBaroUpdate) {
+        kalmanCoreUpdateWithBaro(&coreData, &coreParams, m->data.barometer.baro.asl, quadIsFlying);
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (m->type < MeasurementType_COUNT) {
+    statsCntMinMaxAvgAdd(&measurementCycles[m->type], cycleCounterElapsed(start));
+  }
+}
+
+// Called by the update stage, with the coreMutex taken. All sweeps in the batch share the same event time.
+static void updateWithSweepAngleBatch(const updateQueueItem_t items[], const int count, const uint32_t nowMs) {
+  const uint32_t start = cycleCounterGet();
+
+  static sweepAngleMeasurement_t sweeps[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  for (int i = 0; i < count; i++) {
+    sweeps[i] = items[i].measurement.data.sweepAngle;
+  }
+
+  float offset[3];
+  const bool isShifted = shiftPositionToEventTime(sweeps[0].eventTimeUs, offset);
+  kalmanCoreUpdateWithSweepAnglesBatch(&coreData, sweeps, count, nowMs, &sweepOutlierFilterState);
+  if (isShifted) {
+    restorePosition(offset);
+  }
+
+  // The sweep angle stats are per sweep, used to estimate the cost of a measurement in the decimation of the lighthouse
+  const uint32_t elapsed = cycleCounterElapsed(start);
+  statsCntMinMaxAvgAdd(&sweepBatchCycles, elapsed);
+  for (int i = 0; i < count; i++) {
+    statsCntMinMaxAvgAdd(&measurementCycles[MeasurementTypeSweepAngle], elapsed / count);
+  }
+}
+
+// Called by the update stage, with the coreMutex taken. One flow and one TOF measurement, in any order.
+static void updateWithFlowTofPair(const updateQueueItem_t items[]) {
+  const uint32_t start = cycleCounterGet();
+
+  const int flowIndex = (items[0].measurement.type == MeasurementTypeFlow) ? 0 : 1;
+  const flowMeasurement_t* flow = &items[flowIndex].measurement.data.flow;
+  const tofMeasurement_t* tof = &items[1 - flowIndex].measurement.data.tof;
+  kalmanCoreUpdateWithFlowAndTof(&coreData, flow, tof, &gyroLatest);
+
+  const uint32_t elapsed = cycleCounterElapsed(start);
+  statsCntMinMaxAvgAdd(&flowTofCycles, elapsed);
+  statsCntMinMaxAvgAdd(&measurementCycles[MeasurementTypeFlow], elapsed / 2);
+  statsCntMinMaxAvgAdd(&measurementCycles[MeasurementTypeTOF], elapsed / 2);
+}
+
+// Called by the update stage, with the coreMutex taken. All measurements in the batch share the same event time.
+static void updateWithTdoaBatch(const updateQueueItem_t items[], const int count, const uint32_t nowMs) {
+  const uint32_t start = cycleCounterGet();
+
+  float offset[3];
+  const bool isShifted = shiftPositionToEventTime(items[0].measurement.data.tdoa.eventTimeUs, offset);
+
+  static tdoaMeasurement_t tdoas[KALMAN_CORE_TDOA_MAX_BATCH];
+  for (int i = 0; i < count; i++) {
+    tdoas[i] = items[i].measurement.data.tdoa;
+  }
+
+  // The outlier gating is shared by the standard and the robust update
+  static kalmanCoreTdoaGatedBatch_t gated;
+  const uint32_t gateStart = cycleCounterGet();
+  const int accepted = kalmanCoreGateTdoaBatch(&coreData, tdoas, count, nowMs, &outlierFilterTdoaState, &gated);
+  statsCntMinMaxAvgAdd(&tdoaGateCycles, cycleCounterElapsed(gateStart));
+
+  if (accepted > 0) {
+    const uint32_t updateStart = cycleCounterGet();
+    if (robustTdoa) {
+      // robust KF update with TDOA measurements, one at a time
+      for (int i = 0; i < count; i++) {
+        if (gated.isAccepted[i]) {
+          statsCntMinMaxAvgAdd(&robustTdoaIterations, kalmanCoreRobustUpdateWithTdoa(&coreData, &tdoas[i], &outlierFilterTdoaState));
+        }
+      }
+    } else {
+      // standard KF update
+      kalmanCoreBatchUpdate(&coreData, gated.measurements, accepted);
     }
+    statsCntMinMaxAvgAdd(&tdoaUpdateCycles, cycleCounterElapsed(updateStart));
+  }
+
+  if (isShifted) {
+    restorePosition(offset);
+  }
+
+  const uint32_t elapsed = cycleCounterElapsed(start);
+  statsCntMinMaxAvgAdd(&tdoaBatchCycles, elapsed);
+  for (int i = 0; i < count; i++) {
+    statsCntMinMaxAvgAdd(&measurementCycles[MeasurementTypeTDOA], elapsed / count);
   }
 }
 
+static void initCycleStats() {
+  for (int i = 0; i < MeasurementType_COUNT; i++) {
+    statsCntMinMaxAvgInit(&measurementCycles[i], ONE_SECOND);
+  }
+  statsCntMinMaxAvgInit(&sweepBatchCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&tdoaBatchCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&tdoaGateCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&tdoaUpdateCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&flowTofCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&robustTwrIterations, ONE_SECOND);
+  statsCntMinMaxAvgInit(&robustTdoaIterations, ONE_SECOND);
+  statsCntMinMaxAvgInit(&predictCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&processNoiseCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&finalizeCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&correctionLatency, ONE_SECOND);
+}
+
+static void updateCycleStats(const uint32_t nowMs) {
+  for (int i = 0; i < MeasurementType_COUNT; i++) {
+    statsCntMinMaxAvgUpdate(&measurementCycles[i], nowMs);
+  }
+  statsCntMinMaxAvgUpdate(&sweepBatchCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&tdoaBatchCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&tdoaGateCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&tdoaUpdateCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&flowTofCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&robustTwrIterations, nowMs);
+  statsCntMinMaxAvgUpdate(&robustTdoaIterations, nowMs);
+  statsCntMinMaxAvgUpdate(&predictCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&processNoiseCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&finalizeCycles, nowMs);
+  statsCntMinMaxAvgUpdate(&correctionLatency, nowMs);
+}
+
 // Called when this estimator is activated
-void estimatorKalmanInit(void)
+// Initialize the filter, from an estimate when one is given
+static void initFilter(const state_t* initialState)
 {
   axis3fSubSamplerInit(&accSubSampler, GRAVITY_MAGNITUDE);
+#ifdef CONFIG_ESTIMATOR_KALMAN_GYRO_CONING
+  axis3fSubSamplerInitConing(&gyroSubSampler, DEG_TO_RAD, 1.0f / IMU_RATE);
+#else
   axis3fSubSamplerInit(&gyroSubSampler, DEG_TO_RAD);
+#endif
+  gyroLatestSampleTimeUs = 0;
 
   outlierFilterTdoaReset(&outlierFilterTdoaState);
   outlierFilterLighthouseReset(&sweepOutlierFilterState, 0);
+  kalmanHistoryInit(&history);
 
   uint32_t nowMs = T2M(xTaskGetTickCount());
-  kalmanCoreInit(&coreData, &coreParams, nowMs);
+  if (initialState) {
+    kalmanCoreInitFromState(&coreData, &coreParams, nowMs, initialState);
+  } else {
+    kalmanCoreInit(&coreData, &coreParams, nowMs);
+  }
+}
+
+void estimatorKalmanInit(void)
+{
+  initFilter(0);
+}
+
+void estimatorKalmanWarmStart(const state_t* initialState)
+{
+  xSemaphoreTake(coreMutex, portMAX_DELAY);
+
+  initFilter(initialState);
+  xQueueReset(updateQueue);
+  unpublishedCount = 0;
+  resetEstimation = false;
+
+  // Both snapshots, the stabilizer may read either of them after the switch
+  kalmanCoreExternalizeState(&coreData, &stateSnapshots[0], &accLatest);
+  kalmanCoreExternalizeState(&coreData, &stateSnapshots[1], &accLatest);
+
+  xSemaphoreGive(coreMutex);
 }
 
 bool estimatorKalmanTest(void)
@@ -373,14 +790,34 @@ bool estimatorKalmanTest(void)
   return isInit;
 }
 
+// The getters below are called from other tasks and read the filter data directly, they take the coreMutex to not see
+// a half updated state
 void estimatorKalmanGetEstimatedPos(point_t* pos) {
+  xSemaphoreTake(coreMutex, portMAX_DELAY);
   pos->x = coreData.S[KC_STATE_X];
   pos->y = coreData.S[KC_STATE_Y];
   pos->z = coreData.S[KC_STATE_Z];
+  xSemaphoreGive(coreMutex);
+}
+
+void estimatorKalmanGetEstimatedPosCovariance(float cov[3][3]) {
+  xSemaphoreTake(coreMutex, portMAX_DELAY);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      cov[i][j] = coreData.P[KC_PACKED_INDEX(KC_STATE_X + i, KC_STATE_X + j)];
+    }
+  }
+  xSemaphoreGive(coreMutex);
 }
 
 void estimatorKalmanGetEstimatedRot(float * rotationMatrix) {
+  xSemaphoreTake(coreMutex, portMAX_DELAY);
   memcpy(rotationMatrix, coreData.R, 9*sizeof(float));
+  xSemaphoreGive(coreMutex);
+}
+
+float estimatorKalmanGetMeasurementCycles(const MeasurementType type) {
+  return measurementCycles[type].latestAvg;
 }
 
 /**
@@ -438,39 +875,39 @@ LOG_GROUP_START(kalman)
   /**
   * @brief Covariance matrix position x
   */
-  LOG_ADD(LOG_FLOAT, varX, &coreData.P[KC_STATE_X][KC_STATE_X])
+  LOG_ADD(LOG_FLOAT, varX, &coreData.P[KC_PACKED_INDEX(KC_STATE_X, KC_STATE_X)])
   /**
   * @brief Covariance matrix position y
   */
-  LOG_ADD(LOG_FLOAT, varY, &coreData.P[KC_STATE_Y][KC_STATE_Y])
+  LOG_ADD(LOG_FLOAT, varY, &coreData.P[KC_PACKED_INDEX(KC_STATE_Y, KC_STATE_Y)])
   /**
   * @brief Covariance matrix position z
   */
-  LOG_ADD(LOG_FLOAT, varZ, &coreData.P[KC_STATE_Z][KC_STATE_Z])
+  LOG_ADD(LOG_FLOAT, varZ, &coreData.P[KC_PACKED_INDEX(KC_STATE_Z, KC_STATE_Z)])
   /**
   * @brief Covariance matrix velocity x
   */
-  LOG_ADD(LOG_FLOAT, varPX, &coreData.P[KC_STATE_PX][KC_STATE_PX])
+  LOG_ADD(LOG_FLOAT, varPX, &coreData.P[KC_PACKED_INDEX(KC_STATE_PX, KC_STATE_PX)])
   /**
   * @brief Covariance matrix velocity y
   */
-  LOG_ADD(LOG_FLOAT, varPY, &coreData.P[KC_STATE_PY][KC_STATE_PY])
+  LOG_ADD(LOG_FLOAT, varPY, &coreData.P[KC_PACKED_INDEX(KC_STATE_PY, KC_STATE_PY)])
   /**
   * @brief Covariance matrix velocity z
   */
-  LOG_ADD(LOG_FLOAT, varPZ, &coreData.P[KC_STATE_PZ][KC_STATE_PZ])
+  LOG_ADD(LOG_FLOAT, varPZ, &coreData.P[KC_PACKED_INDEX(KC_STATE_PZ, KC_STATE_PZ)])
   /**
   * @brief Covariance matrix attitude error roll
   */
-  LOG_ADD(LOG_FLOAT, varD0, &coreData.P[KC_STATE_D0][KC_STATE_D0])
+  LOG_ADD(LOG_FLOAT, varD0, &coreData.P[KC_PACKED_INDEX(KC_STATE_D0, KC_STATE_D0)])
   /**
   * @brief Covariance matrix attitude error pitch
   */
-  LOG_ADD(LOG_FLOAT, varD1, &coreData.P[KC_STATE_D1][KC_STATE_D1])
+  LOG_ADD(LOG_FLOAT, varD1, &coreData.P[KC_PACKED_INDEX(KC_STATE_D1, KC_STATE_D1)])
   /**
   * @brief Covariance matrix attitude error yaw
   */
-  LOG_ADD(LOG_FLOAT, varD2, &coreData.P[KC_STATE_D2][KC_STATE_D2])
+  LOG_ADD(LOG_FLOAT, varD2, &coreData.P[KC_PACKED_INDEX(KC_STATE_D2, KC_STATE_D2)])
   /**
   * @brief Estimated Attitude quarternion w
   */
@@ -499,10 +936,150 @@ LOG_GROUP_START(kalman)
   * @brief Statistics rate full estimation step
   */
   STATS_CNT_RATE_LOG_ADD(rtFinal, &finalizeCounter)
+  /**
+  * @brief Statistics rate of measurements applied at the time they were taken
+  */
+  STATS_CNT_RATE_LOG_ADD(rtDlyComp, &delayCompensatedCounter)
+  /**
+  * @brief Delay of the latest compensated measurement [us]
+  */
+  LOG_ADD(LOG_INT32, mDelay, &latestMeasurementDelayUs)
+  /**
+  * @brief Number of finalizations using the second order covariance rotation
+  */
+  LOG_ADD(LOG_UINT32, finExact, &coreData.finalizeExactCount)
+  /**
+  * @brief Number of finalizations using the first order (small angle) covariance rotation
+  */
+  LOG_ADD(LOG_UINT32, finSmall, &coreData.finalizeFirstOrderCount)
+  /**
+  * @brief Number of measurement updates dropped because of a non finite innovation
+  */
+  LOG_ADD(LOG_UINT32, nonFinUpd, &coreData.nonFiniteUpdateCount)
+  /**
+  * @brief Time from the arrival of a measurement to the publication of the state corrected by it [us]
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(corrLat, &correctionLatency)
+  /**
+  * @brief Number of measurements dropped since the update stage could not keep up
+  */
+  LOG_ADD(LOG_UINT32, updDrop, &updateQueueDropped)
+  /**
+  * @brief Reweighting iterations per robust TWR update, min, average, max and rate of the updates
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(rTwrIt, &robustTwrIterations)
+  /**
+  * @brief Reweighting iterations per robust TDoA update, min, average, max and rate of the updates
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(rTdoaIt, &robustTdoaIterations)
 LOG_GROUP_STOP(kalman)
 
+/**
+ * CPU cycles spent in the Kalman task, per measurement type and per phase
+ * of the filter. Each entry has the min, average and max number of cycles
+ * per call [cycles] and the call rate [Hz], calculated over one second.
+ */
+LOG_GROUP_START(kalmanCyc)
+  /**
+  * @brief Prediction step
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pred, &predictCycles)
+  /**
+  * @brief Addition of process noise
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pNoise, &processNoiseCycles)
+  /**
+  * @brief Finalization, only when the state was updated
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(final, &finalizeCycles)
+  /**
+  * @brief TDoA measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tdoa, &measurementCycles[MeasurementTypeTDOA])
+  /**
+  * @brief Position measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pos, &measurementCycles[MeasurementTypePosition])
+  /**
+  * @brief Pose measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pose, &measurementCycles[MeasurementTypePose])
+  /**
+  * @brief Distance (TWR) measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(dist, &measurementCycles[MeasurementTypeDistance])
+  /**
+  * @brief ToF measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tof, &measurementCycles[MeasurementTypeTOF])
+  /**
+  * @brief Absolute height measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(height, &measurementCycles[MeasurementTypeAbsoluteHeight])
+  /**
+  * @brief Flow measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(flow, &measurementCycles[MeasurementTypeFlow])
+  /**
+  * @brief Yaw error measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(yawErr, &measurementCycles[MeasurementTypeYawError])
+  /**
+  * @brief Lighthouse sweep angle measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sweep, &measurementCycles[MeasurementTypeSweepAngle])
+  /**
+  * @brief Lighthouse sweep angle batches, all sweeps from one base station in one frame
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sweepBt, &sweepBatchCycles)
+  /**
+  * @brief TDoA batches, all measurements extracted from one UWB packet
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tdoaBt, &tdoaBatchCycles)
+  /**
+  * @brief The outlier gating stage of TDoA batches, model and outlier filter
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tdoaGate, &tdoaGateCycles)
+  /**
+  * @brief The kalman update stage of TDoA batches, standard or robust, for batches with accepted measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tdoaUpd, &tdoaUpdateCycles)
+  /**
+  * @brief Flow and TOF measurements fused as one update
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(flowTof, &flowTofCycles)
+  /**
+  * @brief Gyro samples
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(gyro, &measurementCycles[MeasurementTypeGyroscope])
+  /**
+  * @brief Accelerometer samples
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(acc, &measurementCycles[MeasurementTypeAcceleration])
+  /**
+  * @brief Barometer measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(baro, &measurementCycles[MeasurementTypeBarometer])
+LOG_GROUP_STOP(kalmanCyc)
+
 LOG_GROUP_START(outlierf)
   LOG_ADD(LOG_INT32, lhWin, &sweepOutlierFilterState.openingWindowMs)
+  /**
+  * @brief Number of lighthouse sweeps rejected because of too large errors
+  */
+  LOG_ADD(LOG_UINT32, lhRejErr, &sweepOutlierFilterState.rejectedErrorCount)
+  /**
+  * @brief Number of lighthouse frames rejected as a whole, most sweeps in the frame had too large errors
+  */
+  LOG_ADD(LOG_UINT32, lhRejFrm, &sweepOutlierFilterState.rejectedFrameCount)
+  /**
+  * @brief Number of TDoA samples rejected by the outlier filter
+  */
+  LOG_ADD(LOG_UINT32, tdoaRej, &outlierFilterTdoaState.rejectedCount)
+  /**
+  * @brief The factor applied to the TDoA standard deviation in the outlier filter, adapted to the measured errors
+  */
+  LOG_ADD(LOG_FLOAT, tdoaScale, &outlierFilterTdoaState.errorScale)
 LOG_GROUP_STOP(outlierf)
 
 /**
@@ -522,6 +1099,10 @@ PARAM_GROUP_START(kalman)
  * @brief Nonzero to use robust TWR method (default: 0)
  */
   PARAM_ADD_CORE(PARAM_UINT8, robustTwr, &robustTwr)
+/**
+ * @brief Nonzero to apply time stamped TDoA, Lighthouse and external position measurements at the time they were taken (default: 1)
+ */
+  PARAM_ADD(PARAM_UINT8, delayComp, &delayCompensation)
 /**
  * @brief Process noise for x and y acceleration
  */
@@ -570,4 +1151,8 @@ PARAM_GROUP_START(kalman)
  * @brief Initial yaw after reset [rad]
  */
   PARAM_ADD_CORE(PARAM_FLOAT, initialYaw, &coreParams.initialYaw)
+  /**
+ * @brief Attitude error limit for the first order covariance rotation in the finalization [rad]
+ */
+  PARAM_ADD(PARAM_FLOAT, smallAngle, &coreParams.attitudeErrorSmallAngle)
 PARAM_GROUP_STOP(kalman)
@@ -70,6 +70,7 @@
 #include "outlierFilterTdoa.h"
 #include "outlierFilterLighthouse.h"
 #include "usec_time.h"
+#include "cycle_counter.h"
 
 #include "statsCnt.h"
 
@@ -118,6 +119,11 @@ static STATS_CNT_RATE_DEFINE(finalizeCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(measurementAppendedCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(measurementNotAppendedCounter, ONE_SECOND);
 
+// Cycles spent per step of the filter, see the ukfCyc log group
+static statsCntMinMaxAvg_t predictCycles;
+static statsCntMinMaxAvg_t sigmaPointCycles;
+static statsCntMinMaxAvg_t measurementCycles[MeasurementType_COUNT];
+
 // for error filter version
 #define DIM_FILTER 9
 #define DIM_STRAPDOWN 10
@@ -136,6 +142,11 @@ static float procTime = 0.0f;
 static uint8_t receivedAnchor;
 
 static float covNavFilter[DIM_FILTER][DIM_FILTER];
+// Lower triangular Cholesky factor of covNavFilter, covNavFilter = covNavFilterSqrt * covNavFilterSqrt'
+static float covNavFilterSqrt[DIM_FILTER][DIM_FILTER];
+#ifdef CONFIG_ESTIMATOR_UKF_SQRT
+static uint32_t sqrtDowndateFailCounter = 0;
+#endif
 
 static float xEst[DIM_FILTER] = {0.0f};
 static float sigmaPointsTempl[DIM_FILTER][DIM_FILTER + 2] = {0};
@@ -226,7 +237,11 @@ static void computeOutputSweep(float *output, float *state, sweepAngleMeasuremen
 
 static bool ukfUpdate(float *Pxy, float *Pyy, float innovation);
 static void computeSigmaPoints(void);
+static void factorizeCovariance(void);
 static uint8_t cholesky(float *A, float *L, uint8_t n);
+#ifdef CONFIG_ESTIMATOR_UKF_SQRT
+static bool choleskyDowndate(float *L, float *u, uint8_t n);
+#endif
 static void quatToEuler(float *quat, float *eulerAngles);
 static void quatFromAtt(float *attVec, float *quat);
 static void directionCosineMatrix(float *quat, float *dcm);
@@ -249,6 +264,12 @@ void errorEstimatorUkfTaskInit()
 
   dataMutex = xSemaphoreCreateMutexStatic(&dataMutexBuffer);
 
+  statsCntMinMaxAvgInit(&predictCycles, ONE_SECOND);
+  statsCntMinMaxAvgInit(&sigmaPointCycles, ONE_SECOND);
+  for (int i = 0; i < MeasurementType_COUNT; i++) {
+    statsCntMinMaxAvgInit(&measurementCycles[i], ONE_SECOND);
+  }
+
   navigationInit();
 
   STATIC_MEM_TASK_CREATE(errorUkfTask, errorUkfTask, ERROR_UKF_TASK_NAME, NULL, ERROR_UKF_TASK_PRI);
@@ -327,6 +348,7 @@ static void errorUkfTask(void *parameters)
       covNavFilter[6][6] = stdDevInitialAtt * stdDevInitialAtt;
       covNavFilter[7][7] = stdDevInitialAtt * stdDevInitialAtt;
       covNavFilter[8][8] = stdDevInitialAtt * stdDevInitialAtt;
+      factorizeCovariance();
 
       lastPrediction = xTaskGetTickCount();
     }
@@ -394,7 +416,9 @@ static void errorUkfTask(void *parameters)
       }
 
       // prediction step of error state Kalman Filter
+      const uint32_t predictStart = cycleCounterGet();
       predictNavigationFilter(&stateNav[0], &accAverage, &gyroAverage, dt);
+      statsCntMinMaxAvgAdd(&predictCycles, cycleCounterElapsed(predictStart));
 
       accLog[0] = accAverage.x; // Logging Data
       accLog[1] = accAverage.y;
@@ -463,6 +487,13 @@ static void errorUkfTask(void *parameters)
 
     xSemaphoreGive(dataMutex);
 
+    const uint32_t nowMs = T2M(osTick);
+    statsCntMinMaxAvgUpdate(&predictCycles, nowMs);
+    statsCntMinMaxAvgUpdate(&sigmaPointCycles, nowMs);
+    for (int i = 0; i < MeasurementType_COUNT; i++) {
+      statsCntMinMaxAvgUpdate(&measurementCycles[i], nowMs);
+    }
+
     procTime = (float)(usecTimestamp()-lastTime)/1000000.0f;
     lastTime = usecTimestamp();
   } // END infinite loop
@@ -611,6 +642,7 @@ static void navigationInit(void)
   covNavFilter[6][6] = stdDevInitialAtt * stdDevInitialAtt;
   covNavFilter[7][7] = stdDevInitialAtt * stdDevInitialAtt;
   covNavFilter[8][8] = stdDevInitialAtt * stdDevInitialAtt;
+  factorizeCovariance();
 
   //______________________________________________________________________
   //compute weights
@@ -771,6 +803,8 @@ static void predictNavigationFilter(float *stateNav, Axis3f *acc, Axis3f *gyro,
     }
   }
 
+  // Adding the process noise does not map to a cheap update of the factor, factorize once per prediction
+  factorizeCovariance();
   computeSigmaPoints();
 }
 
@@ -795,6 +829,7 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
   measurement_t m;
   while (estimatorDequeue(&m))
   {
+    const uint32_t start = cycleCounterGet();
 
     if (m.type == MeasurementTypeGyroscope)
     {
@@ -1163,6 +1198,8 @@ static bool updateQueuedMeasurements(const uint32_t tick, Axis3f *gyroAverage)
           break;
       }
     }
+
+    statsCntMinMaxAvgAdd(&measurementCycles[m.type], cycleCounterElapsed(start));
   }
 
   return doneUpdate;
@@ -1290,12 +1327,30 @@ static void computeOutputSweep(float *output, float *state, sweepAngleMeasuremen
   output[0] = base - (sweepInfo->calib->phase + compGib);
 }
 
+// Compute the lower triangular Cholesky factor of the full covariance matrix
+static void factorizeCovariance(void)
+{
+  uint8_t ii, jj;
+  for (ii = 0; ii < DIM_FILTER; ii++)
+  {
+    for (jj = 0; jj < DIM_FILTER; jj++)
+    {
+      covNavFilterSqrt[ii][jj] = 0.0f;
+    }
+  }
+
+  cholesky(&covNavFilter[0][0], &covNavFilterSqrt[0][0], DIM_FILTER);
+}
+
 static void computeSigmaPoints(void)
 {
   uint8_t ii, jj, kk;
-  float L[DIM_FILTER][DIM_FILTER] = {0};
+  const uint32_t start = cycleCounterGet();
 
-  cholesky(&covNavFilter[0][0], &L[0][0], DIM_FILTER);
+#ifndef CONFIG_ESTIMATOR_UKF_SQRT
+  // Without the square root form the factor is not kept up to date by the updates, compute it from the covariance
+  factorizeCovariance();
+#endif
 
   for (jj = 0; jj < (DIM_FILTER + 2); jj++)
   {
@@ -1312,11 +1367,13 @@ static void computeSigmaPoints(void)
 
       for (kk = 0; kk < DIM_FILTER; kk++)
       {
-        sigmaPoints[ii][jj] = sigmaPoints[ii][jj] + L[ii][kk] * sigmaPointsTempl[kk][jj];
+        sigmaPoints[ii][jj] = sigmaPoints[ii][jj] + covNavFilterSqrt[ii][kk] * sigmaPointsTempl[kk][jj];
       }
       sigmaPoints[ii][jj] = sigmaPoints[ii][jj] + xEst[ii];
     }
   }
+
+  statsCntMinMaxAvgAdd(&sigmaPointCycles, cycleCounterElapsed(start));
 }
 
 static bool ukfUpdate(float *Pxy, float *Pyy, float innovation)
@@ -1356,6 +1413,22 @@ static bool ukfUpdate(float *Pxy, float *Pyy, float innovation)
     }
   }
 
+#ifdef CONFIG_ESTIMATOR_UKF_SQRT
+  // The update is P = P - Kk*Pyy*Kk' = P - u*u' with u = Pxy/sqrt(Pyy), a rank one downdate of the factor
+  float u[DIM_FILTER];
+  const float scale = 1.0f / sqrtf(Pyy[0]);
+  for (ii = 0; ii < DIM_FILTER; ii++)
+  {
+    u[ii] = Pxy[ii] * scale;
+  }
+  if (!choleskyDowndate(&covNavFilterSqrt[0][0], &u[0], DIM_FILTER))
+  {
+    // The downdated matrix is not positive definite in float precision, start over from the covariance
+    sqrtDowndateFailCounter++;
+    factorizeCovariance();
+  }
+#endif
+
   if (useNavigationFilter)
   {
     resetNavigationStates();
@@ -1427,6 +1500,34 @@ static uint8_t cholesky(float *A, float *L, uint8_t n)
   return 1;
 }
 
+#ifdef CONFIG_ESTIMATOR_UKF_SQRT
+// Rank one downdate of the lower triangular factor L, such that L*L' becomes L*L' - u*u'. u is used as work space.
+// Returns false if the result is not positive definite, L is then only partially updated.
+static bool choleskyDowndate(float *L, float *u, uint8_t n)
+{
+  for (uint8_t k = 0; k < n; k++)
+  {
+    const float Lkk = L[k * n + k];
+    const float r2 = Lkk * Lkk - u[k] * u[k];
+    if (!(r2 > 0.0f))
+    {
+      return false;
+    }
+
+    const float r = sqrtf(r2);
+    const float c = r / Lkk;
+    const float s = u[k] / Lkk;
+    L[k * n + k] = r;
+    for (uint8_t i = k + 1; i < n; i++)
+    {
+      L[i * n + k] = (L[i * n + k] - s * u[i]) / c;
+      u[i] = c * u[i] - s * L[i * n + k];
+    }
+  }
+  return true;
+}
+#endif
+
 static void transposeMatrix(float *mat, float *matTp)
 {
   matTp[0 * 3 + 0] = mat[0];
@@ -1590,8 +1691,46 @@ STATS_CNT_RATE_LOG_ADD(rtBaro, &baroUpdateCounter)
 STATS_CNT_RATE_LOG_ADD(rtFinal, &finalizeCounter)
 STATS_CNT_RATE_LOG_ADD(rtApnd, &measurementAppendedCounter)
 STATS_CNT_RATE_LOG_ADD(rtRej, &measurementNotAppendedCounter)
+#ifdef CONFIG_ESTIMATOR_UKF_SQRT
+LOG_ADD(LOG_UINT32, sqrtFail, &sqrtDowndateFailCounter)
+#endif
 LOG_GROUP_STOP(ukf)
 
+/**
+ * CPU cycles spent per step of the UKF. Each entry has the min, average and max
+ * number of cycles per call [cycles] and the call rate [Hz], calculated over one second.
+ */
+LOG_GROUP_START(ukfCyc)
+  /**
+  * @brief Prediction step, including the sigma points
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pred, &predictCycles)
+  /**
+  * @brief Computation of the sigma points
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sigma, &sigmaPointCycles)
+  /**
+  * @brief TDoA measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tdoa, &measurementCycles[MeasurementTypeTDOA])
+  /**
+  * @brief ToF measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(tof, &measurementCycles[MeasurementTypeTOF])
+  /**
+  * @brief Flow measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(flow, &measurementCycles[MeasurementTypeFlow])
+  /**
+  * @brief Barometer measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(baro, &measurementCycles[MeasurementTypeBarometer])
+  /**
+  * @brief Lighthouse sweep angle measurements
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sweep, &measurementCycles[MeasurementTypeSweepAngle])
+LOG_GROUP_STOP(ukfCyc)
+
  /**
   * Parameter values used for tuning the Unscented Kalman Filter (experimental)
   */
@@ -0,0 +1,209 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * measurement_queue.c - Queue for measurements to the state estimators, with
+ * priorities, coalescing of superseded measurements and age based discard.
+ */
+#include <string.h>
+#include "measurement_queue.h"
+#include "cfassert.h"
+
+typedef enum {
+  priorityLow,
+  priorityMedium,
+  priorityHigh,
+} measurementPriority_t;
+
+typedef struct {
+  measurementPriority_t priority;
+  // Only the latest measurement is of interest, a new one replaces the queued one
+  bool coalesce;
+  // Measurements older than this are discarded when dequeued, 0 means no limit
+  uint32_t maxAgeMs;
+} measurementTypeConfig_t;
+
+// Absolute measurements carry the most information and are never evicted by the high rate types.
+// IMU samples are accumulated by the estimators and can neither be coalesced nor discarded by age.
+static const measurementTypeConfig_t typeConfig[MeasurementType_COUNT] = {
+  [MeasurementTypeTDOA] =           {.priority = priorityHigh,   .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypePosition] =       {.priority = priorityHigh,   .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypePose] =           {.priority = priorityHigh,   .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypeDistance] =       {.priority = priorityHigh,   .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypeTOF] =            {.priority = priorityLow,    .coalesce = true,  .maxAgeMs = 50},
+  [MeasurementTypeAbsoluteHeight] = {.priority = priorityMedium, .coalesce = true,  .maxAgeMs = 100},
+  [MeasurementTypeFlow] =           {.priority = priorityLow,    .coalesce = true,  .maxAgeMs = 50},
+  [MeasurementTypeYawError] =       {.priority = priorityHigh,   .coalesce = true,  .maxAgeMs = 0},
+  [MeasurementTypeSweepAngle] =     {.priority = priorityHigh,   .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypeGyroscope] =      {.priority = priorityMedium, .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypeAcceleration] =   {.priority = priorityMedium, .coalesce = false, .maxAgeMs = 0},
+  [MeasurementTypeBarometer] =      {.priority = priorityMedium, .coalesce = true,  .maxAgeMs = 100},
+};
+
+static void unlink(measurementQueue_t* queue, const uint8_t index) {
+  measurementQueueSlot_t* slot = &queue->slots[index];
+
+  if (slot->prev == MEASUREMENT_QUEUE_NONE) {
+    queue->head = slot->next;
+  } else {
+    queue->slots[slot->prev].next = slot->next;
+  }
+
+  if (slot->next == MEASUREMENT_QUEUE_NONE) {
+    queue->tail = slot->prev;
+  } else {
+    queue->slots[slot->next].prev = slot->prev;
+  }
+
+  slot->next = queue->free;
+  queue->free = index;
+
+  queue->depth--;
+  queue->stats[slot->measurement.type].depth--;
+}
+
+static void append(measurementQueue_t* queue, const measurement_t* measurement, const uint32_t nowMs) {
+  const uint8_t index = queue->free;
+  measurementQueueSlot_t* slot = &queue->slots[index];
+  queue->free = slot->next;
+
+  slot->measurement = *measurement;
+  slot->enqueuedMs = nowMs;
+  slot->next = MEASUREMENT_QUEUE_NONE;
+  slot->prev = queue->tail;
+
+  if (queue->tail == MEASUREMENT_QUEUE_NONE) {
+    queue->head = index;
+  } else {
+    queue->slots[queue->tail].next = index;
+  }
+  queue->tail = index;
+
+  queue->depth++;
+  measurementQueueTypeStats_t* stats = &queue->stats[measurement->type];
+  stats->depth++;
+  if (stats->depth > stats->maxDepth) {
+    stats->maxDepth = stats->depth;
+  }
+}
+
+static uint8_t findQueued(const measurementQueue_t* queue, const MeasurementType type) {
+  for (uint8_t index = queue->head; index != MEASUREMENT_QUEUE_NONE; index = queue->slots[index].next) {
+    if (queue->slots[index].measurement.type == type) {
+      return index;
+    }
+  }
+
+  return MEASUREMENT_QUEUE_NONE;
+}
+
+// The oldest measurement with the lowest priority, if its priority is lower than the limit
+static uint8_t findEvictionCandidate(const measurementQueue_t* queue, const measurementPriority_t limit) {
+  uint8_t candidate = MEASUREMENT_QUEUE_NONE;
+  measurementPriority_t candidatePriority = limit;
+
+  for (uint8_t index = queue->head; index != MEASUREMENT_QUEUE_NONE; index = queue->slots[index].next) {
+    const measurementPriority_t priority = typeConfig[queue->slots[index].measurement.type].priority;
+    if (priority < candidatePriority) {
+      candidate = index;
+      candidatePriority = priority;
+    }
+  }
+
+  return candidate;
+}
+
+void measurementQueueInit(measurementQueue_t* queue) {
+  queue->head = MEASUREMENT_QUEUE_NONE;
+  queue->tail = MEASUREMENT_QUEUE_NONE;
+  queue->depth = 0;
+
+  for (uint8_t i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+    queue->slots[i].next = i + 1;
+    queue->slots[i].prev = MEASUREMENT_QUEUE_NONE;
+  }
+  queue->slots[MEASUREMENT_QUEUE_SIZE - 1].next = MEASUREMENT_QUEUE_NONE;
+  queue->free = 0;
+
+  memset(queue->stats, 0, sizeof(queue->stats));
+}
+
+bool measurementQueuePush(measurementQueue_t* queue, const measurement_t* measurement, const uint32_t nowMs) {
+  const MeasurementType type = measurement->type;
+  ASSERT(type < MeasurementType_COUNT);
+
+  const measurementTypeConfig_t* config = &typeConfig[type];
+  measurementQueueTypeStats_t* stats = &queue->stats[type];
+
+  if (config->coalesce) {
+    const uint8_t index = findQueued(queue, type);
+    if (index != MEASUREMENT_QUEUE_NONE) {
+      queue->slots[index].measurement = *measurement;
+      queue->slots[index].enqueuedMs = nowMs;
+      stats->coalesced++;
+      return true;
+    }
+  }
+
+  if (queue->depth >= MEASUREMENT_QUEUE_SIZE) {
+    const uint8_t victim = findEvictionCandidate(queue, config->priority);
+    if (victim == MEASUREMENT_QUEUE_NONE) {
+      stats->rejected++;
+      stats->dropped++;
+      return false;
+    }
+
+    measurementQueueTypeStats_t* victimStats = &queue->stats[queue->slots[victim].measurement.type];
+    victimStats->evicted++;
+    victimStats->dropped++;
+    unlink(queue, victim);
+  }
+
+  append(queue, measurement, nowMs);
+  stats->appended++;
+  return true;
+}
+
+bool measurementQueuePop(measurementQueue_t* queue, measurement_t* measurement, const uint32_t nowMs) {
+  while (queue->head != MEASUREMENT_QUEUE_NONE) {
+    const uint8_t index = queue->head;
+    const measurementQueueSlot_t* slot = &queue->slots[index];
+    const MeasurementType type = slot->measurement.type;
+    const uint32_t maxAgeMs = typeConfig[type].maxAgeMs;
+
+    const bool isStale = (maxAgeMs != 0) && ((nowMs - slot->enqueuedMs) > maxAgeMs);
+    if (isStale) {
+      queue->stats[type].stale++;
+      queue->stats[type].dropped++;
+    } else {
+      *measurement = slot->measurement;
+    }
+
+    unlink(queue, index);
+
+    if (!isStale) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -24,6 +24,8 @@
  * position_estimator_altitude.c: Altitude-only position estimator
  */
 
+#include <math.h>
+
 #include "stm32f4xx.h"
 
 #include "FreeRTOS.h"
@@ -32,6 +34,7 @@
 #include "log.h"
 #include "param.h"
 #include "num.h"
+#include "physicalConstants.h"
 #include "position_estimator.h"
 
 #define G 9.81f;
@@ -58,6 +61,31 @@ static struct selfState_s state = {
   .estimatedVZ = 0.0f,
 };
 
+// State of the incremental estimator. The height is predicted with the acceleration and corrected
+// towards each baro or ToF sample, with the gains of a second order complementary filter with
+// the time constant of the sensor, scaled by the time since the previous sample of that sensor.
+struct altState_s {
+  float z;
+  float vz;
+  uint32_t accTimestamp;
+  uint32_t baroTimestamp;
+  uint32_t tofTimestamp;
+  bool hasAcc;
+  bool hasBaro;
+  bool hasTof;
+  bool isSurfaceFollowing; // Set on the first ToF sample, from then on the baro is not used
+  float tauBaro;  // Time constant of the baro correction [s]
+  float tauTof;   // Time constant of the ToF correction [s]
+};
+
+static struct altState_s altState = {
+  .tauBaro = 1.0f,
+  .tauTof = 0.1f,
+};
+
+// Longest time step that is integrated or used to scale the correction gains [s]
+#define ALT_MAX_DT 0.1f
+
 static void positionEstimateInternal(state_t* estimate, const baro_t* baro, const tofMeasurement_t* tofMeasurement, float dt, stabilizerStep_t stabilizerStep, struct selfState_s* state);
 static void positionUpdateVelocityInternal(float accWZ, float dt, struct selfState_s* state);
 
@@ -121,6 +149,84 @@ static void positionUpdateVelocityInternal(float accWZ, float dt, struct selfSta
   state->velocityZ *= state->velZAlpha;
 }
 
+void positionAltitudeReset(void) {
+  altState.z = 0.0f;
+  altState.vz = 0.0f;
+  altState.hasAcc = false;
+  altState.hasBaro = false;
+  altState.hasTof = false;
+  altState.isSurfaceFollowing = false;
+}
+
+static float secondsBetween(const uint32_t from, const uint32_t to) {
+  // Samples older than the previous one give a negative difference, treat them as simultaneous
+  const int32_t ticks = (int32_t)(to - from);
+  const float dt = ticks > 0 ? T2M(ticks) / 1000.0f : 0.0f;
+  return fminf(dt, ALT_MAX_DT);
+}
+
+void positionAltitudeAddAcc(float accWZ, uint32_t timestamp) {
+  if (altState.hasAcc) {
+    const float dt = secondsBetween(altState.accTimestamp, timestamp);
+    const float acc = deadband(accWZ, state.vAccDeadband) * GRAVITY_MAGNITUDE;
+    altState.z += (altState.vz + 0.5f * acc * dt) * dt;
+    altState.vz += acc * dt;
+  }
+
+  altState.accTimestamp = timestamp;
+  altState.hasAcc = true;
+}
+
+static void correct(const float measurement, const uint32_t timestamp, const float dt, const float tau) {
+  // The prediction is ahead of the sample, compare with the height at the time of the sample
+  const float age = secondsBetween(timestamp, altState.accTimestamp);
+  const float error = measurement - (altState.z - altState.vz * age);
+
+  // Limited to keep the height gain at or below 1 for sparse samples
+  const float scaledDt = fminf(dt, 0.5f * tau);
+  altState.z += (2.0f * scaledDt / tau) * error;
+  altState.vz += (scaledDt / (tau * tau)) * error;
+}
+
+void positionAltitudeAddBaro(const baro_t* baro, uint32_t timestamp) {
+  if (altState.isSurfaceFollowing) {
+    return;
+  }
+
+  if (altState.hasBaro) {
+    correct(baro->asl, timestamp, secondsBetween(altState.baroTimestamp, timestamp), altState.tauBaro);
+  } else {
+    altState.z = baro->asl;
+  }
+
+  altState.baroTimestamp = timestamp;
+  altState.hasBaro = true;
+}
+
+void positionAltitudeAddTof(const tofMeasurement_t* tofMeasurement) {
+  const uint32_t timestamp = tofMeasurement->timestamp;
+
+  if (altState.hasTof) {
+    correct(tofMeasurement->distance, timestamp, secondsBetween(altState.tofTimestamp, timestamp), altState.tauTof);
+  } else {
+    // Switch to the ToF as height reference, it has another offset than the baro
+    altState.z = tofMeasurement->distance;
+    altState.isSurfaceFollowing = true;
+  }
+
+  altState.tofTimestamp = timestamp;
+  altState.hasTof = true;
+}
+
+void positionAltitudeGetEstimate(state_t* estimate) {
+  estimate->position.x = 0.0f;
+  estimate->position.y = 0.0f;
+  estimate->position.z = altState.z;
+  estimate->velocity.z = altState.vz;
+  state.estimatedZ = altState.z;
+  state.estimatedVZ = altState.vz;
+}
+
 LOG_GROUP_START(posEstAlt)
 LOG_ADD(LOG_FLOAT, estimatedZ, &state.estimatedZ)
 LOG_ADD(LOG_FLOAT, estVZ, &state.estimatedVZ)
@@ -151,4 +257,12 @@ PARAM_ADD(PARAM_FLOAT | PARAM_PERSISTENT, velZAlpha, &state.velZAlpha)
  * @brief Vertical acceleration deadband
  */
 PARAM_ADD_CORE(PARAM_FLOAT | PARAM_PERSISTENT, vAccDeadband, &state.vAccDeadband)
+/**
+ * @brief Time constant of the baro correction in the incremental estimator [s]
+ */
+PARAM_ADD(PARAM_FLOAT | PARAM_PERSISTENT, tauBaro, &altState.tauBaro)
+/**
+ * @brief Time constant of the ToF correction in the incremental estimator [s]
+ */
+PARAM_ADD(PARAM_FLOAT | PARAM_PERSISTENT, tauTof, &altState.tauTof)
 PARAM_GROUP_STOP(posEstAlt)
@@ -0,0 +1,206 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * event_trace.c - Binary trace of context switches, interrupts, queue operations and markers
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "event_trace.h"
+#include "cycle_counter.h"
+#include "static_mem.h"
+#include "mem.h"
+#include "param.h"
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE_RTT
+#include "SEGGER_RTT.h"
+
+#define RTT_CHANNEL 1
+#define RTT_BUFFER_SIZE 2048
+#endif
+
+#define CAPACITY CONFIG_DEBUG_EVENT_TRACE_SIZE
+
+// Must be a power of two, names are stored on the task number
+#define MAX_NAMES 32
+#define NAME_EVENT_CHARS 2
+
+typedef struct {
+  uint32_t timestamp;  // cycle counter
+  uint8_t type;
+  uint8_t id;
+  uint16_t arg;
+} __attribute__((packed)) eventTraceEvent_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t eventSize;
+  uint8_t nameCount;
+  uint8_t nameLength;
+  uint32_t capacity;
+  uint32_t head;  // total number of recorded events, the next event is written at head % capacity
+  uint32_t cpuHz;
+} __attribute__((packed)) eventTraceHeader_t;
+
+#define TRACE_VERSION 1
+
+NO_DMA_CCM_SAFE_ZERO_INIT static eventTraceEvent_t ring[CAPACITY];
+static uint32_t head;
+static char names[MAX_NAMES][configMAX_TASK_NAME_LEN];
+
+// The header that is read through the memory, latched when a read starts at address 0
+static eventTraceHeader_t readHeader;
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE_RTT
+static uint8_t rttBuffer[RTT_BUFFER_SIZE];
+#endif
+
+static uint8_t run = 1;
+static bool isInit = false;
+
+#define NAMES_OFFSET sizeof(eventTraceHeader_t)
+#define RING_OFFSET (NAMES_OFFSET + sizeof(names))
+#define TOTAL_SIZE (RING_OFFSET + sizeof(ring))
+
+static void recordName(const uint8_t taskNumber) {
+  const char* name = names[taskNumber & (MAX_NAMES - 1)];
+  const int length = strnlen(name, configMAX_TASK_NAME_LEN);
+  for (int i = 0; i < length; i += NAME_EVENT_CHARS) {
+    uint16_t chars = 0;
+    memcpy(&chars, &name[i], (length - i) < NAME_EVENT_CHARS ? (length - i) : NAME_EVENT_CHARS);
+    eventTraceRecord(EVENT_TRACE_TASK_NAME, taskNumber, chars);
+  }
+}
+
+void eventTraceRecord(const eventTraceType_t type, const uint8_t id, const uint16_t arg) {
+  if (!isInit || !run) {
+    return;
+  }
+
+  const UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+  eventTraceEvent_t* event = &ring[head % CAPACITY];
+  event->timestamp = cycleCounterGet();
+  event->type = type;
+  event->id = id;
+  event->arg = arg;
+  head++;
+#ifdef CONFIG_DEBUG_EVENT_TRACE_RTT
+  // Events are dropped if the host does not keep up
+  SEGGER_RTT_WriteSkipNoLock(RTT_CHANNEL, event, sizeof(*event));
+#endif
+  taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+}
+
+void eventTraceTaskCreated(const uint8_t taskNumber, const char* name) {
+  // Names are stored also before the trace is initialized, the first tasks are created early
+  char* entry = names[taskNumber & (MAX_NAMES - 1)];
+  memset(entry, 0, configMAX_TASK_NAME_LEN);
+  strncpy(entry, name, configMAX_TASK_NAME_LEN - 1);
+
+  recordName(taskNumber);
+}
+
+void eventTraceIsrEnter(void) {
+  eventTraceRecord(EVENT_TRACE_ISR_ENTER, __get_IPSR(), 0);
+}
+
+void eventTraceIsrExit(void) {
+  eventTraceRecord(EVENT_TRACE_ISR_EXIT, __get_IPSR(), 0);
+}
+
+static uint32_t handleMemGetSize(void) {
+  return TOTAL_SIZE;
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > TOTAL_SIZE) {
+    return false;
+  }
+
+  if (memAddr == 0) {
+    // Stop the recording so that the ring is not overwritten while it is read, set eventTrace.run to restart
+    run = 0;
+    readHeader.version = TRACE_VERSION;
+    readHeader.eventSize = sizeof(eventTraceEvent_t);
+    readHeader.nameCount = MAX_NAMES;
+    readHeader.nameLength = configMAX_TASK_NAME_LEN;
+    readHeader.capacity = CAPACITY;
+    readHeader.head = head;
+    readHeader.cpuHz = SystemCoreClock;
+  }
+
+  for (int i = 0; i < readLen; i++) {
+    const uint32_t addr = memAddr + i;
+    if (addr < NAMES_OFFSET) {
+      buffer[i] = ((const uint8_t*)&readHeader)[addr];
+    } else if (addr < RING_OFFSET) {
+      buffer[i] = ((const uint8_t*)names)[addr - NAMES_OFFSET];
+    } else {
+      buffer[i] = ((const uint8_t*)ring)[addr - RING_OFFSET];
+    }
+  }
+
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_EVENT_TRACE,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+
+void eventTraceInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  cycleCounterInit();
+  memoryRegisterHandler(&memDef);
+
+#ifdef CONFIG_DEBUG_EVENT_TRACE_RTT
+  SEGGER_RTT_ConfigUpBuffer(RTT_CHANNEL, "EventTrace", rttBuffer, sizeof(rttBuffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+
+  isInit = true;
+
+  // Names of the tasks that were created before the trace was initialized
+  for (int i = 0; i < MAX_NAMES; i++) {
+    if (names[i][0] != 0) {
+      recordName(i);
+    }
+  }
+}
+
+/**
+ * Binary event trace, see docs/development/event_trace.md
+ */
+PARAM_GROUP_START(eventTrace)
+/**
+ * @brief Nonzero to record events (default: 1). Reading the trace memory stops the recording.
+ */
+PARAM_ADD(PARAM_UINT8, run, &run)
+PARAM_GROUP_STOP(eventTrace)
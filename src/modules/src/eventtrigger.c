@@ -25,11 +25,65 @@
  */
 #include <string.h>
 
+#include "stm32fxxx.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "eventtrigger.h"
 
+#include "config.h"
 #include "debug.h"
+#include "log.h"
+#include "static_mem.h"
+#include "usec_time.h"
+#include "autoconf.h"
+
+#define RING_SIZE CONFIG_EVENTTRIGGER_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+_Static_assert((RING_SIZE & RING_MASK) == 0, "CONFIG_EVENTTRIGGER_RING_SIZE must be a power of two");
 
 static eventtriggerCallback callbacks[eventtriggerHandler_Count] = {0};
+static bool hasCallbacks;
+
+/* Bounded multi producer, single consumer ring. A producer claims a slot by
+ * moving enqueuePos forward with a compare and swap, copies the event and
+ * publishes the slot by setting its sequence to pos + 1. The consumer owns
+ * dequeuePos and hands the slot back to the producers by setting the sequence
+ * to pos + RING_SIZE. A slot that is claimed but not yet published stops the
+ * consumer until the producer has finished. */
+typedef struct {
+    uint32_t sequence;
+    eventtriggerRecord record;
+} ringSlot_t;
+
+static ringSlot_t ring[RING_SIZE];
+static uint32_t enqueuePos;
+static uint32_t dequeuePos;
+
+// Set by the task before it blocks, the producer that clears it notifies the task
+static bool drainWaiting;
+static TaskHandle_t drainTaskHandle;
+
+// Statistics
+static uint32_t overflowCount;
+static uint32_t eventCount;
+static uint16_t maxUsed;
+
+static void eventtriggerTask(void *param);
+STATIC_MEM_TASK_ALLOC(eventtriggerTask, EVENTTRIGGER_TASK_STACKSIZE);
+
+void eventtriggerInit(void)
+{
+    if (drainTaskHandle) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < RING_SIZE; i++) {
+        ring[i].sequence = i;
+    }
+
+    drainTaskHandle = STATIC_MEM_TASK_CREATE(eventtriggerTask, eventtriggerTask, EVENTTRIGGER_TASK_NAME, NULL, EVENTTRIGGER_TASK_PRI);
+}
 
 /* Symbols set by the linker script */
 extern eventtrigger _eventtrigger_start;
@@ -66,14 +120,121 @@ const eventtrigger* eventtriggerGetByName(const char *name)
 
 void eventTrigger(const eventtrigger *event)
 {
-    for (int i = 0; i < eventtriggerHandler_Count; ++i) {
-        if (callbacks[i]) {
-            callbacks[i](event);
+    // Nothing to do until the task is running and someone is listening
+    if (!drainTaskHandle || !hasCallbacks) {
+        return;
+    }
+
+    ringSlot_t *slot;
+    uint32_t pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &ring[pos & RING_MASK];
+        const uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        const int32_t diff = (int32_t)(sequence - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&overflowCount, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+
+    eventtriggerRecord *record = &slot->record;
+    record->event = event;
+    record->timestamp = usecTimestamp();
+    record->payloadSize = event->payloadSize;
+    if (event->payloadSize) {
+        memcpy(record->payload, event->payload, event->payloadSize);
+    }
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    const uint16_t used = pos + 1 - __atomic_load_n(&dequeuePos, __ATOMIC_RELAXED);
+    if (used > maxUsed) {
+        maxUsed = used;
+    }
+
+    if (__atomic_exchange_n(&drainWaiting, false, __ATOMIC_ACQ_REL)) {
+        const bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+        if (isInInterrupt) {
+            BaseType_t higherPriorityTaskWoken = pdFALSE;
+            vTaskNotifyGiveFromISR(drainTaskHandle, &higherPriorityTaskWoken);
+            portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        } else {
+            xTaskNotifyGive(drainTaskHandle);
         }
     }
 }
 
+static bool eventtriggerIsPublished(uint32_t pos)
+{
+    const uint32_t sequence = __atomic_load_n(&ring[pos & RING_MASK].sequence, __ATOMIC_ACQUIRE);
+    return (int32_t)(sequence - (pos + 1)) >= 0;
+}
+
+static bool eventtriggerDequeue(eventtriggerRecord *record)
+{
+    const uint32_t pos = dequeuePos;
+    if (!eventtriggerIsPublished(pos)) {
+        return false;
+    }
+
+    ringSlot_t *slot = &ring[pos & RING_MASK];
+    memcpy(record, &slot->record, sizeof(*record));
+    __atomic_store_n(&slot->sequence, pos + RING_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&dequeuePos, pos + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void eventtriggerTask(void *param)
+{
+    eventtriggerRecord record;
+
+    while (true) {
+        while (eventtriggerDequeue(&record)) {
+            eventCount++;
+            for (int i = 0; i < eventtriggerHandler_Count; ++i) {
+                if (callbacks[i]) {
+                    callbacks[i](&record);
+                }
+            }
+        }
+
+        // Check again after announcing that we are about to wait, an event
+        // that is published in between is either seen here or notifies us
+        __atomic_store_n(&drainWaiting, true, __ATOMIC_SEQ_CST);
+        if (!eventtriggerIsPublished(dequeuePos)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        __atomic_store_n(&drainWaiting, false, __ATOMIC_RELAXED);
+    }
+}
+
 void eventtriggerRegisterCallback(enum eventtriggerHandler_e handler, eventtriggerCallback cb)
 {
     callbacks[handler] = cb;
+    if (cb) {
+        hasCallbacks = true;
+    }
 }
+
+/**
+ * Event trigger ring statistics
+ */
+LOG_GROUP_START(eventtrig)
+/**
+ * @brief Number of events that were dropped since the ring was full
+ */
+LOG_ADD(LOG_UINT32, overflow, &overflowCount)
+/**
+ * @brief Number of events passed to the handlers
+ */
+LOG_ADD(LOG_UINT32, count, &eventCount)
+/**
+ * @brief Largest number of events waiting in the ring
+ */
+LOG_ADD(LOG_UINT16, maxUsed, &maxUsed)
+LOG_GROUP_STOP(eventtrig)
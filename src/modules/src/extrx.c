@@ -44,6 +44,7 @@
 #include "debug.h"
 #include "log.h"
 #include "static_mem.h"
+#include "usec_time.h"
 
 #define ENABLE_CPPM
 #define ENABLE_EXTRX_LOG
@@ -108,6 +109,10 @@ bool extRxModeRate = false;
 static setpoint_t extrxSetpoint;
 static uint16_t ch[EXTRX_NR_CHANNELS] = {0};
 
+// Time from the completed CPPM frame to the setpoint in the commander [us]
+static uint32_t latencyUs;
+static uint32_t latencyMaxUs;
+
 static void extRxTask(void *param);
 static void extRxDecodeCppm(void);
 static void extRxDecodeChannels(void);
@@ -267,23 +272,22 @@ static void extRxDecodeChannels(void)
 
 static void extRxDecodeCppm(void)
 {
-  uint16_t ppm;
-  static uint8_t currChannel = 0;
+  cppmFrame_t frame;
 
-  if (cppmGetTimestamp(&ppm) == pdTRUE)
+  if (cppmGetFrame(&frame) == pdTRUE)
   {
-    if (cppmIsAvailible() && ppm < 2100)
+    // The frame is complete, all channels are updated in one pass
+    for (int i = 0; i < frame.count && i < EXTRX_NR_CHANNELS; i++)
     {
-      if (currChannel < EXTRX_NR_CHANNELS)
-      {
-        ch[currChannel] = ppm;
-      }
-      currChannel++;
+      ch[i] = frame.ch[i];
     }
-    else
+
+    extRxDecodeChannels();
+
+    latencyUs = (uint32_t)(usecTimestamp() - frame.timestamp);
+    if (latencyUs > latencyMaxUs)
     {
-      extRxDecodeChannels();
-      currChannel = 0;
+      latencyMaxUs = latencyUs;
     }
   }
 }
@@ -413,5 +417,13 @@ LOG_ADD(LOG_UINT8, AltHold, &extRxAltHold)
  * @brief External RX Arming signal
  */
 LOG_ADD(LOG_UINT8, Arm, &extRxArm)
+/**
+ * @brief Time from the end of the latest CPPM frame to the setpoint in the commander [us]
+ */
+LOG_ADD(LOG_UINT32, latency, &latencyUs)
+/**
+ * @brief Max time from the end of a CPPM frame to the setpoint in the commander [us]
+ */
+LOG_ADD(LOG_UINT32, latencyMax, &latencyMaxUs)
 LOG_GROUP_STOP(extrx)
 #endif
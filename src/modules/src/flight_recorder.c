@@ -0,0 +1,281 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * flight_recorder.c - RAM black box of the last seconds of the stabilizer loop
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "flight_recorder.h"
+#include "supervisor.h"
+#include "motors.h"
+#include "static_mem.h"
+#include "mem.h"
+#include "log.h"
+#include "param.h"
+#include "debug.h"
+
+#define CAPACITY CONFIG_FLIGHT_RECORDER_SIZE
+#define RATE_HZ CONFIG_FLIGHT_RECORDER_RATE
+
+static_assert(sizeof(flightRecorderSample_t) == 64, "The sample layout is part of the memory format");
+static_assert((RATE_MAIN_LOOP % RATE_HZ) == 0, "CONFIG_FLIGHT_RECORDER_RATE must divide the stabilizer loop rate");
+
+#define RECORDER_MAGIC 0x46524543
+#define RECORDER_VERSION 1
+
+// Supervisor flags that indicate that the Crazyflie was in the air, or about to be
+#define IN_FLIGHT_INFO (SUPERVISOR_INFO_IS_ARMED | SUPERVISOR_INFO_IS_FLYING)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t capacity;
+  uint32_t sampleSize;
+  uint32_t head;         // total number of recorded samples, the next sample is written at head % capacity
+  uint32_t triggerHead;  // head when the freeze was triggered
+  uint32_t remaining;    // number of samples left to record after the trigger
+  uint8_t reason;        // see flightRecorderReason_t, the recording is frozen when set and remaining is 0
+} recorderState_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t sampleSize;
+  uint8_t reason;
+  uint8_t isFrozen;
+  uint16_t rateHz;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t triggerHead;
+} __attribute__((packed)) flightRecorderMemHeader_t;
+
+// Not initialized at start up, a recording survives a warm reset and is validated by flightRecorderInit()
+NO_DMA_CCM_SAFE_NO_INIT static recorderState_t recorder;
+NO_DMA_CCM_SAFE_NO_INIT static flightRecorderSample_t ring[CAPACITY];
+
+// The header that is read through the memory, latched when a read starts at address 0
+static flightRecorderMemHeader_t readHeader;
+
+static uint16_t previousInfo;
+static uint16_t postSamples = CAPACITY / 4;
+static uint8_t run = 1;
+static uint8_t clear;
+static volatile bool isClearRequested;
+static bool isInit = false;
+
+#define RING_OFFSET sizeof(flightRecorderMemHeader_t)
+#define TOTAL_SIZE (RING_OFFSET + sizeof(ring))
+
+static bool isFrozen(void) {
+  return recorder.reason != FLIGHT_RECORDER_REASON_NONE && recorder.remaining == 0;
+}
+
+static void clearRecording(void) {
+  memset(&recorder, 0, sizeof(recorder));
+  memset(ring, 0, sizeof(ring));
+  recorder.capacity = CAPACITY;
+  recorder.sampleSize = sizeof(flightRecorderSample_t);
+  recorder.magic = RECORDER_MAGIC;
+}
+
+static bool isRecordingValid(void) {
+  return recorder.magic == RECORDER_MAGIC &&
+    recorder.capacity == CAPACITY &&
+    recorder.sampleSize == sizeof(flightRecorderSample_t) &&
+    recorder.triggerHead <= recorder.head &&
+    recorder.reason <= FLIGHT_RECORDER_REASON_RESET;
+}
+
+// The samples are frozen on the rising edge of an incident flag, if the Crazyflie was armed or flying before
+static flightRecorderReason_t getTriggerReason(const uint16_t previous, const uint16_t current) {
+  if ((previous & IN_FLIGHT_INFO) == 0) {
+    return FLIGHT_RECORDER_REASON_NONE;
+  }
+
+  const uint16_t rising = current & ~previous;
+  if (rising & SUPERVISOR_INFO_IS_CRASHED) {
+    return FLIGHT_RECORDER_REASON_CRASHED;
+  }
+  if (rising & SUPERVISOR_INFO_IS_TUMBLED) {
+    return FLIGHT_RECORDER_REASON_TUMBLED;
+  }
+  if (rising & SUPERVISOR_INFO_IS_LOCKED) {
+    return FLIGHT_RECORDER_REASON_LOCKED;
+  }
+
+  return FLIGHT_RECORDER_REASON_NONE;
+}
+
+static void freeze(const flightRecorderReason_t reason, const uint32_t remaining) {
+  recorder.triggerHead = recorder.head;
+  recorder.remaining = remaining;
+  recorder.reason = reason;
+}
+
+void flightRecorderSample(const stabilizerStep_t stabilizerStep, const state_t* state, const setpoint_t* setpoint, const sensorData_t* sensorData) {
+  if (!isInit) {
+    return;
+  }
+
+  if (isClearRequested) {
+    clearRecording();
+    previousInfo = 0;
+    isClearRequested = false;
+  }
+
+  if (!run || isFrozen() || !RATE_DO_EXECUTE(RATE_HZ, stabilizerStep)) {
+    return;
+  }
+
+  const uint16_t info = supervisorGetInfoField();
+  if (recorder.reason == FLIGHT_RECORDER_REASON_NONE) {
+    const flightRecorderReason_t reason = getTriggerReason(previousInfo, info);
+    if (reason != FLIGHT_RECORDER_REASON_NONE) {
+      // The sample of the trigger and the post trigger samples, the trigger must not be overwritten
+      const uint32_t post = (postSamples < CAPACITY) ? postSamples : CAPACITY - 1;
+      freeze(reason, post + 1);
+    }
+  }
+  previousInfo = info;
+
+  flightRecorderSample_t* sample = &ring[recorder.head % CAPACITY];
+  sample->step = stabilizerStep;
+  stabilizerCompressState(state, sensorData, &sample->state);
+  stabilizerCompressSetpoint(setpoint, &sample->setpoint);
+  for (int i = 0; i < STABILIZER_NR_OF_MOTORS; i++) {
+    sample->motorRatios[i] = motorsGetRatio(i);
+  }
+  sample->supervisorInfo = info;
+  recorder.head++;
+
+  if (recorder.reason != FLIGHT_RECORDER_REASON_NONE) {
+    recorder.remaining--;
+  }
+}
+
+static uint32_t handleMemGetSize(void) {
+  return TOTAL_SIZE;
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > TOTAL_SIZE) {
+    return false;
+  }
+
+  if (memAddr == 0) {
+    // A frozen recording is never overwritten, otherwise stop the recording while it is read. Set flightRec.run to
+    // restart.
+    if (!isFrozen()) {
+      run = 0;
+    }
+    readHeader.version = RECORDER_VERSION;
+    readHeader.sampleSize = sizeof(flightRecorderSample_t);
+    readHeader.reason = recorder.reason;
+    readHeader.isFrozen = isFrozen();
+    readHeader.rateHz = RATE_HZ;
+    readHeader.capacity = CAPACITY;
+    readHeader.head = recorder.head;
+    readHeader.triggerHead = recorder.triggerHead;
+  }
+
+  uint32_t addr = memAddr;
+  uint32_t left = readLen;
+  if (addr < RING_OFFSET) {
+    const uint32_t length = (left < RING_OFFSET - addr) ? left : RING_OFFSET - addr;
+    memcpy(buffer, ((const uint8_t*)&readHeader) + addr, length);
+    buffer += length;
+    addr += length;
+    left -= length;
+  }
+  memcpy(buffer, ((const uint8_t*)ring) + addr - RING_OFFSET, left);
+
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_FLIGHT_RECORDER,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+
+static void requestClear(void) {
+  if (clear) {
+    clear = 0;
+    isClearRequested = true;
+    run = 1;
+  }
+}
+
+void flightRecorderInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  if (!isRecordingValid()) {
+    // Power on, or the layout changed
+    clearRecording();
+  } else if (recorder.reason != FLIGHT_RECORDER_REASON_NONE) {
+    // The post trigger samples are lost, keep what was recorded
+    recorder.remaining = 0;
+    DEBUG_PRINT("Frozen flight recording kept (reason %d)\n", recorder.reason);
+  } else if (recorder.head > 0 && (ring[(recorder.head - 1) % CAPACITY].supervisorInfo & SUPERVISOR_INFO_IS_FLYING)) {
+    freeze(FLIGHT_RECORDER_REASON_RESET, 0);
+    DEBUG_PRINT("Reset while flying, flight recording frozen\n");
+  }
+
+  memoryRegisterHandler(&memDef);
+
+  isInit = true;
+}
+
+/**
+ * RAM black box of the last seconds of the stabilizer loop, see
+ * docs/functional-areas/memory-subsystem/MEM_TYPE_FLIGHT_RECORDER.md
+ */
+PARAM_GROUP_START(flightRec)
+/**
+ * @brief Nonzero to record samples (default: 1). Reading the recording memory stops the recording, unless it is frozen.
+ */
+PARAM_ADD(PARAM_UINT8, run, &run)
+/**
+ * @brief Set to nonzero to discard the recording, unfreeze and restart the recording
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, clear, &clear, requestClear)
+/**
+ * @brief Number of samples that are recorded after an incident, before the recording is frozen (default: a quarter of
+ * the ring)
+ */
+PARAM_ADD(PARAM_UINT16, post, &postSamples)
+PARAM_GROUP_STOP(flightRec)
+
+LOG_GROUP_START(flightRec)
+/**
+ * @brief The reason the recording was frozen, see flightRecorderReason_t. 0 while recording
+ */
+LOG_ADD(LOG_UINT8, reason, &recorder.reason)
+/**
+ * @brief Total number of recorded samples
+ */
+LOG_ADD(LOG_UINT32, samples, &recorder.head)
+LOG_GROUP_STOP(flightRec)
@@ -28,6 +28,11 @@
  * Propeller test is done by spinning the each propeller after one another
  * while measuring the vibrations with the accelerometer.
  *
+ * The fast propeller test spins all propellers at the same time, each with
+ * its speed modulated at its own frequency. The vibration energy of a
+ * propeller then varies at the frequency of its motor, it is separated from
+ * the others with one DFT bin per motor. The battery test follows directly.
+ *
  * The battery test is done by doing a quick burst of all the motors while
  * measuring the maximum voltage sag. The sag is pretty constant over the
  * battery voltage range but usually a tiny bit higher at full voltage. The
@@ -37,6 +42,8 @@
  */
 #define DEBUG_MODULE "HEALTH"
 
+#include <math.h>
+
 #include "config.h"
 #include "log.h"
 #include "param.h"
@@ -45,13 +52,24 @@
 #include "sensors.h"
 #include "pm.h"
 #include "autoconf.h"
+#include "filter.h"
+#include "physicalConstants.h"
 
 #include "static_mem.h"
 
 #define PROPTEST_NBR_OF_VARIANCE_VALUES   100
 
+// The fast test modulates the motor speeds with a whole number of cycles per block of samples, at low frequencies
+// the motors can follow. The bins are chosen such that no bin is a harmonic of another one.
+#define PROPTEST_FAST_NBR_OF_SAMPLES      1024
+#define PROPTEST_FAST_SPIN_UP_MSEC        300
+#define PROPTEST_FAST_MODULATION_DEPTH    0.25f
+static const uint8_t propTestFastBins[NBR_OF_MOTORS] = {2, 3, 5, 7};
+
 static bool startPropTest = false;
+static bool startFastPropTest = false;
 static bool startBatTest = false;
+static bool isFastPropTest = false;
 
 static uint16_t propTestPWMRatio = CONFIG_MOTORS_DEFAULT_PROP_TEST_PWM_RATIO;
 static uint16_t batTestPWMRatio = CONFIG_MOTORS_DEFAULT_BAT_TEST_PWM_RATIO;
@@ -63,6 +81,9 @@ NO_DMA_CCM_SAFE_ZERO_INIT static float accZ[PROPTEST_NBR_OF_VARIANCE_VALUES];
 static float accVarXnf;
 static float accVarYnf;
 static float accVarZnf;
+static float accMeanXnf;
+static float accMeanYnf;
+static goertzel_t propTestFastDft[NBR_OF_MOTORS];
 static int motorToTest = 0;
 static uint8_t nrFailedTests = 0;
 static float idleVoltage;
@@ -72,6 +93,8 @@ static float minLoadedVoltage;
 static float accVarX[NBR_OF_MOTORS];
 static float accVarY[NBR_OF_MOTORS];
 static float accVarZ[NBR_OF_MOTORS];
+// Vibration score per motor, the X+Y variance of the propeller test or the estimate of it from the fast test
+static float propScore[NBR_OF_MOTORS];
 // Bit field indicating if the motors passed the motor test.
 // Bit 0 - 1 = M1 passed
 // Bit 1 - 1 = M2 passed
@@ -82,7 +105,7 @@ static uint16_t motorTestCount = 0;
 static uint8_t batteryPass = 0;
 static float batterySag = 0;
 
-typedef enum { configureAcc, measureNoiseFloor, measureProp, testBattery, restartBatTest,
+typedef enum { configureAcc, measureNoiseFloor, measureProp, measurePropFast, testBattery, restartBatTest,
                evaluatePropResult, evaluateBatResult, testDone } TestState;
 
 #ifdef RUN_PROP_TEST_AT_STARTUP
@@ -106,6 +129,75 @@ static float variance(float *buffer, uint32_t length)
   return sumSq - (sum * sum) / length;
 }
 
+static float mean(float *buffer, uint32_t length)
+{
+  float sum = 0;
+
+  for (uint32_t i = 0; i < length; i++)
+  {
+    sum += buffer[i];
+  }
+
+  return sum / length;
+}
+
+static uint16_t propTestRatio(uint32_t motor)
+{
+  return propTestPWMRatio > 0 ? propTestPWMRatio : motorsGetHealthTestSettings(motor)->onPeriodPWMRatioProp;
+}
+
+// Spin all motors with modulated speeds and accumulate the vibration energy in the DFT bins of the motors
+static void runFastPropTest(const sensorData_t *sensors)
+{
+  for (int m = 0; m < NBR_OF_MOTORS; m++)
+  {
+    const float phase = 2.0f * M_PI_F * propTestFastBins[m] * tick / PROPTEST_FAST_NBR_OF_SAMPLES;
+    const float ratio = propTestRatio(m) * (1.0f + PROPTEST_FAST_MODULATION_DEPTH * sinf(phase));
+    motorsSetRatio(m, (uint16_t)fminf(ratio, UINT16_MAX));
+  }
+
+  if (tick >= PROPTEST_FAST_SPIN_UP_MSEC)
+  {
+    const uint32_t sampleIndex = tick - PROPTEST_FAST_SPIN_UP_MSEC;
+    if (sampleIndex == 0)
+    {
+      for (int m = 0; m < NBR_OF_MOTORS; m++)
+      {
+        goertzelInit(&propTestFastDft[m], propTestFastBins[m], PROPTEST_FAST_NBR_OF_SAMPLES);
+      }
+    }
+
+    const float dx = sensors->acc.x - accMeanXnf;
+    const float dy = sensors->acc.y - accMeanYnf;
+    const float energy = dx * dx + dy * dy;
+    for (int m = 0; m < NBR_OF_MOTORS; m++)
+    {
+      goertzelAdd(&propTestFastDft[m], energy);
+    }
+
+    if (sampleIndex == PROPTEST_FAST_NBR_OF_SAMPLES - 1)
+    {
+      motorsStop();
+
+      // The energy of a propeller is proportional to the square of its speed and varies with twice the modulation
+      // depth. Scaled to the variance sum of the propeller test, to be compared with the same threshold.
+      for (int m = 0; m < NBR_OF_MOTORS; m++)
+      {
+        const float energyOfMotor = goertzelAmplitude(&propTestFastDft[m]) / (2.0f * PROPTEST_FAST_MODULATION_DEPTH);
+        propScore[m] = energyOfMotor * PROPTEST_NBR_OF_VARIANCE_VALUES;
+        DEBUG_PRINT("Motor M%d vibration score: %.2f\n", m + 1, (double)propScore[m]);
+      }
+
+      tick = 0;
+      testState = evaluatePropResult;
+      sensorsSetAccMode(ACC_MODE_FLIGHT);
+      return;
+    }
+  }
+
+  tick++;
+}
+
 /** Evaluate the values from the propeller test
  * @param low The low limit of the self test
  * @param high The high limit of the self test
@@ -132,7 +224,12 @@ bool healthShallWeRunTest(void)
 
   if (startPropTest != false) {
     testState = configureAcc;
+    isFastPropTest = false;
     startPropTest = false;
+  } else if (startFastPropTest != false) {
+    testState = configureAcc;
+    isFastPropTest = true;
+    startFastPropTest = false;
   } else if (startBatTest != false) {
     testState = testBattery;
     startBatTest = false;
@@ -173,11 +270,17 @@ void healthRunTests(sensorData_t *sensors)
       accVarXnf = variance(accX, PROPTEST_NBR_OF_VARIANCE_VALUES);
       accVarYnf = variance(accY, PROPTEST_NBR_OF_VARIANCE_VALUES);
       accVarZnf = variance(accZ, PROPTEST_NBR_OF_VARIANCE_VALUES);
+      accMeanXnf = mean(accX, PROPTEST_NBR_OF_VARIANCE_VALUES);
+      accMeanYnf = mean(accY, PROPTEST_NBR_OF_VARIANCE_VALUES);
       DEBUG_PRINT("Acc noise floor variance X+Y:%f, (Z:%f)\n",
                   (double)accVarXnf + (double)accVarYnf, (double)accVarZnf);
-      testState = measureProp;
+      testState = isFastPropTest ? measurePropFast : measureProp;
     }
   }
+  else if (testState == measurePropFast)
+  {
+    runFastPropTest(sensors);
+  }
   else if (testState == measureProp)
   {
     healthTestSettings = motorsGetHealthTestSettings(motorToTest);
@@ -200,6 +303,7 @@ void healthRunTests(sensorData_t *sensors)
       accVarX[motorToTest] = variance(accX, PROPTEST_NBR_OF_VARIANCE_VALUES);
       accVarY[motorToTest] = variance(accY, PROPTEST_NBR_OF_VARIANCE_VALUES);
       accVarZ[motorToTest] = variance(accZ, PROPTEST_NBR_OF_VARIANCE_VALUES);
+      propScore[motorToTest] = accVarX[motorToTest] + accVarY[motorToTest];
       DEBUG_PRINT("Motor M%d variance X+Y: %.2f (Z:%.2f), voltage sag:%.2f\n",
                    motorToTest+1,
                    (double)accVarX[motorToTest] + (double)accVarY[motorToTest],
@@ -209,7 +313,7 @@ void healthRunTests(sensorData_t *sensors)
 
     if (tick == 1 && healthTestSettings->onPeriodMsec > 0)
     {
-      motorsSetRatio(motorToTest, propTestPWMRatio > 0 ? propTestPWMRatio : healthTestSettings->onPeriodPWMRatioProp);
+      motorsSetRatio(motorToTest, propTestRatio(motorToTest));
     }
     else if (tick == healthTestSettings->onPeriodMsec)
     {
@@ -289,7 +393,7 @@ void healthRunTests(sensorData_t *sensors)
   {
     for (int m = 0; m < NBR_OF_MOTORS; m++)
     {
-      if (!evaluatePropTest(0, PROPELLER_BALANCE_TEST_THRESHOLD,  accVarX[m] + accVarY[m], m))
+      if (!evaluatePropTest(0, PROPELLER_BALANCE_TEST_THRESHOLD, propScore[m], m))
       {
         nrFailedTests++;
         for (int j = 0; j < 3; j++)
@@ -314,7 +418,17 @@ void healthRunTests(sensorData_t *sensors)
     }
 #endif
     motorTestCount++;
-    testState = testDone;
+    if (isFastPropTest)
+    {
+      // The battery test is part of the fast test
+      isFastPropTest = false;
+      testState = testBattery;
+      tick = 0;
+    }
+    else
+    {
+      testState = testDone;
+    }
   }
 }
 
@@ -329,6 +443,11 @@ PARAM_GROUP_START(health)
  */
 PARAM_ADD_CORE(PARAM_UINT8, startPropTest, &startPropTest)
 
+/**
+ * @brief Set nonzero to initiate the fast test of all propellers at once, followed by the battery test
+ */
+PARAM_ADD_CORE(PARAM_UINT8, startFastTest, &startFastPropTest)
+
 /**
  * @brief Set nonzero to initiate test of battery
  */
@@ -382,6 +501,22 @@ LOG_ADD(LOG_FLOAT, motorVarXM4, &accVarX[3])
  * @brief Variance test result of accel. axis Y on motor 4
  */
 LOG_ADD(LOG_FLOAT, motorVarYM4, &accVarY[3])
+/**
+ * @brief Vibration score of motor 1, X+Y variance of the propeller test or the estimate of it from the fast test
+ */
+LOG_ADD(LOG_FLOAT, propScoreM1, &propScore[0])
+/**
+ * @brief Vibration score of motor 2
+ */
+LOG_ADD(LOG_FLOAT, propScoreM2, &propScore[1])
+/**
+ * @brief Vibration score of motor 3
+ */
+LOG_ADD(LOG_FLOAT, propScoreM3, &propScore[2])
+/**
+ * @brief Vibration score of motor 4
+ */
+LOG_ADD(LOG_FLOAT, propScoreM4, &propScore[3])
 /**
  * @brief Propeller test result, bit is one if OK. [Bit0=M1 Bit1=M2 ...]
  */
@@ -63,9 +63,13 @@
 
 #include "math3d.h"
 #include "static_mem.h"
+#include "test_support.h"
 
 // #define DEBUG_STATE_CHECK
 
+// Use the dense reference implementation for the covariance prediction instead of the block-sparse one
+// #define KALMAN_CORE_DENSE_PREDICTION
+
 // the reversion of pitch and roll to zero
 #ifdef CONFIG_DECK_LOCO_2D_POSITION
 #define ROLLPITCH_ZERO_REVERSION (0.0f)
@@ -97,13 +101,10 @@ static void assertStateNotNaN(const kalmanCoreData_t* this) {
     ASSERT(false);
   }
 
-  for(int i=0; i<KC_STATE_DIM; i++) {
-    for(int j=0; j<KC_STATE_DIM; j++)
-    {
-      if (isnan(this->P[i][j]))
-      {
-        ASSERT(false);
-      }
+  // enforceCovarianceBounds() replaces NaN in the normal flow, the debug check catches where they come from
+  for (int i = 0; i < KC_STATE_PACKED_DIM; i++) {
+    if (!isfinite(this->P[i])) {
+      ASSERT(false);
     }
   }
 }
@@ -122,6 +123,213 @@ static void assertStateNotNaN(const kalmanCoreData_t* this)
 // Small number epsilon, to prevent dividing by zero
 #define EPS (1e-6f)
 
+// Temporary matrix shared by the symmetric covariance kernels below
+NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN[KC_STATE_DIM][KC_STATE_DIM];
+
+/**
+ * Symmetric covariance kernels
+ *
+ * P is symmetric by construction and is stored packed (upper triangle only). The kernels below work directly on the
+ * packed representation and only compute the upper triangle of symmetric results, which saves both flops and
+ * temporary storage compared to dense matrix multiplications. Symmetry is guaranteed by the storage format, there is
+ * no need to re-symmetrize the matrix after an update.
+ */
+
+// out = P * v
+static void symmetricMultVector(const float P[KC_STATE_PACKED_DIM], const float v[KC_STATE_DIM], float out[KC_STATE_DIM])
+{
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    out[i] = 0;
+  }
+
+  int idx = 0;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    out[i] += P[idx] * v[i];
+    idx++;
+    for (int j = i + 1; j < KC_STATE_DIM; j++, idx++) {
+      out[i] += P[idx] * v[j];
+      out[j] += P[idx] * v[i];
+    }
+  }
+}
+
+// P = A * P * A'
+TESTABLE_STATIC void symmetricSandwich(const float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_PACKED_DIM])
+{
+  // tmpNN = A * P, each stored element of P is visited once
+  memset(tmpNN, 0, sizeof(tmpNN));
+  int idx = 0;
+  for (int k = 0; k < KC_STATE_DIM; k++) {
+    const float pkk = P[idx];
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      tmpNN[i][k] += A[i][k] * pkk;
+    }
+    idx++;
+
+    for (int l = k + 1; l < KC_STATE_DIM; l++, idx++) {
+      const float pkl = P[idx];
+      for (int i = 0; i < KC_STATE_DIM; i++) {
+        tmpNN[i][l] += A[i][k] * pkl;
+        tmpNN[i][k] += A[i][l] * pkl;
+      }
+    }
+  }
+
+  // P = tmpNN * A', upper triangle only
+  idx = 0;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++, idx++) {
+      float sum = 0;
+      for (int k = 0; k < KC_STATE_DIM; k++) {
+        sum += tmpNN[i][k] * A[j][k];
+      }
+      P[idx] = sum;
+    }
+  }
+}
+
+/**
+ * Block-sparse covariance prediction
+ *
+ * The linearized dynamics used in the prediction is block upper triangular when partitioned into position (x),
+ * body velocity (v) and attitude error (d):
+ *
+ *     | I  Axv Axd |
+ * A = | 0  Avv Avd |
+ *     | 0  0   Add |
+ *
+ * Only the non-trivial blocks are multiplied. This requires about a third of the multiplications of the dense
+ * A * P * A', symmetricSandwich() is kept as the reference implementation.
+ */
+
+#define KC_BLOCK_X KC_STATE_X
+#define KC_BLOCK_V KC_STATE_PX
+#define KC_BLOCK_D KC_STATE_D0
+
+static void getBlock(const float A[KC_STATE_DIM][KC_STATE_DIM], int row, int col, float B[3][3])
+{
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      B[i][j] = A[row + i][col + j];
+    }
+  }
+}
+
+static void getCovarianceBlock(const float P[KC_STATE_PACKED_DIM], int row, int col, float B[3][3])
+{
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      B[i][j] = P[KC_PACKED_INDEX(row + i, col + j)];
+    }
+  }
+}
+
+// Only the upper triangle is written for blocks on the diagonal
+static void setCovarianceBlock(float P[KC_STATE_PACKED_DIM], int row, int col, const float B[3][3])
+{
+  for (int i = 0; i < 3; i++) {
+    for (int j = (row == col) ? i : 0; j < 3; j++) {
+      P[KC_PACKED_INDEX(row + i, col + j)] = B[i][j];
+    }
+  }
+}
+
+// C += A * B, or C += A * B' if transB is set
+static void multAdd33(const float A[3][3], const float B[3][3], bool transB, float C[3][3])
+{
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      float sum = C[i][j];
+      for (int k = 0; k < 3; k++) {
+        sum += A[i][k] * (transB ? B[j][k] : B[k][j]);
+      }
+      C[i][j] = sum;
+    }
+  }
+}
+
+// P = A * P * A', where A must have the block structure described above
+TESTABLE_STATIC void predictCovarianceBlockSparse(const float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_PACKED_DIM])
+{
+  float Axv[3][3], Axd[3][3], Avv[3][3], Avd[3][3], Add[3][3];
+  getBlock(A, KC_BLOCK_X, KC_BLOCK_V, Axv);
+  getBlock(A, KC_BLOCK_X, KC_BLOCK_D, Axd);
+  getBlock(A, KC_BLOCK_V, KC_BLOCK_V, Avv);
+  getBlock(A, KC_BLOCK_V, KC_BLOCK_D, Avd);
+  getBlock(A, KC_BLOCK_D, KC_BLOCK_D, Add);
+
+  float Pxx[3][3], Pxv[3][3], Pxd[3][3], Pvv[3][3], Pvd[3][3], Pdd[3][3];
+  getCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_X, Pxx);
+  getCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_V, Pxv);
+  getCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_D, Pxd);
+  getCovarianceBlock(P, KC_BLOCK_V, KC_BLOCK_V, Pvv);
+  getCovarianceBlock(P, KC_BLOCK_V, KC_BLOCK_D, Pvd);
+  getCovarianceBlock(P, KC_BLOCK_D, KC_BLOCK_D, Pdd);
+
+  // T = A * P, the blocks below the diagonal are not needed
+  float Txx[3][3], Txv[3][3], Txd[3][3];
+  memcpy(Txx, Pxx, sizeof(Txx));
+  memcpy(Txv, Pxv, sizeof(Txv));
+  memcpy(Txd, Pxd, sizeof(Txd));
+  multAdd33(Axv, Pxv, true, Txx);
+  multAdd33(Axd, Pxd, true, Txx);
+  multAdd33(Axv, Pvv, false, Txv);
+  multAdd33(Axd, Pvd, true, Txv);
+  multAdd33(Axv, Pvd, false, Txd);
+  multAdd33(Axd, Pdd, false, Txd);
+
+  float Tvv[3][3] = {0}, Tvd[3][3] = {0}, Tdd[3][3] = {0};
+  multAdd33(Avv, Pvv, false, Tvv);
+  multAdd33(Avd, Pvd, true, Tvv);
+  multAdd33(Avv, Pvd, false, Tvd);
+  multAdd33(Avd, Pdd, false, Tvd);
+  multAdd33(Add, Pdd, false, Tdd);
+
+  // P = T * A'
+  multAdd33(Txv, Axv, true, Txx);
+  multAdd33(Txd, Axd, true, Txx);
+  setCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_X, Txx);
+
+  float B[3][3] = {0};
+  multAdd33(Txv, Avv, true, B);
+  multAdd33(Txd, Avd, true, B);
+  setCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_V, B);
+
+  memset(B, 0, sizeof(B));
+  multAdd33(Txd, Add, true, B);
+  setCovarianceBlock(P, KC_BLOCK_X, KC_BLOCK_D, B);
+
+  memset(B, 0, sizeof(B));
+  multAdd33(Tvv, Avv, true, B);
+  multAdd33(Tvd, Avd, true, B);
+  setCovarianceBlock(P, KC_BLOCK_V, KC_BLOCK_V, B);
+
+  memset(B, 0, sizeof(B));
+  multAdd33(Tvd, Add, true, B);
+  setCovarianceBlock(P, KC_BLOCK_V, KC_BLOCK_D, B);
+
+  memset(B, 0, sizeof(B));
+  multAdd33(Tdd, Add, true, B);
+  setCovarianceBlock(P, KC_BLOCK_D, KC_BLOCK_D, B);
+}
+
+// Ensure the values of the covariance matrix stay bounded
+// TODO: Why would it hit these bounds? Needs to be investigated.
+static void enforceCovarianceBounds(float P[KC_STATE_PACKED_DIM])
+{
+  int idx = 0;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++, idx++) {
+      float p = P[idx];
+      if (isnan(p) || p > MAX_COVARIANCE) {
+        P[idx] = MAX_COVARIANCE;
+      } else if ( i==j && p < MIN_COVARIANCE ) {
+        P[idx] = MIN_COVARIANCE;
+      }
+    }
+  }
+}
+
 void kalmanCoreDefaultParams(kalmanCoreParams_t* params)
 {
   // Initial variances, uncertain of position, but know we're stationary and roughly flat
@@ -150,6 +358,24 @@ void kalmanCoreDefaultParams(kalmanCoreParams_t* params)
   // PI --- facing negative X
   // 3 * PI / 2 --- facing negative Y
   params->initialYaw = 0.0;
+
+  params->attitudeErrorSmallAngle = 1e-3f;
+}
+
+// Convert the attitude to a rotation matrix, such that we can rotate body-frame velocity and acc
+static void updateRotationMatrix(kalmanCoreData_t* this)
+{
+  this->R[0][0] = this->q[0] * this->q[0] + this->q[1] * this->q[1] - this->q[2] * this->q[2] - this->q[3] * this->q[3];
+  this->R[0][1] = 2 * this->q[1] * this->q[2] - 2 * this->q[0] * this->q[3];
+  this->R[0][2] = 2 * this->q[1] * this->q[3] + 2 * this->q[0] * this->q[2];
+
+  this->R[1][0] = 2 * this->q[1] * this->q[2] + 2 * this->q[0] * this->q[3];
+  this->R[1][1] = this->q[0] * this->q[0] - this->q[1] * this->q[1] + this->q[2] * this->q[2] - this->q[3] * this->q[3];
+  this->R[1][2] = 2 * this->q[2] * this->q[3] - 2 * this->q[0] * this->q[1];
+
+  this->R[2][0] = 2 * this->q[1] * this->q[3] - 2 * this->q[0] * this->q[2];
+  this->R[2][1] = 2 * this->q[2] * this->q[3] + 2 * this->q[0] * this->q[1];
+  this->R[2][2] = this->q[0] * this->q[0] - this->q[1] * this->q[1] - this->q[2] * this->q[2] + this->q[3] * this->q[3];
 }
 
 void kalmanCoreInit(kalmanCoreData_t *this, const kalmanCoreParams_t *params, const uint32_t nowMs)
@@ -179,71 +405,129 @@ void kalmanCoreInit(kalmanCoreData_t *this, const kalmanCoreParams_t *params, co
   // attitude errors into the attitude state, the rotation matrix is updated.
   for(int i=0; i<3; i++) { for(int j=0; j<3; j++) { this->R[i][j] = i==j ? 1 : 0; }}
 
-  for (int i=0; i< KC_STATE_DIM; i++) {
-    for (int j=0; j < KC_STATE_DIM; j++) {
-      this->P[i][j] = 0; // set covariances to zero (diagonals will be changed from zero in the next section)
-    }
+  for (int i=0; i< KC_STATE_PACKED_DIM; i++) {
+    this->P[i] = 0; // set covariances to zero (diagonals will be changed from zero in the next section)
   }
 
   // initialize state variances
-  this->P[KC_STATE_X][KC_STATE_X]  = powf(params->stdDevInitialPosition_xy, 2);
-  this->P[KC_STATE_Y][KC_STATE_Y]  = powf(params->stdDevInitialPosition_xy, 2);
-  this->P[KC_STATE_Z][KC_STATE_Z]  = powf(params->stdDevInitialPosition_z, 2);
-
-  this->P[KC_STATE_PX][KC_STATE_PX] = powf(params->stdDevInitialVelocity, 2);
-  this->P[KC_STATE_PY][KC_STATE_PY] = powf(params->stdDevInitialVelocity, 2);
-  this->P[KC_STATE_PZ][KC_STATE_PZ] = powf(params->stdDevInitialVelocity, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_X, KC_STATE_X)]  = powf(params->stdDevInitialPosition_xy, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_Y, KC_STATE_Y)]  = powf(params->stdDevInitialPosition_xy, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_Z, KC_STATE_Z)]  = powf(params->stdDevInitialPosition_z, 2);
 
-  this->P[KC_STATE_D0][KC_STATE_D0] = powf(params->stdDevInitialAttitude_rollpitch, 2);
-  this->P[KC_STATE_D1][KC_STATE_D1] = powf(params->stdDevInitialAttitude_rollpitch, 2);
-  this->P[KC_STATE_D2][KC_STATE_D2] = powf(params->stdDevInitialAttitude_yaw, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_PX, KC_STATE_PX)] = powf(params->stdDevInitialVelocity, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_PY, KC_STATE_PY)] = powf(params->stdDevInitialVelocity, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_PZ, KC_STATE_PZ)] = powf(params->stdDevInitialVelocity, 2);
 
-  this->Pm.numRows = KC_STATE_DIM;
-  this->Pm.numCols = KC_STATE_DIM;
-  this->Pm.pData = (float*)this->P;
+  this->P[KC_PACKED_INDEX(KC_STATE_D0, KC_STATE_D0)] = powf(params->stdDevInitialAttitude_rollpitch, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_D1, KC_STATE_D1)] = powf(params->stdDevInitialAttitude_rollpitch, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_D2, KC_STATE_D2)] = powf(params->stdDevInitialAttitude_yaw, 2);
 
   this->baroReferenceHeight = 0.0;
 
   this->isUpdated = false;
   this->lastPredictionMs = nowMs;
+  this->lastPredictionSampleTimeUs = 0;
   this->lastProcessNoiseUpdateMs = nowMs;
 }
 
-void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
+void kalmanCoreInitFromState(kalmanCoreData_t *this, const kalmanCoreParams_t *params, const uint32_t nowMs, const state_t *state)
 {
-  // The Kalman gain as a column vector
-  NO_DMA_CCM_SAFE_ZERO_INIT static float K[KC_STATE_DIM];
-  static arm_matrix_instance_f32 Km = {KC_STATE_DIM, 1, (float *)K};
+  kalmanCoreInit(this, params, nowMs);
 
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN1m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
+  this->S[KC_STATE_X] = state->position.x;
+  this->S[KC_STATE_Y] = state->position.y;
+  this->S[KC_STATE_Z] = state->position.z;
 
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN2m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
+  const float q[4] = {state->attitudeQuaternion.w, state->attitudeQuaternion.x, state->attitudeQuaternion.y, state->attitudeQuaternion.z};
+  const float norm = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  if (norm > 0.5f) {
+    for (int i = 0; i < 4; i++) {
+      this->q[i] = q[i] / norm;
+    }
+
+    // Roll and pitch revert to level when not flying, only keep the yaw in the reference
+    const float yaw = atan2f(2 * (this->q[1] * this->q[2] + this->q[0] * this->q[3]),
+      this->q[0] * this->q[0] + this->q[1] * this->q[1] - this->q[2] * this->q[2] - this->q[3] * this->q[3]);
+    this->initialQuaternion[0] = arm_cos_f32(yaw / 2);
+    this->initialQuaternion[1] = 0.0;
+    this->initialQuaternion[2] = 0.0;
+    this->initialQuaternion[3] = arm_sin_f32(yaw / 2);
+  }
+  updateRotationMatrix(this);
 
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float tmpNN3d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN3m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN3d};
+  // The velocity state is in the body frame
+  const velocity_t* v = &state->velocity;
+  this->S[KC_STATE_PX] = this->R[0][0] * v->x + this->R[1][0] * v->y + this->R[2][0] * v->z;
+  this->S[KC_STATE_PY] = this->R[0][1] * v->x + this->R[1][1] * v->y + this->R[2][1] * v->z;
+  this->S[KC_STATE_PZ] = this->R[0][2] * v->x + this->R[1][2] * v->y + this->R[2][2] * v->z;
+}
 
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float HTd[KC_STATE_DIM * 1];
-  static arm_matrix_instance_f32 HTm = {KC_STATE_DIM, 1, HTd};
+// The Kalman gain as a column vector
+NO_DMA_CCM_SAFE_ZERO_INIT static float K[KC_STATE_DIM];
 
-  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float PHTd[KC_STATE_DIM * 1];
-  static arm_matrix_instance_f32 PHTm = {KC_STATE_DIM, 1, PHTd};
+NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float PHTd[KC_STATE_DIM * 1];
 
-  ASSERT(Hm->numRows == 1);
-  ASSERT(Hm->numCols == KC_STATE_DIM);
+/**
+ * Joseph form covariance update for a scalar measurement, P = (I - KH) P (I - KH)' + K R K'
+ *
+ * KH is rank-1, so the product is done in two rank-1 passes, O(N^2) instead of the O(N^3) of the dense products:
+ * P1 = (I - KH) P = P - K (PH')'
+ * P = P1 (I - KH)' + K R K' = P1 - (P1 H') K' + R K K'
+ * Expanding the product into a single expression is not an option, with K = PH' / (HPH' + R) it reduces to the
+ * standard update P - K (PH')' and the protection of the Joseph form against round off errors is lost. P1 is not
+ * symmetric with round off errors and is kept as a full matrix.
+ */
+TESTABLE_STATIC void rank1JosephUpdate(float P[KC_STATE_PACKED_DIM], const float h[KC_STATE_DIM], const float K[KC_STATE_DIM], const float PHT[KC_STATE_DIM], const float R)
+{
+  // tmpNN = P1 = P - K (PH')'
+  int idx = 0;
+  for (int i=0; i<KC_STATE_DIM; i++) {
+    tmpNN[i][i] = P[idx] - K[i] * PHT[i];
+    idx++;
+    for (int j=i+1; j<KC_STATE_DIM; j++, idx++) {
+      tmpNN[i][j] = P[idx] - K[i] * PHT[j];
+      tmpNN[j][i] = P[idx] - K[j] * PHT[i];
+    }
+  }
+
+  // P1 H'
+  float P1HT[KC_STATE_DIM];
+  for (int i=0; i<KC_STATE_DIM; i++) {
+    float sum = 0;
+    for (int j=0; j<KC_STATE_DIM; j++) {
+      sum += tmpNN[i][j] * h[j];
+    }
+    P1HT[i] = sum;
+  }
+
+  // P = P1 - (P1 H') K' + R K K', upper triangle only
+  idx = 0;
+  for (int i=0; i<KC_STATE_DIM; i++) {
+    const float RKi = R * K[i];
+    for (int j=i; j<KC_STATE_DIM; j++, idx++) {
+      P[idx] = tmpNN[i][j] - P1HT[i] * K[j] + RKi * K[j];
+    }
+  }
+}
 
+// Scalar update without any sanity checks of the state, it is up to the caller to verify the state afterwards.
+// A NaN in h or P shows up in HPH' + R, so with a finite innovation and innovation covariance the update keeps a finite
+// state finite. Other updates are dropped, which leaves the supervisor with the finalized state to check.
+static void scalarUpdateUnchecked(kalmanCoreData_t* this, const float* h, float error, float stdMeasNoise)
+{
   // ====== INNOVATION COVARIANCE ======
 
-  mat_trans(Hm, &HTm);
-  mat_mult(&this->Pm, &HTm, &PHTm); // PH'
+  symmetricMultVector(this->P, h, PHTd); // PH'
   float R = stdMeasNoise*stdMeasNoise;
   float HPHR = R; // HPH' + R
   for (int i=0; i<KC_STATE_DIM; i++) { // Add the element of HPH' to the above
-    HPHR += Hm->pData[i]*PHTd[i]; // this obviously only works if the update is scalar (as in this function)
+    HPHR += h[i]*PHTd[i]; // this obviously only works if the update is scalar (as in this function)
+  }
+
+  if (!(isfinite(error) && isfinite(HPHR) && HPHR > 0.0f)) {
+    this->nonFiniteUpdateCount++;
+    return;
   }
-  ASSERT(!isnan(HPHR));
 
   // ====== MEASUREMENT UPDATE ======
   // Calculate the Kalman gain and perform the state update
@@ -251,31 +535,32 @@ void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm,
     K[i] = PHTd[i]/HPHR; // kalman gain = (PH' (HPH' + R )^-1)
     this->S[i] = this->S[i] + K[i] * error; // state update
   }
-  assertStateNotNaN(this);
 
   // ====== COVARIANCE UPDATE ======
-  mat_mult(&Km, Hm, &tmpNN1m); // KH
-  for (int i=0; i<KC_STATE_DIM; i++) { tmpNN1d[KC_STATE_DIM*i+i] -= 1; } // KH - I
-  mat_trans(&tmpNN1m, &tmpNN2m); // (KH - I)'
-  mat_mult(&tmpNN1m, &this->Pm, &tmpNN3m); // (KH - I)*P
-  mat_mult(&tmpNN3m, &tmpNN2m, &this->Pm); // (KH - I)*P*(KH - I)'
+  rank1JosephUpdate(this->P, h, K, PHTd, R); // (KH - I)*P*(KH - I)' + K*R*K'
+  enforceCovarianceBounds(this->P);
+}
+
+void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
+{
+  ASSERT(Hm->numRows == 1);
+  ASSERT(Hm->numCols == KC_STATE_DIM);
+
+  scalarUpdateUnchecked(this, Hm->pData, error, stdMeasNoise);
   assertStateNotNaN(this);
-  // add the measurement variance and ensure boundedness and symmetry
-  // TODO: Why would it hit these bounds? Needs to be investigated.
-  for (int i=0; i<KC_STATE_DIM; i++) {
-    for (int j=i; j<KC_STATE_DIM; j++) {
-      float v = K[i] * R * K[j];
-      float p = 0.5f*this->P[i][j] + 0.5f*this->P[j][i] + v; // add measurement noise
-      if (isnan(p) || p > MAX_COVARIANCE) {
-        this->P[i][j] = this->P[j][i] = MAX_COVARIANCE;
-      } else if ( i==j && p < MIN_COVARIANCE ) {
-        this->P[i][j] = this->P[j][i] = MIN_COVARIANCE;
-      } else {
-        this->P[i][j] = this->P[j][i] = p;
-      }
-    }
+
+  this->isUpdated = true;
+}
+
+void kalmanCoreBatchUpdate(kalmanCoreData_t* this, const kalmanCoreScalarMeasurement_t* measurements, const int count)
+{
+  if (count <= 0) {
+    return;
   }
 
+  for (int i = 0; i < count; i++) {
+    scalarUpdateUnchecked(this, measurements[i].h, measurements[i].error, measurements[i].stdMeasNoise);
+  }
   assertStateNotNaN(this);
 
   this->isUpdated = true;
@@ -284,35 +569,38 @@ void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm,
 void kalmanCoreUpdateWithPKE(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error)
 {
     // kalman filter update with weighted covariance matrix P_w_m, kalman gain Km, and innovation error
-    // Temporary matrices for the covariance updates
-    static float tmpNN1d[KC_STATE_DIM][KC_STATE_DIM];
-    static arm_matrix_instance_f32 tmpNN1m = {KC_STATE_DIM, KC_STATE_DIM, (float *)tmpNN1d};
+    const float* K = Km->pData;
+    const float* h = Hm->pData;
+    const float (*P_w)[KC_STATE_DIM] = (const float (*)[KC_STATE_DIM])P_w_m->pData;
     for (int i=0; i<KC_STATE_DIM; i++){
-        this->S[i] = this->S[i] + Km->pData[i] * error;
+        this->S[i] = this->S[i] + K[i] * error;
     }
     // ====== COVARIANCE UPDATE ====== //
-    mat_mult(Km, Hm, &tmpNN1m);                 // KH,  the Kalman Gain and H are the updated Kalman Gain and H
-    mat_scale(&tmpNN1m, -1.0f, &tmpNN1m);       //  I-KH
-    for (int i=0; i<KC_STATE_DIM; i++) { tmpNN1d[i][i] = 1.0f + tmpNN1d[i][i]; }
-    float Ppo[KC_STATE_DIM][KC_STATE_DIM]={0};
-    arm_matrix_instance_f32 Ppom = {KC_STATE_DIM, KC_STATE_DIM, (float *)Ppo};
-    mat_mult(&tmpNN1m, P_w_m, &Ppom);          // Pm = (I-KH)*P_w_m
-    memcpy(this->P, Ppo, sizeof(this->P));
-
-    assertStateNotNaN(this);
+    // The measurement is scalar, (I-KH)*P_w = P_w - K*(H*P_w) is a rank one update of P_w. Only the row vector
+    // H*P_w is computed instead of the full KH and (I-KH)*P_w matrix products.
+    float HP[KC_STATE_DIM] = {0};
+    for (int k=0; k<KC_STATE_DIM; k++) {
+        if (h[k] != 0.0f) {
+            for (int j=0; j<KC_STATE_DIM; j++) {
+                HP[j] += h[k] * P_w[k][j];
+            }
+        }
+    }
+    float Ppo[KC_STATE_DIM][KC_STATE_DIM];
+    for (int i=0; i<KC_STATE_DIM; i++) {
+        for (int j=0; j<KC_STATE_DIM; j++) {
+            Ppo[i][j] = P_w[i][j] - K[i] * HP[j];   // Pm = (I-KH)*P_w_m
+        }
+    }
 
+    // The product is not exactly symmetric, pack the average of the upper and lower triangles
+    int idx = 0;
     for (int i=0; i<KC_STATE_DIM; i++) {
-        for (int j=i; j<KC_STATE_DIM; j++) {
-        float p = 0.5f*this->P[i][j] + 0.5f*this->P[j][i];
-        if (isnan(p) || p > MAX_COVARIANCE) {
-            this->P[i][j] = this->P[j][i] = MAX_COVARIANCE;
-        } else if ( i==j && p < MIN_COVARIANCE ) {
-            this->P[i][j] = this->P[j][i] = MIN_COVARIANCE;
-        } else {
-            this->P[i][j] = this->P[j][i] = p;
-            }
+        for (int j=i; j<KC_STATE_DIM; j++, idx++) {
+            this->P[idx] = 0.5f*Ppo[i][j] + 0.5f*Ppo[j][i];
         }
     }
+    enforceCovarianceBounds(this->P);
     assertStateNotNaN(this);
 
     this->isUpdated = true;
@@ -358,15 +646,7 @@ static void predictDt(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, float d
    */
 
   // The linearized update matrix
-  NO_DMA_CCM_SAFE_ZERO_INIT static float A[KC_STATE_DIM][KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 Am = { KC_STATE_DIM, KC_STATE_DIM, (float *)A}; // linearized dynamics for covariance update;
-
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 tmpNN1m = { KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static __attribute__((aligned(4))) arm_matrix_instance_f32 tmpNN2m = { KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
+  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float A[KC_STATE_DIM][KC_STATE_DIM]; // linearized dynamics for covariance update
 
   float dt2 = dt*dt;
 
@@ -470,9 +750,11 @@ static void predictDt(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, float d
 
 
   // ====== COVARIANCE UPDATE ======
-  mat_mult(&Am, &this->Pm, &tmpNN1m); // A P
-  mat_trans(&Am, &tmpNN2m); // A'
-  mat_mult(&tmpNN1m, &tmpNN2m, &this->Pm); // A P A'
+#ifdef KALMAN_CORE_DENSE_PREDICTION
+  symmetricSandwich(A, this->P); // A P A'
+#else
+  predictCovarianceBlockSparse(A, this->P); // A P A'
+#endif
   // Process noise is added after the return from the prediction step
 
   // ====== PREDICTION STEP ======
@@ -572,38 +854,50 @@ static void predictDt(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, float d
 }
 
 void kalmanCorePredict(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, const uint32_t nowMs, bool quadIsFlying) {
+  kalmanCorePredictAtSampleTime(this, acc, gyro, nowMs, 0, quadIsFlying);
+}
+
+// Sample time steps longer than this are not trusted, for instance after the time stamps of the IMU have stopped
+#define MAX_SAMPLE_TIME_STEP_US 100000
+
+void kalmanCorePredictAtSampleTime(kalmanCoreData_t* this, Axis3f *acc, Axis3f *gyro, const uint32_t nowMs, const uint32_t sampleTimeUs, bool quadIsFlying) {
   float dt = (nowMs - this->lastPredictionMs) / 1000.0f;
+
+  if (sampleTimeUs != 0 && this->lastPredictionSampleTimeUs != 0) {
+    // Unsigned difference, handles wrap around of the 32 bit time stamps
+    const uint32_t sampleDtUs = sampleTimeUs - this->lastPredictionSampleTimeUs;
+    if (sampleDtUs == 0) {
+      // No new IMU samples, the time up to the newest sample has already been predicted
+      this->lastPredictionMs = nowMs;
+      return;
+    }
+
+    if (sampleDtUs < MAX_SAMPLE_TIME_STEP_US) {
+      dt = sampleDtUs / 1000000.0f;
+    }
+  }
+
   predictDt(this, acc, gyro, dt, quadIsFlying);
   this->lastPredictionMs = nowMs;
+  this->lastPredictionSampleTimeUs = sampleTimeUs;
 }
 
 
 static void addProcessNoiseDt(kalmanCoreData_t *this, const kalmanCoreParams_t *params, float dt)
 {
-  this->P[KC_STATE_X][KC_STATE_X] += powf(params->procNoiseAcc_xy*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
-  this->P[KC_STATE_Y][KC_STATE_Y] += powf(params->procNoiseAcc_xy*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
-  this->P[KC_STATE_Z][KC_STATE_Z] += powf(params->procNoiseAcc_z*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
+  this->P[KC_PACKED_INDEX(KC_STATE_X, KC_STATE_X)] += powf(params->procNoiseAcc_xy*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
+  this->P[KC_PACKED_INDEX(KC_STATE_Y, KC_STATE_Y)] += powf(params->procNoiseAcc_xy*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
+  this->P[KC_PACKED_INDEX(KC_STATE_Z, KC_STATE_Z)] += powf(params->procNoiseAcc_z*dt*dt + params->procNoiseVel*dt + params->procNoisePos, 2);  // add process noise on position
 
-  this->P[KC_STATE_PX][KC_STATE_PX] += powf(params->procNoiseAcc_xy*dt + params->procNoiseVel, 2); // add process noise on velocity
-  this->P[KC_STATE_PY][KC_STATE_PY] += powf(params->procNoiseAcc_xy*dt + params->procNoiseVel, 2); // add process noise on velocity
-  this->P[KC_STATE_PZ][KC_STATE_PZ] += powf(params->procNoiseAcc_z*dt + params->procNoiseVel, 2); // add process noise on velocity
+  this->P[KC_PACKED_INDEX(KC_STATE_PX, KC_STATE_PX)] += powf(params->procNoiseAcc_xy*dt + params->procNoiseVel, 2); // add process noise on velocity
+  this->P[KC_PACKED_INDEX(KC_STATE_PY, KC_STATE_PY)] += powf(params->procNoiseAcc_xy*dt + params->procNoiseVel, 2); // add process noise on velocity
+  this->P[KC_PACKED_INDEX(KC_STATE_PZ, KC_STATE_PZ)] += powf(params->procNoiseAcc_z*dt + params->procNoiseVel, 2); // add process noise on velocity
 
-  this->P[KC_STATE_D0][KC_STATE_D0] += powf(params->measNoiseGyro_rollpitch * dt + params->procNoiseAtt, 2);
-  this->P[KC_STATE_D1][KC_STATE_D1] += powf(params->measNoiseGyro_rollpitch * dt + params->procNoiseAtt, 2);
-  this->P[KC_STATE_D2][KC_STATE_D2] += powf(params->measNoiseGyro_yaw * dt + params->procNoiseAtt, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_D0, KC_STATE_D0)] += powf(params->measNoiseGyro_rollpitch * dt + params->procNoiseAtt, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_D1, KC_STATE_D1)] += powf(params->measNoiseGyro_rollpitch * dt + params->procNoiseAtt, 2);
+  this->P[KC_PACKED_INDEX(KC_STATE_D2, KC_STATE_D2)] += powf(params->measNoiseGyro_yaw * dt + params->procNoiseAtt, 2);
 
-  for (int i=0; i<KC_STATE_DIM; i++) {
-    for (int j=i; j<KC_STATE_DIM; j++) {
-      float p = 0.5f*this->P[i][j] + 0.5f*this->P[j][i];
-      if (isnan(p) || p > MAX_COVARIANCE) {
-        this->P[i][j] = this->P[j][i] = MAX_COVARIANCE;
-      } else if ( i==j && p < MIN_COVARIANCE ) {
-        this->P[i][j] = this->P[j][i] = MIN_COVARIANCE;
-      } else {
-        this->P[i][j] = this->P[j][i] = p;
-      }
-    }
-  }
+  enforceCovarianceBounds(this->P);
 
   assertStateNotNaN(this);
 }
@@ -616,7 +910,52 @@ void kalmanCoreAddProcessNoise(kalmanCoreData_t *this, const kalmanCoreParams_t
   }
 }
 
-bool kalmanCoreFinalize(kalmanCoreData_t* this)
+/**
+ * Rotate the covariance by A = diag(I, I + [[d]]), the first order version of the rotation in kalmanCoreFinalize(),
+ * where [[d]] = [0 d2 -d1; -d2 0 d0; d1 -d0 0]. Only the rows and columns of the attitude error are affected:
+ * P_xd = P_xd (I + [[d]])'
+ * P_dd = P_dd + [[d]] P_dd + P_dd [[d]]'
+ * The second order terms are dropped. They are of the order |d|^2 |P| with d = v/2, an error of about 1e-6 relative to
+ * the covariance at the default attitudeErrorSmallAngle of 1e-3 rad, and it grows with the square of the limit.
+ */
+TESTABLE_STATIC void rotateCovarianceFirstOrder(float P[KC_STATE_PACKED_DIM], const float d0, const float d1, const float d2)
+{
+  const float S[3][3] = {
+    {  0,  d2, -d1},
+    {-d2,   0,  d0},
+    { d1, -d0,   0},
+  };
+
+  // Attitude error columns of P, the cross terms for all states
+  float Pd[KC_STATE_DIM][3];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int k = 0; k < 3; k++) {
+      Pd[i][k] = P[KC_PACKED_INDEX(i, KC_STATE_D0 + k)];
+    }
+  }
+
+  // P_xd (I + [[d]])'
+  for (int i = 0; i < KC_STATE_D0; i++) {
+    for (int j = 0; j < 3; j++) {
+      P[KC_PACKED_INDEX_UPPER(i, KC_STATE_D0 + j)] += Pd[i][0] * S[j][0] + Pd[i][1] * S[j][1] + Pd[i][2] * S[j][2];
+    }
+  }
+
+  // P_dd + [[d]] P_dd + P_dd [[d]]', (P_dd [[d]]')_ij = ([[d]] P_dd)_ji since P_dd is symmetric
+  float SP[3][3];
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      SP[i][j] = S[i][0] * Pd[KC_STATE_D0][j] + S[i][1] * Pd[KC_STATE_D1][j] + S[i][2] * Pd[KC_STATE_D2][j];
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = i; j < 3; j++) {
+      P[KC_PACKED_INDEX_UPPER(KC_STATE_D0 + i, KC_STATE_D0 + j)] += SP[i][j] + SP[j][i];
+    }
+  }
+}
+
+bool kalmanCoreFinalize(kalmanCoreData_t* this, const kalmanCoreParams_t *params)
 {
   // Only finalize if data is updated
   if (! this->isUpdated) {
@@ -625,15 +964,7 @@ bool kalmanCoreFinalize(kalmanCoreData_t* this)
 
 
   // Matrix to rotate the attitude covariances once updated
-  NO_DMA_CCM_SAFE_ZERO_INIT static float A[KC_STATE_DIM][KC_STATE_DIM];
-  static arm_matrix_instance_f32 Am = {KC_STATE_DIM, KC_STATE_DIM, (float *)A};
-
-  // Temporary matrices for the covariance updates
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN1d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN1m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN1d};
-
-  NO_DMA_CCM_SAFE_ZERO_INIT static float tmpNN2d[KC_STATE_DIM * KC_STATE_DIM];
-  static arm_matrix_instance_f32 tmpNN2m = {KC_STATE_DIM, KC_STATE_DIM, tmpNN2d};
+  NO_DMA_CCM_SAFE_ZERO_INIT __attribute__((aligned(4))) static float A[KC_STATE_DIM][KC_STATE_DIM];
 
   // Incorporate the attitude error (Kalman filter state) with the attitude
   float v0 = this->S[KC_STATE_D0];
@@ -676,62 +1007,47 @@ bool kalmanCoreFinalize(kalmanCoreData_t* this)
     float d1 = v1/2; // so we use a first order approximation to d0 = tan(|v0|/2)*v0/|v0|
     float d2 = v2/2;
 
-    A[KC_STATE_X][KC_STATE_X] = 1;
-    A[KC_STATE_Y][KC_STATE_Y] = 1;
-    A[KC_STATE_Z][KC_STATE_Z] = 1;
-
-    A[KC_STATE_PX][KC_STATE_PX] = 1;
-    A[KC_STATE_PY][KC_STATE_PY] = 1;
-    A[KC_STATE_PZ][KC_STATE_PZ] = 1;
-
-    A[KC_STATE_D0][KC_STATE_D0] =  1 - d1*d1/2 - d2*d2/2;
-    A[KC_STATE_D0][KC_STATE_D1] =  d2 + d0*d1/2;
-    A[KC_STATE_D0][KC_STATE_D2] = -d1 + d0*d2/2;
-
-    A[KC_STATE_D1][KC_STATE_D0] = -d2 + d0*d1/2;
-    A[KC_STATE_D1][KC_STATE_D1] =  1 - d0*d0/2 - d2*d2/2;
-    A[KC_STATE_D1][KC_STATE_D2] =  d0 + d1*d2/2;
-
-    A[KC_STATE_D2][KC_STATE_D0] =  d1 + d0*d2/2;
-    A[KC_STATE_D2][KC_STATE_D1] = -d0 + d1*d2/2;
-    A[KC_STATE_D2][KC_STATE_D2] = 1 - d0*d0/2 - d1*d1/2;
-
-    mat_trans(&Am, &tmpNN1m); // A'
-    mat_mult(&Am, &this->Pm, &tmpNN2m); // AP
-    mat_mult(&tmpNN2m, &tmpNN1m, &this->Pm); //APA'
+    // In the common case with small errors, only the first order terms of the rotation matter
+    const float smallAngle = params->attitudeErrorSmallAngle;
+    if (fabsf(v0) < smallAngle && fabsf(v1) < smallAngle && fabsf(v2) < smallAngle) {
+      rotateCovarianceFirstOrder(this->P, d0, d1, d2);
+      this->finalizeFirstOrderCount++;
+    } else {
+      A[KC_STATE_X][KC_STATE_X] = 1;
+      A[KC_STATE_Y][KC_STATE_Y] = 1;
+      A[KC_STATE_Z][KC_STATE_Z] = 1;
+
+      A[KC_STATE_PX][KC_STATE_PX] = 1;
+      A[KC_STATE_PY][KC_STATE_PY] = 1;
+      A[KC_STATE_PZ][KC_STATE_PZ] = 1;
+
+      A[KC_STATE_D0][KC_STATE_D0] =  1 - d1*d1/2 - d2*d2/2;
+      A[KC_STATE_D0][KC_STATE_D1] =  d2 + d0*d1/2;
+      A[KC_STATE_D0][KC_STATE_D2] = -d1 + d0*d2/2;
+
+      A[KC_STATE_D1][KC_STATE_D0] = -d2 + d0*d1/2;
+      A[KC_STATE_D1][KC_STATE_D1] =  1 - d0*d0/2 - d2*d2/2;
+      A[KC_STATE_D1][KC_STATE_D2] =  d0 + d1*d2/2;
+
+      A[KC_STATE_D2][KC_STATE_D0] =  d1 + d0*d2/2;
+      A[KC_STATE_D2][KC_STATE_D1] = -d0 + d1*d2/2;
+      A[KC_STATE_D2][KC_STATE_D2] = 1 - d0*d0/2 - d1*d1/2;
+
+      symmetricSandwich(A, this->P); // APA'
+      this->finalizeExactCount++;
+    }
   }
 
   // convert the new attitude to a rotation matrix, such that we can rotate body-frame velocity and acc
-  this->R[0][0] = this->q[0] * this->q[0] + this->q[1] * this->q[1] - this->q[2] * this->q[2] - this->q[3] * this->q[3];
-  this->R[0][1] = 2 * this->q[1] * this->q[2] - 2 * this->q[0] * this->q[3];
-  this->R[0][2] = 2 * this->q[1] * this->q[3] + 2 * this->q[0] * this->q[2];
-
-  this->R[1][0] = 2 * this->q[1] * this->q[2] + 2 * this->q[0] * this->q[3];
-  this->R[1][1] = this->q[0] * this->q[0] - this->q[1] * this->q[1] + this->q[2] * this->q[2] - this->q[3] * this->q[3];
-  this->R[1][2] = 2 * this->q[2] * this->q[3] - 2 * this->q[0] * this->q[1];
-
-  this->R[2][0] = 2 * this->q[1] * this->q[3] - 2 * this->q[0] * this->q[2];
-  this->R[2][1] = 2 * this->q[2] * this->q[3] + 2 * this->q[0] * this->q[1];
-  this->R[2][2] = this->q[0] * this->q[0] - this->q[1] * this->q[1] - this->q[2] * this->q[2] + this->q[3] * this->q[3];
+  updateRotationMatrix(this);
 
   // reset the attitude error
   this->S[KC_STATE_D0] = 0;
   this->S[KC_STATE_D1] = 0;
   this->S[KC_STATE_D2] = 0;
 
-  // enforce symmetry of the covariance matrix, and ensure the values stay bounded
-  for (int i=0; i<KC_STATE_DIM; i++) {
-    for (int j=i; j<KC_STATE_DIM; j++) {
-      float p = 0.5f*this->P[i][j] + 0.5f*this->P[j][i];
-      if (isnan(p) || p > MAX_COVARIANCE) {
-        this->P[i][j] = this->P[j][i] = MAX_COVARIANCE;
-      } else if ( i==j && p < MIN_COVARIANCE ) {
-        this->P[i][j] = this->P[j][i] = MIN_COVARIANCE;
-      } else {
-        this->P[i][j] = this->P[j][i] = p;
-      }
-    }
-  }
+  // ensure the values of the covariance matrix stay bounded, symmetry is given by the packed storage
+  enforceCovarianceBounds(this->P);
 
   assertStateNotNaN(this);
 
@@ -794,11 +1110,10 @@ static void decoupleState(kalmanCoreData_t* this, kalmanCoreStateIdx_t state)
 {
   // Set all covariance to 0
   for(int i=0; i<KC_STATE_DIM; i++) {
-    this->P[state][i] = 0;
-    this->P[i][state] = 0;
+    this->P[KC_PACKED_INDEX(state, i)] = 0;
   }
   // Set state variance to maximum
-  this->P[state][state] = MAX_COVARIANCE;
+  this->P[KC_PACKED_INDEX(state, state)] = MAX_COVARIANCE;
   // set state to zero
   this->S[state] = 0;
 }
@@ -810,3 +1125,13 @@ void kalmanCoreDecoupleXY(kalmanCoreData_t* this)
   decoupleState(this, KC_STATE_Y);
   decoupleState(this, KC_STATE_PY);
 }
+
+void kalmanCoreGetCovariance(const kalmanCoreData_t* this, float P[KC_STATE_DIM][KC_STATE_DIM])
+{
+  int idx = 0;
+  for (int i=0; i<KC_STATE_DIM; i++) {
+    for (int j=i; j<KC_STATE_DIM; j++, idx++) {
+      P[i][j] = P[j][i] = this->P[idx];
+    }
+  }
+}
@@ -0,0 +1,97 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--'  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * kalman_history.c - History of the predicted motion, used to fuse delayed measurements
+ */
+
+#include <string.h>
+#include "kalman_history.h"
+
+void kalmanHistoryInit(kalmanHistory_t* history) {
+  memset(history, 0, sizeof(kalmanHistory_t));
+}
+
+void kalmanHistoryAddPrediction(kalmanHistory_t* history, const uint32_t timeUs, const float positionChange[3]) {
+  for (int i = 0; i < 3; i++) {
+    history->accumulated[i] += positionChange[i];
+  }
+
+  history->newest = (history->newest + 1) % KALMAN_HISTORY_LENGTH;
+  kalmanHistoryEntry_t* entry = &history->entries[history->newest];
+  entry->timeUs = timeUs;
+  memcpy(entry->displacement, history->accumulated, sizeof(entry->displacement));
+
+  if (history->count < KALMAN_HISTORY_LENGTH) {
+    history->count++;
+  }
+}
+
+static const kalmanHistoryEntry_t* getEntry(const kalmanHistory_t* history, const int age) {
+  const int index = (history->newest + KALMAN_HISTORY_LENGTH - age) % KALMAN_HISTORY_LENGTH;
+  return &history->entries[index];
+}
+
+// Linear interpolation (or extrapolation) of the displacement between two entries
+static void interpolate(const kalmanHistoryEntry_t* older, const kalmanHistoryEntry_t* newer, const uint32_t timeUs, float displacement[3]) {
+  const float dt = (float)(int32_t)(newer->timeUs - older->timeUs);
+  const float fraction = (dt > 0.0f) ? ((float)(int32_t)(timeUs - older->timeUs) / dt) : 1.0f;
+
+  for (int i = 0; i < 3; i++) {
+    displacement[i] = older->displacement[i] + fraction * (newer->displacement[i] - older->displacement[i]);
+  }
+}
+
+bool kalmanHistoryGetOffset(const kalmanHistory_t* history, const uint32_t eventTimeUs, float offset[3]) {
+  if (history->count < 2) {
+    return false;
+  }
+
+  const kalmanHistoryEntry_t* newest = getEntry(history, 0);
+  // Times are compared as signed differences to the latest prediction to handle wrap around of the timer
+  const int32_t eventAge = (int32_t)(newest->timeUs - eventTimeUs);
+
+  if (eventAge < -KALMAN_HISTORY_MAX_EXTRAPOLATION_US) {
+    return false;
+  }
+
+  float displacement[3];
+  if (eventAge <= 0) {
+    interpolate(getEntry(history, 1), newest, eventTimeUs, displacement);
+  } else {
+    int age = 1;
+    while (age < history->count && (int32_t)(newest->timeUs - getEntry(history, age)->timeUs) < eventAge) {
+      age++;
+    }
+
+    if (age >= history->count) {
+      return false;
+    }
+
+    interpolate(getEntry(history, age), getEntry(history, age - 1), eventTimeUs, displacement);
+  }
+
+  for (int i = 0; i < 3; i++) {
+    offset[i] = displacement[i] - newest->displacement[i];
+  }
+
+  return true;
+}
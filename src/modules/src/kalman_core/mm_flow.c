@@ -24,6 +24,7 @@
  */
 
 #include "mm_flow.h"
+#include "mm_tof.h"
 #include "log.h"
 
 #define FLOW_RESOLUTION 0.1f //We do get the measurements in 10x the motion pixels (experimentally measured)
@@ -34,7 +35,9 @@ static float predictedNY;
 static float measuredNX;
 static float measuredNY;
 
-void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *flow, const Axis3f *gyro)
+// Fills in the two scalar measurements of a flow measurement. hx and hy must hold KC_STATE_DIM zeros and are
+// referenced by the measurements.
+static void flowMeasurements(const kalmanCoreData_t* this, const flowMeasurement_t *flow, const Axis3f *gyro, float hx[KC_STATE_DIM], float hy[KC_STATE_DIM], kalmanCoreScalarMeasurement_t measurements[2])
 {
   // Inclusion of flow measurements in the EKF done by two scalar updates
 
@@ -74,8 +77,6 @@ void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *f
 
   // ~~~ X velocity prediction and update ~~~
   // predicts the number of accumulated pixels in the x-direction
-  float hx[KC_STATE_DIM] = {0};
-  arm_matrix_instance_f32 Hx = {1, KC_STATE_DIM, hx};
   predictedNX = (flow->dt * Npix / thetapix ) * ((dx_g * this->R[2][2] / z_g) - omegay_b);
   measuredNX = flow->dpixelx*FLOW_RESOLUTION;
 
@@ -83,12 +84,7 @@ void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *f
   hx[KC_STATE_Z] = (Npix * flow->dt / thetapix) * ((this->R[2][2] * dx_g) / (-z_g * z_g));
   hx[KC_STATE_PX] = (Npix * flow->dt / thetapix) * (this->R[2][2] / z_g);
 
-  //First update
-  kalmanCoreScalarUpdate(this, &Hx, (measuredNX-predictedNX), flow->stdDevX*FLOW_RESOLUTION);
-
   // ~~~ Y velocity prediction and update ~~~
-  float hy[KC_STATE_DIM] = {0};
-  arm_matrix_instance_f32 Hy = {1, KC_STATE_DIM, hy};
   predictedNY = (flow->dt * Npix / thetapix ) * ((dy_g * this->R[2][2] / z_g) + omegax_b);
   measuredNY = flow->dpixely*FLOW_RESOLUTION;
 
@@ -96,8 +92,36 @@ void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *f
   hy[KC_STATE_Z] = (Npix * flow->dt / thetapix) * ((this->R[2][2] * dy_g) / (-z_g * z_g));
   hy[KC_STATE_PY] = (Npix * flow->dt / thetapix) * (this->R[2][2] / z_g);
 
-  // Second update
-  kalmanCoreScalarUpdate(this, &Hy, (measuredNY-predictedNY), flow->stdDevY*FLOW_RESOLUTION);
+  measurements[0] = (kalmanCoreScalarMeasurement_t){.h = hx, .error = measuredNX - predictedNX, .stdMeasNoise = flow->stdDevX * FLOW_RESOLUTION};
+  measurements[1] = (kalmanCoreScalarMeasurement_t){.h = hy, .error = measuredNY - predictedNY, .stdMeasNoise = flow->stdDevY * FLOW_RESOLUTION};
+}
+
+void kalmanCoreUpdateWithFlow(kalmanCoreData_t* this, const flowMeasurement_t *flow, const Axis3f *gyro)
+{
+  float hx[KC_STATE_DIM] = {0};
+  float hy[KC_STATE_DIM] = {0};
+  kalmanCoreScalarMeasurement_t measurements[2];
+  flowMeasurements(this, flow, gyro, hx, hy, measurements);
+
+  // Both updates are linearized around the same state, apply them as one batch
+  kalmanCoreBatchUpdate(this, measurements, 2);
+}
+
+void kalmanCoreUpdateWithFlowAndTof(kalmanCoreData_t* this, const flowMeasurement_t *flow, const tofMeasurement_t *tof, const Axis3f *gyro)
+{
+  float hx[KC_STATE_DIM] = {0};
+  float hy[KC_STATE_DIM] = {0};
+  float hz[KC_STATE_DIM] = {0};
+  kalmanCoreScalarMeasurement_t measurements[3];
+  flowMeasurements(this, flow, gyro, hx, hy, measurements);
+
+  // The flow and the height are linearized around the same state and share the temporaries and the state checks of
+  // one batch update
+  int count = 2;
+  if (kalmanCoreTofMeasurement(this, tof, hz, &measurements[2])) {
+    count = 3;
+  }
+  kalmanCoreBatchUpdate(this, measurements, count);
 }
 
 /**
@@ -25,18 +25,80 @@
 
 #include "mm_sweep_angles.h"
 
+#include <string.h>
+#include "cfassert.h"
+
+// Sensor position in the global reference frame, shared by all sweeps that hit the sensor
+typedef struct {
+  const vec3d* sensorPos;
+  vec3d pcf;
+} sensorGlobalPos_t;
+
+// Sensor position in the reference frame of a rotor, shared by the sweeps of the same rotor that hit the sensor
+typedef struct {
+  const vec3d* sensorPos;
+  const vec3d* rotorPos;
+  const mat3d* rotorRotInv;
+  vec3d sr;
+  float r2;
+  float r;
+} sensorRotorPos_t;
+
+typedef struct {
+  float t;
+  float tan_t;
+} tiltTan_t;
+
+// Geometry shared by the sweeps in a batch. The attitude and position of the crazyflie do not change during a batch.
+typedef struct {
+  sensorGlobalPos_t globalPos[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  int globalPosCount;
+  sensorRotorPos_t rotorPos[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  int rotorPosCount;
+  tiltTan_t tiltTan[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  int tiltTanCount;
+} batchGeometry_t;
+
+static const float* getSensorGlobalPos(const kalmanCoreData_t *this, batchGeometry_t* geo, const vec3d* sensorPos) {
+  for (int i = 0; i < geo->globalPosCount; i++) {
+    if (geo->globalPos[i].sensorPos == sensorPos) {
+      return geo->globalPos[i].pcf;
+    }
+  }
+
+  sensorGlobalPos_t* entry = &geo->globalPos[geo->globalPosCount++];
+  entry->sensorPos = sensorPos;
 
-void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *sweepInfo, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
   // Rotate the sensor position from CF reference frame to global reference frame,
   // using the CF roatation matrix
   vec3d s;
   arm_matrix_instance_f32 Rcf_ = {3, 3, (float32_t *)this->R};
-  arm_matrix_instance_f32 scf_ = {3, 1, (float32_t *)*sweepInfo->sensorPos};
+  arm_matrix_instance_f32 scf_ = {3, 1, (float32_t *)*sensorPos};
   arm_matrix_instance_f32 s_ = {3, 1, s};
   mat_mult(&Rcf_, &scf_, &s_);
 
   // Get the current state values of the position of the crazyflie (global reference frame) and add the relative sensor pos
-  vec3d pcf = {this->S[KC_STATE_X] + s[0], this->S[KC_STATE_Y] + s[1], this->S[KC_STATE_Z] + s[2]};
+  entry->pcf[0] = this->S[KC_STATE_X] + s[0];
+  entry->pcf[1] = this->S[KC_STATE_Y] + s[1];
+  entry->pcf[2] = this->S[KC_STATE_Z] + s[2];
+
+  return entry->pcf;
+}
+
+static const sensorRotorPos_t* getSensorRotorPos(const kalmanCoreData_t *this, batchGeometry_t* geo, const sweepAngleMeasurement_t* sweepInfo) {
+  for (int i = 0; i < geo->rotorPosCount; i++) {
+    const sensorRotorPos_t* entry = &geo->rotorPos[i];
+    if (entry->sensorPos == sweepInfo->sensorPos && entry->rotorPos == sweepInfo->rotorPos && entry->rotorRotInv == sweepInfo->rotorRotInv) {
+      return entry;
+    }
+  }
+
+  sensorRotorPos_t* entry = &geo->rotorPos[geo->rotorPosCount++];
+  entry->sensorPos = sweepInfo->sensorPos;
+  entry->rotorPos = sweepInfo->rotorPos;
+  entry->rotorRotInv = sweepInfo->rotorRotInv;
+
+  const float* pcf = getSensorGlobalPos(this, geo, sweepInfo->sensorPos);
 
   // Calculate the difference between the rotor and the sensor on the CF (global reference frame)
   const vec3d* pr = sweepInfo->rotorPos;
@@ -45,49 +107,114 @@ void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasureme
 
   // Rotate the difference in position to the rotor reference frame,
   // using the rotor inverse rotation matrix
-  vec3d sr;
   arm_matrix_instance_f32 Rr_inv_ = {3, 3, (float32_t *)(*sweepInfo->rotorRotInv)};
-  arm_matrix_instance_f32 sr_ = {3, 1, sr};
+  arm_matrix_instance_f32 sr_ = {3, 1, entry->sr};
   mat_mult(&Rr_inv_, &stmp_, &sr_);
 
-  // The following computations are in the rotor refernece frame
-  const float x = sr[0];
-  const float y = sr[1];
-  const float z = sr[2];
-  const float t = sweepInfo->t;
-  const float tan_t = tanf(t);
-
-  const float r2 = x * x + y * y;
-  const float r = arm_sqrt(r2);
-
-  const float predictedSweepAngle = sweepInfo->calibrationMeasurementModel(x, y, z, t, sweepInfo->calib);
-  const float measuredSweepAngle = sweepInfo->measuredSweepAngle;
-  const float error = measuredSweepAngle - predictedSweepAngle;
-
-  if (outlierFilterLighthouseValidateSweep(sweepOutlierFilterState, r, error, nowMs)) {
-    // Calculate H vector (in the rotor reference frame)
-    const float z_tan_t = z * tan_t;
-    const float qNum = r2 - z_tan_t * z_tan_t;
-    // Avoid singularity
-    if (qNum > 0.0001f) {
-      const float q = tan_t / arm_sqrt(qNum);
-      vec3d gr = {(-y - x * z * q) / r2, (x - y * z * q) / r2 , q};
-
-      // gr is in the rotor reference frame, rotate back to the global
-      // reference frame using the rotor rotation matrix
-      vec3d g;
-      arm_matrix_instance_f32 gr_ = {3, 1, gr};
-      arm_matrix_instance_f32 Rr_ = {3, 3, (float32_t *)(*sweepInfo->rotorRot)};
-      arm_matrix_instance_f32 g_ = {3, 1, g};
-      mat_mult(&Rr_, &gr_, &g_);
-
-      float h[KC_STATE_DIM] = {0};
-      h[KC_STATE_X] = g[0];
-      h[KC_STATE_Y] = g[1];
-      h[KC_STATE_Z] = g[2];
-
-      arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
-      kalmanCoreScalarUpdate(this, &H, error, sweepInfo->stdDev);
+  entry->r2 = entry->sr[0] * entry->sr[0] + entry->sr[1] * entry->sr[1];
+  entry->r = arm_sqrt(entry->r2);
+
+  return entry;
+}
+
+static float getTiltTan(batchGeometry_t* geo, const float t) {
+  for (int i = 0; i < geo->tiltTanCount; i++) {
+    if (geo->tiltTan[i].t == t) {
+      return geo->tiltTan[i].tan_t;
+    }
+  }
+
+  tiltTan_t* entry = &geo->tiltTan[geo->tiltTanCount++];
+  entry->t = t;
+  entry->tan_t = tanf(t);
+  return entry->tan_t;
+}
+
+void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *sweepInfo, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
+  kalmanCoreUpdateWithSweepAnglesBatch(this, sweepInfo, 1, nowMs, sweepOutlierFilterState);
+}
+
+int kalmanCoreUpdateWithSweepAnglesBatch(kalmanCoreData_t *this, const sweepAngleMeasurement_t sweeps[], const int count, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
+  ASSERT(count <= KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH);
+
+  static batchGeometry_t geo;
+  static const sensorRotorPos_t* rotorPositions[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  static float distances[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  static float errors[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  static bool accepted[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  static float h[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH][KC_STATE_DIM];
+  static kalmanCoreScalarMeasurement_t measurements[KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH];
+  geo.globalPosCount = 0;
+  geo.rotorPosCount = 0;
+  geo.tiltTanCount = 0;
+
+  // Predict the sweep angles and validate the errors of the whole frame before the more expensive H vectors and
+  // kalman update
+  for (int i = 0; i < count; i++) {
+    const sweepAngleMeasurement_t* sweepInfo = &sweeps[i];
+    const sensorRotorPos_t* rotorPos = getSensorRotorPos(this, &geo, sweepInfo);
+    rotorPositions[i] = rotorPos;
+
+    // The following computations are in the rotor refernece frame
+    const float x = rotorPos->sr[0];
+    const float y = rotorPos->sr[1];
+    const float z = rotorPos->sr[2];
+    const float t = sweepInfo->t;
+
+    const float predictedSweepAngle = sweepInfo->calibrationMeasurementModel(x, y, z, t, sweepInfo->calib);
+    const float measuredSweepAngle = sweepInfo->measuredSweepAngle;
+    errors[i] = measuredSweepAngle - predictedSweepAngle;
+    distances[i] = rotorPos->r;
+  }
+
+  if (outlierFilterLighthouseValidateSweeps(sweepOutlierFilterState, distances, errors, count, nowMs, accepted) == 0) {
+    return 0;
+  }
+
+  int measurementCount = 0;
+  for (int i = 0; i < count; i++) {
+    if (accepted[i]) {
+      const sweepAngleMeasurement_t* sweepInfo = &sweeps[i];
+      const sensorRotorPos_t* rotorPos = rotorPositions[i];
+      const float x = rotorPos->sr[0];
+      const float y = rotorPos->sr[1];
+      const float z = rotorPos->sr[2];
+      const float r2 = rotorPos->r2;
+
+      // Calculate H vector (in the rotor reference frame)
+      const float tan_t = getTiltTan(&geo, sweepInfo->t);
+      const float z_tan_t = z * tan_t;
+      const float qNum = r2 - z_tan_t * z_tan_t;
+      // Avoid singularity
+      if (qNum > 0.0001f) {
+        const float q = tan_t / arm_sqrt(qNum);
+        vec3d gr = {(-y - x * z * q) / r2, (x - y * z * q) / r2 , q};
+
+        // gr is in the rotor reference frame, rotate back to the global
+        // reference frame using the rotor rotation matrix
+        vec3d g;
+        arm_matrix_instance_f32 gr_ = {3, 1, gr};
+        arm_matrix_instance_f32 Rr_ = {3, 3, (float32_t *)(*sweepInfo->rotorRot)};
+        arm_matrix_instance_f32 g_ = {3, 1, g};
+        mat_mult(&Rr_, &gr_, &g_);
+
+        float* hRow = h[measurementCount];
+        memset(hRow, 0, sizeof(h[0]));
+        hRow[KC_STATE_X] = g[0];
+        hRow[KC_STATE_Y] = g[1];
+        hRow[KC_STATE_Z] = g[2];
+
+        measurements[measurementCount].h = hRow;
+        measurements[measurementCount].error = errors[i];
+        measurements[measurementCount].stdMeasNoise = sweepInfo->stdDev;
+        measurementCount++;
+      }
     }
   }
+
+  if (measurementCount > 0) {
+    kalmanCoreBatchUpdate(this, measurements, measurementCount);
+  }
+
+  return measurementCount;
 }
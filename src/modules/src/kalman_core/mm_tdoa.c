@@ -26,11 +26,14 @@
 #include "mm_tdoa.h"
 #include "test_support.h"
 
+#include <string.h>
+#include "cfassert.h"
+
 #if CONFIG_ESTIMATOR_KALMAN_TDOA_OUTLIERFILTER_FALLBACK
 #include "outlierFilterTdoaSteps.h"
 #endif
 
-void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState)
+bool kalmanCoreGateTdoa(const kalmanCoreData_t* this, const tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState, float h[KC_STATE_DIM], float* errorOut)
 {
   /**
    * Measurement equation:
@@ -61,8 +64,8 @@ void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, c
   float predicted = d1 - d0;
   float error = measurement - predicted;
 
-  float h[KC_STATE_DIM] = {0};
-  arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+  bool sampleIsGood = false;
+  memset(h, 0, sizeof(float) * KC_STATE_DIM);
 
   if ((d0 != 0.0f) && (d1 != 0.0f)) {
     h[KC_STATE_X] = (dx1 / d1 - dx0 / d0);
@@ -82,13 +85,49 @@ void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, c
       .z = this->S[KC_STATE_Z],
     };
 
-    bool sampleIsGood = outlierFilterTdoaValidateSteps(tdoa, error, &jacobian, &estimatedPosition);
+    sampleIsGood = outlierFilterTdoaValidateSteps(tdoa, error, &jacobian, &estimatedPosition);
     #else
-    bool sampleIsGood = outlierFilterTdoaValidateIntegrator(outlierFilterState, tdoa, error, nowMs);
+    sampleIsGood = outlierFilterTdoaValidateIntegrator(outlierFilterState, tdoa, error, nowMs);
     #endif
+  }
+
+  *errorOut = error;
+  return sampleIsGood;
+}
+
+void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState)
+{
+  kalmanCoreUpdateWithTdoaBatch(this, tdoa, 1, nowMs, outlierFilterState);
+}
 
-    if (sampleIsGood) {
-      kalmanCoreScalarUpdate(this, &H, error, tdoa->stdDev);
+int kalmanCoreGateTdoaBatch(const kalmanCoreData_t* this, const tdoaMeasurement_t tdoas[], const int count, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState, kalmanCoreTdoaGatedBatch_t* gated)
+{
+  ASSERT(count <= KALMAN_CORE_TDOA_MAX_BATCH);
+
+  int accepted = 0;
+  for (int i = 0; i < count; i++) {
+    float error;
+    gated->isAccepted[i] = kalmanCoreGateTdoa(this, &tdoas[i], nowMs, outlierFilterState, gated->h[accepted], &error);
+    if (gated->isAccepted[i]) {
+      gated->measurements[accepted].h = gated->h[accepted];
+      gated->measurements[accepted].error = error;
+      gated->measurements[accepted].stdMeasNoise = tdoas[i].stdDev;
+      accepted++;
     }
   }
+
+  gated->acceptedCount = accepted;
+  return accepted;
+}
+
+int kalmanCoreUpdateWithTdoaBatch(kalmanCoreData_t* this, const tdoaMeasurement_t tdoas[], const int count, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState)
+{
+  static kalmanCoreTdoaGatedBatch_t gated;
+
+  const int accepted = kalmanCoreGateTdoaBatch(this, tdoas, count, nowMs, outlierFilterState, &gated);
+  if (accepted > 0) {
+    kalmanCoreBatchUpdate(this, gated.measurements, accepted);
+  }
+
+  return accepted;
 }
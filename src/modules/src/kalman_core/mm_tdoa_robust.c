@@ -19,6 +19,8 @@
 #include "test_support.h"
 
 #define MAX_ITER (2) // maximum iteration is set to 2.
+// The iteration stops early when the weights and the measurement Jacobian change less than this
+#define CONVERGENCE_TOLERANCE (0.01f)
 #define UPPER_BOUND (100)
 #define LOWER_BOUND (-100)
 
@@ -43,6 +45,51 @@ static void Cholesky_Decomposition(int n, float matrix[n][n],  float lower[n][n]
     }
 }
 
+/* Solves lower * x = b for x by forward substitution, lower is lower triangular.
+ * Replaces the full inverse of the Cholesky factor, only its product with a vector is used.
+*/
+static void solveLowerTriangular(const float lower[KC_STATE_DIM][KC_STATE_DIM], const float b[KC_STATE_DIM], float x[KC_STATE_DIM]){
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+        float sum = b[i];
+        for (int k = 0; k < i; k++) {
+            sum -= lower[i][k] * x[k];
+        }
+        x[i] = sum / lower[i][i];
+    }
+}
+
+/* Rescaled covariance P_w = lower.dot(diag(wInv)).dot(upper), where lower is the lower triangular Cholesky
+ * factor and upper its transpose. The diagonal weight matrix is applied as a scaling and the products only run
+ * over the non zero part of the triangular factors.
+*/
+static void rescaleCovariance(const float lower[KC_STATE_DIM][KC_STATE_DIM], const float wInv[KC_STATE_DIM], const float upper[KC_STATE_DIM][KC_STATE_DIM], float P_w[KC_STATE_DIM][KC_STATE_DIM]){
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+        for (int j = 0; j < KC_STATE_DIM; j++) {
+            const int kMax = i < j ? i : j;
+            float sum = 0.0f;
+            for (int k = 0; k <= kMax; k++) {
+                sum += lower[i][k] * wInv[k] * upper[k][j];
+            }
+            P_w[i][j] = sum;
+        }
+    }
+}
+
+/* True when another iteration would not change the result noticeably. The weights leave the covariances as they are
+ * and the measurement Jacobian at the new linearization point is the same as in the previous iteration.
+*/
+static bool isConverged(const float wx_inv[KC_STATE_DIM], const float R_w, const float R_iter, const float h[KC_STATE_DIM], const float h_iter[KC_STATE_DIM]){
+    if (fabsf(R_w - R_iter) > CONVERGENCE_TOLERANCE * R_iter) {
+        return false;
+    }
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+        if (fabsf(wx_inv[i] - 1.0f) > CONVERGENCE_TOLERANCE || fabsf(h_iter[i] - h[i]) > CONVERGENCE_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* Weight function for GM Robust cost function
  * General guidelines for hyperparameter tuning:
  * For a given measurement error e, decreasing the sigma of the GM weight function will set a
@@ -63,11 +110,12 @@ static void GM_state(float e, float * GM_e){
 }
 
 // robsut update function
-void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, OutlierFilterTdoaState_t* outlierFilterState)
+int kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, OutlierFilterTdoaState_t* outlierFilterState)
 {
     // Measurement equation:
     // d_ij = d_j - d_i
 	float measurement = 0.0f;
+    int iter = 0;
     float x = this->S[KC_STATE_X];
     float y = this->S[KC_STATE_Y];
     float z = this->S[KC_STATE_Z];
@@ -99,46 +147,34 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
         static float Kw[KC_STATE_DIM];
         static arm_matrix_instance_f32 Kwm = {KC_STATE_DIM, 1, (float *)Kw};
 
+        // e_x = inv(P_chol).dot(x_err)
         static float e_x[KC_STATE_DIM];
-        static arm_matrix_instance_f32 e_x_m = {KC_STATE_DIM, 1, e_x};
-
-        static float Pc_inv[KC_STATE_DIM][KC_STATE_DIM];
-        static arm_matrix_instance_f32 Pc_inv_m = {KC_STATE_DIM, KC_STATE_DIM, (float *)Pc_inv};
 
-        // rescale matrix
-        static float wx_inv[KC_STATE_DIM][KC_STATE_DIM];
-        static arm_matrix_instance_f32 wx_invm = {KC_STATE_DIM, KC_STATE_DIM, (float *)wx_inv};
-        // tmp matrix for P_chol inverse
-        static float tmp1[KC_STATE_DIM][KC_STATE_DIM];
-        static arm_matrix_instance_f32 tmp1m = {KC_STATE_DIM, KC_STATE_DIM, (float *)tmp1};
-
-        static float Pc_w_inv[KC_STATE_DIM][KC_STATE_DIM];
-        static arm_matrix_instance_f32 Pc_w_invm = {KC_STATE_DIM, KC_STATE_DIM, (float *)Pc_w_inv};
+        // rescale matrix, diagonal of inv(w_x)
+        static float wx_inv[KC_STATE_DIM];
 
         static float P_w[KC_STATE_DIM][KC_STATE_DIM];
         static arm_matrix_instance_f32 P_w_m = {KC_STATE_DIM, KC_STATE_DIM, (float *)P_w};
 
-        static float HTd[KC_STATE_DIM];
-        static arm_matrix_instance_f32 HTm = {KC_STATE_DIM, 1, HTd};
-
         static float PHTd[KC_STATE_DIM];
         static arm_matrix_instance_f32 PHTm = {KC_STATE_DIM, 1, PHTd};
+        // H transposed, a column vector with the same data as H
+        arm_matrix_instance_f32 HTm = {KC_STATE_DIM, 1, h};
         // ------------------- Initialization -----------------------//
         // x prior (error state), set to be zeros. Not used for error state Kalman filter. Provide here for completeness
         // float xpr[STATE_DIM] = {0.0};
 
         // x_err comes from the KF update is the state of error state Kalman filter, set to be zero initially
         static float x_err[KC_STATE_DIM] = {0.0};
-        static arm_matrix_instance_f32 x_errm = {KC_STATE_DIM, 1, x_err};
         static float X_state[KC_STATE_DIM] = {0.0};
         float P_iter[KC_STATE_DIM][KC_STATE_DIM];
-        memcpy(P_iter, this->P, sizeof(P_iter));                 // init P_iter as P_prior
+        kalmanCoreGetCovariance(this, P_iter);                 // init P_iter as P_prior
 
         float R_iter = tdoa->stdDev * tdoa->stdDev;                    // measurement covariance
         memcpy(X_state, this->S, sizeof(X_state));                     // copy Xpr to X_State and then update in each iterations
 
         // ---------------------- Start iteration ----------------------- //
-        for (int iter = 0; iter < MAX_ITER; iter++){
+        while (iter < MAX_ITER){
             // cholesky decomposition for the prior covariance matrix
             Cholesky_Decomposition(KC_STATE_DIM, P_iter, P_chol);      // P_chol is a lower triangular matrix
             mat_trans(&Pc_m, &Pc_tran_m);
@@ -160,9 +196,10 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
             float e_y = error_iter;
             if ((d0 != 0.0f) && (d1 != 0.0f)){
                 // measurement Jacobian changes in each iteration w.r.t linearization point [x_iter, y_iter, z_iter]
-                h[KC_STATE_X] = (dx1 / d1 - dx0 / d0);
-                h[KC_STATE_Y] = (dy1 / d1 - dy0 / d0);
-                h[KC_STATE_Z] = (dz1 / d1 - dz0 / d0);
+                float h_iter[KC_STATE_DIM] = {0};
+                h_iter[KC_STATE_X] = (dx1 / d1 - dx0 / d0);
+                h_iter[KC_STATE_Y] = (dy1 / d1 - dy0 / d0);
+                h_iter[KC_STATE_Z] = (dz1 / d1 - dz0 / d0);
 
                 if (fabsf(R_chol - 0.0f) < 0.0001f){
                     e_y = error_iter / 0.0001f;
@@ -188,19 +225,13 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
                 for (int k=0; k<KC_STATE_DIM; k++){
                     P_chol[k][k] = P_chol[k][k] + dummy_value;
                 }
-                // keep P_chol
-                memcpy(tmp1, P_chol, sizeof(tmp1));
-                mat_inv(&tmp1m, &Pc_inv_m);                            // Pc_inv_m = inv(Pc_m) = inv(P_chol)
-                mat_mult(&Pc_inv_m, &x_errm, &e_x_m);                  // e_x_m = Pc_inv_m.dot(x_errm)
+                solveLowerTriangular(P_chol, x_err, e_x);                 // e_x = inv(P_chol).dot(x_err)
                 // compute w_x, w_y --> weighting matrix
                 // Since w_x is diagnal matrix, compute the inverse directly
                 for (int state_k = 0; state_k < KC_STATE_DIM; state_k++){
-                    GM_state(e_x[state_k], &wx_inv[state_k][state_k]);
-                    wx_inv[state_k][state_k] = (float)1.0 / wx_inv[state_k][state_k];
+                    GM_state(e_x[state_k], &wx_inv[state_k]);
+                    wx_inv[state_k] = (float)1.0 / wx_inv[state_k];
                 }
-                // rescale covariance matrix P
-                mat_mult(&Pc_m, &wx_invm, &Pc_w_invm);                // Pc_w_invm = P_chol.dot(linalg.inv(w_x))
-                mat_mult(&Pc_w_invm, &Pc_tran_m, &P_w_m);             // P_w_m = Pc_w_invm.dot(Pc_tran_m) = P_chol.dot(linalg.inv(w_x)).dot(P_chol.T)
                 // rescale R matrix
                 float w_y=0.0;      float R_w = 0.0f;
                 GM_UWB(e_y, &w_y);                                    // compute the weighted measurement error: w_y
@@ -209,8 +240,16 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
                 }else{
                     R_w = (R_chol * R_chol) / w_y;
                 }
+
+                // Keep the result of the previous iteration if this one would not change it
+                if (iter > 0 && isConverged(wx_inv, R_w, R_iter, h, h_iter)) {
+                    break;
+                }
+                memcpy(h, h_iter, sizeof(h));
+
+                // rescale covariance matrix P
+                rescaleCovariance(P_chol, wx_inv, Pc_tran, P_w);  // P_w = P_chol.dot(linalg.inv(w_x)).dot(P_chol.T)
                 // ====== INNOVATION COVARIANCE ====== //
-                mat_trans(&H, &HTm);
                 mat_mult(&P_w_m, &HTm, &PHTm);                        // PHTm = P_w.dot(H.T). The P is the updated P_w
 
                 float HPHR = R_w;                                     // HPH' + R.            The R is the updated R_w
@@ -228,6 +267,10 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
                 // update P_iter matrix and R matrix for next iteration
                 memcpy(P_iter, P_w, sizeof(P_iter));
                 R_iter = R_w;
+                iter++;
+            } else {
+                // Nothing changes between iterations at this linearization point
+                break;
             }
         }
         // After n iterations, we obtain the rescaled (1) P = P_iter, (2) R = R_iter, (3) Kw.
@@ -235,4 +278,6 @@ void kalmanCoreRobustUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *t
         kalmanCoreUpdateWithPKE(this, &H, &Kwm, &P_w_m, error_check);
 
     }
+
+    return iter;
 }
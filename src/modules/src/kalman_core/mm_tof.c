@@ -25,37 +25,58 @@
 
 #include "mm_tof.h"
 
+bool kalmanCoreTofMeasurement(const kalmanCoreData_t* this, const tofMeasurement_t *tof, float h[KC_STATE_DIM], kalmanCoreScalarMeasurement_t* measurement)
+{
+  // Only update the filter if the measurement is reliable (\hat{h} -> infty when R[2][2] -> 0)
+  const float cosTilt = this->R[2][2];
+  if (!(cosTilt > 0.1f)) {
+    return false;
+  }
+
+  /*
+  The sensor model (Pg.95-96, https://lup.lub.lu.se/student-papers/search/publication/8905295)
+
+  h = z/((R*z_b).z_b) = z/cos(alpha)
+
+  Here,
+  h (Measured variable)[m] = Distance given by TOF sensor. This is the closest point from any surface to the sensor in the measurement cone
+  z (Estimated variable)[m] = THe actual elevation of the crazyflie
+  z_b = Basis vector in z direction of body coordinate system
+  R = Rotation matrix made from ZYX Tait-Bryan angles. Assumed to be stationary
+  alpha = angle between [line made by measured point <---> sensor] and [the intertial z-axis]
+
+  alpha = max(0, tilt - half cone angle), where cos(tilt) = R[2][2]. cos(alpha) is expanded with the angle difference
+  identity instead of going through acos() and cos().
+  */
+  // The half cone angle of the sensor is 7.5 degrees
+  static const float cosHalfCone = 0.99144486f;
+  static const float sinHalfCone = 0.13052619f;
+  float cosAlpha = 1.0f;
+  if (cosTilt < cosHalfCone) {
+    const float sinTilt = sqrtf(1.0f - cosTilt * cosTilt);
+    cosAlpha = cosTilt * cosHalfCone + sinTilt * sinHalfCone;
+  }
+
+  const float predictedDistance = this->S[KC_STATE_Z] / cosAlpha;
+  const float measuredDistance = tof->distance; // [m]
+
+  h[KC_STATE_Z] = 1.0f / cosAlpha; // This just acts like a gain for the sensor model. Further updates are done in the scalar update function
+
+  measurement->h = h;
+  measurement->error = measuredDistance - predictedDistance;
+  measurement->stdMeasNoise = tof->stdDev;
+  return true;
+}
+
 void kalmanCoreUpdateWithTof(kalmanCoreData_t* this, tofMeasurement_t *tof)
 {
-  // Updates the filter with a measured distance in the zb direction using the
+  // Updates the filter with a measured distance in the zb direction
   float h[KC_STATE_DIM] = {0};
   arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
 
-  // Only update the filter if the measurement is reliable (\hat{h} -> infty when R[2][2] -> 0)
-  if (fabs(this->R[2][2]) > 0.1 && this->R[2][2] > 0){
-    float angle = fabsf(acosf(this->R[2][2])) - DEG_TO_RAD * (15.0f / 2.0f);
-    if (angle < 0.0f) {
-      angle = 0.0f;
-    }
-    float predictedDistance = this->S[KC_STATE_Z] / cosf(angle);
-    float measuredDistance = tof->distance; // [m]
-
-    /*
-    The sensor model (Pg.95-96, https://lup.lub.lu.se/student-papers/search/publication/8905295)
-    
-    h = z/((R*z_b).z_b) = z/cos(alpha)
-    
-    Here,
-    h (Measured variable)[m] = Distance given by TOF sensor. This is the closest point from any surface to the sensor in the measurement cone
-    z (Estimated variable)[m] = THe actual elevation of the crazyflie
-    z_b = Basis vector in z direction of body coordinate system
-    R = Rotation matrix made from ZYX Tait-Bryan angles. Assumed to be stationary
-    alpha = angle between [line made by measured point <---> sensor] and [the intertial z-axis] 
-    */
-
-    h[KC_STATE_Z] = 1 / cosf(angle); // This just acts like a gain for the sensor model. Further updates are done in the scalar update function below
-
+  kalmanCoreScalarMeasurement_t measurement;
+  if (kalmanCoreTofMeasurement(this, tof, h, &measurement)) {
     // Scalar update
-    kalmanCoreScalarUpdate(this, &H, measuredDistance-predictedDistance, tof->stdDev);
+    kalmanCoreScalarUpdate(this, &H, measurement.error, measurement.stdMeasNoise);
   }
 }
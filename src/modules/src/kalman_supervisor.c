@@ -26,28 +26,39 @@
  * stays within bounds.
  */
 
+#include <math.h>
+
 #include "kalman_supervisor.h"
 
 #include "param.h"
+#include "log.h"
 
 // The bounds on states, these shouldn't be hit...
 float maxPosition = 100; //meters
 float maxVelocity = 10; //meters per second
 
+// Interval of the sweep of the full covariance matrix
+#define FULL_CHECK_INTERVAL_MS 1000
+
+static uint32_t nextFullCheckMs;
+static uint32_t outOfBoundsCount;
+static uint32_t nonFiniteCount;
+
+// Written so that NaN is out of bounds, all comparisons with NaN are false
+static inline bool isWithin(const float value, const float bound) {
+  return value <= bound && value >= -bound;
+}
+
 bool kalmanSupervisorIsStateWithinBounds(const kalmanCoreData_t* this) {
   for (int i = 0; i < 3; i++) {
     if (maxPosition > 0.0f) {
-      if (this->S[KC_STATE_X + i] > maxPosition) {
-        return false;
-      } else if (this->S[KC_STATE_X + i] < -maxPosition) {
+      if (!isWithin(this->S[KC_STATE_X + i], maxPosition)) {
         return false;
       }
     }
 
     if (maxVelocity > 0.0f) {
-      if (this->S[KC_STATE_PX + i] > maxVelocity) {
-        return false;
-      } else if (this->S[KC_STATE_PX + i] < -maxVelocity) {
+      if (!isWithin(this->S[KC_STATE_PX + i], maxVelocity)) {
         return false;
       }
     }
@@ -56,6 +67,53 @@ bool kalmanSupervisorIsStateWithinBounds(const kalmanCoreData_t* this) {
   return true;
 }
 
+// The entries touched by each finalization, the attitude errors are reset to 0 and folded into the quaternion
+static bool isAttitudeAndDiagonalFinite(const kalmanCoreData_t* this) {
+  bool isFinite = true;
+  for (int i = 0; i < 4; i++) {
+    isFinite &= isfinite(this->q[i]);
+  }
+  for (int i = KC_STATE_D0; i <= KC_STATE_D2; i++) {
+    isFinite &= isfinite(this->S[i]);
+  }
+
+  // The covariance bounds are enforced by the core, a variance outside them is a NaN or an infinity
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    const float p = this->P[KC_PACKED_INDEX_UPPER(i, i)];
+    isFinite &= (p > 0.0f && isfinite(p));
+  }
+
+  return isFinite;
+}
+
+static bool isCovarianceFinite(const kalmanCoreData_t* this) {
+  bool isFinite = true;
+  for (int i = 0; i < KC_STATE_PACKED_DIM; i++) {
+    isFinite &= isfinite(this->P[i]);
+  }
+
+  return isFinite;
+}
+
+bool kalmanSupervisorIsStateValid(const kalmanCoreData_t* this, const uint32_t nowMs) {
+  if (!kalmanSupervisorIsStateWithinBounds(this)) {
+    outOfBoundsCount++;
+    return false;
+  }
+
+  bool isFinite = isAttitudeAndDiagonalFinite(this);
+  if ((int32_t)(nowMs - nextFullCheckMs) >= 0) {
+    nextFullCheckMs = nowMs + FULL_CHECK_INTERVAL_MS;
+    isFinite &= isCovarianceFinite(this);
+  }
+
+  if (!isFinite) {
+    nonFiniteCount++;
+  }
+
+  return isFinite;
+}
+
 PARAM_GROUP_START(kalman)
 /**
  * @brief Maximum accepted coordinate before kalman supervisor
@@ -68,3 +126,17 @@ PARAM_GROUP_START(kalman)
  */
   PARAM_ADD_CORE(PARAM_FLOAT, maxVel, &maxVelocity)
 PARAM_GROUP_STOP(kalman)
+
+/**
+ * Reasons for the kalman supervisor to reset the estimator
+ */
+LOG_GROUP_START(kalmanSup)
+/**
+ * @brief Number of resets because the position or velocity was out of bounds
+ */
+LOG_ADD(LOG_UINT32, outOfBounds, &outOfBoundsCount)
+/**
+ * @brief Number of resets because of a NaN or infinity in the attitude or covariance
+ */
+LOG_ADD(LOG_UINT32, nonFinite, &nonFiniteCount)
+LOG_GROUP_STOP(kalmanSup)
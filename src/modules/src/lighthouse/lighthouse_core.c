@@ -63,6 +63,7 @@
 #include "static_mem.h"
 
 #include "lighthouse_transmit.h"
+#include "lighthouse_recorder.h"
 
 static const uint32_t MAX_WAIT_TIME_FOR_HEALTH_MS = 4000;
 
@@ -229,10 +230,44 @@ void lighthouseCoreSetSystemType(const lighthouseBaseStationType_t type)
   lighthouseUpdateSystemType();
 }
 
+// Set when uart1 delivers the data through circular DMA instead of the byte queue
+static bool useUartRxDma = false;
+
+TESTABLE_STATIC bool decodeUartFrame(const uint8_t* data, lighthouseUartFrame_t *frame) {
+  int syncCounter = 0;
+  for(int i = 0; i < UART_FRAME_LENGTH; i++) {
+    if (data[i] == 0xff) {
+      syncCounter += 1;
+    }
+  }
+
+  memset(frame, 0, sizeof(*frame));
+
+  frame->isSyncFrame = (syncCounter == UART_FRAME_LENGTH);
+
+  frame->data.sensor = data[0] & 0x03;
+  frame->data.channelFound = (data[0] & 0x80) == 0;
+  frame->data.channel = (data[0] >> 3) & 0x0f;
+  frame->data.slowBit = (data[0] >> 2) & 0x01;
+  memcpy(&frame->data.width, &data[1], 2);
+  memcpy(&frame->data.offset, &data[3], 3);
+  memcpy(&frame->data.beamData, &data[6], 3);
+  memcpy(&frame->data.timestamp, &data[9], 3);
+
+  // Offset is expressed in a 6 MHz clock, convert to the 24 MHz that is used for timestamps
+  frame->data.offset *= 4;
+
+  bool isPaddingZero = (((data[5] | data[8]) & 0xfe) == 0);
+  bool isFrameValid = (isPaddingZero || frame->isSyncFrame);
+
+  STATS_CNT_RATE_EVENT_DEBUG(&serialFrameRate);
+
+  return isFrameValid;
+}
+
 #define OPTIMIZE_UART1_ACCESS 1
 TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
   static char data[UART_FRAME_LENGTH];
-  int syncCounter = 0;
 
   #ifdef OPTIMIZE_UART1_ACCESS
     // Wait until there is enough data available in the queue before reading
@@ -252,32 +287,25 @@ TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
       lighthouseTransmitProcessTimeout();
     }
   #endif
-
-    if ((unsigned char)data[i] == 0xff) {
-      syncCounter += 1;
-    }
   }
 
-  memset(frame, 0, sizeof(*frame));
-
-  frame->isSyncFrame = (syncCounter == UART_FRAME_LENGTH);
-
-  frame->data.sensor = data[0] & 0x03;
-  frame->data.channelFound = (data[0] & 0x80) == 0;
-  frame->data.channel = (data[0] >> 3) & 0x0f;
-  frame->data.slowBit = (data[0] >> 2) & 0x01;
-  memcpy(&frame->data.width, &data[1], 2);
-  memcpy(&frame->data.offset, &data[3], 3);
-  memcpy(&frame->data.beamData, &data[6], 3);
-  memcpy(&frame->data.timestamp, &data[9], 3);
+  return decodeUartFrame((const uint8_t*)data, frame);
+}
 
-  // Offset is expressed in a 6 MHz clock, convert to the 24 MHz that is used for timestamps
-  frame->data.offset *= 4;
+TESTABLE_STATIC bool getUartFrameDma(lighthouseUartFrame_t *frame) {
+  while (uart1RxDmaBytesAvailable() < UART_FRAME_LENGTH) {
+    vTaskDelay(1);
+    lighthouseTransmitProcessTimeout();
+  }
 
-  bool isPaddingZero = (((data[5] | data[8]) & 0xfe) == 0);
-  bool isFrameValid = (isPaddingZero || frame->isSyncFrame);
+  // Data has been dropped, we are probably not in sync anymore
+  if (uart1DidOverrun()) {
+    return false;
+  }
 
-  STATS_CNT_RATE_EVENT_DEBUG(&serialFrameRate);
+  // Decode in place in the DMA buffer
+  const bool isFrameValid = decodeUartFrame(uart1RxDmaPeek(UART_FRAME_LENGTH), frame);
+  uart1RxDmaConsume(UART_FRAME_LENGTH);
 
   return isFrameValid;
 }
@@ -298,6 +326,28 @@ TESTABLE_STATIC void waitForUartSynchFrame() {
   }
 }
 
+TESTABLE_STATIC void waitForUartSynchFrameDma() {
+  int syncCounter = 0;
+
+  // Clear any old overrun flag, we are about to synchronize anyway
+  uart1DidOverrun();
+  while (syncCounter < UART_FRAME_LENGTH) {
+    uint32_t available = uart1RxDmaBytesAvailable();
+    if (available == 0) {
+      vTaskDelay(1);
+      continue;
+    }
+
+    const uint8_t* data = uart1RxDmaPeek(1);
+    if (*data == 0xff) {
+      syncCounter += 1;
+    } else {
+      syncCounter = 0;
+    }
+    uart1RxDmaConsume(1);
+  }
+}
+
 void lighthouseCoreSetLeds(lighthouseCoreLedState_t red, lighthouseCoreLedState_t orange, lighthouseCoreLedState_t green)
 {
   uint8_t commandBuffer[2];
@@ -308,20 +358,21 @@ void lighthouseCoreSetLeds(lighthouseCoreLedState_t red, lighthouseCoreLedState_
   uart1SendData(2, commandBuffer);
 }
 
-bool findOtherBaseStation(const pulseProcessorResult_t* angles, const int baseStation, int* otherBaseStation) {
-  for (int candidate = baseStation + 1; candidate != baseStation; candidate++) {
-    if (candidate >= CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
-      candidate = 0;
-    }
+// Base stations that delivered data in the current and in the previous rotor cycle, used to collect
+// data from all visible base stations for one crossing beams solve (LH2)
+static uint16_t crossingBeamsSeenMap = 0;
+static uint16_t crossingBeamsExpectedMap = 0;
 
+static uint16_t findBaseStationsWithData(const pulseProcessorResult_t* angles) {
+  uint16_t result = 0;
+  for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
     // Only looking at sensor 0, assuming this is enough
-    if (angles->baseStationMeasurementsLh1[candidate].sensorMeasurements[0].validCount == PULSE_PROCESSOR_N_SWEEPS) {
-      *otherBaseStation = candidate;
-      return true;
+    if (angles->baseStationMeasurementsLh1[baseStation].sensorMeasurements[0].validCount == PULSE_PROCESSOR_N_SWEEPS) {
+      result |= (1 << baseStation);
     }
   }
 
-  return false;
+  return result;
 }
 
 
@@ -338,35 +389,60 @@ static uint8_t estimationMethod = 1;
 #endif
 
 
+static void usePulseResultCrossingBeamsLh1(pulseProcessor_t *appState, pulseProcessorResult_t* angles, int baseStation) {
+  if (baseStation == 1) {
+    const int otherBaseStation = 0;
+    STATS_CNT_RATE_EVENT_DEBUG(&cycleRate);
+
+    lighthousePositionEstimatePoseCrossingBeams(appState, angles, baseStation, otherBaseStation);
+
+    pulseProcessorProcessed(angles, baseStation);
+    pulseProcessorProcessed(angles, otherBaseStation);
+  }
+}
+
+static void usePulseResultCrossingBeamsLh2(pulseProcessor_t *appState, pulseProcessorResult_t* angles, int baseStation) {
+  const uint16_t baseStationsWithData = findBaseStationsWithData(angles) & appState->baseStationGeoValidMap;
+  const uint16_t baseStationBitMap = (1 << baseStation);
+
+  if (baseStationsWithData & baseStationBitMap) {
+    if (crossingBeamsSeenMap & baseStationBitMap) {
+      // A full cycle since we last got data from this base station
+      crossingBeamsExpectedMap = crossingBeamsSeenMap;
+      crossingBeamsSeenMap = 0;
+    }
+    crossingBeamsSeenMap |= baseStationBitMap;
+  }
+
+  // Wait until all base stations from the previous cycle have delivered data, and use all of them in one solve
+  const bool gotExpected = ((baseStationsWithData & crossingBeamsExpectedMap) == crossingBeamsExpectedMap);
+  if (gotExpected && __builtin_popcount(baseStationsWithData) >= 2) {
+    STATS_CNT_RATE_EVENT_DEBUG(&cycleRate);
+
+    lighthousePositionEstimatePoseCrossingBeamsMulti(appState, angles, baseStationsWithData, baseStation);
+
+    for (int bs = 0; bs < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; bs++) {
+      if (baseStationsWithData & (1 << bs)) {
+        pulseProcessorProcessed(angles, bs);
+      }
+    }
+  }
+}
+
 static void usePulseResultCrossingBeams(pulseProcessor_t *appState, pulseProcessorResult_t* angles, int baseStation) {
   pulseProcessorClearOutdated(appState, angles, baseStation);
 
-  int otherBaseStation = 0;
-  bool foundPair = false;
-
   switch (systemType) {
     case lighthouseBsTypeV1:
-      if (baseStation == 1) {
-        otherBaseStation = 0;
-        foundPair = true;
-      }
+      usePulseResultCrossingBeamsLh1(appState, angles, baseStation);
       break;
     case lighthouseBsTypeV2:
-      foundPair = findOtherBaseStation(angles, baseStation, &otherBaseStation);
+      usePulseResultCrossingBeamsLh2(appState, angles, baseStation);
       break;
     default:
       // Nothing here
       break;
   }
-
-  if (foundPair) {
-    STATS_CNT_RATE_EVENT_DEBUG(&cycleRate);
-
-    lighthousePositionEstimatePoseCrossingBeams(appState, angles, baseStation, otherBaseStation);
-
-    pulseProcessorProcessed(angles, baseStation);
-    pulseProcessorProcessed(angles, otherBaseStation);
-  }
 }
 
 static void usePulseResultSweeps(pulseProcessor_t *appState, pulseProcessorResult_t* angles, int baseStation) {
@@ -417,7 +493,7 @@ static void usePulseResult(pulseProcessor_t *appState, pulseProcessorResult_t* a
         STATS_CNT_RATE_EVENT_DEBUG(&preThrottleRate);
         bool useSample = true;
         if (lighthouseBsTypeV2 == angles->measurementType) {
-          useSample = throttleLh2Samples(now_ms);
+          useSample = throttleLh2Samples(now_ms, angles, baseStation);
         }
 
         if (useSample) {
@@ -447,9 +523,10 @@ static void usePulseResult(pulseProcessor_t *appState, pulseProcessorResult_t* a
 
 static void useCalibrationData(pulseProcessor_t *appState) {
   for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
-    if (appState->ootxDecoder[baseStation].isFullyDecoded) {
+    pulseProcessorBsSlot_t* slot = pulseProcessorFindBsSlot(appState, baseStation);
+    if (slot && slot->ootxDecoder.isFullyDecoded) {
       lighthouseCalibration_t newData;
-      lighthouseCalibrationInitFromFrame(&newData, &appState->ootxDecoder[baseStation].frame);
+      lighthouseCalibrationInitFromFrame(&newData, &slot->ootxDecoder.frame);
 
       modifyBit(&baseStationCalibConfirmedMap, baseStation, true);
 
@@ -457,7 +534,7 @@ static void useCalibrationData(pulseProcessor_t *appState) {
       const bool currentCalibDataValid = currentCalibData->valid;
       const bool isDataDifferent = ((newData.uid != currentCalibData->uid) || (newData.valid != currentCalibDataValid));
       if (isDataDifferent) {
-        DEBUG_PRINT("Got calibration from %08X on channel %d\n", (unsigned int)appState->ootxDecoder[baseStation].frame.id, baseStation + 1);
+        DEBUG_PRINT("Got calibration from %08X on channel %d\n", (unsigned int)slot->ootxDecoder.frame.id, baseStation + 1);
         lighthouseCoreSetCalibrationData(baseStation, &newData);
         lighthouseStoragePersistCalibDataBackground(baseStation);
 
@@ -536,7 +613,8 @@ static void updateSystemStatus(const uint32_t now_ms) {
 void lighthouseCoreTask(void *param) {
   bool isUartFrameValid = false;
 
-  uart1Init(230400);
+  uart1Init(CONFIG_DECK_LIGHTHOUSE_UART_BAUDRATE);
+  useUartRxDma = uart1EnableRxDma();
   systemWaitStart();
 
   lighthouseStorageVerifySetStorageVersion();
@@ -560,12 +638,16 @@ void lighthouseCoreTask(void *param) {
 
   while(1) {
     memset(pulseWidth, 0, sizeof(pulseWidth[0]) * PULSE_PROCESSOR_N_SENSORS);
-    waitForUartSynchFrame();
+    if (useUartRxDma) {
+      waitForUartSynchFrameDma();
+    } else {
+      waitForUartSynchFrame();
+    }
     uartSynchronized = true;
 
     bool previousWasSyncFrame = false;
 
-    while((isUartFrameValid = getUartFrameRaw(&frame))) {
+    while((isUartFrameValid = (useUartRxDma ? getUartFrameDma(&frame) : getUartFrameRaw(&frame)))) {
       const uint32_t now_ms = T2M(xTaskGetTickCount());
 
       // If a sync frame is getting through, we are only receiving sync frames. So nothing else. Reset state
@@ -576,6 +658,7 @@ void lighthouseCoreTask(void *param) {
       else if(!frame.isSyncFrame) {
         STATS_CNT_RATE_EVENT_DEBUG(&frameRate);
 	lighthouseTransmitProcessFrame(&frame);
+        lighthouseRecorderProcessFrame(&frame);
 
         deckHealthCheck(&lighthouseCoreState, &frame, now_ms);
         lighthouseUpdateSystemType();
@@ -587,6 +670,7 @@ void lighthouseCoreTask(void *param) {
       previousWasSyncFrame = frame.isSyncFrame;
 
       updateSystemStatus(now_ms);
+      lighthouseRecorderProcessSnapshot(now_ms);
     }
 
     uartSynchronized = false;
@@ -40,6 +40,8 @@
 #include "crc32.h"
 #include "mem.h"
 
+#include "worker.h"
+
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -54,6 +56,112 @@
 static bool inBootloaderMode = true;
 static bool hasStarted = false;
 
+// Set when the content of the flash has been verified to be the required bitstream
+static bool isImageVerified = false;
+
+// Mem writes are collected in page buffers that are written to the flash by the worker, while the next page is
+// received from the client. A buffer is pending from when it is scheduled until the worker has written it.
+#define PAGE_BUFFER_COUNT 2
+typedef struct {
+  uint32_t address;
+  uint16_t length;
+  volatile bool isPending;
+  uint8_t data[LH_FLASH_PAGE_SIZE];
+} pageBuffer_t;
+
+static pageBuffer_t pageBuffers[PAGE_BUFFER_COUNT];
+static pageBuffer_t* fillBuffer = 0;
+static int nextBuffer = 0;
+
+// Written by the worker, read by the mem task
+static volatile bool hasWriteFailed = false;
+
+static uint32_t transferStartMs;
+
+static void writePage(pageBuffer_t* buffer) {
+  // The previous page write must be done before the next one is started
+  bool pass = lhblFlashWaitComplete();
+  pass = pass && lhblFlashWritePage(buffer->address, buffer->length, buffer->data);
+  if (!pass) {
+    hasWriteFailed = true;
+  }
+
+  buffer->isPending = false;
+}
+
+static void writePageWorker(void* arg) {
+  writePage((pageBuffer_t*)arg);
+}
+
+static void waitForPageBuffer(const pageBuffer_t* buffer) {
+  while (buffer->isPending) {
+    vTaskDelay(M2T(1));
+  }
+}
+
+static void submitFillBuffer() {
+  if (fillBuffer) {
+    fillBuffer->isPending = true;
+    if (workerSchedule(writePageWorker, fillBuffer) != 0) {
+      // The worker queue is full, write the page from this task instead
+      writePage(fillBuffer);
+    }
+    fillBuffer = 0;
+  }
+}
+
+static void takeFillBuffer(const uint32_t address) {
+  fillBuffer = &pageBuffers[nextBuffer];
+  nextBuffer = (nextBuffer + 1) % PAGE_BUFFER_COUNT;
+
+  waitForPageBuffer(fillBuffer);
+  fillBuffer->address = address;
+  fillBuffer->length = 0;
+}
+
+// Wait until all submitted pages have been written to the flash
+static void drainPageBuffers() {
+  submitFillBuffer();
+
+  for (int i = 0; i < PAGE_BUFFER_COUNT; i++) {
+    waitForPageBuffer(&pageBuffers[i]);
+  }
+
+  if (!lhblFlashWaitComplete()) {
+    hasWriteFailed = true;
+  }
+}
+
+static uint32_t calculateFlashCrc(const uint32_t length) {
+  static uint8_t readBuffer[LH_FLASH_PAGE_SIZE];
+
+  crc32Context_t crcContext;
+  crc32ContextInit(&crcContext);
+
+  for (uint32_t i = 0; i < length; i += sizeof(readBuffer)) {
+    uint32_t chunkLength = length - i;
+    if (chunkLength > sizeof(readBuffer)) {
+      chunkLength = sizeof(readBuffer);
+    }
+    lhblFlashRead(LH_FW_ADDR + i, chunkLength, readBuffer);
+    crc32Update(&crcContext, readBuffer, chunkLength);
+  }
+
+  return crc32Out(&crcContext);
+}
+
+static void verifyTransferredImage() {
+  drainPageBuffers();
+
+  const uint32_t transferMs = T2M(xTaskGetTickCount()) - transferStartMs;
+  const uint32_t crc = calculateFlashCrc(LIGHTHOUSE_BITSTREAM_SIZE);
+  isImageVerified = !hasWriteFailed && (crc == LIGHTHOUSE_BITSTREAM_CRC);
+
+  const uint32_t bytesPerSecond = transferMs > 0 ? (LIGHTHOUSE_BITSTREAM_SIZE * 1000) / transferMs : 0;
+  DEBUG_PRINT("Bitstream transferred in %d ms, %d bytes/s\n", (int)transferMs, (int)bytesPerSecond);
+  DEBUG_PRINT("Bitstream CRC32: %x %s\n", (int)crc, isImageVerified?"[PASS]":"[FAIL]");
+}
+
 bool lighthouseDeckFlasherCheckVersionAndBoot() {
   lhblInit();
 
@@ -81,17 +189,9 @@ bool lighthouseDeckFlasherCheckVersionAndBoot() {
   int deckVersion = strtol(&deckBitstream[2], NULL, 10);
 
   // Checking that the bitstream has the right checksum
-  crc32Context_t crcContext;
-  crc32ContextInit(&crcContext);
-
-  for (int i=0; i<=LIGHTHOUSE_BITSTREAM_SIZE; i+=READ_BUFFER_LENGTH) {
-    int length = ((i + READ_BUFFER_LENGTH) < LIGHTHOUSE_BITSTREAM_SIZE)?READ_BUFFER_LENGTH:LIGHTHOUSE_BITSTREAM_SIZE-i;
-    lhblFlashRead(LH_FW_ADDR + i, length, (uint8_t*)deckBitstream);
-    crc32Update(&crcContext, deckBitstream, length);
-  }
-
-  uint32_t crc = crc32Out(&crcContext);
+  uint32_t crc = calculateFlashCrc(LIGHTHOUSE_BITSTREAM_SIZE);
   bool pass = crc == LIGHTHOUSE_BITSTREAM_CRC;
+  isImageVerified = pass;
   DEBUG_PRINT("Bitstream CRC32: %x %s\n", (int)crc, pass?"[PASS]":"[FAIL]");
 
   // Launch LH deck FW
@@ -113,50 +213,69 @@ bool lighthouseDeckFlasherCheckVersionAndBoot() {
 bool lighthouseDeckFlasherRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer)
 {
   if (inBootloaderMode) {
+    // Make sure everything written so far is in the flash before reading it back
+    drainPageBuffers();
     return lhblFlashRead(LH_FW_ADDR + memAddr, readLen, buffer);
   } else {
     return false;
   }
 }
 
+/**
+ * The writes from the client are streamed to the flash. A write is copied to the page buffer being filled and the
+ * buffer is handed over to the worker when the page is full or the next write is not contiguous. The write returns
+ * as soon as the data is copied, the worker writes the page while the client sends the next one. When the last
+ * byte of the bitstream has been written, the CRC of the whole image in the flash is verified.
+ */
 bool lighthouseDeckFlasherWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer, const DeckMemDef_t* memDef)
 {
-  bool pass;
   if (memAddr == 0) {
-    pass = lhblFlashEraseFirmware();
+    drainPageBuffers();
+    hasWriteFailed = false;
+    isImageVerified = false;
+    transferStartMs = T2M(xTaskGetTickCount());
 
-    if (pass == false) {
+    if (lhblFlashEraseFirmware() == false) {
       return false;
     }
   }
 
+  if (hasWriteFailed) {
+    return false;
+  }
+
   uint32_t address = LH_FW_ADDR + memAddr;
+  int index = 0;
+  while (index < writeLen) {
+    if (fillBuffer && (fillBuffer->address + fillBuffer->length) != address) {
+      submitFillBuffer();
+    }
 
-  // This function can be called with a buffer spanning 2 pages
-  // Try to find the first byte of the second page if this is the case
-  int pageSplit = 0;
-  for (int i=0; i<writeLen; i++) {
-    if (((address + i) & 0x0ff) == 0) {
-      pageSplit = i;
-      break;
+    if (fillBuffer == 0) {
+      takeFillBuffer(address);
+    }
+
+    // A page write can not cross a page boundary
+    int length = LH_FLASH_PAGE_SIZE - (address % LH_FLASH_PAGE_SIZE);
+    if (length > (writeLen - index)) {
+      length = writeLen - index;
     }
-  }
 
-  // Flashing first page
-  if (pageSplit > 0) {
-    pass = lhblFlashWritePage(address, pageSplit, buffer);
+    memcpy(&fillBuffer->data[fillBuffer->length], &buffer[index], length);
+    fillBuffer->length += length;
+    address += length;
+    index += length;
 
-    if (pass == false) {
-      return pass;
+    if ((address % LH_FLASH_PAGE_SIZE) == 0) {
+      submitFillBuffer();
     }
   }
 
-  // Flashing second page if necessary
-  if ((writeLen-pageSplit) > 0) {
-    pass = lhblFlashWritePage(address+pageSplit, writeLen-pageSplit, &buffer[pageSplit]);
+  if ((memAddr + writeLen) >= LIGHTHOUSE_BITSTREAM_SIZE) {
+    verifyTransferredImage();
   }
 
-  return pass;
+  return !hasWriteFailed;
 }
 
 uint8_t lighthouseDeckFlasherPropertiesQuery() {
@@ -167,7 +286,12 @@ uint8_t lighthouseDeckFlasherPropertiesQuery() {
   }
 
   if (inBootloaderMode) {
-    result |= DECK_MEMORY_MASK_BOOT_LOADER_ACTIVE | DECK_MEMORY_MASK_UPGRADE_REQUIRED;
+    result |= DECK_MEMORY_MASK_BOOT_LOADER_ACTIVE;
+
+    // A client does not have to transfer the bitstream again if the flash already holds the required image
+    if (!isImageVerified) {
+      result |= DECK_MEMORY_MASK_UPGRADE_REQUIRED;
+    }
   }
 
   return result;
@@ -36,6 +36,8 @@
 #include "statsCnt.h"
 #include "mem.h"
 #include "autoconf.h"
+#include "usec_time.h"
+#include "crc32.h"
 
 #include "lighthouse_position_est.h"
 #include "lighthouse_geometry.h"
@@ -60,7 +62,15 @@ static void preProcessGeometryData(mat3d bsRot, mat3d bsRotInverted, mat3d lh1Ro
 // Geometry memory handling for the memory module
 static const uint32_t calibStartAddr = 0x1000;
 static const uint32_t pageSize = 0x100;
-static uint32_t handleMemGetSize(void) { return calibStartAddr + sizeof(lighthouseCoreState.bsCalibration); }
+static const uint32_t hashStartAddr = 0x2000;
+
+// Content hashes (CRC32) of the geometry and calibration data, laid out as in the memory. The first hash is the hash of
+// all the hashes of the base stations, followed by one geometry hash and one calibration hash per base station.
+// Clients compare the hashes with their data to find out if they have to upload it.
+#define CONTENT_HASH_COUNT (1 + 2 * CONFIG_DECK_LIGHTHOUSE_MAX_N_BS)
+static uint32_t contentHashes[CONTENT_HASH_COUNT];
+
+static uint32_t handleMemGetSize(void) { return hashStartAddr + sizeof(contentHashes); }
 static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
 static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const uint8_t* buffer);
 static const MemoryHandlerDef_t memDef = {
@@ -80,6 +90,12 @@ static void modifyBit(uint16_t *bitmap, const int index, const bool value) {
   }
 }
 
+static void updateContentHash(const int baseStation) {
+  contentHashes[1 + 2 * baseStation] = crc32CalculateBuffer(&lighthouseCoreState.bsGeometry[baseStation], sizeof(baseStationGeometry_t));
+  contentHashes[2 + 2 * baseStation] = crc32CalculateBuffer(&lighthouseCoreState.bsCalibration[baseStation], sizeof(lighthouseCalibration_t));
+  contentHashes[0] = crc32CalculateBuffer(&contentHashes[1], sizeof(contentHashes) - sizeof(contentHashes[0]));
+}
+
 void lighthousePositionEstInit() {
   for (int i = 0; i < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; i++) {
     lighthousePositionGeometryDataUpdated(i);
@@ -101,7 +117,7 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
         result = true;
       }
     }
-  } else {
+  } else if (memAddr < hashStartAddr) {
     uint32_t calibOffsetAddr = memAddr - calibStartAddr;
     uint32_t index = calibOffsetAddr / pageSize;
     uint32_t inPageAddr = calibOffsetAddr % pageSize;
@@ -113,6 +129,14 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
         result = true;
       }
     }
+  } else {
+    uint32_t hashOffsetAddr = memAddr - hashStartAddr;
+    if (hashOffsetAddr + readLen <= sizeof(contentHashes)) {
+      uint8_t* start = (uint8_t*)contentHashes;
+      memcpy(buffer, start + hashOffsetAddr, readLen);
+
+      result = true;
+    }
   }
 
   return result;
@@ -139,7 +163,7 @@ static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const
         result = true;
       }
     }
-  } else {
+  } else if (memAddr < hashStartAddr) {
     uint32_t calibOffsetAddr = memAddr - calibStartAddr;
     uint32_t index = calibOffsetAddr / pageSize;
     uint32_t inPageAddr = calibOffsetAddr % pageSize;
@@ -166,6 +190,8 @@ static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const
 void lighthousePositionCalibrationDataWritten(const uint8_t baseStation) {
   if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
     modifyBit(&lighthouseCoreState.baseStationCalibValidMap, baseStation, lighthouseCoreState.bsCalibration[baseStation].valid);
+    pulseProcessorCalibrationDataUpdated(&lighthouseCoreState, baseStation);
+    updateContentHash(baseStation);
   }
 }
 
@@ -176,6 +202,7 @@ static void lighthousePositionGeometryDataUpdated(const int baseStation) {
   }
 
   modifyBit(&lighthouseCoreState.baseStationGeoValidMap, baseStation, lighthouseCoreState.bsGeometry[baseStation].valid);
+  updateContentHash(baseStation);
 }
 
 void lighthousePositionSetGeometryData(const uint8_t baseStation, const baseStationGeometry_t* geometry) {
@@ -282,6 +309,76 @@ static void estimatePositionCrossingBeams(const pulseProcessor_t *state, pulsePr
   }
 }
 
+// Std dev of the crossing beams position with two base stations, it shrinks with more base stations
+static const float crossingBeamsStdDev = 0.01;
+
+static void estimatePositionCrossingBeamsMulti(const pulseProcessor_t *state, pulseProcessorResult_t* angles, const uint16_t baseStationMap) {
+  memset(&ext_pos, 0, sizeof(ext_pos));
+  uint8_t sensorsUsed = 0;
+  float residualSqSum = 0;
+  int maxBaseStations = 0;
+
+  vec3d origins[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+  vec3d rays[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+
+  // One least squares solve per sensor over all base stations, the sensor positions are averaged in the same
+  // way as in the two base station case
+  for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    int count = 0;
+    for (int baseStation = 0; baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; baseStation++) {
+      // LH2 angles are converted to LH1 angles, so it is OK to use sensorMeasurementsLh1
+      pulseProcessorSensorMeasurement_t* measurement = &angles->baseStationMeasurementsLh1[baseStation].sensorMeasurements[sensor];
+      if ((baseStationMap & (1 << baseStation)) && measurement->validCount == PULSE_PROCESSOR_N_SWEEPS) {
+        const baseStationGeometry_t* geo = &state->bsGeometry[baseStation];
+        lighthouseGeometryGetBaseStationPosition(geo, origins[count]);
+        lighthouseGeometryGetRay(geo, measurement->correctedAngles[0], measurement->correctedAngles[1], rays[count]);
+        count++;
+      }
+    }
+
+    float residual;
+    if (lighthouseGeometryGetPositionFromRays(origins, rays, count, position, &residual)) {
+      residualSqSum += residual * residual;
+
+      ext_pos.x += position[0];
+      ext_pos.y += position[1];
+      ext_pos.z += position[2];
+      sensorsUsed++;
+      if (count > maxBaseStations) {
+        maxBaseStations = count;
+      }
+
+      STATS_CNT_RATE_EVENT(&positionRate);
+    }
+  }
+
+  // Only use measurement if we got all sensors, see estimatePositionCrossingBeams()
+  if (sensorsUsed == PULSE_PROCESSOR_N_SENSORS) {
+    const float residualRms = sqrtf(residualSqSum / sensorsUsed);
+    deltaLog = residualRms;
+    ext_pos.x /= sensorsUsed;
+    ext_pos.y /= sensorsUsed;
+    ext_pos.z /= sensorsUsed;
+
+    positionLog[0] = ext_pos.x;
+    positionLog[1] = ext_pos.y;
+    positionLog[2] = ext_pos.z;
+
+    // Make sure we feed sane data into the estimator
+    if (isfinite(ext_pos.pos[0]) && isfinite(ext_pos.pos[1]) && isfinite(ext_pos.pos[2])) {
+      // Independent rays reduce the error as 1/sqrt(n), but a large residual (reflections, bad geometry data)
+      // means that the rays do not agree and that the nominal value is too optimistic
+      ext_pos.stdDev = fmaxf(crossingBeamsStdDev * sqrtf(2.0f / maxBaseStations), residualRms);
+      ext_pos.source = MeasurementSourceLighthouse;
+      #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
+        estimatorEnqueuePosition(&ext_pos);
+      #endif
+    }
+  } else {
+    deltaLog = 0;
+  }
+}
+
 static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulseProcessorResult_t* angles, int baseStation) {
   const lighthouseCalibration_t* bsCalib = &appState->bsCalibration[baseStation];
   sweepAngleMeasurement_t sweepInfo;
@@ -290,6 +387,8 @@ static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulsePro
   sweepInfo.t = 0;
   sweepInfo.calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh1;
   sweepInfo.baseStationId = baseStation;
+  // The frames are processed as soon as they are received, use the current time as the time of the measurement
+  sweepInfo.eventTimeUs = (uint32_t)usecTimestamp();
 
   for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
     sweepInfo.sensorId = sensor;
@@ -339,6 +438,8 @@ static void estimatePositionSweepsLh2(const pulseProcessor_t* appState, pulsePro
   sweepInfo.rotorRotInv = &appState->bsGeoCache[baseStation].baseStationInvertedRotationMatrixes;
   sweepInfo.calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh2;
   sweepInfo.baseStationId = baseStation;
+  // The frames are processed as soon as they are received, use the current time as the time of the measurement
+  sweepInfo.eventTimeUs = (uint32_t)usecTimestamp();
 
   for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
     sweepInfo.sensorId = sensor;
@@ -470,6 +571,11 @@ void lighthousePositionEstimatePoseCrossingBeams(const pulseProcessor_t *state,
   }
 }
 
+void lighthousePositionEstimatePoseCrossingBeamsMulti(const pulseProcessor_t *state, pulseProcessorResult_t* angles, const uint16_t baseStationMap, int yawBaseStation) {
+  estimatePositionCrossingBeamsMulti(state, angles, baseStationMap & state->baseStationGeoValidMap);
+  estimateYaw(state, angles, yawBaseStation);
+}
+
 void lighthousePositionEstimatePoseSweeps(const pulseProcessor_t *state, pulseProcessorResult_t* angles, int baseStation) {
   if (state->bsGeometry[baseStation].valid) {
     estimatePositionSweeps(state, angles, baseStation);
@@ -0,0 +1,123 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lighthouse_recorder.c - Record raw lighthouse data to the uSD event log
+ */
+
+#include "lighthouse_recorder.h"
+#include "lighthouse_state.h"
+#include "eventtrigger.h"
+#include "autoconf.h"
+
+// Time between snapshots of two base stations
+#define SNAPSHOT_INTERVAL_MS 100
+
+EVENTTRIGGER(lhFrame, uint8, info, uint16, width, uint32, beamData, uint32, offset, uint32, deckTs)
+EVENTTRIGGER(lhCalibA, uint8, id, float, phase, float, tilt, float, curve, float, gibmag)
+EVENTTRIGGER(lhCalibB, uint8, id, float, gibphase, float, ogeemag, float, ogeephase, uint32, uid)
+EVENTTRIGGER(lhGeo, uint8, id, float, x, float, y, float, z)
+
+static uint32_t nextSnapshotTime = 0;
+static int nextSnapshotBaseStation = 0;
+
+void lighthouseRecorderProcessFrame(const lighthouseUartFrame_t* frame) {
+  if (frame->isSyncFrame) {
+    return;
+  }
+
+  const pulseProcessorFrame_t* data = &frame->data;
+
+  uint8_t info = data->sensor & LIGHTHOUSE_RECORDER_INFO_SENSOR_MASK;
+  if (data->channelFound) {
+    info |= LIGHTHOUSE_RECORDER_INFO_CHANNEL_FOUND;
+    info |= data->channel << LIGHTHOUSE_RECORDER_INFO_CHANNEL_SHIFT;
+    if (data->slowBit) {
+      info |= LIGHTHOUSE_RECORDER_INFO_SLOW_BIT;
+    }
+  }
+
+  eventTrigger_lhFrame_payload.info = info;
+  eventTrigger_lhFrame_payload.width = data->width;
+  eventTrigger_lhFrame_payload.beamData = data->beamData;
+  eventTrigger_lhFrame_payload.offset = data->offset;
+  eventTrigger_lhFrame_payload.deckTs = data->timestamp;
+  eventTrigger(&eventTrigger_lhFrame);
+}
+
+// id is (base station << 1) | sweep
+static void recordCalibration(const int baseStation, const lighthouseCalibration_t* calibration) {
+  for (int sweep = 0; sweep < 2; sweep++) {
+    const lighthouseCalibrationSweep_t* calib = &calibration->sweep[sweep];
+    const uint8_t id = (baseStation << 1) | sweep;
+
+    eventTrigger_lhCalibA_payload.id = id;
+    eventTrigger_lhCalibA_payload.phase = calib->phase;
+    eventTrigger_lhCalibA_payload.tilt = calib->tilt;
+    eventTrigger_lhCalibA_payload.curve = calib->curve;
+    eventTrigger_lhCalibA_payload.gibmag = calib->gibmag;
+    eventTrigger(&eventTrigger_lhCalibA);
+
+    eventTrigger_lhCalibB_payload.id = id;
+    eventTrigger_lhCalibB_payload.gibphase = calib->gibphase;
+    eventTrigger_lhCalibB_payload.ogeemag = calib->ogeemag;
+    eventTrigger_lhCalibB_payload.ogeephase = calib->ogeephase;
+    eventTrigger_lhCalibB_payload.uid = calibration->uid;
+    eventTrigger(&eventTrigger_lhCalibB);
+  }
+}
+
+// id is (base station << 2) | row, where row 0 is the origin and rows 1 - 3 are the rows of the rotation matrix
+static void recordGeometryRow(const int baseStation, const int row, const vec3d data) {
+  eventTrigger_lhGeo_payload.id = (baseStation << 2) | row;
+  eventTrigger_lhGeo_payload.x = data[0];
+  eventTrigger_lhGeo_payload.y = data[1];
+  eventTrigger_lhGeo_payload.z = data[2];
+  eventTrigger(&eventTrigger_lhGeo);
+}
+
+static void recordGeometry(const int baseStation, const baseStationGeometry_t* geometry) {
+  recordGeometryRow(baseStation, 0, geometry->origin);
+  for (int i = 0; i < 3; i++) {
+    recordGeometryRow(baseStation, i + 1, geometry->mat[i]);
+  }
+}
+
+void lighthouseRecorderProcessSnapshot(const uint32_t now_ms) {
+  if (now_ms < nextSnapshotTime) {
+    return;
+  }
+  nextSnapshotTime = now_ms + SNAPSHOT_INTERVAL_MS;
+
+  const int baseStation = nextSnapshotBaseStation;
+  nextSnapshotBaseStation = (nextSnapshotBaseStation + 1) % CONFIG_DECK_LIGHTHOUSE_MAX_N_BS;
+
+  const lighthouseCalibration_t* calibration = &lighthouseCoreState.bsCalibration[baseStation];
+  if (calibration->valid) {
+    recordCalibration(baseStation, calibration);
+  }
+
+  const baseStationGeometry_t* geometry = &lighthouseCoreState.bsGeometry[baseStation];
+  if (geometry->valid) {
+    recordGeometry(baseStation, geometry);
+  }
+}
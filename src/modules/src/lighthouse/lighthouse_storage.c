@@ -25,6 +25,8 @@
  * lighthouse_storage.c - persistent storage of lighthouse data
  */
 
+#include <string.h>
+
 #include "storage.h"
 #include "lighthouse_storage.h"
 #include "lighthouse_state.h"
@@ -51,6 +53,12 @@
 static baseStationGeometry_t geoBuffer;
 static lighthouseCalibration_t calibBuffer;
 
+// Used to compare data to persist with the data already in storage
+static union {
+  baseStationGeometry_t geo;
+  lighthouseCalibration_t calib;
+} compareBuffer;
+
 
 static void generateStorageKey(char* buf, const char* base, const uint8_t baseStation) {
   // TOOD make an implementation that supports baseStations with 2 digits
@@ -62,6 +70,18 @@ static void generateStorageKey(char* buf, const char* base, const uint8_t baseSt
   buf[baseLen + 1] = '\0';
 }
 
+// Clients upload the same data every time they connect, skip writing to the EEPROM when nothing has changed
+static bool storeIfChanged(const char* key, const void* data, const size_t length) {
+  ASSERT(length <= sizeof(compareBuffer));
+
+  const size_t fetched = storageFetch(key, &compareBuffer, length);
+  if (fetched == length && memcmp(&compareBuffer, data, length) == 0) {
+    return true;
+  }
+
+  return storageStore(key, data, length);
+}
+
 bool lighthouseStoragePersistData(const uint8_t baseStation, const bool geoData, const bool calibData) {
   bool result = true;
   char key[KEY_LEN];
@@ -69,11 +89,11 @@ bool lighthouseStoragePersistData(const uint8_t baseStation, const bool geoData,
   if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
     if (geoData) {
       generateStorageKey(key, STORAGE_KEY_GEO, baseStation);
-      result = result && storageStore(key, &lighthouseCoreState.bsGeometry[baseStation], sizeof(lighthouseCoreState.bsGeometry[baseStation]));
+      result = result && storeIfChanged(key, &lighthouseCoreState.bsGeometry[baseStation], sizeof(lighthouseCoreState.bsGeometry[baseStation]));
     }
     if (calibData) {
       generateStorageKey(key, STORAGE_KEY_CALIB, baseStation);
-      result = result && storageStore(key, &lighthouseCoreState.bsCalibration[baseStation], sizeof(lighthouseCoreState.bsCalibration[baseStation]));
+      result = result && storeIfChanged(key, &lighthouseCoreState.bsCalibration[baseStation], sizeof(lighthouseCoreState.bsCalibration[baseStation]));
     }
   }
 
@@ -92,7 +112,8 @@ static void lhPersistDataWorker(void* arg) {
 
 void lighthouseStoragePersistCalibDataBackground(const uint8_t baseStation) {
   if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
-    workerSchedule(lhPersistDataWorker, (void*)(uint32_t)baseStation);
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW, .coalesce = true};
+    workerScheduleWithOptions(lhPersistDataWorker, (void*)(uint32_t)baseStation, &options);
   }
 }
 
@@ -24,41 +24,168 @@
  *
  */
 
-#include <stdlib.h>
+#include <math.h>
 #include "lighthouse_throttle.h"
+#include "estimator_kalman.h"
 #include "param.h"
 
 // Uncomment next line to add extra debug log variables
 // #define CONFIG_DEBUG_LOG_ENABLE 1
 #include "log.h"
 
+#define CORE_CLOCK_HZ 168000000.0f
+// The size of the token bucket, in seconds of the current rate
+#define BUCKET_TIME_S 0.2f
+// A base station is active if it has been received within this time
+#define ACTIVE_BS_TIMEOUT_MS 1000
+// Angles further from the optical axis of the base station than this are considered of low quality
+#define MAX_QUALITY_ANGLE 1.0f
+#define SWEEPS_FILTER_ALPHA 0.05f
+
+#define WEIGHT_STALENESS 0.5f
+#define WEIGHT_SPREAD 0.25f
+#define WEIGHT_QUALITY 0.25f
+
 static const uint32_t evaluationIntervalMs = 100;
 static uint16_t maxRate = 50;  // Samples / second
+static float cpuBudget = 3.0f;  // % of the CPU used for sweep angle updates in the Kalman filter
+
+static float currentRate;
 static float discardProbability = 0.0f;
 
-bool throttleLh2Samples(const uint32_t nowMs) {
-    static uint32_t previousEvaluationTime = 0;
-    static uint32_t nextEvaluationTime = 0;
-    static uint32_t eventCounter = 0;
-    static int discardThreshold = 0;
+static float tokens;
+static uint32_t previousCallMs;
+static float avgSweepsPerSample;
+static uint32_t lastUsedMs[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+static uint32_t lastSeenMs[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
 
-    eventCounter++;
+static uint32_t eventCounter;
+static uint32_t discardCounter;
+static uint32_t nextEvaluationTime;
 
-    if (nowMs > nextEvaluationTime) {
-        const float currentRate = 1000.0f * (float)eventCounter / (float)(nowMs - previousEvaluationTime);
-        if (currentRate < (float)maxRate) {
-            discardProbability = 0.0;
-        } else {
-            discardProbability = 1.0f - (float)maxRate / currentRate;
+void throttleLh2Reset() {
+    tokens = 0.0f;
+    previousCallMs = 0;
+    avgSweepsPerSample = 0.0f;
+    for (int i = 0; i < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; i++) {
+        lastUsedMs[i] = 0;
+        lastSeenMs[i] = 0;
+    }
+
+    eventCounter = 0;
+    discardCounter = 0;
+    nextEvaluationTime = 0;
+    currentRate = 0.0f;
+    discardProbability = 0.0f;
+}
+
+/**
+ * The rate of samples the estimator can handle within the CPU budget, based on the measured cost of a sweep angle
+ * update in the Kalman filter. Limited by maxRate.
+ */
+static float calculateRate() {
+    float rate = (float)maxRate;
+
+    const float cyclesPerSweep = estimatorKalmanGetMeasurementCycles(MeasurementTypeSweepAngle);
+    if (cyclesPerSweep > 0.0f && avgSweepsPerSample > 0.0f) {
+        const float budgetCyclesPerS = CORE_CLOCK_HZ * cpuBudget / 100.0f;
+        const float budgetRate = budgetCyclesPerS / (cyclesPerSweep * avgSweepsPerSample);
+        if (budgetRate < rate) {
+            rate = budgetRate;
         }
-        discardThreshold = RAND_MAX * discardProbability;
+    }
+
+    return rate;
+}
+
+static int countActiveBaseStations(const uint32_t nowMs) {
+    int count = 0;
+    for (int i = 0; i < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; i++) {
+        if (lastSeenMs[i] != 0 && (nowMs - lastSeenMs[i]) < ACTIVE_BS_TIMEOUT_MS) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Scores the information in a sample in the range [0, 1], from
+ * - the time since a sample from the base station was used, compared to its share of the rate
+ * - the number of sensors that have seen both sweeps, a larger spread on the deck constrains yaw better
+ * - how close to the optical axis of the base station the sensors are, where the angle resolution is best
+ */
+static float scoreSample(const uint32_t nowMs, const pulseProcessorResult_t* angles, const int baseStation, const float rate, int* sweeps) {
+    int validSensors = 0;
+    float maxAngle = 0.0f;
 
-        previousEvaluationTime = nowMs;
+    for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+        const pulseProcessorSensorMeasurement_t* measurement = &angles->baseStationMeasurementsLh1[baseStation].sensorMeasurements[sensor];
+        if (measurement->validCount == PULSE_PROCESSOR_N_SWEEPS) {
+            validSensors++;
+            for (int sweep = 0; sweep < PULSE_PROCESSOR_N_SWEEPS; sweep++) {
+                const float angle = fabsf(measurement->correctedAngles[sweep]);
+                if (angle > maxAngle) {
+                    maxAngle = angle;
+                }
+            }
+        }
+    }
+    *sweeps = validSensors * PULSE_PROCESSOR_N_SWEEPS;
+
+    const int activeBs = countActiveBaseStations(nowMs);
+    const float targetIntervalMs = 1000.0f * (float)activeBs / rate;
+    float staleness = 1.0f;
+    if (lastUsedMs[baseStation] != 0 && targetIntervalMs > 0.0f) {
+        staleness = fminf(1.0f, (float)(nowMs - lastUsedMs[baseStation]) / targetIntervalMs);
+    }
+
+    const float spread = (float)validSensors / (float)PULSE_PROCESSOR_N_SENSORS;
+    const float quality = fmaxf(0.0f, 1.0f - maxAngle / MAX_QUALITY_ANGLE);
+
+    return WEIGHT_STALENESS * staleness + WEIGHT_SPREAD * spread + WEIGHT_QUALITY * quality;
+}
+
+bool throttleLh2Samples(const uint32_t nowMs, const pulseProcessorResult_t* angles, const int baseStation) {
+    lastSeenMs[baseStation] = nowMs;
+    eventCounter++;
+
+    const float rate = calculateRate();
+    const float capacity = fmaxf(1.0f, rate * BUCKET_TIME_S);
+    if (previousCallMs != 0) {
+        tokens += rate * (float)(nowMs - previousCallMs) / 1000.0f;
+    } else {
+        tokens = capacity;
+    }
+    tokens = fminf(tokens, capacity);
+    previousCallMs = nowMs;
+
+    int sweeps = 0;
+    const float score = scoreSample(nowMs, angles, baseStation, rate, &sweeps);
+    if (sweeps > 0) {
+        avgSweepsPerSample += SWEEPS_FILTER_ALPHA * ((float)sweeps - avgSweepsPerSample);
+    }
+
+    // The emptier the bucket, the more information a sample must carry to be used
+    const float fill = tokens / capacity;
+    const bool useSample = (tokens >= 1.0f) && (score >= 1.0f - fill);
+
+    if (useSample) {
+        tokens -= 1.0f;
+        lastUsedMs[baseStation] = nowMs;
+    } else {
+        discardCounter++;
+    }
+
+    if (nowMs > nextEvaluationTime) {
+        currentRate = rate;
+        discardProbability = (float)discardCounter / (float)eventCounter;
         eventCounter = 0;
+        discardCounter = 0;
         nextEvaluationTime = nowMs + evaluationIntervalMs;
     }
 
-    return (rand() > discardThreshold);
+    return useSample;
 }
 
 PARAM_GROUP_START(lighthouse)
@@ -71,8 +198,17 @@ PARAM_GROUP_START(lighthouse)
  */
 PARAM_ADD(PARAM_UINT16, lh2maxRate, &maxRate)
 
+/**
+ * @brief Share of the CPU that Kalman sweep angle updates may use [%]
+ *
+ * The rate of samples sent to the estimator is reduced below lh2maxRate when the measured cost of the updates in the
+ * Kalman filter would exceed this budget. 3% by default.
+ */
+PARAM_ADD(PARAM_FLOAT, lh2CpuBudget, &cpuBudget)
+
 PARAM_GROUP_STOP(lighthouse)
 
 LOG_GROUP_START(lighthouse)
 LOG_ADD_DEBUG(LOG_FLOAT, disProb, &discardProbability)
+LOG_ADD_DEBUG(LOG_FLOAT, thrRate, &currentRate)
 LOG_GROUP_STOP(lighthouse)
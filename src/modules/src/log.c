@@ -35,7 +35,6 @@
 /* FreeRtos includes */
 #include "FreeRTOS.h"
 #include "task.h"
-#include "timers.h"
 #include "semphr.h"
 
 #include "config.h"
@@ -49,6 +48,12 @@
 #include "cfassert.h"
 #include "debug.h"
 #include "static_mem.h"
+#include "cycle_counter.h"
+#include "toc_index.h"
+#include "toc_blob.h"
+#include "mem.h"
+#include "eventtrigger.h"
+#include "usec_time.h"
 
 #if 0
 #define LOG_DEBUG(fmt, ...) DEBUG_PRINT("D/log " fmt, ## __VA_ARGS__)
@@ -87,30 +92,181 @@ typedef enum {
 // Maximum log payload length (4 bytes are used for block id and timestamp)
 #define LOG_MAX_LEN 26
 
-/* Log packet parameters storage */
-#define LOG_MAX_OPS 128
-#define LOG_MAX_BLOCKS 16
+// Batched blocks prefix each sample with a one byte time delta (in ms) relative
+// to the timestamp of the first sample in the packet
+#define LOG_BATCH_DELTA_LEN 1
+#define LOG_BATCH_MAX_DELTA 255
+
+// Blocks with microsecond timestamps have a 4 bytes timestamp in the header,
+// using one byte of the payload, and two bytes batch time deltas in us
+#define LOG_HEADER_LEN 4
+#define LOG_HEADER_LEN_US 5
+#define LOG_BATCH_DELTA_LEN_US 2
+#define LOG_BATCH_MAX_DELTA_US 65535
+
+typedef enum {
+  logTimestamp_ms = 0,
+  logTimestamp_us = 1,
+} logTimestamp_t;
+
+// Changed-only blocks send a full packet at least every this many periods
+#define LOG_KEYFRAME_INTERVAL_DEFAULT 10
+
+// Adaptive throttling, see logThrottleUpdate(). Under backpressure from the
+// CRTP TX queue the period of fast periodic blocks is doubled per throttle
+// level, but never stretched beyond LOG_THROTTLE_MAX_PERIOD. Blocks that are
+// already slower than that are not affected.
+#define LOG_THROTTLE_MAX_LEVEL 3
+#define LOG_THROTTLE_MAX_PERIOD M2T(100)
+#define LOG_THROTTLE_HIGH_PERCENT 75
+#define LOG_THROTTLE_LOW_PERCENT 25
+#define LOG_THROTTLE_UP_INTERVAL M2T(100)
+#define LOG_THROTTLE_DOWN_INTERVAL M2T(1000)
+
+typedef enum {
+  logEncoding_full = 0,
+  logEncoding_changedOnly = 1,
+} logEncoding_t;
+
+// Triggered blocks, see triggerSample()
+#define LOG_MAX_TRIGGERS 4
+#define LOG_TRIGGER_HISTORY_LEN 8
+
+typedef enum {
+  logTrigger_none = 0,
+  logTrigger_event = 1,
+  logTrigger_above = 2,
+  logTrigger_below = 3,
+  logTrigger_changed = 4,
+} logTriggerType_t;
+
+// Stabilizer synchronous blocks, see logStabilizerStep()
+#define LOG_MAX_SYNC_BLOCKS 4
+
+struct log_trigger_sample {
+  uint32_t timestamp;
+  uint8_t size;
+  uint8_t data[LOG_MAX_LEN];
+};
+
+struct log_trigger {
+  struct log_block * block;
+  uint8_t type;
+  // Eventtrigger id or index of the watched variable in the block
+  uint16_t source;
+  float threshold;
+  TickType_t minInterval;
+  TickType_t lastFired;
+  bool hasFired;
+  // Watched variable state at the previous sample
+  float lastValue;
+  bool hasLastValue;
+  volatile bool eventPending;
+  // Pre-trigger ring buffer
+  uint8_t historyLen;
+  uint8_t historyCount;
+  uint8_t historyHead;
+  struct log_trigger_sample history[LOG_TRIGGER_HISTORY_LEN];
+};
+
+struct log_sync {
+  struct log_block * block;
+  // Sampled every divisor stabilizer steps
+  uint16_t divisor;
+  // Sample waiting to be sent by the scheduler
+  volatile bool isPending;
+  // Stabilizer step, or time for blocks with microsecond timestamps
+  uint32_t timestamp;
+  CRTPPacket pk;
+};
+
+/* Log packet parameters storage. The ops of every block are stored
+ * contiguously in the logOps arena, which is kept packed. */
+#define LOG_MAX_OPS CONFIG_LOG_MAX_OPS
+#define LOG_MAX_BLOCKS CONFIG_LOG_MAX_BLOCKS
 struct log_ops {
-  struct log_ops * next;
+  void * variable;
   uint8_t storageType : 4;
   uint8_t logType     : 4;
-  void * variable;
-  acquisitionType_t acquisitionType;
+  uint8_t acquisitionType;
+  // Copy plan, see blockCompile(). Set on the first op of a run of adjacent
+  // memory variables that do not need conversion, 0 for converting ops.
+  uint8_t runOps;
+  uint8_t runLength;
 };
 
 struct log_block {
   int id;
-  xTimerHandle timer;
-  StaticTimer_t timerBuffer;
+  // Scheduling, see logSchedulerTask()
+  TickType_t period;
+  // Period used by the scheduler, longer than period when throttled
+  TickType_t effectivePeriod;
+  TickType_t deadline;
+  struct log_block * schedNext;
   uint32_t droppedPackets;
-  struct log_ops * ops;
+  // Sampling cost in cycles
+  uint32_t sampleCycles;
+  uint32_t sampleCyclesMax;
+  // Ops of the block in the logOps arena
+  uint16_t opsStart;
+  uint16_t opsCount;
+  // Lazy groups used by the block, see logLazyGroupMask()
+  uint32_t lazyGroups;
+  bool isRunning;
+  // Number of samples sent per packet, 1 for normal blocks
+  uint8_t batchSize;
+  uint8_t batchSamples;
+  uint8_t batchLen;
+  uint32_t batchTimestamp;
+  // Changed-only encoding, see encodeChangedOnly()
+  uint8_t encoding;
+  uint8_t keyframeInterval;
+  uint8_t keyframeCountdown;
+  // Timestamp format, see logSetBlockTimestamp()
+  uint8_t timestampFormat;
+  union {
+    uint8_t batchData[LOG_MAX_LEN];
+    // Last sampled values, for changed-only blocks
+    uint8_t lastData[LOG_MAX_LEN];
+  };
+  // Set for triggered blocks
+  struct log_trigger * trigger;
+  // Set for stabilizer synchronous blocks
+  struct log_sync * sync;
 };
 
 NO_DMA_CCM_SAFE_ZERO_INIT static struct log_ops logOps[LOG_MAX_OPS];
+static uint16_t logOpsUsed;
 NO_DMA_CCM_SAFE_ZERO_INIT static struct log_block logBlocks[LOG_MAX_BLOCKS];
+NO_DMA_CCM_SAFE_ZERO_INIT static struct log_trigger logTriggers[LOG_MAX_TRIGGERS];
+NO_DMA_CCM_SAFE_ZERO_INIT static struct log_sync logSyncs[LOG_MAX_SYNC_BLOCKS];
+static volatile uint8_t logSyncCount;
 static xSemaphoreHandle logLock;
 static StaticSemaphore_t logLockBuffer;
 
+// Running blocks in deadline order
+static struct log_block * schedHead;
+static TaskHandle_t schedTaskHandle;
+
+// Scheduler statistics
+static uint32_t schedJitter;
+static uint32_t schedJitterMax;
+static uint32_t schedOverruns;
+static uint32_t schedDroppedPackets;
+static uint32_t schedWorkerOverflows;
+static uint32_t syncBusy;
+static uint32_t syncOverruns;
+
+// Function backed variables evaluation cache, see acquireByFunction()
+static uint32_t evalPass = 1;
+static uint32_t evalCalls;
+static uint32_t evalCacheHits;
+
+// Throttling state
+static uint8_t throttleLevel;
+static TickType_t throttleLastChange;
+static uint32_t throttleIncreases;
+
 struct ops_setting {
     uint8_t logType;
     uint8_t id;
@@ -125,6 +281,18 @@ struct control_start_block_v2 {
   uint16_t period_in_ms;
 } __attribute__((packed));
 
+struct control_start_block_sync {
+  uint16_t divisor;
+} __attribute__((packed));
+
+struct control_set_block_trigger {
+  uint8_t type;
+  uint16_t source;
+  float threshold;
+  uint16_t minIntervalMs;
+  uint8_t historyLen;
+} __attribute__((packed));
+
 #define TOC_CH      0
 #define CONTROL_CH  1
 #define LOG_CH      2
@@ -143,16 +311,22 @@ struct control_start_block_v2 {
 #define CONTROL_CREATE_BLOCK_V2 6
 #define CONTROL_APPEND_BLOCK_V2 7
 #define CONTROL_START_BLOCK_V2  8
+#define CONTROL_CREATE_BLOCK_BATCHED 9
+#define CONTROL_SET_BLOCK_ENCODING 10
+#define CONTROL_GET_BLOCK_STATS 11
+#define CONTROL_SET_BLOCK_TRIGGER 12
+#define CONTROL_START_BLOCK_SYNC 13
+#define CONTROL_SET_BLOCK_TIMESTAMP 14
 
 #define BLOCK_ID_FREE -1
 
 //Private functions
 static void logTask(void * prm);
+static void logSchedulerTask(void * prm);
 static void logTOCProcess(int command);
 static void logControlProcess(void);
 
 void logRunBlock(void * arg);
-void logBlockTimed(xTimerHandle timer);
 
 //These are set by the Linker
 extern struct log_s _log_start;
@@ -168,18 +342,51 @@ static CRTPPacket p;
 
 static bool isInit = false;
 
+// Index of the log variables by group and name, see logGetVarId(). Large enough
+// for the full TOC, logGetVarId() falls back to a linear search otherwise.
+#define LOG_NAME_INDEX_SIZE 1024
+NO_DMA_CCM_SAFE_ZERO_INIT static tocIndexSlot_t logNameIndexSlots[LOG_NAME_INDEX_SIZE];
+static tocIndex_t logNameIndex;
+static bool logNameIndexIsValid = false;
+static void logNameIndexBuild(void);
+
+// The whole TOC serialized for clients, read through the memory subsystem
+static tocBlob_t logTocBlob;
+static uint8_t logTocBlobEncode(const int index, uint8_t* buffer);
+static uint32_t handleMemGetSize(void) { return tocBlobGetSize(&logTocBlob); }
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer);
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_LOG_TOC,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+
+static logLazyGroup_t* lazyGroups[LOG_LAZY_GROUPS_MAX];
+static uint8_t lazyGroupsCount = 0;
+static uint32_t directConsumerLazyGroups = 0;
+
 /* Log management functions */
 static int logAppendBlock(int id, struct ops_setting * settings, int len);
 static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len);
 static int logCreateBlock(unsigned char id, struct ops_setting * settings, int len);
 static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings, int len);
+static int logCreateBlockBatched(unsigned char id, uint8_t batchSize, struct ops_setting_v2 * settings, int len);
 static int logDeleteBlock(int id);
+static int logSetBlockEncoding(int id, uint8_t encoding, uint8_t keyframeInterval);
+static int logSetBlockTrigger(int id, const struct control_set_block_trigger * args);
+static int logSetBlockTimestamp(int id, uint8_t format);
+static void logEventtriggerCallback(const eventtriggerRecord * record);
 static int logStartBlock(int id, unsigned int period);
+static int logStartBlockSync(int id, uint16_t divisor);
+static void syncRelease(struct log_block * block);
 static int logStopBlock(int id);
+static struct log_block * logFindBlock(int id);
 static void logReset();
 static acquisitionType_t acquisitionTypeFromLogType(uint8_t logType);
 
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(logTask, LOG_TASK_STACKSIZE);
+STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(logSchedulerTask, LOG_SCHED_TASK_STACKSIZE);
 
 void logInit(void)
 {
@@ -220,6 +427,8 @@ void logInit(void)
     logsCrc = crc32CalculateBuffer(p.data, len);
   }
 
+  logNameIndexBuild();
+
   // Big lock that protects the log datastructures
   logLock = xSemaphoreCreateMutexStatic(&logLockBuffer);
 
@@ -229,6 +438,9 @@ void logInit(void)
       logsCount++;
   }
 
+  tocBlobInit(&logTocBlob, logsLen, logsCount, logsCrc, logTocBlobEncode);
+  memoryRegisterHandler(&memDef);
+
   //Manually free all log blocks
   for(i=0; i<LOG_MAX_BLOCKS; i++)
     logBlocks[i].id = BLOCK_ID_FREE;
@@ -238,6 +450,9 @@ void logInit(void)
 
   //Start the log task
   STATIC_MEM_TASK_CREATE(logTask, logTask, LOG_TASK_NAME, NULL, LOG_TASK_PRI);
+  schedTaskHandle = STATIC_MEM_TASK_CREATE(logSchedulerTask, logSchedulerTask, LOG_SCHED_TASK_NAME, NULL, LOG_SCHED_TASK_PRI);
+
+  eventtriggerRegisterCallback(eventtriggerHandler_Log, logEventtriggerCallback);
 
   isInit = true;
 }
@@ -286,8 +501,8 @@ void logTOCProcess(int command)
       p.data[1]=255;
     }
     memcpy(&p.data[2], &logsCrc, 4);
-    p.data[6]=LOG_MAX_BLOCKS;
-    p.data[7]=LOG_MAX_OPS;
+    p.data[6]=(LOG_MAX_BLOCKS < 255) ? LOG_MAX_BLOCKS : 255;
+    p.data[7]=(LOG_MAX_OPS < 255) ? LOG_MAX_OPS : 255;
     crtpSendPacketBlock(&p);
     break;
   case CMD_GET_ITEM:  //Get log variable
@@ -334,12 +549,17 @@ void logTOCProcess(int command)
     ptr = 0;
     group = "";
     p.header=CRTP_HEADER(CRTP_PORT_LOG, TOC_CH);
-    p.size=9;
+    p.size=11;
     p.data[0]=CMD_GET_INFO_V2;
     memcpy(&p.data[1], &logsCount, 2);
     memcpy(&p.data[3], &logsCrc, 4);
-    p.data[7]=LOG_MAX_BLOCKS;
-    p.data[8]=LOG_MAX_OPS;
+    p.data[7]=(LOG_MAX_BLOCKS < 255) ? LOG_MAX_BLOCKS : 255;
+    p.data[8]=(LOG_MAX_OPS < 255) ? LOG_MAX_OPS : 255;
+    // Full number of ops, the ops limit is configurable and may exceed 255
+    {
+      uint16_t maxOps = LOG_MAX_OPS;
+      memcpy(&p.data[9], &maxOps, 2);
+    }
     crtpSendPacketBlock(&p);
     break;
   case CMD_GET_ITEM_V2:  //Get log variable
@@ -430,11 +650,51 @@ void logControlProcess()
         ret = logStartBlock(p.data[1], args->period_in_ms);
       }
       break;
+    case CONTROL_CREATE_BLOCK_BATCHED:
+      ret = logCreateBlockBatched( p.data[1], p.data[2],
+                            (struct ops_setting_v2*)&p.data[3],
+                            (p.size-3)/sizeof(struct ops_setting_v2) );
+      break;
+    case CONTROL_SET_BLOCK_ENCODING:
+      ret = logSetBlockEncoding( p.data[1], p.data[2], p.data[3] );
+      break;
+    case CONTROL_GET_BLOCK_STATS:
+      ret = logFindBlock(p.data[1]) ? 0 : ENOENT;
+      break;
+    case CONTROL_SET_BLOCK_TRIGGER:
+      if (p.size >= 2 + sizeof(struct control_set_block_trigger))
+        ret = logSetBlockTrigger(p.data[1], (struct control_set_block_trigger *)&p.data[2]);
+      else
+        ret = EINVAL;
+      break;
+    case CONTROL_START_BLOCK_SYNC:
+      if (p.size >= 2 + sizeof(struct control_start_block_sync))
+      {
+        struct control_start_block_sync* args = (struct control_start_block_sync *)&p.data[2];
+        ret = logStartBlockSync(p.data[1], args->divisor);
+      }
+      else
+        ret = EINVAL;
+      break;
+    case CONTROL_SET_BLOCK_TIMESTAMP:
+      ret = logSetBlockTimestamp( p.data[1], p.data[2] );
+      break;
   }
 
   //Commands answer
   p.data[2] = ret;
   p.size = 3;
+
+  if (p.data[0] == CONTROL_GET_BLOCK_STATS && ret == 0)
+  {
+    const struct log_block * block = logFindBlock(p.data[1]);
+    memcpy(&p.data[3], &block->sampleCycles, 4);
+    memcpy(&p.data[7], &block->sampleCyclesMax, 4);
+    const uint16_t effectivePeriodMs = T2M(block->effectivePeriod);
+    memcpy(&p.data[11], &effectivePeriodMs, 2);
+    p.size = 13;
+  }
+
   crtpSendPacketBlock(&p);
 }
 
@@ -452,15 +712,17 @@ static int logCreateBlock(unsigned char id, struct ops_setting * settings, int l
     return ENOMEM;
 
   logBlocks[i].id = id;
-  logBlocks[i].timer = xTimerCreateStatic("logTimer", M2T(1000), pdTRUE,
-    &logBlocks[i], logBlockTimed, &logBlocks[i].timerBuffer);
-  logBlocks[i].ops = NULL;
-
-  if (logBlocks[i].timer == NULL)
-  {
-	logBlocks[i].id = BLOCK_ID_FREE;
-	return ENOMEM;
-  }
+  logBlocks[i].opsStart = logOpsUsed;
+  logBlocks[i].opsCount = 0;
+  logBlocks[i].sampleCycles = 0;
+  logBlocks[i].sampleCyclesMax = 0;
+  logBlocks[i].trigger = NULL;
+  logBlocks[i].lazyGroups = 0;
+  logBlocks[i].isRunning = false;
+  logBlocks[i].batchSize = 1;
+  logBlocks[i].batchSamples = 0;
+  logBlocks[i].encoding = logEncoding_full;
+  logBlocks[i].timestampFormat = logTimestamp_ms;
 
   LOG_DEBUG("Added block ID %d\n", id);
 
@@ -481,25 +743,51 @@ static int logCreateBlockV2(unsigned char id, struct ops_setting_v2 * settings,
     return ENOMEM;
 
   logBlocks[i].id = id;
-  logBlocks[i].timer = xTimerCreateStatic("logTimer", M2T(1000), pdTRUE,
-    &logBlocks[i], logBlockTimed, &logBlocks[i].timerBuffer);
-  logBlocks[i].ops = NULL;
-
-  if (logBlocks[i].timer == NULL)
-  {
-  logBlocks[i].id = BLOCK_ID_FREE;
-  return ENOMEM;
-  }
+  logBlocks[i].opsStart = logOpsUsed;
+  logBlocks[i].opsCount = 0;
+  logBlocks[i].sampleCycles = 0;
+  logBlocks[i].sampleCyclesMax = 0;
+  logBlocks[i].trigger = NULL;
+  logBlocks[i].lazyGroups = 0;
+  logBlocks[i].isRunning = false;
+  logBlocks[i].batchSize = 1;
+  logBlocks[i].batchSamples = 0;
+  logBlocks[i].encoding = logEncoding_full;
+  logBlocks[i].timestampFormat = logTimestamp_ms;
 
   LOG_DEBUG("Added block ID %d\n", id);
 
   return logAppendBlockV2(id, settings, len);
 }
 
+static int logCreateBlockBatched(unsigned char id, uint8_t batchSize, struct ops_setting_v2 * settings, int len)
+{
+  // At least two samples, each one carrying its time delta and one byte of data
+  if (batchSize < 2 || batchSize * (LOG_BATCH_DELTA_LEN + 1) > LOG_MAX_LEN)
+    return EINVAL;
+
+  int ret = logCreateBlockV2(id, NULL, 0);
+  if (ret != 0)
+    return ret;
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) logBlocks[i].batchSize = batchSize;
+
+  ret = logAppendBlockV2(id, settings, len);
+  if (ret != 0)
+    logDeleteBlock(id);
+
+  return ret;
+}
+
 static int blockCalcLength(struct log_block * block);
-static struct log_ops * opsMalloc();
-static void opsFree(struct log_ops * ops);
-static void blockAppendOps(struct log_block * block, struct log_ops * ops);
+static int blockCalcOpsCount(struct log_block * block);
+static int blockHeaderLen(const struct log_block * block);
+static uint32_t blockMaxBatchSpan(const struct log_block * block);
+static bool blockFits(struct log_block * block, int length, int opsCount);
+static struct log_ops * opsInsert(struct log_block * block);
+static void opsRelease(struct log_block * block);
+static void blockCompile(struct log_block * block);
 static int variableGetIndex(int id);
 
 static int logAppendBlock(int id, struct ops_setting * settings, int len)
@@ -522,21 +810,16 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
   for (i=0; i<len; i++)
   {
     int currentLength = blockCalcLength(block);
+    int currentOpsCount = blockCalcOpsCount(block);
     struct log_ops * ops;
     int varId;
 
-    if ((currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK])>LOG_MAX_LEN) {
+    if (!blockFits(block, currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK], currentOpsCount + 1)) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
       return E2BIG;
     }
 
-    ops = opsMalloc();
-
-    if(!ops) {
-      LOG_ERROR("No more ops memory free!\n");
-      return ENOMEM;
-    }
-
+    varId = -1;
     if (settings[i].id != 255)  //TOC variable
     {
       varId = variableGetIndex(settings[i].id);
@@ -545,11 +828,22 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
         LOG_ERROR("Trying to add variable Id %d that does not exists.", settings[i].id);
         return ENOENT;
       }
+    }
+
+    ops = opsInsert(block);
+
+    if(!ops) {
+      LOG_ERROR("No more ops memory free!\n");
+      return ENOMEM;
+    }
 
+    if (varId >= 0)  //TOC variable
+    {
       ops->variable    = logs[varId].address;
       ops->storageType = logGetType(varId);
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
       ops->acquisitionType = acquisitionTypeFromLogType(logs[varId].type);
+      block->lazyGroups |= logLazyGroupMask(varId);
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
@@ -562,7 +856,7 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
 
       LOG_DEBUG("Appended var addr 0x%x to block %d\n", (int)ops->variable, id);
     }
-    blockAppendOps(block, ops);
+    blockCompile(block);
 
     LOG_DEBUG("   Now lenght %d\n", blockCalcLength(block));
   }
@@ -590,21 +884,16 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
   for (i=0; i<len; i++)
   {
     int currentLength = blockCalcLength(block);
+    int currentOpsCount = blockCalcOpsCount(block);
     struct log_ops * ops;
     int varId;
 
-    if ((currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK])>LOG_MAX_LEN) {
+    if (!blockFits(block, currentLength + typeLength[settings[i].logType & LOG_TYPE_MASK], currentOpsCount + 1)) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
       return E2BIG;
     }
 
-    ops = opsMalloc();
-
-    if(!ops) {
-      LOG_ERROR("No more ops memory free!\n");
-      return ENOMEM;
-    }
-
+    varId = -1;
     if (settings[i].id != 0xFFFFul)  //TOC variable
     {
       varId = variableGetIndex(settings[i].id);
@@ -613,11 +902,22 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
         LOG_ERROR("Trying to add variable Id %d that does not exists.", settings[i].id);
         return ENOENT;
       }
+    }
 
+    ops = opsInsert(block);
+
+    if(!ops) {
+      LOG_ERROR("No more ops memory free!\n");
+      return ENOMEM;
+    }
+
+    if (varId >= 0)  //TOC variable
+    {
       ops->variable    = logs[varId].address;
       ops->storageType = logGetType(varId);
       ops->logType     = settings[i].logType & LOG_TYPE_MASK;
       ops->acquisitionType = acquisitionTypeFromLogType(logs[varId].type);
+      block->lazyGroups |= logLazyGroupMask(varId);
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
@@ -630,7 +930,7 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
 
       LOG_DEBUG("Appended var addr 0x%x to block %d\n", (int)ops->variable, id);
     }
-    blockAppendOps(block, ops);
+    blockCompile(block);
 
     LOG_DEBUG("   Now lenght %d\n", blockCalcLength(block));
   }
@@ -638,11 +938,35 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
   return 0;
 }
 
+/* Inserts a block in the deadline ordered list of running blocks */
+static void schedInsert(struct log_block * block)
+{
+  struct log_block ** next = &schedHead;
+
+  while (*next && (int32_t)((*next)->deadline - block->deadline) <= 0)
+    next = &(*next)->schedNext;
+
+  block->schedNext = *next;
+  *next = block;
+}
+
+static void schedRemove(struct log_block * block)
+{
+  for (struct log_block ** next = &schedHead; *next; next = &(*next)->schedNext)
+  {
+    if (*next == block)
+    {
+      *next = block->schedNext;
+      break;
+    }
+  }
+
+  block->schedNext = NULL;
+}
+
 static int logDeleteBlock(int id)
 {
   int i;
-  struct log_ops * ops;
-  struct log_ops * opsNext;
 
   for (i=0; i<LOG_MAX_BLOCKS; i++)
     if (logBlocks[i].id == id) break;
@@ -652,24 +976,161 @@ static int logDeleteBlock(int id)
     return ENOENT;
   }
 
-  ops = logBlocks[i].ops;
-  while (ops)
-  {
-    opsNext = ops->next;
-    opsFree(ops);
-    ops = opsNext;
-  }
+  opsRelease(&logBlocks[i]);
 
-  if (logBlocks[i].timer != 0) {
-    xTimerStop(logBlocks[i].timer, portMAX_DELAY);
-    xTimerDelete(logBlocks[i].timer, portMAX_DELAY);
-    logBlocks[i].timer = 0;
+  if (logBlocks[i].trigger) {
+    logBlocks[i].trigger->block = NULL;
+    logBlocks[i].trigger = NULL;
   }
 
+  if (logBlocks[i].sync)
+    syncRelease(&logBlocks[i]);
+  else if (logBlocks[i].isRunning)
+    schedRemove(&logBlocks[i]);
+
   logBlocks[i].id = BLOCK_ID_FREE;
+  logBlocks[i].lazyGroups = 0;
+  logBlocks[i].isRunning = false;
+  return 0;
+}
+
+static int logSetBlockEncoding(int id, uint8_t encoding, uint8_t keyframeInterval)
+{
+  int i;
+
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) break;
+
+  if (i >= LOG_MAX_BLOCKS) {
+    LOG_ERROR("Trying to set encoding of block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  struct log_block * block = &logBlocks[i];
+
+  if (encoding != logEncoding_full && encoding != logEncoding_changedOnly)
+    return EINVAL;
+
+  // Batched and triggered blocks do not support changed-only encoding
+  if (encoding == logEncoding_changedOnly && (block->batchSize > 1 || block->trigger))
+    return EINVAL;
+
+  const uint8_t previousEncoding = block->encoding;
+  block->encoding = encoding;
+  if (!blockFits(block, blockCalcLength(block), blockCalcOpsCount(block))) {
+    block->encoding = previousEncoding;
+    return E2BIG;
+  }
+
+  block->keyframeInterval = keyframeInterval ? keyframeInterval : LOG_KEYFRAME_INTERVAL_DEFAULT;
+  block->keyframeCountdown = 0;
+
+  return 0;
+}
+
+/* Selects between the 3 bytes ms tick timestamp and a 4 bytes microsecond
+ * timestamp from usecTimestamp() in the log data packets of a block. The
+ * block must still fit, the microsecond header uses one byte of payload. */
+static int logSetBlockTimestamp(int id, uint8_t format)
+{
+  struct log_block * block = logFindBlock(id);
+
+  if (!block) {
+    LOG_ERROR("Trying to set timestamp of block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  if (format != logTimestamp_ms && format != logTimestamp_us)
+    return EINVAL;
+
+  // Not while running, the batch time span was checked for the old format
+  if (block->isRunning)
+    return EBUSY;
+
+  const uint8_t previousFormat = block->timestampFormat;
+  block->timestampFormat = format;
+  if (!blockFits(block, blockCalcLength(block), blockCalcOpsCount(block))) {
+    block->timestampFormat = previousFormat;
+    return E2BIG;
+  }
+
+  block->batchSamples = 0;
+
+  return 0;
+}
+
+static int logSetBlockTrigger(int id, const struct control_set_block_trigger * args)
+{
+  struct log_block * block = logFindBlock(id);
+
+  if (!block) {
+    LOG_ERROR("Trying to set trigger of block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  if (args->type == logTrigger_none) {
+    if (block->trigger) {
+      block->trigger->block = NULL;
+      block->trigger = NULL;
+    }
+    return 0;
+  }
+
+  if (args->type > logTrigger_changed || args->historyLen > LOG_TRIGGER_HISTORY_LEN)
+    return EINVAL;
+
+  // Variable triggers watch one of the variables of the block
+  if (args->type != logTrigger_event && args->source >= block->opsCount)
+    return EINVAL;
+
+  if (block->batchSize > 1 || block->encoding != logEncoding_full || block->sync)
+    return EINVAL;
+
+  struct log_trigger * trigger = block->trigger;
+  for (int i = 0; !trigger && i < LOG_MAX_TRIGGERS; i++)
+    if (logTriggers[i].block == NULL) trigger = &logTriggers[i];
+
+  if (!trigger)
+    return ENOMEM;
+
+  // Detach while updating, the eventtrigger callback does not take the lock
+  trigger->block = NULL;
+  trigger->type = args->type;
+  trigger->source = args->source;
+  trigger->threshold = args->threshold;
+  trigger->minInterval = M2T(args->minIntervalMs);
+  trigger->hasFired = false;
+  trigger->hasLastValue = false;
+  trigger->eventPending = false;
+  trigger->historyLen = args->historyLen;
+  trigger->historyCount = 0;
+  trigger->historyHead = 0;
+  trigger->block = block;
+  block->trigger = trigger;
+
   return 0;
 }
 
+/* Called from the eventtrigger task. Only flags the triggers and wakes up the
+ * scheduler. */
+static void logEventtriggerCallback(const eventtriggerRecord * record)
+{
+  const uint16_t eventId = eventtriggerGetId(record->event);
+  bool isPending = false;
+
+  for (int i = 0; i < LOG_MAX_TRIGGERS; i++)
+  {
+    if (logTriggers[i].block && logTriggers[i].type == logTrigger_event && logTriggers[i].source == eventId)
+    {
+      logTriggers[i].eventPending = true;
+      isPending = true;
+    }
+  }
+
+  if (isPending)
+    xTaskNotifyGive(schedTaskHandle);
+}
+
 static int logStartBlock(int id, unsigned int period)
 {
   int i;
@@ -684,13 +1145,38 @@ static int logStartBlock(int id, unsigned int period)
 
   LOG_DEBUG("Starting block %d with period %dms\n", id, period);
 
+  logBlocks[i].batchSamples = 0;
+  logBlocks[i].keyframeCountdown = 0;
+  if (logBlocks[i].trigger)
+  {
+    logBlocks[i].trigger->historyCount = 0;
+    logBlocks[i].trigger->hasLastValue = false;
+  }
+
   if (period>0)
   {
-    xTimerChangePeriod(logBlocks[i].timer, M2T(period), 100);
-    xTimerStart(logBlocks[i].timer, 100);
+    // The time deltas of a batch must fit in their bytes
+    if (period * (logBlocks[i].batchSize - 1) > blockMaxBatchSpan(&logBlocks[i]))
+      return EINVAL;
+
+    if (logBlocks[i].sync)
+      syncRelease(&logBlocks[i]);
+    else if (logBlocks[i].isRunning)
+      schedRemove(&logBlocks[i]);
+
+    logBlocks[i].period = M2T(period);
+    logBlocks[i].effectivePeriod = logBlocks[i].period;
+    logBlocks[i].deadline = xTaskGetTickCount() + logBlocks[i].period;
+    logBlocks[i].isRunning = true;
+    schedInsert(&logBlocks[i]);
+
+    // Let the scheduler recompute its next wakeup
+    xTaskNotifyGive(schedTaskHandle);
   } else {
     // single-shoot run
-    workerSchedule(logRunBlock, &logBlocks[i]);
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_HIGH, .coalesce = true};
+    if (workerScheduleWithOptions(logRunBlock, &logBlocks[i], &options) != 0)
+      schedWorkerOverflows++;
   }
 
   return 0;
@@ -708,175 +1194,727 @@ static int logStopBlock(int id)
     return ENOENT;
   }
 
-  xTimerStop(logBlocks[i].timer, portMAX_DELAY);
+  if (logBlocks[i].sync)
+    syncRelease(&logBlocks[i]);
+  else if (logBlocks[i].isRunning)
+    schedRemove(&logBlocks[i]);
+  logBlocks[i].isRunning = false;
+
+  return 0;
+}
+
+/* Starts a block that is sampled by the stabilizer, see logStabilizerStep().
+ * The timestamp of its packets is the stabilizer step instead of the time, and
+ * batch deltas are in stabilizer steps. */
+static int logStartBlockSync(int id, uint16_t divisor)
+{
+  struct log_block * block = logFindBlock(id);
+
+  if (!block) {
+    LOG_ERROR("Trying to start block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  if (divisor == 0 || block->trigger)
+    return EINVAL;
+
+  // The stabilizer runs at 1 kHz, a step is a ms
+  if ((uint32_t)divisor * (block->batchSize - 1) > blockMaxBatchSpan(block))
+    return EINVAL;
+
+  struct log_sync * sync = block->sync;
+  for (int i = 0; !sync && i < LOG_MAX_SYNC_BLOCKS; i++)
+    if (logSyncs[i].block == NULL) sync = &logSyncs[i];
+
+  if (!sync)
+    return ENOMEM;
+
+  if (block->isRunning && !block->sync)
+    schedRemove(block);
+
+  block->batchSamples = 0;
+  block->keyframeCountdown = 0;
+  block->effectivePeriod = 0;
+
+  sync->divisor = divisor;
+  sync->isPending = false;
+  if (!block->sync)
+    logSyncCount++;
+  sync->block = block;
+  block->sync = sync;
+  block->isRunning = true;
 
   return 0;
 }
 
-/* This function is called by the timer subsystem */
-void logBlockTimed(xTimerHandle timer)
+static void syncRelease(struct log_block * block)
 {
-  workerSchedule(logRunBlock, pvTimerGetTimerID(timer));
+  block->sync->block = NULL;
+  block->sync->isPending = false;
+  block->sync = NULL;
+  logSyncCount--;
 }
 
-/* Appends data to a packet if space is available; returns false on failure. */
-static bool appendToPacket(CRTPPacket * pk, const void * data, size_t n) {
-  if (pk->size <= CRTP_MAX_DATA_SIZE - n)
+/* Raises the throttle level when the log TX queue fills up, and lowers it
+ * again, more slowly, once the queue has drained. The queue backs up when the
+ * link can not keep up, for instance when the radio link degrades. */
+static void logThrottleUpdate(const TickType_t now)
+{
+  const int size = crtpGetTxQueueSizeForPort(CRTP_PORT_LOG);
+  const int used = size - crtpGetFreeTxQueuePacketsForPort(CRTP_PORT_LOG);
+  const int occupancy = (size > 0) ? (100 * used) / size : 0;
+  const TickType_t sinceChange = now - throttleLastChange;
+
+  if (occupancy >= LOG_THROTTLE_HIGH_PERCENT && throttleLevel < LOG_THROTTLE_MAX_LEVEL &&
+      sinceChange >= LOG_THROTTLE_UP_INTERVAL)
   {
-    memcpy(&pk->data[pk->size], data, n);
-    pk->size += n;
-    return true;
+    throttleLevel++;
+    throttleIncreases++;
+    throttleLastChange = now;
+  }
+  else if (occupancy <= LOG_THROTTLE_LOW_PERCENT && throttleLevel > 0 &&
+           sinceChange >= LOG_THROTTLE_DOWN_INTERVAL)
+  {
+    throttleLevel--;
+    throttleLastChange = now;
   }
-  else return false;
 }
 
-/* This function is usually called by the worker subsystem */
-void logRunBlock(void * arg)
+/* Period to use for the next sample of a block given the throttle level.
+ * Triggered and batched blocks are never stretched, the former are already
+ * rate limited and the latter would overflow their time deltas. */
+static TickType_t logEffectivePeriod(const struct log_block * block)
 {
-  struct log_block *blk = arg;
-  struct log_ops *ops = blk->ops;
-  static CRTPPacket pk;
-  unsigned int timestamp;
+  if (throttleLevel == 0 || block->trigger || block->batchSize > 1 ||
+      block->period >= LOG_THROTTLE_MAX_PERIOD)
+    return block->period;
 
-  xSemaphoreTake(logLock, portMAX_DELAY);
+  const TickType_t stretched = block->period << throttleLevel;
+  return (stretched < LOG_THROTTLE_MAX_PERIOD) ? stretched : LOG_THROTTLE_MAX_PERIOD;
+}
 
-  timestamp = ((long long)xTaskGetTickCount())/portTICK_RATE_MS;
+static void logSendSync(struct log_sync * sync);
+static void runBlock(struct log_block * blk, bool isNewPass);
 
-  pk.header = CRTP_HEADER(CRTP_PORT_LOG, LOG_CH);
-  pk.size = 4;
-  pk.data[0] = blk->id;
-  pk.data[1] = timestamp&0x0ff;
-  pk.data[2] = (timestamp>>8)&0x0ff;
-  pk.data[3] = (timestamp>>16)&0x0ff;
+/* Samples all the blocks that are due and sleeps until the next deadline.
+ * Replaces one timer per block, all blocks due in the same tick are run in
+ * the same wakeup. */
+static void logSchedulerTask(void * prm)
+{
+  struct log_block * due[LOG_MAX_BLOCKS];
 
-  while (ops)
+  while(1)
   {
-    int valuei = 0;
-    float valuef = 0;
+    int dueCount = 0;
+    TickType_t wait = portMAX_DELAY;
 
-    // FPU instructions must run on aligned data.
-    // We first copy the data to an (aligned) local variable, before assigning it
-    switch(ops->storageType)
-    {
-      case LOG_UINT8:
-      {
-        uint8_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt8);
-          v = logByFunction->acquireUInt8(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT8:
-      {
-        int8_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt8);
-          v = logByFunction->acquireInt8(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_UINT16:
-      {
-        uint16_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt16);
-          v = logByFunction->acquireUInt16(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT16:
-      {
-        int16_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt16);
-          v = logByFunction->acquireInt16(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_UINT32:
-      {
-        uint32_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt32);
-          v = logByFunction->acquireUInt32(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_INT32:
-      {
-        int32_t v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt32);
-          v = logByFunction->acquireInt32(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(v));
-        }
-        valuei = v;
-        break;
-      }
-      case LOG_FLOAT:
-      {
-        float v;
-        if (ops->acquisitionType == acqType_function) {
-          logByFunction_t* logByFunction = (logByFunction_t*)ops->variable;
-          ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->aquireFloat);
-          v = logByFunction->aquireFloat(timestamp, logByFunction->data);
-        } else {
-          memcpy(&v, ops->variable, sizeof(valuef));
-        }
-        valuei = v;
-        valuef = v;
-        break;
-      }
-    }
+    xSemaphoreTake(logLock, portMAX_DELAY);
+    const TickType_t now = xTaskGetTickCount();
 
-    if (ops->logType == LOG_FLOAT || ops->logType == LOG_FP16)
+    logThrottleUpdate(now);
+
+    // Event triggered blocks are sampled right away
+    for (int i = 0; i < LOG_MAX_TRIGGERS; i++)
+      if (logTriggers[i].block && logTriggers[i].eventPending && logTriggers[i].block->isRunning)
+        due[dueCount++] = logTriggers[i].block;
+    const int triggeredCount = dueCount;
+
+    while (schedHead && (int32_t)(now - schedHead->deadline) >= 0)
     {
-      if (ops->storageType != LOG_FLOAT)
+      struct log_block * block = schedHead;
+      schedHead = block->schedNext;
+
+      const uint32_t lateness = now - block->deadline;
+      schedJitter = lateness;
+      if (lateness > schedJitterMax)
+        schedJitterMax = lateness;
+
+      block->effectivePeriod = logEffectivePeriod(block);
+      block->deadline += block->effectivePeriod;
+      if ((int32_t)(now - block->deadline) >= 0)
       {
-        valuef = valuei;
+        // A full period was missed, skip it instead of bursting
+        schedOverruns++;
+        block->deadline = now + block->effectivePeriod;
       }
 
-      // Try to append the next item to the packet.  If we run out of space,
+      schedInsert(block);
+
+      bool isDue = false;
+      for (int i = 0; i < triggeredCount; i++)
+        isDue = isDue || (due[i] == block);
+      if (!isDue)
+        due[dueCount++] = block;
+    }
+
+    if (schedHead)
+      wait = schedHead->deadline - now;
+    xSemaphoreGive(logLock);
+
+    // All the blocks due in this wakeup are one evaluation pass
+    for (int i = 0; i < dueCount; i++)
+      runBlock(due[i], i == 0);
+
+    for (int i = 0; i < LOG_MAX_SYNC_BLOCKS; i++)
+      if (logSyncs[i].isPending)
+        logSendSync(&logSyncs[i]);
+
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+static int blockHeaderLen(const struct log_block * block)
+{
+  return (block->timestampFormat == logTimestamp_us) ? LOG_HEADER_LEN_US : LOG_HEADER_LEN;
+}
+
+static int blockBatchDeltaLen(const struct log_block * block)
+{
+  return (block->timestampFormat == logTimestamp_us) ? LOG_BATCH_DELTA_LEN_US : LOG_BATCH_DELTA_LEN;
+}
+
+/* Longest time between the first and last sample of a batch, in ms */
+static uint32_t blockMaxBatchSpan(const struct log_block * block)
+{
+  return (block->timestampFormat == logTimestamp_us) ? LOG_BATCH_MAX_DELTA_US / 1000 : LOG_BATCH_MAX_DELTA;
+}
+
+/* Current time in the timestamp format of the block. The microsecond
+ * timestamp is the low 32 bits of usecTimestamp() and wraps around after
+ * about 71 minutes, the ms timestamp is sent as 24 bits and wraps around after
+ * about 4.6 hours. */
+static uint32_t blockTimestampNow(const struct log_block * block)
+{
+  if (block->timestampFormat == logTimestamp_us)
+    return (uint32_t)usecTimestamp();
+
+  return ((long long)xTaskGetTickCount())/portTICK_RATE_MS;
+}
+
+/* Writes the block id and timestamp of a log data packet, the packet size is
+ * set to the header length */
+static void blockWriteHeader(const struct log_block * block, CRTPPacket * pk, uint32_t timestamp)
+{
+  pk->data[0] = block->id;
+  pk->data[1] = timestamp&0x0ff;
+  pk->data[2] = (timestamp>>8)&0x0ff;
+  pk->data[3] = (timestamp>>16)&0x0ff;
+  if (block->timestampFormat == logTimestamp_us)
+    pk->data[4] = (timestamp>>24)&0x0ff;
+  pk->size = blockHeaderLen(block);
+}
+
+/* Value of a variable of the block from the sampled packet data */
+static float opValueFromPacket(const struct log_block * blk, int index, const uint8_t * data)
+{
+  int offset = 0;
+  for (int i = 0; i < index; i++)
+    offset += typeLength[logOps[blk->opsStart + i].logType];
+
+  const uint8_t * value = &data[offset];
+  switch (logOps[blk->opsStart + index].logType)
+  {
+    case LOG_UINT8:  { uint8_t v;  memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_INT8:   { int8_t v;   memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_UINT16: { uint16_t v; memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_INT16:  { int16_t v;  memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_UINT32: { uint32_t v; memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_INT32:  { int32_t v;  memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_FLOAT:  { float v;    memcpy(&v, value, sizeof(v)); return v; }
+    case LOG_FP16:   { uint16_t v; memcpy(&v, value, sizeof(v)); return half2single(v); }
+  }
+
+  return 0.0f;
+}
+
+/* Decides if a triggered block sends its sample. Samples that are not sent are
+ * kept in the pre-trigger ring buffer, which is sent before the triggering
+ * sample. Returns false if the packet should not be sent. */
+static bool triggerSample(struct log_block * blk, CRTPPacket * pk, unsigned int timestamp)
+{
+  struct log_trigger * trigger = blk->trigger;
+  bool fire = false;
+
+  if (trigger->type == logTrigger_event)
+  {
+    fire = trigger->eventPending;
+    trigger->eventPending = false;
+  }
+  else
+  {
+    const float value = opValueFromPacket(blk, trigger->source, &pk->data[blockHeaderLen(blk)]);
+
+    if (trigger->hasLastValue)
+    {
+      switch (trigger->type)
+      {
+        case logTrigger_above:
+          fire = trigger->lastValue <= trigger->threshold && value > trigger->threshold;
+          break;
+        case logTrigger_below:
+          fire = trigger->lastValue >= trigger->threshold && value < trigger->threshold;
+          break;
+        case logTrigger_changed:
+          fire = value != trigger->lastValue;
+          break;
+      }
+    }
+    trigger->lastValue = value;
+    trigger->hasLastValue = true;
+  }
+
+  const TickType_t now = xTaskGetTickCount();
+  if (fire && trigger->hasFired && (now - trigger->lastFired) < trigger->minInterval)
+    fire = false;
+
+  if (!fire)
+  {
+    if (trigger->historyLen > 0)
+    {
+      struct log_trigger_sample * sample = &trigger->history[trigger->historyHead];
+      sample->timestamp = timestamp;
+      sample->size = pk->size - blockHeaderLen(blk);
+      memcpy(sample->data, &pk->data[blockHeaderLen(blk)], sample->size);
+      trigger->historyHead = (trigger->historyHead + 1) % trigger->historyLen;
+      if (trigger->historyCount < trigger->historyLen)
+        trigger->historyCount++;
+    }
+    return false;
+  }
+
+  trigger->hasFired = true;
+  trigger->lastFired = now;
+
+  // Send the pre-trigger history, oldest first
+  static CRTPPacket historyPk;
+  historyPk.header = pk->header;
+  int index = trigger->historyHead - trigger->historyCount;
+  if (index < 0)
+    index += trigger->historyLen;
+  for (int i = 0; i < trigger->historyCount; i++)
+  {
+    const struct log_trigger_sample * sample = &trigger->history[index];
+    blockWriteHeader(blk, &historyPk, sample->timestamp);
+    memcpy(&historyPk.data[historyPk.size], sample->data, sample->size);
+    historyPk.size += sample->size;
+    if (!crtpSendPacket(&historyPk))
+      schedDroppedPackets++;
+    index = (index + 1) % trigger->historyLen;
+  }
+  trigger->historyCount = 0;
+
+  return true;
+}
+
+/* Appends data to a packet if space is available; returns false on failure. */
+static bool appendToPacket(CRTPPacket * pk, const void * data, size_t n) {
+  if (pk->size <= CRTP_MAX_DATA_SIZE - n)
+  {
+    memcpy(&pk->data[pk->size], data, n);
+    pk->size += n;
+    return true;
+  }
+  else return false;
+}
+
+/* Stores the sampled values of a packet in the block batch. Returns true when
+ * the batch is complete, the packet is then rewritten to hold all the samples. */
+static bool batchSample(struct log_block * blk, CRTPPacket * pk, unsigned int timestamp)
+{
+  const int headerLen = blockHeaderLen(blk);
+  const int deltaLen = blockBatchDeltaLen(blk);
+  const uint8_t sampleLen = pk->size - headerLen;
+
+  if (blk->batchSamples == 0)
+  {
+    blk->batchTimestamp = timestamp;
+    blk->batchLen = 0;
+  }
+
+  // Unsigned arithmetics, the delta is right across a timestamp wrap around
+  const uint32_t delta = (uint32_t)timestamp - blk->batchTimestamp;
+  if (blk->timestampFormat == logTimestamp_us)
+  {
+    const uint16_t deltaUs = (delta > LOG_BATCH_MAX_DELTA_US) ? LOG_BATCH_MAX_DELTA_US : delta;
+    memcpy(&blk->batchData[blk->batchLen], &deltaUs, sizeof(deltaUs));
+  }
+  else
+  {
+    blk->batchData[blk->batchLen] = (delta > LOG_BATCH_MAX_DELTA) ? LOG_BATCH_MAX_DELTA : delta;
+  }
+  memcpy(&blk->batchData[blk->batchLen + deltaLen], &pk->data[headerLen], sampleLen);
+  blk->batchLen += deltaLen + sampleLen;
+  blk->batchSamples++;
+
+  if (blk->batchSamples < blk->batchSize)
+    return false;
+
+  blockWriteHeader(blk, pk, blk->batchTimestamp);
+  memcpy(&pk->data[headerLen], blk->batchData, blk->batchLen);
+  pk->size = headerLen + blk->batchLen;
+  blk->batchSamples = 0;
+
+  return true;
+}
+
+/* Rewrites the sampled values of a packet to only contain the values that
+ * changed since the previous period, preceded by a presence bitmap with one bit
+ * per variable. Every keyframeInterval periods all the variables are sent.
+ * Returns false if the packet does not need to be sent. */
+static bool encodeChangedOnly(struct log_block * blk, CRTPPacket * pk)
+{
+  uint8_t encoded[LOG_MAX_LEN];
+  const int headerLen = blockHeaderLen(blk);
+  const int bitmapLen = (blockCalcOpsCount(blk) + 7) / 8;
+  const bool keyframe = (blk->keyframeCountdown == 0);
+  int encodedLen = bitmapLen;
+  int offset = 0;
+  int index = 0;
+
+  memset(encoded, 0, bitmapLen);
+
+  const struct log_ops * ops = &logOps[blk->opsStart];
+  for (; index < blk->opsCount; ops++, index++)
+  {
+    const int len = typeLength[ops->logType];
+    const uint8_t * value = &pk->data[headerLen + offset];
+
+    if (keyframe || memcmp(value, &blk->lastData[offset], len) != 0)
+    {
+      encoded[index / 8] |= 1 << (index % 8);
+      memcpy(&encoded[encodedLen], value, len);
+      encodedLen += len;
+    }
+    offset += len;
+  }
+
+  memcpy(blk->lastData, &pk->data[headerLen], offset);
+
+  if (keyframe)
+    blk->keyframeCountdown = blk->keyframeInterval;
+  blk->keyframeCountdown--;
+
+  // Nothing changed, the next keyframe will tell that the block is still alive
+  if (encodedLen == bitmapLen)
+    return false;
+
+  memcpy(&pk->data[headerLen], encoded, encodedLen);
+  pk->size = headerLen + encodedLen;
+
+  return true;
+}
+
+static void blockSend(struct log_block * blk, CRTPPacket * pk, unsigned int timestamp);
+
+static void evalPassNext(void)
+{
+  evalPass++;
+  // 0 marks a getter that was never called
+  if (evalPass == 0)
+    evalPass = 1;
+}
+
+/* Calls the getter of a function backed variable and returns the value, in
+ * the first bytes of the returned word. The getter is called at most once per
+ * evaluation pass, however many blocks reference the variable, and at most
+ * once every minIntervalMs. Must be called with the log lock taken. */
+static uint32_t acquireByFunction(logByFunction_t* logByFunction, uint8_t storageType, uint32_t timestamp)
+{
+  if (logByFunction->cachePass != 0 &&
+      (logByFunction->cachePass == evalPass || (timestamp - logByFunction->cacheTimestamp) < logByFunction->minIntervalMs))
+  {
+    evalCacheHits++;
+    return logByFunction->cacheValue;
+  }
+
+  uint32_t value = 0;
+  switch (storageType)
+  {
+    case LOG_UINT8:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt8);
+      const uint8_t v = logByFunction->acquireUInt8(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_INT8:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt8);
+      const int8_t v = logByFunction->acquireInt8(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_UINT16:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt16);
+      const uint16_t v = logByFunction->acquireUInt16(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_INT16:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt16);
+      const int16_t v = logByFunction->acquireInt16(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_UINT32:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireUInt32);
+      const uint32_t v = logByFunction->acquireUInt32(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_INT32:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->acquireInt32);
+      const int32_t v = logByFunction->acquireInt32(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+    case LOG_FLOAT:
+    {
+      ASSERT_LOG_FUNCTION_INITIALIZED(logByFunction->aquireFloat);
+      const float v = logByFunction->aquireFloat(timestamp, logByFunction->data);
+      memcpy(&value, &v, sizeof(v));
+      break;
+    }
+  }
+
+  evalCalls++;
+  logByFunction->cachePass = evalPass;
+  logByFunction->cacheTimestamp = timestamp;
+  logByFunction->cacheValue = value;
+
+  return value;
+}
+
+/* Samples the variables of a block into a log data packet, with the given
+ * packet timestamp. Must be called with the log lock taken. */
+static void blockSample(struct log_block * blk, CRTPPacket * pk, unsigned int packetTimestamp)
+{
+  const struct log_ops *ops;
+  const uint32_t sampleStart = cycleCounterGet();
+
+  // Timestamp given to the acquisition functions
+  const unsigned int timestamp = ((long long)xTaskGetTickCount())/portTICK_RATE_MS;
+
+  pk->header = CRTP_HEADER(CRTP_PORT_LOG, LOG_CH);
+  blockWriteHeader(blk, pk, packetTimestamp);
+
+  // Compute derived variables right before they are sampled
+  logLazyGroupsPrepare(blk->lazyGroups);
+
+  ops = &logOps[blk->opsStart];
+  for (int n = 0; n < blk->opsCount; n++, ops++)
+  {
+    int valuei = 0;
+    float valuef = 0;
+
+    // Adjacent variables without conversion are copied in one go
+    if (ops->runOps > 0)
+    {
+      const int skip = ops->runOps - 1;
+      if (!appendToPacket(pk, ops->variable, ops->runLength)) break;
+      n += skip;
+      ops += skip;
+      continue;
+    }
+
+    // Function backed variables go through the evaluation cache
+    const void * source = ops->variable;
+    uint32_t acquired;
+    if (ops->acquisitionType == acqType_function) {
+      acquired = acquireByFunction((logByFunction_t*)ops->variable, ops->storageType, timestamp);
+      source = &acquired;
+    }
+
+    // FPU instructions must run on aligned data.
+    // We first copy the data to an (aligned) local variable, before assigning it
+    switch(ops->storageType)
+    {
+      case LOG_UINT8:
+      {
+        uint8_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_INT8:
+      {
+        int8_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_UINT16:
+      {
+        uint16_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_INT16:
+      {
+        int16_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_UINT32:
+      {
+        uint32_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_INT32:
+      {
+        int32_t v;
+        memcpy(&v, source, sizeof(v));
+        valuei = v;
+        break;
+      }
+      case LOG_FLOAT:
+      {
+        float v;
+        memcpy(&v, source, sizeof(valuef));
+        valuei = v;
+        valuef = v;
+        break;
+      }
+    }
+
+    if (ops->logType == LOG_FLOAT || ops->logType == LOG_FP16)
+    {
+      if (ops->storageType != LOG_FLOAT)
+      {
+        valuef = valuei;
+      }
+
+      // Try to append the next item to the packet.  If we run out of space,
       // drop this and subsequent items.
       if (ops->logType == LOG_FLOAT)
       {
-        if (!appendToPacket(&pk, &valuef, 4)) break;
+        if (!appendToPacket(pk, &valuef, 4)) break;
       }
       else
       {
         valuei = single2half(valuef);
-        if (!appendToPacket(&pk, &valuei, 2)) break;
+        if (!appendToPacket(pk, &valuei, 2)) break;
       }
     }
     else  //logType is an integer
     {
-      if (!appendToPacket(&pk, &valuei, typeLength[ops->logType])) break;
+      if (!appendToPacket(pk, &valuei, typeLength[ops->logType])) break;
     }
+  }
+
+  blk->sampleCycles = cycleCounterElapsed(sampleStart);
+  if (blk->sampleCycles > blk->sampleCyclesMax)
+    blk->sampleCyclesMax = blk->sampleCycles;
+}
+
+/* Samples and sends a block. The blocks run in the same evaluation pass share
+ * the values of function backed variables. */
+static void runBlock(struct log_block * blk, bool isNewPass)
+{
+  static CRTPPacket pk;
+
+  xSemaphoreTake(logLock, portMAX_DELAY);
+
+  if (isNewPass)
+    evalPassNext();
+
+  // The block may have been deleted since it was scheduled
+  if (blk->id == BLOCK_ID_FREE)
+  {
+    xSemaphoreGive(logLock);
+    return;
+  }
+
+  const unsigned int timestamp = blockTimestampNow(blk);
+  blockSample(blk, &pk, timestamp);
+  blockSend(blk, &pk, timestamp);
+}
+
+/* Runs a single block, called by the worker for single shot blocks */
+void logRunBlock(void * arg)
+{
+  runBlock(arg, true);
+}
+
+/* Sends the sample of a stabilizer synchronous block, from the scheduler */
+static void logSendSync(struct log_sync * sync)
+{
+  static CRTPPacket pk;
+
+  xSemaphoreTake(logLock, portMAX_DELAY);
+
+  // The block may have been stopped since it was sampled
+  if (!sync->block || !sync->isPending)
+  {
+    xSemaphoreGive(logLock);
+    return;
+  }
+
+  memcpy(&pk, &sync->pk, sizeof(pk));
+  sync->isPending = false;
+  blockSend(sync->block, &pk, sync->timestamp);
+}
+
+/* Samples the stabilizer synchronous blocks that are due at this step. Called
+ * by the stabilizer after the state has been published, the packets are sent
+ * by the scheduler task. The stabilizer never waits for the log lock, a step
+ * is skipped if the lock is taken. */
+void logStabilizerStep(const uint32_t stabilizerStep)
+{
+  if (logSyncCount == 0)
+    return;
+
+  if (xSemaphoreTake(logLock, 0) != pdTRUE)
+  {
+    syncBusy++;
+    return;
+  }
+
+  evalPassNext();
 
-    ops = ops->next;
+  bool isPending = false;
+  for (int i = 0; i < LOG_MAX_SYNC_BLOCKS; i++)
+  {
+    struct log_sync * sync = &logSyncs[i];
+    if (sync->block && sync->block->isRunning && (stabilizerStep % sync->divisor) == 0)
+    {
+      // The scheduler did not send the previous sample in time
+      if (sync->isPending)
+        syncOverruns++;
+
+      const uint32_t timestamp = (sync->block->timestampFormat == logTimestamp_us) ?
+                                 blockTimestampNow(sync->block) : stabilizerStep;
+      blockSample(sync->block, &sync->pk, timestamp);
+      sync->timestamp = timestamp;
+      sync->isPending = true;
+      isPending = true;
+    }
+  }
+
+  xSemaphoreGive(logLock);
+
+  if (isPending)
+    xTaskNotifyGive(schedTaskHandle);
+}
+
+/* Post-processes and sends a sampled packet. Must be called with the log lock
+ * taken, the lock is released. */
+static void blockSend(struct log_block * blk, CRTPPacket * pk, unsigned int timestamp)
+{
+  if ((blk->trigger && !triggerSample(blk, pk, timestamp)) ||
+      (blk->batchSize > 1 && !batchSample(blk, pk, timestamp)) ||
+      (blk->encoding == logEncoding_changedOnly && !encodeChangedOnly(blk, pk)))
+  {
+    xSemaphoreGive(logLock);
+    return;
   }
 
   xSemaphoreGive(logLock);
@@ -885,14 +1923,17 @@ void logRunBlock(void * arg)
   // all the logging and flush all the CRTP queues.
   if (!crtpIsConnected())
   {
+    xSemaphoreTake(logLock, portMAX_DELAY);
     logReset();
+    xSemaphoreGive(logLock);
     crtpReset();
   }
   else
   {
     // No need to block here, since logging is not guaranteed
-    if (!crtpSendPacket(&pk))
+    if (!crtpSendPacket(pk))
     {
+      schedDroppedPackets++;
       if (blk->droppedPackets++ % 100 == 0)
       {
         DEBUG_PRINT("WARNING: LOG packets drop detected (%lu packets lost)\n",
@@ -923,49 +1964,110 @@ static int variableGetIndex(int id)
   return i;
 }
 
-static struct log_ops * opsMalloc()
+/* Inserts a new op at the end of the ops of a block. The ops stored after the
+ * block in the arena are moved up one slot. */
+static struct log_ops * opsInsert(struct log_block * block)
 {
-  int i;
+  const int end = block->opsStart + block->opsCount;
+
+  if (logOpsUsed >= LOG_MAX_OPS)
+    return NULL;
+
+  memmove(&logOps[end + 1], &logOps[end], (logOpsUsed - end) * sizeof(struct log_ops));
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id != BLOCK_ID_FREE && &logBlocks[i] != block && logBlocks[i].opsStart >= end)
+      logBlocks[i].opsStart++;
 
-  for (i=0;i<LOG_MAX_OPS; i++)
-      if (logOps[i].variable == NULL) break;
+  block->opsCount++;
+  logOpsUsed++;
+
+  return &logOps[end];
+}
+
+/* Builds the copy plan of a block: runs of memory variables that are stored
+ * adjacent and logged with their storage type are merged into one memcpy. The
+ * other ops are sampled and converted one by one. */
+static void blockCompile(struct log_block * block)
+{
+  struct log_ops * run = NULL;
+
+  for (int i = 0; i < block->opsCount; i++)
+  {
+    struct log_ops * ops = &logOps[block->opsStart + i];
+    const uint8_t len = typeLength[ops->logType];
 
-  if (i >= LOG_MAX_OPS)
-      return NULL;
+    ops->runOps = 0;
+    ops->runLength = 0;
 
-  return &logOps[i];
+    if (ops->acquisitionType != acqType_memory || ops->storageType != ops->logType)
+    {
+      run = NULL;
+    }
+    else if (run && (uint8_t*)run->variable + run->runLength == ops->variable)
+    {
+      run->runOps++;
+      run->runLength += len;
+    }
+    else
+    {
+      run = ops;
+      run->runOps = 1;
+      run->runLength = len;
+    }
+  }
 }
 
-static void opsFree(struct log_ops * ops)
+/* Frees the ops of a block and packs the arena */
+static void opsRelease(struct log_block * block)
 {
-  ops->variable = NULL;
+  const int end = block->opsStart + block->opsCount;
+
+  memmove(&logOps[block->opsStart], &logOps[end], (logOpsUsed - end) * sizeof(struct log_ops));
+
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id != BLOCK_ID_FREE && &logBlocks[i] != block && logBlocks[i].opsStart >= end)
+      logBlocks[i].opsStart -= block->opsCount;
+
+  logOpsUsed -= block->opsCount;
+  block->opsCount = 0;
 }
 
 static int blockCalcLength(struct log_block * block)
 {
-  struct log_ops * ops;
   int len = 0;
 
-  for (ops = block->ops; ops; ops = ops->next)
-    len += typeLength[ops->logType];
+  for (int i = 0; i < block->opsCount; i++)
+    len += typeLength[logOps[block->opsStart + i].logType];
 
   return len;
 }
 
-void blockAppendOps(struct log_block * block, struct log_ops * ops)
+static int blockCalcOpsCount(struct log_block * block)
 {
-  struct log_ops * o;
+  return block->opsCount;
+}
 
-  ops->next = NULL;
+static bool blockFits(struct log_block * block, int length, int opsCount)
+{
+  const int maxLen = LOG_MAX_LEN - (blockHeaderLen(block) - LOG_HEADER_LEN);
 
-  if (block->ops == NULL)
-    block->ops = ops;
-  else
-  {
-    for (o = block->ops; o->next; o = o->next);
+  if (block->batchSize > 1)
+    return block->batchSize * (blockBatchDeltaLen(block) + length) <= maxLen;
 
-    o->next = ops;
-  }
+  // A keyframe carries the presence bitmap and all the variables
+  if (block->encoding == logEncoding_changedOnly)
+    return (opsCount + 7) / 8 + length <= maxLen;
+
+  return length <= maxLen;
+}
+
+static struct log_block * logFindBlock(int id)
+{
+  for (int i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) return &logBlocks[i];
+
+  return NULL;
 }
 
 static void logReset(void)
@@ -985,17 +2087,90 @@ static void logReset(void)
 
   //Force free all the log block objects
   for(i=0; i<LOG_MAX_BLOCKS; i++)
+  {
     logBlocks[i].id = BLOCK_ID_FREE;
+    logBlocks[i].isRunning = false;
+  }
+  schedHead = NULL;
 
   //Force free the log ops
-  for (i=0; i<LOG_MAX_OPS; i++)
-    logOps[i].variable = NULL;
+  logOpsUsed = 0;
+
+  for (i=0; i<LOG_MAX_TRIGGERS; i++)
+    logTriggers[i].block = NULL;
+
+  for (i=0; i<LOG_MAX_SYNC_BLOCKS; i++)
+  {
+    logSyncs[i].block = NULL;
+    logSyncs[i].isPending = false;
+  }
+  logSyncCount = 0;
 }
 
 /* Public API to access log TOC from within the copter */
 static logVarId_t invalidVarId = 0xffffu;
 
-logVarId_t logGetVarId(const char* group, const char* name)
+/* Group of a TOC entry, the last group started before it */
+static const char * logGroupOf(int index)
+{
+  for (int i = index; i >= 0; i--)
+    if ((logs[i].type & LOG_GROUP) && (logs[i].type & LOG_START))
+      return logs[i].name;
+
+  return "";
+}
+
+/* Same content as the CMD_GET_ITEM_V2 answer, without the id. The group name
+ * is only included for the first variable of a group. */
+static uint8_t logTocBlobEncode(const int index, uint8_t* buffer)
+{
+  if (logs[index].type & LOG_GROUP) {
+    return 0;
+  }
+
+  const bool isFirstInGroup = index > 0 && (logs[index - 1].type & LOG_GROUP) && (logs[index - 1].type & LOG_START);
+  const char* group = isFirstInGroup ? logs[index - 1].name : "";
+  const int groupLength = strlen(group);
+  const int nameLength = strlen(logs[index].name);
+
+  buffer[0] = logGetType(index);
+  memcpy(&buffer[1], group, groupLength + 1);
+  memcpy(&buffer[2 + groupLength], logs[index].name, nameLength + 1);
+  return 3 + groupLength + nameLength;
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer)
+{
+  return tocBlobRead(&logTocBlob, memAddr, readLen, buffer);
+}
+
+static bool logNameIndexMatch(const uint16_t entry, const char* group, const char* name)
+{
+  return !(logs[entry].type & LOG_GROUP) && !strcmp(name, logs[entry].name) && !strcmp(group, logGroupOf(entry));
+}
+
+static void logNameIndexBuild(void)
+{
+  const char * group = "";
+
+  tocIndexInit(&logNameIndex, logNameIndexSlots, LOG_NAME_INDEX_SIZE);
+  logNameIndexIsValid = true;
+
+  for (int i = 0; i < logsLen; i++)
+  {
+    if (logs[i].type & LOG_GROUP) {
+      if (logs[i].type & LOG_START) {
+        group = logs[i].name;
+      }
+    } else if (!tocIndexAdd(&logNameIndex, group, logs[i].name, i, 0)) {
+      DEBUG_PRINT("Log TOC too large for the name index, using linear search\n");
+      logNameIndexIsValid = false;
+      return;
+    }
+  }
+}
+
+static logVarId_t logGetVarIdScan(const char* group, const char* name)
 {
   int i;
   logVarId_t varId = invalidVarId;
@@ -1016,6 +2191,54 @@ logVarId_t logGetVarId(const char* group, const char* name)
   return invalidVarId;
 }
 
+uint32_t logGetTocCrc(void)
+{
+  return logsCrc;
+}
+
+logVarId_t logGetVarId(const char* group, const char* name)
+{
+  if (logNameIndexIsValid)
+  {
+    const int index = tocIndexFind(&logNameIndex, group, name, logNameIndexMatch, NULL);
+    return (index < 0) ? invalidVarId : (logVarId_t)index;
+  }
+
+  return logGetVarIdScan(group, name);
+}
+
+#ifdef CONFIG_TOC_INDEX_BENCHMARK
+void logNameIndexBenchmark(uint32_t (*clock)(void), float* indexCycles, float* scanCycles)
+{
+  const char * group = "";
+  uint32_t indexTotal = 0;
+  uint32_t scanTotal = 0;
+  int count = 0;
+
+  for (int i = 0; i < logsLen; i++)
+  {
+    if (logs[i].type & LOG_GROUP) {
+      if (logs[i].type & LOG_START) {
+        group = logs[i].name;
+      }
+      continue;
+    }
+
+    uint32_t start = clock();
+    logGetVarId(group, logs[i].name);
+    indexTotal += clock() - start;
+
+    start = clock();
+    logGetVarIdScan(group, logs[i].name);
+    scanTotal += clock() - start;
+    count++;
+  }
+
+  *indexCycles = count ? (float)indexTotal / count : 0.0f;
+  *scanCycles = count ? (float)scanTotal / count : 0.0f;
+}
+#endif
+
 inline int logGetType(logVarId_t varid)
 {
   return logs[varid].type & LOG_TYPE_MASK;
@@ -1057,6 +2280,7 @@ int logGetInt(logVarId_t varid)
   int valuei = 0;
 
   ASSERT(logVarIdIsValid(varid));
+  logLazyGroupsPrepare(logLazyGroupMask(varid));
 
   switch(logGetType(varid))
   {
@@ -1090,8 +2314,10 @@ float logGetFloat(logVarId_t varid)
 {
   ASSERT(logVarIdIsValid(varid));
 
-  if (logGetType(varid) == LOG_FLOAT)
+  if (logGetType(varid) == LOG_FLOAT) {
+    logLazyGroupsPrepare(logLazyGroupMask(varid));
     return *(float *)logs[varid].address;
+  }
 
   return logGetInt(varid);
 }
@@ -1108,3 +2334,122 @@ static acquisitionType_t acquisitionTypeFromLogType(uint8_t logType) {
 
   return acqType_memory;
 }
+
+bool logLazyGroupRegister(logLazyGroup_t* lazyGroup)
+{
+  if (lazyGroupsCount >= LOG_LAZY_GROUPS_MAX) {
+    return false;
+  }
+
+  for (int i = 0; i < logsLen; i++) {
+    if ((logs[i].type & LOG_GROUP) && (logs[i].type & LOG_START) && !strcmp(logs[i].name, lazyGroup->group)) {
+      int stop = i + 1;
+      while (stop < logsLen && !(logs[stop].type & LOG_GROUP)) {
+        stop++;
+      }
+
+      lazyGroup->start = i + 1;
+      lazyGroup->stop = stop;
+      lazyGroup->index = lazyGroupsCount;
+      lazyGroups[lazyGroupsCount] = lazyGroup;
+      lazyGroupsCount++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool logIsGroupConsumed(const logLazyGroup_t* lazyGroup)
+{
+  const uint32_t mask = 1u << lazyGroup->index;
+
+  if (directConsumerLazyGroups & mask) {
+    return true;
+  }
+
+  for (int i = 0; i < LOG_MAX_BLOCKS; i++) {
+    if (logBlocks[i].id != BLOCK_ID_FREE && logBlocks[i].isRunning && (logBlocks[i].lazyGroups & mask)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint32_t logLazyGroupMask(logVarId_t varid)
+{
+  uint32_t mask = 0;
+
+  for (int i = 0; i < lazyGroupsCount; i++) {
+    if (varid >= lazyGroups[i]->start && varid < lazyGroups[i]->stop) {
+      mask |= 1u << i;
+    }
+  }
+
+  return mask;
+}
+
+void logLazyGroupsAddConsumer(uint32_t mask)
+{
+  directConsumerLazyGroups |= mask;
+}
+
+void logLazyGroupsPrepare(uint32_t mask)
+{
+  for (int i = 0; mask != 0; i++, mask >>= 1) {
+    if (mask & 1) {
+      lazyGroups[i]->prepare();
+    }
+  }
+}
+
+/**
+ * Log scheduler statistics
+ */
+LOG_GROUP_START(logSched)
+/**
+ * @brief Lateness of the last block sampled [ticks]
+ */
+LOG_ADD(LOG_UINT32, jitter, &schedJitter)
+/**
+ * @brief Maximum lateness of a block since startup [ticks]
+ */
+LOG_ADD(LOG_UINT32, jitterMax, &schedJitterMax)
+/**
+ * @brief Number of block periods skipped because a full period was missed
+ */
+LOG_ADD(LOG_UINT32, overruns, &schedOverruns)
+/**
+ * @brief Number of log packets dropped because the CRTP TX queue was full
+ */
+LOG_ADD(LOG_UINT32, txDrop, &schedDroppedPackets)
+/**
+ * @brief Number of single shot blocks dropped because the worker queue was full
+ */
+LOG_ADD(LOG_UINT32, workerDrop, &schedWorkerOverflows)
+/**
+ * @brief Current throttle level, blocks faster than 10 Hz run at 1/2^level of their rate, but at least at 10 Hz
+ */
+LOG_ADD(LOG_UINT8, throttle, &throttleLevel)
+/**
+ * @brief Number of times the throttle level was raised because the CRTP TX queue filled up
+ */
+LOG_ADD(LOG_UINT32, throttleUp, &throttleIncreases)
+/**
+ * @brief Number of stabilizer synchronous samples skipped because the log lock was taken
+ */
+LOG_ADD(LOG_UINT32, syncBusy, &syncBusy)
+/**
+ * @brief Number of stabilizer synchronous samples overwritten before they were sent
+ */
+LOG_ADD(LOG_UINT32, syncOverrun, &syncOverruns)
+/**
+ * @brief Number of calls to the getters of function backed variables
+ */
+LOG_ADD(LOG_UINT32, fnCalls, &evalCalls)
+/**
+ * @brief Number of function backed variables sampled from the evaluation cache
+ */
+LOG_ADD(LOG_UINT32, fnCached, &evalCacheHits)
+LOG_GROUP_STOP(logSched)
@@ -41,16 +41,20 @@ static const float lhMaxError = 0.05f;
 void outlierFilterLighthouseReset(OutlierFilterLhState_t* this, const uint32_t nowMs) {
   this->openingTimeMs = nowMs;
   this->openingWindowMs = lhMinWindowTimeMs;
+  this->rejectedErrorCount = 0;
+  this->rejectedFrameCount = 0;
 }
 
-
-bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const float distanceToBs, const float angleError, const uint32_t nowMs) {
+static bool isGoodSample(const float distanceToBs, const float angleError) {
   // float error = distanceToBs * tan(angleError);
   // We use an approximattion
   float error = distanceToBs * angleError;
 
-  bool isGoodSample = (fabsf(error) < lhMaxError);
-  if (isGoodSample) {
+  return (fabsf(error) < lhMaxError);
+}
+
+static bool updateWithSample(OutlierFilterLhState_t* this, const bool isGood, const uint32_t nowMs) {
+  if (isGood) {
     this->openingWindowMs += lhGoodSampleWindowChangeMs;
     if (this->openingWindowMs > lhMaxWindowTimeMs) {
       this->openingWindowMs = lhMaxWindowTimeMs;
@@ -65,10 +69,52 @@ bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const fl
   bool result = true;
   bool isFilterClosed = (nowMs < this->openingTimeMs);
   if (isFilterClosed) {
-    result = isGoodSample;
+    result = isGood;
   }
 
   this->openingTimeMs = nowMs + this->openingWindowMs;
 
   return result;
 }
+
+bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const float distanceToBs, const float angleError, const uint32_t nowMs) {
+  bool result = updateWithSample(this, isGoodSample(distanceToBs, angleError), nowMs);
+  if (!result) {
+    this->rejectedErrorCount++;
+  }
+
+  return result;
+}
+
+int outlierFilterLighthouseValidateSweeps(OutlierFilterLhState_t* this, const float distanceToBs[], const float angleError[], const int count, const uint32_t nowMs, bool accepted[]) {
+  // Classify all sweeps first, accepted[] holds the classification until the filter has been updated
+  int goodCount = 0;
+  for (int i = 0; i < count; i++) {
+    accepted[i] = isGoodSample(distanceToBs[i], angleError[i]);
+    if (accepted[i]) {
+      goodCount++;
+    }
+  }
+
+  // A reflection, or a base station with wrong geometry, usually gives bad samples on all sensors
+  const bool isFilterClosed = (nowMs < this->openingTimeMs);
+  const bool isFrameRejected = isFilterClosed && (count > 1) && ((count - goodCount) * 2 > count);
+
+  // The window is updated for every sample, as when validated one by one, to be able to open for a new position
+  int acceptedCount = 0;
+  for (int i = 0; i < count; i++) {
+    const bool result = updateWithSample(this, accepted[i], nowMs);
+    accepted[i] = result && !isFrameRejected;
+    if (accepted[i]) {
+      acceptedCount++;
+    } else if (!result) {
+      this->rejectedErrorCount++;
+    }
+  }
+
+  if (isFrameRejected) {
+    this->rejectedFrameCount++;
+  }
+
+  return acceptedCount;
+}
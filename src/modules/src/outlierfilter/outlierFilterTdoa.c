@@ -27,6 +27,7 @@
 #include <math.h>
 #include "outlierFilterTdoa.h"
 #include "stabilizer_types.h"
+#include "param.h"
 
 
 static bool isDistanceDiffSmallerThanDistanceBetweenAnchors(const tdoaMeasurement_t* tdoa);
@@ -36,8 +37,11 @@ static bool isDistanceDiffSmallerThanDistanceBetweenAnchors(const tdoaMeasuremen
 // hysteresis to avoid rapid changes. When the filter is open, all samples are let through, usually at startup to let
 // the kalman filter converge. When the filter is closed, only samples with an error < the acceptance level, this should
 // be most of the time.
-// The acceptance level is based on the standard deviation used for the tdoa samples, which should be based on the
-// noise level in the system.
+// The acceptance level is based on the standard deviation used for the tdoa samples, scaled by a running estimate of
+// how large the errors actually are compared to the standard deviation. If the noise in the system is larger than the
+// configured standard deviation (multi path, bad anchor positions...) the acceptance level grows, up to a limit, instead
+// of rejecting most samples and forcing the filter open.
+// All statistics are updated in one pass per sample, the cost is constant and small compared to the measurement model.
 
 
 // The maximum size of the integrator. This size determines the time [in ms] needed to open/close the filter.
@@ -49,30 +53,49 @@ static const float INTEGRATOR_FORCE_OPEN_LEVEL = INTEGRATOR_SIZE * 0.1f;
 // The level when the filter closes again
 static const float INTEGRATOR_RESUME_ACTION_LEVEL = INTEGRATOR_SIZE * 0.9f;
 
+// The accepted error when the filter is closed, in standard deviations
+static float acceptanceGate = 2.5f;
+
+// The error used to determine if a sample is added or removed from the integrator, in standard deviations
+static float integratorGate = 2.0f;
+
+// The rate at which the error scale adapts to the errors of the samples, 0 disables adaptation
+static float scaleAdaptRate = 0.01f;
+
+// The maximum error scale
+static float maxScale = 2.0f;
+
 
 void outlierFilterTdoaReset(OutlierFilterTdoaState_t* this) {
   this->integrator = 0.0f;
   this->isFilterOpen = true;
   this->latestUpdateMs = 0;
+  this->errorVariance = 1.0f;
+  this->errorScale = 1.0f;
+  this->rejectedCount = 0;
 }
 
 bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs) {
+  const float scaledStdDev = tdoa->stdDev * this->errorScale;
+
   // The accepted error when the filter is closed
-  const float acceptedDistance = tdoa->stdDev * 2.5f;
+  const float acceptedDistance = scaledStdDev * acceptanceGate;
 
   // The level used to determine if a sample is added or removed from the integrator
-  const float integratorTriggerDistance = tdoa->stdDev * 2.0f;
+  const float integratorTriggerDistance = scaledStdDev * integratorGate;
 
 
   bool sampleIsGood = false;
 
   // Discard samples that are physically impossible, most likely measurement error
   if (isDistanceDiffSmallerThanDistanceBetweenAnchors(tdoa)) {
+    const float absError = fabsf(error);
+
     uint32_t dtMs = nowMs - this->latestUpdateMs;
     // Limit dt to minimize the impact on the integrator if we have not received samples for a long time (or at start up)
     dtMs = fminf(dtMs, INTEGRATOR_SIZE / 10.0f);
 
-    if (fabsf(error) < integratorTriggerDistance) {
+    if (absError < integratorTriggerDistance) {
       this->integrator += dtMs;
       this->integrator = fminf(this->integrator, INTEGRATOR_SIZE);
     } else {
@@ -90,7 +113,15 @@ bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const t
       }
     } else {
       // The filter is closed, let samples with a small error through
-      sampleIsGood = (fabsf(error) < acceptedDistance);
+      sampleIsGood = (absError < acceptedDistance);
+
+      // Track the error relative to the standard deviation. The error is clipped at the acceptance level to limit the
+      // impact of outliers, and the scale is only adapted when the filter is closed, that is when the estimate is good.
+      if (tdoa->stdDev > 0.0f) {
+        const float normalizedError = fminf(absError, acceptedDistance) / tdoa->stdDev;
+        this->errorVariance += scaleAdaptRate * (normalizedError * normalizedError - this->errorVariance);
+        this->errorScale = fminf(fmaxf(sqrtf(this->errorVariance), 1.0f), maxScale);
+      }
 
       if (this->integrator < INTEGRATOR_FORCE_OPEN_LEVEL) {
         // We have got lots of outliers lately, the kalman filter may have diverged. Open up to try to recover
@@ -101,6 +132,10 @@ bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const t
     this->latestUpdateMs = nowMs;
   }
 
+  if (!sampleIsGood) {
+    this->rejectedCount++;
+  }
+
   return sampleIsGood;
 }
 
@@ -115,3 +150,25 @@ static bool isDistanceDiffSmallerThanDistanceBetweenAnchors(const tdoaMeasuremen
   float distanceDiffSq = sq(tdoa->distanceDiff);
   return (distanceDiffSq < anchorDistanceSq);
 }
+
+/**
+ * Tuning of the TDoA outlier filter, used by the kalman and the UKF estimators
+ */
+PARAM_GROUP_START(outlierf)
+/**
+ * @brief Accepted TDoA error when the filter is closed, in (scaled) standard deviations (default: 2.5)
+ */
+  PARAM_ADD(PARAM_FLOAT, tdoaGate, &acceptanceGate)
+/**
+ * @brief TDoA error limit for a sample to count as good in the integrator, in (scaled) standard deviations (default: 2.0)
+ */
+  PARAM_ADD(PARAM_FLOAT, tdoaIntGate, &integratorGate)
+/**
+ * @brief Rate at which the TDoA error scale adapts to the measured errors, 0 to disable (default: 0.01)
+ */
+  PARAM_ADD(PARAM_FLOAT, tdoaAdapt, &scaleAdaptRate)
+/**
+ * @brief Max TDoA error scale, the standard deviation of the samples can grow at most by this factor (default: 2.0)
+ */
+  PARAM_ADD(PARAM_FLOAT, tdoaMaxScale, &maxScale)
+PARAM_GROUP_STOP(outlierf)
@@ -114,6 +114,10 @@ bool dtrGetPacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t tim
 	return received_success;
 }
 
+bool dtrTakePacketFromQueue(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout){
+	return xQueueReceive(*getQueueHandler(qName), packet, timeout) == pdTRUE;
+}
+
 bool dtrReceivePacketWaitUntil(dtrPacket *packet, DTRQueue_Names qName, uint32_t timeout_ms, bool *new_packet_received){
 	*new_packet_received = xQueueReceive(*getQueueHandler(qName), packet, M2T(timeout_ms)) == pdTRUE;
 	return true;
@@ -35,6 +35,7 @@
 
 #define DEBUG_MODULE "TOK_RING"
 #include "debug.h"
+#include "param.h"
 
 
 static uint8_t node_id = 0;
@@ -63,6 +64,28 @@ static uint8_t my_id ;
 
 static dtrTopology networkTopology;
 
+/*
+ * Sliding window mode: the token holder takes up to windowSize packets from
+ * the TX queue and sends them back to back to each receiver in ring order,
+ * broadcast packets to all receivers and unicast packets to their target
+ * only. Each DATA frame carries a 4 bit sequence number, continuous per
+ * sender and receiver, and the last frame of a burst requests an ack. The
+ * receiver acks the last sequence number received in order (go-back-N).
+ */
+static uint8_t windowSize = 1;
+static bool windowActive = false;
+static dtrPacket window[DTR_MAX_WINDOW_SIZE];
+static uint8_t windowDest[DTR_MAX_WINDOW_SIZE];
+static uint8_t windowCount;
+static uint8_t windowTargetId;
+static uint8_t burst[DTR_MAX_WINDOW_SIZE];
+static uint8_t burstCount;
+static uint8_t burstAcked;
+static uint8_t burstFirstSeq;
+// Indexed by the position of the node in the topology
+static uint8_t txSeq[MAX_NETWORK_SIZE];
+static uint8_t rxExpectedSeq[MAX_NETWORK_SIZE];
+
 
 // DEBUGGING FUNCTIONS
 #ifdef DEBUG_DTR_PROTOCOL
@@ -168,6 +191,14 @@ static void setNodeIds(dtrTopology topology, uint8_t device_id) {
 	DTR_DEBUG_PRINT("prev node_id: %d\n", prev_node_id);
 }
 
+static void resetWindow(void) {
+	windowActive = false;
+	windowCount = 0;
+	burstCount = 0;
+	memset(txSeq, 0, sizeof(txSeq));
+	memset(rxExpectedSeq, 0, sizeof(rxExpectedSeq));
+}
+
 static void initTokenRing(dtrTopology topology, uint8_t device_id) {
 	my_id = dtrGetSelfId();
 
@@ -175,6 +206,126 @@ static void initTokenRing(dtrTopology topology, uint8_t device_id) {
 	setNodeIds(topology, my_id);
 
 	rx_state = RX_IDLE;
+	resetWindow();
+}
+
+static uint8_t getWindowSize(void) {
+	if (windowSize < 1) {
+		return 1;
+	}
+	return windowSize > DTR_MAX_WINDOW_SIZE ? DTR_MAX_WINDOW_SIZE : windowSize;
+}
+
+static bool isWindowModeEnabled(void) {
+	return getWindowSize() > 1;
+}
+
+/* Takes the packets for this token pass from the TX queue */
+static void fillWindow(void) {
+	windowCount = 0;
+
+	dtrPacket* packet = &window[0];
+	uint32_t timeout = M2T(TX_RECEIVED_WAIT_TIME);
+	while (windowCount < getWindowSize() && dtrTakePacketFromQueue(packet, TX_DATA_Q, timeout)) {
+		timeout = 0;
+		if (packet->targetId != 0xFF && !IdExistsInTopology(packet->targetId)) {
+			DEBUG_PRINT("Releasing DTR TX packet,target is not in topology.\n");
+			continue;
+		}
+
+		windowDest[windowCount] = packet->targetId;
+		packet->packetSize = DTR_PACKET_HEADER_SIZE + packet->dataSize;
+		packet->sourceId = node_id;
+		windowCount++;
+		packet = &window[windowCount % DTR_MAX_WINDOW_SIZE];
+	}
+}
+
+/* Selects the next receiver in ring order that has packets in the window.
+ * Returns false when all receivers have been served. */
+static bool nextBurst(void) {
+	uint8_t target = windowTargetId;
+
+	for (uint8_t n = 0; n < networkTopology.size; n++) {
+		target = getNextNodeId(target);
+		if (target == node_id) {
+			return false;
+		}
+
+		burstCount = 0;
+		for (uint8_t i = 0; i < windowCount; i++) {
+			if (windowDest[i] == 0xFF || windowDest[i] == target) {
+				burst[burstCount++] = i;
+			}
+		}
+
+		if (burstCount > 0) {
+			const uint8_t index = getIndexInTopology(target);
+			windowTargetId = target;
+			burstAcked = 0;
+			burstFirstSeq = txSeq[index];
+			txSeq[index] = (txSeq[index] + burstCount) & DTR_SEQ_MASK;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Sends the packets of the burst that are not acked yet */
+static void sendBurst(void) {
+	for (uint8_t i = burstAcked; i < burstCount; i++) {
+		dtrPacket* packet = &window[burst[i]];
+		const uint8_t seq = (burstFirstSeq + i) & DTR_SEQ_MASK;
+		const bool last = (i == burstCount - 1);
+
+		packet->messageType = DATA_FRAME | (seq << DTR_SEQ_SHIFT) | (last ? DTR_ACK_REQUEST : 0);
+		packet->targetId = windowTargetId;
+		dtrSendP2Ppacket(packet);
+		radioMetaInfo.sendPackets++;
+	}
+}
+
+static void setupBurstTx(void) {
+	tx_state = TX_DATA_FRAME;
+	rx_state = RX_WAIT_DATA_ACK;
+	sendBurst();
+	// set the radio timer to "spam" the packets that are not acked
+	dtrStartSenderTimer(MAX_WAIT_TIME_FOR_DATA_ACK);
+}
+
+/* Receiver side, returns true if the packet should be delivered */
+static bool acceptWindowPacket(const dtrPacket* packet, uint8_t seq, bool ackRequest, bool* sendAck) {
+	const uint8_t index = getIndexInTopology(packet->sourceId);
+	if (index >= networkTopology.size) {
+		*sendAck = false;
+		return false;
+	}
+
+	const uint8_t size = getWindowSize();
+	const uint8_t diff = (seq - rxExpectedSeq[index]) & DTR_SEQ_MASK;
+	*sendAck = ackRequest;
+
+	if (diff > 0 && diff < size) {
+		// Packets missing before this one, wait for the sender to go back
+		*sendAck = true;
+		return false;
+	}
+
+	if (diff >= DTR_SEQ_MASK + 1 - size) {
+		// Already received, the ack was probably lost
+		*sendAck = true;
+		return false;
+	}
+
+	// In order, or out of sync after a reset of one of the nodes
+	rxExpectedSeq[index] = (seq + 1) & DTR_SEQ_MASK;
+	return true;
+}
+
+static uint8_t lastAckedSeq(uint8_t sourceId) {
+	const uint8_t index = getIndexInTopology(sourceId);
+	return (rxExpectedSeq[index] - 1) & DTR_SEQ_MASK;
 }
 
 static void setupRadioTx(dtrPacket* packet, dtrTxStates txState) {
@@ -241,6 +392,7 @@ static void resetProtocol(void){
 	dtrEmptyQueues(); // Maybe not all queues, but only the RX_SRV since the data are going to be lost saved in DATA queues 
 	dtrShutdownSenderTimer();
 	last_packet_source_id = 255;
+	resetWindow();
 }
 
 // static uint8_t send_data_to_peer_counter = 0;
@@ -270,6 +422,10 @@ void dtrTaskHandler(void *param) {
 			
 			radioMetaInfo.receivedPackets++;
 
+			const uint8_t rxSeq = rxPk->messageType >> DTR_SEQ_SHIFT;
+			const bool rxAckRequest = (rxPk->messageType & DTR_ACK_REQUEST) != 0;
+			rxPk->messageType &= DTR_MESSAGE_TYPE_MASK;
+
 			DTR_DEBUG_PRINT("===============================================================\n");
 			DTR_DEBUG_PRINT("=\n");
 			DTR_DEBUG_PRINT("TX_DATA Q Empty: %d\n", !dtrIsPacketInQueueAvailable(TX_DATA_Q));
@@ -291,6 +447,23 @@ void dtrTaskHandler(void *param) {
 						DTR_DEBUG_PRINT("\nReceived DATA packet from prev\n");
 						bool received_starting_packet = (rxPk->data[0] == (uint8_t) (START_PACKET >> 8)) 
 													 && (rxPk->data[1] == (uint8_t) START_PACKET) ;
+						if (isWindowModeEnabled() && !received_starting_packet) {
+							bool sendAck;
+							if (acceptWindowPacket(rxPk, rxSeq, rxAckRequest, &sendAck)) {
+								bool queueFull = !dtrInsertPacketToQueue(rxPk, RX_DATA_Q);
+								if (queueFull){
+									radioMetaInfo.failedRxQueueFull++;
+								}
+							}
+
+							if (sendAck) {
+								/* Cumulative ack of the packets received in order */
+								servicePk.messageType = DATA_ACK_FRAME | (lastAckedSeq(rxPk->sourceId) << DTR_SEQ_SHIFT);
+								servicePk.targetId = rxPk->sourceId;
+								setupRadioTx(&servicePk, TX_DATA_ACK);
+							}
+							continue;
+						}
 						if (rxPk->sourceId != last_packet_source_id  && !received_starting_packet) {
 							last_packet_source_id = rxPk->sourceId;
 							/* if packet is relevant and receiver queue is not full, then
@@ -339,6 +512,20 @@ void dtrTaskHandler(void *param) {
 						dtrShutdownSenderTimer();
 						last_packet_source_id = node_id;
 						DTR_DEBUG_PRINT("\nRcvd CTS from prev,send DATA to next\n");
+
+						if (isWindowModeEnabled()) {
+							fillWindow();
+							windowTargetId = node_id;
+							if (windowCount > 0 && nextBurst()) {
+								windowActive = true;
+								setupBurstTx();
+							} else {
+								DTR_DEBUG_PRINT("No TX DATA,forwarding token to next\n");
+								servicePk.messageType = TOKEN_FRAME;
+								setupRadioTx(&servicePk, TX_TOKEN);
+							}
+							continue;
+						}
 						/* check if there is a DATA packet. If yes, prepare it and
 						 * send it, otherwise forward the token to the next node. */
 						
@@ -393,8 +580,37 @@ void dtrTaskHandler(void *param) {
 					break;
 
 				case RX_WAIT_DATA_ACK:
+					if (windowActive) {
+						if (rxPk->messageType == DATA_ACK_FRAME && rxPk->targetId == node_id && rxPk->sourceId == windowTargetId) {
+							const uint8_t acked = (rxSeq - burstFirstSeq + 1) & DTR_SEQ_MASK;
+							if (acked <= burstAcked || acked > burstCount) {
+								// Nothing new acked, the timer will send again
+								break;
+							}
+
+							radioMetaInfo.ackedPackets += acked - burstAcked;
+							burstAcked = acked;
+							dtrShutdownSenderTimer();
+
+							if (burstAcked < burstCount) {
+								// The receiver missed a packet, go back to it
+								setupBurstTx();
+							} else if (nextBurst()) {
+								setupBurstTx();
+							} else {
+								windowActive = false;
+								windowCount = 0;
+								servicePk.messageType = TOKEN_FRAME;
+								setupRadioTx(&servicePk, TX_TOKEN);
+							}
+							continue;
+						}
+						break;
+					}
+
 					if (rxPk->messageType == DATA_ACK_FRAME && rxPk->targetId == node_id) {
 						dtrShutdownSenderTimer();
+						radioMetaInfo.ackedPackets++;
 
 						//TODO: bad implementation, should be fixed
 						dtrPacket _txPk;
@@ -477,6 +693,13 @@ void dtrTimeOutCallBack(xTimerHandle timer) {
 	DTR_DEBUG_PRINT("\n");
 	#endif
 
+	if (windowActive && tx_state == TX_DATA_FRAME) {
+		radioMetaInfo.retransmittedPackets += burstCount - burstAcked;
+		radioMetaInfo.timeOutDATA++;
+		sendBurst();
+		return;
+	}
+
 	dtrSendP2Ppacket(timerDTRpacket);
 	radioMetaInfo.sendPackets++;
 
@@ -489,6 +712,7 @@ void dtrTimeOutCallBack(xTimerHandle timer) {
 			break;
 		case TX_DATA_FRAME:
 			radioMetaInfo.timeOutDATA++;
+			radioMetaInfo.retransmittedPackets++;
 			break;
 		default:
 			break;
@@ -591,6 +815,10 @@ bool dtrSendPacket(dtrPacket* packet){
 }
 
 
+void dtrSetWindowSize(uint8_t size){
+	windowSize = size;
+}
+
 bool dtrGetPacket(dtrPacket* packet, uint32_t timeout){
 	return  dtrGetPacketFromQueue(packet,RX_DATA_Q,timeout);
 }
@@ -599,4 +827,32 @@ bool dtrGetPacket(dtrPacket* packet, uint32_t timeout){
 LOG_GROUP_START(DTR_P2P)
 	LOG_ADD(LOG_UINT8, rx_state, &rx_state)
 	LOG_ADD(LOG_UINT8, tx_state, &tx_state)
+	/**
+	 * @brief Number of DTR packets sent, including service packets and retransmissions
+	 */
+	LOG_ADD(LOG_UINT32, sent, &radioMetaInfo.sendPackets)
+	/**
+	 * @brief Number of DTR packets received
+	 */
+	LOG_ADD(LOG_UINT32, received, &radioMetaInfo.receivedPackets)
+	/**
+	 * @brief Number of DATA packets acked by a receiver, the throughput of the node is the rate of this counter
+	 */
+	LOG_ADD(LOG_UINT32, acked, &radioMetaInfo.ackedPackets)
+	/**
+	 * @brief Number of DATA packets sent again because of a missing ack
+	 */
+	LOG_ADD(LOG_UINT32, retx, &radioMetaInfo.retransmittedPackets)
+	/**
+	 * @brief Number of received DATA packets dropped because the RX queue was full
+	 */
+	LOG_ADD(LOG_UINT32, rxQFull, &radioMetaInfo.failedRxQueueFull)
 LOG_GROUP_STOP(DTR_P2P)
+
+PARAM_GROUP_START(DTR_P2P)
+	/**
+	 * @brief Number of DATA packets per token pass, 1 is stop-and-wait (default),
+	 * up to 7 enables the sliding window mode. Must be the same on all nodes.
+	 */
+	PARAM_ADD(PARAM_UINT8, window, &windowSize)
+PARAM_GROUP_STOP(DTR_P2P)
@@ -34,6 +34,10 @@
 #include "debug.h"
 #include "cfassert.h"
 #include "autoconf.h"
+#include "static_mem.h"
+#include "toc_index.h"
+#include "toc_blob.h"
+#include "worker.h"
 
 #if 0
 #define PARAM_DEBUG(fmt, ...) DEBUG_PRINT("D/param " fmt, ## __VA_ARGS__)
@@ -64,6 +68,13 @@ static const uint8_t typeLength[] = {
 
 #define PERSISTENT_PREFIX_STRING "prm/"
 
+// Most (id, value) pairs that fit in a bulk write, all with 1 byte values
+#define PARAM_BULK_MAX_ITEMS ((CRTP_MAX_DATA_SIZE - 1) / 3)
+// Most ids that fit in a bulk read request
+#define PARAM_BULK_MAX_IDS ((CRTP_MAX_DATA_SIZE - 1) / 2)
+// Most values that can be staged in one transaction
+#define PARAM_TXN_MAX_ITEMS 32
+
 //Private functions
 static int variableGetIndex(int id);
 static void paramNotifyChanged(int index);
@@ -87,6 +98,49 @@ static int paramsLen;
 static uint32_t paramsCrc;
 static uint16_t paramsCount = 0;
 
+// Index of the parameters by group and name, see paramGetVarId(). Large enough
+// for the full TOC, paramGetVarId() falls back to a linear search otherwise.
+#define PARAM_NAME_INDEX_SIZE 1024
+NO_DMA_CCM_SAFE_ZERO_INIT static tocIndexSlot_t paramNameIndexSlots[PARAM_NAME_INDEX_SIZE];
+static tocIndex_t paramNameIndex;
+static bool paramNameIndexIsValid = false;
+static void paramNameIndexBuild(void);
+
+// The whole TOC serialized for clients, see paramTocBlobRead()
+static tocBlob_t paramTocBlob;
+
+// Bulk persistent store in progress, see paramPersistentStoreBulk()
+static struct {
+  uint16_t indexes[PARAM_BULK_MAX_IDS];
+  uint8_t count;
+  bool isAll;
+  bool isRunning;
+} storeBulk;
+
+// Values staged by a transaction, see paramTransactionApply()
+typedef struct {
+  uint16_t index;
+  uint8_t value[8];
+} paramTxnItem_t;
+static paramTxnItem_t txnItems[PARAM_TXN_MAX_ITEMS];
+static uint8_t txnCount;
+static bool txnIsCommitted;
+static uint8_t paramTocBlobEncode(const int index, uint8_t* buffer);
+
+// The current state of all parameters serialized for clients, see
+// paramStateBlobRead(). It is a TOC blob with two bitmaps, one bit per
+// variable in id order, followed by the values.
+static tocBlob_t paramStateBlob;
+static int paramStateBitmapSize;
+static uint8_t paramStateBlobEncode(const int entry, uint8_t* buffer);
+
+// Which parameters have a value in the persistent storage, by index. Set at
+// startup and kept up to date by the store and clear commands, the storage is
+// fetched for the parameters that do not fit.
+#define PARAM_STORED_MAX_ENTRIES 1024
+static uint8_t paramStoredBits[PARAM_STORED_MAX_ENTRIES / 8];
+static void paramStoredMark(const int index, const bool isStored);
+
 // _sdata is from linker script and points to start of data section
 extern int _sdata;
 extern int _edata;
@@ -235,6 +289,9 @@ void paramLogicInit(void)
   params = _param_start;
   paramsLen = _param_stop - _param_start;
 #endif
+  txnCount = 0;
+  txnIsCommitted = false;
+  storeBulk.isRunning = false;
   // Calculate a hash of the toc by chaining description of each elements
   paramsCrc = 0;
   for (int i=0; i<paramsLen; i++)
@@ -262,11 +319,20 @@ void paramLogicInit(void)
     paramsCrc = crc32CalculateBuffer(buf, len);
   }
 
+  paramsCount = 0;
   for (i=0; i<paramsLen; i++)
   {
     if(!(params[i].type & PARAM_GROUP))
       paramsCount++;
   }
+
+  paramNameIndexBuild();
+
+  tocBlobInit(&paramTocBlob, paramsLen, paramsCount, paramsCrc, paramTocBlobEncode);
+
+  memset(paramStoredBits, 0, sizeof(paramStoredBits));
+  paramStateBitmapSize = (paramsCount + 7) / 8;
+  tocBlobInit(&paramStateBlob, 2 * paramStateBitmapSize + paramsLen, paramsCount, paramsCrc, paramStateBlobEncode);
 }
 
 void paramTOCProcess(CRTPPacket *p, int command)
@@ -380,29 +446,14 @@ static void paramNotifyChanged(int index) {
 }
 
 static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr) {
-  int index;
-  char *pgroup = "";
-
-  for (index = 0; index < paramsLen; index++) //Ptr points a group
-  {
-    if (params[index].type & PARAM_GROUP)
-    {
-      if (params[index].type & PARAM_START)
-        pgroup = params[index].name;
-      else
-        pgroup = "";
-    }
-    else                          //Ptr points a variable
-    {
-      if (!strcmp(params[index].name, name) && !strcmp(pgroup, group))
-        break;
-    }
-  }
+  const paramVarId_t varId = paramGetVarId(group, name);
 
-  if (index >= paramsLen) {
+  if (!PARAM_VARID_IS_VALID(varId)) {
     return ENOENT;
   }
 
+  const int index = varId.index;
+
   if (type != (params[index].type & (~(PARAM_CORE | PARAM_RONLY | PARAM_EXTENDED)))) {
     return EINVAL;
   }
@@ -478,7 +529,87 @@ paramVarId_t paramGetVarIdFromComplete(const char* completeName)
   return paramGetVarId(group, name);
 }
 
-paramVarId_t paramGetVarId(const char* group, const char* name)
+/* Group of a TOC entry, the last group started before it */
+static const char * paramGroupOf(int index)
+{
+  for (int i = index; i >= 0; i--) {
+    if ((params[i].type & PARAM_GROUP) && (params[i].type & PARAM_START)) {
+      return params[i].name;
+    }
+  }
+
+  return "";
+}
+
+/* Same content as the CMD_GET_ITEM_V2 answer, without the id. The group name
+ * is only included for the first parameter of a group. */
+static uint8_t paramTocBlobEncode(const int index, uint8_t* buffer)
+{
+  if (params[index].type & PARAM_GROUP) {
+    return 0;
+  }
+
+  const bool isFirstInGroup = index > 0 && (params[index - 1].type & PARAM_GROUP) && (params[index - 1].type & PARAM_START);
+  const char* group = isFirstInGroup ? params[index - 1].name : "";
+  const int groupLength = strlen(group);
+  const int nameLength = strlen(params[index].name);
+
+  buffer[0] = params[index].type;
+  memcpy(&buffer[1], group, groupLength + 1);
+  memcpy(&buffer[2 + groupLength], params[index].name, nameLength + 1);
+  return 3 + groupLength + nameLength;
+}
+
+uint32_t paramTocBlobGetSize(void)
+{
+  return tocBlobGetSize(&paramTocBlob);
+}
+
+bool paramTocBlobRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer)
+{
+  return tocBlobRead(&paramTocBlob, memAddr, readLen, buffer);
+}
+
+uint32_t paramStateBlobGetSize(void)
+{
+  return tocBlobGetSize(&paramStateBlob);
+}
+
+bool paramStateBlobRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer)
+{
+  return tocBlobRead(&paramStateBlob, memAddr, readLen, buffer);
+}
+
+static bool paramNameIndexMatch(const uint16_t entry, const char* group, const char* name)
+{
+  return !(params[entry].type & PARAM_GROUP) && !strcmp(name, params[entry].name) && !strcmp(group, paramGroupOf(entry));
+}
+
+static void paramNameIndexBuild(void)
+{
+  const char * group = "";
+  uint16_t id = 0;
+
+  tocIndexInit(&paramNameIndex, paramNameIndexSlots, PARAM_NAME_INDEX_SIZE);
+  paramNameIndexIsValid = true;
+
+  for (int index = 0; index < paramsLen; index++) {
+    if (params[index].type & PARAM_GROUP) {
+      if (params[index].type & PARAM_START) {
+        group = params[index].name;
+      }
+    } else {
+      if (!tocIndexAdd(&paramNameIndex, group, params[index].name, index, id)) {
+        DEBUG_PRINT("Param TOC too large for the name index, using linear search\n");
+        paramNameIndexIsValid = false;
+        return;
+      }
+      id++;
+    }
+  }
+}
+
+static paramVarId_t paramGetVarIdScan(const char* group, const char* name)
 {
   uint16_t index;
   uint16_t id = 0;
@@ -505,6 +636,54 @@ paramVarId_t paramGetVarId(const char* group, const char* name)
   return invalidVarId;
 }
 
+paramVarId_t paramGetVarId(const char* group, const char* name)
+{
+  if (paramNameIndexIsValid) {
+    paramVarId_t varId = invalidVarId;
+    uint16_t id;
+    const int index = tocIndexFind(&paramNameIndex, group, name, paramNameIndexMatch, &id);
+    if (index >= 0) {
+      varId.index = index;
+      varId.id = id;
+      return varId;
+    }
+    return invalidVarId;
+  }
+
+  return paramGetVarIdScan(group, name);
+}
+
+#ifdef CONFIG_TOC_INDEX_BENCHMARK
+void paramNameIndexBenchmark(uint32_t (*clock)(void), float* indexCycles, float* scanCycles)
+{
+  const char * group = "";
+  uint32_t indexTotal = 0;
+  uint32_t scanTotal = 0;
+  int count = 0;
+
+  for (int index = 0; index < paramsLen; index++) {
+    if (params[index].type & PARAM_GROUP) {
+      if (params[index].type & PARAM_START) {
+        group = params[index].name;
+      }
+      continue;
+    }
+
+    uint32_t start = clock();
+    paramGetVarId(group, params[index].name);
+    indexTotal += clock() - start;
+
+    start = clock();
+    paramGetVarIdScan(group, params[index].name);
+    scanTotal += clock() - start;
+    count++;
+  }
+
+  *indexCycles = count ? (float)indexTotal / count : 0.0f;
+  *scanCycles = count ? (float)scanTotal / count : 0.0f;
+}
+#endif
+
 int paramGetType(paramVarId_t varid)
 {
   return params[varid.index].type;
@@ -649,6 +828,203 @@ void paramSetByName(CRTPPacket *p)
 
 }
 
+/* Parses the (id, value) pairs of a bulk write or transaction packet, starting
+ * at [pos]. Nothing is written, the index and the value offset of each pair are
+ * returned in [indexes] and [offsets]. On error, count is the position of the
+ * offending pair. */
+static uint8_t paramParsePairs(const CRTPPacket *p, int pos, int indexes[], uint8_t offsets[], uint8_t* count)
+{
+  *count = 0;
+  while (pos < p->size) {
+    uint16_t id;
+    if (*count >= PARAM_BULK_MAX_ITEMS || pos + sizeof(id) > p->size) {
+      return EINVAL;
+    }
+    memcpy(&id, &p->data[pos], sizeof(id));
+
+    int index = variableGetIndex(id);
+    if (index < 0) {
+      return ENOENT;
+    }
+    if (params[index].type & PARAM_RONLY) {
+      return EACCES;
+    }
+    const int valuePos = pos + sizeof(id);
+    if (valuePos + paramGetLen(index) > p->size) {
+      return EINVAL;
+    }
+
+    indexes[*count] = index;
+    offsets[*count] = valuePos;
+    (*count)++;
+    pos = valuePos + paramGetLen(index);
+  }
+
+  return 0;
+}
+
+/* Calls the callbacks of the [count] params in [indexes], params that share a
+ * callback get it called once. */
+static void paramNotifyChangedSet(const int indexes[], const int count)
+{
+  for (int i = 0; i < count; i++) {
+    void (*callback)(void) = params[indexes[i]].callback;
+    bool isCalled = false;
+    for (int j = 0; j < i; j++) {
+      if (params[indexes[j]].callback == callback) {
+        isCalled = true;
+        break;
+      }
+    }
+    if (!isCalled) {
+      paramNotifyChanged(indexes[i]);
+    }
+  }
+}
+
+/* Bulk write, the packet holds a sequence of (id, value) pairs. All pairs are
+ * validated before anything is written, so either all or none of the values
+ * are set. Parameters that share a callback get it called once. */
+void paramBulkWrite(CRTPPacket *p)
+{
+  int indexes[PARAM_BULK_MAX_ITEMS];
+  uint8_t offsets[PARAM_BULK_MAX_ITEMS];
+  uint8_t count;
+
+  const uint8_t result = paramParsePairs(p, 1, indexes, offsets, &count);
+
+  if (result == 0) {
+    for (int i = 0; i < count; i++) {
+      paramSet(indexes[i], &p->data[offsets[i]]);
+    }
+
+    paramNotifyChangedSet(indexes, count);
+  }
+
+  p->data[1] = count;
+  p->data[2] = result;
+  p->size = 3;
+  crtpSendPacketBlock(p);
+}
+
+/* Transactions. The staged values are the back buffer, they are swapped in by
+ * paramTransactionApply() from the stabilizer loop, between two ticks, so the
+ * controller never sees half of a set. While a committed transaction waits for
+ * the stabilizer no new values can be staged. */
+static void paramTransactionReply(CRTPPacket *p, const uint8_t count, const uint8_t result)
+{
+  p->data[1] = count;
+  p->data[2] = result;
+  p->size = 3;
+  crtpSendPacketBlock(p);
+}
+
+static uint8_t paramTransactionStagePairs(const CRTPPacket *p, uint8_t* count)
+{
+  int indexes[PARAM_BULK_MAX_ITEMS];
+  uint8_t offsets[PARAM_BULK_MAX_ITEMS];
+
+  if (__atomic_load_n(&txnIsCommitted, __ATOMIC_ACQUIRE)) {
+    *count = 0;
+    return EBUSY;
+  }
+
+  uint8_t result = paramParsePairs(p, 1, indexes, offsets, count);
+  if (result == 0 && txnCount + *count > PARAM_TXN_MAX_ITEMS) {
+    result = ENOMEM;
+  }
+
+  if (result == 0) {
+    for (int i = 0; i < *count; i++) {
+      txnItems[txnCount].index = indexes[i];
+      memcpy(txnItems[txnCount].value, &p->data[offsets[i]], paramGetLen(indexes[i]));
+      txnCount++;
+    }
+  }
+
+  return result;
+}
+
+void paramTransactionStage(CRTPPacket *p)
+{
+  uint8_t count;
+  const uint8_t result = paramTransactionStagePairs(p, &count);
+  paramTransactionReply(p, count, result);
+}
+
+void paramTransactionCommit(CRTPPacket *p)
+{
+  uint8_t count;
+  const uint8_t result = paramTransactionStagePairs(p, &count);
+
+  if (result == 0 && txnCount > 0) {
+    __atomic_store_n(&txnIsCommitted, true, __ATOMIC_RELEASE);
+  }
+
+  // On success, count is the number of values in the transaction
+  paramTransactionReply(p, result == 0 ? txnCount : count, result);
+}
+
+void paramTransactionAbort(CRTPPacket *p)
+{
+  uint8_t result = 0;
+  if (__atomic_load_n(&txnIsCommitted, __ATOMIC_ACQUIRE)) {
+    result = EBUSY;
+  } else {
+    txnCount = 0;
+  }
+
+  paramTransactionReply(p, 0, result);
+}
+
+void paramTransactionApply(void)
+{
+  if (!__atomic_load_n(&txnIsCommitted, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  int indexes[PARAM_TXN_MAX_ITEMS];
+  for (int i = 0; i < txnCount; i++) {
+    paramSet(txnItems[i].index, txnItems[i].value);
+    indexes[i] = txnItems[i].index;
+  }
+
+  paramNotifyChangedSet(indexes, txnCount);
+
+  txnCount = 0;
+  __atomic_store_n(&txnIsCommitted, false, __ATOMIC_RELEASE);
+}
+
+/* Bulk read, the packet holds a sequence of ids. The answer holds the values
+ * of as many of them as fit in one packet, the client asks again for the rest. */
+void paramBulkRead(CRTPPacket *p)
+{
+  uint16_t ids[PARAM_BULK_MAX_IDS];
+  const uint8_t numIds = (p->size - 1) / sizeof(uint16_t);
+  memcpy(ids, &p->data[1], numIds * sizeof(uint16_t));
+
+  uint8_t count = 0;
+  uint8_t result = 0;
+  int pos = 3;
+  for (int i = 0; i < numIds; i++) {
+    int index = variableGetIndex(ids[i]);
+    if (index < 0) {
+      result = ENOENT;
+      break;
+    }
+    if (pos + paramGetLen(index) > CRTP_MAX_DATA_SIZE) {
+      break;
+    }
+    pos += paramGet(index, &p->data[pos]);
+    count++;
+  }
+
+  p->data[1] = count;
+  p->data[2] = result;
+  p->size = pos;
+  crtpSendPacketBlock(p);
+}
+
 #define KEY_LEN 30  // FIXME
 
 void paramGetExtendedType(CRTPPacket *p)
@@ -708,12 +1084,206 @@ void paramPersistentStore(CRTPPacket *p)
   generateStorageKey(index, key);
 
   result = storageStore(key, params[index].address, paramGetLen(index));
+  if (result) {
+    paramStoredMark(index, true);
+  }
 
   p->data[3] = result ? 0: ENOENT;
   p->size = 4;
   crtpSendPacketBlock(p);
 }
 
+static void paramStoredMark(const int index, const bool isStored)
+{
+  if (index < PARAM_STORED_MAX_ENTRIES) {
+    if (isStored) {
+      paramStoredBits[index / 8] |= (1 << (index % 8));
+    } else {
+      paramStoredBits[index / 8] &= ~(1 << (index % 8));
+    }
+  }
+}
+
+static bool paramIsStored(const int index)
+{
+  if (index < PARAM_STORED_MAX_ENTRIES) {
+    return paramStoredBits[index / 8] & (1 << (index % 8));
+  }
+
+  char key[KEY_LEN] = {0};
+  generateStorageKey(index, key);
+  uint8_t value[8];
+  return storageFetch(key, value, paramGetLen(index)) > 0;
+}
+
+// Read-only parameters have no default value, they never differ from it
+static bool paramDiffersFromDefault(const int index)
+{
+  if (params[index].type & PARAM_RONLY) {
+    return false;
+  }
+
+  uint8_t value[8];
+  const int paramLen = paramGet(index, value);
+  const void* defaultValue = params[index].getter ? params[index].getter() : paramGetDefault(index);
+  return memcmp(value, defaultValue, paramLen) != 0;
+}
+
+// Position of the last bitmap byte encoded, the bitmaps are mostly read in order
+static int stateCursorId;
+static int stateCursorIndex;
+
+static uint8_t paramStateBitmapByte(const int byte, bool (*isSet)(const int index))
+{
+  const int firstId = byte * 8;
+  if (firstId < stateCursorId) {
+    stateCursorId = 0;
+    stateCursorIndex = 0;
+  }
+
+  uint8_t bits = 0;
+  int id = stateCursorId;
+  int index = stateCursorIndex;
+  for (; index < paramsLen && id < firstId + 8; index++) {
+    if (params[index].type & PARAM_GROUP) {
+      continue;
+    }
+    if (id >= firstId && isSet(index)) {
+      bits |= (1 << (id - firstId));
+    }
+    id++;
+  }
+
+  stateCursorId = id;
+  stateCursorIndex = index;
+  return bits;
+}
+
+/* The differs from default bitmap, the stored bitmap and then one value per
+ * variable, in id order. */
+static uint8_t paramStateBlobEncode(const int entry, uint8_t* buffer)
+{
+  if (entry < paramStateBitmapSize) {
+    buffer[0] = paramStateBitmapByte(entry, paramDiffersFromDefault);
+    return 1;
+  }
+  if (entry < 2 * paramStateBitmapSize) {
+    buffer[0] = paramStateBitmapByte(entry - paramStateBitmapSize, paramIsStored);
+    return 1;
+  }
+
+  const int index = entry - 2 * paramStateBitmapSize;
+  if (params[index].type & PARAM_GROUP) {
+    return 0;
+  }
+
+  return paramGet(index, buffer);
+}
+
+static bool paramIsPersistent(const int index)
+{
+  return (params[index].type & PARAM_EXTENDED) && (params[index].extended_type & (PARAM_PERSISTENT >> 8));
+}
+
+/* Bulk persistent store, runs as a worker job. The values that are already in
+ * the storage are skipped, the others go to the storage cache and are written
+ * with a single flush. The completion is reported with one packet for the
+ * whole batch. */
+static void paramPersistentStoreBulkJob(void *arg)
+{
+  uint8_t stored = 0;
+  uint8_t unchanged = 0;
+  bool result = true;
+
+  const int count = storeBulk.isAll ? paramsLen : storeBulk.count;
+  for (int i = 0; i < count; i++) {
+    const int index = storeBulk.isAll ? i : storeBulk.indexes[i];
+    if (storeBulk.isAll && ((params[index].type & PARAM_GROUP) || !paramIsPersistent(index))) {
+      continue;
+    }
+
+    char key[KEY_LEN] = {0};
+    generateStorageKey(index, key);
+
+    const uint8_t paramLen = paramGetLen(index);
+    uint8_t value[8];
+    uint8_t storedValue[8];
+    paramGet(index, value);
+    if (storageFetch(key, storedValue, paramLen) == paramLen && memcmp(value, storedValue, paramLen) == 0) {
+      paramStoredMark(index, true);
+      unchanged++;
+      continue;
+    }
+
+    if (storageStore(key, value, paramLen)) {
+      paramStoredMark(index, true);
+    } else {
+      result = false;
+    }
+    stored++;
+  }
+
+  if (stored > 0) {
+    result = storageFlush() && result;
+  }
+
+  static CRTPPacket pk;
+  pk.header = CRTP_HEADER(CRTP_PORT_PARAM, MISC_CH);
+  pk.data[0] = MISC_PERSISTENT_STORE_BULK_DONE;
+  pk.data[1] = stored;
+  pk.data[2] = unchanged;
+  pk.data[3] = result ? 0 : EIO;
+  pk.size = 4;
+  if (crtpSendPacket(&pk) == errQUEUE_FULL) {
+    DEBUG_PRINT("WARNING: Persistent store done not sent\n");
+  }
+
+  __atomic_store_n(&storeBulk.isRunning, false, __ATOMIC_RELEASE);
+}
+
+/* Bulk persistent store, the packet holds a sequence of ids. Without ids all
+ * the persistent parameters are stored. The values are written in the
+ * background, the answer only tells if the request is accepted. */
+void paramPersistentStoreBulk(CRTPPacket *p)
+{
+  uint8_t count = 0;
+  uint8_t result = 0;
+
+  if (__atomic_load_n(&storeBulk.isRunning, __ATOMIC_ACQUIRE)) {
+    result = EBUSY;
+  } else {
+    const uint8_t numIds = (p->size - 1) / sizeof(uint16_t);
+    for (; count < numIds; count++) {
+      uint16_t id;
+      memcpy(&id, &p->data[1 + count * sizeof(id)], sizeof(id));
+      const int index = variableGetIndex(id);
+      if (index < 0) {
+        result = ENOENT;
+        break;
+      }
+      storeBulk.indexes[count] = index;
+    }
+  }
+
+  if (result == 0) {
+    storeBulk.count = count;
+    storeBulk.isAll = (count == 0);
+    storeBulk.isRunning = true;
+
+    const workerOptions_t options = {.priority = WORKER_PRIORITY_LOW};
+    if (workerScheduleWithOptions(paramPersistentStoreBulkJob, NULL, &options) != 0) {
+      storeBulk.isRunning = false;
+      result = ENOMEM;
+    }
+  }
+
+  // On error, count is the position of the offending id
+  p->data[1] = count;
+  p->data[2] = result;
+  p->size = 3;
+  crtpSendPacketBlock(p);
+}
+
 void paramGetDefaultValue(CRTPPacket *p)
 {
   uint16_t id;
@@ -807,6 +1377,9 @@ void paramPersistentClear(CRTPPacket *p)
   generateStorageKey(index, key);
 
   result = storageDelete(key);
+  if (result) {
+    paramStoredMark(index, false);
+  }
 
   p->data[3] = result ? 0: ENOENT;
   p->size = 4;
@@ -823,6 +1396,8 @@ static bool persistentParamFromStorage(const char *key, void *buffer, size_t len
 
   if (PARAM_VARID_IS_VALID(varId)) {
     paramSet(varId.index, buffer);
+    paramNotifyChanged(varId.index);
+    paramStoredMark(varId.index, true);
   }
 
   return true;
@@ -33,6 +33,8 @@
 #include "param_logic.h"
 #include "debug.h"
 #include "static_mem.h"
+#include "mem.h"
+#include "boot_timeline.h"
 
 #include <string.h>
 
@@ -52,6 +54,20 @@ static CRTPPacket p;
 
 STATIC_MEM_TASK_ALLOC(paramTask, PARAM_TASK_STACKSIZE);
 
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_PARAM_TOC,
+  .getSize = paramTocBlobGetSize,
+  .read = paramTocBlobRead,
+  .write = 0, // Write not supported
+};
+
+static const MemoryHandlerDef_t memStateDef = {
+  .type = MEM_TYPE_PARAM_STATE,
+  .getSize = paramStateBlobGetSize,
+  .read = paramStateBlobRead,
+  .write = 0, // Write not supported
+};
+
 
 void paramInit(void)
 {
@@ -61,6 +77,9 @@ void paramInit(void)
 
   paramLogicInit();
   paramLogicStorageInit();
+  bootTimelineMark("paramLogicStorageInit");
+  memoryRegisterHandler(&memDef);
+  memoryRegisterHandler(&memStateDef);
 
   //Start the param task
   STATIC_MEM_TASK_CREATE(paramTask, paramTask, PARAM_TASK_NAME, NULL, PARAM_TASK_PRI);
@@ -103,9 +122,27 @@ void paramTask(void * prm)
         case MISC_PERSISTENT_CLEAR:
           paramPersistentClear(&p);
           break;
+        case MISC_PERSISTENT_STORE_BULK:
+          paramPersistentStoreBulk(&p);
+          break;
         case MISC_GET_DEFAULT_VALUE:
           paramGetDefaultValue(&p);
           break;
+        case MISC_BULK_WRITE:
+          paramBulkWrite(&p);
+          break;
+        case MISC_BULK_READ:
+          paramBulkRead(&p);
+          break;
+        case MISC_TXN_STAGE:
+          paramTransactionStage(&p);
+          break;
+        case MISC_TXN_COMMIT:
+          paramTransactionCommit(&p);
+          break;
+        case MISC_TXN_ABORT:
+          paramTransactionAbort(&p);
+          break;
         default:
           break;
       }
@@ -1,14 +1,121 @@
+#include <string.h>
+
 #include "config.h"
 #include "debug.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "log.h"
 #include "peer_localization.h"
 
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+#include "timers.h"
+#include "radiolink.h"
+#include "configblock.h"
+#include "stabilizer.h"
+#include "param.h"
+#endif
+
+
+// The peer table, and a direct map from radio ID to table index + 1. Zero
+// means that the ID is not in the table.
+static peerLocalizationTable_t table;
+static uint8_t idToIndex[256];
+
+// Number of peers that have been evicted to make room for a new peer.
+static uint32_t evictionCount = 0;
+
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+// The own state is broadcast on this P2P port, the DTR uses port 15
+#define PEER_STATE_P2P_PORT 14
+#define BROADCAST_PERIOD_MS (1000 / CONFIG_PEER_LOCALIZATION_BROADCAST_RATE)
+
+// Position [mm] and velocity [mm/s], 13 bytes to fit many peers in the P2P slots
+typedef struct {
+  uint8_t id;
+  int16_t pos[3];
+  int16_t vel[3];
+} __attribute__((packed)) peerStatePacket_t;
+
+static uint8_t broadcastEnable = 1;
+static uint32_t broadcastCount;
+static uint32_t receiveCount;
+static StaticTimer_t broadcastTimerBuffer;
+
+static int16_t toMilli(const float value)
+{
+  const float milli = value * 1000.0f;
+  if (milli > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (milli < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)milli;
+}
+
+static void broadcastTimer(xTimerHandle timer)
+{
+  if (!broadcastEnable) {
+    return;
+  }
+
+  state_t state;
+  stabilizerGetState(&state);
+
+  P2PPacket p2pp;
+  peerStatePacket_t* packet = (peerStatePacket_t*)p2pp.data;
+  p2pp.port = PEER_STATE_P2P_PORT;
+  p2pp.size = sizeof(peerStatePacket_t);
+  packet->id = configblockGetRadioAddress() & 0xFF;
+  packet->pos[0] = toMilli(state.position.x);
+  packet->pos[1] = toMilli(state.position.y);
+  packet->pos[2] = toMilli(state.position.z);
+  packet->vel[0] = toMilli(state.velocity.x);
+  packet->vel[1] = toMilli(state.velocity.y);
+  packet->vel[2] = toMilli(state.velocity.z);
+
+  // Queued for the own TDMA slot, never blocks
+  if (radiolinkSendP2PPacketBroadcast(&p2pp)) {
+    broadcastCount++;
+  }
+}
+
+bool peerLocalizationHandleP2P(P2PPacket *p2pp)
+{
+  if (p2pp->port != PEER_STATE_P2P_PORT || p2pp->size != sizeof(peerStatePacket_t)) {
+    return false;
+  }
+
+  peerStatePacket_t packet;
+  memcpy(&packet, p2pp->data, sizeof(packet));
+
+  positionMeasurement_t pos = {
+    .x = packet.pos[0] / 1000.0f,
+    .y = packet.pos[1] / 1000.0f,
+    .z = packet.pos[2] / 1000.0f,
+  };
+  velocity_t vel = {
+    .x = packet.vel[0] / 1000.0f,
+    .y = packet.vel[1] / 1000.0f,
+    .z = packet.vel[2] / 1000.0f,
+  };
+  if (peerLocalizationTellPositionVelocity(packet.id, &pos, &vel)) {
+    receiveCount++;
+  }
+
+  return true;
+}
+#endif
 
 void peerLocalizationInit()
 {
-  // All other_positions[in].id will be set to zero due to static initialization.
-  // If we ever switch to dynamic allocation, we need to set them to zero explicitly.
+  // The table and the map are empty due to static initialization.
+  // If we ever switch to dynamic allocation, we need to clear them explicitly.
+
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+  xTimerHandle timer = xTimerCreateStatic("peerLocTimer", M2T(BROADCAST_PERIOD_MS), pdTRUE, NULL, broadcastTimer, &broadcastTimerBuffer);
+  xTimerStart(timer, 100);
+#endif
 }
 
 bool peerLocalizationTest()
@@ -16,49 +123,131 @@ bool peerLocalizationTest()
   return true;
 }
 
-// array of other's position
-static peerLocalizationOtherPosition_t other_positions[PEER_LOCALIZATION_MAX_NEIGHBORS];
-
-bool peerLocalizationTellPosition(int cfid, positionMeasurement_t const *pos)
+// Returns the index of the peer with the oldest position. The table must not
+// be empty.
+static uint8_t findOldest(const uint32_t now)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == 0 || other_positions[i].id == cfid) {
-      other_positions[i].id = cfid;
-      other_positions[i].pos.x = pos->x;
-      other_positions[i].pos.y = pos->y;
-      other_positions[i].pos.z = pos->z;
-      other_positions[i].pos.timestamp = xTaskGetTickCount();
-      return true;
+  uint8_t oldest = 0;
+  for (uint8_t i = 1; i < table.count; ++i) {
+    if (now - table.timestamp[i] > now - table.timestamp[oldest]) {
+      oldest = i;
     }
   }
-  return false;
+  return oldest;
 }
 
-bool peerLocalizationIsIDActive(uint8_t cfid)
+static bool tellPosition(int cfid, positionMeasurement_t const *pos, velocity_t const *vel)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return true;
-    }
+  if (cfid <= 0 || cfid > UINT8_MAX) {
+    return false;
   }
-  return false;
+
+  const uint32_t now = xTaskGetTickCount();
+  uint8_t index;
+
+  if (idToIndex[cfid] != 0) {
+    index = idToIndex[cfid] - 1;
+  } else if (table.count < PEER_LOCALIZATION_MAX_NEIGHBORS) {
+    index = table.count;
+    table.count++;
+    idToIndex[cfid] = index + 1;
+    table.id[index] = cfid;
+  } else {
+    index = findOldest(now);
+    idToIndex[table.id[index]] = 0;
+    idToIndex[cfid] = index + 1;
+    table.id[index] = cfid;
+    evictionCount++;
+  }
+
+  table.x[index] = pos->x;
+  table.y[index] = pos->y;
+  table.z[index] = pos->z;
+  if (vel) {
+    table.vx[index] = vel->x;
+    table.vy[index] = vel->y;
+    table.vz[index] = vel->z;
+  }
+  table.hasVelocity[index] = (vel != 0);
+  table.timestamp[index] = now;
+  return true;
 }
 
-peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t cfid)
+bool peerLocalizationTellPosition(int cfid, positionMeasurement_t const *pos)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return &other_positions[i];
-    }
+  return tellPosition(cfid, pos, 0);
+}
+
+bool peerLocalizationTellPositionVelocity(int cfid, positionMeasurement_t const *pos, velocity_t const *vel)
+{
+  return tellPosition(cfid, pos, vel);
+}
+
+bool peerLocalizationIsIDActive(uint8_t cfid)
+{
+  return cfid != 0 && idToIndex[cfid] != 0;
+}
+
+bool peerLocalizationGetPositionByIdx(uint8_t idx, peerLocalizationOtherPosition_t *position)
+{
+  if (idx >= table.count) {
+    return false;
   }
-  return NULL;
+
+  position->id = table.id[idx];
+  position->pos.x = table.x[idx];
+  position->pos.y = table.y[idx];
+  position->pos.z = table.z[idx];
+  position->pos.timestamp = table.timestamp[idx];
+  return true;
 }
 
-peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx)
+bool peerLocalizationGetPositionByID(uint8_t cfid, peerLocalizationOtherPosition_t *position)
 {
-  // TODO: should we return NULL if the id == 0?
-  if (idx < PEER_LOCALIZATION_MAX_NEIGHBORS) {
-    return &other_positions[idx];
+  if (!peerLocalizationIsIDActive(cfid)) {
+    return false;
   }
-  return NULL;
+
+  return peerLocalizationGetPositionByIdx(idToIndex[cfid] - 1, position);
 }
+
+const peerLocalizationTable_t *peerLocalizationGetTable()
+{
+  return &table;
+}
+
+/**
+ * Peer localization, positions of other Crazyflies
+ */
+LOG_GROUP_START(peerLoc)
+  /**
+   * @brief Number of peers in the table
+   */
+  LOG_ADD(LOG_UINT8, count, &table.count)
+  /**
+   * @brief Number of peers that have been evicted to make room for a new peer
+   */
+  LOG_ADD(LOG_UINT32, evict, &evictionCount)
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+  /**
+   * @brief Number of own states queued for broadcast
+   */
+  LOG_ADD(LOG_UINT32, bcastTx, &broadcastCount)
+  /**
+   * @brief Number of peer states received
+   */
+  LOG_ADD(LOG_UINT32, bcastRx, &receiveCount)
+#endif
+LOG_GROUP_STOP(peerLoc)
+
+#ifdef CONFIG_PEER_LOCALIZATION_BROADCAST
+/**
+ * Peer localization, sharing of the own state with other Crazyflies
+ */
+PARAM_GROUP_START(peerLoc)
+  /**
+   * @brief Nonzero to broadcast the own position and velocity (default: 1)
+   */
+  PARAM_ADD(PARAM_UINT8, bcast, &broadcastEnable)
+PARAM_GROUP_STOP(peerLoc)
+#endif
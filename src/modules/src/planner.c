@@ -40,6 +40,11 @@ implementation of planning state machine
 
 static struct traj_eval plan_eval(struct planner *p, float t);
 
+// A rest to rest 7th order segment peaks at 35/16 times its average velocity
+#define PLAN_PEAK_TO_AVERAGE_VELOCITY (35.0f / 16.0f)
+// Duration of segments without motion that use the velocity limit
+#define PLAN_MIN_WAYPOINT_DURATION 0.5f
+
 static void plan_takeoff_or_landing(struct planner *p, struct vec curr_pos, float curr_yaw, float hover_height, float hover_yaw, float duration)
 {
 	struct vec hover_pos = curr_pos;
@@ -83,6 +88,9 @@ bool plan_is_finished(struct planner *p, float t)
 		case TRAJECTORY_TYPE_PIECEWISE_COMPRESSED:
 		  return piecewise_compressed_is_finished(p->compressed_trajectory, t);
 
+		case TRAJECTORY_TYPE_PIECEWISE_STREAM:
+		  return piecewise_stream_is_finished(p->stream_trajectory, t);
+
 		default:
 		  return 1;
 	}
@@ -141,6 +149,16 @@ struct traj_eval plan_eval(struct planner *p, float t)
 			}
 			break;
 
+		case TRAJECTORY_TYPE_PIECEWISE_STREAM:
+			if (p->reversed) {
+				/* not supported */
+				return traj_eval_invalid();
+			}
+			else {
+				return piecewise_stream_eval(p->stream_trajectory, t);
+			}
+			break;
+
 		default:
 			return traj_eval_invalid();
 	}
@@ -200,6 +218,75 @@ int plan_go_to_from(struct planner *p, const struct traj_eval *curr_eval, bool r
 	return 0;
 }
 
+int plan_go_to_waypoints_from(struct planner *p, const struct traj_eval *curr_eval, bool relative,
+	const struct plan_waypoint *waypoints, int n_waypoints, float max_velocity, float t)
+{
+	if (n_waypoints < 1 || n_waypoints > PLAN_MAX_WAYPOINTS) {
+		return 1;
+	}
+
+	// the route, starting from the current setpoint
+	struct vec pos[PLAN_MAX_WAYPOINTS + 1];
+	float yaw[PLAN_MAX_WAYPOINTS + 1];
+	float duration[PLAN_MAX_WAYPOINTS];
+
+	pos[0] = curr_eval->pos;
+	yaw[0] = normalize_radians(curr_eval->yaw);
+	for (int i = 0; i < n_waypoints; ++i) {
+		struct plan_waypoint const *wp = &waypoints[i];
+		pos[i + 1] = relative ? vadd(wp->pos, curr_eval->pos) : wp->pos;
+
+		// compute the shortest possible rotation from the previous waypoint
+		float goal_yaw = normalize_radians(relative ? wp->yaw + curr_eval->yaw : wp->yaw);
+		yaw[i + 1] = yaw[i] + shortest_signed_angle_radians(normalize_radians(yaw[i]), goal_yaw);
+
+		duration[i] = wp->duration;
+		if (duration[i] <= 0.0f) {
+			if (max_velocity <= 0.0f) {
+				return 1;
+			}
+			float dist = vmag(vsub(pos[i + 1], pos[i]));
+			duration[i] = fmaxf(PLAN_PEAK_TO_AVERAGE_VELOCITY * dist / max_velocity, PLAN_MIN_WAYPOINT_DURATION);
+		}
+	}
+
+	// pass the intermediate waypoints with the velocity of the chord between
+	// the neighbouring waypoints and no acceleration, stop at the last one
+	struct vec vel_start = curr_eval->vel;
+	float dyaw_start = curr_eval->omega.z;
+	struct vec acc_start = curr_eval->acc;
+	for (int i = 0; i < n_waypoints; ++i) {
+		struct vec vel_end = vzero();
+		float dyaw_end = 0;
+		if (i + 1 < n_waypoints) {
+			float dt = duration[i] + duration[i + 1];
+			vel_end = vdiv(vsub(pos[i + 2], pos[i]), dt);
+			dyaw_end = (yaw[i + 2] - yaw[i]) / dt;
+		}
+
+		poly4d_plan_7th_order_no_jerk(&p->pieces[i], duration[i],
+			pos[i],     yaw[i],     vel_start, dyaw_start, acc_start,
+			pos[i + 1], yaw[i + 1], vel_end,   dyaw_end,   vzero());
+
+		vel_start = vel_end;
+		dyaw_start = dyaw_end;
+		acc_start = vzero();
+	}
+
+	p->planned_trajectory.timescale = 1.0;
+	p->planned_trajectory.scale = vrepeat(1.0f);
+	p->planned_trajectory.shift = vzero();
+	p->planned_trajectory.n_pieces = n_waypoints;
+	piecewise_reset_cache(&p->planned_trajectory);
+
+	p->reversed = false;
+	p->state = TRAJECTORY_STATE_FLYING;
+	p->type = TRAJECTORY_TYPE_PIECEWISE;
+	p->planned_trajectory.t_begin = t;
+	p->trajectory = &p->planned_trajectory;
+	return 0;
+}
+
 int plan_go_to(struct planner *p, bool relative, struct vec hover_pos, float hover_yaw, float duration, float t)
 {
 	struct traj_eval setpoint = plan_current_goal(p, t);
@@ -212,6 +299,7 @@ int plan_start_trajectory(struct planner *p, struct piecewise_traj* trajectory,
 	p->state = TRAJECTORY_STATE_FLYING;
 	p->type = TRAJECTORY_TYPE_PIECEWISE;
 	p->trajectory = trajectory;
+	piecewise_reset_cache(trajectory);
 
 	if (relative) {
 		struct traj_eval traj_init;
@@ -252,3 +340,24 @@ int plan_start_compressed_trajectory( struct planner *p, struct piecewise_traj_c
 
 	return 0;
 }
+
+int plan_start_stream_trajectory(struct planner *p, struct piecewise_traj_stream* trajectory, bool relative, struct vec start_from)
+{
+	p->reversed = 0;
+	p->state = TRAJECTORY_STATE_FLYING;
+	p->type = TRAJECTORY_TYPE_PIECEWISE_STREAM;
+	p->stream_trajectory = trajectory;
+
+	if (relative) {
+		trajectory->shift = vzero();
+		struct traj_eval traj_init = piecewise_stream_eval(
+			trajectory, trajectory->t_begin
+		);
+		struct vec shift_pos = vsub(start_from, traj_init.pos);
+		trajectory->shift = shift_pos;
+	} else {
+		trajectory->shift = vzero();
+	}
+
+	return 0;
+}
@@ -36,11 +36,13 @@
 #include "crtp.h"
 #include "platformservice.h"
 #include "syslink.h"
+#include "radiolink.h"
 #include "version.h"
 #include "platform.h"
 #include "app_channel.h"
 #include "static_mem.h"
 #include "supervisor.h"
+#include "stabilizer_profiler.h"
 
 static bool isInit=false;
 STATIC_MEM_TASK_ALLOC_STACK_NO_DMA_CCM_SAFE(platformSrvTask, PLATFORM_SRV_TASK_STACKSIZE);
@@ -49,14 +51,28 @@ typedef enum {
   platformCommand   = 0x00,
   versionCommand    = 0x01,
   appChannel        = 0x02,
+  appStream         = 0x03,
 } Channel;
 
 typedef enum {
   setContinuousWave  = 0x00,
   armSystem          = 0x01,
   recoverSystem     = 0x02, 
+  getStabilizerProfile = 0x03,
+  setLinkAggregation = 0x04,
+  getCrtpStats = 0x05,
 } PlatformCommand;
 
+typedef enum {
+  crtpStatsCounters = 0x00,
+  crtpStatsTxChannels = 0x01,
+  crtpStatsRxChannels = 0x02,
+  crtpStatsTxLatency = 0x03,
+} CrtpStatsPage;
+
+// Port number used to query the link layer statistics
+#define CRTP_STATS_LINK_PORT 0xFF
+
 typedef enum {
   getProtocolVersion = 0x00,
   getFirmwareVersion = 0x01,
@@ -106,6 +122,9 @@ static void platformSrvTask(void* prm)
       case appChannel:
         appchannelIncomingPacket(&p);
         break;
+      case appStream:
+        appchannelStreamIncomingPacket(&p);
+        break;
       default:
         break;
     }
@@ -144,6 +163,77 @@ static void platformCommandProcess(CRTPPacket *p)
       p->size = 2;
       break;
     }    
+    case getStabilizerProfile:
+    {
+      // Request: stage. Response: stage, number of iterations, histogram bins as uint16
+      const stabilizerProfilerStageStats_t* stats = stabilizerProfilerGetStage(data[0]);
+      if (stats) {
+        uint16_t bins[STABILIZER_PROFILER_HISTOGRAM_BINS];
+        taskENTER_CRITICAL();
+        memcpy(bins, stats->latestBins, sizeof(bins));
+        taskEXIT_CRITICAL();
+
+        uint16_t count = 0;
+        for (int i = 0; i < STABILIZER_PROFILER_HISTOGRAM_BINS; i++) {
+          count += bins[i];
+        }
+        memcpy(&data[1], &count, sizeof(count));
+        memcpy(&data[3], bins, sizeof(bins));
+        p->size = 1 + 3 + sizeof(bins);
+      } else {
+        // Unknown stage, only the request is returned
+        p->size = 2;
+      }
+      break;
+    }
+    case setLinkAggregation:
+    {
+      data[0] = radiolinkSetAggregation(data[0] != 0);
+      p->size = 2;
+      break;
+    }
+    case getCrtpStats:
+    {
+      // Request: port, page. Response: port, page, page data
+      const uint8_t port = data[0];
+      const uint8_t page = data[1];
+      p->size = 3;
+
+      if (port == CRTP_STATS_LINK_PORT) {
+        const crtpLinkStats_t* stats = crtpGetLinkStats();
+        memcpy(&data[2], &stats->retries, sizeof(stats->retries));
+        memcpy(&data[6], stats->sendLatency, sizeof(stats->sendLatency));
+        p->size = 3 + sizeof(stats->retries) + sizeof(stats->sendLatency);
+        break;
+      }
+
+      const crtpPortStats_t* stats = crtpGetPortStats(port);
+      if (!stats) {
+        break;
+      }
+
+      switch (page) {
+        case crtpStatsCounters:
+          memcpy(&data[2], &stats->txPackets, 5 * sizeof(uint32_t));
+          p->size = 3 + 5 * sizeof(uint32_t);
+          break;
+        case crtpStatsTxChannels:
+          memcpy(&data[2], stats->txChannelPackets, sizeof(stats->txChannelPackets));
+          p->size = 3 + sizeof(stats->txChannelPackets);
+          break;
+        case crtpStatsRxChannels:
+          memcpy(&data[2], stats->rxChannelPackets, sizeof(stats->rxChannelPackets));
+          p->size = 3 + sizeof(stats->rxChannelPackets);
+          break;
+        case crtpStatsTxLatency:
+          memcpy(&data[2], stats->txLatency, sizeof(stats->txLatency));
+          p->size = 3 + sizeof(stats->txLatency);
+          break;
+        default:
+          break;
+      }
+      break;
+    }
     default:
       break;
   }
@@ -163,6 +253,13 @@ int platformserviceSendAppchannelPacketBlock(CRTPPacket *p)
   return crtpSendPacketBlock(p);
 }
 
+int platformserviceSendAppStreamPacket(CRTPPacket *p)
+{
+  p->port = CRTP_PORT_PLATFORM;
+  p->channel = appStream;
+  return crtpSendPacket(p);
+}
+
 static void versionCommandProcess(CRTPPacket *p)
 {
   switch (p->data[0]) {
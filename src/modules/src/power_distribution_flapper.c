@@ -73,6 +73,18 @@ static float pitch_ampl = 0.4f; // 1 = full servo stroke
   uint32_t idYaw = 2;
 #endif
 
+// Mixing terms that only depend on the flapper parameters, updated by
+// updateMixing() when any of them is changed
+struct flapperMixing_s {
+  float pitchServoNeutral;
+  float yawServoNeutral;
+  float leftThrustGain;
+  float rightThrustGain;
+  float maxThrust;
+};
+
+static struct flapperMixing_s mixing;
+
 static uint8_t limitServoNeutral(uint8_t value)
 {
   if(value > 75)
@@ -87,7 +99,7 @@ static uint8_t limitServoNeutral(uint8_t value)
   return (uint8_t)value;
 }
 
-static int8_t limitRollBias(uint8_t value)
+static int8_t limitRollBias(int8_t value)
 {
   if(value > 25)
   {
@@ -98,7 +110,20 @@ static int8_t limitRollBias(uint8_t value)
     value = -25;
   }
 
-  return (uint8_t)value;
+  return value;
+}
+
+static void updateMixing(void)
+{
+  flapperConfig.pitchServoNeutral = limitServoNeutral(flapperConfig.pitchServoNeutral);
+  flapperConfig.yawServoNeutral = limitServoNeutral(flapperConfig.yawServoNeutral);
+  flapperConfig.rollBias = limitRollBias(flapperConfig.rollBias);
+
+  mixing.pitchServoNeutral = flapperConfig.pitchServoNeutral * act_max / 100.0f;
+  mixing.yawServoNeutral = flapperConfig.yawServoNeutral * act_max / 100.0f;
+  mixing.leftThrustGain = 1.0f + flapperConfig.rollBias / 100.0f;
+  mixing.rightThrustGain = 1.0f - flapperConfig.rollBias / 100.0f;
+  mixing.maxThrust = flapperConfig.maxThrust;
 }
 
 int powerDistributionMotorType(uint32_t id)
@@ -117,11 +142,11 @@ uint16_t powerDistributionStopRatio(uint32_t id)
   uint16_t stopRatio = 0;
   if (id == idPitch)
   {
-    stopRatio = flapperConfig.pitchServoNeutral*act_max/100.0f;
+    stopRatio = mixing.pitchServoNeutral;
   }
   else if (id == idYaw)
   {
-    stopRatio = flapperConfig.yawServoNeutral*act_max/100.0f;
+    stopRatio = mixing.yawServoNeutral;
   }
 
   return stopRatio;
@@ -135,6 +160,7 @@ void powerDistributionInit(void)
     DEBUG_PRINT("Using Flapper power distribution | PCB revD (2022) or newer\n");
   #endif
 
+  updateMixing();
 }
 
 bool powerDistributionTest(void)
@@ -162,22 +188,18 @@ void powerDistribution(const control_t *control, motors_thrust_uncapped_t* motor
   // Only legacy mode is currently supported
   ASSERT(control->controlMode == controlModeLegacy);
 
-  thrust = fmin(control->thrust, flapperConfig.maxThrust);
-
-  flapperConfig.pitchServoNeutral=limitServoNeutral(flapperConfig.pitchServoNeutral);
-  flapperConfig.yawServoNeutral=limitServoNeutral(flapperConfig.yawServoNeutral);
-  flapperConfig.rollBias=limitRollBias(flapperConfig.rollBias);
+  thrust = fminf(control->thrust, mixing.maxThrust);
 
   #if CONFIG_POWER_DISTRIBUTION_FLAPPER_REVB
-    motorThrustUncapped->motors.m2 = flapperConfig.pitchServoNeutral*act_max / 100.0f + pitch_ampl * control->pitch; // pitch servo
-    motorThrustUncapped->motors.m3 = flapperConfig.yawServoNeutral*act_max / 100.0f - control->yaw; // yaw servo
-    motorThrustUncapped->motors.m1 =  0.5f * control->roll + thrust * (1.0f + flapperConfig.rollBias / 100.0f); // left motor
-    motorThrustUncapped->motors.m4 = -0.5f * control->roll + thrust * (1.0f - flapperConfig.rollBias / 100.0f); // right motor
+    motorThrustUncapped->motors.m2 = mixing.pitchServoNeutral + pitch_ampl * control->pitch; // pitch servo
+    motorThrustUncapped->motors.m3 = mixing.yawServoNeutral - control->yaw; // yaw servo
+    motorThrustUncapped->motors.m1 =  0.5f * control->roll + thrust * mixing.leftThrustGain; // left motor
+    motorThrustUncapped->motors.m4 = -0.5f * control->roll + thrust * mixing.rightThrustGain; // right motor
   #else
-    motorThrustUncapped->motors.m1 = flapperConfig.pitchServoNeutral * act_max / 100.0f + pitch_ampl * control->pitch; // pitch servo
-    motorThrustUncapped->motors.m3 = flapperConfig.yawServoNeutral*act_max / 100.0f - control->yaw; // yaw servo
-    motorThrustUncapped->motors.m2 =  0.5f * control->roll + thrust * (1.0f + flapperConfig.rollBias / 100.0f); // left motor
-    motorThrustUncapped->motors.m4 = -0.5f * control->roll + thrust * (1.0f - flapperConfig.rollBias / 100.0f); // right motor
+    motorThrustUncapped->motors.m1 = mixing.pitchServoNeutral + pitch_ampl * control->pitch; // pitch servo
+    motorThrustUncapped->motors.m3 = mixing.yawServoNeutral - control->yaw; // yaw servo
+    motorThrustUncapped->motors.m2 =  0.5f * control->roll + thrust * mixing.leftThrustGain; // left motor
+    motorThrustUncapped->motors.m4 = -0.5f * control->roll + thrust * mixing.rightThrustGain; // right motor
   #endif
 }
 
@@ -236,7 +258,7 @@ PARAM_GROUP_START(flapper)
  * is observed, which in flight results in a drift in roll/sideways flight. Positive values make the drone roll
  * more to the right, negative values to the left.
  */
-PARAM_ADD(PARAM_INT8 | PARAM_PERSISTENT, motBiasRoll, &flapperConfig.rollBias)
+PARAM_ADD_WITH_CALLBACK(PARAM_INT8 | PARAM_PERSISTENT, motBiasRoll, &flapperConfig.rollBias, updateMixing)
 /**
  * @brief Pitch servo neutral <25%; 75%> (default 50%)
  *
@@ -244,20 +266,20 @@ PARAM_ADD(PARAM_INT8 | PARAM_PERSISTENT, motBiasRoll, &flapperConfig.rollBias)
  * aligned when observed from the side. If in flight you observe too much drift forward (nose down) increase the value
  * and vice versa if the drift is backward (nose up).
  */
-PARAM_ADD(PARAM_UINT8 | PARAM_PERSISTENT, servPitchNeutr, &flapperConfig.pitchServoNeutral)
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8 | PARAM_PERSISTENT, servPitchNeutr, &flapperConfig.pitchServoNeutral, updateMixing)
 /**
  * @brief Yaw servo neutral <25%; 75%> (default 50%)
  *
  * The parameter sets the neutral position of the yaw servo, such that the yaw control arm is pointed spanwise. If in flight
  * you observe drift in the clock-wise direction, increase this parameter and vice-versa if the drift is counter-clock-wise.
  */
-PARAM_ADD(PARAM_UINT8 | PARAM_PERSISTENT, servYawNeutr, &flapperConfig.yawServoNeutral)
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8 | PARAM_PERSISTENT, servYawNeutr, &flapperConfig.yawServoNeutral, updateMixing)
 /**
  * @brief Yaw servo neutral <25%; 75%> (default 50%)
  *
  * The parameter sets the neutral position of the yaw servo, such that the yaw control arm is pointed spanwise. If in flight
  * you observe drift in the clock-wise direction, increase this parameter and vice-versa if the drift is counter-clock-wise.
  */
-PARAM_ADD(PARAM_UINT16 | PARAM_PERSISTENT, flapperMaxThrust, &flapperConfig.maxThrust)
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT16 | PARAM_PERSISTENT, flapperMaxThrust, &flapperConfig.maxThrust, updateMixing)
 
 PARAM_GROUP_STOP(flapper)
@@ -100,27 +100,59 @@ static void powerDistributionLegacy(const control_t *control, motors_thrust_unca
   motorThrustUncapped->motors.m4 = control->thrust + r + p - control->yaw;
 }
 
-static void powerDistributionForceTorque(const control_t *control, motors_thrust_uncapped_t* motorThrustUncapped) {
-  static float motorForces[STABILIZER_NR_OF_MOTORS];
+// Constant parts of the force/torque mixing and of the force to PWM conversion. Derived from the system
+// identification parameters and updated when any of them are changed.
+static struct {
+  float armLength;
+  float thrustToTorque;
+  float pwmToThrustA;
+  float pwmToThrustB;
+
+  float rollPitchScale;
+  float yawScale;
+  float bSquared;
+  float fourA;
+  float inverseTwoA;
+} mixer;
+
+static void updateMixer() {
+  if (mixer.armLength == armLength && mixer.thrustToTorque == thrustToTorque &&
+      mixer.pwmToThrustA == pwmToThrustA && mixer.pwmToThrustB == pwmToThrustB) {
+    return;
+  }
+
+  mixer.armLength = armLength;
+  mixer.thrustToTorque = thrustToTorque;
+  mixer.pwmToThrustA = pwmToThrustA;
+  mixer.pwmToThrustB = pwmToThrustB;
 
   const float arm = 0.707106781f * armLength;
-  const float rollPart = 0.25f / arm * control->torqueX;
-  const float pitchPart = 0.25f / arm * control->torqueY;
+  mixer.rollPitchScale = 0.25f / arm;
+  mixer.yawScale = 0.25f / thrustToTorque;
+  mixer.bSquared = pwmToThrustB * pwmToThrustB;
+  mixer.fourA = 4.0f * pwmToThrustA;
+  mixer.inverseTwoA = 1.0f / (2.0f * pwmToThrustA);
+}
+
+static void powerDistributionForceTorque(const control_t *control, motors_thrust_uncapped_t* motorThrustUncapped) {
+  float motorForces[STABILIZER_NR_OF_MOTORS];
+
+  updateMixer();
+
+  const float rollPart = mixer.rollPitchScale * control->torqueX;
+  const float pitchPart = mixer.rollPitchScale * control->torqueY;
   const float thrustPart = 0.25f * control->thrustSi; // N (per rotor)
-  const float yawPart = 0.25f * control->torqueZ / thrustToTorque;
+  const float yawPart = mixer.yawScale * control->torqueZ;
 
   motorForces[0] = thrustPart - rollPart - pitchPart - yawPart;
   motorForces[1] = thrustPart - rollPart + pitchPart + yawPart;
   motorForces[2] = thrustPart + rollPart + pitchPart - yawPart;
   motorForces[3] = thrustPart + rollPart - pitchPart + yawPart;
 
+  // thrust = a * pwm^2 + b * pwm  =>  pwm = (-b + sqrt(b^2 + 4 * a * thrust)) / (2 * a)
   for (int motorIndex = 0; motorIndex < STABILIZER_NR_OF_MOTORS; motorIndex++) {
-    float motorForce = motorForces[motorIndex];
-    if (motorForce < 0.0f) {
-      motorForce = 0.0f;
-    }
-
-    float motor_pwm = (-pwmToThrustB + sqrtf(pwmToThrustB * pwmToThrustB + 4.0f * pwmToThrustA * motorForce)) / (2.0f * pwmToThrustA);
+    const float motorForce = fmaxf(motorForces[motorIndex], 0.0f);
+    const float motor_pwm = (sqrtf(mixer.bSquared + mixer.fourA * motorForce) - mixer.pwmToThrustB) * mixer.inverseTwoA;
     motorThrustUncapped->list[motorIndex] = motor_pwm * UINT16_MAX;
   }
 }
@@ -289,27 +289,53 @@ bool is_traj_eval_valid(struct traj_eval const *ev)
 	return !visnan(ev->pos);
 }
 
+// evaluate a polynomial and its first three derivatives in one pass of
+// horner's rule (repeated synthetic division). the k:th running sum is the
+// k:th taylor coefficient at t, i.e. the k:th derivative divided by k!.
+static void polyval_derivs(float const p[PP_SIZE], float t, float d[4])
+{
+	float d0 = 0.0f, d1 = 0.0f, d2 = 0.0f, d3 = 0.0f;
+	for (int i = PP_DEGREE; i >= 0; --i) {
+		d3 = d3 * t + d2;
+		d2 = d2 * t + d1;
+		d1 = d1 * t + d0;
+		d0 = d0 * t + p[i];
+	}
+	d[0] = d0;
+	d[1] = d1;
+	d[2] = 2.0f * d2;
+	d[3] = 6.0f * d3;
+}
+
+// as above, value and first derivative only
+static void polyval_deriv1(float const p[PP_SIZE], float t, float d[2])
+{
+	float d0 = 0.0f, d1 = 0.0f;
+	for (int i = PP_DEGREE; i >= 0; --i) {
+		d1 = d1 * t + d0;
+		d0 = d0 * t + p[i];
+	}
+	d[0] = d0;
+	d[1] = d1;
+}
+
 struct traj_eval poly4d_eval(struct poly4d const *p, float t)
 {
-	// flat variables
 	struct traj_eval out;
-	out.pos = polyval_xyz(p, t);
-	out.yaw = polyval_yaw(p, t);
-
-	// 1st derivative
-	struct poly4d* deriv = &poly4d_tmp;
-	*deriv = *p;
-	polyder4d(deriv);
-	out.vel = polyval_xyz(deriv, t);
-	float dyaw = polyval_yaw(deriv, t);
 
-	// 2nd derivative
-	polyder4d(deriv);
-	out.acc = polyval_xyz(deriv, t);
+	// flat variables and their derivatives, without copying or
+	// differentiating the polynomial
+	float dx[4], dy[4], dz[4], dyaw[2];
+	polyval_derivs(p->p[0], t, dx);
+	polyval_derivs(p->p[1], t, dy);
+	polyval_derivs(p->p[2], t, dz);
+	polyval_deriv1(p->p[3], t, dyaw);
 
-	// 3rd derivative
-	polyder4d(deriv);
-	out.jerk = polyval_xyz(deriv, t);
+	out.pos = mkvec(dx[0], dy[0], dz[0]);
+	out.vel = mkvec(dx[1], dy[1], dz[1]);
+	out.acc = mkvec(dx[2], dy[2], dz[2]);
+	out.jerk = mkvec(dx[3], dy[3], dz[3]);
+	out.yaw = dyaw[0];
 
 	struct vec thrust = vadd(out.acc, mkvec(0, 0, GRAV));
 	// float thrust_mag = mass * vmag(thrust);
@@ -324,36 +350,131 @@ struct traj_eval poly4d_eval(struct poly4d const *p, float t)
 
 	out.omega.x = -vdot(h_w, y_body);
 	out.omega.y = vdot(h_w, x_body);
-	out.omega.z = z_body.z * dyaw;
+	out.omega.z = z_body.z * dyaw[1];
 
 	return out;
 }
 
+struct traj_bounds traj_bounds_zero()
+{
+	struct traj_bounds bounds = {0};
+	return bounds;
+}
+
+void poly4d_bounds_approx(struct poly4d const *p, struct traj_bounds *bounds)
+{
+	int steps = ceilf(p->duration / POLY4D_BOUNDS_SAMPLE_TIME);
+	if (steps < 1) {
+		steps = 1;
+	}
+	float step = p->duration / steps;
+	for (int i = 0; i <= steps; ++i) {
+		struct traj_eval ev = poly4d_eval(p, i * step);
+		struct vec thrust = vadd(ev.acc, mkvec(0, 0, GRAV));
+		float thrust_mag = vmag(thrust);
+		// no thrust (free fall) counts as fully tilted
+		float tilt = thrust_mag > 0 ? acosf(fminf(thrust.z / thrust_mag, 1.0f)) : M_PI_2_F;
+
+		bounds->max_vel = fmaxf(bounds->max_vel, vmag(ev.vel));
+		bounds->max_acc = fmaxf(bounds->max_acc, vmag(ev.acc));
+		bounds->max_jerk = fmaxf(bounds->max_jerk, vmag(ev.jerk));
+		bounds->max_tilt = fmaxf(bounds->max_tilt, tilt);
+	}
+	bounds->duration += p->duration;
+}
+
 //
 // piecewise 4d polynomials
 //
 
 // piecewise eval
+static bool piecewise_cache_is_valid(struct piecewise_traj const *traj, bool reversed)
+{
+	return traj->current_piece.pieces == traj->pieces
+		&& traj->current_piece.n_pieces == traj->n_pieces
+		&& traj->current_piece.t_begin == traj->t_begin
+		&& traj->current_piece.timescale == traj->timescale
+		&& veq(traj->current_piece.scale, traj->scale)
+		&& veq(traj->current_piece.shift, traj->shift)
+		&& traj->current_piece.reversed == reversed
+		&& traj->current_piece.position >= 0
+		&& traj->current_piece.position < traj->n_pieces;
+}
+
+static inline struct poly4d const *piecewise_piece_at(struct piecewise_traj const *traj, int position, bool reversed)
+{
+	return &traj->pieces[reversed ? traj->n_pieces - 1 - position : position];
+}
+
+static void piecewise_build_current_piece(struct piecewise_traj *traj, bool reversed)
+{
+	struct poly4d *poly = &traj->current_piece.poly4d;
+	*poly = *piecewise_piece_at(traj, traj->current_piece.position, reversed);
+	poly4d_scale(poly, traj->scale.x, traj->scale.y, traj->scale.z, 1);
+	poly4d_shift(poly, traj->shift.x, traj->shift.y, traj->shift.z, 0);
+	poly4d_stretchtime(poly, traj->timescale);
+	if (reversed) {
+		for (int i = 0; i < 4; ++i) {
+			polyreflect(poly->p[i]);
+		}
+	}
+}
+
+// Move the playhead to the piece that contains t (relative to t_begin) and
+// rebuild the cached piece if it changed. Returns false if t is after the end
+// of the trajectory.
+static bool piecewise_seek(struct piecewise_traj *traj, float t, bool reversed)
+{
+	if (!piecewise_cache_is_valid(traj, reversed)) {
+		traj->current_piece.pieces = traj->pieces;
+		traj->current_piece.n_pieces = traj->n_pieces;
+		traj->current_piece.t_begin = traj->t_begin;
+		traj->current_piece.timescale = traj->timescale;
+		traj->current_piece.scale = traj->scale;
+		traj->current_piece.shift = traj->shift;
+		traj->current_piece.reversed = reversed;
+		traj->current_piece.position = 0;
+		traj->current_piece.t_begin_relative = 0;
+		piecewise_build_current_piece(traj, reversed);
+	}
+
+	int position = traj->current_piece.position;
+	float start = traj->current_piece.t_begin_relative;
+
+	while (position > 0 && t < start) {
+		--position;
+		start -= piecewise_piece_at(traj, position, reversed)->duration * traj->timescale;
+	}
+
+	float duration = piecewise_piece_at(traj, position, reversed)->duration * traj->timescale;
+	while (t > start + duration) {
+		if (position == traj->n_pieces - 1) {
+			return false;
+		}
+		start += duration;
+		++position;
+		duration = piecewise_piece_at(traj, position, reversed)->duration * traj->timescale;
+	}
+
+	traj->current_piece.t_begin_relative = start;
+	if (position != traj->current_piece.position) {
+		traj->current_piece.position = position;
+		piecewise_build_current_piece(traj, reversed);
+	}
+	return true;
+}
+
 struct traj_eval piecewise_eval(
-  struct piecewise_traj const *traj, float t)
+  struct piecewise_traj *traj, float t)
 {
-	int cursor = 0;
 	t = t - traj->t_begin;
-	while (cursor < traj->n_pieces) {
-		struct poly4d const *piece = &(traj->pieces[cursor]);
-		if (t <= piece->duration * traj->timescale) {
-			poly4d_tmp = *piece;
-			poly4d_shift(&poly4d_tmp, traj->shift.x, traj->shift.y, traj->shift.z, 0);
-			poly4d_stretchtime(&poly4d_tmp, traj->timescale);
-			return poly4d_eval(&poly4d_tmp, t);
-		}
-		t -= piece->duration * traj->timescale;
-		++cursor;
+	if (traj->n_pieces > 0 && piecewise_seek(traj, t, false)) {
+		return poly4d_eval(&traj->current_piece.poly4d, t - traj->current_piece.t_begin_relative);
 	}
 	// if we get here, the trajectory has ended
 	struct poly4d const *end_piece = &(traj->pieces[traj->n_pieces - 1]);
 	struct traj_eval ev = poly4d_eval(end_piece, end_piece->duration);
-	ev.pos = vadd(ev.pos, traj->shift);
+	ev.pos = vadd(veltmul(ev.pos, traj->scale), traj->shift);
 	ev.vel = vzero();
 	ev.acc = vzero();
 	ev.jerk = vzero();
@@ -362,29 +483,18 @@ struct traj_eval piecewise_eval(
 }
 
 struct traj_eval piecewise_eval_reversed(
-  struct piecewise_traj const *traj, float t)
+  struct piecewise_traj *traj, float t)
 {
-	int cursor = traj->n_pieces - 1;
 	t = t - traj->t_begin;
-	while (cursor >= 0) {
-		struct poly4d const *piece = &(traj->pieces[cursor]);
-		if (t <= piece->duration * traj->timescale) {
-			poly4d_tmp = *piece;
-			poly4d_shift(&poly4d_tmp, traj->shift.x, traj->shift.y, traj->shift.z, 0);
-			poly4d_stretchtime(&poly4d_tmp, traj->timescale);
-			for (int i = 0; i < 4; ++i) {
-				polyreflect(poly4d_tmp.p[i]);
-			}
-			t = t - piece->duration * traj->timescale;
-			return poly4d_eval(&poly4d_tmp, t);
-		}
-		t -= piece->duration * traj->timescale;
-		--cursor;
+	if (traj->n_pieces > 0 && piecewise_seek(traj, t, true)) {
+		// the reflected piece runs from -duration to 0
+		struct poly4d const *piece = &traj->current_piece.poly4d;
+		return poly4d_eval(piece, t - traj->current_piece.t_begin_relative - piece->duration);
 	}
 	// if we get here, the trajectory has ended
 	struct poly4d const *end_piece = &(traj->pieces[0]);
 	struct traj_eval ev = poly4d_eval(end_piece, 0.0f);
-	ev.pos = vadd(ev.pos, traj->shift);
+	ev.pos = vadd(veltmul(ev.pos, traj->scale), traj->shift);
 	ev.vel = vzero();
 	ev.acc = vzero();
 	ev.jerk = vzero();
@@ -401,8 +511,10 @@ void piecewise_plan_5th_order(struct piecewise_traj *pp, float duration,
 	struct poly4d *p = &pp->pieces[0];
 	p->duration = duration;
 	pp->timescale = 1.0;
+	pp->scale = vrepeat(1.0f);
 	pp->shift = vzero();
 	pp->n_pieces = 1;
+	piecewise_reset_cache(pp);
 	poly5(p->p[0], duration, p0.x, v0.x, a0.x, p1.x, v1.x, a1.x);
 	poly5(p->p[1], duration, p0.y, v0.y, a0.y, p1.y, v1.y, a1.y);
 	poly5(p->p[2], duration, p0.z, v0.z, a0.z, p1.z, v1.z, a1.z);
@@ -414,11 +526,21 @@ void piecewise_plan_7th_order_no_jerk(struct piecewise_traj *pp, float duration,
 	struct vec p0, float y0, struct vec v0, float dy0, struct vec a0,
 	struct vec p1, float y1, struct vec v1, float dy1, struct vec a1)
 {
-	struct poly4d *p = &pp->pieces[0];
-	p->duration = duration;
 	pp->timescale = 1.0;
+	pp->scale = vrepeat(1.0f);
 	pp->shift = vzero();
 	pp->n_pieces = 1;
+	piecewise_reset_cache(pp);
+	poly4d_plan_7th_order_no_jerk(&pp->pieces[0], duration,
+		p0, y0, v0, dy0, a0,
+		p1, y1, v1, dy1, a1);
+}
+
+void poly4d_plan_7th_order_no_jerk(struct poly4d *p, float duration,
+	struct vec p0, float y0, struct vec v0, float dy0, struct vec a0,
+	struct vec p1, float y1, struct vec v1, float dy1, struct vec a1)
+{
+	p->duration = duration;
 	poly7_nojerk(p->p[0], duration, p0.x, v0.x, a0.x, p1.x, v1.x, a1.x);
 	poly7_nojerk(p->p[1], duration, p0.y, v0.y, a0.y, p1.y, v1.y, a1.y);
 	poly7_nojerk(p->p[2], duration, p0.z, v0.z, a0.z, p1.z, v1.z, a1.z);
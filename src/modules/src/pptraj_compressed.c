@@ -58,7 +58,7 @@ struct compressed_piece_parsed_header
   compressed_piece_ptr body;
 };
 
-static float calculate_total_duration(compressed_piece_ptr ptr);
+static void build_index(struct piecewise_traj_compressed *traj);
 static compressed_piece_ptr next_coordinate(compressed_piece_ptr ptr, compressed_piece_coordinate* coord);
 static compressed_piece_ptr next_duration(compressed_piece_ptr ptr, uint16_t* coord);
 static compressed_piece_ptr next_piece(compressed_piece_ptr ptr);
@@ -71,6 +71,7 @@ static inline float time_relative_to_start_of_current_piece(const struct piecewi
 
 static void piecewise_compressed_advance_playhead(struct piecewise_traj_compressed *traj);
 static void piecewise_compressed_rewind(struct piecewise_traj_compressed *traj);
+static void piecewise_compressed_seek(struct piecewise_traj_compressed *traj, float t);
 static void piecewise_compressed_update_current_poly4d(
   struct piecewise_traj_compressed *traj, const struct traj_eval *end_of_previous_piece);
 
@@ -99,21 +100,74 @@ static compressed_piece_ptr calculate_polynomial_coefficients(
   return ptr;
 }
 
-// Calculates the total duration of a compressed trajectory, starting at the
-// given piece
-static float calculate_total_duration(compressed_piece_ptr ptr)
+// Reads the last control point of a coordinate in a piece body, which is where
+// the coordinate ends. The value is left untouched for constant coordinates.
+// Returns a pointer that points to _after_ the control points of the
+// coordinate.
+static compressed_piece_ptr read_end_point(
+  compressed_piece_ptr ptr, enum piecewise_traj_storage_type storage_type,
+  float *value, float scale)
 {
-  uint32_t duration_in_msec = 0;
-  struct compressed_piece_parsed_header header;
+  compressed_piece_coordinate coord;
+  uint8_t n = control_points_by_type[storage_type];
 
-  while (1) {
-    ptr = parse_header_of_current_piece(&header, ptr);
-    if (ptr) {
-      duration_in_msec += header.duration_in_msec;
-    } else {
-      return duration_in_msec / STORED_DURATION_SCALE;
+  if (n > 0) {
+    next_coordinate(ptr + (n - 1) * sizeof(compressed_piece_coordinate), &coord);
+    *value = coord / scale;
+  }
+
+  return ptr + n * sizeof(compressed_piece_coordinate);
+}
+
+// Walks the whole trajectory once, calculates the total duration and builds
+// the seek index. The index starts with every piece and every other entry is
+// dropped each time it fills up, so the spacing ends up as the smallest power
+// of two that covers the trajectory.
+static void build_index(struct piecewise_traj_compressed *traj)
+{
+  struct compressed_piece_parsed_header header;
+  struct traj_eval point;
+  compressed_piece_ptr ptr, next;
+  uint32_t duration_in_msec = 0;
+  float t_begin_relative = 0;
+  int stride = 1;
+  int n_pieces = 0;
+
+  ptr = piecewise_compressed_decode_start(traj->data, &point);
+  traj->n_index = 0;
+
+  while ((next = parse_header_of_current_piece(&header, ptr))) {
+    if (n_pieces % stride == 0) {
+      if (traj->n_index == PPTRAJ_COMPRESSED_INDEX_SIZE) {
+        for (int i = 0; i < PPTRAJ_COMPRESSED_INDEX_SIZE / 2; i++) {
+          traj->index[i] = traj->index[2 * i];
+        }
+        traj->n_index = PPTRAJ_COMPRESSED_INDEX_SIZE / 2;
+        stride *= 2;
+      }
     }
+    if (n_pieces % stride == 0) {
+      struct piecewise_traj_compressed_index_entry* entry = &traj->index[traj->n_index++];
+      entry->data = ptr;
+      entry->t_begin_relative = t_begin_relative;
+      entry->pos = point.pos;
+      entry->yaw = point.yaw;
+    }
+
+    compressed_piece_ptr body = header.body;
+    body = read_end_point(body, header.x_type, &point.pos.x, STORED_DISTANCE_SCALE);
+    body = read_end_point(body, header.y_type, &point.pos.y, STORED_DISTANCE_SCALE);
+    body = read_end_point(body, header.z_type, &point.pos.z, STORED_DISTANCE_SCALE);
+    read_end_point(body, header.yaw_type, &point.yaw, STORED_ANGLE_SCALE);
+
+    // accumulated the same way as when advancing the playhead
+    t_begin_relative += (float)(header.duration_in_msec / STORED_DURATION_SCALE);
+    duration_in_msec += header.duration_in_msec;
+    n_pieces++;
+    ptr = next;
   }
+
+  traj->duration = duration_in_msec / STORED_DURATION_SCALE;
 }
 
 // Returns the end time of the current piece being executed
@@ -212,8 +266,8 @@ struct traj_eval piecewise_compressed_eval(
    * a different value while the poly4d is already pre-calculated, and we
    * have no way of detecting it */
 
-  if (t < start_time_of_current_piece(traj)) {
-    piecewise_compressed_rewind(traj);
+  if (t < start_time_of_current_piece(traj) || (traj->current_piece.data && t >= end_time_of_current_piece(traj))) {
+    piecewise_compressed_seek(traj, t);
   }
 
   while (traj->current_piece.data && t >= end_time_of_current_piece(traj)) {
@@ -237,24 +291,55 @@ void piecewise_compressed_load(struct piecewise_traj_compressed *traj, const voi
   traj->shift = vzero();
   piecewise_compressed_rewind(traj);
 
-  traj->duration = calculate_total_duration(traj->current_piece.data);
+  build_index(traj);
+}
+
+// Moves the playhead close to the given time, using the seek index when the
+// time is behind the current piece or at least one index entry ahead of it.
+// The caller then advances sequentially to the piece that contains the time.
+static void piecewise_compressed_seek(struct piecewise_traj_compressed *traj, float t)
+{
+  const float t_relative = t - traj->t_begin;
+
+  if (traj->n_index == 0) {
+    piecewise_compressed_rewind(traj);
+    return;
+  }
+
+  // binary search for the last entry that starts at or before t
+  int lo = 0;
+  int hi = traj->n_index;
+  while (hi - lo > 1) {
+    int mid = (lo + hi) / 2;
+    if (traj->index[mid].t_begin_relative <= t_relative) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  const struct piecewise_traj_compressed_index_entry* entry = &traj->index[lo];
+  if (t_relative >= traj->current_piece.t_begin_relative && entry->t_begin_relative <= traj->current_piece.t_begin_relative) {
+    // the current piece is closer than the index entry
+    return;
+  }
+
+  struct traj_eval start;
+  bzero(&start, sizeof(start));
+  start.pos = entry->pos;
+  start.yaw = entry->yaw;
+  traj->current_piece.t_begin_relative = entry->t_begin_relative;
+  traj->current_piece.data = entry->data;
+  piecewise_compressed_update_current_poly4d(traj, &start);
 }
 
 static void piecewise_compressed_rewind(struct piecewise_traj_compressed *traj)
 {
   struct traj_eval stopped;
-  compressed_piece_coordinate value;
-  compressed_piece_ptr ptr;
 
   /* Parse header that stores the start coordinates */
-  bzero(&stopped, sizeof(stopped));
-  ptr = traj->data;
-  ptr = next_coordinate(ptr, &value); stopped.pos.x = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.pos.y = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.pos.z = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.yaw = value / STORED_ANGLE_SCALE;
   traj->current_piece.t_begin_relative = 0;
-  traj->current_piece.data = ptr;
+  traj->current_piece.data = piecewise_compressed_decode_start(traj->data, &stopped);
 
   piecewise_compressed_update_current_poly4d(traj, &stopped);
 }
@@ -262,16 +347,51 @@ static void piecewise_compressed_rewind(struct piecewise_traj_compressed *traj)
 static void piecewise_compressed_update_current_poly4d(
   struct piecewise_traj_compressed *traj, const struct traj_eval *prev_end)
 {
-  struct poly4d* poly4d = &traj->current_piece.poly4d;
+  piecewise_compressed_decode_piece(traj->current_piece.data, prev_end, &traj->current_piece.poly4d);
+}
+
+static void piecewise_compressed_advance_playhead(struct piecewise_traj_compressed *traj)
+{
+  float duration = traj->current_piece.poly4d.duration;
+  struct traj_eval end_of_previous_piece = poly4d_eval(&traj->current_piece.poly4d, duration);
+
+  traj->current_piece.t_begin_relative += duration;
+  traj->current_piece.data = next_piece(traj->current_piece.data);
+
+  piecewise_compressed_update_current_poly4d(traj, &end_of_previous_piece);
+}
+
+const void* piecewise_compressed_decode_start(const void* data, struct traj_eval *start)
+{
+  compressed_piece_coordinate value;
+  compressed_piece_ptr ptr = data;
+
+  bzero(start, sizeof(*start));
+  ptr = next_coordinate(ptr, &value); start->pos.x = value / STORED_DISTANCE_SCALE;
+  ptr = next_coordinate(ptr, &value); start->pos.y = value / STORED_DISTANCE_SCALE;
+  ptr = next_coordinate(ptr, &value); start->pos.z = value / STORED_DISTANCE_SCALE;
+  ptr = next_coordinate(ptr, &value); start->yaw = value / STORED_ANGLE_SCALE;
+
+  return ptr;
+}
+
+int piecewise_compressed_piece_size(const void* data)
+{
+  compressed_piece_ptr next = next_piece(data);
+  return next ? next - (compressed_piece_ptr)data : 0;
+}
+
+void piecewise_compressed_decode_piece(
+  const void* data, const struct traj_eval *prev_end, struct poly4d *poly4d)
+{
   compressed_piece_ptr ptr;
   struct compressed_piece_parsed_header header;
 
   /* First, clear everything in the poly4d */
   bzero(poly4d, sizeof(*poly4d));
 
-  /* Parse the header of the current piece, extract the storage types and the duration */
-  ptr = traj->current_piece.data;
-  parse_header_of_current_piece(&header, ptr);
+  /* Parse the header of the piece, extract the storage types and the duration */
+  parse_header_of_current_piece(&header, data);
   poly4d->duration = header.duration_in_msec / STORED_DURATION_SCALE;
 
   /* Process the body */
@@ -285,14 +405,3 @@ static void piecewise_compressed_update_current_poly4d(
   calculate_polynomial_coefficients(
     poly4d->p[3], ptr, header.yaw_type, prev_end->yaw, poly4d->duration, STORED_ANGLE_SCALE);
 }
-
-static void piecewise_compressed_advance_playhead(struct piecewise_traj_compressed *traj)
-{
-  float duration = traj->current_piece.poly4d.duration;
-  struct traj_eval end_of_previous_piece = poly4d_eval(&traj->current_piece.poly4d, duration);
-
-  traj->current_piece.t_begin_relative += duration;
-  traj->current_piece.data = next_piece(traj->current_piece.data);
-
-  piecewise_compressed_update_current_poly4d(traj, &end_of_previous_piece);
-}
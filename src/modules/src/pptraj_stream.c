@@ -0,0 +1,196 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * pptraj_stream.c - Streamed piecewise polynomial trajectories
+ */
+
+#include <string.h>
+
+#include "pptraj_stream.h"
+#include "pptraj_compressed.h"
+
+static inline struct poly4d* piece_at(struct piecewise_traj_stream const *stream, int i)
+{
+	return &stream->pieces[(stream->head + i) % stream->capacity];
+}
+
+void piecewise_stream_init(struct piecewise_traj_stream *stream,
+	struct poly4d* buffer, int capacity)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->pieces = buffer;
+	stream->capacity = capacity;
+	stream->timescale = 1;
+	stream->shift = vzero();
+	stream->current_piece.position = -1;
+}
+
+bool piecewise_stream_append(struct piecewise_traj_stream *stream,
+	struct poly4d const *piece)
+{
+	if (stream->complete || stream->count >= stream->capacity) {
+		return false;
+	}
+
+	struct poly4d* slot = piece_at(stream, stream->count);
+	*slot = *piece;
+	stream->count++;
+
+	stream->tail_end = poly4d_eval(slot, slot->duration);
+	stream->has_tail = true;
+	return true;
+}
+
+int piecewise_stream_append_compressed(struct piecewise_traj_stream *stream,
+	const void* data, int size, int n_pieces)
+{
+	const uint8_t* ptr = data;
+	const uint8_t* end = ptr + size;
+	struct traj_eval prev_end = stream->tail_end;
+
+	if (stream->complete) {
+		return -1;
+	}
+
+	if (!stream->has_tail) {
+		if (size < PPTRAJ_COMPRESSED_START_SIZE) {
+			return -1;
+		}
+		ptr = piecewise_compressed_decode_start(ptr, &prev_end);
+	}
+
+	// validate all pieces before touching the ring buffer, a piece with zero
+	// duration ends the trajectory
+	const uint8_t* first = ptr;
+	int n_valid = 0;
+	bool end_marker = false;
+	while (n_valid < n_pieces) {
+		if (end - ptr < PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE) {
+			return -1;
+		}
+		int piece_size = piecewise_compressed_piece_size(ptr);
+		if (piece_size == 0) {
+			end_marker = true;
+			break;
+		}
+		if (end - ptr < piece_size) {
+			return -1;
+		}
+		ptr += piece_size;
+		n_valid++;
+	}
+
+	if (n_valid > piecewise_stream_free(stream)) {
+		return -1;
+	}
+
+	ptr = first;
+	for (int i = 0; i < n_valid; ++i) {
+		struct poly4d* slot = piece_at(stream, stream->count);
+		piecewise_compressed_decode_piece(ptr, &prev_end, slot);
+		prev_end = poly4d_eval(slot, slot->duration);
+		stream->count++;
+		ptr += piecewise_compressed_piece_size(ptr);
+	}
+
+	stream->tail_end = prev_end;
+	stream->has_tail = true;
+	if (end_marker) {
+		stream->complete = true;
+	}
+
+	return n_valid;
+}
+
+float piecewise_stream_buffered_duration(struct piecewise_traj_stream const *stream)
+{
+	float total_dur = 0;
+	for (int i = 0; i < stream->count; ++i) {
+		total_dur += piece_at(stream, i)->duration;
+	}
+	return total_dur * stream->timescale;
+}
+
+bool piecewise_stream_is_finished(struct piecewise_traj_stream const *stream, float t)
+{
+	if (!stream->complete) {
+		return false;
+	}
+	return (t - stream->t_begin) >= piecewise_stream_buffered_duration(stream);
+}
+
+struct traj_eval piecewise_stream_eval(struct piecewise_traj_stream *stream, float t)
+{
+	if (stream->count == 0) {
+		return traj_eval_invalid();
+	}
+
+	// release the pieces the playhead has passed. The last piece is kept, its
+	// end point is held until more pieces arrive
+	while (stream->count > 1) {
+		float end = stream->t_begin + piece_at(stream, 0)->duration * stream->timescale;
+		if (t < end) {
+			break;
+		}
+		stream->t_begin = end;
+		stream->head = (stream->head + 1) % stream->capacity;
+		stream->count--;
+	}
+
+	struct poly4d const *piece = piece_at(stream, 0);
+	float duration = piece->duration * stream->timescale;
+
+	if (t - stream->t_begin >= duration) {
+		if (!stream->complete) {
+			if (!stream->underrun) {
+				stream->underrun = true;
+				stream->underrun_count++;
+			}
+			// move the time base along, the next piece starts when it arrives
+			stream->t_begin = t - duration;
+		}
+
+		struct traj_eval ev = poly4d_eval(piece, piece->duration);
+		ev.pos = vadd(ev.pos, stream->shift);
+		ev.vel = vzero();
+		ev.acc = vzero();
+		ev.jerk = vzero();
+		ev.omega = vzero();
+		return ev;
+	}
+
+	stream->underrun = false;
+
+	if (stream->current_piece.position != stream->head
+		|| stream->current_piece.timescale != stream->timescale) {
+		stream->current_piece.position = stream->head;
+		stream->current_piece.timescale = stream->timescale;
+		stream->current_piece.poly4d = *piece;
+		poly4d_stretchtime(&stream->current_piece.poly4d, stream->timescale);
+	}
+
+	struct traj_eval ev = poly4d_eval(&stream->current_piece.poly4d, t - stream->t_begin);
+	ev.pos = vadd(ev.pos, stream->shift);
+	return ev;
+}
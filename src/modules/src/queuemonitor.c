@@ -34,6 +34,7 @@
 #include "timers.h"
 #include "debug.h"
 #include "cfassert.h"
+#include "log.h"
 
 #define MAX_NR_OF_QUEUES 20
 #define TIMER_PERIOD M2T(10000)
@@ -48,6 +49,8 @@ typedef struct
   int sendCount;
   int maxWaiting;
   int fullCount;
+  int length;
+  int maxWaitingEver;
 } Data;
 
 static Data data[MAX_NR_OF_QUEUES];
@@ -57,6 +60,11 @@ static StaticTimer_t timerBuffer;
 static unsigned char nrOfQueues = 1; // Unregistered queues will end up at 0
 static bool initialized = false;
 
+// Highest fill level of any registered queue since boot, in percent of the queue length
+static uint8_t maxFillEver = 0;
+// Total number of failed sends since boot
+static uint32_t fullCountEver = 0;
+
 static void timerHandler(xTimerHandle timer);
 static void debugPrint();
 static bool filter(Data* queueData);
@@ -64,6 +72,7 @@ static void debugPrintQueue(Data* queueData);
 static Data* getQueueData(xQueueHandle* xQueue);
 static int getMaxWaiting(xQueueHandle* xQueue, int prevPeak);
 static void resetCounters();
+static void updateHighWaterMark(Data* queueData);
 
 unsigned char ucQueueGetQueueNumber( xQueueHandle xQueue );
 
@@ -86,6 +95,7 @@ void qm_traceQUEUE_SEND(void* xQueue) {
 
     queueData->sendCount++;
     queueData->maxWaiting = getMaxWaiting(xQueue, queueData->maxWaiting);
+    updateHighWaterMark(queueData);
   }
 }
 
@@ -94,6 +104,7 @@ void qm_traceQUEUE_SEND_FAILED(void* xQueue) {
     Data* queueData = getQueueData(xQueue);
 
     queueData->fullCount++;
+    fullCountEver++;
   }
 }
 
@@ -104,17 +115,35 @@ void qmRegisterQueue(xQueueHandle* xQueue, char* fileName, char* queueName) {
 
   queueData->fileName = fileName;
   queueData->queueName = queueName;
-  vQueueSetQueueNumber(xQueue, nrOfQueues);
+  queueData->length = uxQueueMessagesWaiting(xQueue) + uxQueueSpacesAvailable(xQueue);
+  // The upper bits of the queue number are used by the queue statistics
+  vQueueSetQueueNumber(xQueue, (uxQueueGetQueueNumber(xQueue) & ~0xff) | nrOfQueues);
 
   nrOfQueues++;
 }
 
 static Data* getQueueData(xQueueHandle* xQueue) {
-  unsigned char number = uxQueueGetQueueNumber(xQueue);
+  unsigned char number = uxQueueGetQueueNumber(xQueue) & 0xff;
   ASSERT(number < MAX_NR_OF_QUEUES);
   return &data[number];
 }
 
+static void updateHighWaterMark(Data* queueData) {
+  if (queueData->maxWaiting > queueData->maxWaitingEver) {
+    queueData->maxWaitingEver = queueData->maxWaiting;
+
+    if (queueData->length > 0) {
+      int fill = (100 * queueData->maxWaitingEver) / queueData->length;
+      if (fill > 100) {
+        fill = 100;
+      }
+      if (fill > maxFillEver) {
+        maxFillEver = fill;
+      }
+    }
+  }
+}
+
 static int getMaxWaiting(xQueueHandle* xQueue, int prevPeak) {
   // We get here before the current item is added to the queue.
   // Must add 1 to get the peak value.
@@ -151,9 +180,9 @@ static bool filter(Data* queueData) {
 }
 
 static void debugPrintQueue(Data* queueData) {
-  DEBUG_PRINT("%s:%s, sent: %i, peak: %i, full: %i\n",
+  DEBUG_PRINT("%s:%s, sent: %i, peak: %i, full: %i, peak since boot: %i/%i\n",
     queueData->fileName, queueData->queueName, queueData->sendCount,
-    queueData->maxWaiting, queueData->fullCount);
+    queueData->maxWaiting, queueData->fullCount, queueData->maxWaitingEver, queueData->length);
 }
 
 static void resetCounters() {
@@ -171,4 +200,21 @@ static void timerHandler(xTimerHandle timer) {
   debugPrint();
 }
 
+/**
+ * Queue usage, only available when the queue monitor is enabled.
+ */
+LOG_GROUP_START(queue)
+
+/**
+ * @brief Highest fill level of any monitored queue since boot [%]
+ */
+LOG_ADD(LOG_UINT8, maxFill, &maxFillEver)
+
+/**
+ * @brief Total number of failed sends to monitored queues since boot
+ */
+LOG_ADD(LOG_UINT32, fullCount, &fullCountEver)
+
+LOG_GROUP_STOP(queue)
+
 #endif // CONFIG_DEBUG_QUEUE_MONITOR
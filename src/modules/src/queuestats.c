@@ -0,0 +1,172 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * queuestats.c - Always on statistics for the most important queues
+ */
+
+#include "queuestats.h"
+
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "cycle_counter.h"
+#include "log.h"
+#include "worker.h"
+
+#define UPDATE_PERIOD_MS 1000
+#define CYCLES_PER_US (configCPU_CLOCK_HZ / 1000000)
+
+typedef struct {
+  // Updated by the producers and consumers of the queue
+  uint16_t depth;
+  uint16_t maxDepth;
+  uint32_t fullCount;
+  uint32_t removedCount;
+  // Integral of the depth over time, in items * cycles
+  uint64_t depthCycles;
+  uint32_t lastChange;
+
+  // Updated periodically. The mean wait is the time integral of the depth
+  // divided by the number of removed items during the last period (Little's law)
+  uint64_t periodDepthCycles;
+  uint32_t periodRemovedCount;
+  uint32_t meanWaitUs;
+} queueStats_t;
+
+static queueStats_t stats[queueStats_COUNT];
+static bool isInit = false;
+
+// Must be called with the queue protected
+static void integrate(queueStats_t* s, const uint32_t depthBefore)
+{
+  const uint32_t now = cycleCounterGet();
+  s->depthCycles += (uint64_t)depthBefore * (now - s->lastChange);
+  s->lastChange = now;
+}
+
+void queueStatsUpdate(const queueStatsId_t id, const uint32_t depthBefore, const uint32_t added, const uint32_t removed)
+{
+  queueStats_t* s = &stats[id];
+
+  integrate(s, depthBefore);
+  s->depth = depthBefore + added - removed;
+  if (s->depth > s->maxDepth) {
+    s->maxDepth = s->depth;
+  }
+  s->removedCount += removed;
+}
+
+void queueStatsFull(const queueStatsId_t id)
+{
+  // The kernel calls the failed send hook outside of the critical section when a blocking send times out
+  __atomic_fetch_add(&stats[id].fullCount, 1, __ATOMIC_RELAXED);
+}
+
+void queueStatsRegister(void* queue, const queueStatsId_t id)
+{
+  if (id >= queueStats_COUNT) {
+    return;
+  }
+
+  const UBaseType_t number = uxQueueGetQueueNumber(queue) & ~(0xff << QUEUE_STATS_NUMBER_SHIFT);
+  vQueueSetQueueNumber(queue, number | ((id + 1) << QUEUE_STATS_NUMBER_SHIFT));
+}
+
+static void queueStatsUpdatePeriod(void* arg)
+{
+  for (int i = 0; i < queueStats_COUNT; i++) {
+    queueStats_t* s = &stats[i];
+
+    // Close the integral at the current time, this also keeps the cycle
+    // counter differences well below the wrap around
+    taskENTER_CRITICAL();
+    integrate(s, s->depth);
+    const uint64_t depthCycles = s->depthCycles;
+    const uint32_t removedCount = s->removedCount;
+    const uint16_t depth = s->depth;
+    taskEXIT_CRITICAL();
+
+    const uint32_t removed = removedCount - s->periodRemovedCount;
+    if (removed > 0) {
+      s->meanWaitUs = (depthCycles - s->periodDepthCycles) / removed / CYCLES_PER_US;
+    } else if (depth == 0) {
+      s->meanWaitUs = 0;
+    }
+
+    s->periodDepthCycles = depthCycles;
+    s->periodRemovedCount = removedCount;
+  }
+}
+
+void queueStatsInit(void)
+{
+  if (isInit) {
+    return;
+  }
+
+  cycleCounterInit();
+  const uint32_t now = cycleCounterGet();
+  taskENTER_CRITICAL();
+  for (int i = 0; i < queueStats_COUNT; i++) {
+    stats[i].lastChange = now;
+  }
+  taskEXIT_CRITICAL();
+
+  workerScheduleWithOptions(queueStatsUpdatePeriod, NULL, &(workerOptions_t){
+    .priority = WORKER_PRIORITY_LOW,
+    .periodMs = UPDATE_PERIOD_MS,
+  });
+
+  isInit = true;
+}
+
+// Adds the depth, high watermark, failed sends and mean wait for one queue
+#define QUEUE_STATS_LOG_ADD(NAME, ID) \
+  LOG_ADD(LOG_UINT16, NAME##Dpth, &stats[ID].depth) \
+  LOG_ADD(LOG_UINT16, NAME##Max, &stats[ID].maxDepth) \
+  LOG_ADD(LOG_UINT32, NAME##Full, &stats[ID].fullCount) \
+  LOG_ADD(LOG_UINT32, NAME##Wait, &stats[ID].meanWaitUs)
+
+/**
+ * Statistics of the most important queues. Dpth is the current number of
+ * items in the queue, Max the largest number since boot and Full the number
+ * of items that were rejected or dropped since the queue was full. Wait is
+ * the mean time [us] an item spent in the queue during the last second.
+ *
+ * The CRTP tx queues are split in the control, config and bulk classes,
+ * radioTx is the queue from the radio link to syslink and syslink the queue
+ * of packets received from the nRF51. For the worker, the wait includes the
+ * requested delay of delayed and periodic jobs.
+ */
+LOG_GROUP_START(queueStat)
+  QUEUE_STATS_LOG_ADD(txCtrl, queueStatsCrtpTxControl)
+  QUEUE_STATS_LOG_ADD(txCfg, queueStatsCrtpTxConfig)
+  QUEUE_STATS_LOG_ADD(txBulk, queueStatsCrtpTxBulk)
+  QUEUE_STATS_LOG_ADD(radioTx, queueStatsRadioTx)
+  QUEUE_STATS_LOG_ADD(syslink, queueStatsSyslinkRx)
+  QUEUE_STATS_LOG_ADD(est, queueStatsEstimator)
+  QUEUE_STATS_LOG_ADD(worker, queueStatsWorker)
+LOG_GROUP_STOP(queueStat)
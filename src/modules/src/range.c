@@ -26,6 +26,9 @@
  */
 #include <stdint.h>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "log.h"
 
 #include "range.h"
@@ -33,12 +36,23 @@
 #include "estimator.h"
 
 static uint16_t ranges[RANGE_T_END] = {0,};
+static uint32_t timestamps[RANGE_T_END] = {0,};
+
+static bool isDownRangeHeld = false;
+static bool isDownRangeAvailable = false;
+static tofMeasurement_t heldDownRange;
 
 void rangeSet(rangeDirection_t direction, float range_m)
+{
+  rangeSetWithTimestamp(direction, range_m, xTaskGetTickCount());
+}
+
+void rangeSetWithTimestamp(rangeDirection_t direction, float range_m, uint32_t timestamp)
 {
   if (direction > (RANGE_T_END-1)) return;
 
   ranges[direction] = range_m * 1000;
+  timestamps[direction] = timestamp;
 }
 
 float rangeGet(rangeDirection_t direction)
@@ -48,12 +62,43 @@ float rangeGet(rangeDirection_t direction)
   return ranges[direction];
 }
 
+uint32_t rangeGetTimestamp(rangeDirection_t direction)
+{
+  if (direction > (RANGE_T_END-1)) return 0;
+
+  return timestamps[direction];
+}
+
 void rangeEnqueueDownRangeInEstimator(float distance, float stdDev, uint32_t timeStamp) {
   tofMeasurement_t tofData;
   tofData.timestamp = timeStamp;
   tofData.distance = distance;
   tofData.stdDev = stdDev;
-  estimatorEnqueueTOF(&tofData);
+
+  if (isDownRangeHeld) {
+    taskENTER_CRITICAL();
+    heldDownRange = tofData;
+    isDownRangeAvailable = true;
+    taskEXIT_CRITICAL();
+  } else {
+    estimatorEnqueueTOF(&tofData);
+  }
+}
+
+void rangeHoldDownRange(const bool hold) {
+  isDownRangeHeld = hold;
+}
+
+bool rangeTakeDownRange(tofMeasurement_t* tof) {
+  taskENTER_CRITICAL();
+  const bool result = isDownRangeAvailable;
+  if (result) {
+    *tof = heldDownRange;
+    isDownRangeAvailable = false;
+  }
+  taskEXIT_CRITICAL();
+
+  return result;
 }
 
 /**
@@ -0,0 +1,192 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * rate_loop.c - Attitude rate loop running on every gyro sample, decoupled
+ * from the 1 kHz stabilizer loop.
+ *
+ * The stabilizer task still runs the estimator, supervisor, position and
+ * attitude controllers at their decimated rates. The PID controller hands the
+ * desired rates and thrust over to this module, and the sensor task closes the
+ * rate loop (rate PID -> power distribution -> motors) for every gyro sample,
+ * without waiting for the next stabilizer tick.
+ *
+ * The rate loop is the only one driving the motors, also when the controller in
+ * use does not feed it. The stabilizer then hands over its control and the rate
+ * loop passes it on to the motors.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "rate_loop.h"
+#include "attitude_controller.h"
+#include "stabilizer.h"
+#include "motors.h"
+#include "statsCnt.h"
+#include "log.h"
+
+typedef struct {
+  attitude_t rateDesired;
+  float thrust;
+  uint32_t tick;
+} rateLoopSetpoint_t;
+
+// Written by the stabilizer task, read by the sensor task. Protected by critical sections.
+static rateLoopSetpoint_t setpoint;
+static bool areMotorsAllowed;
+static control_t stabilizerControl;
+static uint32_t stabilizerControlTick;
+static control_t latestControl;
+// Only used by the sensor task. True if the motors have been driven since they were stopped
+static bool isDriving;
+
+static STATS_CNT_RATE_DEFINE(rateLoopRate, 500);
+
+static bool isFresh(const uint32_t tick, const uint32_t now) {
+  return tick != 0 && (now - tick) < M2T(RATE_LOOP_TIMEOUT_MS);
+}
+
+void rateLoopInit(void) {
+  taskENTER_CRITICAL();
+  setpoint = (rateLoopSetpoint_t){0};
+  areMotorsAllowed = false;
+  stabilizerControl = (control_t){.controlMode = controlModeLegacy};
+  stabilizerControlTick = 0;
+  latestControl = (control_t){.controlMode = controlModeLegacy};
+  taskEXIT_CRITICAL();
+  isDriving = false;
+}
+
+void rateLoopSetSetpoint(const attitude_t* rateDesired, const float thrust) {
+  const uint32_t now = xTaskGetTickCount();
+
+  taskENTER_CRITICAL();
+  setpoint.rateDesired = *rateDesired;
+  setpoint.thrust = thrust;
+  // 0 is used to mark "no setpoint"
+  setpoint.tick = now ? now : 1;
+  taskEXIT_CRITICAL();
+}
+
+void rateLoopSetStabilizerControl(const control_t* control) {
+  const uint32_t now = xTaskGetTickCount();
+
+  taskENTER_CRITICAL();
+  stabilizerControl = *control;
+  stabilizerControlTick = now ? now : 1;
+  taskEXIT_CRITICAL();
+}
+
+void rateLoopSetMotorsAllowed(const bool areMotorsAllowedToRun) {
+  taskENTER_CRITICAL();
+  areMotorsAllowed = areMotorsAllowedToRun;
+  if (!areMotorsAllowedToRun) {
+    // Never pass on a control from before the motors were stopped
+    stabilizerControlTick = 0;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void rateLoopGyroSample(const Axis3f* gyro) {
+  taskENTER_CRITICAL();
+  const rateLoopSetpoint_t sp = setpoint;
+  const control_t fallbackControl = stabilizerControl;
+  const uint32_t fallbackTick = stabilizerControlTick;
+  const bool motorsAllowed = areMotorsAllowed;
+  taskEXIT_CRITICAL();
+
+  // Critical for safety, be careful if you modify this code!
+  // The stabilizer also stops the motors, but it may have done so while we were preempted
+  if (!motorsAllowed) {
+    if (isDriving) {
+      motorsStop();
+      isDriving = false;
+    }
+    attitudeControllerResetRatePID();
+    return;
+  }
+
+  const uint32_t now = xTaskGetTickCount();
+  control_t control = {.controlMode = controlModeLegacy};
+
+  if (isFresh(sp.tick, now)) {
+    control.thrust = sp.thrust;
+
+    if (sp.thrust == 0) {
+      attitudeControllerResetRatePID();
+    } else {
+      attitudeControllerCorrectRatePID(gyro->x, -gyro->y, gyro->z,
+                                       sp.rateDesired.roll, sp.rateDesired.pitch, sp.rateDesired.yaw);
+      attitudeControllerGetActuatorOutput(&control.roll, &control.pitch, &control.yaw);
+      control.yaw = -control.yaw;
+    }
+
+    taskENTER_CRITICAL();
+    latestControl = control;
+    taskEXIT_CRITICAL();
+  } else if (isFresh(fallbackTick, now)) {
+    // The controller in use does not feed the rate loop, pass on the control of the stabilizer loop
+    control = fallbackControl;
+  } else {
+    // Nothing fresh to act on, leave the motors as they are
+    return;
+  }
+
+  stabilizerControlMotors(&control);
+#ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+  motorsBurstDshot();
+#endif
+  isDriving = true;
+
+  STATS_CNT_RATE_EVENT(&rateLoopRate);
+}
+
+void rateLoopGetControl(control_t* control) {
+  taskENTER_CRITICAL();
+  control->roll = latestControl.roll;
+  control->pitch = latestControl.pitch;
+  control->yaw = latestControl.yaw;
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * The inner rate loop, running on every gyro sample
+ */
+LOG_GROUP_START(rateLoop)
+/**
+ * @brief Rate at which the rate loop drives the motors [Hz]
+ */
+STATS_CNT_RATE_LOG_ADD(rate, &rateLoopRate)
+/**
+ * @brief Roll command of the rate loop
+ */
+LOG_ADD(LOG_INT16, cmdRoll, &latestControl.roll)
+/**
+ * @brief Pitch command of the rate loop
+ */
+LOG_ADD(LOG_INT16, cmdPitch, &latestControl.pitch)
+/**
+ * @brief Yaw command of the rate loop
+ */
+LOG_ADD(LOG_INT16, cmdYaw, &latestControl.yaw)
+LOG_GROUP_STOP(rateLoop)
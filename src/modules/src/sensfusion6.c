@@ -23,7 +23,9 @@
  *
  *
  */
+#include <float.h>
 #include <math.h>
+#include <stdint.h>
 
 #include "sensfusion6.h"
 #include "log.h"
@@ -55,6 +57,7 @@ float qy = 0.0f;
 float qz = 0.0f;  // quaternion of sensor frame relative to auxiliary frame
 
 static float gravX, gravY, gravZ; // Unit vector in the estimated gravity direction
+static bool isGravityValid;
 
 // The acc in Z for static position (g)
 // Set on first update, assuming we are in a static position since the sensors were just calibrates.
@@ -68,6 +71,7 @@ static bool isCalibrated = false;
 static void sensfusion6UpdateQImpl(float gx, float gy, float gz, float ax, float ay, float az, float dt);
 static float sensfusion6GetAccZ(const float ax, const float ay, const float az);
 static void estimatedGravityDirection(float* gx, float* gy, float* gz);
+static void updateGravityDirection(void);
 
 // TODO: Make math util file
 static float invSqrt(float x);
@@ -89,6 +93,68 @@ void sensfusion6UpdateQ(float gx, float gy, float gz, float ax, float ay, float
 {
   sensfusion6UpdateQImpl(gx, gy, gz, ax, ay, az, dt);
   estimatedGravityDirection(&gravX, &gravY, &gravZ);
+  isGravityValid = true;
+
+  if (!isCalibrated) {
+    baseZacc = sensfusion6GetAccZ(ax, ay, az);
+    isCalibrated = true;
+  }
+}
+
+void sensfusion6UpdateQFast(float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+#ifdef CONFIG_IMU_MADGWICK_QUATERNION
+  // The fast path is a Mahony filter, use the normal update for Madgwick
+  sensfusion6UpdateQImpl(gx, gy, gz, ax, ay, az, dt);
+#else
+  const float degToRad = M_PI_F / 180.0f;
+  gx *= degToRad;
+  gy *= degToRad;
+  gz *= degToRad;
+
+  // Normalise the accelerometer measurement. FLT_MIN keeps a zero measurement finite, it then
+  // gives no feedback, which makes the validity check of the normal update unnecessary.
+  float recipNorm = 1.0f / sqrtf(ax * ax + ay * ay + az * az + FLT_MIN);
+  ax *= recipNorm;
+  ay *= recipNorm;
+  az *= recipNorm;
+
+  // Error is the cross product between estimated and measured direction of gravity
+  const float halfvx = qx * qz - qw * qy;
+  const float halfvy = qw * qx + qy * qz;
+  const float halfvz = qw * qw - 0.5f + qz * qz;
+  const float halfex = (ay * halfvz - az * halfvy);
+  const float halfey = (az * halfvx - ax * halfvz);
+  const float halfez = (ax * halfvy - ay * halfvx);
+
+  // The integral is cleared when the integral gain is zero, as in the normal update
+  const float integralEnabled = (twoKi > 0.0f) ? 1.0f : 0.0f;
+  integralFBx = (integralFBx + twoKi * halfex * dt) * integralEnabled;
+  integralFBy = (integralFBy + twoKi * halfey * dt) * integralEnabled;
+  integralFBz = (integralFBz + twoKi * halfez * dt) * integralEnabled;
+
+  const float halfDt = 0.5f * dt;
+  gx = (gx + integralFBx + twoKp * halfex) * halfDt;
+  gy = (gy + integralFBy + twoKp * halfey) * halfDt;
+  gz = (gz + integralFBz + twoKp * halfez) * halfDt;
+
+  // Integrate the rate of change of the quaternion
+  const float qa = qw;
+  const float qb = qx;
+  const float qc = qy;
+  qw += (-qb * gx - qc * gy - qz * gz);
+  qx += (qa * gx + qc * gz - qz * gy);
+  qy += (qa * gy - qb * gz + qz * gx);
+  qz += (qa * gz + qb * gy - qc * gx);
+
+  recipNorm = 1.0f / sqrtf(qw * qw + qx * qx + qy * qy + qz * qz);
+  qw *= recipNorm;
+  qx *= recipNorm;
+  qy *= recipNorm;
+  qz *= recipNorm;
+#endif
+
+  isGravityValid = false;
 
   if (!isCalibrated) {
     baseZacc = sensfusion6GetAccZ(ax, ay, az);
@@ -262,6 +328,8 @@ void sensfusion6GetQuaternion(float* q_x, float* q_y, float* q_z, float* q_w)
 
 void sensfusion6GetEulerRPY(float* roll, float* pitch, float* yaw)
 {
+  updateGravityDirection();
+
   float gx = gravX;
   float gy = gravY;
   float gz = gravZ;
@@ -282,19 +350,21 @@ float sensfusion6GetAccZWithoutGravity(const float ax, const float ay, const flo
 //---------------------------------------------------------------------------------------------------
 // Fast inverse square-root
 // See: http://en.wikipedia.org/wiki/Fast_inverse_square_root
+// The bits are reinterpreted through a 32 bit union, "long" is 64 bits on some hosts
 float invSqrt(float x)
 {
   float halfx = 0.5f * x;
-  float y = x;
-  long i = *(long*)&y;
-  i = 0x5f3759df - (i>>1);
-  y = *(float*)&i;
+  union { float f; int32_t i; } conv = { .f = x };
+  conv.i = 0x5f3759df - (conv.i >> 1);
+  float y = conv.f;
   y = y * (1.5f - (halfx * y * y));
   return y;
 }
 
 static float sensfusion6GetAccZ(const float ax, const float ay, const float az)
 {
+  updateGravityDirection();
+
   // return vertical acceleration
   // (A dot G) / |G|,  (|G| = 1) -> (A dot G)
   return (ax * gravX + ay * gravY + az * gravZ);
@@ -307,6 +377,14 @@ static void estimatedGravityDirection(float* gx, float* gy, float* gz)
   *gz = qw * qw - qx * qx - qy * qy + qz * qz;
 }
 
+static void updateGravityDirection(void)
+{
+  if (!isGravityValid) {
+    estimatedGravityDirection(&gravX, &gravY, &gravZ);
+    isGravityValid = true;
+  }
+}
+
 /**
  * Sensor fusion is the process of combining sensory data or data derived from
  * disparate sources such that the resulting information has less uncertainty
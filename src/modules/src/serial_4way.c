@@ -33,9 +33,15 @@
 #define USE_SERIAL_4WAY_BLHELI_BOOTLOADER
 #ifdef  USE_SERIAL_4WAY_BLHELI_INTERFACE
 
+#define DEBUG_MODULE "4WAY"
+
 #include "motors.h"
 #include "usec_time.h"
+#include "cycle_counter.h"
 #include "led.h"
+#include "debug.h"
+#include "log.h"
+#include "statsCnt.h"
 #include "vcp_esc_passthrough.h"
 
 #include "serial_4way.h"
@@ -91,6 +97,11 @@
 
 static uint8_t escCount;
 
+// Transfer throughput, the flash and eeprom payload bytes read, written and verified
+static STATS_CNT_RATE_DEFINE(transferRate, 1000);
+static statsCntMinMaxAvg_t commandTime;
+static uint32_t sessionBytes;
+
 uint8_t selected_esc = 0;
 
 uint8_32_u DeviceInfo;
@@ -146,6 +157,10 @@ uint8_t esc4wayInit(void)
     // StopPwmAllMotors();
     // XXX Review effect of motor refactor
     //pwmDisableMotors();
+    cycleCounterInit();
+    statsCntMinMaxAvgInit(&commandTime, 1000);
+    sessionBytes = 0;
+
     selected_esc = 0;
     escCount = 0;
     for (volatile uint8_t i = 0; i < NBR_OF_MOTORS; i++) {
@@ -402,9 +417,28 @@ static uint8_t ReadByteCrc(void)
     return b;
 }
 
+// Reads a block in one go from the VCP, len 0 means 256
+static void ReadBufCrc(uint8_t *pstring, uint8_t len)
+{
+    const uint32_t length = (len == 0) ? 256 : len;
+    passthroughVcpRxReceiveBufferBlock(pstring, length);
+    for (uint32_t i = 0; i < length; i++) {
+        CRC_in.word = _crc_xmodem_update(CRC_in.word, pstring[i]);
+    }
+}
+
+// The response is collected and sent in one go, to fill the USB packets
+static uint8_t OutBuf[256 + 8];
+static uint32_t OutLen;
 static void WriteByte(uint8_t b)
 {
-  passthroughVcpTxSend(b);
+    OutBuf[OutLen++] = b;
+}
+
+static void FlushOut(void)
+{
+    passthroughVcpTxSendBufferBlock(OutBuf, OutLen);
+    OutLen = 0;
 }
 
 static uint8_16_u CRCout;
@@ -414,6 +448,22 @@ static void WriteByteCrc(uint8_t b)
     CRCout.word = _crc_xmodem_update(CRCout.word, b);
 }
 
+// Number of payload bytes transferred to or from the ESC by a successful command
+static uint32_t PayloadLength(uint8_t cmd, uint8_t inLen, uint8_t outLen)
+{
+    switch (cmd) {
+        case cmd_DeviceRead:
+        case cmd_DeviceReadEEprom:
+            return (outLen == 0) ? 256 : outLen;
+        case cmd_DeviceWrite:
+        case cmd_DeviceWriteEEprom:
+        case cmd_DeviceVerify:
+            return (inLen == 0) ? 256 : inLen;
+        default:
+            return 0;
+    }
+}
+
 void esc4wayProcess(void)
 {
 
@@ -426,7 +476,6 @@ void esc4wayProcess(void)
     uint8_16_u Dummy;
     uint8_t O_PARAM_LEN;
     uint8_t *O_PARAM;
-    uint8_t *InBuff;
     ioMem_t ioMem;
 
         // Start here  with UART Main loop
@@ -449,22 +498,21 @@ void esc4wayProcess(void)
         Dummy.word = 0;
         O_PARAM = &Dummy.bytes[0];
         O_PARAM_LEN = 1;
-        CMD = ReadByteCrc();
-        ioMem.D_FLASH_ADDR_H = ReadByteCrc();
-        ioMem.D_FLASH_ADDR_L = ReadByteCrc();
-        I_PARAM_LEN = ReadByteCrc();
 
-        InBuff = ParamBuf;
-        uint8_t i = I_PARAM_LEN;
-        do {
-          *InBuff = ReadByteCrc();
-          InBuff++;
-          i--;
-        } while (i != 0);
+        uint8_t Header[4];
+        ReadBufCrc(Header, sizeof(Header));
+        CMD = Header[0];
+        ioMem.D_FLASH_ADDR_H = Header[1];
+        ioMem.D_FLASH_ADDR_L = Header[2];
+        I_PARAM_LEN = Header[3];
+
+        ReadBufCrc(ParamBuf, I_PARAM_LEN);
 
         CRC_check.bytes[1] = ReadByte();
         CRC_check.bytes[0] = ReadByte();
 
+        const uint32_t commandStart = cycleCounterGet();
+
         if (CRC_check.word == CRC_in.word) {
             ACK_OUT = ACK_OK;
         } else {
@@ -874,7 +922,16 @@ void esc4wayProcess(void)
             }
         }
 
+        if (ACK_OUT == ACK_OK) {
+            const uint32_t payload = PayloadLength(CMD, I_PARAM_LEN, O_PARAM_LEN);
+            STATS_CNT_RATE_MULTI_EVENT(&transferRate, payload);
+            sessionBytes += payload;
+        }
+        statsCntMinMaxAvgAdd(&commandTime, cycleCounterElapsed(commandStart) / (SystemCoreClock / 1000000));
+        statsCntMinMaxAvgUpdate(&commandTime, millis());
+
         CRCout.word = 0;
+        OutLen = 0;
 
         RX_LED_OFF;
 
@@ -884,7 +941,7 @@ void esc4wayProcess(void)
         WriteByteCrc(ioMem.D_FLASH_ADDR_L);
         WriteByteCrc(O_PARAM_LEN);
 
-        i=O_PARAM_LEN;
+        uint8_t i = O_PARAM_LEN;
         do {
             WriteByteCrc(*O_PARAM);
             O_PARAM++;
@@ -894,9 +951,11 @@ void esc4wayProcess(void)
         WriteByteCrc(ACK_OUT);
         WriteByte(CRCout.bytes[1]);
         WriteByte(CRCout.bytes[0]);
+        FlushOut();
 
         TX_LED_OFF;
         if (isExitScheduled) {
+            DEBUG_PRINT("Transferred %lu bytes to and from the ESCs\n", (unsigned long)sessionBytes);
             esc4wayRelease();
             return;
         }
@@ -905,4 +964,19 @@ void esc4wayProcess(void)
 
 
 
+/**
+ * Throughput of the 4way interface, used for flashing ESCs through the VCP passthrough
+ */
+LOG_GROUP_START(esc4way)
+/**
+ * @brief Flash and eeprom payload bytes per second transferred to and from the ESCs
+ */
+STATS_CNT_RATE_LOG_ADD(xferRate, &transferRate)
+/**
+ * @brief Time to execute a 4way command on the ESC [us]
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(cmdUs, &commandTime)
+LOG_GROUP_STOP(esc4way)
+
+
 #endif
@@ -43,6 +43,7 @@
 #include "serial_4way.h"
 #include "serial_4way_impl.h"
 #include "serial_4way_avrootloader.h"
+#include "cycle_counter.h"
 
 #if defined(USE_SERIAL_4WAY_BLHELI_BOOTLOADER) && !defined(USE_FAKE_ESC)
 
@@ -77,6 +78,18 @@
 #define START_BIT_TIME      (BIT_TIME_HALVE)
 //#define STOP_BIT_TIME     ((BIT_TIME * 9) + BIT_TIME_HALVE)
 
+// The bits are timed with the DWT cycle counter instead of polling micros(). It is a single register read with a
+// resolution of a few ns, which keeps the bit edges on time, and the comparisons are safe over wrap around.
+static inline uint32_t usToCycles(uint32_t us)
+{
+    return us * (SystemCoreClock / 1000000);
+}
+
+static inline void waitUntil(uint32_t cycleTime)
+{
+    while ((int32_t)(cycleCounterGet() - cycleTime) < 0);
+}
+
 
 static uint8_t suart_getc_(uint8_t *bt)
 {
@@ -91,8 +104,9 @@ static uint8_t suart_getc_(uint8_t *bt)
         }
     }
     // start bit
-    start_time = micros();
-    btime = start_time + START_BIT_TIME;
+    start_time = cycleCounterGet();
+    const uint32_t bitCycles = usToCycles(BIT_TIME);
+    btime = start_time + usToCycles(START_BIT_TIME);
 
     // TA: Added to prevent most interruption during read
     watchdogReset();
@@ -100,17 +114,17 @@ static uint8_t suart_getc_(uint8_t *bt)
 
     uint16_t bitmask = 0;
     uint8_t bit = 0;
-    while (micros() < btime);
+    waitUntil(btime);
     while (1) {
         if (ESC_IS_HI)
         {
             bitmask |= (1 << bit);
         } else {
         }
-        btime = btime + BIT_TIME;
+        btime = btime + bitCycles;
         bit++;
         if (bit == 10) break;
-        while (micros() < btime);
+        waitUntil(btime);
     }
     taskEXIT_CRITICAL();
     // check start bit and stop bit
@@ -125,7 +139,8 @@ static void suart_putc_(uint8_t *tx_b)
 {
     // shift out stopbit first
     uint16_t bitmask = (*tx_b << 2) | 1 | (1 << 10);
-    uint32_t btime = micros();
+    const uint32_t bitCycles = usToCycles(BIT_TIME);
+    uint32_t btime = cycleCounterGet();
 
     // TA: Added to prevent most interruption during write
     watchdogReset();
@@ -138,10 +153,10 @@ static void suart_putc_(uint8_t *tx_b)
         else {
             ESC_SET_LO; // 0
         }
-        btime = btime + BIT_TIME;
+        btime = btime + bitCycles;
         bitmask = (bitmask >> 1);
         if (bitmask == 0) break; // stopbit shifted out - but don't wait
-        while (micros() < btime);
+        waitUntil(btime);
     }
     taskEXIT_CRITICAL();
 }
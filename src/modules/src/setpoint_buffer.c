@@ -0,0 +1,216 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * setpoint_buffer.c - Jitter buffer for timestamped streamed setpoints
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "setpoint_buffer.h"
+
+static setpointBufferEntry_t* entryAt(setpointBuffer_t* buffer, const int index) {
+  return &buffer->entries[(buffer->head + index) % SETPOINT_BUFFER_SIZE];
+}
+
+static void releaseOldest(setpointBuffer_t* buffer) {
+  buffer->previous = *entryAt(buffer, 0);
+  buffer->hasPrevious = true;
+  buffer->head = (buffer->head + 1) % SETPOINT_BUFFER_SIZE;
+  buffer->count--;
+}
+
+static float lerp(const float a, const float b, const float alpha) {
+  return a + alpha * (b - a);
+}
+
+static void lerpVec(struct vec3_s* result, const struct vec3_s* a, const struct vec3_s* b, const float alpha) {
+  result->x = lerp(a->x, b->x, alpha);
+  result->y = lerp(a->y, b->y, alpha);
+  result->z = lerp(a->z, b->z, alpha);
+}
+
+static float wrapDegrees(float angle) {
+  while (angle > 180.0f) {
+    angle -= 360.0f;
+  }
+  while (angle < -180.0f) {
+    angle += 360.0f;
+  }
+  return angle;
+}
+
+static void lerpQuaternion(quaternion_t* result, const quaternion_t* a, const quaternion_t* b, const float alpha) {
+  // Normalized linear interpolation along the shortest arc
+  const float sign = (a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w) < 0.0f ? -1.0f : 1.0f;
+  result->x = lerp(a->x, sign * b->x, alpha);
+  result->y = lerp(a->y, sign * b->y, alpha);
+  result->z = lerp(a->z, sign * b->z, alpha);
+  result->w = lerp(a->w, sign * b->w, alpha);
+
+  const float norm = sqrtf(result->x * result->x + result->y * result->y + result->z * result->z + result->w * result->w);
+  if (norm > 0.0f) {
+    result->x /= norm;
+    result->y /= norm;
+    result->z /= norm;
+    result->w /= norm;
+  }
+}
+
+// Interpolates between two setpoints, alpha > 1 extrapolates past b. Setpoints
+// with different modes can not be blended, the result steps from a to b.
+static void interpolate(setpoint_t* result, const setpoint_t* a, const setpoint_t* b, const float alpha) {
+  if (memcmp(&a->mode, &b->mode, sizeof(a->mode)) != 0 || a->velocity_body != b->velocity_body) {
+    *result = alpha < 1.0f ? *a : *b;
+    return;
+  }
+
+  *result = *b;
+
+  result->attitude.roll = lerp(a->attitude.roll, b->attitude.roll, alpha);
+  result->attitude.pitch = lerp(a->attitude.pitch, b->attitude.pitch, alpha);
+  result->attitude.yaw = wrapDegrees(a->attitude.yaw + alpha * wrapDegrees(b->attitude.yaw - a->attitude.yaw));
+
+  result->attitudeRate.roll = lerp(a->attitudeRate.roll, b->attitudeRate.roll, alpha);
+  result->attitudeRate.pitch = lerp(a->attitudeRate.pitch, b->attitudeRate.pitch, alpha);
+  result->attitudeRate.yaw = lerp(a->attitudeRate.yaw, b->attitudeRate.yaw, alpha);
+
+  if (a->mode.quat != modeDisable) {
+    lerpQuaternion(&result->attitudeQuaternion, &a->attitudeQuaternion, &b->attitudeQuaternion, alpha);
+  }
+
+  result->thrust = lerp(a->thrust, b->thrust, alpha);
+  lerpVec(&result->position, &a->position, &b->position, alpha);
+  lerpVec(&result->velocity, &a->velocity, &b->velocity, alpha);
+  lerpVec(&result->acceleration, &a->acceleration, &b->acceleration, alpha);
+  lerpVec(&result->jerk, &a->jerk, &b->jerk, alpha);
+}
+
+void setpointBufferReset(setpointBuffer_t* buffer) {
+  buffer->head = 0;
+  buffer->count = 0;
+  buffer->hasPrevious = false;
+  buffer->isSynced = false;
+  buffer->hasPlayTime = false;
+}
+
+bool setpointBufferPush(setpointBuffer_t* buffer, const setpoint_t* setpoint, uint16_t senderTimeMs, uint32_t nowMs) {
+  if (buffer->isSynced && buffer->count > 0) {
+    const setpointBufferEntry_t* newest = entryAt(buffer, buffer->count - 1);
+    if (nowMs - newest->arrivalTime > SETPOINT_BUFFER_RESYNC_MS) {
+      setpointBufferReset(buffer);
+    }
+  }
+
+  uint32_t senderTime = senderTimeMs;
+  if (buffer->isSynced) {
+    senderTime = buffer->lastSenderTime + (int16_t)(senderTimeMs - (uint16_t)buffer->lastSenderTime);
+    if ((int32_t)(senderTime - buffer->lastSenderTime) <= 0) {
+      return false;
+    }
+  }
+
+  // The fastest arrival defines the offset between the clocks. Let it creep
+  // up slowly so that the offset follows clock drift in both directions.
+  const int32_t offset = (int32_t)(nowMs - senderTime);
+  if (!buffer->isSynced) {
+    buffer->offset = offset;
+    buffer->lastCreepTime = nowMs;
+    buffer->isSynced = true;
+  } else {
+    if (nowMs - buffer->lastCreepTime >= SETPOINT_BUFFER_OFFSET_CREEP_MS) {
+      buffer->offset += 1;
+      buffer->lastCreepTime = nowMs;
+    }
+    if (offset < buffer->offset) {
+      buffer->offset = offset;
+    }
+  }
+  buffer->jitterMs = offset - buffer->offset;
+
+  if (buffer->hasPlayTime && (int32_t)(senderTime - buffer->lastPlayTime) < 0) {
+    buffer->lateCount++;
+  }
+
+  if (buffer->count == SETPOINT_BUFFER_SIZE) {
+    releaseOldest(buffer);
+    buffer->overflowCount++;
+  }
+
+  setpointBufferEntry_t* entry = entryAt(buffer, buffer->count);
+  entry->setpoint = *setpoint;
+  entry->senderTime = senderTime;
+  entry->arrivalTime = nowMs;
+  buffer->count++;
+
+  buffer->lastSenderTime = senderTime;
+  return true;
+}
+
+bool setpointBufferGet(setpointBuffer_t* buffer, const setpointBufferConfig_t* config, uint32_t nowMs, setpoint_t* result) {
+  if (buffer->count == 0) {
+    return false;
+  }
+
+  const uint32_t playTime = nowMs - (uint32_t)buffer->offset - config->latencyMs;
+  buffer->lastPlayTime = playTime;
+  buffer->hasPlayTime = true;
+
+  while (buffer->count >= 2 && (int32_t)(entryAt(buffer, 1)->senderTime - playTime) <= 0) {
+    releaseOldest(buffer);
+  }
+
+  const setpointBufferEntry_t* a = entryAt(buffer, 0);
+  const int32_t sinceA = (int32_t)(playTime - a->senderTime);
+
+  if (sinceA < 0) {
+    // Not started yet, hold the first setpoint
+    *result = a->setpoint;
+  } else if (buffer->count >= 2) {
+    const setpointBufferEntry_t* b = entryAt(buffer, 1);
+    const float alpha = (float)sinceA / (float)(b->senderTime - a->senderTime);
+    interpolate(result, &a->setpoint, &b->setpoint, alpha);
+  } else if (sinceA > 0 && buffer->hasPrevious) {
+    // The buffer has run dry, extrapolate from the last two setpoints
+    int32_t extrapolation = sinceA;
+    if (extrapolation > config->maxExtrapolationMs) {
+      extrapolation = config->maxExtrapolationMs;
+      buffer->holdCount++;
+    } else {
+      buffer->extrapolationCount++;
+    }
+
+    const setpointBufferEntry_t* previous = &buffer->previous;
+    const float alpha = 1.0f + (float)extrapolation / (float)(a->senderTime - previous->senderTime);
+    interpolate(result, &previous->setpoint, &a->setpoint, alpha);
+  } else {
+    if (sinceA > 0) {
+      buffer->holdCount++;
+    }
+    *result = a->setpoint;
+  }
+
+  buffer->delayMs = (int32_t)(nowMs - a->arrivalTime) - sinceA;
+  result->timestamp = entryAt(buffer, buffer->count - 1)->arrivalTime;
+  return true;
+}
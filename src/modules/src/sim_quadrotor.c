@@ -0,0 +1,134 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sim_quadrotor.c - Rigid body model of a quadrotor, used for simulated sensors
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sim_quadrotor.h"
+#include "physicalConstants.h"
+
+void simQuadrotorDefaultParams(simQuadrotorParams_t* params) {
+  *params = (simQuadrotorParams_t){
+    .mass = 0.027f,
+    .armLength = 0.046f,
+    .inertia = {16.6e-6f, 16.7e-6f, 29.3e-6f},
+    .thrustToTorque = 0.005964552f,
+    .pwmToThrustA = 0.091492681f,
+    .pwmToThrustB = 0.067673604f,
+    .drag = 0.01f,
+    .motorTimeConstant = 0.02f,
+  };
+}
+
+void simQuadrotorInit(simQuadrotor_t* this, const simQuadrotorParams_t* params, const struct vec position, const float yaw) {
+  memset(this, 0, sizeof(simQuadrotor_t));
+  this->params = *params;
+  this->position = position;
+  this->velocity = vzero();
+  this->attitude = rpy2quat(mkvec(0.0f, 0.0f, yaw));
+  this->angularVelocity = vzero();
+  this->acceleration = vzero();
+  this->isOnGround = true;
+}
+
+static float motorThrust(const simQuadrotorParams_t* params, const uint16_t ratio) {
+  const float pwm = (float)ratio / UINT16_MAX;
+  return params->pwmToThrustA * pwm * pwm + params->pwmToThrustB * pwm;
+}
+
+void simQuadrotorStep(simQuadrotor_t* this, const uint16_t motorRatio[STABILIZER_NR_OF_MOTORS], const float dt) {
+  const simQuadrotorParams_t* params = &this->params;
+
+  // First order motor dynamics
+  const float alpha = dt / (params->motorTimeConstant + dt);
+  float* f = this->motorThrust;
+  for (int i = 0; i < STABILIZER_NR_OF_MOTORS; i++) {
+    f[i] += alpha * (motorThrust(params, motorRatio[i]) - f[i]);
+  }
+
+  // Inverse of the mixer in power_distribution_quadrotor.c
+  const float arm = 0.707106781f * params->armLength;
+  const float thrust = f[0] + f[1] + f[2] + f[3];
+  const struct vec torque = mkvec(
+    arm * (-f[0] - f[1] + f[2] + f[3]),
+    arm * (-f[0] + f[1] + f[2] - f[3]),
+    params->thrustToTorque * (-f[0] + f[1] - f[2] + f[3]));
+
+  // Translation, world frame
+  const struct vec thrustWorld = qvrot(this->attitude, mkvec(0.0f, 0.0f, thrust));
+  const struct vec dragForce = vscl(-params->drag, this->velocity);
+  struct vec acc = vadd(vscl(1.0f / params->mass, vadd(thrustWorld, dragForce)), mkvec(0.0f, 0.0f, -GRAVITY_MAGNITUDE));
+
+  // Rotation, body frame: I * dw/dt = torque - w x (I * w)
+  const struct vec w = this->angularVelocity;
+  const struct vec iw = mkvec(params->inertia[0] * w.x, params->inertia[1] * w.y, params->inertia[2] * w.z);
+  const struct vec netTorque = vsub(torque, vcross(w, iw));
+  struct vec angularAcc = mkvec(netTorque.x / params->inertia[0], netTorque.y / params->inertia[1], netTorque.z / params->inertia[2]);
+
+  // The ground carries the weight until the thrust is larger
+  this->isOnGround = this->position.z <= 0.0f && acc.z <= 0.0f;
+  if (this->isOnGround) {
+    acc = vzero();
+    angularAcc = vzero();
+    this->velocity = vzero();
+    this->angularVelocity = vzero();
+    this->position.z = 0.0f;
+  }
+
+  this->acceleration = acc;
+  this->velocity = vadd(this->velocity, vscl(dt, acc));
+  this->position = vadd(this->position, vscl(dt, this->velocity));
+  this->angularVelocity = vadd(this->angularVelocity, vscl(dt, angularAcc));
+  this->attitude = quat_gyro_update(this->attitude, this->angularVelocity, dt);
+
+  if (this->position.z < 0.0f) {
+    this->position.z = 0.0f;
+    this->velocity = vzero();
+  }
+}
+
+void simQuadrotorGetGyro(const simQuadrotor_t* this, Axis3f* gyro) {
+  gyro->x = degrees(this->angularVelocity.x);
+  gyro->y = degrees(this->angularVelocity.y);
+  gyro->z = degrees(this->angularVelocity.z);
+}
+
+void simQuadrotorGetAcc(const simQuadrotor_t* this, Axis3f* acc) {
+  // An accelerometer measures the acceleration minus gravity
+  const struct vec specificForce = vadd(this->acceleration, mkvec(0.0f, 0.0f, GRAVITY_MAGNITUDE));
+  const struct vec body = qvrot(qinv(this->attitude), specificForce);
+  acc->x = body.x / GRAVITY_MAGNITUDE;
+  acc->y = body.y / GRAVITY_MAGNITUDE;
+  acc->z = body.z / GRAVITY_MAGNITUDE;
+}
+
+void simQuadrotorGetBaro(const simQuadrotor_t* this, baro_t* baro) {
+  // Inverse of the conversion in sensorsScaleBaro() in sensors_bmi088_bmp3xx.c
+  const float asl = this->position.z;
+  baro->asl = asl;
+  baro->temperature = 25.0f;
+  baro->pressure = 1015.7f / powf(1.0f + asl * 0.0065f / (25.0f + 273.15f), 1.0f / 0.1902630958f);
+}
@@ -25,6 +25,7 @@
  */
 #define DEBUG_MODULE "STAB"
 
+#include <assert.h>
 #include <math.h>
 
 #include "FreeRTOS.h"
@@ -56,10 +57,20 @@
 #include "statsCnt.h"
 #include "static_mem.h"
 #include "rateSupervisor.h"
+#include "stabilizer_profiler.h"
+#include "cycle_counter.h"
+#include "event_trace.h"
+#include "seqlock.h"
+#include "flight_recorder.h"
+#include "sysid.h"
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+#include "rate_loop.h"
+#endif
 
 static bool isInit;
 
 static uint32_t inToOutLatency;
+static uint32_t controlToMotorsLatency;
 
 // State variables for the stabilizer
 static setpoint_t setpoint;
@@ -74,48 +85,26 @@ static motors_thrust_pwm_t motorPwm;
 // For scratch storage - never logged or passed to other subsystems.
 static setpoint_t tempSetpoint;
 
+// Copies of the state variables published once per iteration, for readers in other tasks
+static seqlock_t publishedLock;
+static stabilizerSnapshot_t published;
+static stabilizerTickCallback_t tickCallback;
+
 static StateEstimatorType estimatorType;
 static ControllerType controllerType;
 
 static STATS_CNT_RATE_DEFINE(stabilizerRate, 500);
-static rateSupervisor_t rateSupervisorContext;
+static rateSupervisorTask_t rateSupervisorTask;
 static bool rateWarningDisplayed = false;
 
-static struct {
-  // position - mm
-  int16_t x;
-  int16_t y;
-  int16_t z;
-  // velocity - mm / sec
-  int16_t vx;
-  int16_t vy;
-  int16_t vz;
-  // acceleration - mm / sec^2
-  int16_t ax;
-  int16_t ay;
-  int16_t az;
-  // compressed quaternion, see quatcompress.h
-  int32_t quat;
-  // angular velocity - milliradians / sec
-  int16_t rateRoll;
-  int16_t ratePitch;
-  int16_t rateYaw;
-} stateCompressed;
-
-static struct {
-  // position - mm
-  int16_t x;
-  int16_t y;
-  int16_t z;
-  // velocity - mm / sec
-  int16_t vx;
-  int16_t vy;
-  int16_t vz;
-  // acceleration - mm / sec^2
-  int16_t ax;
-  int16_t ay;
-  int16_t az;
-} setpointCompressed;
+static stateCompressed_t stateCompressed;
+static setpointCompressed_t setpointCompressed;
+
+// The compressed formats are only computed when sampled by a log block or uSD logging
+static void compressState(void);
+static void compressSetpoint(void);
+static logLazyGroup_t stateCompressedLog = {.group = "stateEstimateZ", .prepare = compressState};
+static logLazyGroup_t setpointCompressedLog = {.group = "ctrltargetZ", .prepare = compressSetpoint};
 
 STATIC_MEM_TASK_ALLOC(stabilizerTask, STABILIZER_TASK_STACKSIZE);
 
@@ -127,46 +116,56 @@ static void calcSensorToOutputLatency(const sensorData_t *sensorData)
   inToOutLatency = outTimestamp - sensorData->interruptTimestamp;
 }
 
-static void compressState()
+void stabilizerCompressState(const state_t* state, const sensorData_t* sensorData, stateCompressed_t* dest)
 {
-  stateCompressed.x = state.position.x * 1000.0f;
-  stateCompressed.y = state.position.y * 1000.0f;
-  stateCompressed.z = state.position.z * 1000.0f;
+  dest->x = state->position.x * 1000.0f;
+  dest->y = state->position.y * 1000.0f;
+  dest->z = state->position.z * 1000.0f;
 
-  stateCompressed.vx = state.velocity.x * 1000.0f;
-  stateCompressed.vy = state.velocity.y * 1000.0f;
-  stateCompressed.vz = state.velocity.z * 1000.0f;
+  dest->vx = state->velocity.x * 1000.0f;
+  dest->vy = state->velocity.y * 1000.0f;
+  dest->vz = state->velocity.z * 1000.0f;
 
-  stateCompressed.ax = state.acc.x * 9.81f * 1000.0f;
-  stateCompressed.ay = state.acc.y * 9.81f * 1000.0f;
-  stateCompressed.az = (state.acc.z + 1) * 9.81f * 1000.0f;
+  dest->ax = state->acc.x * 9.81f * 1000.0f;
+  dest->ay = state->acc.y * 9.81f * 1000.0f;
+  dest->az = (state->acc.z + 1) * 9.81f * 1000.0f;
 
   float const q[4] = {
-    state.attitudeQuaternion.x,
-    state.attitudeQuaternion.y,
-    state.attitudeQuaternion.z,
-    state.attitudeQuaternion.w};
-  stateCompressed.quat = quatcompress(q);
+    state->attitudeQuaternion.x,
+    state->attitudeQuaternion.y,
+    state->attitudeQuaternion.z,
+    state->attitudeQuaternion.w};
+  dest->quat = quatcompress(q);
 
   float const deg2millirad = ((float)M_PI * 1000.0f) / 180.0f;
-  stateCompressed.rateRoll = sensorData.gyro.x * deg2millirad;
-  stateCompressed.ratePitch = -sensorData.gyro.y * deg2millirad;
-  stateCompressed.rateYaw = sensorData.gyro.z * deg2millirad;
+  dest->rateRoll = sensorData->gyro.x * deg2millirad;
+  dest->ratePitch = -sensorData->gyro.y * deg2millirad;
+  dest->rateYaw = sensorData->gyro.z * deg2millirad;
 }
 
-static void compressSetpoint()
+void stabilizerCompressSetpoint(const setpoint_t* setpoint, setpointCompressed_t* dest)
 {
-  setpointCompressed.x = setpoint.position.x * 1000.0f;
-  setpointCompressed.y = setpoint.position.y * 1000.0f;
-  setpointCompressed.z = setpoint.position.z * 1000.0f;
+  dest->x = setpoint->position.x * 1000.0f;
+  dest->y = setpoint->position.y * 1000.0f;
+  dest->z = setpoint->position.z * 1000.0f;
+
+  dest->vx = setpoint->velocity.x * 1000.0f;
+  dest->vy = setpoint->velocity.y * 1000.0f;
+  dest->vz = setpoint->velocity.z * 1000.0f;
 
-  setpointCompressed.vx = setpoint.velocity.x * 1000.0f;
-  setpointCompressed.vy = setpoint.velocity.y * 1000.0f;
-  setpointCompressed.vz = setpoint.velocity.z * 1000.0f;
+  dest->ax = setpoint->acceleration.x * 1000.0f;
+  dest->ay = setpoint->acceleration.y * 1000.0f;
+  dest->az = setpoint->acceleration.z * 1000.0f;
+}
 
-  setpointCompressed.ax = setpoint.acceleration.x * 1000.0f;
-  setpointCompressed.ay = setpoint.acceleration.y * 1000.0f;
-  setpointCompressed.az = setpoint.acceleration.z * 1000.0f;
+static void compressState(void)
+{
+  stabilizerCompressState(&state, &sensorData, &stateCompressed);
+}
+
+static void compressSetpoint(void)
+{
+  stabilizerCompressSetpoint(&setpoint, &setpointCompressed);
 }
 
 void stabilizerInit(StateEstimatorType estimator)
@@ -180,6 +179,19 @@ void stabilizerInit(StateEstimatorType estimator)
   powerDistributionInit();
   motorsInit(platformConfigGetMotorMapping());
   collisionAvoidanceInit();
+  logLazyGroupRegister(&stateCompressedLog);
+  logLazyGroupRegister(&setpointCompressedLog);
+  stabilizerProfilerInit();
+  seqlockInit(&publishedLock);
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+  rateLoopInit();
+#endif
+#ifdef CONFIG_FLIGHT_RECORDER
+  flightRecorderInit();
+#endif
+#ifdef CONFIG_SYSID
+  sysidInit();
+#endif
   estimatorType = stateEstimatorGetType();
   controllerType = controllerGetType();
 
@@ -202,28 +214,32 @@ bool stabilizerTest(void)
   return pass;
 }
 
+static_assert(STABILIZER_NR_OF_MOTORS == NBR_OF_MOTORS);
+
 static void batteryCompensation(const motors_thrust_uncapped_t* motorThrustUncapped, motors_thrust_uncapped_t* motorThrustBatCompUncapped)
 {
   float supplyVoltage = pmGetBatteryVoltage();
 
-  for (int motor = 0; motor < STABILIZER_NR_OF_MOTORS; motor++)
-  {
-    motorThrustBatCompUncapped->list[motor] = motorsCompensateBatteryVoltage(motor, motorThrustUncapped->list[motor], supplyVoltage);
-  }
+  motorsCompensateBatteryVoltageAll(motorThrustUncapped->list, motorThrustBatCompUncapped->list, supplyVoltage);
 }
 
 static void setMotorRatios(const motors_thrust_pwm_t* motorPwm)
 {
-  motorsSetRatio(MOTOR_M1, motorPwm->motors.m1);
-  motorsSetRatio(MOTOR_M2, motorPwm->motors.m2);
-  motorsSetRatio(MOTOR_M3, motorPwm->motors.m3);
-  motorsSetRatio(MOTOR_M4, motorPwm->motors.m4);
+  motorsSetRatios(motorPwm->list);
 }
 
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
 static void updateStateEstimatorAndControllerTypes() {
-  if (stateEstimatorGetType() != estimatorType) {
-    stateEstimatorSwitchTo(estimatorType);
-    estimatorType = stateEstimatorGetType();
+  if (stateEstimatorGetType() != estimatorType && !stateEstimatorIsSwitching()) {
+    stateEstimatorRequestSwitch(estimatorType, &state);
+    if (!stateEstimatorIsSwitching()) {
+      estimatorType = stateEstimatorGetType();
+    }
+  }
+
+  if (controllerFallbackTriggered()) {
+    // The controller switched to the fallback controller, reflect it in the parameter
+    controllerType = controllerGetType();
   }
 
   if (controllerGetType() != controllerType) {
@@ -231,6 +247,60 @@ static void updateStateEstimatorAndControllerTypes() {
     controllerType = controllerGetType();
   }
 }
+#endif
+
+// Add the cycles since start to the stage, returns the start of the next stage
+static uint32_t profileStage(const stabilizerProfilerStage_t stage, const uint32_t start) {
+  const uint32_t now = cycleCounterGet();
+  stabilizerProfilerAdd(stage, now - start);
+  EVENT_TRACE_MARK(EVENT_TRACE_MARKER_STABILIZER_STAGE, stage);
+  return now;
+}
+
+static void publish(const stabilizerStep_t stabilizerStep) {
+  seqlockWriteBegin(&publishedLock);
+  published.step = stabilizerStep;
+  published.state = state;
+  published.setpoint = setpoint;
+  published.sensorData = sensorData;
+  published.control = control;
+  seqlockWriteEnd(&publishedLock);
+
+  // The writer can read the published data without the lock
+  const stabilizerTickCallback_t callback = tickCallback;
+  if (callback) {
+    callback(&published);
+  }
+}
+
+bool stabilizerGetState(state_t* dest) {
+  return seqlockRead(&publishedLock, &published.state, dest, sizeof(*dest));
+}
+
+bool stabilizerGetSetpoint(setpoint_t* dest) {
+  return seqlockRead(&publishedLock, &published.setpoint, dest, sizeof(*dest));
+}
+
+bool stabilizerGetSensorData(sensorData_t* dest) {
+  return seqlockRead(&publishedLock, &published.sensorData, dest, sizeof(*dest));
+}
+
+bool stabilizerGetSnapshot(stabilizerSnapshot_t* dest) {
+  return seqlockRead(&publishedLock, &published, dest, sizeof(*dest));
+}
+
+const stabilizerSnapshot_t* stabilizerSnapshotReadBegin(uint32_t* sequence) {
+  *sequence = seqlockReadBegin(&publishedLock);
+  return &published;
+}
+
+bool stabilizerSnapshotReadEnd(const uint32_t sequence) {
+  return seqlockReadValidate(&publishedLock, sequence);
+}
+
+void stabilizerSetTickCallback(stabilizerTickCallback_t callback) {
+  tickCallback = callback;
+}
 
 static void logCapWarning(const bool isCapped) {
   #ifdef CONFIG_LOG_MOTOR_CAP_WARNING
@@ -246,12 +316,17 @@ static void logCapWarning(const bool isCapped) {
   #endif
 }
 
-static void controlMotors(const control_t* control) {
+void stabilizerControlMotors(const control_t* control) {
+  const uint64_t controlTimestamp = usecTimestamp();
   powerDistribution(control, &motorThrustUncapped);
   batteryCompensation(&motorThrustUncapped, &motorThrustBatCompUncapped);
   const bool isCapped = powerDistributionCap(&motorThrustBatCompUncapped, &motorPwm);
   logCapWarning(isCapped);
+#ifdef CONFIG_SYSID
+  sysidUpdateMotors(&motorPwm);
+#endif
   setMotorRatios(&motorPwm);
+  controlToMotorsLatency = usecTimestamp() - controlTimestamp;
 }
 
 /* The stabilizer loop runs at 1kHz. It is the
@@ -279,23 +354,39 @@ static void stabilizerTask(void* param)
 
   systemWaitStart();
   DEBUG_PRINT("Starting stabilizer loop\n");
-  rateSupervisorInit(&rateSupervisorContext, xTaskGetTickCount(), M2T(1000), 997, 1003, 1);
+  rateSupervisorRegisterTask(&rateSupervisorTask, "stabilizer", T2M(xTaskGetTickCount()), 1000, 3, 1);
 
   while(1) {
     // The sensor should unlock at 1kHz
     sensorsWaitDataReady();
+    const uint32_t loopStart = cycleCounterGet();
+#if defined(CONFIG_STABILIZER_INNER_RATE_LOOP) && defined(CONFIG_MOTORS_ESC_PROTOCOL_DSHOT)
+    bool isRateLoopDrivingMotors = false;
+#endif
+    EVENT_TRACE_MARK(EVENT_TRACE_MARKER_STABILIZER_LOOP, stabilizerStep);
+
+    // Committed param transactions are swapped in between two ticks
+    paramTransactionApply();
 
     // update sensorData struct (for logging variables)
     sensorsAcquire(&sensorData);
+    motorsGetRpm(sensorData.motorRpm);
+    uint32_t stageStart = profileStage(StabilizerStageSensors, loopStart);
 
     if (healthShallWeRunTest()) {
       healthRunTests(&sensorData);
     } else {
+#ifndef CONFIG_STABILIZER_FIXED_DISPATCH
       updateStateEstimatorAndControllerTypes();
+#endif
 
       stateEstimator(&state, stabilizerStep);
+      stageStart = profileStage(StabilizerStageEstimator, stageStart);
 
       const bool areMotorsAllowedToRun = supervisorAreMotorsAllowedToRun();
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+      rateLoopSetMotorsAllowed(areMotorsAllowedToRun);
+#endif
 
       // Critical for safety, be careful if you modify this code!
       crtpCommanderBlock(! areMotorsAllowedToRun);
@@ -304,31 +395,56 @@ static void stabilizerTask(void* param)
         commanderSetSetpoint(&tempSetpoint, COMMANDER_PRIORITY_HIGHLEVEL);
       }
       commanderGetSetpoint(&setpoint, &state);
+      stageStart = profileStage(StabilizerStageSetpoint, stageStart);
 
       // Critical for safety, be careful if you modify this code!
       // Let the supervisor update it's view of the current situation
       supervisorUpdate(&sensorData, &setpoint, stabilizerStep);
+      stageStart = profileStage(StabilizerStageSupervisor, stageStart);
 
       // Let the collision avoidance module modify the setpoint, if needed
       collisionAvoidanceUpdateSetpoint(&setpoint, &sensorData, &state, stabilizerStep);
+      stageStart = profileStage(StabilizerStageCollisionAvoidance, stageStart);
+
+#ifdef CONFIG_SYSID
+      // Excitation for system identification, before the supervisor can override the setpoint
+      sysidUpdateSetpoint(&setpoint, stabilizerStep);
+#endif
 
       // Critical for safety, be careful if you modify this code!
       // Let the supervisor modify the setpoint to handle exceptional conditions
       supervisorOverrideSetpoint(&setpoint);
 
+      stageStart = cycleCounterGet();
       controller(&control, &setpoint, &sensorData, &state, stabilizerStep);
+      stageStart = profileStage(StabilizerStageController, stageStart);
 
       // Critical for safety, be careful if you modify this code!
       // The supervisor will already set thrust to 0 in the setpoint if needed, but to be extra sure prevent motors from running.
       if (areMotorsAllowedToRun) {
-        controlMotors(&control);
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+        // The inner rate loop owns the motors, it uses this control when the controller does not feed it
+        rateLoopSetStabilizerControl(&control);
+#ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+        isRateLoopDrivingMotors = true;
+#endif
+#else
+        stabilizerControlMotors(&control);
+#endif
       } else {
         motorsStop();
       }
+      stageStart = profileStage(StabilizerStageMotors, stageStart);
 
-      // Compute compressed log formats
-      compressState();
-      compressSetpoint();
+      publish(stabilizerStep);
+      logStabilizerStep(stabilizerStep);
+#ifdef CONFIG_FLIGHT_RECORDER
+      flightRecorderSample(stabilizerStep, &state, &setpoint, &sensorData);
+#endif
+#ifdef CONFIG_SYSID
+      sysidCapture(stabilizerStep, &sensorData);
+#endif
+      profileStage(StabilizerStagePublish, stageStart);
 
 #ifdef CONFIG_DECK_USD
       // Log data to uSD card if configured
@@ -342,19 +458,36 @@ static void stabilizerTask(void* param)
       stabilizerStep++;
       STATS_CNT_RATE_EVENT(&stabilizerRate);
 
-      if (!rateSupervisorValidate(&rateSupervisorContext, xTaskGetTickCount())) {
+      stabilizerProfilerAdd(StabilizerStageLoop, cycleCounterElapsed(loopStart));
+      stabilizerProfilerUpdate(T2M(xTaskGetTickCount()));
+
+      if (!rateSupervisorTaskValidate(&rateSupervisorTask, T2M(xTaskGetTickCount()))) {
         if (!rateWarningDisplayed) {
-          DEBUG_PRINT("WARNING: stabilizer loop rate is off (%lu)\n", rateSupervisorLatestCount(&rateSupervisorContext));
+          DEBUG_PRINT("WARNING: stabilizer loop rate is off (%lu)\n", rateSupervisorLatestCount(&rateSupervisorTask.supervisor));
           rateWarningDisplayed = true;
         }
       }
     }
 #ifdef CONFIG_MOTORS_ESC_PROTOCOL_DSHOT
+#ifdef CONFIG_STABILIZER_INNER_RATE_LOOP
+    // The inner rate loop bursts the DShot frames right after setting the motors
+    if (!isRateLoopDrivingMotors) {
+      motorsBurstDshot();
+    }
+#else
     motorsBurstDshot();
+#endif
 #endif
   }
 }
 
+#ifdef CONFIG_STABILIZER_FIXED_DISPATCH
+// The types are fixed at compile time, the parameters only report them
+#define STABILIZER_TYPE_PARAM (PARAM_UINT8 | PARAM_RONLY)
+#else
+#define STABILIZER_TYPE_PARAM PARAM_UINT8
+#endif
+
 /**
  * Parameters to set the estimator and controller type
  * for the stabilizer module
@@ -364,12 +497,16 @@ PARAM_GROUP_START(stabilizer)
  * @brief Estimator type Auto select(0), complementary(1), extended kalman(2), **unscented kalman(3)  (Default: 0)
  *
  * ** Experimental, needs to be enabled in kbuild
+ *
+ * Read only when built with CONFIG_STABILIZER_FIXED_DISPATCH
  */
-PARAM_ADD_CORE(PARAM_UINT8, estimator, &estimatorType)
+PARAM_ADD_CORE(STABILIZER_TYPE_PARAM, estimator, &estimatorType)
 /**
  * @brief Controller type Auto select(0), PID(1), Mellinger(2), INDI(3), Brescianini(4), Lee(5) (Default: 0)
+ *
+ * Read only when built with CONFIG_STABILIZER_FIXED_DISPATCH
  */
-PARAM_ADD_CORE(PARAM_UINT8, controller, &controllerType)
+PARAM_ADD_CORE(STABILIZER_TYPE_PARAM, controller, &controllerType)
 PARAM_GROUP_STOP(stabilizer)
 
 
@@ -530,6 +667,10 @@ STATS_CNT_RATE_LOG_ADD(rtStab, &stabilizerRate)
  *    Note: Used for debugging but could also be used as a system test
  */
 LOG_ADD(LOG_UINT32, intToOut, &inToOutLatency)
+/**
+ * @brief Latency from the controller output to the motor outputs being set [us]
+ */
+LOG_ADD(LOG_UINT32, ctrlToMotor, &controlToMotorsLatency)
 LOG_GROUP_STOP(stabilizer)
 
 /**
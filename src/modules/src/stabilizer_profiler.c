@@ -0,0 +1,116 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * stabilizer_profiler.c - CPU cycles spent per stage of the stabilizer loop
+ */
+
+#include <string.h>
+#include "stabilizer_profiler.h"
+#include "log.h"
+
+static stabilizerProfilerStageStats_t stageStats[StabilizerStage_COUNT];
+
+void stabilizerProfilerInit(void) {
+  memset(stageStats, 0, sizeof(stageStats));
+  for (int i = 0; i < StabilizerStage_COUNT; i++) {
+    statsCntMinMaxAvgInit(&stageStats[i].cycles, STABILIZER_PROFILER_INTERVAL_MS);
+  }
+}
+
+void stabilizerProfilerAdd(const stabilizerProfilerStage_t stage, const uint32_t cycles) {
+  stabilizerProfilerStageStats_t* stats = &stageStats[stage];
+  statsCntMinMaxAvgAdd(&stats->cycles, cycles);
+
+  uint16_t* bin = &stats->bins[stabilizerProfilerBin(cycles)];
+  if (*bin < UINT16_MAX) {
+    (*bin)++;
+  }
+}
+
+bool stabilizerProfilerUpdate(const uint32_t nowMs) {
+  bool isUpdated = false;
+
+  // The histograms follow the averaging interval of the min/avg/max statistics
+  for (int i = 0; i < StabilizerStage_COUNT; i++) {
+    stabilizerProfilerStageStats_t* stats = &stageStats[i];
+    if (statsCntMinMaxAvgUpdate(&stats->cycles, nowMs)) {
+      memcpy(stats->latestBins, stats->bins, sizeof(stats->bins));
+      memset(stats->bins, 0, sizeof(stats->bins));
+      isUpdated = true;
+    }
+  }
+
+  return isUpdated;
+}
+
+const stabilizerProfilerStageStats_t* stabilizerProfilerGetStage(const uint8_t stage) {
+  if (stage >= StabilizerStage_COUNT) {
+    return 0;
+  }
+  return &stageStats[stage];
+}
+
+/**
+ * CPU cycles spent per stage of the stabilizer loop. Each entry has the min,
+ * average and max number of cycles per iteration [cycles] and the rate [Hz],
+ * calculated over one second. The histograms are available through the
+ * platform service on CRTP.
+ */
+LOG_GROUP_START(stabCyc)
+  /**
+  * @brief Acquisition of sensor data, sensorsAcquire()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sens, &stageStats[StabilizerStageSensors].cycles)
+  /**
+  * @brief State estimator, stateEstimator()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(est, &stageStats[StabilizerStageEstimator].cycles)
+  /**
+  * @brief Setpoint from the high level and low level commanders
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(setp, &stageStats[StabilizerStageSetpoint].cycles)
+  /**
+  * @brief Supervisor, supervisorUpdate()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(sup, &stageStats[StabilizerStageSupervisor].cycles)
+  /**
+  * @brief Collision avoidance, collisionAvoidanceUpdateSetpoint()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(colAv, &stageStats[StabilizerStageCollisionAvoidance].cycles)
+  /**
+  * @brief Controller, controller()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(ctrl, &stageStats[StabilizerStageController].cycles)
+  /**
+  * @brief Power distribution and motor output, stabilizerControlMotors()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(mot, &stageStats[StabilizerStageMotors].cycles)
+  /**
+  * @brief Publication of state, setpoint and sensor data to other tasks, see stabilizerGetState()
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(pub, &stageStats[StabilizerStagePublish].cycles)
+  /**
+  * @brief The full stabilizer loop
+  */
+  STATS_CNT_MIN_MAX_AVG_LOG_ADD(loop, &stageStats[StabilizerStageLoop].cycles)
+LOG_GROUP_STOP(stabCyc)
@@ -26,8 +26,47 @@
  * @copyright Copyright (c) 2019 Bitcraze AB
  */
 
+#include <stdbool.h>
 #include <FreeRTOS.h>
+#include <task.h>
 #include "static_mem.h"
+#include "arena.h"
+
+/* Symbols set by the linker script, the CCM that is not used by .ccmbss and .ccmdata */
+extern uint8_t _sccmarena;
+extern uint8_t _eccmarena;
+
+static arena_t ccmArena;
+static bool isCcmArenaInit = false;
+
+// Must be called in a critical section
+static void ccmArenaInit(void)
+{
+  if (!isCcmArenaInit) {
+    arenaInit(&ccmArena, &_sccmarena, &_eccmarena - &_sccmarena);
+    isCcmArenaInit = true;
+  }
+}
+
+void* ccmArenaAlloc(const size_t size)
+{
+  taskENTER_CRITICAL();
+  ccmArenaInit();
+  void* result = arenaAlloc(&ccmArena, size);
+  taskEXIT_CRITICAL();
+
+  return result;
+}
+
+size_t ccmArenaGetFree(void)
+{
+  taskENTER_CRITICAL();
+  ccmArenaInit();
+  const size_t result = arenaGetFree(&ccmArena);
+  taskEXIT_CRITICAL();
+
+  return result;
+}
 
 /**
  * @brief configSUPPORT_STATIC_ALLOCATION is set to 1, so the application must provide an
@@ -42,6 +42,8 @@
 #include "crtp_localization_service.h"
 #include "system.h"
 #include "autoconf.h"
+#include "statsCnt.h"
+#include "cycle_counter.h"
 
 #define DEBUG_MODULE "SUP"
 #include "debug.h"
@@ -89,6 +91,8 @@ typedef struct {
   // Copy of latest conditions, for logging
   supervisorConditionBits_t latestConditions;
   uint8_t doinfodump;
+
+  bool isChecksInit;
 } SupervisorMem_t;
 
 static SupervisorMem_t supervisorMem;
@@ -125,6 +129,10 @@ bool supervisorIsCrashed() {
   return supervisorMem.isCrashed;
 }
 
+uint16_t supervisorGetInfoField() {
+  return supervisorMem.infoBitfield;
+}
+
 static void supervisorSetLatestLandingTime(SupervisorMem_t* this, const uint32_t currentTick) {
   this->latestLandingTick = currentTick;
 }
@@ -297,23 +305,70 @@ static void postTransitionActions(SupervisorMem_t* this, const supervisorState_t
   }
 }
 
-static supervisorConditionBits_t updateAndPopulateConditions(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
-  supervisorConditionBits_t conditions = 0;
+//
+// The conditions are produced by a set of checks, each running at its own rate. The checks that can stop the motors
+// (disarming, emergency stop and crash) run on every tick, the others at the rate their signals change at. The latest
+// result of each check is kept between runs and the state machine is updated at RATE_SUPERVISOR, or directly when any
+// condition changes.
+//
+typedef supervisorConditionBits_t (*supervisorCheckFn_t)(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick);
 
-  if (supervisorIsArmed()) {
-    conditions |= SUPERVISOR_CB_ARMED;
-  }
+typedef struct {
+  supervisorCheckFn_t check;
+  uint16_t rateHz;
+  // Offset in stabilizer steps, to spread the decimated checks over different ticks
+  uint16_t phase;
+  // Worst case execution time [cycles], runs exceeding it are counted as overruns
+  uint32_t budgetCycles;
+  const char* name;
+} supervisorCheckDef_t;
 
-  const bool isFlying = isFlyingCheck(this, currentTick);
-  if (isFlying) {
-    conditions |= SUPERVISOR_CB_IS_FLYING;
-  }
+typedef struct {
+  supervisorConditionBits_t latest;
+  uint32_t overruns;
+  statsCntMinMaxAvg_t cycles;
+} supervisorCheckState_t;
+
+typedef enum {
+  supervisorCheckArmed = 0,
+  supervisorCheckEmergencyStop,
+  supervisorCheckCrashed,
+  supervisorCheckTumbled,
+  supervisorCheckFlying,
+  supervisorCheckCommanderWatchdog,
+  supervisorCheckLandingTimeout,
+  supervisorCheck_NrOfChecks,
+} supervisorCheck_t;
+
+#define SUPERVISOR_CHECK_STATS_INTERVAL_MS 1000
+
+static supervisorConditionBits_t checkArmed(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  return supervisorIsArmed() ? SUPERVISOR_CB_ARMED : 0;
+}
 
-  const bool isTumbled = isTumbledCheck(this, sensors, currentTick);
-  if (isTumbled) {
-    conditions |= SUPERVISOR_CB_IS_TUMBLED;
+static supervisorConditionBits_t checkEmergencyStop(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  if (!checkEmergencyStopWatchdog(currentTick) || locSrvIsEmergencyStopRequested() || this->paramEmergencyStop) {
+    return SUPERVISOR_CB_EMERGENCY_STOP;
   }
 
+  return 0;
+}
+
+static supervisorConditionBits_t checkCrashed(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  return supervisorIsCrashed() ? SUPERVISOR_CB_CRASHED : 0;
+}
+
+static supervisorConditionBits_t checkTumbled(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  return isTumbledCheck(this, sensors, currentTick) ? SUPERVISOR_CB_IS_TUMBLED : 0;
+}
+
+static supervisorConditionBits_t checkFlying(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  return isFlyingCheck(this, currentTick) ? SUPERVISOR_CB_IS_FLYING : 0;
+}
+
+static supervisorConditionBits_t checkCommanderWatchdog(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  supervisorConditionBits_t conditions = 0;
+
   const uint32_t setpointAge = currentTick - setpoint->timestamp;
   if (setpointAge > COMMANDER_WDT_TIMEOUT_STABILIZE) {
     conditions |= SUPERVISOR_CB_COMMANDER_WDT_WARNING;
@@ -322,29 +377,67 @@ static supervisorConditionBits_t updateAndPopulateConditions(SupervisorMem_t* th
     conditions |= SUPERVISOR_CB_COMMANDER_WDT_TIMEOUT;
   }
 
-  if (!checkEmergencyStopWatchdog(currentTick)) {
-    conditions |= SUPERVISOR_CB_EMERGENCY_STOP;
-  }
+  return conditions;
+}
 
-  if (locSrvIsEmergencyStopRequested()) {
-    conditions |= SUPERVISOR_CB_EMERGENCY_STOP;
-  }
+static supervisorConditionBits_t checkLandingTimeout(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick) {
+  return supervisorIsLandingTimeout(this, currentTick) ? SUPERVISOR_CB_LANDING_TIMEOUT : 0;
+}
 
-  if (this->paramEmergencyStop) {
-    conditions |= SUPERVISOR_CB_EMERGENCY_STOP;
-  }
+static const supervisorCheckDef_t checkDefs[supervisorCheck_NrOfChecks] = {
+  [supervisorCheckArmed] =            {.check = checkArmed, .rateHz = RATE_MAIN_LOOP, .phase = 0, .budgetCycles = 200, .name = "armed"},
+  [supervisorCheckEmergencyStop] =    {.check = checkEmergencyStop, .rateHz = RATE_MAIN_LOOP, .phase = 0, .budgetCycles = 400, .name = "emergencyStop"},
+  [supervisorCheckCrashed] =          {.check = checkCrashed, .rateHz = RATE_MAIN_LOOP, .phase = 0, .budgetCycles = 200, .name = "crashed"},
+  [supervisorCheckTumbled] =          {.check = checkTumbled, .rateHz = RATE_100_HZ, .phase = 3, .budgetCycles = 400, .name = "tumbled"},
+  [supervisorCheckFlying] =           {.check = checkFlying, .rateHz = RATE_SUPERVISOR, .phase = 11, .budgetCycles = 800, .name = "flying"},
+  [supervisorCheckCommanderWatchdog] = {.check = checkCommanderWatchdog, .rateHz = RATE_SUPERVISOR, .phase = 23, .budgetCycles = 200, .name = "commanderWdt"},
+  [supervisorCheckLandingTimeout] =   {.check = checkLandingTimeout, .rateHz = RATE_SUPERVISOR, .phase = 31, .budgetCycles = 200, .name = "landingTimeout"},
+};
+
+static supervisorCheckState_t checkStates[supervisorCheck_NrOfChecks];
+static uint32_t checkOverruns;
+
+static void initChecks() {
+  for (int i = 0; i < supervisorCheck_NrOfChecks; i++) {
+    checkStates[i].latest = 0;
+    checkStates[i].overruns = 0;
+    statsCntMinMaxAvgInit(&checkStates[i].cycles, SUPERVISOR_CHECK_STATS_INTERVAL_MS);
+  }
+  checkOverruns = 0;
+}
 
-  if (supervisorIsCrashed()) {
-    conditions |= SUPERVISOR_CB_CRASHED;
-  }
+static supervisorConditionBits_t runChecks(SupervisorMem_t* this, const sensorData_t *sensors, const setpoint_t* setpoint, const uint32_t currentTick, const stabilizerStep_t stabilizerStep) {
+  supervisorConditionBits_t conditions = 0;
+
+  for (int i = 0; i < supervisorCheck_NrOfChecks; i++) {
+    const supervisorCheckDef_t* def = &checkDefs[i];
+    supervisorCheckState_t* checkState = &checkStates[i];
+
+    if (RATE_DO_EXECUTE(def->rateHz, stabilizerStep + def->phase)) {
+      const uint32_t start = cycleCounterGet();
+      checkState->latest = def->check(this, sensors, setpoint, currentTick);
+      const uint32_t cycles = cycleCounterElapsed(start);
+
+      statsCntMinMaxAvgAdd(&checkState->cycles, cycles);
+      if (cycles > def->budgetCycles) {
+        checkState->overruns++;
+        checkOverruns++;
+      }
+    }
 
-  if (supervisorIsLandingTimeout(this, currentTick)) {
-    conditions |= SUPERVISOR_CB_LANDING_TIMEOUT;
+    conditions |= checkState->latest;
   }
 
   return conditions;
 }
 
+static void updateCheckStats(const uint32_t currentTick) {
+  const uint32_t nowMs = T2M(currentTick);
+  for (int i = 0; i < supervisorCheck_NrOfChecks; i++) {
+    statsCntMinMaxAvgUpdate(&checkStates[i].cycles, nowMs);
+  }
+}
+
 static void updateLogData(SupervisorMem_t* this, const supervisorConditionBits_t conditions) {
   this->canFly = supervisorAreMotorsAllowedToRun();
   this->isFlying = (this->state == supervisorStateFlying) || (this->state == supervisorStateWarningLevelOut);
@@ -352,40 +445,51 @@ static void updateLogData(SupervisorMem_t* this, const supervisorConditionBits_t
 
   this->infoBitfield = 0;
   if (supervisorCanArm()) {
-    this->infoBitfield |= 0x0001;
+    this->infoBitfield |= SUPERVISOR_INFO_CAN_ARM;
   }
   if (supervisorIsArmed()) {
-    this->infoBitfield |= 0x0002;
+    this->infoBitfield |= SUPERVISOR_INFO_IS_ARMED;
   }
   if(AUTO_ARMING || this->deprecatedArmParam) {
-    this->infoBitfield |= 0x0004;
+    this->infoBitfield |= SUPERVISOR_INFO_AUTO_ARM;
   }
   if (this->canFly) {
-    this->infoBitfield |= 0x0008;
+    this->infoBitfield |= SUPERVISOR_INFO_CAN_FLY;
   }
   if (this->isFlying) {
-    this->infoBitfield |= 0x0010;
+    this->infoBitfield |= SUPERVISOR_INFO_IS_FLYING;
   }
   if (this->isTumbled) {
-    this->infoBitfield |= 0x0020;
+    this->infoBitfield |= SUPERVISOR_INFO_IS_TUMBLED;
   }
   if (supervisorStateLocked == this->state) {
-    this->infoBitfield |= 0x0040;
+    this->infoBitfield |= SUPERVISOR_INFO_IS_LOCKED;
   }
   if (this->isCrashed) {
-    this->infoBitfield |= 0x0080;
+    this->infoBitfield |= SUPERVISOR_INFO_IS_CRASHED;
   }
 }
 
 void supervisorUpdate(const sensorData_t *sensors, const setpoint_t* setpoint, stabilizerStep_t stabilizerStep) {
-  if (!RATE_DO_EXECUTE(RATE_SUPERVISOR, stabilizerStep)) {
-    return;
-  }
-
   SupervisorMem_t* this = &supervisorMem;
   const uint32_t currentTick = xTaskGetTickCount();
 
-  const supervisorConditionBits_t conditions = updateAndPopulateConditions(this, sensors, setpoint, currentTick);
+  if (!this->isChecksInit) {
+    initChecks();
+    this->isChecksInit = true;
+  }
+
+  const supervisorConditionBits_t conditions = runChecks(this, sensors, setpoint, currentTick, stabilizerStep);
+
+  // Act directly when a condition changes, otherwise run the state machine at the supervisor rate
+  const bool isAtSupervisorRate = RATE_DO_EXECUTE(RATE_SUPERVISOR, stabilizerStep);
+  if (!isAtSupervisorRate && conditions == this->latestConditions) {
+    return;
+  }
+
+  if (isAtSupervisorRate) {
+    updateCheckStats(currentTick);
+  }
   const supervisorState_t newState = supervisorStateUpdate(this->state, conditions);
   if (this->state != newState) {
     const supervisorState_t previousState = this->state;
@@ -452,6 +556,12 @@ void infoDump(const SupervisorMem_t* this) {
 
     DEBUG_PRINT("  %s (0x%lx): %u\n", supervisorGetConditionName(condition), bit, bitValue);
   }
+
+  DEBUG_PRINT("Checks: (rate, max cycles, budget, overruns)\n");
+  for (int i = 0; i < supervisorCheck_NrOfChecks; i++) {
+    DEBUG_PRINT("  %s: %u Hz, %lu, %lu, %lu\n", checkDefs[i].name, checkDefs[i].rateHz, checkStates[i].cycles.latestMax,
+      checkDefs[i].budgetCycles, checkStates[i].overruns);
+  }
 }
 
 
@@ -514,10 +624,50 @@ LOG_GROUP_START(supervisor)
  * Bit 4 = is flying - the Crazyflie is flying.
  * Bit 5 = is tumbled - the Crazyflie is up side down.
  * Bit 6 = is locked - the Crazyflie is in the locked state and must be restarted.
+ * Bit 7 = is crashed - the Crazyflie has crashed and must be recovered before it can fly again.
  */
 LOG_ADD(LOG_UINT16, info, &supervisorMem.infoBitfield)
 LOG_GROUP_STOP(supervisor)
 
+/**
+ * CPU cycles spent in the supervisor checks. Each entry has the min, average and max number of cycles per
+ * run [cycles] and the run rate [Hz], calculated over one second.
+ */
+LOG_GROUP_START(supCyc)
+/**
+ * @brief Armed check, full rate
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(arm, &checkStates[supervisorCheckArmed].cycles)
+/**
+ * @brief Emergency stop check, full rate
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(eStop, &checkStates[supervisorCheckEmergencyStop].cycles)
+/**
+ * @brief Crashed check, full rate
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(crash, &checkStates[supervisorCheckCrashed].cycles)
+/**
+ * @brief Tumble and free fall check
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(tumb, &checkStates[supervisorCheckTumbled].cycles)
+/**
+ * @brief Is flying check
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(fly, &checkStates[supervisorCheckFlying].cycles)
+/**
+ * @brief Commander (link) watchdog check
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(wdt, &checkStates[supervisorCheckCommanderWatchdog].cycles)
+/**
+ * @brief Landing timeout check
+ */
+STATS_CNT_MIN_MAX_AVG_LOG_ADD(land, &checkStates[supervisorCheckLandingTimeout].cycles)
+/**
+ * @brief Total number of check runs that exceeded their budget
+ */
+LOG_ADD(LOG_UINT32, overruns, &checkOverruns)
+LOG_GROUP_STOP(supCyc)
+
 
 /**
  * The purpose of the supervisor is to monitor the system and its state. Depending on the situation, the supervisor
@@ -0,0 +1,370 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sysid.c - Onboard excitation and capture for system identification
+ *
+ * Injects a step, chirp or pseudo random binary sequence into the motor
+ * commands or the setpoint, and captures the motor commands, gyro,
+ * accelerometer and motor RPM of every stabilizer iteration during the
+ * maneuver. The capture is downloaded through the MEM_TYPE_SYSID memory, see
+ * docs/functional-areas/memory-subsystem/MEM_TYPE_SYSID.md
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sysid.h"
+#include "sysid_signal.h"
+#include "supervisor.h"
+#include "motors.h"
+#include "static_mem.h"
+#include "mem.h"
+#include "log.h"
+#include "param.h"
+
+#define DEBUG_MODULE "SYSID"
+#include "debug.h"
+
+#define CAPACITY CONFIG_SYSID_CAPTURE_SIZE
+
+#define SYSID_VERSION 1
+
+typedef struct {
+  stabilizerStep_t step;
+  float excitation;
+  uint16_t motorRatios[STABILIZER_NR_OF_MOTORS];
+  int16_t gyro[3];                              // milliradians / sec
+  int16_t acc[3];                               // milli G
+  uint16_t motorRpm[STABILIZER_NR_OF_MOTORS];
+} sysidSample_t;
+
+typedef struct {
+  uint8_t version;
+  uint8_t sampleSize;
+  uint8_t signal;
+  uint8_t target;
+  uint8_t state;
+  uint8_t motorMask;
+  uint16_t prbsBitMs;
+  uint16_t baseRatio;
+  uint16_t rateHz;
+  uint32_t durationMs;
+  uint32_t count;
+  float amplitude;
+  float f0;
+  float f1;
+} __attribute__((packed)) sysidMemHeader_t;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static sysidSample_t capture[CAPACITY];
+static uint32_t count;
+
+// The header that is read through the memory, latched when a read starts at address 0
+static sysidMemHeader_t readHeader;
+
+// Configuration, set through parameters. The configuration of a running maneuver is latched at the start.
+static uint8_t paramSignal = sysidSignalChirp;
+static uint8_t paramTarget = sysidTargetMotors;
+static float paramAmplitude = 5000.0f;
+static uint16_t paramDurationMs = CAPACITY;
+static float paramF0 = 1.0f;
+static float paramF1 = 50.0f;
+static uint16_t paramPrbsBitMs = 10;
+static uint16_t paramBaseRatio = 20000;
+static uint8_t paramMotorMask = 0x0f;
+static uint8_t paramStart;
+
+static sysidSignalConfig_t signalConfig;
+static sysidSignalState_t signalState;
+static sysidTarget_t target;
+static uint16_t baseRatio;
+static uint8_t motorMask;
+
+// Written by the stabilizer task only
+static uint8_t state = sysidStateIdle;
+static stabilizerStep_t startStep;
+static float excitation;
+
+static volatile bool isStartRequested;
+static bool isInit = false;
+
+#define CAPTURE_OFFSET sizeof(sysidMemHeader_t)
+#define TOTAL_SIZE (CAPTURE_OFFSET + sizeof(capture))
+
+static int16_t saturateInt16(const float value) {
+  if (value > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (value < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)value;
+}
+
+static uint16_t saturateUInt16(const float value) {
+  if (value > UINT16_MAX) {
+    return UINT16_MAX;
+  }
+  if (value < 0.0f) {
+    return 0;
+  }
+  return (uint16_t)value;
+}
+
+static void start(const stabilizerStep_t stabilizerStep) {
+  if (!supervisorAreMotorsAllowedToRun()) {
+    DEBUG_PRINT("Not started, the motors are not allowed to run\n");
+    return;
+  }
+
+  signalConfig.signal = paramSignal;
+  signalConfig.amplitude = paramAmplitude;
+  // The maneuver ends when the capture is full
+  signalConfig.durationMs = (paramDurationMs < CAPACITY) ? paramDurationMs : CAPACITY;
+  signalConfig.f0 = paramF0;
+  signalConfig.f1 = paramF1;
+  signalConfig.prbsBitMs = paramPrbsBitMs;
+  sysidSignalInit(&signalState);
+  target = paramTarget;
+  baseRatio = paramBaseRatio;
+  motorMask = paramMotorMask;
+
+  count = 0;
+  startStep = stabilizerStep;
+  state = sysidStateRunning;
+}
+
+static void addToAxis(const stab_mode_t mode, float* attitude, float* attitudeRate) {
+  if (mode == modeAbs) {
+    *attitude += excitation;
+  } else if (mode == modeVelocity) {
+    *attitudeRate += excitation;
+  }
+}
+
+void sysidUpdateSetpoint(setpoint_t* setpoint, const stabilizerStep_t stabilizerStep) {
+  if (!isInit) {
+    return;
+  }
+
+  if (isStartRequested) {
+    isStartRequested = false;
+    start(stabilizerStep);
+  }
+
+  if (state != sysidStateRunning) {
+    return;
+  }
+
+  const uint32_t timeMs = stabilizerStep - startStep;
+  if (timeMs >= signalConfig.durationMs) {
+    state = sysidStateDone;
+    excitation = 0.0f;
+    return;
+  }
+  if (!supervisorAreMotorsAllowedToRun()) {
+    state = sysidStateAborted;
+    excitation = 0.0f;
+    return;
+  }
+
+  excitation = sysidSignalValue(&signalState, &signalConfig, timeMs);
+
+  switch (target) {
+    case sysidTargetRoll:
+      addToAxis(setpoint->mode.roll, &setpoint->attitude.roll, &setpoint->attitudeRate.roll);
+      break;
+    case sysidTargetPitch:
+      addToAxis(setpoint->mode.pitch, &setpoint->attitude.pitch, &setpoint->attitudeRate.pitch);
+      break;
+    case sysidTargetYaw:
+      addToAxis(setpoint->mode.yaw, &setpoint->attitude.yaw, &setpoint->attitudeRate.yaw);
+      break;
+    case sysidTargetThrust:
+      setpoint->thrust = fmaxf(setpoint->thrust + excitation, 0.0f);
+      break;
+    default:
+      // The motors are set in sysidUpdateMotors()
+      break;
+  }
+}
+
+void sysidUpdateMotors(motors_thrust_pwm_t* motorPwm) {
+  if (state != sysidStateRunning || target != sysidTargetMotors) {
+    return;
+  }
+
+  const uint16_t ratio = saturateUInt16(baseRatio + excitation);
+  for (int i = 0; i < STABILIZER_NR_OF_MOTORS; i++) {
+    if (motorMask & (1 << i)) {
+      motorPwm->list[i] = ratio;
+    }
+  }
+}
+
+void sysidCapture(const stabilizerStep_t stabilizerStep, const sensorData_t* sensorData) {
+  if (state != sysidStateRunning || count >= CAPACITY) {
+    return;
+  }
+
+  float const deg2millirad = ((float)M_PI * 1000.0f) / 180.0f;
+  sysidSample_t* sample = &capture[count];
+  sample->step = stabilizerStep;
+  sample->excitation = excitation;
+  for (int i = 0; i < STABILIZER_NR_OF_MOTORS; i++) {
+    sample->motorRatios[i] = motorsGetRatio(i);
+    sample->motorRpm[i] = saturateUInt16(sensorData->motorRpm[i]);
+  }
+  sample->gyro[0] = saturateInt16(sensorData->gyro.x * deg2millirad);
+  sample->gyro[1] = saturateInt16(sensorData->gyro.y * deg2millirad);
+  sample->gyro[2] = saturateInt16(sensorData->gyro.z * deg2millirad);
+  sample->acc[0] = saturateInt16(sensorData->acc.x * 1000.0f);
+  sample->acc[1] = saturateInt16(sensorData->acc.y * 1000.0f);
+  sample->acc[2] = saturateInt16(sensorData->acc.z * 1000.0f);
+  count++;
+}
+
+static uint32_t handleMemGetSize(void) {
+  return TOTAL_SIZE;
+}
+
+static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
+  if (memAddr + readLen > TOTAL_SIZE) {
+    return false;
+  }
+
+  if (memAddr == 0) {
+    readHeader.version = SYSID_VERSION;
+    readHeader.sampleSize = sizeof(sysidSample_t);
+    readHeader.signal = signalConfig.signal;
+    readHeader.target = target;
+    readHeader.state = state;
+    readHeader.motorMask = motorMask;
+    readHeader.prbsBitMs = signalConfig.prbsBitMs;
+    readHeader.baseRatio = baseRatio;
+    readHeader.rateHz = RATE_MAIN_LOOP;
+    readHeader.durationMs = signalConfig.durationMs;
+    readHeader.count = count;
+    readHeader.amplitude = signalConfig.amplitude;
+    readHeader.f0 = signalConfig.f0;
+    readHeader.f1 = signalConfig.f1;
+  }
+
+  uint32_t addr = memAddr;
+  uint32_t left = readLen;
+  if (addr < CAPTURE_OFFSET) {
+    const uint32_t length = (left < CAPTURE_OFFSET - addr) ? left : CAPTURE_OFFSET - addr;
+    memcpy(buffer, ((const uint8_t*)&readHeader) + addr, length);
+    buffer += length;
+    addr += length;
+    left -= length;
+  }
+  memcpy(buffer, ((const uint8_t*)capture) + addr - CAPTURE_OFFSET, left);
+
+  return true;
+}
+
+static const MemoryHandlerDef_t memDef = {
+  .type = MEM_TYPE_SYSID,
+  .getSize = handleMemGetSize,
+  .read = handleMemRead,
+  .write = 0, // Write not supported
+};
+
+static void requestStart(void) {
+  if (paramStart) {
+    paramStart = 0;
+    isStartRequested = true;
+  }
+}
+
+void sysidInit(void) {
+  if (isInit) {
+    return;
+  }
+
+  memoryRegisterHandler(&memDef);
+
+  isInit = true;
+}
+
+/**
+ * Onboard excitation and capture for system identification. Configure the maneuver and set start, the capture is
+ * downloaded through the MEM_TYPE_SYSID memory.
+ */
+PARAM_GROUP_START(sysid)
+/**
+ * @brief The excitation signal, 0: step, 1: chirp, 2: pseudo random binary sequence (default: 1)
+ */
+PARAM_ADD(PARAM_UINT8, signal, &paramSignal)
+/**
+ * @brief Where the signal is added, 0: motors (open loop), 1: roll, 2: pitch, 3: yaw, 4: thrust setpoint (default: 0)
+ */
+PARAM_ADD(PARAM_UINT8, target, &paramTarget)
+/**
+ * @brief Amplitude of the signal, PWM ratio for the motors and thrust, deg or deg/s for roll, pitch and yaw
+ */
+PARAM_ADD(PARAM_FLOAT, amp, &paramAmplitude)
+/**
+ * @brief Duration of the maneuver [ms], limited by the size of the capture
+ */
+PARAM_ADD(PARAM_UINT16, duration, &paramDurationMs)
+/**
+ * @brief Chirp start frequency [Hz]
+ */
+PARAM_ADD(PARAM_FLOAT, f0, &paramF0)
+/**
+ * @brief Chirp end frequency [Hz]
+ */
+PARAM_ADD(PARAM_FLOAT, f1, &paramF1)
+/**
+ * @brief Time one bit of the pseudo random binary sequence is held [ms]
+ */
+PARAM_ADD(PARAM_UINT16, prbsMs, &paramPrbsBitMs)
+/**
+ * @brief PWM ratio the signal is added to, for the motor target
+ */
+PARAM_ADD(PARAM_UINT16, base, &paramBaseRatio)
+/**
+ * @brief The motors that are driven, bit 0 for motor 1, for the motor target (default: 0x0f)
+ */
+PARAM_ADD(PARAM_UINT8, motors, &paramMotorMask)
+/**
+ * @brief Set to nonzero to start the maneuver, the motors must be allowed to run (armed)
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, start, &paramStart, requestStart)
+PARAM_GROUP_STOP(sysid)
+
+LOG_GROUP_START(sysid)
+/**
+ * @brief See sysidState_t, 0: idle, 1: running, 2: done, 3: aborted
+ */
+LOG_ADD(LOG_UINT8, state, &state)
+/**
+ * @brief Number of captured samples
+ */
+LOG_ADD(LOG_UINT32, count, &count)
+/**
+ * @brief The current value of the excitation signal
+ */
+LOG_ADD(LOG_FLOAT, exc, &excitation)
+LOG_GROUP_STOP(sysid)
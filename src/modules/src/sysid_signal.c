@@ -0,0 +1,74 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sysid_signal.c - Excitation signals for system identification
+ */
+
+#include <math.h>
+
+#include "sysid_signal.h"
+
+// Seed of the maximal length 16 bit linear feedback shift register, x^16 + x^14 + x^13 + x^11 + 1
+#define LFSR_SEED 0xACE1
+
+static uint16_t lfsrNext(const uint16_t lfsr) {
+  const uint16_t bit = ((lfsr >> 0) ^ (lfsr >> 2) ^ (lfsr >> 3) ^ (lfsr >> 5)) & 1;
+  return (lfsr >> 1) | (bit << 15);
+}
+
+void sysidSignalInit(sysidSignalState_t* this) {
+  this->lfsr = LFSR_SEED;
+  this->prbsBit = 0;
+}
+
+static float chirp(const sysidSignalConfig_t* config, const uint32_t timeMs) {
+  const float t = timeMs / 1000.0f;
+  const float duration = config->durationMs / 1000.0f;
+  const float sweepRate = (duration > 0.0f) ? (config->f1 - config->f0) / duration : 0.0f;
+  const float phase = 2.0f * (float)M_PI * (config->f0 * t + 0.5f * sweepRate * t * t);
+  return config->amplitude * sinf(phase);
+}
+
+static float prbs(sysidSignalState_t* this, const sysidSignalConfig_t* config, const uint32_t timeMs) {
+  const uint16_t bitMs = (config->prbsBitMs > 0) ? config->prbsBitMs : 1;
+  const uint32_t bit = timeMs / bitMs;
+  while (this->prbsBit < bit) {
+    this->lfsr = lfsrNext(this->lfsr);
+    this->prbsBit++;
+  }
+
+  return (this->lfsr & 1) ? config->amplitude : -config->amplitude;
+}
+
+float sysidSignalValue(sysidSignalState_t* this, const sysidSignalConfig_t* config, const uint32_t timeMs) {
+  switch (config->signal) {
+    case sysidSignalStep:
+      return (timeMs >= config->durationMs / 4) ? config->amplitude : 0.0f;
+    case sysidSignalChirp:
+      return chirp(config, timeMs);
+    case sysidSignalPrbs:
+      return prbs(this, config, timeMs);
+    default:
+      return 0.0f;
+  }
+}
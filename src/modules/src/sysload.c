@@ -27,11 +27,15 @@
 #define DEBUG_MODULE "SYSLOAD"
 
 #include <stdbool.h>
+#include <string.h>
 #include "FreeRTOS.h"
 #include "timers.h"
+#include "task.h"
+#include "config.h"
 #include "debug.h"
 #include "cfassert.h"
 #include "param.h"
+#include "log.h"
 #include "static_mem.h"
 
 #include "sysload.h"
@@ -42,6 +46,7 @@ static void timerHandler(xTimerHandle timer);
 
 static bool initialized = false;
 static uint8_t triggerDump = 0;
+static uint8_t triggerMemDump = 0;
 
 typedef struct {
   uint32_t ulRunTimeCounter;
@@ -55,9 +60,107 @@ static uint32_t previousTotalRunTime = 0;
 
 static StaticTimer_t timerBuffer;
 
+// Tasks that have their stack high-water mark exposed in the stack log group.
+// The order must match the log variables at the end of this file.
+static const char* const trackedTaskNames[] = {
+  SYSTEM_TASK_NAME,
+  STABILIZER_TASK_NAME,
+  SENSORS_TASK_NAME,
+  KALMAN_TASK_NAME,
+  CMD_HIGH_LEVEL_TASK_NAME,
+  CRTP_RX_TASK_NAME,
+  CRTP_TX_TASK_NAME,
+  SYSLINK_TASK_NAME,
+  USBLINK_TASK_NAME,
+  LOG_TASK_NAME,
+  PARAM_TASK_NAME,
+  MEM_TASK_NAME,
+  PM_TASK_NAME,
+  APP_TASK_NAME,
+};
+#define TRACKED_TASK_COUNT (sizeof(trackedTaskNames) / sizeof(trackedTaskNames[0]))
+#define STACK_LEFT_UNKNOWN 0xffff
+
+// Unused stack space at peak usage, in bytes
+static uint16_t trackedStackLeft[TRACKED_TASK_COUNT];
+static uint16_t minStackLeft;
+
+static uint32_t heapFree;
+static uint32_t heapMinFree;
+static uint32_t ccmArenaFree;
+
+// Totals of the allocations made through the STATIC_MEM_xxx_ALLOC() macros
+static uint32_t staticRamTotal;
+static uint32_t staticCcmTotal;
+
+extern const staticMemRecord_t _staticMem_start;
+extern const staticMemRecord_t _staticMem_stop;
+
+NO_DMA_CCM_SAFE_ZERO_INIT static TaskStatus_t taskStats[TASK_MAX_COUNT];
+
+static void calculateStaticMemTotals() {
+  staticRamTotal = 0;
+  staticCcmTotal = 0;
+  for (const staticMemRecord_t* record = &_staticMem_start; record < &_staticMem_stop; record++) {
+    staticRamTotal += record->ramSize;
+    staticCcmTotal += record->ccmSize;
+  }
+}
+
+static void updateMemoryStats(const TaskStatus_t* stats, const uint32_t taskCount) {
+  heapFree = xPortGetFreeHeapSize();
+  heapMinFree = xPortGetMinimumEverFreeHeapSize();
+  ccmArenaFree = ccmArenaGetFree();
+
+  minStackLeft = STACK_LEFT_UNKNOWN;
+  for (uint32_t t = 0; t < TRACKED_TASK_COUNT; t++) {
+    trackedStackLeft[t] = STACK_LEFT_UNKNOWN;
+  }
+
+  for (uint32_t i = 0; i < taskCount; i++) {
+    // The high-water mark is reported in words
+    const uint32_t left = stats[i].usStackHighWaterMark * sizeof(StackType_t);
+    const uint16_t leftBytes = left < STACK_LEFT_UNKNOWN ? left : STACK_LEFT_UNKNOWN - 1;
+
+    if (leftBytes < minStackLeft) {
+      minStackLeft = leftBytes;
+    }
+
+    for (uint32_t t = 0; t < TRACKED_TASK_COUNT; t++) {
+      if (strcmp(stats[i].pcTaskName, trackedTaskNames[t]) == 0) {
+        trackedStackLeft[t] = leftBytes;
+        break;
+      }
+    }
+  }
+}
+
+static void memDump() {
+  DEBUG_PRINT("Memory dump\n");
+  DEBUG_PRINT("Heap free: %u, min ever free: %u\n", (unsigned int)heapFree, (unsigned int)heapMinFree);
+  DEBUG_PRINT("Static RAM: %u, CCM: %u\n", (unsigned int)staticRamTotal, (unsigned int)staticCcmTotal);
+  DEBUG_PRINT("CCM arena free: %u\n", (unsigned int)ccmArenaFree);
+  DEBUG_PRINT("RAM\tCCM\tModule\n");
+
+  // Records from the same source file are placed next to each other by the linker
+  const staticMemRecord_t* record = &_staticMem_start;
+  while (record < &_staticMem_stop) {
+    const char* file = record->file;
+    uint32_t ram = 0;
+    uint32_t ccm = 0;
+    for (; record < &_staticMem_stop && strcmp(record->file, file) == 0; record++) {
+      ram += record->ramSize;
+      ccm += record->ccmSize;
+    }
+    DEBUG_PRINT("%u\t%u\t%s\n", (unsigned int)ram, (unsigned int)ccm, file);
+  }
+}
+
 void sysLoadInit() {
   ASSERT(!initialized);
 
+  calculateStaticMemTotals();
+
   xTimerHandle timer = xTimerCreateStatic( "sysLoadMonitorTimer", TIMER_PERIOD, pdTRUE, NULL, timerHandler, &timerBuffer);
   xTimerStart(timer, 100);
 
@@ -84,13 +187,18 @@ static taskData_t* getPreviousTaskData(uint32_t xTaskNumber) {
 }
 
 static void timerHandler(xTimerHandle timer) {
-  if (triggerDump != 0) {
-    uint32_t totalRunTime;
+  uint32_t totalRunTime;
+  uint32_t taskCount = uxTaskGetSystemState(taskStats, TASK_MAX_COUNT, &totalRunTime);
+  ASSERT(taskCount < TASK_MAX_COUNT);
+
+  updateMemoryStats(taskStats, taskCount);
 
-    TaskStatus_t taskStats[TASK_MAX_COUNT];
-    uint32_t taskCount = uxTaskGetSystemState(taskStats, TASK_MAX_COUNT, &totalRunTime);
-    ASSERT(taskCount < TASK_MAX_COUNT);
+  if (triggerMemDump != 0) {
+    memDump();
+    triggerMemDump = 0;
+  }
 
+  if (triggerDump != 0) {
     uint32_t totalDelta = totalRunTime - previousTotalRunTime;
     float f = 100.0 / totalDelta;
 
@@ -125,4 +233,124 @@ PARAM_GROUP_START(system)
  */
 PARAM_ADD_CORE(PARAM_UINT8, taskDump, &triggerDump)
 
+/**
+ * @brief Set to nonzero to dump heap usage and the static memory allocated per module to console
+ */
+PARAM_ADD_CORE(PARAM_UINT8, memDump, &triggerMemDump)
+
 PARAM_GROUP_STOP(system)
+
+/**
+ * Memory usage of the system. Updated once per second.
+ */
+LOG_GROUP_START(memory)
+
+/**
+ * @brief Free heap [bytes]
+ */
+LOG_ADD(LOG_UINT32, heapFree, &heapFree)
+
+/**
+ * @brief Lowest amount of free heap since boot [bytes]
+ */
+LOG_ADD(LOG_UINT32, heapMinFree, &heapMinFree)
+
+/**
+ * @brief RAM used by static OS objects (STATIC_MEM_xxx_ALLOC) [bytes]
+ */
+LOG_ADD(LOG_UINT32, staticRam, &staticRamTotal)
+
+/**
+ * @brief CCM used by static OS objects (STATIC_MEM_xxx_ALLOC) [bytes]
+ */
+LOG_ADD(LOG_UINT32, staticCcm, &staticCcmTotal)
+
+/**
+ * @brief CCM left for runtime allocations with ccmArenaAlloc() [bytes]
+ */
+LOG_ADD(LOG_UINT32, ccmArenaFree, &ccmArenaFree)
+
+/**
+ * @brief Smallest unused stack space at peak usage of any task [bytes]
+ */
+LOG_ADD(LOG_UINT16, minStackLeft, &minStackLeft)
+
+LOG_GROUP_STOP(memory)
+
+/**
+ * Unused stack space at peak usage (stack high-water mark) per task, in bytes.
+ * Tasks that are not running report 65535. Updated once per second.
+ */
+LOG_GROUP_START(stackLeft)
+
+/**
+ * @brief System task
+ */
+LOG_ADD(LOG_UINT16, system, &trackedStackLeft[0])
+
+/**
+ * @brief Stabilizer task
+ */
+LOG_ADD(LOG_UINT16, stabilizer, &trackedStackLeft[1])
+
+/**
+ * @brief Sensors task
+ */
+LOG_ADD(LOG_UINT16, sensors, &trackedStackLeft[2])
+
+/**
+ * @brief Kalman estimator task
+ */
+LOG_ADD(LOG_UINT16, kalman, &trackedStackLeft[3])
+
+/**
+ * @brief High level commander task
+ */
+LOG_ADD(LOG_UINT16, cmdHl, &trackedStackLeft[4])
+
+/**
+ * @brief CRTP rx task
+ */
+LOG_ADD(LOG_UINT16, crtpRx, &trackedStackLeft[5])
+
+/**
+ * @brief CRTP tx task
+ */
+LOG_ADD(LOG_UINT16, crtpTx, &trackedStackLeft[6])
+
+/**
+ * @brief Syslink task
+ */
+LOG_ADD(LOG_UINT16, syslink, &trackedStackLeft[7])
+
+/**
+ * @brief USB link task
+ */
+LOG_ADD(LOG_UINT16, usblink, &trackedStackLeft[8])
+
+/**
+ * @brief Log task
+ */
+LOG_ADD(LOG_UINT16, log, &trackedStackLeft[9])
+
+/**
+ * @brief Parameter task
+ */
+LOG_ADD(LOG_UINT16, param, &trackedStackLeft[10])
+
+/**
+ * @brief Memory task
+ */
+LOG_ADD(LOG_UINT16, mem, &trackedStackLeft[11])
+
+/**
+ * @brief Power management task
+ */
+LOG_ADD(LOG_UINT16, pm, &trackedStackLeft[12])
+
+/**
+ * @brief App task
+ */
+LOG_ADD(LOG_UINT16, app, &trackedStackLeft[13])
+
+LOG_GROUP_STOP(stackLeft)
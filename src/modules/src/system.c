@@ -62,6 +62,8 @@
 #include "buzzer.h"
 #include "sound.h"
 #include "sysload.h"
+#include "cpu_accounting.h"
+#include "event_trace.h"
 #include "estimator_kalman.h"
 #include "estimator_ukf.h"
 #include "deck.h"
@@ -71,8 +73,12 @@
 #include "peer_localization.h"
 #include "cfassert.h"
 #include "i2cdev.h"
+#include "cycle_counter.h"
 #include "autoconf.h"
 #include "vcp_esc_passthrough.h"
+#include "boot_timeline.h"
+#include "eventtrigger.h"
+#include "queuestats.h"
 #if CONFIG_ENABLE_CPX
   #include "cpxlink.h"
 #endif
@@ -111,15 +117,24 @@ void systemInit(void)
   xSemaphoreTake(canStartMutex, portMAX_DELAY);
 
   usblinkInit();
+  bootTimelineMark("usblinkInit");
   sysLoadInit();
+#ifdef CONFIG_DEBUG_CPU_ACCOUNTING
+  cpuAccountingInit();
+#endif
+#ifdef CONFIG_DEBUG_EVENT_TRACE
+  eventTraceInit();
+#endif
 #if CONFIG_ENABLE_CPX
   cpxlinkInit();
+  bootTimelineMark("cpxlinkInit");
 #endif
 
   /* Initialized here so that DEBUG_PRINT (buffered) can be used early */
   debugInit();
   crtpInit();
   consoleInit();
+  bootTimelineMark("consoleInit");
 
   DEBUG_PRINT("----------------------------\n");
   DEBUG_PRINT("%s is up and running!\n", platformConfigGetDeviceTypeName());
@@ -135,21 +150,42 @@ void systemInit(void)
               *((int*)(MCU_ID_ADDRESS+0)), *((short*)(MCU_FLASH_SIZE_ADDRESS)));
 
   configblockInit();
+  bootTimelineMark("configblockInit");
   storageInit();
+  bootTimelineMark("storageInit");
   workerInit();
+  queueStatsInit();
+  eventtriggerInit();
   adcInit();
   ledseqInit();
   pmInit();
   buzzerInit();
   peerLocalizationInit();
+  bootTimelineInit();
 
 #ifdef CONFIG_APP_ENABLE
   appInit();
+  bootTimelineMark("appInit");
 #endif
 
   isInit = true;
 }
 
+static bool systemRunTest(bool (*test)(void), const char* timelineName, const char* name)
+{
+  bool pass = test();
+  bootTimelineMark(timelineName);
+
+  if (pass == false) {
+    DEBUG_PRINT("%s [FAIL]\n", name);
+  }
+
+  return pass;
+}
+
+// Run a test function, record it in the boot time line and print a message if it fails
+#define SYSTEM_RUN_TEST(test, name) systemRunTest(test, #test, name)
+
 bool systemTest()
 {
   bool pass=isInit;
@@ -179,23 +215,31 @@ void systemTask(void *arg)
 #endif
 
   usecTimerInit();
+  bootTimelineMark("usecTimerInit");
+  cycleCounterInit();
   i2cdevInit(I2C3_DEV);
   i2cdevInit(I2C1_DEV);
   passthroughInit();
+  bootTimelineMark("i2cdevInit");
 
   //Init the high-levels modules
   systemInit();
+  bootTimelineMark("systemInit");
   commInit();
+  bootTimelineMark("commInit");
   commanderInit();
+  bootTimelineMark("commanderInit");
 
   StateEstimatorType estimator = StateEstimatorTypeAutoSelect;
 
   #ifdef CONFIG_ESTIMATOR_KALMAN_ENABLE
   estimatorKalmanTaskInit();
+  bootTimelineMark("estimatorKalmanTaskInit");
   #endif
 
   #ifdef CONFIG_ESTIMATOR_UKF_ENABLE
   errorEstimatorUkfTaskInit();
+  bootTimelineMark("errorEstimatorUkfTaskInit");
   #endif
 
   // Enabling incoming syslink messages to be added to the queue.
@@ -203,91 +247,51 @@ void systemTask(void *arg)
   uartslkEnableIncoming();
 
   memInit();
+  bootTimelineMark("memInit");
   deckInit();
+  bootTimelineMark("deckInit");
   estimator = deckGetRequiredEstimator();
   stabilizerInit(estimator);
+  bootTimelineMark("stabilizerInit");
   if (deckGetRequiredLowInterferenceRadioMode() && platformConfigPhysicalLayoutAntennasAreClose())
   {
     platformSetLowInterferenceRadioMode();
   }
   soundInit();
   crtpMemInit();
+  bootTimelineMark("crtpMemInit");
 
 #ifdef PROXIMITY_ENABLED
   proximityInit();
+  bootTimelineMark("proximityInit");
 #endif
 
   systemRequestNRFVersion();
 
   //Test the modules
   DEBUG_PRINT("About to run tests in system.c.\n");
-  if (systemTest() == false) {
-    pass = false;
-    DEBUG_PRINT("system [FAIL]\n");
-  }
-  if (configblockTest() == false) {
-    pass = false;
-    DEBUG_PRINT("configblock [FAIL]\n");
-  }
-  if (storageTest() == false) {
-    pass = false;
-    DEBUG_PRINT("storage [FAIL]\n");
-  }
-  if (commTest() == false) {
-    pass = false;
-    DEBUG_PRINT("comm [FAIL]\n");
-  }
-  if (commanderTest() == false) {
-    pass = false;
-    DEBUG_PRINT("commander [FAIL]\n");
-  }
-  if (stabilizerTest() == false) {
-    pass = false;
-    DEBUG_PRINT("stabilizer [FAIL]\n");
-  }
+  pass &= SYSTEM_RUN_TEST(systemTest, "system");
+  pass &= SYSTEM_RUN_TEST(configblockTest, "configblock");
+  pass &= SYSTEM_RUN_TEST(storageTest, "storage");
+  pass &= SYSTEM_RUN_TEST(commTest, "comm");
+  pass &= SYSTEM_RUN_TEST(commanderTest, "commander");
+  pass &= SYSTEM_RUN_TEST(stabilizerTest, "stabilizer");
 
   #ifdef CONFIG_ESTIMATOR_KALMAN_ENABLE
-  if (estimatorKalmanTaskTest() == false) {
-    pass = false;
-    DEBUG_PRINT("estimatorKalmanTask [FAIL]\n");
-  }
+  pass &= SYSTEM_RUN_TEST(estimatorKalmanTaskTest, "estimatorKalmanTask");
   #endif
 
   #ifdef CONFIG_ESTIMATOR_UKF_ENABLE
-  if (errorEstimatorUkfTaskTest() == false) {
-    pass = false;
-    DEBUG_PRINT("estimatorUKFTask [FAIL]\n");
-  }
+  pass &= SYSTEM_RUN_TEST(errorEstimatorUkfTaskTest, "estimatorUKFTask");
   #endif
 
-  if (deckTest() == false) {
-    pass = false;
-    DEBUG_PRINT("deck [FAIL]\n");
-  }
-  if (soundTest() == false) {
-    pass = false;
-    DEBUG_PRINT("sound [FAIL]\n");
-  }
-  if (memTest() == false) {
-    pass = false;
-    DEBUG_PRINT("mem [FAIL]\n");
-  }
-  if (crtpMemTest() == false) {
-    pass = false;
-    DEBUG_PRINT("CRTP mem [FAIL]\n");
-  }
-  if (watchdogNormalStartTest() == false) {
-    pass = false;
-    DEBUG_PRINT("watchdogNormalStart [FAIL]\n");
-  }
-  if (cfAssertNormalStartTest() == false) {
-    pass = false;
-    DEBUG_PRINT("cfAssertNormalStart [FAIL]\n");
-  }
-  if (peerLocalizationTest() == false) {
-    pass = false;
-    DEBUG_PRINT("peerLocalization [FAIL]\n");
-  }
+  pass &= SYSTEM_RUN_TEST(deckTest, "deck");
+  pass &= SYSTEM_RUN_TEST(soundTest, "sound");
+  pass &= SYSTEM_RUN_TEST(memTest, "mem");
+  pass &= SYSTEM_RUN_TEST(crtpMemTest, "CRTP mem");
+  pass &= SYSTEM_RUN_TEST(watchdogNormalStartTest, "watchdogNormalStart");
+  pass &= SYSTEM_RUN_TEST(cfAssertNormalStartTest, "cfAssertNormalStart");
+  pass &= SYSTEM_RUN_TEST(peerLocalizationTest, "peerLocalization");
 
   //Start the firmware
   if(pass)
@@ -295,6 +299,7 @@ void systemTask(void *arg)
     DEBUG_PRINT("Self test passed!\n");
     selftestPassed = 1;
     systemStart();
+    bootTimelineMark("systemStart");
     soundSetEffect(SND_STARTUP);
     ledseqRun(&seq_alive);
     ledseqRun(&seq_testPassed);
@@ -313,6 +318,7 @@ void systemTask(void *arg)
         {
 	        DEBUG_PRINT("Start forced.\n");
           systemStart();
+          bootTimelineMark("systemStart");
           break;
         }
       }
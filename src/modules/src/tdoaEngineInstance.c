@@ -32,6 +32,10 @@
 
 NO_DMA_CCM_SAFE_ZERO_INIT tdoaEngineState_t tdoaEngineState;
 
+static uint16_t anchorInfoSize = sizeof(tdoaAnchorInfo_t);
+static uint16_t remoteEntrySize = sizeof(tdoaRemoteEntry_t);
+static uint32_t storageSize = sizeof(tdoaAnchorStorage_t);
+
 /**
  * Log group for the TDoA engine module.
  *
@@ -95,6 +99,33 @@ LOG_ADD(LOG_UINT16, tof, &tdoaEngineState.stats.tof)
  * A is selected using the tdoaEngine.logId parameter and B is selected by tdoaEngine.logOthrId.
  */
 LOG_ADD(LOG_FLOAT, tdoa, &tdoaEngineState.stats.tdoa)
+
+/**
+ * @brief Memory used per anchor in the TDoA storage, not including remote data [bytes]
+ */
+LOG_ADD(LOG_UINT16, anchMem, &anchorInfoSize)
+
+/**
+ * @brief Memory used per remote data entry (rx time or tof of an anchor pair) [bytes]
+ */
+LOG_ADD(LOG_UINT16, remMem, &remoteEntrySize)
+
+/**
+ * @brief Total memory used by the TDoA storage [bytes]
+ */
+LOG_ADD(LOG_UINT32, storeMem, &storageSize)
+
+/**
+ * @brief Number of anchors in the TDoA storage
+ */
+LOG_ADD(LOG_UINT8, anchCnt, &tdoaEngineState.anchorStorage.slotsInUse)
+
+/**
+ * @brief Number of remote data entries in use in the TDoA storage.
+ *
+ * If this is close to the pool size (CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_POOL_SIZE), remote data is evicted before it is outdated.
+ */
+LOG_ADD(LOG_UINT16, remCnt, &tdoaEngineState.anchorStorage.remoteEntriesInUse)
 LOG_GROUP_STOP(tdoaEngine)
 
 /**
@@ -113,5 +144,14 @@ PARAM_ADD_CORE(PARAM_UINT8, logOthrId, &tdoaEngineState.stats.newRemoteAnchorId)
 // This variable should not be exposed as a parameter since it is changed from inside the CF FW.
 // It only happens when the LPS system mode is changed to TDoA2 or TDoA3 though, and as this is
 // not a frequent action, we chose to expose it anyway.
+// 1 = random, 2 = youngest, 3 = all (one measurement per usable remote anchor in each packet)
 PARAM_ADD(PARAM_UINT8, matchAlgo, &tdoaEngineState.matchingAlgorithm)
+
+/**
+ * @brief Clock correction algorithm, 0 = leaky bucket (default), 1 = least squares fit
+ *
+ * The least squares fit uses all packets from an anchor, not only the latest pair, and produces usable
+ * measurements sooner after an anchor is first heard, in particular with noisy time stamps.
+ */
+PARAM_ADD(PARAM_UINT8, ccAlgo, &tdoaEngineState.clockCorrectionAlgorithm)
 PARAM_GROUP_STOP(tdoaEngine)
@@ -0,0 +1,85 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * toc_index_benchmark.c - Compare log and param lookups by name with and without the name index
+ */
+
+#include <stdint.h>
+
+#include "cycle_counter.h"
+#include "param.h"
+#include "log.h"
+#include "debug.h"
+
+static uint8_t run;
+static float logIndexCycles;
+static float logScanCycles;
+static float paramIndexCycles;
+static float paramScanCycles;
+
+static void runBenchmark(void) {
+  if (!run) {
+    return;
+  }
+  run = 0;
+
+  cycleCounterInit();
+  logNameIndexBenchmark(cycleCounterGet, &logIndexCycles, &logScanCycles);
+  paramNameIndexBenchmark(cycleCounterGet, &paramIndexCycles, &paramScanCycles);
+
+  DEBUG_PRINT("logGetVarId: index %.0f, scan %.0f cycles\n", (double)logIndexCycles, (double)logScanCycles);
+  DEBUG_PRINT("paramGetVarId: index %.0f, scan %.0f cycles\n", (double)paramIndexCycles, (double)paramScanCycles);
+}
+
+/**
+ * Micro-benchmark of logGetVarId() and paramGetVarId(), looking up every variable of the TOCs once with the name
+ * index and once with a linear search.
+ */
+PARAM_GROUP_START(tocBench)
+/**
+ * @brief Set to nonzero to run the benchmark, results are printed to the console and logged
+ */
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, run, &run, runBenchmark)
+PARAM_GROUP_STOP(tocBench)
+
+/**
+ * Results of the last benchmark run, in average CPU cycles per lookup
+ */
+LOG_GROUP_START(tocBench)
+/**
+ * @brief logGetVarId() using the name index
+ */
+LOG_ADD(LOG_FLOAT, logIdx, &logIndexCycles)
+/**
+ * @brief logGetVarId() using a linear search
+ */
+LOG_ADD(LOG_FLOAT, logScan, &logScanCycles)
+/**
+ * @brief paramGetVarId() using the name index
+ */
+LOG_ADD(LOG_FLOAT, prmIdx, &paramIndexCycles)
+/**
+ * @brief paramGetVarId() using a linear search
+ */
+LOG_ADD(LOG_FLOAT, prmScan, &paramScanCycles)
+LOG_GROUP_STOP(tocBench)
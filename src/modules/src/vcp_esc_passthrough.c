@@ -27,8 +27,7 @@
 /*FreeRtos includes*/
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "queuemonitor.h"
+#include "stream_buffer.h"
 
 #include "system.h"
 #include "config.h"
@@ -38,21 +37,28 @@
 #include "usb.h"
 #include "motors.h"
 #include "serial_4way.h"
+#include "vcp_esc_passthrough.h"
 #include "msp.h"
 #include "uart_syslink.h"
 #include "sensors.h"
 #include "param.h"
+#include "log.h"
+#include "statsCnt.h"
 
 static TaskHandle_t passthroughTaskHandle;
 STATIC_MEM_TASK_ALLOC(passthroughTask, PASSTHROUGH_TASK_STACKSIZE);
 
 static bool isInit;
 
-// Passthorugh queues to handle VCP data.
-static xQueueHandle  ptRxQueue;
-STATIC_MEM_QUEUE_ALLOC(ptRxQueue, 512, sizeof(uint8_t));
-static xQueueHandle  ptTxQueue;
-STATIC_MEM_QUEUE_ALLOC(ptTxQueue, 512, sizeof(uint8_t));
+// Passthrough stream buffers to handle VCP data. Whole USB packets are copied in and out of them, instead of one
+// queue operation per byte.
+#define PASSTHROUGH_RX_STREAM_SIZE 512
+#define PASSTHROUGH_TX_STREAM_SIZE 512
+static StreamBufferHandle_t ptRxStream;
+static StreamBufferHandle_t ptTxStream;
+
+static STATS_CNT_RATE_DEFINE(vcpRxRate, 1000);
+static STATS_CNT_RATE_DEFINE(vcpTxRate, 1000);
 
 // Helper
 /*
@@ -69,10 +75,10 @@ void passthroughInit()
   if(isInit)
     return;
 
-  ptRxQueue = STATIC_MEM_QUEUE_CREATE(ptRxQueue);
-  DEBUG_QUEUE_MONITOR_REGISTER(ptRxQueue);
-  ptTxQueue = STATIC_MEM_QUEUE_CREATE(ptTxQueue);
-  DEBUG_QUEUE_MONITOR_REGISTER(ptRxQueue);
+  ptRxStream = xStreamBufferCreate(PASSTHROUGH_RX_STREAM_SIZE, 1);
+  ASSERT(ptRxStream);
+  ptTxStream = xStreamBufferCreate(PASSTHROUGH_TX_STREAM_SIZE, 1);
+  ASSERT(ptTxStream);
 
   passthroughTaskHandle = STATIC_MEM_TASK_CREATE(passthroughTask, passthroughTask, PASSTHROUGH_TASK_NAME, NULL, PASSTHROUGH_TASK_PRI);
 }
@@ -85,42 +91,76 @@ void passthroughEnableFromISR()
 
 void passthroughVcpRxSendFromISR(uint8_t Ch)
 {
-  BaseType_t xHigherPriorityTaskWoken;
+  passthroughVcpRxSendBufferFromISR(&Ch, 1);
+}
 
-  ASSERT(xQueueSendFromISR(ptRxQueue, &Ch, &xHigherPriorityTaskWoken) == pdTRUE);
+void passthroughVcpRxSendBufferFromISR(const uint8_t* data, uint32_t length)
+{
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  ASSERT(xStreamBufferSendFromISR(ptRxStream, data, length, &xHigherPriorityTaskWoken) == length);
+  STATS_CNT_RATE_MULTI_EVENT(&vcpRxRate, length);
+
+  // Wake the passthrough task directly, it is waiting for the rest of a request
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 void passthroughVcpRxSendBlock(uint8_t Ch)
 {
-  ASSERT(xQueueSend(ptRxQueue, &Ch, portMAX_DELAY) == pdTRUE);
+  ASSERT(xStreamBufferSend(ptRxStream, &Ch, 1, portMAX_DELAY) == 1);
 }
 
 int passthroughVcpRxReceive(uint8_t* receiveChPtr)
 {
   ASSERT(receiveChPtr);
-  return xQueueReceive(ptRxQueue, receiveChPtr, 0);
+  return xStreamBufferReceive(ptRxStream, receiveChPtr, 1, 0);
 }
 
 int passthroughVcpRxReceiveBlock(uint8_t* receiveChPtr)
 {
   ASSERT(receiveChPtr);
-  return xQueueReceive(ptRxQueue, receiveChPtr, portMAX_DELAY);
+  return xStreamBufferReceive(ptRxStream, receiveChPtr, 1, portMAX_DELAY);
+}
+
+void passthroughVcpRxReceiveBufferBlock(uint8_t* data, uint32_t length)
+{
+  ASSERT(data);
+  uint32_t received = 0;
+  while (received < length)
+  {
+    xStreamBufferSetTriggerLevel(ptRxStream, length - received);
+    received += xStreamBufferReceive(ptRxStream, &data[received], length - received, portMAX_DELAY);
+  }
 }
 
 void passthroughVcpTxSend(uint8_t Ch)
 {
-  ASSERT(xQueueSend(ptTxQueue, &Ch, 0) == pdTRUE);
+  ASSERT(xStreamBufferSend(ptTxStream, &Ch, 1, 0) == 1);
+  STATS_CNT_RATE_EVENT(&vcpTxRate);
 }
 
 void passthroughVcpTxSendBlock(uint8_t Ch)
 {
-  ASSERT(xQueueSend(ptTxQueue, &Ch, portMAX_DELAY) == pdTRUE);
+  passthroughVcpTxSendBufferBlock(&Ch, 1);
+}
+
+void passthroughVcpTxSendBufferBlock(const uint8_t* data, uint32_t length)
+{
+  ASSERT(xStreamBufferSend(ptTxStream, data, length, portMAX_DELAY) == length);
+  STATS_CNT_RATE_MULTI_EVENT(&vcpTxRate, length);
 }
 
 int passthroughVcpTxReceiveFromISR(uint8_t* receiveChPtr)
 {
-  BaseType_t xHigherPriorityTaskWoken;
-  return xQueueReceiveFromISR(ptTxQueue, receiveChPtr, &xHigherPriorityTaskWoken);
+  return passthroughVcpTxReceiveBufferFromISR(receiveChPtr, 1);
+}
+
+uint32_t passthroughVcpTxReceiveBufferFromISR(uint8_t* data, uint32_t maxLength)
+{
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  const uint32_t length = xStreamBufferReceiveFromISR(ptTxStream, data, maxLength, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+  return length;
 }
 
 void passthroughTask(void *param)
@@ -170,11 +210,7 @@ static uint8_t readByteBlocking()
 static void mspCallback(uint8_t* pBuffer, uint32_t bufferLen)
 {
   // Sent all data through serial
-  for (int i = 0; i < bufferLen; i++)
-  {
-    uint8_t byte = pBuffer[i];
-    passthroughVcpTxSendBlock(byte);
-  }
+  passthroughVcpTxSendBufferBlock(pBuffer, bufferLen);
 }
 
 static void blHeliConfigHandshake()
@@ -196,3 +232,17 @@ static void blHeliConfigHandshake()
 
   mspResetSet4WayIf();
 }
+
+/**
+ * Throughput of the VCP passthrough, used for flashing ESCs
+ */
+LOG_GROUP_START(vcpPt)
+/**
+ * @brief Bytes per second received from the host
+ */
+STATS_CNT_RATE_LOG_ADD(rxRate, &vcpRxRate)
+/**
+ * @brief Bytes per second sent to the host
+ */
+STATS_CNT_RATE_LOG_ADD(txRate, &vcpTxRate)
+LOG_GROUP_STOP(vcpPt)
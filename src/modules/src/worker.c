@@ -29,63 +29,289 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "queuemonitor.h"
-#include "static_mem.h"
+#include "semphr.h"
 
+#define DEBUG_MODULE "WORKER"
 #include "console.h"
+#include "debug.h"
+#include "log.h"
+#include "queuestats.h"
+#include "usec_time.h"
 
-#define WORKER_QUEUE_LENGTH 5
+// Number of jobs that can be scheduled at the same time, including periodic jobs
+#define WORKER_QUEUE_LENGTH 12
+
+typedef enum {
+  workFree = 0,
+  workPending,
+  workRunning,
+} workState_t;
 
 struct worker_work {
   void (*function)(void*);
   void* arg;
+  workState_t state;
+  workerPriority_t priority;
+  // set when a periodic job is cancelled while it is running
+  bool cancelled;
+  // order of scheduling, jobs of the same priority are executed in this order
+  uint32_t sequence;
+  TickType_t dueTick;
+  TickType_t period;
+};
+
+// The jobs are protected by a critical section, the worker loop is woken up by the semaphore when a job is scheduled
+static struct worker_work jobs[WORKER_QUEUE_LENGTH];
+static uint32_t nextSequence;
+// Number of jobs in the workPending state, for the queue statistics
+static uint8_t pendingJobs;
+static xSemaphoreHandle workerWakeup;
+static StaticSemaphore_t workerWakeupBuffer;
+static bool isInit = false;
+
+static const workerOptions_t defaultOptions = {
+  .priority = WORKER_PRIORITY_NORMAL,
 };
 
-static xQueueHandle workerQueue;
-STATIC_MEM_QUEUE_ALLOC(workerQueue, WORKER_QUEUE_LENGTH, sizeof(struct worker_work));
+// Statistics
+static uint32_t runCount;
+static uint32_t dropCount;
+static uint32_t coalesceCount;
+static uint8_t maxPendingCount;
+static uint32_t maxRuntimeUs;
+static uint32_t slowestFunction;
+static uint32_t lastRuntimeUs;
 
 void workerInit()
 {
-  if (workerQueue)
+  if (isInit)
     return;
 
-  workerQueue = STATIC_MEM_QUEUE_CREATE(workerQueue);
-  DEBUG_QUEUE_MONITOR_REGISTER(workerQueue);
+  workerWakeup = xSemaphoreCreateBinaryStatic(&workerWakeupBuffer);
+  isInit = true;
 }
 
 bool workerTest()
 {
-  return (workerQueue != NULL);
+  return isInit;
 }
 
-void workerLoop()
+static bool isDue(const struct worker_work* work, const TickType_t now)
+{
+  return (int32_t)(work->dueTick - now) <= 0;
+}
+
+// Finds the next job to execute and marks it as running. If no job is due, NULL is returned and timeout is set to
+// the time until the next delayed job is due. Must be called in a critical section.
+static struct worker_work* takeNextJob(const TickType_t now, TickType_t* timeout)
 {
-  struct worker_work work;
+  struct worker_work* next = NULL;
+  *timeout = portMAX_DELAY;
+
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    struct worker_work* work = &jobs[i];
+    if (work->state != workPending) {
+      continue;
+    }
+
+    if (!isDue(work, now)) {
+      const TickType_t untilDue = work->dueTick - now;
+      if (untilDue < *timeout) {
+        *timeout = untilDue;
+      }
+      continue;
+    }
+
+    if (next == NULL || work->priority > next->priority ||
+        (work->priority == next->priority && (int32_t)(work->sequence - next->sequence) < 0)) {
+      next = work;
+    }
+  }
+
+  if (next) {
+    next->state = workRunning;
+    queueStatsUpdate(queueStatsWorker, pendingJobs, 0, 1);
+    pendingJobs--;
+  }
+
+  return next;
+}
 
-  if (!workerQueue)
+// Frees a job that has been executed, or schedules it again if it is periodic. Must be called in a critical section.
+static void releaseJob(struct worker_work* work, const TickType_t now)
+{
+  if (work->period > 0 && !work->cancelled) {
+    work->dueTick += work->period;
+    if (isDue(work, now)) {
+      // We are late, skip the periods that we missed
+      work->dueTick = now + work->period;
+    }
+    work->sequence = nextSequence++;
+    work->state = workPending;
+    queueStatsUpdate(queueStatsWorker, pendingJobs, 1, 0);
+    pendingJobs++;
+  } else {
+    work->state = workFree;
+  }
+}
+
+static void updateStatistics(const struct worker_work* work, const uint32_t runtimeUs)
+{
+  runCount++;
+  lastRuntimeUs = runtimeUs;
+  if (runtimeUs > maxRuntimeUs) {
+    maxRuntimeUs = runtimeUs;
+    slowestFunction = (uint32_t)work->function;
+  }
+}
+
+void workerLoop()
+{
+  if (!isInit)
     return;
 
   while (1)
   {
-    xQueueReceive(workerQueue, &work, portMAX_DELAY);
+    TickType_t timeout;
+
+    taskENTER_CRITICAL();
+    struct worker_work* work = takeNextJob(xTaskGetTickCount(), &timeout);
+    taskEXIT_CRITICAL();
+
+    if (work == NULL) {
+      xSemaphoreTake(workerWakeup, timeout);
+      continue;
+    }
 
-    if (work.function)
-      work.function(work.arg);
+    // The job is not changed by anyone else while it is running
+    const uint64_t start = usecTimestamp();
+    work->function(work->arg);
+    updateStatistics(work, usecTimestamp() - start);
+
+    taskENTER_CRITICAL();
+    releaseJob(work, xTaskGetTickCount());
+    taskEXIT_CRITICAL();
   }
 }
 
 int workerSchedule(void (*function)(void*), void *arg)
 {
-  struct worker_work work;
+  return workerScheduleWithOptions(function, arg, &defaultOptions);
+}
 
+int workerScheduleWithOptions(void (*function)(void*), void *arg, const workerOptions_t* options)
+{
   if (!function)
     return ENOEXEC;
 
-  work.function = function;
-  work.arg = arg;
-  if (xQueueSend(workerQueue, &work, 0) == pdFALSE)
-    return ENOMEM;
+  int result = ENOMEM;
+  struct worker_work* free = NULL;
+  uint8_t pendingCount = 0;
 
-  return 0;
+  taskENTER_CRITICAL();
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    struct worker_work* work = &jobs[i];
+    if (work->state == workFree) {
+      if (free == NULL) {
+        free = work;
+      }
+    } else if (work->state == workPending) {
+      pendingCount++;
+      if (options->coalesce && work->function == function && work->arg == arg) {
+        result = 0;
+        break;
+      }
+    }
+  }
+
+  if (result == 0) {
+    coalesceCount++;
+  } else if (free) {
+    free->function = function;
+    free->arg = arg;
+    free->priority = options->priority;
+    free->cancelled = false;
+    free->sequence = nextSequence++;
+    free->dueTick = xTaskGetTickCount() + M2T(options->delayMs);
+    free->period = M2T(options->periodMs);
+    free->state = workPending;
+    queueStatsUpdate(queueStatsWorker, pendingJobs, 1, 0);
+    pendingJobs++;
+    pendingCount++;
+    result = 0;
+  } else {
+    dropCount++;
+    queueStatsFull(queueStatsWorker);
+  }
+
+  if (pendingCount > maxPendingCount) {
+    maxPendingCount = pendingCount;
+  }
+  taskEXIT_CRITICAL();
+
+  if (result == 0) {
+    xSemaphoreGive(workerWakeup);
+  } else if (dropCount == 1) {
+    DEBUG_PRINT("WARNING: worker queue is full, a job was dropped\n");
+  }
+
+  return result;
 }
+
+int workerCancel(void (*function)(void*), void *arg)
+{
+  int result = ENOENT;
+
+  taskENTER_CRITICAL();
+  for (int i = 0; i < WORKER_QUEUE_LENGTH; i++) {
+    struct worker_work* work = &jobs[i];
+    if (work->function == function && work->arg == arg) {
+      if (work->state == workPending) {
+        work->state = workFree;
+        queueStatsUpdate(queueStatsWorker, pendingJobs, 0, 1);
+        pendingJobs--;
+        result = 0;
+      } else if (work->state == workRunning && work->period > 0) {
+        work->cancelled = true;
+        result = 0;
+      }
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  return result;
+}
+
+/**
+ * The worker executes jobs that have been scheduled by other parts of the system, in the system task
+ */
+LOG_GROUP_START(worker)
+/**
+ * @brief Number of jobs that have been executed
+ */
+LOG_ADD(LOG_UINT32, run, &runCount)
+/**
+ * @brief Number of jobs that could not be scheduled since the queue was full, the jobs were lost
+ */
+LOG_ADD(LOG_UINT32, drop, &dropCount)
+/**
+ * @brief Number of jobs that were merged with a pending job with the same function and argument
+ */
+LOG_ADD(LOG_UINT32, coalesce, &coalesceCount)
+/**
+ * @brief The largest number of pending jobs seen
+ */
+LOG_ADD(LOG_UINT8, maxPending, &maxPendingCount)
+/**
+ * @brief Runtime of the last job [us]
+ */
+LOG_ADD(LOG_UINT32, lastUs, &lastRuntimeUs)
+/**
+ * @brief Longest runtime of a job [us]
+ */
+LOG_ADD(LOG_UINT32, maxUs, &maxRuntimeUs)
+/**
+ * @brief Address of the function of the job with the longest runtime, look it up in the map file of the build
+ */
+LOG_ADD(LOG_UINT32, slowFn, &slowestFunction)
+LOG_GROUP_STOP(worker)
@@ -0,0 +1,64 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * arena.h - Bump allocator for pools that are sized at runtime
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A region of memory that is handed out in blocks that are never freed. It is
+ * intended for pools that are allocated once during init, when the size is
+ * not known at compile time (configuration read from storage, deck
+ * detection). Blocks are 8 byte aligned and zero initialized.
+ *
+ * The arena does not lock, callers that may run concurrently must serialize
+ * the calls.
+ */
+typedef struct {
+  uint8_t* memory;
+  size_t size;
+  size_t used;
+} arena_t;
+
+#define ARENA_ALIGNMENT 8
+
+void arenaInit(arena_t* arena, void* memory, const size_t size);
+
+/**
+ * @brief Allocate a zero initialized block
+ *
+ * @return A pointer to the block, or NULL if there is not enough memory left in the arena
+ */
+void* arenaAlloc(arena_t* arena, const size_t size);
+
+/**
+ * @brief The number of bytes that are left, the largest block that can be
+ * allocated may be up to ARENA_ALIGNMENT - 1 bytes smaller
+ */
+static inline size_t arenaGetFree(const arena_t* arena) {
+  return arena->size - arena->used;
+}
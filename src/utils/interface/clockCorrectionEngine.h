@@ -32,13 +32,46 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef enum {
+  // Low pass filtered pairwise ratios with leaky bucket acceptance, see clockCorrectionEngineUpdate()
+  clockCorrectionAlgorithmBucket = 0,
+  // Recursive least squares fit over all samples, see clockCorrectionEngineUpdateLeastSquares()
+  clockCorrectionAlgorithmLeastSquares = 1,
+} clockCorrectionAlgorithm_t;
+
 typedef struct {
   double clockCorrection;
   unsigned int clockCorrectionBucket;
+
+  // State of the least squares fit. The means are relative to the latest sample.
+  double lsWeight;
+  double lsMeanX;
+  double lsMeanY;
+  double lsCovXX;
+  double lsCovXY;
+  uint16_t lsSampleCount;
+  uint8_t lsOutlierCount;
 } clockCorrectionStorage_t;
 
 double clockCorrectionEngineGet(const clockCorrectionStorage_t* storage);
 double clockCorrectionEngineCalculate(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
 bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double clockCorrectionCandidate);
 
+/**
+ * @brief Update the clock correction with a new pair of time stamps, using a recursive least squares fit of the
+ * reference clock against clock x, with exponential forgetting. The cost is constant per sample.
+ *
+ * All samples since the anchor was first heard contribute to the fit, not only the latest pair, which makes the
+ * estimate converge faster and be less noisy than the pairwise ratio used by clockCorrectionEngineUpdate().
+ *
+ * @param storage The clock correction storage
+ * @param new_t_in_cl_reference Time of the latest event, measured by the reference clock
+ * @param old_t_in_cl_reference Time of the previous event, measured by the reference clock
+ * @param new_t_in_cl_x Time of the latest event, measured by clock x
+ * @param old_t_in_cl_x Time of the previous event, measured by clock x
+ * @param mask Mask with the bits used in the time stamps
+ * @return true if the sample is reliable, that is the fit is based on enough samples and the sample is consistent with it
+ */
+bool clockCorrectionEngineUpdateLeastSquares(clockCorrectionStorage_t* storage, const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
+
 #endif /* clockCorrectionEngine_h */
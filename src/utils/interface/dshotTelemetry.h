@@ -0,0 +1,69 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * dshotTelemetry.h - decoding of bidirectional DSHOT telemetry
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of bits in a telemetry frame, including the start bit
+#define DSHOT_TELEMETRY_FRAME_BITS 21
+
+// The telemetry bit rate is 5/4 of the DSHOT bit rate
+#define DSHOT_TELEMETRY_BIT_RATE(DSHOT_BIT_RATE) ((DSHOT_BIT_RATE) * 5 / 4)
+
+/**
+ * @brief Decode a telemetry frame from samples of the motor signal. The line is idle high and the frame starts with a
+ * falling edge, the bits are GCR encoded and a transition marks a 1.
+ *
+ * @param samples Samples of the GPIO input data register, taken at a fixed rate
+ * @param count Number of samples
+ * @param start Index of the first sample to search for the frame from
+ * @param pinMask Mask of the motor pin in the samples
+ * @param samplesPerBit Number of samples per telemetry bit, at least 2
+ * @param value Set to the 12 bit telemetry value if a valid frame was found
+ * @return true if a frame with a valid checksum was found
+ */
+bool dshotTelemetryDecodeSamples(const uint16_t* samples, const int count, const int start, const uint16_t pinMask, const float samplesPerBit, uint16_t* value);
+
+/**
+ * @brief Decode a received telemetry frame
+ *
+ * @param frame The 21 bit frame, a 1 for each bit that starts with a transition. The start bit is the most significant.
+ * @param value Set to the 12 bit telemetry value if the checksum is valid
+ * @return true if the frame is valid
+ */
+bool dshotTelemetryDecodeFrame(const uint32_t frame, uint16_t* value);
+
+/**
+ * @brief Convert a telemetry value to electrical RPM. The value is the electrical period in us, as a 9 bit mantissa
+ * and a 3 bit left shift.
+ *
+ * @param value The 12 bit telemetry value
+ * @return The eRPM, 0 if the motor is stopped
+ */
+uint32_t dshotTelemetryToErpm(const uint16_t value);
@@ -47,6 +47,122 @@ void lpf2pSetCutoffFreq(lpf2pData* lpfData, float sample_freq, float cutoff_freq
 float lpf2pApply(lpf2pData* lpfData, float sample);
 float lpf2pReset(lpf2pData* lpfData, float sample);
 
+/** Bank of second order (biquad) filters, one per channel, updated in one pass.
+ *
+ * Each channel has its own coefficients, so low pass and notch channels can be
+ * mixed in the same bank. The coefficients and the state are stored per field
+ * for all channels (structure of arrays), which lets the compiler pipeline the
+ * loads and fused multiply-adds of all channels instead of doing one function
+ * call per channel.
+ *
+ * Direct form I is used, the latest and previous outputs of channel i are
+ * available in y1[i] and y2[i].
+ */
+#define BIQUAD_BANK_MAX_CHANNELS 6
+
+typedef struct {
+  uint8_t channels;
+  // Coefficients, a0 normalized to 1
+  float b0[BIQUAD_BANK_MAX_CHANNELS];
+  float b1[BIQUAD_BANK_MAX_CHANNELS];
+  float b2[BIQUAD_BANK_MAX_CHANNELS];
+  float a1[BIQUAD_BANK_MAX_CHANNELS];
+  float a2[BIQUAD_BANK_MAX_CHANNELS];
+  // Input and output history
+  float x1[BIQUAD_BANK_MAX_CHANNELS];
+  float x2[BIQUAD_BANK_MAX_CHANNELS];
+  float y1[BIQUAD_BANK_MAX_CHANNELS];
+  float y2[BIQUAD_BANK_MAX_CHANNELS];
+} biquadBank_t;
+
+/**
+ * @brief Initialize a bank with all channels set to the same second order Butterworth low pass
+ * filter, and the state cleared. A cutoff frequency <= 0 makes the channels pass through.
+ */
+void biquadBankInitLowPass(biquadBank_t* bank, uint8_t channels, float sampleFreq, float cutoffFreq);
+
+/**
+ * @brief Initialize a bank with all channels set to the same notch filter, and the state cleared.
+ */
+void biquadBankInitNotch(biquadBank_t* bank, uint8_t channels, float sampleFreq, float centerFreq, float q);
+
+/**
+ * @brief Set one channel to a second order Butterworth low pass filter, the state is kept.
+ * A cutoff frequency <= 0 makes the channel pass through.
+ */
+void biquadBankSetLowPass(biquadBank_t* bank, uint8_t channel, float sampleFreq, float cutoffFreq);
+
+/**
+ * @brief Set one channel to a notch filter, the state is kept.
+ *
+ * @param centerFreq The frequency to reject
+ * @param q Quality factor, center frequency / -3 dB bandwidth
+ */
+void biquadBankSetNotch(biquadBank_t* bank, uint8_t channel, float sampleFreq, float centerFreq, float q);
+
+/**
+ * @brief Set one channel to a notch filter given the cosine and sine of the normalized center frequency
+ * (2 * pi * centerFreq / sampleFreq), the state is kept. Avoids the trigonometric functions when the center
+ * frequency is updated often, see biquadBankSetNotch().
+ */
+void biquadBankSetNotchCosSin(biquadBank_t* bank, uint8_t channel, float cosW0, float sinW0, float q);
+
+/**
+ * @brief Set the state of all channels to the steady state of constant inputs (unity DC gain)
+ *
+ * @param values One value per channel
+ */
+void biquadBankReset(biquadBank_t* bank, const float* values);
+
+/**
+ * @brief Filter one sample of each channel
+ *
+ * @param samples One sample per channel, replaced by the filtered values
+ */
+void biquadBankApply(biquadBank_t* bank, float* samples);
+
+/**
+ * @brief Filter one sample of each channel and calculate the finite difference of the filtered values of the
+ * first channels, in the same pass
+ *
+ * @param samples One sample per channel, replaced by the filtered values
+ * @param diffChannels Number of channels, from the first one, to differentiate
+ * @param sampleFreq The sample frequency [Hz]
+ * @param derivative One value per differentiated channel, (y - previous y) * sampleFreq
+ */
+void biquadBankApplyDifferentiate(biquadBank_t* bank, float* samples, uint8_t diffChannels, float sampleFreq, float* derivative);
+
+/**
+ * Single bin of a DFT over a block of samples (Goertzel algorithm). Streams the samples with one multiplication and
+ * two additions per sample, cheaper than an FFT of the block when only a few bins are needed and without a buffer.
+ */
+typedef struct {
+  float coeff;
+  float s1;
+  float s2;
+  uint32_t count;
+} goertzel_t;
+
+/**
+ * @brief Initialize for the bin with the given number of cycles per block
+ *
+ * @param bin Number of cycles per block of the frequency to detect, the frequency is bin * sampleFreq / length
+ * @param length Number of samples in the block
+ */
+void goertzelInit(goertzel_t* goertzel, uint32_t bin, uint32_t length);
+
+static inline void goertzelAdd(goertzel_t* goertzel, float sample) {
+  const float s = sample + goertzel->coeff * goertzel->s1 - goertzel->s2;
+  goertzel->s2 = goertzel->s1;
+  goertzel->s1 = s;
+  goertzel->count++;
+}
+
+/**
+ * @brief Amplitude of the sinusoid at the bin frequency in the samples added since the init
+ */
+float goertzelAmplitude(const goertzel_t* goertzel);
+
 /** Second order low pass filter structure.
  *
  * using biquad filter with bilinear z transform
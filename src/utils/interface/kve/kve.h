@@ -37,6 +37,16 @@ typedef bool (*kveFunc_t)(const char *key, void *buffer, size_t length);
 
 void kveDefrag(kveMemory_t *kve);
 
+/** Do one bounded step of defragmentation
+ *
+ * Moves the first item after the first hole down into the hole, or crops
+ * the hole if it is at the end of the table. Can be interleaved with the
+ * other kve functions to compact the table a little at a time.
+ *
+ * Return true if a step was done, false if there are no holes left
+ */
+bool kveDefragStep(kveMemory_t *kve);
+
 bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t length);
 
 size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLength);
@@ -60,6 +70,9 @@ typedef struct kveStats {
     size_t freeSpace;
     size_t fragmentation;
     size_t spaceLeftUntilForcedDefrag;
+    // RAM used by the key index and number of items in it, 0 without index
+    size_t indexSize;
+    size_t indexItems;
 } kveStats_t;
 
 void kveGetStats(kveMemory_t *kve, kveStats_t *stats);
\ No newline at end of file
@@ -30,9 +30,15 @@
 
 #include <stddef.h>
 
+struct kveIndex_s;
+
 typedef struct {
     size_t memorySize;
     size_t (*read)(size_t address, void* data, size_t length);
     size_t (*write)(size_t address, const void* data, size_t length);
     void (*flush)(void);
+    // Optional RAM index of the keys, see kve_index.h. NULL to always walk the table.
+    struct kveIndex_s *index;
+    // No holes before this address, where kveDefragStep() continues from
+    size_t defragAddress;
 } kveMemory_t;
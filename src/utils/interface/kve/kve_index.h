@@ -0,0 +1,99 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kve_index.h - RAM index of the key addresses in a kve table
+ *
+ */
+
+/**
+ * These functions are intended to be used internally by the embedded
+ * key-value module. They are not intended to be used by any other
+ * modules.
+ *
+ * The index maps key hashes to item addresses, so that items can be found
+ * without walking the table. It is built with one walk of the table on first
+ * use and then kept in sync by the kve functions. Hash collisions are
+ * resolved by comparing the key stored in the table.
+ *
+ * The slots are provided by the owner of the kve memory, which bounds the
+ * RAM used. If the table holds more items than the index can take, the index
+ * is disabled and the kve functions fall back to walking the table.
+ */
+
+#pragma once
+
+#include "kve/kve_common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint16_t hash;
+    // Item address, KVE_INDEX_EMPTY or KVE_INDEX_DELETED
+    uint16_t address;
+} kveIndexSlot_t;
+
+typedef enum {
+    kveIndexStateNotBuilt = 0,
+    kveIndexStateValid,
+    kveIndexStateDisabled,
+} kveIndexState_t;
+
+typedef struct kveIndex_s {
+    kveIndexSlot_t *slots;
+    // Number of slots, must be a power of two
+    uint16_t size;
+    kveIndexState_t state;
+    // Slots in use, including deleted ones
+    uint16_t used;
+    uint16_t count;
+    // Address of the end tag of the table
+    size_t endAddress;
+} kveIndex_t;
+
+/** Mark the index as out of date, it is rebuilt on next use
+ *
+ * Must be called when items are moved in the table
+ */
+void kveIndexInvalidate(kveMemory_t *kve);
+
+/** Return true if the index can be used, builds it if needed
+ *
+ * firstItemAddress is the address of the first item in the table
+ */
+bool kveIndexIsValid(kveMemory_t *kve, size_t firstItemAddress);
+
+/** Find the address of the item with key, or an invalid address
+ *
+ * Only valid if kveIndexIsValid() returns true
+ */
+size_t kveIndexFind(kveMemory_t *kve, const char *key);
+
+/** Add an item that has been written to the table
+ */
+void kveIndexAdd(kveMemory_t *kve, const char *key, size_t address);
+
+/** Remove an item from the index, before it is overwritten in the table
+ */
+void kveIndexRemove(kveMemory_t *kve, const char *key, size_t address);
@@ -3,6 +3,24 @@
 #include "ootx_decoder.h"
 #include "lighthouse_types.h"
 
+// Number of grid points along each axis of the LH2 correction table
+#define LIGHTHOUSE_CALIBRATION_TABLE_SIZE 9
+// The table covers raw angles in [-LIGHTHOUSE_CALIBRATION_TABLE_RANGE, LIGHTHOUSE_CALIBRATION_TABLE_RANGE] (radians)
+#define LIGHTHOUSE_CALIBRATION_TABLE_RANGE 1.2f
+// Resolution of the stored corrections (radians per LSB), gives a range of +-0.65 rad
+#define LIGHTHOUSE_CALIBRATION_TABLE_SCALE 0.00002f
+// Marks a grid point where the solver did not converge
+#define LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA INT16_MIN
+
+/**
+ * Precomputed inverse distortion for one LH2 base station. Holds the correction (corrected - raw angle)
+ * for both sweeps at each grid point, in units of LIGHTHOUSE_CALIBRATION_TABLE_SCALE radians.
+ */
+typedef struct {
+  int16_t correction[LIGHTHOUSE_CALIBRATION_TABLE_SIZE][LIGHTHOUSE_CALIBRATION_TABLE_SIZE][2];
+  bool valid;
+} lighthouseCalibrationTable_t;
+
 /**
  * @brief Initialize calibration structure from baseStation ootx frame
  *
@@ -29,6 +47,28 @@ void lighthouseCalibrationApplyV1(const lighthouseCalibration_t* calib, const fl
  */
 void lighthouseCalibrationApplyV2(const lighthouseCalibration_t* calib, const float* rawAngles, float* correctedAngles);
 
+/**
+ * @brief Build the LH2 correction table for a base station. Expensive (runs the iterative solver for every grid
+ * point), call it when new calibration data is set, not per sample. If the calibration data is not valid
+ * the table is marked as invalid.
+ *
+ * @param table The table to initialize
+ * @param calib Calibration object to use
+ */
+void lighthouseCalibrationInitTableV2(lighthouseCalibrationTable_t* table, const lighthouseCalibration_t* calib);
+
+/**
+ * @brief Apply baseStation calibration to the two received angles for LH 2, using a precomputed table.
+ * The correction is interpolated from the table and refined by one step of the solver. Falls back to
+ * lighthouseCalibrationApplyV2() if the table is not valid or the angles are outside the table.
+ *
+ * @param calib Calibration object to use
+ * @param table Correction table built from calib by lighthouseCalibrationInitTableV2()
+ * @param rawAngles Array containing the two raw measured angles
+ * @param correctedAngles Array containing the two corrected angles after applying calibration
+ */
+void lighthouseCalibrationApplyV2Table(const lighthouseCalibration_t* calib, const lighthouseCalibrationTable_t* table, const float* rawAngles, float* correctedAngles);
+
 /**
  * @brief Apply no baseStation calibration to the two received angles, that is copy the raw angles
  *
@@ -28,6 +28,19 @@ typedef struct {
  */
 bool lighthouseGeometryGetPositionFromRayIntersection(const baseStationGeometry_t* geo1, const baseStationGeometry_t* geo2, float angles1[2], float angles2[2], vec3d position, float *position_delta);
 
+/**
+ * @brief Find the point closest to a set of rays, in the least squares sense. Used when more than two
+ * base stations see the same sensor.
+ *
+ * @param origins - array with the origin of each ray (base station positions)
+ * @param rays - array with a normalized direction vector for each ray
+ * @param count - the number of rays, at least 2
+ * @param position - (output) the point with the smallest sum of squared distances to the rays
+ * @param residual - (output) the RMS distance between the point and the rays
+ * @return true if the position could be calculated, false if the rays are (close to) parallel
+ */
+bool lighthouseGeometryGetPositionFromRays(const vec3d origins[], const vec3d rays[], const int count, vec3d position, float *residual);
+
 /**
  * @brief Get the base station position from the base station geometry in world reference frame. This position can be seen as the
  * point where the lazers originate from.
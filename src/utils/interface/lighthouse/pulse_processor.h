@@ -48,6 +48,16 @@
 #define PULSE_PROCESSOR_TIMESTAMP_MAX ((1 << PULSE_PROCESSOR_TIMESTAMP_BITWIDTH) - 1)
 #define PULSE_PROCESSOR_TIMESTAMP_BITMASK PULSE_PROCESSOR_TIMESTAMP_MAX
 
+// Number of base stations that can have OOTX decoding and calibration tables at the same time
+#if CONFIG_DECK_LIGHTHOUSE_N_BS_SLOTS < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS
+#define PULSE_PROCESSOR_N_BS_SLOTS CONFIG_DECK_LIGHTHOUSE_N_BS_SLOTS
+#else
+#define PULSE_PROCESSOR_N_BS_SLOTS CONFIG_DECK_LIGHTHOUSE_MAX_N_BS
+#endif
+
+// A slot that has been used within this time is not reassigned to another base station
+#define PULSE_PROCESSOR_BS_SLOT_MIN_IDLE_US 1000000
+
 // Utility functions and macros
 
 /**
@@ -206,6 +216,22 @@ typedef struct {
   uint32_t ootxTimestamps[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
 } pulseProcessorV2_t;
 
+/**
+ * @brief Data for one base station that is only needed while the base station is visible. A small pool of slots is
+ * shared by all base stations, a slot is assigned to a base station when it is first needed and the least recently
+ * used slot is reassigned when the pool is full.
+ *
+ */
+typedef struct {
+  bool inUse;
+  uint8_t baseStation;
+  uint64_t lastUsed; // [us]
+
+  ootxDecoderState_t ootxDecoder;
+  // Precomputed LH2 corrections for bsCalibration[baseStation]
+  lighthouseCalibrationTable_t calibTable;
+} pulseProcessorBsSlot_t;
+
 typedef struct pulseProcessor_s {
   bool receivedBsSweep[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
 
@@ -219,7 +245,7 @@ typedef struct pulseProcessor_s {
     };
   };
 
-  ootxDecoderState_t ootxDecoder[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+  pulseProcessorBsSlot_t bsSlots[PULSE_PROCESSOR_N_BS_SLOTS];
   lighthouseCalibration_t bsCalibration[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
   baseStationGeometry_t bsGeometry[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
   baseStationGeometryCache_t bsGeoCache[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
@@ -278,6 +304,34 @@ typedef bool (*pulseProcessorProcessPulse_t)(pulseProcessor_t *state, const puls
  */
 bool pulseProcessorApplyCalibration(pulseProcessor_t *state, pulseProcessorResult_t* angles, int baseStation);
 
+/**
+ * @brief Get the slot of a base station, and mark it as used. If the base station does not have a slot, a free slot
+ * or the least recently used slot is assigned to it and the calibration table is built from bsCalibration.
+ *
+ * @param state The pulse processor state
+ * @param baseStation The base station
+ * @return The slot, or NULL if all slots are used by base stations that have been seen within
+ * PULSE_PROCESSOR_BS_SLOT_MIN_IDLE_US
+ */
+pulseProcessorBsSlot_t* pulseProcessorGetBsSlot(pulseProcessor_t *state, const int baseStation);
+
+/**
+ * @brief Find the slot of a base station, without assigning a new slot or marking it as used
+ *
+ * @param state The pulse processor state
+ * @param baseStation The base station
+ * @return The slot, or NULL if the base station does not have a slot
+ */
+pulseProcessorBsSlot_t* pulseProcessorFindBsSlot(pulseProcessor_t *state, const int baseStation);
+
+/**
+ * @brief Rebuild the calibration table of a base station, if it has a slot. Call when bsCalibration is updated.
+ *
+ * @param state The pulse processor state
+ * @param baseStation The base station
+ */
+void pulseProcessorCalibrationDataUpdated(pulseProcessor_t *state, const int baseStation);
+
 void pulseProcessorClearOutdated(pulseProcessor_t *appState, pulseProcessorResult_t* angles, int baseStation);
 
 /**
@@ -71,3 +71,53 @@ bool rateSupervisorValidate(rateSupervisor_t* context, const uint32_t osTimeMs);
  * @return uint32_t The count at the latest evaluation time
  */
 uint32_t rateSupervisorLatestCount(rateSupervisor_t* context);
+
+#define RATE_SUPERVISOR_MAX_TASKS 8
+
+/**
+ * A periodic task in the rate supervisor registry. The rate is evaluated once per second, deviations are counted
+ * and the latest offender is exposed in the rateSup log group.
+ */
+typedef struct {
+    rateSupervisor_t supervisor;
+    const char* name;
+    uint32_t deviationCount;
+    uint8_t id;
+} rateSupervisorTask_t;
+
+/**
+ * @brief Register a periodic task in the rate supervisor registry. Should be called from the task, before the
+ * first call to rateSupervisorTaskValidate(). Registering the same task again restarts the supervision.
+ *
+ * @param task The task to register, must be statically allocated
+ * @param name Name of the task, used in the warning when the rate is off
+ * @param osTimeMs The current os time in ms
+ * @param expectedRateHz The expected number of validations per second
+ * @param toleranceHz The accepted deviation from the expected rate
+ * @param skip The number of initial evaluations to ignore failures for
+ * @return true if the task was registered, false if the registry is full. The task is still supervised, but it is
+ * not counted in the log variables.
+ */
+bool rateSupervisorRegisterTask(rateSupervisorTask_t* task, const char* name, const uint32_t osTimeMs, const uint32_t expectedRateHz, const uint32_t toleranceHz, const uint8_t skip);
+
+/**
+ * @brief Validation hook for a registered task, to be called once per iteration of the task. Costs an increment
+ * and a compare, except once per second when the rate is evaluated.
+ *
+ * @param task A registered task
+ * @param osTimeMs The current os time in ms
+ * @return false if the rate was off at this evaluation
+ */
+bool rateSupervisorTaskValidate(rateSupervisorTask_t* task, const uint32_t osTimeMs);
+
+/**
+ * @brief Get the total number of rate deviations of all registered tasks
+ */
+uint32_t rateSupervisorTotalDeviations(void);
+
+/**
+ * @brief Get the latest task with a rate deviation
+ *
+ * @return The task, or 0 if no deviation has been seen
+ */
+const rateSupervisorTask_t* rateSupervisorLatestOffender(void);
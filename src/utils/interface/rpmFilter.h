@@ -0,0 +1,81 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * rpmFilter.h - notch filters tracking the motor speeds and their harmonics
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "filter.h"
+
+#define RPM_FILTER_MOTORS 4
+#define RPM_FILTER_MAX_HARMONICS 3
+#define RPM_FILTER_AXES 3
+
+/**
+ * A notch filter per motor and harmonic, in series, on each of the three axes. The center frequencies follow the motor
+ * speeds. The coefficients of one motor are updated per sample, the harmonics are derived from the fundamental with
+ * trigonometric identities so only one sine and cosine is evaluated per update.
+ */
+typedef struct {
+  float sampleFreq;
+  float q;
+  // Notches are clamped to this frequency when the motor is slow or stopped [Hz]
+  float minFreq;
+  // Notches above this frequency are passed through [Hz]
+  float maxFreq;
+  uint8_t harmonics;
+  uint8_t nextMotor;
+  float rpm[RPM_FILTER_MOTORS];
+  biquadBank_t notch[RPM_FILTER_MOTORS][RPM_FILTER_MAX_HARMONICS];
+} rpmFilter_t;
+
+/**
+ * @brief Initialize the filters, all notches are set to the min frequency
+ *
+ * @param this The filter
+ * @param sampleFreq Sample rate of the filtered data [Hz]
+ * @param harmonics Number of harmonics to reject, 1 for the fundamental only
+ * @param q Quality factor of the notches
+ * @param minFreq Lowest center frequency [Hz]
+ */
+void rpmFilterInit(rpmFilter_t* this, const float sampleFreq, const uint8_t harmonics, const float q, const float minFreq);
+
+/**
+ * @brief Set the latest motor speeds. The coefficients follow during the next RPM_FILTER_MOTORS calls to
+ * rpmFilterApply().
+ *
+ * @param this The filter
+ * @param rpm The speed of each motor [RPM], RPM_FILTER_MOTORS entries
+ */
+void rpmFilterSetRpm(rpmFilter_t* this, const float* rpm);
+
+/**
+ * @brief Update the coefficients of one motor and filter one sample
+ *
+ * @param this The filter
+ * @param axis One sample per axis, replaced by the filtered values
+ */
+void rpmFilterApply(rpmFilter_t* this, float* axis);
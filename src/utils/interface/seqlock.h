@@ -0,0 +1,122 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * seqlock.h - Sequence lock for single writer, multiple reader data sharing
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A sequence lock lets one writer publish a data structure to any number of readers without blocking the writer.
+ * The writer bumps the sequence number before and after the update, a reader copies the data and retries if the
+ * sequence number was odd (update in progress) or changed during the copy.
+ *
+ * Intended for a writer with a higher priority than the readers, for instance the stabilizer loop. A reader is then
+ * only preempted by the writer and a retry is rare and cheap. Readers must not have a higher priority than the writer
+ * (or run in an ISR), as they could preempt an update in progress and would fail until the writer resumes.
+ */
+typedef struct {
+  volatile uint32_t sequence;
+} seqlock_t;
+
+// Max number of attempts in seqlockRead() before giving up
+#define SEQLOCK_READ_ATTEMPTS 8
+
+/**
+ * @brief Initialize a sequence lock
+ *
+ * @param lock The lock
+ */
+void seqlockInit(seqlock_t* lock);
+
+/**
+ * @brief Start an update of the protected data. Must be followed by seqlockWriteEnd().
+ *
+ * @param lock The lock
+ */
+static inline void seqlockWriteBegin(seqlock_t* lock) {
+  lock->sequence++;
+  __sync_synchronize();
+}
+
+/**
+ * @brief End an update of the protected data
+ *
+ * @param lock The lock
+ */
+static inline void seqlockWriteEnd(seqlock_t* lock) {
+  __sync_synchronize();
+  lock->sequence++;
+}
+
+/**
+ * @brief Copy data into the protected storage
+ *
+ * @param lock The lock
+ * @param storage The protected storage
+ * @param data The data to publish
+ * @param size Size of the data
+ */
+void seqlockWrite(seqlock_t* lock, void* storage, const void* data, const size_t size);
+
+/**
+ * @brief Get a consistent copy of the protected storage
+ *
+ * @param lock The lock
+ * @param storage The protected storage
+ * @param data Destination of the copy
+ * @param size Size of the data
+ * @return true if a consistent copy was made, false if the data was being updated in all SEQLOCK_READ_ATTEMPTS
+ * attempts. The content of data is undefined in that case.
+ */
+bool seqlockRead(const seqlock_t* lock, const void* storage, void* data, const size_t size);
+
+/**
+ * @brief Start an in place read of the protected storage, to read parts of the data without copying all of it. The
+ * data that was read is only valid if seqlockReadValidate() returns true for the returned sequence number.
+ *
+ * @param lock The lock
+ * @return The sequence number to pass to seqlockReadValidate()
+ */
+static inline uint32_t seqlockReadBegin(const seqlock_t* lock) {
+  const uint32_t sequence = lock->sequence;
+  __sync_synchronize();
+  return sequence;
+}
+
+/**
+ * @brief End an in place read started with seqlockReadBegin()
+ *
+ * @param lock The lock
+ * @param sequence The sequence number returned by seqlockReadBegin()
+ * @return true if the data read since seqlockReadBegin() is consistent, false if it was (or is being) updated and
+ * the read must be retried
+ */
+static inline bool seqlockReadValidate(const seqlock_t* lock, const uint32_t sequence) {
+  __sync_synchronize();
+  return ((sequence & 1) == 0) && (lock->sequence == sequence);
+}
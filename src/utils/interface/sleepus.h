@@ -26,4 +26,9 @@
 #pragma once
 #include <stdint.h>
 
+/**
+ * Sleep for at least us microseconds. From a task, sleeps of 10 us and more
+ * block the task on a hardware timer and let other tasks run. Shorter sleeps,
+ * and sleeps from interrupts or before the scheduler is started, busy-wait.
+ */
 void sleepus(uint32_t us);
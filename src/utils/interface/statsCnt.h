@@ -22,11 +22,12 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  *
- * statsCnt.h - utitlity for logging rates
+ * statsCnt.h - utitlity for logging rates and statistics
  */
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "log.h"
 
@@ -60,6 +61,162 @@ void statsCntRateCounterInit(statsCntRateCounter_t* counter, uint32_t averagingI
 float statsCntRateCounterUpdate(statsCntRateCounter_t* counter, uint32_t now_ms);
 
 
+/**
+ * @brief A struct used to track min, average and max of a sampled value, for instance execution times, over an interval
+ */
+typedef struct {
+    uint32_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+
+    uint32_t latestMin;
+    uint32_t latestMax;
+    float latestAvg;
+    float latestRate;
+    uint32_t latestAveragingMs;
+    uint32_t intervalMs;
+} statsCntMinMaxAvg_t;
+
+/**
+ * @brief Initialize a statsCntMinMaxAvg_t struct.
+ *
+ * @param stats The struct to initialize
+ * @param averagingIntervalMs The interval (in ms) between calculations
+ */
+void statsCntMinMaxAvgInit(statsCntMinMaxAvg_t* stats, uint32_t averagingIntervalMs);
+
+/**
+ * @brief Add a sample
+ *
+ * @param stats The struct to add the sample to
+ * @param value The sampled value
+ */
+static inline void statsCntMinMaxAvgAdd(statsCntMinMaxAvg_t* stats, const uint32_t value) {
+    if (value < stats->min) {
+        stats->min = value;
+    }
+    if (value > stats->max) {
+        stats->max = value;
+    }
+    stats->sum += value;
+    stats->count++;
+}
+
+/**
+ * @brief If the time since the previous calculation is longer than the configured interval, the min, average, max
+ * and sample rate of the samples added since then are stored in the latest values and the accumulation restarts.
+ * The latest values are 0 if there were no samples in the interval.
+ *
+ * @param stats The struct to update
+ * @param now_ms Current system time in ms
+ * @return true if new values were calculated
+ */
+bool statsCntMinMaxAvgUpdate(statsCntMinMaxAvg_t* stats, uint32_t now_ms);
+
+
+// STATS_CNT_HISTOGRAM_LOG_ADD() must be updated if the number of buckets is changed
+#define STATS_CNT_HISTOGRAM_BUCKETS 10
+
+/**
+ * @brief A struct used to track the distribution of a sampled value, for instance a latency, in buckets with
+ * logarithmic size. Values below 2^shift go in bucket 0, values in [2^(shift + i - 1), 2^(shift + i)) in bucket i
+ * and values from 2^(shift + STATS_CNT_HISTOGRAM_BUCKETS - 2) and up in the last bucket.
+ *
+ * The counts only increase when samples are added, the number of samples in each bucket over an interval is computed
+ * from the difference in statsCntHistogramUpdate(). Samples may therefore be added from one interrupt handler or
+ * task while the histogram is updated from another, as long as samples are added from one context only. Use
+ * STATS_CNT_HISTOGRAM_ADD_FROM_ISR() when samples are added from several contexts.
+ */
+typedef struct {
+    uint32_t count[STATS_CNT_HISTOGRAM_BUCKETS];
+    uint8_t shift;
+
+    uint32_t previousCount[STATS_CNT_HISTOGRAM_BUCKETS];
+    uint16_t latest[STATS_CNT_HISTOGRAM_BUCKETS];
+    uint32_t latestAveragingMs;
+    uint32_t intervalMs;
+} statsCntHistogram_t;
+
+/**
+ * @brief Initialize a statsCntHistogram_t struct.
+ *
+ * @param histogram The struct to initialize
+ * @param shift The upper limit of the first bucket is 2^shift
+ * @param averagingIntervalMs The interval (in ms) between calculations
+ */
+void statsCntHistogramInit(statsCntHistogram_t* histogram, uint8_t shift, uint32_t averagingIntervalMs);
+
+/**
+ * @brief Get the bucket of a value
+ *
+ * @param histogram The histogram
+ * @param value The value
+ * @return The index of the bucket
+ */
+static inline int statsCntHistogramBucket(const statsCntHistogram_t* histogram, const uint32_t value) {
+    const uint32_t scaled = value >> histogram->shift;
+    if (scaled == 0) {
+        return 0;
+    }
+    const int bucket = 32 - __builtin_clz(scaled);
+    return bucket < STATS_CNT_HISTOGRAM_BUCKETS ? bucket : STATS_CNT_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * @brief Add a sample, constant time
+ *
+ * @param histogram The histogram to add the sample to
+ * @param value The sampled value
+ */
+static inline void statsCntHistogramAdd(statsCntHistogram_t* histogram, const uint32_t value) {
+    histogram->count[statsCntHistogramBucket(histogram, value)]++;
+}
+
+/**
+ * @brief If the time since the previous calculation is longer than the configured interval, the number of samples
+ * in each bucket since then is stored in the latest values (saturated at UINT16_MAX).
+ *
+ * @param histogram The struct to update
+ * @param now_ms Current system time in ms
+ * @return true if new values were calculated
+ */
+bool statsCntHistogramUpdate(statsCntHistogram_t* histogram, uint32_t now_ms);
+
+
+// Interrupt safe variants ------------------------------------------------------
+// For samples that are added from interrupt handlers, or from several contexts. The macros use the FreeRTOS
+// critical sections, FreeRTOS.h and task.h must be included where they are used.
+
+/**
+ * @brief Add a sample to a statsCntMinMaxAvg_t from an interrupt handler
+ */
+#define STATS_CNT_MIN_MAX_AVG_ADD_FROM_ISR(STATS, VALUE) do { \
+    const UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR(); \
+    statsCntMinMaxAvgAdd((STATS), (VALUE)); \
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus); \
+  } while (0)
+
+/**
+ * @brief Update a statsCntMinMaxAvg_t that samples are added to from interrupt handlers, from a task
+ */
+#define STATS_CNT_MIN_MAX_AVG_UPDATE_SHARED(STATS, NOW_MS) do { \
+    taskENTER_CRITICAL(); \
+    statsCntMinMaxAvgUpdate((STATS), (NOW_MS)); \
+    taskEXIT_CRITICAL(); \
+  } while (0)
+
+/**
+ * @brief Add a sample to a statsCntHistogram_t that samples are added to from several contexts, from an interrupt
+ * handler. Use taskENTER_CRITICAL() around statsCntHistogramAdd() in tasks.
+ */
+#define STATS_CNT_HISTOGRAM_ADD_FROM_ISR(HISTOGRAM, VALUE) do { \
+    const UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR(); \
+    statsCntHistogramAdd((HISTOGRAM), (VALUE)); \
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus); \
+  } while (0)
+
+
 // Log module integration -------------------------------------------------------
 
 /**
@@ -80,7 +237,7 @@ typedef struct {
  */
 #define STATS_CNT_RATE_INIT(LOGGER, INTERVAL_MS) statsCntRateLoggerInit(LOGGER, INTERVAL_MS)
 
-#define STATS_CNT_RATE_DEFINE(NAME, INTERVAL_MS) statsCntRateLogger_t NAME = {.logByFunction = {.data = &NAME, .aquireFloat = statsCntRateLogHandler}, .rateCounter = {.intervalMs = (INTERVAL_MS), .count = 0, .latestCount = 0, .latestAveragingMs = 0, .latestRate = 0}}
+#define STATS_CNT_RATE_DEFINE(NAME, INTERVAL_MS) statsCntRateLogger_t NAME = {.logByFunction = {.data = &NAME, .aquireFloat = statsCntRateLogHandler, .minIntervalMs = (INTERVAL_MS)}, .rateCounter = {.intervalMs = (INTERVAL_MS), .count = 0, .latestCount = 0, .latestAveragingMs = 0, .latestRate = 0}}
 
 /**
  * @brief Macro to add an event to a statsCntRateLogger_t, that is to increase the internal counter
@@ -105,6 +262,37 @@ typedef struct {
  */
 #define STATS_CNT_RATE_LOG_ADD(NAME, LOGGER) LOG_ADD_BY_FUNCTION(LOG_FLOAT, NAME, LOGGER)
 
+/**
+ * @brief Macro to add the latest min, average, max and rate of a statsCntMinMaxAvg_t as
+ * logs named NAMEMin, NAMEAvg, NAMEMax and NAMERt. Used in a similar way as
+ * LOG_ADD() in a LOG_GROUP_START() - LOG_GROUP_STOP() block
+ *
+ * @param STATS A pointer to a statsCntMinMaxAvg_t
+ */
+#define STATS_CNT_MIN_MAX_AVG_LOG_ADD(NAME, STATS) \
+  LOG_ADD(LOG_UINT32, NAME##Min, &(STATS)->latestMin) \
+  LOG_ADD(LOG_FLOAT, NAME##Avg, &(STATS)->latestAvg) \
+  LOG_ADD(LOG_UINT32, NAME##Max, &(STATS)->latestMax) \
+  LOG_ADD(LOG_FLOAT, NAME##Rt, &(STATS)->latestRate)
+
+/**
+ * @brief Macro to add the latest bucket counts of a statsCntHistogram_t as logs named NAME0 to NAME9. Used in a
+ * similar way as LOG_ADD() in a LOG_GROUP_START() - LOG_GROUP_STOP() block
+ *
+ * @param HISTOGRAM A pointer to a statsCntHistogram_t
+ */
+#define STATS_CNT_HISTOGRAM_LOG_ADD(NAME, HISTOGRAM) \
+  LOG_ADD(LOG_UINT16, NAME##0, &(HISTOGRAM)->latest[0]) \
+  LOG_ADD(LOG_UINT16, NAME##1, &(HISTOGRAM)->latest[1]) \
+  LOG_ADD(LOG_UINT16, NAME##2, &(HISTOGRAM)->latest[2]) \
+  LOG_ADD(LOG_UINT16, NAME##3, &(HISTOGRAM)->latest[3]) \
+  LOG_ADD(LOG_UINT16, NAME##4, &(HISTOGRAM)->latest[4]) \
+  LOG_ADD(LOG_UINT16, NAME##5, &(HISTOGRAM)->latest[5]) \
+  LOG_ADD(LOG_UINT16, NAME##6, &(HISTOGRAM)->latest[6]) \
+  LOG_ADD(LOG_UINT16, NAME##7, &(HISTOGRAM)->latest[7]) \
+  LOG_ADD(LOG_UINT16, NAME##8, &(HISTOGRAM)->latest[8]) \
+  LOG_ADD(LOG_UINT16, NAME##9, &(HISTOGRAM)->latest[9])
+
 #ifdef CONFIG_DEBUG_LOG_ENABLE
 #define STATS_CNT_RATE_EVENT_DEBUG(LOGGER) STATS_CNT_RATE_EVENT(LOGGER)
 #define STATS_CNT_RATE_MULTI_EVENT_DEBUG(LOGGER, CNT) STATS_CNT_RATE_MULTI_EVENT(LOGGER, CNT)
@@ -0,0 +1,122 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * swarmTime.h - shared time base for a swarm, distributed by broadcast
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * The swarm time is a clock maintained by the client, [us] with an arbitrary epoch, that is broadcasted to all
+ * Crazyflies in a swarm. Each Crazyflie maps its local clock to the swarm time with an offset and a rate that are
+ * estimated from the received time stamps (an alpha-beta filter on the offset and the drift). All Crazyflies receive
+ * a broadcast at the same time, so the radio latency is common to the swarm and does not skew the time between
+ * Crazyflies.
+ */
+typedef struct {
+  bool isInitialized;
+
+  // The swarm time at local time refLocalUs, and the rate of the swarm clock relative to the local clock
+  uint64_t refLocalUs;
+  double refSwarmUs;
+  double rate;
+
+  uint32_t sampleCount;
+  uint8_t outlierCount;
+
+  // Statistics
+  float latestErrorUs;
+  uint32_t resyncCount;
+} swarmTime_t;
+
+// Max deviation between a received time stamp and the estimated swarm time [us], time stamps further away are
+// outliers
+#define SWARM_TIME_MAX_ERROR_US 20000
+// Number of consecutive outliers before starting over, for instance when the client has been restarted
+#define SWARM_TIME_MAX_OUTLIERS 3
+// Number of received time stamps before the swarm time is considered synchronized
+#define SWARM_TIME_MIN_SAMPLES 5
+// The swarm time is not considered synchronized if no time stamp has been received for this long [us]
+#define SWARM_TIME_MAX_AGE_US (30 * 1000 * 1000)
+// Max drift between the swarm clock and the local clock
+#define SWARM_TIME_MAX_DRIFT 500e-6
+
+/**
+ * @brief Initialize a swarmTime_t struct, the swarm time is unknown until the first update
+ *
+ * @param this The swarm time
+ */
+void swarmTimeInit(swarmTime_t* this);
+
+/**
+ * @brief Update the estimate with a received swarm time stamp
+ *
+ * @param this The swarm time
+ * @param swarmTimeUs The received swarm time stamp
+ * @param localTimeUs The local time when the time stamp was received
+ * @return true if the time stamp was accepted, false if it was an outlier
+ */
+bool swarmTimeUpdate(swarmTime_t* this, const uint64_t swarmTimeUs, const uint64_t localTimeUs);
+
+/**
+ * @brief Check if the swarm time is known well enough to be used
+ *
+ * @param this The swarm time
+ * @param localTimeUs The current local time
+ * @return true if synchronized
+ */
+bool swarmTimeIsSynchronized(const swarmTime_t* this, const uint64_t localTimeUs);
+
+/**
+ * @brief Convert a local time to swarm time
+ *
+ * @param this The swarm time
+ * @param localTimeUs Local time
+ * @return The swarm time [us]
+ */
+uint64_t swarmTimeFromLocal(const swarmTime_t* this, const uint64_t localTimeUs);
+
+/**
+ * @brief Convert a swarm time to local time
+ *
+ * @param this The swarm time
+ * @param swarmTimeUs Swarm time
+ * @return The local time [us]
+ */
+uint64_t swarmTimeToLocal(const swarmTime_t* this, const uint64_t swarmTimeUs);
+
+/**
+ * @brief Convert a truncated swarm time in ms, the lower 32 bits of the swarm time in ms, to local time. The
+ * truncated time is interpreted as the swarm time closest to the current time with the same lower bits, that is
+ * within +/- 24 days.
+ *
+ * @param this The swarm time
+ * @param swarmTimeMs Truncated swarm time [ms]
+ * @param localNowUs The current local time
+ * @return The local time [us]
+ */
+uint64_t swarmTimeToLocalFromMs(const swarmTime_t* this, const uint32_t swarmTimeMs, const uint64_t localNowUs);
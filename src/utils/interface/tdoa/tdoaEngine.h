@@ -11,23 +11,30 @@
 #define TDOA_ENGINE_MEASUREMENT_NOISE_STD 0.15f //Стандартное отклонение шума измерения TDoA. Зависит от конфигурации дальнобойности системы.
 #endif
 
+// Max number of measurements extracted from one packet in TdoaEngineMatchingAlgorithmAll
+#define TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET 8
+
 typedef void (*tdoaEngineSendTdoaToEstimator)(tdoaMeasurement_t* tdoaMeasurement);
 
 typedef enum {
   TdoaEngineMatchingAlgorithmNone = 0,
   TdoaEngineMatchingAlgorithmRandom,
   TdoaEngineMatchingAlgorithmYoungest,
+  TdoaEngineMatchingAlgorithmAll, // One measurement for every usable remote anchor in a packet
 } tdoaEngineMatchingAlgorithm_t; //Перечисление, определяющее алгоритм сопоставления якорей для вычисления TDoA.
 
 typedef struct {
   // State
-  tdaoAnchorInfoArray_t anchorInfoArray; // Массив, хранящий информацию о каждом обнаруженном якоре.
+  tdoaAnchorStorage_t anchorStorage; // Массив, хранящий информацию о каждом обнаруженном якоре.
   tdoaStats_t stats; // Структура, хранящая статистику работы движка TDOA.
 
 // Указатель на функцию, которая будет вызываться для отправки данных TDOA в модуль оценки местоположения.
   tdoaEngineSendTdoaToEstimator sendTdoaToEstimator; 
   double locodeckTsFreq; // Частота таймера Locodeck, используемого для измерения времени.
   tdoaEngineMatchingAlgorithm_t matchingAlgorithm; // Алгоритм сопоставления якорей для вычисления TDOA.
+  // Algorithm used to estimate the clock correction of each anchor. Not changed by tdoaEngineInit() to keep the
+  // setting when the LPS mode is switched, a zero initialized state uses clockCorrectionAlgorithmBucket.
+  clockCorrectionAlgorithm_t clockCorrectionAlgorithm;
 
   // Matching algorithm data
   struct {
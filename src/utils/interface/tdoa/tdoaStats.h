@@ -2,7 +2,9 @@
 #define __LPS_TDOA_STATS_H__
 
 #include <inttypes.h>
+#include <stddef.h>
 #include "statsCnt.h"
+#include "tdoaStorage.h"
 
 typedef struct {
   statsCntRateLogger_t packetsReceived;
@@ -36,4 +38,51 @@ typedef struct {
 void tdoaStatsInit(tdoaStats_t* tdoaStats, uint32_t now_ms);
 void tdoaStatsUpdate(tdoaStats_t* tdoaStats, uint32_t now_ms);
 
+
+// Link statistics table, with one entry for every anchor in the storage. Used to read the statistics of all anchors in
+// one go, for instance through the memory sub system.
+#define TDOA_STATS_LINK_TABLE_VERSION 1
+
+#define TDOA_STATS_LINK_FLAG_ACTIVE 0x01 // The anchor has been heard recently
+#define TDOA_STATS_LINK_FLAG_POSITION 0x02 // The anchor has a valid position
+#define TDOA_STATS_LINK_FLAG_CLOCK_CORRECTION 0x04 // The anchor has a clock correction
+
+typedef struct {
+  uint8_t formatVersion;
+  uint8_t entryCount;
+  uint8_t entrySize;
+  uint8_t reserved;
+  uint32_t timestamp; // System time [ms] when the table was created
+} __attribute__((packed)) tdoaStatsLinkTableHeader_t;
+
+typedef struct {
+  uint8_t id;
+  uint8_t flags; // TDOA_STATS_LINK_FLAG_...
+  uint8_t remoteRxCount; // Number of other anchors with valid rx times, as reported by the anchor
+  uint8_t remoteTofCount; // Number of other anchors with valid tofs, as reported by the anchor
+  uint16_t age; // Time since the latest packet [ms], saturated
+  uint16_t reserved;
+  float packetRate; // Received packets per second, 0 if not active
+  uint32_t packetCount; // Received packets
+  uint32_t lostPacketCount; // Packets lost, from gaps in the sequence numbers
+  uint32_t clockCorrectionAcceptedCount;
+  uint32_t clockCorrectionRejectedCount;
+  float clockCorrectionPpm; // The clock correction - 1, in ppm
+  float clockCorrectionJitterPpm; // Filtered change of the clock correction between packets, in ppm
+  uint32_t measurementCount; // TDoA measurements with this anchor sent to the estimator
+} __attribute__((packed)) tdoaStatsLinkTableEntry_t;
+
+#define TDOA_STATS_LINK_TABLE_MAX_SIZE (sizeof(tdoaStatsLinkTableHeader_t) + ANCHOR_STORAGE_COUNT * sizeof(tdoaStatsLinkTableEntry_t))
+
+/**
+ * @brief Write the link statistics of all anchors in the storage to a buffer, header first
+ *
+ * @param anchorStorage The anchor storage
+ * @param now_ms The current time
+ * @param buffer The destination
+ * @param bufferSize The size of the buffer, entries that do not fit are left out
+ * @return size_t The number of bytes written
+ */
+size_t tdoaStatsSerializeLinkTable(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms, uint8_t* buffer, const size_t bufferSize);
+
 #endif // __LPS_TDOA_STATS_H__
@@ -5,27 +5,59 @@
 #include "clockCorrectionEngine.h"
 #include "autoconf.h"
 
+#ifdef CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#define ANCHOR_STORAGE_COUNT CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#else
 #define ANCHOR_STORAGE_COUNT 16
+#endif
+
+// Max number of remote rx times and tofs stored per anchor
 #define REMOTE_ANCHOR_DATA_COUNT 16
 #define TOF_PER_ANCHOR_COUNT 16
 
+// Remote rx times and tofs are allocated from a pool shared by all anchors
+#ifdef CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_POOL_SIZE
+#define TDOA_STORAGE_REMOTE_ENTRY_COUNT CONFIG_DECK_LOCO_TDOA_REMOTE_DATA_POOL_SIZE
+#else
+#define TDOA_STORAGE_REMOTE_ENTRY_COUNT (ANCHOR_STORAGE_COUNT * 16)
+#endif
+
+#if ANCHOR_STORAGE_COUNT > 254
+  #error "Too large TDoA anchor storage"
+#endif
+
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
 #define TWR_HISTORY_LENGTH 32
 #define TWR_OUTLIER_TH 4
 #endif
 
-typedef struct {
-  uint8_t id; // Id of remote remote anchor
-  uint8_t seqNr; // Sequence number of the packet received in the remote anchor (7 bits)
-  int64_t rxTime; // Receive time of packet from anchor id in the remote anchor, in remote DWM clock
-  uint32_t endOfLife;
-} tdoaRemoteAnchorData_t;
+// Marks the end of a list of remote entries
+#define TDOA_STORAGE_NO_ENTRY 0xffff
 
+// Data about a remote anchor, stored for an anchor. Used both for the receive
+// time of packets from the remote anchor (in the anchor) and for the time of
+// flight between the anchors. Entries of an anchor are linked in a list.
 typedef struct {
-  uint8_t id;
-  int64_t tof;
-  uint32_t endOfLife; // Time stamp when the tof data is outdated, local system time in ms
-} tdoaTimeOfFlight_t;
+  int64_t value; // Receive time in remote DWM clock, or tof
+  uint32_t endOfLife; // Time stamp when the data is outdated, local system time in ms
+  uint16_t next; // Next entry in the list, or TDOA_STORAGE_NO_ENTRY
+  uint8_t id; // Id of remote anchor
+  uint8_t seqNr; // Sequence number of the packet received in the remote anchor (7 bits), not used for tof
+} tdoaRemoteEntry_t;
+
+// Link statistics for an anchor, used for network planning. Reset when the anchor is added to the storage.
+typedef struct {
+  uint32_t packetCount; // Received packets
+  uint32_t lostPacketCount; // Packets lost, from gaps in the sequence numbers
+  uint32_t clockCorrectionAcceptedCount; // Packets where the clock correction sample was reliable
+  uint32_t clockCorrectionRejectedCount; // Packets where the clock correction sample was not reliable
+  float clockCorrectionJitter; // Low pass filtered change of the clock correction between packets
+  uint32_t measurementCount; // TDoA measurements with this anchor sent to the estimator
+
+  float packetRate; // Received packets per second
+  uint32_t rateStartTime; // Start of the current packet rate period
+  uint32_t rateStartPacketCount;
+} tdoaAnchorLinkStats_t;
 
 typedef struct {
   bool isInitialized;
@@ -40,8 +72,12 @@ typedef struct {
 
   point_t position; // The coordinates of the anchor
 
-  tdoaTimeOfFlight_t remoteTof[TOF_PER_ANCHOR_COUNT];
-  tdoaRemoteAnchorData_t remoteAnchorData[REMOTE_ANCHOR_DATA_COUNT];
+  tdoaAnchorLinkStats_t linkStats;
+
+  uint16_t remoteRxList; // First entry with remote rx data
+  uint16_t remoteTofList; // First entry with tof data
+  uint8_t remoteRxCount;
+  uint8_t remoteTofCount;
 
   #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
   uint64_t tof;
@@ -49,24 +85,47 @@ typedef struct {
   #endif
 } tdoaAnchorInfo_t;
 
-typedef tdoaAnchorInfo_t tdaoAnchorInfoArray_t[ANCHOR_STORAGE_COUNT];
+// Marks an unused entry in the id map and the ends of the recency list
+#define TDOA_STORAGE_NO_SLOT 0xff
+
+// Anchor storage with an id to slot map for constant time look ups, and the
+// slots linked in order of last update time, youngest first. The list is used
+// for eviction (oldest slot) and for finding recently updated anchors.
+typedef struct {
+  tdoaAnchorInfo_t anchorInfo[ANCHOR_STORAGE_COUNT];
+  uint8_t slotById[256]; // Slot for each anchor id, or TDOA_STORAGE_NO_SLOT
+  uint8_t olderSlot[ANCHOR_STORAGE_COUNT]; // Next slot towards the oldest end of the list
+  uint8_t youngerSlot[ANCHOR_STORAGE_COUNT]; // Next slot towards the youngest end of the list
+  uint8_t youngestSlot;
+  uint8_t oldestSlot;
+  uint8_t slotsInUse;
+
+  tdoaRemoteEntry_t remoteEntries[TDOA_STORAGE_REMOTE_ENTRY_COUNT];
+  uint16_t freeEntryList;
+  uint16_t remoteEntriesInUse;
+} tdoaAnchorStorage_t;
 
 
 // The anchor context is used to pass information about an anchor as well as
 // the current time to functions.
 // The context should not be stored.
 typedef struct {
+  tdoaAnchorStorage_t* storage;
   tdoaAnchorInfo_t* anchorInfo;
   uint32_t currentTime_ms;
 } tdoaAnchorContext_t;
 
 
-void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]);
+void tdoaStorageInitialize(tdoaAnchorStorage_t* anchorStorage);
+
+bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+bool tdoaStorageGetAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize);
+uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms);
 
-bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
-bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
-uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize);
-uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms);
+// Iterate over the anchors in storage, youngest (most recently updated) first
+bool tdoaStorageGetYoungestAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+bool tdoaStorageGetNextOlderAnchorCtx(tdoaAnchorContext_t* anchorCtx);
 
 uint8_t tdoaStorageGetId(const tdoaAnchorContext_t* anchorCtx);
 int64_t tdoaStorageGetRxTime(const tdoaAnchorContext_t* anchorCtx);
@@ -84,6 +143,9 @@ void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t re
 void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* remoteCount, uint8_t seqNr[], uint8_t id[]);
 int64_t tdoaStorageGetRemoteTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor);
 void tdoaStorageSetRemoteTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof);
+tdoaAnchorLinkStats_t* tdoaStorageGetLinkStats(const tdoaAnchorContext_t* anchorCtx);
+// Number of remote anchors with valid rx times and tofs
+void tdoaStorageGetValidRemoteCounts(const tdoaAnchorContext_t* anchorCtx, uint8_t* rxCount, uint8_t* tofCount);
 
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
 int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint32_t oldestAcceptableTime_ms);
@@ -91,6 +153,6 @@ void tdoaStorageSetTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const int64_t to
 #endif
 
 // Mainly for test
-bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor);
+bool tdoaStorageIsAnchorInStorage(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor);
 
 #endif // __TDOA_STORAGE_H__
@@ -0,0 +1,92 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * toc_blob.h - Serialized log or param TOC, read in chunks through the mem subsystem
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A TOC blob is the whole log or param TOC serialized to a byte stream that a client can fetch with a few large memory
+ * reads instead of one CRTP round trip per entry. The blob is never stored, bytes are produced from the TOC when
+ * they are read. Reads are expected to be mostly sequential, so the position of the last read is cached.
+ *
+ * Format:
+ *   uint8 version, uint16 number of entries, uint32 TOC CRC
+ *   per entry, in id order: uint8 type, group name\0, name\0
+ * The group name is empty when it is the same as for the previous entry.
+ */
+
+#define TOC_BLOB_VERSION 1
+#define TOC_BLOB_HEADER_SIZE 7
+#define TOC_BLOB_MAX_ENTRY_SIZE 32
+
+/**
+ * @brief Serialize the TOC entry with the given number
+ *
+ * @param entry The entry number, including group markers
+ * @param buffer Buffer of at least TOC_BLOB_MAX_ENTRY_SIZE bytes
+ * @return Number of bytes written, 0 for entries that are not variables
+ */
+typedef uint8_t (*tocBlobEncode_t)(const int entry, uint8_t* buffer);
+
+typedef struct {
+  tocBlobEncode_t encode;
+  int entriesLen;
+  uint32_t size;
+  uint8_t header[TOC_BLOB_HEADER_SIZE];
+
+  // Position of the last read
+  int cursorEntry;
+  uint32_t cursorAddress;
+} tocBlob_t;
+
+/**
+ * @brief Initialize a blob and calculate its size
+ *
+ * @param blob The blob
+ * @param entriesLen Number of TOC entries, including group markers
+ * @param count Number of variables in the TOC
+ * @param crc CRC of the TOC
+ * @param encode Function serializing one entry
+ */
+void tocBlobInit(tocBlob_t* blob, const int entriesLen, const uint16_t count, const uint32_t crc, tocBlobEncode_t encode);
+
+/**
+ * @brief Size of the blob in bytes
+ */
+uint32_t tocBlobGetSize(const tocBlob_t* blob);
+
+/**
+ * @brief Read a part of the blob
+ *
+ * @param blob The blob
+ * @param address Start address in the blob
+ * @param length Number of bytes to read
+ * @param buffer Filled with the data
+ * @return false if the read is outside of the blob
+ */
+bool tocBlobRead(tocBlob_t* blob, const uint32_t address, const uint8_t length, uint8_t* buffer);
@@ -0,0 +1,90 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * toc_index.h - Hash index over the (group, name) pairs of a log or param TOC
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Open addressing hash table used to find log and param TOC entries by group and name without walking the whole TOC.
+ * The index is built at init time in a slot array provided by the owner. The index only stores entry numbers, the
+ * owner provides a match function that checks an entry against the group and name that are looked up.
+ *
+ * If more entries are added than the index can hold with a reasonable load factor, adding fails and the owner should
+ * fall back to a linear search of the TOC.
+ */
+
+typedef struct {
+  // Entry number + 1, 0 for an empty slot
+  uint16_t entry;
+  // Owner defined data stored with the entry, for instance the TOC id
+  uint16_t data;
+} tocIndexSlot_t;
+
+typedef struct {
+  tocIndexSlot_t* slots;
+  uint16_t mask;
+  uint16_t count;
+} tocIndex_t;
+
+/**
+ * @brief Returns true if TOC entry matches the group and name
+ */
+typedef bool (*tocIndexMatch_t)(const uint16_t entry, const char* group, const char* name);
+
+/**
+ * @brief Initialize an empty index
+ *
+ * @param index The index
+ * @param slots Slot storage
+ * @param size Number of slots, must be a power of two
+ */
+void tocIndexInit(tocIndex_t* index, tocIndexSlot_t* slots, const uint16_t size);
+
+/**
+ * @brief Add an entry to the index
+ *
+ * @param index The index
+ * @param group Group name of the entry, "" if none
+ * @param name Name of the entry
+ * @param entry The entry number, less than 0xffff
+ * @param data Owner defined data returned by tocIndexFind()
+ * @return false if the index is full
+ */
+bool tocIndexAdd(tocIndex_t* index, const char* group, const char* name, const uint16_t entry, const uint16_t data);
+
+/**
+ * @brief Find an entry in the index
+ *
+ * @param index The index
+ * @param group Group name to look up
+ * @param name Name to look up
+ * @param match Function checking candidate entries against group and name
+ * @param data Set to the data stored with the entry if found, may be NULL
+ * @return The entry number, or -1 if not found
+ */
+int tocIndexFind(const tocIndex_t* index, const char* group, const char* name, tocIndexMatch_t match, uint16_t* data);
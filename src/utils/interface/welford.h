@@ -0,0 +1,59 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * welford.h - Streaming mean and variance, O(1) per sample
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Mean and variance of a stream of samples, using Welford's algorithm. Each
+ * sample is added in constant time and without storing it, and the result is
+ * numerically stable also for large offsets, such as a gyro bias.
+ *
+ * To get the statistics over windows of N samples, read the result and
+ * re-initialize when count reaches N.
+ */
+typedef struct {
+  uint32_t count;
+  float mean;
+  // Sum of squared differences to the mean
+  float m2;
+} welford_t;
+
+void welfordInit(welford_t* w);
+
+void welfordAdd(welford_t* w, const float value);
+
+/**
+ * @brief Mean of the samples added since init, 0 if there are no samples
+ */
+float welfordMean(const welford_t* w);
+
+/**
+ * @brief Population variance of the samples added since init, 0 with less
+ * than two samples
+ */
+float welfordVariance(const welford_t* w);
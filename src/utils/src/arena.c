@@ -0,0 +1,57 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * arena.c - Bump allocator for pools that are sized at runtime
+ */
+
+#include "arena.h"
+
+#include <string.h>
+
+void arenaInit(arena_t* arena, void* memory, const size_t size) {
+  arena->memory = memory;
+  arena->size = size;
+  arena->used = 0;
+
+  // Start at an aligned address, the bytes before it are lost
+  const size_t misalignment = (uintptr_t)memory % ARENA_ALIGNMENT;
+  if (misalignment != 0) {
+    arena->used = ARENA_ALIGNMENT - misalignment;
+    if (arena->used > size) {
+      arena->used = size;
+    }
+  }
+}
+
+void* arenaAlloc(arena_t* arena, const size_t size) {
+  const size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  if (size == 0 || aligned < size || aligned > arenaGetFree(arena)) {
+    return NULL;
+  }
+
+  void* result = arena->memory + arena->used;
+  arena->used += aligned;
+  memset(result, 0, size);
+
+  return result;
+}
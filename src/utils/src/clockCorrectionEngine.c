@@ -25,6 +25,16 @@
 // коррекции часов. Чем больше значение, тем медленнее меняется опорная коррекция.
 #define CLOCK_CORRECTION_BUCKET_MAX 4
 
+// Forgetting factor of the least squares fit, the fit is effectively based on the
+// latest 1 / (1 - factor) samples. Lets the estimate track slow drift, for instance due to temperature.
+#define CLOCK_CORRECTION_LS_FORGETTING 0.98
+// Number of samples in the fit before the result is considered reliable
+#define CLOCK_CORRECTION_LS_MIN_SAMPLES 3
+// Max deviation between a sample and the fit [reference clock ticks], samples further away are outliers
+#define CLOCK_CORRECTION_LS_MAX_RESIDUAL 1000.0
+// Number of consecutive outliers before the fit is restarted, for instance when an anchor has been restarted
+#define CLOCK_CORRECTION_LS_MAX_OUTLIERS CLOCK_CORRECTION_BUCKET_MAX
+
 /**
  Логирование всей информации о коррекции часов требует многократного масштабирования значений, 
  что является интенсивной вычислительной операцией. 
@@ -245,6 +255,81 @@ bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double
   return sampleIsReliable;
 }
 
+static void restartLeastSquares(clockCorrectionStorage_t* storage, const double dx, const double dy) {
+  // The previous and the latest samples are both in the fit, with the origin at the latest sample
+  storage->lsWeight = 2.0;
+  storage->lsMeanX = -dx / 2.0;
+  storage->lsMeanY = -dy / 2.0;
+  storage->lsCovXX = dx * dx / 2.0;
+  storage->lsCovXY = dx * dy / 2.0;
+  storage->lsSampleCount = 2;
+  storage->lsOutlierCount = 0;
+
+  storage->clockCorrection = dy / dx;
+}
+
+static void handleLeastSquaresOutlier(clockCorrectionStorage_t* storage) {
+  storage->lsOutlierCount++;
+  if (storage->lsOutlierCount > CLOCK_CORRECTION_LS_MAX_OUTLIERS) {
+    // The fit does not match the clock any more, start over with the next sample
+    storage->lsSampleCount = 0;
+    storage->lsOutlierCount = 0;
+  }
+}
+
+bool clockCorrectionEngineUpdateLeastSquares(clockCorrectionStorage_t* storage, const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask) {
+  const double dy = (double)truncateTimeStamp(new_t_in_cl_reference - old_t_in_cl_reference, mask);
+  const double dx = (double)truncateTimeStamp(new_t_in_cl_x - old_t_in_cl_x, mask);
+  if (dx == 0.0) {
+    return false;
+  }
+
+  // Move the origin to the latest sample. This is done for all samples, also outliers, as the time stamps of the
+  // latest sample are used as the previous sample in the next call. Errors in a time stamp cancel out in the next call.
+  storage->lsMeanX -= dx;
+  storage->lsMeanY -= dy;
+
+  const double candidate = dy / dx;
+  if (candidate <= CLOCK_CORRECTION_SPEC_MIN || CLOCK_CORRECTION_SPEC_MAX <= candidate) {
+    handleLeastSquaresOutlier(storage);
+    return false;
+  }
+
+  if (storage->lsSampleCount == 0) {
+    restartLeastSquares(storage, dx, dy);
+    return false;
+  }
+
+  // Deviation of the new sample (at the origin) from the current fit
+  const double residual = storage->clockCorrection * storage->lsMeanX - storage->lsMeanY;
+  if (storage->lsSampleCount >= CLOCK_CORRECTION_LS_MIN_SAMPLES && (residual < -CLOCK_CORRECTION_LS_MAX_RESIDUAL || CLOCK_CORRECTION_LS_MAX_RESIDUAL < residual)) {
+    handleLeastSquaresOutlier(storage);
+    return false;
+  }
+
+  // Weighted Welford update, the new sample is at (0, 0)
+  storage->lsWeight = storage->lsWeight * CLOCK_CORRECTION_LS_FORGETTING + 1.0;
+  const double errorX = -storage->lsMeanX;
+  storage->lsMeanX += errorX / storage->lsWeight;
+  storage->lsMeanY += -storage->lsMeanY / storage->lsWeight;
+  storage->lsCovXX = storage->lsCovXX * CLOCK_CORRECTION_LS_FORGETTING + errorX * -storage->lsMeanX;
+  storage->lsCovXY = storage->lsCovXY * CLOCK_CORRECTION_LS_FORGETTING + errorX * -storage->lsMeanY;
+
+  storage->lsOutlierCount = 0;
+  if (storage->lsSampleCount < UINT16_MAX) {
+    storage->lsSampleCount++;
+  }
+
+  if (storage->lsCovXX > 0.0) {
+    const double slope = storage->lsCovXY / storage->lsCovXX;
+    if (CLOCK_CORRECTION_SPEC_MIN < slope && slope < CLOCK_CORRECTION_SPEC_MAX) {
+      storage->clockCorrection = slope;
+    }
+  }
+
+  return storage->lsSampleCount >= CLOCK_CORRECTION_LS_MIN_SAMPLES;
+}
+
 // Определяет группу логов для коррекции часов
 #ifdef CLOCK_CORRECTION_ENABLE_LOGGING
 LOG_GROUP_START(CkCorrection)
@@ -0,0 +1,123 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * dshotTelemetry.c - decoding of bidirectional DSHOT telemetry
+ */
+
+#include "dshotTelemetry.h"
+
+#define GCR_INVALID 0xFF
+
+// 5 bit GCR code to 4 bit nibble
+static const uint8_t gcrDecode[32] = {
+  GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID,
+  GCR_INVALID, 0x9, 0xA, 0xB, GCR_INVALID, 0xD, 0xE, 0xF,
+  GCR_INVALID, GCR_INVALID, 0x2, 0x3, GCR_INVALID, 0x5, 0x6, 0x7,
+  GCR_INVALID, 0x0, 0x8, 0x1, GCR_INVALID, 0x4, 0xC, GCR_INVALID,
+};
+
+// The GCR code has at most two zeros in a row
+#define MAX_BITS_PER_RUN 3
+
+bool dshotTelemetryDecodeFrame(const uint32_t frame, uint16_t* value) {
+  uint32_t decoded = 0;
+  for (int i = 0; i < 4; i++) {
+    const uint8_t nibble = gcrDecode[(frame >> (5 * i)) & 0x1f];
+    if (nibble == GCR_INVALID) {
+      return false;
+    }
+    decoded |= nibble << (4 * i);
+  }
+
+  // The checksum is the inverted xor of the nibbles
+  uint32_t checksum = decoded ^ (decoded >> 8);
+  checksum ^= checksum >> 4;
+  if ((checksum & 0xf) != 0xf) {
+    return false;
+  }
+
+  *value = decoded >> 4;
+  return true;
+}
+
+uint32_t dshotTelemetryToErpm(const uint16_t value) {
+  if (value == 0x0fff) {
+    return 0;
+  }
+
+  const uint32_t periodUs = (value & 0x01ff) << ((value & 0x0e00) >> 9);
+  if (periodUs == 0) {
+    return 0;
+  }
+
+  return (60 * 1000000 + periodUs / 2) / periodUs;
+}
+
+bool dshotTelemetryDecodeSamples(const uint16_t* samples, const int count, const int start, const uint16_t pinMask, const float samplesPerBit, uint16_t* value) {
+  // Find the idle line and the falling edge of the start bit
+  int i = start;
+  while (i < count && (samples[i] & pinMask) == 0) {
+    i++;
+  }
+  while (i < count && (samples[i] & pinMask) != 0) {
+    i++;
+  }
+  if (i >= count) {
+    return false;
+  }
+
+  uint32_t frame = 0;
+  int bits = 0;
+  int edge = i;
+  uint16_t level = 0;
+  for (i = i + 1; i < count && bits < DSHOT_TELEMETRY_FRAME_BITS; i++) {
+    if ((samples[i] & pinMask) != level) {
+      const int len = (int)((i - edge) / samplesPerBit + 0.5f);
+      if (len < 1 || len > MAX_BITS_PER_RUN) {
+        return false;
+      }
+
+      frame = (frame << len) | (1 << (len - 1));
+      bits += len;
+      edge = i;
+      level ^= pinMask;
+    }
+  }
+
+  // The last run, the line stays high after the frame if it ends high
+  if (bits < DSHOT_TELEMETRY_FRAME_BITS) {
+    const int len = DSHOT_TELEMETRY_FRAME_BITS - bits;
+    if (len > MAX_BITS_PER_RUN || (i - edge) < (int)(len * samplesPerBit - samplesPerBit / 2)) {
+      return false;
+    }
+    frame = (frame << len) | (1 << (len - 1));
+    bits += len;
+  }
+
+  if (bits != DSHOT_TELEMETRY_FRAME_BITS) {
+    return false;
+  }
+
+  return dshotTelemetryDecodeFrame(frame, value);
+}
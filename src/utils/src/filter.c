@@ -107,3 +107,141 @@ float lpf2pReset(lpf2pData* lpfData, float sample)
   lpfData->delay_element_2 = dval;
   return lpf2pApply(lpfData, sample);
 }
+
+/**
+ * Biquad filter bank
+ */
+static void biquadBankSetCoefficients(biquadBank_t* bank, uint8_t channel, float b0, float b1, float b2, float a1, float a2)
+{
+  bank->b0[channel] = b0;
+  bank->b1[channel] = b1;
+  bank->b2[channel] = b2;
+  bank->a1[channel] = a1;
+  bank->a2[channel] = a2;
+}
+
+static void biquadBankInit(biquadBank_t* bank, uint8_t channels)
+{
+  if (channels > BIQUAD_BANK_MAX_CHANNELS) {
+    channels = BIQUAD_BANK_MAX_CHANNELS;
+  }
+  bank->channels = channels;
+
+  const float zero[BIQUAD_BANK_MAX_CHANNELS] = {0};
+  biquadBankReset(bank, zero);
+}
+
+void biquadBankInitLowPass(biquadBank_t* bank, uint8_t channels, float sampleFreq, float cutoffFreq)
+{
+  biquadBankInit(bank, channels);
+  for (int i = 0; i < bank->channels; i++) {
+    biquadBankSetLowPass(bank, i, sampleFreq, cutoffFreq);
+  }
+}
+
+void biquadBankInitNotch(biquadBank_t* bank, uint8_t channels, float sampleFreq, float centerFreq, float q)
+{
+  biquadBankInit(bank, channels);
+  for (int i = 0; i < bank->channels; i++) {
+    biquadBankSetNotch(bank, i, sampleFreq, centerFreq, q);
+  }
+}
+
+void biquadBankSetLowPass(biquadBank_t* bank, uint8_t channel, float sampleFreq, float cutoffFreq)
+{
+  if (cutoffFreq <= 0.0f) {
+    biquadBankSetCoefficients(bank, channel, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    return;
+  }
+
+  // Same filter as lpf2pSetCutoffFreq()
+  float ohm = tanf(M_PI_F * cutoffFreq / sampleFreq);
+  float c = 1.0f + 2.0f * cosf(M_PI_F / 4.0f) * ohm + ohm * ohm;
+  float b0 = ohm * ohm / c;
+  biquadBankSetCoefficients(bank, channel, b0, 2.0f * b0, b0,
+    2.0f * (ohm * ohm - 1.0f) / c,
+    (1.0f - 2.0f * cosf(M_PI_F / 4.0f) * ohm + ohm * ohm) / c);
+}
+
+void biquadBankSetNotch(biquadBank_t* bank, uint8_t channel, float sampleFreq, float centerFreq, float q)
+{
+  float w0 = 2.0f * M_PI_F * centerFreq / sampleFreq;
+  biquadBankSetNotchCosSin(bank, channel, cosf(w0), sinf(w0), q);
+}
+
+void biquadBankSetNotchCosSin(biquadBank_t* bank, uint8_t channel, float cosW0, float sinW0, float q)
+{
+  float alpha = sinW0 / (2.0f * q);
+  float a0Inv = 1.0f / (1.0f + alpha);
+  float b1 = -2.0f * cosW0 * a0Inv;
+  biquadBankSetCoefficients(bank, channel, a0Inv, b1, a0Inv, b1, (1.0f - alpha) * a0Inv);
+}
+
+void biquadBankReset(biquadBank_t* bank, const float* values)
+{
+  for (int i = 0; i < bank->channels; i++) {
+    bank->x1[i] = values[i];
+    bank->x2[i] = values[i];
+    bank->y1[i] = values[i];
+    bank->y2[i] = values[i];
+  }
+}
+
+void biquadBankApply(biquadBank_t* bank, float* samples)
+{
+  for (int i = 0; i < bank->channels; i++) {
+    const float x = samples[i];
+    float y = bank->b0[i] * x + bank->b1[i] * bank->x1[i] + bank->b2[i] * bank->x2[i]
+            - bank->a1[i] * bank->y1[i] - bank->a2[i] * bank->y2[i];
+    if (!isfinite(y)) {
+      // don't allow bad values to propagate via the filter
+      y = x;
+    }
+
+    bank->x2[i] = bank->x1[i];
+    bank->x1[i] = x;
+    bank->y2[i] = bank->y1[i];
+    bank->y1[i] = y;
+    samples[i] = y;
+  }
+}
+
+void biquadBankApplyDifferentiate(biquadBank_t* bank, float* samples, uint8_t diffChannels, float sampleFreq, float* derivative)
+{
+  for (int i = 0; i < bank->channels; i++) {
+    const float x = samples[i];
+    const float yPrevious = bank->y1[i];
+    float y = bank->b0[i] * x + bank->b1[i] * bank->x1[i] + bank->b2[i] * bank->x2[i]
+            - bank->a1[i] * yPrevious - bank->a2[i] * bank->y2[i];
+    if (!isfinite(y)) {
+      // don't allow bad values to propagate via the filter
+      y = x;
+    }
+
+    bank->x2[i] = bank->x1[i];
+    bank->x1[i] = x;
+    bank->y2[i] = yPrevious;
+    bank->y1[i] = y;
+    samples[i] = y;
+
+    if (i < diffChannels) {
+      derivative[i] = (y - yPrevious) * sampleFreq;
+    }
+  }
+}
+
+void goertzelInit(goertzel_t* goertzel, uint32_t bin, uint32_t length) {
+  goertzel->coeff = 2.0f * cosf(2.0f * M_PI_F * bin / length);
+  goertzel->s1 = 0.0f;
+  goertzel->s2 = 0.0f;
+  goertzel->count = 0;
+}
+
+float goertzelAmplitude(const goertzel_t* goertzel) {
+  if (goertzel->count == 0) {
+    return 0.0f;
+  }
+
+  const float power = goertzel->s1 * goertzel->s1 + goertzel->s2 * goertzel->s2 - goertzel->coeff * goertzel->s1 * goertzel->s2;
+  return 2.0f * sqrtf(fmaxf(power, 0.0f)) / goertzel->count;
+}
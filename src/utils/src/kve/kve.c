@@ -1,6 +1,7 @@
 
 #include "kve/kve.h"
 #include "kve/kve_storage.h"
+#include "kve/kve_index.h"
 
 #include "debug.h"
 
@@ -24,9 +25,39 @@ static size_t min(size_t a, size_t b)
     }
 }
 
-// Utility function
+// Utility functions
+static size_t findItemByKey(kveMemory_t *kve, const char* key) {
+    if (kveIndexIsValid(kve, FIRST_ITEM_ADDRESS)) {
+        return kveIndexFind(kve, key);
+    }
+    return kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+}
+
+static size_t findEnd(kveMemory_t *kve, size_t address) {
+    if (kveIndexIsValid(kve, FIRST_ITEM_ADDRESS)) {
+        return kve->index->endAddress;
+    }
+    return kveStorageFindEnd(kve, address);
+}
+
+static void writeItemAndEnd(kveMemory_t *kve, size_t itemAddress, const char* key, const void* buffer, size_t length) {
+    size_t endAddress = itemAddress + kveStorageWriteItem(kve, itemAddress, key, buffer, length);
+    kveStorageWriteEnd(kve, endAddress);
+
+    kveIndexAdd(kve, key, itemAddress);
+    if (kve->index) {
+        kve->index->endAddress = endAddress;
+    }
+}
+
+static void markHole(kveMemory_t *kve, size_t address) {
+    if (address < kve->defragAddress) {
+        kve->defragAddress = address;
+    }
+}
+
 static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, const void* buffer, size_t length) {
-    size_t itemAddress = kveStorageFindEnd(kve, address);
+    size_t itemAddress = findEnd(kve, address);
 
     // If it is over the end of the memory, table corrupted
     // Do not write anything ...
@@ -37,17 +68,15 @@ static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, c
 
     // Test that there is enough space to write the item
     if ((itemAddress + sizeof(kveItemHeader_t) + strlen(key) + length + KVE_END_TAG_LENDTH) < kve->memorySize) {
-        itemAddress += kveStorageWriteItem(kve, itemAddress, key, buffer, length);
-        kveStorageWriteEnd(kve, itemAddress);
+        writeItemAndEnd(kve, itemAddress, key, buffer, length);
     } else {
         // Otherwise, defrag and try to insert again!
         kveDefrag(kve);
 
-        itemAddress = kveStorageFindEnd(kve, FIRST_ITEM_ADDRESS);
+        itemAddress = findEnd(kve, FIRST_ITEM_ADDRESS);
 
         if ((itemAddress + sizeof(kveItemHeader_t) + strlen(key) + length + KVE_END_TAG_LENDTH) < kve->memorySize) {
-            itemAddress += kveStorageWriteItem(kve, itemAddress, key, buffer, length);
-            kveStorageWriteEnd(kve, itemAddress);
+            writeItemAndEnd(kve, itemAddress, key, buffer, length);
         } else {
             // Memory full!
             DEBUG_PRINT("Error: memory full!");
@@ -89,13 +118,61 @@ void kveDefrag(kveMemory_t *kve) {
 
         holeAddress = holeAddress + lenghtToMove;
     }
+
+    // Items have moved
+    kveIndexInvalidate(kve);
+    kve->defragAddress = FIRST_ITEM_ADDRESS;
+}
+
+bool kveDefragStep(kveMemory_t *kve) {
+    static char keyBuffer[256];
+    size_t startAddress = kve->defragAddress;
+    if (startAddress < FIRST_ITEM_ADDRESS) {
+        startAddress = FIRST_ITEM_ADDRESS;
+    }
+
+    size_t holeAddress = kveStorageFindHole(kve, startAddress);
+
+    if (KVE_STORAGE_IS_VALID(holeAddress) == false) {
+        return false;
+    }
+
+    kveItemHeader_t hole = kveStorageGetItemInfo(kve, holeAddress);
+    if (hole.full_length == KVE_END_TAG) {
+        // No hole before the end of the table
+        kve->defragAddress = holeAddress;
+        return false;
+    }
+
+    size_t itemAddress = kveStorageFindNextItem(kve, holeAddress);
+    if (KVE_STORAGE_IS_VALID(itemAddress) == false) {
+        // This hole is at the end, lets crop it
+        kveStorageWriteEnd(kve, holeAddress);
+        if (kve->index) {
+            kve->index->endAddress = holeAddress;
+        }
+        kve->defragAddress = holeAddress;
+        return true;
+    }
+
+    kveItemHeader_t item = kveStorageGetItemInfo(kve, itemAddress);
+    kveStorageGetKey(kve, itemAddress, item, keyBuffer, item.key_length);
+    keyBuffer[item.key_length] = 0;
+
+    kveIndexRemove(kve, keyBuffer, itemAddress);
+    kveStorageMoveMemory(kve, itemAddress, holeAddress, item.full_length);
+    kveStorageWriteHole(kve, holeAddress + item.full_length, itemAddress - holeAddress);
+    kveIndexAdd(kve, keyBuffer, holeAddress);
+
+    kve->defragAddress = holeAddress + item.full_length;
+    return true;
 }
 
 bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t length) {
     size_t itemAddress;
 
     // Search if the key is already present in the table
-    itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    itemAddress = findItemByKey(kve, key);
     if (KVE_STORAGE_IS_VALID(itemAddress) == false) {
         // Item does not exit, find the end of the table to insert it
         return appendItemToEnd(kve, FIRST_ITEM_ADDRESS, key, buffer, length);
@@ -105,7 +182,9 @@ bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t leng
         uint16_t newLength = length + 3 + strlen(key);
         if (currentItem.full_length != newLength) {
             // If not, delete the item and find the end of the table
+            kveIndexRemove(kve, key, itemAddress);
             kveStorageWriteHole(kve, itemAddress, currentItem.full_length);
+            markHole(kve, itemAddress);
             return appendItemToEnd(kve, FIRST_ITEM_ADDRESS, key, buffer, length);
         } else {
             kveStorageWriteItem(kve, itemAddress, key, buffer, length);
@@ -157,7 +236,7 @@ bool kveForeach(kveMemory_t *kve, const char *prefix, kveFunc_t func)
 
 size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLength)
 {
-    size_t itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    size_t itemAddress = findItemByKey(kve, key);
 
     if (KVE_STORAGE_IS_VALID(itemAddress)) {
         kveItemHeader_t header = kveStorageGetItemInfo(kve, itemAddress);
@@ -169,11 +248,13 @@ size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLe
 }
 
 bool kveDelete(kveMemory_t *kve, const char* key) {
-    size_t itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    size_t itemAddress = findItemByKey(kve, key);
 
     if (KVE_STORAGE_IS_VALID(itemAddress)) {
         kveItemHeader_t itemInfo = kveStorageGetItemInfo(kve, itemAddress);
+        kveIndexRemove(kve, key, itemAddress);
         kveStorageWriteHole(kve, itemAddress, itemInfo.full_length);
+        markHole(kve, itemAddress);
         return true;
     }
 
@@ -184,6 +265,8 @@ void kveFormat(kveMemory_t *kve) {
     uint8_t version = KVE_VERSION;
     kve->write(VERSION_ADDRESS, &version, 1);
     kveStorageWriteEnd(kve, FIRST_ITEM_ADDRESS);
+    kveIndexInvalidate(kve);
+    kve->defragAddress = FIRST_ITEM_ADDRESS;
 }
 
 bool kveCheck(kveMemory_t *kve) {
@@ -252,4 +335,13 @@ void kveGetStats(kveMemory_t *kve, kveStats_t *stats) {
     stats->freeSpace = kve->memorySize - item_size;
     stats->fragmentation = (hole_size * 100) / (kve->memorySize - item_size);
     stats->spaceLeftUntilForcedDefrag = kve->memorySize - total_size;
+
+    stats->indexSize = 0;
+    stats->indexItems = 0;
+    if (kve->index) {
+        stats->indexSize = kve->index->size * sizeof(kveIndexSlot_t);
+        if (kveIndexIsValid(kve, FIRST_ITEM_ADDRESS)) {
+            stats->indexItems = kve->index->count;
+        }
+    }
 }
@@ -0,0 +1,185 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * kve_index.c - RAM index of the key addresses in a kve table
+ *
+ */
+
+#include "kve/kve_index.h"
+#include "kve/kve_storage.h"
+
+#include <string.h>
+
+#define KVE_INDEX_EMPTY (0x0000u)
+#define KVE_INDEX_DELETED (0xffffu)
+
+// FNV-1a, folded to 16 bits
+static uint16_t hashKey(const char *key)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *c = key; *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    return (hash >> 16) ^ (hash & 0xffff);
+}
+
+static bool keyMatches(kveMemory_t *kve, size_t address, const char *key)
+{
+    static char keyBuffer[255];
+
+    kveItemHeader_t header = kveStorageGetItemInfo(kve, address);
+    size_t keyLength = strlen(key);
+    if (header.key_length != keyLength) {
+        return false;
+    }
+
+    kveStorageGetKey(kve, address, header, keyBuffer, keyLength);
+    return memcmp(key, keyBuffer, keyLength) == 0;
+}
+
+static bool insert(kveIndex_t *index, uint16_t hash, size_t address)
+{
+    // Keep the load factor below 75% for short probe sequences
+    if ((index->used + 1) * 4 > index->size * 3 || address >= KVE_INDEX_DELETED) {
+        return false;
+    }
+
+    const uint16_t mask = index->size - 1;
+    for (uint16_t i = hash & mask; ; i = (i + 1) & mask) {
+        kveIndexSlot_t *slot = &index->slots[i];
+        if (slot->address == KVE_INDEX_EMPTY || slot->address == KVE_INDEX_DELETED) {
+            if (slot->address == KVE_INDEX_EMPTY) {
+                index->used++;
+            }
+            slot->hash = hash;
+            slot->address = address;
+            index->count++;
+            return true;
+        }
+    }
+}
+
+static void build(kveMemory_t *kve, size_t firstItemAddress)
+{
+    static char keyBuffer[256];
+    kveIndex_t *index = kve->index;
+
+    memset(index->slots, 0, index->size * sizeof(kveIndexSlot_t));
+    index->used = 0;
+    index->count = 0;
+    index->state = kveIndexStateDisabled;
+
+    size_t address = firstItemAddress;
+    while (address < (kve->memorySize - 2)) {
+        kveItemHeader_t header = kveStorageGetItemInfo(kve, address);
+        if (header.full_length == KVE_END_TAG) {
+            index->endAddress = address;
+            index->state = kveIndexStateValid;
+            return;
+        }
+
+        // Corrupted table, leave it to the table walking functions
+        if (header.full_length < (sizeof(header) + 1)) {
+            return;
+        }
+
+        if (header.key_length != 0) {
+            kveStorageGetKey(kve, address, header, keyBuffer, header.key_length);
+            keyBuffer[header.key_length] = 0;
+            if (!insert(index, hashKey(keyBuffer), address)) {
+                return;
+            }
+        }
+
+        address += header.full_length;
+    }
+}
+
+void kveIndexInvalidate(kveMemory_t *kve)
+{
+    if (kve->index) {
+        kve->index->state = kveIndexStateNotBuilt;
+    }
+}
+
+bool kveIndexIsValid(kveMemory_t *kve, size_t firstItemAddress)
+{
+    if (!kve->index) {
+        return false;
+    }
+
+    if (kve->index->state == kveIndexStateNotBuilt) {
+        build(kve, firstItemAddress);
+    }
+
+    return kve->index->state == kveIndexStateValid;
+}
+
+size_t kveIndexFind(kveMemory_t *kve, const char *key)
+{
+    kveIndex_t *index = kve->index;
+    const uint16_t hash = hashKey(key);
+    const uint16_t mask = index->size - 1;
+
+    for (uint16_t i = hash & mask; index->slots[i].address != KVE_INDEX_EMPTY; i = (i + 1) & mask) {
+        const kveIndexSlot_t *slot = &index->slots[i];
+        if (slot->address != KVE_INDEX_DELETED && slot->hash == hash && keyMatches(kve, slot->address, key)) {
+            return slot->address;
+        }
+    }
+
+    return KVE_STORAGE_INVALID_ADDRESS;
+}
+
+void kveIndexAdd(kveMemory_t *kve, const char *key, size_t address)
+{
+    kveIndex_t *index = kve->index;
+    if (!index || index->state != kveIndexStateValid) {
+        return;
+    }
+
+    // Rebuild without the deleted slots, the index is disabled if it is still full
+    if (!insert(index, hashKey(key), address)) {
+        index->state = kveIndexStateNotBuilt;
+    }
+}
+
+void kveIndexRemove(kveMemory_t *kve, const char *key, size_t address)
+{
+    kveIndex_t *index = kve->index;
+    if (!index || index->state != kveIndexStateValid) {
+        return;
+    }
+
+    const uint16_t hash = hashKey(key);
+    const uint16_t mask = index->size - 1;
+    for (uint16_t i = hash & mask; index->slots[i].address != KVE_INDEX_EMPTY; i = (i + 1) & mask) {
+        kveIndexSlot_t *slot = &index->slots[i];
+        if (slot->address == address) {
+            slot->address = KVE_INDEX_DELETED;
+            index->count--;
+            return;
+        }
+    }
+}
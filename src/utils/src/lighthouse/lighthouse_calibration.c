@@ -88,15 +88,8 @@ static void idealToDistortedV2(const lighthouseCalibration_t* calib, const float
 
 typedef void (* idealToDistortedFcn_t)(const lighthouseCalibration_t* calib, const float* ideal, float* distorted);
 
-static void lighthouseCalibrationApply(const lighthouseCalibration_t* calib, const float* rawAngles, float* correctedAngles, idealToDistortedFcn_t idealToDistorted) {
-  const double max_delta = 0.0005;
-
-  // Use distorted angle as a starting point
-  float* estmatedAngles = correctedAngles;
-  estmatedAngles[0] = rawAngles[0];
-  estmatedAngles[1] = rawAngles[1];
-
-  for (int i = 0; i < 5; i++) {
+static void refine(const lighthouseCalibration_t* calib, const float* rawAngles, float* estmatedAngles, idealToDistortedFcn_t idealToDistorted, const int maxIterations, const float maxDelta) {
+  for (int i = 0; i < maxIterations; i++) {
     float currentDistortedAngles[2];
     idealToDistorted(calib, estmatedAngles, currentDistortedAngles);
 
@@ -106,12 +99,20 @@ static void lighthouseCalibrationApply(const lighthouseCalibration_t* calib, con
     estmatedAngles[0] = estmatedAngles[0] + delta0;
     estmatedAngles[1] = estmatedAngles[1] + delta1;
 
-    if (fabs((double)delta0) < max_delta && fabs((double)delta1) < max_delta) {
+    if (fabsf(delta0) < maxDelta && fabsf(delta1) < maxDelta) {
       break;
     }
   }
 }
 
+static void lighthouseCalibrationApply(const lighthouseCalibration_t* calib, const float* rawAngles, float* correctedAngles, idealToDistortedFcn_t idealToDistorted) {
+  // Use distorted angle as a starting point
+  correctedAngles[0] = rawAngles[0];
+  correctedAngles[1] = rawAngles[1];
+
+  refine(calib, rawAngles, correctedAngles, idealToDistorted, 5, 0.0005f);
+}
+
 void lighthouseCalibrationApplyV1(const lighthouseCalibration_t* calib, const float* rawAngles, float* correctedAngles) {
   return lighthouseCalibrationApply(calib, rawAngles, correctedAngles, idealToDistortedV1);
 }
@@ -120,6 +121,104 @@ void lighthouseCalibrationApplyV2(const lighthouseCalibration_t* calib, const fl
   return lighthouseCalibrationApply(calib, rawAngles, correctedAngles, idealToDistortedV2);
 }
 
+static const float tableStep = 2.0f * LIGHTHOUSE_CALIBRATION_TABLE_RANGE / (LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 1);
+
+void lighthouseCalibrationInitTableV2(lighthouseCalibrationTable_t* table, const lighthouseCalibration_t* calib) {
+  table->valid = false;
+  if (!calib->valid) {
+    return;
+  }
+
+  for (int i = 0; i < LIGHTHOUSE_CALIBRATION_TABLE_SIZE; i++) {
+    for (int j = 0; j < LIGHTHOUSE_CALIBRATION_TABLE_SIZE; j++) {
+      const float rawAngles[2] = {
+        -LIGHTHOUSE_CALIBRATION_TABLE_RANGE + i * tableStep,
+        -LIGHTHOUSE_CALIBRATION_TABLE_RANGE + j * tableStep,
+      };
+
+      // Solve to a tighter tolerance than the run time solver, the table error is carried into every sample
+      float correctedAngles[2] = {rawAngles[0], rawAngles[1]};
+      refine(calib, rawAngles, correctedAngles, idealToDistortedV2, 20, 0.000001f);
+
+      // Grid points far outside the field of view may not converge, or need a correction that does not fit.
+      // Samples in cells next to them are handled by the iterative solver.
+      float check[2];
+      idealToDistortedV2(calib, correctedAngles, check);
+      const bool converged = fabsf(check[0] - rawAngles[0]) < 0.00001f && fabsf(check[1] - rawAngles[1]) < 0.00001f;
+
+      for (int sweep = 0; sweep < 2; sweep++) {
+        const float correction = (correctedAngles[sweep] - rawAngles[sweep]) / LIGHTHOUSE_CALIBRATION_TABLE_SCALE;
+        if (converged && fabsf(correction) < INT16_MAX) {
+          table->correction[i][j][sweep] = (int16_t)lroundf(correction);
+        } else {
+          table->correction[i][j][sweep] = LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA;
+        }
+      }
+    }
+  }
+
+  table->valid = true;
+}
+
+void lighthouseCalibrationApplyV2Table(const lighthouseCalibration_t* calib, const lighthouseCalibrationTable_t* table, const float* rawAngles, float* correctedAngles) {
+  const float u = (rawAngles[0] + LIGHTHOUSE_CALIBRATION_TABLE_RANGE) / tableStep;
+  const float v = (rawAngles[1] + LIGHTHOUSE_CALIBRATION_TABLE_RANGE) / tableStep;
+
+  // The negated comparisons also catch NaN
+  const float maxIndex = LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 1;
+  if (!table->valid || !(u >= 0.0f && u <= maxIndex && v >= 0.0f && v <= maxIndex)) {
+    lighthouseCalibrationApplyV2(calib, rawAngles, correctedAngles);
+    return;
+  }
+
+  int i = (int)u;
+  int j = (int)v;
+  if (i > LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 2) {
+    i = LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 2;
+  }
+  if (j > LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 2) {
+    j = LIGHTHOUSE_CALIBRATION_TABLE_SIZE - 2;
+  }
+  const float fu = u - i;
+  const float fv = v - j;
+
+  for (int sweep = 0; sweep < 2; sweep++) {
+    if (table->correction[i][j][sweep] == LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA ||
+        table->correction[i + 1][j][sweep] == LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA ||
+        table->correction[i][j + 1][sweep] == LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA ||
+        table->correction[i + 1][j + 1][sweep] == LIGHTHOUSE_CALIBRATION_TABLE_NO_DATA) {
+      lighthouseCalibrationApplyV2(calib, rawAngles, correctedAngles);
+      return;
+    }
+  }
+
+  // Interpolated correction and its gradient with respect to the raw angles
+  float gradient[2][2];
+  const float gradientScale = LIGHTHOUSE_CALIBRATION_TABLE_SCALE / tableStep;
+  for (int sweep = 0; sweep < 2; sweep++) {
+    const float c00 = table->correction[i][j][sweep];
+    const float c10 = table->correction[i + 1][j][sweep];
+    const float c01 = table->correction[i][j + 1][sweep];
+    const float c11 = table->correction[i + 1][j + 1][sweep];
+
+    const float c0 = c00 + (c10 - c00) * fu;
+    const float c1 = c01 + (c11 - c01) * fu;
+    correctedAngles[sweep] = rawAngles[sweep] + (c0 + (c1 - c0) * fv) * LIGHTHOUSE_CALIBRATION_TABLE_SCALE;
+
+    gradient[sweep][0] = ((c10 - c00) * (1.0f - fv) + (c11 - c01) * fv) * gradientScale;
+    gradient[sweep][1] = (c1 - c0) * gradientScale;
+  }
+
+  // Refinement step. The Jacobian of the inverse distortion (I + gradient) turns the fixed point step of the
+  // iterative solver into a Newton step, which matters where the correction changes quickly over the table.
+  float distorted[2];
+  idealToDistortedV2(calib, correctedAngles, distorted);
+  const float delta0 = rawAngles[0] - distorted[0];
+  const float delta1 = rawAngles[1] - distorted[1];
+  correctedAngles[0] += delta0 + gradient[0][0] * delta0 + gradient[0][1] * delta1;
+  correctedAngles[1] += delta1 + gradient[1][0] * delta0 + gradient[1][1] * delta1;
+}
+
 void lighthouseCalibrationApplyNothing(const float rawAngles[2], float correctedAngles[2]) {
   correctedAngles[0] = rawAngles[0];
   correctedAngles[1] = rawAngles[1];
@@ -113,6 +113,62 @@ bool lighthouseGeometryGetPositionFromRayIntersection(const baseStationGeometry_
     return intersect_lines(origin1, ray1, origin2, ray2, position, position_delta);
 }
 
+bool lighthouseGeometryGetPositionFromRays(const vec3d origins[], const vec3d rays[], const int count, vec3d position, float *residual)
+{
+    if (count < 2) {
+        return false;
+    }
+
+    // Normal equations: sum(I - r * r^T) * p = sum((I - r * r^T) * o), where (I - r * r^T) projects onto the
+    // plane perpendicular to the ray. A is symmetric, only the upper triangle is accumulated.
+    float a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    vec3d b = {0};
+    for (int i = 0; i < count; i++) {
+        const float* r = rays[i];
+        const float* o = origins[i];
+        const float ro = vec_dot(r, o);
+
+        a00 += 1.0f - r[0] * r[0];
+        a01 -= r[0] * r[1];
+        a02 -= r[0] * r[2];
+        a11 += 1.0f - r[1] * r[1];
+        a12 -= r[1] * r[2];
+        a22 += 1.0f - r[2] * r[2];
+
+        b[0] += o[0] - r[0] * ro;
+        b[1] += o[1] - r[1] * ro;
+        b[2] += o[2] - r[2] * ro;
+    }
+
+    // Solve using the adjugate
+    const float c00 = a11 * a22 - a12 * a12;
+    const float c01 = a02 * a12 - a01 * a22;
+    const float c02 = a01 * a12 - a02 * a11;
+    const float det = a00 * c00 + a01 * c01 + a02 * c02;
+    if (det < 1e-5f) {
+        return false;
+    }
+
+    const float c11 = a00 * a22 - a02 * a02;
+    const float c12 = a01 * a02 - a00 * a12;
+    const float c22 = a00 * a11 - a01 * a01;
+
+    position[0] = (c00 * b[0] + c01 * b[1] + c02 * b[2]) / det;
+    position[1] = (c01 * b[0] + c11 * b[1] + c12 * b[2]) / det;
+    position[2] = (c02 * b[0] + c12 * b[1] + c22 * b[2]) / det;
+
+    float sumSq = 0;
+    for (int i = 0; i < count; i++) {
+        vec3d d = {position[0] - origins[i][0], position[1] - origins[i][1], position[2] - origins[i][2]};
+        const float along = vec_dot(d, rays[i]);
+        vec3d perpendicular = {d[0] - along * rays[i][0], d[1] - along * rays[i][1], d[2] - along * rays[i][2]};
+        sumSq += vec_dot(perpendicular, perpendicular);
+    }
+    *residual = arm_sqrt(sumSq / count);
+
+    return true;
+}
+
 void lighthouseGeometryGetBaseStationPosition(const baseStationGeometry_t* bs, vec3d baseStationPos) {
     // TODO: Make geometry adjustments within base station.
     vec3d rotated_origin_delta = {};
@@ -26,10 +26,13 @@
  *
  */
 
+#include <string.h>
+
 #include "pulse_processor.h"
 #include "pulse_processor_v1.h"
 #include "pulse_processor_v2.h"
 #include "cf_math.h"
+#include "usec_time.h"
 #include "autoconf.h"
 
 
@@ -46,15 +49,24 @@ bool pulseProcessorApplyCalibration(pulseProcessor_t *state, pulseProcessorResul
   const bool doApplyCalibration = calibrationData->valid;
 
   pulseProcessorBaseStationMeasurement_t* bsMeasurement = &angles->baseStationMeasurementsLh1[baseStation];
+  const pulseProcessorBsSlot_t* slot = 0;
   if (lighthouseBsTypeV2 == angles->measurementType) {
     bsMeasurement = &angles->baseStationMeasurementsLh2[baseStation];
+    if (doApplyCalibration) {
+      // Without a slot there is no table, fall back to the iterative solver
+      slot = pulseProcessorGetBsSlot(state, baseStation);
+    }
   }
 
   for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
     pulseProcessorSensorMeasurement_t* measurement = &bsMeasurement->sensorMeasurements[sensor];
     if (doApplyCalibration) {
       if (lighthouseBsTypeV2 == angles->measurementType) {
-        lighthouseCalibrationApplyV2(calibrationData, measurement->angles, measurement->correctedAngles);
+        if (slot) {
+          lighthouseCalibrationApplyV2Table(calibrationData, &slot->calibTable, measurement->angles, measurement->correctedAngles);
+        } else {
+          lighthouseCalibrationApplyV2(calibrationData, measurement->angles, measurement->correctedAngles);
+        }
       } else {
         lighthouseCalibrationApplyV1(calibrationData, measurement->angles, measurement->correctedAngles);
       }
@@ -66,6 +78,58 @@ bool pulseProcessorApplyCalibration(pulseProcessor_t *state, pulseProcessorResul
   return doApplyCalibration;
 }
 
+pulseProcessorBsSlot_t* pulseProcessorFindBsSlot(pulseProcessor_t *state, const int baseStation) {
+  for (int i = 0; i < PULSE_PROCESSOR_N_BS_SLOTS; i++) {
+    pulseProcessorBsSlot_t* slot = &state->bsSlots[i];
+    if (slot->inUse && slot->baseStation == baseStation) {
+      return slot;
+    }
+  }
+
+  return 0;
+}
+
+pulseProcessorBsSlot_t* pulseProcessorGetBsSlot(pulseProcessor_t *state, const int baseStation) {
+  const uint64_t now = usecTimestamp();
+
+  pulseProcessorBsSlot_t* slot = pulseProcessorFindBsSlot(state, baseStation);
+  if (!slot) {
+    // Prefer a free slot, otherwise the least recently used one
+    pulseProcessorBsSlot_t* candidate = &state->bsSlots[0];
+    for (int i = 0; i < PULSE_PROCESSOR_N_BS_SLOTS; i++) {
+      pulseProcessorBsSlot_t* s = &state->bsSlots[i];
+      if (!s->inUse) {
+        candidate = s;
+        break;
+      }
+      if (s->lastUsed < candidate->lastUsed) {
+        candidate = s;
+      }
+    }
+
+    if (candidate->inUse && (now - candidate->lastUsed) < PULSE_PROCESSOR_BS_SLOT_MIN_IDLE_US) {
+      // All slots are used by visible base stations, do not thrash
+      return 0;
+    }
+
+    slot = candidate;
+    memset(slot, 0, sizeof(pulseProcessorBsSlot_t));
+    slot->inUse = true;
+    slot->baseStation = baseStation;
+    lighthouseCalibrationInitTableV2(&slot->calibTable, &state->bsCalibration[baseStation]);
+  }
+
+  slot->lastUsed = now;
+  return slot;
+}
+
+void pulseProcessorCalibrationDataUpdated(pulseProcessor_t *state, const int baseStation) {
+  pulseProcessorBsSlot_t* slot = pulseProcessorFindBsSlot(state, baseStation);
+  if (slot) {
+    lighthouseCalibrationInitTableV2(&slot->calibTable, &state->bsCalibration[baseStation]);
+  }
+}
+
 /**
  * Clear angles information when we know that data became old when it wasn't updated anymore.
  * For example when base stations or sensors are hidden for crazyflie
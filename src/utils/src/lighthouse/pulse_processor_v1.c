@@ -271,10 +271,12 @@ TESTABLE_STATIC bool isNewSync(uint32_t timestamp, uint32_t lastSync) {
 static bool decodeAndApplyBaseStationCalibrationData(pulseProcessor_t *state) {
   bool isDecoded = false;
 
-  if (ootxDecoderProcessBit(&state->ootxDecoder[0], getOotxDataBit(state->v1.currentSync0Width))) {
+  pulseProcessorBsSlot_t* slot0 = pulseProcessorGetBsSlot(state, 0);
+  if (slot0 && ootxDecoderProcessBit(&slot0->ootxDecoder, getOotxDataBit(state->v1.currentSync0Width))) {
     isDecoded = true;
   }
-  if (ootxDecoderProcessBit(&state->ootxDecoder[1], getOotxDataBit(state->v1.currentSync1Width))) {
+  pulseProcessorBsSlot_t* slot1 = pulseProcessorGetBsSlot(state, 1);
+  if (slot1 && ootxDecoderProcessBit(&slot1->ootxDecoder, getOotxDataBit(state->v1.currentSync1Width))) {
     isDecoded = true;
   }
 
@@ -285,7 +285,10 @@ TESTABLE_STATIC bool handleCalibrationData(pulseProcessor_t *state, const pulseP
             const uint32_t timestamp0 = TS_DIFF(frameData->timestamp, frameData->offset);
 
             if (TS_ABS_DIFF_LARGER_THAN(timestamp0, prevTimestamp0, MIN_TICKS_BETWEEN_SLOW_BITS)) {
-                isFullMessage = ootxDecoderProcessBit(&state->ootxDecoder[channel], frameData->slowBit);
+                pulseProcessorBsSlot_t* slot = pulseProcessorGetBsSlot(state, channel);
+                if (slot) {
+                    isFullMessage = ootxDecoderProcessBit(&slot->ootxDecoder, frameData->slowBit);
+                }
             }
 
             state->v2.ootxTimestamps[channel] = timestamp0;
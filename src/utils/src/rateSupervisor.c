@@ -26,6 +26,24 @@
  */
 
 #include "rateSupervisor.h"
+#include "log.h"
+
+#define DEBUG_MODULE "RATESUP"
+#include "debug.h"
+
+#define RATE_SUPERVISOR_EVALUATION_INTERVAL_MS 1000
+
+// The registry of periodic tasks. Tasks register from their own context, the slot is claimed atomically.
+static rateSupervisorTask_t* registry[RATE_SUPERVISOR_MAX_TASKS];
+static uint8_t registeredCount;
+
+static uint32_t totalDeviations;
+static rateSupervisorTask_t* latestOffender;
+// The latest offender, for logging. The id is the registration index + 1, 0 means none so far.
+static uint8_t latestOffenderId;
+static uint32_t latestOffenderCount;
+static uint32_t latestOffenderExpected;
+static uint32_t latestOffenderTimeMs;
 
 void rateSupervisorInit(rateSupervisor_t* context, const uint32_t osTimeMs, const uint32_t evaluationIntervalMs, const uint32_t minCount, const uint32_t maxCount, const uint8_t skip) {
     context->count = 0;
@@ -63,3 +81,86 @@ bool rateSupervisorValidate(rateSupervisor_t* context, const uint32_t osTimeMs)
 uint32_t rateSupervisorLatestCount(rateSupervisor_t* context) {
     return context->latestCount;
 }
+
+bool rateSupervisorRegisterTask(rateSupervisorTask_t* task, const char* name, const uint32_t osTimeMs, const uint32_t expectedRateHz, const uint32_t toleranceHz, const uint8_t skip) {
+    const uint32_t minCount = expectedRateHz > toleranceHz ? expectedRateHz - toleranceHz : 0;
+    rateSupervisorInit(&task->supervisor, osTimeMs, RATE_SUPERVISOR_EVALUATION_INTERVAL_MS, minCount, expectedRateHz + toleranceHz, skip);
+    task->name = name;
+    task->deviationCount = 0;
+
+    const uint8_t count = __atomic_load_n(&registeredCount, __ATOMIC_ACQUIRE);
+    for (uint8_t i = 0; i < count; i++) {
+        if (registry[i] == task) {
+            return true;
+        }
+    }
+
+    const uint8_t index = __atomic_fetch_add(&registeredCount, 1, __ATOMIC_ACQ_REL);
+    if (index >= RATE_SUPERVISOR_MAX_TASKS) {
+        __atomic_store_n(&registeredCount, RATE_SUPERVISOR_MAX_TASKS, __ATOMIC_RELEASE);
+        task->id = 0;
+        return false;
+    }
+
+    task->id = index + 1;
+    registry[index] = task;
+    DEBUG_PRINT("Supervising %s at %lu Hz (id %u)\n", name, (unsigned long)expectedRateHz, task->id);
+    return true;
+}
+
+bool rateSupervisorTaskValidate(rateSupervisorTask_t* task, const uint32_t osTimeMs) {
+    if (rateSupervisorValidate(&task->supervisor, osTimeMs)) {
+        return true;
+    }
+
+    task->deviationCount++;
+    __atomic_add_fetch(&totalDeviations, 1, __ATOMIC_RELAXED);
+
+    latestOffender = task;
+    latestOffenderId = task->id;
+    latestOffenderCount = task->supervisor.latestCount;
+    latestOffenderExpected = (task->supervisor.expectedMin + task->supervisor.expectedMax) / 2;
+    latestOffenderTimeMs = osTimeMs;
+
+    return false;
+}
+
+uint32_t rateSupervisorTotalDeviations(void) {
+    return __atomic_load_n(&totalDeviations, __ATOMIC_RELAXED);
+}
+
+const rateSupervisorTask_t* rateSupervisorLatestOffender(void) {
+    return latestOffender;
+}
+
+/**
+ * Rate supervision of the periodic tasks. The tasks register an expected rate and a tolerance,
+ * and the rate is evaluated once per second. The id and name of each task is printed on the console
+ * when it registers.
+ */
+LOG_GROUP_START(rateSup)
+/**
+ * @brief Number of registered tasks
+ */
+LOG_ADD(LOG_UINT8, tasks, &registeredCount)
+/**
+ * @brief Total number of evaluations where a task was off its rate
+ */
+LOG_ADD(LOG_UINT32, deviations, &totalDeviations)
+/**
+ * @brief Registration index + 1 of the latest task that was off its rate, 0 if none
+ */
+LOG_ADD(LOG_UINT8, lastId, &latestOffenderId)
+/**
+ * @brief Rate of the latest task that was off its rate [Hz]
+ */
+LOG_ADD(LOG_UINT32, lastRate, &latestOffenderCount)
+/**
+ * @brief Expected rate of the latest task that was off its rate [Hz]
+ */
+LOG_ADD(LOG_UINT32, lastExpected, &latestOffenderExpected)
+/**
+ * @brief Time of the latest rate deviation [ms]
+ */
+LOG_ADD(LOG_UINT32, lastTime, &latestOffenderTimeMs)
+LOG_GROUP_STOP(rateSup)
@@ -0,0 +1,101 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * rpmFilter.c - notch filters tracking the motor speeds and their harmonics
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "rpmFilter.h"
+#include "physicalConstants.h"
+
+// Keep the notches well below the Nyquist frequency, where the filter gets very wide
+#define MAX_FREQ_OF_SAMPLE_FREQ 0.45f
+
+static void updateMotor(rpmFilter_t* this, const int motor)
+{
+  float freq = this->rpm[motor] / 60.0f;
+  if (freq < this->minFreq) {
+    freq = this->minFreq;
+  }
+
+  const float w0 = 2.0f * M_PI_F * freq / this->sampleFreq;
+  const float cosW0 = cosf(w0);
+  const float sinW0 = sinf(w0);
+
+  // cos(nw) and sin(nw) from the angle sum identities
+  float cosW = cosW0;
+  float sinW = sinW0;
+  for (int harmonic = 0; harmonic < this->harmonics; harmonic++) {
+    biquadBank_t* bank = &this->notch[motor][harmonic];
+    const float harmonicFreq = freq * (harmonic + 1);
+    for (int axis = 0; axis < RPM_FILTER_AXES; axis++) {
+      if (harmonicFreq < this->maxFreq) {
+        biquadBankSetNotchCosSin(bank, axis, cosW, sinW, this->q);
+      } else {
+        biquadBankSetLowPass(bank, axis, this->sampleFreq, 0.0f);
+      }
+    }
+
+    const float cosNext = cosW * cosW0 - sinW * sinW0;
+    sinW = sinW * cosW0 + cosW * sinW0;
+    cosW = cosNext;
+  }
+}
+
+void rpmFilterInit(rpmFilter_t* this, const float sampleFreq, const uint8_t harmonics, const float q, const float minFreq)
+{
+  memset(this, 0, sizeof(rpmFilter_t));
+
+  this->sampleFreq = sampleFreq;
+  this->q = q;
+  this->minFreq = minFreq;
+  this->maxFreq = MAX_FREQ_OF_SAMPLE_FREQ * sampleFreq;
+  this->harmonics = harmonics < RPM_FILTER_MAX_HARMONICS ? harmonics : RPM_FILTER_MAX_HARMONICS;
+
+  for (int motor = 0; motor < RPM_FILTER_MOTORS; motor++) {
+    for (int harmonic = 0; harmonic < this->harmonics; harmonic++) {
+      biquadBankInitNotch(&this->notch[motor][harmonic], RPM_FILTER_AXES, sampleFreq, minFreq, q);
+    }
+    updateMotor(this, motor);
+  }
+}
+
+void rpmFilterSetRpm(rpmFilter_t* this, const float* rpm)
+{
+  memcpy(this->rpm, rpm, sizeof(this->rpm));
+}
+
+void rpmFilterApply(rpmFilter_t* this, float* axis)
+{
+  updateMotor(this, this->nextMotor);
+  this->nextMotor = (this->nextMotor + 1) % RPM_FILTER_MOTORS;
+
+  for (int motor = 0; motor < RPM_FILTER_MOTORS; motor++) {
+    for (int harmonic = 0; harmonic < this->harmonics; harmonic++) {
+      biquadBankApply(&this->notch[motor][harmonic], axis);
+    }
+  }
+}
@@ -0,0 +1,59 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * seqlock.c - Sequence lock for single writer, multiple reader data sharing
+ */
+
+#include <string.h>
+
+#include "seqlock.h"
+
+void seqlockInit(seqlock_t* lock) {
+  lock->sequence = 0;
+}
+
+void seqlockWrite(seqlock_t* lock, void* storage, const void* data, const size_t size) {
+  seqlockWriteBegin(lock);
+  memcpy(storage, data, size);
+  seqlockWriteEnd(lock);
+}
+
+bool seqlockRead(const seqlock_t* lock, const void* storage, void* data, const size_t size) {
+  for (int attempt = 0; attempt < SEQLOCK_READ_ATTEMPTS; attempt++) {
+    const uint32_t before = lock->sequence;
+    if (before & 1) {
+      // Update in progress
+      continue;
+    }
+
+    __sync_synchronize();
+    memcpy(data, storage, size);
+    __sync_synchronize();
+
+    if (lock->sequence == before) {
+      return true;
+    }
+  }
+
+  return false;
+}
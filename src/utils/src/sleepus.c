@@ -26,9 +26,22 @@
 #include "sleepus.h"
 #include "usec_time.h"
 
+// Shorter sleeps are busy-waited, the task switches would cost more than the sleep
+#define SLEEPUS_BLOCK_MIN_US 10
+
+// Time from the timer interrupt until the task runs again, busy-waited to
+// end the sleep on time
+#define SLEEPUS_WAKEUP_LATENCY_US 4
+
 void sleepus(uint32_t us)
 {
   uint64_t start = usecTimestamp();
+
+  // Let other tasks run, falls back to busy-waiting when the task can not block
+  if (us >= SLEEPUS_BLOCK_MIN_US) {
+    usecTimerSleep(us - SLEEPUS_WAKEUP_LATENCY_US);
+  }
+
   while ((start+us) > usecTimestamp()) {
   }
 }
@@ -22,7 +22,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  *
- * statsCnt.c - utitlity for logging rates
+ * statsCnt.c - utitlity for logging rates and statistics
  */
 
 #include "statsCnt.h"
@@ -52,11 +52,82 @@ float statsCntRateCounterUpdate(statsCntRateCounter_t* counter, uint32_t now_ms)
     return counter->latestRate;
 }
 
+static void resetMinMaxAvgAccumulation(statsCntMinMaxAvg_t* stats) {
+    stats->count = 0;
+    stats->sum = 0;
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+}
+
+void statsCntMinMaxAvgInit(statsCntMinMaxAvg_t* stats, uint32_t averagingIntervalMs) {
+    resetMinMaxAvgAccumulation(stats);
+    stats->intervalMs = averagingIntervalMs;
+    stats->latestMin = 0;
+    stats->latestMax = 0;
+    stats->latestAvg = 0.0f;
+    stats->latestRate = 0.0f;
+    stats->latestAveragingMs = 0;
+}
+
+bool statsCntMinMaxAvgUpdate(statsCntMinMaxAvg_t* stats, uint32_t now_ms) {
+    uint32_t dt_ms = now_ms - stats->latestAveragingMs;
+    if (dt_ms <= stats->intervalMs) {
+        return false;
+    }
+
+    if (stats->count > 0) {
+        stats->latestMin = stats->min;
+        stats->latestMax = stats->max;
+        stats->latestAvg = (float)stats->sum / stats->count;
+    } else {
+        stats->latestMin = 0;
+        stats->latestMax = 0;
+        stats->latestAvg = 0.0f;
+    }
+    stats->latestRate = stats->count / (dt_ms / 1000.0f);
+
+    stats->latestAveragingMs = now_ms;
+    resetMinMaxAvgAccumulation(stats);
+
+    return true;
+}
+
+void statsCntHistogramInit(statsCntHistogram_t* histogram, uint8_t shift, uint32_t averagingIntervalMs) {
+    for (int i = 0; i < STATS_CNT_HISTOGRAM_BUCKETS; i++) {
+        histogram->count[i] = 0;
+        histogram->previousCount[i] = 0;
+        histogram->latest[i] = 0;
+    }
+    histogram->shift = shift;
+    histogram->intervalMs = averagingIntervalMs;
+    histogram->latestAveragingMs = 0;
+}
+
+bool statsCntHistogramUpdate(statsCntHistogram_t* histogram, uint32_t now_ms) {
+    uint32_t dt_ms = now_ms - histogram->latestAveragingMs;
+    if (dt_ms <= histogram->intervalMs) {
+        return false;
+    }
+
+    for (int i = 0; i < STATS_CNT_HISTOGRAM_BUCKETS; i++) {
+        const uint32_t count = histogram->count[i];
+        const uint32_t samples = count - histogram->previousCount[i];
+        histogram->latest[i] = samples < UINT16_MAX ? samples : UINT16_MAX;
+        histogram->previousCount[i] = count;
+    }
+
+    histogram->latestAveragingMs = now_ms;
+
+    return true;
+}
+
 void statsCntRateLoggerInit(statsCntRateLogger_t* logger, uint32_t averagingIntervalMs) {
     statsCntRateCounterInit(&logger->rateCounter, averagingIntervalMs);
 
     logger->logByFunction.data = (void*)logger;
     logger->logByFunction.aquireFloat = statsCntRateLogHandler;
+    // The rate only changes once per averaging interval
+    logger->logByFunction.minIntervalMs = averagingIntervalMs;
 }
 
 float statsCntRateLogHandler(uint32_t timestamp, void* data) {
@@ -0,0 +1,121 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * swarmTime.c - shared time base for a swarm, distributed by broadcast
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "swarmTime.h"
+
+// Gain of the filter on the offset, the estimate is based on roughly the latest 1 / gain time stamps
+#define OFFSET_GAIN 0.1
+// Gain of the filter on the drift, smaller than the offset gain to filter out the radio jitter
+#define DRIFT_GAIN 0.005
+
+void swarmTimeInit(swarmTime_t* this) {
+  memset(this, 0, sizeof(swarmTime_t));
+  this->rate = 1.0;
+}
+
+static void restart(swarmTime_t* this, const uint64_t swarmTimeUs, const uint64_t localTimeUs) {
+  this->isInitialized = true;
+  this->refLocalUs = localTimeUs;
+  this->refSwarmUs = (double)swarmTimeUs;
+  this->rate = 1.0;
+  this->sampleCount = 1;
+  this->outlierCount = 0;
+  this->latestErrorUs = 0.0f;
+}
+
+bool swarmTimeUpdate(swarmTime_t* this, const uint64_t swarmTimeUs, const uint64_t localTimeUs) {
+  if (!this->isInitialized) {
+    restart(this, swarmTimeUs, localTimeUs);
+    return true;
+  }
+
+  const double dt = (double)(int64_t)(localTimeUs - this->refLocalUs);
+  if (dt <= 0.0) {
+    return false;
+  }
+
+  const double predicted = this->refSwarmUs + dt * this->rate;
+  const double error = (double)swarmTimeUs - predicted;
+
+  if (fabs(error) > SWARM_TIME_MAX_ERROR_US) {
+    this->outlierCount++;
+    if (this->outlierCount > SWARM_TIME_MAX_OUTLIERS) {
+      // The swarm clock has jumped, start over
+      restart(this, swarmTimeUs, localTimeUs);
+      this->resyncCount++;
+      return true;
+    }
+    return false;
+  }
+
+  // Use a higher gain for the first samples to converge quickly
+  this->sampleCount++;
+  double offsetGain = 1.0 / this->sampleCount;
+  if (offsetGain < OFFSET_GAIN) {
+    offsetGain = OFFSET_GAIN;
+  }
+
+  this->refLocalUs = localTimeUs;
+  this->refSwarmUs = predicted + offsetGain * error;
+
+  double rate = this->rate + DRIFT_GAIN * error / dt;
+  if (rate < 1.0 - SWARM_TIME_MAX_DRIFT) {
+    rate = 1.0 - SWARM_TIME_MAX_DRIFT;
+  } else if (rate > 1.0 + SWARM_TIME_MAX_DRIFT) {
+    rate = 1.0 + SWARM_TIME_MAX_DRIFT;
+  }
+  this->rate = rate;
+
+  this->outlierCount = 0;
+  this->latestErrorUs = (float)error;
+  return true;
+}
+
+bool swarmTimeIsSynchronized(const swarmTime_t* this, const uint64_t localTimeUs) {
+  return this->isInitialized && this->sampleCount >= SWARM_TIME_MIN_SAMPLES &&
+    localTimeUs - this->refLocalUs < SWARM_TIME_MAX_AGE_US;
+}
+
+uint64_t swarmTimeFromLocal(const swarmTime_t* this, const uint64_t localTimeUs) {
+  const double dt = (double)(int64_t)(localTimeUs - this->refLocalUs);
+  return (uint64_t)llround(this->refSwarmUs + dt * this->rate);
+}
+
+uint64_t swarmTimeToLocal(const swarmTime_t* this, const uint64_t swarmTimeUs) {
+  const double dSwarm = (double)swarmTimeUs - this->refSwarmUs;
+  return this->refLocalUs + llround(dSwarm / this->rate);
+}
+
+uint64_t swarmTimeToLocalFromMs(const swarmTime_t* this, const uint32_t swarmTimeMs, const uint64_t localNowUs) {
+  const uint64_t swarmNowMs = swarmTimeFromLocal(this, localNowUs) / 1000;
+  const int32_t diffMs = (int32_t)(swarmTimeMs - (uint32_t)swarmNowMs);
+  const uint64_t swarmTimeUs = (swarmNowMs + diffMs) * 1000;
+  return swarmTimeToLocal(this, swarmTimeUs);
+}
@@ -44,6 +44,7 @@ The implementation must handle
 */
 
 #include <string.h>
+#include <math.h>
 
 #define DEBUG_MODULE "TDOA_ENGINE"
 #include "debug.h"
@@ -53,6 +54,13 @@ The implementation must handle
 #include "clockCorrectionEngine.h"
 #include "physicalConstants.h"
 
+// Anchors that have not been updated within this time are not considered when
+// looking for the youngest matching anchor, in ms
+#define TDOA_ENGINE_MATCHING_MAX_AGE (2 * 1000)
+
+// Low pass filter coefficient for the clock correction jitter in the link stats
+#define LINK_STATS_JITTER_FILTER 0.05f
+
 // **Инициализирует движок TDoA, устанавливая начальные значения и сохраняя важные параметры.**
 // 
 // `engineState`: Указатель на структуру состояния движка TDoA.
@@ -61,11 +69,11 @@ The implementation must handle
 // `locodeckTsFreq`: Частота таймера Locodeck.
 // `matchingAlgorithm`: Выбранный алгоритм сопоставления якорей.
 void tdoaEngineInit(tdoaEngineState_t* engineState, const uint32_t now_ms, tdoaEngineSendTdoaToEstimator sendTdoaToEstimator, const double locodeckTsFreq, const tdoaEngineMatchingAlgorithm_t matchingAlgorithm) {
-  // Инициализирует хранилище информации о якорях, обнуляя все слоты в массиве `anchorInfoArray`.
+  // Инициализирует хранилище информации о якорях, обнуляя все слоты в хранилище `anchorStorage`.
   // Каждый слот хранит информацию о конкретном якоре, такую как время приема/передачи, 
   // коррекция часов, номер последовательности и т.д. 
   // Подробнее см. `tdoaStorage.h` и `tdoaStorage.c`.
-  tdoaStorageInitialize(engineState->anchorInfoArray); 
+  tdoaStorageInitialize(&engineState->anchorStorage); 
   // Инициализирует модуль сбора статистики TDoA, устанавливая начальное время и сбрасывая счетчики.
   tdoaStatsInit(&engineState->stats, now_ms);
   // Сохраняет указатель на функцию отправки данных TDoA. 
@@ -125,6 +133,9 @@ static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorC
     tdoa.anchorIds[0] = idA; 
     tdoa.anchorIds[1] = idB; 
 
+    tdoaStorageGetLinkStats(anchorACtx)->measurementCount++;
+    tdoaStorageGetLinkStats(anchorBCtx)->measurementCount++;
+
     // Отправляет данные TDoA в модуль оценки местоположения с помощью функции, 
     // указатель на которую был передан при инициализации движка.
     engineState->sendTdoaToEstimator(&tdoa); 
@@ -139,7 +150,7 @@ static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorC
 // `stats`: Указатель на структуру статистики.
 // 
 // **Возвращает:** `true`, если измерение считается надежным, `false` в противном случае.
-static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, tdoaStats_t* stats) {
+static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const clockCorrectionAlgorithm_t algorithm, tdoaStats_t* stats) {
   bool sampleIsReliable = false; // Инициализирует флаг надежности измерения.
 
   // Получает последнее измеренное время приема пакета от якоря и время передачи пакета якорем.
@@ -155,12 +166,17 @@ static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t
     // для оценки разницы между часами якоря и тега.
     // `TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP` -  маска, определяющая, какие биты 
     // временной метки якоря будут использоваться для коррекции часов.
-    double clockCorrectionCandidate = clockCorrectionEngineCalculate(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
-    // Обновляет коррекцию часов для якоря, используя вычисленное значение. 
-    // Функция `clockCorrectionEngineUpdate` также проверяет надежность измерения, 
-    // например, сравнивая новое значение с предыдущими значениями и 
-    // отбрасывая выбросы. Возвращает `true`, если измерение считается надежным.
-    sampleIsReliable = clockCorrectionEngineUpdate(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+    const double previousClockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
+    if (algorithm == clockCorrectionAlgorithmLeastSquares) {
+      sampleIsReliable = clockCorrectionEngineUpdateLeastSquares(tdoaStorageGetClockCorrectionStorage(anchorCtx), rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
+    } else {
+      double clockCorrectionCandidate = clockCorrectionEngineCalculate(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
+      // Обновляет коррекцию часов для якоря, используя вычисленное значение. 
+      // Функция `clockCorrectionEngineUpdate` также проверяет надежность измерения, 
+      // например, сравнивая новое значение с предыдущими значениями и 
+      // отбрасывая выбросы. Возвращает `true`, если измерение считается надежным.
+      sampleIsReliable = clockCorrectionEngineUpdate(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+    }
 
     // Если измерение надежное...
     if (sampleIsReliable){
@@ -172,6 +188,17 @@ static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t
         STATS_CNT_RATE_EVENT(&stats->clockCorrectionCount);
       }
     }
+
+    tdoaAnchorLinkStats_t* linkStats = tdoaStorageGetLinkStats(anchorCtx);
+    if (sampleIsReliable) {
+      linkStats->clockCorrectionAcceptedCount++;
+      if (previousClockCorrection > 0.0) {
+        const float change = fabs(tdoaStorageGetClockCorrection(anchorCtx) - previousClockCorrection);
+        linkStats->clockCorrectionJitter += LINK_STATS_JITTER_FILTER * (change - linkStats->clockCorrectionJitter);
+      }
+    } else {
+      linkStats->clockCorrectionRejectedCount++;
+    }
   }
 
   return sampleIsReliable; // Возвращает флаг надежности измерения.
@@ -266,11 +293,10 @@ static bool matchRandomAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_
     const uint8_t candidateAnchorId = engineState->matching.id[index]; 
     // Проверяет, не нужно ли исключить этот ID.
     if (!doExcludeId || (excludedId != candidateAnchorId)) { 
-      // Пытается получить или создать контекст кандидата. 
-      // Если контекст кандидата уже существует (якорь был виден ранее), 
-      // функция `tdoaStorageGetCreateAnchorCtx` вернет `true` и заполнит `otherAnchorCtx`. 
-      // Если контекст кандидата не существует, функция вернет `false` и создаст новый контекст.
-      if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
+      // Получает контекст кандидата, если якорь есть в хранилище.
+      // Candidates that are not in storage can not be used, no slot is
+      // created for them.
+      if (tdoaStorageGetAnchorCtx(&engineState->anchorStorage, candidateAnchorId, now_ms, otherAnchorCtx)) {
         // Проверяет, соответствует ли номер последовательности кандидата 
         // номеру последовательности, хранящемуся в списке `seqNr` текущего якоря.
         // Также проверяет, доступно ли время пролета сигнала между 
@@ -297,51 +323,36 @@ static bool matchRandomAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_
 // 
 // **Возвращает:** `true`, если найден подходящий якорь, `false` в противном случае.
 static bool matchYoungestAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
-    int remoteCount = 0;
-    // Получает список номеров последовательностей (`seqNr`) и ID (`id`) 
-    // удаленных якорей, видимых текущим якорем. 
-    // Эта информация хранится в структуре `tdoaAnchorInfo_t` текущего якоря.
-    tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, engineState->matching.seqNr, engineState->matching.id);
-
     uint32_t now_ms = anchorCtx->currentTime_ms; // Получает текущее время.
-    uint32_t youmgestUpdateTime = 0;  // Инициализирует время последнего обновления самого "молодого" якоря.
-    int bestId = -1; // Инициализирует ID самого "молодого" якоря.
+    const uint8_t anchorId = tdoaStorageGetId(anchorCtx);
+
+    // The storage keeps anchors ordered by update time, youngest first. The
+    // first candidate that the current anchor has remote data and a time of
+    // flight for is the youngest one, and the search can stop there.
+    bool found = tdoaStorageGetYoungestAnchorCtx(&engineState->anchorStorage, now_ms, otherAnchorCtx);
+    for (; found; found = tdoaStorageGetNextOlderAnchorCtx(otherAnchorCtx)) {
+      const uint32_t updateTime = tdoaStorageGetLastUpdateTime(otherAnchorCtx);
+      // Older anchors are not interesting, neither are the ones that never have been updated
+      if (updateTime == 0 || (now_ms - updateTime) > TDOA_ENGINE_MATCHING_MAX_AGE) {
+        break;
+      }
 
-    // Перебирает кандидатов на сопоставление.
-    for (int index = 0; index < remoteCount; index++) {
       // Получает ID кандидата.
-      const uint8_t candidateAnchorId = engineState->matching.id[index];
+      const uint8_t candidateAnchorId = tdoaStorageGetId(otherAnchorCtx);
       // Проверяет, не нужно ли исключить этот ID.
-      if (!doExcludeId || (excludedId != candidateAnchorId)) {
-        // Проверяет наличие времени пролета сигнала для кандидата. 
-        // Время пролета сигнала должно быть измерено ранее.
-        if (tdoaStorageGetRemoteTimeOfFlight(anchorCtx, candidateAnchorId)) {
-          // Получает контекст кандидата. 
-          // Если контекст кандидата уже существует (якорь был виден ранее), 
-          // функция `tdoaStorageGetCreateAnchorCtx` вернет `true` и заполнит `otherAnchorCtx`. 
-          // Если контекст кандидата не существует, функция вернет `false` и создаст новый контекст.
-          if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
-            // Получает время последнего обновления кандидата.
-            uint32_t updateTime = tdoaStorageGetLastUpdateTime(otherAnchorCtx);
-            // Если кандидат "моложе" текущего самого "молодого"...
-            if (updateTime > youmgestUpdateTime) {
-              // ...и номер последовательности совпадает...
-              if (engineState->matching.seqNr[index] == tdoaStorageGetSeqNr(otherAnchorCtx)) {
-                // ...то обновляет время последнего обновления и ID самого "молодого" якоря.
-                youmgestUpdateTime = updateTime;
-                bestId = candidateAnchorId;
-              }
-            }
-          }
-        }
+      if (candidateAnchorId == anchorId || (doExcludeId && (excludedId == candidateAnchorId))) {
+        continue;
       }
-    }
 
-    // Если найден "молодой" якорь...
-    if (bestId >= 0) { 
-      // ...то получает его контекст и возвращает `true`.
-      tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, bestId, now_ms, otherAnchorCtx);
-      return true; 
+      int64_t remoteRxTime;
+      uint8_t remoteSeqNr;
+      // Номер последовательности кандидата должен совпадать с номером, который слышал текущий якорь,
+      // и время пролета сигнала должно быть измерено ранее.
+      if (tdoaStorageGetRemoteRxTimeSeqNr(anchorCtx, candidateAnchorId, &remoteRxTime, &remoteSeqNr)) {
+        if (remoteSeqNr == tdoaStorageGetSeqNr(otherAnchorCtx) && tdoaStorageGetRemoteTimeOfFlight(anchorCtx, candidateAnchorId)) {
+          return true;
+        }
+      }
     }
 
     // Если подходящий кандидат не найден, сбрасывает контекст 
@@ -350,6 +361,43 @@ static bool matchYoungestAnchor(tdoaEngineState_t* engineState, tdoaAnchorContex
     return false;
 }
 
+// **Вычисляет TDoA относительно всех подходящих удаленных якорей из пакета.**
+//
+// Every remote anchor in the packet that is in storage, has a matching sequence
+// number and a known time of flight is used, at most
+// TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET. The measurements are sent to the
+// estimator back to back so they can be processed as a batch.
+//
+// **Возвращает:** количество отправленных измерений.
+static int processAllSuitableAnchors(tdoaEngineState_t* engineState, const tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const bool doExcludeId, const uint8_t excludedId) {
+  if (tdoaStorageGetClockCorrection(anchorCtx) <= 0.0) {
+    return 0;
+  }
+
+  int remoteCount = 0;
+  tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, engineState->matching.seqNr, engineState->matching.id);
+
+  uint32_t now_ms = anchorCtx->currentTime_ms;
+  int count = 0;
+  for (int index = 0; index < remoteCount && count < TDOA_ENGINE_MAX_MEASUREMENTS_PER_PACKET; index++) {
+    const uint8_t candidateAnchorId = engineState->matching.id[index];
+    if (doExcludeId && (excludedId == candidateAnchorId)) {
+      continue;
+    }
+
+    tdoaAnchorContext_t otherAnchorCtx;
+    if (tdoaStorageGetAnchorCtx(&engineState->anchorStorage, candidateAnchorId, now_ms, &otherAnchorCtx)) {
+      if (engineState->matching.seqNr[index] == tdoaStorageGetSeqNr(&otherAnchorCtx) && tdoaStorageGetRemoteTimeOfFlight(anchorCtx, candidateAnchorId)) {
+        double tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->locodeckTsFreq);
+        enqueueTDOA(&otherAnchorCtx, anchorCtx, tdoaDistDiff, engineState);
+        count++;
+      }
+    }
+  }
+
+  return count;
+}
+
 // **Находит подходящий якорь для сопоставления с текущим якорем, 
 // используя выбранный алгоритм сопоставления.**
 // 
@@ -398,7 +446,7 @@ void tdoaEngineGetAnchorCtxForPacketProcessing(tdoaEngineState_t* engineState, c
   // Если контекст якоря уже существует (якорь был виден ранее), 
   // функция `tdoaStorageGetCreateAnchorCtx` вернет `true` и заполнит `anchorCtx`. 
   // Если контекст якоря не существует, функция вернет `false` и создаст новый контекст.
-  if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, anchorId, currentTime_ms, anchorCtx)) {
+  if (tdoaStorageGetCreateAnchorCtx(&engineState->anchorStorage, anchorId, currentTime_ms, anchorCtx)) {
     // Увеличивает счетчик успешных получений контекста.
     STATS_CNT_RATE_EVENT(&engineState->stats.contextHitCount);
   } else {
@@ -435,12 +483,19 @@ bool tdoaEngineProcessPacketFiltered(tdoaEngineState_t* engineState, tdoaAnchorC
   // (время передачи и приема). 
   // Функция `updateClockCorrection` возвращает `true`, если 
   // измерение времени считается надежным.
-  bool timeIsGood = updateClockCorrection(anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, &engineState->stats);
+  bool timeIsGood = updateClockCorrection(anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->clockCorrectionAlgorithm, &engineState->stats);
   // Если измерение времени надежное...
   if (timeIsGood) { 
     // ...то увеличивает счетчик надежных измерений времени.
     STATS_CNT_RATE_EVENT(&engineState->stats.timeIsGood);
 
+    if (engineState->matchingAlgorithm == TdoaEngineMatchingAlgorithmAll) {
+      if (processAllSuitableAnchors(engineState, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, doExcludeId, excludedId) > 0) {
+        STATS_CNT_RATE_EVENT(&engineState->stats.suitableDataFound);
+      }
+      return timeIsGood;
+    }
+
     tdoaAnchorContext_t otherAnchorCtx;
     // Находит подходящий якорь для сопоставления с текущим якорем, 
     // используя выбранный алгоритм сопоставления и, 
@@ -92,4 +92,60 @@ void tdoaStatsUpdate(tdoaStats_t* tdoaStats, uint32_t now_ms) {
     tdoaStats->previousStatisticsTime = now_ms;
     tdoaStats->nextStatisticsTime = now_ms + STATS_INTERVAL;
   }
-}
\ No newline at end of file
+}
+
+// The anchor is active if a packet has been received within this time
+#define LINK_STATS_ACTIVE_PERIOD 2000
+
+static void fillLinkTableEntry(tdoaAnchorContext_t* anchorCtx, tdoaStatsLinkTableEntry_t* entry) {
+  const tdoaAnchorLinkStats_t* linkStats = tdoaStorageGetLinkStats(anchorCtx);
+  const uint32_t age = anchorCtx->currentTime_ms - tdoaStorageGetLastUpdateTime(anchorCtx);
+  const bool isActive = (linkStats->packetCount > 0) && (age < LINK_STATS_ACTIVE_PERIOD);
+  const double clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
+
+  point_t position;
+  memset(entry, 0, sizeof(tdoaStatsLinkTableEntry_t));
+  entry->id = tdoaStorageGetId(anchorCtx);
+  entry->flags = (isActive ? TDOA_STATS_LINK_FLAG_ACTIVE : 0) |
+    (tdoaStorageGetAnchorPosition(anchorCtx, &position) ? TDOA_STATS_LINK_FLAG_POSITION : 0) |
+    ((clockCorrection > 0.0) ? TDOA_STATS_LINK_FLAG_CLOCK_CORRECTION : 0);
+  tdoaStorageGetValidRemoteCounts(anchorCtx, &entry->remoteRxCount, &entry->remoteTofCount);
+  entry->age = (age < UINT16_MAX) ? age : UINT16_MAX;
+  entry->packetRate = isActive ? linkStats->packetRate : 0.0f;
+  entry->packetCount = linkStats->packetCount;
+  entry->lostPacketCount = linkStats->lostPacketCount;
+  entry->clockCorrectionAcceptedCount = linkStats->clockCorrectionAcceptedCount;
+  entry->clockCorrectionRejectedCount = linkStats->clockCorrectionRejectedCount;
+  entry->clockCorrectionPpm = (clockCorrection > 0.0) ? (clockCorrection - 1.0) * 1e6 : 0.0f;
+  entry->clockCorrectionJitterPpm = linkStats->clockCorrectionJitter * 1e6f;
+  entry->measurementCount = linkStats->measurementCount;
+}
+
+size_t tdoaStatsSerializeLinkTable(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms, uint8_t* buffer, const size_t bufferSize) {
+  if (bufferSize < sizeof(tdoaStatsLinkTableHeader_t)) {
+    return 0;
+  }
+
+  tdoaStatsLinkTableHeader_t header = {
+    .formatVersion = TDOA_STATS_LINK_TABLE_VERSION,
+    .entrySize = sizeof(tdoaStatsLinkTableEntry_t),
+    .timestamp = now_ms,
+  };
+
+  size_t length = sizeof(header);
+  tdoaAnchorContext_t anchorCtx;
+  for (bool found = tdoaStorageGetYoungestAnchorCtx(anchorStorage, now_ms, &anchorCtx); found; found = tdoaStorageGetNextOlderAnchorCtx(&anchorCtx)) {
+    if (length + sizeof(tdoaStatsLinkTableEntry_t) > bufferSize) {
+      break;
+    }
+
+    tdoaStatsLinkTableEntry_t entry;
+    fillLinkTableEntry(&anchorCtx, &entry);
+    memcpy(&buffer[length], &entry, sizeof(entry));
+    length += sizeof(entry);
+    header.entryCount++;
+  }
+
+  memcpy(buffer, &header, sizeof(header));
+  return length;
+}
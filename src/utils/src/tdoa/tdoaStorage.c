@@ -41,102 +41,112 @@ Data storage encapsulation for the TDoA engine
 #define ANCHOR_POSITION_VALIDITY_PERIOD (2 * 1000)
 #define ANCHOR_ACTIVE_VALIDITY_PERIOD (2 * 1000)
 
-
-static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor);
+// Sequence numbers are 7 bits, gaps are only counted as lost packets if the previous packet is recent enough for the
+// sequence number not to have wrapped
+#define LINK_STATS_MAX_GAP_TIME 500
+#define LINK_STATS_RATE_PERIOD 1000
+
+
+static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint8_t anchor);
+static void unlinkSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot);
+static void linkSlotByUpdateTime(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot);
+static void linkSlotAsOldest(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot);
+static void setCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+static uint8_t findSlotToReuse(const tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms);
+static bool isPositionValid(const tdoaAnchorInfo_t* anchorInfo, const uint32_t currentTime_ms);
+static tdoaRemoteEntry_t* findRemoteEntry(tdoaAnchorStorage_t* anchorStorage, const uint16_t list, const uint8_t remoteAnchor);
+static tdoaRemoteEntry_t* getRemoteEntryForUpdate(tdoaAnchorStorage_t* anchorStorage, uint16_t* list, uint8_t* count, const int maxCount, const uint8_t remoteAnchor);
+static uint16_t allocateRemoteEntry(tdoaAnchorStorage_t* anchorStorage);
+static void freeRemoteEntries(tdoaAnchorStorage_t* anchorStorage, uint16_t* list, uint8_t* count);
 
 // Инициализирует хранилище информации о якорях, обнуляя все его данные.
-// Функция memset используется для заполнения памяти, занимаемой массивом anchorStorage, нулями.
-void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
-  memset(anchorStorage, 0, sizeof(tdoaAnchorInfo_t) * ANCHOR_STORAGE_COUNT);
+// Id map and recency list are marked as empty and all remote entries are
+// put in the free list
+void tdoaStorageInitialize(tdoaAnchorStorage_t* anchorStorage) {
+  memset(anchorStorage, 0, sizeof(tdoaAnchorStorage_t));
+  memset(anchorStorage->slotById, TDOA_STORAGE_NO_SLOT, sizeof(anchorStorage->slotById));
+  anchorStorage->youngestSlot = TDOA_STORAGE_NO_SLOT;
+  anchorStorage->oldestSlot = TDOA_STORAGE_NO_SLOT;
+
+  for (int i = 0; i < TDOA_STORAGE_REMOTE_ENTRY_COUNT; i++) {
+    anchorStorage->remoteEntries[i].next = i + 1;
+  }
+  anchorStorage->remoteEntries[TDOA_STORAGE_REMOTE_ENTRY_COUNT - 1].next = TDOA_STORAGE_NO_ENTRY;
+  anchorStorage->freeEntryList = 0;
 }
 
 // Ищет информацию о якоре в хранилище и, если не находит, 
 // создает новую запись для этого якоря. Она возвращает true, если якорь найден, 
 // и false, если пришлось создать новую запись.
-
-// anchorStorage[]: массив структур типа tdoaAnchorInfo_t, 
-// представляющий хранилище данных о якорях.
+// When the storage is full, a slot is reused in this order of preference:
+// 1. The oldest anchor if it has not been heard recently
+// 2. The oldest anchor without a valid position, it can not be used for TDoA
+// 3. The oldest anchor
+// This keeps anchors that are in use when a new anchor shows up, the new anchor
+// will get a slot when an old one has gone out of range or stays silent.
+
+// anchorStorage: хранилище данных о якорях.
 // anchor: идентификатор якоря, который необходимо найти или создать.
 // currentTime_ms: текущее время в миллисекундах, которое используется 
 // для обновления информации о якоре.
 // anchorCtx: указатель на структуру tdoaAnchorContext_t, 
 // в которую будет записана информация о найденном или созданном якоре.
-bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
-  anchorCtx->currentTime_ms = currentTime_ms;  // Установка текущего времени в контексте анкера
-  uint32_t oldestUpdateTime = currentTime_ms;  // Самое старое время обновления
-  int firstUninitializedSlot = -1;  // Первый неинициализированный слот
-  int oldestSlot = 0;  // Самый старый слот
-
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {  // Проход по всем элементам массива anchorStorage
-    if (anchorStorage[i].isInitialized) {  // Если запись уже инициализирована
-      if (anchor == anchorStorage[i].id) {  // Проверка, совпадает ли айди с искомым
-        anchorCtx->anchorInfo = &anchorStorage[i];  // Записывает ее
-        return true;  // Возвращает тру
-      }
-
-      if (anchorStorage[i].lastUpdateTime < oldestUpdateTime) {  // Если текущее время больше, чем время последнего обновления у записи
-        oldestUpdateTime = anchorStorage[i].lastUpdateTime;  // Обновить время обновления
-        oldestSlot = i;  // Занести айди записи как последнюю обновленную
-      }
-    } else {  // Если слот не инициализирован
-      if (firstUninitializedSlot == -1) {  // Сохраняет индекс первого такого слота
-        firstUninitializedSlot = i;
-      }
-    }
+bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+  const uint8_t slot = anchorStorage->slotById[anchor];
+  if (slot != TDOA_STORAGE_NO_SLOT) {
+    setCtx(anchorStorage, slot, currentTime_ms, anchorCtx);
+    return true;
   }
 
   // The anchor was not found in storage
   // Запись анкера НЕ была найдена
-  tdoaAnchorInfo_t* newAnchorInfo = 0;
-  if (firstUninitializedSlot != -1) {  // Если найден хоть один неициализированный слот
-    newAnchorInfo = initializeSlot(anchorStorage, firstUninitializedSlot, anchor);  // Инициализация первого доступного слота
-  } else {  // Иначе
-    newAnchorInfo = initializeSlot(anchorStorage, oldestSlot, anchor);  // Используем самый старый слот
+  uint8_t newSlot;
+  if (anchorStorage->slotsInUse < ANCHOR_STORAGE_COUNT) {  // Если есть неициализированный слот
+    newSlot = anchorStorage->slotsInUse;
+    anchorStorage->slotsInUse++;
+  } else {
+    newSlot = findSlotToReuse(anchorStorage, currentTime_ms);
   }
 
-  anchorCtx->anchorInfo = newAnchorInfo;  // Передаем новую запись в указатель
+  initializeSlot(anchorStorage, newSlot, anchor);
+  setCtx(anchorStorage, newSlot, currentTime_ms, anchorCtx);
   return false;  // Возвращаем фолс - пришлось создать запись
 }
 
 // Ищет информацию о анкере, но в случае ненахода, просто записывает 0
-bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
-  anchorCtx->currentTime_ms = currentTime_ms;  // Текущее время
-
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {  // Перебор элементов массива anchorStorage
-    if (anchorStorage[i].isInitialized) {  // Если запись существует (инициализирована)
-      if (anchor == anchorStorage[i].id) {  // Если это искомый айди
-        anchorCtx->anchorInfo = &anchorStorage[i];  // Записать ссылку на эту запись
-        return true;  // Вернуть тру
-      }
-    }
+bool tdoaStorageGetAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+  const uint8_t slot = anchorStorage->slotById[anchor];
+  if (slot != TDOA_STORAGE_NO_SLOT) {
+    setCtx(anchorStorage, slot, currentTime_ms, anchorCtx);
+    return true;
   }
 
+  anchorCtx->storage = anchorStorage;
+  anchorCtx->currentTime_ms = currentTime_ms;  // Текущее время
   anchorCtx->anchorInfo = 0;  // Иначе отдаем 0
   return false;  // Ретурн фолс
 }
 
 // Получить список записанных анкеров
-uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize) {
+uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize) {
   int count = 0;  // Счетчик начальное 0
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT && count < maxListSize; i++) {  // Перебор всего массива или пока не достигнем заданного предела
-    if (anchorStorage[i].isInitialized) {  // Если запись существует
-      unorderedAnchorList[count] = anchorStorage[i].id;  // Записываем айдишник в массив без сортировки
-      count++;  // Счетчик +1
-    }
+  for (int i = 0; i < anchorStorage->slotsInUse && count < maxListSize; i++) {  // Перебор всего массива или пока не достигнем заданного предела
+    unorderedAnchorList[count] = anchorStorage->anchorInfo[i].id;  // Записываем айдишник в массив без сортировки
+    count++;  // Счетчик +1
   }
 
   return count;  // Возвращаем количество
 }
 
 // Получить список записанных активных анкеров
-uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms) {
+uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms) {
   int count = 0;  // Счетчик начальное 0
 
   const uint32_t expiryTime = currentTime_ms - ANCHOR_ACTIVE_VALIDITY_PERIOD;  // Вычисляем время просрочки активности
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT && count < maxListSize; i++) {  // Перебор массива, но не больше требуемого количества активных записей
-    if (anchorStorage[i].isInitialized && anchorStorage[i].lastUpdateTime > expiryTime) {  // Если запись инициализирована и еще не просрочена по времени
-      unorderedAnchorList[count] = anchorStorage[i].id;  // Записать айди анкера в список
+  for (int i = 0; i < anchorStorage->slotsInUse && count < maxListSize; i++) {  // Перебор массива, но не больше требуемого количества активных записей
+    if (anchorStorage->anchorInfo[i].lastUpdateTime > expiryTime) {  // Если запись еще не просрочена по времени
+      unorderedAnchorList[count] = anchorStorage->anchorInfo[i].id;  // Записать айди анкера в список
       count++;  // счетчик +1
     }
   }
@@ -144,6 +154,34 @@ uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorInfo_t anchorStorage[], ui
   return count;  // вернуть количество
 }
 
+// Gets the context of the anchor that was updated most recently
+bool tdoaStorageGetYoungestAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+  const uint8_t slot = anchorStorage->youngestSlot;
+  if (slot == TDOA_STORAGE_NO_SLOT) {
+    anchorCtx->storage = anchorStorage;
+    anchorCtx->currentTime_ms = currentTime_ms;
+    anchorCtx->anchorInfo = 0;
+    return false;
+  }
+
+  setCtx(anchorStorage, slot, currentTime_ms, anchorCtx);
+  return true;
+}
+
+// Moves the context to the anchor that was updated before the current one
+bool tdoaStorageGetNextOlderAnchorCtx(tdoaAnchorContext_t* anchorCtx) {
+  tdoaAnchorStorage_t* anchorStorage = anchorCtx->storage;
+  const uint8_t slot = anchorCtx->anchorInfo - anchorStorage->anchorInfo;
+  const uint8_t olderSlot = anchorStorage->olderSlot[slot];
+  if (olderSlot == TDOA_STORAGE_NO_SLOT) {
+    anchorCtx->anchorInfo = 0;
+    return false;
+  }
+
+  anchorCtx->anchorInfo = &anchorStorage->anchorInfo[olderSlot];
+  return true;
+}
+
 // Возвращает айди анкера из контекста
 uint8_t tdoaStorageGetId(const tdoaAnchorContext_t* anchorCtx) {
   return anchorCtx->anchorInfo->id;
@@ -207,10 +245,35 @@ void tdoaStorageSetRxTxData(tdoaAnchorContext_t* anchorCtx, int64_t rxTime, int6
   uint32_t now = anchorCtx->currentTime_ms;  // текущее время
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
 
+  tdoaAnchorLinkStats_t* linkStats = &anchorInfo->linkStats;
+  if (linkStats->packetCount > 0 && (now - anchorInfo->lastUpdateTime) < LINK_STATS_MAX_GAP_TIME) {
+    const uint8_t gap = (seqNr - anchorInfo->seqNr) & 0x7f;
+    if (gap > 1) {
+      linkStats->lostPacketCount += gap - 1;
+    }
+  }
+
+  linkStats->packetCount++;
+  if (linkStats->packetCount == 1) {
+    linkStats->rateStartTime = now;
+    linkStats->rateStartPacketCount = 1;
+  }
+  const uint32_t ratePeriod = now - linkStats->rateStartTime;
+  if (ratePeriod >= LINK_STATS_RATE_PERIOD) {
+    linkStats->packetRate = (linkStats->packetCount - linkStats->rateStartPacketCount) * 1000.0f / ratePeriod;
+    linkStats->rateStartTime = now;
+    linkStats->rateStartPacketCount = linkStats->packetCount;
+  }
+
   anchorInfo->rxTime = rxTime;  // Время получения
   anchorInfo->txTime = txTime;  // Время отправки
   anchorInfo->seqNr = seqNr;  // Номер пакета
   anchorInfo->lastUpdateTime = now;  // Время обнолвения (сейчас)
+
+  // Keep the recency list ordered by update time
+  const uint8_t slot = anchorInfo - anchorCtx->storage->anchorInfo;
+  unlinkSlot(anchorCtx->storage, slot);
+  linkSlotByUpdateTime(anchorCtx->storage, slot);
 }
 
 #ifdef CONFIG_DECK_LOCO_TDOA3_HYBRID_MODE
@@ -249,61 +312,42 @@ int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const u
 
 // Возвращает время приема сигнала и номер пакета от удаленного анкера в контексте текущего???
 bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, int64_t* rxTime, uint8_t* seqNr) {
-  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-  bool result = false;
-
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {  // Проход по всем анкерам
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {  // Если айди совпал
-      uint32_t now = anchorCtx->currentTime_ms;  // Запись текущего времени
-      if (anchorInfo->remoteAnchorData[i].endOfLife > now) {  // Если данные еще не устарели
-        *rxTime = anchorInfo->remoteAnchorData[i].rxTime;  // Отдать инфу о времени приема
-        *seqNr = anchorInfo->remoteAnchorData[i].seqNr;  // Отдать инфу о номере пакета
-        result = true;  // Успешный успех
-      }
-      break;
+  const tdoaRemoteEntry_t* entry = findRemoteEntry(anchorCtx->storage, anchorCtx->anchorInfo->remoteRxList, remoteAnchor);
+  if (entry) {  // Если айди совпал
+    uint32_t now = anchorCtx->currentTime_ms;  // Запись текущего времени
+    if (entry->endOfLife > now) {  // Если данные еще не устарели
+      *rxTime = entry->value;  // Отдать инфу о времени приема
+      *seqNr = entry->seqNr;  // Отдать инфу о номере пакета
+      return true;  // Успешный успех
     }
   }
 
-  return result;
+  return false;
 }
 
 // Обновляет время приема и номер пакета для удаленного анкера в контексте текущего
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;  // Начальное состояние
   uint32_t now = anchorCtx->currentTime_ms;  // Текущее время
-  uint32_t oldestTime = 0xFFFFFFFF;  // Самое старое время
-
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {  // Проход по всем записям remoteAnchorData
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {  // Если нашли
-      indexToUpdate = i;  // Записываем индекс, который надо обновить
-      break;  // Выходим из цикла
-    }
 
-    if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {  // Поиск самого старого слота, чтобы в случае чего, перезаписать его
-      oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
-      indexToUpdate = i;
-    }
-  }
-
-  anchorInfo->remoteAnchorData[indexToUpdate].id = remoteAnchor;  // Записываем новые данные
-  anchorInfo->remoteAnchorData[indexToUpdate].rxTime = remoteRxTime;
-  anchorInfo->remoteAnchorData[indexToUpdate].seqNr = remoteSeqNr;
-  anchorInfo->remoteAnchorData[indexToUpdate].endOfLife = now + REMOTE_DATA_VALIDITY_PERIOD;  // И новый срок годности
+  tdoaRemoteEntry_t* entry = getRemoteEntryForUpdate(anchorCtx->storage, &anchorInfo->remoteRxList, &anchorInfo->remoteRxCount, REMOTE_ANCHOR_DATA_COUNT, remoteAnchor);
+  entry->value = remoteRxTime;  // Записываем новые данные
+  entry->seqNr = remoteSeqNr;
+  entry->endOfLife = now + REMOTE_DATA_VALIDITY_PERIOD;  // И новый срок годности
 }
 
 // Возвращает последние полученные номер пакетов для каждого из удаленных анкеров
 void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* remoteCount, uint8_t seqNr[], uint8_t id[]) {
-  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  const tdoaAnchorStorage_t* anchorStorage = anchorCtx->storage;
   uint32_t now = anchorCtx->currentTime_ms;  // Текущее время
 
   int count = 0;  // Счетчик начало
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {  // Проход по всем анкерам в контексте текущего
-    if (anchorInfo->remoteAnchorData[i].endOfLife > now) {  // Если срок годности нормальный
-      id[count] = anchorInfo->remoteAnchorData[i].id;  // Записать айди в список
-      seqNr[count] = anchorInfo->remoteAnchorData[i].seqNr;  // Записать номер пакета в список
+  for (uint16_t i = anchorCtx->anchorInfo->remoteRxList; i != TDOA_STORAGE_NO_ENTRY; i = anchorStorage->remoteEntries[i].next) {  // Проход по всем анкерам в контексте текущего
+    const tdoaRemoteEntry_t* entry = &anchorStorage->remoteEntries[i];
+    if (entry->endOfLife > now) {  // Если срок годности нормальный
+      id[count] = entry->id;  // Записать айди в список
+      seqNr[count] = entry->seqNr;  // Записать номер пакета в список
       count++;  // Счетчик +1
     }
   }
@@ -313,15 +357,11 @@ void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* re
 
 // Возвращает ToF между текущим анкеромс и другим
 int64_t tdoaStorageGetRemoteTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor) {
-  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {  // По всем анкерам в контексте
-    if (otherAnchor == anchorInfo->remoteTof[i].id) {  // Если Есть доступный ToF для заданного анкера
-      uint32_t now = anchorCtx->currentTime_ms;  // Текущее время
-      if (anchorInfo->remoteTof[i].endOfLife > now) {  // если срок годности нормальный
-        return anchorInfo->remoteTof[i].tof;  // Отдаем значение ToF
-      }
-      break;
+  const tdoaRemoteEntry_t* entry = findRemoteEntry(anchorCtx->storage, anchorCtx->anchorInfo->remoteTofList, otherAnchor);
+  if (entry) {  // Если Есть доступный ToF для заданного анкера
+    uint32_t now = anchorCtx->currentTime_ms;  // Текущее время
+    if (entry->endOfLife > now) {  // если срок годности нормальный
+      return entry->value;  // Отдаем значение ToF
     }
   }
 
@@ -331,46 +371,242 @@ int64_t tdoaStorageGetRemoteTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, c
 // Обновляет ToF для заданного анкера
 void tdoaStorageSetRemoteTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof) {
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;  // Индекс, который надо будет обновить
   uint32_t now = anchorCtx->currentTime_ms;  // Текущее время
-  uint32_t oldestTime = 0xFFFFFFFF;  // Начальное самое старое время
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {  // Проход по всем анкерам в контексте текущего
-    if (remoteAnchor == anchorInfo->remoteTof[i].id) {  // Если нашли нужную запись
-      indexToUpdate = i;  // Записываем ее индекс
-      break;  // Выходим с цикла
-    }
+  tdoaRemoteEntry_t* entry = getRemoteEntryForUpdate(anchorCtx->storage, &anchorInfo->remoteTofList, &anchorInfo->remoteTofCount, TOF_PER_ANCHOR_COUNT, remoteAnchor);
+  entry->value = tof;  // Записываем новую инфу
+  entry->endOfLife = now + TOF_VALIDITY_PERIOD;  // И новый срок годности
+}
 
-    if (anchorInfo->remoteTof[i].endOfLife < oldestTime) {  // Находим самую старую запись
-      oldestTime = anchorInfo->remoteTof[i].endOfLife;
-      indexToUpdate = i;
+tdoaAnchorLinkStats_t* tdoaStorageGetLinkStats(const tdoaAnchorContext_t* anchorCtx) {
+  return &anchorCtx->anchorInfo->linkStats;
+}
+
+static uint8_t countValidEntries(const tdoaAnchorStorage_t* anchorStorage, const uint16_t list, const uint32_t now) {
+  uint8_t count = 0;
+  for (uint16_t i = list; i != TDOA_STORAGE_NO_ENTRY; i = anchorStorage->remoteEntries[i].next) {
+    if (anchorStorage->remoteEntries[i].endOfLife > now) {
+      count++;
     }
   }
 
-  anchorInfo->remoteTof[indexToUpdate].id = remoteAnchor;  // Записываем новую инфу
-  anchorInfo->remoteTof[indexToUpdate].tof = tof;
-  anchorInfo->remoteTof[indexToUpdate].endOfLife = now + TOF_VALIDITY_PERIOD;  // И новый срок годности
+  return count;
+}
+
+void tdoaStorageGetValidRemoteCounts(const tdoaAnchorContext_t* anchorCtx, uint8_t* rxCount, uint8_t* tofCount) {
+  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  *rxCount = countValidEntries(anchorCtx->storage, anchorInfo->remoteRxList, anchorCtx->currentTime_ms);
+  *tofCount = countValidEntries(anchorCtx->storage, anchorInfo->remoteTofList, anchorCtx->currentTime_ms);
 }
 
 // Проверяет. находится ли анкер в сторадже
-bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {  // Проход по всем анкерам
-    if (anchorStorage[i].isInitialized) {  // Если запись инициализирована
-      if (anchor == anchorStorage[i].id) {  // Если нужный анкер
-        return true;  // Рет тру
+bool tdoaStorageIsAnchorInStorage(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor) {
+  return anchorStorage->slotById[anchor] != TDOA_STORAGE_NO_SLOT;
+}
+
+// Инициализирует слот под новую запись (Делает новую запись)
+// The id map and recency list are updated as well, a new slot has never been
+// updated and is linked in as the oldest.
+static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint8_t anchor) {
+  tdoaAnchorInfo_t* anchorInfo = &anchorStorage->anchorInfo[slot];
+  if (anchorInfo->isInitialized) {
+    anchorStorage->slotById[anchorInfo->id] = TDOA_STORAGE_NO_SLOT;
+    unlinkSlot(anchorStorage, slot);
+    freeRemoteEntries(anchorStorage, &anchorInfo->remoteRxList, &anchorInfo->remoteRxCount);
+    freeRemoteEntries(anchorStorage, &anchorInfo->remoteTofList, &anchorInfo->remoteTofCount);
+  }
+
+  memset(anchorInfo, 0, sizeof(tdoaAnchorInfo_t));  // Очищает ячейку памяти
+  anchorInfo->id = anchor;  // Записывает айди анкера
+  anchorInfo->isInitialized = true;  // Ставит флаг, что ячейка инициализированна
+  anchorInfo->remoteRxList = TDOA_STORAGE_NO_ENTRY;
+  anchorInfo->remoteTofList = TDOA_STORAGE_NO_ENTRY;
+
+  anchorStorage->slotById[anchor] = slot;
+  linkSlotAsOldest(anchorStorage, slot);
+
+  return anchorInfo;  // Возвращает ссылку на новую запись
+}
+
+static void unlinkSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot) {
+  const uint8_t older = anchorStorage->olderSlot[slot];
+  const uint8_t younger = anchorStorage->youngerSlot[slot];
+
+  if (younger != TDOA_STORAGE_NO_SLOT) {
+    anchorStorage->olderSlot[younger] = older;
+  } else {
+    anchorStorage->youngestSlot = older;
+  }
+
+  if (older != TDOA_STORAGE_NO_SLOT) {
+    anchorStorage->youngerSlot[older] = younger;
+  } else {
+    anchorStorage->oldestSlot = younger;
+  }
+}
+
+// Inserts an unlinked slot in the recency list. The search starts at the
+// youngest end since updates normally arrive in time order, which makes this
+// constant time in practice.
+static void linkSlotByUpdateTime(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot) {
+  const uint32_t updateTime = anchorStorage->anchorInfo[slot].lastUpdateTime;
+
+  uint8_t younger = TDOA_STORAGE_NO_SLOT;
+  uint8_t older = anchorStorage->youngestSlot;
+  while (older != TDOA_STORAGE_NO_SLOT && anchorStorage->anchorInfo[older].lastUpdateTime > updateTime) {
+    younger = older;
+    older = anchorStorage->olderSlot[older];
+  }
+
+  anchorStorage->olderSlot[slot] = older;
+  anchorStorage->youngerSlot[slot] = younger;
+
+  if (younger != TDOA_STORAGE_NO_SLOT) {
+    anchorStorage->olderSlot[younger] = slot;
+  } else {
+    anchorStorage->youngestSlot = slot;
+  }
+
+  if (older != TDOA_STORAGE_NO_SLOT) {
+    anchorStorage->youngerSlot[older] = slot;
+  } else {
+    anchorStorage->oldestSlot = slot;
+  }
+}
+
+static void linkSlotAsOldest(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot) {
+  const uint8_t younger = anchorStorage->oldestSlot;
+
+  anchorStorage->olderSlot[slot] = TDOA_STORAGE_NO_SLOT;
+  anchorStorage->youngerSlot[slot] = younger;
+
+  if (younger != TDOA_STORAGE_NO_SLOT) {
+    anchorStorage->olderSlot[younger] = slot;
+  } else {
+    anchorStorage->youngestSlot = slot;
+  }
+
+  anchorStorage->oldestSlot = slot;
+}
+
+static void setCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+  anchorCtx->storage = anchorStorage;
+  anchorCtx->anchorInfo = &anchorStorage->anchorInfo[slot];
+  anchorCtx->currentTime_ms = currentTime_ms;
+}
+
+static uint8_t findSlotToReuse(const tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms) {
+  const uint8_t oldestSlot = anchorStorage->oldestSlot;
+  if ((currentTime_ms - anchorStorage->anchorInfo[oldestSlot].lastUpdateTime) > ANCHOR_ACTIVE_VALIDITY_PERIOD) {
+    return oldestSlot;
+  }
+
+  for (uint8_t slot = oldestSlot; slot != TDOA_STORAGE_NO_SLOT; slot = anchorStorage->youngerSlot[slot]) {
+    if (!isPositionValid(&anchorStorage->anchorInfo[slot], currentTime_ms)) {
+      return slot;
+    }
+  }
+
+  return oldestSlot;
+}
+
+static bool isPositionValid(const tdoaAnchorInfo_t* anchorInfo, const uint32_t currentTime_ms) {
+  int32_t validCreationTime = currentTime_ms - ANCHOR_POSITION_VALIDITY_PERIOD;
+  return (int32_t)anchorInfo->position.timestamp > validCreationTime;
+}
+
+static tdoaRemoteEntry_t* findRemoteEntry(tdoaAnchorStorage_t* anchorStorage, const uint16_t list, const uint8_t remoteAnchor) {
+  for (uint16_t i = list; i != TDOA_STORAGE_NO_ENTRY; i = anchorStorage->remoteEntries[i].next) {
+    if (remoteAnchor == anchorStorage->remoteEntries[i].id) {
+      return &anchorStorage->remoteEntries[i];
+    }
+  }
+
+  return 0;
+}
+
+// Finds the entry for a remote anchor in a list. If it is not in the list, the
+// oldest entry is reused when the list is full, otherwise a new entry is
+// appended to the list.
+static tdoaRemoteEntry_t* getRemoteEntryForUpdate(tdoaAnchorStorage_t* anchorStorage, uint16_t* list, uint8_t* count, const int maxCount, const uint8_t remoteAnchor) {
+  tdoaRemoteEntry_t* oldestEntry = 0;
+  for (uint16_t i = *list; i != TDOA_STORAGE_NO_ENTRY; i = anchorStorage->remoteEntries[i].next) {
+    tdoaRemoteEntry_t* entry = &anchorStorage->remoteEntries[i];
+    if (remoteAnchor == entry->id) {
+      return entry;
+    }
+
+    if (oldestEntry == 0 || entry->endOfLife < oldestEntry->endOfLife) {
+      oldestEntry = entry;
+    }
+  }
+
+  if (*count >= maxCount) {
+    oldestEntry->id = remoteAnchor;
+    return oldestEntry;
+  }
+
+  // Allocating may take an entry from this list, find the end of the list afterwards
+  const uint16_t newEntry = allocateRemoteEntry(anchorStorage);
+  uint16_t* link = list;
+  while (*link != TDOA_STORAGE_NO_ENTRY) {
+    link = &anchorStorage->remoteEntries[*link].next;
+  }
+  *link = newEntry;
+  (*count)++;
+
+  tdoaRemoteEntry_t* entry = &anchorStorage->remoteEntries[newEntry];
+  memset(entry, 0, sizeof(tdoaRemoteEntry_t));
+  entry->next = TDOA_STORAGE_NO_ENTRY;
+  entry->id = remoteAnchor;
+  return entry;
+}
+
+// Takes an entry from the free list. If the pool is exhausted, the entry with
+// the oldest end of life is taken from the anchor that owns it.
+static uint16_t allocateRemoteEntry(tdoaAnchorStorage_t* anchorStorage) {
+  const uint16_t freeEntry = anchorStorage->freeEntryList;
+  if (freeEntry != TDOA_STORAGE_NO_ENTRY) {
+    anchorStorage->freeEntryList = anchorStorage->remoteEntries[freeEntry].next;
+    anchorStorage->remoteEntriesInUse++;
+    return freeEntry;
+  }
+
+  uint16_t* oldestLink = 0;
+  uint8_t* oldestCount = 0;
+  uint32_t oldestEndOfLife = UINT32_MAX;
+  for (int slot = 0; slot < anchorStorage->slotsInUse; slot++) {
+    tdoaAnchorInfo_t* anchorInfo = &anchorStorage->anchorInfo[slot];
+    uint16_t* lists[] = {&anchorInfo->remoteRxList, &anchorInfo->remoteTofList};
+    uint8_t* counts[] = {&anchorInfo->remoteRxCount, &anchorInfo->remoteTofCount};
+
+    for (int l = 0; l < 2; l++) {
+      for (uint16_t* link = lists[l]; *link != TDOA_STORAGE_NO_ENTRY; link = &anchorStorage->remoteEntries[*link].next) {
+        const uint32_t endOfLife = anchorStorage->remoteEntries[*link].endOfLife;
+        if (oldestLink == 0 || endOfLife < oldestEndOfLife) {
+          oldestEndOfLife = endOfLife;
+          oldestLink = link;
+          oldestCount = counts[l];
+        }
       }
     }
   }
 
-  return false;  // Рет фолс иначе
+  const uint16_t oldestEntry = *oldestLink;
+  *oldestLink = anchorStorage->remoteEntries[oldestEntry].next;
+  (*oldestCount)--;
+  return oldestEntry;
 }
 
-// Инициализирует слот под новую запись (Делает новую запись)
-static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor) {
-  memset(&anchorStorage[slot], 0, sizeof(tdoaAnchorInfo_t));  // Очищает ячейку памяти
-  anchorStorage[slot].id = anchor;  // Записывает айди анкера
-  anchorStorage[slot].isInitialized = true;  // Ставит флаг, что ячейка инициализированна
+static void freeRemoteEntries(tdoaAnchorStorage_t* anchorStorage, uint16_t* list, uint8_t* count) {
+  while (*list != TDOA_STORAGE_NO_ENTRY) {
+    const uint16_t entry = *list;
+    *list = anchorStorage->remoteEntries[entry].next;
+
+    anchorStorage->remoteEntries[entry].next = anchorStorage->freeEntryList;
+    anchorStorage->freeEntryList = entry;
+    anchorStorage->remoteEntriesInUse--;
+  }
 
-  return &anchorStorage[slot];  // Возвращает ссылку на новую запись
+  *count = 0;
 }
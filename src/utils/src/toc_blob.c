@@ -0,0 +1,94 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * toc_blob.c - Serialized log or param TOC, read in chunks through the mem subsystem
+ */
+
+#include <string.h>
+
+#include "toc_blob.h"
+
+void tocBlobInit(tocBlob_t* blob, const int entriesLen, const uint16_t count, const uint32_t crc, tocBlobEncode_t encode)
+{
+  uint8_t buffer[TOC_BLOB_MAX_ENTRY_SIZE];
+
+  blob->encode = encode;
+  blob->entriesLen = entriesLen;
+
+  blob->header[0] = TOC_BLOB_VERSION;
+  memcpy(&blob->header[1], &count, sizeof(count));
+  memcpy(&blob->header[3], &crc, sizeof(crc));
+
+  blob->size = TOC_BLOB_HEADER_SIZE;
+  for (int i = 0; i < entriesLen; i++) {
+    blob->size += encode(i, buffer);
+  }
+
+  blob->cursorEntry = 0;
+  blob->cursorAddress = TOC_BLOB_HEADER_SIZE;
+}
+
+uint32_t tocBlobGetSize(const tocBlob_t* blob)
+{
+  return blob->size;
+}
+
+bool tocBlobRead(tocBlob_t* blob, const uint32_t address, const uint8_t length, uint8_t* buffer)
+{
+  if (address + length > blob->size) {
+    return false;
+  }
+
+  uint32_t pos = address;
+  const uint32_t end = address + length;
+
+  while (pos < end && pos < TOC_BLOB_HEADER_SIZE) {
+    *buffer++ = blob->header[pos++];
+  }
+
+  // Restart from the first entry when reading backwards
+  if (pos < blob->cursorAddress) {
+    blob->cursorEntry = 0;
+    blob->cursorAddress = TOC_BLOB_HEADER_SIZE;
+  }
+
+  uint8_t entry[TOC_BLOB_MAX_ENTRY_SIZE];
+  while (pos < end && blob->cursorEntry < blob->entriesLen) {
+    const uint8_t entrySize = blob->encode(blob->cursorEntry, entry);
+    const uint32_t entryEnd = blob->cursorAddress + entrySize;
+
+    while (pos < end && pos < entryEnd) {
+      *buffer++ = entry[pos - blob->cursorAddress];
+      pos++;
+    }
+
+    // Stay on a partially read entry, the next read continues in it
+    if (pos < entryEnd) {
+      break;
+    }
+    blob->cursorEntry++;
+    blob->cursorAddress = entryEnd;
+  }
+
+  return true;
+}
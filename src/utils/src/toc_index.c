@@ -0,0 +1,90 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * toc_index.c - Hash index over the (group, name) pairs of a log or param TOC
+ */
+
+#include <string.h>
+
+#include "toc_index.h"
+
+// Max number of entries in percent of the number of slots, keeps probe sequences short
+#define TOC_INDEX_MAX_LOAD_PERCENT 75
+
+// FNV-1a over "group.name"
+static uint32_t hashString(uint32_t hash, const char* str) {
+  for (; *str; str++) {
+    hash ^= (uint8_t)*str;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t hash(const char* group, const char* name) {
+  uint32_t result = hashString(2166136261u, group);
+  result ^= '.';
+  result *= 16777619u;
+  return hashString(result, name);
+}
+
+void tocIndexInit(tocIndex_t* index, tocIndexSlot_t* slots, const uint16_t size) {
+  memset(slots, 0, size * sizeof(tocIndexSlot_t));
+  index->slots = slots;
+  index->mask = size - 1;
+  index->count = 0;
+}
+
+bool tocIndexAdd(tocIndex_t* index, const char* group, const char* name, const uint16_t entry, const uint16_t data) {
+  const uint32_t size = (uint32_t)index->mask + 1;
+  if ((index->count + 1) * 100 > size * TOC_INDEX_MAX_LOAD_PERCENT) {
+    return false;
+  }
+
+  uint32_t slot = hash(group, name) & index->mask;
+  while (index->slots[slot].entry != 0) {
+    slot = (slot + 1) & index->mask;
+  }
+
+  index->slots[slot].entry = entry + 1;
+  index->slots[slot].data = data;
+  index->count++;
+
+  return true;
+}
+
+int tocIndexFind(const tocIndex_t* index, const char* group, const char* name, tocIndexMatch_t match, uint16_t* data) {
+  uint32_t slot = hash(group, name) & index->mask;
+
+  while (index->slots[slot].entry != 0) {
+    const uint16_t entry = index->slots[slot].entry - 1;
+    if (match(entry, group, name)) {
+      if (data) {
+        *data = index->slots[slot].data;
+      }
+      return entry;
+    }
+    slot = (slot + 1) & index->mask;
+  }
+
+  return -1;
+}
@@ -0,0 +1,52 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * welford.c - Streaming mean and variance, O(1) per sample
+ */
+
+#include "welford.h"
+
+void welfordInit(welford_t* w) {
+  w->count = 0;
+  w->mean = 0.0f;
+  w->m2 = 0.0f;
+}
+
+void welfordAdd(welford_t* w, const float value) {
+  w->count++;
+  const float delta = value - w->mean;
+  w->mean += delta / w->count;
+  w->m2 += delta * (value - w->mean);
+}
+
+float welfordMean(const welford_t* w) {
+  return w->mean;
+}
+
+float welfordVariance(const welford_t* w) {
+  if (w->count < 2) {
+    return 0.0f;
+  }
+
+  return w->m2 / w->count;
+}
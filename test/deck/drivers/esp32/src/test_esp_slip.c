@@ -329,6 +329,57 @@ void testThatTheBufferIsClearedBeforeWritingSomething()
   TEST_ASSERT_EQUAL_INT32(0, mockGetCharDirtCounter);
 }
 
+void testThatASentPacketCanBeReceivedLater()
+{
+  // Fixture
+  const uint8_t command = 0x17;
+
+  espSlipSendPacket_t senderPckt;
+  senderPckt.command = command;
+  senderPckt.dataSize = 0x03;
+
+  uint8_t sendBuffer[14];
+  sendBuffer[9] = 6;
+  sendBuffer[10] = 7;
+  sendBuffer[11] = 8;
+
+  espSlipReceivePacket_t receiverPckt;
+  setupEmptyReceivePacket(&receiverPckt, command);
+
+  // Test
+  espSlipSend(&sendBuffer[0], &senderPckt, mockPutChar, mockGetChar);
+  const int receivedBeforeResponse = mockGetCharBufIndex;
+  bool actual = espSlipReceive(&receiverPckt, &senderPckt, mockGetChar, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT32(0, receivedBeforeResponse);
+  TEST_ASSERT_EQUAL_HEX8(0x06, mockPutCharBuf[9]);
+  TEST_ASSERT_EQUAL_HEX8(0xC0, mockPutCharBuf[12]); // end byte
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatCompressedFlashDataHasAChecksum()
+{
+  // Fixture
+  espSlipSendPacket_t senderPckt;
+  senderPckt.command = FLASH_DEFL_DATA;
+  senderPckt.dataSize = ESP_SLIP_ADDITIONAL_DATA_OVERHEAD_LEN + 2;
+
+  uint8_t sendBuffer[ESP_SLIP_DATA_START + 2 + ESP_SLIP_STOP_CODE_LEN];
+  memset(sendBuffer, 0, sizeof(sendBuffer));
+  sendBuffer[ESP_SLIP_DATA_START + 0] = 0x12;
+  sendBuffer[ESP_SLIP_DATA_START + 1] = 0x34;
+
+  espSlipReceivePacket_t receiverPckt;
+  setupEmptyReceivePacket(&receiverPckt, FLASH_DEFL_DATA);
+
+  // Test
+  espSlipExchange(&sendBuffer[0], &receiverPckt, &senderPckt, mockPutChar, mockGetChar, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_HEX8(0xEF ^ 0x12 ^ 0x34, mockPutCharBuf[5]);
+}
+
 // Helpers ///////////////////////////////////////////////////////////////////////////////////////////////
 
 static void mockPutChar(uint32_t size, uint8_t *data)
@@ -0,0 +1,267 @@
+// File under test lpsAnchorTable.c
+#include "lpsAnchorTable.h"
+
+#include <string.h>
+#include "unity.h"
+#include "crc32.h"
+
+static lpsAnchorTable_t table;
+static uint8_t buffer[LPS_ANCHOR_TABLE_MAX_SERIALIZED_SIZE];
+
+static point_t createPosition(const float x, const float y, const float z);
+
+void setUp(void) {
+  lpsAnchorTableInit(&table);
+  memset(buffer, 0, sizeof(buffer));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatPositionsCanBeSetAndRead() {
+  // Fixture
+  const point_t expected = createPosition(1.0f, 2.0f, 3.0f);
+  point_t actual;
+
+  // Test
+  lpsAnchorTableSet(&table, 17, &expected);
+
+  // Assert
+  TEST_ASSERT_TRUE(lpsAnchorTableGet(&table, 17, &actual));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, actual.x);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual.y);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, actual.z);
+  TEST_ASSERT_FALSE(lpsAnchorTableGet(&table, 18, &actual));
+}
+
+void testThatSettingAnExistingAnchorUpdatesThePosition() {
+  // Fixture
+  const point_t first = createPosition(1.0f, 2.0f, 3.0f);
+  const point_t second = createPosition(4.0f, 5.0f, 6.0f);
+  lpsAnchorTableSet(&table, 3, &first);
+  point_t actual;
+
+  // Test
+  lpsAnchorTableSet(&table, 3, &second);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, table.count);
+  lpsAnchorTableGet(&table, 3, &actual);
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, actual.x);
+}
+
+void testThatEntriesAreSortedById() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+
+  // Test
+  lpsAnchorTableSet(&table, 7, &position);
+  lpsAnchorTableSet(&table, 2, &position);
+  lpsAnchorTableSet(&table, 200, &position);
+  lpsAnchorTableSet(&table, 5, &position);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(4, table.count);
+  TEST_ASSERT_EQUAL_UINT8(2, table.entries[0].id);
+  TEST_ASSERT_EQUAL_UINT8(5, table.entries[1].id);
+  TEST_ASSERT_EQUAL_UINT8(7, table.entries[2].id);
+  TEST_ASSERT_EQUAL_UINT8(200, table.entries[3].id);
+}
+
+void testThatANewAnchorIsRejectedWhenTheTableIsFull() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  for (int i = 0; i < LPS_ANCHOR_TABLE_MAX_ANCHORS; i++) {
+    lpsAnchorTableSet(&table, i, &position);
+  }
+
+  // Test
+  const bool actualNew = lpsAnchorTableSet(&table, LPS_ANCHOR_TABLE_MAX_ANCHORS, &position);
+  const bool actualExisting = lpsAnchorTableSet(&table, 0, &position);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualNew);
+  TEST_ASSERT_TRUE(actualExisting);
+  TEST_ASSERT_EQUAL_UINT8(LPS_ANCHOR_TABLE_MAX_ANCHORS, table.count);
+}
+
+void testThatTheCrcDoesNotDependOnTheOrderAnchorsAreAdded() {
+  // Fixture
+  const point_t positionA = createPosition(1.0f, 2.0f, 3.0f);
+  const point_t positionB = createPosition(4.0f, 5.0f, 6.0f);
+  lpsAnchorTable_t other;
+  lpsAnchorTableInit(&other);
+
+  lpsAnchorTableSet(&table, 1, &positionA);
+  lpsAnchorTableSet(&table, 2, &positionB);
+
+  // Test
+  lpsAnchorTableSet(&other, 2, &positionB);
+  lpsAnchorTableSet(&other, 1, &positionA);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(lpsAnchorTableCrc(&table), lpsAnchorTableCrc(&other));
+}
+
+void testThatTheCrcChangesWhenAPositionChanges() {
+  // Fixture
+  const point_t first = createPosition(1.0f, 2.0f, 3.0f);
+  const point_t second = createPosition(1.0f, 2.0f, 3.5f);
+  lpsAnchorTableSet(&table, 1, &first);
+  const uint32_t crcBefore = lpsAnchorTableCrc(&table);
+
+  // Test
+  lpsAnchorTableSet(&table, 1, &second);
+
+  // Assert
+  TEST_ASSERT_NOT_EQUAL(crcBefore, lpsAnchorTableCrc(&table));
+}
+
+void testThatASerializedTableHasHeaderAndEntries() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 4, &position);
+  lpsAnchorTableSet(&table, 9, &position);
+
+  // Test
+  const size_t actual = lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(8 + 2 * 13, actual);
+  TEST_ASSERT_EQUAL_UINT32(actual, lpsAnchorTableSerializedSize(buffer, actual));
+
+  const lpsAnchorTableHeader_t* header = (const lpsAnchorTableHeader_t*)buffer;
+  TEST_ASSERT_EQUAL_UINT8(LPS_ANCHOR_TABLE_FORMAT_VERSION, header->formatVersion);
+  TEST_ASSERT_EQUAL_UINT8(2, header->anchorCount);
+  TEST_ASSERT_EQUAL_UINT32(crc32CalculateBuffer(&buffer[8], 2 * 13), header->crc);
+  TEST_ASSERT_EQUAL_UINT8(4, buffer[8]);
+  TEST_ASSERT_EQUAL_UINT8(9, buffer[8 + 13]);
+}
+
+void testThatSerializationFailsIfTheBufferIsTooSmall() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 4, &position);
+
+  // Test
+  const size_t actual = lpsAnchorTableSerialize(&table, buffer, 8 + 12);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, actual);
+}
+
+void testThatTheSizeIsUnknownUntilTheFullHeaderIsAvailable() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 4, &position);
+  lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+
+  // Test
+  const size_t actual = lpsAnchorTableSerializedSize(buffer, 7);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, actual);
+}
+
+void testThatASerializedTableCanBeDeserialized() {
+  // Fixture
+  const point_t positionA = createPosition(1.0f, 2.0f, 3.0f);
+  const point_t positionB = createPosition(-4.0f, 5.0f, 6.0f);
+  lpsAnchorTableSet(&table, 1, &positionA);
+  lpsAnchorTableSet(&table, 12, &positionB);
+  const size_t length = lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+
+  lpsAnchorTable_t actual;
+  lpsAnchorTableInit(&actual);
+  point_t actualPosition;
+
+  // Test
+  const bool isValid = lpsAnchorTableDeserialize(&actual, buffer, length);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT8(2, actual.count);
+  TEST_ASSERT_EQUAL_UINT32(lpsAnchorTableCrc(&table), lpsAnchorTableCrc(&actual));
+  TEST_ASSERT_TRUE(lpsAnchorTableGet(&actual, 12, &actualPosition));
+  TEST_ASSERT_EQUAL_FLOAT(-4.0f, actualPosition.x);
+}
+
+void testThatATableWithBadCrcIsRejectedAndTheTableIsNotModified() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 1, &position);
+  const size_t length = lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+  buffer[length - 1] ^= 0x01;
+
+  lpsAnchorTable_t actual;
+  lpsAnchorTableInit(&actual);
+  lpsAnchorTableSet(&actual, 5, &position);
+
+  // Test
+  const bool isValid = lpsAnchorTableDeserialize(&actual, buffer, length);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+  TEST_ASSERT_EQUAL_UINT8(1, actual.count);
+  TEST_ASSERT_EQUAL_UINT8(5, actual.entries[0].id);
+}
+
+void testThatATruncatedTableIsRejected() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 1, &position);
+  lpsAnchorTableSet(&table, 2, &position);
+  const size_t length = lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+
+  lpsAnchorTable_t actual;
+  lpsAnchorTableInit(&actual);
+
+  // Test
+  const bool isValid = lpsAnchorTableDeserialize(&actual, buffer, length - 1);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+void testThatATableWithUnknownFormatVersionIsRejected() {
+  // Fixture
+  const point_t position = createPosition(1.0f, 2.0f, 3.0f);
+  lpsAnchorTableSet(&table, 1, &position);
+  const size_t length = lpsAnchorTableSerialize(&table, buffer, sizeof(buffer));
+  buffer[0] = LPS_ANCHOR_TABLE_FORMAT_VERSION + 1;
+
+  lpsAnchorTable_t actual;
+  lpsAnchorTableInit(&actual);
+
+  // Test
+  const bool isValid = lpsAnchorTableDeserialize(&actual, buffer, length);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+void testThatATableWithUnsortedIdsIsRejected() {
+  // Fixture
+  lpsAnchorTableHeader_t header = {.formatVersion = LPS_ANCHOR_TABLE_FORMAT_VERSION, .anchorCount = 2};
+  lpsAnchorTableEntry_t entries[2] = {{.id = 5}, {.id = 3}};
+  header.crc = crc32CalculateBuffer(entries, sizeof(entries));
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(&buffer[sizeof(header)], entries, sizeof(entries));
+
+  lpsAnchorTable_t actual;
+  lpsAnchorTableInit(&actual);
+
+  // Test
+  const bool isValid = lpsAnchorTableDeserialize(&actual, buffer, sizeof(header) + sizeof(entries));
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static point_t createPosition(const float x, const float y, const float z) {
+  point_t position = {.timestamp = 1, .x = x, .y = y, .z = z};
+  return position;
+}
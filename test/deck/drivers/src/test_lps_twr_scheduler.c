@@ -0,0 +1,237 @@
+// File under test lpsTwrScheduler.c
+#include "lpsTwrScheduler.h"
+
+#include <string.h>
+#include "unity.h"
+
+#define ANCHOR_COUNT 6
+#define FAILURE_THRESHOLD 3
+
+static lpsTwrScheduler_t scheduler;
+static point_t anchorPositions[ANCHOR_COUNT];
+static float posCov[3][3];
+static point_t tagPos;
+
+static const uint32_t allPositionsValid = (1 << ANCHOR_COUNT) - 1;
+
+static void failRanging(const uint8_t anchor, const int count, const uint32_t nowMs);
+static void rangeAllAnchors(const uint32_t nowMs);
+
+void setUp(void) {
+  lpsTwrSchedulerInit(&scheduler, ANCHOR_COUNT, FAILURE_THRESHOLD);
+
+  memset(anchorPositions, 0, sizeof(anchorPositions));
+  memset(posCov, 0, sizeof(posCov));
+  memset(&tagPos, 0, sizeof(tagPos));
+
+  // Anchors along the axes
+  anchorPositions[0].x = 5.0f;
+  anchorPositions[1].x = -5.0f;
+  anchorPositions[2].y = 5.0f;
+  anchorPositions[3].y = -5.0f;
+  anchorPositions[4].z = 5.0f;
+  anchorPositions[5].z = -5.0f;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatRoundRobinModeRangesAnchorsInOrder() {
+  // Fixture
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  const uint8_t actual6 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual1);
+  TEST_ASSERT_EQUAL_UINT8(2, actual2);
+  TEST_ASSERT_EQUAL_UINT8(0, actual6);
+}
+
+void testThatAdaptiveModeFallsBackToRoundRobinWithoutAnchorPositions() {
+  // Fixture
+  posCov[0][0] = 1.0f;
+
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, 0, 0);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, 0, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual1);
+  TEST_ASSERT_EQUAL_UINT8(2, actual2);
+}
+
+void testThatAdaptiveModeSelectsAnchorAlongTheMostUncertainDirection() {
+  // Fixture
+  const uint32_t now = 1000;
+  rangeAllAnchors(now);
+
+  posCov[0][0] = 0.01f;
+  posCov[1][1] = 0.01f;
+  posCov[2][2] = 1.0f;
+
+  // Test
+  const uint8_t actual = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, allPositionsValid, now + 10);
+
+  // Assert
+  // Anchors 4 and 5 are on the z-axis, ties are broken in round robin order after the current anchor
+  TEST_ASSERT_TRUE(actual == 4 || actual == 5);
+}
+
+void testThatAdaptiveModeAlternatesBetweenEquallyGoodAnchors() {
+  // Fixture
+  const uint32_t now = 1000;
+  rangeAllAnchors(now);
+
+  posCov[2][2] = 1.0f;
+
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, allPositionsValid, now + 10);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, allPositionsValid, now + 20);
+
+  // Assert
+  TEST_ASSERT_NOT_EQUAL(actual1, actual2);
+  TEST_ASSERT_TRUE(actual1 == 4 || actual1 == 5);
+  TEST_ASSERT_TRUE(actual2 == 4 || actual2 == 5);
+}
+
+void testThatAnchorThatHasNotBeenRangedForALongTimeIsSelectedFirst() {
+  // Fixture
+  const uint32_t now = 10000;
+  rangeAllAnchors(now);
+  // Anchor 1 was ranged a long time ago
+  lpsTwrSchedulerReportResult(&scheduler, 1, true, now - LPS_TWR_SCHEDULER_MAX_AGE_MS - 100);
+
+  posCov[2][2] = 1.0f;
+
+  // Test
+  const uint8_t actual = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeAdaptive, &tagPos, posCov, anchorPositions, allPositionsValid, now);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual);
+}
+
+void testThatAnchorIsSuspendedAfterRepeatedFailures() {
+  // Fixture
+  // Test
+  failRanging(2, FAILURE_THRESHOLD, 100);
+
+  // Assert
+  TEST_ASSERT_TRUE(lpsTwrSchedulerIsSuspended(&scheduler, 2));
+  TEST_ASSERT_FALSE(lpsTwrSchedulerIsSuspended(&scheduler, 1));
+}
+
+void testThatSuspendedAnchorIsSkipped() {
+  // Fixture
+  failRanging(2, FAILURE_THRESHOLD, 100);
+
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 200);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 200);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual1);
+  TEST_ASSERT_EQUAL_UINT8(3, actual2);
+}
+
+void testThatSuspendedAnchorIsProbedWhenSuspensionHasExpired() {
+  // Fixture
+  failRanging(2, FAILURE_THRESHOLD, 100);
+  const uint32_t now = 100 + LPS_TWR_SCHEDULER_SUSPEND_MIN_MS;
+
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, now);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, now);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual1);
+  TEST_ASSERT_EQUAL_UINT8(2, actual2);
+}
+
+void testThatFailedProbeDoublesTheSuspensionTime() {
+  // Fixture
+  failRanging(2, FAILURE_THRESHOLD, 100);
+  const uint32_t probeTime = 100 + LPS_TWR_SCHEDULER_SUSPEND_MIN_MS;
+
+  // Test
+  lpsTwrSchedulerReportResult(&scheduler, 2, false, probeTime);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(2 * LPS_TWR_SCHEDULER_SUSPEND_MIN_MS, scheduler.anchors[2].suspendTimeMs);
+  TEST_ASSERT_EQUAL_UINT32(probeTime + 2 * LPS_TWR_SCHEDULER_SUSPEND_MIN_MS, scheduler.anchors[2].suspendedUntilMs);
+}
+
+void testThatSuccessfulRangingResumesAnchor() {
+  // Fixture
+  failRanging(2, FAILURE_THRESHOLD, 100);
+
+  // Test
+  lpsTwrSchedulerReportResult(&scheduler, 2, true, 2000);
+
+  // Assert
+  TEST_ASSERT_FALSE(lpsTwrSchedulerIsSuspended(&scheduler, 2));
+  TEST_ASSERT_EQUAL_UINT16(LPS_TWR_SCHEDULER_SUSPEND_MIN_MS, scheduler.anchors[2].suspendTimeMs);
+}
+
+void testThatAnchorIsRangedInBursts() {
+  // Fixture
+  lpsTwrSchedulerSetBurstSize(&scheduler, 3);
+
+  // Test
+  const uint8_t actual1 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  const uint8_t actual2 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  const uint8_t actual3 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  const uint8_t actual4 = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual1);
+  TEST_ASSERT_EQUAL_UINT8(1, actual2);
+  TEST_ASSERT_EQUAL_UINT8(1, actual3);
+  TEST_ASSERT_EQUAL_UINT8(2, actual4);
+}
+
+void testThatBurstIsAbortedWhenAnchorIsSuspended() {
+  // Fixture
+  lpsTwrSchedulerSetBurstSize(&scheduler, 3);
+  const uint8_t first = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+  failRanging(first, FAILURE_THRESHOLD, 0);
+
+  // Test
+  const uint8_t actual = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, actual);
+}
+
+void testThatTheAnchorFirstToResumeIsSelectedWhenAllAreSuspended() {
+  // Fixture
+  for (int i = 0; i < ANCHOR_COUNT; i++) {
+    failRanging(i, FAILURE_THRESHOLD, 100 + i);
+  }
+  failRanging(0, 1, 150);
+
+  // Test
+  const uint8_t actual = lpsTwrSchedulerNext(&scheduler, lpsTwrSchedulerModeRoundRobin, 0, 0, anchorPositions, 0, 200);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void failRanging(const uint8_t anchor, const int count, const uint32_t nowMs) {
+  for (int i = 0; i < count; i++) {
+    lpsTwrSchedulerReportResult(&scheduler, anchor, false, nowMs);
+  }
+}
+
+static void rangeAllAnchors(const uint32_t nowMs) {
+  for (int i = 0; i < ANCHOR_COUNT; i++) {
+    lpsTwrSchedulerReportResult(&scheduler, i, true, nowMs);
+  }
+}
@@ -20,6 +20,8 @@ void arm_std_f32(const float32_t * pSrc, uint32_t blockSize, float32_t * pResult
 void arm_mean_f32(const float32_t * pSrc, uint32_t blockSize, float32_t * pResult) { *pResult = 0.0; }
 
 #include "mock_estimator.h"
+#include "mock_estimator_kalman.h"
+#include "lpsTwrScheduler.h"
 
 #include "freertosMocks.h"
 
@@ -0,0 +1,200 @@
+// File under test p2p_relay.c
+#include "p2p_relay.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+#define OWN_ID 7
+#define SENT_MAX 4
+
+static uint32_t nowMs;
+static uint64_t sharedTimeUs;
+static bool hasTimeBase;
+static P2PPacket sent[SENT_MAX];
+static int sentCount;
+
+static P2PPacket createRelayed(uint8_t origin, uint8_t seq, uint8_t ttl);
+
+void setUp(void) {
+  nowMs = 1000;
+  sharedTimeUs = 5000000;
+  hasTimeBase = true;
+  sentCount = 0;
+  p2pRelayInit();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatARelayedPacketIsDeliveredOnThePayloadPort() {
+  // Fixture
+  P2PPacket packet = createRelayed(3, 10, 1);
+
+  // Test
+  bool actual = p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT8(5, packet.port);
+  TEST_ASSERT_EQUAL_UINT8(2, packet.size);
+  TEST_ASSERT_EQUAL_UINT8(0xAB, packet.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(0xCD, packet.data[1]);
+}
+
+void testThatADuplicateIsDropped() {
+  // Fixture
+  P2PPacket packet = createRelayed(3, 10, 1);
+  p2pRelayHandleReceived(&packet);
+  packet = createRelayed(3, 10, 1);
+
+  // Test
+  bool actual = p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatOwnPacketsAreDropped() {
+  // Fixture
+  P2PPacket packet = createRelayed(OWN_ID, 10, 3);
+
+  // Test
+  bool actual = p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_INT(0, sentCount);
+}
+
+void testThatAPacketIsRebroadcastWithOneHopLess() {
+  // Fixture
+  P2PPacket packet = createRelayed(3, 10, 3);
+
+  // Test
+  p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  p2pRelayHeader_t header;
+  memcpy(&header, sent[0].data, sizeof(header));
+  TEST_ASSERT_EQUAL_UINT8(P2P_RELAY_PORT, sent[0].port);
+  TEST_ASSERT_EQUAL_UINT8(3, header.origin);
+  TEST_ASSERT_EQUAL_UINT8(2, header.ttl);
+  TEST_ASSERT_EQUAL_UINT8(1, header.hops);
+  TEST_ASSERT_EQUAL_UINT16(4990, header.sentMs);
+}
+
+void testThatAPacketIsNotRebroadcastAtTheLastHop() {
+  // Fixture
+  P2PPacket packet = createRelayed(3, 10, 1);
+
+  // Test
+  p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, sentCount);
+}
+
+void testThatRebroadcastsAreRateLimited() {
+  // Fixture
+  for (uint8_t seq = 0; seq < SENT_MAX; seq++) {
+    P2PPacket packet = createRelayed(3, seq, 3);
+    p2pRelayHandleReceived(&packet);
+  }
+  TEST_ASSERT_TRUE(sentCount < SENT_MAX);
+  const int sentBefore = sentCount;
+
+  // Test
+  nowMs += 1000;
+  P2PPacket packet = createRelayed(3, SENT_MAX, 3);
+  p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(sentBefore + 1, sentCount);
+}
+
+void testThatOtherPortsAreDeliveredUnchanged() {
+  // Fixture
+  P2PPacket packet = {.port = 5, .size = 1, .data = {0x12}};
+
+  // Test
+  bool actual = p2pRelayHandleReceived(&packet);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT8(5, packet.port);
+  TEST_ASSERT_EQUAL_UINT8(1, packet.size);
+}
+
+void testThatASentPacketGetsTheRelayHeader() {
+  // Fixture
+  P2PPacket packet = {.port = 5, .size = 1, .data = {0x12}};
+
+  // Test
+  bool actual = p2pRelaySendBroadcast(&packet, 4);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  p2pRelayHeader_t header;
+  memcpy(&header, sent[0].data, sizeof(header));
+  TEST_ASSERT_EQUAL_UINT8(sizeof(header) + 1, sent[0].size);
+  TEST_ASSERT_EQUAL_UINT8(OWN_ID, header.origin);
+  TEST_ASSERT_EQUAL_UINT8(4, header.ttl);
+  TEST_ASSERT_EQUAL_UINT8(5, header.port);
+  TEST_ASSERT_EQUAL_UINT8(P2P_RELAY_FLAG_SHARED_TIME, header.flags);
+  TEST_ASSERT_EQUAL_UINT16(5000, header.sentMs);
+  TEST_ASSERT_EQUAL_UINT8(0x12, sent[0].data[sizeof(header)]);
+}
+
+void testThatAPacketWithoutTimeBaseIsNotFlagged() {
+  // Fixture
+  hasTimeBase = false;
+  P2PPacket packet = {.port = 5, .size = 1, .data = {0x12}};
+
+  // Test
+  p2pRelaySendBroadcast(&packet, 4);
+
+  // Assert
+  p2pRelayHeader_t header;
+  memcpy(&header, sent[0].data, sizeof(header));
+  TEST_ASSERT_EQUAL_UINT8(0, header.flags);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+uint32_t xTaskGetTickCount() {
+  return nowMs;
+}
+
+uint8_t radiolinkP2PGetId(void) {
+  return OWN_ID;
+}
+
+uint64_t radiolinkP2PSharedTimeUs(void) {
+  return sharedTimeUs;
+}
+
+bool radiolinkP2PHasTimeBase(void) {
+  return hasTimeBase;
+}
+
+bool radiolinkSendP2PPacketBroadcast(P2PPacket *p2pp) {
+  if (sentCount >= SENT_MAX) {
+    return false;
+  }
+  sent[sentCount++] = *p2pp;
+  return true;
+}
+
+static P2PPacket createRelayed(uint8_t origin, uint8_t seq, uint8_t ttl) {
+  // Sent 10 ms ago, in swarm time
+  const p2pRelayHeader_t header = {.origin = origin, .seq = seq, .ttl = ttl, .hops = 0, .port = 5, .flags = P2P_RELAY_FLAG_SHARED_TIME, .sentMs = 4990};
+  const uint8_t payload[] = {0xAB, 0xCD};
+
+  P2PPacket packet = {.port = P2P_RELAY_PORT, .size = sizeof(header) + sizeof(payload)};
+  memcpy(packet.data, &header, sizeof(header));
+  memcpy(packet.data + sizeof(header), payload, sizeof(payload));
+  return packet;
+}
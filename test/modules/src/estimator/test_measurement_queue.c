@@ -0,0 +1,203 @@
+// File under test measurement_queue.c
+#include "measurement_queue.h"
+
+#include <string.h>
+#include "unity.h"
+
+static measurementQueue_t queue;
+
+static measurement_t createMeasurement(const MeasurementType type, const float value) {
+  measurement_t measurement;
+  memset(&measurement, 0, sizeof(measurement));
+  measurement.type = type;
+  measurement.data.tof.distance = value;
+  return measurement;
+}
+
+static void pushMeasurement(const MeasurementType type, const float value, const uint32_t nowMs) {
+  measurement_t measurement = createMeasurement(type, value);
+  measurementQueuePush(&queue, &measurement, nowMs);
+}
+
+void setUp(void) {
+  measurementQueueInit(&queue);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatEmptyQueueReturnsNothing() {
+  // Fixture
+  measurement_t actual;
+
+  // Test
+  bool result = measurementQueuePop(&queue, &actual, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
+
+void testThatMeasurementsAreReturnedInOrder() {
+  // Fixture
+  pushMeasurement(MeasurementTypeTDOA, 1.0f, 0);
+  pushMeasurement(MeasurementTypeGyroscope, 2.0f, 0);
+  pushMeasurement(MeasurementTypeSweepAngle, 3.0f, 0);
+
+  measurement_t actual;
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTDOA, actual.type);
+  TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeGyroscope, actual.type);
+  TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeSweepAngle, actual.type);
+  TEST_ASSERT_FALSE(measurementQueuePop(&queue, &actual, 0));
+}
+
+void testThatFlowMeasurementIsCoalesced() {
+  // Fixture
+  pushMeasurement(MeasurementTypeFlow, 1.0f, 0);
+  pushMeasurement(MeasurementTypeTDOA, 2.0f, 0);
+
+  // Test
+  pushMeasurement(MeasurementTypeFlow, 3.0f, 0);
+
+  // Assert
+  measurement_t actual;
+  TEST_ASSERT_EQUAL_UINT8(2, queue.depth);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeFlow].coalesced);
+
+  TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeFlow, actual.type);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, actual.data.tof.distance);
+}
+
+void testThatSweepAnglesAreNotCoalesced() {
+  // Fixture
+  pushMeasurement(MeasurementTypeSweepAngle, 1.0f, 0);
+
+  // Test
+  pushMeasurement(MeasurementTypeSweepAngle, 2.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, queue.depth);
+  TEST_ASSERT_EQUAL_UINT8(2, queue.stats[MeasurementTypeSweepAngle].depth);
+}
+
+void testThatLowPriorityMeasurementIsEvictedWhenFull() {
+  // Fixture
+  pushMeasurement(MeasurementTypeTOF, 1.0f, 0);
+  for (int i = 1; i < MEASUREMENT_QUEUE_SIZE; i++) {
+    pushMeasurement(MeasurementTypeGyroscope, 1.0f, 0);
+  }
+  measurement_t tdoa = createMeasurement(MeasurementTypeTDOA, 2.0f);
+
+  // Test
+  bool actual = measurementQueuePush(&queue, &tdoa, 0);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT8(MEASUREMENT_QUEUE_SIZE, queue.depth);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeTOF].evicted);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeTOF].dropped);
+  TEST_ASSERT_EQUAL_UINT8(0, queue.stats[MeasurementTypeTOF].depth);
+}
+
+void testThatOldestMeasurementWithLowestPriorityIsEvicted() {
+  // Fixture
+  for (int i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+    pushMeasurement(MeasurementTypeGyroscope, (float)i, 0);
+  }
+  measurement_t tdoa = createMeasurement(MeasurementTypeTDOA, 2.0f);
+
+  // Test
+  measurementQueuePush(&queue, &tdoa, 0);
+
+  // Assert
+  measurement_t actual;
+  TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, actual.data.tof.distance);
+}
+
+void testThatMeasurementIsRejectedWhenFullOfHigherPriority() {
+  // Fixture
+  for (int i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+    pushMeasurement(MeasurementTypeSweepAngle, 1.0f, 0);
+  }
+  measurement_t gyro = createMeasurement(MeasurementTypeGyroscope, 2.0f);
+
+  // Test
+  bool actual = measurementQueuePush(&queue, &gyro, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeGyroscope].rejected);
+  TEST_ASSERT_EQUAL_UINT32(0, queue.stats[MeasurementTypeSweepAngle].dropped);
+}
+
+void testThatMeasurementIsRejectedWhenFullOfSamePriority() {
+  // Fixture
+  for (int i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+    pushMeasurement(MeasurementTypeTDOA, 1.0f, 0);
+  }
+  measurement_t tdoa = createMeasurement(MeasurementTypeTDOA, 2.0f);
+
+  // Test
+  bool actual = measurementQueuePush(&queue, &tdoa, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeTDOA].rejected);
+}
+
+void testThatStaleMeasurementIsDiscarded() {
+  // Fixture
+  pushMeasurement(MeasurementTypeFlow, 1.0f, 1000);
+  pushMeasurement(MeasurementTypeTDOA, 2.0f, 1000);
+
+  // Test
+  measurement_t actual;
+  bool result = measurementQueuePop(&queue, &actual, 2000);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_INT(MeasurementTypeTDOA, actual.type);
+  TEST_ASSERT_EQUAL_UINT32(1, queue.stats[MeasurementTypeFlow].stale);
+  TEST_ASSERT_EQUAL_UINT8(0, queue.depth);
+}
+
+void testThatAbsoluteMeasurementIsNotDiscardedByAge() {
+  // Fixture
+  pushMeasurement(MeasurementTypeTDOA, 2.0f, 1000);
+
+  // Test
+  measurement_t actual;
+  bool result = measurementQueuePop(&queue, &actual, 60000);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+}
+
+void testThatAllSlotsCanBeReused() {
+  // Fixture
+  measurement_t actual;
+
+  // Test
+  for (int n = 0; n < 3; n++) {
+    for (int i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+      pushMeasurement(MeasurementTypeSweepAngle, (float)i, 0);
+    }
+    for (int i = 0; i < MEASUREMENT_QUEUE_SIZE; i++) {
+      // Assert
+      TEST_ASSERT_TRUE(measurementQueuePop(&queue, &actual, 0));
+      TEST_ASSERT_EQUAL_FLOAT((float)i, actual.data.tof.distance);
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_FALSE(measurementQueuePop(&queue, &actual, 0));
+  TEST_ASSERT_EQUAL_UINT8(MEASUREMENT_QUEUE_SIZE, queue.stats[MeasurementTypeSweepAngle].maxDepth);
+}
@@ -0,0 +1,129 @@
+// File under test position_estimator_altitude.c
+#include "position_estimator.h"
+
+#include <string.h>
+
+#include "unity.h"
+#include "physicalConstants.h"
+
+static state_t estimate;
+
+static void addBaro(float asl, uint32_t timestamp);
+static void addTof(float distance, uint32_t timestamp);
+static void addAccSamples(float acc, uint32_t from, uint32_t to, uint32_t period);
+
+void setUp(void) {
+  positionAltitudeReset();
+  memset(&estimate, 0, sizeof(estimate));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheFirstBaroSampleInitializesTheHeight() {
+  // Fixture
+  addAccSamples(0.0f, 0, 10, 2);
+
+  // Test
+  addBaro(12.5f, 10);
+
+  // Assert
+  positionAltitudeGetEstimate(&estimate);
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, estimate.position.z);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, estimate.velocity.z);
+}
+
+void testThatTheHeightConvergesToIrregularBaroSamples() {
+  // Fixture
+  addBaro(10.0f, 0);
+
+  // Test
+  uint32_t timestamp = 0;
+  for (int i = 0; i < 400; i++) {
+    const uint32_t period = (i % 3 == 0) ? 45 : 20;
+    addAccSamples(0.0f, timestamp, timestamp + period, 2);
+    timestamp += period;
+    addBaro(11.0f, timestamp);
+  }
+
+  // Assert
+  positionAltitudeGetEstimate(&estimate);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 11.0f, estimate.position.z);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, estimate.velocity.z);
+}
+
+void testThatTheAccelerationIsIntegratedWithTheSampleTimes() {
+  // Fixture
+  addBaro(0.0f, 0);
+  const float acc = 0.5f;
+
+  // Test
+  addAccSamples(acc, 0, 100, 4);
+
+  // Assert
+  positionAltitudeGetEstimate(&estimate);
+  // Minus the default deadband of 0.04 g
+  const float expectedVz = (acc - 0.04f) * GRAVITY_MAGNITUDE * 0.1f;
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expectedVz, estimate.velocity.z);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f * expectedVz * 0.1f, estimate.position.z);
+}
+
+void testThatTheTofReplacesTheBaroAsHeightReference() {
+  // Fixture
+  addBaro(100.0f, 0);
+  addAccSamples(0.0f, 0, 20, 2);
+
+  // Test
+  addTof(0.3f, 20);
+  addAccSamples(0.0f, 20, 40, 2);
+  addBaro(100.0f, 40);
+
+  // Assert
+  positionAltitudeGetEstimate(&estimate);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.3f, estimate.position.z);
+}
+
+void testThatALateSampleIsComparedWithTheHeightAtItsTime() {
+  // Fixture
+  addTof(0.0f, 0);
+  addAccSamples(0.5f, 0, 100, 2);
+  positionAltitudeGetEstimate(&estimate);
+  const state_t expected = estimate;
+
+  // The sample was taken 20 ms before the latest acceleration sample
+  const float heightAtSample = expected.position.z - expected.velocity.z * 0.02f;
+
+  // Test
+  addTof(heightAtSample, 80);
+
+  // Assert
+  positionAltitudeGetEstimate(&estimate);
+  TEST_ASSERT_TRUE(expected.position.z > 0.01f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.position.z, estimate.position.z);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.velocity.z, estimate.velocity.z);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+uint32_t xTaskGetTickCount() {
+  return 0;
+}
+
+static void addBaro(float asl, uint32_t timestamp) {
+  baro_t baro = {.asl = asl};
+  positionAltitudeAddBaro(&baro, timestamp);
+}
+
+static void addTof(float distance, uint32_t timestamp) {
+  tofMeasurement_t tof = {.timestamp = timestamp, .distance = distance, .stdDev = 0.01f};
+  positionAltitudeAddTof(&tof);
+}
+
+// Adds acceleration samples from (not including) from to (including) to
+static void addAccSamples(float acc, uint32_t from, uint32_t to, uint32_t period) {
+  positionAltitudeAddAcc(acc, from);
+  for (uint32_t t = from + period; t <= to; t += period) {
+    positionAltitudeAddAcc(acc, t);
+  }
+}
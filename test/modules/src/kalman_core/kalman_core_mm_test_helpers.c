@@ -3,7 +3,8 @@
 
 // Helpers to simplify testing of measurment model implementations in the kalman core
 
-// Use to set up expectations for one call to kalmanCoreScalarUpdate(). This helper does not support multiple calls.
+// Use to set up expectations for one call to kalmanCoreScalarUpdate(), or one call to kalmanCoreBatchUpdate() with a
+// single measurement. This helper does not support multiple calls.
 
 // Storage for expected values
 const kalmanCoreData_t* kcsus_expectedThis;
@@ -13,6 +14,7 @@ float kcsus_expectedStdMeasNoise;
 float kcsus_scalarUpadateWasCalled;
 
 void mock_kalmanCoreScalarUpdate_callback(kalmanCoreData_t* actualThis, arm_matrix_instance_f32* actualHm, float actualError, float actualStdMeasNoise, int cmock_num_calls);
+void mock_kalmanCoreBatchUpdate_callback(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls);
 
 // Inti the mock with default (unlikely) values
 void initKalmanCoreScalarUpdateExpectationsSingleCall() {
@@ -32,10 +34,12 @@ void setKalmanCoreScalarUpdateExpectationsSingleCall(const kalmanCoreData_t* exp
   kcsus_expectedStdMeasNoise = expectedStdMeasNoise;
 
   kalmanCoreScalarUpdate_StubWithCallback(mock_kalmanCoreScalarUpdate_callback);
+  kalmanCoreBatchUpdate_StubWithCallback(mock_kalmanCoreBatchUpdate_callback);
 }
 
 // Callback doing the validation work
 void mock_kalmanCoreScalarUpdate_callback(kalmanCoreData_t* actualThis, arm_matrix_instance_f32* actualHm, float actualError, float actualStdMeasNoise, int cmock_num_calls) {
+  TEST_ASSERT_FALSE_MESSAGE(kcsus_scalarUpadateWasCalled, "Only expect one call");
   kcsus_scalarUpadateWasCalled = true;
   TEST_ASSERT_EQUAL_INT_MESSAGE(0, cmock_num_calls, "Only expect one call");
   TEST_ASSERT_EQUAL_PTR_MESSAGE(kcsus_expectedThis, actualThis, "Unexpected this pointer");
@@ -51,6 +55,22 @@ void mock_kalmanCoreScalarUpdate_callback(kalmanCoreData_t* actualThis, arm_matr
   TEST_ASSERT_EQUAL_FLOAT_MESSAGE(kcsus_expectedStdMeasNoise, actualStdMeasNoise, "Unexpected value of stdMeasNoise");
 }
 
+// Callback doing the validation work for batch updates
+void mock_kalmanCoreBatchUpdate_callback(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls) {
+  TEST_ASSERT_FALSE_MESSAGE(kcsus_scalarUpadateWasCalled, "Only expect one call");
+  kcsus_scalarUpadateWasCalled = true;
+  TEST_ASSERT_EQUAL_INT_MESSAGE(0, cmock_num_calls, "Only expect one call");
+  TEST_ASSERT_EQUAL_PTR_MESSAGE(kcsus_expectedThis, actualThis, "Unexpected this pointer");
+  TEST_ASSERT_EQUAL_INT_MESSAGE(1, actualCount, "Only expect one measurement in the batch");
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-20, kcsus_expectedHm[i], actualMeasurements[0].h[i], "Unexpected value of element in Hm vector");
+  }
+
+  TEST_ASSERT_EQUAL_FLOAT_MESSAGE(kcsus_expectedError, actualMeasurements[0].error, "Unexpected value of error");
+  TEST_ASSERT_EQUAL_FLOAT_MESSAGE(kcsus_expectedStdMeasNoise, actualMeasurements[0].stdMeasNoise, "Unexpected value of stdMeasNoise");
+}
+
 void assertScalarUpdateWasCalled() {
   TEST_ASSERT_TRUE_MESSAGE(kcsus_scalarUpadateWasCalled, "kalmanCoreScalarUpdate() was never called");
 }
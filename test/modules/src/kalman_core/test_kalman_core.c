@@ -0,0 +1,484 @@
+// File under test kalman_core.c
+#include "kalman_core.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+// @BUILD_LIB ARM_DSP_MATH
+
+// Functions under test
+void symmetricSandwich(const float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_PACKED_DIM]);
+void predictCovarianceBlockSparse(const float A[KC_STATE_DIM][KC_STATE_DIM], float P[KC_STATE_PACKED_DIM]);
+void rank1JosephUpdate(float P[KC_STATE_PACKED_DIM], const float h[KC_STATE_DIM], const float K[KC_STATE_DIM], const float PHT[KC_STATE_DIM], const float R);
+void rotateCovarianceFirstOrder(float P[KC_STATE_PACKED_DIM], const float d0, const float d1, const float d2);
+
+static float A[KC_STATE_DIM][KC_STATE_DIM];
+static float P[KC_STATE_PACKED_DIM];
+static float expected[KC_STATE_PACKED_DIM];
+
+static float randomValue() {
+  return (float)rand() / (float)RAND_MAX - 0.5f;
+}
+
+// Fill A with the structure of the linearized dynamics: identity position block and zero blocks below the diagonal
+static void fillBlockUpperTriangular(float A[KC_STATE_DIM][KC_STATE_DIM]) {
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      const int blockRow = i / 3;
+      const int blockCol = j / 3;
+      if (blockRow == 0 && blockCol == 0) {
+        A[i][j] = (i == j) ? 1.0f : 0.0f;
+      } else if (blockRow <= blockCol) {
+        A[i][j] = randomValue();
+      } else {
+        A[i][j] = 0.0f;
+      }
+    }
+  }
+}
+
+static void fillSymmetric(float P[KC_STATE_PACKED_DIM]) {
+  for (int i = 0; i < KC_STATE_PACKED_DIM; i++) {
+    P[i] = randomValue();
+  }
+}
+
+static void assertPackedWithin(const float delta, const float expected[KC_STATE_PACKED_DIM], const float actual[KC_STATE_PACKED_DIM]) {
+  for (int i = 0; i < KC_STATE_PACKED_DIM; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(delta, expected[i], actual[i]);
+  }
+}
+
+void setUp(void) {
+  srand(4711);
+  memset(A, 0, sizeof(A));
+  memset(P, 0, sizeof(P));
+  memset(expected, 0, sizeof(expected));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatPackedIndexIsSymmetric() {
+  // Fixture
+  // Test
+  // Assert
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_EQUAL_INT(KC_PACKED_INDEX(i, j), KC_PACKED_INDEX(j, i));
+    }
+  }
+}
+
+void testThatPackedIndexCoversTheUpperTriangle() {
+  // Fixture
+  int expectedIndex = 0;
+
+  // Test
+  // Assert
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++) {
+      TEST_ASSERT_EQUAL_INT(expectedIndex, KC_PACKED_INDEX(i, j));
+      expectedIndex++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(KC_STATE_PACKED_DIM, expectedIndex);
+}
+
+void testThatSymmetricSandwichIsEqualToDenseMultiplication() {
+  // Fixture
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      A[i][j] = randomValue();
+    }
+  }
+  fillSymmetric(P);
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++) {
+      float sum = 0.0f;
+      for (int k = 0; k < KC_STATE_DIM; k++) {
+        for (int l = 0; l < KC_STATE_DIM; l++) {
+          sum += A[i][k] * P[KC_PACKED_INDEX(k, l)] * A[j][l];
+        }
+      }
+      expected[KC_PACKED_INDEX(i, j)] = sum;
+    }
+  }
+
+  // Test
+  symmetricSandwich(A, P);
+
+  // Assert
+  assertPackedWithin(1e-5f, expected, P);
+}
+
+void testThatBlockSparsePredictionIsEqualToDensePrediction() {
+  // Fixture
+  for (int n = 0; n < 10; n++) {
+    fillBlockUpperTriangular(A);
+    fillSymmetric(P);
+    memcpy(expected, P, sizeof(expected));
+    symmetricSandwich(A, expected);
+
+    // Test
+    predictCovarianceBlockSparse(A, P);
+
+    // Assert
+    assertPackedWithin(1e-5f, expected, P);
+  }
+}
+
+void testThatBlockSparsePredictionWithIdentityKeepsCovariance() {
+  // Fixture
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    A[i][i] = 1.0f;
+  }
+  fillSymmetric(P);
+  memcpy(expected, P, sizeof(expected));
+
+  // Test
+  predictCovarianceBlockSparse(A, P);
+
+  // Assert
+  assertPackedWithin(1e-7f, expected, P);
+}
+
+void testThatBatchUpdateIsEqualToSequentialScalarUpdates() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t expectedCore;
+  kalmanCoreData_t actualCore;
+  kalmanCoreInit(&expectedCore, &params, 0);
+  kalmanCoreInit(&actualCore, &params, 0);
+
+  float h[3][KC_STATE_DIM] = {{0}};
+  kalmanCoreScalarMeasurement_t measurements[3];
+  for (int n = 0; n < 3; n++) {
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      h[n][i] = randomValue();
+    }
+    measurements[n].h = h[n];
+    measurements[n].error = randomValue();
+    measurements[n].stdMeasNoise = 0.1f;
+  }
+
+  for (int n = 0; n < 3; n++) {
+    arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h[n]};
+    kalmanCoreScalarUpdate(&expectedCore, &H, measurements[n].error, measurements[n].stdMeasNoise);
+  }
+
+  // Test
+  kalmanCoreBatchUpdate(&actualCore, measurements, 3);
+
+  // Assert
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-7f, expectedCore.S[i], actualCore.S[i]);
+  }
+  assertPackedWithin(1e-7f, expectedCore.P, actualCore.P);
+  TEST_ASSERT_TRUE(actualCore.isUpdated);
+}
+
+void testThatAScalarUpdateWithANonFiniteInnovationIsDropped() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t expectedCore;
+  kalmanCoreData_t actualCore;
+  kalmanCoreInit(&expectedCore, &params, 0);
+  kalmanCoreInit(&actualCore, &params, 0);
+
+  float h[KC_STATE_DIM] = {0};
+  h[KC_STATE_Z] = 1.0f;
+  arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+
+  // Test
+  kalmanCoreScalarUpdate(&actualCore, &H, NAN, 0.1f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT_ARRAY(expectedCore.S, actualCore.S, KC_STATE_DIM);
+  assertPackedWithin(0.0f, expectedCore.P, actualCore.P);
+  TEST_ASSERT_EQUAL_UINT32(1, actualCore.nonFiniteUpdateCount);
+}
+
+void testThatRank1JosephUpdateIsEqualToDenseJosephUpdate() {
+  // Fixture
+  // A diagonally dominant, and thus positive definite, covariance
+  fillSymmetric(P);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    P[KC_PACKED_INDEX(i, i)] += 5.0f;
+  }
+
+  float h[KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    h[i] = randomValue();
+  }
+  const float R = 0.01f;
+
+  float PHT[KC_STATE_DIM] = {0};
+  float HPHR = R;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      PHT[i] += P[KC_PACKED_INDEX(i, j)] * h[j];
+    }
+    HPHR += h[i] * PHT[i];
+  }
+
+  float K[KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = PHT[i] / HPHR;
+  }
+
+  // The dense reference, (KH - I) P (KH - I)' + K R K'
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      A[i][j] = K[i] * h[j];
+    }
+    A[i][i] -= 1.0f;
+  }
+  memcpy(expected, P, sizeof(expected));
+  symmetricSandwich(A, expected);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++) {
+      expected[KC_PACKED_INDEX(i, j)] += K[i] * R * K[j];
+    }
+  }
+
+  // Test
+  rank1JosephUpdate(P, h, K, PHT, R);
+
+  // Assert
+  assertPackedWithin(1e-6f, expected, P);
+}
+
+void testThatRank1JosephUpdateMatchesDenseJosephUpdateForABadlyConditionedCovariance() {
+  // Fixture
+  // Variances from 1e-6 to 100, the range allowed by the covariance bounds, with strong correlations between the
+  // states, and an accurate measurement of a well known combination of the states
+  double Pd[KC_STATE_DIM][KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    const double sigmaI = sqrt(1e-6 * pow(1e8, i / (double)(KC_STATE_DIM - 1)));
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      const double sigmaJ = sqrt(1e-6 * pow(1e8, j / (double)(KC_STATE_DIM - 1)));
+      Pd[i][j] = (i == j ? 1.0 : 0.95) * sigmaI * sigmaJ;
+    }
+  }
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++) {
+      P[KC_PACKED_INDEX(i, j)] = (float)Pd[i][j];
+    }
+  }
+
+  float h[KC_STATE_DIM] = {0};
+  h[KC_STATE_DIM - 1] = 1.0f;
+  h[KC_STATE_DIM - 2] = 0.5f;
+  const float R = 1e-6f;
+
+  // PH' in float as the filter computes it, and a gain away from the optimal PH'/(HPH' + R) since the Joseph form holds
+  // for any gain
+  float PHT[KC_STATE_DIM] = {0};
+  float HPHR = R;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      PHT[i] += P[KC_PACKED_INDEX(i, j)] * h[j];
+    }
+    HPHR += h[i] * PHT[i];
+  }
+  float K[KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    K[i] = 0.8f * PHT[i] / HPHR;
+  }
+
+  // The dense reference in double, (I - KH) P (I - KH)' + K R K' with the same gain
+  double IKH[KC_STATE_DIM][KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      IKH[i][j] = (i == j ? 1.0 : 0.0) - (double)K[i] * h[j];
+    }
+  }
+  double expectedDense[KC_STATE_DIM][KC_STATE_DIM];
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = 0; j < KC_STATE_DIM; j++) {
+      double sum = 0.0;
+      for (int k = 0; k < KC_STATE_DIM; k++) {
+        for (int l = 0; l < KC_STATE_DIM; l++) {
+          sum += IKH[i][k] * Pd[k][l] * IKH[j][l];
+        }
+      }
+      expectedDense[i][j] = sum + (double)K[i] * R * K[j];
+    }
+  }
+
+  // Test
+  rank1JosephUpdate(P, h, K, PHT, R);
+
+  // Assert
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    for (int j = i; j < KC_STATE_DIM; j++) {
+      const double scale = sqrt(expectedDense[i][i] * expectedDense[j][j]);
+      TEST_ASSERT_FLOAT_WITHIN(1e-2 * scale, expectedDense[i][j], P[KC_PACKED_INDEX(i, j)]);
+    }
+    TEST_ASSERT_TRUE(P[KC_PACKED_INDEX(i, i)] > 0.0f);
+  }
+}
+
+void testThatFirstOrderCovarianceRotationIsCloseToFullRotation() {
+  // Fixture
+  fillSymmetric(P);
+  memcpy(expected, P, sizeof(expected));
+
+  const float d0 = 0.002f;
+  const float d1 = -0.001f;
+  const float d2 = 0.0015f;
+
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    A[i][i] = 1.0f;
+  }
+  A[KC_STATE_D0][KC_STATE_D0] =  1 - d1*d1/2 - d2*d2/2;
+  A[KC_STATE_D0][KC_STATE_D1] =  d2 + d0*d1/2;
+  A[KC_STATE_D0][KC_STATE_D2] = -d1 + d0*d2/2;
+  A[KC_STATE_D1][KC_STATE_D0] = -d2 + d0*d1/2;
+  A[KC_STATE_D1][KC_STATE_D1] =  1 - d0*d0/2 - d2*d2/2;
+  A[KC_STATE_D1][KC_STATE_D2] =  d0 + d1*d2/2;
+  A[KC_STATE_D2][KC_STATE_D0] =  d1 + d0*d2/2;
+  A[KC_STATE_D2][KC_STATE_D1] = -d0 + d1*d2/2;
+  A[KC_STATE_D2][KC_STATE_D2] = 1 - d0*d0/2 - d1*d1/2;
+  symmetricSandwich(A, expected);
+
+  // Test
+  rotateCovarianceFirstOrder(P, d0, d1, d2);
+
+  // Assert
+  // The dropped terms are of the order d^2
+  assertPackedWithin(1e-5f, expected, P);
+}
+
+void testThatFinalizeUsesFirstOrderRotationForSmallAttitudeErrors() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t core;
+  kalmanCoreInit(&core, &params, 0);
+
+  // Test
+  core.S[KC_STATE_D0] = params.attitudeErrorSmallAngle / 2.0f;
+  core.isUpdated = true;
+  kalmanCoreFinalize(&core, &params);
+
+  core.S[KC_STATE_D1] = params.attitudeErrorSmallAngle * 2.0f;
+  core.isUpdated = true;
+  kalmanCoreFinalize(&core, &params);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1, core.finalizeFirstOrderCount);
+  TEST_ASSERT_EQUAL_UINT32(1, core.finalizeExactCount);
+}
+
+void testThatFirstOrderRotationInFinalizeIsCloseToFullRotationAtTheSmallAngleLimit() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreParams_t paramsExact;
+  memcpy(&paramsExact, &params, sizeof(paramsExact));
+  paramsExact.attitudeErrorSmallAngle = 0.0f;
+
+  kalmanCoreData_t firstOrder;
+  kalmanCoreInit(&firstOrder, &params, 0);
+  fillSymmetric(firstOrder.P);
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    firstOrder.P[KC_PACKED_INDEX(i, i)] = 1.0f;
+  }
+
+  const float angle = params.attitudeErrorSmallAngle * 0.999f;
+  firstOrder.S[KC_STATE_D0] = angle;
+  firstOrder.S[KC_STATE_D1] = -angle;
+  firstOrder.S[KC_STATE_D2] = angle;
+  firstOrder.isUpdated = true;
+
+  kalmanCoreData_t exact;
+  memcpy(&exact, &firstOrder, sizeof(exact));
+
+  // Test
+  kalmanCoreFinalize(&firstOrder, &params);
+  kalmanCoreFinalize(&exact, &paramsExact);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1, firstOrder.finalizeFirstOrderCount);
+  TEST_ASSERT_EQUAL_UINT32(1, exact.finalizeExactCount);
+  // The dropped terms are of the order d^2 = (angle / 2)^2 for the covariances of order 1 in the fixture
+  assertPackedWithin(1e-6f, exact.P, firstOrder.P);
+}
+
+void testThatPredictionUsesTheTimeStepOfTheImuSamples() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t actual;
+  kalmanCoreInit(&actual, &params, 0);
+  actual.S[KC_STATE_PX] = 1.0f;
+  kalmanCoreData_t expected;
+  memcpy(&expected, &actual, sizeof(expected));
+
+  Axis3f acc = {.x = 0.0f, .y = 0.0f, .z = 1.0f};
+  Axis3f gyro = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+
+  // Test
+  // The first prediction has no previous sample time, both use the 2 ms from nowMs
+  kalmanCorePredictAtSampleTime(&actual, &acc, &gyro, 2, 1000, false);
+  kalmanCorePredict(&expected, &acc, &gyro, 2, false);
+  // Scheduled 5 ms later, but the samples are 1 ms apart
+  kalmanCorePredictAtSampleTime(&actual, &acc, &gyro, 7, 2000, false);
+  kalmanCorePredict(&expected, &acc, &gyro, 3, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.S[KC_STATE_X], actual.S[KC_STATE_X]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.003f, actual.S[KC_STATE_X]);
+}
+
+void testThatPredictionWithoutNewImuSamplesDoesNotChangeTheState() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t core;
+  kalmanCoreInit(&core, &params, 0);
+  core.S[KC_STATE_PX] = 1.0f;
+
+  Axis3f acc = {.x = 0.0f, .y = 0.0f, .z = 1.0f};
+  Axis3f gyro = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+  kalmanCorePredictAtSampleTime(&core, &acc, &gyro, 1, 1000, false);
+  const float expected = core.S[KC_STATE_X];
+
+  // Test
+  kalmanCorePredictAtSampleTime(&core, &acc, &gyro, 2, 1000, false);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(expected, core.S[KC_STATE_X]);
+}
+
+void testThatPredictionFallsBackToNowWhenTheSampleTimeStepIsTooLong() {
+  // Fixture
+  kalmanCoreParams_t params;
+  kalmanCoreDefaultParams(&params);
+  kalmanCoreData_t actual;
+  kalmanCoreInit(&actual, &params, 0);
+  actual.S[KC_STATE_PX] = 1.0f;
+  kalmanCoreData_t expected;
+  memcpy(&expected, &actual, sizeof(expected));
+
+  Axis3f acc = {.x = 0.0f, .y = 0.0f, .z = 1.0f};
+  Axis3f gyro = {.x = 0.0f, .y = 0.0f, .z = 0.0f};
+
+  // Test
+  kalmanCorePredictAtSampleTime(&actual, &acc, &gyro, 1, 1000, false);
+  kalmanCorePredictAtSampleTime(&actual, &acc, &gyro, 2, 1000 + 500000, false);
+  kalmanCorePredict(&expected, &acc, &gyro, 1, false);
+  kalmanCorePredict(&expected, &acc, &gyro, 2, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.S[KC_STATE_X], actual.S[KC_STATE_X]);
+}
@@ -0,0 +1,111 @@
+// File under test kalman_history.c
+#include "kalman_history.h"
+
+#include "unity.h"
+
+static kalmanHistory_t history;
+static const float oneMeterInX[3] = {1.0f, 0.0f, 0.0f};
+
+void setUp(void) {
+  kalmanHistoryInit(&history);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatEmptyHistoryDoesNotCoverAnEvent() {
+  // Fixture
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, 1000, offset);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatOffsetIsInterpolatedBetweenPredictions() {
+  // Fixture
+  kalmanHistoryAddPrediction(&history, 10000, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 20000, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 30000, oneMeterInX);
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, 15000, offset);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -1.5f, offset[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, offset[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, offset[2]);
+}
+
+void testThatOffsetIsZeroAtTheLatestPrediction() {
+  // Fixture
+  kalmanHistoryAddPrediction(&history, 10000, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 20000, oneMeterInX);
+  float offset[3];
+
+  // Test
+  kalmanHistoryGetOffset(&history, 20000, offset);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, offset[0]);
+}
+
+void testThatOffsetIsExtrapolatedAfterTheLatestPrediction() {
+  // Fixture
+  kalmanHistoryAddPrediction(&history, 10000, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 20000, oneMeterInX);
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, 25000, offset);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, offset[0]);
+}
+
+void testThatEventTooFarIntoTheFutureIsNotCovered() {
+  // Fixture
+  kalmanHistoryAddPrediction(&history, 10000, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 20000, oneMeterInX);
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, 20000 + KALMAN_HISTORY_MAX_EXTRAPOLATION_US + 1, offset);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatEventOlderThanTheHistoryIsNotCovered() {
+  // Fixture
+  for (int i = 0; i < KALMAN_HISTORY_LENGTH + 5; i++) {
+    kalmanHistoryAddPrediction(&history, 10000 * (i + 1), oneMeterInX);
+  }
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, 10000, offset);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatTimerWrapAroundIsHandled() {
+  // Fixture
+  kalmanHistoryAddPrediction(&history, UINT32_MAX - 9999, oneMeterInX);
+  kalmanHistoryAddPrediction(&history, 400, oneMeterInX);
+  float offset[3];
+
+  // Test
+  bool actual = kalmanHistoryGetOffset(&history, UINT32_MAX - 4799, offset);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, -0.5f, offset[0]);
+}
@@ -0,0 +1,237 @@
+// File under test mm_sweep_angles.c
+#include "mm_sweep_angles.h"
+
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+#include "mock_outlierFilterLighthouse.h"
+#include "kalman_core_mm_test_helpers.c"
+
+// Default data initialized in setup()
+static kalmanCoreData_t this;
+static float expectedHm[KC_STATE_DIM];
+static OutlierFilterLhState_t outlierFilterLhState;
+
+static const mat3d identity = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+static const vec3d rotorPos = {0, 0, 0};
+static const lighthouseCalibrationSweep_t calib;
+
+static vec3d sensorPositions[4];
+
+// Storage for the batch update mock
+#define MAX_CAPTURED KALMAN_CORE_SWEEP_ANGLES_MAX_BATCH
+static int capturedCount;
+static int capturedCalls;
+static float capturedH[MAX_CAPTURED][KC_STATE_DIM];
+static float capturedError[MAX_CAPTURED];
+
+static int modelCalls;
+
+static float mockMeasurementModel(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib);
+static void mockBatchUpdateCapture(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls);
+static sweepAngleMeasurement_t createSweep(const int sensor, const float t, const float measuredSweepAngle);
+static int mockValidateSweepsAcceptAll(OutlierFilterLhState_t* this, const float* distanceToBs, const float* angleError, const int count, const uint32_t nowMs, bool* accepted, int cmock_num_calls);
+static int mockValidateSweepsAcceptEven(OutlierFilterLhState_t* this, const float* distanceToBs, const float* angleError, const int count, const uint32_t nowMs, bool* accepted, int cmock_num_calls);
+
+void setUp(void) {
+  memset(&this, 0, sizeof(this));
+  memset(&expectedHm, 0, sizeof(expectedHm));
+  memset(&sensorPositions, 0, sizeof(sensorPositions));
+  memset(capturedH, 0, sizeof(capturedH));
+  memset(capturedError, 0, sizeof(capturedError));
+  capturedCount = 0;
+  capturedCalls = 0;
+  modelCalls = 0;
+
+  this.R[0][0] = 1.0f;
+  this.R[1][1] = 1.0f;
+  this.R[2][2] = 1.0f;
+
+  initKalmanCoreScalarUpdateExpectationsSingleCall();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatBatchUpdateIsCalledInSimpleCase() {
+  // Fixture
+  float expectedError = 0.1f;
+  float expectedStdMeasNoise = 0.123f;
+
+  this.S[KC_STATE_X] = 1.0f;
+
+  expectedHm[KC_STATE_X] = 0.0f;
+  expectedHm[KC_STATE_Y] = 1.0f;
+  expectedHm[KC_STATE_Z] = 0.0f;
+
+  sweepAngleMeasurement_t sweep = createSweep(0, 0.0f, 0.1f);
+  sweep.stdDev = expectedStdMeasNoise;
+
+  setKalmanCoreScalarUpdateExpectationsSingleCall(&this, expectedHm, expectedError, expectedStdMeasNoise);
+  outlierFilterLighthouseValidateSweeps_StubWithCallback(mockValidateSweepsAcceptAll);
+
+  // Test
+  kalmanCoreUpdateWithSweepAngles(&this, &sweep, 0, &outlierFilterLhState);
+
+  // Assert
+  assertScalarUpdateWasCalled();
+}
+
+void testThatBatchUpdateIsNotCalledWhenTheOutlierFilterIsBlocking() {
+  // Fixture
+  this.S[KC_STATE_X] = 1.0f;
+  sweepAngleMeasurement_t sweeps[] = {createSweep(0, -0.5f, 0.1f), createSweep(0, 0.5f, 0.1f)};
+
+  outlierFilterLighthouseValidateSweeps_IgnoreAndReturn(0);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithSweepAnglesBatch(&this, sweeps, 2, 0, &outlierFilterLhState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  assertScalarUpdateWasNotCalled();
+}
+
+void testThatAllSweepsInABatchAreFedToTheKalmanCoreInOneCall() {
+  // Fixture
+  this.S[KC_STATE_X] = 2.0f;
+  this.S[KC_STATE_Y] = 0.5f;
+  this.S[KC_STATE_Z] = 0.3f;
+  sensorPositions[1][1] = 0.01f;
+
+  sweepAngleMeasurement_t sweeps[] = {
+    createSweep(0, -0.5f, 0.1f), createSweep(0, 0.5f, 0.2f),
+    createSweep(1, -0.5f, 0.3f), createSweep(1, 0.5f, 0.4f),
+  };
+
+  outlierFilterLighthouseValidateSweeps_StubWithCallback(mockValidateSweepsAcceptAll);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithSweepAnglesBatch(&this, sweeps, 4, 0, &outlierFilterLhState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, actual);
+  TEST_ASSERT_EQUAL_INT(1, capturedCalls);
+  TEST_ASSERT_EQUAL_INT(4, capturedCount);
+  TEST_ASSERT_EQUAL_INT(4, modelCalls);
+}
+
+void testThatOnlyAcceptedSweepsAreFedToTheKalmanCore() {
+  // Fixture
+  this.S[KC_STATE_X] = 2.0f;
+
+  sweepAngleMeasurement_t sweeps[] = {
+    createSweep(0, -0.5f, 0.1f), createSweep(0, 0.5f, 0.2f),
+    createSweep(1, -0.5f, 0.3f), createSweep(1, 0.5f, 0.4f),
+  };
+
+  outlierFilterLighthouseValidateSweeps_StubWithCallback(mockValidateSweepsAcceptEven);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithSweepAnglesBatch(&this, sweeps, 4, 0, &outlierFilterLhState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_EQUAL_INT(2, capturedCount);
+  TEST_ASSERT_EQUAL_FLOAT(0.1f - mockMeasurementModel(2.0f, 0.0f, 0.0f, -0.5f, &calib), capturedError[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.3f - mockMeasurementModel(2.0f, 0.0f, 0.0f, -0.5f, &calib), capturedError[1]);
+}
+
+void testThatBatchUpdateGivesTheSameJacobiansAsSingleUpdates() {
+  // Fixture
+  this.S[KC_STATE_X] = 2.0f;
+  this.S[KC_STATE_Y] = 0.5f;
+  this.S[KC_STATE_Z] = 0.3f;
+  sensorPositions[0][0] = 0.01f;
+  sensorPositions[1][1] = 0.01f;
+  sensorPositions[2][0] = -0.01f;
+
+  sweepAngleMeasurement_t sweeps[] = {
+    createSweep(0, -0.5f, 0.1f), createSweep(0, 0.5f, 0.2f),
+    createSweep(1, -0.5f, 0.3f), createSweep(1, 0.5f, 0.4f),
+    createSweep(2, -0.5f, 0.5f), createSweep(2, 0.5f, 0.6f),
+  };
+  const int count = sizeof(sweeps) / sizeof(sweeps[0]);
+
+  outlierFilterLighthouseValidateSweeps_StubWithCallback(mockValidateSweepsAcceptAll);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  float expectedH[MAX_CAPTURED][KC_STATE_DIM];
+  float expectedError[MAX_CAPTURED];
+  for (int i = 0; i < count; i++) {
+    capturedCount = 0;
+    kalmanCoreUpdateWithSweepAngles(&this, &sweeps[i], 0, &outlierFilterLhState);
+    TEST_ASSERT_EQUAL_INT(1, capturedCount);
+    memcpy(expectedH[i], capturedH[0], sizeof(expectedH[i]));
+    expectedError[i] = capturedError[0];
+  }
+
+  // Test
+  kalmanCoreUpdateWithSweepAnglesBatch(&this, sweeps, count, 0, &outlierFilterLhState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(count, capturedCount);
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expectedH[i], capturedH[i], KC_STATE_DIM);
+    TEST_ASSERT_EQUAL_FLOAT(expectedError[i], capturedError[i]);
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static float mockMeasurementModel(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib) {
+  modelCalls++;
+  return atan2f(y, x) * 0.01f + t * z * 0.01f;
+}
+
+static void mockBatchUpdateCapture(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_PTR(&this, actualThis);
+  TEST_ASSERT_TRUE(actualCount <= MAX_CAPTURED);
+
+  capturedCalls++;
+  capturedCount = actualCount;
+  for (int i = 0; i < actualCount; i++) {
+    memcpy(capturedH[i], actualMeasurements[i].h, sizeof(capturedH[i]));
+    capturedError[i] = actualMeasurements[i].error;
+  }
+}
+
+static int mockValidateSweepsAcceptAll(OutlierFilterLhState_t* this, const float* distanceToBs, const float* angleError, const int count, const uint32_t nowMs, bool* accepted, int cmock_num_calls) {
+  for (int i = 0; i < count; i++) {
+    accepted[i] = true;
+  }
+
+  return count;
+}
+
+static int mockValidateSweepsAcceptEven(OutlierFilterLhState_t* this, const float* distanceToBs, const float* angleError, const int count, const uint32_t nowMs, bool* accepted, int cmock_num_calls) {
+  int acceptedCount = 0;
+  for (int i = 0; i < count; i++) {
+    accepted[i] = (i % 2) == 0;
+    acceptedCount += accepted[i];
+  }
+
+  return acceptedCount;
+}
+
+static sweepAngleMeasurement_t createSweep(const int sensor, const float t, const float measuredSweepAngle) {
+  sweepAngleMeasurement_t sweep = {
+    .sensorPos = &sensorPositions[sensor],
+    .rotorPos = &rotorPos,
+    .rotorRot = &identity,
+    .rotorRotInv = &identity,
+    .sensorId = sensor,
+    .baseStationId = 0,
+    .sweepId = t < 0 ? 0 : 1,
+    .t = t,
+    .measuredSweepAngle = measuredSweepAngle,
+    .stdDev = 0.001f,
+    .calib = &calib,
+    .calibrationMeasurementModel = mockMeasurementModel,
+  };
+
+  return sweep;
+}
@@ -12,9 +12,23 @@ static kalmanCoreData_t this;
 static float expectedHm[KC_STATE_DIM];
 static OutlierFilterTdoaState_t outlierFilterTdoaState;
 
+// Storage for the batch update mock
+static int capturedCount;
+static int capturedCalls;
+static float capturedH[KALMAN_CORE_TDOA_MAX_BATCH][KC_STATE_DIM];
+static float capturedError[KALMAN_CORE_TDOA_MAX_BATCH];
+
+static void mockBatchUpdateCapture(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls);
+static bool mockValidateIntegratorAcceptEven(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs, int cmock_num_calls);
+static tdoaMeasurement_t createMeasurement(const float x0, const float x1, const float distanceDiff);
+
 void setUp(void) {
   memset(&this, 0, sizeof(this));
   memset(&expectedHm, 0, sizeof(expectedHm));
+  memset(capturedH, 0, sizeof(capturedH));
+  memset(capturedError, 0, sizeof(capturedError));
+  capturedCount = 0;
+  capturedCalls = 0;
 
   initKalmanCoreScalarUpdateExpectationsSingleCall();
 
@@ -105,3 +119,125 @@ void testThatScalarUpdateIsNotCalledWhenTheOutlierFilterIsBlocking() {
   // Assert
   assertScalarUpdateWasNotCalled();
 }
+
+
+void testThatAllMeasurementsInABatchAreFedToTheKalmanCoreInOneCall() {
+  // Fixture
+  this.S[KC_STATE_Y] = 0.5;
+
+  tdoaMeasurement_t measurements[] = {
+    createMeasurement(-1.0, 1.0, 0.1),
+    createMeasurement(-2.0, 1.0, 0.2),
+    createMeasurement(-1.0, 2.0, 0.3),
+  };
+
+  outlierFilterTdoaValidateIntegrator_IgnoreAndReturn(true);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithTdoaBatch(&this, measurements, 3, 0, &outlierFilterTdoaState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, actual);
+  TEST_ASSERT_EQUAL_INT(1, capturedCalls);
+  TEST_ASSERT_EQUAL_INT(3, capturedCount);
+}
+
+
+void testThatOnlyMeasurementsAcceptedByTheOutlierFilterAreFedToTheKalmanCore() {
+  // Fixture
+  tdoaMeasurement_t measurements[] = {
+    createMeasurement(-1.0, 1.0, 0.1),
+    createMeasurement(-1.0, 1.0, 0.2),
+    createMeasurement(-1.0, 1.0, 0.3),
+  };
+
+  outlierFilterTdoaValidateIntegrator_StubWithCallback(mockValidateIntegratorAcceptEven);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithTdoaBatch(&this, measurements, 3, 0, &outlierFilterTdoaState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_EQUAL_INT(2, capturedCount);
+  TEST_ASSERT_EQUAL_FLOAT(0.1, capturedError[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.3, capturedError[1]);
+  TEST_ASSERT_EQUAL_FLOAT(-2.0, capturedH[0][KC_STATE_X]);
+  TEST_ASSERT_EQUAL_FLOAT(-2.0, capturedH[1][KC_STATE_X]);
+}
+
+
+void testThatBatchUpdateIsNotCalledWhenNoMeasurementIsAccepted() {
+  // Fixture
+  tdoaMeasurement_t measurements[] = {
+    createMeasurement(-1.0, 1.0, 0.1),
+    createMeasurement(-1.0, 1.0, 0.2),
+  };
+
+  outlierFilterTdoaValidateIntegrator_IgnoreAndReturn(false);
+  kalmanCoreBatchUpdate_StubWithCallback(mockBatchUpdateCapture);
+
+  // Test
+  const int actual = kalmanCoreUpdateWithTdoaBatch(&this, measurements, 2, 0, &outlierFilterTdoaState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(0, capturedCalls);
+}
+
+
+void testThatGatingMarksWhichMeasurementsWereAccepted() {
+  // Fixture
+  tdoaMeasurement_t measurements[] = {
+    createMeasurement(-1.0, 1.0, 0.1),
+    createMeasurement(-1.0, 1.0, 0.2),
+    createMeasurement(-1.0, 1.0, 0.3),
+  };
+  kalmanCoreTdoaGatedBatch_t gated;
+
+  outlierFilterTdoaValidateIntegrator_StubWithCallback(mockValidateIntegratorAcceptEven);
+
+  // Test
+  const int actual = kalmanCoreGateTdoaBatch(&this, measurements, 3, 0, &outlierFilterTdoaState, &gated);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_EQUAL_INT(2, gated.acceptedCount);
+  TEST_ASSERT_TRUE(gated.isAccepted[0]);
+  TEST_ASSERT_FALSE(gated.isAccepted[1]);
+  TEST_ASSERT_TRUE(gated.isAccepted[2]);
+  TEST_ASSERT_EQUAL_FLOAT(0.3, gated.measurements[1].error);
+  TEST_ASSERT_EQUAL_PTR(gated.h[1], gated.measurements[1].h);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void mockBatchUpdateCapture(kalmanCoreData_t* actualThis, const kalmanCoreScalarMeasurement_t* actualMeasurements, const int actualCount, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_PTR(&this, actualThis);
+  TEST_ASSERT_TRUE(actualCount <= KALMAN_CORE_TDOA_MAX_BATCH);
+
+  capturedCalls++;
+  capturedCount = actualCount;
+  for (int i = 0; i < actualCount; i++) {
+    memcpy(capturedH[i], actualMeasurements[i].h, sizeof(capturedH[i]));
+    capturedError[i] = actualMeasurements[i].error;
+  }
+}
+
+static bool mockValidateIntegratorAcceptEven(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs, int cmock_num_calls) {
+  return (cmock_num_calls % 2) == 0;
+}
+
+static tdoaMeasurement_t createMeasurement(const float x0, const float x1, const float distanceDiff) {
+  tdoaMeasurement_t measurement = {
+    .anchorPositions = {
+      {.x = x0, .y = 0.0, .z = 0.0},
+      {.x = x1, .y = 0.0, .z = 0.0},
+    },
+    .distanceDiff = distanceDiff,
+    .stdDev = 0.123,
+  };
+
+  return measurement;
+}
@@ -9,6 +9,7 @@
 #include "mock_pulse_processor_v1.h"
 #include "mock_pulse_processor_v2.h"
 #include "mock_lighthouse_transmit.h"
+#include "mock_lighthouse_recorder.h"
 #include "mock_lighthouse_deck_flasher.h"
 #include "mock_lighthouse_position_est.h"
 #include "mock_lighthouse_calibration.h"
@@ -21,6 +22,7 @@
 #include <stdbool.h>
 
 static void uart1SetSequence(char* sequence, int length);
+static void uart1SetDmaSequence(unsigned char* sequence, int length);
 static emptySequence[] = {0};
 static int uart1BytesRead = 0;
 static char* uart1Sequence;
@@ -32,6 +34,8 @@ extern pulseProcessor_t lighthouseCoreState;
 // Functions under test
 void waitForUartSynchFrame();
 bool getUartFrameRaw(lighthouseUartFrame_t *frame);
+void waitForUartSynchFrameDma();
+bool getUartFrameDma(lighthouseUartFrame_t *frame);
 lighthouseBaseStationType_t identifyBaseStationType(const lighthouseUartFrame_t* frame, lighthouseBsIdentificationData_t* state);
 
 // Dummy mocks timer
@@ -263,6 +267,52 @@ void testThatSlowBitIsDecodedInUartFrame() {
   TEST_ASSERT_EQUAL_UINT8(0, frame.data.channel);
 }
 
+void testThatUartFrameIsDetectedInDmaBuffer() {
+  // Fixture
+  unsigned char sequence[] = {0, 1, 2, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0, 1, 2};
+  int expected = 15;
+  uart1SetDmaSequence(sequence, sizeof(sequence));
+  uart1DidOverrun_ExpectAndReturn(false);
+
+  // Test
+  waitForUartSynchFrameDma();
+
+  // Assert
+  int actual = uart1BytesRead;
+  TEST_ASSERT_EQUAL(expected, actual);
+}
+
+void testThatUartFrameIsDecodedFromDmaBuffer() {
+  // Fixture
+  unsigned char sequence[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 2, 1};
+  uint32_t expected = 0x010203;
+  uart1SetDmaSequence(sequence, sizeof(sequence));
+  uart1DidOverrun_ExpectAndReturn(false);
+
+  // Test
+  bool frameOk = getUartFrameDma(&frame);
+
+  // Assert
+  uint32_t actual = frame.data.timestamp;
+  TEST_ASSERT_EQUAL_UINT32(expected, actual);
+
+  TEST_ASSERT_TRUE(frameOk);
+  TEST_ASSERT_EQUAL(FRAME_LENGTH, uart1BytesRead);
+}
+
+void testThatDmaUartFrameIsNotValidAfterOverrun() {
+  // Fixture
+  unsigned char sequence[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  uart1SetDmaSequence(sequence, sizeof(sequence));
+  uart1DidOverrun_ExpectAndReturn(true);
+
+  // Test
+  bool frameOk = getUartFrameDma(&frame);
+
+  // Assert
+  TEST_ASSERT_FALSE(frameOk);
+}
+
 // Test support ----------------------------------------------------------------------------------------------------
 static void uart1ReadCallback(char* ch, int cmock_num_calls) {
     if (uart1BytesRead >= uart1SequenceLength) {
@@ -286,3 +336,29 @@ static void uart1SetSequence(char* sequence, int length) {
     uart1Getchar_StubWithCallback(uart1ReadCallback);
     uart1Getchar_StubWithCallback(uart1GetcharCallback);
 }
+
+static uint32_t uart1RxDmaBytesAvailableCallback(int cmock_num_calls) {
+    return uart1SequenceLength - uart1BytesRead;
+}
+
+static const uint8_t* uart1RxDmaPeekCallback(const uint32_t size, int cmock_num_calls) {
+    if (uart1BytesRead + size > uart1SequenceLength) {
+        TEST_FAIL_MESSAGE("Too many bytes peeked from uart1 DMA buffer");
+    }
+
+    return (const uint8_t*)&uart1Sequence[uart1BytesRead];
+}
+
+static void uart1RxDmaConsumeCallback(const uint32_t size, int cmock_num_calls) {
+    uart1BytesRead += size;
+}
+
+static void uart1SetDmaSequence(unsigned char* sequence, int length) {
+    uart1BytesRead = 0;
+    uart1Sequence = (char*)sequence;
+    uart1SequenceLength = length;
+
+    uart1RxDmaBytesAvailable_StubWithCallback(uart1RxDmaBytesAvailableCallback);
+    uart1RxDmaPeek_StubWithCallback(uart1RxDmaPeekCallback);
+    uart1RxDmaConsume_StubWithCallback(uart1RxDmaConsumeCallback);
+}
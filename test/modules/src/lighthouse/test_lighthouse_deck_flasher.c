@@ -7,16 +7,21 @@
 #include "mock_system.h"
 #include "mock_lh_bootloader.h"
 #include "mock_crc32.h"
+#include "mock_worker.h"
 
 #include "freertosMocks.h"
+#include "lighthouse.h"
 
 #include <stdbool.h>
 
 const DeckMemDef_t* noMemDef = 0;
 
+static int runWorkNow(void (*function)(void*), void *arg, int cmock_num_calls);
+
 
 void setUp(void) {
-  // Empty
+  workerSchedule_StubWithCallback(runWorkNow);
+  lhblFlashWaitComplete_IgnoreAndReturn(true);
 }
 
 void tearDown(void) {
@@ -29,12 +34,17 @@ void testThaEraseFwIsCalledWhenWritingTheFirstBlock() {
   lhblFlashEraseFirmware_ExpectAndReturn(true);
   uint8_t buffer[] = {1, 2, 3, 4};
   lhblFlashWritePage_ExpectWithArrayAndReturn(LH_FW_ADDR + 0, 4, buffer, 4, true);
+  lhblFlashRead_IgnoreAndReturn(true);
 
   // Test
   bool actual = lighthouseDeckFlasherWrite(0, 4, buffer, noMemDef);
 
   // Actual
   TEST_ASSERT_TRUE(actual);
+
+  // Flush the page buffer
+  uint8_t readBuffer[4];
+  lighthouseDeckFlasherRead(0, 4, readBuffer);
 }
 
 
@@ -43,11 +53,85 @@ void testThaEraseFwSplitsWriteBetweenTwoPages() {
   uint8_t buffer[] = {1, 2, 3, 4};
   lhblFlashWritePage_ExpectWithArrayAndReturn(LH_FW_ADDR + 254, 2, buffer, 2, true);
   lhblFlashWritePage_ExpectWithArrayAndReturn(LH_FW_ADDR + 256, 2, &buffer[2], 2, true);
-
+  lhblFlashRead_IgnoreAndReturn(true);
 
   // Test
   bool actual = lighthouseDeckFlasherWrite(254, 4, buffer, noMemDef);
 
   // Actual
   TEST_ASSERT_TRUE(actual);
+
+  // Flush the page buffer
+  uint8_t readBuffer[4];
+  lighthouseDeckFlasherRead(0, 4, readBuffer);
+}
+
+
+void testThatContiguousWritesAreCombinedIntoOnePageWrite() {
+  // Fixture
+  uint8_t buffer[256];
+  for (int i = 0; i < 256; i++) {
+    buffer[i] = i;
+  }
+  lhblFlashWritePage_ExpectWithArrayAndReturn(LH_FW_ADDR + 512, 256, buffer, 256, true);
+
+  // Test
+  bool actual = true;
+  for (int i = 0; i < 256; i += 32) {
+    actual &= lighthouseDeckFlasherWrite(512 + i, 32, &buffer[i], noMemDef);
+  }
+
+  // Actual
+  TEST_ASSERT_TRUE(actual);
+}
+
+
+void testThatAFailedPageWriteIsReportedOnTheNextWrite() {
+  // Fixture
+  uint8_t buffer[32] = {0};
+  lhblFlashEraseFirmware_ExpectAndReturn(true);
+  lhblFlashWritePage_IgnoreAndReturn(false);
+
+  lighthouseDeckFlasherWrite(0, 32, buffer, noMemDef);
+  for (int i = 32; i < 256; i += 32) {
+    lighthouseDeckFlasherWrite(i, 32, buffer, noMemDef);
+  }
+
+  // Test
+  bool actual = lighthouseDeckFlasherWrite(256, 32, buffer, noMemDef);
+
+  // Actual
+  TEST_ASSERT_FALSE(actual);
+}
+
+
+void testThatUpgradeIsNotRequiredWhenTheTransferredImageIsVerified() {
+  // Fixture
+  uint8_t buffer[32] = {0};
+  const uint32_t lastAddress = LIGHTHOUSE_BITSTREAM_SIZE - sizeof(buffer);
+
+  lhblFlashEraseFirmware_ExpectAndReturn(true);
+  lhblFlashWritePage_IgnoreAndReturn(true);
+  lhblFlashRead_IgnoreAndReturn(true);
+  crc32ContextInit_Ignore();
+  crc32Update_Ignore();
+  crc32Out_IgnoreAndReturn(LIGHTHOUSE_BITSTREAM_CRC);
+
+  lighthouseDeckFlasherWrite(0, sizeof(buffer), buffer, noMemDef);
+  TEST_ASSERT_TRUE(lighthouseDeckFlasherPropertiesQuery() & DECK_MEMORY_MASK_UPGRADE_REQUIRED);
+
+  // Test
+  bool actual = lighthouseDeckFlasherWrite(lastAddress, sizeof(buffer), buffer, noMemDef);
+
+  // Actual
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FALSE(lighthouseDeckFlasherPropertiesQuery() & DECK_MEMORY_MASK_UPGRADE_REQUIRED);
+}
+
+
+// Helpers ////////////////////////////////////////////////
+
+static int runWorkNow(void (*function)(void*), void *arg, int cmock_num_calls) {
+  function(arg);
+  return 0;
 }
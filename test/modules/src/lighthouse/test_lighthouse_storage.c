@@ -13,6 +13,7 @@
 #include "mock_worker.h"
 
 #include <stdbool.h>
+#include <string.h>
 
 // Functions under test
 void lighthouseStorageInitializeGeoDataFromStorage();
@@ -20,6 +21,9 @@ void lighthouseStorageInitializeCalibDataFromStorage();
 
 pulseProcessor_t lighthouseCoreState;
 
+static size_t mockStorageFetchCurrentGeoData(const char *key, void* buffer, size_t length, int cmock_num_calls);
+static size_t mockStorageFetchOtherCalibData(const char *key, void* buffer, size_t length, int cmock_num_calls);
+
 void setUp(void) {
   // Empty
 }
@@ -31,6 +35,7 @@ void tearDown(void) {
 
 void testThatGeoDataIsWrittenToStorage() {
   // Fixture
+  storageFetch_IgnoreAndReturn(0);
   storageStore_ExpectAndReturn("lh/sys/0/geo/1", &lighthouseCoreState.bsGeometry[1], sizeof(baseStationGeometry_t), true);
 
   // Test
@@ -42,6 +47,7 @@ void testThatGeoDataIsWrittenToStorage() {
 
 void testThatFailedGeoDataWriteToStorageReturnsFailure() {
   // Fixture
+  storageFetch_IgnoreAndReturn(0);
   storageStore_IgnoreAndReturn(false);
 
   // Test
@@ -53,6 +59,7 @@ void testThatFailedGeoDataWriteToStorageReturnsFailure() {
 
 void testThatCalibDataIsWrittenToStorage() {
   // Fixture
+  storageFetch_IgnoreAndReturn(0);
   storageStore_ExpectAndReturn("lh/sys/0/cal/1", &lighthouseCoreState.bsCalibration[1], sizeof(lighthouseCalibration_t), true);
 
   // Test
@@ -64,6 +71,7 @@ void testThatCalibDataIsWrittenToStorage() {
 
 void testThatFailedCalibDataWriteToStorageReturnsFailure() {
   // Fixture
+  storageFetch_IgnoreAndReturn(0);
   storageStore_IgnoreAndReturn(false);
 
   // Test
@@ -73,6 +81,33 @@ void testThatFailedCalibDataWriteToStorageReturnsFailure() {
   TEST_ASSERT_FALSE(actual);
 }
 
+void testThatUnchangedGeoDataIsNotWrittenToStorage() {
+  // Fixture
+  lighthouseCoreState.bsGeometry[1].origin[0] = 1.0f;
+  lighthouseCoreState.bsGeometry[1].valid = true;
+  storageFetch_StubWithCallback(mockStorageFetchCurrentGeoData);
+
+  // Test
+  bool actual = lighthouseStoragePersistData(1, true, false);
+
+  // Actual
+  TEST_ASSERT_TRUE(actual);
+  // No call to storageStore() verified in mocks
+}
+
+void testThatChangedCalibDataIsWrittenToStorage() {
+  // Fixture
+  lighthouseCoreState.bsCalibration[1].uid = 1234;
+  storageFetch_StubWithCallback(mockStorageFetchOtherCalibData);
+  storageStore_ExpectAndReturn("lh/sys/0/cal/1", &lighthouseCoreState.bsCalibration[1], sizeof(lighthouseCalibration_t), true);
+
+  // Test
+  bool actual = lighthouseStoragePersistData(1, false, true);
+
+  // Actual
+  TEST_ASSERT_TRUE(actual);
+}
+
 void testThatNoInitializationOfGeoIsDoneWhenStorageIsEmpty() {
   // Fixture
   storageFetch_IgnoreAndReturn(0);
@@ -136,3 +171,21 @@ void testInitializationOfCalibIsDoneFromStorage() {
   // Actual
   // Verified in mocks
 }
+
+// Helpers ////////////////////////////////////////////////
+
+static size_t mockStorageFetchCurrentGeoData(const char *key, void* buffer, size_t length, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_STRING("lh/sys/0/geo/1", key);
+  TEST_ASSERT_EQUAL(sizeof(baseStationGeometry_t), length);
+  memcpy(buffer, &lighthouseCoreState.bsGeometry[1], length);
+  return length;
+}
+
+static size_t mockStorageFetchOtherCalibData(const char *key, void* buffer, size_t length, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_STRING("lh/sys/0/cal/1", key);
+  TEST_ASSERT_EQUAL(sizeof(lighthouseCalibration_t), length);
+  lighthouseCalibration_t other = lighthouseCoreState.bsCalibration[1];
+  other.uid++;
+  memcpy(buffer, &other, length);
+  return length;
+}
@@ -0,0 +1,170 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_lighthouse_throttle.c - unit tests for the lighthouse sample throttling
+ */
+
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+// File under test lighthouse_throttle.c
+#include "lighthouse_throttle.h"
+
+#include <string.h>
+
+#include "unity.h"
+#include "mock_estimator_kalman.h"
+
+static pulseProcessorResult_t angles;
+
+static void setSample(const int baseStation, const int validSensors, const float angle);
+static int feedSamples(const int baseStation, const int samplesPerSecond, const uint32_t durationMs, uint32_t* nowMs);
+
+void setUp(void) {
+  memset(&angles, 0, sizeof(angles));
+  throttleLh2Reset();
+  estimatorKalmanGetMeasurementCycles_IgnoreAndReturn(0.0f);
+}
+
+void testThatAllSamplesAreUsedWhenTheRateIsLow() {
+  // Fixture
+  uint32_t nowMs = 1000;
+  setSample(0, 4, 0.1f);
+
+  // Test
+  const int used = feedSamples(0, 10, 1000, &nowMs);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(10, used);
+}
+
+void testThatTheRateIsLimitedToMaxRate() {
+  // Fixture
+  uint32_t nowMs = 1000;
+  setSample(0, 4, 0.1f);
+  feedSamples(0, 500, 1000, &nowMs);
+
+  // Test
+  const int used = feedSamples(0, 500, 2000, &nowMs);
+
+  // Assert
+  // Default max rate is 50 samples/s
+  TEST_ASSERT_INT_WITHIN(10, 100, used);
+}
+
+void testThatTheRateIsLimitedByTheCpuBudget() {
+  // Fixture
+  uint32_t nowMs = 1000;
+  setSample(0, 4, 0.1f);
+  // 3% of 168 MHz for 25 samples/s of 8 sweeps each
+  const float cyclesPerSweep = 168000000.0f * 0.03f / (25.0f * 8.0f);
+  estimatorKalmanGetMeasurementCycles_IgnoreAndReturn(cyclesPerSweep);
+  feedSamples(0, 500, 1000, &nowMs);
+
+  // Test
+  const int used = feedSamples(0, 500, 2000, &nowMs);
+
+  // Assert
+  TEST_ASSERT_INT_WITHIN(6, 50, used);
+}
+
+void testThatARarelySeenBaseStationIsPreferred() {
+  // Fixture
+  uint32_t nowMs = 1000;
+  int usedBs1 = 0;
+  int receivedBs1 = 0;
+
+  // Test
+  for (int i = 0; i < 2000; i++) {
+    nowMs += 2;
+    if (i % 25 == 0) {
+      setSample(1, 4, 0.1f);
+      receivedBs1++;
+      if (throttleLh2Samples(nowMs, &angles, 1)) {
+        usedBs1++;
+      }
+    } else {
+      setSample(0, 4, 0.1f);
+      throttleLh2Samples(nowMs, &angles, 0);
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_GREATER_OR_EQUAL(receivedBs1 * 8 / 10, usedBs1);
+}
+
+void testThatSamplesWithMoreInformationArePreferred() {
+  // Fixture
+  uint32_t nowMs = 1000;
+  int usedGood = 0;
+  int usedPoor = 0;
+
+  // Test
+  for (int i = 0; i < 2000; i++) {
+    nowMs += 2;
+    const bool good = (i % 2 == 0);
+    if (good) {
+      setSample(0, 4, 0.1f);
+    } else {
+      setSample(0, 1, 0.9f);
+    }
+
+    if (throttleLh2Samples(nowMs, &angles, 0)) {
+      if (good) {
+        usedGood++;
+      } else {
+        usedPoor++;
+      }
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_GREATER_THAN(usedPoor * 2, usedGood);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void setSample(const int baseStation, const int validSensors, const float angle) {
+  memset(&angles, 0, sizeof(angles));
+  for (int sensor = 0; sensor < validSensors; sensor++) {
+    pulseProcessorSensorMeasurement_t* measurement = &angles.baseStationMeasurementsLh1[baseStation].sensorMeasurements[sensor];
+    measurement->validCount = PULSE_PROCESSOR_N_SWEEPS;
+    measurement->correctedAngles[0] = angle;
+    measurement->correctedAngles[1] = -angle;
+  }
+}
+
+static int feedSamples(const int baseStation, const int samplesPerSecond, const uint32_t durationMs, uint32_t* nowMs) {
+  int used = 0;
+  const int count = samplesPerSecond * durationMs / 1000;
+  const float intervalMs = 1000.0f / samplesPerSecond;
+  const uint32_t startMs = *nowMs;
+
+  for (int i = 1; i <= count; i++) {
+    *nowMs = startMs + (uint32_t)(i * intervalMs);
+    if (throttleLh2Samples(*nowMs, &angles, baseStation)) {
+      used++;
+    }
+  }
+
+  return used;
+}
@@ -139,6 +139,90 @@ void testThatLhFilterOpensWithMixedSamples() {
   TEST_ASSERT_EQUAL(expected, actual);
 }
 
+void testThatLhFilterBatchGivesTheSameResultAsSingleSweepsForAGoodFrame() {
+  // Fixture
+  OutlierFilterLhState_t single;
+  OutlierFilterLhState_t batch;
+  uint32_t time = fixtureCloseLhFilter(&single);
+  fixtureCloseLhFilter(&batch);
+
+  const float distances[] = {LH_DISTANCE, LH_DISTANCE, LH_DISTANCE, LH_DISTANCE};
+  const float angles[] = {LH_GOOD_ANGLE, LH_BAD_ANGLE, LH_GOOD_ANGLE, LH_GOOD_ANGLE};
+  bool accepted[4];
+
+  // Test
+  int actual = outlierFilterLighthouseValidateSweeps(&batch, distances, angles, 4, time, accepted);
+
+  // Assert
+  TEST_ASSERT_EQUAL(3, actual);
+  for (int i = 0; i < 4; i++) {
+    bool expected = outlierFilterLighthouseValidateSweep(&single, distances[i], angles[i], time);
+    TEST_ASSERT_EQUAL(expected, accepted[i]);
+  }
+  TEST_ASSERT_EQUAL(single.openingTimeMs, batch.openingTimeMs);
+  TEST_ASSERT_EQUAL(single.openingWindowMs, batch.openingWindowMs);
+  TEST_ASSERT_EQUAL_UINT32(1, batch.rejectedErrorCount);
+  TEST_ASSERT_EQUAL_UINT32(0, batch.rejectedFrameCount);
+}
+
+void testThatLhFilterBatchRejectsTheWholeFrameWhenMostSweepsAreBadAndTheFilterIsClosed() {
+  // Fixture
+  OutlierFilterLhState_t this;
+  uint32_t time = fixtureCloseLhFilter(&this);
+
+  const float distances[] = {LH_DISTANCE, LH_DISTANCE, LH_DISTANCE, LH_DISTANCE};
+  const float angles[] = {LH_GOOD_ANGLE, LH_BAD_ANGLE, LH_BAD_ANGLE, LH_BAD_ANGLE};
+  bool accepted[4];
+
+  // Test
+  int actual = outlierFilterLighthouseValidateSweeps(&this, distances, angles, 4, time, accepted);
+
+  // Assert
+  TEST_ASSERT_EQUAL(0, actual);
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_FALSE(accepted[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, this.rejectedErrorCount);
+  TEST_ASSERT_EQUAL_UINT32(1, this.rejectedFrameCount);
+}
+
+void testThatLhFilterBatchLetsBadFramesThroughWhenOpen() {
+  // Fixture
+  OutlierFilterLhState_t this;
+  uint32_t time = fixtureOpenLhFilter(&this);
+
+  const float distances[] = {LH_DISTANCE, LH_DISTANCE, LH_DISTANCE, LH_DISTANCE};
+  const float angles[] = {LH_BAD_ANGLE, LH_BAD_ANGLE, LH_BAD_ANGLE, LH_BAD_ANGLE};
+  bool accepted[4];
+
+  // Test
+  int actual = outlierFilterLighthouseValidateSweeps(&this, distances, angles, 4, time, accepted);
+
+  // Assert
+  TEST_ASSERT_EQUAL(4, actual);
+  TEST_ASSERT_EQUAL_UINT32(0, this.rejectedFrameCount);
+}
+
+void testThatLhFilterBatchOpensForManyBadFrames() {
+  // Fixture
+  OutlierFilterLhState_t this;
+  uint32_t time = fixtureCloseLhFilter(&this);
+
+  const float distances[] = {LH_DISTANCE, LH_DISTANCE};
+  const float angles[] = {LH_BAD_ANGLE, LH_BAD_ANGLE};
+  bool accepted[2];
+
+  // Test
+  int actual = 0;
+  for (int i = 0; i < 10 && actual == 0; i++) {
+    actual = outlierFilterLighthouseValidateSweeps(&this, distances, angles, 2, time, accepted);
+    time += LH_TIME_STEP;
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL(2, actual);
+}
+
 
 // Helpers /////////////////////////////////////////////////////////////////////////////////
 uint32_t fixtureCloseLhFilter(OutlierFilterLhState_t* this) {
@@ -0,0 +1,165 @@
+// File under test outlierFilterTdoa.c
+#include "outlierFilterTdoa.h"
+
+#include "unity.h"
+
+// Helpers
+static uint32_t fixtureCloseTdoaFilter(OutlierFilterTdoaState_t* this, const float error);
+static tdoaMeasurement_t createMeasurement();
+
+
+#define TDOA_STD_DEV 0.1f
+#define TDOA_GOOD_ERROR 0.01f
+#define TDOA_BAD_ERROR 1.0f
+#define TDOA_TIME_STEP 10
+
+static OutlierFilterTdoaState_t this;
+static tdoaMeasurement_t measurement;
+
+void setUp(void) {
+  outlierFilterTdoaReset(&this);
+  measurement = createMeasurement();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTdoaFilterIsOpenAfterReset() {
+  // Fixture
+  // Test
+  bool actual = outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_BAD_ERROR, TDOA_TIME_STEP);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_TRUE(this.isFilterOpen);
+}
+
+void testThatTdoaFilterClosesForGoodSamples() {
+  // Fixture
+  // Test
+  fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Assert
+  TEST_ASSERT_FALSE(this.isFilterOpen);
+}
+
+void testThatTdoaFilterLetsGoodSampleThroughWhenClosed() {
+  // Fixture
+  uint32_t time = fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Test
+  bool actual = outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_GOOD_ERROR, time);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatTdoaFilterBlocksBadSampleWhenClosed() {
+  // Fixture
+  uint32_t time = fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Test
+  bool actual = outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_BAD_ERROR, time);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(1, this.rejectedCount);
+}
+
+void testThatTdoaFilterBlocksPhysicallyImpossibleSample() {
+  // Fixture
+  measurement.distanceDiff = 3.0f;
+
+  // Test
+  bool actual = outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_GOOD_ERROR, TDOA_TIME_STEP);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatTdoaFilterOpensForManyBadSamples() {
+  // Fixture
+  uint32_t time = fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Test
+  for (int i = 0; i < 100; i++) {
+    time += TDOA_TIME_STEP;
+    outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_BAD_ERROR, time);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(this.isFilterOpen);
+}
+
+void testThatTdoaErrorScaleStaysAtOneForSmallErrors() {
+  // Fixture
+  uint32_t time = fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Test
+  for (int i = 0; i < 1000; i++) {
+    time += TDOA_TIME_STEP;
+    outlierFilterTdoaValidateIntegrator(&this, &measurement, TDOA_GOOD_ERROR, time);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, this.errorScale);
+}
+
+void testThatTdoaErrorScaleGrowsForErrorsLargerThanTheStdDev() {
+  // Fixture
+  // Errors of 1.8 std dev, alternating sign, accepted but larger than expected
+  const float error = 1.8f * TDOA_STD_DEV;
+  uint32_t time = fixtureCloseTdoaFilter(&this, error);
+
+  // Test
+  for (int i = 0; i < 1000; i++) {
+    time += TDOA_TIME_STEP;
+    outlierFilterTdoaValidateIntegrator(&this, &measurement, (i % 2) ? error : -error, time);
+  }
+
+  // Assert
+  TEST_ASSERT_FALSE(this.isFilterOpen);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.8f, this.errorScale);
+}
+
+void testThatTdoaErrorScaleIsLimited() {
+  // Fixture
+  // Errors just below the (growing) acceptance level
+  uint32_t time = fixtureCloseTdoaFilter(&this, TDOA_GOOD_ERROR);
+
+  // Test
+  for (int i = 0; i < 2000; i++) {
+    time += TDOA_TIME_STEP;
+    const float error = 1.9f * TDOA_STD_DEV * this.errorScale;
+    outlierFilterTdoaValidateIntegrator(&this, &measurement, error, time);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, this.errorScale);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static uint32_t fixtureCloseTdoaFilter(OutlierFilterTdoaState_t* this, const float error) {
+  uint32_t time = 0;
+  for (int i = 0; i < 100 && this->isFilterOpen; i++) {
+    time += TDOA_TIME_STEP;
+    outlierFilterTdoaValidateIntegrator(this, &measurement, error, time);
+  }
+
+  return time + TDOA_TIME_STEP;
+}
+
+static tdoaMeasurement_t createMeasurement() {
+  tdoaMeasurement_t measurement = {
+    .anchorPositions = {
+      {.x = -1.0, .y = 0.0, .z = 0.0},
+      {.x = 1.0, .y = 0.0, .z = 0.0},
+    },
+    .distanceDiff = 0.5,
+    .stdDev = TDOA_STD_DEV,
+  };
+
+  return measurement;
+}
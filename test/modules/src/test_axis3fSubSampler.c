@@ -1,7 +1,10 @@
 // File under test axis3fSubSampler.c
 #include "axis3fSubSampler.h"
 
+#include <math.h>
+
 #include "unity.h"
+#include "math3d.h"
 
 Axis3fSubSampler_t subSampler;
 
@@ -9,6 +12,9 @@ const Axis3f sample1 = {.x=1.0, .y=2.0, .z=3.0};
 const Axis3f sample2 = {.x=4.0, .y=5.0, .z=6.0};
 const Axis3f sample3 = {.x=7.0, .y=8.0, .z=9.0};
 
+static struct vec rotationOf(const Axis3f* rates, const int count, const float dt);
+static struct vec toVec(const Axis3f* v);
+
 void setUp(void) {
 }
 
@@ -98,3 +104,99 @@ void testThatResultIsMultipliedWithConversionFactor() {
   TEST_ASSERT_EQUAL_FLOAT(sample1.y * 3.0f, actual->y);
   TEST_ASSERT_EQUAL_FLOAT(sample1.z * 3.0f, actual->z);
 }
+
+void testThatAccumulatedSamplesMatchTheAverageOfConvertedSamples() {
+  // Fixture
+  const float conversionFactor = radians(1.0f);
+  axis3fSubSamplerInit(&subSampler, conversionFactor);
+
+  double expectedX = 0.0;
+  double expectedY = 0.0;
+  double expectedZ = 0.0;
+  const int count = 10;
+  for (int i = 0; i < count; i++) {
+    const Axis3f sample = {.x = 100.0f * sinf(i * 0.3f), .y = -250.0f + 3.1f * i, .z = 0.01f * i};
+    axis3fSubSamplerAccumulate(&subSampler, &sample);
+
+    expectedX += sample.x * conversionFactor;
+    expectedY += sample.y * conversionFactor;
+    expectedZ += sample.z * conversionFactor;
+  }
+
+  // Test
+  Axis3f* actual = axis3fSubSamplerFinalize(&subSampler);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expectedX / count, actual->x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expectedY / count, actual->y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expectedZ / count, actual->z);
+}
+
+void testThatConingCorrectionIsZeroForAFixedAxis() {
+  // Fixture
+  axis3fSubSamplerInitConing(&subSampler, 3.0f, 0.001f);
+
+  axis3fSubSamplerAccumulateConing(&subSampler, &sample1);
+  const Axis3f doubled = {.x = 2.0f * sample1.x, .y = 2.0f * sample1.y, .z = 2.0f * sample1.z};
+  axis3fSubSamplerAccumulateConing(&subSampler, &doubled);
+
+  // Test
+  Axis3f* actual = axis3fSubSamplerFinalize(&subSampler);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(sample1.x * 1.5f * 3.0f, actual->x);
+  TEST_ASSERT_EQUAL_FLOAT(sample1.y * 1.5f * 3.0f, actual->y);
+  TEST_ASSERT_EQUAL_FLOAT(sample1.z * 1.5f * 3.0f, actual->z);
+}
+
+void testThatConingCorrectionGivesTheRotationOfTheSamples() {
+  // Fixture
+  // A coning motion, the rotation axis goes round at 20 Hz. The samples are in deg/s.
+  const float dt = 0.001f;
+  const int count = 10;
+  Axis3f rates[10];
+  Axis3f samples[10];
+  for (int i = 0; i < count; i++) {
+    const float phase = 2.0f * (float)M_PI * 20.0f * i * dt;
+    rates[i] = (Axis3f){.x = 10.0f * cosf(phase), .y = 10.0f * sinf(phase), .z = 1.0f};
+    samples[i] = (Axis3f){.x = degrees(rates[i].x), .y = degrees(rates[i].y), .z = degrees(rates[i].z)};
+  }
+
+  const struct vec expected = rotationOf(rates, count, dt);
+
+  Axis3fSubSampler_t plainSubSampler;
+  axis3fSubSamplerInit(&plainSubSampler, radians(1.0f));
+  axis3fSubSamplerInitConing(&subSampler, radians(1.0f), dt);
+  for (int i = 0; i < count; i++) {
+    axis3fSubSamplerAccumulate(&plainSubSampler, &samples[i]);
+    axis3fSubSamplerAccumulateConing(&subSampler, &samples[i]);
+  }
+
+  // Test
+  const struct vec plain = vscl(count * dt, toVec(axis3fSubSamplerFinalize(&plainSubSampler)));
+  const struct vec actual = vscl(count * dt, toVec(axis3fSubSamplerFinalize(&subSampler)));
+
+  // Assert
+  const float plainError = vmag(vsub(plain, expected));
+  const float actualError = vmag(vsub(actual, expected));
+  TEST_ASSERT_TRUE(actualError < plainError / 10.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, actualError);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// The rotation vector of the rates applied one after the other in the body frame, each for dt
+static struct vec rotationOf(const Axis3f* rates, const int count, const float dt) {
+  struct quat q = qeye();
+  for (int i = 0; i < count; i++) {
+    const struct vec step = vscl(dt, toVec(&rates[i]));
+    // qqmul(p, q) is the Hamilton product q * p
+    q = qqmul(qaxisangle(vnormalize(step), vmag(step)), q);
+  }
+
+  return vscl(quat2angle(q), quat2axis(q));
+}
+
+static struct vec toVec(const Axis3f* v) {
+  return mkvec(v->x, v->y, v->z);
+}
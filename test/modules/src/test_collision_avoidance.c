@@ -0,0 +1,202 @@
+// File under test collision_avoidance.c
+#include "collision_avoidance.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "unity.h"
+
+#define MAX_OTHERS 8
+
+static collision_avoidance_params_t params;
+static collision_avoidance_state_t collisionState;
+static float workspace[7 * (MAX_OTHERS + 6)];
+static setpoint_t setpoint;
+static state_t state;
+
+static void setVelocitySetpoint(float vx, float vy, float vz);
+static void setPositionSetpoint(float x, float y, float z);
+static setpoint_t updateSetpoint(const float* otherPositions, int nOthers);
+static setpoint_t updateSetpointWithVelocities(const float* otherPositions, const float* otherVelocities, int nOthers);
+
+void setUp(void) {
+  params = (collision_avoidance_params_t){
+    .ellipsoidRadii = { .x = 0.3, .y = 0.3, .z = 0.9 },
+    .bboxMin = { .x = -FLT_MAX, .y = -FLT_MAX, .z = -FLT_MAX },
+    .bboxMax = { .x = FLT_MAX, .y = FLT_MAX, .z = FLT_MAX },
+    .horizonSecs = 1.0f,
+    .maxSpeed = 0.5f,
+    .sidestepThreshold = 0.25f,
+    .maxPeerLocAgeMillis = 5000,
+    .voronoiProjectionTolerance = 1e-5,
+    .voronoiProjectionMaxIters = 100,
+  };
+  collisionState.lastFeasibleSetPosition = mkvec(NAN, NAN, NAN);
+  memset(&state, 0, sizeof(state));
+  memset(workspace, 0, sizeof(workspace));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatVelocityTowardsCloseNeighborIsLimited() {
+  // Fixture
+  const float others[] = {1.0f, 0.0f, 0.0f};
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+
+  // Test
+  setpoint_t actual = updateSetpoint(others, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.velocity.x < 0.5f);
+}
+
+void testThatFarNeighborsDoNotChangeTheVelocitySetpoint() {
+  // Fixture
+  const float near[] = {
+    1.0f, 0.2f, 0.0f,
+  };
+  const float nearAndFar[] = {
+    20.0f, 0.0f, 0.0f,
+    1.0f, 0.2f, 0.0f,
+    0.0f, -4.0f, 0.0f,
+    0.0f, 0.0f, 12.0f,
+  };
+  setVelocitySetpoint(0.5f, 0.0f, 0.1f);
+  setpoint_t expected = updateSetpoint(near, 1);
+
+  // Test
+  setVelocitySetpoint(0.5f, 0.0f, 0.1f);
+  setpoint_t actual = updateSetpoint(nearAndFar, 4);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.velocity.x, actual.velocity.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.velocity.y, actual.velocity.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.velocity.z, actual.velocity.z);
+}
+
+void testThatFarNeighborsDoNotChangeThePositionSetpoint() {
+  // Fixture
+  const float near[] = {
+    0.8f, 0.1f, 0.0f,
+  };
+  const float nearAndFar[] = {
+    0.8f, 0.1f, 0.0f,
+    -5.0f, 0.0f, 0.0f,
+    3.0f, 3.0f, 3.0f,
+  };
+  setPositionSetpoint(1.0f, 0.0f, 0.0f);
+  setpoint_t expected = updateSetpoint(near, 1);
+
+  // Test
+  setPositionSetpoint(1.0f, 0.0f, 0.0f);
+  setpoint_t actual = updateSetpoint(nearAndFar, 3);
+
+  // Assert
+  TEST_ASSERT_TRUE(expected.position.x < 1.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.position.x, actual.position.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.position.y, actual.position.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected.position.z, actual.position.z);
+}
+
+void testThatNeighborsAreNotCulledWhenTheHorizonIsLong() {
+  // Fixture
+  const float others[] = {6.0f, 0.0f, 0.0f};
+  params.horizonSecs = 10.0f;
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+
+  // Test
+  setpoint_t actual = updateSetpoint(others, 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual.velocity.x < 0.5f);
+}
+
+void testThatOtherPositionsMayShareTheWorkspace() {
+  // Fixture
+  const float others[] = {
+    20.0f, 0.0f, 0.0f,
+    1.0f, 0.2f, 0.0f,
+    0.0f, 0.0f, 12.0f,
+  };
+  setVelocitySetpoint(0.5f, 0.0f, 0.1f);
+  setpoint_t expected = updateSetpoint(others, 3);
+
+  memcpy(workspace, others, sizeof(others));
+  setVelocitySetpoint(0.5f, 0.0f, 0.1f);
+
+  // Test
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 3, workspace, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(expected.velocity.x, setpoint.velocity.x);
+  TEST_ASSERT_EQUAL_FLOAT(expected.velocity.y, setpoint.velocity.y);
+  TEST_ASSERT_EQUAL_FLOAT(expected.velocity.z, setpoint.velocity.z);
+}
+
+void testThatAnApproachingNeighborIsTakenIntoAccountBeforeItIsClose() {
+  // Fixture
+  const float others[] = {3.0f, 0.0f, 0.0f};
+  const float velocities[] = {-3.0f, 0.0f, 0.0f};
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+  setpoint_t const staticNeighbor = updateSetpoint(others, 1);
+
+  // Test
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+  setpoint_t actual = updateSetpointWithVelocities(others, velocities, 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, staticNeighbor.velocity.x);
+  TEST_ASSERT_TRUE(actual.velocity.x < 0.5f);
+}
+
+void testThatADivergingNeighborIsNotExtrapolated() {
+  // Fixture
+  const float others[] = {1.0f, 0.2f, 0.0f};
+  const float velocities[] = {0.5f, 0.0f, 0.0f};
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+  setpoint_t const expected = updateSetpoint(others, 1);
+
+  // Test
+  setVelocitySetpoint(0.5f, 0.0f, 0.0f);
+  setpoint_t actual = updateSetpointWithVelocities(others, velocities, 1);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.velocity.x, actual.velocity.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.velocity.y, actual.velocity.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.velocity.z, actual.velocity.z);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void setVelocitySetpoint(float vx, float vy, float vz) {
+  memset(&setpoint, 0, sizeof(setpoint));
+  setpoint.mode.x = modeVelocity;
+  setpoint.mode.y = modeVelocity;
+  setpoint.mode.z = modeVelocity;
+  setpoint.velocity.x = vx;
+  setpoint.velocity.y = vy;
+  setpoint.velocity.z = vz;
+}
+
+static void setPositionSetpoint(float x, float y, float z) {
+  memset(&setpoint, 0, sizeof(setpoint));
+  setpoint.mode.x = modeAbs;
+  setpoint.mode.y = modeAbs;
+  setpoint.mode.z = modeAbs;
+  setpoint.position.x = x;
+  setpoint.position.y = y;
+  setpoint.position.z = z;
+}
+
+static setpoint_t updateSetpoint(const float* otherPositions, int nOthers) {
+  return updateSetpointWithVelocities(otherPositions, NULL, nOthers);
+}
+
+static setpoint_t updateSetpointWithVelocities(const float* otherPositions, const float* otherVelocities, int nOthers) {
+  float scratch[7 * (MAX_OTHERS + 6)];
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, otherPositions, otherVelocities, scratch, &setpoint, 0, &state);
+  return setpoint;
+}
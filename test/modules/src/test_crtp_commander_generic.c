@@ -0,0 +1,122 @@
+// File under test crtp_commander_generic.c
+#include "crtp_commander.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+static CRTPPacket packet;
+static setpoint_t setpoint;
+
+static void createBroadcast(uint8_t format, uint8_t firstId, const int16_t* values, int valueCount);
+
+void setUp(void) {
+  memset(&packet, 0, sizeof(packet));
+  memset(&setpoint, 0, sizeof(setpoint));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatThePositionOfADroneIsFoundFromItsId() {
+  // Fixture
+  const int16_t values[] = {
+    100, 200, 300,
+    -400, 500, 600,
+    700, 800, 900,
+  };
+  createBroadcast(0, 10, values, 9);
+
+  // Test
+  bool actual = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 11, &packet);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL(modeAbs, setpoint.mode.x);
+  TEST_ASSERT_EQUAL(modeAbs, setpoint.mode.z);
+  TEST_ASSERT_EQUAL_FLOAT(-0.4f, setpoint.position.x);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, setpoint.position.y);
+  TEST_ASSERT_EQUAL_FLOAT(0.6f, setpoint.position.z);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, setpoint.velocity.x);
+  TEST_ASSERT_EQUAL(modeVelocity, setpoint.mode.yaw);
+}
+
+void testThatPositionAndVelocityAreDecoded() {
+  // Fixture
+  const int16_t values[] = {
+    100, 200, 300, 10, 20, 30,
+    400, 500, 600, -40, 50, 60,
+  };
+  createBroadcast(1, 1, values, 12);
+
+  // Test
+  bool actual = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 2, &packet);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL(modeAbs, setpoint.mode.y);
+  TEST_ASSERT_EQUAL_FLOAT(0.4f, setpoint.position.x);
+  TEST_ASSERT_EQUAL_FLOAT(-0.04f, setpoint.velocity.x);
+  TEST_ASSERT_EQUAL_FLOAT(0.06f, setpoint.velocity.z);
+  TEST_ASSERT_FALSE(setpoint.velocity_body);
+}
+
+void testThatVelocityOnlyEntriesSetVelocityMode() {
+  // Fixture
+  const int16_t values[] = {
+    250, -250, 0,
+  };
+  createBroadcast(2, 7, values, 3);
+
+  // Test
+  bool actual = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 7, &packet);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL(modeVelocity, setpoint.mode.x);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, setpoint.velocity.x);
+  TEST_ASSERT_EQUAL_FLOAT(-0.25f, setpoint.velocity.y);
+}
+
+void testThatIdsOutsideThePacketAreIgnored() {
+  // Fixture
+  const int16_t values[] = {
+    100, 200, 300,
+    400, 500, 600,
+  };
+  createBroadcast(0, 10, values, 6);
+  setpoint.position.x = 42.0f;
+
+  // Test
+  bool below = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 9, &packet);
+  bool above = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 12, &packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(below);
+  TEST_ASSERT_FALSE(above);
+  TEST_ASSERT_EQUAL_FLOAT(42.0f, setpoint.position.x);
+}
+
+void testThatUnknownFormatsAreIgnored() {
+  // Fixture
+  const int16_t values[] = {
+    100, 200, 300,
+  };
+  createBroadcast(3, 10, values, 3);
+
+  // Test
+  bool actual = crtpCommanderGenericDecodeBroadcastSetpoint(&setpoint, 10, &packet);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void createBroadcast(uint8_t format, uint8_t firstId, const int16_t* values, int valueCount) {
+  packet.data[0] = format;
+  packet.data[1] = firstId;
+  memcpy(&packet.data[2], values, valueCount * sizeof(int16_t));
+  packet.size = 2 + valueCount * sizeof(int16_t);
+}
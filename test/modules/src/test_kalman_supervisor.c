@@ -1,12 +1,20 @@
 // File under test kalman_supervisor.c
 #include "kalman_supervisor.h"
 
+#include <math.h>
+
 #include "unity.h"
 
 kalmanCoreData_t coreData;
 
+// The full covariance sweep is scheduled in the supervisor, every test starts at a time where it is due
+static uint32_t nowMs;
+
+static void initValidState(kalmanCoreData_t* data);
+
 void setUp(void) {
   memset(&coreData, 0, sizeof(coreData));
+  nowMs += 10000;
 }
 
 void tearDown(void) {
@@ -72,3 +80,75 @@ void testThatVelocityOutOfBoundsNegativeIsNotAccepted() {
   // Assert
   TEST_ASSERT_EQUAL(actual, expected);
 }
+
+void testThatNaNPositionIsNotAccepted() {
+  // Fixture
+  bool expected = false;
+  coreData.S[KC_STATE_Y] = NAN;
+
+  // Test
+  bool actual = kalmanSupervisorIsStateWithinBounds(&coreData);
+
+  // Assert
+  TEST_ASSERT_EQUAL(actual, expected);
+}
+
+void testThatValidStateIsAccepted() {
+  // Fixture
+  initValidState(&coreData);
+
+  // Test
+  bool actual = kalmanSupervisorIsStateValid(&coreData, nowMs);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatNaNInQuaternionIsNotAccepted() {
+  // Fixture
+  initValidState(&coreData);
+  coreData.q[2] = NAN;
+
+  // Test
+  bool actual = kalmanSupervisorIsStateValid(&coreData, nowMs);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatNaNInCovarianceDiagonalIsNotAcceptedAtEveryCall() {
+  // Fixture
+  initValidState(&coreData);
+  kalmanSupervisorIsStateValid(&coreData, nowMs);
+  coreData.P[KC_PACKED_INDEX(KC_STATE_PY, KC_STATE_PY)] = NAN;
+
+  // Test
+  bool actual = kalmanSupervisorIsStateValid(&coreData, nowMs + 10);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatNaNOffTheCovarianceDiagonalIsFoundByTheFullSweep() {
+  // Fixture
+  initValidState(&coreData);
+  kalmanSupervisorIsStateValid(&coreData, nowMs);
+  coreData.P[KC_PACKED_INDEX(KC_STATE_X, KC_STATE_D1)] = -INFINITY;
+
+  // Test
+  bool actualBetweenSweeps = kalmanSupervisorIsStateValid(&coreData, nowMs + 10);
+  bool actualAtSweep = kalmanSupervisorIsStateValid(&coreData, nowMs + 1000);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualBetweenSweeps);
+  TEST_ASSERT_FALSE(actualAtSweep);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static void initValidState(kalmanCoreData_t* data) {
+  data->q[0] = 1.0f;
+  for (int i = 0; i < KC_STATE_DIM; i++) {
+    data->P[KC_PACKED_INDEX(i, i)] = 0.01f;
+  }
+}
@@ -10,7 +10,10 @@
 
 #include "mock_crtp.h"
 #include "mock_storage.h"
+#include "mock_worker.h"
 #include "crc32.h"
+#include "toc_index.h"
+#include "toc_blob.h"
 
 // linker symbols mock
 int _sdata;
@@ -34,6 +37,14 @@ static int32_t myPersistent = 0;
 static float myPersistentFloat = 0;
 static int8_t myShortPersistent = 0;
 static float myFloat = 0.0f;
+static uint8_t myCallbackA = 0;
+static uint8_t myCallbackB = 0;
+static uint8_t myReadOnly = 0;
+
+static int callbackCount = 0;
+static void countingCallback(void) {
+  callbackCount++;
+}
 
 // Storage fetch mock
 static int32_t* fetchMockBuffer = 0;
@@ -52,6 +63,9 @@ PARAM_ADD(PARAM_FLOAT, myFloat, &myFloat)
 PARAM_ADD_CORE(PARAM_FLOAT | PARAM_PERSISTENT, myPersistent, &myPersistent)
 PARAM_ADD_CORE(PARAM_FLOAT | PARAM_PERSISTENT, myPersistentFloat, &myPersistentFloat)
 PARAM_ADD_CORE(PARAM_INT8 | PARAM_PERSISTENT, myShortPersistent, &myShortPersistent)
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, myCallbackA, &myCallbackA, &countingCallback)
+PARAM_ADD_WITH_CALLBACK(PARAM_UINT8, myCallbackB, &myCallbackB, &countingCallback)
+PARAM_ADD(PARAM_UINT8 | PARAM_RONLY, myReadOnly, &myReadOnly)
 PARAM_GROUP_STOP(myGroup)
 
 CRTPPacket replyPk;
@@ -72,6 +86,8 @@ void setUp(void) {
   fetchMockBufferLength = 0;
   fetchMockExpectedKey = "";
 
+  callbackCount = 0;
+
   paramLogicInit();
 }
 
@@ -464,3 +480,529 @@ void testPersistentGetStateWithNonExistingParameter(void) {
   TEST_ASSERT_EQUAL_UINT8(testPk.size, replyPk.size);
   TEST_ASSERT_EQUAL_UINT8_ARRAY(&testPk.data[0], &replyPk.data[0], replyPk.size);
 }
+
+static int storeMockCount = 0;
+static bool storageStoreMockFunc(const char* key, const void* buffer, size_t length, int cmock_num_calls)
+{
+  storeMockCount++;
+  return true;
+}
+
+// Returns the current value of myPersistentFloat, nothing is stored for the other keys
+static size_t storageFetchUnchangedFloatMockFunc(const char *key, void* buffer, size_t length, int cmock_num_calls)
+{
+  if (strcmp(key, "prm/myGroup.myPersistentFloat") != 0) {
+    return 0;
+  }
+
+  memcpy(buffer, &myPersistentFloat, sizeof(myPersistentFloat));
+  return sizeof(myPersistentFloat);
+}
+
+static int workerRunNowMockFunc(void (*function)(void*), void *arg, const workerOptions_t* options, int cmock_num_calls)
+{
+  function(arg);
+  return 0;
+}
+
+CRTPPacket donePk;
+static int crtpDone(CRTPPacket* p, int cmock_num_calls)
+{
+  memcpy(&donePk, p, sizeof(CRTPPacket));
+
+  return 1;
+}
+
+void testPersistentStoreBulkStoresOnlyChangedValues(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myPersistent = 17;
+  myPersistentFloat = 2.5f;
+  storeMockCount = 0;
+
+  testPk.data[0] = MISC_PERSISTENT_STORE_BULK;
+  // Id 7, myPersistent
+  testPk.data[1] = 7;
+  testPk.data[2] = 0;
+  // Id 8, myPersistentFloat
+  testPk.data[3] = 8;
+  testPk.data[4] = 0;
+  testPk.size = 5;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+  crtpSendPacket_StubWithCallback(crtpDone);
+  workerScheduleWithOptions_StubWithCallback(workerRunNowMockFunc);
+  storageFetch_StubWithCallback(storageFetchUnchangedFloatMockFunc);
+  storageStore_StubWithCallback(storageStoreMockFunc);
+  storageFlush_ExpectAndReturn(true);
+
+  // Test
+  paramPersistentStoreBulk(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[2]);
+  TEST_ASSERT_EQUAL_INT(1, storeMockCount);
+  TEST_ASSERT_EQUAL_UINT8(MISC_PERSISTENT_STORE_BULK_DONE, donePk.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(1, donePk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(1, donePk.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(0, donePk.data[3]);
+}
+
+void testPersistentStoreBulkWithNonExistingParameterStoresNothing(void) {
+  // Fixture
+  CRTPPacket testPk;
+
+  testPk.data[0] = MISC_PERSISTENT_STORE_BULK;
+  // Id 7, myPersistent
+  testPk.data[1] = 7;
+  testPk.data[2] = 0;
+  // Non existing id
+  testPk.data[3] = 0x47;
+  testPk.data[4] = 0x11;
+  testPk.size = 5;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramPersistentStoreBulk(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(ENOENT, replyPk.data[2]);
+}
+
+void testBulkWriteSetsAllValues(void) {
+  // Fixture
+  CRTPPacket testPk;
+  uint16_t expectedUint16 = 0x1234;
+  float expectedFloat = 3.5f;
+  myUint16 = 0;
+  myFloat = 0.0f;
+
+  testPk.data[0] = MISC_BULK_WRITE;
+  // Id 1, myUint16
+  testPk.data[1] = 1;
+  testPk.data[2] = 0;
+  memcpy(&testPk.data[3], &expectedUint16, sizeof(expectedUint16));
+  // Id 6, myFloat
+  testPk.data[5] = 6;
+  testPk.data[6] = 0;
+  memcpy(&testPk.data[7], &expectedFloat, sizeof(expectedFloat));
+  testPk.size = 11;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkWrite(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(expectedUint16, myUint16);
+  TEST_ASSERT_EQUAL_FLOAT(expectedFloat, myFloat);
+  TEST_ASSERT_EQUAL_UINT8(3, replyPk.size);
+  TEST_ASSERT_EQUAL_UINT8(2, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[2]);
+}
+
+void testBulkWriteWithNonExistingParameterWritesNothing(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myUint8 = 0;
+
+  testPk.data[0] = MISC_BULK_WRITE;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  // Non existing id
+  testPk.data[4] = 0x47;
+  testPk.data[5] = 0x11;
+  testPk.data[6] = 1;
+  testPk.size = 7;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkWrite(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, myUint8);
+  TEST_ASSERT_EQUAL_UINT8(1, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(ENOENT, replyPk.data[2]);
+}
+
+void testBulkWriteWithTruncatedValueWritesNothing(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myUint8 = 0;
+
+  testPk.data[0] = MISC_BULK_WRITE;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  // Id 2, myUint32 with only 2 bytes of value
+  testPk.data[4] = 2;
+  testPk.data[5] = 0;
+  testPk.data[6] = 1;
+  testPk.data[7] = 2;
+  testPk.size = 8;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkWrite(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, myUint8);
+  TEST_ASSERT_EQUAL_UINT8(1, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, replyPk.data[2]);
+}
+
+void testBulkWriteToReadOnlyParameterIsRejected(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myReadOnly = 0;
+
+  testPk.data[0] = MISC_BULK_WRITE;
+  // Id 12, myReadOnly
+  testPk.data[1] = 12;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  testPk.size = 4;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkWrite(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, myReadOnly);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(EACCES, replyPk.data[2]);
+}
+
+void testBulkWriteCallsSharedCallbackOnce(void) {
+  // Fixture
+  CRTPPacket testPk;
+
+  testPk.data[0] = MISC_BULK_WRITE;
+  // Id 10, myCallbackA
+  testPk.data[1] = 10;
+  testPk.data[2] = 0;
+  testPk.data[3] = 1;
+  // Id 11, myCallbackB
+  testPk.data[4] = 11;
+  testPk.data[5] = 0;
+  testPk.data[6] = 2;
+  testPk.size = 7;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkWrite(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, myCallbackA);
+  TEST_ASSERT_EQUAL_UINT8(2, myCallbackB);
+  TEST_ASSERT_EQUAL_INT(1, callbackCount);
+}
+
+void testTransactionIsNotVisibleBeforeApply(void) {
+  // Fixture
+  CRTPPacket testPk;
+  uint16_t expectedUint16 = 0x1234;
+  myUint8 = 0;
+  myUint16 = 0;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  testPk.data[0] = MISC_TXN_STAGE;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  testPk.size = 4;
+  paramTransactionStage(&testPk);
+
+  testPk.data[0] = MISC_TXN_COMMIT;
+  // Id 1, myUint16
+  testPk.data[1] = 1;
+  testPk.data[2] = 0;
+  memcpy(&testPk.data[3], &expectedUint16, sizeof(expectedUint16));
+  testPk.size = 5;
+
+  // Test
+  paramTransactionCommit(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, myUint8);
+  TEST_ASSERT_EQUAL_UINT16(0, myUint16);
+  TEST_ASSERT_EQUAL_UINT8(2, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[2]);
+}
+
+void testTransactionIsSetByApply(void) {
+  // Fixture
+  CRTPPacket testPk;
+  float expectedFloat = 3.5f;
+  myUint8 = 0;
+  myFloat = 0.0f;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  testPk.data[0] = MISC_TXN_COMMIT;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  // Id 6, myFloat
+  testPk.data[4] = 6;
+  testPk.data[5] = 0;
+  memcpy(&testPk.data[6], &expectedFloat, sizeof(expectedFloat));
+  testPk.size = 10;
+  paramTransactionCommit(&testPk);
+
+  // Test
+  paramTransactionApply();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(17, myUint8);
+  TEST_ASSERT_EQUAL_FLOAT(expectedFloat, myFloat);
+}
+
+void testTransactionCallsSharedCallbackOnce(void) {
+  // Fixture
+  CRTPPacket testPk;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  testPk.data[0] = MISC_TXN_COMMIT;
+  // Id 10, myCallbackA
+  testPk.data[1] = 10;
+  testPk.data[2] = 0;
+  testPk.data[3] = 1;
+  // Id 11, myCallbackB
+  testPk.data[4] = 11;
+  testPk.data[5] = 0;
+  testPk.data[6] = 2;
+  testPk.size = 7;
+  paramTransactionCommit(&testPk);
+
+  // Test
+  paramTransactionApply();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, myCallbackA);
+  TEST_ASSERT_EQUAL_UINT8(2, myCallbackB);
+  TEST_ASSERT_EQUAL_INT(1, callbackCount);
+}
+
+void testTransactionStageIsRejectedWhileCommitted(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myUint8 = 0;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  testPk.data[0] = MISC_TXN_COMMIT;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  testPk.size = 4;
+  paramTransactionCommit(&testPk);
+
+  testPk.data[0] = MISC_TXN_STAGE;
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 42;
+  testPk.size = 4;
+
+  // Test
+  paramTransactionStage(&testPk);
+  paramTransactionApply();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(EBUSY, replyPk.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(17, myUint8);
+}
+
+void testTransactionAbortDropsStagedValues(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myUint8 = 0;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  testPk.data[0] = MISC_TXN_STAGE;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  testPk.data[3] = 17;
+  testPk.size = 4;
+  paramTransactionStage(&testPk);
+
+  testPk.data[0] = MISC_TXN_ABORT;
+  testPk.size = 1;
+  paramTransactionAbort(&testPk);
+
+  testPk.data[0] = MISC_TXN_COMMIT;
+  testPk.size = 1;
+
+  // Test
+  paramTransactionCommit(&testPk);
+  paramTransactionApply();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(0, myUint8);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[1]);
+}
+
+void testBulkReadReturnsAllValues(void) {
+  // Fixture
+  CRTPPacket testPk;
+  myUint8 = 0xAB;
+  myInt32 = -2;
+
+  testPk.data[0] = MISC_BULK_READ;
+  // Id 0, myUint8
+  testPk.data[1] = 0;
+  testPk.data[2] = 0;
+  // Id 5, myInt32
+  testPk.data[3] = 5;
+  testPk.data[4] = 0;
+  testPk.size = 5;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkRead(&testPk);
+
+  // Assert
+  int32_t actualInt32;
+  memcpy(&actualInt32, &replyPk.data[4], sizeof(actualInt32));
+  TEST_ASSERT_EQUAL_UINT8(8, replyPk.size);
+  TEST_ASSERT_EQUAL_UINT8(2, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(0xAB, replyPk.data[3]);
+  TEST_ASSERT_EQUAL_INT32(-2, actualInt32);
+}
+
+void testBulkReadStopsWhenPacketIsFull(void) {
+  // Fixture
+  CRTPPacket testPk;
+
+  testPk.data[0] = MISC_BULK_READ;
+  // Request myInt32 (id 5) 8 times, only 6 values fit in the answer
+  for (int i = 0; i < 8; i++) {
+    testPk.data[1 + i * 2] = 5;
+    testPk.data[2 + i * 2] = 0;
+  }
+  testPk.size = 17;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+
+  // Test
+  paramBulkRead(&testPk);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(6, replyPk.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, replyPk.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(3 + 6 * 4, replyPk.size);
+}
+
+void testTocBlobStartsWithHeaderAndFirstParameter(void) {
+  // Fixture
+  uint8_t expected[] = {TOC_BLOB_VERSION, 13, 0, 0, 0, 0, 0,
+    PARAM_UINT8, 'm', 'y', 'G', 'r', 'o', 'u', 'p', 0, 'm', 'y', 'U', 'i', 'n', 't', '8', 0,
+    PARAM_UINT16, 0, 'm', 'y', 'U', 'i', 'n', 't', '1', '6', 0};
+  uint8_t actual[sizeof(expected)];
+
+  // Test
+  bool result = paramTocBlobRead(0, sizeof(actual), actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  // Count and CRC are not checked
+  TEST_ASSERT_EQUAL_UINT8(expected[0], actual[0]);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&expected[7], &actual[7], sizeof(expected) - 7);
+}
+
+static void resetParamValues(void) {
+  myUint8 = 0;
+  myUint16 = 0;
+  myUint32 = 0;
+  myInt8 = 0;
+  myInt16 = 0;
+  myInt32 = 0;
+  myFloat = 0.0f;
+  myPersistent = 0;
+  myPersistentFloat = 0.0f;
+  myShortPersistent = 0;
+  myCallbackA = 0;
+  myCallbackB = 0;
+  myReadOnly = 0;
+}
+
+void testStateBlobHasChangedBitmapAndValues(void) {
+  // Fixture
+  resetParamValues();
+  myUint16 = 0x1234;
+  myFloat = 1.0f;
+  myReadOnly = 3;
+
+  // Header, 2 bytes of changed bitmap, 2 bytes of stored bitmap, then myUint8 and myUint16
+  uint8_t expected[] = {TOC_BLOB_VERSION, 13, 0, 0, 0, 0, 0,
+    (1 << 1) | (1 << 6), 0,
+    0, 0,
+    0, 0x34, 0x12};
+  uint8_t actual[sizeof(expected)];
+
+  // Test
+  bool result = paramStateBlobRead(0, sizeof(actual), actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  // CRC is not checked
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&expected[0], &actual[0], 3);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&expected[7], &actual[7], sizeof(expected) - 7);
+}
+
+void testStateBlobHasStoredBitmap(void) {
+  // Fixture
+  CRTPPacket testPk;
+  resetParamValues();
+
+  testPk.data[0] = MISC_PERSISTENT_STORE;
+  // Id 8, myPersistentFloat
+  testPk.data[1] = 8;
+  testPk.data[2] = 0;
+  testPk.size = 3;
+
+  crtpSendPacketBlock_StubWithCallback(crtpReply);
+  storageStore_StubWithCallback(storageStoreMockFunc);
+  paramPersistentStore(&testPk);
+
+  uint8_t expected[] = {0, 1 << 0};
+  uint8_t actual[sizeof(expected)];
+
+  // Test
+  bool result = paramStateBlobRead(9, sizeof(actual), actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, sizeof(expected));
+}
+
+void testStateBlobSizeCoversAllValues(void) {
+  // Fixture
+  // Header, two bitmaps and the values of 6 1-byte, 2 2-byte and 5 4-byte variables
+  const uint32_t expected = 7 + 2 * 2 + 6 * 1 + 2 * 2 + 5 * 4;
+
+  // Test
+  const uint32_t actual = paramStateBlobGetSize();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(expected, actual);
+}
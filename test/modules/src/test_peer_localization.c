@@ -0,0 +1,164 @@
+// File under test peer_localization.c
+#include "peer_localization.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+static uint32_t nowMs;
+
+static positionMeasurement_t createPosition(float x);
+static void fillTable();
+
+void setUp(void) {
+  nowMs = 1000;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAPeerCanBeLookedUpById() {
+  // Fixture
+  positionMeasurement_t pos = createPosition(1.5f);
+  peerLocalizationTellPosition(201, &pos);
+
+  // Test
+  peerLocalizationOtherPosition_t actual;
+  bool found = peerLocalizationGetPositionByID(201, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_EQUAL_UINT8(201, actual.id);
+  TEST_ASSERT_EQUAL_FLOAT(1.5f, actual.pos.x);
+  TEST_ASSERT_EQUAL_UINT32(nowMs, actual.pos.timestamp);
+}
+
+void testThatAnUnknownIdIsNotFound() {
+  // Fixture
+  peerLocalizationOtherPosition_t actual;
+
+  // Test
+  bool found = peerLocalizationGetPositionByID(202, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(found);
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(202));
+}
+
+void testThatIdZeroIsRejected() {
+  // Fixture
+  positionMeasurement_t pos = createPosition(1.0f);
+
+  // Test
+  bool actual = peerLocalizationTellPosition(0, &pos);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(0));
+}
+
+void testThatAnUpdateOfAKnownPeerReusesTheEntry() {
+  // Fixture
+  positionMeasurement_t pos = createPosition(1.0f);
+  peerLocalizationTellPosition(203, &pos);
+  const uint8_t countBefore = peerLocalizationGetTable()->count;
+
+  pos = createPosition(2.0f);
+  nowMs += 10;
+
+  // Test
+  peerLocalizationTellPosition(203, &pos);
+
+  // Assert
+  peerLocalizationOtherPosition_t actual;
+  peerLocalizationGetPositionByID(203, &actual);
+  TEST_ASSERT_EQUAL_UINT8(countBefore, peerLocalizationGetTable()->count);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual.pos.x);
+  TEST_ASSERT_EQUAL_UINT32(nowMs, actual.pos.timestamp);
+}
+
+void testThatAMocapPositionClearsTheVelocity() {
+  // Fixture
+  positionMeasurement_t pos = createPosition(1.0f);
+  velocity_t vel = {.x = 0.5f, .y = 0.0f, .z = 0.0f};
+  peerLocalizationTellPositionVelocity(204, &pos, &vel);
+  const peerLocalizationTable_t* table = peerLocalizationGetTable();
+  const uint8_t idx = table->count - 1;
+  TEST_ASSERT_TRUE(table->hasVelocity[idx]);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, table->vx[idx]);
+
+  // Test
+  peerLocalizationTellPosition(204, &pos);
+
+  // Assert
+  TEST_ASSERT_FALSE(table->hasVelocity[idx]);
+}
+
+void testThatTheOldestPeerIsEvictedWhenTheTableIsFull() {
+  // Fixture
+  fillTable();
+  const peerLocalizationTable_t* table = peerLocalizationGetTable();
+  const uint8_t oldestId = table->id[0];
+
+  positionMeasurement_t pos = createPosition(3.0f);
+  nowMs += 10;
+
+  // Test
+  bool actual = peerLocalizationTellPosition(250, &pos);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT8(PEER_LOCALIZATION_MAX_NEIGHBORS, table->count);
+  TEST_ASSERT_TRUE(peerLocalizationIsIDActive(250));
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(oldestId));
+  TEST_ASSERT_EQUAL_UINT8(250, table->id[0]);
+}
+
+void testThatTheTableIsPackedForIteration() {
+  // Fixture
+  fillTable();
+
+  // Test
+  const peerLocalizationTable_t* actual = peerLocalizationGetTable();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(PEER_LOCALIZATION_MAX_NEIGHBORS, actual->count);
+  for (int i = 0; i < actual->count; i++) {
+    peerLocalizationOtherPosition_t pos;
+    TEST_ASSERT_TRUE(peerLocalizationGetPositionByIdx(i, &pos));
+    TEST_ASSERT_EQUAL_UINT8(actual->id[i], pos.id);
+    TEST_ASSERT_EQUAL_FLOAT(actual->x[i], pos.pos.x);
+    TEST_ASSERT_TRUE(peerLocalizationIsIDActive(actual->id[i]));
+  }
+
+  peerLocalizationOtherPosition_t pos;
+  TEST_ASSERT_FALSE(peerLocalizationGetPositionByIdx(actual->count, &pos));
+}
+
+// Helpers ////////////////////////////////////////////////
+
+uint32_t xTaskGetTickCount() {
+  return nowMs;
+}
+
+static positionMeasurement_t createPosition(float x) {
+  positionMeasurement_t pos = {.x = x, .y = 0.0f, .z = 0.0f, .stdDev = 0.01f};
+  return pos;
+}
+
+// Fills the table with peers, the first entry has the oldest position
+static void fillTable() {
+  const peerLocalizationTable_t* table = peerLocalizationGetTable();
+  positionMeasurement_t pos = createPosition(1.0f);
+
+  for (int id = 1; table->count < PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    peerLocalizationTellPosition(id, &pos);
+  }
+
+  for (int i = 0; i < table->count; i++) {
+    nowMs += 10;
+    const int id = table->id[i];
+    peerLocalizationTellPosition(id, &pos);
+  }
+}
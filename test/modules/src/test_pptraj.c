@@ -246,6 +246,7 @@ void testFigure8Evaluation(void) {
 
   traj.t_begin = 2;
   traj.timescale = 1;
+  traj.scale = vrepeat(1);
   traj.shift = vzero();
   traj.n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
   traj.pieces = figure8_pieces;
@@ -384,6 +385,7 @@ void testCompressedFigure8RandomOrderQueries(void) {
 
   traj.t_begin = 2;
   traj.timescale = 1;
+  traj.scale = vrepeat(1);
   traj.shift = vzero();
   traj.n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
   traj.pieces = figure8_pieces;
@@ -431,3 +433,421 @@ void testCompressedFigure8RandomOrderQueries(void) {
   printf("Maximum difference = %.4f\n", maxdiff);
 #endif
 }
+
+static struct traj_eval evalWithoutCache(struct piecewise_traj const *traj, float t, bool reversed);
+static float evalDiff(struct traj_eval const *a, struct traj_eval const *b);
+static void initFigure8(struct piecewise_traj *traj);
+static void assertVecWithin(float delta, struct vec expected, struct vec actual);
+
+void testThatCachedEvaluationMatchesFullSearchInRandomOrder(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  traj.timescale = 1.5;
+  const float duration = piecewise_duration(&traj);
+  float maxdiff = 0.0;
+
+  // Test
+  for (int i = 0; i < 200; i++) {
+    const float t = traj.t_begin + (rand() / (float)RAND_MAX) * (duration + 1) - 0.5f;
+    struct traj_eval actual = piecewise_eval(&traj, t);
+    struct traj_eval expected = evalWithoutCache(&traj, t, false);
+    maxdiff = MAX(maxdiff, evalDiff(&actual, &expected));
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, maxdiff);
+}
+
+void testThatCachedReversedEvaluationMatchesFullSearch(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  const float duration = piecewise_duration(&traj);
+  float maxdiff = 0.0;
+
+  // Test
+  for (float t = traj.t_begin - 0.5f; t < traj.t_begin + duration + 0.5f; t += 0.01f) {
+    struct traj_eval actual = piecewise_eval_reversed(&traj, t);
+    struct traj_eval expected = evalWithoutCache(&traj, t, true);
+    maxdiff = MAX(maxdiff, evalDiff(&actual, &expected));
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, maxdiff);
+}
+
+void testThatTheCacheFollowsShiftAndTimescaleChanges(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  const float t = traj.t_begin + 1.5f;
+  piecewise_eval(&traj, t);
+
+  traj.shift = mkvec(3, -2, 1);
+  traj.timescale = 2;
+
+  // Test
+  struct traj_eval actual = piecewise_eval(&traj, t);
+
+  // Assert
+  struct traj_eval expected = evalWithoutCache(&traj, t, false);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0, evalDiff(&actual, &expected));
+}
+
+void testThatTheCacheFollowsScaleChanges(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  const float t = traj.t_begin + 1.5f;
+  piecewise_eval(&traj, t);
+
+  traj.scale = mkvec(2, 0.5, 1);
+
+  // Test
+  struct traj_eval actual = piecewise_eval(&traj, t);
+
+  // Assert
+  struct traj_eval expected = evalWithoutCache(&traj, t, false);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0, evalDiff(&actual, &expected));
+}
+
+void testThatScaledEvaluationMatchesFullSearch(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  traj.scale = mkvec(1.5, -2, 0.5);
+  const float duration = piecewise_duration(&traj);
+  float maxdiff = 0.0;
+
+  // Test
+  for (float t = traj.t_begin - 0.5f; t < traj.t_begin + duration + 0.5f; t += 0.01f) {
+    struct traj_eval actual = piecewise_eval(&traj, t);
+    struct traj_eval expected = evalWithoutCache(&traj, t, false);
+    maxdiff = MAX(maxdiff, evalDiff(&actual, &expected));
+
+    actual = piecewise_eval_reversed(&traj, t);
+    expected = evalWithoutCache(&traj, t, true);
+    maxdiff = MAX(maxdiff, evalDiff(&actual, &expected));
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, maxdiff);
+}
+
+void testThatTheScaleIsAppliedBeforeTheShift(void) {
+  // Fixture
+  struct poly4d piece = poly4d_linear(2, mkvec(1, 2, 3), mkvec(2, 4, 6), 0, 0);
+  struct piecewise_traj traj;
+  memset(&traj, 0, sizeof(traj));
+  traj.timescale = 1;
+  traj.n_pieces = 1;
+  traj.pieces = &piece;
+  traj.scale = mkvec(2, -1, 0.5);
+  traj.shift = mkvec(1, 1, 1);
+
+  // Test
+  struct traj_eval start = piecewise_eval(&traj, 0);
+  struct traj_eval end = piecewise_eval(&traj, 3);
+
+  // Assert
+  assertVecWithin(1e-5, mkvec(3, -1, 2.5), start.pos);
+  assertVecWithin(1e-5, mkvec(1, -1, 0.75), start.vel);
+  assertVecWithin(1e-5, mkvec(5, -3, 4), end.pos);
+}
+
+void testThatResetCacheIsRequiredAfterModifyingPiecesInPlace(void) {
+  // Fixture
+  struct poly4d pieces[2];
+  memcpy(pieces, figure8_pieces, sizeof(pieces));
+  struct piecewise_traj traj;
+  initFigure8(&traj);
+  traj.n_pieces = 2;
+  traj.pieces = pieces;
+  const float t = traj.t_begin + 0.5f;
+  piecewise_eval(&traj, t);
+
+  pieces[0].p[0][0] += 1.0f;
+
+  // Test
+  piecewise_reset_cache(&traj);
+  struct traj_eval actual = piecewise_eval(&traj, t);
+
+  // Assert
+  struct traj_eval expected = evalWithoutCache(&traj, t, false);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0, evalDiff(&actual, &expected));
+}
+
+static struct traj_eval evalWithPolyder(struct poly4d const *p, float t);
+
+void testThatFusedEvaluationMatchesDifferentiatedPolynomials(void) {
+  // Fixture
+  const int n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+
+  for (int i = 0; i < n_pieces; i++) {
+    struct poly4d piece = figure8_pieces[i];
+    // Exercise all axes and yaw, the figure 8 is flat
+    for (int j = 0; j < PP_SIZE; j++) {
+      piece.p[2][j] = 0.5f * piece.p[0][j] - 0.25f * piece.p[1][j];
+      piece.p[3][j] = 0.3f * piece.p[1][j];
+    }
+
+    for (float t = 0; t <= piece.duration; t += 0.05f) {
+      // Test
+      struct traj_eval actual = poly4d_eval(&piece, t);
+
+      // Assert
+      struct traj_eval expected = evalWithPolyder(&piece, t);
+      assertVecWithin(1e-5, expected.pos, actual.pos);
+      assertVecWithin(1e-4, expected.vel, actual.vel);
+      assertVecWithin(1e-4, expected.acc, actual.acc);
+      assertVecWithin(1e-3, expected.jerk, actual.jerk);
+      TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.yaw, actual.yaw);
+    }
+  }
+}
+
+void testThatYawRateIsTheDerivativeOfYawWhenLevel(void) {
+  // Fixture
+  struct poly4d piece = poly4d_zero(2);
+  piece.p[3][0] = 0.1f;
+  piece.p[3][1] = 0.5f;
+  piece.p[3][2] = -0.2f;
+
+  // Test
+  struct traj_eval actual = poly4d_eval(&piece, 0.75f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.1f + 0.5f * 0.75f - 0.2f * 0.75f * 0.75f, actual.yaw);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5f - 0.4f * 0.75f, actual.omega.z);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, actual.omega.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, actual.omega.y);
+}
+
+#define LONG_TRAJ_PIECES 100
+
+static int buildLongCompressedTrajectory(uint8_t* data, int n_pieces);
+static struct traj_eval evalCompressedSequentially(const uint8_t* data, float t);
+
+void testThatTheCompressedSeekIndexCoversLongTrajectories(void) {
+  // Fixture
+  static uint8_t data[8 + LONG_TRAJ_PIECES * 9 + 3];
+  buildLongCompressedTrajectory(data, LONG_TRAJ_PIECES);
+  struct piecewise_traj_compressed ctraj;
+
+  // Test
+  piecewise_compressed_load(&ctraj, data);
+
+  // Assert
+  TEST_ASSERT_TRUE(ctraj.n_index > PPTRAJ_COMPRESSED_INDEX_SIZE / 2);
+  TEST_ASSERT_TRUE(ctraj.n_index <= PPTRAJ_COMPRESSED_INDEX_SIZE);
+  TEST_ASSERT_EQUAL_PTR(&data[8], ctraj.index[0].data);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, ctraj.index[0].t_begin_relative);
+  for (int i = 1; i < ctraj.n_index; i++) {
+    TEST_ASSERT_TRUE(ctraj.index[i].t_begin_relative > ctraj.index[i - 1].t_begin_relative);
+  }
+}
+
+void testThatCompressedSeeksMatchSequentialDecodingInRandomOrder(void) {
+  // Fixture
+  static uint8_t data[8 + LONG_TRAJ_PIECES * 9 + 3];
+  buildLongCompressedTrajectory(data, LONG_TRAJ_PIECES);
+  struct piecewise_traj_compressed ctraj;
+  piecewise_compressed_load(&ctraj, data);
+  ctraj.t_begin = 2;
+  const float duration = piecewise_compressed_duration(&ctraj);
+  float maxdiff = 0.0;
+
+  // Test
+  for (int i = 0; i < 200; i++) {
+    const float t = ctraj.t_begin + (rand() / (float)RAND_MAX) * (duration + 1) - 0.5f;
+    struct traj_eval actual = piecewise_compressed_eval(&ctraj, t);
+    struct traj_eval expected = evalCompressedSequentially(data, t - ctraj.t_begin);
+    maxdiff = MAX(maxdiff, evalDiff(&actual, &expected));
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, maxdiff);
+}
+
+void testThatCompressedDurationIsCalculatedAtLoad(void) {
+  // Fixture
+  static uint8_t data[8 + LONG_TRAJ_PIECES * 9 + 3];
+  buildLongCompressedTrajectory(data, LONG_TRAJ_PIECES);
+  struct piecewise_traj_compressed ctraj;
+
+  // Test
+  piecewise_compressed_load(&ctraj, data);
+
+  // Assert
+  // The pieces are 200, 300 and 400 ms long, in turns
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 33 * 0.9f + 0.2f, piecewise_compressed_duration(&ctraj));
+}
+
+void testThatBoundsOfALinearPieceHaveConstantVelocity(void) {
+  // Fixture
+  struct poly4d piece = poly4d_linear(2, mkvec(0, 0, 1), mkvec(3, 4, 1), 0, 0);
+  struct traj_bounds bounds = traj_bounds_zero();
+
+  // Test
+  poly4d_bounds_approx(&piece, &bounds);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2, bounds.duration);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.5, bounds.max_vel);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, bounds.max_acc);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, bounds.max_jerk);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, bounds.max_tilt);
+}
+
+void testThatBoundsOfAConstantAccelerationPieceGiveTheTilt(void) {
+  // Fixture
+  const float acc = 3.0f;
+  struct poly4d piece = poly4d_zero(1);
+  piece.p[0][2] = acc / 2;
+  struct traj_bounds bounds = traj_bounds_zero();
+
+  // Test
+  poly4d_bounds_approx(&piece, &bounds);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, acc, bounds.max_vel);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, acc, bounds.max_acc);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, atanf(acc / 9.81f), bounds.max_tilt);
+}
+
+void testThatBoundsAccumulateOverPieces(void) {
+  // Fixture
+  struct poly4d slow = poly4d_linear(1, mkvec(0, 0, 1), mkvec(1, 0, 1), 0, 0);
+  struct poly4d fast = poly4d_linear(0.5, mkvec(1, 0, 1), mkvec(3, 0, 1), 0, 0);
+  struct traj_bounds bounds = traj_bounds_zero();
+
+  // Test
+  poly4d_bounds_approx(&slow, &bounds);
+  poly4d_bounds_approx(&fast, &bounds);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.5, bounds.duration);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 4, bounds.max_vel);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// The search from the first piece at every call, as before the cache was added
+static struct traj_eval evalWithoutCache(struct piecewise_traj const *traj, float t, bool reversed) {
+  struct poly4d tmp;
+  t = t - traj->t_begin;
+  for (int i = 0; i < traj->n_pieces; i++) {
+    struct poly4d const *piece = &(traj->pieces[reversed ? traj->n_pieces - 1 - i : i]);
+    if (t <= piece->duration * traj->timescale) {
+      tmp = *piece;
+      poly4d_scale(&tmp, traj->scale.x, traj->scale.y, traj->scale.z, 1);
+      poly4d_shift(&tmp, traj->shift.x, traj->shift.y, traj->shift.z, 0);
+      poly4d_stretchtime(&tmp, traj->timescale);
+      if (reversed) {
+        for (int j = 0; j < 4; ++j) {
+          polyreflect(tmp.p[j]);
+        }
+        t = t - piece->duration * traj->timescale;
+      }
+      return poly4d_eval(&tmp, t);
+    }
+    t -= piece->duration * traj->timescale;
+  }
+
+  struct poly4d const *end_piece = reversed ? &(traj->pieces[0]) : &(traj->pieces[traj->n_pieces - 1]);
+  struct traj_eval ev = poly4d_eval(end_piece, reversed ? 0.0f : end_piece->duration);
+  ev.pos = vadd(veltmul(ev.pos, traj->scale), traj->shift);
+  ev.vel = vzero();
+  ev.acc = vzero();
+  ev.jerk = vzero();
+  ev.omega = vzero();
+  return ev;
+}
+
+static float evalDiff(struct traj_eval const *a, struct traj_eval const *b) {
+  float diff = 0.0;
+  diff = MAX(diff, vmag(vsub(a->pos, b->pos)));
+  diff = MAX(diff, vmag(vsub(a->vel, b->vel)));
+  diff = MAX(diff, vmag(vsub(a->acc, b->acc)));
+  diff = MAX(diff, fabsf(a->yaw - b->yaw));
+  return diff;
+}
+
+static void initFigure8(struct piecewise_traj *traj) {
+  memset(traj, 0, sizeof(*traj));
+  traj->t_begin = 2;
+  traj->timescale = 1;
+  traj->scale = vrepeat(1);
+  traj->n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+  traj->pieces = figure8_pieces;
+  traj->shift = mkvec(-1, 2, 3);
+}
+
+// Evaluation by explicitly differentiating the polynomial, as before the fused evaluation was added
+static struct traj_eval evalWithPolyder(struct poly4d const *p, float t) {
+  struct traj_eval ev;
+  struct poly4d deriv = *p;
+  ev.pos = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  ev.yaw = polyval(deriv.p[3], t);
+  polyder4d(&deriv);
+  ev.vel = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  polyder4d(&deriv);
+  ev.acc = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  polyder4d(&deriv);
+  ev.jerk = mkvec(polyval(deriv.p[0], t), polyval(deriv.p[1], t), polyval(deriv.p[2], t));
+  return ev;
+}
+
+static void assertVecWithin(float delta, struct vec expected, struct vec actual) {
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.x, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.y, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.z, actual.z);
+}
+
+static void putInt16(uint8_t* data, int16_t value) {
+  data[0] = value & 0xff;
+  data[1] = (value >> 8) & 0xff;
+}
+
+// A trajectory of linear pieces in x, y and z with a constant yaw. Returns the size in bytes.
+static int buildLongCompressedTrajectory(uint8_t* data, int n_pieces) {
+  int len = 0;
+  putInt16(&data[len], 100); len += 2;
+  putInt16(&data[len], -200); len += 2;
+  putInt16(&data[len], 300); len += 2;
+  putInt16(&data[len], 450); len += 2;
+
+  for (int i = 0; i < n_pieces; i++) {
+    data[len++] = PPTRAJ_STORAGE_LINEAR | (PPTRAJ_STORAGE_LINEAR << 2) | (PPTRAJ_STORAGE_LINEAR << 4);
+    putInt16(&data[len], 200 + (i % 3) * 100); len += 2;
+    putInt16(&data[len], (i * 37) % 500 - 250); len += 2;
+    putInt16(&data[len], (i * 53) % 400 - 200); len += 2;
+    putInt16(&data[len], 300 + (i * 17) % 200); len += 2;
+  }
+
+  data[len++] = 0;
+  putInt16(&data[len], 0); len += 2;
+  return len;
+}
+
+// Decodes from the start of the trajectory at every call, as before the seek index was added
+static struct traj_eval evalCompressedSequentially(const uint8_t* data, float t) {
+  struct traj_eval prev_end;
+  struct poly4d piece;
+  const uint8_t* ptr = piecewise_compressed_decode_start(data, &prev_end);
+  float t_begin = 0;
+
+  while (piecewise_compressed_piece_size(ptr) > 0) {
+    piecewise_compressed_decode_piece(ptr, &prev_end, &piece);
+    if (t < t_begin + piece.duration) {
+      return poly4d_eval(&piece, t - t_begin);
+    }
+    prev_end = poly4d_eval(&piece, piece.duration);
+    t_begin += piece.duration;
+    ptr += piecewise_compressed_piece_size(ptr);
+  }
+
+  piecewise_compressed_decode_piece(ptr, &prev_end, &piece);
+  return poly4d_eval(&piece, 0);
+}
@@ -0,0 +1,273 @@
+// File under test pptraj_stream.c
+#include "pptraj_stream.h"
+#include "pptraj.h"
+#include "pptraj_compressed.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+#define CAPACITY 4
+
+static struct poly4d buffer[CAPACITY];
+static struct piecewise_traj_stream stream;
+
+static struct poly4d linearPiece(float duration, float x0, float x1);
+static int addCompressedStart(uint8_t* data, int16_t x, int16_t y, int16_t z, int16_t yaw);
+static int addCompressedLinearX(uint8_t* data, uint16_t durationMs, int16_t x1);
+static int addCompressedEnd(uint8_t* data);
+
+void setUp(void) {
+  memset(buffer, 0, sizeof(buffer));
+  piecewise_stream_init(&stream, buffer, CAPACITY);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAppendFailsWhenTheRingBufferIsFull() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  for (int i = 0; i < CAPACITY; i++) {
+    TEST_ASSERT_TRUE(piecewise_stream_append(&stream, &piece));
+  }
+
+  // Test
+  bool actual = piecewise_stream_append(&stream, &piece);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_INT(0, piecewise_stream_free(&stream));
+}
+
+void testThatEvaluationFollowsTheAppendedPieces() {
+  // Fixture
+  struct poly4d p1 = linearPiece(1, 0, 1);
+  struct poly4d p2 = linearPiece(2, 1, 3);
+  piecewise_stream_append(&stream, &p1);
+  piecewise_stream_append(&stream, &p2);
+  stream.t_begin = 10;
+
+  // Test
+  struct traj_eval actual1 = piecewise_stream_eval(&stream, 10.5);
+  struct traj_eval actual2 = piecewise_stream_eval(&stream, 12);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.5, actual1.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0, actual1.vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.0, actual2.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0, actual2.vel.x);
+}
+
+void testThatPassedPiecesAreReleased() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  for (int i = 0; i < CAPACITY; i++) {
+    piecewise_stream_append(&stream, &piece);
+  }
+
+  // Test
+  piecewise_stream_eval(&stream, 2.5);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, piecewise_stream_free(&stream));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.0, stream.t_begin);
+}
+
+void testThatTheRingBufferWrapsAround() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  for (int i = 0; i < CAPACITY; i++) {
+    piecewise_stream_append(&stream, &piece);
+  }
+  piecewise_stream_eval(&stream, 3.5);
+  struct poly4d last = linearPiece(1, 5, 6);
+
+  // Test
+  bool appended = piecewise_stream_append(&stream, &last);
+  struct traj_eval actual = piecewise_stream_eval(&stream, 4.5);
+
+  // Assert
+  TEST_ASSERT_TRUE(appended);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.5, actual.pos.x);
+}
+
+void testThatUnderrunHoldsTheEndPoint() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  piecewise_stream_append(&stream, &piece);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&stream, 1.5);
+
+  // Assert
+  TEST_ASSERT_TRUE(stream.underrun);
+  TEST_ASSERT_EQUAL_UINT32(1, stream.underrun_count);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.0, actual.vel.x);
+  TEST_ASSERT_FALSE(piecewise_stream_is_finished(&stream, 1.5));
+}
+
+void testThatTheTrajectoryContinuesFromTheHoldPointAfterAnUnderrun() {
+  // Fixture
+  struct poly4d p1 = linearPiece(1, 0, 1);
+  struct poly4d p2 = linearPiece(1, 1, 2);
+  piecewise_stream_append(&stream, &p1);
+  piecewise_stream_eval(&stream, 1.5);
+  piecewise_stream_eval(&stream, 3.0);
+  piecewise_stream_append(&stream, &p2);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&stream, 3.25);
+
+  // Assert
+  TEST_ASSERT_FALSE(stream.underrun);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.25, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0, actual.vel.x);
+}
+
+void testThatACompleteStreamFinishesAtTheEndOfTheLastPiece() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  piecewise_stream_append(&stream, &piece);
+  piecewise_stream_append(&stream, &piece);
+  piecewise_stream_set_complete(&stream);
+
+  // Test
+  bool finishedBefore = piecewise_stream_is_finished(&stream, 1.9);
+  piecewise_stream_eval(&stream, 2.5);
+  bool finishedAfter = piecewise_stream_is_finished(&stream, 2.5);
+
+  // Assert
+  TEST_ASSERT_FALSE(finishedBefore);
+  TEST_ASSERT_TRUE(finishedAfter);
+  TEST_ASSERT_FALSE(stream.underrun);
+  TEST_ASSERT_FALSE(piecewise_stream_append(&stream, &piece));
+}
+
+void testThatTimescaleStretchesThePieces() {
+  // Fixture
+  struct poly4d piece = linearPiece(1, 0, 1);
+  piecewise_stream_append(&stream, &piece);
+  piecewise_stream_append(&stream, &piece);
+  stream.timescale = 2;
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&stream, 1.0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.5, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.5, actual.vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 4.0, piecewise_stream_buffered_duration(&stream));
+}
+
+void testThatCompressedPiecesMatchTheCompressedTrajectory() {
+  // Fixture
+  uint8_t data[64];
+  int len = addCompressedStart(data, 100, 200, 300, 0);
+  const int firstLen = len + addCompressedLinearX(&data[len], 1000, 600);
+  len = firstLen;
+  len += addCompressedLinearX(&data[len], 500, -400);
+  addCompressedEnd(&data[len]);
+
+  struct piecewise_traj_compressed compressed;
+  piecewise_compressed_load(&compressed, data);
+
+  // Test
+  int appendedFirst = piecewise_stream_append_compressed(&stream, data, firstLen, 1);
+  int appendedSecond = piecewise_stream_append_compressed(&stream, &data[firstLen], len - firstLen, 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, appendedFirst);
+  TEST_ASSERT_EQUAL_INT(1, appendedSecond);
+  for (float t = 0.0f; t < 1.5f; t += 0.1f) {
+    struct traj_eval expected = piecewise_compressed_eval(&compressed, t);
+    struct traj_eval actual = piecewise_stream_eval(&stream, t);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.x, actual.pos.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.y, actual.pos.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.z, actual.pos.z);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.vel.x, actual.vel.x);
+  }
+}
+
+void testThatACompressedEndMarkerCompletesTheStream() {
+  // Fixture
+  uint8_t data[64];
+  int len = addCompressedStart(data, 0, 0, 0, 0);
+  len += addCompressedLinearX(&data[len], 1000, 600);
+  len += addCompressedEnd(&data[len]);
+
+  // Test
+  int actual = piecewise_stream_append_compressed(&stream, data, len, 5);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, actual);
+  TEST_ASSERT_TRUE(stream.complete);
+}
+
+void testThatTruncatedCompressedDataIsRejected() {
+  // Fixture
+  uint8_t data[64];
+  int len = addCompressedStart(data, 0, 0, 0, 0);
+  len += addCompressedLinearX(&data[len], 1000, 600);
+  len += addCompressedLinearX(&data[len], 1000, 0);
+
+  // Test
+  int actual = piecewise_stream_append_compressed(&stream, data, len - 1, 2);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, actual);
+  TEST_ASSERT_EQUAL_INT(CAPACITY, piecewise_stream_free(&stream));
+}
+
+void testThatCompressedPiecesThatDoNotFitAreRejected() {
+  // Fixture
+  uint8_t data[128];
+  int len = addCompressedStart(data, 0, 0, 0, 0);
+  for (int i = 0; i < CAPACITY + 1; i++) {
+    len += addCompressedLinearX(&data[len], 1000, i * 100);
+  }
+
+  // Test
+  int actual = piecewise_stream_append_compressed(&stream, data, len, CAPACITY + 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, actual);
+  TEST_ASSERT_EQUAL_INT(CAPACITY, piecewise_stream_free(&stream));
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static struct poly4d linearPiece(float duration, float x0, float x1) {
+  struct poly4d piece = poly4d_zero(duration);
+  polylinear(piece.p[0], duration, x0, x1);
+  return piece;
+}
+
+static void addInt16(uint8_t* data, int16_t value) {
+  data[0] = value & 0xff;
+  data[1] = (value >> 8) & 0xff;
+}
+
+static int addCompressedStart(uint8_t* data, int16_t x, int16_t y, int16_t z, int16_t yaw) {
+  addInt16(&data[0], x);
+  addInt16(&data[2], y);
+  addInt16(&data[4], z);
+  addInt16(&data[6], yaw);
+  return PPTRAJ_COMPRESSED_START_SIZE;
+}
+
+// Linear in x, constant in y, z and yaw
+static int addCompressedLinearX(uint8_t* data, uint16_t durationMs, int16_t x1) {
+  data[0] = PPTRAJ_STORAGE_LINEAR;
+  addInt16(&data[1], durationMs);
+  addInt16(&data[3], x1);
+  return PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE + 2;
+}
+
+static int addCompressedEnd(uint8_t* data) {
+  data[0] = 0;
+  addInt16(&data[1], 0);
+  return PPTRAJ_COMPRESSED_PIECE_HEADER_SIZE;
+}
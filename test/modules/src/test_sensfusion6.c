@@ -0,0 +1,90 @@
+// File under test sensfusion6.c
+#include "sensfusion6.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+#define TILT_DEG 20.0f
+
+// The filter state in sensfusion6.c
+extern float qw, qx, qy, qz;
+extern float integralFBx, integralFBy, integralFBz;
+
+typedef void (*updateFn_t)(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+static void runTilted(updateFn_t update, const int steps, const float dt);
+
+void setUp(void) {
+  qw = 1.0f;
+  qx = 0.0f;
+  qy = 0.0f;
+  qz = 0.0f;
+  integralFBx = 0.0f;
+  integralFBy = 0.0f;
+  integralFBz = 0.0f;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheFastUpdateMatchesTheNormalUpdate() {
+  // Fixture
+  float expectedRoll, expectedPitch, expectedYaw;
+  runTilted(sensfusion6UpdateQ, 200, 0.004f);
+  sensfusion6GetEulerRPY(&expectedRoll, &expectedPitch, &expectedYaw);
+
+  setUp();
+
+  // Test
+  float actualRoll, actualPitch, actualYaw;
+  runTilted(sensfusion6UpdateQFast, 200, 0.004f);
+  sensfusion6GetEulerRPY(&actualRoll, &actualPitch, &actualYaw);
+
+  // Assert
+  // The normal update normalizes with an approximate inverse square root
+  TEST_ASSERT_TRUE(expectedRoll > 1.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, expectedRoll, actualRoll);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, expectedPitch, actualPitch);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, expectedYaw, actualYaw);
+}
+
+void testThatTheFastUpdateConvergesToTheAccelerometerTilt() {
+  // Fixture
+  float roll, pitch, yaw;
+
+  // Test
+  runTilted(sensfusion6UpdateQFast, 20000, 0.001f);
+
+  // Assert
+  sensfusion6GetEulerRPY(&roll, &pitch, &yaw);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, TILT_DEG, roll);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, pitch);
+}
+
+void testThatTheFastUpdateIgnoresAZeroAccelerometerMeasurement() {
+  // Fixture
+  float x, y, z, w;
+
+  // Test
+  for (int i = 0; i < 100; i++) {
+    sensfusion6UpdateQFast(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.001f);
+  }
+
+  // Assert
+  sensfusion6GetQuaternion(&x, &y, &z, &w);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, w);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, x);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, y);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+// Runs the update with the accelerometer tilted TILT_DEG around the x axis
+static void runTilted(updateFn_t update, const int steps, const float dt) {
+  const float tilt = TILT_DEG * (float)M_PI / 180.0f;
+  for (int i = 0; i < steps; i++) {
+    update(0.0f, 0.0f, 0.0f, 0.0f, sinf(tilt), cosf(tilt), dt);
+  }
+}
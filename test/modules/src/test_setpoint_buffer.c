@@ -0,0 +1,239 @@
+// File under test setpoint_buffer.c
+#include "setpoint_buffer.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+static setpointBuffer_t buffer;
+static setpointBufferConfig_t config;
+
+static setpoint_t positionSetpoint(float x, float yaw);
+static void pushPosition(float x, uint16_t senderTime, uint32_t arrivalTime);
+static setpoint_t get(uint32_t nowMs);
+
+void setUp(void) {
+  memset(&buffer, 0, sizeof(buffer));
+  setpointBufferReset(&buffer);
+  config = (setpointBufferConfig_t){.latencyMs = 20, .maxExtrapolationMs = 30};
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAnEmptyBufferHasNoSetpoint() {
+  // Fixture
+  setpoint_t actual;
+
+  // Test
+  bool result = setpointBufferGet(&buffer, &config, 1000, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
+
+void testThatTheFirstSetpointIsHeldUntilItIsPlayed() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+
+  // Test
+  setpoint_t actual = get(1005);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, actual.position.x);
+  TEST_ASSERT_EQUAL(modeAbs, actual.mode.x);
+}
+
+void testThatSetpointsAreInterpolatedAtThePlaybackTime() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  pushPosition(2.0f, 120, 1020);
+
+  // Test
+  // Playback runs 20 ms behind the arrivals, 1025 plays sender time 105
+  setpoint_t actual = get(1025);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.25f, actual.position.x);
+}
+
+void testThatJitterInTheArrivalTimeIsHidden() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  // Delayed by the radio, but still within the latency
+  pushPosition(2.0f, 120, 1035);
+
+  // Test
+  setpoint_t actual = get(1030);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.5f, actual.position.x);
+  TEST_ASSERT_EQUAL_INT32(15, buffer.jitterMs);
+  TEST_ASSERT_EQUAL_UINT32(0, buffer.lateCount);
+}
+
+void testThatYawIsInterpolatedTheShortestWay() {
+  // Fixture
+  setpoint_t setpoint = positionSetpoint(0.0f, 170.0f);
+  setpointBufferPush(&buffer, &setpoint, 100, 1000);
+  setpoint = positionSetpoint(0.0f, -170.0f);
+  setpointBufferPush(&buffer, &setpoint, 120, 1020);
+
+  // Test
+  setpoint_t actual = get(1035);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, -175.0f, actual.attitude.yaw);
+}
+
+void testThatTheLastSetpointsAreExtrapolatedWhenTheBufferRunsDry() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  pushPosition(2.0f, 120, 1020);
+  get(1040);
+
+  // Test
+  setpoint_t actual = get(1050);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 2.5f, actual.position.x);
+  TEST_ASSERT_EQUAL_UINT32(1, buffer.extrapolationCount);
+}
+
+void testThatExtrapolationIsLimited() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  pushPosition(2.0f, 120, 1020);
+  get(1040);
+
+  // Test
+  setpoint_t actual = get(1200);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 3.5f, actual.position.x);
+  TEST_ASSERT_EQUAL_UINT32(1, buffer.holdCount);
+}
+
+void testThatSetpointsWithDifferentModesAreNotBlended() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  setpoint_t velocity = {.mode.x = modeVelocity, .velocity.x = 0.5f};
+  setpointBufferPush(&buffer, &velocity, 120, 1020);
+
+  // Test
+  setpoint_t before = get(1039);
+  setpoint_t after = get(1040);
+
+  // Assert
+  TEST_ASSERT_EQUAL(modeAbs, before.mode.x);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, before.position.x);
+  TEST_ASSERT_EQUAL(modeVelocity, after.mode.x);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, after.velocity.x);
+}
+
+void testThatOldAndDuplicateSetpointsAreDropped() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  pushPosition(2.0f, 120, 1020);
+  setpoint_t setpoint = positionSetpoint(5.0f, 0.0f);
+
+  // Test
+  bool duplicate = setpointBufferPush(&buffer, &setpoint, 120, 1021);
+  bool old = setpointBufferPush(&buffer, &setpoint, 110, 1022);
+
+  // Assert
+  TEST_ASSERT_FALSE(duplicate);
+  TEST_ASSERT_FALSE(old);
+  TEST_ASSERT_EQUAL(2, setpointBufferGetDepth(&buffer));
+}
+
+void testThatTheSenderTimeIsUnwrapped() {
+  // Fixture
+  pushPosition(1.0f, 65526, 1000);
+  pushPosition(2.0f, 10, 1020);
+
+  // Test
+  setpoint_t actual = get(1030);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.5f, actual.position.x);
+}
+
+void testThatALateSetpointIsCounted() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  get(1050);
+
+  // Test
+  pushPosition(2.0f, 120, 1055);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1, buffer.lateCount);
+}
+
+void testThatTheOldestSetpointIsDroppedWhenTheBufferIsFull() {
+  // Fixture
+  for (int i = 0; i < SETPOINT_BUFFER_SIZE; i++) {
+    pushPosition(i, 100 + i * 10, 1000 + i * 10);
+  }
+
+  // Test
+  pushPosition(100.0f, 200, 1100);
+
+  // Assert
+  TEST_ASSERT_EQUAL(SETPOINT_BUFFER_SIZE, setpointBufferGetDepth(&buffer));
+  TEST_ASSERT_EQUAL_UINT32(1, buffer.overflowCount);
+}
+
+void testThatTheResultHasTheArrivalTimeOfTheNewestSetpoint() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  pushPosition(2.0f, 120, 1020);
+
+  // Test
+  setpoint_t actual = get(1021);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1020, actual.timestamp);
+}
+
+void testThatTheBufferIsRestartedAfterAPause() {
+  // Fixture
+  pushPosition(1.0f, 100, 1000);
+  get(1100);
+
+  // Test
+  // The sender has restarted its clock
+  pushPosition(2.0f, 5, 1000 + SETPOINT_BUFFER_RESYNC_MS + 1);
+  setpoint_t actual = get(1000 + SETPOINT_BUFFER_RESYNC_MS + 2);
+
+  // Assert
+  TEST_ASSERT_EQUAL(1, setpointBufferGetDepth(&buffer));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual.position.x);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static setpoint_t positionSetpoint(float x, float yaw) {
+  setpoint_t setpoint = {
+    .mode.x = modeAbs,
+    .mode.y = modeAbs,
+    .mode.z = modeAbs,
+    .mode.yaw = modeAbs,
+    .position.x = x,
+    .attitude.yaw = yaw,
+  };
+  return setpoint;
+}
+
+static void pushPosition(float x, uint16_t senderTime, uint32_t arrivalTime) {
+  setpoint_t setpoint = positionSetpoint(x, 0.0f);
+  setpointBufferPush(&buffer, &setpoint, senderTime, arrivalTime);
+}
+
+static setpoint_t get(uint32_t nowMs) {
+  setpoint_t result;
+  setpointBufferGet(&buffer, &config, nowMs, &result);
+  return result;
+}
@@ -0,0 +1,143 @@
+// File under test sim_quadrotor.c
+#include "sim_quadrotor.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+static simQuadrotor_t model;
+static simQuadrotorParams_t params;
+
+static uint16_t hoverRatio();
+static void run(const uint16_t ratio[STABILIZER_NR_OF_MOTORS], const int steps);
+
+void setUp(void) {
+  simQuadrotorDefaultParams(&params);
+  simQuadrotorInit(&model, &params, mkvec(1.0f, 2.0f, 0.0f), 0.0f);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheModelStaysOnTheGroundWithoutThrust() {
+  // Fixture
+  const uint16_t ratio[] = {0, 0, 0, 0};
+
+  // Test
+  run(ratio, 1000);
+
+  // Assert
+  TEST_ASSERT_TRUE(model.isOnGround);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, model.position.z);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, model.position.x);
+}
+
+void testThatTheAccelerometerReadsOneGAtRest() {
+  // Fixture
+  const uint16_t ratio[] = {0, 0, 0, 0};
+  run(ratio, 10);
+
+  // Test
+  Axis3f actual;
+  simQuadrotorGetAcc(&model, &actual);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, actual.z);
+}
+
+void testThatTheModelTakesOffWithFullThrust() {
+  // Fixture
+  const uint16_t ratio[] = {UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX};
+
+  // Test
+  run(ratio, 500);
+
+  // Assert
+  TEST_ASSERT_FALSE(model.isOnGround);
+  TEST_ASSERT_TRUE(model.position.z > 0.1f);
+  TEST_ASSERT_TRUE(model.velocity.z > 0.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, model.angularVelocity.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, model.angularVelocity.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, model.angularVelocity.z);
+}
+
+void testThatTheModelHoversWithHoverThrust() {
+  // Fixture
+  const uint16_t takeOff[] = {UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX};
+  run(takeOff, 200);
+  const uint16_t hover = hoverRatio();
+  const uint16_t ratio[] = {hover, hover, hover, hover};
+  run(ratio, 100);
+  const float velocityBefore = model.velocity.z;
+
+  // Test
+  run(ratio, 500);
+
+  // Assert
+  TEST_ASSERT_TRUE(velocityBefore > 0.0f);
+  TEST_ASSERT_TRUE(model.velocity.z < velocityBefore);
+  TEST_ASSERT_TRUE(model.velocity.z > 0.0f);
+}
+
+void testThatMoreThrustOnTheLeftMotorsRollsRight() {
+  // Fixture
+  // In the same way as powerDistributionLegacy() with a positive roll
+  const uint16_t ratio[] = {50000, 50000, 60000, 60000};
+
+  // Test
+  run(ratio, 100);
+
+  // Assert
+  Axis3f gyro;
+  simQuadrotorGetGyro(&model, &gyro);
+  TEST_ASSERT_TRUE(gyro.x > 0.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, gyro.y);
+}
+
+void testThatMoreThrustOnTheBackMotorsPitchesForward() {
+  // Fixture
+  const uint16_t ratio[] = {50000, 60000, 60000, 50000};
+
+  // Test
+  run(ratio, 100);
+
+  // Assert
+  Axis3f gyro;
+  simQuadrotorGetGyro(&model, &gyro);
+  TEST_ASSERT_TRUE(gyro.y > 0.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, gyro.x);
+}
+
+void testThatTheBarometerMatchesTheAltitude() {
+  // Fixture
+  model.position.z = 2.0f;
+
+  // Test
+  baro_t actual;
+  simQuadrotorGetBaro(&model, &actual);
+
+  // Assert
+  const float expectedAsl = ((powf((1015.7f / actual.pressure), 0.1902630958f) - 1.0f) * (25.0f + 273.15f)) / 0.0065f;
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f, expectedAsl);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual.asl);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static uint16_t hoverRatio() {
+  // thrust = a * pwm^2 + b * pwm  =>  pwm = (-b + sqrt(b^2 + 4 * a * thrust)) / (2 * a)
+  const float thrust = params.mass * 9.81f / 4.0f;
+  const float a = params.pwmToThrustA;
+  const float b = params.pwmToThrustB;
+  const float pwm = (sqrtf(b * b + 4.0f * a * thrust) - b) / (2.0f * a);
+  return pwm * UINT16_MAX;
+}
+
+static void run(const uint16_t ratio[STABILIZER_NR_OF_MOTORS], const int steps) {
+  for (int i = 0; i < steps; i++) {
+    simQuadrotorStep(&model, ratio, 0.001f);
+  }
+}
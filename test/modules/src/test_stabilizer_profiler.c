@@ -0,0 +1,88 @@
+// File under test stabilizer_profiler.c
+#include "stabilizer_profiler.h"
+
+#include "unity.h"
+
+void setUp(void) {
+  stabilizerProfilerInit();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatSmallValuesEndUpInTheFirstBin() {
+  // Fixture
+  const uint32_t largestSmallValue = (1 << STABILIZER_PROFILER_FIRST_BIT) - 1;
+
+  // Test
+  const int actual = stabilizerProfilerBin(largestSmallValue);
+
+  // Assert
+  TEST_ASSERT_EQUAL(0, actual);
+  TEST_ASSERT_EQUAL(0, stabilizerProfilerBin(0));
+}
+
+void testThatBinsArePowersOfTwo() {
+  // Fixture
+  const uint32_t firstInBin1 = 1 << STABILIZER_PROFILER_FIRST_BIT;
+  const uint32_t firstInBin2 = 2 << STABILIZER_PROFILER_FIRST_BIT;
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL(1, stabilizerProfilerBin(firstInBin1));
+  TEST_ASSERT_EQUAL(1, stabilizerProfilerBin(firstInBin2 - 1));
+  TEST_ASSERT_EQUAL(2, stabilizerProfilerBin(firstInBin2));
+}
+
+void testThatLargeValuesEndUpInTheLastBin() {
+  // Fixture
+  const uint32_t largeValue = 0xffffffff;
+
+  // Test
+  const int actual = stabilizerProfilerBin(largeValue);
+
+  // Assert
+  TEST_ASSERT_EQUAL(STABILIZER_PROFILER_HISTOGRAM_BINS - 1, actual);
+}
+
+void testThatHistogramIsPublishedAfterTheInterval() {
+  // Fixture
+  stabilizerProfilerAdd(StabilizerStageController, 300);
+  stabilizerProfilerAdd(StabilizerStageController, 400);
+  stabilizerProfilerAdd(StabilizerStageController, 5000);
+
+  // Test
+  const bool actual = stabilizerProfilerUpdate(STABILIZER_PROFILER_INTERVAL_MS + 1);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  const stabilizerProfilerStageStats_t* stats = stabilizerProfilerGetStage(StabilizerStageController);
+  TEST_ASSERT_EQUAL_UINT16(2, stats->latestBins[stabilizerProfilerBin(300)]);
+  TEST_ASSERT_EQUAL_UINT16(1, stats->latestBins[stabilizerProfilerBin(5000)]);
+  TEST_ASSERT_EQUAL_UINT32(300, stats->cycles.latestMin);
+  TEST_ASSERT_EQUAL_UINT32(5000, stats->cycles.latestMax);
+  TEST_ASSERT_EQUAL_UINT16(0, stats->bins[stabilizerProfilerBin(300)]);
+}
+
+void testThatHistogramIsNotPublishedBeforeTheInterval() {
+  // Fixture
+  stabilizerProfilerAdd(StabilizerStageMotors, 300);
+
+  // Test
+  const bool actual = stabilizerProfilerUpdate(STABILIZER_PROFILER_INTERVAL_MS - 1);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  const stabilizerProfilerStageStats_t* stats = stabilizerProfilerGetStage(StabilizerStageMotors);
+  TEST_ASSERT_EQUAL_UINT16(0, stats->latestBins[stabilizerProfilerBin(300)]);
+}
+
+void testThatUnknownStageReturnsNull() {
+  // Fixture
+  // Test
+  const stabilizerProfilerStageStats_t* actual = stabilizerProfilerGetStage(StabilizerStage_COUNT);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+}
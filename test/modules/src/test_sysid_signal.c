@@ -0,0 +1,118 @@
+// File under test sysid_signal.c
+#include "sysid_signal.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+static sysidSignalState_t state;
+static sysidSignalConfig_t config;
+
+void setUp(void) {
+  sysidSignalInit(&state);
+  config = (sysidSignalConfig_t){
+    .amplitude = 2.0f,
+    .durationMs = 1000,
+    .f0 = 1.0f,
+    .f1 = 21.0f,
+    .prbsBitMs = 10,
+  };
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatStepIsZeroDuringTheFirstQuarter() {
+  // Fixture
+  config.signal = sysidSignalStep;
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, sysidSignalValue(&state, &config, 0));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, sysidSignalValue(&state, &config, 249));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, sysidSignalValue(&state, &config, 250));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, sysidSignalValue(&state, &config, 999));
+}
+
+void testThatChirpStartsAtTheStartFrequency() {
+  // Fixture
+  config.signal = sysidSignalChirp;
+
+  // Test
+  // A quarter of a period at 1 Hz, plus the phase of the 20 Hz/s sweep
+  const float actual = sysidSignalValue(&state, &config, 250);
+
+  // Assert
+  const float expected = 2.0f * sinf(2.0f * (float)M_PI * (0.25f + 0.5f * 20.0f * 0.25f * 0.25f));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, expected, actual);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, sysidSignalValue(&state, &config, 0));
+}
+
+void testThatChirpEndsAtTheEndFrequency() {
+  // Fixture
+  config.signal = sysidSignalChirp;
+
+  // Test
+  // The period is 1 / 21 s at the end, the phase advances by about 2 * pi * 21 / 1000 per ms
+  const float before = sysidSignalValue(&state, &config, 999);
+  const float after = sysidSignalValue(&state, &config, 1000);
+
+  // Assert
+  // At the end the phase is 2 * pi * (1 + 10) = a multiple of 2 * pi
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, after);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -2.0f * sinf(2.0f * (float)M_PI * 21.0f / 1000.0f), before);
+}
+
+void testThatPrbsIsHeldForTheBitTime() {
+  // Fixture
+  config.signal = sysidSignalPrbs;
+  const float first = sysidSignalValue(&state, &config, 0);
+
+  // Test
+  // Assert
+  for (uint32_t t = 1; t < config.prbsBitMs; t++) {
+    TEST_ASSERT_EQUAL_FLOAT(first, sysidSignalValue(&state, &config, t));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, fabsf(first));
+}
+
+void testThatPrbsIsBalanced() {
+  // Fixture
+  config.signal = sysidSignalPrbs;
+  config.prbsBitMs = 1;
+
+  // Test
+  float sum = 0.0f;
+  int changes = 0;
+  float previous = sysidSignalValue(&state, &config, 0);
+  for (uint32_t t = 1; t < 65535; t++) {
+    const float value = sysidSignalValue(&state, &config, t);
+    sum += value;
+    if (value != previous) {
+      changes++;
+    }
+    previous = value;
+  }
+
+  // Assert
+  // A maximal length sequence has one more one than zeros over a period, and half of the runs have length 1
+  TEST_ASSERT_FLOAT_WITHIN(4.0f, 0.0f, sum);
+  TEST_ASSERT_INT_WITHIN(16, 32768, changes);
+}
+
+void testThatPrbsCatchesUpWhenSamplesAreMissed() {
+  // Fixture
+  config.signal = sysidSignalPrbs;
+  sysidSignalState_t reference;
+  sysidSignalInit(&reference);
+  for (uint32_t t = 0; t <= 100; t++) {
+    sysidSignalValue(&reference, &config, t);
+  }
+
+  // Test
+  const float actual = sysidSignalValue(&state, &config, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(sysidSignalValue(&reference, &config, 100), actual);
+}
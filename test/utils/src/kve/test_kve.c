@@ -1,6 +1,7 @@
 // File under test kve.c
 #include "kve/kve.h"
 #include "kve/kve_storage.h"
+#include "kve/kve_index.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -47,6 +48,22 @@ static kveMemory_t kve = {
   .flush = flush,
 };
 
+// Same memory, with a key index
+#define KVE_INDEX_SIZE 1024
+static kveIndexSlot_t kveIndexSlots[KVE_INDEX_SIZE];
+static kveIndex_t kveIndex = {
+  .slots = kveIndexSlots,
+  .size = KVE_INDEX_SIZE,
+};
+
+static kveMemory_t kveIndexed = {
+  .memorySize = KVE_PARTITION_LENGTH,
+  .read = read,
+  .write = write,
+  .flush = flush,
+  .index = &kveIndex,
+};
+
 static bool fromStorageOneKey(const char *key, void *buffer, size_t length)
 {
 
@@ -84,7 +101,7 @@ static bool fromFullStorageAllKeys(const char *key, void *buffer, size_t length)
   return true;
 }
 
-static void fillKveMemory(void)
+static int fillMemory(kveMemory_t *memory)
 {
   int i;
   char keyString[30];
@@ -92,12 +109,18 @@ static void fillKveMemory(void)
   for (i = 0; i < (KVE_PARTITION_LENGTH / 10); i++)
   {
     sprintf(keyString, "prm/test.value%i", i);
-    if (!kveStore(&kve, keyString, &i, sizeof(i)))
+    if (!kveStore(memory, keyString, &i, sizeof(i)))
     {
       break;
     }
   }
   //printf("Nr stored:%i\n", i);
+  return i;
+}
+
+static void fillKveMemory(void)
+{
+  fillMemory(&kve);
 }
 
 //-----------------------------Test cases -------------------------------- //
@@ -106,6 +129,8 @@ void setUp(void) {
   // The full memory is initialized to zero
   memset(kveData, 0, KVE_PARTITION_LENGTH);
   kveFormat(&kve);
+  kveFormat(&kveIndexed);
+  kveIndex.size = KVE_INDEX_SIZE;
 }
 
 void tearDown(void) {
@@ -247,4 +272,209 @@ void testFragmentationStatisticsIncreaseWhenFragmented(void) {
   kveGetStats(&kve, &stats);
   // Assert
   TEST_ASSERT_NOT_EQUAL(0, stats.fragmentation);
-}
\ No newline at end of file
+}
+
+void testIndexedFetchFindsAllStoredItems(void) {
+  // Fixture
+  int stored = fillMemory(&kveIndexed);
+
+  // Test
+  // Assert
+  char keyString[30];
+  for (int i = 0; i < stored; i++) {
+    int value = -1;
+    sprintf(keyString, "prm/test.value%i", i);
+    TEST_ASSERT_EQUAL(sizeof(value), kveFetch(&kveIndexed, keyString, &value, sizeof(value)));
+    TEST_ASSERT_EQUAL(i, value);
+  }
+}
+
+void testIndexedFetchAfterDeleteFails(void) {
+  // Fixture
+  uint32_t u32Store = 0xBEAF;
+  uint32_t u32Read = 0;
+  kveStore(&kveIndexed, "prm/a", &u32Store, sizeof(u32Store));
+  kveStore(&kveIndexed, "prm/b", &u32Store, sizeof(u32Store));
+
+  // Test
+  bool actualDelete = kveDelete(&kveIndexed, "prm/a");
+
+  // Assert
+  TEST_ASSERT_EQUAL(true, actualDelete);
+  TEST_ASSERT_EQUAL(0, kveFetch(&kveIndexed, "prm/a", &u32Read, sizeof(u32Read)));
+  TEST_ASSERT_EQUAL(sizeof(u32Read), kveFetch(&kveIndexed, "prm/b", &u32Read, sizeof(u32Read)));
+}
+
+void testIndexedStoreWithNewSizeReplacesItem(void) {
+  // Fixture
+  uint8_t u8Store = 0x12;
+  uint32_t u32Store = 0xBEAF;
+  uint32_t u32Read = 0;
+  kveStore(&kveIndexed, "prm/a", &u8Store, sizeof(u8Store));
+
+  // Test
+  kveStore(&kveIndexed, "prm/a", &u32Store, sizeof(u32Store));
+
+  // Assert
+  TEST_ASSERT_EQUAL(sizeof(u32Read), kveFetch(&kveIndexed, "prm/a", &u32Read, sizeof(u32Read)));
+  TEST_ASSERT_EQUAL_UINT32(u32Store, u32Read);
+}
+
+void testIndexIsInSyncWithTableWrittenWithoutIndex(void) {
+  // Fixture
+  uint32_t u32Store = 0xBEAF;
+  uint32_t u32Read = 0;
+  kveStore(&kve, "prm/a", &u32Store, sizeof(u32Store));
+
+  // Test
+  size_t actual = kveFetch(&kveIndexed, "prm/a", &u32Read, sizeof(u32Read));
+
+  // Assert
+  TEST_ASSERT_EQUAL(sizeof(u32Read), actual);
+  TEST_ASSERT_EQUAL_UINT32(u32Store, u32Read);
+}
+
+void testIndexedStoreAfterDefragWhenMemoryIsFull(void) {
+  // Fixture
+  uint32_t u32Store = 0xBEAF;
+  uint32_t u32Read = 0;
+  int value = -1;
+  fillMemory(&kveIndexed);
+  kveDelete(&kveIndexed, "prm/test.value10");
+
+  // Test
+  bool actualStore = kveStore(&kveIndexed, "prm/test.hole10", &u32Store, sizeof(u32Store));
+
+  // Assert
+  TEST_ASSERT_EQUAL(true, actualStore);
+  TEST_ASSERT_EQUAL(sizeof(u32Read), kveFetch(&kveIndexed, "prm/test.hole10", &u32Read, sizeof(u32Read)));
+  TEST_ASSERT_EQUAL(sizeof(value), kveFetch(&kveIndexed, "prm/test.value11", &value, sizeof(value)));
+  TEST_ASSERT_EQUAL(11, value);
+}
+
+void testTooSmallIndexFallsBackToTableWalk(void) {
+  // Fixture
+  kveIndex.size = 8;
+  fillMemory(&kveIndexed);
+  int value = -1;
+
+  // Test
+  size_t actual = kveFetch(&kveIndexed, "prm/test.value100", &value, sizeof(value));
+
+  // Assert
+  kveStats_t stats;
+  kveGetStats(&kveIndexed, &stats);
+  TEST_ASSERT_EQUAL(sizeof(value), actual);
+  TEST_ASSERT_EQUAL(100, value);
+  TEST_ASSERT_EQUAL(8 * sizeof(kveIndexSlot_t), stats.indexSize);
+  TEST_ASSERT_EQUAL(0, stats.indexItems);
+}
+
+void testIndexStatistics(void) {
+  // Fixture
+  uint32_t i = 42;
+  kveStore(&kveIndexed, "hello", &i, sizeof(i));
+  kveStore(&kveIndexed, "world", &i, sizeof(i));
+
+  // Test
+  kveStats_t stats;
+  kveGetStats(&kveIndexed, &stats);
+
+  // Assert
+  TEST_ASSERT_EQUAL(KVE_INDEX_SIZE * sizeof(kveIndexSlot_t), stats.indexSize);
+  TEST_ASSERT_EQUAL(2, stats.indexItems);
+}
+
+static void defragInSteps(kveMemory_t *memory)
+{
+  int steps = 0;
+  while (kveDefragStep(memory)) {
+    steps++;
+    TEST_ASSERT_TRUE(steps < KVE_PARTITION_LENGTH);
+  }
+}
+
+void testDefragStepWithoutHolesDoesNothing(void) {
+  // Fixture
+  uint32_t u32Store = 0xBEAF;
+  kveStore(&kve, "prm/a", &u32Store, sizeof(u32Store));
+
+  // Test
+  bool actual = kveDefragStep(&kve);
+
+  // Assert
+  TEST_ASSERT_EQUAL(false, actual);
+}
+
+void testDefragStepsRemoveAllHoles(void) {
+  // Fixture
+  int stored = fillMemory(&kve);
+  char keyString[30];
+  for (int i = 0; i < stored; i += 3) {
+    sprintf(keyString, "prm/test.value%i", i);
+    kveDelete(&kve, keyString);
+  }
+
+  // Test
+  defragInSteps(&kve);
+
+  // Assert
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(0, stats.holeSize);
+  TEST_ASSERT_EQUAL(true, kveCheck(&kve));
+  for (int i = 0; i < stored; i++) {
+    int value = -1;
+    sprintf(keyString, "prm/test.value%i", i);
+    size_t expected = (i % 3) ? sizeof(value) : 0;
+    TEST_ASSERT_EQUAL(expected, kveFetch(&kve, keyString, &value, sizeof(value)));
+    if (expected) {
+      TEST_ASSERT_EQUAL(i, value);
+    }
+  }
+}
+
+void testDefragStepsInterleavedWithDeletesAndStores(void) {
+  // Fixture
+  uint32_t u32Store = 0xBEAF;
+  uint32_t u32Read = 0;
+  kveStore(&kve, "prm/a", &u32Store, sizeof(u32Store));
+  kveStore(&kve, "prm/b", &u32Store, sizeof(u32Store));
+  kveStore(&kve, "prm/c", &u32Store, sizeof(u32Store));
+  kveDelete(&kve, "prm/b");
+  kveDefragStep(&kve);
+
+  // Test
+  kveDelete(&kve, "prm/a");
+  kveStore(&kve, "prm/d", &u32Store, sizeof(u32Store));
+  defragInSteps(&kve);
+
+  // Assert
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(0, stats.holeSize);
+  TEST_ASSERT_EQUAL(2, stats.totalItems);
+  TEST_ASSERT_EQUAL(sizeof(u32Read), kveFetch(&kve, "prm/c", &u32Read, sizeof(u32Read)));
+  TEST_ASSERT_EQUAL(sizeof(u32Read), kveFetch(&kve, "prm/d", &u32Read, sizeof(u32Read)));
+}
+
+void testIndexedFetchAfterDefragSteps(void) {
+  // Fixture
+  int stored = fillMemory(&kveIndexed);
+  char keyString[30];
+  for (int i = 0; i < stored; i += 2) {
+    sprintf(keyString, "prm/test.value%i", i);
+    kveDelete(&kveIndexed, keyString);
+  }
+
+  // Test
+  defragInSteps(&kveIndexed);
+
+  // Assert
+  for (int i = 1; i < stored; i += 2) {
+    int value = -1;
+    sprintf(keyString, "prm/test.value%i", i);
+    TEST_ASSERT_EQUAL(sizeof(value), kveFetch(&kveIndexed, keyString, &value, sizeof(value)));
+    TEST_ASSERT_EQUAL(i, value);
+  }
+}
@@ -0,0 +1,161 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_lighthouse_calibration.c - unit tests for lighthouse angle calibration
+ */
+
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+// File under test lighthouse_calibration.c
+#include "lighthouse_calibration.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "physicalConstants.h"
+
+// Build the arm dsp math lib and use the "real thing" instead of mocking calls to it
+// @BUILD_LIB ARM_DSP_MATH
+
+static lighthouseCalibration_t calib;
+static lighthouseCalibrationTable_t table;
+
+// Same model as used by the LH2 solver, to check how well a solution maps back to the raw angles
+static void idealToDistorted(const float* ideal, float* distorted) {
+  const float t30 = M_PI_F / 6.0f;
+  const float tan30 = tanf(t30);
+
+  const float x = 1.0f;
+  const float y = tanf((ideal[1] + ideal[0]) / 2.0f);
+  const float z = sinf(ideal[1] - ideal[0]) / (tan30 * (cosf(ideal[1]) + cosf(ideal[0])));
+
+  distorted[0] = lighthouseCalibrationMeasurementModelLh2(x, y, z, -t30, &calib.sweep[0]);
+  distorted[1] = lighthouseCalibrationMeasurementModelLh2(x, y, z, t30, &calib.sweep[1]);
+}
+
+static float residual(const float* rawAngles, const float* correctedAngles) {
+  float distorted[2];
+  idealToDistorted(correctedAngles, distorted);
+  return fmaxf(fabsf(distorted[0] - rawAngles[0]), fabsf(distorted[1] - rawAngles[1]));
+}
+
+void setUp(void) {
+  memset(&calib, 0, sizeof(calib));
+  memset(&table, 0, sizeof(table));
+
+  // Typical values from a LH2 base station
+  calib.sweep[0].phase = 0.0f;
+  calib.sweep[0].tilt = -0.047353f;
+  calib.sweep[0].gibmag = 0.005661f;
+  calib.sweep[0].gibphase = 2.087891f;
+  calib.sweep[1].phase = -0.005354f;
+  calib.sweep[1].tilt = 0.044617f;
+  calib.sweep[1].gibmag = 0.002315f;
+  calib.sweep[1].gibphase = 0.585449f;
+  calib.uid = 0x12345678;
+  calib.valid = true;
+}
+
+void testThatTableIsNotValidForInvalidCalibrationData() {
+  // Fixture
+  calib.valid = false;
+  table.valid = true;
+
+  // Test
+  lighthouseCalibrationInitTableV2(&table, &calib);
+
+  // Assert
+  TEST_ASSERT_FALSE(table.valid);
+}
+
+void testThatTableIsValidForValidCalibrationData() {
+  // Fixture
+
+  // Test
+  lighthouseCalibrationInitTableV2(&table, &calib);
+
+  // Assert
+  TEST_ASSERT_TRUE(table.valid);
+}
+
+void testThatTableResultIsAsAccurateAsIterativeSolverInsideTheTable() {
+  // Fixture
+  lighthouseCalibrationInitTableV2(&table, &calib);
+
+  float worstTableResidual = 0.0f;
+  float worstIterativeResidual = 0.0f;
+  float worstDifference = 0.0f;
+  for (int i = 0; i < 64; i++) {
+    for (int j = 0; j < 64; j++) {
+      const float rawAngles[2] = {-1.19f + i * 0.0377f, -1.19f + j * 0.0377f};
+      float iterative[2];
+      float actual[2];
+      lighthouseCalibrationApplyV2(&calib, rawAngles, iterative);
+
+      // Test
+      lighthouseCalibrationApplyV2Table(&calib, &table, rawAngles, actual);
+
+      const float iterativeResidual = residual(rawAngles, iterative);
+      worstTableResidual = fmaxf(worstTableResidual, residual(rawAngles, actual));
+      worstIterativeResidual = fmaxf(worstIterativeResidual, iterativeResidual);
+      if (iterativeResidual < 0.0001f) {
+        worstDifference = fmaxf(worstDifference, fmaxf(fabsf(iterative[0] - actual[0]), fabsf(iterative[1] - actual[1])));
+      }
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(worstTableResidual <= worstIterativeResidual);
+  // Within the convergence limit of the iterative solver
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 0.0f, worstDifference);
+}
+
+void testThatIterativeSolverIsUsedOutsideTheTable() {
+  // Fixture
+  lighthouseCalibrationInitTableV2(&table, &calib);
+  const float rawAngles[2] = {1.3f, -0.2f};
+  float expected[2];
+  lighthouseCalibrationApplyV2(&calib, rawAngles, expected);
+  float actual[2];
+
+  // Test
+  lighthouseCalibrationApplyV2Table(&calib, &table, rawAngles, actual);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, actual, 2);
+}
+
+void testThatIterativeSolverIsUsedForInvalidTable() {
+  // Fixture
+  table.valid = false;
+  const float rawAngles[2] = {0.3f, -0.2f};
+  float expected[2];
+  lighthouseCalibrationApplyV2(&calib, rawAngles, expected);
+  float actual[2];
+
+  // Test
+  lighthouseCalibrationApplyV2Table(&calib, &table, rawAngles, actual);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, actual, 2);
+}
@@ -98,6 +98,100 @@ void testThatRayIsCalculatedFromNonRotatedBaseStationWithVerticalSweepAngle() {
   TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, actual, vec3d_size);
 }
 
+void testThatPositionIsFoundFromTwoIntersectingRays() {
+  // Fixture
+  vec3d origins[] = {{0.0, 0.0, 0.0}, {2.0, 0.0, 0.0}};
+  vec3d rays[] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}};
+  vec3d actual;
+  float actualResidual;
+
+  vec3d expected = {2.0, 0.0, 0.0};
+
+  // Test
+  bool actualResult = lighthouseGeometryGetPositionFromRays(origins, rays, 2, actual, &actualResidual);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualResult);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[0], actual[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[1], actual[1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[2], actual[2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, 0.0, actualResidual);
+}
+
+void testThatPositionIsFoundInTheMiddleOfTwoSkewRays() {
+  // Fixture
+  vec3d origins[] = {{0.0, 0.0, 0.0}, {1.0, -1.0, 0.2}};
+  vec3d rays[] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}};
+  vec3d actual;
+  float actualResidual;
+
+  vec3d expected = {1.0, 0.0, 0.1};
+
+  // Test
+  bool actualResult = lighthouseGeometryGetPositionFromRays(origins, rays, 2, actual, &actualResidual);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualResult);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[0], actual[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[1], actual[1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, expected[2], actual[2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, 0.1, actualResidual);
+}
+
+void testThatPositionIsFoundFromFourRays() {
+  // Fixture
+  vec3d target = {1.0, 2.0, 0.5};
+  vec3d origins[] = {{-2.0, -2.0, 2.5}, {3.0, -2.0, 2.5}, {3.0, 4.0, 2.5}, {-2.0, 4.0, 2.5}};
+  vec3d rays[4];
+  for (int i = 0; i < 4; i++) {
+    vec3d d = {target[0] - origins[i][0], target[1] - origins[i][1], target[2] - origins[i][2]};
+    float len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    rays[i][0] = d[0] / len;
+    rays[i][1] = d[1] / len;
+    rays[i][2] = d[2] / len;
+  }
+  vec3d actual;
+  float actualResidual;
+
+  // Test
+  bool actualResult = lighthouseGeometryGetPositionFromRays(origins, rays, 4, actual, &actualResidual);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualResult);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, target[0], actual[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, target[1], actual[1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, target[2], actual[2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, 0.0, actualResidual);
+}
+
+void testThatNoPositionIsFoundFromParallelRays() {
+  // Fixture
+  vec3d origins[] = {{0.0, 0.0, 0.0}, {0.0, 1.0, 0.0}};
+  vec3d rays[] = {{1.0, 0.0, 0.0}, {1.0, 0.0, 0.0}};
+  vec3d actual;
+  float actualResidual;
+
+  // Test
+  bool actualResult = lighthouseGeometryGetPositionFromRays(origins, rays, 2, actual, &actualResidual);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualResult);
+}
+
+void testThatNoPositionIsFoundFromOneRay() {
+  // Fixture
+  vec3d origins[] = {{0.0, 0.0, 0.0}};
+  vec3d rays[] = {{1.0, 0.0, 0.0}};
+  vec3d actual;
+  float actualResidual;
+
+  // Test
+  bool actualResult = lighthouseGeometryGetPositionFromRays(origins, rays, 1, actual, &actualResidual);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualResult);
+}
+
 void testThatIntersectionPointIsFoundForLinePerpendicularToPlane() {
   // Fixture
   vec3d linePoint = {1, 1, 2};
@@ -3,13 +3,19 @@
 // File under test pulse_processor.c
 #include "pulse_processor.h"
 
+#include <string.h>
+
 #include "unity.h"
 
 #include "mock_lighthouse_calibration.h"
 #include "mock_pulse_processor_v1.h"
 #include "mock_pulse_processor_v2.h"
+#include "mock_usec_time.h"
+
+static pulseProcessor_t state;
 
 void setUp(void) {
+  memset(&state, 0, sizeof(state));
 }
 
 void testThatResultStructIsCleared() {
@@ -82,3 +88,118 @@ void testThatTsAbsDiffGreaterThan() {
   TEST_ASSERT_FALSE(TS_ABS_DIFF_LARGER_THAN(PULSE_PROCESSOR_TIMESTAMP_MAX + 1 - 10, 30, 100));
   TEST_ASSERT_TRUE(TS_ABS_DIFF_LARGER_THAN(PULSE_PROCESSOR_TIMESTAMP_MAX + 1 - 10, 30, 1));
 }
+
+void testThatBsSlotIsAssignedToBaseStation() {
+  // Fixture
+  usecTimestamp_IgnoreAndReturn(1000);
+  lighthouseCalibrationInitTableV2_Ignore();
+
+  // Test
+  pulseProcessorBsSlot_t* actual = pulseProcessorGetBsSlot(&state, 3);
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_TRUE(actual->inUse);
+  TEST_ASSERT_EQUAL_UINT8(3, actual->baseStation);
+  TEST_ASSERT_EQUAL_PTR(actual, pulseProcessorFindBsSlot(&state, 3));
+}
+
+void testThatCalibrationTableIsBuiltWhenBsSlotIsAssigned() {
+  // Fixture
+  usecTimestamp_IgnoreAndReturn(1000);
+  pulseProcessorBsSlot_t* expectedSlot = &state.bsSlots[0];
+  lighthouseCalibrationInitTableV2_Expect(&expectedSlot->calibTable, &state.bsCalibration[1]);
+
+  // Test
+  pulseProcessorGetBsSlot(&state, 1);
+
+  // Assert
+  // Verified in mock
+}
+
+void testThatTheSameBsSlotIsReturnedForABaseStation() {
+  // Fixture
+  usecTimestamp_IgnoreAndReturn(1000);
+  lighthouseCalibrationInitTableV2_Ignore();
+  pulseProcessorBsSlot_t* expected = pulseProcessorGetBsSlot(&state, 1);
+  pulseProcessorGetBsSlot(&state, 0);
+
+  // Test
+  pulseProcessorBsSlot_t* actual = pulseProcessorGetBsSlot(&state, 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_PTR(expected, actual);
+}
+
+void testThatBsSlotIsNotFoundForBaseStationWithoutSlot() {
+  // Fixture
+  // Test
+  pulseProcessorBsSlot_t* actual = pulseProcessorFindBsSlot(&state, 1);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+}
+
+void testThatLeastRecentlyUsedBsSlotIsReassigned() {
+  // Fixture
+  lighthouseCalibrationInitTableV2_Ignore();
+  uint64_t now = 1000;
+  for (int bs = 0; bs < PULSE_PROCESSOR_N_BS_SLOTS; bs++) {
+    usecTimestamp_IgnoreAndReturn(now);
+    pulseProcessorGetBsSlot(&state, bs);
+    now += 10;
+  }
+
+  // Refresh base station 0, base station 1 is now the least recently used
+  usecTimestamp_IgnoreAndReturn(now);
+  pulseProcessorGetBsSlot(&state, 0);
+
+  const int newBaseStation = PULSE_PROCESSOR_N_BS_SLOTS;
+  usecTimestamp_IgnoreAndReturn(now + PULSE_PROCESSOR_BS_SLOT_MIN_IDLE_US);
+
+  // Test
+  pulseProcessorBsSlot_t* actual = pulseProcessorGetBsSlot(&state, newBaseStation);
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT8(newBaseStation, actual->baseStation);
+  if (PULSE_PROCESSOR_N_BS_SLOTS > 1) {
+    TEST_ASSERT_NOT_NULL(pulseProcessorFindBsSlot(&state, 0));
+    TEST_ASSERT_NULL(pulseProcessorFindBsSlot(&state, 1));
+  }
+}
+
+void testThatBsSlotIsNotReassignedWhenAllSlotsAreRecentlyUsed() {
+  // Fixture
+  usecTimestamp_IgnoreAndReturn(1000);
+  lighthouseCalibrationInitTableV2_Ignore();
+  for (int bs = 0; bs < PULSE_PROCESSOR_N_BS_SLOTS; bs++) {
+    pulseProcessorGetBsSlot(&state, bs);
+  }
+
+  const int newBaseStation = PULSE_PROCESSOR_N_BS_SLOTS;
+
+  // Test
+  pulseProcessorBsSlot_t* actual = pulseProcessorGetBsSlot(&state, newBaseStation);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+  for (int bs = 0; bs < PULSE_PROCESSOR_N_BS_SLOTS; bs++) {
+    TEST_ASSERT_NOT_NULL(pulseProcessorFindBsSlot(&state, bs));
+  }
+}
+
+void testThatCalibrationTableIsRebuiltForBaseStationWithSlot() {
+  // Fixture
+  usecTimestamp_IgnoreAndReturn(1000);
+  pulseProcessorBsSlot_t* slot = &state.bsSlots[0];
+  lighthouseCalibrationInitTableV2_Expect(&slot->calibTable, &state.bsCalibration[2]);
+  pulseProcessorGetBsSlot(&state, 2);
+  lighthouseCalibrationInitTableV2_Expect(&slot->calibTable, &state.bsCalibration[2]);
+
+  // Test
+  pulseProcessorCalibrationDataUpdated(&state, 2);
+
+  // Assert
+  // Verified in mock
+}
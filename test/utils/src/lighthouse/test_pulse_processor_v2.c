@@ -39,6 +39,7 @@ static pulseProcessorV2SweepBlock_t block;
 static pulseProcessorV2BlockWorkspace_t blockWorkspace;
 
 static pulseProcessorFrame_t slowbitFrame;
+static pulseProcessorBsSlot_t bsSlot;
 static int nrOfCallsToOotxDecoderProcessBit;
 
 const uint32_t NO_OFFSET = 0;
@@ -67,6 +68,8 @@ void setUp(void) {
     setUpSlowbitFrame();
     clearSlowbitState();
     nrOfCallsToOotxDecoderProcessBit = -1;
+
+    pulseProcessorGetBsSlot_IgnoreAndReturn(&bsSlot);
 }
 
 void testThatWorkspaceIsCleared() {
@@ -418,7 +421,7 @@ void testThatProcessBlockPairRejectsBlocksWhenTooLongApart() {
 
 void testThatSlowBitIsProcessed() {
     // Fixture
-    ootxDecoderProcessBit_ExpectAndReturn(&state.ootxDecoder[SB_CHANNEL], SB_BIT, false);
+    ootxDecoderProcessBit_ExpectAndReturn(&bsSlot.ootxDecoder, SB_BIT, false);
 
     // Test
     handleCalibrationData(&state, &slowbitFrame);
@@ -427,6 +430,19 @@ void testThatSlowBitIsProcessed() {
     // Validated in mock
 }
 
+void testThatSlowBitIsNotProcessedIfThereIsNoSlot() {
+    // Fixture
+    pulseProcessorGetBsSlot_IgnoreAndReturn(0);
+
+    setUpOotxDecoderProcessBitCallCounter();
+
+    // Test
+    handleCalibrationData(&state, &slowbitFrame);
+
+    // Assert
+    TEST_ASSERT_EQUAL(0, nrOfCallsToOotxDecoderProcessBit);
+}
+
 void testThatSlowBitIsNotProcessedIfChannelIsMissing() {
     // Fixture
     slowbitFrame.channelFound = false;
@@ -38,12 +38,12 @@
 #define ANCHOR_POSITION_VALIDITY_PERIOD (2 * 1000)
 
 
-static tdaoAnchorInfoArray_t storage;
+static tdoaAnchorStorage_t storage;
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr);
 static void fixtureSetTof(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t tof);
 
 void setUp(void) {
-  tdoaStorageInitialize(storage);
+  tdoaStorageInitialize(&storage);
 }
 
 void testThatCurrentTimeIsSetInContextForGet() {
@@ -53,7 +53,7 @@ void testThatCurrentTimeIsSetInContextForGet() {
 
   // Test
   tdoaAnchorContext_t result;
-  tdoaStorageGetAnchorCtx(storage, anchor, expectedTime, &result);
+  tdoaStorageGetAnchorCtx(&storage, anchor, expectedTime, &result);
 
   // Assert
   TEST_ASSERT_EQUAL_UINT8(expectedTime, result.currentTime_ms);
@@ -67,7 +67,7 @@ void testThatCurrentTimeIsSetInContextForGetCreate() {
 
   // Test
   tdoaAnchorContext_t result;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, expectedTime, &result);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, expectedTime, &result);
 
   // Assert
   TEST_ASSERT_EQUAL_UINT8(expectedTime, result.currentTime_ms);
@@ -81,7 +81,7 @@ void testThatNoAnchorIsReturnedWhenItDoesNotExistInStorage() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did not exist
@@ -97,7 +97,7 @@ void testThatANewAnchorContextIsReturnedWhenItDoesNotExistInStorage() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did not exist
@@ -113,11 +113,11 @@ void testThatTheSameAnchorContextIsReturnedWhenItAlreadyExistsInStorageForGet()
 
   // Make sure the anchor exists
   tdoaAnchorContext_t firstContext;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &firstContext);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &firstContext);
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did exist
@@ -133,11 +133,11 @@ void testThatTheSameAnchorContextIsReturnedWhenItAlreadyExistsInStorageForGetCre
 
   // Make sure the anchor exists
   tdoaAnchorContext_t firstContext;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &firstContext);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &firstContext);
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did exist
@@ -160,7 +160,7 @@ void testThatTheOldestAnchorContextIsReplacedWhenStorageIsFull() {
   // time for one slot to be oldest
   tdoaAnchorContext_t context;
   for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
-    tdoaStorageGetCreateAnchorCtx(storage, id, currentTime, &context);
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
 
     uint32_t updateTime = baseAnchorTime + id;
     if (id == oldestAnchor) {
@@ -173,12 +173,184 @@ void testThatTheOldestAnchorContextIsReplacedWhenStorageIsFull() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, newAnchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, newAnchor, currentTime, &result);
 
   // Assert
   TEST_ASSERT_FALSE(actual);
-  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(storage, newAnchor));
-  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(storage, oldestAnchor));
+  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, newAnchor));
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(&storage, oldestAnchor));
+}
+
+
+void testThatAnEvictedAnchorIsNoLongerFoundAndTheNewOneIs() {
+  // Fixture
+  const uint32_t currentTime = 2000;
+  tdoaAnchorContext_t context;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
+    context.currentTime_ms = 1000 + id;
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  uint8_t newAnchor = 200;
+  tdoaStorageGetCreateAnchorCtx(&storage, newAnchor, currentTime, &context);
+  tdoaAnchorInfo_t* expected = context.anchorInfo;
+
+  // Test
+  tdoaAnchorContext_t result;
+  bool actualOld = tdoaStorageGetAnchorCtx(&storage, 0, currentTime, &result);
+  bool actualNew = tdoaStorageGetAnchorCtx(&storage, newAnchor, currentTime, &result);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualOld);
+  TEST_ASSERT_TRUE(actualNew);
+  TEST_ASSERT_EQUAL_PTR(expected, result.anchorInfo);
+  TEST_ASSERT_EQUAL_UINT8(newAnchor, tdoaStorageGetId(&result));
+}
+
+
+void testThatAnOldAnchorThatIsNotActiveIsReplacedFirst() {
+  // Fixture
+  const uint32_t currentTime = 5000;
+  const uint8_t inactiveAnchor = 0;
+
+  tdoaAnchorContext_t context;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
+    tdoaStorageSetAnchorPosition(&context, 1.0f, 2.0f, 3.0f);
+
+    context.currentTime_ms = (id == inactiveAnchor) ? 1000 : 4000 + id;
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  // Test
+  tdoaStorageGetCreateAnchorCtx(&storage, 200, currentTime, &context);
+
+  // Assert
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(&storage, inactiveAnchor));
+}
+
+
+void testThatAnActiveAnchorWithoutPositionIsReplacedBeforeOlderAnchorsWithPosition() {
+  // Fixture
+  const uint32_t currentTime = 5000;
+  const uint8_t anchorWithoutPosition = 7;
+
+  tdoaAnchorContext_t context;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
+    if (id != anchorWithoutPosition) {
+      tdoaStorageSetAnchorPosition(&context, 1.0f, 2.0f, 3.0f);
+    }
+
+    context.currentTime_ms = 4000 + id;
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  // Test
+  tdoaStorageGetCreateAnchorCtx(&storage, 200, currentTime, &context);
+
+  // Assert
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(&storage, anchorWithoutPosition));
+  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, 0));
+}
+
+
+void testThatRemoteDataIsReleasedWhenAnAnchorIsReplaced() {
+  // Fixture
+  const uint32_t currentTime = 5000;
+
+  tdoaAnchorContext_t context;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    fixtureSetRemoteRxTime(&context, id, currentTime, 100, 1234, 1);
+    fixtureSetTof(&context, id, currentTime, 100, 4321);
+  }
+  TEST_ASSERT_EQUAL_UINT16(2 * ANCHOR_STORAGE_COUNT, storage.remoteEntriesInUse);
+
+  // Test
+  tdoaStorageGetCreateAnchorCtx(&storage, 200, currentTime, &context);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(2 * (ANCHOR_STORAGE_COUNT - 1), storage.remoteEntriesInUse);
+  TEST_ASSERT_EQUAL_INT64(0, tdoaStorageGetRemoteRxTime(&context, 100));
+  TEST_ASSERT_EQUAL_INT64(0, tdoaStorageGetRemoteTimeOfFlight(&context, 100));
+}
+
+
+void testThatTheOldestRemoteDataInAllAnchorsIsReusedWhenThePoolIsExhausted() {
+  // Fixture
+  const uint32_t oldestStorageTime = 1000;
+  const uint32_t storageTime = 1001;
+  const uint8_t oldestOwner = 3;
+  const uint8_t oldestRemoteAnchor = 4;
+
+  // Fill the pool with tofs from all anchors
+  tdoaAnchorContext_t context;
+  int entries = 0;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT && entries < TDOA_STORAGE_REMOTE_ENTRY_COUNT; id++) {
+    for (int remoteAnchor = 0; remoteAnchor < TOF_PER_ANCHOR_COUNT && entries < TDOA_STORAGE_REMOTE_ENTRY_COUNT; remoteAnchor++) {
+      const bool isOldest = (id == oldestOwner && remoteAnchor == oldestRemoteAnchor);
+      fixtureSetTof(&context, id, isOldest ? oldestStorageTime : storageTime, remoteAnchor, 1234);
+      entries++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT16(TDOA_STORAGE_REMOTE_ENTRY_COUNT, storage.remoteEntriesInUse);
+
+  // Test
+  const uint8_t anchor = 5;
+  const uint8_t newRemoteAnchor = 200;
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, newRemoteAnchor, 4711, 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(4711, tdoaStorageGetRemoteRxTime(&context, newRemoteAnchor));
+  TEST_ASSERT_EQUAL_UINT16(TDOA_STORAGE_REMOTE_ENTRY_COUNT, storage.remoteEntriesInUse);
+
+  tdoaStorageGetAnchorCtx(&storage, oldestOwner, storageTime, &context);
+  TEST_ASSERT_EQUAL_INT64(0, tdoaStorageGetRemoteTimeOfFlight(&context, oldestRemoteAnchor));
+  TEST_ASSERT_EQUAL_INT64(1234, tdoaStorageGetRemoteTimeOfFlight(&context, oldestRemoteAnchor + 1));
+}
+
+
+void testThatAnchorsAreIteratedYoungestFirst() {
+  // Fixture
+  const uint32_t currentTime = 2000;
+  const uint8_t ids[] = {7, 3, 9};
+  const uint32_t updateTimes[] = {1000, 1200, 1100};
+
+  tdoaAnchorContext_t context;
+  for (int i = 0; i < 3; i++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, ids[i], currentTime, &context);
+    context.currentTime_ms = updateTimes[i];
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  // Test
+  uint8_t actual[3];
+  int count = 0;
+  for (bool found = tdoaStorageGetYoungestAnchorCtx(&storage, currentTime, &context); found; found = tdoaStorageGetNextOlderAnchorCtx(&context)) {
+    TEST_ASSERT_TRUE(count < 3);
+    actual[count] = tdoaStorageGetId(&context);
+    count++;
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, count);
+  TEST_ASSERT_EQUAL_UINT8(3, actual[0]);
+  TEST_ASSERT_EQUAL_UINT8(9, actual[1]);
+  TEST_ASSERT_EQUAL_UINT8(7, actual[2]);
+}
+
+
+void testThatIterationOfAnEmptyStorageFindsNothing() {
+  // Fixture
+  tdoaAnchorContext_t context;
+
+  // Test
+  bool actual = tdoaStorageGetYoungestAnchorCtx(&storage, 1234, &context);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_NULL(context.anchorInfo);
 }
 
 
@@ -193,14 +365,14 @@ void testThatAListOfAnchorIdsIsReturned() {
 
   uint8_t expectedCount = 3;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId2, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId2, currentTime, &context);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(storage, unorderedAnchorList, 10);
+  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(&storage, unorderedAnchorList, 10);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -220,14 +392,14 @@ void testThatAListOfAnchorIdsIsReturnedButNotMoreThanTheListLength() {
 
   uint8_t expectedCount = 2;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId2, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId2, currentTime, &context);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(storage, unorderedAnchorList, expectedCount);
+  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(&storage, unorderedAnchorList, expectedCount);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -251,19 +423,19 @@ void testThatAListOfActiveAnchorIdsIsReturned() {
 
   uint8_t expectedCount = 2;
 
-  tdoaStorageGetCreateAnchorCtx(storage, otherId, oldTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, otherId, oldTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, recentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, recentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, recentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, recentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(storage, unorderedAnchorList, 10, currentTime);
+  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(&storage, unorderedAnchorList, 10, currentTime);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -283,16 +455,16 @@ void testThatAListOfActiveAnchorIdsIsReturnedButNotMoreThanTheListLength() {
 
   uint8_t expectedCount = 1;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, otherId, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, otherId, currentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(storage, unorderedAnchorList, expectedCount, currentTime);
+  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(&storage, unorderedAnchorList, expectedCount, currentTime);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -308,12 +480,12 @@ void testThatAnchorPositionIsSetAndGet() {
   uint32_t expectedTime = 1234;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, expectedTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, expectedTime, &context);
 
   tdoaStorageSetAnchorPosition(&context, expectedX, expectedY, expectedZ);
 
   uint32_t now = 2345;
-  tdoaStorageGetAnchorCtx(storage, 0, now, &context);
+  tdoaStorageGetAnchorCtx(&storage, 0, now, &context);
   point_t actual;
 
   // Test
@@ -336,7 +508,7 @@ void testThatAnchorPositionIsNotReturnedWhenTooOld() {
   uint32_t now = 1234;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, now, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, now, &context);
 
   tdoaStorageSetAnchorPosition(&context, x, y, z);
 
@@ -359,7 +531,7 @@ void testThatRxTxDataIsSet() {
   uint8_t expectedSeqNr = 17;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, expectedUpdateTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, expectedUpdateTime, &context);
 
   // Test
   tdoaStorageSetRxTxData(&context, expectedRxTime, expectedTxTime, expectedSeqNr);
@@ -375,7 +547,7 @@ void testThatRxTxDataIsSet() {
 void testThatClockCorrectionIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   double expected = 123.456;
   clockCorrectionStorage_t* clockCorrectionStorage = tdoaStorageGetClockCorrectionStorage(&context);
@@ -392,7 +564,7 @@ void testThatClockCorrectionIsReturned() {
 void testThatRemoteRxTimeIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t seqNr = 13;
   const uint8_t remoteAnchor = 17;
@@ -419,7 +591,7 @@ void testThatRemoteRxTimeIsNotReturnedWhenOutdated() {
   const uint8_t remoteAnchor = 17;
   fixtureSetRemoteRxTime(&context, anchor, storageTime, remoteAnchor, 4711, seqNr);
 
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, expiryTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, expiryTime, &context);
   const int64_t expectedRemoteRxTime = 0;
 
   // Test
@@ -433,7 +605,7 @@ void testThatRemoteRxTimeIsNotReturnedWhenOutdated() {
 void testThatRemoteRxTimeIsNotReturnedForUnknownRemoteAnchor() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
   const uint8_t unkownRemoteAnchor = 17;
   const int64_t expectedRemoteRxTime = 0;
 
@@ -448,7 +620,7 @@ void testThatRemoteRxTimeIsNotReturnedForUnknownRemoteAnchor() {
 void testThatRemoteRxTimeIsOverwrittenWhenSetWithTheSameRemoteId() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t seqNr = 13;
   const uint8_t remoteAnchor = 17;
@@ -510,7 +682,7 @@ void testThatRemoteRxTimeReplacesTheOldestEntryWhenStorageIsFull() {
 void testThatRemoteRxTimeAndSequenceNumberIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t remoteAnchor = 17;
   const uint8_t expectedRemoteSeqNr = 13;
@@ -531,7 +703,7 @@ void testThatRemoteRxTimeAndSequenceNumberIsReturned() {
 void testThatRemoteRxTimeAndSequenceNumberIsNotReturnedWhenNotInList() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t remoteAnchor = 17;
 
@@ -568,7 +740,7 @@ void testThatAListOfSequenceNumbersAndIdsOfRemoteAnchorsIsReturned() {
   fixtureSetRemoteRxTime(&context, anchor, activeStorageTime, activeRemoteAnchor1, someRemoteRxTime, activeSeqNr1);
 
   const uint32_t currentTime = oldStorageTime + REMOTE_DATA_VALIDITY_PERIOD;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &context);
 
   int actualRemoteCount;
   uint8_t actualSequenceNumbers[REMOTE_ANCHOR_DATA_COUNT];
@@ -596,7 +768,7 @@ void testThatNoTimeOfFlightIsReturnedWhenRemoteAnchorIsNotInStorage() {
   const uint8_t remoteAnchor = 17;
   const uint64_t expected = 0;
 
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, &context);
 
   // Test
   int64_t actual = tdoaStorageGetRemoteTimeOfFlight(&context, remoteAnchor);
@@ -690,7 +862,7 @@ void testThatTimeOfFlightIsSet() {
   int64_t expectedToF = 4747474747;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   // Test
   tdoaStorageSetTimeOfFlight(&context, expectedToF, storageTime_ms);
@@ -703,14 +875,112 @@ void testThatTimeOfFlightIsSet() {
 }
 
 
+void testThatPacketsAreCountedInTheLinkStats() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  tdoaStorageGetCreateAnchorCtx(&storage, 3, 100, &context);
+
+  // Test
+  for (int i = 0; i < 5; i++) {
+    context.currentTime_ms = 100 + i * 10;
+    tdoaStorageSetRxTxData(&context, 1000 * i, 1000 * i, i);
+  }
+
+  // Assert
+  const tdoaAnchorLinkStats_t* actual = tdoaStorageGetLinkStats(&context);
+  TEST_ASSERT_EQUAL_UINT32(5, actual->packetCount);
+  TEST_ASSERT_EQUAL_UINT32(0, actual->lostPacketCount);
+}
+
+void testThatGapsInSequenceNumbersAreCountedAsLostPackets() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  tdoaStorageGetCreateAnchorCtx(&storage, 3, 100, &context);
+  tdoaStorageSetRxTxData(&context, 1000, 1000, 126);
+
+  // Test
+  context.currentTime_ms = 110;
+  tdoaStorageSetRxTxData(&context, 2000, 2000, 1);
+
+  // Assert
+  const tdoaAnchorLinkStats_t* actual = tdoaStorageGetLinkStats(&context);
+  TEST_ASSERT_EQUAL_UINT32(2, actual->lostPacketCount);
+}
+
+void testThatGapsAreNotCountedAfterALongSilence() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  tdoaStorageGetCreateAnchorCtx(&storage, 3, 100, &context);
+  tdoaStorageSetRxTxData(&context, 1000, 1000, 10);
+
+  // Test
+  context.currentTime_ms = 5000;
+  tdoaStorageSetRxTxData(&context, 2000, 2000, 20);
+
+  // Assert
+  const tdoaAnchorLinkStats_t* actual = tdoaStorageGetLinkStats(&context);
+  TEST_ASSERT_EQUAL_UINT32(0, actual->lostPacketCount);
+}
+
+void testThatThePacketRateIsCalculated() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  tdoaStorageGetCreateAnchorCtx(&storage, 3, 1000, &context);
+
+  // Test
+  for (int i = 0; i <= 50; i++) {
+    context.currentTime_ms = 1000 + i * 20;
+    tdoaStorageSetRxTxData(&context, 1000 * i, 1000 * i, i);
+  }
+
+  // Assert
+  const tdoaAnchorLinkStats_t* actual = tdoaStorageGetLinkStats(&context);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 50.0f, actual->packetRate);
+}
+
+void testThatLinkStatsAreResetWhenASlotIsReused() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, i, 100, &context);
+    tdoaStorageSetRxTxData(&context, 1000, 1000, 0);
+  }
+
+  // Test
+  tdoaStorageGetCreateAnchorCtx(&storage, 200, 10000, &context);
+
+  // Assert
+  const tdoaAnchorLinkStats_t* actual = tdoaStorageGetLinkStats(&context);
+  TEST_ASSERT_EQUAL_UINT32(0, actual->packetCount);
+}
+
+void testThatOnlyValidRemoteDataIsCounted() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  fixtureSetRemoteRxTime(&context, 1, 100, 2, 1234, 5);
+  fixtureSetRemoteRxTime(&context, 1, 200, 3, 1234, 5);
+  fixtureSetTof(&context, 1, 100, 2, 17);
+  fixtureSetTof(&context, 1, 200, 3, 17);
+  context.currentTime_ms = 200 + REMOTE_DATA_VALIDITY_PERIOD - 1;
+
+  // Test
+  uint8_t actualRxCount = 0;
+  uint8_t actualTofCount = 0;
+  tdoaStorageGetValidRemoteCounts(&context, &actualRxCount, &actualTofCount);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actualRxCount);
+  TEST_ASSERT_EQUAL_UINT8(2, actualTofCount);
+}
+
 // Helpers ///////////////
 
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr) {
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, context);
   tdoaStorageSetRemoteRxTime(context, remoteAnchor, remoteRxTime, seqNr);
 }
 
 static void fixtureSetTof(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t tof) {
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, context);
   tdoaStorageSetRemoteTimeOfFlight(context, remoteAnchor, tof);
 }
@@ -0,0 +1,108 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_arena.c - unit tests for the bump allocator
+ */
+
+// File under test arena.c
+#include "arena.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+static uint64_t memory[16];
+static arena_t arena;
+
+void setUp(void) {
+  memset(memory, 0xab, sizeof(memory));
+  arenaInit(&arena, memory, sizeof(memory));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatBlocksAreAlignedAndDoNotOverlap() {
+  // Fixture
+
+  // Test
+  uint8_t* actual1 = arenaAlloc(&arena, 3);
+  uint8_t* actual2 = arenaAlloc(&arena, 9);
+
+  // Assert
+  TEST_ASSERT_EQUAL_PTR(memory, actual1);
+  TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)actual2 % ARENA_ALIGNMENT);
+  TEST_ASSERT_TRUE(actual2 >= actual1 + 3);
+}
+
+void testThatBlocksAreZeroInitialized() {
+  // Fixture
+
+  // Test
+  uint8_t* actual = arenaAlloc(&arena, 12);
+
+  // Assert
+  for (int i = 0; i < 12; i++) {
+    TEST_ASSERT_EQUAL_UINT8(0, actual[i]);
+  }
+}
+
+void testThatAllocationFailsWhenTheArenaIsExhausted() {
+  // Fixture
+  void* first = arenaAlloc(&arena, sizeof(memory) - ARENA_ALIGNMENT);
+
+  // Test
+  void* actualTooLarge = arenaAlloc(&arena, ARENA_ALIGNMENT + 1);
+  void* actualLast = arenaAlloc(&arena, ARENA_ALIGNMENT);
+
+  // Assert
+  TEST_ASSERT_NOT_NULL(first);
+  TEST_ASSERT_NULL(actualTooLarge);
+  TEST_ASSERT_NOT_NULL(actualLast);
+  TEST_ASSERT_EQUAL_UINT32(0, arenaGetFree(&arena));
+}
+
+void testThatAZeroSizedAllocationFails() {
+  // Fixture
+
+  // Test
+  void* actual = arenaAlloc(&arena, 0);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(memory), arenaGetFree(&arena));
+}
+
+void testThatAMisalignedRegionIsAlignedAtInit() {
+  // Fixture
+  uint8_t* start = (uint8_t*)memory + 3;
+  arenaInit(&arena, start, 32);
+
+  // Test
+  uint8_t* actual = arenaAlloc(&arena, 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_PTR((uint8_t*)memory + ARENA_ALIGNMENT, actual);
+  TEST_ASSERT_EQUAL_UINT32(32 - (ARENA_ALIGNMENT - 3) - ARENA_ALIGNMENT, arenaGetFree(&arena));
+}
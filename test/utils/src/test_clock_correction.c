@@ -1,6 +1,7 @@
 // FIle under test
 #include "clockCorrectionEngine.h"
 
+#include <string.h>
 #include "unity.h"
 
 #define MAX_CLOCK_DEVIATION_SPEC 10e-6
@@ -10,7 +11,21 @@
 #define CLOCK_CORRECTION_FILTER 0.1
 #define CLOCK_CORRECTION_BUCKET_MAX 4
 
+#define LS_MASK 0xFFFFFFFF
+#define LS_TICKS_BETWEEN_PACKETS 320000000
+
+static clockCorrectionStorage_t lsStorage;
+static uint64_t lsT_in_cl_reference;
+static uint64_t lsT_in_cl_x;
+static int64_t lsPreviousError;
+
+static bool feedLeastSquares(const double clockCorrection, const int64_t referenceError);
+
 void setUp(void) {
+  memset(&lsStorage, 0, sizeof(lsStorage));
+  lsT_in_cl_reference = 123456789;
+  lsT_in_cl_x = 987654321;
+  lsPreviousError = 0;
 }
 
 void tearDown(void) {
@@ -200,3 +215,129 @@ void testUpdateClockCorrectionWithSampleInTheInnerLimitOfTheAcceptableNoise() {
   TEST_ASSERT_EQUAL_DOUBLE(expectedClockCorrection, clockCorrectionStorage.clockCorrection);
   TEST_ASSERT_EQUAL_UINT(expectedClockCorrectionBucket, clockCorrectionStorage.clockCorrectionBucket);
 }
+
+void testLeastSquaresFirstSampleIsNotReliableButGivesCorrection() {
+  // Fixture
+  const double clockCorrection = 1.000005;
+
+  // Test
+  const bool actual = feedLeastSquares(clockCorrection, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, clockCorrection, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresIsReliableAfterMinSamples() {
+  // Fixture
+  const double clockCorrection = 1.000005;
+  feedLeastSquares(clockCorrection, 0);
+
+  // Test
+  const bool actual = feedLeastSquares(clockCorrection, 0);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, clockCorrection, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresAveragesOutNoisyTimeStamps() {
+  // Fixture
+  const double clockCorrection = 0.999993;
+  const int64_t noise[] = {30, -25, 10, -40, 35, 0, -15, 20, -30, 15};
+  const int noiseCount = sizeof(noise) / sizeof(noise[0]);
+
+  // Test
+  bool actual = false;
+  for (int i = 0; i < 20; i++) {
+    actual = feedLeastSquares(clockCorrection, noise[i % noiseCount]);
+  }
+
+  // Assert
+  // The pairwise ratio of the noisiest pair is off by 75 / LS_TICKS_BETWEEN_PACKETS ~ 0.23e-6
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_DOUBLE_WITHIN(0.03e-6, clockCorrection, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresRejectsOutlierWithoutAffectingTheFit() {
+  // Fixture
+  const double clockCorrection = 1.000002;
+  for (int i = 0; i < 5; i++) {
+    feedLeastSquares(clockCorrection, 0);
+  }
+
+  // Test
+  const bool actualOutlier = feedLeastSquares(clockCorrection, 5000);
+  const bool actualNext = feedLeastSquares(clockCorrection, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualOutlier);
+  TEST_ASSERT_TRUE(actualNext);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, clockCorrection, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresRejectsSampleOutsideSpec() {
+  // Fixture
+  const double clockCorrection = 1.0001;
+
+  // Test
+  const bool actual = feedLeastSquares(clockCorrection, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresRestartsAfterConsecutiveOutliers() {
+  // Fixture
+  const double clockCorrection1 = 1.000002;
+  const double clockCorrection2 = 0.999995;
+  for (int i = 0; i < 5; i++) {
+    feedLeastSquares(clockCorrection1, 0);
+  }
+
+  // Test
+  // The anchor is restarted with a new clock, the samples are outliers until the fit is restarted
+  bool actual = false;
+  for (int i = 0; i < 10; i++) {
+    actual = feedLeastSquares(clockCorrection2, 0);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, clockCorrection2, clockCorrectionEngineGet(&lsStorage));
+}
+
+void testLeastSquaresHandlesWrapAround() {
+  // Fixture
+  const double clockCorrection = 1.000005;
+  lsT_in_cl_reference = LS_MASK - 1000;
+  lsT_in_cl_x = LS_MASK - 2000;
+
+  // Test
+  bool actual = false;
+  for (int i = 0; i < 5; i++) {
+    actual = feedLeastSquares(clockCorrection, 0);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, clockCorrection, clockCorrectionEngineGet(&lsStorage));
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static bool feedLeastSquares(const double clockCorrection, const int64_t referenceError) {
+  const uint64_t old_t_in_cl_x = lsT_in_cl_x;
+  const uint64_t old_t_in_cl_reference = lsT_in_cl_reference;
+
+  lsT_in_cl_x += LS_TICKS_BETWEEN_PACKETS;
+  lsT_in_cl_reference += (uint64_t)(clockCorrection * LS_TICKS_BETWEEN_PACKETS);
+
+  // The error is on the time stamp of this packet only, not accumulated
+  const uint64_t new_t_in_cl_reference = lsT_in_cl_reference + referenceError;
+  const uint64_t old_t_in_cl_reference_measured = old_t_in_cl_reference + lsPreviousError;
+  lsPreviousError = referenceError;
+
+  return clockCorrectionEngineUpdateLeastSquares(&lsStorage, new_t_in_cl_reference & LS_MASK, old_t_in_cl_reference_measured & LS_MASK, lsT_in_cl_x & LS_MASK, old_t_in_cl_x & LS_MASK, LS_MASK);
+}
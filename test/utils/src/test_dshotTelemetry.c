@@ -0,0 +1,245 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * test_dshotTelemetry.c - unit tests for the bidirectional DSHOT telemetry decoder
+ */
+
+// File under test
+#include "dshotTelemetry.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+#define PIN_MASK 0x0400
+#define OTHER_PIN_MASK 0x0800
+#define MAX_SAMPLES 200
+
+static uint16_t samples[MAX_SAMPLES];
+
+static uint32_t encodeFrame(const uint16_t value);
+static int generateSamples(const uint32_t frame, const int idleBefore, const float samplesPerBit);
+
+void setUp(void) {
+  memset(samples, 0, sizeof(samples));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatAValidFrameIsDecoded() {
+  // Fixture
+  const uint16_t expected = 0x0a5c;
+  const uint32_t frame = encodeFrame(expected);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeFrame(frame, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT16(expected, actual);
+}
+
+void testThatAFrameWithABadChecksumIsRejected() {
+  // Fixture
+  const uint32_t frame = encodeFrame(0x0a5c);
+  // Replace the checksum nibble (GCR 0x19 = 0) with another valid code (GCR 0x1b = 1)
+  const uint32_t corrupted = (frame & ~0x1f) | (((frame & 0x1f) == 0x19) ? 0x1b : 0x19);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeFrame(corrupted, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+void testThatAFrameWithAnInvalidGcrCodeIsRejected() {
+  // Fixture
+  const uint32_t frame = (encodeFrame(0x0123) & ~0x1f);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeFrame(frame, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+void testThatTheTelemetryValueIsConvertedToErpm() {
+  // Fixture
+  // Period 300 us = 0x12c, as mantissa 150 and shift 1
+  const uint16_t value = (1 << 9) | 150;
+
+  // Test
+  const uint32_t actual = dshotTelemetryToErpm(value);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(200000, actual);
+}
+
+void testThatAStoppedMotorGivesZeroErpm() {
+  // Fixture
+  // Test
+  const uint32_t actual = dshotTelemetryToErpm(0x0fff);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, actual);
+}
+
+void testThatAFrameIsDecodedFromSamples() {
+  // Fixture
+  const uint16_t expected = 0x0321;
+  const int count = generateSamples(encodeFrame(expected), 10, 3.0f);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, count, 0, PIN_MASK, 3.0f, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT16(expected, actual);
+}
+
+void testThatAFrameIsDecodedFromSamplesWithANonIntegerSampleRate() {
+  // Fixture
+  const uint16_t expected = 0x0fff;
+  const int count = generateSamples(encodeFrame(expected), 7, 3.2f);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, count, 0, PIN_MASK, 3.2f, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT16(expected, actual);
+}
+
+void testThatOtherPinsInTheSamplesAreIgnored() {
+  // Fixture
+  const uint16_t expected = 0x0456;
+  const int count = generateSamples(encodeFrame(expected), 10, 3.0f);
+  for (int i = 0; i < count; i += 2) {
+    samples[i] |= OTHER_PIN_MASK;
+  }
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, count, 0, PIN_MASK, 3.0f, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT16(expected, actual);
+}
+
+void testThatTheSearchStartsAtTheStartIndex() {
+  // Fixture
+  const uint16_t expected = 0x0789;
+  const int count = generateSamples(encodeFrame(expected), 40, 3.0f);
+  // A low pulse before the start index, like the end of the DSHOT frame sent to the ESC
+  for (int i = 5; i < 10; i++) {
+    samples[i] = 0;
+  }
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, count, 20, PIN_MASK, 3.0f, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(isValid);
+  TEST_ASSERT_EQUAL_UINT16(expected, actual);
+}
+
+void testThatATruncatedFrameIsRejected() {
+  // Fixture
+  const int count = generateSamples(encodeFrame(0x0321), 10, 3.0f);
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, count - 45, 0, PIN_MASK, 3.0f, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+void testThatAnIdleLineIsRejected() {
+  // Fixture
+  for (int i = 0; i < MAX_SAMPLES; i++) {
+    samples[i] = PIN_MASK;
+  }
+  uint16_t actual = 0;
+
+  // Test
+  const bool isValid = dshotTelemetryDecodeSamples(samples, MAX_SAMPLES, 0, PIN_MASK, 3.0f, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(isValid);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static uint32_t encodeFrame(const uint16_t value) {
+  static const uint8_t gcrEncode[16] = {
+    0x19, 0x1b, 0x12, 0x13, 0x1d, 0x15, 0x16, 0x17, 0x1a, 0x09, 0x0a, 0x0b, 0x1e, 0x0d, 0x0e, 0x0f,
+  };
+
+  const uint16_t checksum = (~(value ^ (value >> 4) ^ (value >> 8))) & 0x0f;
+  const uint16_t data = (value << 4) | checksum;
+
+  uint32_t frame = 1 << 20;
+  for (int i = 0; i < 4; i++) {
+    frame |= gcrEncode[(data >> (4 * i)) & 0x0f] << (5 * i);
+  }
+
+  return frame;
+}
+
+static int generateSamples(const uint32_t frame, const int idleBefore, const float samplesPerBit) {
+  int count = 0;
+  for (; count < idleBefore; count++) {
+    samples[count] = PIN_MASK;
+  }
+
+  uint16_t level = PIN_MASK;
+  const int frameStart = count;
+  for (int bit = DSHOT_TELEMETRY_FRAME_BITS - 1; bit >= 0; bit--) {
+    if (frame & (1 << bit)) {
+      level ^= PIN_MASK;
+    }
+
+    const int bitEnd = frameStart + (int)((DSHOT_TELEMETRY_FRAME_BITS - bit) * samplesPerBit + 0.5f);
+    for (; count < bitEnd; count++) {
+      samples[count] = level;
+    }
+  }
+
+  // Idle after the frame
+  for (int i = 0; i < 10; i++, count++) {
+    samples[count] = PIN_MASK;
+  }
+
+  return count;
+}
@@ -0,0 +1,190 @@
+// File under test filter.c
+#include "filter.h"
+
+#include <math.h>
+#include "unity.h"
+
+#define SAMPLE_FREQ 1000.0f
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void testThatLowPassBankMatchesLpf2p() {
+  // Fixture
+  biquadBank_t bank;
+  biquadBankInitLowPass(&bank, 3, SAMPLE_FREQ, 80.0f);
+
+  lpf2pData lpf[3];
+  for (int i = 0; i < 3; i++) {
+    lpf2pInit(&lpf[i], SAMPLE_FREQ, 80.0f);
+  }
+
+  // Test
+  // Assert
+  for (int n = 0; n < 200; n++) {
+    float samples[3] = {sinf(n * 0.1f), (n % 7) - 3.0f, 1.0f};
+    float expected[3];
+    for (int i = 0; i < 3; i++) {
+      expected[i] = lpf2pApply(&lpf[i], samples[i]);
+    }
+
+    biquadBankApply(&bank, samples);
+
+    for (int i = 0; i < 3; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected[i], samples[i]);
+    }
+  }
+}
+
+void testThatChannelsAreIndependent() {
+  // Fixture
+  biquadBank_t bank;
+  biquadBankInitLowPass(&bank, 2, SAMPLE_FREQ, 50.0f);
+  biquadBankSetLowPass(&bank, 1, SAMPLE_FREQ, 0.0f);
+
+  // Test
+  float samples[2] = {0.0f, 0.0f};
+  for (int n = 0; n < 1000; n++) {
+    samples[0] = 2.0f;
+    samples[1] = (float)n;
+    biquadBankApply(&bank, samples);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, samples[0]);
+  TEST_ASSERT_EQUAL_FLOAT(999.0f, samples[1]);
+}
+
+void testThatNotchRejectsCenterFrequency() {
+  // Fixture
+  const float centerFreq = 120.0f;
+  biquadBank_t bank;
+  biquadBankInitNotch(&bank, 2, SAMPLE_FREQ, centerFreq, 2.0f);
+
+  // Test
+  float maxAbs[2] = {0.0f, 0.0f};
+  for (int n = 0; n < 2000; n++) {
+    float t = n / SAMPLE_FREQ;
+    float samples[2] = {sinf(2.0f * (float)M_PI * centerFreq * t), 1.0f};
+    biquadBankApply(&bank, samples);
+    if (n > 1000) {
+      maxAbs[0] = fmaxf(maxAbs[0], fabsf(samples[0]));
+      maxAbs[1] = fmaxf(maxAbs[1], fabsf(samples[1]));
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, maxAbs[0]);
+  // Unity DC gain
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, maxAbs[1]);
+}
+
+void testThatNotchFromCosSinMatchesNotch() {
+  // Fixture
+  const float centerFreq = 170.0f;
+  const float w0 = 2.0f * (float)M_PI * centerFreq / SAMPLE_FREQ;
+  biquadBank_t expected;
+  biquadBankInitNotch(&expected, 1, SAMPLE_FREQ, centerFreq, 3.0f);
+  biquadBank_t actual;
+  biquadBankInitLowPass(&actual, 1, SAMPLE_FREQ, 0.0f);
+
+  // Test
+  biquadBankSetNotchCosSin(&actual, 0, cosf(w0), sinf(w0), 3.0f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.b0[0], actual.b0[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.b1[0], actual.b1[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.b2[0], actual.b2[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.a1[0], actual.a1[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected.a2[0], actual.a2[0]);
+}
+
+void testThatResetGivesSteadyState() {
+  // Fixture
+  biquadBank_t bank;
+  biquadBankInitLowPass(&bank, 3, SAMPLE_FREQ, 30.0f);
+  const float values[3] = {1.0f, -2.0f, 3.5f};
+
+  // Test
+  biquadBankReset(&bank, values);
+  float samples[3] = {1.0f, -2.0f, 3.5f};
+  biquadBankApply(&bank, samples);
+
+  // Assert
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, values[i], samples[i]);
+  }
+}
+
+void testThatNonFiniteInputDoesNotPropagate() {
+  // Fixture
+  biquadBank_t bank;
+  biquadBankInitLowPass(&bank, 1, SAMPLE_FREQ, 30.0f);
+
+  // Test
+  float sample = NAN;
+  biquadBankApply(&bank, &sample);
+  for (int n = 0; n < 5; n++) {
+    sample = 1.0f;
+    biquadBankApply(&bank, &sample);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, sample);
+}
+
+void testThatApplyDifferentiateMatchesApplyAndFiniteDifference() {
+  // Fixture
+  biquadBank_t expectedBank;
+  biquadBankInitLowPass(&expectedBank, 6, SAMPLE_FREQ, 30.0f);
+  biquadBankSetLowPass(&expectedBank, 2, SAMPLE_FREQ, 10.0f);
+  biquadBank_t actualBank = expectedBank;
+
+  // Test
+  // Assert
+  for (int n = 0; n < 200; n++) {
+    float expected[6];
+    float actual[6];
+    for (int i = 0; i < 6; i++) {
+      expected[i] = sinf(n * 0.05f * (i + 1)) + i;
+      actual[i] = expected[i];
+    }
+
+    biquadBankApply(&expectedBank, expected);
+    float derivative[3];
+    biquadBankApplyDifferentiate(&actualBank, actual, 3, SAMPLE_FREQ, derivative);
+
+    for (int i = 0; i < 6; i++) {
+      TEST_ASSERT_EQUAL_FLOAT(expected[i], actual[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+      TEST_ASSERT_EQUAL_FLOAT((expectedBank.y1[i] - expectedBank.y2[i]) * SAMPLE_FREQ, derivative[i]);
+    }
+  }
+}
+
+void testThatGoertzelSeparatesTheBinsOfABlock() {
+  // Fixture
+  const uint32_t length = 1024;
+  goertzel_t bins[3];
+  goertzelInit(&bins[0], 3, length);
+  goertzelInit(&bins[1], 5, length);
+  goertzelInit(&bins[2], 7, length);
+
+  // Test
+  for (uint32_t n = 0; n < length; n++) {
+    const float phase = 2.0f * (float)M_PI * n / length;
+    const float sample = 2.0f + 0.7f * sinf(5.0f * phase) + 0.3f * cosf(7.0f * phase + 1.0f);
+    for (int i = 0; i < 3; i++) {
+      goertzelAdd(&bins[i], sample);
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, goertzelAmplitude(&bins[0]));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.7f, goertzelAmplitude(&bins[1]));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.3f, goertzelAmplitude(&bins[2]));
+}
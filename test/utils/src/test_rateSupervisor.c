@@ -143,3 +143,48 @@ void testThatValidationFailesAfterSkip() {
     // Assert
     TEST_ASSERT_FALSE(actual);
 }
+
+void testThatARegisteredTaskCountsDeviations() {
+    // Fixture
+    static rateSupervisorTask_t task;
+    rateSupervisorRegisterTask(&task, "test", startTime, 3, 1, 0);
+    const uint32_t totalBefore = rateSupervisorTotalDeviations();
+
+    // Test
+    bool actual = rateSupervisorTaskValidate(&task, startTime + 1200);
+
+    // Assert
+    TEST_ASSERT_FALSE(actual);
+    TEST_ASSERT_EQUAL_UINT32(1, task.deviationCount);
+    TEST_ASSERT_EQUAL_UINT32(totalBefore + 1, rateSupervisorTotalDeviations());
+    TEST_ASSERT_EQUAL_PTR(&task, rateSupervisorLatestOffender());
+}
+
+void testThatATaskWithinToleranceIsNotAnOffender() {
+    // Fixture
+    static rateSupervisorTask_t task;
+    rateSupervisorRegisterTask(&task, "test", startTime, 3, 1, 0);
+    rateSupervisorTaskValidate(&task, startTime + 400);
+    rateSupervisorTaskValidate(&task, startTime + 800);
+
+    // Test
+    bool actual = rateSupervisorTaskValidate(&task, startTime + 1200);
+
+    // Assert
+    TEST_ASSERT_TRUE(actual);
+    TEST_ASSERT_EQUAL_UINT32(0, task.deviationCount);
+}
+
+void testThatRegisteringATaskAgainKeepsTheId() {
+    // Fixture
+    static rateSupervisorTask_t task;
+    rateSupervisorRegisterTask(&task, "test", startTime, 3, 1, 0);
+    const uint8_t expected = task.id;
+
+    // Test
+    rateSupervisorRegisterTask(&task, "test", startTime, 3, 1, 0);
+
+    // Assert
+    TEST_ASSERT_NOT_EQUAL(0, expected);
+    TEST_ASSERT_EQUAL_UINT8(expected, task.id);
+}
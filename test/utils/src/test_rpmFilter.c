@@ -0,0 +1,155 @@
+// File under test rpmFilter.c
+#include "rpmFilter.h"
+
+#include <math.h>
+#include "unity.h"
+
+#define SAMPLE_FREQ 1000.0f
+#define Q 5.0f
+#define MIN_FREQ 80.0f
+
+static rpmFilter_t filter;
+
+static float maxAbsAfterSettling(const float freq, const int axis);
+static void setAllRpm(const float rpm);
+
+void setUp(void) {
+  rpmFilterInit(&filter, SAMPLE_FREQ, 3, Q, MIN_FREQ);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheMotorFrequencyIsRejected() {
+  // Fixture
+  const float rpm[RPM_FILTER_MOTORS] = {9000.0f, 10000.0f, 11000.0f, 12000.0f};
+  rpmFilterSetRpm(&filter, rpm);
+
+  // Test
+  const float actual = maxAbsAfterSettling(11000.0f / 60.0f, 0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, actual);
+}
+
+void testThatTheSecondHarmonicIsRejected() {
+  // Fixture
+  setAllRpm(6000.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(2.0f * 6000.0f / 60.0f, 1);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, actual);
+}
+
+void testThatTheThirdHarmonicIsRejected() {
+  // Fixture
+  setAllRpm(6000.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(3.0f * 6000.0f / 60.0f, 2);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, actual);
+}
+
+void testThatHarmonicsAboveTheConfiguredAreNotRejected() {
+  // Fixture
+  rpmFilterInit(&filter, SAMPLE_FREQ, 1, Q, MIN_FREQ);
+  setAllRpm(6000.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(2.0f * 6000.0f / 60.0f, 0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f, actual);
+}
+
+void testThatFrequenciesAwayFromTheNotchesPass() {
+  // Fixture
+  setAllRpm(12000.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(10.0f, 0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 1.0f, actual);
+}
+
+void testThatStoppedMotorsAreClampedToTheMinFrequency() {
+  // Fixture
+  setAllRpm(0.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(MIN_FREQ, 0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, actual);
+}
+
+void testThatNotchesNearNyquistArePassedThrough() {
+  // Fixture
+  // The third harmonic is at 480 Hz
+  setAllRpm(9600.0f);
+
+  // Test
+  const float actual = maxAbsAfterSettling(3.0f * 9600.0f / 60.0f, 0);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual > 0.5f);
+}
+
+void testThatAllMotorsAreUpdatedWithinOneRound() {
+  // Fixture
+  rpmFilter_t expected;
+  rpmFilterInit(&expected, SAMPLE_FREQ, 3, Q, MIN_FREQ);
+  const float rpm[RPM_FILTER_MOTORS] = {6000.0f, 7000.0f, 8000.0f, 8500.0f};
+  for (int motor = 0; motor < RPM_FILTER_MOTORS; motor++) {
+    for (int harmonic = 0; harmonic < 3; harmonic++) {
+      const float freq = rpm[motor] * (harmonic + 1) / 60.0f;
+      biquadBankInitNotch(&expected.notch[motor][harmonic], RPM_FILTER_AXES, SAMPLE_FREQ, freq, Q);
+    }
+  }
+
+  rpmFilterSetRpm(&filter, rpm);
+
+  // Test
+  for (int i = 0; i < RPM_FILTER_MOTORS; i++) {
+    float axis[RPM_FILTER_AXES] = {0};
+    rpmFilterApply(&filter, axis);
+  }
+
+  // Assert
+  for (int motor = 0; motor < RPM_FILTER_MOTORS; motor++) {
+    for (int harmonic = 0; harmonic < 3; harmonic++) {
+      const biquadBank_t* e = &expected.notch[motor][harmonic];
+      const biquadBank_t* a = &filter.notch[motor][harmonic];
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, e->b0[0], a->b0[0]);
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, e->b1[2], a->b1[2]);
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, e->a2[1], a->a2[1]);
+    }
+  }
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static float maxAbsAfterSettling(const float freq, const int axis) {
+  float maxAbs = 0.0f;
+  for (int n = 0; n < 3000; n++) {
+    float samples[RPM_FILTER_AXES] = {0};
+    samples[axis] = sinf(2.0f * (float)M_PI * freq * n / SAMPLE_FREQ);
+    rpmFilterApply(&filter, samples);
+    if (n > 2000) {
+      maxAbs = fmaxf(maxAbs, fabsf(samples[axis]));
+    }
+  }
+
+  return maxAbs;
+}
+
+static void setAllRpm(const float rpm) {
+  const float all[RPM_FILTER_MOTORS] = {rpm, rpm, rpm, rpm};
+  rpmFilterSetRpm(&filter, all);
+}
@@ -0,0 +1,141 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_seqlock.c - unit tests for seqlock
+ */
+
+// File under test seqlock.c
+#include "seqlock.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+typedef struct {
+  uint32_t a;
+  float b;
+  uint8_t c[7];
+} testData_t;
+
+static seqlock_t lock;
+static testData_t storage;
+
+void setUp(void) {
+  seqlockInit(&lock);
+  memset(&storage, 0, sizeof(storage));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatReadReturnsWrittenData() {
+  // Fixture
+  const testData_t expected = {.a = 17, .b = 4.5f, .c = {1, 2, 3, 4, 5, 6, 7}};
+  testData_t actual;
+
+  // Test
+  seqlockWrite(&lock, &storage, &expected, sizeof(expected));
+  const bool result = seqlockRead(&lock, &storage, &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_MEMORY(&expected, &actual, sizeof(expected));
+}
+
+void testThatWriteLeavesSequenceEvenAndIncreased() {
+  // Fixture
+  const testData_t data = {.a = 1};
+  const uint32_t before = lock.sequence;
+
+  // Test
+  seqlockWrite(&lock, &storage, &data, sizeof(data));
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(before + 2, lock.sequence);
+}
+
+void testThatReadFailsWhileUpdateIsInProgress() {
+  // Fixture
+  testData_t actual;
+  seqlockWriteBegin(&lock);
+
+  // Test
+  const bool result = seqlockRead(&lock, &storage, &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
+
+void testThatReadSucceedsWhenUpdateIsDone() {
+  // Fixture
+  testData_t actual;
+  seqlockWriteBegin(&lock);
+  storage.a = 42;
+  seqlockWriteEnd(&lock);
+
+  // Test
+  const bool result = seqlockRead(&lock, &storage, &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(42, actual.a);
+}
+
+void testThatInPlaceReadIsValidWhenNotUpdated() {
+  // Fixture
+  seqlockWrite(&lock, &storage, &(testData_t){.a = 7}, sizeof(storage));
+
+  // Test
+  const uint32_t sequence = seqlockReadBegin(&lock);
+  const uint32_t actual = storage.a;
+  const bool result = seqlockReadValidate(&lock, sequence);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(7, actual);
+}
+
+void testThatInPlaceReadIsInvalidWhenUpdatedDuringTheRead() {
+  // Fixture
+  const uint32_t sequence = seqlockReadBegin(&lock);
+
+  // Test
+  seqlockWrite(&lock, &storage, &(testData_t){.a = 8}, sizeof(storage));
+  const bool result = seqlockReadValidate(&lock, sequence);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
+
+void testThatInPlaceReadIsInvalidWhenStartedDuringAnUpdate() {
+  // Fixture
+  seqlockWriteBegin(&lock);
+
+  // Test
+  const uint32_t sequence = seqlockReadBegin(&lock);
+  const bool result = seqlockReadValidate(&lock, sequence);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
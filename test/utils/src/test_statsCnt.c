@@ -30,6 +30,126 @@
 
 #include "unity.h"
 
+void testThatMinMaxAvgIsComputedWhenTimeSinceLastComputationIsLongerThanTheInterval() {
+  // Fixture
+  statsCntMinMaxAvg_t sut;
+  statsCntMinMaxAvgInit(&sut, 500);
+
+  statsCntMinMaxAvgAdd(&sut, 20);
+  statsCntMinMaxAvgAdd(&sut, 10);
+  statsCntMinMaxAvgAdd(&sut, 60);
+
+  // Test
+  bool actual = statsCntMinMaxAvgUpdate(&sut, 1000);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT32(10, sut.latestMin);
+  TEST_ASSERT_EQUAL_UINT32(60, sut.latestMax);
+  TEST_ASSERT_EQUAL_FLOAT(30.0f, sut.latestAvg);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, sut.latestRate);
+}
+
+void testThatMinMaxAvgIsNotComputedWhenTimeSinceLastComputationIsShorterThanTheInterval() {
+  // Fixture
+  statsCntMinMaxAvg_t sut;
+  statsCntMinMaxAvgInit(&sut, 500);
+  statsCntMinMaxAvgUpdate(&sut, 1000);
+
+  statsCntMinMaxAvgAdd(&sut, 20);
+
+  // Test
+  bool actual = statsCntMinMaxAvgUpdate(&sut, 1200);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(0, sut.latestMax);
+  TEST_ASSERT_EQUAL_UINT32(1, sut.count);
+}
+
+void testThatMinMaxAvgIsRestartedAfterComputation() {
+  // Fixture
+  statsCntMinMaxAvg_t sut;
+  statsCntMinMaxAvgInit(&sut, 500);
+  statsCntMinMaxAvgAdd(&sut, 100);
+  statsCntMinMaxAvgUpdate(&sut, 1000);
+
+  statsCntMinMaxAvgAdd(&sut, 5);
+
+  // Test
+  statsCntMinMaxAvgUpdate(&sut, 2000);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(5, sut.latestMin);
+  TEST_ASSERT_EQUAL_UINT32(5, sut.latestMax);
+  TEST_ASSERT_EQUAL_FLOAT(5.0f, sut.latestAvg);
+}
+
+void testThatHistogramBucketsAreLogarithmic() {
+  // Fixture
+  statsCntHistogram_t sut;
+  statsCntHistogramInit(&sut, 4, 500);
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, statsCntHistogramBucket(&sut, 0));
+  TEST_ASSERT_EQUAL_INT(0, statsCntHistogramBucket(&sut, 15));
+  TEST_ASSERT_EQUAL_INT(1, statsCntHistogramBucket(&sut, 16));
+  TEST_ASSERT_EQUAL_INT(1, statsCntHistogramBucket(&sut, 31));
+  TEST_ASSERT_EQUAL_INT(2, statsCntHistogramBucket(&sut, 32));
+  TEST_ASSERT_EQUAL_INT(STATS_CNT_HISTOGRAM_BUCKETS - 1, statsCntHistogramBucket(&sut, 16 << (STATS_CNT_HISTOGRAM_BUCKETS - 2)));
+  TEST_ASSERT_EQUAL_INT(STATS_CNT_HISTOGRAM_BUCKETS - 1, statsCntHistogramBucket(&sut, UINT32_MAX));
+}
+
+void testThatHistogramCountsSamplesInTheInterval() {
+  // Fixture
+  statsCntHistogram_t sut;
+  statsCntHistogramInit(&sut, 0, 500);
+  statsCntHistogramAdd(&sut, 0);
+  statsCntHistogramUpdate(&sut, 1000);
+
+  statsCntHistogramAdd(&sut, 0);
+  statsCntHistogramAdd(&sut, 3);
+  statsCntHistogramAdd(&sut, 2);
+
+  // Test
+  bool actual = statsCntHistogramUpdate(&sut, 2000);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT16(1, sut.latest[0]);
+  TEST_ASSERT_EQUAL_UINT16(0, sut.latest[1]);
+  TEST_ASSERT_EQUAL_UINT16(2, sut.latest[2]);
+}
+
+void testThatHistogramIsNotUpdatedWhenTimeSinceLastComputationIsShorterThanTheInterval() {
+  // Fixture
+  statsCntHistogram_t sut;
+  statsCntHistogramInit(&sut, 0, 500);
+  statsCntHistogramUpdate(&sut, 1000);
+  statsCntHistogramAdd(&sut, 1);
+
+  // Test
+  bool actual = statsCntHistogramUpdate(&sut, 1200);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT16(0, sut.latest[1]);
+}
+
+void testThatHistogramLatestCountIsSaturated() {
+  // Fixture
+  statsCntHistogram_t sut;
+  statsCntHistogramInit(&sut, 0, 500);
+  sut.count[1] = 100000;
+
+  // Test
+  statsCntHistogramUpdate(&sut, 1000);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, sut.latest[1]);
+}
+
 
 // Helpers
 void assertRateCounterIsInitialized(statsCntRateCounter_t* sut);
@@ -0,0 +1,190 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * test_swarmTime.c - unit tests for the swarm time base
+ */
+
+// File under test
+#include "swarmTime.h"
+
+#include <stdlib.h>
+
+#include "unity.h"
+
+static swarmTime_t swarmTime;
+
+static const uint64_t swarmEpochUs = 1000000000000ull;
+static const uint64_t latencyUs = 2000;
+static const double drift = 40e-6;
+
+static uint64_t trueSwarmTime(const uint64_t localTimeUs);
+static void feedSamples(const uint64_t startLocalUs, const int count, const uint64_t intervalUs, const uint64_t jitterUs);
+static int64_t estimateError(const uint64_t localTimeUs);
+
+void setUp(void) {
+  swarmTimeInit(&swarmTime);
+  srand(1);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTheSwarmTimeIsNotSynchronizedBeforeEnoughSamples() {
+  // Fixture
+  feedSamples(1000000, SWARM_TIME_MIN_SAMPLES - 1, 100000, 0);
+
+  // Test
+  bool actual = swarmTimeIsSynchronized(&swarmTime, 1500000);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatTheSwarmTimeIsSynchronizedAfterEnoughSamples() {
+  // Fixture
+  feedSamples(1000000, SWARM_TIME_MIN_SAMPLES, 100000, 0);
+
+  // Test
+  bool actual = swarmTimeIsSynchronized(&swarmTime, 1500000);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatTheSwarmTimeIsNotSynchronizedWhenSamplesStop() {
+  // Fixture
+  feedSamples(1000000, 20, 100000, 0);
+
+  // Test
+  bool actual = swarmTimeIsSynchronized(&swarmTime, 3000000 + SWARM_TIME_MAX_AGE_US);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatTheSwarmTimeFollowsADriftingClockWithJitter() {
+  // Fixture
+  feedSamples(1000000, 600, 100000, 1000);
+
+  // Test
+  int64_t actual = estimateError(61000000);
+
+  // Assert
+  TEST_ASSERT_INT64_WITHIN(300, 0, actual);
+}
+
+void testThatTheDriftIsCompensatedWhenSamplesStop() {
+  // Fixture
+  feedSamples(1000000, 1200, 100000, 0);
+
+  // Test
+  // Without drift compensation the error would be 400 us after 10 s
+  int64_t actual = estimateError(121000000 + 10000000);
+
+  // Assert
+  TEST_ASSERT_INT64_WITHIN(100, 0, actual);
+}
+
+void testThatAnOutlierIsRejected() {
+  // Fixture
+  feedSamples(1000000, 20, 100000, 0);
+  const uint64_t localTimeUs = 3000000 + latencyUs;
+
+  // Test
+  bool actual = swarmTimeUpdate(&swarmTime, trueSwarmTime(localTimeUs - latencyUs) + 100000, localTimeUs);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_INT64_WITHIN(100, 0, estimateError(localTimeUs));
+}
+
+void testThatAJumpInTheSwarmClockRestartsTheEstimate() {
+  // Fixture
+  feedSamples(1000000, 20, 100000, 0);
+  const uint64_t jumpUs = 5000000;
+
+  // Test
+  for (int i = 0; i <= SWARM_TIME_MAX_OUTLIERS; i++) {
+    const uint64_t localTimeUs = 3000000 + i * 100000;
+    swarmTimeUpdate(&swarmTime, trueSwarmTime(localTimeUs) + jumpUs, localTimeUs + latencyUs);
+  }
+
+  // Assert
+  const uint64_t localTimeUs = 3000000 + SWARM_TIME_MAX_OUTLIERS * 100000 + latencyUs;
+  TEST_ASSERT_EQUAL_UINT32(1, swarmTime.resyncCount);
+  TEST_ASSERT_INT64_WITHIN(100, jumpUs, estimateError(localTimeUs));
+  TEST_ASSERT_FALSE(swarmTimeIsSynchronized(&swarmTime, localTimeUs));
+}
+
+void testThatToLocalIsTheInverseOfFromLocal() {
+  // Fixture
+  feedSamples(1000000, 100, 100000, 500);
+  const uint64_t localTimeUs = 20000000;
+
+  // Test
+  uint64_t actual = swarmTimeToLocal(&swarmTime, swarmTimeFromLocal(&swarmTime, localTimeUs));
+
+  // Assert
+  TEST_ASSERT_INT64_WITHIN(1, localTimeUs, actual);
+}
+
+void testThatTruncatedSwarmTimeIsResolvedAroundTheCurrentTime() {
+  // Fixture
+  feedSamples(1000000, 100, 100000, 0);
+  const uint64_t localNowUs = 11000000;
+  const uint64_t startSwarmUs = swarmTimeFromLocal(&swarmTime, localNowUs) / 1000 * 1000 + 500000;
+  const uint32_t truncatedMs = (uint32_t)(startSwarmUs / 1000);
+
+  // Test
+  uint64_t actual = swarmTimeToLocalFromMs(&swarmTime, truncatedMs, localNowUs);
+
+  // Assert
+  TEST_ASSERT_INT64_WITHIN(1, swarmTimeToLocal(&swarmTime, startSwarmUs), actual);
+  TEST_ASSERT_INT64_WITHIN(1000, localNowUs + 500000, actual);
+}
+
+// Helpers ////////////////////////////////////////////////
+
+static uint64_t trueSwarmTime(const uint64_t localTimeUs) {
+  return swarmEpochUs + (uint64_t)(localTimeUs * (1.0 + drift));
+}
+
+// The time stamp in a packet is the swarm time when it was sent, it is received latencyUs later (+/- jitter)
+static void feedSamples(const uint64_t startLocalUs, const int count, const uint64_t intervalUs, const uint64_t jitterUs) {
+  for (int i = 0; i < count; i++) {
+    const uint64_t sendLocalUs = startLocalUs + i * intervalUs;
+    uint64_t receiveLocalUs = sendLocalUs + latencyUs;
+    if (jitterUs > 0) {
+      receiveLocalUs += rand() % (2 * jitterUs) - jitterUs;
+    }
+    swarmTimeUpdate(&swarmTime, trueSwarmTime(sendLocalUs), receiveLocalUs);
+  }
+}
+
+// The error of the estimate, not counting the mean latency that is common to all Crazyflies in the swarm
+static int64_t estimateError(const uint64_t localTimeUs) {
+  const uint64_t expected = trueSwarmTime(localTimeUs - latencyUs);
+  return (int64_t)(swarmTimeFromLocal(&swarmTime, localTimeUs) - expected);
+}
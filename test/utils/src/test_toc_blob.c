@@ -0,0 +1,140 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_toc_blob.c - unit tests for the serialized TOC
+ */
+
+// File under test toc_blob.c
+#include "toc_blob.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+typedef struct {
+  uint8_t type;
+  const char* group;
+  const char* name;
+} testEntry_t;
+
+// Entries with a NULL name are group markers
+static const testEntry_t entries[] = {
+  {0, "stateEstimate", 0},
+  {7, "", "x"},
+  {7, "", "y"},
+  {0, "pm", 0},
+  {1, "", "state"},
+};
+static const int entriesLen = sizeof(entries) / sizeof(entries[0]);
+
+static const uint8_t expectedBlob[] = {
+  TOC_BLOB_VERSION, 3, 0, 0x78, 0x56, 0x34, 0x12,
+  7, 's', 't', 'a', 't', 'e', 'E', 's', 't', 'i', 'm', 'a', 't', 'e', 0, 'x', 0,
+  7, 0, 'y', 0,
+  1, 'p', 'm', 0, 's', 't', 'a', 't', 'e', 0,
+};
+
+static uint8_t encode(const int entry, uint8_t* buffer)
+{
+  if (!entries[entry].name) {
+    return 0;
+  }
+
+  const bool isFirstInGroup = entry > 0 && !entries[entry - 1].name;
+  const char* group = isFirstInGroup ? entries[entry - 1].group : "";
+
+  buffer[0] = entries[entry].type;
+  strcpy((char*)&buffer[1], group);
+  strcpy((char*)&buffer[2 + strlen(group)], entries[entry].name);
+  return 3 + strlen(group) + strlen(entries[entry].name);
+}
+
+static tocBlob_t blob;
+
+void setUp(void) {
+  tocBlobInit(&blob, entriesLen, 3, 0x12345678, encode);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testSizeIsHeaderAndEntries(void) {
+  // Fixture
+  // Test
+  uint32_t actual = tocBlobGetSize(&blob);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(sizeof(expectedBlob), actual);
+}
+
+void testReadWholeBlob(void) {
+  // Fixture
+  uint8_t actual[sizeof(expectedBlob)];
+
+  // Test
+  bool result = tocBlobRead(&blob, 0, sizeof(expectedBlob), actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBlob, actual, sizeof(expectedBlob));
+}
+
+void testSequentialSmallReads(void) {
+  // Fixture
+  uint8_t actual[sizeof(expectedBlob)];
+
+  // Test
+  for (uint32_t address = 0; address < sizeof(expectedBlob); address += 5) {
+    uint8_t length = sizeof(expectedBlob) - address < 5 ? sizeof(expectedBlob) - address : 5;
+    TEST_ASSERT_TRUE(tocBlobRead(&blob, address, length, &actual[address]));
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBlob, actual, sizeof(expectedBlob));
+}
+
+void testReadBackwards(void) {
+  // Fixture
+  uint8_t actual[4];
+  uint8_t dummy[4];
+  tocBlobRead(&blob, 30, 4, dummy);
+
+  // Test
+  bool result = tocBlobRead(&blob, 10, 4, actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&expectedBlob[10], actual, 4);
+}
+
+void testReadOutsideBlobFails(void) {
+  // Fixture
+  uint8_t actual[4];
+
+  // Test
+  bool result = tocBlobRead(&blob, sizeof(expectedBlob) - 2, 4, actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+}
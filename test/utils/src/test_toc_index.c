@@ -0,0 +1,147 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_toc_index.c - unit tests for the TOC name index
+ */
+
+// File under test toc_index.c
+#include "toc_index.h"
+
+#include <string.h>
+
+#include "unity.h"
+
+typedef struct {
+  const char* group;
+  const char* name;
+} testEntry_t;
+
+static const testEntry_t entries[] = {
+  {"stateEstimate", "x"},
+  {"stateEstimate", "y"},
+  {"stateEstimate", "z"},
+  {"pm", "state"},
+  {"pm", "vbat"},
+  {"", "ungrouped"},
+  {"stabilizer", "x"},
+};
+#define ENTRY_COUNT (sizeof(entries) / sizeof(entries[0]))
+
+static bool matchEntry(const uint16_t entry, const char* group, const char* name) {
+  return !strcmp(entries[entry].group, group) && !strcmp(entries[entry].name, name);
+}
+
+#define SLOT_COUNT 16
+static tocIndexSlot_t slots[SLOT_COUNT];
+static tocIndex_t tocIndex;
+
+void setUp(void) {
+  tocIndexInit(&tocIndex, slots, SLOT_COUNT);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+static void addAllEntries() {
+  for (uint16_t i = 0; i < ENTRY_COUNT; i++) {
+    TEST_ASSERT_TRUE(tocIndexAdd(&tocIndex, entries[i].group, entries[i].name, i, 100 + i));
+  }
+}
+
+void testThatAllEntriesAreFound() {
+  // Fixture
+  addAllEntries();
+
+  for (uint16_t i = 0; i < ENTRY_COUNT; i++) {
+    uint16_t data = 0;
+
+    // Test
+    int actual = tocIndexFind(&tocIndex, entries[i].group, entries[i].name, matchEntry, &data);
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT(i, actual);
+    TEST_ASSERT_EQUAL_UINT16(100 + i, data);
+  }
+}
+
+void testThatUnknownNameIsNotFound() {
+  // Fixture
+  addAllEntries();
+
+  // Test
+  int actual = tocIndexFind(&tocIndex, "stateEstimate", "w", matchEntry, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, actual);
+}
+
+void testThatSameNameInOtherGroupIsNotFound() {
+  // Fixture
+  addAllEntries();
+
+  // Test
+  int actual = tocIndexFind(&tocIndex, "pm", "x", matchEntry, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, actual);
+}
+
+void testThatEmptyIndexFindsNothing() {
+  // Fixture
+
+  // Test
+  int actual = tocIndexFind(&tocIndex, "pm", "vbat", matchEntry, NULL);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, actual);
+}
+
+void testThatAddFailsWhenIndexIsFull() {
+  // Fixture
+  // 75% of the 16 slots can be used
+  for (uint16_t i = 0; i < 12; i++) {
+    TEST_ASSERT_TRUE(tocIndexAdd(&tocIndex, "pm", "vbat", i, 0));
+  }
+
+  // Test
+  bool actual = tocIndexAdd(&tocIndex, "pm", "vbat", 12, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatFirstAddedDuplicateIsFound() {
+  // Fixture
+  addAllEntries();
+  tocIndexAdd(&tocIndex, "pm", "vbat", 4, 200);
+
+  uint16_t data = 0;
+
+  // Test
+  int actual = tocIndexFind(&tocIndex, "pm", "vbat", matchEntry, &data);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, actual);
+  TEST_ASSERT_EQUAL_UINT16(104, data);
+}
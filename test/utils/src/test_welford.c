@@ -0,0 +1,101 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2026 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_toc_blob.c - unit tests for the serialized TOC
+ * test_welford.c - unit tests for the streaming mean and variance
+ */
+
+// File under test welford.c
+#include "welford.h"
+
+#include "unity.h"
+
+void testThatMeanAndVarianceAreZeroWithoutSamples() {
+  // Fixture
+  welford_t sut;
+  welfordInit(&sut);
+
+  // Test
+  float actualMean = welfordMean(&sut);
+  float actualVariance = welfordVariance(&sut);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, actualMean);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, actualVariance);
+}
+
+void testThatMeanAndPopulationVarianceAreComputed() {
+  // Fixture
+  welford_t sut;
+  welfordInit(&sut);
+
+  const float samples[] = {2.0f, 4.0f, 4.0f, 4.0f, 5.0f, 5.0f, 7.0f, 9.0f};
+  for (int i = 0; i < 8; i++) {
+    welfordAdd(&sut, samples[i]);
+  }
+
+  // Test
+  float actualMean = welfordMean(&sut);
+  float actualVariance = welfordVariance(&sut);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(8, sut.count);
+  TEST_ASSERT_EQUAL_FLOAT(5.0f, actualMean);
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, actualVariance);
+}
+
+void testThatVarianceIsAccurateWithLargeOffset() {
+  // Fixture
+  welford_t sut;
+  welfordInit(&sut);
+
+  // A window of raw gyro samples with a large bias and a small noise
+  for (int i = 0; i < 1024; i++) {
+    welfordAdd(&sut, 20000.0f + ((i % 2) ? 3.0f : -3.0f));
+  }
+
+  // Test
+  float actualMean = welfordMean(&sut);
+  float actualVariance = welfordVariance(&sut);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20000.0f, actualMean);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 9.0f, actualVariance);
+}
+
+void testThatInitRestartsTheStatistics() {
+  // Fixture
+  welford_t sut;
+  welfordInit(&sut);
+  welfordAdd(&sut, 100.0f);
+  welfordAdd(&sut, 200.0f);
+
+  // Test
+  welfordInit(&sut);
+  welfordAdd(&sut, 1.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(1, sut.count);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, welfordMean(&sut));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, welfordVariance(&sut));
+}
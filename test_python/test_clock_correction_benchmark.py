@@ -0,0 +1,62 @@
+#!/usr/bin/env python
+
+import numpy as np
+import cffirmware
+from bindings.util.clock_correction_benchmark import ClockCorrectionReplay
+from bindings.util.clock_correction_benchmark import convergence_time
+from bindings.util.clock_correction_benchmark import synthetic_stream
+
+
+def test_clock_correction_replay_with_no_samples():
+    # Fixture
+    replay = ClockCorrectionReplay(cffirmware.clockCorrectionAlgorithmBucket)
+    samples = np.zeros(0, dtype=ClockCorrectionReplay.SAMPLE_DTYPE)
+
+    # Test
+    actual, stats = replay.run(samples)
+
+    # Assert
+    assert len(actual) == 0
+
+
+def test_that_both_algorithms_converge_on_a_clean_stream():
+    # Fixture
+    expected = 1.0 + 5e-6
+    samples = synthetic_stream(expected, noise_ticks=1.0)
+
+    for algorithm in [cffirmware.clockCorrectionAlgorithmBucket, cffirmware.clockCorrectionAlgorithmLeastSquares]:
+        # Test
+        actual, stats = ClockCorrectionReplay(algorithm).run(samples)
+
+        # Assert
+        assert convergence_time(samples, actual, expected) is not None
+        assert abs(actual['clockCorrection'][-1] - expected) < 0.1e-6
+
+
+def test_that_least_squares_converges_no_later_than_bucket_on_a_noisy_stream():
+    # Fixture
+    expected = 1.0 - 8e-6
+    samples = synthetic_stream(expected, noise_ticks=20.0, loss=0.1)
+
+    # Test
+    bucket, _ = ClockCorrectionReplay(cffirmware.clockCorrectionAlgorithmBucket).run(samples)
+    least_squares, _ = ClockCorrectionReplay(cffirmware.clockCorrectionAlgorithmLeastSquares).run(samples)
+
+    # Assert
+    actual = convergence_time(samples, least_squares, expected)
+    assert actual is not None
+    bucket_time = convergence_time(samples, bucket, expected)
+    if bucket_time is not None:
+        assert actual <= bucket_time
+
+
+def test_clock_correction_replay_reports_timing():
+    # Fixture
+    samples = synthetic_stream(1.0, duration=20.0)
+
+    # Test
+    actual, stats = ClockCorrectionReplay(cffirmware.clockCorrectionAlgorithmLeastSquares).run(samples)
+
+    # Assert
+    assert stats.sampleCount == len(samples)
+    assert stats.nsPerUpdate > 0.0
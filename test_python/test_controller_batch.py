@@ -0,0 +1,148 @@
+#!/usr/bin/env python
+
+import numpy as np
+import cffirmware
+from bindings.util.controller_batch import ControllerBatch
+
+CONTROLLERS = [
+    cffirmware.controllerBatchPid,
+    cffirmware.controllerBatchMellinger,
+    cffirmware.controllerBatchBrescianini,
+    cffirmware.controllerBatchLee,
+]
+
+
+def _make_inputs(count):
+    inputs = ControllerBatch.make_inputs(count)
+    t = np.arange(count) * 0.001
+    inputs['mode'] = cffirmware.modeAbs
+    inputs['position'][:, 0] = 0.5 * np.sin(t)
+    inputs['position'][:, 2] = 1.0
+    inputs['velocity'][:, 0] = 0.5 * np.cos(t)
+    inputs['statePosition'][:, 0] = 0.4 * np.sin(t)
+    inputs['statePosition'][:, 2] = 0.9
+    inputs['stateVelocity'][:, 0] = 0.1
+    inputs['gyro'][:, 2] = 5.0 * np.sin(10 * t)
+    return inputs
+
+
+def _run_one_call_at_a_time(controller_type, inputs):
+    mellinger = cffirmware.controllerMellinger_t()
+    lee = cffirmware.controllerLee_t()
+    if controller_type == cffirmware.controllerBatchPid:
+        cffirmware.controllerPidInit()
+    elif controller_type == cffirmware.controllerBatchMellinger:
+        cffirmware.controllerMellingerInit(mellinger)
+    elif controller_type == cffirmware.controllerBatchBrescianini:
+        cffirmware.controllerBrescianiniInit()
+    else:
+        cffirmware.controllerLeeInit(lee)
+
+    control = cffirmware.control_t()
+    setpoint = cffirmware.setpoint_t()
+    sensors = cffirmware.sensorData_t()
+    state = cffirmware.state_t()
+    result = []
+    for tick, input in enumerate(inputs):
+        setpoint.mode.x, setpoint.mode.y, setpoint.mode.z, setpoint.mode.yaw = [int(m) for m in input['mode']]
+        setpoint.position.x, setpoint.position.y, setpoint.position.z = [float(v) for v in input['position']]
+        setpoint.velocity.x, setpoint.velocity.y, setpoint.velocity.z = [float(v) for v in input['velocity']]
+        state.position.x, state.position.y, state.position.z = [float(v) for v in input['statePosition']]
+        state.velocity.x, state.velocity.y, state.velocity.z = [float(v) for v in input['stateVelocity']]
+        q = input['stateQuaternion']
+        state.attitudeQuaternion.x, state.attitudeQuaternion.y = float(q[0]), float(q[1])
+        state.attitudeQuaternion.z, state.attitudeQuaternion.w = float(q[2]), float(q[3])
+        sensors.gyro.x, sensors.gyro.y, sensors.gyro.z = [float(v) for v in input['gyro']]
+
+        if controller_type == cffirmware.controllerBatchPid:
+            cffirmware.controllerPid(control, setpoint, sensors, state, tick)
+        elif controller_type == cffirmware.controllerBatchMellinger:
+            cffirmware.controllerMellinger(mellinger, control, setpoint, sensors, state, tick)
+        elif controller_type == cffirmware.controllerBatchBrescianini:
+            cffirmware.controllerBrescianini(control, setpoint, sensors, state, tick)
+        else:
+            cffirmware.controllerLee(lee, control, setpoint, sensors, state, tick)
+
+        if control.controlMode == cffirmware.controlModeLegacy:
+            result.append([control.thrust, control.roll, control.pitch, control.yaw])
+        else:
+            result.append([control.thrustSi, control.torqueX, control.torqueY, control.torqueZ])
+    return np.array(result, dtype=np.float32)
+
+
+def test_batch_matches_one_call_at_a_time():
+    # Fixture
+    inputs = _make_inputs(200)
+
+    for controller_type in CONTROLLERS:
+        expected = _run_one_call_at_a_time(controller_type, inputs)
+
+        # Test
+        actual = ControllerBatch(controller_type).run(inputs)
+
+        # Assert
+        assert np.allclose(expected, actual['value'], rtol=1e-5, atol=1e-5)
+
+
+def test_batch_keeps_the_controller_state_between_calls():
+    # Fixture
+    inputs = _make_inputs(300)
+    expected = ControllerBatch(cffirmware.controllerBatchMellinger).run(inputs)
+
+    # Test
+    batch = ControllerBatch(cffirmware.controllerBatchMellinger)
+    actual = np.concatenate((batch.run(inputs[:100]), batch.run(inputs[100:])))
+
+    # Assert
+    assert np.array_equal(expected, actual)
+
+
+def test_batch_power_distribution_matches_power_distribution():
+    # Fixture
+    control = np.zeros(3, dtype=ControllerBatch.CONTROL_DTYPE)
+    control['controlMode'] = cffirmware.controlModeLegacy
+    control['value'] = [[10, 0, 0, 0], [1000, 10, 0, 0], [70000, 0, 0, 0]]
+
+    # Test
+    actual = ControllerBatch.power_distribution(control)
+
+    # Assert
+    for i in range(len(control)):
+        fw_control = cffirmware.control_t()
+        fw_control.controlMode = cffirmware.controlModeLegacy
+        fw_control.thrust, fw_control.roll, fw_control.pitch, fw_control.yaw = [float(v) for v in control['value'][i]]
+        expected = cffirmware.motors_thrust_uncapped_t()
+        cffirmware.powerDistribution(fw_control, expected)
+        assert list(actual['motorThrustUncapped'][i]) == [expected.motors.m1, expected.motors.m2, expected.motors.m3, expected.motors.m4]
+    assert not actual['isCapped'][0]
+    assert actual['isCapped'][2]
+
+
+def test_batch_run_with_power_distribution():
+    # Fixture
+    inputs = _make_inputs(50)
+    batch = ControllerBatch(cffirmware.controllerBatchMellinger)
+
+    # Test
+    control, motors = batch.run(inputs, power_distribution=True)
+
+    # Assert
+    assert np.array_equal(ControllerBatch.power_distribution(control), motors)
+
+
+def test_batch_planner_matches_plan_current_goal():
+    # Fixture
+    planner = cffirmware.planner()
+    cffirmware.plan_init(planner)
+    cffirmware.plan_takeoff(planner, cffirmware.mkvec(0, 0, 0), 0, 1.0, 0, 2.0, 0)
+    t = np.linspace(0, 2.0, 21)
+
+    # Test
+    actual = ControllerBatch.planner_goals(planner, t)
+
+    # Assert
+    for i, ti in enumerate(t):
+        expected = cffirmware.plan_current_goal(planner, float(np.float32(ti)))
+        assert np.allclose(np.array(expected.pos), actual['position'][i], atol=1e-6)
+        assert np.allclose(np.array(expected.vel), actual['velocity'][i], atol=1e-6)
+        assert np.isclose(expected.yaw, actual['yaw'][i], atol=1e-6)
@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+
+import numpy as np
+import cffirmware
+
+BENCHMARKS = [
+    cffirmware.ControllerBenchmarkMellinger,
+    cffirmware.ControllerBenchmarkLee,
+    cffirmware.ControllerBenchmarkBrescianini,
+    cffirmware.ControllerBenchmarkMath3d,
+    cffirmware.ControllerBenchmarkMath3dFast,
+    cffirmware.ControllerBenchmarkPoly4dEval,
+    cffirmware.ControllerBenchmarkSubSampler,
+    cffirmware.ControllerBenchmarkSubSamplerConing,
+]
+
+
+def test_controller_benchmark_reports_timing_for_all_benchmarks():
+    # Fixture
+    iterations = 500
+    result = cffirmware.controllerBenchmarkResult_t()
+
+    for benchmark in BENCHMARKS:
+        # Test
+        cffirmware.controllerBenchmarkRunHost(benchmark, iterations, result)
+        # Run with "pytest -s" to see the numbers
+        print('{:12s} min {:6d} avg {:8.1f} max {:6d} ns'.format(
+            cffirmware.controllerBenchmarkName(benchmark), result.min, result.avg, result.max))
+
+        # Assert
+        assert result.count == iterations
+        assert result.min <= result.avg <= result.max
+
+
+def test_qvrot_fast_matches_qvrot():
+    # Fixture
+    q = cffirmware.rpy2quat(cffirmware.mkvec(0.3, -0.2, 1.1))
+    v = cffirmware.mkvec(1, -2, 3)
+
+    # Test
+    actual = np.array(cffirmware.qvrot_fast(q, v))
+
+    # Assert
+    expected = np.array(cffirmware.qvrot(q, v))
+    assert np.allclose(expected, actual, atol=1e-5)
+
+
+def test_quat2rotmat_fast_matches_quat2rotmat():
+    # Fixture
+    q = cffirmware.rpy2quat(cffirmware.mkvec(-0.7, 0.4, 2.5))
+
+    # Test
+    actual = cffirmware.quat2rotmat_fast(q)
+
+    # Assert
+    expected = cffirmware.quat2rotmat(q)
+    for i in range(3):
+        assert np.allclose(np.array(cffirmware.mcolumn(expected, i)), np.array(cffirmware.mcolumn(actual, i)), atol=1e-6)
+
+
+def test_rsqrtf_fast_is_accurate():
+    # Fixture
+    values = [1e-4, 0.5, 1.0, 2.0, 123.0, 1e5]
+
+    for value in values:
+        # Test
+        actual = cffirmware.rsqrtf_fast(value)
+        # Assert
+        expected = 1.0 / np.sqrt(value)
+        assert np.isclose(expected, actual, rtol=1e-5)
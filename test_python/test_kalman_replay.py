@@ -0,0 +1,45 @@
+#!/usr/bin/env python
+
+import numpy as np
+from bindings.util.estimator_kalman_emulator import EstimatorKalmanEmulator
+from bindings.util.kalman_replay import KalmanReplay
+from bindings.util.sd_card_file_runner import SdCardFileRunner
+from bindings.util.loco_utils import read_loco_anchor_positions
+
+fixture_base = 'test_python/fixtures/kalman_core'
+
+
+def test_kalman_replay_with_tdoa3():
+    # Fixture
+    anchor_positions = read_loco_anchor_positions(fixture_base + '/anchor_positions.yaml')
+    samples = KalmanReplay.read_samples(fixture_base + '/log05')
+    replay = KalmanReplay(anchor_positions)
+
+    # Test
+    actual, stats = replay.run(samples)
+
+    # Assert
+    # Verify that the final position is close-ish to (0, 0, 0)
+    assert np.linalg.norm(actual['position'][-1] - [0.0, 0.0, 0.0]) < 0.4
+    assert stats.sampleCount == len(samples)
+    assert stats.iterationCount == len(actual)
+    assert stats.samplesPerSecond > 0.0
+
+
+def test_kalman_replay_is_equal_to_emulator():
+    # Fixture
+    anchor_positions = read_loco_anchor_positions(fixture_base + '/anchor_positions.yaml')
+    runner = SdCardFileRunner(fixture_base + '/log05')
+    emulator = EstimatorKalmanEmulator(anchor_positions)
+    expected = runner.run_estimator_loop(emulator)
+
+    samples = KalmanReplay.read_samples(fixture_base + '/log05')
+    replay = KalmanReplay(anchor_positions)
+
+    # Test
+    actual, stats = replay.run(samples)
+
+    # Assert
+    assert len(actual) == len(expected)
+    assert actual['timestamp'][-1] == expected[-1][0]
+    assert np.allclose(actual['position'][-1], expected[-1][1], atol=1e-5)
@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+
+import numpy as np
+from bindings.util.lighthouse_replay import LighthouseReplay
+
+
+def test_lighthouse_replay_with_no_frames():
+    # Fixture
+    replay = LighthouseReplay()
+    frames = np.zeros(0, dtype=LighthouseReplay.FRAME_DTYPE)
+
+    # Test
+    actual, stats = replay.run(frames)
+
+    # Assert
+    assert len(actual) == 0
+
+
+def test_lighthouse_replay_reports_timing():
+    # Fixture
+    replay = LighthouseReplay()
+    frame_count = 10000
+    frames = np.zeros(frame_count, dtype=LighthouseReplay.FRAME_DTYPE)
+    frames['usecTimestamp'] = np.arange(frame_count) * 20
+    frames['timestamp'] = (np.arange(frame_count) * 480) & 0xffffff
+    frames['info'] = np.arange(frame_count) % 4
+
+    # Test
+    actual, stats = replay.run(frames)
+
+    # Assert
+    # No calibration or geometry data, no positions
+    assert len(actual) == 0
+    assert stats.frameCount == frame_count
+    assert stats.positionCount == 0
+    assert stats.framesPerSecond > 0.0
+
+
+def test_lighthouse_replay_reads_snapshots_from_log_data():
+    # Fixture
+    bs = 2
+    log_data = {
+        'lhFrame': {
+            'timestamp': np.array([1.0, 1.5]),
+            'info': np.array([0x14, 0x01]),
+            'width': np.array([100, 200]),
+            'beamData': np.array([3, 4]),
+            'offset': np.array([5, 6]),
+            'deckTs': np.array([7, 8]),
+        },
+        'lhCalibA': {
+            'timestamp': np.array([1.0, 1.0]),
+            'id': np.array([bs << 1, (bs << 1) | 1]),
+            'phase': np.array([0.1, 1.1]),
+            'tilt': np.array([0.2, 1.2]),
+            'curve': np.array([0.3, 1.3]),
+            'gibmag': np.array([0.4, 1.4]),
+        },
+        'lhCalibB': {
+            'timestamp': np.array([1.0, 1.0]),
+            'id': np.array([bs << 1, (bs << 1) | 1]),
+            'gibphase': np.array([0.5, 1.5]),
+            'ogeemag': np.array([0.6, 1.6]),
+            'ogeephase': np.array([0.7, 1.7]),
+            'uid': np.array([1234, 1234]),
+        },
+        'lhGeo': {
+            'timestamp': np.array([1.0, 1.0, 1.0, 1.0]),
+            'id': np.array([(bs << 2) | row for row in range(4)]),
+            'x': np.array([1.0, 1.0, 0.0, 0.0]),
+            'y': np.array([2.0, 0.0, 1.0, 0.0]),
+            'z': np.array([3.0, 0.0, 0.0, 1.0]),
+        },
+    }
+
+    # Test
+    frames, calibrations, geometries = LighthouseReplay.from_log_data(log_data)
+
+    # Assert
+    assert list(frames['usecTimestamp']) == [1000, 1500]
+    assert list(frames['timestamp']) == [7, 8]
+    assert list(frames['info']) == [0x14, 0x01]
+
+    assert list(calibrations.keys()) == [bs]
+    assert np.allclose(calibrations[bs]['sweep'][1], [1.1, 1.2, 1.3, 1.4, 1.5, 1.6, 1.7])
+    assert calibrations[bs]['uid'] == 1234
+
+    assert list(geometries.keys()) == [bs]
+    assert np.allclose(geometries[bs]['origin'], [1.0, 2.0, 3.0])
+    assert np.allclose(geometries[bs]['mat'], np.identity(3))
+
+    # The snapshots can be used to initialize the replay
+    LighthouseReplay(calibrations, geometries)
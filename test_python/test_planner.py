@@ -20,3 +20,92 @@ def test_takeoff():
     state = cffirmware.plan_current_goal(planner, duration)
     assert np.allclose(np.array([0, 0, targetHeight]), state.pos)
     assert np.allclose(np.array([0, 0, 0.0]), state.vel)
+
+
+def _make_waypoints(route):
+    waypoints = cffirmware.plan_waypoint_malloc(len(route))
+    for i, (x, y, z, yaw, duration) in enumerate(route):
+        wp = cffirmware.plan_waypoint_get(waypoints, i)
+        wp.pos = cffirmware.mkvec(x, y, z)
+        wp.yaw = yaw
+        wp.duration = duration
+    return waypoints
+
+
+def _hover_at(x, y, z):
+    ev = cffirmware.traj_eval_zero()
+    ev.pos = cffirmware.mkvec(x, y, z)
+    return ev
+
+
+def test_go_to_waypoints_passes_all_waypoints():
+    # Fixture
+    planner = cffirmware.planner()
+    cffirmware.plan_init(planner)
+    route = [(1, 0, 1, 0, 2), (1, 1, 1, 0, 1.5), (0, 1, 1.5, 0.5, 2)]
+    waypoints = _make_waypoints(route)
+
+    # Test
+    result = cffirmware.plan_go_to_waypoints_from(planner, _hover_at(0, 0, 1), False, waypoints, len(route), 0, 0)
+
+    # Assert
+    assert result == 0
+    t = 0
+    for x, y, z, yaw, duration in route:
+        t += duration
+        state = cffirmware.plan_current_goal(planner, t)
+        assert np.allclose(np.array([x, y, z]), state.pos, atol=1e-4)
+        assert np.isclose(yaw, state.yaw, atol=1e-4)
+    assert np.allclose(np.zeros(3), state.vel, atol=1e-4)
+    cffirmware.plan_waypoint_free(waypoints)
+
+
+def test_go_to_waypoints_does_not_stop_at_intermediate_waypoints():
+    # Fixture
+    planner = cffirmware.planner()
+    cffirmware.plan_init(planner)
+    route = [(1, 0, 1, 0, 1), (2, 0, 1, 0, 1)]
+    waypoints = _make_waypoints(route)
+
+    # Test
+    cffirmware.plan_go_to_waypoints_from(planner, _hover_at(0, 0, 1), False, waypoints, len(route), 0, 0)
+
+    # Assert
+    state = cffirmware.plan_current_goal(planner, 1)
+    assert np.allclose(np.array([1, 0, 0]), state.vel, atol=1e-4)
+    cffirmware.plan_waypoint_free(waypoints)
+
+
+def test_go_to_waypoints_uses_the_velocity_limit_for_zero_durations():
+    # Fixture
+    planner = cffirmware.planner()
+    cffirmware.plan_init(planner)
+    route = [(2, 0, 1, 0, 0)]
+    waypoints = _make_waypoints(route)
+    max_velocity = 1.0
+
+    # Test
+    cffirmware.plan_go_to_waypoints_from(planner, _hover_at(0, 0, 1), False, waypoints, len(route), max_velocity, 0)
+
+    # Assert
+    duration = cffirmware.piecewise_get(planner.planned_trajectory, 0).duration
+    peak_velocity = max(np.linalg.norm(np.array(cffirmware.plan_current_goal(planner, t).vel))
+                        for t in np.linspace(0, duration, 101))
+    assert peak_velocity <= max_velocity + 1e-3
+    cffirmware.plan_waypoint_free(waypoints)
+
+
+def test_go_to_waypoints_rejects_too_many_waypoints():
+    # Fixture
+    planner = cffirmware.planner()
+    cffirmware.plan_init(planner)
+    route = [(i, 0, 1, 0, 1) for i in range(cffirmware.PLAN_MAX_WAYPOINTS + 1)]
+    waypoints = _make_waypoints(route)
+
+    # Test
+    result = cffirmware.plan_go_to_waypoints_from(planner, _hover_at(0, 0, 1), False, waypoints, len(route), 0, 0)
+
+    # Assert
+    assert result != 0
+    assert cffirmware.plan_is_stopped(planner)
+    cffirmware.plan_waypoint_free(waypoints)
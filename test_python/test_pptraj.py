@@ -28,3 +28,43 @@ def test_that_traj_eval_invalid_is_actually_invalid():
 
     # Assert
     assert not valid
+
+
+def test_that_poly4d_eval_matches_numpy_derivatives():
+    # Fixture
+    rng = np.random.default_rng(42)
+    coefs = rng.uniform(-1.0, 1.0, size=(4, 8))
+    poly = cffirmware.poly4d()
+    for dim in range(4):
+        for i in range(8):
+            cffirmware.poly4d_set(poly, dim, i, coefs[dim, i])
+    poly.duration = 2.0
+
+    for t in np.linspace(0.0, poly.duration, 21):
+        # Test
+        ev = cffirmware.poly4d_eval(poly, t)
+
+        # Assert
+        # numpy polynomials are highest order first, the firmware stores constant term first
+        xyz = [np.poly1d(coefs[dim][::-1]) for dim in range(3)]
+        expected = [[p.deriv(k)(t) if k > 0 else p(t) for p in xyz] for k in range(4)]
+        assert np.allclose(expected[0], ev.pos, atol=1e-4)
+        assert np.allclose(expected[1], ev.vel, atol=1e-4)
+        assert np.allclose(expected[2], ev.acc, atol=1e-3)
+        assert np.allclose(expected[3], ev.jerk, atol=1e-3)
+        assert np.isclose(np.poly1d(coefs[3][::-1])(t), ev.yaw, atol=1e-4)
+
+
+def test_poly4d_eval_benchmark():
+    # Fixture
+    iterations = 500
+    result = cffirmware.controllerBenchmarkResult_t()
+
+    # Test
+    cffirmware.controllerBenchmarkRunHost(cffirmware.ControllerBenchmarkPoly4dEval, iterations, result)
+    # Run with "pytest -s" to see the numbers
+    print('poly4d_eval min {:6d} avg {:8.1f} max {:6d} ns'.format(result.min, result.avg, result.max))
+
+    # Assert
+    assert result.count == iterations
+    assert result.min <= result.avg <= result.max
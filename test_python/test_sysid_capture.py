@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+
+import io
+import struct
+
+import pytest
+
+from tools.system_id.sysid_capture import HEADER_FORMAT, decode, write_csv
+
+
+def _make_capture(count, capacity=8):
+    data = struct.pack(HEADER_FORMAT, 1, 36, 1, 0, 2, 0x0f, 10, 20000, 1000, count, count, 5000.0, 1.0, 50.0)
+    for i in range(capacity):
+        if i < count:
+            data += struct.pack('<If4H3h3h4H', 100 + i, 0.5 * i, 20000 + i, 20001, 20002, 20003,
+                                1000, -2000, 3000, 10, -20, 1000, 5000 + i, 5001, 5002, 5003)
+        else:
+            data += bytes(36)
+    return data
+
+
+def test_decode_scales_the_samples():
+    # Fixture
+    data = _make_capture(3)
+
+    # Test
+    header, samples = decode(data)
+
+    # Assert
+    assert header['count'] == 3
+    assert header['amplitude'] == 5000.0
+    assert list(samples['time']) == [0, 1, 2]
+    assert list(samples['excitation']) == [0.0, 0.5, 1.0]
+    assert list(samples['pwm'][1]) == [20001, 20001, 20002, 20003]
+    assert list(samples['gyro'][0]) == pytest.approx([1.0, -2.0, 3.0])
+    assert list(samples['acc'][0]) == pytest.approx([0.01, -0.02, 1.0])
+    assert samples['rpm'][2][0] == 5002
+
+
+def test_decode_ignores_the_samples_after_the_count():
+    # Fixture
+    data = _make_capture(2)
+
+    # Test
+    _, samples = decode(data)
+
+    # Assert
+    assert len(samples['time']) == 2
+
+
+def test_decode_rejects_an_unknown_sample_size():
+    # Fixture
+    data = bytearray(_make_capture(1))
+    data[1] = 40
+
+    # Test
+    # Assert
+    with pytest.raises(ValueError):
+        decode(bytes(data))
+
+
+def test_write_csv_writes_one_line_per_sample():
+    # Fixture
+    _, samples = decode(_make_capture(4))
+    output = io.StringIO()
+
+    # Test
+    write_csv(samples, output)
+
+    # Assert
+    lines = output.getvalue().splitlines()
+    assert len(lines) == 5
+    assert lines[1].split(',')[2] == '20000'
@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+
+import numpy as np
+import cffirmware
+from bindings.util.tdoa_replay import TdoaReplay
+from bindings.util.tdoa_replay import make_anchor_positions
+from bindings.util.tdoa_replay import synthetic_packets
+
+ANCHOR_POSITIONS = make_anchor_positions({
+    0: (0.0, 0.0, 0.0), 1: (4.0, 0.0, 0.0), 2: (0.0, 4.0, 0.0), 3: (4.0, 4.0, 2.5), 4: (0.0, 0.0, 2.5),
+    5: (4.0, 0.0, 2.5)})
+TRUE_POSITION = (1.5, 2.5, 1.0)
+
+
+def test_tdoa_replay_with_no_packets():
+    # Fixture
+    replay = TdoaReplay(ANCHOR_POSITIONS)
+    packets = np.zeros(0, dtype=TdoaReplay.PACKET_DTYPE)
+
+    # Test
+    results, measurements, stats = replay.run(packets)
+
+    # Assert
+    assert len(results) == 0
+    assert len(measurements) == 0
+
+
+def test_that_synthetic_packets_give_accurate_measurements():
+    # Fixture
+    replay = TdoaReplay(ANCHOR_POSITIONS)
+    packets = synthetic_packets(ANCHOR_POSITIONS, TRUE_POSITION, duration=2.0)
+
+    # Test
+    results, measurements, stats = replay.run(packets)
+
+    # Assert
+    assert np.mean(results['result'] == cffirmware.tdoaReplayResultUsed) > 0.9
+    assert stats.rmsError < 0.05
+    assert stats.nsPerPacket > 0.0
+
+
+def test_that_all_matching_gives_more_measurements_per_packet():
+    # Fixture
+    packets = synthetic_packets(ANCHOR_POSITIONS, TRUE_POSITION, duration=2.0)
+
+    # Test
+    _, random_measurements, _ = TdoaReplay(ANCHOR_POSITIONS, matching='random').run(packets)
+    _, all_measurements, _ = TdoaReplay(ANCHOR_POSITIONS, matching='all').run(packets)
+
+    # Assert
+    assert len(all_measurements) > 2 * len(random_measurements)
+
+
+def test_that_the_first_packet_from_an_anchor_is_rejected_for_clock_correction():
+    # Fixture
+    replay = TdoaReplay(ANCHOR_POSITIONS)
+    packets = synthetic_packets(ANCHOR_POSITIONS, TRUE_POSITION, duration=0.1)
+
+    # Test
+    results, _, _ = replay.run(packets)
+
+    # Assert
+    assert np.all(results['result'][:len(ANCHOR_POSITIONS)] == cffirmware.tdoaReplayResultClockCorrection)
+
+
+def test_that_packets_are_rejected_when_anchor_positions_are_unknown():
+    # Fixture
+    replay = TdoaReplay({})
+    packets = synthetic_packets(ANCHOR_POSITIONS, TRUE_POSITION, duration=1.0)
+
+    # Test
+    results, measurements, _ = replay.run(packets)
+
+    # Assert
+    assert len(measurements) == 0
+    assert np.mean(results['result'] == cffirmware.tdoaReplayResultNoPosition) > 0.9
@@ -0,0 +1,158 @@
+#!/usr/bin/env python
+
+import struct
+from zlib import crc32
+
+import numpy as np
+import pytest
+
+import tools.usdlog.cfusdlog as cfusdlog
+from tools.usdlog.cfusdlog_columnar import UsdLog
+
+EVENT_TYPES = [
+    (1, 'fixedFrequency', [('acc.x', 'f'), ('acc.y', 'f'), ('range.zrange', 'H'), ('motor.m1', 'h')]),
+    (7, 'estTDOA', [('idA', 'B'), ('idB', 'B'), ('distanceDiff', 'f')]),
+    (9, 'unused', [('value', 'i')]),
+]
+
+
+def _varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def _zigzag_delta(current, last, size):
+    # As zigzagDelta() in usddeck.c
+    bits = 8 * size
+    delta = (int.from_bytes(current, 'little') - int.from_bytes(last, 'little')) % (1 << bits)
+    if delta >= 1 << (bits - 1):
+        delta -= 1 << bits
+    return delta << 1 if delta >= 0 else ((-delta) << 1) - 1
+
+
+def _make_events():
+    events = []
+    t = 1000000
+    for i in range(300):
+        t += 1000 + (i % 7)
+        values = (0.01 * i, -2.5 + 0.1 * (i % 13), (65530 + i) % 65536, (i * 911) % 65536 - 32768)
+        events.append((0, t, values))
+        if i % 3 == 0:
+            events.append((1, t + 3, (i % 8, (i + 1) % 8, -0.3 * i)))
+    return events
+
+
+def _write_log(path, version, keyframe_interval=10):
+    data = bytearray(struct.pack('<BHH', 0xBC, version, len(EVENT_TYPES)))
+    for event_id, name, variables in EVENT_TYPES:
+        data += struct.pack('<H', event_id) + name.encode() + b'\0'
+        data += struct.pack('<H', len(variables))
+        for var, type_char in variables:
+            data += '{}({})'.format(var, type_char).encode() + b'\0'
+
+    last = {}
+    since_keyframe = {}
+    for index, timestamp, values in _make_events():
+        event_id, _, variables = EVENT_TYPES[index]
+        fmt = '<' + ''.join(c for _, c in variables)
+        raw = struct.pack(fmt, *values)
+        if version == 2:
+            data += struct.pack('<HQ', event_id, timestamp) + raw
+            continue
+
+        count = since_keyframe.get(index, 0)
+        if count == 0:
+            data += _varint((index << 1) | 1) + struct.pack('<Q', timestamp) + raw
+        else:
+            last_timestamp, last_raw = last[index]
+            data += _varint(index << 1) + _varint(timestamp - last_timestamp)
+            offset = 0
+            for _, type_char in variables:
+                size = struct.calcsize('<' + type_char)
+                data += _varint(_zigzag_delta(raw[offset:offset + size], last_raw[offset:offset + size], size))
+                offset += size
+        last[index] = (timestamp, raw)
+        since_keyframe[index] = (count + 1) % keyframe_interval
+
+    data += struct.pack('<I', crc32(data))
+    path.write_bytes(bytes(data))
+    return str(path)
+
+
+@pytest.mark.parametrize('version', [2, 3])
+def test_columnar_decode_matches_decode(tmp_path, version):
+    # Fixture
+    filename = _write_log(tmp_path / 'log00', version)
+    expected = cfusdlog.decode(filename)
+
+    # Test
+    with UsdLog(filename, use_numba=False) as log:
+        actual = log.to_dict()
+
+    # Assert
+    assert sorted(expected.keys()) == sorted(actual.keys())
+    assert 'unused' not in actual
+    for name in expected:
+        assert sorted(expected[name].keys()) == sorted(actual[name].keys())
+        for var in expected[name]:
+            assert np.array_equal(expected[name][var], actual[name][var]), (name, var)
+
+
+def test_columnar_decode_counts_and_parquet_columns(tmp_path):
+    # Fixture
+    filename = _write_log(tmp_path / 'log00', 3)
+
+    # Test
+    with UsdLog(filename, use_numba=False) as log:
+        count = log.count('fixedFrequency')
+        columns = log.parquet_columns('fixedFrequency')
+
+    # Assert
+    assert log.crc_ok
+    assert count == 300
+    assert columns['timestamp_us'].dtype == np.int64
+    assert columns['timestamp_us'][0] == 1001000
+    assert np.all(np.diff(columns['timestamp_us']) > 0)
+    assert 'acc_x' in columns
+    assert columns['motor_m1'].dtype == np.int16
+    assert columns['acc_x'].flags['C_CONTIGUOUS']
+
+
+def test_columnar_decode_stops_at_a_truncated_record(tmp_path):
+    # Fixture
+    filename = _write_log(tmp_path / 'log00', 2)
+    with open(filename, 'rb') as f:
+        data = f.read()
+    truncated = tmp_path / 'truncated'
+    # Remove part of the last record, keep a (now wrong) crc at the end
+    truncated.write_bytes(data[:-10] + data[-4:])
+
+    # Test
+    with UsdLog(str(truncated), use_numba=False) as log:
+        actual = log.count('fixedFrequency') + log.count('estTDOA')
+
+    # Assert
+    assert not log.crc_ok
+    assert actual == len(_make_events()) - 1
+
+
+def test_compiled_decode_matches_python_decode(tmp_path):
+    pytest.importorskip('numba')
+
+    # Fixture
+    filename = _write_log(tmp_path / 'log00', 3)
+    with UsdLog(filename, use_numba=False) as log:
+        expected = log.to_dict()
+
+    # Test
+    with UsdLog(filename, use_numba=True) as log:
+        actual = log.to_dict()
+
+    # Assert
+    for name in expected:
+        for var in expected[name]:
+            assert np.array_equal(expected[name][var], actual[name][var]), (name, var)
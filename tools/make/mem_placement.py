@@ -0,0 +1,184 @@
+#!/usr/bin/env python
+
+import argparse
+import collections
+import os
+import subprocess
+
+# Prints where the statically allocated data ends up (RAM or CCM), per symbol
+# and per module, together with the object files that reference each symbol.
+# Used to find hot data that should move to CCM and DMA buffers that must not.
+
+RAM_START = 0x20000000
+RAM_SIZE = 128 * 1024
+CCM_START = 0x10000000
+CCM_SIZE = 64 * 1024
+
+DATA_SECTIONS = ['.data', '.bss', '.nzds', '.ccmbss', '.ccmdata']
+
+
+def check_output(*args):
+    """A wrapper for subprocess.check_output() to handle differences in python 2 and 3.
+    Returns a string.
+    """
+    result = subprocess.check_output(*args)
+
+    if isinstance(result, bytes):
+        return result.decode('utf-8')
+    else:
+        return result
+
+
+def region_of(address):
+    if CCM_START <= address < CCM_START + CCM_SIZE:
+        return 'CCM'
+    if RAM_START <= address < RAM_START + RAM_SIZE:
+        return 'RAM'
+    return None
+
+
+def read_sections(size_app, elf):
+    """Returns a list of (name, start, size) for the data sections"""
+    sections = []
+    for line in check_output([size_app, '-A', elf]).splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[0] in DATA_SECTIONS:
+            sections.append((parts[0], int(parts[2]), int(parts[1])))
+    return sections
+
+
+def section_of(sections, address):
+    for name, start, size in sections:
+        if start <= address < start + size:
+            return name
+    return '?'
+
+
+def read_symbols(nm_app, elf, sections, srctree):
+    """Returns a list of dicts with the data symbols in RAM and CCM"""
+    symbols = []
+    output = check_output([nm_app, '--print-size', '--size-sort', '--line-numbers', elf])
+    for line in output.splitlines():
+        location = ''
+        if '\t' in line:
+            line, location = line.split('\t', 1)
+        parts = line.split()
+        if len(parts) != 4 or parts[2] not in 'bBdD':
+            continue
+
+        address = int(parts[0], 16)
+        region = region_of(address)
+        if region is None:
+            continue
+
+        owner = location.rsplit(':', 1)[0]
+        if owner and srctree:
+            owner = os.path.relpath(owner, srctree)
+
+        symbols.append({
+            'name': parts[3],
+            'size': int(parts[1], 16),
+            'global': parts[2].isupper(),
+            'region': region,
+            'section': section_of(sections, address),
+            'owner': owner,
+        })
+    return symbols
+
+
+def read_references(nm_app, objects_dir):
+    """Returns a dict from global symbol to the object files that use it"""
+    objects = []
+    for root, _, files in os.walk(objects_dir):
+        for name in files:
+            if name.endswith('.o') and name != 'built-in.o':
+                objects.append(os.path.join(root, name))
+
+    references = collections.defaultdict(list)
+    # Limit the command line length
+    for i in range(0, len(objects), 200):
+        output = check_output([nm_app, '--print-file-name', '--undefined-only'] + objects[i:i + 200])
+        for line in output.splitlines():
+            path, _, rest = line.partition(':')
+            parts = rest.split()
+            if len(parts) == 2 and parts[0] == 'U':
+                references[parts[1]].append(os.path.relpath(path, objects_dir))
+    return references
+
+
+def consumers_of(symbol, references):
+    result = []
+    if symbol['owner']:
+        result.append(os.path.basename(symbol['owner']))
+    if symbol['global']:
+        for path in references.get(symbol['name'], []):
+            name = os.path.basename(path).replace('.o', '.c')
+            if name not in result:
+                result.append(name)
+    return result
+
+
+def print_regions(sections):
+    totals = collections.defaultdict(int)
+    for name, start, size in sections:
+        totals[region_of(start)] += size
+
+    for region, available in (('RAM', RAM_SIZE), ('CCM', CCM_SIZE)):
+        used = totals[region]
+        in_region = ', '.join('{}: {}'.format(name, size) for name, start, size in sections if region_of(start) == region)
+        print('{:3} | {:7d}/{:<7d} ({:2.0f}%) | {}'.format(region, used, available, 100.0 * used / available, in_region))
+
+
+def print_modules(symbols, count):
+    per_module = collections.defaultdict(lambda: {'RAM': 0, 'CCM': 0})
+    for symbol in symbols:
+        per_module[symbol['owner'] or '?'][symbol['region']] += symbol['size']
+
+    print('')
+    print('{:>7} {:>7}  Module'.format('RAM', 'CCM'))
+    modules = sorted(per_module.items(), key=lambda item: item[1]['RAM'] + item[1]['CCM'], reverse=True)
+    for owner, sizes in modules[:count]:
+        print('{:7d} {:7d}  {}'.format(sizes['RAM'], sizes['CCM'], owner))
+
+
+def print_symbols(symbols, references, count, region, csv):
+    selected = [s for s in symbols if region is None or s['region'] == region]
+    selected.sort(key=lambda s: s['size'], reverse=True)
+    if count:
+        selected = selected[:count]
+
+    if csv:
+        print('region,section,size,symbol,owner,consumers')
+        for s in selected:
+            print('{},{},{},{},{},{}'.format(s['region'], s['section'], s['size'], s['name'], s['owner'],
+                                             ' '.join(consumers_of(s, references))))
+        return
+
+    print('')
+    print('{:3} {:8} {:>7}  {:40} {}'.format('Mem', 'Section', 'Size', 'Symbol', 'Consumers'))
+    for s in selected:
+        print('{:3} {:8} {:7d}  {:40} {}'.format(s['region'], s['section'], s['size'], s['name'],
+                                                 ', '.join(consumers_of(s, references))))
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("nm_app", help="path to the nm program")
+    parser.add_argument("size_app", help="path to the size program")
+    parser.add_argument("source", help=".elf file to use")
+    parser.add_argument("--objects", help="build directory, scanned for object files to find the consumers of global symbols")
+    parser.add_argument("--srctree", help="source tree, owner paths are printed relative to it")
+    parser.add_argument("--region", choices=['RAM', 'CCM'], help="only list symbols in this memory")
+    parser.add_argument("--count", type=int, default=50, help="number of symbols and modules to list, 0 for all symbols")
+    parser.add_argument("--csv", action="store_true", help="print all listed symbols as csv, without the summaries")
+    args = parser.parse_args()
+
+    sections = read_sections(args.size_app, args.source)
+    symbols = read_symbols(args.nm_app, args.source, sections, args.srctree)
+    references = read_references(args.nm_app, args.objects) if args.objects else {}
+
+    if not args.csv:
+        print_regions(sections)
+        print_modules(symbols, args.count if args.count else len(symbols))
+    print_symbols(symbols, references, args.count, args.region, args.csv)
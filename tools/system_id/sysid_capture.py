@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+Decode a system identification capture, a dump of the MEM_TYPE_SYSID memory
+(see docs/functional-areas/memory-subsystem/MEM_TYPE_SYSID.md), to a csv file
+"""
+import argparse
+import struct
+
+import numpy as np
+
+HEADER_FORMAT = '<BBBBBBHHHIIfff'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+HEADER_FIELDS = ['version', 'sample_size', 'signal', 'target', 'state', 'motor_mask', 'prbs_ms', 'base',
+                 'rate_hz', 'duration_ms', 'count', 'amplitude', 'f0', 'f1']
+
+SAMPLE_DTYPE = np.dtype([
+    ('step', '<u4'),
+    ('excitation', '<f4'),
+    ('pwm', '<u2', 4),
+    ('gyro', '<i2', 3),
+    ('acc', '<i2', 3),
+    ('rpm', '<u2', 4),
+])
+
+SIGNALS = ['step', 'chirp', 'prbs']
+TARGETS = ['motors', 'roll', 'pitch', 'yaw', 'thrust']
+STATES = ['idle', 'running', 'done', 'aborted']
+
+
+def decode(data):
+    """
+    Decode a capture
+
+    Returns the header as a dict and the samples as a dict of numpy arrays: time [ms] since the first sample,
+    excitation, pwm (n x 4), gyro [rad/s] (n x 3), acc [G] (n x 3) and rpm (n x 4)
+    """
+    if len(data) < HEADER_SIZE:
+        raise ValueError('Too short for a capture header')
+    header = dict(zip(HEADER_FIELDS, struct.unpack_from(HEADER_FORMAT, data)))
+    if header['version'] != 1 or header['sample_size'] != SAMPLE_DTYPE.itemsize:
+        raise ValueError('Unsupported capture version {} or sample size {}'.format(
+            header['version'], header['sample_size']))
+
+    available = (len(data) - HEADER_SIZE) // SAMPLE_DTYPE.itemsize
+    count = min(header['count'], available)
+    raw = np.frombuffer(data, dtype=SAMPLE_DTYPE, count=count, offset=HEADER_SIZE)
+
+    steps = raw['step'].astype(np.int64)
+    samples = {
+        'time': (steps - steps[0]) * 1000 // header['rate_hz'] if count > 0 else steps,
+        'excitation': raw['excitation'].astype(np.float64),
+        'pwm': raw['pwm'].astype(np.int64),
+        'gyro': raw['gyro'] / 1000.0,
+        'acc': raw['acc'] / 1000.0,
+        'rpm': raw['rpm'].astype(np.int64),
+    }
+    return header, samples
+
+
+def write_csv(samples, file):
+    file.write('time[ms],excitation,pwm1,pwm2,pwm3,pwm4,gyroX[rad/s],gyroY[rad/s],gyroZ[rad/s],'
+               'accX[G],accY[G],accZ[G],rpm1,rpm2,rpm3,rpm4\n')
+    for i in range(len(samples['time'])):
+        values = [samples['time'][i], samples['excitation'][i]]
+        values += list(samples['pwm'][i]) + list(samples['gyro'][i]) + list(samples['acc'][i])
+        values += list(samples['rpm'][i])
+        file.write(','.join(str(v) for v in values) + '\n')
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Decode a MEM_TYPE_SYSID capture to csv')
+    parser.add_argument('capture', help='binary dump of the MEM_TYPE_SYSID memory')
+    parser.add_argument('output', nargs='?', default='data.csv', help='csv file to write')
+    args = parser.parse_args()
+
+    with open(args.capture, 'rb') as f:
+        header, samples = decode(f.read())
+
+    print('{} samples, {} on {}, amplitude {}, {}'.format(
+        header['count'], SIGNALS[header['signal']] if header['signal'] < len(SIGNALS) else header['signal'],
+        TARGETS[header['target']] if header['target'] < len(TARGETS) else header['target'],
+        header['amplitude'], STATES[header['state']] if header['state'] < len(STATES) else header['state']))
+
+    with open(args.output, 'w') as f:
+        write_csv(samples, f)
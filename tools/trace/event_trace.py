@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+# Converts a binary event trace (see docs/development/event_trace.md) to the Chrome trace event format, to be opened
+# in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+#
+# The input is either a dump of the MEM_TYPE_EVENT_TRACE memory or a raw capture of the RTT stream.
+import argparse
+import json
+import struct
+import sys
+
+EVENT_SIZE = 8
+HEADER_FORMAT = '<BBBBIII'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+TASK_SWITCH = 1
+ISR_ENTER = 2
+ISR_EXIT = 3
+QUEUE_SEND = 4
+QUEUE_RECEIVE = 5
+QUEUE_BLOCK_SEND = 6
+QUEUE_BLOCK_RECEIVE = 7
+MARKER = 8
+TASK_NAME = 9
+
+QUEUE_EVENTS = {
+    QUEUE_SEND: 'send',
+    QUEUE_RECEIVE: 'receive',
+    QUEUE_BLOCK_SEND: 'block on send',
+    QUEUE_BLOCK_RECEIVE: 'block on receive',
+}
+
+MARKERS = {
+    1: 'stabilizer loop',
+    2: 'stabilizer stage',
+}
+
+# Cortex-M exception numbers, external interrupts start at 16
+EXCEPTIONS = {
+    11: 'SVCall',
+    14: 'PendSV',
+    15: 'SysTick',
+}
+
+PID = 1
+TASKS_TID = 1
+ISR_TID = 2
+MARKERS_TID = 3
+
+
+def parse_events(data):
+    events = []
+    for offset in range(0, len(data) - EVENT_SIZE + 1, EVENT_SIZE):
+        events.append(struct.unpack_from('<IBBH', data, offset))
+    return events
+
+
+def read_mem_dump(data):
+    version, event_size, name_count, name_length, capacity, head, cpu_hz = struct.unpack_from(HEADER_FORMAT, data)
+    if version != 1 or event_size != EVENT_SIZE:
+        raise ValueError('Unsupported trace version {} or event size {}'.format(version, event_size))
+
+    names = {}
+    offset = HEADER_SIZE
+    for i in range(name_count):
+        name = data[offset:offset + name_length].split(b'\0')[0].decode(errors='replace')
+        if name:
+            names[i] = name
+        offset += name_length
+
+    ring = parse_events(data[offset:offset + capacity * EVENT_SIZE])
+    if head > capacity:
+        # The oldest event is the one that will be overwritten next
+        start = head % capacity
+        ring = ring[start:] + ring[:start]
+    else:
+        ring = ring[:head]
+
+    return ring, names, cpu_hz
+
+
+def collect_names(events, names, name_count):
+    # Names from TASK_NAME events, two characters per event
+    partial = {}
+    for _, type, id, arg in events:
+        if type == TASK_NAME:
+            partial.setdefault(id, b'')
+            partial[id] += struct.pack('<H', arg)
+    for id, chars in partial.items():
+        names[id] = chars.split(b'\0')[0].decode(errors='replace')
+
+    def name_of(task):
+        if task in names:
+            return names[task]
+        if name_count and task % name_count in names:
+            return names[task % name_count]
+        return 'task {}'.format(task)
+
+    return name_of
+
+
+def isr_name(number):
+    if number in EXCEPTIONS:
+        return EXCEPTIONS[number]
+    if number >= 16:
+        return 'IRQ {}'.format(number - 16)
+    return 'exception {}'.format(number)
+
+
+def convert(events, name_of, cpu_hz):
+    trace = []
+
+    def meta(tid, name):
+        trace.append({'ph': 'M', 'pid': PID, 'tid': tid, 'name': 'thread_name', 'args': {'name': name}})
+
+    meta(TASKS_TID, 'Tasks')
+    meta(ISR_TID, 'Interrupts')
+    meta(MARKERS_TID, 'Markers')
+
+    # Unwrap the 32 bit cycle counter, events are recorded in order
+    time = 0
+    previous = None
+    current_task = None
+    task_start = 0
+    isr_stack = []
+
+    for timestamp, type, id, arg in events:
+        if previous is not None:
+            time += (timestamp - previous) & 0xffffffff
+        previous = timestamp
+        us = time * 1e6 / cpu_hz
+
+        if type == TASK_SWITCH:
+            if current_task is not None:
+                trace.append({'ph': 'X', 'pid': PID, 'tid': TASKS_TID, 'name': name_of(current_task),
+                              'ts': task_start, 'dur': us - task_start})
+            current_task = id
+            task_start = us
+        elif type == ISR_ENTER:
+            isr_stack.append((id, us))
+        elif type == ISR_EXIT:
+            if isr_stack and isr_stack[-1][0] == id:
+                _, start = isr_stack.pop()
+                trace.append({'ph': 'X', 'pid': PID, 'tid': ISR_TID, 'name': isr_name(id),
+                              'ts': start, 'dur': us - start})
+        elif type in QUEUE_EVENTS:
+            trace.append({'ph': 'i', 's': 't', 'pid': PID, 'tid': TASKS_TID, 'name': QUEUE_EVENTS[type],
+                          'ts': us, 'args': {'queue': '0x{:04x}'.format(arg)}})
+        elif type == MARKER:
+            trace.append({'ph': 'i', 's': 't', 'pid': PID, 'tid': MARKERS_TID,
+                          'name': MARKERS.get(id, 'marker {}'.format(id)), 'ts': us, 'args': {'value': arg}})
+
+    return {'traceEvents': trace, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a binary event trace to the Chrome trace event format')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--mem', metavar='FILE', help='dump of the MEM_TYPE_EVENT_TRACE memory')
+    source.add_argument('--rtt', metavar='FILE', help='raw capture of RTT channel 1')
+    parser.add_argument('--cpu-hz', type=int, default=168000000,
+                        help='frequency of the cycle counter for RTT captures (default 168000000)')
+    parser.add_argument('output', help='JSON file to write')
+    args = parser.parse_args()
+
+    name_count = 0
+    if args.mem:
+        with open(args.mem, 'rb') as f:
+            data = f.read()
+        events, names, cpu_hz = read_mem_dump(data)
+        name_count = struct.unpack_from(HEADER_FORMAT, data)[2]
+    else:
+        with open(args.rtt, 'rb') as f:
+            events = parse_events(f.read())
+        names = {}
+        cpu_hz = args.cpu_hz
+
+    name_of = collect_names(events, names, name_count)
+    with open(args.output, 'w') as f:
+        json.dump(convert(events, name_of, cpu_hz), f)
+
+    print('Converted {} events'.format(len(events)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
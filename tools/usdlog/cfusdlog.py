@@ -14,6 +14,21 @@ def _get_name(data, idx):
         endIdx = endIdx + 1
     return data[idx:endIdx].decode("utf-8"), endIdx + 1
 
+# decode unsigned LEB128 varint
+def _get_varint(data, idx):
+    value = 0
+    shift = 0
+    while True:
+        b = data[idx]
+        idx += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if b < 0x80:
+            return value, idx
+
+def _unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
 def decode(filename):
     # read file as binary
     with open(filename, 'rb') as f:
@@ -32,12 +47,13 @@ def decode(filename):
 
     # check version
     version, num_event_types = struct.unpack('HH', data[1:5])
-    if version != 1 and version != 2:
+    if version not in (1, 2, 3):
         print("Unsupported version!", version)
         return
 
     result = dict()
     event_by_id = dict()
+    event_list = []
 
     # read header with data types
     idx = 5
@@ -62,10 +78,42 @@ def decode(filename):
             'name': event_name,
             'fmtStr': fmtStr,
             'numBytes': struct.calcsize(fmtStr),
+            'sizes': [struct.calcsize('<' + c) for c in fmtStr[1:]],
             'variables': variables,
+            'last': None,
             }
+        event_list.append(event_by_id[event_id])
 
     while idx < len(data) - 4:
+        if version == 3:
+            # compressed: keyframes are raw, other events are deltas to the
+            # previous event of the same type
+            tag, idx = _get_varint(data, idx)
+            event = event_list[tag >> 1]
+            if tag & 1:
+                timestamp, = struct.unpack('<Q', data[idx:idx+8])
+                idx += 8
+                raw = data[idx:idx+event['numBytes']]
+                idx += event['numBytes']
+            else:
+                last_timestamp, last_raw = event['last']
+                delta, idx = _get_varint(data, idx)
+                timestamp = last_timestamp + delta
+                raw = bytearray()
+                offset = 0
+                for size in event['sizes']:
+                    last_value = int.from_bytes(last_raw[offset:offset+size], 'little')
+                    delta, idx = _get_varint(data, idx)
+                    value = (last_value + _unzigzag(delta)) % (1 << (8 * size))
+                    raw += value.to_bytes(size, 'little')
+                    offset += size
+            event['last'] = (timestamp, raw)
+            eventData = struct.unpack(event['fmtStr'], raw)
+            for v,d in zip(event['variables'], eventData):
+                result[event['name']][v].append(d)
+            result[event['name']]["timestamp"].append(timestamp / 1000.0)
+            continue
+
         if version == 1:
             event_id, timestamp, = struct.unpack('<HI', data[idx:idx+6])
             idx += 6
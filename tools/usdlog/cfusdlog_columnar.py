@@ -0,0 +1,441 @@
+# -*- coding: utf-8 -*-
+"""
+Columnar decoder for binary logs from the crazyflie2 uSD-Card-Deck
+
+The file is memory mapped and the event records are indexed in one pass, each event type is then materialized as numpy
+columns. The records of the uncompressed formats (version 1 and 2) are copied straight from the file, the compressed
+format (version 3) is decoded into the same layout. The result of to_dict() is the same as from cfusdlog.decode(), but
+large logs are decoded in a fraction of the time and memory.
+
+The scan over the records is compiled with numba when it is installed, it falls back to plain python otherwise.
+
+Usage:
+    python3 cfusdlog_columnar.py log00 [--parquet output_dir]
+"""
+import argparse
+import mmap
+import os
+import struct
+from zlib import crc32
+
+import numpy as np
+
+try:
+    import numba
+except ImportError:
+    numba = None
+
+MAGIC = 0xBC
+SUPPORTED_VERSIONS = (1, 2, 3)
+
+# Size of the record header (event id and timestamp) in the uncompressed formats
+_FIXED_HEADER = {
+    1: [('id', '<u2'), ('timestamp', '<u4')],
+    2: [('id', '<u2'), ('timestamp', '<u8')],
+}
+
+# Max number of records gathered at a time, limits the size of the index arrays
+_GATHER_CHUNK = 1 << 20
+
+
+def _make_scanners(jit):
+    """Returns the scan functions, compiled with jit"""
+
+    @jit
+    def read_varint(data, idx):
+        value = 0
+        shift = 0
+        while True:
+            b = data[idx]
+            idx += 1
+            value |= (b & 0x7F) << shift
+            shift += 7
+            if b < 0x80:
+                return value, idx
+
+    @jit
+    def scan_fixed(data, start, end, type_of_id, record_size, types_out, offsets_out):
+        # Index of the records of version 1 and 2, stops at the first unknown or truncated record
+        n = 0
+        idx = start
+        while idx + 2 <= end:
+            t = type_of_id[data[idx] | (data[idx + 1] << 8)]
+            if t < 0 or idx + record_size[t] > end:
+                break
+            types_out[n] = t
+            offsets_out[n] = idx
+            n += 1
+            idx += record_size[t]
+        return n
+
+    @jit
+    def count_compressed(data, start, end, payload_size, num_fields, counts):
+        # Number of records per event type of version 3, returns where the last complete record ends
+        idx = start
+        stop = start
+        n_types = len(counts)
+        while idx < end:
+            tag, idx = read_varint(data, idx)
+            t = tag >> 1
+            if t >= n_types:
+                break
+            if tag & 1:
+                idx += 8 + payload_size[t]
+            else:
+                if counts[t] == 0:
+                    # A delta without a keyframe to start from
+                    break
+                _, idx = read_varint(data, idx)
+                for _f in range(num_fields[t]):
+                    _, idx = read_varint(data, idx)
+            if idx > end:
+                break
+            counts[t] += 1
+            stop = idx
+        return stop
+
+    @jit
+    def decode_compressed(data, start, stop, payload_size, field_sizes, num_fields, ts_base, raw_base, timestamps,
+                          raw, counts):
+        # Decodes the records of version 3 in [start, stop) into the timestamp and raw arrays. The records of type t
+        # are stored from ts_base[t] and raw_base[t], a delta is applied to the previous record of the same type.
+        idx = start
+        while idx < stop:
+            tag, idx = read_varint(data, idx)
+            t = tag >> 1
+            k = counts[t]
+            size = payload_size[t]
+            ts_pos = ts_base[t] + k
+            raw_pos = raw_base[t] + k * size
+
+            if tag & 1:
+                ts = 0
+                for i in range(8):
+                    ts |= data[idx + i] << (8 * i)
+                idx += 8
+                timestamps[ts_pos] = ts
+                for i in range(size):
+                    raw[raw_pos + i] = data[idx + i]
+                idx += size
+            else:
+                delta, idx = read_varint(data, idx)
+                timestamps[ts_pos] = timestamps[ts_pos - 1] + delta
+
+                last_pos = raw_pos - size
+                offset = 0
+                for f in range(num_fields[t]):
+                    field_size = field_sizes[t, f]
+                    last = 0
+                    for i in range(field_size):
+                        last |= raw[last_pos + offset + i] << (8 * i)
+                    zigzag, idx = read_varint(data, idx)
+                    diff = (zigzag >> 1) ^ -(zigzag & 1)
+                    value = (last + diff) & ((1 << (8 * field_size)) - 1)
+                    for i in range(field_size):
+                        raw[raw_pos + offset + i] = (value >> (8 * i)) & 0xFF
+                    offset += field_size
+            counts[t] = k + 1
+
+    return scan_fixed, count_compressed, decode_compressed
+
+
+_scan_fixed, _count_compressed, _decode_compressed = _make_scanners(lambda f: f)
+_compiled = None
+
+
+def _scanners(use_numba):
+    global _compiled
+    if not use_numba:
+        return _scan_fixed, _count_compressed, _decode_compressed
+    if _compiled is None:
+        _compiled = _make_scanners(numba.njit)
+    return _compiled
+
+
+class EventType:
+    """The layout of one event type, from the header of the file"""
+
+    def __init__(self, index, event_id, name, variables, type_chars):
+        self.index = index
+        self.id = event_id
+        self.name = name
+        self.variables = variables
+        self.fields = [(var, '<' + c) for var, c in zip(variables, type_chars)]
+        self.dtype = np.dtype(self.fields)
+        self.field_sizes = [struct.calcsize('<' + c) for c in type_chars]
+        self.payload_size = self.dtype.itemsize
+
+
+class UsdLog:
+    """
+    A memory mapped log file from the uSD-card deck
+
+    Args:
+        filename: The log file
+        use_numba: Compile the scan with numba, None to use numba if it is installed
+        check_crc: Verify the CRC of the file, prints a warning if it does not match
+    """
+
+    def __init__(self, filename, use_numba=None, check_crc=True):
+        if use_numba is None:
+            use_numba = numba is not None
+        elif use_numba and numba is None:
+            raise ImportError('numba is not installed')
+        self.use_numba = use_numba
+
+        self._file = open(filename, 'rb')
+        size = os.fstat(self._file.fileno()).st_size
+        if size < 9:
+            self._file.close()
+            raise ValueError('Not a uSD log, the file is too short')
+        self._mmap = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        self._buffer = np.frombuffer(self._mmap, dtype=np.uint8)
+
+        if self._buffer[0] != MAGIC:
+            self.close()
+            raise ValueError('Unsupported format!')
+
+        self.crc_ok = None
+        if check_crc:
+            expected_crc, = struct.unpack('<I', self._mmap[-4:])
+            self.crc_ok = crc32(memoryview(self._mmap)[:-4]) == expected_crc
+            if not self.crc_ok:
+                print("WARNING: CRC does not match!")
+
+        self.version, num_event_types = struct.unpack('<HH', self._mmap[1:5])
+        if self.version not in SUPPORTED_VERSIONS:
+            self.close()
+            raise ValueError('Unsupported version! {}'.format(self.version))
+
+        self.event_types = {}
+        self._event_list = []
+        idx = self._read_header(num_event_types)
+        self._data_start = idx
+        self._data_end = len(self._buffer) - 4
+
+        self._columns = {}
+        self._index()
+
+    def close(self):
+        """Release the memory map, the arrays returned by records() may refer to it"""
+        self._buffer = None
+        if self._mmap is not None:
+            try:
+                self._mmap.close()
+            except BufferError:
+                # Still referenced by a numpy view, released when the view is
+                pass
+            self._mmap = None
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _get_name(self, idx):
+        end_idx = self._mmap.find(b'\0', idx)
+        return self._mmap[idx:end_idx].decode('utf-8'), end_idx + 1
+
+    def _read_header(self, num_event_types):
+        idx = 5
+        for index in range(num_event_types):
+            event_id, = struct.unpack('<H', self._mmap[idx:idx + 2])
+            idx += 2
+            name, idx = self._get_name(idx)
+            num_variables, = struct.unpack('<H', self._mmap[idx:idx + 2])
+            idx += 2
+            variables = []
+            type_chars = []
+            for _ in range(num_variables):
+                var_name_and_type, idx = self._get_name(idx)
+                variables.append(var_name_and_type[0:-3])
+                type_chars.append(var_name_and_type[-2])
+            event = EventType(index, event_id, name, variables, type_chars)
+            self.event_types[name] = event
+            self._event_list.append(event)
+        return idx
+
+    def _index(self):
+        scan_fixed, count_compressed, decode_compressed = _scanners(self.use_numba)
+        # The compiled scan works on numpy arrays, plain python is faster on the mmap itself, where indexing gives
+        # python ints
+        data = self._buffer if self.use_numba else self._mmap
+        if self.version == 3:
+            self._index_compressed(data, count_compressed, decode_compressed)
+        else:
+            self._index_fixed(data, scan_fixed)
+
+    def _index_fixed(self, data, scan_fixed):
+        header = _FIXED_HEADER[self.version]
+        header_size = np.dtype(header).itemsize
+        self._record_dtypes = [np.dtype(header + event.fields) for event in self._event_list]
+
+        type_of_id = np.full(1 << 16, -1, dtype=np.int32)
+        record_size = np.zeros(max(len(self._event_list), 1), dtype=np.int64)
+        for event in self._event_list:
+            type_of_id[event.id] = event.index
+            record_size[event.index] = header_size + event.payload_size
+
+        min_size = int(record_size.min()) if len(self._event_list) > 0 else header_size
+        capacity = (self._data_end - self._data_start) // max(min_size, 1) + 1
+        types = np.empty(capacity, dtype=np.int16)
+        offsets = np.empty(capacity, dtype=np.int64)
+        n = scan_fixed(data, self._data_start, self._data_end, type_of_id, record_size, types, offsets)
+        types = types[:n]
+        offsets = offsets[:n]
+
+        # Stable grouping on type keeps the records of each type in file order
+        order = np.argsort(types, kind='stable')
+        counts = np.bincount(types, minlength=len(self._event_list))
+        bounds = np.concatenate(([0], np.cumsum(counts)))
+        self._offsets = {event.name: offsets[order[bounds[event.index]:bounds[event.index + 1]]]
+                         for event in self._event_list}
+
+    def _index_compressed(self, data, count_compressed, decode_compressed):
+        n_types = len(self._event_list)
+        payload_size = np.array([e.payload_size for e in self._event_list], dtype=np.int64)
+        num_fields = np.array([len(e.field_sizes) for e in self._event_list], dtype=np.int64)
+        max_fields = int(num_fields.max()) if n_types > 0 else 0
+        field_sizes = np.zeros((max(n_types, 1), max(max_fields, 1)), dtype=np.int64)
+        for e in self._event_list:
+            field_sizes[e.index, :len(e.field_sizes)] = e.field_sizes
+
+        counts = np.zeros(n_types, dtype=np.int64)
+        stop = count_compressed(data, self._data_start, self._data_end, payload_size, num_fields, counts)
+
+        ts_base = np.concatenate(([0], np.cumsum(counts)[:-1])).astype(np.int64)
+        raw_base = np.concatenate(([0], np.cumsum(counts * payload_size)[:-1])).astype(np.int64)
+        timestamps = np.empty(int(counts.sum()), dtype=np.int64)
+        raw_size = int((counts * payload_size).sum())
+        raw = np.empty(raw_size, dtype=np.uint8) if self.use_numba else bytearray(raw_size)
+
+        filled = np.zeros(n_types, dtype=np.int64)
+        decode_compressed(data, self._data_start, stop, payload_size, field_sizes, num_fields, ts_base,
+                          raw_base, timestamps, raw, filled)
+        raw = np.frombuffer(raw, dtype=np.uint8)
+
+        self._timestamps = {}
+        self._raw = {}
+        for e in self._event_list:
+            count = int(counts[e.index])
+            self._timestamps[e.name] = timestamps[ts_base[e.index]:ts_base[e.index] + count]
+            raw_start = int(raw_base[e.index])
+            if e.payload_size > 0:
+                self._raw[e.name] = raw[raw_start:raw_start + count * e.payload_size].view(e.dtype)
+            else:
+                self._raw[e.name] = np.zeros(count, dtype=e.dtype)
+
+    def count(self, name):
+        """Number of records of an event type"""
+        if self.version == 3:
+            return len(self._timestamps[name])
+        return len(self._offsets[name])
+
+    def records(self, name):
+        """
+        The records of an event type as a structured array, with the payload variables and for version 1 and 2 also
+        the id and raw timestamp of each record
+        """
+        if self.version == 3:
+            return self._raw[name]
+
+        event = self.event_types[name]
+        dtype = self._record_dtypes[event.index]
+        offsets = self._offsets[name]
+        result = np.empty(len(offsets), dtype=dtype)
+        result_bytes = result.view(np.uint8).reshape(len(offsets), dtype.itemsize)
+        columns = np.arange(dtype.itemsize)
+        for start in range(0, len(offsets), _GATHER_CHUNK):
+            chunk = offsets[start:start + _GATHER_CHUNK]
+            result_bytes[start:start + len(chunk)] = self._buffer[chunk[:, None] + columns]
+        return result
+
+    def timestamps_us(self, name):
+        """The timestamps of an event type in microseconds, as int64"""
+        if self.version == 3:
+            return self._timestamps[name]
+        timestamps = self.records(name)['timestamp'].astype(np.int64)
+        if self.version == 1:
+            # Version 1 has timestamps in ms
+            timestamps *= 1000
+        return timestamps
+
+    def columns(self, name):
+        """
+        The variables of an event type as a dict of arrays, with the timestamp in ms in 'timestamp', as from
+        cfusdlog.decode()
+        """
+        if name in self._columns:
+            return self._columns[name]
+
+        event = self.event_types[name]
+        records = self.records(name)
+        result = {}
+        if self.version == 1:
+            result['timestamp'] = records['timestamp'].copy()
+        elif self.version == 2:
+            result['timestamp'] = records['timestamp'] / 1000.0
+        else:
+            result['timestamp'] = self._timestamps[name] / 1000.0
+        for var in event.variables:
+            result[var] = np.ascontiguousarray(records[var])
+
+        self._columns[name] = result
+        return result
+
+    def to_dict(self):
+        """All event types with data, in the same format as cfusdlog.decode()"""
+        return {name: self.columns(name) for name in self.event_types if self.count(name) > 0}
+
+    def parquet_columns(self, name):
+        """
+        The variables of an event type as contiguous 1D arrays with fixed size types, ready for pyarrow or pandas.
+        The timestamp is in 'timestamp_us' as int64 microseconds, dots in the variable names are replaced by
+        underscores.
+        """
+        event = self.event_types[name]
+        records = self.records(name)
+        result = {'timestamp_us': self.timestamps_us(name)}
+        for var in event.variables:
+            result[var.replace('.', '_')] = np.ascontiguousarray(records[var])
+        return result
+
+    def write_parquet(self, directory):
+        """Write one parquet file per event type with data to a directory, requires pyarrow"""
+        import pyarrow as pa
+        import pyarrow.parquet as pq
+
+        os.makedirs(directory, exist_ok=True)
+        written = []
+        for name in self.event_types:
+            if self.count(name) == 0:
+                continue
+            table = pa.table(self.parquet_columns(name))
+            path = os.path.join(directory, name + '.parquet')
+            pq.write_table(table, path)
+            written.append(path)
+        return written
+
+
+def decode(filename, use_numba=None):
+    """Decode a log file, returns the same result as cfusdlog.decode()"""
+    with UsdLog(filename, use_numba=use_numba) as log:
+        return log.to_dict()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("filename")
+    parser.add_argument("--parquet", help="write one parquet file per event type to this directory")
+    parser.add_argument("--no-numba", action="store_true", help="do not compile the scan with numba")
+    args = parser.parse_args()
+
+    with UsdLog(args.filename, use_numba=False if args.no_numba else None) as log:
+        print('Version {}, {} event types'.format(log.version, len(log.event_types)))
+        for name in log.event_types:
+            print('  {:24s} {:10d} records'.format(name, log.count(name)))
+        if args.parquet:
+            for path in log.write_parquet(args.parquet):
+                print('Wrote', path)